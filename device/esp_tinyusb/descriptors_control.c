@@ -32,7 +32,9 @@ typedef struct {
 #if (TUD_OPT_HIGH_SPEED)
     const uint8_t *hs_cfg;              /*!< Pointer to HighSpeed configuration descriptor */
     const tusb_desc_device_qualifier_t *qualifier;            /*!< Pointer to Qualifier descriptor */
-    uint8_t *other_speed;               /*!< Pointer for other speed configuration descriptor */
+    const uint8_t *fs_other_speed;      /*!< FullSpeed other speed configuration descriptor, in flash, NULL to build it in other_speed_buf */
+    const uint8_t *hs_other_speed;      /*!< HighSpeed other speed configuration descriptor, in flash, NULL to build it in other_speed_buf */
+    uint8_t *other_speed_buf;           /*!< Buffer for other speed configuration descriptors that were not provided */
 #endif // TUD_OPT_HIGH_SPEED
     const char *str[USB_STRING_DESCRIPTOR_ARRAY_SIZE];  /*!< Pointer to array of UTF-8 strings */
     int str_count;                      /*!< Number of descriptors in str */
@@ -99,18 +101,47 @@ uint8_t const *tud_descriptor_device_qualifier_cb(void)
  */
 uint8_t const *tud_descriptor_other_speed_configuration_cb(uint8_t index)
 {
-    assert(s_desc_cfg.other_speed);
+    const bool high_speed = (TUSB_SPEED_HIGH == tud_speed_get());
+    const uint8_t *other_speed = high_speed ? s_desc_cfg.fs_other_speed : s_desc_cfg.hs_other_speed;
+    if (other_speed) {
+        return other_speed;
+    }
 
-    const uint8_t *other_speed = (TUSB_SPEED_HIGH == tud_speed_get())
-                                 ? s_desc_cfg.fs_cfg
-                                 : s_desc_cfg.hs_cfg;
+    assert(s_desc_cfg.other_speed_buf);
+    const uint8_t *cfg = high_speed ? s_desc_cfg.fs_cfg : s_desc_cfg.hs_cfg;
+    memcpy(s_desc_cfg.other_speed_buf,
+           cfg,
+           ((tusb_desc_configuration_t *)cfg)->wTotalLength);
 
-    memcpy(s_desc_cfg.other_speed,
-           other_speed,
-           ((tusb_desc_configuration_t *)other_speed)->wTotalLength);
+    ((tusb_desc_configuration_t *)s_desc_cfg.other_speed_buf)->bDescriptorType = TUSB_DESC_OTHER_SPEED_CONFIG;
+    return s_desc_cfg.other_speed_buf;
+}
 
-    ((tusb_desc_configuration_t *)s_desc_cfg.other_speed)->bDescriptorType = TUSB_DESC_OTHER_SPEED_CONFIG;
-    return s_desc_cfg.other_speed;
+/**
+ * @brief Select other speed configuration descriptor
+ *
+ * @param[in] provided    Descriptor of the user, can be NULL
+ * @param[in] cfg         Selected configuration descriptor of the same speed
+ * @param[in] cfg_default Default configuration descriptor of the same speed
+ * @param[in] od_default  Default other speed configuration descriptor of the same speed
+ * @param[out] other_speed Descriptor in flash, NULL if it must be built in RAM
+ * @return ESP_OK or ESP_ERR_INVALID_ARG if the provided descriptor does not match the configuration descriptor
+ */
+static esp_err_t tinyusb_select_other_speed(const uint8_t *provided, const uint8_t *cfg, const uint8_t *cfg_default,
+                                            const uint8_t *od_default, const uint8_t **other_speed)
+{
+    *other_speed = NULL;
+    if (provided) {
+        const tusb_desc_configuration_t *od = (const tusb_desc_configuration_t *)provided;
+        ESP_RETURN_ON_FALSE(od->bDescriptorType == TUSB_DESC_OTHER_SPEED_CONFIG, ESP_ERR_INVALID_ARG, TAG,
+                            "Other speed configuration descriptor must have type %d", TUSB_DESC_OTHER_SPEED_CONFIG);
+        ESP_RETURN_ON_FALSE(od->wTotalLength == ((const tusb_desc_configuration_t *)cfg)->wTotalLength, ESP_ERR_INVALID_ARG, TAG,
+                            "Other speed configuration descriptor must be same length as the configuration descriptor");
+        *other_speed = provided;
+    } else if (cfg == cfg_default) {
+        *other_speed = od_default;
+    }
+    return ESP_OK;
 }
 #endif // TUD_OPT_HIGH_SPEED
 
@@ -179,10 +210,13 @@ esp_err_t tinyusb_set_descriptors(const tinyusb_config_t *config)
     // Select FullSpeed configuration descriptor
     if (config->configuration_descriptor == NULL) {
         // Default configuration descriptor must be provided for the following classes
-#if (CFG_TUD_HID > 0 || CFG_TUD_MIDI > 0 || CFG_TUD_ECM_RNDIS > 0 || CFG_TUD_DFU > 0 || CFG_TUD_DFU_RUNTIME > 0 || CFG_TUD_BTH > 0)
+#if (CFG_TUD_HID > 0 || CFG_TUD_MIDI > 0 || CFG_TUD_ECM_RNDIS > 0 || CFG_TUD_DFU > 0 || CFG_TUD_DFU_RUNTIME > 0 || CFG_TUD_BTH > 0 || CFG_TUD_VIDEO > 0 || CFG_TUD_AUDIO > 0)
         ESP_GOTO_ON_FALSE(config->configuration_descriptor, ESP_ERR_INVALID_ARG, fail, TAG, "Configuration descriptor must be provided for this device");
 #else
         ESP_LOGW(TAG, "No FullSpeed configuration descriptor provided, using default.");
+        ESP_GOTO_ON_FALSE(descriptor_cfg_default_ep_count <= TUSB_EPNUM_MAX, ESP_ERR_NOT_SUPPORTED, fail, TAG,
+                          "Default configuration descriptor needs %d endpoints, the USB controller has %d",
+                          descriptor_cfg_default_ep_count, TUSB_EPNUM_MAX);
         s_desc_cfg.cfg = descriptor_fs_cfg_default;
 #endif
     } else {
@@ -193,7 +227,7 @@ esp_err_t tinyusb_set_descriptors(const tinyusb_config_t *config)
     // High Speed
     if (config->hs_configuration_descriptor == NULL) {
         // Default configuration descriptor must be provided for the following classes
-#if (CFG_TUD_HID > 0 || CFG_TUD_MIDI > 0 || CFG_TUD_ECM_RNDIS > 0 || CFG_TUD_DFU > 0 || CFG_TUD_DFU_RUNTIME > 0 || CFG_TUD_BTH > 0)
+#if (CFG_TUD_HID > 0 || CFG_TUD_MIDI > 0 || CFG_TUD_ECM_RNDIS > 0 || CFG_TUD_DFU > 0 || CFG_TUD_DFU_RUNTIME > 0 || CFG_TUD_BTH > 0 || CFG_TUD_VIDEO > 0 || CFG_TUD_AUDIO > 0)
         ESP_GOTO_ON_FALSE(config->hs_configuration_descriptor, ESP_ERR_INVALID_ARG, fail, TAG, "HighSpeed configuration descriptor must be provided for this device");
 #else
         ESP_LOGW(TAG, "No HighSpeed configuration descriptor provided, using default.");
@@ -218,9 +252,17 @@ esp_err_t tinyusb_set_descriptors(const tinyusb_config_t *config)
         s_desc_cfg.qualifier = config->qualifier_descriptor;
     }
 
-    // Other Speed buffer allocate
-    s_desc_cfg.other_speed = calloc(1, ((tusb_desc_configuration_t *)s_desc_cfg.hs_cfg)->wTotalLength);
-    ESP_GOTO_ON_FALSE(s_desc_cfg.other_speed, ESP_ERR_NO_MEM, fail, TAG, "Other speed memory allocation error");
+    // Other speed descriptors of the defaults and provided ones are in flash, only the others need a buffer
+    ESP_GOTO_ON_ERROR(tinyusb_select_other_speed(config->fs_other_speed_descriptor, s_desc_cfg.fs_cfg, descriptor_fs_cfg_default,
+                                                 descriptor_fs_other_speed_default, &s_desc_cfg.fs_other_speed),
+                      fail, TAG, "FullSpeed other speed configuration descriptor invalid");
+    ESP_GOTO_ON_ERROR(tinyusb_select_other_speed(config->hs_other_speed_descriptor, s_desc_cfg.hs_cfg, descriptor_hs_cfg_default,
+                                                 descriptor_hs_other_speed_default, &s_desc_cfg.hs_other_speed),
+                      fail, TAG, "HighSpeed other speed configuration descriptor invalid");
+    if (s_desc_cfg.fs_other_speed == NULL || s_desc_cfg.hs_other_speed == NULL) {
+        s_desc_cfg.other_speed_buf = calloc(1, ((tusb_desc_configuration_t *)s_desc_cfg.hs_cfg)->wTotalLength);
+        ESP_GOTO_ON_FALSE(s_desc_cfg.other_speed_buf, ESP_ERR_NO_MEM, fail, TAG, "Other speed memory allocation error");
+    }
 #endif // TUD_OPT_HIGH_SPEED
 
     // Select String Descriptors and count them
@@ -274,7 +316,8 @@ esp_err_t tinyusb_set_descriptors(const tinyusb_config_t *config)
 
 fail:
 #if (TUD_OPT_HIGH_SPEED)
-    free(s_desc_cfg.other_speed);
+    free(s_desc_cfg.other_speed_buf);
+    s_desc_cfg.other_speed_buf = NULL;
 #endif // TUD_OPT_HIGH_SPEED
     return ret;
 }
@@ -288,7 +331,8 @@ void tinyusb_set_str_descriptor(const char *str, int str_idx)
 void tinyusb_free_descriptors(void)
 {
 #if (TUD_OPT_HIGH_SPEED)
-    assert(s_desc_cfg.other_speed);
-    free(s_desc_cfg.other_speed);
+    // NULL after a failed tinyusb_driver_reconfigure() or if all other speed descriptors are in flash
+    free(s_desc_cfg.other_speed_buf);
+    s_desc_cfg.other_speed_buf = NULL;
 #endif // TUD_OPT_HIGH_SPEED
 }
@@ -15,6 +15,34 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Configuration descriptor header with other speed descriptor type
+ *
+ * Same arguments as TUD_CONFIG_DESCRIPTOR(). Build the other speed configuration descriptors as const arrays
+ * with the same function descriptors as the configuration descriptors, so they stay in flash:
+ *
+ * @code{c}
+ * #define MY_FUNCTIONS(ep_size) TUD_CDC_DESCRIPTOR(0, 4, 0x81, 8, 0x02, 0x82, ep_size)
+ * static const uint8_t fs_cfg[] = { TUD_CONFIG_DESCRIPTOR(1, 2, 0, MY_LEN, 0, 100), MY_FUNCTIONS(64) };
+ * static const uint8_t fs_other_speed[] = { TINYUSB_OTHER_SPEED_CONFIG_DESCRIPTOR(1, 2, 0, MY_LEN, 0, 100), MY_FUNCTIONS(64) };
+ * @endcode
+ */
+#define TINYUSB_OTHER_SPEED_CONFIG_DESCRIPTOR(_config_num, _itfcount, _stridx, _total_len, _attribute, _power_ma) \
+    TUD_CONFIG_DESC_LEN, TUSB_DESC_OTHER_SPEED_CONFIG, U16_TO_U8S_LE(_total_len), _itfcount, _config_num, _stridx, \
+    TU_BIT(7) | (_attribute), (_power_ma) / 2
+
+/**
+ * @brief Check endpoint address and size of a descriptor at compile time
+ *
+ * @param _ep_addr      Endpoint address, number 1 to 15 with direction bit
+ * @param _ep_size      Maximum packet size of a bulk endpoint
+ * @param _high_speed   1 for the HighSpeed configuration descriptor, 0 for the FullSpeed one
+ */
+#define TINYUSB_DESC_STATIC_ASSERT_BULK_EP(_ep_addr, _ep_size, _high_speed) \
+    _Static_assert(((_ep_addr) & 0x0F) != 0 && ((_ep_addr) & 0x70) == 0, "Invalid endpoint address"); \
+    _Static_assert((_high_speed) ? (_ep_size) == 512 : ((_ep_size) == 8 || (_ep_size) == 16 || (_ep_size) == 32 || (_ep_size) == 64), \
+                   "Invalid bulk endpoint size")
+
 /**
  * @brief Configuration structure of the TinyUSB core
  *
@@ -42,6 +70,8 @@ typedef struct {
     };
     const uint8_t *hs_configuration_descriptor;                 /*!< Pointer to a HighSpeed configuration descriptor. If set to NULL, TinyUSB device will use a default configuration descriptor whose values are set in Kconfig */
     const tusb_desc_device_qualifier_t *qualifier_descriptor;   /*!< Pointer to a qualifier descriptor */
+    const uint8_t *fs_other_speed_descriptor;                   /*!< FullSpeed configuration with other speed descriptor type, see TINYUSB_OTHER_SPEED_CONFIG_DESCRIPTOR(). If NULL, it is copied from the FullSpeed configuration descriptor into a RAM buffer on request */
+    const uint8_t *hs_other_speed_descriptor;                   /*!< HighSpeed configuration with other speed descriptor type. If NULL, it is copied from the HighSpeed configuration descriptor into a RAM buffer on request */
 #else
     };
 #endif // TUD_OPT_HIGH_SPEED
@@ -80,6 +110,28 @@ esp_err_t tinyusb_driver_install(const tinyusb_config_t *config);
  */
 esp_err_t tinyusb_driver_uninstall(void);
 
+/**
+ * @brief Switch the descriptors without uninstalling the driver
+ *
+ * The device detaches from the bus, the descriptors of config are set in the TinyUSB task,
+ * and the device attaches again after CONFIG_TINYUSB_RECONFIGURE_DETACH_MS, so that the host
+ * enumerates the new personality. The PHY, the TinyUSB task and the stack stay initialized.
+ * The class drivers are closed and tud_umount_cb() is invoked, like on unplugging the cable.
+ *
+ * @note Only classes enabled in menuconfig can be used by the new descriptors. Class helpers of the
+ *       old descriptors, e.g. tusb_cdc_acm_deinit(), should be deinitialized before the call,
+ *       class helpers of the new descriptors initialized after it.
+ * @note With CONFIG_TINYUSB_NO_DEFAULT_TASK, tud_task() must be running in another task.
+ *
+ * @param config Configuration of the new descriptors, external_phy, self_powered and vbus_monitor_io are ignored
+ * @retval ESP_ERR_INVALID_ARG Invalid descriptors, the device stays detached until called with valid ones
+ * @retval ESP_ERR_INVALID_STATE Driver not installed
+ * @retval ESP_ERR_NOT_SUPPORTED Device controller can't detach
+ * @retval ESP_ERR_TIMEOUT TinyUSB task did not swap the descriptors
+ * @retval ESP_OK Descriptors switched, device attached
+ */
+esp_err_t tinyusb_driver_reconfigure(const tinyusb_config_t *config);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_BTH_BRIDGE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Counters of the BTH bridge
+ */
+typedef struct {
+    uint32_t cmd_to_controller;     /*!< HCI commands passed to the controller */
+    uint32_t acl_to_controller;     /*!< ACL packets passed to the controller */
+    uint32_t evt_to_host;           /*!< HCI events passed to the USB host */
+    uint32_t acl_to_host;           /*!< ACL packets passed to the USB host */
+    uint32_t dropped_to_controller; /*!< Packets of the USB host dropped, no free buffer or larger than the buffer */
+    uint32_t dropped_to_host;       /*!< Packets of the controller dropped, no free buffer or device not mounted */
+    uint32_t dropped_iso;           /*!< SCO and ISO data of the controller, which BTH cannot pass to the USB host */
+    uint16_t acl_credits;           /*!< ACL packets the controller can take now */
+    uint16_t acl_credits_max;       /*!< ACL buffers of the controller, 0 until the host read the buffer size */
+    uint16_t acl_waiting;           /*!< ACL packets waiting for controller credits */
+} tinyusb_bth_bridge_stats_t;
+
+/**
+ * @brief Configuration of the BTH bridge
+ */
+typedef struct {
+    uint8_t ep_evt;                 /*!< Address of the interrupt IN endpoint of HCI events in the configuration descriptor, e.g. 0x81 */
+    uint8_t ep_acl_in;              /*!< Address of the bulk IN endpoint of ACL data in the configuration descriptor, e.g. 0x82 */
+} tinyusb_config_bth_t;
+
+/**
+ * @brief Start the bridge between the BTH interface and the Bluetooth controller
+ *
+ * HCI commands and ACL data of the USB host are passed to the controller via VHCI,
+ * events and ACL data of the controller are sent to the USB host. Packets are kept
+ * in CONFIG_TINYUSB_BTH_BRIDGE_BUFFER_NUM preallocated buffers per direction and
+ * sent from the buffer they were received into.
+ *
+ * ACL data is passed to the controller only while it has free ACL buffers. The number
+ * of buffers is taken from the Read Buffer Size commands of the host and the credits
+ * are returned by Number Of Completed Packets events.
+ *
+ * @note The Bluetooth controller must be initialized and enabled by the application.
+ *       The bridge registers the VHCI callbacks, so the controller must not be used by a host stack
+ *       running on the device at the same time.
+ *
+ * @param[in] config Configuration
+ * @return
+ *    - ESP_OK: Bridge started
+ *    - ESP_ERR_INVALID_ARG: Invalid endpoint address
+ *    - ESP_ERR_INVALID_STATE: Bridge already started
+ *    - ESP_ERR_NO_MEM: Not enough memory for the buffers and queues
+ *    - Error of esp_vhci_host_register_callback()
+ */
+esp_err_t tinyusb_bth_bridge_init(const tinyusb_config_bth_t *config);
+
+/**
+ * @brief Stop the bridge
+ *
+ * Packets in the buffers are dropped. The VHCI callbacks stay registered and discard
+ * packets of the controller until the bridge is started again.
+ *
+ * @return
+ *    - ESP_OK: Bridge stopped
+ *    - ESP_ERR_INVALID_STATE: Bridge not started, or a packet is being sent to the mounted USB host
+ *    - ESP_ERR_TIMEOUT: TinyUSB task did not stop the bridge
+ */
+esp_err_t tinyusb_bth_bridge_deinit(void);
+
+/**
+ * @brief Get counters of the bridge
+ *
+ * @param[out] stats Counters since tinyusb_bth_bridge_init()
+ * @return
+ *    - ESP_OK: Counters copied
+ *    - ESP_ERR_INVALID_ARG: stats is NULL
+ *    - ESP_ERR_INVALID_STATE: Bridge not started
+ */
+esp_err_t tinyusb_bth_bridge_get_stats(tinyusb_bth_bridge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_BTH_BRIDGE
@@ -0,0 +1,71 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_DFU_OTA
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Callback on the end of the DFU download
+ *
+ * Invoked from the DFU writer task after the image was written and set as the boot partition,
+ * or after the manifestation failed. Typically schedules a restart into the new firmware.
+ *
+ * @param[in] result ESP_OK if the new image is the boot partition now, otherwise the error of the OTA update
+ * @param[in] arg    User argument of the configuration
+ */
+typedef void (*tinyusb_dfu_complete_cb_t)(esp_err_t result, void *arg);
+
+/**
+ * @brief Configuration of the DFU OTA backend
+ */
+typedef struct {
+    const esp_partition_t *partition;       /*!< OTA partition to write the image to, NULL selects esp_ota_get_next_update_partition() */
+    tinyusb_dfu_complete_cb_t complete_cb;  /*!< Callback on the end of the download, can be NULL */
+    void *user_arg;                         /*!< User argument of complete_cb */
+} tinyusb_dfu_config_t;
+
+/**
+ * @brief Initialize the DFU OTA backend
+ *
+ * DFU_DNLOAD blocks are copied to one of CONFIG_TINYUSB_DFU_BUFFER_NUM buffers and written to the
+ * OTA partition by a separate task, so the host sends the next block while the previous one
+ * is erased and programmed. The download is accepted immediately while a buffer is free,
+ * otherwise GETSTATUS reports the measured write time of a block as the poll timeout.
+ *
+ * @param[in] config Configuration, can be NULL for the defaults
+ * @return
+ *    - ESP_OK: DFU backend initialized
+ *    - ESP_ERR_INVALID_STATE: Already initialized
+ *    - ESP_ERR_NOT_FOUND: No OTA partition to update
+ *    - ESP_ERR_NO_MEM: Not enough memory for the buffers or the writer task
+ */
+esp_err_t tinyusb_dfu_init(const tinyusb_dfu_config_t *config);
+
+/**
+ * @brief Deinitialize the DFU OTA backend
+ *
+ * An unfinished download is aborted.
+ *
+ * @return
+ *    - ESP_OK: DFU backend deinitialized
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ */
+esp_err_t tinyusb_dfu_deinit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_DFU_OTA
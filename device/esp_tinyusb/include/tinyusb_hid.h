@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_HID_REPORT_QUEUE
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initialize the report queue of a HID interface
+ *
+ * @param[in] instance HID interface, from 0 to CONFIG_TINYUSB_HID_COUNT - 1
+ * @return
+ *    - ESP_OK: Report queue initialized
+ *    - ESP_ERR_INVALID_ARG: Invalid instance
+ *    - ESP_ERR_INVALID_STATE: Already initialized
+ *    - ESP_ERR_NO_MEM: Not enough memory for the queue
+ */
+esp_err_t tinyusb_hid_init(uint8_t instance);
+
+/**
+ * @brief Deinitialize the report queue of a HID interface
+ *
+ * Queued reports are dropped.
+ *
+ * @param[in] instance HID interface
+ * @return
+ *    - ESP_OK: Report queue deinitialized
+ *    - ESP_ERR_INVALID_ARG: Invalid instance
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_TIMEOUT: TinyUSB task did not remove the queue
+ */
+esp_err_t tinyusb_hid_deinit(uint8_t instance);
+
+/**
+ * @brief Queue an input report
+ *
+ * The report is copied and sent by the TinyUSB task on one of the next polls of the host,
+ * one report per poll, so reports produced in bursts reach the host at the polling interval.
+ *
+ * @param[in] instance  HID interface
+ * @param[in] report_id Report ID, 0 if the report descriptor does not use report IDs
+ * @param[in] report    Report data, without the report ID
+ * @param[in] len       Report length, up to CFG_TUD_HID_EP_BUFSIZE, minus one byte with a report ID
+ * @return
+ *    - ESP_OK: Report queued
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_NO_MEM: Queue of CONFIG_TINYUSB_HID_REPORT_QUEUE_SIZE reports is full
+ */
+esp_err_t tinyusb_hid_report(uint8_t instance, uint8_t report_id, const void *report, uint16_t len);
+
+/**
+ * @brief Queue a relative mouse report
+ *
+ * The report has the layout of hid_mouse_report_t, see TUD_HID_REPORT_DESC_MOUSE().
+ * Motion is merged into the last queued mouse report with the same report ID and buttons,
+ * as long as it is not sent yet and the sums fit into the report, so that no motion is lost
+ * when the application moves the mouse faster than the host polls it.
+ * A change of buttons is queued as a new report, so that no click is lost.
+ *
+ * @param[in] instance   HID interface
+ * @param[in] report_id  Report ID, 0 if the report descriptor does not use report IDs
+ * @param[in] buttons    Button mask, see hid_mouse_button_bm_t
+ * @param[in] x          Horizontal motion
+ * @param[in] y          Vertical motion
+ * @param[in] vertical   Wheel motion
+ * @param[in] horizontal Pan motion
+ * @return
+ *    - ESP_OK: Motion queued
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_NO_MEM: Queue is full
+ */
+esp_err_t tinyusb_hid_mouse_report(uint8_t instance, uint8_t report_id, uint8_t buttons,
+                                   int8_t x, int8_t y, int8_t vertical, int8_t horizontal);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_HID_REPORT_QUEUE
@@ -0,0 +1,128 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_MIDI_BATCH
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Received USB-MIDI event packet
+ */
+typedef struct {
+    uint8_t packet[4];                  /*!< Cable number and code index, followed by up to 3 MIDI bytes */
+    int64_t timestamp_us;               /*!< esp_timer_get_time() when the packet was taken from the endpoint */
+} tinyusb_midi_event_t;
+
+/**
+ * @brief Callback on received event packets
+ *
+ * Invoked from the TinyUSB task, must not block, e.g. to notify the task calling tinyusb_midi_read().
+ *
+ * @param[in] itf MIDI interface
+ * @param[in] arg User argument of the configuration
+ */
+typedef void (*tinyusb_midi_rx_cb_t)(uint8_t itf, void *arg);
+
+/**
+ * @brief Configuration of the MIDI event queues
+ */
+typedef struct {
+    uint8_t itf;                        /*!< MIDI interface, from 0 to CONFIG_TINYUSB_MIDI_COUNT - 1 */
+    uint8_t ep_in;                      /*!< Address of the IN endpoint of the interface in the configuration descriptor, e.g. 0x81 */
+    tinyusb_midi_rx_cb_t rx_cb;         /*!< Callback on received event packets, can be NULL */
+    void *user_arg;                     /*!< User argument of rx_cb */
+} tinyusb_config_midi_t;
+
+/**
+ * @brief Initialize the event queues of a MIDI interface
+ *
+ * @param[in] config Configuration
+ * @return
+ *    - ESP_OK: MIDI interface initialized
+ *    - ESP_ERR_INVALID_ARG: Invalid configuration
+ *    - ESP_ERR_INVALID_STATE: Already initialized
+ *    - ESP_ERR_NO_MEM: Not enough memory for the queues or the latency timer
+ */
+esp_err_t tinyusb_midi_init(const tinyusb_config_midi_t *config);
+
+/**
+ * @brief Deinitialize the event queues of a MIDI interface
+ *
+ * Queued event packets are dropped.
+ *
+ * @param[in] itf MIDI interface
+ * @return
+ *    - ESP_OK: MIDI interface deinitialized
+ *    - ESP_ERR_INVALID_ARG: Invalid interface
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_TIMEOUT: TinyUSB task did not remove the interface
+ */
+esp_err_t tinyusb_midi_deinit(uint8_t itf);
+
+/**
+ * @brief Queue event packets to be sent to the host
+ *
+ * Packets are sent together once they fill a transfer of CFG_TUD_MIDI_EP_BUFSIZE bytes,
+ * or at the latest after CONFIG_TINYUSB_MIDI_LATENCY_US. Either all packets are queued or none.
+ *
+ * @param[in] itf     MIDI interface
+ * @param[in] packets USB-MIDI event packets of 4 bytes each
+ * @param[in] count   Number of packets
+ * @return
+ *    - ESP_OK: Packets queued
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_NO_MEM: Not enough space in the CONFIG_TINYUSB_MIDI_TX_QUEUE_SIZE queue
+ */
+esp_err_t tinyusb_midi_write_packets(uint8_t itf, const uint8_t *packets, size_t count);
+
+/**
+ * @brief Queue a system exclusive message to be sent to the host
+ *
+ * The message is split into USB-MIDI event packets of code index 0x4 to 0x7, e.g. for sysex dumps.
+ *
+ * @param[in] itf   MIDI interface
+ * @param[in] cable Cable number, from 0 to 15
+ * @param[in] sysex Message from 0xF0 to 0xF7 included
+ * @param[in] len   Message length in bytes
+ * @return
+ *    - ESP_OK: Message queued
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_NO_MEM: Not enough space in the queue for the whole message
+ */
+esp_err_t tinyusb_midi_write_sysex(uint8_t itf, uint8_t cable, const uint8_t *sysex, size_t len);
+
+/**
+ * @brief Take the oldest received event packet
+ *
+ * Lock-free, the queue of an interface must be read by one task only. While the RX queue
+ * is full, the OUT endpoint is not read, so the host waits instead of packets being dropped.
+ *
+ * @param[in]  itf   MIDI interface
+ * @param[out] event Event packet
+ * @return
+ *    - ESP_OK: Event packet taken
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_NOT_FOUND: No event packet received
+ */
+esp_err_t tinyusb_midi_read(uint8_t itf, tinyusb_midi_event_t *event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_MIDI_BATCH
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include "tinyusb_types.h"
 #include "esp_err.h"
@@ -47,6 +49,12 @@ typedef struct {
                                                */
     tusb_net_init_cb_t on_init_callback;      /*!< TinyUSB init network callback */
     void *user_context;                       /*!< User context to be passed to any of the callback */
+    bool rx_zero_copy;                        /*!< Keep the received buffer after on_recv_callback() returns ESP_OK
+                                               *    - the buffer is released by tinyusb_net_recv_done(), e.g. from free function of lwIP pbuf_custom
+                                               *    - no other frame is passed to on_recv_callback() meanwhile, next NTBs are still received
+                                               *      into the other CONFIG_TINYUSB_NCM_OUT_NTB_BUFFS_COUNT buffers
+                                               *    - if on_recv_callback() returns an error, the buffer is released immediately
+                                               */
 } tinyusb_net_config_t;
 
 /**
@@ -58,30 +66,60 @@ typedef struct {
  */
 esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t *cfg);
 
+/**
+ * @brief Frame of synchronous batch send
+ */
+typedef struct {
+    void *buffer;               /*!< USB send data */
+    uint16_t len;               /*!< Send data len */
+    void *buff_free_arg;        /*!< Pointer to be passed to the free_tx_buffer() callback */
+} tinyusb_net_frame_t;
+
 /**
  * @brief TinyUSB NET driver send data synchronously
  *
  * @note It is possible to use sync and async send interchangeably.
- * This function needs some synchronization primitives, so using sync mode (even once) uses more heap
+ * @note Several tasks can send synchronously at the same time, each request has its own completion
+ * from the packet pool (CONFIG_TINYUSB_NET_TX_PACKET_POOL_SIZE), shared with asynchronous send.
  *
  * @param[in] buffer            USB send data
  * @param[in] len               Send data len
  * @param[in] buff_free_arg     Pointer to be passed to the free_tx_buffer() callback
- * @param[in] timeout           Send data len
+ * @param[in] timeout           Timeout of the send
  * @return  ESP_OK on success == packet has been consumed by tusb and would be eventually freed
  *                              by free_tx_buffer() callback (if non null)
  *          ESP_ERR_TIMEOUT on timeout
- *          ESP_ERR_INVALID_STATE if tusb not initialized, ESP_ERR_NO_MEM on alloc failure
+ *          ESP_FAIL if the packet was not accepted by tusb
+ *          ESP_ERR_INVALID_STATE if tusb not initialized, ESP_ERR_NO_MEM if the packet pool is exhausted
  */
 esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg, TickType_t  timeout);
 
+/**
+ * @brief TinyUSB NET driver send several frames synchronously, waiting once
+ *
+ * The frames are submitted to the TinyUSB task together and sent in order, so that NCM can
+ * aggregate them into one NTB. The call waits until all of them are processed or the timeout expires.
+ *
+ * @param[in]  frames   Frames to send
+ * @param[in]  count    Number of frames
+ * @param[in]  timeout  Timeout of the whole batch
+ * @param[out] sent     Number of frames consumed by tusb, always the first ones of the array.
+ *                      Only these are freed by free_tx_buffer() callback (if non null)
+ * @return  ESP_OK if no frame failed, *sent may be less than count if the packet pool is exhausted
+ *          ESP_ERR_TIMEOUT on timeout
+ *          ESP_FAIL if a frame was not accepted by tusb
+ *          ESP_ERR_INVALID_ARG on invalid argument, ESP_ERR_INVALID_STATE if tusb not initialized
+ */
+esp_err_t tinyusb_net_send_sync_batch(const tinyusb_net_frame_t *frames, size_t count, TickType_t timeout, size_t *sent);
+
 /**
  * @brief TinyUSB NET driver send data asynchronously
  *
  * @note If using asynchronous sends, you must free the buffer using free_tx_buffer() callback.
  * @note It is possible to use sync and async send interchangeably.
- * @note Async flavor of the send is useful when the USB stack runs faster than the caller,
- * since we have no control over the transmitted packets, if they get accepted or discarded.
+ * @note Async flavor of the send is useful when the USB stack runs faster than the caller.
+ * If the USB interface cannot accept the packet, it is queued and sent when an NTB is free.
+ * Queued packets are passed together, so that NCM aggregates several datagrams into one NTB.
  *
  * @param[in] buffer            USB send data
  * @param[in] len               Send data len
@@ -89,9 +127,22 @@ esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg,
  * @return  ESP_OK on success == packet has been consumed by tusb and will be freed
  *                              by free_tx_buffer() callback (if non null)
  *          ESP_ERR_INVALID_STATE if tusb not initialized
+ *          ESP_ERR_NO_MEM if CONFIG_TINYUSB_NET_TX_PACKET_POOL_SIZE packets are already queued,
+ *                         the buffer is not consumed and the caller may retry later
  */
 esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg);
 
+/**
+ * @brief Release the buffer of received frame in zero copy mode
+ *
+ * @note Can be called from any task, including from on_recv_callback().
+ *
+ * @param[in] buffer  Buffer passed to on_recv_callback()
+ * @return  ESP_OK on success, next frame will be received
+ *          ESP_ERR_INVALID_ARG if the buffer is not held by the user
+ */
+esp_err_t tinyusb_net_recv_done(void *buffer);
+
 #endif // (CONFIG_TINYUSB_NET_MODE_NONE != 1)
 
 #ifdef __cplusplus
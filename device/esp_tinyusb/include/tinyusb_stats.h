@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_STATS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TINYUSB_STATS_CDC_NUM 7 /*!< Maximum number of CDC-ACM interfaces, upper limit of CONFIG_TINYUSB_CDC_COUNT */
+
+/**
+ * @brief Transfer counters
+ */
+typedef struct {
+    uint32_t transfers;             /*!< Number of transfers */
+    uint64_t bytes;                 /*!< Number of bytes */
+} tinyusb_stats_xfer_t;
+
+/**
+ * @brief Time a class occupied the TinyUSB task
+ *
+ * The TinyUSB task handles the events of all classes in order, so every class delays the others by its service time.
+ */
+typedef struct {
+    uint32_t count;                 /*!< Number of callbacks and deferred functions run */
+    uint64_t total_us;              /*!< Total run time */
+    uint32_t max_us;                /*!< Longest run, the worst delay caused to the other classes */
+} tinyusb_stats_service_t;
+
+/**
+ * @brief Counters of esp_tinyusb classes
+ *
+ * Counters are updated without locking, so the snapshot is not consistent as a whole under load.
+ */
+typedef struct {
+    struct {
+        tinyusb_stats_xfer_t rx;        /*!< Data read from the RX FIFO */
+        tinyusb_stats_xfer_t tx;        /*!< Data queued to the TX FIFO */
+        uint32_t tx_fifo_full;          /*!< Writes truncated, because the TX FIFO was full */
+        uint32_t tx_flush_timeout;      /*!< Flushes which timed out */
+    } cdc[TINYUSB_STATS_CDC_NUM];       /*!< CDC-ACM, per interface */
+    struct {
+        tinyusb_stats_xfer_t read;      /*!< READ10 data */
+        tinyusb_stats_xfer_t write;     /*!< WRITE10 data */
+        uint32_t write_busy;            /*!< WRITE10 retried by TinyUSB, because all write buffers were busy or, with write-through, the data was not written yet */
+        uint32_t read_busy;             /*!< READ10 retried by TinyUSB, because written data or read ahead were not in the storage yet */
+        uint64_t storage_read_us;       /*!< Total time of storage reads */
+        uint32_t storage_read_max_us;   /*!< Longest storage read */
+        uint64_t storage_write_us;      /*!< Total time of storage writes */
+        uint32_t storage_write_max_us;  /*!< Longest storage write */
+    } msc;                              /*!< Mass storage */
+    struct {
+        tinyusb_stats_xfer_t rx;        /*!< Received frames */
+        tinyusb_stats_xfer_t tx;        /*!< Frames copied to NTB */
+        uint32_t tx_busy;               /*!< Retries of the TX queue, because no NTB was free */
+        uint32_t tx_pool_empty;         /*!< Sends refused, because the packet pool was exhausted */
+        uint32_t tx_dropped;            /*!< Queued frames dropped, because the device was disconnected */
+        uint32_t tx_queue_max;          /*!< Maximum depth of the TX queue */
+    } net;                              /*!< Network */
+    uint32_t worker_queue_max;          /*!< Maximum depth of the worker task queue, see tusb_defer_work() */
+    struct {
+        tinyusb_stats_service_t cdc;    /*!< CDC-ACM user callbacks and VFS receiver */
+        tinyusb_stats_service_t msc;    /*!< MSC READ10, WRITE10 and SCSI callbacks */
+        tinyusb_stats_service_t net;    /*!< Network receive callback and deferred sends */
+    } service;                          /*!< Time the classes occupied the TinyUSB task */
+} tinyusb_stats_t;
+
+/**
+ * @brief Get counters of esp_tinyusb classes
+ *
+ * @param[out] stats Counters since start or since tinyusb_reset_stats()
+ * @return
+ *     - ESP_OK on success
+ *     - ESP_ERR_INVALID_ARG if stats is NULL
+ */
+esp_err_t tinyusb_get_stats(tinyusb_stats_t *stats);
+
+/**
+ * @brief Reset all counters to zero
+ */
+void tinyusb_reset_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_STATS
@@ -0,0 +1,144 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "driver/i2s_std.h"
+#include "tusb.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_UAC_ENABLED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Entities of the speaker audio function
+#define TINYUSB_UAC_ENTITY_INPUT_TERMINAL   0x01
+#define TINYUSB_UAC_ENTITY_FEATURE_UNIT     0x02
+#define TINYUSB_UAC_ENTITY_OUTPUT_TERMINAL  0x03
+#define TINYUSB_UAC_ENTITY_CLOCK            0x04
+
+/**
+ * @brief UAC2 stereo speaker function with explicit feedback endpoint
+ *
+ * The length is TINYUSB_UAC_SPEAKER_DESC_LEN, see tusb_config.h.
+ *
+ * @param _itfnum  Number of the audio control interface, the streaming interface is _itfnum + 1
+ * @param _stridx  String index of the function
+ * @param _epout   Address of the isochronous OUT endpoint, e.g. 0x01
+ * @param _epfb    Address of the feedback IN endpoint, e.g. 0x81
+ */
+#define TINYUSB_UAC_SPEAKER_DESCRIPTOR(_itfnum, _stridx, _epout, _epfb) \
+    TUD_AUDIO_DESC_IAD(_itfnum, 0x02, 0x00), \
+    TUD_AUDIO_DESC_STD_AC(_itfnum, 0x00, _stridx), \
+    TUD_AUDIO_DESC_CS_AC(0x0200, AUDIO_FUNC_DESKTOP_SPEAKER, \
+                         TUD_AUDIO_DESC_CLK_SRC_LEN + TUD_AUDIO_DESC_INPUT_TERM_LEN + \
+                         TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_LEN + TUD_AUDIO_DESC_OUTPUT_TERM_LEN, \
+                         AUDIO_CS_AS_INTERFACE_CTRL_LATENCY_POS), \
+    TUD_AUDIO_DESC_CLK_SRC(TINYUSB_UAC_ENTITY_CLOCK, AUDIO_CLOCK_SOURCE_ATT_INT_FIX_CLK, \
+                           (AUDIO_CTRL_R << AUDIO_CLOCK_SOURCE_CTRL_CLK_FRQ_POS), 0x00, 0x00), \
+    TUD_AUDIO_DESC_INPUT_TERM(TINYUSB_UAC_ENTITY_INPUT_TERMINAL, AUDIO_TERM_TYPE_USB_STREAMING, 0x00, \
+                              TINYUSB_UAC_ENTITY_CLOCK, 0x02, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0x00, 0x00, 0x00), \
+    TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL(TINYUSB_UAC_ENTITY_FEATURE_UNIT, TINYUSB_UAC_ENTITY_INPUT_TERMINAL, \
+                                            (AUDIO_CTRL_RW << AUDIO_FEATURE_UNIT_CTRL_MUTE_POS | AUDIO_CTRL_RW << AUDIO_FEATURE_UNIT_CTRL_VOLUME_POS), \
+                                            0x00, 0x00, 0x00), \
+    TUD_AUDIO_DESC_OUTPUT_TERM(TINYUSB_UAC_ENTITY_OUTPUT_TERMINAL, AUDIO_TERM_TYPE_OUT_GENERIC_SPEAKER, 0x00, \
+                               TINYUSB_UAC_ENTITY_FEATURE_UNIT, TINYUSB_UAC_ENTITY_CLOCK, 0x0000, 0x00), \
+    /* Alternate 0 without bandwidth, alternate 1 streams */ \
+    TUD_AUDIO_DESC_STD_AS_INT((uint8_t)((_itfnum) + 1), 0x00, 0x00, 0x00), \
+    TUD_AUDIO_DESC_STD_AS_INT((uint8_t)((_itfnum) + 1), 0x01, 0x02, 0x00), \
+    TUD_AUDIO_DESC_CS_AS_INT(TINYUSB_UAC_ENTITY_INPUT_TERMINAL, AUDIO_CTRL_NONE, AUDIO_FORMAT_TYPE_I, \
+                             AUDIO_DATA_FORMAT_TYPE_I_PCM, 0x02, AUDIO_CHANNEL_CONFIG_NON_PREDEFINED, 0x00), \
+    TUD_AUDIO_DESC_TYPE_I_FORMAT(CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE, CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE * 8), \
+    TUD_AUDIO_DESC_STD_AS_ISO_EP(_epout, (uint8_t)(TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS | TUSB_ISO_EP_ATT_DATA), \
+                                 TINYUSB_UAC_EP_SIZE, 0x01), \
+    TUD_AUDIO_DESC_CS_AS_ISO_EP(AUDIO_CS_AS_ISO_DATA_EP_ATT_NON_MAX_PACKETS_OK, AUDIO_CTRL_NONE, \
+                                AUDIO_CS_AS_ISO_DATA_EP_LOCK_DELAY_UNIT_UNDEFINED, 0x0000), \
+    /* Explicit feedback endpoint, 10.14 format on full-speed and 16.16 on high-speed */ \
+    7, TUSB_DESC_ENDPOINT, _epfb, (uint8_t)(TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_NO_SYNC | TUSB_ISO_EP_ATT_EXPLICIT_FB), \
+    U16_TO_U8S_LE(TUD_OPT_HIGH_SPEED ? 4 : 3), 0x01
+
+/**
+ * @brief Callback on mute or volume change by the host
+ *
+ * Invoked from the TinyUSB task, must not block. Muted audio is replaced by silence,
+ * the volume is applied by the application, e.g. in the codec.
+ *
+ * @param[in] mute       Master mute
+ * @param[in] volume_db  Master volume in 1/256 dB, from TINYUSB_UAC_VOLUME_MIN_DB to 0
+ * @param[in] arg        User argument of the configuration
+ */
+typedef void (*tinyusb_uac_volume_cb_t)(bool mute, int16_t volume_db, void *arg);
+
+#define TINYUSB_UAC_VOLUME_MIN_DB   (-90 * 256) /*!< Minimum volume reported to the host, in 1/256 dB */
+
+/**
+ * @brief Configuration of the UAC speaker
+ */
+typedef struct {
+    i2s_chan_handle_t i2s_tx;           /*!< Initialized, not yet enabled, I2S TX channel with CONFIG_TINYUSB_UAC_SAMPLE_RATE,
+                                             stereo slots of CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE. It is enabled by the driver */
+    tinyusb_uac_volume_cb_t volume_cb;  /*!< Callback on mute or volume change, can be NULL */
+    void *user_arg;                     /*!< User argument of volume_cb */
+} tinyusb_config_uac_t;
+
+/**
+ * @brief Counters of the UAC speaker
+ */
+typedef struct {
+    uint32_t underruns;                 /*!< I2S blocks padded with silence, because the host did not send enough samples */
+    uint32_t rate_hz;                   /*!< Sample rate of I2S, measured on the DMA buffers sent */
+    uint32_t feedback;                  /*!< Last feedback value sent to the host */
+} tinyusb_uac_stats_t;
+
+/**
+ * @brief Initialize the UAC speaker
+ *
+ * Samples of the isochronous OUT endpoint are buffered in the TinyUSB endpoint FIFO of
+ * CONFIG_TINYUSB_UAC_BUFFER_MS, from which a task writes them to the I2S DMA buffers.
+ * The feedback endpoint reports the sample rate of I2S, measured from the sent DMA buffers,
+ * corrected by the FIFO fill level, so that the host sends samples as fast as I2S plays them.
+ *
+ * @param[in] config Configuration
+ * @return
+ *    - ESP_OK: UAC speaker initialized
+ *    - ESP_ERR_INVALID_ARG: Invalid configuration
+ *    - ESP_ERR_INVALID_STATE: Already initialized, or the I2S channel is enabled
+ *    - ESP_ERR_NO_MEM: Not enough memory for the task
+ */
+esp_err_t tinyusb_uac_init(const tinyusb_config_uac_t *config);
+
+/**
+ * @brief Deinitialize the UAC speaker
+ *
+ * The I2S channel is disabled, it can be deleted by the application afterwards.
+ *
+ * @return
+ *    - ESP_OK: UAC speaker deinitialized
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ */
+esp_err_t tinyusb_uac_deinit(void);
+
+/**
+ * @brief Get the counters of the UAC speaker
+ *
+ * @param[out] stats Counters
+ * @return
+ *    - ESP_OK: Counters copied
+ *    - ESP_ERR_INVALID_ARG: stats is NULL
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ */
+esp_err_t tinyusb_uac_get_stats(tinyusb_uac_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_UAC_ENABLED
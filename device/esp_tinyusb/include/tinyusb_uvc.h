@@ -0,0 +1,161 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_UVC_ENABLED
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TINYUSB_UVC_FRAME_SIZE_MAX 4    /*!< Maximum number of frame sizes of the video format */
+
+/**
+ * @brief Video formats
+ */
+typedef enum {
+    TINYUSB_UVC_FORMAT_MJPEG = 0,       /*!< Motion JPEG, e.g. from the JPEG encoder */
+    TINYUSB_UVC_FORMAT_YUY2,            /*!< Uncompressed YUV 4:2:2, 16 bits per pixel */
+} tinyusb_uvc_format_t;
+
+/**
+ * @brief Frame size of the video format
+ */
+typedef struct {
+    uint16_t width;                     /*!< Width in pixels */
+    uint16_t height;                    /*!< Height in pixels */
+    uint8_t fps;                        /*!< Frames per second */
+} tinyusb_uvc_frame_size_t;
+
+/**
+ * @brief Video format offered to the host
+ */
+typedef struct {
+    tinyusb_uvc_format_t format;        /*!< Video format */
+    uint8_t frame_size_num;             /*!< Number of frame sizes, 1 to TINYUSB_UVC_FRAME_SIZE_MAX */
+    tinyusb_uvc_frame_size_t frame_sizes[TINYUSB_UVC_FRAME_SIZE_MAX]; /*!< Frame sizes, the first one is the default */
+} tinyusb_uvc_format_config_t;
+
+/**
+ * @brief Callback on start and stop of the video stream
+ *
+ * Invoked from the TinyUSB task, must not block.
+ *
+ * @param[in] start      True when the host committed the stream, false when it stopped it
+ * @param[in] frame_size Frame size negotiated by the host, NULL on stop
+ * @param[in] arg        User argument of the configuration
+ */
+typedef void (*tinyusb_uvc_stream_cb_t)(bool start, const tinyusb_uvc_frame_size_t *frame_size, void *arg);
+
+/**
+ * @brief Callback on the end of a frame transfer
+ *
+ * Invoked from the TinyUSB task, must not block. The frame buffer is owned by the application again,
+ * e.g. given back to the camera or JPEG encoder driver.
+ *
+ * @param[in] frame  Buffer passed to tinyusb_uvc_frame_submit()
+ * @param[in] result ESP_OK if the frame was sent, ESP_ERR_INVALID_STATE if dropped because the stream stopped
+ * @param[in] arg    User argument of the configuration
+ */
+typedef void (*tinyusb_uvc_frame_done_cb_t)(const void *frame, esp_err_t result, void *arg);
+
+/**
+ * @brief Configuration of the UVC device
+ */
+typedef struct {
+    tinyusb_uvc_format_config_t format; /*!< Video format, must match the descriptor built by tinyusb_uvc_desc_build() */
+    tinyusb_uvc_stream_cb_t stream_cb;  /*!< Callback on start and stop of the stream, can be NULL */
+    tinyusb_uvc_frame_done_cb_t frame_done_cb; /*!< Callback on the end of a frame transfer, can be NULL */
+    void *user_arg;                     /*!< User argument of the callbacks */
+} tinyusb_config_uvc_t;
+
+/**
+ * @brief Length of the UVC function descriptor
+ *
+ * @param[in] format Video format
+ * @return Number of bytes written by tinyusb_uvc_desc_build(), 0 on invalid format
+ */
+size_t tinyusb_uvc_desc_len(const tinyusb_uvc_format_config_t *format);
+
+/**
+ * @brief Build the UVC function descriptor
+ *
+ * Writes the interface association, the video control interface with a camera and a streaming
+ * output terminal, and the video streaming interface with the format, its frame sizes and the
+ * endpoint (bulk with CONFIG_TINYUSB_UVC_BULK, isochronous in alternate setting 1 otherwise).
+ * The descriptor is placed into the configuration descriptor of the application.
+ *
+ * @param[in]  format     Video format
+ * @param[in]  itf_num    Number of the video control interface, the streaming interface is itf_num + 1
+ * @param[in]  ep_addr    Address of the IN endpoint, e.g. 0x81
+ * @param[in]  str_idx    String index of the function, 0 for none
+ * @param[in]  high_speed Build the descriptor for high-speed configuration
+ * @param[out] buf        Descriptor buffer
+ * @param[in]  buf_len    Size of the buffer, at least tinyusb_uvc_desc_len()
+ * @return
+ *    - ESP_OK: Descriptor written
+ *    - ESP_ERR_INVALID_ARG: Invalid format
+ *    - ESP_ERR_INVALID_SIZE: Buffer is too small
+ */
+esp_err_t tinyusb_uvc_desc_build(const tinyusb_uvc_format_config_t *format, uint8_t itf_num, uint8_t ep_addr,
+                                 uint8_t str_idx, bool high_speed, uint8_t *buf, size_t buf_len);
+
+/**
+ * @brief Initialize the UVC device
+ *
+ * @param[in] config Configuration
+ * @return
+ *    - ESP_OK: UVC device initialized
+ *    - ESP_ERR_INVALID_ARG: Invalid configuration
+ *    - ESP_ERR_INVALID_STATE: Already initialized
+ *    - ESP_ERR_NO_MEM: Not enough memory for the frame queue
+ */
+esp_err_t tinyusb_uvc_init(const tinyusb_config_uvc_t *config);
+
+/**
+ * @brief Deinitialize the UVC device
+ *
+ * Queued frames are dropped with ESP_ERR_INVALID_STATE.
+ *
+ * @return
+ *    - ESP_OK: UVC device deinitialized
+ *    - ESP_ERR_INVALID_STATE: Not initialized
+ *    - ESP_ERR_TIMEOUT: TinyUSB task did not release the frames
+ */
+esp_err_t tinyusb_uvc_deinit(void);
+
+/**
+ * @brief Queue a frame to be sent to the host
+ *
+ * The frame is not copied, it is sent straight from the buffer, e.g. the DMA buffer of the camera
+ * or the JPEG encoder, which must stay valid until frame_done_cb() is invoked with it.
+ * TinyUSB splits the frame into payloads with the UVC payload header, toggling the frame ID
+ * and setting the end of frame bit on the last payload.
+ *
+ * @param[in] frame         Frame data
+ * @param[in] len           Frame length in bytes
+ * @param[in] ticks_to_wait Time to wait for a free slot of the CONFIG_TINYUSB_UVC_FRAME_QUEUE_SIZE queue
+ * @return
+ *    - ESP_OK: Frame queued, frame_done_cb() will be invoked
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Not initialized or the host is not streaming
+ *    - ESP_ERR_TIMEOUT: Queue is full
+ */
+esp_err_t tinyusb_uvc_frame_submit(const void *frame, size_t len, TickType_t ticks_to_wait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_UVC_ENABLED
@@ -0,0 +1,129 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#if CONFIG_TINYUSB_VENDOR_STREAM
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Vendor specific interfaces available to setup
+ */
+typedef enum {
+    TINYUSB_VENDOR_0 = 0x0,
+    TINYUSB_VENDOR_1,
+    TINYUSB_VENDOR_MAX
+} tinyusb_vendor_itf_t;
+
+/**
+ * @brief Callback on the end of an asynchronous write
+ *
+ * Invoked from the TinyUSB task, must not block.
+ *
+ * @param[in] itf     Vendor interface
+ * @param[in] buffer  Buffer passed to tinyusb_vendor_write_async(), owned by the caller again
+ * @param[in] len     Number of bytes of the buffer
+ * @param[in] result  ESP_OK if all data was passed to the endpoint, ESP_ERR_INVALID_STATE if dropped on deinit
+ * @param[in] arg     User argument of the configuration
+ */
+typedef void (*tinyusb_vendor_tx_done_cb_t)(tinyusb_vendor_itf_t itf, const void *buffer, size_t len, esp_err_t result, void *arg);
+
+/**
+ * @brief Callback on received data
+ *
+ * Invoked from the TinyUSB task, must not block. The buffer is lent to the application
+ * until it is returned by tinyusb_vendor_rx_done().
+ *
+ * @param[in] itf     Vendor interface
+ * @param[in] buffer  Received data
+ * @param[in] len     Number of received bytes
+ * @param[in] arg     User argument of the configuration
+ */
+typedef void (*tinyusb_vendor_rx_cb_t)(tinyusb_vendor_itf_t itf, void *buffer, size_t len, void *arg);
+
+/**
+ * @brief Configuration of the vendor specific interface
+ */
+typedef struct {
+    tinyusb_vendor_itf_t itf;           /*!< Vendor interface */
+    tinyusb_vendor_tx_done_cb_t tx_done_cb; /*!< Callback on the end of an asynchronous write, can be NULL */
+    tinyusb_vendor_rx_cb_t rx_cb;       /*!< Callback on received data, can be NULL to discard received data */
+    void *user_arg;                     /*!< User argument of the callbacks */
+} tinyusb_config_vendor_t;
+
+/**
+ * @brief Initialize the vendor specific interface
+ *
+ * @param[in] config Configuration
+ * @return
+ *    - ESP_OK: Interface initialized
+ *    - ESP_ERR_INVALID_ARG: Invalid interface
+ *    - ESP_ERR_INVALID_STATE: Interface already initialized
+ *    - ESP_ERR_NO_MEM: Not enough memory for the queues and buffers
+ */
+esp_err_t tinyusb_vendor_init(const tinyusb_config_vendor_t *config);
+
+/**
+ * @brief Deinitialize the vendor specific interface
+ *
+ * Queued writes are dropped with ESP_ERR_INVALID_STATE. Received buffers still held by
+ * the application must be returned before.
+ *
+ * @param[in] itf Vendor interface
+ * @return
+ *    - ESP_OK: Interface deinitialized
+ *    - ESP_ERR_INVALID_STATE: Interface not initialized or received buffers not returned
+ *    - ESP_ERR_TIMEOUT: TinyUSB task did not remove the interface
+ */
+esp_err_t tinyusb_vendor_deinit(tinyusb_vendor_itf_t itf);
+
+/**
+ * @brief Queue a buffer to be sent to the host
+ *
+ * The buffer is not copied, it must stay valid until tx_done_cb() is invoked with it.
+ * Buffers are passed to the IN endpoint one after another, as the endpoint FIFO has space.
+ * Up to CONFIG_TINYUSB_VENDOR_TX_QUEUE_SIZE buffers are queued, so the application prepares
+ * the next buffer while the previous ones are transferred.
+ *
+ * @param[in] itf           Vendor interface
+ * @param[in] buffer        Data to send
+ * @param[in] len           Number of bytes to send
+ * @param[in] ticks_to_wait Time to wait for a free queue slot
+ * @return
+ *    - ESP_OK: Buffer queued, tx_done_cb() will be invoked
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: Interface not initialized
+ *    - ESP_ERR_TIMEOUT: Queue is full
+ */
+esp_err_t tinyusb_vendor_write_async(tinyusb_vendor_itf_t itf, const void *buffer, size_t len, TickType_t ticks_to_wait);
+
+/**
+ * @brief Return a received buffer
+ *
+ * @note Can be called from any task, including from rx_cb().
+ *
+ * @param[in] itf     Vendor interface
+ * @param[in] buffer  Buffer passed to rx_cb()
+ * @return
+ *    - ESP_OK: Buffer returned, pending data will be received into it
+ *    - ESP_ERR_INVALID_ARG: The buffer is not held by the application
+ *    - ESP_ERR_INVALID_STATE: Interface not initialized
+ */
+esp_err_t tinyusb_vendor_rx_done(tinyusb_vendor_itf_t itf, void *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_TINYUSB_VENDOR_STREAM
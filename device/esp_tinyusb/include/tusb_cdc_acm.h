@@ -13,6 +13,8 @@ extern "C" {
 #include <stdint.h>
 #include "sdkconfig.h"
 #include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 #include "tinyusb_types.h"
 #include "class/cdc/cdc.h"
@@ -28,6 +30,11 @@ extern "C" {
 typedef enum {
     TINYUSB_CDC_ACM_0 = 0x0,
     TINYUSB_CDC_ACM_1,
+    TINYUSB_CDC_ACM_2,
+    TINYUSB_CDC_ACM_3,
+    TINYUSB_CDC_ACM_4,
+    TINYUSB_CDC_ACM_5,
+    TINYUSB_CDC_ACM_6,
     TINYUSB_CDC_ACM_MAX
 } tinyusb_cdcacm_itf_t;
 
@@ -63,7 +70,8 @@ typedef enum {
     CDC_EVENT_RX,
     CDC_EVENT_RX_WANTED_CHAR,
     CDC_EVENT_LINE_STATE_CHANGED,
-    CDC_EVENT_LINE_CODING_CHANGED
+    CDC_EVENT_LINE_CODING_CHANGED,
+    CDC_EVENT_TX_COMPLETE,                  /*!< TX transfer is complete and space is available in the write buffer */
 } cdcacm_event_type_t;
 
 /**
@@ -83,6 +91,14 @@ typedef struct {
  */
 typedef void(*tusb_cdcacm_callback_t)(int itf, cdcacm_event_t *event);
 
+/**
+ * @brief Item of the event queue, see tinyusb_cdcacm_set_event_queue()
+ */
+typedef struct {
+    int itf;                /*!< Index of CDC interface */
+    cdcacm_event_t event;   /*!< Event, `p_line_coding` points to the current line coding of the interface */
+} tinyusb_cdcacm_event_msg_t;
+
 /*********************************************************************** Callbacks and events*/
 /* Other structs
    ********************************************************************* */
@@ -142,6 +158,19 @@ esp_err_t tinyusb_cdcacm_register_callback(tinyusb_cdcacm_itf_t itf,
  */
 esp_err_t tinyusb_cdcacm_unregister_callback(tinyusb_cdcacm_itf_t itf, cdcacm_event_type_t event_type);
 
+/**
+ * @brief Send CDC-ACM events to a queue instead of invoking the callbacks
+ *
+ * Registered callbacks run in the TinyUSB task, so a slow callback delays all USB traffic.
+ * With an event queue set, the TinyUSB task only sends the events to the queue without
+ * waiting, and a user task receives and handles them. Events are dropped if the queue is full.
+ *
+ * @param[in] itf   Index of CDC interface
+ * @param[in] queue Queue created with an item size of sizeof(tinyusb_cdcacm_event_msg_t), NULL to invoke the callbacks again
+ * @return esp_err_t - ESP_OK or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_set_event_queue(tinyusb_cdcacm_itf_t itf, QueueHandle_t queue);
+
 /**
  * @brief Sent one character to a write buffer
  *
@@ -171,6 +200,9 @@ size_t tinyusb_cdcacm_write_queue(tinyusb_cdcacm_itf_t itf, const uint8_t *in_bu
  *        one of the next callbacks ends.
  *        SO USING OF THE FLUSH WITH TIMEOUTS IN CALLBACKS IS NOT RECOMMENDED - YOU CAN GET A LOCK FOR THE TIMEOUT
  *
+ * In blocking mode the calling task sleeps until a TX transfer completes, instead of polling the buffer.
+ * Producers that don't want to block can register a CDC_EVENT_TX_COMPLETE callback and queue more data from it.
+ *
  * @param[in] itf             Index of CDC interface
  * @param[in] timeout_ticks   Transfer timeout. Set to zero for non-blocking mode
  * @return - ESP_OK           All data flushed
@@ -190,6 +222,61 @@ esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf, uint32_t timeout_
  */
 esp_err_t tinyusb_cdcacm_read(tinyusb_cdcacm_itf_t itf, uint8_t *out_buf, size_t out_buf_sz, size_t *rx_data_size);
 
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+/**
+ * @brief Get free space of the TX ring, to be filled in place
+ *
+ * The application writes data directly to the returned space, e.g. formats telemetry there, and publishes it with
+ * tinyusb_cdcacm_write_commit(). The TinyUSB task moves committed data to the TinyUSB TX FIFO as soon as it has space
+ * and sends it, so the application neither copies the data nor waits for the FIFO.
+ * Space after the end of the ring is returned by the next call, once the space before it is committed.
+ *
+ * @note The ring has one writer: call this and tinyusb_cdcacm_write_commit() from one task only, and do not mix them
+ *       with tinyusb_cdcacm_write_queue() on the same interface.
+ *
+ * @param[in]  itf  Index of CDC interface
+ * @param[out] buf  Free space of the TX ring
+ * @param[out] size Size of the free space in bytes, 0 if the ring is full
+ * @return esp_err_t - ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_write_acquire(tinyusb_cdcacm_itf_t itf, uint8_t **buf, size_t *size);
+
+/**
+ * @brief Publish data written to the space from tinyusb_cdcacm_write_acquire()
+ *
+ * @param[in] itf  Index of CDC interface
+ * @param[in] size Number of written bytes, at most the acquired size
+ * @return esp_err_t - ESP_OK, ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_write_commit(tinyusb_cdcacm_itf_t itf, size_t size);
+
+/**
+ * @brief Get received data in the RX ring, to be processed in place
+ *
+ * The first call switches the interface to the RX ring: from then on the TinyUSB task moves received data from
+ * the TinyUSB RX FIFO to the ring before CDC_EVENT_RX is delivered. Data after the end of the ring is returned
+ * by the next call, once the data before it is committed.
+ *
+ * @note The ring has one reader: call this and tinyusb_cdcacm_read_commit() from one task only, and do not mix them
+ *       with tinyusb_cdcacm_read() or the CDC VFS on the same interface.
+ *
+ * @param[in]  itf  Index of CDC interface
+ * @param[out] buf  Received data
+ * @param[out] size Size of the received data in bytes, 0 if the ring is empty
+ * @return esp_err_t - ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_read_acquire(tinyusb_cdcacm_itf_t itf, const uint8_t **buf, size_t *size);
+
+/**
+ * @brief Release data processed from tinyusb_cdcacm_read_acquire(), so the ring can receive more
+ *
+ * @param[in] itf  Index of CDC interface
+ * @param[in] size Number of processed bytes, at most the acquired size
+ * @return esp_err_t - ESP_OK, ESP_ERR_INVALID_SIZE or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_read_commit(tinyusb_cdcacm_itf_t itf, size_t size);
+#endif // CONFIG_TINYUSB_CDC_RING_SIZE
+
 /**
  * @brief Check if the CDC interface is initialized
  *
@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "driver/uart.h"
+#include "tusb_cdc_acm.h"
+
+#if (CONFIG_TINYUSB_CDC_BRIDGE != 1)
+#error "TinyUSB CDC to UART bridge must be enabled in menuconfig"
+#endif
+
+/**
+ * @brief One bridged pair of CDC-ACM port and UART
+ */
+typedef struct {
+    tinyusb_cdcacm_itf_t cdc_port;  /*!< CDC-ACM port initialized by tusb_cdc_acm_init() */
+    uart_port_t uart_port;          /*!< UART with installed driver, with RX and TX buffer */
+    QueueHandle_t uart_queue;       /*!< Event queue of the UART driver, returned by uart_driver_install() */
+    bool line_coding;               /*!< Apply baud rate, data bits, parity and stop bits set by the host to the UART */
+} tusb_cdc_bridge_port_t;
+
+/**
+ * @brief Configuration of CDC to UART bridge
+ */
+typedef struct {
+    const tusb_cdc_bridge_port_t *ports;  /*!< Bridged ports */
+    size_t port_count;                    /*!< Number of bridged ports, up to CONFIG_TINYUSB_CDC_COUNT */
+} tusb_cdc_bridge_config_t;
+
+/**
+ * @brief Counters of one bridged port
+ */
+typedef struct {
+    uint64_t to_uart;               /*!< Bytes moved from CDC to UART */
+    uint64_t to_usb;                /*!< Bytes moved from UART to CDC */
+    uint32_t uart_overflows;        /*!< UART RX FIFO or buffer overflows, data received by the UART were lost */
+} tusb_cdc_bridge_stats_t;
+
+/**
+ * @brief Start moving data between CDC-ACM ports and UARTs
+ *
+ * Data received from the host are written into the UART TX buffer, data received by the UART are queued
+ * to the CDC TX FIFO, in both directions only as much as fits, so a slow side holds back its peer without
+ * losing data on the USB side. All ports are served by one task.
+ *
+ * The events of the bridged CDC-ACM ports are sent to the bridge task by tinyusb_cdcacm_set_event_queue(),
+ * so their callbacks are not invoked while the bridge runs. Events of the UART queues are received by the bridge.
+ *
+ * @param[in] config Bridge configuration
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid configuration
+ *     - ESP_ERR_INVALID_STATE: Bridge already started, or a CDC-ACM port is not initialized
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t tusb_cdc_bridge_start(const tusb_cdc_bridge_config_t *config);
+
+/**
+ * @brief Stop the bridge
+ *
+ * The CDC-ACM ports invoke their callbacks again, the UART drivers stay installed.
+ *
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_STATE: Bridge not started
+ */
+esp_err_t tusb_cdc_bridge_stop(void);
+
+/**
+ * @brief Get counters of a bridged port
+ *
+ * @param[in]  cdc_port CDC-ACM port of the bridged pair
+ * @param[out] stats    Counters
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stats is NULL or the port is not bridged
+ *     - ESP_ERR_INVALID_STATE: Bridge not started
+ */
+esp_err_t tusb_cdc_bridge_get_stats(tinyusb_cdcacm_itf_t cdc_port, tusb_cdc_bridge_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
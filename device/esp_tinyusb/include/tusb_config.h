@@ -59,6 +59,30 @@ extern "C" {
 #   define CONFIG_TINYUSB_VENDOR_COUNT 0
 #endif
 
+#ifndef CONFIG_TINYUSB_VENDOR_RX_BUFSIZE
+#   define CONFIG_TINYUSB_VENDOR_RX_BUFSIZE 64
+#endif
+
+#ifndef CONFIG_TINYUSB_VENDOR_TX_BUFSIZE
+#   define CONFIG_TINYUSB_VENDOR_TX_BUFSIZE 64
+#endif
+
+#ifndef CONFIG_TINYUSB_UAC_ENABLED
+#   define CONFIG_TINYUSB_UAC_ENABLED 0
+#endif
+
+#ifndef CONFIG_TINYUSB_UVC_ENABLED
+#   define CONFIG_TINYUSB_UVC_ENABLED 0
+#endif
+
+#ifndef CONFIG_TINYUSB_UVC_BULK
+#   define CONFIG_TINYUSB_UVC_BULK 0
+#endif
+
+#ifndef CONFIG_TINYUSB_UVC_EP_BUFSIZE
+#   define CONFIG_TINYUSB_UVC_EP_BUFSIZE 512
+#endif
+
 #ifndef CONFIG_TINYUSB_NET_MODE_ECM_RNDIS
 #   define CONFIG_TINYUSB_NET_MODE_ECM_RNDIS 0
 #endif
@@ -146,15 +170,45 @@ extern "C" {
 // MSC Buffer size of Device Mass storage
 #define CFG_TUD_MSC_BUFSIZE         CONFIG_TINYUSB_MSC_BUFSIZE
 
-// MIDI macros
-#define CFG_TUD_MIDI_EP_BUFSIZE     64
-#define CFG_TUD_MIDI_EPSIZE         CFG_TUD_MIDI_EP_BUFSIZE
-#define CFG_TUD_MIDI_RX_BUFSIZE     64
-#define CFG_TUD_MIDI_TX_BUFSIZE     64
+// MIDI macros, transfers of 512 bytes carry 128 event packets on high-speed
+#define CFG_TUD_MIDI_EP_BUFSIZE     (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#define CFG_TUD_MIDI_EPSIZE         64
+#define CFG_TUD_MIDI_RX_BUFSIZE     CFG_TUD_MIDI_EP_BUFSIZE
+#define CFG_TUD_MIDI_TX_BUFSIZE     CFG_TUD_MIDI_EP_BUFSIZE
 
 // Vendor FIFO size of TX and RX
-#define CFG_TUD_VENDOR_RX_BUFSIZE (TUD_OPT_HIGH_SPEED ? 512 : 64)
-#define CFG_TUD_VENDOR_TX_BUFSIZE (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#define CFG_TUD_VENDOR_RX_BUFSIZE   CONFIG_TINYUSB_VENDOR_RX_BUFSIZE
+#define CFG_TUD_VENDOR_TX_BUFSIZE   CONFIG_TINYUSB_VENDOR_TX_BUFSIZE
+// Vendor endpoint buffer, one packet of the bulk endpoint per transfer
+#define CFG_TUD_VENDOR_EPSIZE       (TUD_OPT_HIGH_SPEED ? 512 : 64)
+
+// UAC macros
+#if CONFIG_TINYUSB_UAC_ENABLED
+// One sample more than the nominal number per (micro)frame, the host adapts the rate to the feedback
+#define TINYUSB_UAC_EP_SIZE         ((CONFIG_TINYUSB_UAC_SAMPLE_RATE / (TUD_OPT_HIGH_SPEED ? 8000 : 1000) + 1) * \
+                                     CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE * 2)
+#define TINYUSB_UAC_SPEAKER_DESC_LEN (TUD_AUDIO_DESC_IAD_LEN + TUD_AUDIO_DESC_STD_AC_LEN + TUD_AUDIO_DESC_CS_AC_LEN + \
+                                      TUD_AUDIO_DESC_CLK_SRC_LEN + TUD_AUDIO_DESC_INPUT_TERM_LEN + \
+                                      TUD_AUDIO_DESC_FEATURE_UNIT_TWO_CHANNEL_LEN + TUD_AUDIO_DESC_OUTPUT_TERM_LEN + \
+                                      TUD_AUDIO_DESC_STD_AS_INT_LEN + TUD_AUDIO_DESC_STD_AS_INT_LEN + \
+                                      TUD_AUDIO_DESC_CS_AS_INT_LEN + TUD_AUDIO_DESC_TYPE_I_FORMAT_LEN + \
+                                      TUD_AUDIO_DESC_STD_AS_ISO_EP_LEN + TUD_AUDIO_DESC_CS_AS_ISO_EP_LEN + 7)
+#define CFG_TUD_AUDIO_FUNC_1_DESC_LEN               TINYUSB_UAC_SPEAKER_DESC_LEN
+#define CFG_TUD_AUDIO_FUNC_1_N_AS_INT               1
+#define CFG_TUD_AUDIO_FUNC_1_CTRL_BUF_SZ            64
+#define CFG_TUD_AUDIO_ENABLE_EP_OUT                 1
+#define CFG_TUD_AUDIO_ENABLE_FEEDBACK_EP            1
+#define CFG_TUD_AUDIO_FUNC_1_N_BYTES_PER_SAMPLE_RX  CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE
+#define CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_RX          2
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SZ_MAX          TINYUSB_UAC_EP_SIZE
+// FIFO between the endpoint and I2S
+#define CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ       (CONFIG_TINYUSB_UAC_BUFFER_MS * CONFIG_TINYUSB_UAC_SAMPLE_RATE / 1000 * \
+                                                     CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE * 2)
+#endif // CONFIG_TINYUSB_UAC_ENABLED
+
+// UVC macros
+#define CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE  CONFIG_TINYUSB_UVC_EP_BUFSIZE
+#define CFG_TUD_VIDEO_STREAMING_BULK        CONFIG_TINYUSB_UVC_BULK
 
 // DFU macros
 #define CFG_TUD_DFU_XFER_BUFSIZE    CONFIG_TINYUSB_DFU_BUFSIZE
@@ -170,6 +224,9 @@ extern "C" {
 #define CFG_TUD_VENDOR              CONFIG_TINYUSB_VENDOR_COUNT
 #define CFG_TUD_ECM_RNDIS           CONFIG_TINYUSB_NET_MODE_ECM_RNDIS
 #define CFG_TUD_NCM                 CONFIG_TINYUSB_NET_MODE_NCM
+#define CFG_TUD_AUDIO               CONFIG_TINYUSB_UAC_ENABLED
+#define CFG_TUD_VIDEO               CONFIG_TINYUSB_UVC_ENABLED
+#define CFG_TUD_VIDEO_STREAMING     CONFIG_TINYUSB_UVC_ENABLED
 #define CFG_TUD_DFU                 CONFIG_TINYUSB_DFU_MODE_DFU
 #define CFG_TUD_DFU_RUNTIME         CONFIG_TINYUSB_DFU_MODE_DFU_RUNTIME
 #define CFG_TUD_BTH                 CONFIG_TINYUSB_BTH_ENABLED
@@ -10,7 +10,9 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include "esp_err.h"
+#include "sdkconfig.h"
 
 /**
  * @brief Redirect output to the USB serial
@@ -28,6 +30,17 @@ esp_err_t esp_tusb_init_console(int cdc_intf);
  */
 esp_err_t esp_tusb_deinit_console(int cdc_intf);
 
+#if CONFIG_TINYUSB_CONSOLE_ASYNC
+/**
+ * @brief Number of output bytes dropped, because the log ring was full
+ *
+ * Output is dropped when the host does not read the console fast enough, or not at all.
+ *
+ * @return Dropped bytes since esp_tusb_init_console()
+ */
+size_t esp_tusb_console_get_dropped(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@ extern "C" {
 
 #include <stddef.h>
 #include "esp_err.h"
+#include "esp_partition.h"
 #include "wear_levelling.h"
 #include "esp_vfs_fat.h"
 #if SOC_SDMMC_HOST_SUPPORTED
@@ -41,6 +42,7 @@ typedef struct {
     union {
         tinyusb_msc_event_mount_changed_data_t mount_changed_data; /*!< Data input of the callback */
     };
+    uint8_t lun;                   /*!< LUN of the storage */
 } tinyusb_msc_event_t;
 
 /**
@@ -60,6 +62,8 @@ typedef struct {
     tusb_msc_callback_t callback_mount_changed;     /*!< Pointer to the function callback that will be delivered AFTER mount/unmount operation is successfully finished */
     tusb_msc_callback_t callback_premount_changed;  /*!< Pointer to the function callback that will be delivered BEFORE mount/unmount operation is started */
     const esp_vfs_fat_mount_config_t mount_config; /*!< FATFS mount config */
+    bool shared_access;                             /*!< Keep read-only FATFS access for the application while the host has the storage, see tinyusb_msc_storage_unmount() */
+    uint8_t lun;                                    /*!< Logical unit number of the storage, below CONFIG_TINYUSB_MSC_LUN_NUM */
 } tinyusb_msc_sdmmc_config_t;
 #endif
 
@@ -74,6 +78,15 @@ typedef struct {
     tusb_msc_callback_t callback_mount_changed;     /*!< Pointer to the function callback that will be delivered AFTER mount/unmount operation is successfully finished */
     tusb_msc_callback_t callback_premount_changed;  /*!< Pointer to the function callback that will be delivered BEFORE mount/unmount operation is started */
     const esp_vfs_fat_mount_config_t mount_config; /*!< FATFS mount config */
+    bool shared_access;                             /*!< Keep read-only FATFS access for the application while the host has the storage, see tinyusb_msc_storage_unmount() */
+    uint8_t lun;                                    /*!< Logical unit number of the storage, below CONFIG_TINYUSB_MSC_LUN_NUM */
+    const esp_partition_t *read_only_partition;     /*!< Raw FAT partition to expose write protected instead of the wear-levelling volume, NULL if not used.
+                                                         The partition is memory mapped and READ10 is served from the flash cache, wl_handle is ignored.
+                                                         It must contain a FAT image with 4096 bytes sectors (SPI_FLASH_SEC_SIZE), as created by
+                                                         fatfs_create_rawflash_image(), it is never formatted. */
+    bool flash_sector_size;                         /*!< Expose 4096 bytes sectors (SPI_FLASH_SEC_SIZE) even if CONFIG_WL_SECTOR_SIZE is 512, so host writes map 1:1 onto
+                                                         flash sectors instead of read-modify-write in wear levelling. Requires CONFIG_TINYUSB_MSC_BUFSIZE and
+                                                         FATFS sector size of at least 4096, the volume must be formatted in this mode. */
 } tinyusb_msc_spiflash_config_t;
 
 /**
@@ -82,9 +95,11 @@ typedef struct {
  * @param config pointer to the spiflash configuration
  * @return esp_err_t
  *       - ESP_OK, if success;
+ *       - ESP_ERR_INVALID_ARG, if lun is not below CONFIG_TINYUSB_MSC_LUN_NUM;
  *       - ESP_ERR_NO_MEM, if there was no memory to allocate storage components;
- *       - ESP_ERR_NOT_SUPPORTED, if wear leveling sector size CONFIG_WL_SECTOR_SIZE is bigger than
- *                                the tinyusb MSC buffer size CONFIG_TINYUSB_MSC_BUFSIZE
+ *       - ESP_ERR_NOT_SUPPORTED, if wear leveling sector size CONFIG_WL_SECTOR_SIZE, or 4096 with flash_sector_size,
+ *                                is bigger than the tinyusb MSC buffer size CONFIG_TINYUSB_MSC_BUFSIZE
+ *       - Error of esp_partition_mmap(), if read_only_partition could not be memory mapped
  */
 esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t *config);
 
@@ -95,16 +110,57 @@ esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t
  * @param config pointer to the sd card configuration
  * @return esp_err_t
  *       - ESP_OK, if success;
+ *       - ESP_ERR_INVALID_ARG, if lun is not below CONFIG_TINYUSB_MSC_LUN_NUM;
  *       - ESP_ERR_NO_MEM, if there was no memory to allocate storage components;
  */
 esp_err_t tinyusb_msc_storage_init_sdmmc(const tinyusb_msc_sdmmc_config_t *config);
 #endif
+
+/**
+ * @brief Configuration structure for RAM disk initialization
+ *
+ * User configurable parameters that are used while
+ * initializing the RAM disk media.
+ */
+typedef struct {
+    void *buffer;                                   /*!< Memory of sector_count * sector_size bytes holding the storage, NULL to allocate it, preferably in PSRAM */
+    uint32_t sector_count;                          /*!< Number of sectors of the storage */
+    uint32_t sector_size;                           /*!< Size of a sector in bytes, power of two from 512 to 4096, 0 for 512 */
+    tusb_msc_callback_t callback_mount_changed;     /*!< Pointer to the function callback that will be delivered AFTER mount/unmount operation is successfully finished */
+    tusb_msc_callback_t callback_premount_changed;  /*!< Pointer to the function callback that will be delivered BEFORE mount/unmount operation is started */
+    const esp_vfs_fat_mount_config_t mount_config; /*!< FATFS mount config */
+    bool shared_access;                             /*!< Keep read-only FATFS access for the application while the host has the storage, see tinyusb_msc_storage_unmount() */
+    uint8_t lun;                                    /*!< Logical unit number of the storage, below CONFIG_TINYUSB_MSC_LUN_NUM */
+} tinyusb_msc_ramdisk_config_t;
+
+/**
+ * @brief Register storage type RAM disk with tinyusb driver
+ *
+ * WRITE10 data is copied straight to the storage memory, without the write buffers
+ * and the writer task. The content is lost on reset, the storage is formatted on the
+ * first mount by the application.
+ *
+ * @param config pointer to the RAM disk configuration
+ * @return esp_err_t
+ *       - ESP_OK, if success;
+ *       - ESP_ERR_INVALID_ARG, if sector_count is 0, sector_size is not supported or lun is not below CONFIG_TINYUSB_MSC_LUN_NUM;
+ *       - ESP_ERR_NO_MEM, if there was no memory to allocate storage components;
+ */
+esp_err_t tinyusb_msc_storage_init_ramdisk(const tinyusb_msc_ramdisk_config_t *config);
+
 /**
- * @brief Deregister storage with tinyusb driver and frees the memory
+ * @brief Deregister storage of all LUNs with tinyusb driver and frees the memory
  *
  */
 void tinyusb_msc_storage_deinit(void);
 
+/**
+ * @brief Deregister storage of the LUN with tinyusb driver and frees the memory
+ *
+ * @param lun - logical unit number of the storage
+ */
+void tinyusb_msc_storage_deinit_lun(uint8_t lun);
+
 /**
  * @brief Register a callback invoking on MSC event. If the callback had been
  *        already registered, it will be overwritten
@@ -116,6 +172,18 @@ void tinyusb_msc_storage_deinit(void);
 esp_err_t tinyusb_msc_register_callback(tinyusb_msc_event_type_t event_type,
                                         tusb_msc_callback_t callback);
 
+/**
+ * @brief Register a callback invoking on MSC event of the LUN, see tinyusb_msc_register_callback()
+ *
+ * @param lun - logical unit number of the storage
+ * @param event_type - type of registered event for a callback
+ * @param callback  - callback function
+ * @return esp_err_t - ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t tinyusb_msc_register_callback_lun(uint8_t lun,
+        tinyusb_msc_event_type_t event_type,
+        tusb_msc_callback_t callback);
+
 
 /**
  * @brief Unregister a callback invoking on MSC event.
@@ -125,6 +193,15 @@ esp_err_t tinyusb_msc_register_callback(tinyusb_msc_event_type_t event_type,
  */
 esp_err_t tinyusb_msc_unregister_callback(tinyusb_msc_event_type_t event_type);
 
+/**
+ * @brief Unregister a callback invoking on MSC event of the LUN.
+ *
+ * @param lun - logical unit number of the storage
+ * @param event_type - type of registered event for a callback
+ * @return esp_err_t - ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t tinyusb_msc_unregister_callback_lun(uint8_t lun, tinyusb_msc_event_type_t event_type);
+
 /**
  * @brief Mount the storage partition locally on the firmware application.
  *
@@ -145,6 +222,18 @@ esp_err_t tinyusb_msc_unregister_callback(tinyusb_msc_event_type_t event_type);
  */
 esp_err_t tinyusb_msc_storage_mount(const char *base_path);
 
+/**
+ * @brief Mount the storage of the LUN locally on the firmware application, see tinyusb_msc_storage_mount()
+ *
+ * Every LUN must be mounted to its own base path. If it is NULL, LUN 0 is mounted to
+ * CONFIG_TINYUSB_MSC_MOUNT_PATH and the other LUNs to the path with the LUN number appended.
+ *
+ * @param lun        logical unit number of the storage
+ * @param base_path  path prefix where FATFS should be registered
+ * @return esp_err_t, see tinyusb_msc_storage_mount()
+ */
+esp_err_t tinyusb_msc_storage_mount_lun(uint8_t lun, const char *base_path);
+
 /**
  * @brief Unmount the storage partition from the firmware application.
  *
@@ -156,12 +245,26 @@ esp_err_t tinyusb_msc_storage_mount(const char *base_path);
  * so as to make sure that user callbacks must be completed within a specific time.
  * Otherwise, MSC device may not appear on Host.
  *
+ * With shared_access in the storage configuration, FATFS stays registered and the
+ * application keeps read-only access while the host has the storage. FATFS re-reads
+ * the volume after the host wrote to it, so files opened before that become invalid.
+ * Files opened for writing must be closed before this call. The following
+ * tinyusb_msc_storage_mount() only gives write access back, without mounting FATFS again.
+ *
  * @return esp_err_t
  *      - ESP_OK on success
  *      - ESP_ERR_INVALID_STATE if FATFS is not registered in VFS
  */
 esp_err_t tinyusb_msc_storage_unmount(void);
 
+/**
+ * @brief Unmount the storage of the LUN from the firmware application, see tinyusb_msc_storage_unmount()
+ *
+ * @param lun logical unit number of the storage
+ * @return esp_err_t, see tinyusb_msc_storage_unmount()
+ */
+esp_err_t tinyusb_msc_storage_unmount_lun(uint8_t lun);
+
 /**
  * @brief Get number of sectors in storage media
  *
@@ -169,6 +272,14 @@ esp_err_t tinyusb_msc_storage_unmount(void);
  */
 uint32_t tinyusb_msc_storage_get_sector_count(void);
 
+/**
+ * @brief Get number of sectors in storage media of the LUN
+ *
+ * @param lun logical unit number of the storage
+ * @return sector count
+ */
+uint32_t tinyusb_msc_storage_get_sector_count_lun(uint8_t lun);
+
 /**
  * @brief Get sector size of storage media
  *
@@ -176,6 +287,14 @@ uint32_t tinyusb_msc_storage_get_sector_count(void);
  */
 uint32_t tinyusb_msc_storage_get_sector_size(void);
 
+/**
+ * @brief Get sector size of storage media of the LUN
+ *
+ * @param lun logical unit number of the storage
+ * @return sector size, in bytes
+ */
+uint32_t tinyusb_msc_storage_get_sector_size_lun(uint8_t lun);
+
 /**
  * @brief Get status if storage media is exposed over USB to Host
  *
@@ -185,6 +304,14 @@ uint32_t tinyusb_msc_storage_get_sector_size(void);
  */
 bool tinyusb_msc_storage_in_use_by_usb_host(void);
 
+/**
+ * @brief Get status if storage media of the LUN is exposed over USB to Host
+ *
+ * @param lun logical unit number of the storage
+ * @return bool, see tinyusb_msc_storage_in_use_by_usb_host()
+ */
+bool tinyusb_msc_storage_in_use_by_usb_host_lun(uint8_t lun);
+
 #ifdef __cplusplus
 }
 #endif
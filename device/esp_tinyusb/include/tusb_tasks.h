@@ -6,6 +6,9 @@
 
 #pragma once
 
+#include <stdbool.h>
+#include <stdint.h>
+#include "sdkconfig.h"
 #include "esp_err.h"
 
 #ifdef __cplusplus
@@ -34,6 +37,50 @@ esp_err_t tusb_run_task(void);
  */
 esp_err_t tusb_stop_task(void);
 
+#if CONFIG_TINYUSB_WORKER_TASK
+/**
+ * @brief Function deferred to the worker task
+ */
+typedef void (*tusb_work_func_t)(void *arg);
+
+/**
+ * @brief Run function in the worker task, started by `tusb_run_task()`
+ *
+ * Functions are run in the order they were deferred, at lower priority than the TinyUSB task.
+ *
+ * @param[in] func   Function to run
+ * @param[in] arg    Argument of the function
+ * @param[in] in_isr Called from ISR
+ *
+ * @retval ESP_OK the function was queued
+ * @retval ESP_ERR_INVALID_STATE worker task is not running
+ * @retval ESP_ERR_NO_MEM worker queue is full
+ */
+esp_err_t tusb_defer_work(tusb_work_func_t func, void *arg, bool in_isr);
+
+#if CONFIG_TINYUSB_WORKER_PROFILING
+/**
+ * @brief Statistics of deferred work
+ */
+typedef struct {
+    uint32_t count;             /*!< Number of run functions */
+    uint32_t dropped;           /*!< Number of functions not queued, because the queue was full */
+    uint32_t max_us;            /*!< Longest function run time */
+    uint64_t total_us;          /*!< Total run time of all functions */
+} tusb_work_stats_t;
+
+/**
+ * @brief Get statistics of deferred work
+ *
+ * @param[out] stats Statistics since `tusb_run_task()`
+ *
+ * @retval ESP_OK on success
+ * @retval ESP_ERR_INVALID_ARG stats is NULL
+ */
+esp_err_t tusb_get_work_stats(tusb_work_stats_t *stats);
+#endif // CONFIG_TINYUSB_WORKER_PROFILING
+#endif // CONFIG_TINYUSB_WORKER_TASK
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,7 @@ extern "C" {
 #include "freertos/timers.h"
 #include "tusb.h"
 #include "tinyusb_types.h"
+#include "tusb_cdc_acm.h"
 
 /* CDC classification
    ********************************************************************* */
@@ -75,6 +76,17 @@ esp_err_t tinyusb_cdc_deinit(int itf);
  * @return esp_tusb_cdc_t* pointer to the interface or (NULL) on error
  */
 esp_tusb_cdc_t *tinyusb_cdc_get_intf(int itf_num);
+
+/**
+ * @brief Set internal receiver of CDC-ACM RX events, e.g. CDC VFS
+ *
+ * It is invoked before and independently of the callback registered by tinyusb_cdcacm_register_callback().
+ *
+ * @param itf - number of a CDC-ACM object
+ * @param callback - callback function, NULL to remove
+ * @return esp_err_t ESP_OK or ESP_ERR_INVALID_STATE
+ */
+esp_err_t tinyusb_cdcacm_set_internal_rx_callback(tinyusb_cdcacm_itf_t itf, tusb_cdcacm_callback_t callback);
 /*********************************************************************** Functions*/
 
 #ifdef __cplusplus
@@ -0,0 +1,53 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_TINYUSB_STATS
+#include "esp_timer.h"
+#include "tinyusb_stats.h"
+
+extern tinyusb_stats_t tinyusb_stats_data;
+
+/**
+ * @brief Raise the counter to value, if it is higher
+ */
+void tinyusb_stats_update_max(uint32_t *counter, uint32_t value);
+
+// Counters are incremented from several tasks, relaxed atomics are enough for statistics
+#define TINYUSB_STATS_ADD(field, value)     __atomic_fetch_add(&tinyusb_stats_data.field, (value), __ATOMIC_RELAXED)
+#define TINYUSB_STATS_INC(field)            TINYUSB_STATS_ADD(field, 1)
+#define TINYUSB_STATS_MAX(field, value)     tinyusb_stats_update_max(&tinyusb_stats_data.field, (value))
+#define TINYUSB_STATS_XFER(field, len)      do { TINYUSB_STATS_INC(field.transfers); TINYUSB_STATS_ADD(field.bytes, (len)); } while (0)
+#define TINYUSB_STATS_TIME_START(start)     const int64_t start = esp_timer_get_time()
+#define TINYUSB_STATS_TIME_END(total, max, start) do { \
+        const uint32_t _elapsed = (uint32_t)(esp_timer_get_time() - (start)); \
+        TINYUSB_STATS_ADD(total, _elapsed); \
+        TINYUSB_STATS_MAX(max, _elapsed); \
+    } while (0)
+#define TINYUSB_STATS_SERVICE_END(class, start) do { \
+        TINYUSB_STATS_INC(service.class.count); \
+        TINYUSB_STATS_TIME_END(service.class.total_us, service.class.max_us, start); \
+    } while (0)
+#else
+#define TINYUSB_STATS_ADD(field, value)
+#define TINYUSB_STATS_INC(field)
+#define TINYUSB_STATS_MAX(field, value)
+#define TINYUSB_STATS_XFER(field, len)
+#define TINYUSB_STATS_TIME_START(start)
+#define TINYUSB_STATS_TIME_END(total, max, start)
+#define TINYUSB_STATS_SERVICE_END(class, start)
+#endif // CONFIG_TINYUSB_STATS
+
+#ifdef __cplusplus
+}
+#endif
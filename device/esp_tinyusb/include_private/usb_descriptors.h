@@ -53,8 +53,30 @@ extern const uint8_t descriptor_fs_cfg_default[];
  * The user can provide their own HighSpeed configuration descriptor via tinyusb_driver_install() call
  */
 extern const uint8_t descriptor_hs_cfg_default[];
+
+/**
+ * @brief Other speed configuration descriptors generated from Kconfig
+ *
+ * Default FullSpeed and HighSpeed configuration descriptors with other speed descriptor type, in flash
+ */
+extern const uint8_t descriptor_fs_other_speed_default[];
+extern const uint8_t descriptor_hs_other_speed_default[];
 #endif // TUD_OPT_HIGH_SPEED
 
+/**
+ * @brief Endpoint numbers besides EP0: 6 on the full-speed controller of ESP32-S2 and ESP32-S3, 15 on the high-speed controller
+ */
+#if (TUD_OPT_HIGH_SPEED)
+#define TUSB_EPNUM_MAX 15
+#else
+#define TUSB_EPNUM_MAX 6
+#endif
+
+/**
+ * @brief Number of endpoints besides EP0 used by the default configuration descriptors
+ */
+extern const uint8_t descriptor_cfg_default_ep_count;
+
 uint8_t tusb_get_mac_string_id(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,152 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tusb_cdc_acm.h"
+
+#define CDC_BENCHMARK_ITF   TINYUSB_CDC_ACM_0
+#define CDC_CMD_MAX_LEN     32
+
+static SemaphoreHandle_t s_rx_sem;
+static uint8_t s_buf[CONFIG_TINYUSB_CDC_RX_BUFSIZE];
+
+static void tinyusb_cdc_rx_callback(int itf, cdcacm_event_t *event)
+{
+    xSemaphoreGive(s_rx_sem);
+}
+
+static size_t cdc_read(uint8_t *buf, size_t len)
+{
+    size_t rx_size = 0;
+    ESP_ERROR_CHECK(tinyusb_cdcacm_read(CDC_BENCHMARK_ITF, buf, len, &rx_size));
+    if (rx_size == 0) {
+        xSemaphoreTake(s_rx_sem, pdMS_TO_TICKS(10));
+    }
+    return rx_size;
+}
+
+static void cdc_write_str(const char *str)
+{
+    tinyusb_cdcacm_write_queue(CDC_BENCHMARK_ITF, (const uint8_t *)str, strlen(str));
+    tinyusb_cdcacm_write_flush(CDC_BENCHMARK_ITF, pdMS_TO_TICKS(100));
+}
+
+/**
+ * @brief Read command line, byte by byte, so that no payload is consumed
+ */
+static void cdc_read_command(char *cmd, size_t len)
+{
+    size_t pos = 0;
+    while (true) {
+        uint8_t c;
+        if (cdc_read(&c, 1) == 0) {
+            continue;
+        }
+        if (c == '\n') {
+            cmd[pos] = '\0';
+            return;
+        }
+        if (c != '\r' && pos < len - 1) {
+            cmd[pos++] = c;
+        }
+    }
+}
+
+static void cdc_benchmark_rx(size_t total)
+{
+    cdc_write_str("READY\n");
+    size_t received = 0;
+    int64_t start = 0;
+    while (received < total) {
+        const size_t rx_size = cdc_read(s_buf, sizeof(s_buf));
+        if (rx_size && received == 0) {
+            start = esp_timer_get_time();
+        }
+        received += rx_size;
+    }
+    const int64_t elapsed = esp_timer_get_time() - start;
+    printf("BENCHMARK: cdc_rx %u bytes in %lld us\n", (unsigned)total, elapsed);
+    char reply[CDC_CMD_MAX_LEN];
+    snprintf(reply, sizeof(reply), "DONE %lld\n", elapsed);
+    cdc_write_str(reply);
+}
+
+static void cdc_benchmark_tx(size_t total)
+{
+    for (size_t i = 0; i < sizeof(s_buf); i++) {
+        s_buf[i] = i;
+    }
+    const int64_t start = esp_timer_get_time();
+    size_t sent = 0;
+    while (sent < total) {
+        const size_t chunk = MIN(sizeof(s_buf), total - sent);
+        const size_t queued = tinyusb_cdcacm_write_queue(CDC_BENCHMARK_ITF, s_buf, chunk);
+        sent += queued;
+        if (queued < chunk) {
+            // TX FIFO is full, wait for the host to read it
+            tinyusb_cdcacm_write_flush(CDC_BENCHMARK_ITF, pdMS_TO_TICKS(10));
+        }
+    }
+    tinyusb_cdcacm_write_flush(CDC_BENCHMARK_ITF, pdMS_TO_TICKS(1000));
+    printf("BENCHMARK: cdc_tx %u bytes in %lld us\n", (unsigned)total, esp_timer_get_time() - start);
+}
+
+/**
+ * @brief TinyUSB CDC throughput benchmark
+ *
+ * This is not a 'standard' testcase, as it never exits. The host drives the benchmark by commands:
+ *
+ * - "RX <n>\n": Device replies "READY\n", receives <n> bytes and replies "DONE <us>\n"
+ * - "TX <n>\n": Device sends <n> bytes as fast as possible
+ *
+ * Results measured by the device are printed to the console as "BENCHMARK: ..." lines.
+ */
+TEST_CASE("tinyusb_cdc_benchmark", "[esp_tinyusb][cdc_benchmark]")
+{
+    s_rx_sem = xSemaphoreCreateBinary();
+    TEST_ASSERT_NOT_NULL(s_rx_sem);
+
+    // Install TinyUSB driver with default descriptors
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+
+    const tinyusb_config_cdcacm_t acm_cfg = {
+        .usb_dev = TINYUSB_USBDEV_0,
+        .cdc_port = CDC_BENCHMARK_ITF,
+        .rx_unread_buf_sz = 64,
+        .callback_rx = &tinyusb_cdc_rx_callback,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tusb_cdc_acm_init(&acm_cfg));
+
+    char cmd[CDC_CMD_MAX_LEN];
+    while (true) {
+        cdc_read_command(cmd, sizeof(cmd));
+        unsigned total = 0;
+        if (sscanf(cmd, "RX %u", &total) == 1) {
+            cdc_benchmark_rx(total);
+        } else if (sscanf(cmd, "TX %u", &total) == 1) {
+            cdc_benchmark_tx(total);
+        } else {
+            cdc_write_str("ERROR\n");
+        }
+    }
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
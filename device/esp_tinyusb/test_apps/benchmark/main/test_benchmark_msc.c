@@ -0,0 +1,91 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_err.h"
+#include "esp_partition.h"
+#include "wear_levelling.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tusb_msc_storage.h"
+#if SOC_SDMMC_HOST_SUPPORTED
+#include "sdmmc_cmd.h"
+#endif
+
+/**
+ * @brief Install TinyUSB with default descriptors and keep serving the host
+ *
+ * The storage is not mounted by the application, it is exposed to the host for the whole test.
+ */
+static void msc_benchmark_run(void)
+{
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+    printf("BENCHMARK: msc storage ready, %lu sectors of %lu bytes\n",
+           (unsigned long)tinyusb_msc_storage_get_sector_count(), (unsigned long)tinyusb_msc_storage_get_sector_size());
+    while (true) {
+        vTaskDelay(portMAX_DELAY);
+    }
+}
+
+/**
+ * @brief TinyUSB MSC benchmark with SPI Flash storage
+ *
+ * This is not a 'standard' testcase, as it never exits.
+ * The host measures sequential write and read of the raw block device.
+ */
+TEST_CASE("tinyusb_msc_benchmark_spiflash", "[esp_tinyusb][msc_benchmark_spiflash]")
+{
+    const esp_partition_t *data_partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, NULL);
+    TEST_ASSERT_NOT_NULL(data_partition);
+    wl_handle_t wl_handle = WL_INVALID_HANDLE;
+    TEST_ASSERT_EQUAL(ESP_OK, wl_mount(data_partition, &wl_handle));
+
+    const tinyusb_msc_spiflash_config_t config_spi = {
+        .wl_handle = wl_handle,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_spiflash(&config_spi));
+    msc_benchmark_run();
+}
+
+#if SOC_SDMMC_HOST_SUPPORTED
+/**
+ * @brief TinyUSB MSC benchmark with SD card storage
+ *
+ * This is not a 'standard' testcase, as it never exits.
+ * Requires an SD card connected to the default pins of the SDMMC slot.
+ */
+TEST_CASE("tinyusb_msc_benchmark_sdmmc", "[esp_tinyusb][msc_benchmark_sdmmc]")
+{
+    sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+    host.max_freq_khz = SDMMC_FREQ_HIGHSPEED;
+    const sdmmc_slot_config_t slot_config = SDMMC_SLOT_CONFIG_DEFAULT();
+
+    sdmmc_card_t *card = malloc(sizeof(sdmmc_card_t));
+    TEST_ASSERT_NOT_NULL(card);
+    TEST_ASSERT_EQUAL(ESP_OK, (*host.init)());
+    TEST_ASSERT_EQUAL(ESP_OK, sdmmc_host_init_slot(host.slot, &slot_config));
+    TEST_ASSERT_EQUAL(ESP_OK, sdmmc_card_init(&host, card));
+    sdmmc_card_print_info(stdout, card);
+
+    const tinyusb_msc_sdmmc_config_t config_sdmmc = {
+        .card = card,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_msc_storage_init_sdmmc(&config_sdmmc));
+    msc_benchmark_run();
+}
+#endif // SOC_SDMMC_HOST_SUPPORTED
+
+#endif // SOC_USB_OTG_SUPPORTED
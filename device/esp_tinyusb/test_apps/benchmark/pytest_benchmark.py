@@ -0,0 +1,167 @@
+# SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import glob
+import logging
+import mmap
+import os
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep, perf_counter
+from serial import Serial
+from serial.tools.list_ports import comports
+
+# Default descriptors of CDC + MSC device, see USB_TUSB_PID in usb_descriptors.c
+TUSB_HWID = '303A:4003'
+CDC_BENCHMARK_SIZE = 4 * 1024 * 1024
+MSC_IO_SIZE = 64 * 1024
+
+
+def usb_device_speed() -> str:
+    '''
+    Speed of the enumerated TinyUSB device in Mbit/s, as reported by Linux sysfs
+    '''
+    for path in glob.glob('/sys/bus/usb/devices/*/idProduct'):
+        dev = os.path.dirname(path)
+        with open(os.path.join(dev, 'idVendor')) as vid, open(path) as pid:
+            if vid.read().strip() == '303a' and pid.read().strip() == '4003':
+                with open(os.path.join(dev, 'speed')) as speed:
+                    return speed.read().strip()
+    return 'unknown'
+
+
+def report(record_property, name: str, size: int, seconds: float) -> None:
+    '''
+    Log the throughput and attach it to the JUnit report, so it can be tracked across releases
+    '''
+    kbps = size / seconds / 1024
+    speed = usb_device_speed()
+    logging.info(f'BENCHMARK {name}: {kbps:.1f} KiB/s ({size} bytes in {seconds:.3f} s, {speed} Mbit/s bus)')
+    record_property(f'{name}_kib_per_s', f'{kbps:.1f}')
+    record_property('usb_speed_mbps', speed)
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+@pytest.mark.usb_device
+def test_usb_device_cdc_benchmark(dut: IdfDut, record_property) -> None:
+    '''
+    Test procedure:
+    1. Run the benchmark on the DUT
+    2. Send CDC_BENCHMARK_SIZE bytes to the device and measure the time until the device confirms reception
+    3. Request CDC_BENCHMARK_SIZE bytes from the device and measure the time until they are received
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[cdc_benchmark]')
+    dut.expect_exact('TinyUSB: TinyUSB Driver installed')
+    sleep(2)  # Some time for the OS to enumerate our USB device
+
+    ports = [port for port, _, hwid in comports() if TUSB_HWID in hwid]
+    if len(ports) != 1:
+        raise Exception('TinyUSB COM port not found')
+
+    with Serial(ports[0], timeout=10) as cdc:
+        # Host to device
+        cdc.write(f'RX {CDC_BENCHMARK_SIZE}\n'.encode())
+        assert cdc.readline().strip() == b'READY'
+        data = os.urandom(CDC_BENCHMARK_SIZE)
+        start = perf_counter()
+        cdc.write(data)
+        res = cdc.readline()
+        elapsed = perf_counter() - start
+        assert res.startswith(b'DONE')
+        report(record_property, 'cdc_rx', CDC_BENCHMARK_SIZE, elapsed)
+        dut.expect(r'BENCHMARK: cdc_rx (\d+) bytes in (\d+) us')
+
+        # Device to host
+        cdc.write(f'TX {CDC_BENCHMARK_SIZE}\n'.encode())
+        received = 0
+        start = perf_counter()
+        while received < CDC_BENCHMARK_SIZE:
+            chunk = cdc.read(CDC_BENCHMARK_SIZE - received)
+            assert chunk, 'CDC TX benchmark timed out'
+            received += len(chunk)
+        elapsed = perf_counter() - start
+        report(record_property, 'cdc_tx', CDC_BENCHMARK_SIZE, elapsed)
+        dut.expect(r'BENCHMARK: cdc_tx (\d+) bytes in (\d+) us')
+
+
+def find_msc_block_device() -> str:
+    '''
+    Find the whole-disk block device of TinyUSB MSC, see tud_msc_inquiry_cb()
+    '''
+    for _ in range(10):
+        disks = [d for d in glob.glob('/dev/disk/by-id/usb-TinyUSB_Flash_Storage*') if '-part' not in d]
+        if disks:
+            return os.path.realpath(disks[0])
+        sleep(1)
+    raise Exception('TinyUSB MSC block device not found')
+
+
+def block_device_throughput(path: str, size: int, write: bool) -> float:
+    '''
+    Sequentially write or read the block device, bypassing the page cache
+
+    O_DIRECT requires aligned buffers, mmap provides page aligned memory.
+    '''
+    buf = mmap.mmap(-1, MSC_IO_SIZE)
+    if write:
+        buf.write(os.urandom(MSC_IO_SIZE))
+    fd = os.open(path, (os.O_WRONLY if write else os.O_RDONLY) | os.O_DIRECT)
+    try:
+        start = perf_counter()
+        for offset in range(0, size, MSC_IO_SIZE):
+            if write:
+                os.pwritev(fd, [buf], offset)
+            else:
+                os.preadv(fd, [buf], offset)
+        if write:
+            os.fsync(fd)
+        return perf_counter() - start
+    finally:
+        os.close(fd)
+        buf.close()
+
+
+def run_msc_benchmark(dut: IdfDut, record_property, test_filter: str, name: str) -> None:
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write(test_filter)
+    res = dut.expect(r'BENCHMARK: msc storage ready, (\d+) sectors of (\d+) bytes')
+    capacity = int(res[1].decode()) * int(res[2].decode())
+    sleep(2)  # Some time for the OS to enumerate our USB device
+
+    disk = find_msc_block_device()
+    # Use the most of the storage, but keep the benchmark time reasonable
+    size = min(capacity, 32 * 1024 * 1024) // MSC_IO_SIZE * MSC_IO_SIZE
+    assert size > 0
+    report(record_property, f'msc_{name}_write', size, block_device_throughput(disk, size, True))
+    report(record_property, f'msc_{name}_read', size, block_device_throughput(disk, size, False))
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+@pytest.mark.usb_device
+def test_usb_device_msc_benchmark_spiflash(dut: IdfDut, record_property) -> None:
+    '''
+    Test procedure:
+    1. Run the SPI Flash benchmark on the DUT
+    2. Sequentially write and then read the whole raw block device
+       The content of the storage is destroyed, which requires root access to the block device.
+    '''
+    run_msc_benchmark(dut, record_property, '[msc_benchmark_spiflash]', 'spiflash')
+
+
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+@pytest.mark.usb_device
+@pytest.mark.skipif(not os.environ.get('USB_BENCHMARK_SDMMC'), reason='SD card is not connected to the DUT')
+def test_usb_device_msc_benchmark_sdmmc(dut: IdfDut, record_property) -> None:
+    '''
+    Test procedure:
+    1. Run the SD card benchmark on the DUT, set USB_BENCHMARK_SDMMC=1 if the DUT has an SD card
+    2. Sequentially write and then read the first 32 MiB of the raw block device
+       The content of the card is destroyed, which requires root access to the block device.
+    '''
+    run_msc_benchmark(dut, record_property, '[msc_benchmark_sdmmc]', 'sdmmc')
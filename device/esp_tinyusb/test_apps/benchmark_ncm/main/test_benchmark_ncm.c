@@ -0,0 +1,181 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "soc/soc_caps.h"
+#if SOC_USB_OTG_SUPPORTED
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_err.h"
+
+#include "unity.h"
+#include "tinyusb.h"
+#include "tinyusb_net.h"
+
+/*
+ * Raw Ethernet frames with local experimental EtherType, the first payload byte is the command:
+ * - 'D': Data, counted by the device
+ * - 'E': Echo, sent back to the host, for latency measurement
+ * - 'S': Source, device sends <u32 count> frames of <u16 length> bytes to the host
+ * - 'R': Report, device replies 'R' <u32 frames> <u32 bytes> <u32 us from first to last data frame>
+ */
+#define NCM_BENCHMARK_ETHERTYPE 0x88B5
+#define ETH_HEADER_LEN          14
+#define ETH_FRAME_MAX_LEN       1514
+#define NCM_CMD_OFFSET          ETH_HEADER_LEN
+
+typedef struct {
+    uint32_t frames;
+    uint32_t bytes;
+    int64_t first_us;
+    int64_t last_us;
+} ncm_rx_stats_t;
+
+typedef struct {
+    uint8_t host_mac[6];
+    uint32_t count;
+    uint16_t len;
+} ncm_source_req_t;
+
+static const uint8_t s_dev_mac[6] = {0x02, 0x02, 0x11, 0x22, 0x33, 0x01};
+static ncm_rx_stats_t s_rx_stats;
+static QueueHandle_t s_source_queue;
+static uint8_t s_tx_frame[ETH_FRAME_MAX_LEN];
+
+static void ncm_fill_header(uint8_t *frame, const uint8_t *dst)
+{
+    memcpy(&frame[0], dst, 6);
+    memcpy(&frame[6], s_dev_mac, 6);
+    frame[12] = NCM_BENCHMARK_ETHERTYPE >> 8;
+    frame[13] = NCM_BENCHMARK_ETHERTYPE & 0xFF;
+}
+
+static void ncm_free_tx_buffer(void *buffer, void *ctx)
+{
+    free(buffer);
+}
+
+static void ncm_send_copy(const uint8_t *frame, uint16_t len)
+{
+    uint8_t *copy = malloc(len);
+    if (copy == NULL) {
+        return;
+    }
+    memcpy(copy, frame, len);
+    if (tinyusb_net_send_async(copy, len, copy) != ESP_OK) {
+        free(copy);
+    }
+}
+
+// Runs in the TinyUSB task, must not block
+static esp_err_t ncm_recv_callback(void *buffer, uint16_t len, void *ctx)
+{
+    uint8_t *frame = buffer;
+    if (len <= NCM_CMD_OFFSET || frame[12] != (NCM_BENCHMARK_ETHERTYPE >> 8) || frame[13] != (NCM_BENCHMARK_ETHERTYPE & 0xFF)) {
+        return ESP_OK;  // Other traffic of the host
+    }
+
+    uint8_t reply[ETH_HEADER_LEN + 13];
+    switch (frame[NCM_CMD_OFFSET]) {
+    case 'D': {
+        const int64_t now = esp_timer_get_time();
+        if (s_rx_stats.frames == 0) {
+            s_rx_stats.first_us = now;
+        }
+        s_rx_stats.last_us = now;
+        s_rx_stats.frames++;
+        s_rx_stats.bytes += len;
+        break;
+    }
+    case 'E':
+        memcpy(&frame[0], &frame[6], 6);
+        memcpy(&frame[6], s_dev_mac, 6);
+        ncm_send_copy(frame, len);
+        break;
+    case 'S': {
+        ncm_source_req_t req;
+        memcpy(req.host_mac, &frame[6], 6);
+        memcpy(&req.count, &frame[NCM_CMD_OFFSET + 1], sizeof(req.count));
+        memcpy(&req.len, &frame[NCM_CMD_OFFSET + 5], sizeof(req.len));
+        xQueueSend(s_source_queue, &req, 0);
+        break;
+    }
+    case 'R': {
+        const uint32_t elapsed = (uint32_t)(s_rx_stats.last_us - s_rx_stats.first_us);
+        ncm_fill_header(reply, &frame[6]);
+        reply[NCM_CMD_OFFSET] = 'R';
+        memcpy(&reply[NCM_CMD_OFFSET + 1], &s_rx_stats.frames, 4);
+        memcpy(&reply[NCM_CMD_OFFSET + 5], &s_rx_stats.bytes, 4);
+        memcpy(&reply[NCM_CMD_OFFSET + 9], &elapsed, 4);
+        printf("BENCHMARK: ncm_rx %lu frames, %lu bytes in %lu us\n",
+               (unsigned long)s_rx_stats.frames, (unsigned long)s_rx_stats.bytes, (unsigned long)elapsed);
+        memset(&s_rx_stats, 0, sizeof(s_rx_stats));
+        ncm_send_copy(reply, sizeof(reply));
+        break;
+    }
+    default:
+        break;
+    }
+    return ESP_OK;
+}
+
+static void ncm_source(const ncm_source_req_t *req)
+{
+    const uint16_t len = MIN(MAX(req->len, ETH_HEADER_LEN + 1), ETH_FRAME_MAX_LEN);
+    ncm_fill_header(s_tx_frame, req->host_mac);
+    s_tx_frame[NCM_CMD_OFFSET] = 'D';
+    const int64_t start = esp_timer_get_time();
+    uint32_t sent = 0;
+    while (sent < req->count) {
+        // The frame is copied to the NTB before the synchronous send returns
+        if (tinyusb_net_send_sync(s_tx_frame, len, NULL, pdMS_TO_TICKS(100)) == ESP_OK) {
+            sent++;
+        } else {
+            vTaskDelay(1);
+        }
+    }
+    printf("BENCHMARK: ncm_tx %lu frames of %u bytes in %lld us\n",
+           (unsigned long)sent, len, esp_timer_get_time() - start);
+}
+
+/**
+ * @brief TinyUSB NCM throughput and latency benchmark
+ *
+ * This is not a 'standard' testcase, as it never exits. The host drives the benchmark
+ * by raw Ethernet frames, see NCM_BENCHMARK_ETHERTYPE.
+ */
+TEST_CASE("tinyusb_ncm_benchmark", "[esp_tinyusb][ncm_benchmark]")
+{
+    s_source_queue = xQueueCreate(1, sizeof(ncm_source_req_t));
+    TEST_ASSERT_NOT_NULL(s_source_queue);
+
+    const tinyusb_config_t tusb_cfg = {
+        .external_phy = false,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_driver_install(&tusb_cfg));
+
+    tinyusb_net_config_t net_config = {
+        .on_recv_callback = ncm_recv_callback,
+        .free_tx_buffer = ncm_free_tx_buffer,
+    };
+    memcpy(net_config.mac_addr, s_dev_mac, sizeof(net_config.mac_addr));
+    TEST_ASSERT_EQUAL(ESP_OK, tinyusb_net_init(TINYUSB_USBDEV_0, &net_config));
+
+    ncm_source_req_t req;
+    while (true) {
+        if (xQueueReceive(s_source_queue, &req, portMAX_DELAY) == pdTRUE) {
+            ncm_source(&req);
+        }
+    }
+}
+
+#endif // SOC_USB_OTG_SUPPORTED
@@ -0,0 +1,122 @@
+# SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+# SPDX-License-Identifier: Apache-2.0
+
+import glob
+import logging
+import os
+import socket
+import struct
+import pytest
+from pytest_embedded_idf.dut import IdfDut
+from time import sleep, perf_counter
+
+# Local experimental EtherType, see test_benchmark_ncm.c
+NCM_BENCHMARK_ETHERTYPE = 0x88B5
+BROADCAST = b'\xff' * 6
+FRAME_LEN = 1514
+FRAME_COUNT = 5000
+ECHO_COUNT = 200
+
+
+def find_ncm_interface() -> tuple:
+    '''
+    Find the host network interface of the TinyUSB NCM device and its speed in Linux sysfs
+    '''
+    for _ in range(10):
+        for path in glob.glob('/sys/class/net/*/device'):
+            usb_dev = os.path.dirname(os.path.realpath(path))  # interface -> device
+            vid_path = os.path.join(usb_dev, 'idVendor')
+            if os.path.exists(vid_path):
+                with open(vid_path) as vid:
+                    if vid.read().strip() == '303a':
+                        with open(os.path.join(usb_dev, 'speed')) as speed:
+                            return os.path.basename(os.path.dirname(path)), speed.read().strip()
+        sleep(1)
+    raise Exception('TinyUSB NCM network interface not found')
+
+
+def frame(src: bytes, cmd: bytes, payload: bytes = b'', length: int = 0) -> bytes:
+    data = BROADCAST + src + struct.pack('!H', NCM_BENCHMARK_ETHERTYPE) + cmd + payload
+    return data + bytes(max(0, length - len(data)))
+
+
+def receive_cmd(sock: socket.socket, cmd: bytes) -> bytes:
+    while True:
+        data = sock.recv(2048)
+        if len(data) > 14 and data[14:15] == cmd:
+            return data
+
+
+@pytest.mark.esp32s2
+@pytest.mark.esp32s3
+@pytest.mark.esp32p4
+@pytest.mark.usb_device
+def test_usb_device_ncm_benchmark(dut: IdfDut, record_property) -> None:
+    '''
+    Running the test requires root, to bring the interface up and to open a raw socket.
+
+    Test procedure:
+    1. Run the benchmark on the DUT
+    2. Send FRAME_COUNT data frames and read the device statistics, host to device throughput
+    3. Request FRAME_COUNT frames from the device, device to host throughput
+    4. Send ECHO_COUNT echo frames one by one, round trip latency
+    '''
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[ncm_benchmark]')
+    dut.expect_exact('TinyUSB: TinyUSB Driver installed')
+    sleep(2)  # Some time for the OS to enumerate our USB device
+
+    ifname, speed = find_ncm_interface()
+    os.system(f'ip link set {ifname} up')
+    sleep(1)
+    record_property('usb_speed_mbps', speed)
+
+    with socket.socket(socket.AF_PACKET, socket.SOCK_RAW, socket.htons(NCM_BENCHMARK_ETHERTYPE)) as sock:
+        sock.bind((ifname, 0))
+        sock.settimeout(5)
+        src = sock.getsockname()[4]
+
+        # Host to device
+        data = frame(src, b'D', length=FRAME_LEN)
+        start = perf_counter()
+        for _ in range(FRAME_COUNT):
+            sock.send(data)
+        elapsed = perf_counter() - start
+        sleep(0.5)  # Let the device process all frames
+        sock.send(frame(src, b'R', length=60))
+        frames, size, device_us = struct.unpack('<III', receive_cmd(sock, b'R')[15:27])
+        kbps = size / max(device_us, 1) * 1e6 / 1024
+        logging.info(f'BENCHMARK ncm_rx: {kbps:.1f} KiB/s ({frames}/{FRAME_COUNT} frames, host sent in {elapsed:.3f} s, {speed} Mbit/s bus)')
+        record_property('ncm_rx_kib_per_s', f'{kbps:.1f}')
+        record_property('ncm_rx_lost_frames', FRAME_COUNT - frames)
+        dut.expect(r'BENCHMARK: ncm_rx (\d+) frames')
+
+        # Device to host
+        sock.send(frame(src, b'S', struct.pack('<IH', FRAME_COUNT, FRAME_LEN), length=60))
+        received = 0
+        start = perf_counter()
+        try:
+            while received < FRAME_COUNT:
+                receive_cmd(sock, b'D')
+                received += 1
+        except socket.timeout:
+            pass
+        elapsed = perf_counter() - start
+        kbps = received * FRAME_LEN / elapsed / 1024
+        logging.info(f'BENCHMARK ncm_tx: {kbps:.1f} KiB/s ({received}/{FRAME_COUNT} frames in {elapsed:.3f} s)')
+        record_property('ncm_tx_kib_per_s', f'{kbps:.1f}')
+        dut.expect(r'BENCHMARK: ncm_tx (\d+) frames')
+        assert received > 0
+
+        # Latency
+        rtt = []
+        for i in range(ECHO_COUNT):
+            start = perf_counter()
+            sock.send(frame(src, b'E', struct.pack('<I', i), length=60))
+            while struct.unpack('<I', receive_cmd(sock, b'E')[15:19])[0] != i:
+                pass
+            rtt.append(perf_counter() - start)
+        rtt.sort()
+        logging.info(f'BENCHMARK ncm_rtt: median {rtt[len(rtt) // 2] * 1e6:.0f} us, max {rtt[-1] * 1e6:.0f} us')
+        record_property('ncm_rtt_median_us', f'{rtt[len(rtt) // 2] * 1e6:.0f}')
+        record_property('ncm_rtt_max_us', f'{rtt[-1] * 1e6:.0f}')
@@ -6,6 +6,9 @@
 
 #include <string.h>
 #include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_err.h"
@@ -14,18 +17,51 @@
 #include "descriptors_control.h"
 #include "tusb.h"
 #include "tusb_tasks.h"
+#include "device/dcd.h"
+#include "device/usbd_pvt.h"
+#if CONFIG_TINYUSB_EARLY_INIT
+#include "esp_idf_version.h"
+#include "esp_private/startup_internal.h"
+#endif
+
+#define RECONFIGURE_TIMEOUT_MS  1000
 
 const static char *TAG = "TinyUSB";
 static usb_phy_handle_t phy_hdl;
 
+// Descriptors swapped in the TinyUSB task, the only user of them
+static struct {
+    tinyusb_config_t config;
+    esp_err_t ret;
+    SemaphoreHandle_t done;
+} s_reconfigure;
+
 // For the tinyusb component without tusb_teardown() implementation
 #ifndef tusb_teardown
 #   define tusb_teardown()   (true)
 #endif // tusb_teardown
 
+#if CONFIG_TINYUSB_EARLY_INIT
+// Driver installed by the startup hook, kept by the first tinyusb_driver_install() of the application
+static bool s_early_installed;
+#endif
+
 esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
 {
     ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+#if CONFIG_TINYUSB_EARLY_INIT
+    if (s_early_installed) {
+        s_early_installed = false;
+        if (config->device_descriptor || config->string_descriptor || config->configuration_descriptor
+#if (TUD_OPT_HIGH_SPEED)
+                || config->hs_configuration_descriptor || config->qualifier_descriptor
+#endif // TUD_OPT_HIGH_SPEED
+           ) {
+            ESP_LOGW(TAG, "Driver installed at startup with default descriptors, use tinyusb_driver_reconfigure() to change them");
+        }
+        return ESP_OK;
+    }
+#endif // CONFIG_TINYUSB_EARLY_INIT
 
     // Configure USB PHY
     usb_phy_config_t phy_conf = {
@@ -102,11 +138,79 @@ esp_err_t tinyusb_driver_install(const tinyusb_config_t *config)
 
 esp_err_t tinyusb_driver_uninstall(void)
 {
+#if CONFIG_TINYUSB_EARLY_INIT
+    s_early_installed = false;
+#endif
 #if !CONFIG_TINYUSB_NO_DEFAULT_TASK
     ESP_RETURN_ON_ERROR(tusb_stop_task(), TAG, "Unable to stop TinyUSB task");
 #endif // !CONFIG_TINYUSB_NO_DEFAULT_TASK
     ESP_RETURN_ON_FALSE(tusb_teardown(), ESP_ERR_NOT_FINISHED, TAG, "Unable to teardown TinyUSB");
     tinyusb_free_descriptors();
     ESP_RETURN_ON_ERROR(usb_del_phy(phy_hdl), TAG, "Unable to delete PHY");
+    phy_hdl = NULL;
+    return ESP_OK;
+}
+
+static void do_reconfigure(void *param)
+{
+    (void) param;
+    // Processed after this function, closes the class drivers and invokes tud_umount_cb()
+    dcd_event_bus_signal(TUD_OPT_RHPORT, DCD_EVENT_UNPLUGGED, false);
+    tinyusb_free_descriptors();
+    s_reconfigure.ret = tinyusb_set_descriptors(&s_reconfigure.config);
+    xSemaphoreGive(s_reconfigure.done);
+}
+
+esp_err_t tinyusb_driver_reconfigure(const tinyusb_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, TAG, "Config can't be NULL");
+    ESP_RETURN_ON_FALSE(phy_hdl, ESP_ERR_INVALID_STATE, TAG, "Driver not installed");
+    if (s_reconfigure.done == NULL) {
+        // Kept until reboot, a timed out swap may still give it
+        s_reconfigure.done = xSemaphoreCreateBinary();
+        ESP_RETURN_ON_FALSE(s_reconfigure.done, ESP_ERR_NO_MEM, TAG, "No memory for reconfiguration");
+    }
+
+    ESP_RETURN_ON_FALSE(tud_disconnect(), ESP_ERR_NOT_SUPPORTED, TAG, "Unable to detach");
+    TickType_t detached = xTaskGetTickCount();
+    s_reconfigure.config = *config;
+    usbd_defer_func(do_reconfigure, NULL, false);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(s_reconfigure.done, pdMS_TO_TICKS(RECONFIGURE_TIMEOUT_MS)) == pdTRUE,
+                        ESP_ERR_TIMEOUT, TAG, "TinyUSB task did not swap the descriptors");
+    // The device stays detached on invalid descriptors
+    ESP_RETURN_ON_ERROR(s_reconfigure.ret, TAG, "Descriptors config failed");
+
+    xTaskDelayUntil(&detached, pdMS_TO_TICKS(CONFIG_TINYUSB_RECONFIGURE_DETACH_MS));
+    ESP_RETURN_ON_FALSE(tud_connect(), ESP_FAIL, TAG, "Unable to attach");
+    ESP_LOGI(TAG, "TinyUSB Driver reconfigured");
+    return ESP_OK;
+}
+
+#if CONFIG_TINYUSB_EARLY_INIT
+/**
+ * @brief Install the driver with the default descriptors before app_main()
+ *
+ * Runs on CPU0 before the scheduler starts, the TinyUSB task runs from the first tick on.
+ * A failure is only logged, so the application still boots and may install the driver itself.
+ */
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 2, 0)
+ESP_SYSTEM_INIT_FN(tinyusb_early_init, SECONDARY, BIT(0), 250)
+#else
+ESP_SYSTEM_INIT_FN(tinyusb_early_init, BIT(0), 250)
+#endif
+{
+    const tinyusb_config_t config = { 0 };
+    const esp_err_t ret = tinyusb_driver_install(&config);
+    if (ret == ESP_OK) {
+        s_early_installed = true;
+    } else {
+        ESP_EARLY_LOGE(TAG, "Early install failed: %s", esp_err_to_name(ret));
+    }
     return ESP_OK;
 }
+
+// Referenced by a linker flag of the component, so that the startup hook is linked
+void tinyusb_early_init_include(void)
+{
+}
+#endif // CONFIG_TINYUSB_EARLY_INIT
@@ -0,0 +1,523 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_bt.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_bth.h"
+
+static const char *TAG = "tusb_bth";
+
+#define BTH_BUFFER_NUM                  CONFIG_TINYUSB_BTH_BRIDGE_BUFFER_NUM
+#define BTH_BUFFER_SIZE                 CONFIG_TINYUSB_BTH_BRIDGE_BUFFER_SIZE
+#define BTH_DEINIT_TIMEOUT_MS           1000
+
+// H4 packet types, the first byte of VHCI packets
+#define H4_TYPE_CMD                     0x01
+#define H4_TYPE_ACL                     0x02
+#define H4_TYPE_SCO                     0x03
+#define H4_TYPE_EVT                     0x04
+#define H4_TYPE_ISO                     0x05
+
+#define HCI_CMD_HEADER_SIZE             3
+#define HCI_ACL_HEADER_SIZE             4
+#define HCI_EVT_HEADER_SIZE             2
+#define HCI_EVT_CMD_COMPLETE            0x0E
+#define HCI_EVT_NUM_COMPLETED_PACKETS   0x13
+#define HCI_OP_RESET                    0x0C03
+#define HCI_OP_READ_BUFFER_SIZE         0x1005
+#define HCI_OP_LE_READ_BUFFER_SIZE      0x2002
+#define HCI_OP_LE_READ_BUFFER_SIZE_V2   0x2060
+
+#define BTH_STAT_INC(bth, counter)      __atomic_fetch_add(&(bth)->stats.counter, 1, __ATOMIC_RELAXED)
+
+typedef struct {
+    uint16_t len;                       // Bytes of data, H4 packet type included
+    uint8_t reserved;
+    uint8_t data[BTH_BUFFER_SIZE];      // H4 packet type, then the HCI packet at a word aligned address
+} __attribute__((aligned(4))) bth_buffer_t;
+
+typedef struct {
+    bth_buffer_t *buffer;               // NULL while the packet is dropped
+    uint16_t received;                  // Bytes of the ACL packet received so far
+    uint16_t total;                     // Bytes of the ACL packet, valid once the header is received
+    uint8_t header[HCI_ACL_HEADER_SIZE];
+} bth_acl_rx_t;
+
+typedef struct {
+    uint8_t ep_evt;
+    uint8_t ep_acl_in;
+    bth_buffer_t *pool;                 // BTH_BUFFER_NUM buffers to the controller, then BTH_BUFFER_NUM to the host
+    QueueHandle_t ctrl_free;            // Buffers for packets of the USB host
+    QueueHandle_t ctrl_cmd;             // Commands waiting for VHCI
+    QueueHandle_t ctrl_acl;             // ACL packets waiting for VHCI and controller credits
+    QueueHandle_t host_free;            // Buffers for packets of the controller
+    QueueHandle_t host_evt;             // Events waiting for the event endpoint
+    QueueHandle_t host_acl;             // ACL packets waiting for the ACL IN endpoint
+    bth_buffer_t *evt_current;          // Buffer sent on the event endpoint, TinyUSB task only
+    bth_buffer_t *acl_current;          // Buffer sent on the ACL IN endpoint, TinyUSB task only
+    bth_acl_rx_t acl_rx;                // ACL packet being received, TinyUSB task only
+    int32_t acl_credits;                // Atomic access
+    int32_t acl_credits_max;            // Atomic access, 0 while the buffers of the controller are not known
+    bool acl_credits_le;                // Taken from LE Read Buffer Size, which overrides the shared BR/EDR buffers
+    tinyusb_bth_bridge_stats_t stats;   // Atomic access
+    SemaphoreHandle_t deinit_done;
+    esp_err_t deinit_result;
+} tinyusb_bth_t;
+
+static tinyusb_bth_t *s_bth;
+static uint32_t s_vhci_busy;            // VHCI callbacks using s_bth, atomic access
+static bool s_vhci_registered;
+
+static inline tinyusb_bth_t *bth_get(void)
+{
+    return __atomic_load_n(&s_bth, __ATOMIC_SEQ_CST);
+}
+
+/* Controller credits
+ ********************************************************************* */
+
+static void bth_credits_set(tinyusb_bth_t *bth, int32_t max)
+{
+    // Read at initialization of the host stack, no ACL packets are in the controller
+    __atomic_store_n(&bth->acl_credits_max, max, __ATOMIC_RELEASE);
+    __atomic_store_n(&bth->acl_credits, max, __ATOMIC_RELEASE);
+}
+
+static void bth_credits_return(tinyusb_bth_t *bth, int32_t completed)
+{
+    const int32_t max = __atomic_load_n(&bth->acl_credits_max, __ATOMIC_ACQUIRE);
+    if (max == 0) {
+        return;
+    }
+    int32_t credits = __atomic_load_n(&bth->acl_credits, __ATOMIC_RELAXED);
+    int32_t next;
+    do {
+        next = MIN(credits + completed, max);
+    } while (!__atomic_compare_exchange_n(&bth->acl_credits, &credits, next, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+}
+
+static bool bth_credits_take(tinyusb_bth_t *bth)
+{
+    if (__atomic_load_n(&bth->acl_credits_max, __ATOMIC_ACQUIRE) == 0) {
+        return true;    // Not known yet, only VHCI flow control applies
+    }
+    int32_t credits = __atomic_load_n(&bth->acl_credits, __ATOMIC_RELAXED);
+    do {
+        if (credits <= 0) {
+            return false;   // Continued on Number Of Completed Packets
+        }
+    } while (!__atomic_compare_exchange_n(&bth->acl_credits, &credits, credits - 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+    return true;
+}
+
+/**
+ * @brief Track the ACL buffers of the controller from the events sent to the USB host
+ *
+ * @param[in] bth Bridge
+ * @param[in] evt HCI event without H4 packet type
+ * @param[in] len Length of the event
+ */
+static void bth_parse_event(tinyusb_bth_t *bth, const uint8_t *evt, uint16_t len)
+{
+    if (len < HCI_EVT_HEADER_SIZE || len < HCI_EVT_HEADER_SIZE + evt[1]) {
+        return;
+    }
+    const uint8_t *param = evt + HCI_EVT_HEADER_SIZE;
+    const uint8_t param_len = evt[1];
+
+    switch (evt[0]) {
+    case HCI_EVT_CMD_COMPLETE: {
+        // Num_HCI_Command_Packets, Command_Opcode, Status, then return parameters of the command
+        if (param_len < 4 || param[3] != 0) {
+            break;
+        }
+        const uint16_t opcode = param[1] | (param[2] << 8);
+        if (opcode == HCI_OP_READ_BUFFER_SIZE && param_len >= 11) {
+            // ACL_Data_Packet_Length, Synchronous_Data_Packet_Length, Total_Num_ACL_Data_Packets
+            if (!bth->acl_credits_le) {
+                bth_credits_set(bth, param[7] | (param[8] << 8));
+            }
+        } else if ((opcode == HCI_OP_LE_READ_BUFFER_SIZE || opcode == HCI_OP_LE_READ_BUFFER_SIZE_V2) && param_len >= 7) {
+            // LE_ACL_Data_Packet_Length, Total_Num_LE_ACL_Data_Packets, 0 if shared with BR/EDR
+            if (param[6]) {
+                bth->acl_credits_le = true;
+                bth_credits_set(bth, param[6]);
+            }
+        }
+        break;
+    }
+    case HCI_EVT_NUM_COMPLETED_PACKETS: {
+        // Num_Handles, then Connection_Handle and Num_Completed_Packets of each handle
+        const uint8_t handles = param[0];
+        if (param_len < 1 + handles * 4) {
+            break;
+        }
+        int32_t completed = 0;
+        for (int i = 0; i < handles; i++) {
+            const uint8_t *count = &param[1 + i * 4 + 2];
+            completed += count[0] | (count[1] << 8);
+        }
+        bth_credits_return(bth, completed);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/* TinyUSB task side
+ ********************************************************************* */
+
+static void host_release(tinyusb_bth_t *bth, bth_buffer_t **current)
+{
+    xQueueSend(bth->host_free, current, 0);
+    *current = NULL;
+}
+
+static void host_send(tinyusb_bth_t *bth, uint8_t ep, QueueHandle_t queue, bth_buffer_t **current,
+                      bool (*send)(void *, uint16_t), uint32_t *sent)
+{
+    // Transfers are aborted without a callback on bus reset and unplug
+    if (*current && !usbd_edpt_busy(TUD_OPT_RHPORT, ep)) {
+        host_release(bth, current);
+    }
+    while (*current == NULL && xQueueReceive(queue, current, 0) == pdTRUE) {
+        bth_buffer_t *buffer = *current;
+        // The endpoint tells the packet type, the H4 packet type is not sent
+        if (send(buffer->data + 1, buffer->len - 1)) {
+            __atomic_fetch_add(sent, 1, __ATOMIC_RELAXED);
+        } else {
+            BTH_STAT_INC(bth, dropped_to_host);
+            host_release(bth, current);
+        }
+    }
+}
+
+static void host_drain(void *param)
+{
+    (void) param;
+    tinyusb_bth_t *bth = bth_get();
+    if (bth == NULL) {
+        return;
+    }
+    host_send(bth, bth->ep_evt, bth->host_evt, &bth->evt_current, tud_bt_event_send, &bth->stats.evt_to_host);
+    host_send(bth, bth->ep_acl_in, bth->host_acl, &bth->acl_current, tud_bt_acl_data_send, &bth->stats.acl_to_host);
+}
+
+static void ctrl_drain(void *param)
+{
+    (void) param;
+    tinyusb_bth_t *bth = bth_get();
+    if (bth == NULL) {
+        return;
+    }
+    bth_buffer_t *buffer;
+    // Continued from the send available callback of VHCI
+    while (esp_vhci_host_check_send_available()) {
+        // Commands are flow controlled by the USB host, with Num_HCI_Command_Packets of the events
+        if (xQueueReceive(bth->ctrl_cmd, &buffer, 0) == pdTRUE) {
+            BTH_STAT_INC(bth, cmd_to_controller);
+        } else if (uxQueueMessagesWaiting(bth->ctrl_acl) && bth_credits_take(bth)) {
+            xQueueReceive(bth->ctrl_acl, &buffer, 0);
+            BTH_STAT_INC(bth, acl_to_controller);
+        } else {
+            break;
+        }
+        // VHCI copies the packet into the controller
+        esp_vhci_host_send_packet(buffer->data, buffer->len);
+        xQueueSend(bth->ctrl_free, &buffer, 0);
+    }
+}
+
+static void ctrl_drop_acl(tinyusb_bth_t *bth)
+{
+    bth_buffer_t *buffer;
+    while (xQueueReceive(bth->ctrl_acl, &buffer, 0) == pdTRUE) {
+        BTH_STAT_INC(bth, dropped_to_controller);
+        xQueueSend(bth->ctrl_free, &buffer, 0);
+    }
+}
+
+void tud_bt_hci_cmd_cb(void *hci_cmd, size_t cmd_len)
+{
+    tinyusb_bth_t *bth = bth_get();
+    if (bth == NULL) {
+        return;
+    }
+    bth_buffer_t *buffer;
+    if (cmd_len < HCI_CMD_HEADER_SIZE || cmd_len + 1 > BTH_BUFFER_SIZE ||
+            xQueueReceive(bth->ctrl_free, &buffer, 0) != pdTRUE) {
+        BTH_STAT_INC(bth, dropped_to_controller);
+        return;
+    }
+    const uint8_t *cmd = hci_cmd;
+    if ((cmd[0] | (cmd[1] << 8)) == HCI_OP_RESET) {
+        // Connections are closed, the credits are known again after the next Read Buffer Size
+        ctrl_drop_acl(bth);
+        bth->acl_credits_le = false;
+        bth_credits_set(bth, 0);
+    }
+    buffer->data[0] = H4_TYPE_CMD;
+    memcpy(buffer->data + 1, cmd, cmd_len);
+    buffer->len = cmd_len + 1;
+    xQueueSend(bth->ctrl_cmd, &buffer, 0);
+    ctrl_drain(NULL);
+}
+
+void tud_bt_acl_data_received_cb(void *acl_data, uint16_t data_len)
+{
+    tinyusb_bth_t *bth = bth_get();
+    if (bth == NULL) {
+        return;
+    }
+    // The endpoint delivers ACL packets in chunks of its packet size, which are collected in one buffer
+    bth_acl_rx_t *rx = &bth->acl_rx;
+    const uint8_t *data = acl_data;
+    while (data_len) {
+        if (rx->received < HCI_ACL_HEADER_SIZE) {
+            // The header is kept aside, so that the length is known even if the packet is dropped
+            const uint16_t chunk = MIN(data_len, HCI_ACL_HEADER_SIZE - rx->received);
+            memcpy(rx->header + rx->received, data, chunk);
+            rx->received += chunk;
+            data += chunk;
+            data_len -= chunk;
+            if (rx->received < HCI_ACL_HEADER_SIZE) {
+                break;
+            }
+            rx->total = HCI_ACL_HEADER_SIZE + (rx->header[2] | (rx->header[3] << 8));
+            if (rx->total + 1 <= BTH_BUFFER_SIZE && xQueueReceive(bth->ctrl_free, &rx->buffer, 0) == pdTRUE) {
+                rx->buffer->data[0] = H4_TYPE_ACL;
+                memcpy(rx->buffer->data + 1, rx->header, HCI_ACL_HEADER_SIZE);
+            } else {
+                rx->buffer = NULL;
+            }
+        }
+        const uint16_t chunk = MIN(data_len, rx->total - rx->received);
+        if (rx->buffer) {
+            memcpy(rx->buffer->data + 1 + rx->received, data, chunk);
+        }
+        rx->received += chunk;
+        data += chunk;
+        data_len -= chunk;
+        if (rx->received == rx->total) {
+            if (rx->buffer) {
+                rx->buffer->len = rx->total + 1;
+                xQueueSend(bth->ctrl_acl, &rx->buffer, 0);
+                rx->buffer = NULL;
+            } else {
+                BTH_STAT_INC(bth, dropped_to_controller);
+            }
+            rx->received = 0;
+        }
+    }
+    ctrl_drain(NULL);
+}
+
+void tud_bt_event_sent_cb(uint16_t sent_bytes)
+{
+    (void) sent_bytes;
+    tinyusb_bth_t *bth = bth_get();
+    if (bth && bth->evt_current) {
+        host_release(bth, &bth->evt_current);
+        host_drain(NULL);
+    }
+}
+
+void tud_bt_acl_data_sent_cb(uint16_t sent_bytes)
+{
+    (void) sent_bytes;
+    tinyusb_bth_t *bth = bth_get();
+    if (bth && bth->acl_current) {
+        host_release(bth, &bth->acl_current);
+        host_drain(NULL);
+    }
+}
+
+static void do_deinit(void *param)
+{
+    (void) param;
+    tinyusb_bth_t *bth = bth_get();
+    if (bth == NULL) {
+        return;
+    }
+    // The endpoints read from the buffers until the transfers end
+    if ((bth->evt_current && usbd_edpt_busy(TUD_OPT_RHPORT, bth->ep_evt)) ||
+            (bth->acl_current && usbd_edpt_busy(TUD_OPT_RHPORT, bth->ep_acl_in))) {
+        bth->deinit_result = ESP_ERR_INVALID_STATE;
+    } else {
+        __atomic_store_n(&s_bth, NULL, __ATOMIC_SEQ_CST);
+        bth->deinit_result = ESP_OK;
+    }
+    xSemaphoreGive(bth->deinit_done);
+}
+
+/* Controller side
+ ********************************************************************* */
+
+static void bth_vhci_send_available(void)
+{
+    if (bth_get()) {
+        usbd_defer_func(ctrl_drain, NULL, false);
+    }
+}
+
+static void bth_to_host(tinyusb_bth_t *bth, const uint8_t *data, uint16_t len)
+{
+    QueueHandle_t queue;
+    switch (data[0]) {
+    case H4_TYPE_EVT:
+        bth_parse_event(bth, data + 1, len - 1);
+        if (data[1] == HCI_EVT_NUM_COMPLETED_PACKETS) {
+            usbd_defer_func(ctrl_drain, NULL, false);
+        }
+        queue = bth->host_evt;
+        break;
+    case H4_TYPE_ACL:
+        queue = bth->host_acl;
+        break;
+    case H4_TYPE_SCO:
+    case H4_TYPE_ISO:
+        // The BTH class has no data path of its isochronous interface
+        BTH_STAT_INC(bth, dropped_iso);
+        return;
+    default:
+        BTH_STAT_INC(bth, dropped_to_host);
+        return;
+    }
+    bth_buffer_t *buffer;
+    if (len > BTH_BUFFER_SIZE || xQueueReceive(bth->host_free, &buffer, 0) != pdTRUE) {
+        BTH_STAT_INC(bth, dropped_to_host);
+        return;
+    }
+    // The only copy, the endpoint sends from this buffer
+    memcpy(buffer->data, data, len);
+    buffer->len = len;
+    xQueueSend(queue, &buffer, 0);
+    usbd_defer_func(host_drain, NULL, false);
+}
+
+static int bth_vhci_recv(uint8_t *data, uint16_t len)
+{
+    // tinyusb_bth_bridge_deinit() waits for the callbacks, which saw the bridge
+    __atomic_fetch_add(&s_vhci_busy, 1, __ATOMIC_SEQ_CST);
+    tinyusb_bth_t *bth = bth_get();
+    if (bth && len > 1) {
+        bth_to_host(bth, data, len);
+    }
+    __atomic_fetch_sub(&s_vhci_busy, 1, __ATOMIC_SEQ_CST);
+    return 0;
+}
+
+static const esp_vhci_host_callback_t s_vhci_callback = {
+    .notify_host_send_available = bth_vhci_send_available,
+    .notify_host_recv = bth_vhci_recv,
+};
+
+/* Public API
+ ********************************************************************* */
+
+static void _bth_free(tinyusb_bth_t *bth)
+{
+    QueueHandle_t queues[] = {bth->ctrl_free, bth->ctrl_cmd, bth->ctrl_acl, bth->host_free, bth->host_evt, bth->host_acl};
+    for (int i = 0; i < sizeof(queues) / sizeof(queues[0]); i++) {
+        if (queues[i]) {
+            vQueueDelete(queues[i]);
+        }
+    }
+    if (bth->deinit_done) {
+        vSemaphoreDelete(bth->deinit_done);
+    }
+    heap_caps_free(bth->pool);
+    free(bth);
+}
+
+esp_err_t tinyusb_bth_bridge_init(const tinyusb_config_bth_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && tu_edpt_dir(config->ep_evt) == TUSB_DIR_IN && tu_edpt_dir(config->ep_acl_in) == TUSB_DIR_IN,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(bth_get() == NULL, ESP_ERR_INVALID_STATE, TAG, "Bridge already started");
+
+    tinyusb_bth_t *bth = calloc(1, sizeof(tinyusb_bth_t));
+    ESP_RETURN_ON_FALSE(bth, ESP_ERR_NO_MEM, TAG, "No memory for BTH bridge");
+    bth->ep_evt = config->ep_evt;
+    bth->ep_acl_in = config->ep_acl_in;
+
+    // The endpoints send from the buffers
+    bth->pool = heap_caps_calloc(2 * BTH_BUFFER_NUM, sizeof(bth_buffer_t), MALLOC_CAP_DMA);
+    // Each queue can hold all buffers of its direction, so that returning a buffer never fails
+    bth->ctrl_free = xQueueCreate(BTH_BUFFER_NUM, sizeof(bth_buffer_t *));
+    bth->ctrl_cmd = xQueueCreate(BTH_BUFFER_NUM, sizeof(bth_buffer_t *));
+    bth->ctrl_acl = xQueueCreate(BTH_BUFFER_NUM, sizeof(bth_buffer_t *));
+    bth->host_free = xQueueCreate(BTH_BUFFER_NUM, sizeof(bth_buffer_t *));
+    bth->host_evt = xQueueCreate(BTH_BUFFER_NUM, sizeof(bth_buffer_t *));
+    bth->host_acl = xQueueCreate(BTH_BUFFER_NUM, sizeof(bth_buffer_t *));
+    bth->deinit_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(bth->pool && bth->ctrl_free && bth->ctrl_cmd && bth->ctrl_acl && bth->host_free &&
+                      bth->host_evt && bth->host_acl && bth->deinit_done, ESP_ERR_NO_MEM, fail, TAG,
+                      "No memory for BTH buffers");
+    for (int i = 0; i < BTH_BUFFER_NUM; i++) {
+        bth_buffer_t *ctrl_buffer = &bth->pool[i];
+        bth_buffer_t *host_buffer = &bth->pool[BTH_BUFFER_NUM + i];
+        xQueueSend(bth->ctrl_free, &ctrl_buffer, 0);
+        xQueueSend(bth->host_free, &host_buffer, 0);
+    }
+
+    if (!s_vhci_registered) {
+        // VHCI has no way to unregister, the callbacks discard packets while the bridge is stopped
+        ESP_GOTO_ON_ERROR(esp_vhci_host_register_callback(&s_vhci_callback), fail, TAG,
+                          "Unable to register VHCI callbacks");
+        s_vhci_registered = true;
+    }
+    __atomic_store_n(&s_bth, bth, __ATOMIC_SEQ_CST);
+    return ESP_OK;
+
+fail:
+    _bth_free(bth);
+    return ret;
+}
+
+esp_err_t tinyusb_bth_bridge_deinit(void)
+{
+    tinyusb_bth_t *bth = bth_get();
+    ESP_RETURN_ON_FALSE(bth, ESP_ERR_INVALID_STATE, TAG, "Bridge not started");
+
+    // Buffers are used by the TinyUSB task, which removes the bridge
+    usbd_defer_func(do_deinit, NULL, false);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(bth->deinit_done, pdMS_TO_TICKS(BTH_DEINIT_TIMEOUT_MS)) == pdTRUE,
+                        ESP_ERR_TIMEOUT, TAG, "TinyUSB task did not remove the bridge");
+    ESP_RETURN_ON_FALSE(bth->deinit_result == ESP_OK, bth->deinit_result, TAG, "Packet being sent to the USB host");
+    // A packet of the controller may still be copied into a buffer
+    while (__atomic_load_n(&s_vhci_busy, __ATOMIC_SEQ_CST)) {
+        vTaskDelay(1);
+    }
+    _bth_free(bth);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_bth_bridge_get_stats(tinyusb_bth_bridge_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_bth_t *bth = bth_get();
+    ESP_RETURN_ON_FALSE(bth, ESP_ERR_INVALID_STATE, TAG, "Bridge not started");
+
+    *stats = bth->stats;
+    stats->acl_credits = __atomic_load_n(&bth->acl_credits, __ATOMIC_ACQUIRE);
+    stats->acl_credits_max = __atomic_load_n(&bth->acl_credits_max, __ATOMIC_ACQUIRE);
+    stats->acl_waiting = uxQueueMessagesWaiting(bth->ctrl_acl);
+    return ESP_OK;
+}
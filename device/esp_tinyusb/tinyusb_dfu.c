@@ -0,0 +1,329 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_timer.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_dfu.h"
+
+static const char *TAG = "tusb_dfu";
+
+#define DFU_BUFFER_NUM CONFIG_TINYUSB_DFU_BUFFER_NUM
+#define DFU_BUFFER_SIZE CONFIG_TINYUSB_DFU_BUFSIZE
+// Poll timeout of the manifestation: esp_ota_end() verifies the whole image
+#define DFU_MANIFEST_POLL_TIMEOUT_MS 100
+
+typedef enum {
+    DFU_REQ_BLOCK = 0,      // Write the buffer to the partition
+    DFU_REQ_MANIFEST,       // Finish the image and set the boot partition
+    DFU_REQ_ABORT,          // Abort the download
+    DFU_REQ_STOP,           // Abort the download and delete the writer task
+} dfu_req_type_t;
+
+typedef struct {
+    uint8_t type;           // dfu_req_type_t
+    uint16_t block_num;
+    uint16_t length;
+    uint8_t *data;
+} dfu_request_t;
+
+typedef struct {
+    uint8_t *buffers[DFU_BUFFER_NUM];
+    uint32_t buffer_next;               // Buffer of the next DFU_DNLOAD block
+    uint32_t buffer_free;               // Number of free buffers, TinyUSB task only
+    bool block_pending;                 // Last block waits for a free buffer to be acknowledged, TinyUSB task only
+    QueueHandle_t queue;                // dfu_request_t to the writer task
+    TaskHandle_t writer_task;
+    SemaphoreHandle_t stopped;          // Given by the writer task on DFU_REQ_STOP
+    const esp_partition_t *partition;
+    esp_ota_handle_t ota_handle;
+    bool ota_started;                   // ota_handle is valid, writer task only
+    volatile esp_err_t error;           // First error of the download, written by the writer task
+    volatile uint32_t block_time_ms;    // Write time of the last block
+    tinyusb_dfu_complete_cb_t complete_cb;
+    void *user_arg;
+} tinyusb_dfu_t;
+
+static tinyusb_dfu_t *s_dfu;
+
+/* TinyUSB task side
+ ********************************************************************* */
+
+// Deferred by the writer task, a buffer was written
+static void _dfu_block_done(void *param)
+{
+    (void) param;
+    if (s_dfu == NULL) {
+        return;
+    }
+    s_dfu->buffer_free++;
+    if (s_dfu->block_pending) {
+        s_dfu->block_pending = false;
+        tud_dfu_finish_flashing(s_dfu->error == ESP_OK ? DFU_STATUS_OK : DFU_STATUS_ERR_WRITE);
+    }
+}
+
+// Deferred by the writer task, the image was finished
+static void _dfu_manifest_done(void *param)
+{
+    (void) param;
+    if (s_dfu == NULL) {
+        return;
+    }
+    tud_dfu_finish_flashing(s_dfu->error == ESP_OK ? DFU_STATUS_OK : DFU_STATUS_ERR_VERIFY);
+}
+
+static void _dfu_send_request(uint8_t type, uint16_t block_num, uint8_t *data, uint16_t length)
+{
+    const dfu_request_t req = {
+        .type = type,
+        .block_num = block_num,
+        .length = length,
+        .data = data,
+    };
+    // The queue has room for all buffers and the control requests, sending does not block
+    xQueueSend(s_dfu->queue, &req, 0);
+}
+
+uint32_t tud_dfu_get_timeout_cb(uint8_t alt, uint8_t state)
+{
+    (void) alt;
+    if (s_dfu == NULL) {
+        return 0;
+    }
+    const uint32_t block_time_ms = s_dfu->block_time_ms > 0 ? s_dfu->block_time_ms : 1;
+    switch (state) {
+    case DFU_DNBUSY:
+        // The block is acknowledged at once if another buffer stays free for the next one,
+        // otherwise the host should poll when the oldest queued block is written
+        return s_dfu->buffer_free > 1 ? 0 : block_time_ms;
+    case DFU_MANIFEST:
+        return (DFU_BUFFER_NUM - s_dfu->buffer_free) * block_time_ms + DFU_MANIFEST_POLL_TIMEOUT_MS;
+    default:
+        return 0;
+    }
+}
+
+void tud_dfu_download_cb(uint8_t alt, uint16_t block_num, uint8_t const *data, uint16_t length)
+{
+    (void) alt;
+    if (s_dfu == NULL) {
+        tud_dfu_finish_flashing(DFU_STATUS_ERR_TARGET);
+        return;
+    }
+    // Block 0 starts a new download, the writer task resets the error
+    if (block_num != 0 && s_dfu->error != ESP_OK) {
+        tud_dfu_finish_flashing(DFU_STATUS_ERR_WRITE);
+        return;
+    }
+    // The previous block was acknowledged only with a free buffer left
+    assert(s_dfu->buffer_free > 0);
+    uint8_t *buffer = s_dfu->buffers[s_dfu->buffer_next];
+    s_dfu->buffer_next = (s_dfu->buffer_next + 1) % DFU_BUFFER_NUM;
+    s_dfu->buffer_free--;
+    memcpy(buffer, data, length);
+    _dfu_send_request(DFU_REQ_BLOCK, block_num, buffer, length);
+
+    if (s_dfu->buffer_free > 0) {
+        tud_dfu_finish_flashing(DFU_STATUS_OK);
+    } else {
+        s_dfu->block_pending = true;
+    }
+}
+
+void tud_dfu_manifest_cb(uint8_t alt)
+{
+    (void) alt;
+    if (s_dfu == NULL) {
+        tud_dfu_finish_flashing(DFU_STATUS_ERR_TARGET);
+        return;
+    }
+    _dfu_send_request(DFU_REQ_MANIFEST, 0, NULL, 0);
+}
+
+void tud_dfu_abort_cb(uint8_t alt)
+{
+    (void) alt;
+    if (s_dfu == NULL) {
+        return;
+    }
+    s_dfu->block_pending = false;
+    _dfu_send_request(DFU_REQ_ABORT, 0, NULL, 0);
+}
+
+/* Writer task side
+ ********************************************************************* */
+
+static void _dfu_ota_abort(void)
+{
+    if (s_dfu->ota_started) {
+        esp_ota_abort(s_dfu->ota_handle);
+        s_dfu->ota_started = false;
+    }
+}
+
+static void _dfu_write_block(const dfu_request_t *req)
+{
+    esp_err_t ret = ESP_OK;
+    if (req->block_num == 0) {
+        // New download, drop the unfinished one
+        _dfu_ota_abort();
+        s_dfu->error = ESP_OK;
+        // Sectors are erased by esp_ota_write() as the image grows, instead of erasing the whole partition here
+        ESP_GOTO_ON_ERROR(esp_ota_begin(s_dfu->partition, OTA_WITH_SEQUENTIAL_WRITES, &s_dfu->ota_handle), fail, TAG,
+                          "OTA begin failed");
+        s_dfu->ota_started = true;
+    }
+    if (s_dfu->error != ESP_OK || !s_dfu->ota_started) {
+        // Download failed or was aborted, skip the rest of its blocks
+        return;
+    }
+
+    const int64_t start = esp_timer_get_time();
+    ESP_GOTO_ON_ERROR(esp_ota_write(s_dfu->ota_handle, req->data, req->length), fail, TAG,
+                      "OTA write of block %u failed", req->block_num);
+    s_dfu->block_time_ms = (uint32_t)((esp_timer_get_time() - start + 999) / 1000);
+    return;
+
+fail:
+    s_dfu->error = ret;
+}
+
+static void _dfu_manifest(void)
+{
+    esp_err_t ret = s_dfu->error;
+    if (ret == ESP_OK && !s_dfu->ota_started) {
+        ret = ESP_ERR_INVALID_STATE;
+    }
+    if (ret == ESP_OK) {
+        s_dfu->ota_started = false;
+        ret = esp_ota_end(s_dfu->ota_handle);
+        if (ret == ESP_OK) {
+            ret = esp_ota_set_boot_partition(s_dfu->partition);
+        }
+    }
+    _dfu_ota_abort();
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Image written to partition %s", s_dfu->partition->label);
+    } else {
+        ESP_LOGE(TAG, "Manifestation failed: %s", esp_err_to_name(ret));
+    }
+    s_dfu->error = ret;
+    usbd_defer_func(_dfu_manifest_done, NULL, false);
+    if (s_dfu->complete_cb) {
+        s_dfu->complete_cb(ret, s_dfu->user_arg);
+    }
+}
+
+static void _dfu_writer_task(void *arg)
+{
+    (void) arg;
+    dfu_request_t req;
+    while (true) {
+        xQueueReceive(s_dfu->queue, &req, portMAX_DELAY);
+        switch (req.type) {
+        case DFU_REQ_BLOCK:
+            _dfu_write_block(&req);
+            usbd_defer_func(_dfu_block_done, NULL, false);
+            break;
+        case DFU_REQ_MANIFEST:
+            _dfu_manifest();
+            break;
+        case DFU_REQ_ABORT:
+            _dfu_ota_abort();
+            s_dfu->error = ESP_OK;
+            break;
+        case DFU_REQ_STOP:
+            _dfu_ota_abort();
+            xSemaphoreGive(s_dfu->stopped);
+            vTaskDelete(NULL);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+/* Public API
+ ********************************************************************* */
+
+static void _dfu_free(tinyusb_dfu_t *dfu)
+{
+    for (int i = 0; i < DFU_BUFFER_NUM; i++) {
+        free(dfu->buffers[i]);
+    }
+    if (dfu->queue) {
+        vQueueDelete(dfu->queue);
+    }
+    if (dfu->stopped) {
+        vSemaphoreDelete(dfu->stopped);
+    }
+    free(dfu);
+}
+
+esp_err_t tinyusb_dfu_init(const tinyusb_dfu_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(s_dfu == NULL, ESP_ERR_INVALID_STATE, TAG, "DFU already initialized");
+
+    tinyusb_dfu_t *dfu = calloc(1, sizeof(tinyusb_dfu_t));
+    ESP_RETURN_ON_FALSE(dfu, ESP_ERR_NO_MEM, TAG, "No memory for DFU");
+    if (config) {
+        dfu->partition = config->partition;
+        dfu->complete_cb = config->complete_cb;
+        dfu->user_arg = config->user_arg;
+    }
+    if (dfu->partition == NULL) {
+        dfu->partition = esp_ota_get_next_update_partition(NULL);
+    }
+    ESP_GOTO_ON_FALSE(dfu->partition, ESP_ERR_NOT_FOUND, fail, TAG, "No OTA partition to update");
+
+    for (int i = 0; i < DFU_BUFFER_NUM; i++) {
+        dfu->buffers[i] = malloc(DFU_BUFFER_SIZE);
+        ESP_GOTO_ON_FALSE(dfu->buffers[i], ESP_ERR_NO_MEM, fail, TAG, "No memory for DFU buffers");
+    }
+    dfu->buffer_free = DFU_BUFFER_NUM;
+    dfu->queue = xQueueCreate(DFU_BUFFER_NUM + 3, sizeof(dfu_request_t));
+    dfu->stopped = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(dfu->queue && dfu->stopped, ESP_ERR_NO_MEM, fail, TAG, "No memory for DFU queue");
+
+    s_dfu = dfu;
+    if (xTaskCreate(_dfu_writer_task, "TinyUSB DFU", CONFIG_TINYUSB_DFU_WRITER_TASK_STACK_SIZE, NULL,
+                    CONFIG_TINYUSB_DFU_WRITER_TASK_PRIORITY, &dfu->writer_task) != pdPASS) {
+        ESP_LOGE(TAG, "No memory for DFU writer task");
+        s_dfu = NULL;
+        ret = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+    ESP_LOGI(TAG, "DFU updates partition %s", dfu->partition->label);
+    return ESP_OK;
+
+fail:
+    _dfu_free(dfu);
+    return ret;
+}
+
+esp_err_t tinyusb_dfu_deinit(void)
+{
+    ESP_RETURN_ON_FALSE(s_dfu, ESP_ERR_INVALID_STATE, TAG, "DFU not initialized");
+    tinyusb_dfu_t *dfu = s_dfu;
+    _dfu_send_request(DFU_REQ_STOP, 0, NULL, 0);
+    xSemaphoreTake(dfu->stopped, portMAX_DELAY);
+    s_dfu = NULL;
+    _dfu_free(dfu);
+    return ESP_OK;
+}
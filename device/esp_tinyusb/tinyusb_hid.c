@@ -0,0 +1,234 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_hid.h"
+
+static const char *TAG = "tusb_hid";
+
+#define HID_ITF_NUM                 CFG_TUD_HID
+#define HID_QUEUE_SIZE              CONFIG_TINYUSB_HID_REPORT_QUEUE_SIZE
+#define HID_REPORT_SIZE_MAX         CFG_TUD_HID_EP_BUFSIZE
+#define HID_MOUSE_DELTA_MAX         127     // Logical range of TUD_HID_REPORT_DESC_MOUSE()
+#define HID_DEINIT_TIMEOUT_MS       1000
+
+typedef struct {
+    uint8_t report_id;
+    bool mouse;                         // Data is a hid_mouse_report_t, motion can be merged
+    uint16_t len;
+    uint8_t data[HID_REPORT_SIZE_MAX];
+} hid_report_item_t;
+
+typedef struct {
+    portMUX_TYPE lock;                  // Protects the ring of reports and sending
+    hid_report_item_t items[HID_QUEUE_SIZE];
+    uint8_t head;
+    uint8_t count;
+    bool sending;                       // Head report is being passed to the endpoint, it must not be merged into
+    SemaphoreHandle_t deinit_done;
+} tinyusb_hid_t;
+
+static tinyusb_hid_t *s_hid[HID_ITF_NUM];
+
+/* TinyUSB task side
+ ********************************************************************* */
+
+static void report_drain(void *param)
+{
+    const uint8_t instance = (uint8_t)(uintptr_t)param;
+    tinyusb_hid_t *hid = s_hid[instance];
+    if (hid == NULL || !tud_hid_n_ready(instance)) {
+        return;  // Continued from tud_hid_report_complete_cb() or the next queued report
+    }
+
+    hid_report_item_t item;
+    taskENTER_CRITICAL(&hid->lock);
+    const bool pending = hid->count > 0;
+    if (pending) {
+        item = hid->items[hid->head];
+        hid->sending = true;
+    }
+    taskEXIT_CRITICAL(&hid->lock);
+    if (!pending) {
+        return;
+    }
+
+    // The report is copied into the endpoint buffer, a failed report stays at the head of the queue
+    const bool sent = tud_hid_n_report(instance, item.report_id, item.data, item.len);
+    taskENTER_CRITICAL(&hid->lock);
+    if (sent) {
+        hid->head = (hid->head + 1) % HID_QUEUE_SIZE;
+        hid->count--;
+    }
+    hid->sending = false;
+    taskEXIT_CRITICAL(&hid->lock);
+}
+
+static void do_deinit(void *param)
+{
+    const uint8_t instance = (uint8_t)(uintptr_t)param;
+    tinyusb_hid_t *hid = s_hid[instance];
+    if (hid == NULL) {
+        return;
+    }
+    s_hid[instance] = NULL;
+    xSemaphoreGive(hid->deinit_done);
+}
+
+void tud_hid_report_complete_cb(uint8_t instance, uint8_t const *report, uint16_t len)
+{
+    (void) report;
+    (void) len;
+    report_drain((void *)(uintptr_t)instance);
+}
+
+/* Public API
+ ********************************************************************* */
+
+static void _hid_free(tinyusb_hid_t *hid)
+{
+    if (hid->deinit_done) {
+        vSemaphoreDelete(hid->deinit_done);
+    }
+    free(hid);
+}
+
+esp_err_t tinyusb_hid_init(uint8_t instance)
+{
+    ESP_RETURN_ON_FALSE(instance < HID_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(s_hid[instance] == NULL, ESP_ERR_INVALID_STATE, TAG, "Interface already initialized");
+
+    tinyusb_hid_t *hid = calloc(1, sizeof(tinyusb_hid_t));
+    ESP_RETURN_ON_FALSE(hid, ESP_ERR_NO_MEM, TAG, "No memory for HID report queue");
+    portMUX_INITIALIZE(&hid->lock);
+    hid->deinit_done = xSemaphoreCreateBinary();
+    if (hid->deinit_done == NULL) {
+        _hid_free(hid);
+        ESP_LOGE(TAG, "No memory for HID report queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_hid[instance] = hid;
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_hid_deinit(uint8_t instance)
+{
+    ESP_RETURN_ON_FALSE(instance < HID_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_hid_t *hid = s_hid[instance];
+    ESP_RETURN_ON_FALSE(hid, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    // The TinyUSB task may be passing the head report to the endpoint
+    usbd_defer_func(do_deinit, (void *)(uintptr_t)instance, false);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(hid->deinit_done, pdMS_TO_TICKS(HID_DEINIT_TIMEOUT_MS)) == pdTRUE,
+                        ESP_ERR_TIMEOUT, TAG, "TinyUSB task did not remove the interface");
+    _hid_free(hid);
+    return ESP_OK;
+}
+
+// Must be called in the critical section, the free slot is at the tail of the ring
+static hid_report_item_t *_queue_push(tinyusb_hid_t *hid)
+{
+    if (hid->count == HID_QUEUE_SIZE) {
+        return NULL;
+    }
+    hid_report_item_t *item = &hid->items[(hid->head + hid->count) % HID_QUEUE_SIZE];
+    hid->count++;
+    return item;
+}
+
+esp_err_t tinyusb_hid_report(uint8_t instance, uint8_t report_id, const void *report, uint16_t len)
+{
+    // TinyUSB prepends a non-zero report ID to the report in the endpoint buffer
+    const uint16_t len_max = report_id ? HID_REPORT_SIZE_MAX - 1 : HID_REPORT_SIZE_MAX;
+    ESP_RETURN_ON_FALSE(instance < HID_ITF_NUM && report && len && len <= len_max, ESP_ERR_INVALID_ARG, TAG,
+                        "Invalid argument");
+    tinyusb_hid_t *hid = s_hid[instance];
+    ESP_RETURN_ON_FALSE(hid, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    taskENTER_CRITICAL(&hid->lock);
+    hid_report_item_t *item = _queue_push(hid);
+    if (item) {
+        item->report_id = report_id;
+        item->mouse = false;
+        item->len = len;
+        memcpy(item->data, report, len);
+    }
+    taskEXIT_CRITICAL(&hid->lock);
+    if (item == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    usbd_defer_func(report_drain, (void *)(uintptr_t)instance, false);
+    return ESP_OK;
+}
+
+static bool _mouse_merge(hid_mouse_report_t *pending, const hid_mouse_report_t *motion)
+{
+    const int x = pending->x + motion->x;
+    const int y = pending->y + motion->y;
+    const int wheel = pending->wheel + motion->wheel;
+    const int pan = pending->pan + motion->pan;
+    if (abs(x) > HID_MOUSE_DELTA_MAX || abs(y) > HID_MOUSE_DELTA_MAX ||
+            abs(wheel) > HID_MOUSE_DELTA_MAX || abs(pan) > HID_MOUSE_DELTA_MAX) {
+        return false;
+    }
+    pending->x = (int8_t)x;
+    pending->y = (int8_t)y;
+    pending->wheel = (int8_t)wheel;
+    pending->pan = (int8_t)pan;
+    return true;
+}
+
+esp_err_t tinyusb_hid_mouse_report(uint8_t instance, uint8_t report_id, uint8_t buttons,
+                                   int8_t x, int8_t y, int8_t vertical, int8_t horizontal)
+{
+    ESP_RETURN_ON_FALSE(instance < HID_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_hid_t *hid = s_hid[instance];
+    ESP_RETURN_ON_FALSE(hid, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    const hid_mouse_report_t motion = {
+        .buttons = buttons,
+        .x = x,
+        .y = y,
+        .wheel = vertical,
+        .pan = horizontal,
+    };
+    bool queued = false;
+    taskENTER_CRITICAL(&hid->lock);
+    // The tail is the head when only one report is queued, which must not change while it is being sent
+    if (hid->count > (hid->sending ? 1 : 0)) {
+        hid_report_item_t *tail = &hid->items[(hid->head + hid->count - 1) % HID_QUEUE_SIZE];
+        hid_mouse_report_t *pending = (hid_mouse_report_t *)tail->data;
+        if (tail->mouse && tail->report_id == report_id && pending->buttons == buttons) {
+            queued = _mouse_merge(pending, &motion);
+        }
+    }
+    if (!queued) {
+        hid_report_item_t *item = _queue_push(hid);
+        if (item) {
+            item->report_id = report_id;
+            item->mouse = true;
+            item->len = sizeof(hid_mouse_report_t);
+            memcpy(item->data, &motion, sizeof(hid_mouse_report_t));
+            queued = true;
+        }
+    }
+    taskEXIT_CRITICAL(&hid->lock);
+    if (!queued) {
+        return ESP_ERR_NO_MEM;
+    }
+    usbd_defer_func(report_drain, (void *)(uintptr_t)instance, false);
+    return ESP_OK;
+}
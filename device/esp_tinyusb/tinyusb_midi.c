@@ -0,0 +1,319 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_midi.h"
+
+static const char *TAG = "tusb_midi";
+
+#define MIDI_ITF_NUM                CFG_TUD_MIDI
+#define MIDI_PACKET_SIZE            4
+#define MIDI_TX_QUEUE_SIZE          CONFIG_TINYUSB_MIDI_TX_QUEUE_SIZE
+#define MIDI_RX_QUEUE_SIZE          CONFIG_TINYUSB_MIDI_RX_QUEUE_SIZE
+#define MIDI_TX_BATCH_PACKETS       (CFG_TUD_MIDI_EP_BUFSIZE / MIDI_PACKET_SIZE)  // Packets of a full transfer
+#define MIDI_TX_FIFO_PACKETS        (CFG_TUD_MIDI_TX_BUFSIZE / MIDI_PACKET_SIZE)
+#define MIDI_LATENCY_US             CONFIG_TINYUSB_MIDI_LATENCY_US
+#define MIDI_RETRY_US               125     // One microframe, while the TX FIFO is full with latency 0
+#define MIDI_DEINIT_TIMEOUT_MS      1000
+
+// Code index numbers of system exclusive messages
+#define MIDI_CIN_SYSEX_START        0x4
+#define MIDI_CIN_SYSEX_END_1BYTE    0x5
+#define MIDI_CIN_SYSEX_END_2BYTE    0x6
+#define MIDI_CIN_SYSEX_END_3BYTE    0x7
+
+typedef struct {
+    uint8_t itf;
+    uint8_t ep_in;
+    tinyusb_midi_rx_cb_t rx_cb;
+    void *user_arg;
+    portMUX_TYPE tx_lock;               // Protects the TX ring, written by any task
+    uint8_t (*tx_ring)[MIDI_PACKET_SIZE];
+    uint16_t tx_head;
+    uint16_t tx_count;
+    esp_timer_handle_t tx_timer;        // Latency timer of queued packets
+    tinyusb_midi_event_t *rx_ring;      // Single producer, the TinyUSB task, single consumer, the reader
+    uint32_t rx_head;                   // Written by the TinyUSB task, atomic access
+    uint32_t rx_tail;                   // Written by the reader, atomic access
+    SemaphoreHandle_t deinit_done;
+} tinyusb_midi_t;
+
+static tinyusb_midi_t *s_midi[MIDI_ITF_NUM];
+
+/* TinyUSB task side
+ ********************************************************************* */
+
+static bool _tx_peek(tinyusb_midi_t *midi, uint8_t packet[MIDI_PACKET_SIZE], uint16_t *count)
+{
+    taskENTER_CRITICAL(&midi->tx_lock);
+    *count = midi->tx_count;
+    if (*count) {
+        memcpy(packet, midi->tx_ring[midi->tx_head], MIDI_PACKET_SIZE);
+    }
+    taskEXIT_CRITICAL(&midi->tx_lock);
+    return *count > 0;
+}
+
+static void _tx_pop(tinyusb_midi_t *midi)
+{
+    taskENTER_CRITICAL(&midi->tx_lock);
+    midi->tx_head = (midi->tx_head + 1) % MIDI_TX_QUEUE_SIZE;
+    midi->tx_count--;
+    taskEXIT_CRITICAL(&midi->tx_lock);
+}
+
+static void tx_flush(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    tinyusb_midi_t *midi = s_midi[itf];
+    if (midi == NULL || !tud_midi_n_mounted(itf)) {
+        return;  // Queued packets wait for the host
+    }
+
+    // TinyUSB starts a transfer on every packet written to an idle endpoint. The idle endpoint is claimed,
+    // so the packets collect in its FIFO, which is empty while idle, until the last one is written
+    // after the release and starts a single transfer with all of them.
+    bool claimed = usbd_edpt_claim(TUD_OPT_RHPORT, midi->ep_in);
+    size_t written = 0;
+    uint8_t packet[MIDI_PACKET_SIZE];
+    uint16_t count;
+    while (_tx_peek(midi, packet, &count)) {
+        if (claimed && (count == 1 || written + 1 == MIDI_TX_FIFO_PACKETS)) {
+            usbd_edpt_release(TUD_OPT_RHPORT, midi->ep_in);
+            claimed = false;
+        }
+        if (!tud_midi_n_packet_write(itf, packet)) {
+            break;  // FIFO full, it is sent by TinyUSB on the end of the running transfer
+        }
+        _tx_pop(midi);
+        written++;
+    }
+    if (claimed) {
+        usbd_edpt_release(TUD_OPT_RHPORT, midi->ep_in);
+    }
+    if (count > 0 && !esp_timer_is_active(midi->tx_timer)) {
+        esp_timer_start_once(midi->tx_timer, MIDI_LATENCY_US ? MIDI_LATENCY_US : MIDI_RETRY_US);
+    }
+}
+
+static void rx_drain(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    tinyusb_midi_t *midi = s_midi[itf];
+    if (midi == NULL) {
+        return;
+    }
+    const int64_t now = esp_timer_get_time();
+    uint32_t head = __atomic_load_n(&midi->rx_head, __ATOMIC_RELAXED);
+    bool received = false;
+    while (true) {
+        const uint32_t next = (head + 1) % MIDI_RX_QUEUE_SIZE;
+        if (next == __atomic_load_n(&midi->rx_tail, __ATOMIC_ACQUIRE)) {
+            break;  // Queue full, packets stay in the FIFO, continued from tinyusb_midi_read()
+        }
+        tinyusb_midi_event_t *event = &midi->rx_ring[head];
+        if (!tud_midi_n_packet_read(itf, event->packet)) {
+            break;
+        }
+        event->timestamp_us = now;
+        head = next;
+        __atomic_store_n(&midi->rx_head, head, __ATOMIC_RELEASE);
+        received = true;
+    }
+    if (received && midi->rx_cb) {
+        midi->rx_cb(itf, midi->user_arg);
+    }
+}
+
+static void do_deinit(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    tinyusb_midi_t *midi = s_midi[itf];
+    if (midi == NULL) {
+        return;
+    }
+    s_midi[itf] = NULL;
+    xSemaphoreGive(midi->deinit_done);
+}
+
+void tud_midi_rx_cb(uint8_t itf)
+{
+    rx_drain((void *)(uintptr_t)itf);
+}
+
+static void tx_timer_cb(void *arg)
+{
+    usbd_defer_func(tx_flush, arg, false);
+}
+
+/* Public API
+ ********************************************************************* */
+
+static void _midi_free(tinyusb_midi_t *midi)
+{
+    if (midi->tx_timer) {
+        esp_timer_delete(midi->tx_timer);
+    }
+    if (midi->deinit_done) {
+        vSemaphoreDelete(midi->deinit_done);
+    }
+    free(midi->tx_ring);
+    free(midi->rx_ring);
+    free(midi);
+}
+
+esp_err_t tinyusb_midi_init(const tinyusb_config_midi_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && config->itf < MIDI_ITF_NUM && tu_edpt_dir(config->ep_in) == TUSB_DIR_IN,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(s_midi[config->itf] == NULL, ESP_ERR_INVALID_STATE, TAG, "Interface already initialized");
+
+    tinyusb_midi_t *midi = calloc(1, sizeof(tinyusb_midi_t));
+    ESP_RETURN_ON_FALSE(midi, ESP_ERR_NO_MEM, TAG, "No memory for MIDI interface");
+    midi->itf = config->itf;
+    midi->ep_in = config->ep_in;
+    midi->rx_cb = config->rx_cb;
+    midi->user_arg = config->user_arg;
+    portMUX_INITIALIZE(&midi->tx_lock);
+
+    midi->tx_ring = malloc(MIDI_TX_QUEUE_SIZE * MIDI_PACKET_SIZE);
+    midi->rx_ring = malloc(MIDI_RX_QUEUE_SIZE * sizeof(tinyusb_midi_event_t));
+    midi->deinit_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(midi->tx_ring && midi->rx_ring && midi->deinit_done, ESP_ERR_NO_MEM, fail, TAG,
+                      "No memory for MIDI queues");
+    const esp_timer_create_args_t timer_args = {
+        .callback = tx_timer_cb,
+        .arg = (void *)(uintptr_t)config->itf,
+        .name = "tusb_midi_tx",
+    };
+    ESP_GOTO_ON_ERROR(esp_timer_create(&timer_args, &midi->tx_timer), fail, TAG, "Failed to create TX latency timer");
+
+    s_midi[config->itf] = midi;
+    // Packets may be waiting in the FIFO since enumeration
+    usbd_defer_func(rx_drain, (void *)(uintptr_t)config->itf, false);
+    return ESP_OK;
+
+fail:
+    _midi_free(midi);
+    return ret;
+}
+
+esp_err_t tinyusb_midi_deinit(uint8_t itf)
+{
+    ESP_RETURN_ON_FALSE(itf < MIDI_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_midi_t *midi = s_midi[itf];
+    ESP_RETURN_ON_FALSE(midi, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    esp_timer_stop(midi->tx_timer);
+    // A flush deferred before may still be running in the TinyUSB task
+    usbd_defer_func(do_deinit, (void *)(uintptr_t)itf, false);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(midi->deinit_done, pdMS_TO_TICKS(MIDI_DEINIT_TIMEOUT_MS)) == pdTRUE,
+                        ESP_ERR_TIMEOUT, TAG, "TinyUSB task did not remove the interface");
+    _midi_free(midi);
+    return ESP_OK;
+}
+
+// Must be called in the critical section with space for the packet
+static void _tx_push(tinyusb_midi_t *midi, uint8_t header, const uint8_t *data, size_t len)
+{
+    uint8_t *packet = midi->tx_ring[(midi->tx_head + midi->tx_count) % MIDI_TX_QUEUE_SIZE];
+    packet[0] = header;
+    memset(&packet[1], 0, MIDI_PACKET_SIZE - 1);
+    memcpy(&packet[1], data, len);
+    midi->tx_count++;
+}
+
+static void _tx_schedule(tinyusb_midi_t *midi, uint16_t count)
+{
+    if (MIDI_LATENCY_US == 0 || count >= MIDI_TX_BATCH_PACKETS) {
+        usbd_defer_func(tx_flush, (void *)(uintptr_t)midi->itf, false);
+    } else if (!esp_timer_is_active(midi->tx_timer)) {
+        // Fails harmlessly if started by another task in the meantime
+        esp_timer_start_once(midi->tx_timer, MIDI_LATENCY_US);
+    }
+}
+
+esp_err_t tinyusb_midi_write_packets(uint8_t itf, const uint8_t *packets, size_t count)
+{
+    ESP_RETURN_ON_FALSE(itf < MIDI_ITF_NUM && packets && count, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_midi_t *midi = s_midi[itf];
+    ESP_RETURN_ON_FALSE(midi, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    taskENTER_CRITICAL(&midi->tx_lock);
+    const bool fits = midi->tx_count + count <= MIDI_TX_QUEUE_SIZE;
+    if (fits) {
+        for (size_t i = 0; i < count; i++) {
+            const uint8_t *packet = &packets[i * MIDI_PACKET_SIZE];
+            _tx_push(midi, packet[0], &packet[1], MIDI_PACKET_SIZE - 1);
+        }
+    }
+    const uint16_t queued = midi->tx_count;
+    taskEXIT_CRITICAL(&midi->tx_lock);
+    if (!fits) {
+        return ESP_ERR_NO_MEM;
+    }
+    _tx_schedule(midi, queued);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_midi_write_sysex(uint8_t itf, uint8_t cable, const uint8_t *sysex, size_t len)
+{
+    ESP_RETURN_ON_FALSE(itf < MIDI_ITF_NUM && cable < 16 && sysex && len >= 2 &&
+                        sysex[0] == 0xF0 && sysex[len - 1] == 0xF7, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_midi_t *midi = s_midi[itf];
+    ESP_RETURN_ON_FALSE(midi, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    const size_t count = (len + 2) / 3;
+    taskENTER_CRITICAL(&midi->tx_lock);
+    const bool fits = midi->tx_count + count <= MIDI_TX_QUEUE_SIZE;
+    if (fits) {
+        for (size_t offset = 0; offset < len; offset += 3) {
+            const size_t chunk = MIN(len - offset, 3);
+            // Packets of 3 bytes continue the message, the last packet ends it with 1 to 3 bytes
+            const uint8_t cin = (offset + chunk < len) ? MIDI_CIN_SYSEX_START : MIDI_CIN_SYSEX_END_1BYTE + chunk - 1;
+            _tx_push(midi, (uint8_t)((cable << 4) | cin), &sysex[offset], chunk);
+        }
+    }
+    const uint16_t queued = midi->tx_count;
+    taskEXIT_CRITICAL(&midi->tx_lock);
+    if (!fits) {
+        return ESP_ERR_NO_MEM;
+    }
+    _tx_schedule(midi, queued);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_midi_read(uint8_t itf, tinyusb_midi_event_t *event)
+{
+    ESP_RETURN_ON_FALSE(itf < MIDI_ITF_NUM && event, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_midi_t *midi = s_midi[itf];
+    ESP_RETURN_ON_FALSE(midi, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    const uint32_t tail = __atomic_load_n(&midi->rx_tail, __ATOMIC_RELAXED);
+    const uint32_t head = __atomic_load_n(&midi->rx_head, __ATOMIC_ACQUIRE);
+    if (tail == head) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *event = midi->rx_ring[tail];
+    __atomic_store_n(&midi->rx_tail, (tail + 1) % MIDI_RX_QUEUE_SIZE, __ATOMIC_RELEASE);
+    if ((head + 1) % MIDI_RX_QUEUE_SIZE == tail) {
+        // The queue was full, packets may be waiting in the FIFO
+        usbd_defer_func(rx_drain, (void *)(uintptr_t)itf, false);
+    }
+    return ESP_OK;
+}
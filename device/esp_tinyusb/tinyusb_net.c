@@ -4,66 +4,183 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include "freertos/FreeRTOS.h"
-#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "tinyusb_net.h"
 #include "descriptors_control.h"
 #include "usb_descriptors.h"
 #include "device/usbd_pvt.h"
 #include "esp_check.h"
+#include "esp_timer.h"
+#include "stats.h"
 
 #define MAC_ADDR_LEN 6
+#define TX_PACKET_POOL_SIZE CONFIG_TINYUSB_NET_TX_PACKET_POOL_SIZE
+#define TX_RETRY_PERIOD_US 1000
+
+typedef enum {
+    PACKET_ASYNC = 0,
+    PACKET_SYNC_PENDING,    // Waiting for the TinyUSB task
+    PACKET_SYNC_SENDING,    // Taken by the TinyUSB task, the sender must wait for done
+    PACKET_SYNC_CANCELLED,  // Sender timed out, the TinyUSB task frees the packet
+} packet_state_t;
 
 typedef struct packet {
     void *buffer;
     void *buff_free_arg;
     uint16_t len;
     esp_err_t result;
+    uint8_t state;              // packet_state_t, sync packets only
+    struct packet *next;        // Next packet of the synchronous batch
+    SemaphoreHandle_t done;     // Given when the synchronous packet was processed
+    StaticSemaphore_t done_buf;
 } packet_t;
 
 struct tinyusb_net_handle {
     bool initialized;
-    SemaphoreHandle_t buffer_sema;
-    EventGroupHandle_t  tx_flags;
     tusb_net_rx_cb_t    rx_cb;
     tusb_net_free_tx_cb_t tx_buff_free_cb;
     tusb_net_init_cb_t init_cb;
     char mac_str[2 * MAC_ADDR_LEN + 1];
     void *ctx;
-    packet_t *packet_to_send;
+    bool rx_zero_copy;
+    void *rx_held;          // Received buffer not released by the user in zero copy mode
+    esp_timer_handle_t tx_retry_timer;
+    // Queue of asynchronous packets waiting for free NTB, accessed only from the TinyUSB task
+    packet_t *tx_queue[TX_PACKET_POOL_SIZE];
+    uint8_t tx_queue_head;
+    uint8_t tx_queue_count;
 };
 
-const static int TX_FINISHED_BIT = BIT0;
 static struct tinyusb_net_handle s_net_obj = { };
 static const char *TAG = "tusb_net";
 
-static void do_send_sync(void *ctx)
+// Packets of send requests, a set bit of s_packet_free marks a free packet
+static packet_t s_packet_pool[TX_PACKET_POOL_SIZE];
+static uint32_t s_packet_free = (uint32_t)((1ULL << TX_PACKET_POOL_SIZE) - 1);
+
+/**
+ * @brief Take a free packet from the pool, lock-free
+ *
+ * @return Packet, or NULL if all packets are queued
+ */
+static packet_t *packet_alloc(void)
+{
+    uint32_t free_mask = __atomic_load_n(&s_packet_free, __ATOMIC_RELAXED);
+    while (free_mask) {
+        const uint32_t bit = free_mask & (~free_mask + 1); // lowest free packet
+        if (__atomic_compare_exchange_n(&s_packet_free, &free_mask, free_mask & ~bit, true,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return &s_packet_pool[__builtin_ctz(bit)];
+        }
+        // free_mask was updated by the failed exchange, try again
+    }
+    return NULL;
+}
+
+static void packet_free(packet_t *packet)
+{
+    __atomic_fetch_or(&s_packet_free, 1U << (packet - s_packet_pool), __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Pass queued packets to TinyUSB while it accepts them
+ *
+ * Runs in the TinyUSB task. The packets are passed back to back, so that NCM aggregates them
+ * into one NTB, up to CONFIG_TINYUSB_NCM_IN_NTB_BUFF_MAX_SIZE. If some packets are left,
+ * the queue is retried after TX_RETRY_PERIOD_US, when an NTB could be free again.
+ */
+static void tx_queue_drain(void *ctx)
 {
     (void) ctx;
-    if (xSemaphoreTake(s_net_obj.buffer_sema, 0) != pdTRUE || s_net_obj.packet_to_send == NULL) {
-        return;
+    const bool ready = tud_ready();
+    while (s_net_obj.tx_queue_count) {
+        packet_t *packet = s_net_obj.tx_queue[s_net_obj.tx_queue_head];
+        if (ready) {
+            if (!tud_network_can_xmit(packet->len)) {
+                TINYUSB_STATS_INC(net.tx_busy);
+                break;
+            }
+            tud_network_xmit(packet, packet->len);
+        } else if (s_net_obj.tx_buff_free_cb) {
+            // Disconnected, packets would never be sent
+            TINYUSB_STATS_INC(net.tx_dropped);
+            s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
+        }
+        s_net_obj.tx_queue_head = (s_net_obj.tx_queue_head + 1) % TX_PACKET_POOL_SIZE;
+        s_net_obj.tx_queue_count--;
+        packet_free(packet);
     }
+    if (s_net_obj.tx_queue_count && !esp_timer_is_active(s_net_obj.tx_retry_timer)) {
+        esp_timer_start_once(s_net_obj.tx_retry_timer, TX_RETRY_PERIOD_US);
+    }
+}
+
+static void tx_retry_timer_cb(void *arg)
+{
+    (void) arg;
+    usbd_defer_func(tx_queue_drain, NULL, false);
+}
 
-    packet_t *packet = s_net_obj.packet_to_send;
-    if (tud_network_can_xmit(packet->len)) {
-        tud_network_xmit(packet, packet->len);
-        packet->result = ESP_OK;
-    } else {
-        packet->result = ESP_FAIL;
+static void do_send_sync(void *ctx)
+{
+    TINYUSB_STATS_TIME_START(start);
+    tx_queue_drain(NULL);   // keep the order of packets sent before
+    bool accepted = true;
+    packet_t *next;
+    for (packet_t *packet = ctx; packet; packet = next) {
+        next = packet->next;    // the sender may reuse the packet once it is done
+        uint8_t state = PACKET_SYNC_PENDING;
+        if (!__atomic_compare_exchange_n(&packet->state, &state, PACKET_SYNC_SENDING, false,
+                                         __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            packet_free(packet);    // cancelled by the sender
+            accepted = false;       // the rest would be sent out of order
+            continue;
+        }
+        // Stop at the first rejected packet, so that the frames are sent in order
+        accepted = accepted && tud_network_can_xmit(packet->len);
+        if (accepted) {
+            tud_network_xmit(packet, packet->len);
+            packet->result = ESP_OK;
+        } else {
+            packet->result = ESP_FAIL;
+        }
+        xSemaphoreGive(packet->done);
     }
-    xSemaphoreGive(s_net_obj.buffer_sema);
-    xEventGroupSetBits(s_net_obj.tx_flags, TX_FINISHED_BIT);
+    TINYUSB_STATS_SERVICE_END(net, start);
+}
+
+/**
+ * @brief Wait for the synchronous packet, or cancel it on timeout
+ *
+ * @return Result of the packet, ESP_ERR_TIMEOUT if it was cancelled
+ */
+static esp_err_t packet_wait_sync(packet_t *packet, TickType_t timeout)
+{
+    if (xSemaphoreTake(packet->done, timeout) != pdTRUE) {
+        uint8_t state = PACKET_SYNC_PENDING;
+        if (__atomic_compare_exchange_n(&packet->state, &state, PACKET_SYNC_CANCELLED, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return ESP_ERR_TIMEOUT;     // the TinyUSB task frees the packet
+        }
+        // Sending already started, must wait before ditching the packet
+        xSemaphoreTake(packet->done, portMAX_DELAY);
+    }
+    const esp_err_t result = packet->result;
+    packet_free(packet);
+    return result;
 }
 
 static void do_send_async(void *ctx)
 {
+    TINYUSB_STATS_TIME_START(start);
     packet_t *packet = ctx;
-    if (tud_network_can_xmit(packet->len)) {
-        tud_network_xmit(packet, packet->len);
-    } else if (s_net_obj.tx_buff_free_cb) {
-        ESP_LOGW(TAG, "Packet cannot be accepted on USB interface, dropping");
-        s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
-    }
-    free(packet);
+    // Every packet of the pool fits into the queue
+    const uint8_t tail = (s_net_obj.tx_queue_head + s_net_obj.tx_queue_count) % TX_PACKET_POOL_SIZE;
+    s_net_obj.tx_queue[tail] = packet;
+    s_net_obj.tx_queue_count++;
+    TINYUSB_STATS_MAX(net.tx_queue_max, s_net_obj.tx_queue_count);
+    tx_queue_drain(NULL);
+    TINYUSB_STATS_SERVICE_END(net, start);
 }
 
 esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg)
@@ -72,50 +189,105 @@ esp_err_t tinyusb_net_send_async(void *buffer, uint16_t len, void *buff_free_arg
         return ESP_ERR_INVALID_STATE;
     }
 
-    packet_t *packet = calloc(1, sizeof(packet_t));
+    packet_t *packet = packet_alloc();
+    if (packet == NULL) {
+        TINYUSB_STATS_INC(net.tx_pool_empty);
+        return ESP_ERR_NO_MEM; // All packets are queued, caller may retry after some are sent
+    }
     packet->len = len;
     packet->buffer = buffer;
     packet->buff_free_arg = buff_free_arg;
-    ESP_RETURN_ON_FALSE(packet, ESP_ERR_NO_MEM, TAG, "Failed to allocate packet to send");
+    packet->state = PACKET_ASYNC;
     usbd_defer_func(do_send_async, packet, false);
     return ESP_OK;
 }
 
 esp_err_t tinyusb_net_send_sync(void *buffer, uint16_t len, void *buff_free_arg, TickType_t  timeout)
 {
+    const tinyusb_net_frame_t frame = {
+        .buffer = buffer,
+        .len = len,
+        .buff_free_arg = buff_free_arg,
+    };
+    size_t sent = 0;
+    esp_err_t ret = tinyusb_net_send_sync_batch(&frame, 1, timeout, &sent);
+    if (ret == ESP_OK && sent == 0) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ret;
+}
+
+esp_err_t tinyusb_net_send_sync_batch(const tinyusb_net_frame_t *frames, size_t count, TickType_t timeout, size_t *sent)
+{
+    ESP_RETURN_ON_FALSE(frames && count && sent, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    *sent = 0;
     if (!tud_ready()) {
         return ESP_ERR_INVALID_STATE;
     }
 
-    // Lazy init the flags and semaphores, as they might not be needed (if async approach is used)
-    if (!s_net_obj.tx_flags) {
-        s_net_obj.tx_flags = xEventGroupCreate();
-        ESP_RETURN_ON_FALSE(s_net_obj.tx_flags, ESP_ERR_NO_MEM, TAG, "Failed to allocate event flags");
+    // Chain as many frames as the pool allows, the rest is left to the caller
+    packet_t *first = NULL;
+    packet_t **last = &first;
+    for (size_t i = 0; i < count; i++) {
+        packet_t *packet = packet_alloc();
+        if (packet == NULL) {
+            break;
+        }
+        packet->buffer = frames[i].buffer;
+        packet->len = frames[i].len;
+        packet->buff_free_arg = frames[i].buff_free_arg;
+        packet->state = PACKET_SYNC_PENDING;
+        packet->next = NULL;
+        *last = packet;
+        last = &packet->next;
     }
-    if (!s_net_obj.buffer_sema) {
-        s_net_obj.buffer_sema = xSemaphoreCreateBinary();
-        ESP_RETURN_ON_FALSE(s_net_obj.buffer_sema, ESP_ERR_NO_MEM, TAG, "Failed to allocate buffer semaphore");
+    if (first == NULL) {
+        return ESP_OK;  // pool exhausted, nothing sent
     }
 
-    packet_t packet = {
-        .buffer = buffer,
-        .len = len,
-        .buff_free_arg = buff_free_arg
-    };
-    s_net_obj.packet_to_send = &packet;
-    xSemaphoreGive(s_net_obj.buffer_sema);  // now the packet is ready, let's mark it available to tusb send
+    // One deferred call for the whole batch, to execute the send in tinyUSB task context
+    usbd_defer_func(do_send_sync, first, false);
 
-    // to execute the send function in tinyUSB task context
-    usbd_defer_func(do_send_sync, NULL, false);  // arg=NULL -> sync send, we keep the packet inside the object
+    // Wait for completion with common deadline, the packets are processed in order
+    const TickType_t start = xTaskGetTickCount();
+    esp_err_t ret = ESP_OK;
+    packet_t *next;
+    for (packet_t *packet = first; packet; packet = next) {
+        next = packet->next;
+        const TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t wait = 0;    // after the first failure, just collect or cancel the rest
+        if (ret == ESP_OK && timeout == portMAX_DELAY) {
+            wait = portMAX_DELAY;
+        } else if (ret == ESP_OK && elapsed < timeout) {
+            wait = timeout - elapsed;
+        }
+        const esp_err_t result = packet_wait_sync(packet, wait);
+        if (result == ESP_OK && ret == ESP_OK) {
+            (*sent)++;
+        } else if (ret == ESP_OK) {
+            ret = result;
+        }
+    }
+    return ret;
+}
+
+static void do_recv_renew(void *ctx)
+{
+    (void) ctx;
+    tud_network_recv_renew();
+}
 
-    // wait wor completion with defined timeout
-    EventBits_t bits = xEventGroupWaitBits(s_net_obj.tx_flags, TX_FINISHED_BIT, pdTRUE, pdTRUE, timeout);
-    xSemaphoreTake(s_net_obj.buffer_sema, portMAX_DELAY);   // if tusb sending already started, we have wait before ditching the packet
-    s_net_obj.packet_to_send = NULL;        // invalidate the argument
-    if (bits & TX_FINISHED_BIT) {   // If transaction finished, return error code
-        return packet.result;
+esp_err_t tinyusb_net_recv_done(void *buffer)
+{
+    void *held = buffer;
+    // Exchange prevents double release of the same frame
+    if (buffer == NULL ||
+            !__atomic_compare_exchange_n(&s_net_obj.rx_held, &held, NULL, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        return ESP_ERR_INVALID_ARG;
     }
-    return ESP_ERR_TIMEOUT;
+    // TinyUSB NCM driver must be called from its task
+    usbd_defer_func(do_recv_renew, NULL, false);
+    return ESP_OK;
 }
 
 esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t *cfg)
@@ -124,11 +296,14 @@ esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t
 
     ESP_RETURN_ON_FALSE(s_net_obj.initialized == false, ESP_ERR_INVALID_STATE, TAG, "TinyUSB Net class is already initialized");
 
-    // the semaphore and event flags are initialized only if needed
     s_net_obj.rx_cb = cfg->on_recv_callback;
     s_net_obj.init_cb = cfg->on_init_callback;
     s_net_obj.tx_buff_free_cb = cfg->free_tx_buffer;
     s_net_obj.ctx = cfg->user_context;
+    s_net_obj.rx_zero_copy = cfg->rx_zero_copy;
+    for (int i = 0; i < TX_PACKET_POOL_SIZE; i++) {
+        s_packet_pool[i].done = xSemaphoreCreateBinaryStatic(&s_packet_pool[i].done_buf);
+    }
 
     const uint8_t *mac = &cfg->mac_addr[0];
     snprintf(s_net_obj.mac_str, sizeof(s_net_obj.mac_str), "%02X%02X%02X%02X%02X%02X",
@@ -137,6 +312,14 @@ esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t
     // Pass it to Descriptor control module
     tinyusb_set_str_descriptor(s_net_obj.mac_str, mac_id);
 
+    if (!s_net_obj.tx_retry_timer) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = tx_retry_timer_cb,
+            .name = "tusb_net_tx",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &s_net_obj.tx_retry_timer), TAG, "Failed to create TX retry timer");
+    }
+
     s_net_obj.initialized = true;
 
     return ESP_OK;
@@ -145,12 +328,32 @@ esp_err_t tinyusb_net_init(tinyusb_usbdev_t usb_dev, const tinyusb_net_config_t
 //--------------------------------------------------------------------+
 // tinyusb callbacks
 //--------------------------------------------------------------------+
-bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
+static void net_recv(const uint8_t *src, uint16_t size)
 {
+    TINYUSB_STATS_XFER(net.rx, size);
+    if (s_net_obj.rx_zero_copy && s_net_obj.rx_cb) {
+        // Held before the callback, as the user could release the buffer before it returns
+        __atomic_store_n(&s_net_obj.rx_held, (void *)src, __ATOMIC_RELEASE);
+        if (s_net_obj.rx_cb((void *)src, size, s_net_obj.ctx) == ESP_OK) {
+            return;     // tud_network_recv_renew() is deferred to tinyusb_net_recv_done()
+        }
+        // Frame not taken, release it here unless the callback already did
+        if (__atomic_exchange_n(&s_net_obj.rx_held, NULL, __ATOMIC_ACQ_REL) != NULL) {
+            tud_network_recv_renew();
+        }
+        return;
+    }
     if (s_net_obj.rx_cb) {
         s_net_obj.rx_cb((void *)src, size, s_net_obj.ctx);
     }
     tud_network_recv_renew();
+}
+
+bool tud_network_recv_cb(const uint8_t *src, uint16_t size)
+{
+    TINYUSB_STATS_TIME_START(start);
+    net_recv(src, size);
+    TINYUSB_STATS_SERVICE_END(net, start);
     return true;
 }
 
@@ -160,6 +363,7 @@ uint16_t tud_network_xmit_cb(uint8_t *dst, void *ref, uint16_t arg)
     uint16_t len = arg;
 
     memcpy(dst, packet->buffer, packet->len);
+    TINYUSB_STATS_XFER(net.tx, packet->len);
     if (s_net_obj.tx_buff_free_cb) {
         s_net_obj.tx_buff_free_cb(packet->buff_free_arg, s_net_obj.ctx);
     }
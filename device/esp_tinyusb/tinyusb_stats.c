@@ -0,0 +1,38 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "esp_check.h"
+#include "tinyusb_stats.h"
+#include "stats.h"
+
+static const char *TAG = "tusb_stats";
+
+tinyusb_stats_t tinyusb_stats_data;
+
+void tinyusb_stats_update_max(uint32_t *counter, uint32_t value)
+{
+    uint32_t current = __atomic_load_n(counter, __ATOMIC_RELAXED);
+    while (value > current) {
+        if (__atomic_compare_exchange_n(counter, &current, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            break;
+        }
+        // current was updated by the failed exchange, try again
+    }
+}
+
+esp_err_t tinyusb_get_stats(tinyusb_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    memcpy(stats, &tinyusb_stats_data, sizeof(tinyusb_stats_t));
+    return ESP_OK;
+}
+
+void tinyusb_reset_stats(void)
+{
+    memset(&tinyusb_stats_data, 0, sizeof(tinyusb_stats_t));
+}
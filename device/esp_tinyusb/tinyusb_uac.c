@@ -0,0 +1,358 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "tusb.h"
+#include "tinyusb_uac.h"
+
+static const char *TAG = "tusb_uac";
+
+#define UAC_SAMPLE_RATE         CONFIG_TINYUSB_UAC_SAMPLE_RATE
+#define UAC_FRAME_BYTES         (CONFIG_TINYUSB_UAC_BYTES_PER_SAMPLE * 2)   // One stereo sample
+#define UAC_BLOCK_BYTES         (UAC_SAMPLE_RATE / 1000 * UAC_FRAME_BYTES)  // 1 ms of audio per I2S write
+#define UAC_FIFO_TARGET_BYTES   (CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ / 2)
+#define UAC_I2S_TIMEOUT_MS      100
+#define UAC_RATE_WINDOW_US      1000000     // Window of the I2S rate measurement
+#define UAC_FILL_GAIN_HZ        0.5f        // Rate correction per sample of FIFO fill error
+#define UAC_FILL_CORR_MAX       0.005f      // Limit of the fill correction, relative to the nominal rate
+
+#if TUD_OPT_HIGH_SPEED
+// 16.16 samples per microframe
+#define UAC_FB_FRAMES_PER_S     8000
+#define UAC_FB_SHIFT            16
+#else
+// 10.14 samples per frame
+#define UAC_FB_FRAMES_PER_S     1000
+#define UAC_FB_SHIFT            14
+#endif
+
+typedef struct {
+    i2s_chan_handle_t i2s_tx;
+    tinyusb_uac_volume_cb_t volume_cb;
+    void *user_arg;
+    TaskHandle_t task;
+    SemaphoreHandle_t stopped;          // Given by the task when it exits
+    volatile bool running;
+    volatile bool streaming;            // Host selected the streaming alternate setting
+    bool playing;                       // FIFO was filled up to the target since the stream start, task only
+    bool mute;
+    int16_t volume;
+    // Updated by the on_sent callback of I2S
+    portMUX_TYPE i2s_lock;
+    uint32_t i2s_bytes;
+    int64_t i2s_time_us;
+    // I2S rate measurement, task only
+    uint32_t window_bytes;
+    int64_t window_time_us;
+    float rate_hz;
+    tinyusb_uac_stats_t stats;
+    uint8_t block[UAC_BLOCK_BYTES];
+} tinyusb_uac_t;
+
+static tinyusb_uac_t *s_uac;
+
+/* Feedback
+ ********************************************************************* */
+
+static bool IRAM_ATTR uac_i2s_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    tinyusb_uac_t *uac = user_ctx;
+    portENTER_CRITICAL_ISR(&uac->i2s_lock);
+    uac->i2s_bytes += event->size;
+    uac->i2s_time_us = esp_timer_get_time();
+    portEXIT_CRITICAL_ISR(&uac->i2s_lock);
+    return false;
+}
+
+static uint32_t uac_feedback_value(float rate_hz)
+{
+    return (uint32_t)(rate_hz / UAC_FB_FRAMES_PER_S * (1 << UAC_FB_SHIFT) + 0.5f);
+}
+
+/**
+ * @brief Update the I2S rate and the feedback value
+ *
+ * The rate of I2S is measured from the DMA buffers sent between the on_sent callbacks, so it follows
+ * the real I2S clock instead of the nominal sample rate. The offset of the host clock is then
+ * compensated by the FIFO fill level: the host is asked for more samples while the FIFO is below the
+ * target, and for less while it is above.
+ */
+static void uac_update_feedback(tinyusb_uac_t *uac, uint32_t fifo_bytes)
+{
+    portENTER_CRITICAL(&uac->i2s_lock);
+    const uint32_t bytes = uac->i2s_bytes;
+    const int64_t time_us = uac->i2s_time_us;
+    portEXIT_CRITICAL(&uac->i2s_lock);
+    if (uac->window_time_us == 0) {
+        uac->window_bytes = bytes;
+        uac->window_time_us = time_us;
+    } else if (time_us - uac->window_time_us >= UAC_RATE_WINDOW_US) {
+        const float measured = (float)(bytes - uac->window_bytes) / UAC_FRAME_BYTES * 1e6f / (time_us - uac->window_time_us);
+        // Smooth the quantization of the DMA buffer size
+        uac->rate_hz += (measured - uac->rate_hz) / 8;
+        uac->stats.rate_hz = (uint32_t)(uac->rate_hz + 0.5f);
+        uac->window_bytes = bytes;
+        uac->window_time_us = time_us;
+    }
+
+    const float fill_error = ((float)fifo_bytes - UAC_FIFO_TARGET_BYTES) / UAC_FRAME_BYTES;
+    float correction = -fill_error * UAC_FILL_GAIN_HZ;
+    const float correction_max = UAC_SAMPLE_RATE * UAC_FILL_CORR_MAX;
+    correction = correction > correction_max ? correction_max : (correction < -correction_max ? -correction_max : correction);
+
+    uac->stats.feedback = uac_feedback_value(uac->rate_hz + correction);
+    tud_audio_fb_set(uac->stats.feedback);
+}
+
+/* I2S task
+ ********************************************************************* */
+
+static void uac_apply_mute(tinyusb_uac_t *uac, uint32_t len)
+{
+    if (uac->mute) {
+        memset(uac->block, 0, len);
+    }
+}
+
+static void uac_task(void *arg)
+{
+    tinyusb_uac_t *uac = arg;
+    while (uac->running) {
+        const uint32_t fifo_bytes = uac->streaming ? tud_audio_available() : 0;
+        uint32_t len = 0;
+        if (!uac->streaming) {
+            uac->playing = false;
+        } else if (!uac->playing) {
+            // Prefill the FIFO up to the target, so that it absorbs the jitter of both clocks
+            uac->playing = fifo_bytes >= UAC_FIFO_TARGET_BYTES;
+        }
+        if (uac->playing) {
+            len = tud_audio_read(uac->block, MIN(fifo_bytes, sizeof(uac->block)) / UAC_FRAME_BYTES * UAC_FRAME_BYTES);
+            if (len < sizeof(uac->block)) {
+                uac->stats.underruns++;
+            }
+            uac_apply_mute(uac, len);
+        }
+        // Silence keeps the I2S clock running, which paces this task and the rate measurement
+        memset(uac->block + len, 0, sizeof(uac->block) - len);
+
+        size_t written = 0;
+        i2s_channel_write(uac->i2s_tx, uac->block, sizeof(uac->block), &written, pdMS_TO_TICKS(UAC_I2S_TIMEOUT_MS));
+        if (uac->streaming) {
+            uac_update_feedback(uac, fifo_bytes - len);
+        }
+    }
+    xSemaphoreGive(uac->stopped);
+    vTaskDelete(NULL);
+}
+
+/* TinyUSB audio class callbacks
+ ********************************************************************* */
+
+static bool uac_get_clock_req(uint8_t rhport, tusb_control_request_t const *p_request, uint8_t ctrl_sel)
+{
+    if (ctrl_sel == AUDIO_CS_CTRL_SAM_FREQ) {
+        if (p_request->bRequest == AUDIO_CS_REQ_CUR) {
+            audio_control_cur_4_t cur = { .bCur = tu_htole32(UAC_SAMPLE_RATE) };
+            return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &cur, sizeof(cur));
+        }
+        if (p_request->bRequest == AUDIO_CS_REQ_RANGE) {
+            audio_control_range_4_n_t(1) range = {
+                .wNumSubRanges = tu_htole16(1),
+                .subrange[0] = {
+                    .bMin = tu_htole32(UAC_SAMPLE_RATE),
+                    .bMax = tu_htole32(UAC_SAMPLE_RATE),
+                    .bRes = 0,
+                },
+            };
+            return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &range, sizeof(range));
+        }
+    } else if (ctrl_sel == AUDIO_CS_CTRL_CLK_VALID && p_request->bRequest == AUDIO_CS_REQ_CUR) {
+        audio_control_cur_1_t valid = { .bCur = 1 };
+        return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &valid, sizeof(valid));
+    }
+    return false;
+}
+
+static bool uac_get_feature_req(uint8_t rhport, tusb_control_request_t const *p_request, uint8_t ctrl_sel)
+{
+    if (ctrl_sel == AUDIO_FU_CTRL_MUTE && p_request->bRequest == AUDIO_CS_REQ_CUR) {
+        audio_control_cur_1_t mute = { .bCur = s_uac->mute };
+        return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &mute, sizeof(mute));
+    }
+    if (ctrl_sel == AUDIO_FU_CTRL_VOLUME) {
+        if (p_request->bRequest == AUDIO_CS_REQ_CUR) {
+            audio_control_cur_2_t volume = { .bCur = tu_htole16(s_uac->volume) };
+            return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &volume, sizeof(volume));
+        }
+        if (p_request->bRequest == AUDIO_CS_REQ_RANGE) {
+            audio_control_range_2_n_t(1) range = {
+                .wNumSubRanges = tu_htole16(1),
+                .subrange[0] = {
+                    .bMin = tu_htole16(TINYUSB_UAC_VOLUME_MIN_DB),
+                    .bMax = tu_htole16(0),
+                    .bRes = tu_htole16(256),
+                },
+            };
+            return tud_audio_buffer_and_schedule_control_xfer(rhport, p_request, &range, sizeof(range));
+        }
+    }
+    return false;
+}
+
+bool tud_audio_get_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p_request)
+{
+    if (s_uac == NULL) {
+        return false;
+    }
+    const uint8_t ctrl_sel = TU_U16_HIGH(p_request->wValue);
+    const uint8_t entity_id = TU_U16_HIGH(p_request->wIndex);
+    switch (entity_id) {
+    case TINYUSB_UAC_ENTITY_CLOCK:
+        return uac_get_clock_req(rhport, p_request, ctrl_sel);
+    case TINYUSB_UAC_ENTITY_FEATURE_UNIT:
+        return uac_get_feature_req(rhport, p_request, ctrl_sel);
+    default:
+        return false;
+    }
+}
+
+bool tud_audio_set_req_entity_cb(uint8_t rhport, tusb_control_request_t const *p_request, uint8_t *buf)
+{
+    (void) rhport;
+    if (s_uac == NULL || p_request->bRequest != AUDIO_CS_REQ_CUR) {
+        return false;
+    }
+    const uint8_t channel = TU_U16_LOW(p_request->wValue);
+    const uint8_t ctrl_sel = TU_U16_HIGH(p_request->wValue);
+    const uint8_t entity_id = TU_U16_HIGH(p_request->wIndex);
+
+    if (entity_id == TINYUSB_UAC_ENTITY_CLOCK && ctrl_sel == AUDIO_CS_CTRL_SAM_FREQ) {
+        // The clock is fixed, only the supported rate is accepted
+        return tu_le32toh(((audio_control_cur_4_t const *)buf)->bCur) == UAC_SAMPLE_RATE;
+    }
+    if (entity_id != TINYUSB_UAC_ENTITY_FEATURE_UNIT || channel != 0) {
+        return false;   // Only the master channel has controls
+    }
+    if (ctrl_sel == AUDIO_FU_CTRL_MUTE) {
+        s_uac->mute = ((audio_control_cur_1_t const *)buf)->bCur;
+    } else if (ctrl_sel == AUDIO_FU_CTRL_VOLUME) {
+        s_uac->volume = (int16_t)tu_le16toh(((audio_control_cur_2_t const *)buf)->bCur);
+    } else {
+        return false;
+    }
+    if (s_uac->volume_cb) {
+        s_uac->volume_cb(s_uac->mute, s_uac->volume, s_uac->user_arg);
+    }
+    return true;
+}
+
+bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_request)
+{
+    (void) rhport;
+    if (s_uac == NULL) {
+        return true;
+    }
+    const uint8_t alt = TU_U16_LOW(p_request->wValue);
+    if (alt != 0) {
+        // Start with the nominal rate, until the first measurement
+        tud_audio_fb_set(uac_feedback_value(s_uac->rate_hz));
+    }
+    s_uac->streaming = alt != 0;
+    return true;
+}
+
+bool tud_audio_set_itf_close_EP_cb(uint8_t rhport, tusb_control_request_t const *p_request)
+{
+    (void) rhport;
+    (void) p_request;
+    if (s_uac) {
+        s_uac->streaming = false;
+    }
+    return true;
+}
+
+/* Public API
+ ********************************************************************* */
+
+esp_err_t tinyusb_uac_init(const tinyusb_config_uac_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && config->i2s_tx, ESP_ERR_INVALID_ARG, TAG, "Invalid configuration");
+    ESP_RETURN_ON_FALSE(s_uac == NULL, ESP_ERR_INVALID_STATE, TAG, "UAC already initialized");
+
+    tinyusb_uac_t *uac = calloc(1, sizeof(tinyusb_uac_t));
+    ESP_RETURN_ON_FALSE(uac, ESP_ERR_NO_MEM, TAG, "No memory for UAC");
+    uac->i2s_tx = config->i2s_tx;
+    uac->volume_cb = config->volume_cb;
+    uac->user_arg = config->user_arg;
+    portMUX_INITIALIZE(&uac->i2s_lock);
+    uac->rate_hz = UAC_SAMPLE_RATE;
+    uac->stats.rate_hz = UAC_SAMPLE_RATE;
+    uac->stopped = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(uac->stopped, ESP_ERR_NO_MEM, fail, TAG, "No memory for UAC semaphore");
+
+    const i2s_event_callbacks_t cbs = {
+        .on_sent = uac_i2s_sent,
+    };
+    ESP_GOTO_ON_ERROR(i2s_channel_register_event_callback(uac->i2s_tx, &cbs, uac), fail, TAG, "I2S callback registration failed");
+    ESP_GOTO_ON_ERROR(i2s_channel_enable(uac->i2s_tx), fail_cbs, TAG, "I2S channel enable failed");
+
+    s_uac = uac;
+    uac->running = true;
+    if (xTaskCreate(uac_task, "TinyUSB UAC", CONFIG_TINYUSB_UAC_TASK_STACK_SIZE, uac,
+                    CONFIG_TINYUSB_UAC_TASK_PRIORITY, &uac->task) != pdPASS) {
+        ESP_LOGE(TAG, "No memory for UAC task");
+        s_uac = NULL;
+        i2s_channel_disable(uac->i2s_tx);
+        ret = ESP_ERR_NO_MEM;
+        goto fail_cbs;
+    }
+    return ESP_OK;
+
+fail_cbs:
+    {
+        const i2s_event_callbacks_t no_cbs = { 0 };
+        i2s_channel_register_event_callback(uac->i2s_tx, &no_cbs, NULL);
+    }
+fail:
+    if (uac->stopped) {
+        vSemaphoreDelete(uac->stopped);
+    }
+    free(uac);
+    return ret;
+}
+
+esp_err_t tinyusb_uac_deinit(void)
+{
+    tinyusb_uac_t *uac = s_uac;
+    ESP_RETURN_ON_FALSE(uac, ESP_ERR_INVALID_STATE, TAG, "UAC not initialized");
+    s_uac = NULL;
+    uac->running = false;
+    xSemaphoreTake(uac->stopped, portMAX_DELAY);
+    i2s_channel_disable(uac->i2s_tx);
+    const i2s_event_callbacks_t no_cbs = { 0 };
+    i2s_channel_register_event_callback(uac->i2s_tx, &no_cbs, NULL);
+    vSemaphoreDelete(uac->stopped);
+    free(uac);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_uac_get_stats(tinyusb_uac_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(s_uac, ESP_ERR_INVALID_STATE, TAG, "UAC not initialized");
+    *stats = s_uac->stats;
+    return ESP_OK;
+}
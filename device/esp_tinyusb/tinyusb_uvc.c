@@ -0,0 +1,440 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_uvc.h"
+
+static const char *TAG = "tusb_uvc";
+
+#define UVC_CTL_IDX                 0
+#define UVC_STM_IDX                 0
+#define UVC_FRAME_QUEUE_SIZE        CONFIG_TINYUSB_UVC_FRAME_QUEUE_SIZE
+#define UVC_DEINIT_TIMEOUT_MS       1000
+#define UVC_CLOCK_FREQUENCY         27000000
+#define UVC_BITS_PER_PIXEL          16          // YUY2, also used for the MJPEG bit rate bounds
+
+// Descriptor lengths
+#define UVC_DESC_IAD_LEN            8
+#define UVC_DESC_ITF_LEN            9
+#define UVC_DESC_VC_HEADER_LEN      13          // One streaming interface
+#define UVC_DESC_CAMERA_TERM_LEN    18
+#define UVC_DESC_OUTPUT_TERM_LEN    9
+#define UVC_DESC_VS_INPUT_LEN       14          // One format
+#define UVC_DESC_FMT_MJPEG_LEN      11
+#define UVC_DESC_FMT_UNCOMPR_LEN    27
+#define UVC_DESC_FRAME_LEN          30          // One discrete frame interval
+#define UVC_DESC_COLOR_LEN          6
+#define UVC_DESC_EP_LEN             7
+
+#define UVC_TERM_ID_CAMERA          1
+#define UVC_TERM_ID_OUTPUT          2
+
+typedef struct {
+    const void *frame;
+    size_t len;
+} uvc_frame_t;
+
+typedef struct {
+    tinyusb_uvc_format_config_t format;
+    tinyusb_uvc_stream_cb_t stream_cb;
+    tinyusb_uvc_frame_done_cb_t frame_done_cb;
+    void *user_arg;
+    QueueHandle_t queue;                // uvc_frame_t, written by the application
+    uvc_frame_t current;                // Frame being transferred, TinyUSB task only
+    volatile bool committed;            // The host committed the stream
+    bool active;                        // Streaming endpoint was seen active since the commit, TinyUSB task only
+    tinyusb_uvc_frame_size_t frame_size;    // Negotiated frame size
+    esp_err_t deinit_result;
+    SemaphoreHandle_t deinit_done;
+} tinyusb_uvc_t;
+
+static tinyusb_uvc_t *s_uvc;
+
+/* Descriptor builder
+ ********************************************************************* */
+
+static bool _format_valid(const tinyusb_uvc_format_config_t *format)
+{
+    if (format == NULL || format->frame_size_num == 0 || format->frame_size_num > TINYUSB_UVC_FRAME_SIZE_MAX ||
+            format->format > TINYUSB_UVC_FORMAT_YUY2) {
+        return false;
+    }
+    for (int i = 0; i < format->frame_size_num; i++) {
+        const tinyusb_uvc_frame_size_t *size = &format->frame_sizes[i];
+        if (size->width == 0 || size->height == 0 || size->fps == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t _vs_len(const tinyusb_uvc_format_config_t *format)
+{
+    return UVC_DESC_VS_INPUT_LEN +
+           (format->format == TINYUSB_UVC_FORMAT_MJPEG ? UVC_DESC_FMT_MJPEG_LEN : UVC_DESC_FMT_UNCOMPR_LEN) +
+           format->frame_size_num * UVC_DESC_FRAME_LEN + UVC_DESC_COLOR_LEN;
+}
+
+size_t tinyusb_uvc_desc_len(const tinyusb_uvc_format_config_t *format)
+{
+    if (!_format_valid(format)) {
+        return 0;
+    }
+    size_t len = UVC_DESC_IAD_LEN +
+                 UVC_DESC_ITF_LEN + UVC_DESC_VC_HEADER_LEN + UVC_DESC_CAMERA_TERM_LEN + UVC_DESC_OUTPUT_TERM_LEN +
+                 UVC_DESC_ITF_LEN + _vs_len(format) + UVC_DESC_EP_LEN;
+#if !CONFIG_TINYUSB_UVC_BULK
+    len += UVC_DESC_ITF_LEN;            // Alternate setting 1 with the isochronous endpoint
+#endif
+    return len;
+}
+
+static uint8_t *_put_u16(uint8_t *p, uint16_t value)
+{
+    *p++ = value & 0xFF;
+    *p++ = value >> 8;
+    return p;
+}
+
+static uint8_t *_put_u32(uint8_t *p, uint32_t value)
+{
+    p = _put_u16(p, value & 0xFFFF);
+    return _put_u16(p, value >> 16);
+}
+
+static uint8_t *_put_itf(uint8_t *p, uint8_t itf_num, uint8_t alt, uint8_t ep_num, uint8_t subclass, uint8_t str_idx)
+{
+    const uint8_t desc[UVC_DESC_ITF_LEN] = {
+        UVC_DESC_ITF_LEN, TUSB_DESC_INTERFACE, itf_num, alt, ep_num,
+        TUSB_CLASS_VIDEO, subclass, VIDEO_ITF_PROTOCOL_15, str_idx
+    };
+    memcpy(p, desc, sizeof(desc));
+    return p + sizeof(desc);
+}
+
+static uint8_t *_put_frame(uint8_t *p, const tinyusb_uvc_format_config_t *format, uint8_t frame_idx)
+{
+    const tinyusb_uvc_frame_size_t *size = &format->frame_sizes[frame_idx];
+    const uint32_t frame_bytes = (uint32_t)size->width * size->height * UVC_BITS_PER_PIXEL / 8;
+    const uint32_t bit_rate = frame_bytes * 8 * size->fps;
+    const uint32_t interval = 10000000 / size->fps;     // 100 ns units
+
+    *p++ = UVC_DESC_FRAME_LEN;
+    *p++ = TUSB_DESC_CS_INTERFACE;
+    *p++ = format->format == TINYUSB_UVC_FORMAT_MJPEG ? VIDEO_CS_ITF_VS_FRAME_MJPEG : VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED;
+    *p++ = frame_idx + 1;
+    *p++ = 0;                           // bmCapabilities
+    p = _put_u16(p, size->width);
+    p = _put_u16(p, size->height);
+    p = _put_u32(p, bit_rate);          // dwMinBitRate
+    p = _put_u32(p, bit_rate);          // dwMaxBitRate
+    p = _put_u32(p, frame_bytes);       // dwMaxVideoFrameBufferSize, upper bound of a JPEG frame
+    p = _put_u32(p, interval);          // dwDefaultFrameInterval
+    *p++ = 1;                           // bFrameIntervalType, one discrete interval
+    return _put_u32(p, interval);
+}
+
+esp_err_t tinyusb_uvc_desc_build(const tinyusb_uvc_format_config_t *format, uint8_t itf_num, uint8_t ep_addr,
+                                 uint8_t str_idx, bool high_speed, uint8_t *buf, size_t buf_len)
+{
+    ESP_RETURN_ON_FALSE(_format_valid(format) && buf, ESP_ERR_INVALID_ARG, TAG, "Invalid format");
+    ESP_RETURN_ON_FALSE(buf_len >= tinyusb_uvc_desc_len(format), ESP_ERR_INVALID_SIZE, TAG, "Descriptor buffer too small");
+    uint8_t *p = buf;
+
+    // Interface association of the video function
+    const uint8_t iad[UVC_DESC_IAD_LEN] = {
+        UVC_DESC_IAD_LEN, TUSB_DESC_INTERFACE_ASSOCIATION, itf_num, 2,
+        TUSB_CLASS_VIDEO, VIDEO_SUBCLASS_INTERFACE_COLLECTION, VIDEO_ITF_PROTOCOL_UNDEFINED, str_idx
+    };
+    memcpy(p, iad, sizeof(iad));
+    p += sizeof(iad);
+
+    // Video control interface: camera terminal -> streaming output terminal
+    p = _put_itf(p, itf_num, 0, 0, VIDEO_SUBCLASS_CONTROL, str_idx);
+    *p++ = UVC_DESC_VC_HEADER_LEN;
+    *p++ = TUSB_DESC_CS_INTERFACE;
+    *p++ = VIDEO_CS_ITF_VC_HEADER;
+    p = _put_u16(p, 0x0150);            // bcdUVC
+    p = _put_u16(p, UVC_DESC_VC_HEADER_LEN + UVC_DESC_CAMERA_TERM_LEN + UVC_DESC_OUTPUT_TERM_LEN);
+    p = _put_u32(p, UVC_CLOCK_FREQUENCY);
+    *p++ = 1;                           // bInCollection
+    *p++ = itf_num + 1;                 // baInterfaceNr
+
+    *p++ = UVC_DESC_CAMERA_TERM_LEN;
+    *p++ = TUSB_DESC_CS_INTERFACE;
+    *p++ = VIDEO_CS_ITF_VC_INPUT_TERMINAL;
+    *p++ = UVC_TERM_ID_CAMERA;
+    p = _put_u16(p, VIDEO_ITT_CAMERA);
+    memset(p, 0, 8);                    // bAssocTerminal, iTerminal, focal lengths
+    p += 8;
+    *p++ = 3;                           // bControlSize
+    memset(p, 0, 3);                    // bmControls, no camera controls
+    p += 3;
+
+    *p++ = UVC_DESC_OUTPUT_TERM_LEN;
+    *p++ = TUSB_DESC_CS_INTERFACE;
+    *p++ = VIDEO_CS_ITF_VC_OUTPUT_TERMINAL;
+    *p++ = UVC_TERM_ID_OUTPUT;
+    p = _put_u16(p, VIDEO_TT_STREAMING);
+    *p++ = 0;                           // bAssocTerminal
+    *p++ = UVC_TERM_ID_CAMERA;          // bSourceID
+    *p++ = 0;                           // iTerminal
+
+    // Video streaming interface, the bulk endpoint is in the only alternate setting
+    p = _put_itf(p, itf_num + 1, 0, CONFIG_TINYUSB_UVC_BULK ? 1 : 0, VIDEO_SUBCLASS_STREAMING, 0);
+    *p++ = UVC_DESC_VS_INPUT_LEN;
+    *p++ = TUSB_DESC_CS_INTERFACE;
+    *p++ = VIDEO_CS_ITF_VS_INPUT_HEADER;
+    *p++ = 1;                           // bNumFormats
+    p = _put_u16(p, _vs_len(format));
+    *p++ = ep_addr;
+    *p++ = 0;                           // bmInfo
+    *p++ = UVC_TERM_ID_OUTPUT;          // bTerminalLink
+    *p++ = 0;                           // bStillCaptureMethod
+    *p++ = 0;                           // bTriggerSupport
+    *p++ = 0;                           // bTriggerUsage
+    *p++ = 1;                           // bControlSize
+    *p++ = 0;                           // bmaControls
+
+    if (format->format == TINYUSB_UVC_FORMAT_MJPEG) {
+        *p++ = UVC_DESC_FMT_MJPEG_LEN;
+        *p++ = TUSB_DESC_CS_INTERFACE;
+        *p++ = VIDEO_CS_ITF_VS_FORMAT_MJPEG;
+        *p++ = 1;                       // bFormatIndex
+        *p++ = format->frame_size_num;
+        *p++ = 0;                       // bmFlags, JPEG frames have variable size
+        *p++ = 1;                       // bDefaultFrameIndex
+        memset(p, 0, 4);                // Aspect ratio, interlace flags, copy protection
+        p += 4;
+    } else {
+        static const uint8_t guid_yuy2[16] = {
+            'Y', 'U', 'Y', '2', 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+        };
+        *p++ = UVC_DESC_FMT_UNCOMPR_LEN;
+        *p++ = TUSB_DESC_CS_INTERFACE;
+        *p++ = VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED;
+        *p++ = 1;                       // bFormatIndex
+        *p++ = format->frame_size_num;
+        memcpy(p, guid_yuy2, sizeof(guid_yuy2));
+        p += sizeof(guid_yuy2);
+        *p++ = UVC_BITS_PER_PIXEL;
+        *p++ = 1;                       // bDefaultFrameIndex
+        memset(p, 0, 4);                // Aspect ratio, interlace flags, copy protection
+        p += 4;
+    }
+    for (int i = 0; i < format->frame_size_num; i++) {
+        p = _put_frame(p, format, i);
+    }
+    *p++ = UVC_DESC_COLOR_LEN;
+    *p++ = TUSB_DESC_CS_INTERFACE;
+    *p++ = VIDEO_CS_ITF_VS_COLORFORMAT;
+    *p++ = VIDEO_COLOR_PRIMARIES_BT709;
+    *p++ = VIDEO_COLOR_XFER_CH_BT709;
+    *p++ = VIDEO_COLOR_COEF_SMPTE170M;
+
+#if CONFIG_TINYUSB_UVC_BULK
+    const uint16_t ep_size = high_speed ? 512 : 64;
+    const uint8_t ep_attr = TUSB_XFER_BULK;
+#else
+    // Isochronous endpoint in alternate setting 1, the host selects it to start the stream
+    p = _put_itf(p, itf_num + 1, 1, 1, VIDEO_SUBCLASS_STREAMING, 0);
+    const uint16_t ep_size = MIN(CFG_TUD_VIDEO_STREAMING_EP_BUFSIZE, high_speed ? 1024 : 1023);
+    const uint8_t ep_attr = TUSB_XFER_ISOCHRONOUS | TUSB_ISO_EP_ATT_ASYNCHRONOUS;
+#endif // CONFIG_TINYUSB_UVC_BULK
+    *p++ = UVC_DESC_EP_LEN;
+    *p++ = TUSB_DESC_ENDPOINT;
+    *p++ = ep_addr;
+    *p++ = ep_attr;
+    p = _put_u16(p, ep_size);
+    *p++ = 1;                           // bInterval
+    return ESP_OK;
+}
+
+/* TinyUSB task side
+ ********************************************************************* */
+
+static void _frame_done(tinyusb_uvc_t *uvc, const uvc_frame_t *frame, esp_err_t result)
+{
+    if (uvc->frame_done_cb) {
+        uvc->frame_done_cb(frame->frame, result, uvc->user_arg);
+    }
+}
+
+static void _drop_frames(tinyusb_uvc_t *uvc)
+{
+    if (uvc->current.frame) {
+        _frame_done(uvc, &uvc->current, ESP_ERR_INVALID_STATE);
+        uvc->current.frame = NULL;
+    }
+    uvc_frame_t frame;
+    while (xQueueReceive(uvc->queue, &frame, 0) == pdTRUE) {
+        _frame_done(uvc, &frame, ESP_ERR_INVALID_STATE);
+    }
+}
+
+static void frame_drain(void *param)
+{
+    (void) param;
+    tinyusb_uvc_t *uvc = s_uvc;
+    if (uvc == NULL || !uvc->committed) {
+        return;
+    }
+    const bool streaming = tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX);
+    if (streaming) {
+        uvc->active = true;
+    } else if (uvc->active) {
+        // The host stopped the stream, TinyUSB dropped the transfer in progress
+        uvc->committed = false;
+        uvc->active = false;
+        _drop_frames(uvc);
+        if (uvc->stream_cb) {
+            uvc->stream_cb(false, NULL, uvc->user_arg);
+        }
+        return;
+    } else {
+        return;     // Committed, but the host did not select the streaming endpoint yet
+    }
+
+    if (uvc->current.frame == NULL && xQueueReceive(uvc->queue, &uvc->current, 0) == pdTRUE) {
+        if (!tud_video_n_frame_xfer(UVC_CTL_IDX, UVC_STM_IDX, (void *)uvc->current.frame, uvc->current.len)) {
+            _frame_done(uvc, &uvc->current, ESP_FAIL);
+            uvc->current.frame = NULL;
+        }
+    }
+}
+
+static void do_deinit(void *param)
+{
+    (void) param;
+    tinyusb_uvc_t *uvc = s_uvc;
+    if (uvc->current.frame && tud_video_n_streaming(UVC_CTL_IDX, UVC_STM_IDX)) {
+        // TinyUSB still reads the frame buffer
+        uvc->deinit_result = ESP_ERR_INVALID_STATE;
+    } else {
+        s_uvc = NULL;
+        _drop_frames(uvc);
+        uvc->deinit_result = ESP_OK;
+    }
+    xSemaphoreGive(uvc->deinit_done);
+}
+
+void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
+{
+    tinyusb_uvc_t *uvc = s_uvc;
+    if (uvc == NULL || uvc->current.frame == NULL) {
+        return;
+    }
+    _frame_done(uvc, &uvc->current, ESP_OK);
+    uvc->current.frame = NULL;
+    frame_drain(NULL);
+}
+
+int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx, video_probe_and_commit_control_t const *parameters)
+{
+    tinyusb_uvc_t *uvc = s_uvc;
+    if (uvc == NULL) {
+        return VIDEO_ERROR_NOT_READY;
+    }
+    if (parameters->bFormatIndex != 1 || parameters->bFrameIndex == 0 ||
+            parameters->bFrameIndex > uvc->format.frame_size_num) {
+        return VIDEO_ERROR_OUT_OF_RANGE;
+    }
+    uvc->frame_size = uvc->format.frame_sizes[parameters->bFrameIndex - 1];
+    if (parameters->dwFrameInterval) {
+        uvc->frame_size.fps = 10000000 / parameters->dwFrameInterval;
+    }
+    // A new commit restarts the stream, frames of the previous one are dropped
+    _drop_frames(uvc);
+    uvc->active = false;
+    uvc->committed = true;
+    ESP_LOGI(TAG, "Stream committed: %ux%u @ %u fps", uvc->frame_size.width, uvc->frame_size.height, uvc->frame_size.fps);
+    if (uvc->stream_cb) {
+        uvc->stream_cb(true, &uvc->frame_size, uvc->user_arg);
+    }
+    return VIDEO_ERROR_NONE;
+}
+
+/* Public API
+ ********************************************************************* */
+
+static void _uvc_free(tinyusb_uvc_t *uvc)
+{
+    if (uvc->queue) {
+        vQueueDelete(uvc->queue);
+    }
+    if (uvc->deinit_done) {
+        vSemaphoreDelete(uvc->deinit_done);
+    }
+    free(uvc);
+}
+
+esp_err_t tinyusb_uvc_init(const tinyusb_config_uvc_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && _format_valid(&config->format), ESP_ERR_INVALID_ARG, TAG, "Invalid configuration");
+    ESP_RETURN_ON_FALSE(s_uvc == NULL, ESP_ERR_INVALID_STATE, TAG, "UVC already initialized");
+
+    tinyusb_uvc_t *uvc = calloc(1, sizeof(tinyusb_uvc_t));
+    ESP_RETURN_ON_FALSE(uvc, ESP_ERR_NO_MEM, TAG, "No memory for UVC");
+    uvc->format = config->format;
+    uvc->stream_cb = config->stream_cb;
+    uvc->frame_done_cb = config->frame_done_cb;
+    uvc->user_arg = config->user_arg;
+    uvc->queue = xQueueCreate(UVC_FRAME_QUEUE_SIZE, sizeof(uvc_frame_t));
+    uvc->deinit_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(uvc->queue && uvc->deinit_done, ESP_ERR_NO_MEM, fail, TAG, "No memory for UVC frame queue");
+
+    s_uvc = uvc;
+    return ESP_OK;
+
+fail:
+    _uvc_free(uvc);
+    return ret;
+}
+
+esp_err_t tinyusb_uvc_deinit(void)
+{
+    tinyusb_uvc_t *uvc = s_uvc;
+    ESP_RETURN_ON_FALSE(uvc, ESP_ERR_INVALID_STATE, TAG, "UVC not initialized");
+
+    // Frames are released in the TinyUSB task, which is the only user of the frame in transfer
+    usbd_defer_func(do_deinit, NULL, false);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(uvc->deinit_done, pdMS_TO_TICKS(UVC_DEINIT_TIMEOUT_MS)) == pdTRUE,
+                        ESP_ERR_TIMEOUT, TAG, "TinyUSB task did not release the frames");
+    ESP_RETURN_ON_ERROR(uvc->deinit_result, TAG, "Frame transfer in progress");
+    _uvc_free(uvc);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_uvc_frame_submit(const void *frame, size_t len, TickType_t ticks_to_wait)
+{
+    ESP_RETURN_ON_FALSE(frame && len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_uvc_t *uvc = s_uvc;
+    ESP_RETURN_ON_FALSE(uvc, ESP_ERR_INVALID_STATE, TAG, "UVC not initialized");
+    if (!uvc->committed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    const uvc_frame_t item = {
+        .frame = frame,
+        .len = len,
+    };
+    // Let the TinyUSB task take the next frame, also when the queue is full
+    usbd_defer_func(frame_drain, NULL, false);
+    if (xQueueSend(uvc->queue, &item, ticks_to_wait) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    usbd_defer_func(frame_drain, NULL, false);
+    return ESP_OK;
+}
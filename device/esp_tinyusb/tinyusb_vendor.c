@@ -0,0 +1,253 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/param.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_bit_defs.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "tusb.h"
+#include "device/usbd_pvt.h"
+#include "tinyusb_vendor.h"
+
+static const char *TAG = "tusb_vendor";
+
+#define VENDOR_ITF_NUM              CFG_TUD_VENDOR
+#define VENDOR_TX_QUEUE_SIZE        CONFIG_TINYUSB_VENDOR_TX_QUEUE_SIZE
+#define VENDOR_RX_BUFFER_NUM        CONFIG_TINYUSB_VENDOR_RX_BUFFER_NUM
+#define VENDOR_RX_BUFFER_SIZE       CFG_TUD_VENDOR_RX_BUFSIZE
+#define VENDOR_DEINIT_TIMEOUT_MS    1000
+
+typedef struct {
+    const uint8_t *buffer;
+    size_t len;
+} vendor_tx_item_t;
+
+typedef struct {
+    tinyusb_vendor_itf_t itf;
+    tinyusb_vendor_tx_done_cb_t tx_done_cb;
+    tinyusb_vendor_rx_cb_t rx_cb;
+    void *user_arg;
+    QueueHandle_t tx_queue;             // vendor_tx_item_t, written by the application
+    vendor_tx_item_t tx_current;        // Buffer being passed to the endpoint, TinyUSB task only
+    size_t tx_offset;
+    uint8_t *rx_buffers[VENDOR_RX_BUFFER_NUM];
+    uint32_t rx_held;                   // Bit mask of buffers lent to the application, atomic access
+    SemaphoreHandle_t deinit_done;
+} tinyusb_vendor_t;
+
+static tinyusb_vendor_t *s_vendor[VENDOR_ITF_NUM];
+
+/* TinyUSB task side
+ ********************************************************************* */
+
+static void _tx_done(tinyusb_vendor_t *vendor, const vendor_tx_item_t *item, esp_err_t result)
+{
+    if (vendor->tx_done_cb) {
+        vendor->tx_done_cb(vendor->itf, item->buffer, item->len, result, vendor->user_arg);
+    }
+}
+
+static void tx_drain(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    tinyusb_vendor_t *vendor = s_vendor[itf];
+    if (vendor == NULL) {
+        return;
+    }
+    while (true) {
+        if (vendor->tx_current.buffer == NULL) {
+            if (xQueueReceive(vendor->tx_queue, &vendor->tx_current, 0) != pdTRUE) {
+                break;
+            }
+            vendor->tx_offset = 0;
+        }
+        const uint32_t available = tud_vendor_n_write_available(itf);
+        if (available == 0) {
+            break;  // Continued from tud_vendor_tx_cb()
+        }
+        const uint32_t chunk = MIN(available, vendor->tx_current.len - vendor->tx_offset);
+        vendor->tx_offset += tud_vendor_n_write(itf, vendor->tx_current.buffer + vendor->tx_offset, chunk);
+        if (vendor->tx_offset == vendor->tx_current.len) {
+            _tx_done(vendor, &vendor->tx_current, ESP_OK);
+            vendor->tx_current.buffer = NULL;
+        }
+    }
+    tud_vendor_n_write_flush(itf);
+}
+
+static int _rx_take_buffer(tinyusb_vendor_t *vendor)
+{
+    const uint32_t held = __atomic_load_n(&vendor->rx_held, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < VENDOR_RX_BUFFER_NUM; i++) {
+        if ((held & BIT(i)) == 0) {
+            // Only the TinyUSB task takes buffers, the application only releases them
+            __atomic_fetch_or(&vendor->rx_held, BIT(i), __ATOMIC_ACQ_REL);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void rx_drain(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    tinyusb_vendor_t *vendor = s_vendor[itf];
+    if (vendor == NULL) {
+        return;
+    }
+    // Data left in the FIFO when all buffers are lent makes TinyUSB NAK the OUT endpoint
+    while (tud_vendor_n_available(itf)) {
+        const int idx = _rx_take_buffer(vendor);
+        if (idx < 0) {
+            break;  // Continued from tinyusb_vendor_rx_done()
+        }
+        uint8_t *buffer = vendor->rx_buffers[idx];
+        const uint32_t len = tud_vendor_n_read(itf, buffer, VENDOR_RX_BUFFER_SIZE);
+        if (vendor->rx_cb) {
+            vendor->rx_cb(vendor->itf, buffer, len, vendor->user_arg);
+        } else {
+            __atomic_fetch_and(&vendor->rx_held, ~BIT(idx), __ATOMIC_ACQ_REL);
+        }
+    }
+}
+
+static void do_deinit(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    tinyusb_vendor_t *vendor = s_vendor[itf];
+    if (vendor == NULL) {
+        return;
+    }
+    s_vendor[itf] = NULL;
+    if (vendor->tx_current.buffer) {
+        _tx_done(vendor, &vendor->tx_current, ESP_ERR_INVALID_STATE);
+    }
+    vendor_tx_item_t item;
+    while (xQueueReceive(vendor->tx_queue, &item, 0) == pdTRUE) {
+        _tx_done(vendor, &item, ESP_ERR_INVALID_STATE);
+    }
+    xSemaphoreGive(vendor->deinit_done);
+}
+
+#if (TUSB_VERSION_MINOR >= 17)
+void tud_vendor_rx_cb(uint8_t itf, uint8_t const *buffer, uint16_t bufsize)
+#else
+void tud_vendor_rx_cb(uint8_t itf)
+#endif // TUSB_VERSION_MINOR
+{
+    // The data is read from the FIFO, so that it is received into the buffers of the interface
+    rx_drain((void *)(uintptr_t)itf);
+}
+
+void tud_vendor_tx_cb(uint8_t itf, uint32_t sent_bytes)
+{
+    (void) sent_bytes;
+    tx_drain((void *)(uintptr_t)itf);
+}
+
+/* Public API
+ ********************************************************************* */
+
+static void _vendor_free(tinyusb_vendor_t *vendor)
+{
+    for (int i = 0; i < VENDOR_RX_BUFFER_NUM; i++) {
+        free(vendor->rx_buffers[i]);
+    }
+    if (vendor->tx_queue) {
+        vQueueDelete(vendor->tx_queue);
+    }
+    if (vendor->deinit_done) {
+        vSemaphoreDelete(vendor->deinit_done);
+    }
+    free(vendor);
+}
+
+esp_err_t tinyusb_vendor_init(const tinyusb_config_vendor_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && config->itf < VENDOR_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    ESP_RETURN_ON_FALSE(s_vendor[config->itf] == NULL, ESP_ERR_INVALID_STATE, TAG, "Interface already initialized");
+
+    tinyusb_vendor_t *vendor = calloc(1, sizeof(tinyusb_vendor_t));
+    ESP_RETURN_ON_FALSE(vendor, ESP_ERR_NO_MEM, TAG, "No memory for vendor interface");
+    vendor->itf = config->itf;
+    vendor->tx_done_cb = config->tx_done_cb;
+    vendor->rx_cb = config->rx_cb;
+    vendor->user_arg = config->user_arg;
+
+    vendor->tx_queue = xQueueCreate(VENDOR_TX_QUEUE_SIZE, sizeof(vendor_tx_item_t));
+    vendor->deinit_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(vendor->tx_queue && vendor->deinit_done, ESP_ERR_NO_MEM, fail, TAG, "No memory for vendor queue");
+    for (int i = 0; i < VENDOR_RX_BUFFER_NUM; i++) {
+        vendor->rx_buffers[i] = malloc(VENDOR_RX_BUFFER_SIZE);
+        ESP_GOTO_ON_FALSE(vendor->rx_buffers[i], ESP_ERR_NO_MEM, fail, TAG, "No memory for vendor RX buffers");
+    }
+
+    s_vendor[config->itf] = vendor;
+    // Data may be waiting in the FIFO since enumeration
+    usbd_defer_func(rx_drain, (void *)(uintptr_t)config->itf, false);
+    return ESP_OK;
+
+fail:
+    _vendor_free(vendor);
+    return ret;
+}
+
+esp_err_t tinyusb_vendor_deinit(tinyusb_vendor_itf_t itf)
+{
+    ESP_RETURN_ON_FALSE(itf < VENDOR_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_vendor_t *vendor = s_vendor[itf];
+    ESP_RETURN_ON_FALSE(vendor, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+    ESP_RETURN_ON_FALSE(__atomic_load_n(&vendor->rx_held, __ATOMIC_ACQUIRE) == 0, ESP_ERR_INVALID_STATE, TAG,
+                        "Received buffers not returned");
+
+    // Queued writes are dropped in the TinyUSB task, which is the only user of the current write
+    usbd_defer_func(do_deinit, (void *)(uintptr_t)itf, false);
+    ESP_RETURN_ON_FALSE(xSemaphoreTake(vendor->deinit_done, pdMS_TO_TICKS(VENDOR_DEINIT_TIMEOUT_MS)) == pdTRUE,
+                        ESP_ERR_TIMEOUT, TAG, "TinyUSB task did not remove the interface");
+    _vendor_free(vendor);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_vendor_write_async(tinyusb_vendor_itf_t itf, const void *buffer, size_t len, TickType_t ticks_to_wait)
+{
+    ESP_RETURN_ON_FALSE(itf < VENDOR_ITF_NUM && buffer && len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_vendor_t *vendor = s_vendor[itf];
+    ESP_RETURN_ON_FALSE(vendor, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    const vendor_tx_item_t item = {
+        .buffer = buffer,
+        .len = len,
+    };
+    if (xQueueSend(vendor->tx_queue, &item, ticks_to_wait) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    usbd_defer_func(tx_drain, (void *)(uintptr_t)itf, false);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_vendor_rx_done(tinyusb_vendor_itf_t itf, void *buffer)
+{
+    ESP_RETURN_ON_FALSE(itf < VENDOR_ITF_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    tinyusb_vendor_t *vendor = s_vendor[itf];
+    ESP_RETURN_ON_FALSE(vendor, ESP_ERR_INVALID_STATE, TAG, "Interface not initialized");
+
+    for (int i = 0; i < VENDOR_RX_BUFFER_NUM; i++) {
+        if (vendor->rx_buffers[i] == buffer) {
+            const uint32_t held = __atomic_fetch_and(&vendor->rx_held, ~BIT(i), __ATOMIC_ACQ_REL);
+            ESP_RETURN_ON_FALSE(held & BIT(i), ESP_ERR_INVALID_ARG, TAG, "Buffer not held by the application");
+            usbd_defer_func(rx_drain, (void *)(uintptr_t)itf, false);
+            return ESP_OK;
+        }
+    }
+    ESP_LOGE(TAG, "Buffer not held by the application");
+    return ESP_ERR_INVALID_ARG;
+}
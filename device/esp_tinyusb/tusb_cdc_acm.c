@@ -10,25 +10,41 @@
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "tusb.h"
 #include "tusb_cdc_acm.h"
 #include "cdc.h"
+#include "stats.h"
 #include "sdkconfig.h"
+#if CONFIG_TINYUSB_EARLY_INIT || CONFIG_TINYUSB_CDC_RING_SIZE
+#include "device/usbd_pvt.h"
+#endif
 
 #ifndef MIN
 #define MIN(x, y) (((x) < (y)) ? (x) : (y))
 #endif
 
-// CDC-ACM spinlock
-static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
-#define CDC_ACM_ENTER_CRITICAL()   portENTER_CRITICAL(&cdc_acm_lock)
-#define CDC_ACM_EXIT_CRITICAL()    portEXIT_CRITICAL(&cdc_acm_lock)
+// CDC-ACM callbacks are published atomically, TinyUSB task reads them without locking
+#define CDC_ACM_ATOMIC_LOAD(x)          __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define CDC_ACM_ATOMIC_STORE(x, new_x)  __atomic_store_n(&(x), (new_x), __ATOMIC_RELEASE)
 
 typedef struct {
     tusb_cdcacm_callback_t callback_rx;
     tusb_cdcacm_callback_t callback_rx_wanted_char;
     tusb_cdcacm_callback_t callback_line_state_changed;
     tusb_cdcacm_callback_t callback_line_coding_changed;
+    tusb_cdcacm_callback_t callback_rx_internal; /*!< Internal receiver (CDC VFS), invoked besides callback_rx */
+    tusb_cdcacm_callback_t callback_tx_complete;
+    SemaphoreHandle_t tx_complete_sem; /*!< Given on TX transfer completion, wakes up blocking flush */
+    QueueHandle_t event_queue; /*!< If set, events are sent to this queue instead of invoking the callbacks */
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+    // TinyUSB FIFOs are private to its CDC driver, so the rings are exchanged with them in the TinyUSB task
+    tu_fifo_t tx_ring; /*!< Written by the application, moved to the TinyUSB TX FIFO by the TinyUSB task */
+    tu_fifo_t rx_ring; /*!< Filled from the TinyUSB RX FIFO by the TinyUSB task, read by the application */
+    bool rx_ring_active; /*!< Application reads through the RX ring, set by the first tinyusb_cdcacm_read_acquire() */
+    uint8_t tx_ring_buf[CONFIG_TINYUSB_CDC_RING_SIZE];
+    uint8_t rx_ring_buf[CONFIG_TINYUSB_CDC_RING_SIZE];
+#endif
 } esp_tusb_cdcacm_t; /*!< CDC_ACM object */
 
 static const char *TAG = "tusb_cdc_acm";
@@ -43,6 +59,143 @@ static inline esp_tusb_cdcacm_t *get_acm(tinyusb_cdcacm_itf_t itf)
 }
 
 
+#if CONFIG_TINYUSB_EARLY_INIT
+#define CDC_ACM_HELD(type)  (1U << (type))
+#define CDC_ACM_HOLDABLE    (CDC_ACM_HELD(CDC_EVENT_RX) | CDC_ACM_HELD(CDC_EVENT_LINE_STATE_CHANGED) | CDC_ACM_HELD(CDC_EVENT_LINE_CODING_CHANGED))
+
+// With the driver installed at startup the host talks to the ports before the application initializes them.
+// Events without receiver are held per port and delivered again from the current state, so they are coalesced.
+static uint8_t s_held_events[CFG_TUD_CDC];
+static cdc_line_coding_t s_held_line_coding[CFG_TUD_CDC];
+
+static void cdcacm_hold_event(uint8_t itf, cdcacm_event_type_t type)
+{
+    if (CDC_ACM_HELD(type) & CDC_ACM_HOLDABLE) {
+        __atomic_fetch_or(&s_held_events[itf], CDC_ACM_HELD(type), __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief Deliver held events of a port, in the TinyUSB task as all other events
+ */
+static void cdcacm_replay_events(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    const uint8_t held = __atomic_exchange_n(&s_held_events[itf], 0, __ATOMIC_RELAXED);
+    if (held & CDC_ACM_HELD(CDC_EVENT_LINE_CODING_CHANGED)) {
+        tud_cdc_n_get_line_coding(itf, &s_held_line_coding[itf]);
+        tud_cdc_line_coding_cb(itf, &s_held_line_coding[itf]);
+    }
+    if (held & CDC_ACM_HELD(CDC_EVENT_LINE_STATE_CHANGED)) {
+        const uint8_t state = tud_cdc_n_get_line_state(itf);
+        tud_cdc_line_state_cb(itf, state & TU_BIT(0), state & TU_BIT(1)); // DTR, RTS
+    }
+    if ((held & CDC_ACM_HELD(CDC_EVENT_RX)) && tud_cdc_n_available(itf)) {
+        tud_cdc_rx_cb(itf);
+    }
+}
+
+// Events that were held get delivered to the new receiver
+static void cdcacm_release_events(tinyusb_cdcacm_itf_t itf)
+{
+    if (__atomic_load_n(&s_held_events[itf], __ATOMIC_RELAXED)) {
+        usbd_defer_func(cdcacm_replay_events, (void *)(uintptr_t)itf, false);
+    }
+}
+#else
+#define cdcacm_hold_event(itf, type)
+#define cdcacm_release_events(itf)
+#endif // CONFIG_TINYUSB_EARLY_INIT
+
+/**
+ * @brief Deliver event to the user
+ *
+ * If an event queue is set, the event is sent to it without blocking, so the TinyUSB task
+ * never waits for the user. Otherwise the callback is invoked in the TinyUSB task.
+ */
+static void cdcacm_deliver_event(uint8_t itf, esp_tusb_cdcacm_t *acm, tusb_cdcacm_callback_t cb, cdcacm_event_t *event)
+{
+    QueueHandle_t queue = CDC_ACM_ATOMIC_LOAD(acm->event_queue);
+    if (queue) {
+        const tinyusb_cdcacm_event_msg_t msg = {
+            .itf = itf,
+            .event = *event,
+        };
+        if (xQueueSend(queue, &msg, 0) != pdTRUE) {
+            ESP_LOGD(TAG, "CDC no.%d event %d dropped, queue is full", itf, event->type);
+        }
+        return;
+    }
+    if (cb) {
+        TINYUSB_STATS_TIME_START(start);
+        cb(itf, event);
+        TINYUSB_STATS_SERVICE_END(cdc, start);
+    } else {
+        cdcacm_hold_event(itf, event->type);
+    }
+}
+
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+/**
+ * @brief Move committed data of the TX ring to the TinyUSB TX FIFO, as much as fits
+ *
+ * Runs in the TinyUSB task only, which is the one reader of the TX ring.
+ */
+static void cdcacm_tx_ring_drain(uint8_t itf, esp_tusb_cdcacm_t *acm)
+{
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_read_info(&acm->tx_ring, &info);
+    if (info.len_lin == 0) {
+        return;
+    }
+    uint32_t moved = tud_cdc_n_write(itf, info.ptr_lin, MIN(info.len_lin, tud_cdc_n_write_available(itf)));
+    if (moved == info.len_lin && info.len_wrap) {
+        moved += tud_cdc_n_write(itf, info.ptr_wrap, MIN(info.len_wrap, tud_cdc_n_write_available(itf)));
+    }
+    if (moved) {
+        tu_fifo_advance_read_pointer(&acm->tx_ring, moved);
+        tud_cdc_n_write_flush(itf);
+    }
+}
+
+/**
+ * @brief Move received data from the TinyUSB RX FIFO to the RX ring, as much as fits
+ *
+ * Runs in the TinyUSB task only, which is the one writer of the RX ring.
+ */
+static void cdcacm_rx_ring_fill(uint8_t itf, esp_tusb_cdcacm_t *acm)
+{
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_write_info(&acm->rx_ring, &info);
+    if (info.len_lin == 0 || tud_cdc_n_available(itf) == 0) {
+        return;
+    }
+    uint32_t moved = tud_cdc_n_read(itf, info.ptr_lin, info.len_lin);
+    if (moved == info.len_lin && info.len_wrap) {
+        moved += tud_cdc_n_read(itf, info.ptr_wrap, info.len_wrap);
+    }
+    tu_fifo_advance_write_pointer(&acm->rx_ring, moved);
+}
+
+static void cdcacm_tx_ring_drain_deferred(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (acm) {
+        cdcacm_tx_ring_drain(itf, acm);
+    }
+}
+
+static void cdcacm_rx_ring_fill_deferred(void *param)
+{
+    const uint8_t itf = (uint8_t)(uintptr_t)param;
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (acm) {
+        cdcacm_rx_ring_fill(itf, acm);
+    }
+}
+#endif // CONFIG_TINYUSB_CDC_RING_SIZE
+
 /* TinyUSB callbacks
    ********************************************************************* */
 
@@ -55,29 +208,27 @@ void tud_cdc_line_state_cb(uint8_t itf, bool dtr, bool rts)
             ESP_LOGV(TAG, "Host connected to CDC no.%d.", itf);
         } else {
             ESP_LOGW(TAG, "Host is connected to CDC no.%d, but it is not initialized. Initialize it using `tinyusb_cdc_init`.", itf);
+            cdcacm_hold_event(itf, CDC_EVENT_LINE_STATE_CHANGED);
             return;
         }
     } else { // disconnected
         if (acm != NULL) {
             ESP_LOGV(TAG, "Serial device is ready to connect to CDC no.%d", itf);
         } else {
+            cdcacm_hold_event(itf, CDC_EVENT_LINE_STATE_CHANGED);
             return;
         }
     }
     if (acm) {
-        CDC_ACM_ENTER_CRITICAL();
-        tusb_cdcacm_callback_t cb = acm->callback_line_state_changed;
-        CDC_ACM_EXIT_CRITICAL();
-        if (cb) {
-            cdcacm_event_t event = {
-                .type = CDC_EVENT_LINE_STATE_CHANGED,
-                .line_state_changed_data = {
-                    .dtr = dtr,
-                    .rts = rts
-                }
-            };
-            cb(itf, &event);
-        }
+        tusb_cdcacm_callback_t cb = CDC_ACM_ATOMIC_LOAD(acm->callback_line_state_changed);
+        cdcacm_event_t event = {
+            .type = CDC_EVENT_LINE_STATE_CHANGED,
+            .line_state_changed_data = {
+                .dtr = dtr,
+                .rts = rts
+            }
+        };
+        cdcacm_deliver_event(itf, acm, cb, &event);
     }
 }
 
@@ -86,15 +237,24 @@ void tud_cdc_rx_cb(uint8_t itf)
 {
     esp_tusb_cdcacm_t *acm = get_acm(itf);
     if (acm) {
-        CDC_ACM_ENTER_CRITICAL();
-        tusb_cdcacm_callback_t cb = acm->callback_rx;
-        CDC_ACM_EXIT_CRITICAL();
-        if (cb) {
-            cdcacm_event_t event = {
-                .type = CDC_EVENT_RX
-            };
-            cb(itf, &event);
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+        if (CDC_ACM_ATOMIC_LOAD(acm->rx_ring_active)) {
+            cdcacm_rx_ring_fill(itf, acm);
+        }
+#endif
+        tusb_cdcacm_callback_t cb = CDC_ACM_ATOMIC_LOAD(acm->callback_rx);
+        tusb_cdcacm_callback_t cb_internal = CDC_ACM_ATOMIC_LOAD(acm->callback_rx_internal);
+        cdcacm_event_t event = {
+            .type = CDC_EVENT_RX
+        };
+        if (cb_internal) {
+            TINYUSB_STATS_TIME_START(start);
+            cb_internal(itf, &event);
+            TINYUSB_STATS_SERVICE_END(cdc, start);
         }
+        cdcacm_deliver_event(itf, acm, cb, &event);
+    } else {
+        cdcacm_hold_event(itf, CDC_EVENT_RX);
     }
 }
 
@@ -103,18 +263,33 @@ void tud_cdc_line_coding_cb(uint8_t itf, cdc_line_coding_t const *p_line_coding)
 {
     esp_tusb_cdcacm_t *acm = get_acm(itf);
     if (acm) {
-        CDC_ACM_ENTER_CRITICAL();
-        tusb_cdcacm_callback_t cb = acm->callback_line_coding_changed;
-        CDC_ACM_EXIT_CRITICAL();
-        if (cb) {
-            cdcacm_event_t event = {
-                .type = CDC_EVENT_LINE_CODING_CHANGED,
-                .line_coding_changed_data = {
-                    .p_line_coding = p_line_coding,
-                }
-            };
-            cb(itf, &event);
-        }
+        tusb_cdcacm_callback_t cb = CDC_ACM_ATOMIC_LOAD(acm->callback_line_coding_changed);
+        cdcacm_event_t event = {
+            .type = CDC_EVENT_LINE_CODING_CHANGED,
+            .line_coding_changed_data = {
+                .p_line_coding = p_line_coding,
+            }
+        };
+        cdcacm_deliver_event(itf, acm, cb, &event);
+    } else {
+        cdcacm_hold_event(itf, CDC_EVENT_LINE_CODING_CHANGED);
+    }
+}
+
+// Invoked when a TX transfer is complete and space is available in the TX FIFO
+void tud_cdc_tx_complete_cb(uint8_t itf)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (acm) {
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+        cdcacm_tx_ring_drain(itf, acm);
+#endif
+        xSemaphoreGive(acm->tx_complete_sem);
+        tusb_cdcacm_callback_t cb = CDC_ACM_ATOMIC_LOAD(acm->callback_tx_complete);
+        cdcacm_event_t event = {
+            .type = CDC_EVENT_TX_COMPLETE
+        };
+        cdcacm_deliver_event(itf, acm, cb, &event);
     }
 }
 
@@ -123,18 +298,14 @@ void tud_cdc_rx_wanted_cb(uint8_t itf, char wanted_char)
 {
     esp_tusb_cdcacm_t *acm = get_acm(itf);
     if (acm) {
-        CDC_ACM_ENTER_CRITICAL();
-        tusb_cdcacm_callback_t cb = acm->callback_rx_wanted_char;
-        CDC_ACM_EXIT_CRITICAL();
-        if (cb) {
-            cdcacm_event_t event = {
-                .type = CDC_EVENT_RX_WANTED_CHAR,
-                .rx_wanted_char_data = {
-                    .wanted_char = wanted_char,
-                }
-            };
-            cb(itf, &event);
-        }
+        tusb_cdcacm_callback_t cb = CDC_ACM_ATOMIC_LOAD(acm->callback_rx_wanted_char);
+        cdcacm_event_t event = {
+            .type = CDC_EVENT_RX_WANTED_CHAR,
+            .rx_wanted_char_data = {
+                .wanted_char = wanted_char,
+            }
+        };
+        cdcacm_deliver_event(itf, acm, cb, &event);
     }
 }
 
@@ -146,24 +317,22 @@ esp_err_t tinyusb_cdcacm_register_callback(tinyusb_cdcacm_itf_t itf,
     if (acm) {
         switch (event_type) {
         case CDC_EVENT_RX:
-            CDC_ACM_ENTER_CRITICAL();
-            acm->callback_rx = callback;
-            CDC_ACM_EXIT_CRITICAL();
+            CDC_ACM_ATOMIC_STORE(acm->callback_rx, callback);
+            cdcacm_release_events(itf);
             return ESP_OK;
         case CDC_EVENT_RX_WANTED_CHAR:
-            CDC_ACM_ENTER_CRITICAL();
-            acm->callback_rx_wanted_char = callback;
-            CDC_ACM_EXIT_CRITICAL();
+            CDC_ACM_ATOMIC_STORE(acm->callback_rx_wanted_char, callback);
             return ESP_OK;
         case CDC_EVENT_LINE_STATE_CHANGED:
-            CDC_ACM_ENTER_CRITICAL();
-            acm->callback_line_state_changed = callback;
-            CDC_ACM_EXIT_CRITICAL();
+            CDC_ACM_ATOMIC_STORE(acm->callback_line_state_changed, callback);
+            cdcacm_release_events(itf);
             return ESP_OK;
         case CDC_EVENT_LINE_CODING_CHANGED:
-            CDC_ACM_ENTER_CRITICAL();
-            acm->callback_line_coding_changed = callback;
-            CDC_ACM_EXIT_CRITICAL();
+            CDC_ACM_ATOMIC_STORE(acm->callback_line_coding_changed, callback);
+            cdcacm_release_events(itf);
+            return ESP_OK;
+        case CDC_EVENT_TX_COMPLETE:
+            CDC_ACM_ATOMIC_STORE(acm->callback_tx_complete, callback);
             return ESP_OK;
         default:
             ESP_LOGE(TAG, "Wrong event type");
@@ -175,6 +344,20 @@ esp_err_t tinyusb_cdcacm_register_callback(tinyusb_cdcacm_itf_t itf,
     }
 }
 
+esp_err_t tinyusb_cdcacm_set_event_queue(tinyusb_cdcacm_itf_t itf, QueueHandle_t queue)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (!acm) {
+        ESP_LOGE(TAG, "CDC-ACM is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    CDC_ACM_ATOMIC_STORE(acm->event_queue, queue);
+    if (queue) {
+        cdcacm_release_events(itf);
+    }
+    return ESP_OK;
+}
+
 esp_err_t tinyusb_cdcacm_unregister_callback(tinyusb_cdcacm_itf_t itf,
         cdcacm_event_type_t event_type)
 {
@@ -185,24 +368,19 @@ esp_err_t tinyusb_cdcacm_unregister_callback(tinyusb_cdcacm_itf_t itf,
     }
     switch (event_type) {
     case CDC_EVENT_RX:
-        CDC_ACM_ENTER_CRITICAL();
-        acm->callback_rx = NULL;
-        CDC_ACM_EXIT_CRITICAL();
+        CDC_ACM_ATOMIC_STORE(acm->callback_rx, NULL);
         return ESP_OK;
     case CDC_EVENT_RX_WANTED_CHAR:
-        CDC_ACM_ENTER_CRITICAL();
-        acm->callback_rx_wanted_char = NULL;
-        CDC_ACM_EXIT_CRITICAL();
+        CDC_ACM_ATOMIC_STORE(acm->callback_rx_wanted_char, NULL);
         return ESP_OK;
     case CDC_EVENT_LINE_STATE_CHANGED:
-        CDC_ACM_ENTER_CRITICAL();
-        acm->callback_line_state_changed = NULL;
-        CDC_ACM_EXIT_CRITICAL();
+        CDC_ACM_ATOMIC_STORE(acm->callback_line_state_changed, NULL);
         return ESP_OK;
     case CDC_EVENT_LINE_CODING_CHANGED:
-        CDC_ACM_ENTER_CRITICAL();
-        acm->callback_line_coding_changed = NULL;
-        CDC_ACM_EXIT_CRITICAL();
+        CDC_ACM_ATOMIC_STORE(acm->callback_line_coding_changed, NULL);
+        return ESP_OK;
+    case CDC_EVENT_TX_COMPLETE:
+        CDC_ACM_ATOMIC_STORE(acm->callback_tx_complete, NULL);
         return ESP_OK;
     default:
         ESP_LOGE(TAG, "Wrong event type");
@@ -210,6 +388,17 @@ esp_err_t tinyusb_cdcacm_unregister_callback(tinyusb_cdcacm_itf_t itf,
     }
 }
 
+esp_err_t tinyusb_cdcacm_set_internal_rx_callback(tinyusb_cdcacm_itf_t itf, tusb_cdcacm_callback_t callback)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (!acm) {
+        ESP_LOGE(TAG, "CDC-ACM is not initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+    CDC_ACM_ATOMIC_STORE(acm->callback_rx_internal, callback);
+    return ESP_OK;
+}
+
 /*********************************************************************** TinyUSB callbacks*/
 /* CDC-ACM
    ********************************************************************* */
@@ -223,10 +412,83 @@ esp_err_t tinyusb_cdcacm_read(tinyusb_cdcacm_itf_t itf, uint8_t *out_buf, size_t
         *rx_data_size = 0;
     } else {
         *rx_data_size = tud_cdc_n_read(itf, out_buf, out_buf_sz);
+        TINYUSB_STATS_XFER(cdc[itf].rx, *rx_data_size);
     }
     return ESP_OK;
 }
 
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+esp_err_t tinyusb_cdcacm_write_acquire(tinyusb_cdcacm_itf_t itf, uint8_t **buf, size_t *size)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+    ESP_RETURN_ON_FALSE(buf && size, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_write_info(&acm->tx_ring, &info);
+    *buf = (uint8_t *)info.ptr_lin;
+    *size = info.len_lin;
+    if (info.len_lin == 0) {
+        TINYUSB_STATS_INC(cdc[itf].tx_fifo_full);
+    }
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_write_commit(tinyusb_cdcacm_itf_t itf, size_t size)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_write_info(&acm->tx_ring, &info);
+    ESP_RETURN_ON_FALSE(size <= info.len_lin, ESP_ERR_INVALID_SIZE, TAG, "Commit exceeds the acquired space");
+    if (size == 0) {
+        return ESP_OK;
+    }
+    tu_fifo_advance_write_pointer(&acm->tx_ring, size);
+    TINYUSB_STATS_XFER(cdc[itf].tx, size);
+    // The TinyUSB task is the only reader of the ring
+    usbd_defer_func(cdcacm_tx_ring_drain_deferred, (void *)(uintptr_t)itf, false);
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_read_acquire(tinyusb_cdcacm_itf_t itf, const uint8_t **buf, size_t *size)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+    ESP_RETURN_ON_FALSE(buf && size, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    if (!CDC_ACM_ATOMIC_LOAD(acm->rx_ring_active)) {
+        // Data received before the switch are still in the TinyUSB RX FIFO
+        CDC_ACM_ATOMIC_STORE(acm->rx_ring_active, true);
+        usbd_defer_func(cdcacm_rx_ring_fill_deferred, (void *)(uintptr_t)itf, false);
+    }
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_read_info(&acm->rx_ring, &info);
+    *buf = (const uint8_t *)info.ptr_lin;
+    *size = info.len_lin;
+    return ESP_OK;
+}
+
+esp_err_t tinyusb_cdcacm_read_commit(tinyusb_cdcacm_itf_t itf, size_t size)
+{
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    ESP_RETURN_ON_FALSE(acm, ESP_ERR_INVALID_STATE, TAG, "Interface is not initialized. Use `tinyusb_cdc_init` for initialization");
+
+    tu_fifo_buffer_info_t info;
+    tu_fifo_get_read_info(&acm->rx_ring, &info);
+    ESP_RETURN_ON_FALSE(size <= info.len_lin, ESP_ERR_INVALID_SIZE, TAG, "Commit exceeds the acquired data");
+    if (size == 0) {
+        return ESP_OK;
+    }
+    tu_fifo_advance_read_pointer(&acm->rx_ring, size);
+    TINYUSB_STATS_XFER(cdc[itf].rx, size);
+    // Received data might be waiting in the TinyUSB RX FIFO for the space, the TinyUSB task is the only writer of the ring
+    usbd_defer_func(cdcacm_rx_ring_fill_deferred, (void *)(uintptr_t)itf, false);
+    return ESP_OK;
+}
+#endif // CONFIG_TINYUSB_CDC_RING_SIZE
+
 size_t tinyusb_cdcacm_write_queue_char(tinyusb_cdcacm_itf_t itf, char ch)
 {
     if (!get_acm(itf)) { // non-initialized
@@ -241,7 +503,12 @@ size_t tinyusb_cdcacm_write_queue(tinyusb_cdcacm_itf_t itf, const uint8_t *in_bu
         return 0;
     }
     const uint32_t size_available = tud_cdc_n_write_available(itf);
-    return tud_cdc_n_write(itf, in_buf, MIN(in_size, size_available));
+    const size_t written = tud_cdc_n_write(itf, in_buf, MIN(in_size, size_available));
+    if (written < in_size) {
+        TINYUSB_STATS_INC(cdc[itf].tx_fifo_full);
+    }
+    TINYUSB_STATS_XFER(cdc[itf].tx, written);
+    return written;
 }
 
 static uint32_t tud_cdc_n_write_occupied(tinyusb_cdcacm_itf_t itf)
@@ -251,7 +518,8 @@ static uint32_t tud_cdc_n_write_occupied(tinyusb_cdcacm_itf_t itf)
 
 esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf, uint32_t timeout_ticks)
 {
-    if (!get_acm(itf)) { // non-initialized
+    esp_tusb_cdcacm_t *acm = get_acm(itf);
+    if (!acm) { // non-initialized
         return ESP_FAIL;
     }
 
@@ -274,9 +542,11 @@ esp_err_t tinyusb_cdcacm_write_flush(tinyusb_cdcacm_itf_t itf, uint32_t timeout_
             }
             if ( (ticks_now - ticks_start) > timeout_ticks ) { // Time is up
                 ESP_LOGW(TAG, "Flush failed");
+                TINYUSB_STATS_INC(cdc[itf].tx_flush_timeout);
                 return ESP_ERR_TIMEOUT;
             }
-            vTaskDelay(1);
+            // Wait for the ongoing transfer to complete, then flush the next part
+            xSemaphoreTake(acm->tx_complete_sem, timeout_ticks - (ticks_now - ticks_start) + 1);
         }
     }
     return ESP_OK;
@@ -288,10 +558,20 @@ static esp_err_t alloc_obj(tinyusb_cdcacm_itf_t itf)
     if (cdc_inst == NULL) {
         return ESP_FAIL;
     }
-    cdc_inst->subclass_obj = calloc(1, sizeof(esp_tusb_cdcacm_t));
-    if (cdc_inst->subclass_obj == NULL) {
+    esp_tusb_cdcacm_t *acm = calloc(1, sizeof(esp_tusb_cdcacm_t));
+    if (acm == NULL) {
+        return ESP_FAIL;
+    }
+    acm->tx_complete_sem = xSemaphoreCreateBinary();
+    if (acm->tx_complete_sem == NULL) {
+        free(acm);
         return ESP_FAIL;
     }
+#if CONFIG_TINYUSB_CDC_RING_SIZE
+    tu_fifo_config(&acm->tx_ring, acm->tx_ring_buf, CONFIG_TINYUSB_CDC_RING_SIZE, 1, false);
+    tu_fifo_config(&acm->rx_ring, acm->rx_ring_buf, CONFIG_TINYUSB_CDC_RING_SIZE, 1, false);
+#endif
+    cdc_inst->subclass_obj = acm;
     return ESP_OK;
 }
 
@@ -301,7 +581,9 @@ static esp_err_t obj_free(tinyusb_cdcacm_itf_t itf)
     if (cdc_inst == NULL || cdc_inst->subclass_obj == NULL) {
         return ESP_FAIL;
     }
-    free(cdc_inst->subclass_obj);
+    esp_tusb_cdcacm_t *acm = (esp_tusb_cdcacm_t *)cdc_inst->subclass_obj;
+    vSemaphoreDelete(acm->tx_complete_sem);
+    free(acm);
     return ESP_OK;
 }
 
@@ -0,0 +1,327 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "tusb.h"
+#include "tusb_cdc_bridge.h"
+#include "sdkconfig.h"
+
+#ifndef MIN
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+#endif
+
+#define CDC_BRIDGE_CHUNK_SIZE       (256)   // Bytes moved at once through the bounce buffer
+#define CDC_BRIDGE_CDC_QUEUE_LEN    (8)     // Events of all CDC ports, more are dropped and found by the retry sweep
+#define CDC_BRIDGE_RETRY_PERIOD     pdMS_TO_TICKS(CONFIG_TINYUSB_CDC_BRIDGE_RETRY_MS)
+#define CDC_BRIDGE_IDLE_PERIOD      pdMS_TO_TICKS(100)
+#define CDC_BRIDGE_STOP_ITF         (-1)    // Item of the CDC event queue that stops the task
+
+static const char *TAG = "tusb_cdc_bridge";
+
+typedef struct {
+    tusb_cdc_bridge_port_t cfg;
+    tusb_cdc_bridge_stats_t stats;
+    bool pending;                   // Data were left in a FIFO because the peer had no room
+} cdc_bridge_port_t;
+
+/**
+ * @brief State of the bridge task
+ *
+ * A single task serves all ports. It blocks on a queue set of the shared CDC event queue and of the UART
+ * event queues, and moves data of the port whose queue woke it up. Data that did not fit are moved
+ * by a sweep over all ports every retry period.
+ */
+typedef struct {
+    cdc_bridge_port_t *ports;
+    size_t port_count;
+    QueueHandle_t cdc_queue;        // Events of all bridged CDC ports, tinyusb_cdcacm_event_msg_t
+    QueueSetHandle_t queue_set;
+    TaskHandle_t task;
+    TaskHandle_t stopping;          // Task waiting in tusb_cdc_bridge_stop()
+    uint8_t chunk[CDC_BRIDGE_CHUNK_SIZE];
+} cdc_bridge_t;
+
+static cdc_bridge_t *s_bridge;
+static portMUX_TYPE s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static cdc_bridge_port_t *cdc_bridge_port_by_itf(cdc_bridge_t *bridge, int itf)
+{
+    for (size_t i = 0; i < bridge->port_count; i++) {
+        if ((int)bridge->ports[i].cfg.cdc_port == itf) {
+            return &bridge->ports[i];
+        }
+    }
+    return NULL;
+}
+
+static void cdc_bridge_apply_line_coding(const cdc_bridge_port_t *port, const cdc_line_coding_t *coding)
+{
+    const uart_port_t uart = port->cfg.uart_port;
+    if (coding->bit_rate) {
+        uart_set_baudrate(uart, coding->bit_rate);
+    }
+    if (coding->data_bits >= 5 && coding->data_bits <= 8) {
+        uart_set_word_length(uart, (uart_word_length_t)(UART_DATA_5_BITS + (coding->data_bits - 5)));
+    }
+    switch (coding->parity) {
+    case 0: uart_set_parity(uart, UART_PARITY_DISABLE); break;
+    case 1: uart_set_parity(uart, UART_PARITY_ODD); break;
+    case 2: uart_set_parity(uart, UART_PARITY_EVEN); break;
+    default: ESP_LOGW(TAG, "CDC no.%d: parity %d not supported by UART", port->cfg.cdc_port, coding->parity); break;
+    }
+    switch (coding->stop_bits) {
+    case 0: uart_set_stop_bits(uart, UART_STOP_BITS_1); break;
+    case 1: uart_set_stop_bits(uart, UART_STOP_BITS_1_5); break;
+    case 2: uart_set_stop_bits(uart, UART_STOP_BITS_2); break;
+    default: break;
+    }
+}
+
+/**
+ * @brief Move data of one port in both directions, only as much as the peer can take
+ *
+ * @return true if data were left in a FIFO
+ */
+static bool cdc_bridge_port_service(cdc_bridge_t *bridge, cdc_bridge_port_t *port)
+{
+    const uint8_t itf = port->cfg.cdc_port;
+    const uart_port_t uart = port->cfg.uart_port;
+    bool pending = false;
+
+    // CDC -> UART, data that do not fit into the UART TX buffer stay in the CDC RX FIFO,
+    // TinyUSB then NAKs the host instead of dropping data
+    for (;;) {
+        size_t uart_free = 0;
+        uart_get_tx_buffer_free_size(uart, &uart_free);
+        const uint32_t avail = tud_cdc_n_available(itf);
+        const size_t len = MIN(MIN((size_t)avail, uart_free), sizeof(bridge->chunk));
+        if (len == 0) {
+            pending |= (avail > 0);
+            break;
+        }
+        const uint32_t got = tud_cdc_n_read(itf, bridge->chunk, len);
+        uart_write_bytes(uart, bridge->chunk, got);
+        portENTER_CRITICAL(&s_stats_lock);
+        port->stats.to_uart += got;
+        portEXIT_CRITICAL(&s_stats_lock);
+    }
+
+    // UART -> CDC, data that do not fit into the CDC TX FIFO stay in the UART RX buffer
+    bool written = false;
+    for (;;) {
+        size_t uart_avail = 0;
+        uart_get_buffered_data_len(uart, &uart_avail);
+        const uint32_t cdc_free = tud_cdc_n_write_available(itf);
+        const size_t len = MIN(MIN(uart_avail, (size_t)cdc_free), sizeof(bridge->chunk));
+        if (len == 0) {
+            pending |= (uart_avail > 0);
+            break;
+        }
+        const int got = uart_read_bytes(uart, bridge->chunk, len, 0);
+        if (got <= 0) {
+            break;
+        }
+        tud_cdc_n_write(itf, bridge->chunk, got);
+        portENTER_CRITICAL(&s_stats_lock);
+        port->stats.to_usb += got;
+        portEXIT_CRITICAL(&s_stats_lock);
+        written = true;
+    }
+    if (written) {
+        tinyusb_cdcacm_write_flush(itf, 0);
+    }
+    return pending;
+}
+
+static void cdc_bridge_handle_cdc_event(cdc_bridge_t *bridge, const tinyusb_cdcacm_event_msg_t *msg)
+{
+    cdc_bridge_port_t *port = cdc_bridge_port_by_itf(bridge, msg->itf);
+    if (port == NULL) {
+        return;
+    }
+    if (msg->event.type == CDC_EVENT_LINE_CODING_CHANGED && port->cfg.line_coding) {
+        cdc_bridge_apply_line_coding(port, msg->event.line_coding_changed_data.p_line_coding);
+    }
+    // RX, TX complete: move the data, the other events carry no data but do not hurt
+    port->pending = cdc_bridge_port_service(bridge, port);
+}
+
+static void cdc_bridge_handle_uart_event(cdc_bridge_t *bridge, cdc_bridge_port_t *port)
+{
+    uart_event_t event;
+    if (xQueueReceive(port->cfg.uart_queue, &event, 0) != pdTRUE) {
+        return;
+    }
+    switch (event.type) {
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL:
+        // The driver keeps the buffered data, data arriving until they are read are lost
+        portENTER_CRITICAL(&s_stats_lock);
+        port->stats.uart_overflows++;
+        portEXIT_CRITICAL(&s_stats_lock);
+        break;
+    default:
+        break;
+    }
+    port->pending = cdc_bridge_port_service(bridge, port);
+}
+
+static void cdc_bridge_task(void *arg)
+{
+    cdc_bridge_t *bridge = (cdc_bridge_t *)arg;
+    bool pending = false;
+    for (;;) {
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(bridge->queue_set,
+                                                            pending ? CDC_BRIDGE_RETRY_PERIOD : CDC_BRIDGE_IDLE_PERIOD);
+        if (member == bridge->cdc_queue) {
+            tinyusb_cdcacm_event_msg_t msg;
+            if (xQueueReceive(bridge->cdc_queue, &msg, 0) == pdTRUE) {
+                if (msg.itf == CDC_BRIDGE_STOP_ITF) {
+                    break;
+                }
+                cdc_bridge_handle_cdc_event(bridge, &msg);
+            }
+        } else if (member) {
+            for (size_t i = 0; i < bridge->port_count; i++) {
+                if (member == bridge->ports[i].cfg.uart_queue) {
+                    cdc_bridge_handle_uart_event(bridge, &bridge->ports[i]);
+                    break;
+                }
+            }
+        } else {
+            // Timeout: dropped CDC events and data held back by a full peer are found by the sweep
+            for (size_t i = 0; i < bridge->port_count; i++) {
+                bridge->ports[i].pending = cdc_bridge_port_service(bridge, &bridge->ports[i]);
+            }
+        }
+        pending = false;
+        for (size_t i = 0; i < bridge->port_count; i++) {
+            pending |= bridge->ports[i].pending;
+        }
+    }
+    xTaskNotifyGive(bridge->stopping);
+    vTaskSuspend(NULL);
+}
+
+static void cdc_bridge_free(cdc_bridge_t *bridge)
+{
+    for (size_t i = 0; i < bridge->port_count; i++) {
+        tinyusb_cdcacm_set_event_queue(bridge->ports[i].cfg.cdc_port, NULL);
+    }
+    if (bridge->queue_set) {
+        // A queue can be removed from a set only if it is empty
+        xQueueReset(bridge->cdc_queue);
+        xQueueRemoveFromSet(bridge->cdc_queue, bridge->queue_set);
+        for (size_t i = 0; i < bridge->port_count; i++) {
+            xQueueReset(bridge->ports[i].cfg.uart_queue);
+            xQueueRemoveFromSet(bridge->ports[i].cfg.uart_queue, bridge->queue_set);
+        }
+        vQueueDelete(bridge->queue_set);
+    }
+    if (bridge->cdc_queue) {
+        vQueueDelete(bridge->cdc_queue);
+    }
+    free(bridge->ports);
+    free(bridge);
+}
+
+esp_err_t tusb_cdc_bridge_start(const tusb_cdc_bridge_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && config->ports, ESP_ERR_INVALID_ARG, TAG, "Invalid config");
+    ESP_RETURN_ON_FALSE(config->port_count > 0 && config->port_count <= CONFIG_TINYUSB_CDC_COUNT,
+                        ESP_ERR_INVALID_ARG, TAG, "Port count must be 1 to %d", CONFIG_TINYUSB_CDC_COUNT);
+    ESP_RETURN_ON_FALSE(s_bridge == NULL, ESP_ERR_INVALID_STATE, TAG, "Bridge already started");
+    for (size_t i = 0; i < config->port_count; i++) {
+        const tusb_cdc_bridge_port_t *port = &config->ports[i];
+        ESP_RETURN_ON_FALSE(port->uart_queue, ESP_ERR_INVALID_ARG, TAG, "Port %d: UART event queue is NULL", (int)i);
+        ESP_RETURN_ON_FALSE(tusb_cdc_acm_initialized(port->cdc_port), ESP_ERR_INVALID_STATE, TAG,
+                            "CDC no.%d is not initialized", port->cdc_port);
+        for (size_t j = 0; j < i; j++) {
+            ESP_RETURN_ON_FALSE(config->ports[j].cdc_port != port->cdc_port && config->ports[j].uart_port != port->uart_port,
+                                ESP_ERR_INVALID_ARG, TAG, "Port %d: CDC port or UART bridged twice", (int)i);
+        }
+    }
+
+    cdc_bridge_t *bridge = calloc(1, sizeof(cdc_bridge_t));
+    ESP_RETURN_ON_FALSE(bridge, ESP_ERR_NO_MEM, TAG, "Bridge allocation failed");
+    bridge->ports = calloc(config->port_count, sizeof(cdc_bridge_port_t));
+    ESP_GOTO_ON_FALSE(bridge->ports, ESP_ERR_NO_MEM, fail, TAG, "Ports allocation failed");
+    for (size_t i = 0; i < config->port_count; i++) {
+        bridge->ports[i].cfg = config->ports[i];
+    }
+
+    bridge->cdc_queue = xQueueCreate(CDC_BRIDGE_CDC_QUEUE_LEN, sizeof(tinyusb_cdcacm_event_msg_t));
+    ESP_GOTO_ON_FALSE(bridge->cdc_queue, ESP_ERR_NO_MEM, fail, TAG, "CDC event queue allocation failed");
+    UBaseType_t set_len = CDC_BRIDGE_CDC_QUEUE_LEN;
+    for (size_t i = 0; i < config->port_count; i++) {
+        set_len += uxQueueSpacesAvailable(config->ports[i].uart_queue) + uxQueueMessagesWaiting(config->ports[i].uart_queue);
+    }
+    bridge->queue_set = xQueueCreateSet(set_len);
+    ESP_GOTO_ON_FALSE(bridge->queue_set, ESP_ERR_NO_MEM, fail, TAG, "Queue set allocation failed");
+    // Only empty queues can be added to a set, events received so far are dropped, the first sweep moves their data
+    xQueueAddToSet(bridge->cdc_queue, bridge->queue_set);
+    for (size_t i = 0; i < config->port_count; i++) {
+        xQueueReset(config->ports[i].uart_queue);
+        xQueueAddToSet(config->ports[i].uart_queue, bridge->queue_set);
+    }
+    bridge->port_count = config->port_count;
+    for (size_t i = 0; i < config->port_count; i++) {
+        tinyusb_cdcacm_set_event_queue(config->ports[i].cdc_port, bridge->cdc_queue);
+    }
+
+    s_bridge = bridge;
+    if (xTaskCreate(cdc_bridge_task, "tusb_cdc_bridge", CONFIG_TINYUSB_CDC_BRIDGE_TASK_STACK_SIZE, bridge,
+                    CONFIG_TINYUSB_CDC_BRIDGE_TASK_PRIORITY, &bridge->task) != pdPASS) {
+        s_bridge = NULL;
+        ESP_GOTO_ON_FALSE(false, ESP_ERR_NO_MEM, fail, TAG, "Task creation failed");
+    }
+    ESP_LOGI(TAG, "Bridging %d CDC port(s)", (int)bridge->port_count);
+    return ESP_OK;
+
+fail:
+    cdc_bridge_free(bridge);
+    return ret;
+}
+
+esp_err_t tusb_cdc_bridge_stop(void)
+{
+    cdc_bridge_t *bridge = s_bridge;
+    ESP_RETURN_ON_FALSE(bridge, ESP_ERR_INVALID_STATE, TAG, "Bridge not started");
+    // CDC ports stop sending events first, so the stop message is not lost in a full queue
+    for (size_t i = 0; i < bridge->port_count; i++) {
+        tinyusb_cdcacm_set_event_queue(bridge->ports[i].cfg.cdc_port, NULL);
+    }
+    bridge->stopping = xTaskGetCurrentTaskHandle();
+    const tinyusb_cdcacm_event_msg_t stop = {
+        .itf = CDC_BRIDGE_STOP_ITF,
+    };
+    xQueueSend(bridge->cdc_queue, &stop, portMAX_DELAY);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    vTaskDelete(bridge->task);
+    s_bridge = NULL;
+    cdc_bridge_free(bridge);
+    return ESP_OK;
+}
+
+esp_err_t tusb_cdc_bridge_get_stats(tinyusb_cdcacm_itf_t cdc_port, tusb_cdc_bridge_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    cdc_bridge_t *bridge = s_bridge;
+    ESP_RETURN_ON_FALSE(bridge, ESP_ERR_INVALID_STATE, TAG, "Bridge not started");
+    const cdc_bridge_port_t *port = cdc_bridge_port_by_itf(bridge, cdc_port);
+    ESP_RETURN_ON_FALSE(port, ESP_ERR_INVALID_ARG, TAG, "CDC no.%d is not bridged", cdc_port);
+    portENTER_CRITICAL(&s_stats_lock);
+    *stats = port->stats;
+    portEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
@@ -7,12 +7,22 @@
 
 #include <stdio.h>
 #include <stdio_ext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <sys/stat.h>
 #include "esp_log.h"
 #include "cdc.h"
 #include "tusb_console.h"
 #include "tinyusb.h"
 #include "vfs_tinyusb.h"
 #include "esp_check.h"
+#if CONFIG_TINYUSB_CONSOLE_ASYNC
+#include "esp_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#endif
 
 #define STRINGIFY(s) STRINGIFY2(s)
 #define STRINGIFY2(s) #s
@@ -27,6 +37,224 @@ typedef struct {
 
 static console_handle_t con;
 
+#if CONFIG_TINYUSB_CONSOLE_ASYNC
+#define CONSOLE_RING_PATH       "/dev/tusb_con"
+#define CONSOLE_RING_SIZE       CONFIG_TINYUSB_CONSOLE_RING_SIZE
+#define CONSOLE_RING_MASK       (CONSOLE_RING_SIZE - 1)
+#define CONSOLE_RECORD_MAX      (CONSOLE_RING_SIZE / 4) // Longer writes are split into several records
+#define CONSOLE_RECORD_READY    (1UL << 31)             // Header bit, the record is written
+#define CONSOLE_RECORD_PAD      (1UL << 30)             // Header bit, skip to the start of the ring
+#define CONSOLE_RECORD_LEN_MASK (CONSOLE_RECORD_PAD - 1)
+#define CONSOLE_ALIGN(len)      (((len) + 3) & ~3UL)
+#define CONSOLE_DRAIN_PERIOD    pdMS_TO_TICKS(10)
+
+_Static_assert((CONSOLE_RING_SIZE & CONSOLE_RING_MASK) == 0, "CONFIG_TINYUSB_CONSOLE_RING_SIZE must be a power of two");
+
+/**
+ * @brief Multi-producer log ring
+ *
+ * Writers reserve a record by moving `reserve` with compare-and-swap, copy the data
+ * and mark the record ready in its 32-bit header. The drain task sends ready records in order,
+ * clears them and moves `tail`. A writer which does not fit drops its data, so no one waits.
+ */
+typedef struct {
+    uint8_t *ring;              // CONSOLE_RING_SIZE bytes, 4-byte aligned
+    uint32_t reserve;           // Free running position of the next record, moved by writers
+    uint32_t tail;              // Free running position of the oldest record, moved by the drain task
+    uint32_t dropped;           // Bytes dropped because the ring was full
+    int cdc_intf;
+    bool stop;
+    SemaphoreHandle_t stopped;
+} console_ring_t;
+
+static console_ring_t s_con_ring;
+
+/**
+ * @brief Copy data to the ring record with newline conversion of the console
+ *
+ * @return Length of the converted data, if dest is NULL only the length is computed
+ */
+static size_t console_ring_convert(uint8_t *dest, const uint8_t *src, size_t size)
+{
+    size_t len = 0;
+    for (size_t i = 0; i < size; i++) {
+#if CONFIG_NEWLIB_STDOUT_LINE_ENDING_CRLF
+        if (src[i] == '\n') {
+            if (dest) {
+                dest[len] = '\r';
+            }
+            len++;
+        }
+#elif CONFIG_NEWLIB_STDOUT_LINE_ENDING_CR
+        if (src[i] == '\n') {
+            if (dest) {
+                dest[len] = '\r';
+            }
+            len++;
+            continue;
+        }
+#endif
+        if (dest) {
+            dest[len] = src[i];
+        }
+        len++;
+    }
+    return len;
+}
+
+static void console_ring_put(const uint8_t *data, size_t size)
+{
+    const size_t len = console_ring_convert(NULL, data, size);
+    const uint32_t need = sizeof(uint32_t) + CONSOLE_ALIGN(len);
+    uint32_t pos = __atomic_load_n(&s_con_ring.reserve, __ATOMIC_RELAXED);
+    uint32_t pad;
+    do {
+        // A record is contiguous, if it does not fit before the end of the ring, pad the rest
+        const uint32_t offset = pos & CONSOLE_RING_MASK;
+        pad = (offset + need > CONSOLE_RING_SIZE) ? CONSOLE_RING_SIZE - offset : 0;
+        if (pos + pad + need - __atomic_load_n(&s_con_ring.tail, __ATOMIC_ACQUIRE) > CONSOLE_RING_SIZE) {
+            __atomic_fetch_add(&s_con_ring.dropped, size, __ATOMIC_RELAXED);
+            return;
+        }
+    } while (!__atomic_compare_exchange_n(&s_con_ring.reserve, &pos, pos + pad + need, true,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_RELAXED));
+
+    if (pad) {
+        uint32_t *pad_header = (uint32_t *)&s_con_ring.ring[pos & CONSOLE_RING_MASK];
+        __atomic_store_n(pad_header, pad | CONSOLE_RECORD_PAD | CONSOLE_RECORD_READY, __ATOMIC_RELEASE);
+    }
+    uint8_t *record = &s_con_ring.ring[(pos + pad) & CONSOLE_RING_MASK];
+    console_ring_convert(record + sizeof(uint32_t), data, size);
+    __atomic_store_n((uint32_t *)record, len | CONSOLE_RECORD_READY, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief This thread sends ready records of the log ring to the host
+ */
+static void console_drain_task(void *arg)
+{
+    (void) arg;
+    size_t sent = 0; // Part of the oldest record already sent
+    while (!__atomic_load_n(&s_con_ring.stop, __ATOMIC_ACQUIRE)) {
+        const uint32_t offset = s_con_ring.tail & CONSOLE_RING_MASK;
+        const uint32_t header = __atomic_load_n((uint32_t *)&s_con_ring.ring[offset], __ATOMIC_ACQUIRE);
+        if (!(header & CONSOLE_RECORD_READY)) {
+            // Ring is empty or the oldest record is still being written, send what we have
+            tud_cdc_n_write_flush(s_con_ring.cdc_intf);
+            vTaskDelay(CONSOLE_DRAIN_PERIOD);
+            continue;
+        }
+        const uint32_t len = header & CONSOLE_RECORD_LEN_MASK;
+        uint32_t record_len = len;
+        if (!(header & CONSOLE_RECORD_PAD)) {
+            const uint8_t *data = &s_con_ring.ring[offset + sizeof(uint32_t)];
+            sent += tud_cdc_n_write(s_con_ring.cdc_intf, data + sent, len - sent);
+            if (sent < len) {
+                // CDC FIFO is full, the host is not reading fast enough
+                tud_cdc_n_write_flush(s_con_ring.cdc_intf);
+                vTaskDelay(1);
+                continue;
+            }
+            record_len = sizeof(uint32_t) + CONSOLE_ALIGN(len);
+        }
+        // Clear the record, so that no stale header is found in the next round of the ring
+        memset(&s_con_ring.ring[offset], 0, record_len);
+        sent = 0;
+        __atomic_store_n(&s_con_ring.tail, s_con_ring.tail + record_len, __ATOMIC_RELEASE);
+    }
+    xSemaphoreGive(s_con_ring.stopped);
+    vTaskDelete(NULL);
+}
+
+static ssize_t console_ring_write(int fd, const void *data, size_t size)
+{
+    (void) fd;
+    const uint8_t *src = data;
+    for (size_t done = 0; done < size; done += CONSOLE_RECORD_MAX / 2) {
+        // Half of the record, as newline conversion can double the length
+        console_ring_put(src + done, MIN(size - done, CONSOLE_RECORD_MAX / 2));
+    }
+    return size;
+}
+
+static int console_ring_open(const char *path, int flags, int mode)
+{
+    (void) path;
+    (void) flags;
+    (void) mode;
+    return 0;
+}
+
+static int console_ring_close(int fd)
+{
+    (void) fd;
+    return 0;
+}
+
+static int console_ring_fstat(int fd, struct stat *st)
+{
+    (void) fd;
+    memset(st, 0, sizeof(*st));
+    st->st_mode = S_IFCHR;
+    return 0;
+}
+
+static void console_ring_free(void)
+{
+    if (s_con_ring.stopped) {
+        vSemaphoreDelete(s_con_ring.stopped);
+    }
+    free(s_con_ring.ring);
+    memset(&s_con_ring, 0, sizeof(s_con_ring));
+}
+
+static esp_err_t console_ring_start(int cdc_intf)
+{
+    s_con_ring.ring = calloc(1, CONSOLE_RING_SIZE);
+    s_con_ring.stopped = xSemaphoreCreateBinary();
+    s_con_ring.cdc_intf = cdc_intf;
+    if (s_con_ring.ring == NULL || s_con_ring.stopped == NULL) {
+        console_ring_free();
+        ESP_LOGE(TAG, "Failed to allocate log ring");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_vfs_t vfs = {
+        .flags = ESP_VFS_FLAG_DEFAULT,
+        .close = &console_ring_close,
+        .fstat = &console_ring_fstat,
+        .open = &console_ring_open,
+        .write = &console_ring_write,
+    };
+    if (esp_vfs_register(CONSOLE_RING_PATH, &vfs, NULL) != ESP_OK) {
+        console_ring_free();
+        ESP_LOGE(TAG, "Failed to register log ring VFS");
+        return ESP_FAIL;
+    }
+    if (xTaskCreate(console_drain_task, "tusb_con", CONFIG_TINYUSB_CONSOLE_DRAIN_TASK_STACK_SIZE, NULL,
+                    CONFIG_TINYUSB_CONSOLE_DRAIN_TASK_PRIORITY, NULL) != pdPASS) {
+        esp_vfs_unregister(CONSOLE_RING_PATH);
+        console_ring_free();
+        ESP_LOGE(TAG, "Failed to create log drain task");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void console_ring_stop(void)
+{
+    __atomic_store_n(&s_con_ring.stop, true, __ATOMIC_RELEASE);
+    xSemaphoreTake(s_con_ring.stopped, portMAX_DELAY);
+    esp_vfs_unregister(CONSOLE_RING_PATH);
+    console_ring_free();
+}
+
+size_t esp_tusb_console_get_dropped(void)
+{
+    return __atomic_load_n(&s_con_ring.dropped, __ATOMIC_RELAXED);
+}
+#endif // CONFIG_TINYUSB_CONSOLE_ASYNC
+
 
 /**
  * @brief Reopen standard streams using a new path
@@ -103,13 +331,27 @@ esp_err_t esp_tusb_init_console(int cdc_intf)
 {
     /* Registering TUSB at VFS */
     ESP_RETURN_ON_ERROR(esp_vfs_tusb_cdc_register(cdc_intf, NULL), TAG, "");
+#if CONFIG_TINYUSB_CONSOLE_ASYNC
+    // Input is read by the CDC VFS, output goes through the log ring
+    esp_err_t ret = console_ring_start(cdc_intf);
+    if (ret != ESP_OK) {
+        esp_vfs_tusb_cdc_unregister(NULL);
+        return ret;
+    }
+    ESP_RETURN_ON_ERROR(redirect_std_streams_to(&con.in, NULL, NULL, VFS_TUSB_PATH_DEFAULT), TAG, "Failed to redirect STD streams");
+    ESP_RETURN_ON_ERROR(redirect_std_streams_to(NULL, &con.out, &con.err, CONSOLE_RING_PATH), TAG, "Failed to redirect STD streams");
+#else
     ESP_RETURN_ON_ERROR(redirect_std_streams_to(&con.in, &con.out, &con.err, VFS_TUSB_PATH_DEFAULT), TAG, "Failed to redirect STD streams");
+#endif
     return ESP_OK;
 }
 
 esp_err_t esp_tusb_deinit_console(int cdc_intf)
 {
     ESP_RETURN_ON_ERROR(restore_std_streams(&con.in, &con.out, &con.err), TAG, "Failed to restore STD streams");
+#if CONFIG_TINYUSB_CONSOLE_ASYNC
+    console_ring_stop();
+#endif
     esp_vfs_tusb_cdc_unregister(NULL);
     return ESP_OK;
 }
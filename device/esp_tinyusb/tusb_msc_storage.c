@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdio.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_err.h"
@@ -14,12 +15,17 @@
 #include "wear_levelling.h"
 #include "esp_partition.h"
 #include "esp_memory_utils.h"
+#include "spi_flash_mmap.h"
 #include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "vfs_fat_internal.h"
 #include "tinyusb.h"
-#include "device/usbd_pvt.h"
 #include "class/msc/msc_device.h"
 #include "tusb_msc_storage.h"
+#include "stats.h"
 #if SOC_SDMMC_HOST_SUPPORTED
 #include "diskio_sdmmc.h"
 #endif
@@ -27,17 +33,32 @@
 static const char *TAG = "tinyusb_msc_storage";
 
 #define MSC_STORAGE_MEM_ALIGN 4
+#if CONFIG_CACHE_L1_CACHE_LINE_SIZE
+// Storage drivers DMA directly from/to cache line aligned buffers, otherwise they bounce the data through a temporary one
+#define MSC_STORAGE_DMA_ALIGN CONFIG_CACHE_L1_CACHE_LINE_SIZE
+#else
+#define MSC_STORAGE_DMA_ALIGN MSC_STORAGE_MEM_ALIGN
+#endif
 #define MSC_STORAGE_BUFFER_SIZE CONFIG_TINYUSB_MSC_BUFSIZE /*!< Size of the buffer, configured via menuconfig (MSC FIFO size) */
+#define MSC_STORAGE_BUFFER_NUM CONFIG_TINYUSB_MSC_BUFFER_NUM /*!< Number of write buffers, configured via menuconfig */
+#define MSC_STORAGE_BUFFER_WAIT_TICKS 1 /*!< Time to wait for a free write buffer before asking TinyUSB to retry */
+#define MSC_STORAGE_READ_AHEAD_SIZE CONFIG_TINYUSB_MSC_READ_AHEAD_SIZE /*!< Size of the read ahead buffer, 0 if disabled */
+#define MSC_STORAGE_COALESCE_TIMEOUT_TICKS pdMS_TO_TICKS(CONFIG_TINYUSB_MSC_WRITE_COALESCE_TIMEOUT_MS) /*!< Time to wait for contiguous data before writing */
+#define MSC_STORAGE_LUN_NUM CONFIG_TINYUSB_MSC_LUN_NUM /*!< Number of logical units, configured via menuconfig */
 
 #if ((MSC_STORAGE_BUFFER_SIZE) % MSC_STORAGE_MEM_ALIGN != 0)
 #error "CONFIG_TINYUSB_MSC_BUFSIZE must be divisible by MSC_STORAGE_MEM_ALIGN. Adjust your configuration (MSC FIFO size) in menuconfig."
 #endif
 
+#if ((MSC_STORAGE_READ_AHEAD_SIZE) % MSC_STORAGE_MEM_ALIGN != 0)
+#error "CONFIG_TINYUSB_MSC_READ_AHEAD_SIZE must be divisible by MSC_STORAGE_MEM_ALIGN. Adjust your configuration (MSC read ahead size) in menuconfig."
+#endif
+
 /**
  * @brief Structure representing a single write buffer for MSC operations.
  */
 typedef struct {
-    uint8_t data_buffer[MSC_STORAGE_BUFFER_SIZE]; /*!< Buffer to store write data. The size is defined by MSC_STORAGE_BUFFER_SIZE. */
+    uint8_t *data_buffer;                  /*!< Buffer to store write data, MSC_STORAGE_BUFFER_SIZE bytes in the storage data of the handle. */
     uint32_t lba;                          /*!< Logical Block Address for the current WRITE10 operation. */
     uint32_t offset;                       /*!< Offset within the specified LBA for the current write operation. */
     uint32_t bufsize;                      /*!< Number of bytes to be written in this operation. */
@@ -47,48 +68,84 @@ typedef struct {
  * @brief Handle for TinyUSB MSC storage interface.
  *
  * This structure holds metadata and function pointers required to
- * manage the underlying storage medium (SPI flash, SDMMC).
+ * manage the underlying storage medium (SPI flash, SDMMC) of one LUN.
+ * Every LUN has its own write buffers and writer task.
  */
-typedef struct {
-    msc_storage_buffer_t storage_buffer;
+typedef struct tinyusb_msc_storage_handle_s {
+    uint8_t storage_data[MSC_STORAGE_BUFFER_NUM * MSC_STORAGE_BUFFER_SIZE] __attribute__((aligned(MSC_STORAGE_DMA_ALIGN))); /*!< Data of all write buffers, consecutive buffers are adjacent. */
+    msc_storage_buffer_t storage_buffer[MSC_STORAGE_BUFFER_NUM]; /*!< Ring of write buffers, filled by TinyUSB task and written by writer task. */
+#if MSC_STORAGE_READ_AHEAD_SIZE
+    uint8_t read_ahead_data[MSC_STORAGE_READ_AHEAD_SIZE] __attribute__((aligned(MSC_STORAGE_DMA_ALIGN))); /*!< Data of the read ahead buffer. */
+    msc_storage_buffer_t read_ahead;      /*!< Sectors read ahead by writer task, bufsize is 0 if there are none. */
+    bool read_ahead_pending;              /*!< Read ahead was requested and read_ahead_done was not taken yet. */
+    SemaphoreHandle_t read_ahead_done;    /*!< Given by writer task after the read ahead. */
+    uint64_t read_next_addr;              /*!< Address following the last READ10 data, to detect sequential reads. */
+#endif
+    uint32_t buffer_head;                 /*!< Index of the next buffer to be filled by WRITE10. */
+    bool write_failed;                    /*!< A write of the writer task failed and was not reported to the host yet. */
+#if !CONFIG_TINYUSB_MSC_WRITE_BACK
+    msc_storage_buffer_t *write_through_pending; /*!< Queued WRITE10 data, TinyUSB retries the callback until it is written. */
+#endif
+    SemaphoreHandle_t buffer_free;        /*!< Counting semaphore of free write buffers. */
+    SemaphoreHandle_t flush_mutex;        /*!< Serializes waiting for all pending writes. */
+    bool flush_requested;                 /*!< READ10 queued a flush request and waits for the writes without blocking. */
+    QueueHandle_t write_queue;            /*!< Filled buffers waiting for the writer task. */
+    TaskHandle_t writer_task;             /*!< Task writing filled buffers to the storage medium. */
     bool is_fat_mounted;                  /*!< Indicates if the FAT filesystem is currently mounted. */
+    bool shared_access;                   /*!< FATFS stays registered with read-only access while the host has the storage. */
+    bool read_only;                       /*!< Storage is write protected for both the host and the application. */
+    bool direct_access;                   /*!< Storage is memory, READ10 and WRITE10 bypass the read ahead and write buffers. */
+    bool host_access;                     /*!< FATFS is registered, but the host has the storage (shared access only). */
+    volatile bool host_changed;           /*!< Host wrote to the storage since FATFS last read it (shared access only). */
+    BYTE shared_pdrv;                     /*!< FATFS drive of the shared access diskio. */
+    uint8_t lun;                          /*!< Logical unit number of the storage. */
     const char *base_path;                /*!< Base path where the filesystem is mounted. */
+    char default_base_path[ESP_VFS_PATH_MAX + 1]; /*!< Base path if the application did not provide one. */
     union {
         wl_handle_t wl_handle;            /*!< Handle for wear leveling on SPI flash. */
+        struct {
+            const esp_partition_t *partition;         /*!< Raw SPI flash partition of the read-only storage. */
+            const uint8_t *mmap_data;                 /*!< The partition mapped to the address space. */
+            esp_partition_mmap_handle_t mmap_handle;  /*!< Handle to unmap the partition. */
+        };
+        struct {
+            uint8_t *ramdisk_data;                    /*!< Memory of the RAM disk storage. */
+            bool ramdisk_owned;                       /*!< Memory was allocated by the driver and is freed on deinit. */
+        };
 #if SOC_SDMMC_HOST_SUPPORTED
         sdmmc_card_t *card;               /*!< Handle for SDMMC card. */
 #endif
     };
-    esp_err_t (*mount)(BYTE pdrv);        /*!< Pointer to the mount function. */
-    esp_err_t (*unmount)(void);           /*!< Pointer to the unmount function. */
+    esp_err_t (*mount)(struct tinyusb_msc_storage_handle_s *handle, BYTE pdrv); /*!< Pointer to the mount function. */
+    esp_err_t (*unmount)(struct tinyusb_msc_storage_handle_s *handle);          /*!< Pointer to the unmount function. */
     uint32_t sector_count;                /*!< Total number of sectors in the storage medium. */
     uint32_t sector_size;                 /*!< Size of a single sector in bytes. */
-    esp_err_t (*read)(size_t sector_size, /*!< Function pointer for reading data. */
+    esp_err_t (*read)(struct tinyusb_msc_storage_handle_s *handle, size_t sector_size, /*!< Function pointer for reading data. */
                       uint32_t lba, uint32_t offset, size_t size, void *dest);
-    esp_err_t (*write)(size_t sector_size, /*!< Function pointer for writing data. */
+    esp_err_t (*write)(struct tinyusb_msc_storage_handle_s *handle, size_t sector_size, /*!< Function pointer for writing data. */
                        size_t addr, uint32_t lba, uint32_t offset, size_t size, const void *src);
     tusb_msc_callback_t callback_mount_changed; /*!< Callback for mount state change. */
     tusb_msc_callback_t callback_premount_changed; /*!< Callback for pre-mount state change. */
     int max_files;                          /*!< Maximum number of files that can be open simultaneously. */
 } tinyusb_msc_storage_handle_s;
 
-/* handle of tinyusb driver connected to application */
-static tinyusb_msc_storage_handle_s *s_storage_handle;
+/* handles of tinyusb driver connected to application, indexed by LUN */
+static tinyusb_msc_storage_handle_s *s_storage_handle[MSC_STORAGE_LUN_NUM];
 
-static esp_err_t _mount_spiflash(BYTE pdrv)
+static esp_err_t _mount_spiflash(tinyusb_msc_storage_handle_s *handle, BYTE pdrv)
 {
-    return ff_diskio_register_wl_partition(pdrv, s_storage_handle->wl_handle);
+    return ff_diskio_register_wl_partition(pdrv, handle->wl_handle);
 }
 
-static esp_err_t _unmount_spiflash(void)
+static esp_err_t _unmount_spiflash(tinyusb_msc_storage_handle_s *handle)
 {
     BYTE pdrv;
-    pdrv = ff_diskio_get_pdrv_wl(s_storage_handle->wl_handle);
+    pdrv = ff_diskio_get_pdrv_wl(handle->wl_handle);
     if (pdrv == 0xff) {
         ESP_LOGE(TAG, "Invalid state");
         return ESP_ERR_INVALID_STATE;
     }
-    ff_diskio_clear_pdrv_wl(s_storage_handle->wl_handle);
+    ff_diskio_clear_pdrv_wl(handle->wl_handle);
 
     char drv[3] = {(char)('0' + pdrv), ':', 0};
     f_mount(0, drv, 0);
@@ -97,27 +154,28 @@ static esp_err_t _unmount_spiflash(void)
     return ESP_OK;
 }
 
-static uint32_t _get_sector_count_spiflash(void)
+static uint32_t _get_sector_count_spiflash(tinyusb_msc_storage_handle_s *handle)
 {
     uint32_t result = 0;
-    assert(s_storage_handle->wl_handle != WL_INVALID_HANDLE);
-    size_t size = wl_sector_size(s_storage_handle->wl_handle);
+    assert(handle->wl_handle != WL_INVALID_HANDLE);
+    size_t size = wl_sector_size(handle->wl_handle);
     if (size == 0) {
         ESP_LOGW(TAG, "WL Sector size is zero !!!");
         result = 0;
     } else {
-        result = (uint32_t)(wl_size(s_storage_handle->wl_handle) / size);
+        result = (uint32_t)(wl_size(handle->wl_handle) / size);
     }
     return result;
 }
 
-static uint32_t _get_sector_size_spiflash(void)
+static uint32_t _get_sector_size_spiflash(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle->wl_handle != WL_INVALID_HANDLE);
-    return (uint32_t)wl_sector_size(s_storage_handle->wl_handle);
+    assert(handle->wl_handle != WL_INVALID_HANDLE);
+    return (uint32_t)wl_sector_size(handle->wl_handle);
 }
 
-static esp_err_t _read_sector_spiflash(size_t sector_size,
+static esp_err_t _read_sector_spiflash(tinyusb_msc_storage_handle_s *handle,
+                                       size_t sector_size,
                                        uint32_t lba,
                                        uint32_t offset,
                                        size_t size,
@@ -127,10 +185,11 @@ static esp_err_t _read_sector_spiflash(size_t sector_size,
     size_t addr = 0; // Address of the data to be read, relative to the beginning of the partition.
     ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
     ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
-    return wl_read(s_storage_handle->wl_handle, addr, dest, size);
+    return wl_read(handle->wl_handle, addr, dest, size);
 }
 
-static esp_err_t _write_sector_spiflash(size_t sector_size,
+static esp_err_t _write_sector_spiflash(tinyusb_msc_storage_handle_s *handle,
+                                        size_t sector_size,
                                         size_t addr,
                                         uint32_t lba,
                                         uint32_t offset,
@@ -142,22 +201,96 @@ static esp_err_t _write_sector_spiflash(size_t sector_size,
     size_t src_addr = 0; // Address of the data to be write, relative to the beginning of the partition.
     ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
     ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &src_addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
-    ESP_RETURN_ON_ERROR(wl_erase_range(s_storage_handle->wl_handle, src_addr, size), TAG, "Failed to erase");
-    return wl_write(s_storage_handle->wl_handle, src_addr, src, size);
+    ESP_RETURN_ON_ERROR(wl_erase_range(handle->wl_handle, src_addr, size), TAG, "Failed to erase");
+    return wl_write(handle->wl_handle, src_addr, src, size);
+}
+
+static esp_err_t _read_sector_partition_ro(tinyusb_msc_storage_handle_s *handle,
+        size_t sector_size,
+        uint32_t lba,
+        uint32_t offset,
+        size_t size,
+        void *dest)
+{
+    size_t temp = 0;
+    size_t addr = 0; // Address of the data to be read, relative to the beginning of the partition.
+    ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
+    ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, &addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
+    ESP_RETURN_ON_FALSE(addr <= handle->partition->size && size <= handle->partition->size - addr,
+                        ESP_ERR_INVALID_SIZE, TAG, "read beyond partition addr %u size %u", addr, size);
+    // Served by the flash cache, no SPI flash command or wear levelling lookup
+    memcpy(dest, &handle->mmap_data[addr], size);
+    return ESP_OK;
+}
+
+static esp_err_t _write_sector_partition_ro(tinyusb_msc_storage_handle_s *handle,
+        size_t sector_size,
+        size_t addr,
+        uint32_t lba,
+        uint32_t offset,
+        size_t size,
+        const void *src)
+{
+    (void) sector_size;
+    (void) addr;
+    (void) lba;
+    (void) offset;
+    (void) size;
+    (void) src;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static esp_err_t _ramdisk_addr(tinyusb_msc_storage_handle_s *handle, size_t sector_size, uint32_t lba, uint32_t offset, size_t size, size_t *addr)
+{
+    size_t temp = 0;
+    ESP_RETURN_ON_FALSE(!__builtin_umul_overflow(lba, sector_size, &temp), ESP_ERR_INVALID_SIZE, TAG, "overflow lba %lu sector_size %u", lba, sector_size);
+    ESP_RETURN_ON_FALSE(!__builtin_uadd_overflow(temp, offset, addr), ESP_ERR_INVALID_SIZE, TAG, "overflow addr %u offset %lu", temp, offset);
+    const size_t capacity = (size_t)handle->sector_count * sector_size;
+    ESP_RETURN_ON_FALSE(*addr <= capacity && size <= capacity - *addr, ESP_ERR_INVALID_SIZE, TAG,
+                        "access beyond RAM disk addr %u size %u", *addr, size);
+    return ESP_OK;
+}
+
+static esp_err_t _read_sector_ramdisk(tinyusb_msc_storage_handle_s *handle,
+                                      size_t sector_size,
+                                      uint32_t lba,
+                                      uint32_t offset,
+                                      size_t size,
+                                      void *dest)
+{
+    size_t addr = 0;
+    ESP_RETURN_ON_ERROR(_ramdisk_addr(handle, sector_size, lba, offset, size, &addr), TAG, "Invalid read");
+    memcpy(dest, &handle->ramdisk_data[addr], size);
+    return ESP_OK;
+}
+
+static esp_err_t _write_sector_ramdisk(tinyusb_msc_storage_handle_s *handle,
+                                       size_t sector_size,
+                                       size_t addr,
+                                       uint32_t lba,
+                                       uint32_t offset,
+                                       size_t size,
+                                       const void *src)
+{
+    (void) addr; // addr argument is not used in this function, we calculate it based on lba and offset.
+    size_t dest_addr = 0;
+    ESP_RETURN_ON_ERROR(_ramdisk_addr(handle, sector_size, lba, offset, size, &dest_addr), TAG, "Invalid write");
+    memcpy(&handle->ramdisk_data[dest_addr], src, size);
+    return ESP_OK;
 }
 
 #if SOC_SDMMC_HOST_SUPPORTED
-static esp_err_t _mount_sdmmc(BYTE pdrv)
+static esp_err_t _mount_sdmmc(tinyusb_msc_storage_handle_s *handle, BYTE pdrv)
 {
-    ff_diskio_register_sdmmc(pdrv, s_storage_handle->card);
+    ff_diskio_register_sdmmc(pdrv, handle->card);
     ff_sdmmc_set_disk_status_check(pdrv, false);
     return ESP_OK;
 }
 
-static esp_err_t _unmount_sdmmc(void)
+static esp_err_t _unmount_sdmmc(tinyusb_msc_storage_handle_s *handle)
 {
     BYTE pdrv;
-    pdrv = ff_diskio_get_pdrv_card(s_storage_handle->card);
+    pdrv = ff_diskio_get_pdrv_card(handle->card);
     if (pdrv == 0xff) {
         ESP_LOGE(TAG, "Invalid state");
         return ESP_ERR_INVALID_STATE;
@@ -170,28 +303,30 @@ static esp_err_t _unmount_sdmmc(void)
     return ESP_OK;
 }
 
-static uint32_t _get_sector_count_sdmmc(void)
+static uint32_t _get_sector_count_sdmmc(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle->card);
-    return (uint32_t)s_storage_handle->card->csd.capacity;
+    assert(handle->card);
+    return (uint32_t)handle->card->csd.capacity;
 }
 
-static uint32_t _get_sector_size_sdmmc(void)
+static uint32_t _get_sector_size_sdmmc(tinyusb_msc_storage_handle_s *handle)
 {
-    assert(s_storage_handle->card);
-    return (uint32_t)s_storage_handle->card->csd.sector_size;
+    assert(handle->card);
+    return (uint32_t)handle->card->csd.sector_size;
 }
 
-static esp_err_t _read_sector_sdmmc(size_t sector_size,
+static esp_err_t _read_sector_sdmmc(tinyusb_msc_storage_handle_s *handle,
+                                    size_t sector_size,
                                     uint32_t lba,
                                     uint32_t offset,
                                     size_t size,
                                     void *dest)
 {
-    return sdmmc_read_sectors(s_storage_handle->card, dest, lba, size / sector_size);
+    return sdmmc_read_sectors(handle->card, dest, lba, size / sector_size);
 }
 
-static esp_err_t _write_sector_sdmmc(size_t sector_size,
+static esp_err_t _write_sector_sdmmc(tinyusb_msc_storage_handle_s *handle,
+                                     size_t sector_size,
                                      size_t addr,
                                      uint32_t lba,
                                      uint32_t offset,
@@ -199,40 +334,48 @@ static esp_err_t _write_sector_sdmmc(size_t sector_size,
                                      const void *src)
 {
     (void) addr; // addr argument is not used in this function, we use lba directly
-    return sdmmc_write_sectors(s_storage_handle->card, src, lba, size / sector_size);
+    return sdmmc_write_sectors(handle->card, src, lba, size / sector_size);
 }
 #endif
 
-static esp_err_t _msc_storage_read_sector(uint32_t lba,
+static esp_err_t _msc_storage_read_sector(tinyusb_msc_storage_handle_s *handle,
+        uint32_t lba,
         uint32_t offset,
         size_t size,
         void *dest)
 {
-    assert(s_storage_handle);
-    size_t sector_size = tinyusb_msc_storage_get_sector_size();
-    return (s_storage_handle->read)(sector_size, lba, offset, size, dest);
+    assert(handle);
+    size_t sector_size = handle->sector_size;
+    TINYUSB_STATS_TIME_START(start);
+    esp_err_t ret = (handle->read)(handle, sector_size, lba, offset, size, dest);
+    TINYUSB_STATS_TIME_END(msc.storage_read_us, msc.storage_read_max_us, start);
+    return ret;
 }
 
-static esp_err_t _msc_storage_write_sector(uint32_t lba,
+static esp_err_t _msc_storage_write_sector(tinyusb_msc_storage_handle_s *handle,
+        uint32_t lba,
         uint32_t offset,
         size_t size,
         const void *src)
 {
-    assert(s_storage_handle);
-    if (s_storage_handle->is_fat_mounted) {
+    assert(handle);
+    if (handle->is_fat_mounted) {
         ESP_LOGE(TAG, "can't write, FAT mounted");
         return ESP_ERR_INVALID_STATE;
     }
-    size_t sector_size = tinyusb_msc_storage_get_sector_size();
+    size_t sector_size = handle->sector_size;
 
     if (size % sector_size != 0) {
         ESP_LOGE(TAG, "Invalid Argument lba(%lu) offset(%lu) size(%u) sector_size(%u)", lba, offset, size, sector_size);
         return ESP_ERR_INVALID_ARG;
     }
-    return (s_storage_handle->write)(sector_size, 0 /* not used */, lba, offset, size, src);
+    TINYUSB_STATS_TIME_START(start);
+    esp_err_t ret = (handle->write)(handle, sector_size, 0 /* not used */, lba, offset, size, src);
+    TINYUSB_STATS_TIME_END(msc.storage_write_us, msc.storage_write_max_us, start);
+    return ret;
 }
 
-static esp_err_t _mount(char *drv, FATFS *fs)
+static esp_err_t _mount(tinyusb_msc_storage_handle_s *handle, char *drv, FATFS *fs)
 {
     void *workbuf = NULL;
     const size_t workbuf_size = 4096;
@@ -241,7 +384,8 @@ static esp_err_t _mount(char *drv, FATFS *fs)
     FRESULT fresult = f_mount(fs, drv, 1);
     if (fresult != FR_OK) {
         ESP_LOGW(TAG, "f_mount failed (%d)", fresult);
-        if (!((fresult == FR_NO_FILESYSTEM || fresult == FR_INT_ERR))) {
+        // Read-only storage is never formatted, it must contain a FAT image
+        if (!((fresult == FR_NO_FILESYSTEM || fresult == FR_INT_ERR)) || handle->read_only) {
             ret = ESP_FAIL;
             goto fail;
         }
@@ -250,8 +394,9 @@ static esp_err_t _mount(char *drv, FATFS *fs)
             ret = ESP_ERR_NO_MEM;
             goto fail;
         }
+        // Clusters are aligned to the sectors of the storage, which the host writes at once
         size_t alloc_unit_size = esp_vfs_fat_get_allocation_unit_size(
-                                     CONFIG_WL_SECTOR_SIZE,
+                                     handle->sector_size,
                                      4096);
         ESP_LOGW(TAG, "formatting card, allocation unit size=%d", alloc_unit_size);
 
@@ -301,50 +446,495 @@ fail:
 }
 
 /**
- * @brief Handles deferred USB MSC write operations.
- *
- * This function is invoked via TinyUSB's deferred execution mechanism to perform
- * write operations to the underlying storage. It writes data from the
- * `storage_buffer` stored within the `s_storage_handle`.
- *
- * @param param Unused. Present for compatibility with deferred function signature.
+ * @brief Contiguous data of consecutive write buffers, held by the writer task
  */
-static void _write_func(void *param)
-{
-    // Process the data in storage_buffer
-    esp_err_t err = _msc_storage_write_sector(
-                        s_storage_handle->storage_buffer.lba,
-                        s_storage_handle->storage_buffer.offset,
-                        s_storage_handle->storage_buffer.bufsize,
-                        (const void *)s_storage_handle->storage_buffer.data_buffer
-                    );
+typedef struct {
+    uint32_t first;     /*!< Index of the first buffer */
+    uint32_t count;     /*!< Number of buffers, 0 if there is no data */
+    uint32_t lba;       /*!< Logical Block Address of the data */
+    uint32_t offset;    /*!< Offset within the LBA */
+    uint32_t size;      /*!< Number of bytes */
+} msc_storage_run_t;
+
+static void _run_write(tinyusb_msc_storage_handle_s *handle, msc_storage_run_t *run)
+{
+    if (run->count == 0) {
+        return;
+    }
+    esp_err_t err = _msc_storage_write_sector(handle, run->lba,
+                                              run->offset,
+                                              run->size,
+                                              (const void *)handle->storage_buffer[run->first].data_buffer);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Write failed, error=0x%x", err);
+        __atomic_store_n(&handle->write_failed, true, __ATOMIC_RELAXED);
     }
+    if (!handle->is_fat_mounted) {
+        // Even a failed write might have changed the storage
+        handle->host_changed = true;
+    }
+    for (uint32_t i = 0; i < run->count; i++) {
+        xSemaphoreGive(handle->buffer_free);
+    }
+    run->count = 0;
 }
 
-esp_err_t tinyusb_msc_storage_mount(const char *base_path)
+/**
+ * @brief Check that the buffer continues the run, both on the storage and in memory
+ */
+static bool _run_is_continued_by(tinyusb_msc_storage_handle_s *handle, const msc_storage_run_t *run, const msc_storage_buffer_t *buffer)
+{
+    const uint64_t sector_size = handle->sector_size;
+    const uint64_t run_end = (uint64_t)run->lba * sector_size + run->offset + run->size;
+    const uint64_t buffer_start = (uint64_t)buffer->lba * sector_size + buffer->offset;
+    return (buffer_start == run_end) &&
+           (buffer == &handle->storage_buffer[run->first + run->count]);
+}
+
+#if MSC_STORAGE_READ_AHEAD_SIZE
+static void _read_ahead_fill(tinyusb_msc_storage_handle_s *handle, msc_storage_buffer_t *read_ahead)
+{
+    esp_err_t err = _msc_storage_read_sector(handle, read_ahead->lba,
+                                             read_ahead->offset,
+                                             read_ahead->bufsize,
+                                             (void *)read_ahead->data_buffer);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Read ahead failed, error=0x%x", err);
+        read_ahead->bufsize = 0;
+    }
+    xSemaphoreGive(handle->read_ahead_done);
+}
+#endif
+
+/**
+ * @brief Writer task, performs deferred USB MSC write operations.
+ *
+ * Filled buffers are written to the underlying storage in the order they were
+ * received, so the TinyUSB task can receive the next WRITE10 data meanwhile.
+ * Buffers with contiguous LBAs are held and written at once, so SD card gets
+ * multi-block writes and wear levelling erases larger ranges. The held data is
+ * written on non-contiguous access, at the end of the ring, on flush request
+ * (NULL in the queue) or when no more data arrives in the coalesce timeout.
+ * After the write the buffers are returned to the ring.
+ * The read ahead buffer in the queue is a request to read ahead.
+ *
+ * @param arg Storage handle of the LUN.
+ */
+static void _writer_task(void *arg)
+{
+    tinyusb_msc_storage_handle_s *handle = (tinyusb_msc_storage_handle_s *)arg;
+    msc_storage_run_t run = { 0 };
+    msc_storage_buffer_t *buffer;
+    while (1) {
+        TickType_t timeout = run.count ? MSC_STORAGE_COALESCE_TIMEOUT_TICKS : portMAX_DELAY;
+        if (xQueueReceive(handle->write_queue, &buffer, timeout) != pdTRUE || buffer == NULL) {
+            _run_write(handle, &run);
+            continue;
+        }
+#if MSC_STORAGE_READ_AHEAD_SIZE
+        if (buffer == &handle->read_ahead) {
+            _run_write(handle, &run);
+            _read_ahead_fill(handle, buffer);
+            continue;
+        }
+#endif
+        if (run.count && _run_is_continued_by(handle, &run, buffer)) {
+            run.count++;
+            run.size += buffer->bufsize;
+        } else {
+            _run_write(handle, &run);
+            run.first = buffer - handle->storage_buffer;
+            run.count = 1;
+            run.lba = buffer->lba;
+            run.offset = buffer->offset;
+            run.size = buffer->bufsize;
+        }
+        if (run.first + run.count == MSC_STORAGE_BUFFER_NUM) {
+            // Next buffer is not adjacent in memory, and TinyUSB may be waiting for one
+            _run_write(handle, &run);
+        }
+    }
+}
+
+/**
+ * @brief Wait until all write buffers are written to the storage medium
+ */
+static void _msc_storage_flush(tinyusb_msc_storage_handle_s *handle)
 {
+    const msc_storage_buffer_t *flush_request = NULL;
+    if (uxSemaphoreGetCount(handle->buffer_free) == MSC_STORAGE_BUFFER_NUM) {
+        return; // Nothing to write
+    }
+    xSemaphoreTake(handle->flush_mutex, portMAX_DELAY);
+    xQueueSend(handle->write_queue, &flush_request, portMAX_DELAY);
+    for (int i = 0; i < MSC_STORAGE_BUFFER_NUM; i++) {
+        xSemaphoreTake(handle->buffer_free, portMAX_DELAY);
+    }
+    for (int i = 0; i < MSC_STORAGE_BUFFER_NUM; i++) {
+        xSemaphoreGive(handle->buffer_free);
+    }
+    xSemaphoreGive(handle->flush_mutex);
+}
+
+/**
+ * @brief Request writing of the write buffers and wait for it at most a tick
+ *
+ * The TinyUSB task asks TinyUSB to retry the command instead of waiting for a long storage write,
+ * so the events of the other classes are handled meanwhile.
+ *
+ * @return true if all write buffers are written
+ */
+static bool _msc_storage_flush_poll(tinyusb_msc_storage_handle_s *handle)
+{
+    if (uxSemaphoreGetCount(handle->buffer_free) == MSC_STORAGE_BUFFER_NUM) {
+        handle->flush_requested = false;
+        return true;
+    }
+    if (!handle->flush_requested) {
+        const msc_storage_buffer_t *flush_request = NULL;
+        handle->flush_requested = (xQueueSend(handle->write_queue, &flush_request, 0) == pdTRUE);
+    }
+    // Woken up by the first written buffer
+    if (xSemaphoreTake(handle->buffer_free, MSC_STORAGE_BUFFER_WAIT_TICKS) == pdTRUE) {
+        xSemaphoreGive(handle->buffer_free);
+    }
+    if (uxSemaphoreGetCount(handle->buffer_free) == MSC_STORAGE_BUFFER_NUM) {
+        handle->flush_requested = false;
+        return true;
+    }
+    return false;
+}
+
+#if MSC_STORAGE_READ_AHEAD_SIZE
+/**
+ * @brief Wait for the requested read ahead at most a tick
+ *
+ * @return true if no read ahead is pending
+ */
+static bool _read_ahead_poll(tinyusb_msc_storage_handle_s *handle)
+{
+    if (handle->read_ahead_pending) {
+        if (xSemaphoreTake(handle->read_ahead_done, MSC_STORAGE_BUFFER_WAIT_TICKS) != pdTRUE) {
+            return false;
+        }
+        handle->read_ahead_pending = false;
+    }
+    return true;
+}
+
+/**
+ * @brief Wait for the requested read ahead
+ */
+static void _read_ahead_wait(tinyusb_msc_storage_handle_s *handle)
+{
+    if (handle->read_ahead_pending) {
+        xSemaphoreTake(handle->read_ahead_done, portMAX_DELAY);
+        handle->read_ahead_pending = false;
+    }
+}
+
+/**
+ * @brief Drop the read ahead data, which might be outdated by a write to the storage
+ */
+static void _read_ahead_invalidate(tinyusb_msc_storage_handle_s *handle)
+{
+    _read_ahead_wait(handle);
+    handle->read_ahead.bufsize = 0;
+    handle->read_next_addr = UINT64_MAX;
+}
+
+/**
+ * @brief Request the writer task to read the sectors from the LBA into the read ahead buffer
+ */
+static void _read_ahead_start(tinyusb_msc_storage_handle_s *handle, uint32_t lba)
+{
+    msc_storage_buffer_t *read_ahead = &handle->read_ahead;
+    uint32_t sectors = MSC_STORAGE_READ_AHEAD_SIZE / handle->sector_size;
+    if (lba >= handle->sector_count) {
+        return;
+    }
+    if (sectors > handle->sector_count - lba) {
+        sectors = handle->sector_count - lba;
+    }
+    if (sectors == 0) {
+        return; // Read ahead buffer is smaller than a sector
+    }
+    read_ahead->lba = lba;
+    read_ahead->offset = 0;
+    read_ahead->bufsize = sectors * handle->sector_size;
+    handle->read_ahead_pending = true;
+    xQueueSend(handle->write_queue, &read_ahead, portMAX_DELAY);
+}
+
+/**
+ * @brief Read from the read ahead buffer, or from the storage if data is not there
+ *
+ * When a sequential read consumes the read ahead data, the next sectors are
+ * requested, so writer task reads them while this chunk goes out over USB.
+ */
+static esp_err_t _read_ahead_read(tinyusb_msc_storage_handle_s *handle, uint32_t lba, uint32_t offset, size_t size, void *dest)
+{
+    msc_storage_buffer_t *read_ahead = &handle->read_ahead;
+    const uint64_t sector_size = handle->sector_size;
+    const uint64_t addr = (uint64_t)lba * sector_size + offset;
+    const bool sequential = (addr == handle->read_next_addr);
     esp_err_t ret = ESP_OK;
-    assert(s_storage_handle);
 
-    if (s_storage_handle->is_fat_mounted) {
-        return ESP_OK;
+    _read_ahead_wait(handle);
+    handle->read_next_addr = addr + size;
+
+    const uint64_t read_ahead_addr = (uint64_t)read_ahead->lba * sector_size;
+    const uint64_t read_ahead_end = read_ahead_addr + read_ahead->bufsize;
+    if (read_ahead->bufsize && addr >= read_ahead_addr && addr + size <= read_ahead_end) {
+        memcpy(dest, read_ahead->data_buffer + (addr - read_ahead_addr), size);
+        if (addr + size < read_ahead_end) {
+            return ESP_OK;
+        }
+    } else {
+        ret = _msc_storage_read_sector(handle, lba, offset, size, dest);
+        if (ret != ESP_OK || !sequential) {
+            return ret;
+        }
+    }
+    if ((addr + size) % sector_size == 0) {
+        _read_ahead_start(handle, (uint32_t)((addr + size) / sector_size));
+    }
+    return ret;
+}
+#endif
+
+static void _msc_storage_pipeline_delete(tinyusb_msc_storage_handle_s *handle)
+{
+    if (handle->writer_task) {
+        vTaskDelete(handle->writer_task);
+    }
+    if (handle->write_queue) {
+        vQueueDelete(handle->write_queue);
+    }
+    if (handle->flush_mutex) {
+        vSemaphoreDelete(handle->flush_mutex);
+    }
+    if (handle->buffer_free) {
+        vSemaphoreDelete(handle->buffer_free);
+    }
+#if MSC_STORAGE_READ_AHEAD_SIZE
+    if (handle->read_ahead_done) {
+        vSemaphoreDelete(handle->read_ahead_done);
+    }
+#endif
+}
+
+static void _msc_storage_check_dma(tinyusb_msc_storage_handle_s *handle)
+{
+    if (!esp_ptr_dma_capable((const void *)handle->storage_data)) {
+        ESP_LOGW(TAG, "storage buffer is not DMA capable");
+    }
+    if (MSC_STORAGE_BUFFER_SIZE % MSC_STORAGE_DMA_ALIGN != 0) {
+        ESP_LOGW(TAG, "CONFIG_TINYUSB_MSC_BUFSIZE (%d) is not a multiple of %d, writes are bounced by the storage driver",
+                 (int)MSC_STORAGE_BUFFER_SIZE, (int)MSC_STORAGE_DMA_ALIGN);
     }
+}
+
+static esp_err_t _msc_storage_pipeline_create(tinyusb_msc_storage_handle_s *handle)
+{
+    handle->buffer_head = 0;
+    handle->write_failed = false;
+#if !CONFIG_TINYUSB_MSC_WRITE_BACK
+    handle->write_through_pending = NULL;
+#endif
+    handle->writer_task = NULL;
+#if MSC_STORAGE_READ_AHEAD_SIZE
+    handle->read_ahead_done = NULL;
+#endif
+    for (int i = 0; i < MSC_STORAGE_BUFFER_NUM; i++) {
+        handle->storage_buffer[i].data_buffer = &handle->storage_data[i * MSC_STORAGE_BUFFER_SIZE];
+    }
+    handle->buffer_free = xSemaphoreCreateCounting(MSC_STORAGE_BUFFER_NUM, MSC_STORAGE_BUFFER_NUM);
+    handle->flush_mutex = xSemaphoreCreateMutex();
+    handle->write_queue = xQueueCreate(MSC_STORAGE_BUFFER_NUM + 3, sizeof(msc_storage_buffer_t *)); // +3 for flush requests of the application and READ10, and read ahead request
+    handle->flush_requested = false;
+    if (!handle->buffer_free || !handle->flush_mutex || !handle->write_queue) {
+        goto fail;
+    }
+#if MSC_STORAGE_READ_AHEAD_SIZE
+    handle->read_ahead.data_buffer = handle->read_ahead_data;
+    handle->read_ahead.bufsize = 0;
+    handle->read_ahead_pending = false;
+    handle->read_next_addr = UINT64_MAX;
+    handle->read_ahead_done = xSemaphoreCreateBinary();
+    if (!handle->read_ahead_done) {
+        goto fail;
+    }
+#endif
+    if (xTaskCreatePinnedToCore(_writer_task, "TinyUSB MSC", CONFIG_TINYUSB_MSC_WRITER_TASK_STACK_SIZE, handle,
+                                CONFIG_TINYUSB_MSC_WRITER_TASK_PRIORITY, &handle->writer_task, tskNO_AFFINITY) != pdPASS) {
+        handle->writer_task = NULL;
+        goto fail;
+    }
+    return ESP_OK;
+
+fail:
+    _msc_storage_pipeline_delete(handle);
+    return ESP_ERR_NO_MEM;
+}
+
+/* Shared access diskio
+   *********************************************************************
+   While the host has the storage, FATFS of the application stays mounted through
+   this diskio. Writes are refused and the status reports write protection, so
+   FATFS opens files read-only. When the host wrote to the storage, the status
+   reports the drive not initialized once, so FATFS drops its cached sectors and
+   re-reads the volume on next access. */
+
+/* handles of the storage registered to the shared access diskio, indexed by FATFS drive */
+static tinyusb_msc_storage_handle_s *s_shared_handle[FF_VOLUMES];
+
+static DSTATUS _shared_disk_initialize(BYTE pdrv)
+{
+    tinyusb_msc_storage_handle_s *handle = s_shared_handle[pdrv];
+    return handle->host_access ? STA_PROTECT : 0;
+}
+
+static DSTATUS _shared_disk_status(BYTE pdrv)
+{
+    tinyusb_msc_storage_handle_s *handle = s_shared_handle[pdrv];
+    DSTATUS stat = _shared_disk_initialize(pdrv);
+    if (handle->host_access) {
+        _msc_storage_flush(handle);
+    }
+    if (handle->host_changed) {
+        handle->host_changed = false;
+        stat |= STA_NOINIT;
+    }
+    return stat;
+}
+
+static DRESULT _shared_disk_read(BYTE pdrv, BYTE *buff, uint32_t sector, UINT count)
+{
+    tinyusb_msc_storage_handle_s *handle = s_shared_handle[pdrv];
+    if (handle->host_access) {
+        _msc_storage_flush(handle);
+    }
+    const size_t sector_size = handle->sector_size;
+    esp_err_t err = (handle->read)(handle, sector_size, sector, 0, count * sector_size, buff);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Shared disk read failed (0x%x)", err);
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT _shared_disk_write(BYTE pdrv, const BYTE *buff, uint32_t sector, UINT count)
+{
+    tinyusb_msc_storage_handle_s *handle = s_shared_handle[pdrv];
+    if (handle->host_access || handle->read_only) {
+        return RES_WRPRT;
+    }
+    const size_t sector_size = handle->sector_size;
+    esp_err_t err = (handle->write)(handle, sector_size, 0 /* not used */, sector, 0, count * sector_size, buff);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Shared disk write failed (0x%x)", err);
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT _shared_disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    tinyusb_msc_storage_handle_s *handle = s_shared_handle[pdrv];
+    switch (cmd) {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *((LBA_t *) buff) = handle->sector_count;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *((WORD *) buff) = handle->sector_size;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *((DWORD *) buff) = 1;
+        return RES_OK;
+    default:
+        return RES_ERROR;
+    }
+}
+
+static const ff_diskio_impl_t s_shared_diskio = {
+    .init = &_shared_disk_initialize,
+    .status = &_shared_disk_status,
+    .read = &_shared_disk_read,
+    .write = &_shared_disk_write,
+    .ioctl = &_shared_disk_ioctl,
+};
+
+static esp_err_t _mount_shared(tinyusb_msc_storage_handle_s *handle, BYTE pdrv)
+{
+    handle->shared_pdrv = pdrv;
+    s_shared_handle[pdrv] = handle;
+    ff_diskio_register(pdrv, &s_shared_diskio);
+    return ESP_OK;
+}
+
+static esp_err_t _unmount_shared(tinyusb_msc_storage_handle_s *handle)
+{
+    BYTE pdrv = handle->shared_pdrv;
+    char drv[3] = {(char)('0' + pdrv), ':', 0};
+    f_mount(0, drv, 0);
+    ff_diskio_unregister(pdrv);
+    s_shared_handle[pdrv] = NULL;
+    return ESP_OK;
+}
+/********************************************************************* Shared access diskio */
 
-    tusb_msc_callback_t cb = s_storage_handle->callback_premount_changed;
+static tinyusb_msc_storage_handle_s *_get_handle(uint8_t lun)
+{
+    return (lun < MSC_STORAGE_LUN_NUM) ? s_storage_handle[lun] : NULL;
+}
+
+static void _notify(tinyusb_msc_storage_handle_s *handle, tinyusb_msc_event_type_t type)
+{
+    tusb_msc_callback_t cb = (type == TINYUSB_MSC_EVENT_MOUNT_CHANGED) ?
+                             handle->callback_mount_changed : handle->callback_premount_changed;
     if (cb) {
         tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_PREMOUNT_CHANGED,
+            .type = type,
             .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
+                .is_mounted = handle->is_fat_mounted
+            },
+            .lun = handle->lun,
         };
         cb(&event);
     }
+}
+
+esp_err_t tinyusb_msc_storage_mount_lun(uint8_t lun, const char *base_path)
+{
+    esp_err_t ret = ESP_OK;
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    assert(handle);
+
+    if (handle->is_fat_mounted) {
+        return ESP_OK;
+    }
+
+    // Data received from the host must reach the storage before FAT takes it over
+    _msc_storage_flush(handle);
+#if MSC_STORAGE_READ_AHEAD_SIZE
+    // Application may change the storage while it is mounted
+    _read_ahead_invalidate(handle);
+#endif
+
+    _notify(handle, TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
+
+    if (handle->host_access) {
+        // FATFS stayed registered while the host had the storage, it re-reads
+        // the volume on next access if the host changed it
+        handle->host_access = false;
+        goto mounted;
+    }
 
     if (!base_path) {
-        base_path = CONFIG_TINYUSB_MSC_MOUNT_PATH;
+        base_path = handle->default_base_path;
     }
 
     // connect driver to FATFS
@@ -353,10 +943,10 @@ esp_err_t tinyusb_msc_storage_mount(const char *base_path)
                         "The maximum count of volumes is already mounted");
     char drv[3] = {(char)('0' + pdrv), ':', 0};
 
-    ESP_GOTO_ON_ERROR((s_storage_handle->mount)(pdrv), fail, TAG, "Failed pdrv=%d", pdrv);
+    ESP_GOTO_ON_ERROR((handle->mount)(handle, pdrv), fail, TAG, "Failed pdrv=%d", pdrv);
 
     FATFS *fs = NULL;
-    ret = esp_vfs_fat_register(base_path, drv, s_storage_handle->max_files, &fs);
+    ret = esp_vfs_fat_register(base_path, drv, handle->max_files, &fs);
     if (ret == ESP_ERR_INVALID_STATE) {
         ESP_LOGD(TAG, "it's okay, already registered with VFS");
     } else if (ret != ESP_OK) {
@@ -364,22 +954,13 @@ esp_err_t tinyusb_msc_storage_mount(const char *base_path)
         goto fail;
     }
 
-    ESP_GOTO_ON_ERROR(_mount(drv, fs), fail, TAG, "Failed _mount");
+    ESP_GOTO_ON_ERROR(_mount(handle, drv, fs), fail, TAG, "Failed _mount");
 
-    s_storage_handle->is_fat_mounted = true;
-    s_storage_handle->base_path = base_path;
-
-    cb = s_storage_handle->callback_mount_changed;
-    if (cb) {
-        tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_MOUNT_CHANGED,
-            .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
-        };
-        cb(&event);
-    }
+    handle->base_path = base_path;
 
+mounted:
+    handle->is_fat_mounted = true;
+    _notify(handle, TINYUSB_MSC_EVENT_MOUNT_CHANGED);
     return ret;
 
 fail:
@@ -387,167 +968,310 @@ fail:
         esp_vfs_fat_unregister_path(base_path);
     }
     ff_diskio_unregister(pdrv);
-    s_storage_handle->is_fat_mounted = false;
+    handle->is_fat_mounted = false;
     ESP_LOGW(TAG, "Failed to mount storage (0x%x)", ret);
     return ret;
 }
 
-esp_err_t tinyusb_msc_storage_unmount(void)
+esp_err_t tinyusb_msc_storage_mount(const char *base_path)
 {
-    if (!s_storage_handle) {
+    return tinyusb_msc_storage_mount_lun(0, base_path);
+}
+
+esp_err_t tinyusb_msc_storage_unmount_lun(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    if (!handle) {
         return ESP_FAIL;
     }
 
-    if (!s_storage_handle->is_fat_mounted) {
+    if (!handle->is_fat_mounted) {
         return ESP_OK;
     }
 
-    tusb_msc_callback_t cb = s_storage_handle->callback_premount_changed;
-    if (cb) {
-        tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_PREMOUNT_CHANGED,
-            .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
-        };
-        cb(&event);
-    }
-
-    esp_err_t err = (s_storage_handle->unmount)();
-    if (err) {
-        return err;
-    }
-    err = esp_vfs_fat_unregister_path(s_storage_handle->base_path);
-    s_storage_handle->base_path = NULL;
-    s_storage_handle->is_fat_mounted = false;
+    _notify(handle, TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
 
-    cb = s_storage_handle->callback_mount_changed;
-    if (cb) {
-        tinyusb_msc_event_t event = {
-            .type = TINYUSB_MSC_EVENT_MOUNT_CHANGED,
-            .mount_changed_data = {
-                .is_mounted = s_storage_handle->is_fat_mounted
-            }
-        };
-        cb(&event);
+    esp_err_t err = ESP_OK;
+    if (handle->shared_access) {
+        // Keep FATFS registered, the application reads it while the host has the storage
+        handle->host_changed = false;
+        handle->host_access = true;
+    } else {
+        err = (handle->unmount)(handle);
+        if (err) {
+            return err;
+        }
+        err = esp_vfs_fat_unregister_path(handle->base_path);
+        handle->base_path = NULL;
     }
+    handle->is_fat_mounted = false;
 
+    _notify(handle, TINYUSB_MSC_EVENT_MOUNT_CHANGED);
     return err;
 }
 
+esp_err_t tinyusb_msc_storage_unmount(void)
+{
+    return tinyusb_msc_storage_unmount_lun(0);
+}
+
+uint32_t tinyusb_msc_storage_get_sector_count_lun(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    assert(handle);
+    return (handle->sector_count);
+}
+
 uint32_t tinyusb_msc_storage_get_sector_count(void)
 {
-    assert(s_storage_handle);
-    return (s_storage_handle->sector_count);
+    return tinyusb_msc_storage_get_sector_count_lun(0);
+}
+
+uint32_t tinyusb_msc_storage_get_sector_size_lun(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    assert(handle);
+    return (handle->sector_size);
 }
 
 uint32_t tinyusb_msc_storage_get_sector_size(void)
 {
-    assert(s_storage_handle);
-    return (s_storage_handle->sector_size);
+    return tinyusb_msc_storage_get_sector_size_lun(0);
 }
 
-esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t *config)
+/**
+ * @brief Allocate the handle of the LUN and set up the fields common to all storage types
+ */
+static tinyusb_msc_storage_handle_s *_handle_create(uint8_t lun,
+        const esp_vfs_fat_mount_config_t *mount_config,
+        tusb_msc_callback_t callback_mount_changed,
+        tusb_msc_callback_t callback_premount_changed,
+        bool shared_access)
 {
-    assert(!s_storage_handle);
-    ESP_RETURN_ON_FALSE(CONFIG_TINYUSB_MSC_BUFSIZE >= CONFIG_WL_SECTOR_SIZE,
-                        ESP_ERR_NOT_SUPPORTED, TAG,
-                        "CONFIG_TINYUSB_MSC_BUFSIZE (%d) must be at least the size of CONFIG_WL_SECTOR_SIZE (%d)", (int)(CONFIG_TINYUSB_MSC_BUFSIZE), (int)(CONFIG_WL_SECTOR_SIZE));
-    s_storage_handle = (tinyusb_msc_storage_handle_s *)heap_caps_aligned_alloc(MSC_STORAGE_MEM_ALIGN, sizeof(tinyusb_msc_storage_handle_s), MALLOC_CAP_DMA);
-    ESP_RETURN_ON_FALSE(s_storage_handle, ESP_ERR_NO_MEM, TAG, "Failed to allocate memory for storage handle");
-    s_storage_handle->mount = &_mount_spiflash;
-    s_storage_handle->unmount = &_unmount_spiflash;
-    s_storage_handle->wl_handle = config->wl_handle;
-    s_storage_handle->sector_count = _get_sector_count_spiflash();
-    s_storage_handle->sector_size = _get_sector_size_spiflash();
-    s_storage_handle->read = &_read_sector_spiflash;
-    s_storage_handle->write = &_write_sector_spiflash;
-    s_storage_handle->is_fat_mounted = false;
-    s_storage_handle->base_path = NULL;
+    assert(!s_storage_handle[lun]);
+    tinyusb_msc_storage_handle_s *handle = (tinyusb_msc_storage_handle_s *)heap_caps_aligned_alloc(MSC_STORAGE_DMA_ALIGN, sizeof(tinyusb_msc_storage_handle_s), MALLOC_CAP_DMA);
+    if (!handle) {
+        ESP_LOGE(TAG, "Failed to allocate memory for storage handle");
+        return NULL;
+    }
+    handle->lun = lun;
+    handle->shared_access = shared_access;
+    handle->host_access = false;
+    handle->host_changed = false;
+    handle->read_only = false;
+    handle->direct_access = false;
+    handle->is_fat_mounted = false;
+    handle->base_path = NULL;
+    // LUN 0 keeps the configured mount path, the other LUNs get the LUN number appended
+    if (lun == 0) {
+        snprintf(handle->default_base_path, sizeof(handle->default_base_path), "%s", CONFIG_TINYUSB_MSC_MOUNT_PATH);
+    } else {
+        snprintf(handle->default_base_path, sizeof(handle->default_base_path), "%s%u", CONFIG_TINYUSB_MSC_MOUNT_PATH, lun);
+    }
     // In case the user does not set mount_config.max_files
     // and for backward compatibility with versions <1.4.2
     // max_files is set to 2
-    const int max_files = config->mount_config.max_files;
-    s_storage_handle->max_files = max_files > 0 ? max_files : 2;
+    const int max_files = mount_config->max_files;
+    handle->max_files = max_files > 0 ? max_files : 2;
 
     /* Callbacks setting up*/
-    if (config->callback_mount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED, config->callback_mount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED);
-    }
-    if (config->callback_premount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED, config->callback_premount_changed);
+    handle->callback_mount_changed = callback_mount_changed;
+    handle->callback_premount_changed = callback_premount_changed;
+    return handle;
+}
+
+esp_err_t tinyusb_msc_storage_init_spiflash(const tinyusb_msc_spiflash_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config->lun < MSC_STORAGE_LUN_NUM, ESP_ERR_INVALID_ARG, TAG,
+                        "LUN %u is not below CONFIG_TINYUSB_MSC_LUN_NUM (%d)", config->lun, MSC_STORAGE_LUN_NUM);
+    // Read-only storage has no write buffers, READ10 is served in parts of any size
+    ESP_RETURN_ON_FALSE(config->read_only_partition || CONFIG_TINYUSB_MSC_BUFSIZE >= CONFIG_WL_SECTOR_SIZE,
+                        ESP_ERR_NOT_SUPPORTED, TAG,
+                        "CONFIG_TINYUSB_MSC_BUFSIZE (%d) must be at least the size of CONFIG_WL_SECTOR_SIZE (%d)", (int)(CONFIG_TINYUSB_MSC_BUFSIZE), (int)(CONFIG_WL_SECTOR_SIZE));
+    ESP_RETURN_ON_FALSE(!config->flash_sector_size || config->read_only_partition ||
+                        (CONFIG_TINYUSB_MSC_BUFSIZE >= SPI_FLASH_SEC_SIZE && FF_MAX_SS >= SPI_FLASH_SEC_SIZE),
+                        ESP_ERR_NOT_SUPPORTED, TAG,
+                        "flash_sector_size requires CONFIG_TINYUSB_MSC_BUFSIZE (%d) and FATFS sector size (%d) of at least %d",
+                        (int)(CONFIG_TINYUSB_MSC_BUFSIZE), (int)(FF_MAX_SS), (int)(SPI_FLASH_SEC_SIZE));
+    tinyusb_msc_storage_handle_s *handle = _handle_create(config->lun, &config->mount_config, config->callback_mount_changed,
+                                           config->callback_premount_changed, config->shared_access);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "Failed to allocate memory for storage handle");
+    handle->read_only = (config->read_only_partition != NULL);
+    handle->direct_access = handle->read_only;
+    if (handle->read_only) {
+        // FATFS of the application reads the memory mapped partition as well
+        handle->mount = &_mount_shared;
+        handle->unmount = &_unmount_shared;
+        handle->partition = config->read_only_partition;
+        esp_err_t ret = esp_partition_mmap(config->read_only_partition, 0, config->read_only_partition->size,
+                                           ESP_PARTITION_MMAP_DATA, (const void **)&handle->mmap_data,
+                                           &handle->mmap_handle);
+        if (ret != ESP_OK) {
+            heap_caps_free(handle);
+            ESP_LOGE(TAG, "Failed to mmap partition (0x%x)", ret);
+            return ret;
+        }
+        handle->sector_count = config->read_only_partition->size / SPI_FLASH_SEC_SIZE;
+        handle->sector_size = SPI_FLASH_SEC_SIZE;
+        handle->read = &_read_sector_partition_ro;
+        handle->write = &_write_sector_partition_ro;
+    } else if (config->flash_sector_size) {
+        // Host writes whole flash sectors, wear levelling erases them without read-modify-write.
+        // FATFS of the application must use the same sectors, the WL diskio has the WL sector size.
+        handle->mount = &_mount_shared;
+        handle->unmount = &_unmount_shared;
+        handle->wl_handle = config->wl_handle;
+        handle->sector_count = (uint32_t)(wl_size(handle->wl_handle) / SPI_FLASH_SEC_SIZE);
+        handle->sector_size = SPI_FLASH_SEC_SIZE;
+        handle->read = &_read_sector_spiflash;
+        handle->write = &_write_sector_spiflash;
     } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
+        handle->mount = config->shared_access ? &_mount_shared : &_mount_spiflash;
+        handle->unmount = config->shared_access ? &_unmount_shared : &_unmount_spiflash;
+        handle->wl_handle = config->wl_handle;
+        handle->sector_count = _get_sector_count_spiflash(handle);
+        handle->sector_size = _get_sector_size_spiflash(handle);
+        handle->read = &_read_sector_spiflash;
+        handle->write = &_write_sector_spiflash;
     }
 
-    if (!esp_ptr_dma_capable((const void *)s_storage_handle->storage_buffer.data_buffer)) {
-        ESP_LOGW(TAG, "storage buffer is not DMA capable");
+    if (_msc_storage_pipeline_create(handle) != ESP_OK) {
+        if (handle->read_only) {
+            esp_partition_munmap(handle->mmap_handle);
+        }
+        heap_caps_free(handle);
+        ESP_LOGE(TAG, "Failed to create storage writer");
+        return ESP_ERR_NO_MEM;
     }
 
+    _msc_storage_check_dma(handle);
+
+    s_storage_handle[config->lun] = handle;
     return ESP_OK;
 }
 
 #if SOC_SDMMC_HOST_SUPPORTED
 esp_err_t tinyusb_msc_storage_init_sdmmc(const tinyusb_msc_sdmmc_config_t *config)
 {
-    assert(!s_storage_handle);
-    s_storage_handle = (tinyusb_msc_storage_handle_s *)heap_caps_aligned_alloc(MSC_STORAGE_MEM_ALIGN, sizeof(tinyusb_msc_storage_handle_s), MALLOC_CAP_DMA);
-    ESP_RETURN_ON_FALSE(s_storage_handle, ESP_ERR_NO_MEM, TAG, "Failed to allocate memory for storage handle");
-    s_storage_handle->mount = &_mount_sdmmc;
-    s_storage_handle->unmount = &_unmount_sdmmc;
-    s_storage_handle->card = config->card;
-    s_storage_handle->sector_count = _get_sector_count_sdmmc();
-    s_storage_handle->sector_size = _get_sector_size_sdmmc();
-    s_storage_handle->read = &_read_sector_sdmmc;
-    s_storage_handle->write = &_write_sector_sdmmc;
-    s_storage_handle->is_fat_mounted = false;
-    s_storage_handle->base_path = NULL;
-    // In case the user does not set mount_config.max_files
-    // and for backward compatibility with versions <1.4.2
-    // max_files is set to 2
-    const int max_files = config->mount_config.max_files;
-    s_storage_handle->max_files = max_files > 0 ? max_files : 2;
-
-    /* Callbacks setting up*/
-    if (config->callback_mount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED, config->callback_mount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_MOUNT_CHANGED);
-    }
-    if (config->callback_premount_changed) {
-        tinyusb_msc_register_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED, config->callback_premount_changed);
-    } else {
-        tinyusb_msc_unregister_callback(TINYUSB_MSC_EVENT_PREMOUNT_CHANGED);
+    ESP_RETURN_ON_FALSE(config->lun < MSC_STORAGE_LUN_NUM, ESP_ERR_INVALID_ARG, TAG,
+                        "LUN %u is not below CONFIG_TINYUSB_MSC_LUN_NUM (%d)", config->lun, MSC_STORAGE_LUN_NUM);
+    tinyusb_msc_storage_handle_s *handle = _handle_create(config->lun, &config->mount_config, config->callback_mount_changed,
+                                           config->callback_premount_changed, config->shared_access);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "Failed to allocate memory for storage handle");
+    handle->mount = config->shared_access ? &_mount_shared : &_mount_sdmmc;
+    handle->unmount = config->shared_access ? &_unmount_shared : &_unmount_sdmmc;
+    handle->card = config->card;
+    handle->sector_count = _get_sector_count_sdmmc(handle);
+    handle->sector_size = _get_sector_size_sdmmc(handle);
+    handle->read = &_read_sector_sdmmc;
+    handle->write = &_write_sector_sdmmc;
+
+    if (_msc_storage_pipeline_create(handle) != ESP_OK) {
+        heap_caps_free(handle);
+        ESP_LOGE(TAG, "Failed to create storage writer");
+        return ESP_ERR_NO_MEM;
     }
 
-    if (!esp_ptr_dma_capable((const void *)s_storage_handle->storage_buffer.data_buffer)) {
-        ESP_LOGW(TAG, "storage buffer is not DMA capable");
+    _msc_storage_check_dma(handle);
+
+    s_storage_handle[config->lun] = handle;
+    return ESP_OK;
+}
+#endif
+
+esp_err_t tinyusb_msc_storage_init_ramdisk(const tinyusb_msc_ramdisk_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config->lun < MSC_STORAGE_LUN_NUM, ESP_ERR_INVALID_ARG, TAG,
+                        "LUN %u is not below CONFIG_TINYUSB_MSC_LUN_NUM (%d)", config->lun, MSC_STORAGE_LUN_NUM);
+    const uint32_t sector_size = config->sector_size ? config->sector_size : 512;
+    ESP_RETURN_ON_FALSE(sector_size >= 512 && sector_size <= 4096 && (sector_size & (sector_size - 1)) == 0,
+                        ESP_ERR_INVALID_ARG, TAG, "Unsupported sector size %lu", sector_size);
+    ESP_RETURN_ON_FALSE(config->sector_count > 0 && config->sector_count <= SIZE_MAX / sector_size,
+                        ESP_ERR_INVALID_ARG, TAG, "Invalid sector count %lu", config->sector_count);
+    tinyusb_msc_storage_handle_s *handle = _handle_create(config->lun, &config->mount_config, config->callback_mount_changed,
+                                           config->callback_premount_changed, config->shared_access);
+    ESP_RETURN_ON_FALSE(handle, ESP_ERR_NO_MEM, TAG, "Failed to allocate memory for storage handle");
+    handle->ramdisk_data = config->buffer;
+    handle->ramdisk_owned = false;
+    if (!handle->ramdisk_data) {
+        const size_t size = (size_t)config->sector_count * sector_size;
+        handle->ramdisk_data = heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!handle->ramdisk_data) {
+            handle->ramdisk_data = heap_caps_malloc(size, MALLOC_CAP_8BIT);
+        }
+        if (!handle->ramdisk_data) {
+            heap_caps_free(handle);
+            ESP_LOGE(TAG, "Failed to allocate %u bytes of RAM disk", size);
+            return ESP_ERR_NO_MEM;
+        }
+        handle->ramdisk_owned = true;
+    }
+    handle->direct_access = true;
+    // FATFS of the application accesses the memory through the shared access diskio
+    handle->mount = &_mount_shared;
+    handle->unmount = &_unmount_shared;
+    handle->sector_count = config->sector_count;
+    handle->sector_size = sector_size;
+    handle->read = &_read_sector_ramdisk;
+    handle->write = &_write_sector_ramdisk;
+
+    if (_msc_storage_pipeline_create(handle) != ESP_OK) {
+        if (handle->ramdisk_owned) {
+            heap_caps_free(handle->ramdisk_data);
+        }
+        heap_caps_free(handle);
+        ESP_LOGE(TAG, "Failed to create storage writer");
+        return ESP_ERR_NO_MEM;
     }
 
+    s_storage_handle[config->lun] = handle;
     return ESP_OK;
 }
+
+void tinyusb_msc_storage_deinit_lun(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    if (handle) {
+        _msc_storage_flush(handle);
+#if MSC_STORAGE_READ_AHEAD_SIZE
+        _read_ahead_wait(handle);
 #endif
+        _msc_storage_pipeline_delete(handle);
+        if (handle->host_access) {
+            // FATFS of shared access is still registered
+            _unmount_shared(handle);
+            esp_vfs_fat_unregister_path(handle->base_path);
+        }
+        if (handle->read_only) {
+            esp_partition_munmap(handle->mmap_handle);
+        }
+        if (handle->direct_access && !handle->read_only && handle->ramdisk_owned) {
+            heap_caps_free(handle->ramdisk_data);
+        }
+        heap_caps_free(handle);
+        s_storage_handle[lun] = NULL;
+    }
+}
 
 void tinyusb_msc_storage_deinit(void)
 {
-    if (s_storage_handle) {
-        heap_caps_free(s_storage_handle);
-        s_storage_handle = NULL;
+    for (uint8_t lun = 0; lun < MSC_STORAGE_LUN_NUM; lun++) {
+        tinyusb_msc_storage_deinit_lun(lun);
     }
 }
 
-esp_err_t tinyusb_msc_register_callback(tinyusb_msc_event_type_t event_type,
-                                        tusb_msc_callback_t callback)
+esp_err_t tinyusb_msc_register_callback_lun(uint8_t lun,
+        tinyusb_msc_event_type_t event_type,
+        tusb_msc_callback_t callback)
 {
-    assert(s_storage_handle);
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    assert(handle);
     switch (event_type) {
     case TINYUSB_MSC_EVENT_MOUNT_CHANGED:
-        s_storage_handle->callback_mount_changed = callback;
+        handle->callback_mount_changed = callback;
         return ESP_OK;
     case TINYUSB_MSC_EVENT_PREMOUNT_CHANGED:
-        s_storage_handle->callback_premount_changed = callback;
+        handle->callback_premount_changed = callback;
         return ESP_OK;
     default:
         ESP_LOGE(TAG, "Wrong event type");
@@ -555,26 +1279,32 @@ esp_err_t tinyusb_msc_register_callback(tinyusb_msc_event_type_t event_type,
     }
 }
 
+esp_err_t tinyusb_msc_register_callback(tinyusb_msc_event_type_t event_type,
+                                        tusb_msc_callback_t callback)
+{
+    return tinyusb_msc_register_callback_lun(0, event_type, callback);
+}
+
+esp_err_t tinyusb_msc_unregister_callback_lun(uint8_t lun, tinyusb_msc_event_type_t event_type)
+{
+    return tinyusb_msc_register_callback_lun(lun, event_type, NULL);
+}
+
 esp_err_t tinyusb_msc_unregister_callback(tinyusb_msc_event_type_t event_type)
 {
-    assert(s_storage_handle);
-    switch (event_type) {
-    case TINYUSB_MSC_EVENT_MOUNT_CHANGED:
-        s_storage_handle->callback_mount_changed = NULL;
-        return ESP_OK;
-    case TINYUSB_MSC_EVENT_PREMOUNT_CHANGED:
-        s_storage_handle->callback_premount_changed = NULL;
-        return ESP_OK;
-    default:
-        ESP_LOGE(TAG, "Wrong event type");
-        return ESP_ERR_INVALID_ARG;
-    }
+    return tinyusb_msc_register_callback_lun(0, event_type, NULL);
+}
+
+bool tinyusb_msc_storage_in_use_by_usb_host_lun(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    assert(handle);
+    return !handle->is_fat_mounted;
 }
 
 bool tinyusb_msc_storage_in_use_by_usb_host(void)
 {
-    assert(s_storage_handle);
-    return !s_storage_handle->is_fat_mounted;
+    return tinyusb_msc_storage_in_use_by_usb_host_lun(0);
 }
 
 
@@ -585,8 +1315,23 @@ bool tinyusb_msc_storage_in_use_by_usb_host(void)
 /** User can add and use more codes as per the need of the application **/
 #define SCSI_CODE_ASC_MEDIUM_NOT_PRESENT 0x3A /** SCSI ASC code for 'MEDIUM NOT PRESENT' **/
 #define SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE 0x20 /** SCSI ASC code for 'INVALID COMMAND OPERATION CODE' **/
+#define SCSI_CODE_ASC_WRITE_ERROR 0x0C /** SCSI ASC code for 'WRITE ERROR' **/
+#define SCSI_CMD_SYNCHRONIZE_CACHE_10 0x35 /** SCSI SYNCHRONIZE CACHE (10) command **/
 #define SCSI_CODE_ASCQ 0x00
 
+// Invoked when received GET_MAX_LUN request
+// Return the number of LUNs, up to the highest one with a registered storage
+uint8_t tud_msc_get_maxlun_cb(void)
+{
+    uint8_t count = 1;
+    for (uint8_t lun = 0; lun < MSC_STORAGE_LUN_NUM; lun++) {
+        if (s_storage_handle[lun]) {
+            count = lun + 1;
+        }
+    }
+    return count;
+}
+
 // Invoked when received SCSI_CMD_INQUIRY
 // Application fill vendor id, product id and revision with string up to 8, 16, 4 characters respectively
 void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16], uint8_t product_rev[4])
@@ -601,21 +1346,38 @@ void tud_msc_inquiry_cb(uint8_t lun, uint8_t vendor_id[8], uint8_t product_id[16
     memcpy(product_rev, rev, strlen(rev));
 }
 
+/**
+ * @brief Fail the command with MEDIUM ERROR sense, if a write of the writer task failed
+ *
+ * With write-back, the host gets CHECK CONDITION on the command following the failed write,
+ * with write-through on the WRITE10 itself.
+ *
+ * @return true if the failure was reported and the command must fail
+ */
+static bool _msc_storage_report_write_error(tinyusb_msc_storage_handle_s *handle)
+{
+    if (!__atomic_exchange_n(&handle->write_failed, false, __ATOMIC_RELAXED)) {
+        return false;
+    }
+    tud_msc_set_sense(handle->lun, SCSI_SENSE_MEDIUM_ERROR, SCSI_CODE_ASC_WRITE_ERROR, SCSI_CODE_ASCQ);
+    return true;
+}
+
 // Invoked when received Test Unit Ready command.
 // return true allowing host to read/write this LUN e.g SD card inserted
 bool tud_msc_test_unit_ready_cb(uint8_t lun)
 {
-    (void) lun;
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
     bool result = false;
 
-    if (s_storage_handle->is_fat_mounted) {
+    if (!handle || handle->is_fat_mounted) {
         tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, SCSI_CODE_ASC_MEDIUM_NOT_PRESENT, SCSI_CODE_ASCQ);
         result = false;
     } else {
-        if (tinyusb_msc_storage_unmount() != ESP_OK) {
+        if (tinyusb_msc_storage_unmount_lun(lun) != ESP_OK) {
             ESP_LOGW(TAG, "tud_msc_test_unit_ready_cb() unmount Fails");
         }
-        result = true;
+        result = !_msc_storage_report_write_error(handle);
     }
     return result;
 }
@@ -624,12 +1386,15 @@ bool tud_msc_test_unit_ready_cb(uint8_t lun)
 // Application update block count and block size
 void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_size)
 {
-    (void) lun;
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    if (!handle) {
+        *block_count = 0;
+        *block_size = 0;
+        return;
+    }
 
-    uint32_t sec_count = tinyusb_msc_storage_get_sector_count();
-    uint32_t sec_size = tinyusb_msc_storage_get_sector_size();
-    *block_count = sec_count;
-    *block_size  = (uint16_t)sec_size;
+    *block_count = handle->sector_count;
+    *block_size  = (uint16_t)handle->sector_size;
 }
 
 // Invoked when received Start Stop Unit command
@@ -637,49 +1402,167 @@ void tud_msc_capacity_cb(uint8_t lun, uint32_t *block_count, uint16_t *block_siz
 // - Start = 1 : active mode, if load_eject = 1 : load disk storage
 bool tud_msc_start_stop_cb(uint8_t lun, uint8_t power_condition, bool start, bool load_eject)
 {
-    (void) lun;
     (void) power_condition;
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
 
-    if (load_eject && !start) {
-        if (tinyusb_msc_storage_mount(s_storage_handle->base_path) != ESP_OK) {
+    if (handle && load_eject && !start) {
+        if (tinyusb_msc_storage_mount_lun(lun, handle->base_path) != ESP_OK) {
             ESP_LOGW(TAG, "tud_msc_start_stop_cb() mount Fails");
         }
     }
     return true;
 }
 
+// Invoked when received SCSI WRITE10 command and MODE SENSE to report the write protection
+// return false to make the host mount the LUN read-only, WRITE10 fails with DATA PROTECT
+bool tud_msc_is_writable_cb(uint8_t lun)
+{
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    return handle && !handle->read_only;
+}
+
 // Invoked when received SCSI READ10 command
 // - Address = lba * BLOCK_SIZE + offset
 // - Application fill the buffer (up to bufsize) with address contents and return number of read byte.
-int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize)
+static int32_t _msc_read10(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize)
 {
-    esp_err_t err = _msc_storage_read_sector(lba, offset, bufsize, buffer);
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    if (!handle) {
+        return -1;
+    }
+    esp_err_t err;
+    if (handle->direct_access) {
+        // Memory storage is as fast as the read ahead buffer
+        err = _msc_storage_read_sector(handle, lba, offset, bufsize, buffer);
+    } else {
+        // Host must read back what it has written, even if it is still in the write buffers.
+        // TinyUSB invokes this callback again, if the writer task is not done yet.
+        if (!_msc_storage_flush_poll(handle)) {
+            TINYUSB_STATS_INC(msc.read_busy);
+            return 0;
+        }
+        if (_msc_storage_report_write_error(handle)) {
+            return -1;
+        }
+#if MSC_STORAGE_READ_AHEAD_SIZE
+        if (!_read_ahead_poll(handle)) {
+            TINYUSB_STATS_INC(msc.read_busy);
+            return 0;
+        }
+        err = _read_ahead_read(handle, lba, offset, bufsize, buffer);
+#else
+        err = _msc_storage_read_sector(handle, lba, offset, bufsize, buffer);
+#endif
+    }
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "msc_storage_read_sector failed: 0x%x", err);
         return 0;
     }
+    TINYUSB_STATS_XFER(msc.read, bufsize);
+    return bufsize;
+}
+
+int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void *buffer, uint32_t bufsize)
+{
+    TINYUSB_STATS_TIME_START(start);
+    const int32_t ret = _msc_read10(lun, lba, offset, buffer, bufsize);
+    TINYUSB_STATS_SERVICE_END(msc, start);
+    return ret;
+}
+
+/**
+ * @brief Write WRITE10 data straight to memory storage, skipping the write buffers and the writer task
+ */
+static int32_t _msc_storage_write_direct(tinyusb_msc_storage_handle_s *handle, uint32_t lba, uint32_t offset, const uint8_t *buffer, uint32_t bufsize)
+{
+    if (handle->is_fat_mounted) {
+        ESP_LOGE(TAG, "can't write, FAT mounted");
+        return -1;
+    }
+    TINYUSB_STATS_TIME_START(start);
+    esp_err_t err = (handle->write)(handle, handle->sector_size, 0 /* not used */, lba, offset, bufsize, buffer);
+    TINYUSB_STATS_TIME_END(msc.storage_write_us, msc.storage_write_max_us, start);
+    handle->host_changed = true;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write failed, error=0x%x", err);
+        return -1;
+    }
+    TINYUSB_STATS_XFER(msc.write, bufsize);
     return bufsize;
 }
 
 // Invoked when received SCSI WRITE10 command
 // - Address = lba * BLOCK_SIZE + offset
 // - Application write data from buffer to address contents (up to bufsize) and return number of written byte.
-int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize)
+static int32_t _msc_write10(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize)
 {
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+    if (!handle) {
+        return -1;
+    }
+    if (handle->direct_access) {
+        return _msc_storage_write_direct(handle, lba, offset, buffer, bufsize);
+    }
     assert(bufsize <= MSC_STORAGE_BUFFER_SIZE);
-    // Copy data to the buffer
-    memcpy((void *)s_storage_handle->storage_buffer.data_buffer, buffer, bufsize);
-    s_storage_handle->storage_buffer.lba = lba;
-    s_storage_handle->storage_buffer.offset = offset;
-    s_storage_handle->storage_buffer.bufsize = bufsize;
+#if !CONFIG_TINYUSB_MSC_WRITE_BACK
+    msc_storage_buffer_t *pending = handle->write_through_pending;
+    handle->write_through_pending = NULL;
+    if (pending && pending->lba == lba && pending->offset == offset && pending->bufsize == bufsize) {
+        // Retry of queued data, acknowledge it once it is written
+        goto wait_written;
+    }
+#endif
+    if (_msc_storage_report_write_error(handle)) {
+        return -1;
+    }
+#if MSC_STORAGE_READ_AHEAD_SIZE
+    _read_ahead_invalidate(handle);
+#endif
+    // All buffers are being written, TinyUSB will invoke this callback again with the same data
+    if (xSemaphoreTake(handle->buffer_free, MSC_STORAGE_BUFFER_WAIT_TICKS) != pdTRUE) {
+        TINYUSB_STATS_INC(msc.write_busy);
+        return 0;
+    }
+    // Buffers are written in order, so the one at the head is always free
+    msc_storage_buffer_t *storage_buffer = &handle->storage_buffer[handle->buffer_head];
+    handle->buffer_head = (handle->buffer_head + 1) % MSC_STORAGE_BUFFER_NUM;
 
-    // Defer execution of the write to the TinyUSB task
-    usbd_defer_func(_write_func, NULL, false);
+    // Copy data to the buffer
+    memcpy((void *)storage_buffer->data_buffer, buffer, bufsize);
+    storage_buffer->lba = lba;
+    storage_buffer->offset = offset;
+    storage_buffer->bufsize = bufsize;
+
+    // Defer execution of the write to the writer task
+    xQueueSend(handle->write_queue, &storage_buffer, portMAX_DELAY);
+#if !CONFIG_TINYUSB_MSC_WRITE_BACK
+    pending = storage_buffer;
+
+wait_written:
+    // TinyUSB invokes this callback again with the same data, if the writer task is not done yet
+    if (!_msc_storage_flush_poll(handle)) {
+        handle->write_through_pending = pending;
+        TINYUSB_STATS_INC(msc.write_busy);
+        return 0;
+    }
+    if (_msc_storage_report_write_error(handle)) {
+        return -1;
+    }
+#endif
+    TINYUSB_STATS_XFER(msc.write, bufsize);
 
     // Return the number of bytes accepted
     return bufsize;
 }
 
+int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *buffer, uint32_t bufsize)
+{
+    TINYUSB_STATS_TIME_START(start);
+    const int32_t ret = _msc_write10(lun, lba, offset, buffer, bufsize);
+    TINYUSB_STATS_SERVICE_END(msc, start);
+    return ret;
+}
+
 /**
  * Invoked when received an SCSI command not in built-in list below.
  * - READ_CAPACITY10, READ_FORMAT_CAPACITY, INQUIRY, TEST_UNIT_READY, START_STOP_UNIT, MODE_SENSE6, REQUEST_SENSE
@@ -698,8 +1581,19 @@ int32_t tud_msc_write10_cb(uint8_t lun, uint32_t lba, uint32_t offset, uint8_t *
  */
 int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer, uint16_t bufsize)
 {
+    TINYUSB_STATS_TIME_START(start);
+    tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
     int32_t ret;
 
+    if (!handle) {
+        tud_msc_set_sense(lun, SCSI_SENSE_NOT_READY, SCSI_CODE_ASC_MEDIUM_NOT_PRESENT, SCSI_CODE_ASCQ);
+        return -1;
+    }
+    if (scsi_cmd[0] != SCSI_CMD_SYNCHRONIZE_CACHE_10 && _msc_storage_report_write_error(handle)) {
+        TINYUSB_STATS_SERVICE_END(msc, start);
+        return -1;
+    }
+
     switch (scsi_cmd[0]) {
     case SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL:
         /* SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL is the Prevent/Allow Medium Removal
@@ -707,26 +1601,38 @@ int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void *buffer, u
         the storage media/partition. */
         ret = 0;
         break;
+    case SCSI_CMD_SYNCHRONIZE_CACHE_10:
+        /* Write data deferred to the writer task to the storage medium and
+        report failure of any deferred write not reported yet. */
+        _msc_storage_flush(handle);
+        ret = _msc_storage_report_write_error(handle) ? -1 : 0;
+        break;
     default:
         ESP_LOGW(TAG, "tud_msc_scsi_cb() invoked: %d", scsi_cmd[0]);
         tud_msc_set_sense(lun, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_CODE_ASC_INVALID_COMMAND_OPERATION_CODE, SCSI_CODE_ASCQ);
         ret = -1;
         break;
     }
+    TINYUSB_STATS_SERVICE_END(msc, start);
     return ret;
 }
 
 // Invoked when device is unmounted
 void tud_umount_cb(void)
 {
-    if (tinyusb_msc_storage_mount(s_storage_handle->base_path) != ESP_OK) {
-        ESP_LOGW(TAG, "tud_umount_cb() mount Fails");
+    for (uint8_t lun = 0; lun < MSC_STORAGE_LUN_NUM; lun++) {
+        tinyusb_msc_storage_handle_s *handle = _get_handle(lun);
+        if (handle && tinyusb_msc_storage_mount_lun(lun, handle->base_path) != ESP_OK) {
+            ESP_LOGW(TAG, "tud_umount_cb() mount Fails");
+        }
     }
 }
 
 // Invoked when device is mounted (configured)
 void tud_mount_cb(void)
 {
-    tinyusb_msc_storage_unmount();
+    for (uint8_t lun = 0; lun < MSC_STORAGE_LUN_NUM; lun++) {
+        tinyusb_msc_storage_unmount_lun(lun);
+    }
 }
 /*********************************************************************** TinyUSB MSC callbacks*/
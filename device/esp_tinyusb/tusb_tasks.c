@@ -8,13 +8,40 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "tinyusb.h"
 #include "tusb_tasks.h"
+#include "stats.h"
 
 const static char *TAG = "tusb_tsk";
 static TaskHandle_t s_tusb_tskh;
+#if CONFIG_TINYUSB_TASK_STATIC
+static StaticTask_t s_tusb_tsk_tcb;
+static StackType_t s_tusb_tsk_stack[CONFIG_TINYUSB_TASK_STACK_SIZE];
+#endif
+
+#if CONFIG_TINYUSB_TASK_EVENT_TIMEOUT_MS
+#define TUSB_TASK_EVENT_TIMEOUT CONFIG_TINYUSB_TASK_EVENT_TIMEOUT_MS
+#else
+#define TUSB_TASK_EVENT_TIMEOUT UINT32_MAX
+#endif
+
+#if CONFIG_TINYUSB_WORKER_TASK
+typedef struct {
+    tusb_work_func_t func;
+    void *arg;
+} tusb_work_t;
+
+static TaskHandle_t s_worker_tskh;
+static QueueHandle_t s_worker_queue;
+#if CONFIG_TINYUSB_WORKER_PROFILING
+static tusb_work_stats_t s_work_stats;
+static portMUX_TYPE s_work_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+#endif
+#endif // CONFIG_TINYUSB_WORKER_TASK
 
 #if CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK
 const static int INIT_OK = BIT0;
@@ -38,10 +65,115 @@ static void tusb_device_task(void *arg)
     xEventGroupSetBits(*init_flags, INIT_OK);
 #endif // CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK
     while (1) { // RTOS forever loop
-        tud_task();
+        tud_task_ext(TUSB_TASK_EVENT_TIMEOUT, false);
+#if CONFIG_TINYUSB_TASK_EVENT_TIMEOUT_MS
+        taskYIELD();
+#endif
     }
 }
 
+#if CONFIG_TINYUSB_WORKER_TASK
+/**
+ * @brief This thread runs functions deferred by tusb_defer_work()
+ */
+static void tusb_worker_task(void *arg)
+{
+    (void) arg;
+    tusb_work_t work;
+    while (1) {
+        if (xQueueReceive(s_worker_queue, &work, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+#if CONFIG_TINYUSB_WORKER_PROFILING
+        const int64_t start = esp_timer_get_time();
+        work.func(work.arg);
+        const uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start);
+        portENTER_CRITICAL(&s_work_stats_lock);
+        s_work_stats.count++;
+        s_work_stats.total_us += elapsed;
+        if (elapsed > s_work_stats.max_us) {
+            s_work_stats.max_us = elapsed;
+        }
+        portEXIT_CRITICAL(&s_work_stats_lock);
+#else
+        work.func(work.arg);
+#endif // CONFIG_TINYUSB_WORKER_PROFILING
+    }
+}
+
+esp_err_t tusb_defer_work(tusb_work_func_t func, void *arg, bool in_isr)
+{
+    ESP_RETURN_ON_FALSE(func, ESP_ERR_INVALID_ARG, TAG, "Invalid function");
+    ESP_RETURN_ON_FALSE(s_worker_queue, ESP_ERR_INVALID_STATE, TAG, "TinyUSB worker task not started yet");
+    const tusb_work_t work = {
+        .func = func,
+        .arg = arg,
+    };
+    BaseType_t queued;
+    if (in_isr) {
+        BaseType_t yield = pdFALSE;
+        queued = xQueueSendFromISR(s_worker_queue, &work, &yield);
+        if (yield == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        queued = xQueueSend(s_worker_queue, &work, 0);
+    }
+    TINYUSB_STATS_MAX(worker_queue_max, uxQueueMessagesWaitingFromISR(s_worker_queue));
+    if (queued != pdTRUE) {
+#if CONFIG_TINYUSB_WORKER_PROFILING
+        portENTER_CRITICAL_SAFE(&s_work_stats_lock);
+        s_work_stats.dropped++;
+        portEXIT_CRITICAL_SAFE(&s_work_stats_lock);
+#endif
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#if CONFIG_TINYUSB_WORKER_PROFILING
+esp_err_t tusb_get_work_stats(tusb_work_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    portENTER_CRITICAL(&s_work_stats_lock);
+    *stats = s_work_stats;
+    portEXIT_CRITICAL(&s_work_stats_lock);
+    return ESP_OK;
+}
+#endif // CONFIG_TINYUSB_WORKER_PROFILING
+
+static esp_err_t tusb_run_worker(void)
+{
+    s_worker_queue = xQueueCreate(CONFIG_TINYUSB_WORKER_QUEUE_SIZE, sizeof(tusb_work_t));
+    ESP_RETURN_ON_FALSE(s_worker_queue, ESP_ERR_NO_MEM, TAG, "Failed to allocate worker queue");
+#if CONFIG_TINYUSB_WORKER_PROFILING
+    s_work_stats = (tusb_work_stats_t) { 0 };
+#endif
+    // Same core as the TinyUSB task, so that the priorities apply
+    xTaskCreatePinnedToCore(tusb_worker_task, "TinyUSB worker", CONFIG_TINYUSB_WORKER_TASK_STACK_SIZE, NULL,
+                            CONFIG_TINYUSB_WORKER_TASK_PRIORITY, &s_worker_tskh, CONFIG_TINYUSB_TASK_AFFINITY);
+    if (!s_worker_tskh) {
+        vQueueDelete(s_worker_queue);
+        s_worker_queue = NULL;
+        ESP_LOGE(TAG, "create TinyUSB worker task failed");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void tusb_stop_worker(void)
+{
+    if (s_worker_tskh) {
+        vTaskDelete(s_worker_tskh);
+        s_worker_tskh = NULL;
+    }
+    if (s_worker_queue) {
+        vQueueDelete(s_worker_queue);
+        s_worker_queue = NULL;
+    }
+}
+#endif // CONFIG_TINYUSB_WORKER_TASK
+
 esp_err_t tusb_run_task(void)
 {
     // This function is not guaranteed to be thread safe, if invoked multiple times without calling `tusb_stop_task`, will cause memory leak
@@ -56,7 +188,12 @@ esp_err_t tusb_run_task(void)
     task_arg = &init_flags;
 #endif
     // Create a task for tinyusb device stack:
+#if CONFIG_TINYUSB_TASK_STATIC
+    s_tusb_tskh = xTaskCreateStaticPinnedToCore(tusb_device_task, "TinyUSB", CONFIG_TINYUSB_TASK_STACK_SIZE, task_arg, CONFIG_TINYUSB_TASK_PRIORITY,
+                                                s_tusb_tsk_stack, &s_tusb_tsk_tcb, CONFIG_TINYUSB_TASK_AFFINITY);
+#else
     xTaskCreatePinnedToCore(tusb_device_task, "TinyUSB", CONFIG_TINYUSB_TASK_STACK_SIZE, task_arg, CONFIG_TINYUSB_TASK_PRIORITY, &s_tusb_tskh, CONFIG_TINYUSB_TASK_AFFINITY);
+#endif // CONFIG_TINYUSB_TASK_STATIC
     ESP_RETURN_ON_FALSE(s_tusb_tskh, ESP_FAIL, TAG, "create TinyUSB main task failed");
 #if CONFIG_TINYUSB_INIT_IN_DEFAULT_TASK
     // wait until tusb initialization has completed
@@ -64,6 +201,9 @@ esp_err_t tusb_run_task(void)
     vEventGroupDelete(init_flags);
     ESP_RETURN_ON_FALSE(bits & INIT_OK, ESP_FAIL, TAG, "Init TinyUSB stack failed");
 #endif
+#if CONFIG_TINYUSB_WORKER_TASK
+    ESP_RETURN_ON_ERROR(tusb_run_worker(), TAG, "Run TinyUSB worker task failed");
+#endif
 
     return ESP_OK;
 }
@@ -71,6 +211,9 @@ esp_err_t tusb_run_task(void)
 esp_err_t tusb_stop_task(void)
 {
     ESP_RETURN_ON_FALSE(s_tusb_tskh, ESP_ERR_INVALID_STATE, TAG, "TinyUSB main task not started yet");
+#if CONFIG_TINYUSB_WORKER_TASK
+    tusb_stop_worker();
+#endif
     vTaskDelete(s_tusb_tskh);
     s_tusb_tskh = NULL;
     return ESP_OK;
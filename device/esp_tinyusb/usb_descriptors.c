@@ -125,6 +125,31 @@ enum {
     ITF_NUM_CDC1_DATA,
 #endif
 
+#if CFG_TUD_CDC > 2
+    ITF_NUM_CDC2,
+    ITF_NUM_CDC2_DATA,
+#endif
+
+#if CFG_TUD_CDC > 3
+    ITF_NUM_CDC3,
+    ITF_NUM_CDC3_DATA,
+#endif
+
+#if CFG_TUD_CDC > 4
+    ITF_NUM_CDC4,
+    ITF_NUM_CDC4_DATA,
+#endif
+
+#if CFG_TUD_CDC > 5
+    ITF_NUM_CDC5,
+    ITF_NUM_CDC5_DATA,
+#endif
+
+#if CFG_TUD_CDC > 6
+    ITF_NUM_CDC6,
+    ITF_NUM_CDC6_DATA,
+#endif
+
 #if CFG_TUD_MSC
     ITF_NUM_MSC,
 #endif
@@ -167,6 +192,31 @@ enum {
     EPNUM_1_CDC,
 #endif
 
+#if CFG_TUD_CDC > 2
+    EPNUM_2_CDC_NOTIF,
+    EPNUM_2_CDC,
+#endif
+
+#if CFG_TUD_CDC > 3
+    EPNUM_3_CDC_NOTIF,
+    EPNUM_3_CDC,
+#endif
+
+#if CFG_TUD_CDC > 4
+    EPNUM_4_CDC_NOTIF,
+    EPNUM_4_CDC,
+#endif
+
+#if CFG_TUD_CDC > 5
+    EPNUM_5_CDC_NOTIF,
+    EPNUM_5_CDC,
+#endif
+
+#if CFG_TUD_CDC > 6
+    EPNUM_6_CDC_NOTIF,
+    EPNUM_6_CDC,
+#endif
+
 #if CFG_TUD_MSC
     EPNUM_MSC,
 #endif
@@ -181,10 +231,14 @@ enum {
 #endif
 
 #if CFG_TUD_VENDOR > 1
-    EPNUM_1_VENDOR
+    EPNUM_1_VENDOR,
 #endif
+
+    EPNUM_TOTAL
 };
 
+const uint8_t descriptor_cfg_default_ep_count = EPNUM_TOTAL - 1;
+
 //------------- STRID -------------//
 enum {
     STRID_LANGID = 0,
@@ -210,76 +264,128 @@ enum {
 };
 
 //------------- Configuration Descriptor -------------//
-uint8_t const descriptor_fs_cfg_default[] = {
-    // Configuration number, interface count, string index, total length, attribute, power in mA
-    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, TUSB_DESC_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+// The descriptors are built by macros into const arrays at compile time, so they stay in flash.
+// Each function descriptor macro takes the bulk endpoint size and expands to nothing if the class is disabled.
+#define DESC_FS_BULK_EP_SIZE    64
+#define DESC_HS_BULK_EP_SIZE    512
+#define DESC_CDC_NOTIF_EP_SIZE  8
+#define DESC_NET_NOTIF_EP_SIZE  64
 
-#if CFG_TUD_CDC
-    // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
-    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, STRID_CDC_INTERFACE, 0x80 | EPNUM_0_CDC_NOTIF, 8, EPNUM_0_CDC, 0x80 | EPNUM_0_CDC, 64),
-#endif
+_Static_assert(DESC_FS_BULK_EP_SIZE == 8 || DESC_FS_BULK_EP_SIZE == 16 || DESC_FS_BULK_EP_SIZE == 32 || DESC_FS_BULK_EP_SIZE == 64,
+               "FullSpeed bulk endpoint size must be 8, 16, 32 or 64 bytes");
+_Static_assert(DESC_HS_BULK_EP_SIZE == 512, "HighSpeed bulk endpoint size must be 512 bytes");
+_Static_assert(DESC_CDC_NOTIF_EP_SIZE <= 64 && DESC_NET_NOTIF_EP_SIZE <= 64, "FullSpeed interrupt endpoint size is up to 64 bytes");
 
-#if CFG_TUD_CDC > 1
-    // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
-    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC1, STRID_CDC_INTERFACE, 0x80 | EPNUM_1_CDC_NOTIF, 8, EPNUM_1_CDC, 0x80 | EPNUM_1_CDC, 64),
+// Endpoints used by the default descriptors, known to the preprocessor to diagnose the build
+#define DESC_CFG_DEFAULT_EP_COUNT (2 * CFG_TUD_CDC + CFG_TUD_MSC + 2 * CFG_TUD_NCM + CFG_TUD_VENDOR)
+_Static_assert(DESC_CFG_DEFAULT_EP_COUNT == EPNUM_TOTAL - 1, "Endpoint count out of sync with the endpoint numbers");
+#if (DESC_CFG_DEFAULT_EP_COUNT > TUSB_EPNUM_MAX)
+#warning "Default configuration descriptor needs more endpoints than the USB controller has, tinyusb_driver_install() needs a configuration descriptor"
 #endif
 
-#if CFG_TUD_MSC
-    // Interface number, string index, EP Out & EP In address, EP size
-    TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, STRID_MSC_INTERFACE, EPNUM_MSC, 0x80 | EPNUM_MSC, 64),
+// Configuration number, interface count, string index, total length, attribute, power in mA
+#define DESC_CFG_DEFAULT_HEADER(_type) \
+    TUD_CONFIG_DESC_LEN, _type, U16_TO_U8S_LE(TUSB_DESC_TOTAL_LEN), ITF_NUM_TOTAL, 1, 0, TU_BIT(7) | TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100 / 2
+
+// Interface number, string index, EP notification address and size, EP data address (out, in) and size.
+#define DESC_CDC(_itf, _ep_notif, _ep_data, _ep_size) \
+    TUD_CDC_DESCRIPTOR(_itf, STRID_CDC_INTERFACE, 0x80 | (_ep_notif), DESC_CDC_NOTIF_EP_SIZE, _ep_data, 0x80 | (_ep_data), _ep_size),
+
+#if CFG_TUD_CDC
+#define DESC_CDC0(_ep_size) DESC_CDC(ITF_NUM_CDC, EPNUM_0_CDC_NOTIF, EPNUM_0_CDC, _ep_size)
+#else
+#define DESC_CDC0(_ep_size)
 #endif
 
-#if CFG_TUD_NCM
-    // Interface number, description string index, MAC address string index, EP notification address and size, EP data address (out, in), and size, max segment size.
-    TUD_CDC_NCM_DESCRIPTOR(ITF_NUM_NET, STRID_NET_INTERFACE, STRID_MAC, (0x80 | EPNUM_NET_NOTIF), 64, EPNUM_NET_DATA, (0x80 | EPNUM_NET_DATA), 64, CFG_TUD_NET_MTU),
+#if CFG_TUD_CDC > 1
+#define DESC_CDC1(_ep_size) DESC_CDC(ITF_NUM_CDC1, EPNUM_1_CDC_NOTIF, EPNUM_1_CDC, _ep_size)
+#else
+#define DESC_CDC1(_ep_size)
 #endif
 
-#if CFG_TUD_VENDOR
-    // Interface number, string index, EP Out & IN address, EP size
-    TUD_VENDOR_DESCRIPTOR(ITF_VENDOR, STRID_VENDOR_INTERFACE, EPNUM_0_VENDOR, 0x80 | EPNUM_0_VENDOR, 64),
+#if CFG_TUD_CDC > 2
+#define DESC_CDC2(_ep_size) DESC_CDC(ITF_NUM_CDC2, EPNUM_2_CDC_NOTIF, EPNUM_2_CDC, _ep_size)
+#else
+#define DESC_CDC2(_ep_size)
 #endif
 
-#if CFG_TUD_VENDOR > 1
-    // Interface number, string index, EP Out & IN address, EP size
-    TUD_VENDOR_DESCRIPTOR(ITF_VENDOR1, STRID_VENDOR_INTERFACE, EPNUM_1_VENDOR, 0x80 | EPNUM_1_VENDOR, 64),
+#if CFG_TUD_CDC > 3
+#define DESC_CDC3(_ep_size) DESC_CDC(ITF_NUM_CDC3, EPNUM_3_CDC_NOTIF, EPNUM_3_CDC, _ep_size)
+#else
+#define DESC_CDC3(_ep_size)
 #endif
-};
 
-#if (TUD_OPT_HIGH_SPEED)
-uint8_t const descriptor_hs_cfg_default[] = {
-    // Configuration number, interface count, string index, total length, attribute, power in mA
-    TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, TUSB_DESC_TOTAL_LEN, TUSB_DESC_CONFIG_ATT_REMOTE_WAKEUP, 100),
+#if CFG_TUD_CDC > 4
+#define DESC_CDC4(_ep_size) DESC_CDC(ITF_NUM_CDC4, EPNUM_4_CDC_NOTIF, EPNUM_4_CDC, _ep_size)
+#else
+#define DESC_CDC4(_ep_size)
+#endif
 
-#if CFG_TUD_CDC
-    // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
-    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, STRID_CDC_INTERFACE, 0x80 | EPNUM_0_CDC_NOTIF, 8, EPNUM_0_CDC, 0x80 | EPNUM_0_CDC, 512),
+#if CFG_TUD_CDC > 5
+#define DESC_CDC5(_ep_size) DESC_CDC(ITF_NUM_CDC5, EPNUM_5_CDC_NOTIF, EPNUM_5_CDC, _ep_size)
+#else
+#define DESC_CDC5(_ep_size)
 #endif
 
-#if CFG_TUD_CDC > 1
-    // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
-    TUD_CDC_DESCRIPTOR(ITF_NUM_CDC1, STRID_CDC_INTERFACE, 0x80 | EPNUM_1_CDC_NOTIF, 8, EPNUM_1_CDC, 0x80 | EPNUM_1_CDC, 512),
+#if CFG_TUD_CDC > 6
+#define DESC_CDC6(_ep_size) DESC_CDC(ITF_NUM_CDC6, EPNUM_6_CDC_NOTIF, EPNUM_6_CDC, _ep_size)
+#else
+#define DESC_CDC6(_ep_size)
 #endif
 
 #if CFG_TUD_MSC
-    // Interface number, string index, EP Out & EP In address, EP size
-    TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, STRID_MSC_INTERFACE, EPNUM_MSC, 0x80 | EPNUM_MSC, 512),
+// Interface number, string index, EP Out & EP In address, EP size
+#define DESC_MSC(_ep_size) TUD_MSC_DESCRIPTOR(ITF_NUM_MSC, STRID_MSC_INTERFACE, EPNUM_MSC, 0x80 | EPNUM_MSC, _ep_size),
+#else
+#define DESC_MSC(_ep_size)
 #endif
 
 #if CFG_TUD_NCM
-    // Interface number, description string index, MAC address string index, EP notification address and size, EP data address (out, in), and size, max segment size.
-    TUD_CDC_NCM_DESCRIPTOR(ITF_NUM_NET, STRID_NET_INTERFACE, STRID_MAC, (0x80 | EPNUM_NET_NOTIF), 64, EPNUM_NET_DATA, (0x80 | EPNUM_NET_DATA), 512, CFG_TUD_NET_MTU),
+// Interface number, description string index, MAC address string index, EP notification address and size, EP data address (out, in), and size, max segment size.
+#define DESC_NET(_ep_size) TUD_CDC_NCM_DESCRIPTOR(ITF_NUM_NET, STRID_NET_INTERFACE, STRID_MAC, (0x80 | EPNUM_NET_NOTIF), DESC_NET_NOTIF_EP_SIZE, \
+                                                  EPNUM_NET_DATA, (0x80 | EPNUM_NET_DATA), _ep_size, CFG_TUD_NET_MTU),
+#else
+#define DESC_NET(_ep_size)
 #endif
 
 #if CFG_TUD_VENDOR
-    // Interface number, string index, EP Out & IN address, EP size
-    TUD_VENDOR_DESCRIPTOR(ITF_VENDOR, STRID_VENDOR_INTERFACE, EPNUM_0_VENDOR, 0x80 | EPNUM_0_VENDOR, 512),
+// Interface number, string index, EP Out & IN address, EP size
+#define DESC_VENDOR0(_ep_size) TUD_VENDOR_DESCRIPTOR(ITF_VENDOR, STRID_VENDOR_INTERFACE, EPNUM_0_VENDOR, 0x80 | EPNUM_0_VENDOR, _ep_size),
+#else
+#define DESC_VENDOR0(_ep_size)
 #endif
 
 #if CFG_TUD_VENDOR > 1
-    // Interface number, string index, EP Out & IN address, EP size
-    TUD_VENDOR_DESCRIPTOR(ITF_VENDOR1, STRID_VENDOR_INTERFACE, EPNUM_1_VENDOR, 0x80 | EPNUM_1_VENDOR, 512),
+#define DESC_VENDOR1(_ep_size) TUD_VENDOR_DESCRIPTOR(ITF_VENDOR1, STRID_VENDOR_INTERFACE, EPNUM_1_VENDOR, 0x80 | EPNUM_1_VENDOR, _ep_size),
+#else
+#define DESC_VENDOR1(_ep_size)
 #endif
+
+#define DESC_CFG_DEFAULT(_type, _ep_size) \
+    DESC_CFG_DEFAULT_HEADER(_type), \
+    DESC_CDC0(_ep_size) DESC_CDC1(_ep_size) DESC_CDC2(_ep_size) DESC_CDC3(_ep_size) \
+    DESC_CDC4(_ep_size) DESC_CDC5(_ep_size) DESC_CDC6(_ep_size) \
+    DESC_MSC(_ep_size) DESC_NET(_ep_size) DESC_VENDOR0(_ep_size) DESC_VENDOR1(_ep_size)
+
+uint8_t const descriptor_fs_cfg_default[] = {
+    DESC_CFG_DEFAULT(TUSB_DESC_CONFIGURATION, DESC_FS_BULK_EP_SIZE)
+};
+_Static_assert(sizeof(descriptor_fs_cfg_default) == TUSB_DESC_TOTAL_LEN, "Total length out of sync with the function descriptors");
+
+#if (TUD_OPT_HIGH_SPEED)
+uint8_t const descriptor_hs_cfg_default[] = {
+    DESC_CFG_DEFAULT(TUSB_DESC_CONFIGURATION, DESC_HS_BULK_EP_SIZE)
+};
+
+// Returned for GET OTHER SPEED CONFIGURATION: the FullSpeed configuration while running at HighSpeed and vice versa
+uint8_t const descriptor_fs_other_speed_default[] = {
+    DESC_CFG_DEFAULT(TUSB_DESC_OTHER_SPEED_CONFIG, DESC_FS_BULK_EP_SIZE)
+};
+
+uint8_t const descriptor_hs_other_speed_default[] = {
+    DESC_CFG_DEFAULT(TUSB_DESC_OTHER_SPEED_CONFIG, DESC_HS_BULK_EP_SIZE)
 };
+_Static_assert(sizeof(descriptor_hs_cfg_default) == TUSB_DESC_TOTAL_LEN, "Total length out of sync with the function descriptors");
 #endif // TUD_OPT_HIGH_SPEED
 
 #if CFG_TUD_NCM
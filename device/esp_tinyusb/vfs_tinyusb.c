@@ -17,16 +17,20 @@
 #include "esp_log.h"
 #include "esp_vfs.h"
 #include "esp_vfs_dev.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#if CONFIG_TINYUSB_CDC_VFS_FLUSH_TIMED
+#include "esp_timer.h"
+#endif
 #include "tinyusb.h"
 #include "tusb_cdc_acm.h"
+#include "cdc.h"
+#include "stats.h"
 #include "vfs_tinyusb.h"
 #include "sdkconfig.h"
 
 const static char *TAG = "tusb_vfs";
 
-// Token signifying that no character is available
-#define NONE -1
-
 #define FD_CHECK(fd, ret_val) do {                      \
                                     if ((fd) != 0) {    \
                                     errno = EBADF;      \
@@ -60,6 +64,10 @@ typedef struct {
     uint32_t flags;
     char vfs_path[VFS_TUSB_MAX_PATH];
     int cdc_intf;
+    SemaphoreHandle_t rx_sem; // Given on data reception, unblocks blocking reads
+#if CONFIG_TINYUSB_CDC_VFS_FLUSH_TIMED
+    esp_timer_handle_t flush_timer; // Flushes data queued by writes since the timer was started
+#endif
 } vfs_tinyusb_t;
 
 static vfs_tinyusb_t s_vfstusb;
@@ -81,6 +89,16 @@ static esp_err_t apply_path(char const *path)
     return ESP_OK;
 }
 
+#if CONFIG_TINYUSB_CDC_VFS_FLUSH_TIMED
+static void flush_timer_cb(void *arg)
+{
+    (void) arg;
+    _lock_acquire(&(s_vfstusb.write_lock));
+    tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
+    _lock_release(&(s_vfstusb.write_lock));
+}
+#endif
+
 /**
  * @brief Fill s_vfstusb
  *
@@ -94,7 +112,26 @@ static esp_err_t vfstusb_init(int cdc_intf, char const *path)
     s_vfstusb.tx_mode = DEFAULT_TX_MODE;
     s_vfstusb.rx_mode = DEFAULT_RX_MODE;
 
-    return apply_path(path);
+    esp_err_t ret = apply_path(path);
+    if (ret == ESP_OK && s_vfstusb.rx_sem == NULL) {
+        s_vfstusb.rx_sem = xSemaphoreCreateBinary();
+        if (s_vfstusb.rx_sem == NULL) {
+            ret = ESP_ERR_NO_MEM;
+        }
+    }
+#if CONFIG_TINYUSB_CDC_VFS_FLUSH_TIMED
+    if (ret == ESP_OK && s_vfstusb.flush_timer == NULL) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = &flush_timer_cb,
+            .name = "tusb_vfs_flush",
+        };
+        ret = esp_timer_create(&timer_args, &s_vfstusb.flush_timer);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Can't create flush timer (err: 0x%x)", ret);
+        }
+    }
+#endif
+    return ret;
 }
 
 /**
@@ -102,6 +139,16 @@ static esp_err_t vfstusb_init(int cdc_intf, char const *path)
  */
 static void vfstusb_deinit(void)
 {
+    tinyusb_cdcacm_set_internal_rx_callback(s_vfstusb.cdc_intf, NULL);
+    if (s_vfstusb.rx_sem) {
+        vSemaphoreDelete(s_vfstusb.rx_sem);
+    }
+#if CONFIG_TINYUSB_CDC_VFS_FLUSH_TIMED
+    if (s_vfstusb.flush_timer) {
+        esp_timer_stop(s_vfstusb.flush_timer);
+        esp_timer_delete(s_vfstusb.flush_timer);
+    }
+#endif
     _lock_close(&(s_vfstusb.write_lock));
     _lock_close(&(s_vfstusb.read_lock));
     memset(&s_vfstusb, 0, sizeof(s_vfstusb));
@@ -111,88 +158,167 @@ static int tusb_open(const char *path, int flags, int mode)
 {
     (void) mode;
     (void) path;
-    s_vfstusb.flags = flags | O_NONBLOCK; // for now only non-blocking mode is implemented
+    // Non-blocking by default for backward compatibility, use fcntl() to clear O_NONBLOCK for blocking reads
+    s_vfstusb.flags = flags | O_NONBLOCK;
     return 0;
 }
 
-static ssize_t tusb_write(int fd, const void *data, size_t size)
+/**
+ * @brief Queue data for transmission with the tx_mode line endings
+ *
+ * Data between newlines is queued at once, line endings are only inserted at newlines.
+ *
+ * @param[in]  data    Data to queue
+ * @param[in]  size    Size of the data
+ * @param[out] newline Set to true, if at least one newline was queued
+ * @return Number of bytes of the data queued, less than size if the FIFO is full
+ */
+static size_t tusb_write_queue(const char *data, size_t size, bool *newline)
 {
-    FD_CHECK(fd, -1);
+    const char *eol;
+    size_t eol_len;
+    switch (s_vfstusb.tx_mode) {
+    case ESP_LINE_ENDINGS_CRLF:
+        eol = "\r\n";
+        eol_len = 2;
+        break;
+    case ESP_LINE_ENDINGS_CR:
+        eol = "\r";
+        eol_len = 1;
+        break;
+    default:
+        eol = "\n";
+        eol_len = 1;
+        break;
+    }
+
     size_t written_sz = 0;
-    const char *data_c = (const char *)data;
-    _lock_acquire(&(s_vfstusb.write_lock));
-    for (size_t i = 0; i < size; i++) {
-        int c = data_c[i];
-        if (c != '\n') {
-            if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, c)) {
-                break; // can't write anymore
-            }
-        } else {
-            if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF || s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CR) {
-                char cr = '\r';
-                if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, cr)) {
-                    break; // can't write anymore
-                }
-            }
-            if (s_vfstusb.tx_mode == ESP_LINE_ENDINGS_CRLF || s_vfstusb.tx_mode == ESP_LINE_ENDINGS_LF) {
-                char lf = '\n';
-                if (!tinyusb_cdcacm_write_queue_char(s_vfstusb.cdc_intf, lf)) {
-                    break; // can't write anymore
-                }
-            }
+    while (written_sz < size) {
+        const char *run = data + written_sz;
+        const char *lf = memchr(run, '\n', size - written_sz);
+        const size_t run_len = lf ? (size_t)(lf - run) : (size - written_sz);
+
+        const size_t queued = tinyusb_cdcacm_write_queue(s_vfstusb.cdc_intf, (const uint8_t *)run, run_len);
+        written_sz += queued;
+        if (queued < run_len || lf == NULL) {
+            break; // can't write anymore or no newline left
+        }
+        if (tud_cdc_n_write_available(s_vfstusb.cdc_intf) < eol_len) {
+            break; // don't split the line ending
         }
+        tinyusb_cdcacm_write_queue(s_vfstusb.cdc_intf, (const uint8_t *)eol, eol_len);
         written_sz++;
+        *newline = true;
     }
+    return written_sz;
+}
+
+static void tusb_rx_cb(int itf, cdcacm_event_t *event)
+{
+    (void) itf;
+    (void) event;
+    xSemaphoreGive(s_vfstusb.rx_sem);
+}
+
+static ssize_t tusb_write(int fd, const void *data, size_t size)
+{
+    FD_CHECK(fd, -1);
+    bool newline = false;
+    _lock_acquire(&(s_vfstusb.write_lock));
+    size_t written_sz = tusb_write_queue((const char *)data, size, &newline);
+#if CONFIG_TINYUSB_CDC_VFS_FLUSH_EVERY_WRITE
+    (void) newline;
     tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
+#elif CONFIG_TINYUSB_CDC_VFS_FLUSH_NEWLINE
+    // Also flush when the FIFO is full, the rest of the data can't be queued until it is sent
+    if (newline || written_sz < size) {
+        tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
+    }
+#elif CONFIG_TINYUSB_CDC_VFS_FLUSH_TIMED
+    (void) newline;
+    if (written_sz < size) {
+        tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
+    } else if (!esp_timer_is_active(s_vfstusb.flush_timer)) {
+        esp_timer_start_once(s_vfstusb.flush_timer, CONFIG_TINYUSB_CDC_VFS_FLUSH_DELAY_MS * 1000);
+    }
+#endif
     _lock_release(&(s_vfstusb.write_lock));
     return written_sz;
 }
 
-static int tusb_close(int fd)
+static int tusb_fsync(int fd)
 {
     FD_CHECK(fd, -1);
+    _lock_acquire(&(s_vfstusb.write_lock));
+    tud_cdc_n_write_flush(s_vfstusb.cdc_intf);
+    _lock_release(&(s_vfstusb.write_lock));
     return 0;
 }
 
-static ssize_t tusb_read(int fd, void *data, size_t size)
+static int tusb_close(int fd)
 {
     FD_CHECK(fd, -1);
-    char *data_c = (char *) data;
-    size_t received = 0;
-    _lock_acquire(&(s_vfstusb.read_lock));
+    return 0;
+}
 
-    if (tud_cdc_n_available(s_vfstusb.cdc_intf) == 0) {
-        goto finish;
+/**
+ * @brief Convert line endings of received data from rx_mode to LF in place
+ *
+ * @param[inout] data Received data
+ * @param[in]    len  Length of the received data
+ * @return Length of the converted data
+ */
+static size_t tusb_read_convert(char *data, size_t len)
+{
+    char *cr = memchr(data, '\r', len);
+    if (cr == NULL || s_vfstusb.rx_mode == ESP_LINE_ENDINGS_LF) {
+        return len;
     }
-    while (received < size) {
-        int c = tud_cdc_n_read_char(s_vfstusb.cdc_intf);
-        if ( c == NONE) { // if data ends
-            break;
-        }
-
-        // Handle line endings. From configured mode -> LF mode
-        if (s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CR) {
-            // Change CRs to newlines
-            if (c == '\r') {
-                c = '\n';
-            }
-        } else if (s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CRLF) {
-            if (c == '\r') {
-                uint8_t next_char = NONE;
-                // Check if next char is newline. If yes, we got CRLF sequence
-                tud_cdc_n_peek(s_vfstusb.cdc_intf, &next_char);
-                if (next_char == '\n') {
+    if (s_vfstusb.rx_mode == ESP_LINE_ENDINGS_CR) {
+        // Change CRs to newlines
+        do {
+            *cr = '\n';
+            cr = memchr(cr + 1, '\r', len - (cr + 1 - data));
+        } while (cr);
+        return len;
+    }
+    // ESP_LINE_ENDINGS_CRLF: drop CR of each CRLF sequence
+    size_t out = cr - data;
+    for (size_t i = out; i < len; i++) {
+        char c = data[i];
+        if (c == '\r') {
+            if (i + 1 < len) {
+                if (data[i + 1] == '\n') {
+                    continue;
+                }
+            } else {
+                // CR is the last received char, check if next char in the fifo is newline
+                uint8_t next_char = 0;
+                if (tud_cdc_n_peek(s_vfstusb.cdc_intf, &next_char) && next_char == '\n') {
                     c = tud_cdc_n_read_char(s_vfstusb.cdc_intf); // Remove '\n' from the fifo
                 }
             }
         }
+        data[out++] = c;
+    }
+    return out;
+}
 
-        data_c[received] = (char) c;
-        ++received;
-        if (c == '\n') {
-            break;
+static ssize_t tusb_read(int fd, void *data, size_t size)
+{
+    FD_CHECK(fd, -1);
+    size_t received = 0;
+    _lock_acquire(&(s_vfstusb.read_lock));
+
+    while (tud_cdc_n_available(s_vfstusb.cdc_intf) == 0) {
+        if (s_vfstusb.flags & O_NONBLOCK) {
+            goto finish;
         }
+        xSemaphoreTake(s_vfstusb.rx_sem, portMAX_DELAY);
     }
+    received = tud_cdc_n_read(s_vfstusb.cdc_intf, data, size);
+    TINYUSB_STATS_XFER(cdc[s_vfstusb.cdc_intf].rx, received);
+    received = tusb_read_convert((char *) data, received);
 finish:
     _lock_release(&(s_vfstusb.read_lock));
     if (received > 0) {
@@ -268,12 +394,14 @@ esp_err_t esp_vfs_tusb_cdc_register(int cdc_intf, char const *path)
     if (res != ESP_OK) {
         return res;
     }
+    tinyusb_cdcacm_set_internal_rx_callback(cdc_intf, &tusb_rx_cb);
 
     esp_vfs_t vfs = {
         .flags = ESP_VFS_FLAG_DEFAULT,
         .close = &tusb_close,
         .fcntl = &tusb_fcntl,
         .fstat = &tusb_fstat,
+        .fsync = &tusb_fsync,
         .open = &tusb_open,
         .read = &tusb_read,
         .write = &tusb_write,
@@ -282,6 +410,7 @@ esp_err_t esp_vfs_tusb_cdc_register(int cdc_intf, char const *path)
     res = esp_vfs_register(s_vfstusb.vfs_path, &vfs, NULL);
     if (res != ESP_OK) {
         ESP_LOGE(TAG, "Can't register CDC-VFS driver (err: %x)", res);
+        vfstusb_deinit();
     } else {
         ESP_LOGD(TAG, "CDC-VFS registered (%s)", s_vfstusb.vfs_path);
     }
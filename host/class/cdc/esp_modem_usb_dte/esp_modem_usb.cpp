@@ -4,6 +4,8 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <mutex>
+#include <optional>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
@@ -16,17 +18,27 @@
 #include "usb/cdc_acm_host.h"
 #include "sdkconfig.h"
 #include "usb_terminal.hpp"
+#include "ppp_hdlc.hpp"
 
 static const char *TAG = "usb_terminal";
 
+// Maximum PPP frame with the default MRU of 1500 bytes: address, control, protocol, information and FCS, with margin
+static constexpr size_t ppp_frame_max = 1600;
+
+// USB Host Lib and CDC-ACM driver are shared by all terminals, see usb_drivers_acquire()
+static std::mutex usb_drivers_lock;
+static int usb_drivers_refs = 0;                 // Terminals that use the drivers
+static bool cdc_acm_installed_here = false;      // CDC-ACM driver was installed by a terminal, it is uninstalled with the last one
+static TaskHandle_t usb_host_lib_task = nullptr; // USB Host task, if USB Host Lib was installed by a terminal
+
 /**
  * @brief USB Host task
  *
  * This task is created only if install_usb_host is set to true in DTE configuration.
  * In case you don't want to install USB Host driver here, you must install it before creating UsbTerminal object.
  *
- * This implementation of USB Host Lib handling never returns, which means that the USB Host Lib will keep running
- * even after all USB devices are disconnected. That allows repeated device reconnections.
+ * The task runs while any terminal exists, even if all USB devices are disconnected. That allows repeated device reconnections.
+ * USB Host Lib is uninstalled when its last client, the CDC-ACM driver, is uninstalled with the last terminal.
  *
  * If you want/need to handle lifetime of USB Host Lib, you can set install_usb_host to false and manage it yourself.
  *
@@ -39,58 +51,96 @@ static void usb_host_task(void *arg)
         esp_err_t err = ESP_OK;
         err = usb_host_lib_handle_events(portMAX_DELAY, &event_flags);
         if (event_flags & USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS) {
-            err = usb_host_device_free_all();
-            ESP_LOGD(TAG, "No more clients: clean up %d", err);
-            err = usb_host_uninstall();
-            ESP_LOGD(TAG, "USB Host uninstalled %d", err);
-            *(TaskHandle_t *)arg = nullptr;
-            vTaskDelete(NULL);
-        }
-        if (event_flags & USB_HOST_LIB_EVENT_FLAGS_ALL_FREE) {
-            err = cdc_acm_host_uninstall();
-            ESP_LOGD(TAG, "CDC-ACM Host uninstalled %d", err);
+            usb_drivers_lock.lock();
+            // A new terminal could have installed the CDC-ACM driver again since the event
+            if (usb_drivers_refs == 0) {
+                err = usb_host_device_free_all();
+                ESP_LOGD(TAG, "No more clients: clean up %d", err);
+                err = usb_host_uninstall();
+                ESP_LOGD(TAG, "USB Host uninstalled %d", err);
+                usb_host_lib_task = nullptr;
+                usb_drivers_lock.unlock();
+                vTaskDelete(NULL);
+            }
+            usb_drivers_lock.unlock();
         }
     }
 }
 
-namespace esp_modem {
-class UsbTerminal : public Terminal, private CdcAcmDevice {
-public:
-    explicit UsbTerminal(const esp_modem_dte_config *config, int term_idx): buffer_size(config->dte_buffer_size)
-    {
-        const struct esp_modem_usb_term_config *usb_config = (struct esp_modem_usb_term_config *)(config->extension_config);
+/**
+ * @brief Take a reference to the USB drivers, install them with the first one
+ *
+ * All DTEs and both terminals of a dual port modem share one USB Host task and one CDC-ACM driver.
+ * The CDC-ACM driver is installed with configuration of the first terminal. If it was installed by the application,
+ * it is left installed after the last terminal.
+ *
+ * @param[in] config DTE configuration
+ */
+static void usb_drivers_acquire(const esp_modem_dte_config *config)
+{
+    const struct esp_modem_usb_term_config *usb_config = (struct esp_modem_usb_term_config *)(config->extension_config);
+    std::lock_guard<std::mutex> guard(usb_drivers_lock);
+
+    // Install USB Host driver (if not already installed)
+    if (usb_config->install_usb_host && !usb_host_lib_task) {
+        usb_host_config_t host_config = {};
+        host_config.skip_phy_setup = false;
+        host_config.intr_flags = ESP_INTR_FLAG_LEVEL1;
 
-        // Install USB Host driver (if not already installed)
-        if (usb_config->install_usb_host && !usb_host_lib_task) {
-            usb_host_config_t host_config = {};
-            host_config.skip_phy_setup = false;
-            host_config.intr_flags = ESP_INTR_FLAG_LEVEL1;
-
-            ESP_MODEM_THROW_IF_ERROR(usb_host_install(&host_config), "USB Host install failed");
-            ESP_LOGD(TAG, "USB Host installed");
-            // The priority of the usb_host task should be lower than that of the USB-CDC task. 
-            // This ensures that when the CDC-ACM device is disconnected, 
-            // the USB-CDC task first calls cdc_acm_host_close(), 
-            // and then the usb_host calls cdc_acm_host_uninstall().
-            ESP_MODEM_THROW_IF_FALSE(config->task_priority >= 1);
-            ESP_MODEM_THROW_IF_FALSE(
-                pdTRUE == xTaskCreatePinnedToCore(usb_host_task, "usb_host", 4096, &usb_host_lib_task, config->task_priority - 1, &usb_host_lib_task, usb_config->xCoreID),
-                "USB host task failed");
-        }
-
-        // Install CDC-ACM driver
+        ESP_MODEM_THROW_IF_ERROR(usb_host_install(&host_config), "USB Host install failed");
+        ESP_LOGD(TAG, "USB Host installed");
+        // The priority of the usb_host task should be lower than that of the USB-CDC task.
+        // This ensures that when the CDC-ACM device is disconnected,
+        // the USB-CDC task first calls cdc_acm_host_close(),
+        // and then the usb_host calls usb_host_uninstall().
+        ESP_MODEM_THROW_IF_FALSE(config->task_priority >= 1);
+        ESP_MODEM_THROW_IF_FALSE(
+            pdTRUE == xTaskCreatePinnedToCore(usb_host_task, "usb_host", 4096, nullptr, config->task_priority - 1, &usb_host_lib_task, usb_config->xCoreID),
+            "USB host task failed");
+    }
+
+    // Install CDC-ACM driver with the first terminal
+    if (usb_drivers_refs == 0) {
         const cdc_acm_host_driver_config_t esp_modem_cdc_acm_driver_config = {
             .driver_task_stack_size = config->task_stack_size,
             .driver_task_priority = config->task_priority,
             .xCoreID = (BaseType_t)usb_config->xCoreID,
             .new_dev_cb = NULL, // We don't forward this information to user. User can poll USB Host Lib.
         };
+        const esp_err_t err = cdc_acm_host_install(&esp_modem_cdc_acm_driver_config);
+        // ESP_ERR_INVALID_STATE: already installed by the application, or by us if its uninstallation failed
+        ESP_MODEM_THROW_IF_FALSE(err == ESP_OK || err == ESP_ERR_INVALID_STATE, "CDC-ACM install failed");
+        if (err == ESP_OK) {
+            cdc_acm_installed_here = true;
+        }
+    }
+    usb_drivers_refs++;
+}
 
-        // Silently continue on error: CDC-ACM driver might be already installed
-        cdc_acm_host_install(&esp_modem_cdc_acm_driver_config);
+/**
+ * @brief Release a reference to the USB drivers, the last one uninstalls the CDC-ACM driver if it was installed here
+ */
+static void usb_drivers_release()
+{
+    std::lock_guard<std::mutex> guard(usb_drivers_lock);
+    if (--usb_drivers_refs == 0 && cdc_acm_installed_here) {
+        const esp_err_t err = cdc_acm_host_uninstall();
+        ESP_LOGD(TAG, "CDC-ACM Host uninstalled %d", err);
+        if (err == ESP_OK) {
+            cdc_acm_installed_here = false;
+        }
+    }
+}
+
+namespace esp_modem {
+class UsbTerminal : public Terminal, private CdcAcmDevice {
+public:
+    explicit UsbTerminal(const esp_modem_dte_config *config, int term_idx): drivers(config), buffer_size(config->dte_buffer_size), out_xfer_count(0)
+    {
+        const struct esp_modem_usb_term_config *usb_config = (struct esp_modem_usb_term_config *)(config->extension_config);
 
-        // Open CDC-ACM device
-        const cdc_acm_host_device_config_t esp_modem_cdc_acm_device_config = {
+        // Open CDC-ACM device, the drivers are shared with other terminals
+        cdc_acm_host_device_config_t esp_modem_cdc_acm_device_config = {
             .connection_timeout_ms = usb_config->timeout_ms,
             .out_buffer_size = config->dte_buffer_size,
             .in_buffer_size = config->dte_buffer_size,
@@ -99,6 +149,25 @@ public:
             .user_arg = this
         };
 
+        // Data terminal fast path: several IN transfers in flight and asynchronous TX.
+        // Only the secondary terminal carries pure network data. The primary terminal must be able to append
+        // fragmented AT responses in one IN buffer, which is not possible with multiple IN transfers.
+        if (term_idx != 0) {
+            esp_modem_cdc_acm_device_config.in_xfer_count = usb_config->data_fast_path.in_xfer_count;
+            esp_modem_cdc_acm_device_config.out_xfer_count = usb_config->data_fast_path.out_xfer_count;
+            esp_modem_cdc_acm_device_config.rx_task.stack_size = usb_config->data_fast_path.rx_task_stack_size;
+            esp_modem_cdc_acm_device_config.rx_task.priority = config->task_priority;
+            esp_modem_cdc_acm_device_config.rx_task.xCoreID = usb_config->xCoreID;
+            out_xfer_count = usb_config->data_fast_path.out_xfer_count;
+            if (usb_config->data_fast_path.ppp_framing) {
+                ppp_decoder = std::make_unique<ppp_hdlc::Decoder>(ppp_frame_max);
+                ppp_tx_buf = std::make_unique<uint8_t[]>(ppp_hdlc::Encoder::max_encoded_len(ppp_frame_max));
+                ppp_frame_cb = [this](uint8_t *frame, size_t len) {
+                    this->on_read(frame, len);
+                };
+            }
+        }
+
         // Determine Terminal interface index
         const uint8_t intf_idx = term_idx == 0 ? usb_config->interface_idx : usb_config->secondary_interface_idx;
 
@@ -111,11 +180,29 @@ public:
                 this->CdcAcmDevice::open_vendor_specific(usb_config->vid, usb_config->pid, intf_idx, &esp_modem_cdc_acm_device_config),
                 "USB Device open failed");
         }
+
+        // Reconnected modem is opened directly from the new device event of the driver, with the same configuration.
+        // Registered only after the first opening, so that the polling cdc_acm_host_open() above does not race with it
+        if (usb_config->auto_reconnect.enabled) {
+            reconnected_cb = usb_config->auto_reconnect.reconnected_cb;
+            reconnected_arg = usb_config->auto_reconnect.user_arg;
+            const esp_err_t err = cdc_acm_host_auto_open_register(usb_config->vid, usb_config->pid, intf_idx, &esp_modem_cdc_acm_device_config, handle_reconnect);
+            if (err != ESP_OK) {
+                this->CdcAcmDevice::close();
+                ESP_MODEM_THROW_IF_ERROR(err, "USB auto-reconnect failed");
+            }
+            auto_reconnect = {usb_config->vid, usb_config->pid, intf_idx};
+        }
     };
 
     ~UsbTerminal()
     {
-        this->CdcAcmDevice::close();
+        if (auto_reconnect) {
+            cdc_acm_host_auto_open_unregister(auto_reconnect->vid, auto_reconnect->pid, auto_reconnect->intf_idx);
+        }
+        if (this->cdc_hdl) {
+            this->CdcAcmDevice::close();
+        }
     };
 
     void start() override
@@ -131,17 +218,10 @@ public:
     int write(uint8_t *data, size_t len) override
     {
         ESP_LOG_BUFFER_HEXDUMP(TAG, data, len, ESP_LOG_DEBUG);
-        uint8_t *ptr = data;
-        size_t remain = len;
-        while (remain > 0) {
-            int batch = std::min(buffer_size, remain);
-            if (this->CdcAcmDevice::tx_blocking(ptr, batch) != ESP_OK) {
-                return -1;
-            }
-            remain -= batch;
-            ptr += batch;
+        if (ppp_decoder) {
+            return write_ppp_frame(data, len);
         }
-        return len;
+        return write_raw(data, len);
     }
 
     int read(uint8_t *data, size_t len) override
@@ -157,13 +237,88 @@ private:
     UsbTerminal &operator=(const UsbTerminal &copy) = delete;
     bool operator== (const UsbTerminal &param) const = delete;
     bool operator!= (const UsbTerminal &param) const = delete;
-    static TaskHandle_t usb_host_lib_task; // Reused by multiple devices or between reconnections
+
+    /**
+     * @brief Reference to the USB drivers, held for the lifetime of the terminal
+     *
+     * First member of the terminal: the drivers are acquired before the device is opened,
+     * and released after it is closed, also if the constructor throws.
+     */
+    struct UsbDrivers {
+        explicit UsbDrivers(const esp_modem_dte_config *config)
+        {
+            usb_drivers_acquire(config);
+        }
+        ~UsbDrivers()
+        {
+            usb_drivers_release();
+        }
+    };
+
+    int write_raw(uint8_t *data, size_t len)
+    {
+        uint8_t *ptr = data;
+        size_t remain = len;
+        if (out_xfer_count > 0) {
+            // Asynchronous TX copies the data to the transfer pool, so the caller can reuse its buffer right away
+            while (remain > 0) {
+                size_t batch = std::min(buffer_size * out_xfer_count, remain);
+                if (this->CdcAcmDevice::tx_async(ptr, batch, handle_tx_done, this, 100) != ESP_OK) {
+                    return -1;
+                }
+                remain -= batch;
+                ptr += batch;
+            }
+            return len;
+        }
+        while (remain > 0) {
+            int batch = std::min(buffer_size, remain);
+            if (this->CdcAcmDevice::tx_blocking(ptr, batch) != ESP_OK) {
+                return -1;
+            }
+            remain -= batch;
+            ptr += batch;
+        }
+        return len;
+    }
+
+    /**
+     * @brief Write one PPP frame with HDLC framing
+     *
+     * With asynchronous TX, the frame is escaped straight into a lent OUT transfer buffer.
+     * Frames larger than one OUT transfer and blocking TX go through the TX frame buffer.
+     */
+    int write_ppp_frame(uint8_t *frame, size_t len)
+    {
+        if (out_xfer_count > 0) {
+            uint8_t *buf;
+            size_t buf_size;
+            if (this->CdcAcmDevice::tx_buffer_get(&buf, &buf_size, 100) != ESP_OK) {
+                return -1;
+            }
+            const size_t encoded_len = ppp_encoder.encode(frame, len, buf, buf_size);
+            if (encoded_len > 0) {
+                return this->CdcAcmDevice::tx_buffer_submit(buf, encoded_len, handle_tx_done, this) == ESP_OK ? len : -1;
+            }
+            this->CdcAcmDevice::tx_buffer_submit(buf, 0); // Return the buffer, the frame does not fit into it
+        }
+        const size_t encoded_len = ppp_encoder.encode(frame, len, ppp_tx_buf.get(), ppp_hdlc::Encoder::max_encoded_len(ppp_frame_max));
+        if (encoded_len == 0) {
+            ESP_LOGW(TAG, "PPP frame of %d bytes is too long", (int)len);
+            return -1;
+        }
+        return write_raw(ppp_tx_buf.get(), encoded_len) < 0 ? -1 : len;
+    }
 
     static bool handle_rx(const uint8_t *data, size_t data_len, void *user_arg)
     {
         ESP_LOG_BUFFER_HEXDUMP(TAG, data, data_len, ESP_LOG_DEBUG);
         auto *this_terminal = static_cast<UsbTerminal *>(user_arg);
-        if (data_len > 0 && this_terminal->on_read) {
+        if (data_len > 0 && this_terminal->on_read && this_terminal->ppp_decoder) {
+            // Frames are unescaped in the IN transfer buffer, which is resubmitted after this callback
+            this_terminal->ppp_decoder->process(const_cast<uint8_t *>(data), data_len, this_terminal->ppp_frame_cb);
+            return true;
+        } else if (data_len > 0 && this_terminal->on_read) {
             return this_terminal->on_read((uint8_t *)data, data_len);
         } else {
             ESP_LOGD(TAG, "Unhandled RX data");
@@ -171,6 +326,37 @@ private:
         }
     }
 
+    /**
+     * @brief Reconnected modem was opened by the CDC-ACM driver
+     *
+     * Called from the auto-open task of the CDC-ACM driver, right after the enumeration of the modem.
+     */
+    static void handle_reconnect(cdc_acm_dev_hdl_t cdc_hdl, void *user_arg)
+    {
+        auto *this_terminal = static_cast<UsbTerminal *>(user_arg);
+        if (this_terminal->cdc_hdl) {
+            // Another device with the same VID/PID, this terminal is still connected
+            ESP_LOGW(TAG, "Another USB modem with the same VID/PID connected, closing it");
+            cdc_acm_host_close(cdc_hdl);
+            return;
+        }
+        ESP_LOGI(TAG, "USB terminal reconnected");
+        if (this_terminal->ppp_decoder) {
+            this_terminal->ppp_decoder->reset();
+        }
+        __atomic_store_n(&this_terminal->cdc_hdl, cdc_hdl, __ATOMIC_RELEASE);
+        if (this_terminal->reconnected_cb) {
+            this_terminal->reconnected_cb(this_terminal->reconnected_arg);
+        }
+    }
+
+    static void handle_tx_done(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg)
+    {
+        if (status != ESP_OK) {
+            ESP_LOGW(TAG, "Asynchronous TX failed: %s", esp_err_to_name(status));
+        }
+    }
+
     static void handle_notif(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
     {
         auto *this_terminal = static_cast<UsbTerminal *>(user_ctx);
@@ -182,6 +368,10 @@ private:
             ESP_LOGD(TAG, "Ignored USB event %d", event->type);
             break;
         case CDC_ACM_HOST_DEVICE_DISCONNECTED:
+            if (event->data.cdc_hdl != this_terminal->cdc_hdl) {
+                cdc_acm_host_close(event->data.cdc_hdl); // Not the device of this terminal
+                break;
+            }
             ESP_LOGW(TAG, "USB terminal disconnected");
             if (this_terminal->on_error) {
                 this_terminal->on_error(terminal_error::DEVICE_GONE);
@@ -198,10 +388,22 @@ private:
             abort();
         }
     }
+    UsbDrivers drivers;
     size_t buffer_size;
+    size_t out_xfer_count; // Number of OUT transfers for asynchronous TX, 0 for blocking TX
+    std::unique_ptr<ppp_hdlc::Decoder> ppp_decoder;  // HDLC framing of PPP frames, nullptr if disabled
+    ppp_hdlc::Encoder ppp_encoder;
+    ppp_hdlc::Decoder::frame_cb ppp_frame_cb;         // Passes received PPP frames to on_read
+    std::unique_ptr<uint8_t[]> ppp_tx_buf;            // Frames that do not fit into one OUT transfer
+    struct auto_reconnect_t {
+        uint16_t vid;
+        uint16_t pid;
+        uint8_t intf_idx;
+    };
+    std::optional<auto_reconnect_t> auto_reconnect;   // Registered interface for reopening on reconnection
+    void (*reconnected_cb)(void *user_arg) = nullptr;
+    void *reconnected_arg = nullptr;
 };
-TaskHandle_t UsbTerminal::usb_host_lib_task = nullptr;
-
 std::unique_ptr<Terminal> create_usb_terminal(const esp_modem_dte_config *config, int term_idx)
 {
     TRY_CATCH_RET_NULL(
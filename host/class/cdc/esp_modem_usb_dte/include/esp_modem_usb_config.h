@@ -7,6 +7,7 @@
 #pragma once
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 /**
  * @brief USB configuration structure
@@ -21,6 +22,17 @@ struct esp_modem_usb_term_config {
     int xCoreID;                 /*!< Core affinity of created tasks: CDC-ACM driver task and optional USB Host task */
     bool cdc_compliant;          /*!< Treat the USB device as CDC-compliant. Read CDC-ACM driver documentation for more details */
     bool install_usb_host;       /*!< Flag whether USB Host driver should be installed */
+    struct {
+        uint8_t in_xfer_count;   /*!< Number of BULK IN transfers kept in flight. Set to 0 or 1 for a single transfer */
+        uint8_t out_xfer_count;  /*!< Number of BULK OUT transfers for asynchronous TX. Set to 0 for blocking TX */
+        bool ppp_framing;        /*!< HDLC framing of PPP in the terminal: on_read gets PPP frames without flags, escapes and FCS, write takes one PPP frame */
+        size_t rx_task_stack_size; /*!< Stack size of RX task of the terminal, so its data are passed to the DTE outside of the CDC-ACM driver task shared by all terminals. Set to 0 to disable */
+    } data_fast_path;            /*!< High-throughput settings of the secondary (data) terminal. Ignored for the primary terminal */
+    struct {
+        bool enabled;                        /*!< Reopen the terminal when the modem reconnects, e.g. after its reset. DEVICE_GONE error is reported on disconnection */
+        void (*reconnected_cb)(void *user_arg); /*!< Called from the CDC-ACM driver task when the terminal was reopened. Can be NULL */
+        void *user_arg;                      /*!< Argument of reconnected_cb */
+    } auto_reconnect;            /*!< Reconnection without re-creating the DTE */
 };
 
 /**
@@ -55,7 +67,18 @@ struct esp_modem_usb_term_config {
         .timeout_ms = 0,                                             \
         .xCoreID = 0,                                                \
         .cdc_compliant = false,                                      \
-        .install_usb_host = true                                     \
+        .install_usb_host = true,                                    \
+        .data_fast_path = {                                          \
+            .in_xfer_count = 0,                                      \
+            .out_xfer_count = 0,                                     \
+            .ppp_framing = false,                                    \
+            .rx_task_stack_size = 0,                                 \
+        },                                                           \
+        .auto_reconnect = {                                          \
+            .enabled = false,                                        \
+            .reconnected_cb = NULL,                                  \
+            .user_arg = NULL,                                        \
+        }                                                            \
     }
 #define ESP_MODEM_DEFAULT_USB_CONFIG(_vid, _pid, _intf) ESP_MODEM_DEFAULT_USB_CONFIG_DUAL(_vid, _pid, _intf, -1)
 
@@ -0,0 +1,261 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <cstring>
+#include "ppp_hdlc.hpp"
+
+namespace esp_modem {
+namespace ppp_hdlc {
+
+namespace {
+using fcs_table_t = std::array<std::array<uint16_t, 256>, 4>;
+
+// Tables of reflected CRC-16/X.25 (polynomial 0x8408): table[0] for bytewise update,
+// table[k] advances the CRC of a byte by k more bytes
+constexpr fcs_table_t make_fcs_table()
+{
+    fcs_table_t table{};
+    for (int i = 0; i < 256; i++) {
+        uint16_t fcs = i;
+        for (int bit = 0; bit < 8; bit++) {
+            fcs = (fcs & 1) ? (fcs >> 1) ^ 0x8408 : (fcs >> 1);
+        }
+        table[0][i] = fcs;
+    }
+    for (int k = 1; k < 4; k++) {
+        for (int i = 0; i < 256; i++) {
+            table[k][i] = (table[k - 1][i] >> 8) ^ table[0][table[k - 1][i] & 0xFF];
+        }
+    }
+    return table;
+}
+
+constexpr fcs_table_t fcs_table = make_fcs_table();
+
+/**
+ * @brief Find first occurrence of a byte, one 32-bit word per step
+ *
+ * Word loads are aligned, as the Xtensa cores do not support unaligned loads.
+ */
+const uint8_t *find_byte(const uint8_t *p, const uint8_t *end, uint8_t c)
+{
+    while (p < end && (reinterpret_cast<uintptr_t>(p) & 3)) {
+        if (*p == c) {
+            return p;
+        }
+        p++;
+    }
+    const uint32_t pattern = 0x01010101U * c;
+    while (end - p >= 4) {
+        const uint32_t w = *reinterpret_cast<const uint32_t *>(p) ^ pattern;
+        if ((w - 0x01010101U) & ~w & 0x80808080U) {
+            break; // One of the bytes is c
+        }
+        p += 4;
+    }
+    while (p < end && *p != c) {
+        p++;
+    }
+    return p;
+}
+
+/**
+ * @brief Unescape data without flags in place
+ *
+ * @param[inout] data   Data, the unescaped data are written to its start
+ * @param[in]    len    Length of the data in bytes
+ * @param[inout] escape ESCAPE was the last byte of previous data
+ * @return Length of the unescaped data
+ */
+size_t unescape_in_place(uint8_t *data, size_t len, bool &escape)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    uint8_t *out = data;
+    if (escape && p < end) {
+        *out++ = *p++ ^ ESCAPE_XOR;
+        escape = false;
+    }
+    while (p < end) {
+        const uint8_t *esc = find_byte(p, end, ESCAPE);
+        const size_t run = esc - p;
+        if (out != p) {
+            memmove(out, p, run);
+        }
+        out += run;
+        p = esc;
+        if (p == end) {
+            break;
+        }
+        if (++p == end) {
+            escape = true; // The escaped byte is in the next buffer
+            break;
+        }
+        *out++ = *p++ ^ ESCAPE_XOR;
+    }
+    return out - data;
+}
+} // namespace
+
+uint16_t fcs16(uint16_t fcs, const uint8_t *data, size_t len)
+{
+    while (len >= 4) {
+        const uint16_t x = fcs ^ (data[0] | (data[1] << 8));
+        fcs = fcs_table[3][x & 0xFF] ^ fcs_table[2][x >> 8] ^ fcs_table[1][data[2]] ^ fcs_table[0][data[3]];
+        data += 4;
+        len -= 4;
+    }
+    while (len--) {
+        fcs = (fcs >> 8) ^ fcs_table[0][(fcs ^ *data++) & 0xFF];
+    }
+    return fcs;
+}
+
+Encoder::Encoder()
+{
+    set_accm(0xFFFFFFFF);
+}
+
+void Encoder::set_accm(uint32_t accm)
+{
+    for (int c = 0; c < 256; c++) {
+        escaped[c] = (c < 0x20) ? (accm & (1U << c)) != 0 : (c == FLAG || c == ESCAPE);
+    }
+}
+
+uint8_t *Encoder::escape(const uint8_t *in, size_t len, uint8_t *out, const uint8_t *out_end) const
+{
+    const uint8_t *end = in + len;
+    while (in < end) {
+        // Runs of bytes that need no escaping are copied at once
+        const uint8_t *run = in;
+        while (in < end && !escaped[*in]) {
+            in++;
+        }
+        const size_t run_len = in - run;
+        if (run_len > static_cast<size_t>(out_end - out)) {
+            return nullptr;
+        }
+        memcpy(out, run, run_len);
+        out += run_len;
+        if (in == end) {
+            break;
+        }
+        if (out_end - out < 2) {
+            return nullptr;
+        }
+        *out++ = ESCAPE;
+        *out++ = *in++ ^ ESCAPE_XOR;
+    }
+    return out;
+}
+
+size_t Encoder::encode(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size) const
+{
+    if (out_size < 2) {
+        return 0;
+    }
+    const uint16_t fcs = ~fcs16(FCS_INIT, frame, len);
+    const uint8_t fcs_bytes[2] = {static_cast<uint8_t>(fcs & 0xFF), static_cast<uint8_t>(fcs >> 8)};
+    const uint8_t *out_end = out + out_size - 1; // Room for the closing flag
+
+    uint8_t *p = out;
+    *p++ = FLAG;
+    p = escape(frame, len, p, out_end);
+    if (p) {
+        p = escape(fcs_bytes, sizeof(fcs_bytes), p, out_end);
+    }
+    if (!p) {
+        return 0;
+    }
+    *p++ = FLAG;
+    return p - out;
+}
+
+Decoder::Decoder(size_t max_frame_size): buf(new uint8_t[max_frame_size]), buf_size(max_frame_size)
+{
+}
+
+void Decoder::reset()
+{
+    buf_len = 0;
+    sync = false;
+    escape = false;
+    partial = false;
+    overrun = false;
+}
+
+void Decoder::deliver(uint8_t *frame, size_t len, bool abort, const frame_cb &cb)
+{
+    if (len == 0 && !abort) {
+        return; // Flags between frames
+    }
+    if (len > buf_size) {
+        overruns++;
+        return;
+    }
+    if (abort || len < 4 || fcs16(FCS_INIT, frame, len) != FCS_GOOD) {
+        fcs_errors++;
+        return;
+    }
+    frames++;
+    cb(frame, len - 2);
+}
+
+void Decoder::process(uint8_t *data, size_t len, const frame_cb &cb)
+{
+    uint8_t *p = data;
+    uint8_t *end = data + len;
+    while (p < end) {
+        uint8_t *flag = const_cast<uint8_t *>(find_byte(p, end, FLAG));
+        if (!sync) {
+            if (flag == end) {
+                return;
+            }
+            sync = true;
+            p = flag + 1;
+            continue;
+        }
+
+        const bool complete = (flag != end);
+        const size_t raw_len = flag - p;
+        const size_t frame_len = unescape_in_place(p, raw_len, escape);
+        if (!partial && complete) {
+            // Whole frame is in this buffer, it is passed without copying
+            deliver(p, frame_len, escape, cb);
+        } else {
+            if (!overrun) {
+                if (buf_len + frame_len <= buf_size) {
+                    memcpy(buf.get() + buf_len, p, frame_len);
+                    buf_len += frame_len;
+                } else {
+                    overrun = true;
+                }
+            }
+            if (complete) {
+                if (overrun) {
+                    overruns++;
+                } else {
+                    deliver(buf.get(), buf_len, escape, cb);
+                }
+                buf_len = 0;
+                overrun = false;
+                partial = false;
+            } else if (raw_len > 0) {
+                partial = true;
+            }
+        }
+        if (complete) {
+            escape = false;
+            p = flag + 1;
+        } else {
+            p = end;
+        }
+    }
+}
+
+} // namespace ppp_hdlc
+} // namespace esp_modem
@@ -0,0 +1,127 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <array>
+#include <functional>
+#include <memory>
+
+namespace esp_modem {
+/**
+ * @brief HDLC-like framing of PPP, RFC 1662
+ *
+ * The framing runs directly on CDC transfer buffers: received frames are unescaped in place where possible
+ * and transmitted frames are escaped straight into the OUT transfer buffer.
+ */
+namespace ppp_hdlc {
+
+constexpr uint8_t FLAG = 0x7E;
+constexpr uint8_t ESCAPE = 0x7D;
+constexpr uint8_t ESCAPE_XOR = 0x20;
+constexpr uint16_t FCS_INIT = 0xFFFF;
+constexpr uint16_t FCS_GOOD = 0xF0B8; // FCS over a frame including its FCS field
+
+/**
+ * @brief Update FCS-16 with data, 4 bytes per step (slicing-by-4)
+ *
+ * @param[in] fcs  FCS of the previous data, FCS_INIT for start of frame
+ * @param[in] data Data
+ * @param[in] len  Length of the data in bytes
+ * @return Updated FCS
+ */
+uint16_t fcs16(uint16_t fcs, const uint8_t *data, size_t len);
+
+/**
+ * @brief Escaping transmitter
+ */
+class Encoder {
+public:
+    /**
+     * @brief Create encoder escaping all control characters, i.e. ACCM 0xFFFFFFFF
+     */
+    Encoder();
+
+    /**
+     * @brief Set transmit Async-Control-Character-Map negotiated by LCP
+     *
+     * @param[in] accm Bit n set: character n (0x00 - 0x1F) is escaped
+     */
+    void set_accm(uint32_t accm);
+
+    /**
+     * @brief Worst case length of encoded frame
+     */
+    static constexpr size_t max_encoded_len(size_t len)
+    {
+        return 2 + 2 * (len + 2); // Two flags, each byte of frame and FCS escaped
+    }
+
+    /**
+     * @brief Encode PPP frame: flag, escaped frame and FCS, flag
+     *
+     * @param[in]  frame    PPP frame without FCS
+     * @param[in]  len      Length of the frame in bytes
+     * @param[out] out      Destination, e.g. OUT transfer buffer
+     * @param[in]  out_size Size of the destination
+     * @return Length of the encoded frame, 0 if it does not fit into the destination
+     */
+    size_t encode(const uint8_t *frame, size_t len, uint8_t *out, size_t out_size) const;
+
+private:
+    uint8_t *escape(const uint8_t *in, size_t len, uint8_t *out, const uint8_t *out_end) const;
+    std::array<bool, 256> escaped; // Escape table built from ACCM
+};
+
+/**
+ * @brief Unescaping receiver
+ *
+ * Frames completely contained in one received buffer are unescaped in this buffer and passed without copying.
+ * Frames split over several buffers are collected in a frame buffer.
+ */
+class Decoder {
+public:
+    using frame_cb = std::function<void(uint8_t *frame, size_t len)>;
+
+    /**
+     * @brief Create decoder
+     *
+     * @param[in] max_frame_size Maximum length of a frame including its FCS, longer frames are dropped
+     */
+    explicit Decoder(size_t max_frame_size);
+
+    /**
+     * @brief Decode received data
+     *
+     * @param[inout] data  Received data, modified in place
+     * @param[in]    len   Length of the data in bytes
+     * @param[in]    cb    Called for each received frame with good FCS, the frame is passed without its FCS
+     */
+    void process(uint8_t *data, size_t len, const frame_cb &cb);
+
+    /**
+     * @brief Drop partially received frame and wait for the next flag, e.g. after reconnection
+     */
+    void reset();
+
+    uint32_t frames = 0;                // Received frames with good FCS
+    uint32_t fcs_errors = 0;            // Frames dropped because of bad FCS, abort sequence or length below 4 bytes
+    uint32_t overruns = 0;              // Frames dropped because they were longer than the frame buffer
+
+private:
+    void deliver(uint8_t *frame, size_t len, bool abort, const frame_cb &cb);
+    std::unique_ptr<uint8_t[]> buf;     // Frame buffer for frames split over several received buffers
+    size_t buf_size;
+    size_t buf_len = 0;
+    bool sync = false;                  // First flag was received, data before it are discarded
+    bool escape = false;                // Last byte of the previous buffer was ESCAPE
+    bool partial = false;               // The previous buffer ended inside of a frame
+    bool overrun = false;               // The frame in the frame buffer is dropped
+};
+
+} // namespace ppp_hdlc
+} // namespace esp_modem
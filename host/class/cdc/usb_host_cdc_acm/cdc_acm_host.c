@@ -8,43 +8,126 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/queue.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "freertos/event_groups.h"
+#include "freertos/message_buffer.h"
 #include "soc/soc_caps.h"
 #include "esp_log.h"
 #include "esp_check.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 
 #include "usb/usb_host.h"
+#include "usb/usb_host_xfer_pool_weak.h"
 #include "usb/cdc_acm_host.h"
 #include "cdc_host_descriptor_parsing.h"
 #include "cdc_host_common.h"
 #include "cdc_host_acm_compliant.h"
+#include "cdc_host_rx_framing.h"
 
 static const char *TAG = "cdc_acm";
 
+// Optional enumeration profiler, marks are made only if the usb_host_enum_profiler component is linked
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase) __attribute__((weak));
+#define CDC_ACM_ENUM_MARK(addr, phase)                           \
+    do {                                                         \
+        if (usb_host_enum_profiler_mark) {                       \
+            usb_host_enum_profiler_mark((addr), "cdc", (phase)); \
+        }                                                        \
+    } while(0)
+
+// Optional trace recorder, events of data transfers are recorded only if the usb_host_trace component is linked
+void usb_host_trace_submit(const char *driver, uint8_t interface, const usb_transfer_t *transfer) __attribute__((weak));
+void usb_host_trace_complete(const char *driver, uint8_t interface, const usb_transfer_t *transfer) __attribute__((weak));
+#define CDC_ACM_TRACE_SUBMIT(cdc_dev, transfer)                                                          \
+    do {                                                                                                 \
+        if (usb_host_trace_submit) {                                                                     \
+            usb_host_trace_submit("cdc", (cdc_dev)->data.intf_desc->bInterfaceNumber, (transfer));       \
+        }                                                                                                \
+    } while(0)
+#define CDC_ACM_TRACE_COMPLETE(cdc_dev, transfer)                                                        \
+    do {                                                                                                 \
+        if (usb_host_trace_complete) {                                                                   \
+            usb_host_trace_complete("cdc", (cdc_dev)->data.intf_desc->bInterfaceNumber, (transfer));     \
+        }                                                                                                \
+    } while(0)
+
 // Control transfer constants
 #define CDC_ACM_CTRL_TRANSFER_SIZE (64)   // All standard CTRL requests and responses fit in this size
 #define CDC_ACM_CTRL_TIMEOUT_MS    (5000) // Every CDC device should be able to respond to CTRL transfer in 5 seconds
+#define CDC_ACM_NOTIF_POLL_MAX_GAP_MS (250) // Default longest gap between the poll windows of an idle notification endpoint
+#define CDC_ACM_AUTO_OPEN_QUEUE_LEN (4)     // Newly connected devices waiting for the auto-open task
+#define CDC_ACM_CONNECTED_DEV_MAX (32)      // Longest USB device address list read by cdc_acm_host_get_connected_devices()
+
+// For targets that must sync internal memory through L1CACHE, the IN transfer must start on a cache line.
+// Appended RX data are therefore received to a cache aligned position and moved right behind the previous data.
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+#define CDC_ACM_IN_APPEND_ALIGN    (CONFIG_CACHE_L1_CACHE_LINE_SIZE)
+#else
+#define CDC_ACM_IN_APPEND_ALIGN    (1)
+#endif
 
 // CDC-ACM spinlock
 static portMUX_TYPE cdc_acm_lock = portMUX_INITIALIZER_UNLOCKED;
 #define CDC_ACM_ENTER_CRITICAL()   portENTER_CRITICAL(&cdc_acm_lock)
 #define CDC_ACM_EXIT_CRITICAL()    portEXIT_CRITICAL(&cdc_acm_lock)
 
+// Per-device spinlock, for the state of one device that is accessed from its transfer callbacks
+#define CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev) portENTER_CRITICAL(&(cdc_dev)->lock)
+#define CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev)  portEXIT_CRITICAL(&(cdc_dev)->lock)
+
 // CDC-ACM events
 #define CDC_ACM_TEARDOWN          BIT0
 #define CDC_ACM_TEARDOWN_COMPLETE BIT1
 
+// Completed IN transfer passed to RX dispatch task
+typedef struct {
+    usb_transfer_t *transfer;           // NULL requests the end of the task
+    int64_t rx_time_us;                 // Completion time of the transfer
+} cdc_acm_rx_event_t;
+
+// Interface registered for opening on device connection
+typedef struct cdc_acm_auto_open_s {
+    uint16_t vid;
+    uint16_t pid;
+    uint8_t interface_idx;
+    cdc_acm_host_device_config_t dev_config;
+    cdc_acm_auto_open_callback_t opened_cb;
+    SLIST_ENTRY(cdc_acm_auto_open_s) list_entry;
+} cdc_acm_auto_open_t;
+
+// Interface opened by the auto-open task, reported to its callback after open_close_mutex is given
+typedef struct {
+    cdc_dev_t *cdc_dev;
+    cdc_acm_auto_open_callback_t opened_cb;
+    void *user_arg;
+} cdc_acm_auto_opened_t;
+
+// CTRL transfer shared by interfaces of one USB device opened by cdc_acm_host_open_multi()
+typedef struct cdc_ctrl_shared_s {
+    unsigned refs;                      // Number of CDC devices using the CTRL transfer, protected by open_close_mutex
+} cdc_ctrl_shared_t;
+
 // CDC-ACM driver object
 typedef struct {
     usb_host_client_handle_t cdc_acm_client_hdl;        /*!< USB Host handle reused for all CDC-ACM devices in the system */
     SemaphoreHandle_t open_close_mutex;
     EventGroupHandle_t event_group;
     cdc_acm_new_dev_callback_t new_dev_cb;
+    bool background_task;                               /*!< Client events are handled by the driver task, otherwise by cdc_acm_host_handle_events() */
     SLIST_HEAD(list_dev, cdc_dev_s) cdc_devices_list;   /*!< List of open pseudo devices */
+    SLIST_HEAD(list_auto_open, cdc_acm_auto_open_s) auto_open_list; /*!< List of interfaces opened on device connection */
+    struct {
+        QueueHandle_t queue;                            /*!< Addresses of newly connected devices, 0 requests the end of the task */
+        TaskHandle_t task;                              /*!< Created on first registration, protected by open_close_mutex */
+        TaskHandle_t closing_task;                      /*!< Task waiting for the end of the auto-open task */
+        size_t stack_size;
+        unsigned priority;
+        int xCoreID;
+    } auto_open_task;
 } cdc_acm_obj_t;
 
 static cdc_acm_obj_t *p_cdc_acm_obj = NULL;
@@ -73,21 +156,71 @@ static void notif_xfer_cb(usb_transfer_t *transfer);
 /**
  * @brief Data received callback
  *
- * Data (bulk) IN transfer is submitted at the end of this function to ensure continuous poll of IN endpoint.
+ * Data (bulk) IN transfer is submitted at the end of processing to ensure continuous poll of IN endpoint.
+ * If the device has RX dispatch task, the transfer is processed and resubmitted from that task.
  *
  * @param[in] transfer Transfer that triggered the callback
  */
 static void in_xfer_cb(usb_transfer_t *transfer);
 
 /**
- * @brief Data send callback
+ * @brief RX dispatch task
+ *
+ * Calls user's data callback for completed IN transfers, so a slow consumer does not block the driver's task.
+ * The task ends when it receives NULL transfer from cdc_acm_host_close().
+ *
+ * @param[in] arg Pointer to CDC device
+ */
+static void cdc_acm_rx_task(void *arg);
+
+/**
+ * @brief Auto-open task
+ *
+ * Opens registered interfaces of newly connected devices, so the USB client event callback never waits for the opening.
+ * The task ends when it receives address 0 from cdc_acm_host_uninstall().
+ *
+ * @param[in] arg Pointer to CDC-ACM driver object
+ */
+static void cdc_acm_auto_open_task(void *arg);
+
+/**
+ * @brief Run adaptive polling steps of devices, whose polling timer expired
+ *
+ * Called by the driver task after handling of client events.
+ * A device is claimed while its step runs, cdc_acm_host_close() waits for the step to finish.
+ *
+ * @param[in] cdc_acm_obj Pointer to the driver
+ */
+static void cdc_acm_notif_poll_process(cdc_acm_obj_t *cdc_acm_obj);
+
+/**
+ * @brief CTRL transfer callback
  *
- * Reused for bulk OUT and CTRL transfers
+ * Gives the semaphore in the context of the transfer
  *
  * @param[in] transfer Transfer that triggered the callback
  */
 static void out_xfer_cb(usb_transfer_t *transfer);
 
+/**
+ * @brief Data send callback of blocking BULK OUT transfer
+ *
+ * The context of the transfer is the CDC device, so the completion can be traced per interface.
+ * Gives out_done semaphore of the device.
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void out_bulk_xfer_cb(usb_transfer_t *transfer);
+
+/**
+ * @brief Asynchronous data send callback
+ *
+ * Returns the transfer to the pool of free OUT transfers and calls user's TX done callback
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void out_async_xfer_cb(usb_transfer_t *transfer);
+
 /**
  * @brief USB Host Client event callback
  *
@@ -103,18 +236,22 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
  *
  * In in_xfer_cb() we can modify IN transfer parameters, this function resets the transfer to its defaults
  *
- * @param[in] cdc_dev Pointer to CDC device
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer IN transfer from the ring of IN transfers
  */
-static void cdc_acm_reset_in_transfer(cdc_dev_t *cdc_dev)
+static void cdc_acm_reset_in_transfer(cdc_dev_t *cdc_dev, usb_transfer_t *transfer)
 {
-    assert(cdc_dev->data.in_xfer);
-    usb_transfer_t *transfer = cdc_dev->data.in_xfer;
-    uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
-    *ptr = cdc_dev->data.in_data_buffer_base;
-    transfer->num_bytes = transfer->data_buffer_size;
-    // This is a hotfix for IDF changes, where 'transfer->data_buffer_size' does not contain actual buffer length,
-    // but *allocated* buffer length, which can be larger if CONFIG_HEAP_POISONING_COMPREHENSIVE is enabled
-    transfer->num_bytes -= transfer->data_buffer_size % cdc_dev->data.in_mps;
+    assert(transfer);
+    if (transfer == cdc_dev->data.in_xfer[0]) {
+        // Only the first transfer of the ring can be used for RX buffer append, so only its data_buffer can move
+        uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
+        *ptr = cdc_dev->data.in_data_buffer_base;
+        cdc_dev->data.in_data_len = 0;
+    }
+    // The transfer length is the configured buffer size, not 'transfer->data_buffer_size', which can be larger
+    // if CONFIG_HEAP_POISONING_COMPREHENSIVE is enabled
+    transfer->num_bytes = cdc_dev->data.in_buffer_size;
+    transfer->num_bytes -= cdc_dev->data.in_buffer_size % cdc_dev->data.in_mps;
 }
 
 /**
@@ -133,6 +270,7 @@ static void cdc_acm_client_task(void *arg)
     // Start handling client's events
     while (1) {
         usb_host_client_handle_events(cdc_acm_obj->cdc_acm_client_hdl, portMAX_DELAY);
+        cdc_acm_notif_poll_process(cdc_acm_obj);
         EventBits_t events = xEventGroupGetBits(cdc_acm_obj->event_group);
         if (events & CDC_ACM_TEARDOWN) {
             break;
@@ -165,6 +303,187 @@ static esp_err_t cdc_acm_reset_transfer_endpoint(usb_device_handle_t dev_hdl, us
     return ESP_OK;
 }
 
+/**
+ * @brief Submit notification transfer
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ * @return esp_err_t
+ */
+static esp_err_t cdc_acm_notif_submit(cdc_dev_t *cdc_dev)
+{
+    cdc_dev->notif.xfer_busy = true;
+    const esp_err_t ret = usb_host_transfer_submit(cdc_dev->notif.xfer);
+    if (ret != ESP_OK) {
+        cdc_dev->notif.xfer_busy = false;
+    }
+    return ret;
+}
+
+/**
+ * @brief Stop polling of the idle notification endpoint until the next window, the caller holds poll_mux
+ *
+ * The cancelled notification transfer returns through its callback.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_notif_poll_stop(cdc_dev_t *cdc_dev)
+{
+    cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->notif.xfer);
+    cdc_dev->notif.poll_state = CDC_NOTIF_POLL_STOPPED;
+    cdc_dev->notif.poll_stopped_us = esp_timer_get_time();
+    esp_timer_start_once(cdc_dev->notif.poll_timer, cdc_dev->notif.poll_gap_us);
+}
+
+/**
+ * @brief Adaptive polling step, stops the idle notification endpoint and opens the poll windows
+ *
+ * Runs in the driver task, after the adaptive polling timer expired.
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_notif_poll_step(cdc_dev_t *cdc_dev)
+{
+    xSemaphoreTake(cdc_dev->notif.poll_mux, portMAX_DELAY);
+    if (!cdc_dev->notif.poll_running) {
+        xSemaphoreGive(cdc_dev->notif.poll_mux);
+        return;
+    }
+    const int64_t now = esp_timer_get_time();
+    switch (cdc_dev->notif.poll_state) {
+    case CDC_NOTIF_POLL_CONTINUOUS: {
+        // The timer is not restarted by each notification, the time left is checked here
+        const uint64_t idle_us = (uint64_t)(now - cdc_dev->notif.poll_last_us);
+        if (idle_us < cdc_dev->notif.poll_timeout_us) {
+            esp_timer_start_once(cdc_dev->notif.poll_timer, cdc_dev->notif.poll_timeout_us - idle_us);
+            break;
+        }
+        cdc_dev->notif.poll_gap_us = MIN(cdc_dev->notif.poll_window_us, cdc_dev->notif.poll_max_gap_us);
+        cdc_dev->notif.poll_unpolled_us = 0;
+        cdc_acm_notif_poll_stop(cdc_dev);
+        CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+        cdc_dev->stats.cnt.notif_poll_stops++;
+        CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+        break;
+    }
+    case CDC_NOTIF_POLL_STOPPED:
+        // The window needs the transfer, which returned from the cancellation
+        if (!cdc_dev->notif.xfer_busy && cdc_acm_notif_submit(cdc_dev) == ESP_OK) {
+            cdc_dev->notif.poll_unpolled_us = (uint32_t)(now - cdc_dev->notif.poll_stopped_us);
+            cdc_dev->notif.poll_state = CDC_NOTIF_POLL_WINDOW;
+            CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+            cdc_dev->stats.cnt.notif_poll_windows++;
+            CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+            esp_timer_start_once(cdc_dev->notif.poll_timer, cdc_dev->notif.poll_window_us);
+        } else {
+            esp_timer_start_once(cdc_dev->notif.poll_timer, cdc_dev->notif.poll_gap_us);
+        }
+        break;
+    case CDC_NOTIF_POLL_WINDOW:
+        // No notification in the window, the next gap is longer
+        cdc_dev->notif.poll_gap_us = MIN(cdc_dev->notif.poll_gap_us * 2, cdc_dev->notif.poll_max_gap_us);
+        cdc_acm_notif_poll_stop(cdc_dev);
+        break;
+    }
+    xSemaphoreGive(cdc_dev->notif.poll_mux);
+}
+
+/**
+ * @brief Adaptive polling timer callback
+ *
+ * The esp_timer task must not wait for the driver task or run endpoint operations.
+ * The device is only marked and the driver task is woken up to run cdc_acm_notif_poll_step().
+ *
+ * @param[in] arg Pointer to CDC device
+ */
+static void cdc_acm_notif_poll_timer_cb(void *arg)
+{
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)arg;
+
+    // cdc_acm_transfers_free() takes the same lock, so it waits for this callback before the timer is deleted
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    __atomic_store_n(&cdc_dev->notif.poll_expired, true, __ATOMIC_RELEASE);
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+    usb_host_client_unblock(p_cdc_acm_obj->cdc_acm_client_hdl);
+}
+
+static void cdc_acm_notif_poll_process(cdc_acm_obj_t *cdc_acm_obj)
+{
+    while (1) {
+        cdc_dev_t *cdc_dev;
+        CDC_ACM_ENTER_CRITICAL();
+        SLIST_FOREACH(cdc_dev, &cdc_acm_obj->cdc_devices_list, list_entry) {
+            if (__atomic_exchange_n(&cdc_dev->notif.poll_expired, false, __ATOMIC_ACQ_REL)) {
+                cdc_dev->notif.poll_claimed = true;
+                break;
+            }
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        if (!cdc_dev) {
+            return;
+        }
+
+        cdc_acm_notif_poll_step(cdc_dev);
+        CDC_ACM_ENTER_CRITICAL();
+        cdc_dev->notif.poll_claimed = false;
+        CDC_ACM_EXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief Notification transfer returned, resume polling at bInterval if it brought a notification
+ *
+ * @param[in] cdc_dev   Pointer to CDC device
+ * @param[in] completed The transfer brought a notification, it is submitted again by the caller
+ */
+static void cdc_acm_notif_poll_returned(cdc_dev_t *cdc_dev, bool completed)
+{
+    xSemaphoreTake(cdc_dev->notif.poll_mux, portMAX_DELAY);
+    cdc_dev->notif.xfer_busy = false;
+    if (completed) {
+        cdc_dev->notif.poll_last_us = esp_timer_get_time();
+        if (cdc_dev->notif.poll_state != CDC_NOTIF_POLL_CONTINUOUS && cdc_dev->notif.poll_running) {
+            esp_timer_stop(cdc_dev->notif.poll_timer);
+            CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+            cdc_dev->stats.cnt.notif_poll_wakeups++;
+            cdc_dev->stats.cnt.notif_poll_gap_max_us = MAX(cdc_dev->stats.cnt.notif_poll_gap_max_us, cdc_dev->notif.poll_unpolled_us);
+            CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+            cdc_dev->notif.poll_state = CDC_NOTIF_POLL_CONTINUOUS;
+            esp_timer_start_once(cdc_dev->notif.poll_timer, cdc_dev->notif.poll_timeout_us);
+        }
+    }
+    xSemaphoreGive(cdc_dev->notif.poll_mux);
+}
+
+/**
+ * @brief Prepare adaptive polling of the notification endpoint
+ *
+ * @param[in] cdc_dev       Pointer to CDC device
+ * @param[in] notif_ep_desc Notification endpoint descriptor
+ * @param[in] dev_config    Device configuration
+ * @return esp_err_t
+ */
+static esp_err_t cdc_acm_notif_poll_init(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const cdc_acm_host_device_config_t *dev_config)
+{
+    usb_device_info_t dev_info;
+    ESP_RETURN_ON_ERROR(usb_host_device_info(cdc_dev->dev_hdl, &dev_info), TAG,);
+    // Interrupt endpoints of high-speed devices are polled every 2^(bInterval-1) microframes, others every bInterval ms
+    const uint8_t interval = MAX(notif_ep_desc->bInterval, 1);
+    const uint64_t interval_us = (dev_info.speed == USB_SPEED_HIGH) ? (125u << MIN(interval - 1, 15)) : (uint64_t)interval * 1000;
+    const uint32_t max_gap_ms = dev_config->notif_poll.max_gap_ms ? dev_config->notif_poll.max_gap_ms : CDC_ACM_NOTIF_POLL_MAX_GAP_MS;
+
+    cdc_dev->notif.poll_timeout_us = (uint64_t)dev_config->notif_poll.idle_timeout_ms * 1000;
+    cdc_dev->notif.poll_max_gap_us = (uint64_t)max_gap_ms * 1000;
+    cdc_dev->notif.poll_window_us = MAX(2 * interval_us, 1000);
+    cdc_dev->notif.poll_mux = xSemaphoreCreateMutex();
+    ESP_RETURN_ON_FALSE(cdc_dev->notif.poll_mux, ESP_ERR_NO_MEM, TAG,);
+    const esp_timer_create_args_t timer_args = {
+        .callback = cdc_acm_notif_poll_timer_cb,
+        .arg = cdc_dev,
+        .name = "cdc_notif_poll",
+    };
+    return esp_timer_create(&timer_args, &cdc_dev->notif.poll_timer);
+}
+
 /**
  * @brief Start CDC device
  *
@@ -173,19 +492,21 @@ static esp_err_t cdc_acm_reset_transfer_endpoint(usb_device_handle_t dev_hdl, us
  * @param cdc_dev
  * @param[in] event_cb  Device event callback
  * @param[in] in_cb     Data received callback
+ * @param[in] in_ts_cb  Data received callback with RX timestamp, called instead of in_cb if not NULL
  * @param[in] user_arg  Optional user's argument, that will be passed to the callbacks
  * @return esp_err_t
  */
-static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t event_cb, cdc_acm_data_callback_t in_cb, void *user_arg)
+static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t event_cb, cdc_acm_data_callback_t in_cb, cdc_acm_data_ts_callback_t in_ts_cb, void *user_arg)
 {
     esp_err_t ret = ESP_OK;
     assert(cdc_dev);
 
-    CDC_ACM_ENTER_CRITICAL();
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
     cdc_dev->notif.cb = event_cb;
     cdc_dev->data.in_cb = in_cb;
+    cdc_dev->data.in_ts_cb = in_ts_cb;
     cdc_dev->cb_arg = user_arg;
-    CDC_ACM_EXIT_CRITICAL();
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
 
     // Claim data interface and start polling its IN endpoint
     ESP_GOTO_ON_ERROR(
@@ -196,8 +517,11 @@ static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t e
             cdc_dev->data.intf_desc->bAlternateSetting),
         err, TAG, "Could not claim interface");
     if (cdc_dev->data.in_xfer) {
-        ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->data.in_xfer));
+        ESP_LOGD(TAG, "Submitting poll for %d BULK IN transfer(s)", cdc_dev->data.in_xfer_num);
+        for (int i = 0; i < cdc_dev->data.in_xfer_num; i++) {
+            CDC_ACM_TRACE_SUBMIT(cdc_dev, cdc_dev->data.in_xfer[i]);
+            ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->data.in_xfer[i]));
+        }
     }
 
     // If notification are supported, claim its interface and start polling its IN endpoint
@@ -212,7 +536,13 @@ static esp_err_t cdc_acm_start(cdc_dev_t *cdc_dev, cdc_acm_host_dev_callback_t e
                 err, TAG, "Could not claim interface");
         }
         ESP_LOGD(TAG, "Submitting poll for INTR IN transfer");
-        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc_dev->notif.xfer));
+        ESP_ERROR_CHECK(cdc_acm_notif_submit(cdc_dev));
+        if (cdc_dev->notif.poll_timer) {
+            cdc_dev->notif.poll_state = CDC_NOTIF_POLL_CONTINUOUS;
+            cdc_dev->notif.poll_last_us = esp_timer_get_time();
+            cdc_dev->notif.poll_running = true;
+            esp_timer_start_once(cdc_dev->notif.poll_timer, cdc_dev->notif.poll_timeout_us);
+        }
     }
 
     // Everything OK, add the device into list and return
@@ -241,6 +571,13 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev);
 static void cdc_acm_device_remove(cdc_dev_t *cdc_dev)
 {
     assert(cdc_dev);
+    if (cdc_dev->data.rx_task) {
+        // The device failed to open, RX dispatch task is blocked on the empty queue
+        vTaskDelete(cdc_dev->data.rx_task);
+    }
+    if (cdc_dev->data.rx_queue) {
+        vQueueDelete(cdc_dev->data.rx_queue);
+    }
     cdc_acm_transfers_free(cdc_dev);
     free(cdc_dev->cdc_func_desc);
     // We don't check the error code of usb_host_device_close, as the close might fail, if someone else is still using the device (not all interfaces are released)
@@ -248,21 +585,43 @@ static void cdc_acm_device_remove(cdc_dev_t *cdc_dev)
     free(cdc_dev);
 }
 
+/**
+ * @brief Check whether CDC interface of USB device is already opened by this driver
+ *
+ * @param[in] dev_addr      USB device address
+ * @param[in] interface_idx Index of CDC interface
+ * @return true if the interface is opened
+ */
+static bool cdc_acm_is_interface_opened(uint8_t dev_addr, uint8_t interface_idx)
+{
+    cdc_dev_t *cdc_dev;
+    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+        if (cdc_dev->dev_addr == dev_addr && cdc_dev->intf_idx == interface_idx) {
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * @brief Open USB device with requested VID/PID
  *
  * This function has two regular return paths:
- * 1. USB device with matching VID/PID is already opened by this driver: allocate new CDC device on top of the already opened USB device.
+ * 1. USB device with matching VID/PID is already opened by this driver and the requested interface is not opened yet:
+ *    allocate new CDC device on top of the already opened USB device.
  * 2. USB device with matching VID/PID is NOT opened by this driver yet: poll USB connected devices until it is found.
  *
+ * Thanks to the interface check in path 1, several USB devices with the same VID/PID can be opened one after another.
+ *
  * @note This function will block for timeout_ms, if the device is not enumerated at the moment of calling this function.
  * @param[in] vid Vendor ID
  * @param[in] pid Product ID
+ * @param[in] interface_idx Index of CDC interface that will be opened
  * @param[in] timeout_ms Connection timeout [ms]
  * @param[out] dev CDC-ACM device
  * @return esp_err_t
  */
-static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, int timeout_ms, cdc_dev_t **dev)
+static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, uint8_t interface_idx, int timeout_ms, cdc_dev_t **dev)
 {
     assert(p_cdc_acm_obj);
     assert(dev);
@@ -271,17 +630,24 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
     if (*dev == NULL) {
         return ESP_ERR_NO_MEM;
     }
+    portMUX_INITIALIZE(&(*dev)->lock);
 
     // First, check list of already opened CDC devices
     ESP_LOGD(TAG, "Checking list of opened USB devices");
     cdc_dev_t *cdc_dev;
     SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
-        const usb_device_desc_t *device_desc;
-        ESP_ERROR_CHECK(usb_host_get_device_descriptor(cdc_dev->dev_hdl, &device_desc));
-        if ((vid == device_desc->idVendor || vid == CDC_HOST_ANY_VID) &&
-                (pid == device_desc->idProduct || pid == CDC_HOST_ANY_PID)) {
+        // VID and PID were saved when the device was opened, no need to get the Device descriptor again
+        if ((vid == cdc_dev->vid || vid == CDC_HOST_ANY_VID) &&
+                (pid == cdc_dev->pid || pid == CDC_HOST_ANY_PID)) {
+            if (cdc_acm_is_interface_opened(cdc_dev->dev_addr, interface_idx)) {
+                ESP_LOGD(TAG, "Interface %d of device %d is already opened, skipping", interface_idx, cdc_dev->dev_addr);
+                continue;
+            }
             // Return path 1:
             (*dev)->dev_hdl = cdc_dev->dev_hdl;
+            (*dev)->dev_addr = cdc_dev->dev_addr;
+            (*dev)->vid = cdc_dev->vid;
+            (*dev)->pid = cdc_dev->pid;
             return ESP_OK;
         }
     }
@@ -299,6 +665,18 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
 
         // Go through device address list and find the one we are looking for
         for (int i = 0; i < num_of_devices; i++) {
+            // Devices already opened by this driver were checked above, skip them
+            bool already_opened = false;
+            SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+                if (cdc_dev->dev_addr == dev_addr_list[i]) {
+                    already_opened = true;
+                    break;
+                }
+            }
+            if (already_opened) {
+                continue;
+            }
+
             usb_device_handle_t current_device;
             // Open USB device
             if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
@@ -311,6 +689,10 @@ static esp_err_t cdc_acm_find_and_open_usb_device(uint16_t vid, uint16_t pid, in
                     (pid == device_desc->idProduct || pid == CDC_HOST_ANY_PID)) {
                 // Return path 2:
                 (*dev)->dev_hdl = current_device;
+                (*dev)->dev_addr = dev_addr_list[i];
+                (*dev)->vid = device_desc->idVendor;
+                (*dev)->pid = device_desc->idProduct;
+                CDC_ACM_ENUM_MARK(dev_addr_list[i], "found");
                 return ESP_OK;
             }
             usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, current_device);
@@ -339,11 +721,14 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
     EventGroupHandle_t event_group = xEventGroupCreate();
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
     TaskHandle_t driver_task_h = NULL;
-    xTaskCreatePinnedToCore(
-        cdc_acm_client_task, "USB-CDC", driver_config->driver_task_stack_size, NULL,
-        driver_config->driver_task_priority, &driver_task_h, driver_config->xCoreID);
+    const bool background_task = driver_config->driver_task_stack_size > 0;
+    if (background_task) {
+        xTaskCreatePinnedToCore(
+            cdc_acm_client_task, "USB-CDC", driver_config->driver_task_stack_size, NULL,
+            driver_config->driver_task_priority, &driver_task_h, driver_config->xCoreID);
+    }
 
-    if (cdc_acm_obj == NULL || driver_task_h == NULL || event_group == NULL || mutex == NULL) {
+    if (cdc_acm_obj == NULL || (background_task && driver_task_h == NULL) || event_group == NULL || mutex == NULL) {
         ret = ESP_ERR_NO_MEM;
         goto err;
     }
@@ -360,10 +745,17 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
 
     // Initialize CDC-ACM driver structure
     SLIST_INIT(&(cdc_acm_obj->cdc_devices_list));
+    SLIST_INIT(&(cdc_acm_obj->auto_open_list));
     cdc_acm_obj->event_group = event_group;
     cdc_acm_obj->open_close_mutex = mutex;
     cdc_acm_obj->cdc_acm_client_hdl = usb_client;
     cdc_acm_obj->new_dev_cb = driver_config->new_dev_cb;
+    cdc_acm_obj->background_task = background_task;
+    // Auto-open task takes parameters of the driver task, or the default ones if the application handles client events
+    const cdc_acm_host_driver_config_t *task_config = background_task ? driver_config : &cdc_acm_driver_config_default;
+    cdc_acm_obj->auto_open_task.stack_size = task_config->driver_task_stack_size;
+    cdc_acm_obj->auto_open_task.priority = task_config->driver_task_priority;
+    cdc_acm_obj->auto_open_task.xCoreID = task_config->xCoreID;
 
     // Between 1st call of this function and following section, another task might try to install this driver:
     // Make sure that there is only one instance of this driver in the system
@@ -379,7 +771,9 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
     CDC_ACM_EXIT_CRITICAL();
 
     // Everything OK: Start CDC-Driver task and return
-    xTaskNotifyGive(driver_task_h);
+    if (driver_task_h) {
+        xTaskNotifyGive(driver_task_h);
+    }
     return ESP_OK;
 
 client_err:
@@ -419,14 +813,37 @@ esp_err_t cdc_acm_host_uninstall()
     }
     CDC_ACM_EXIT_CRITICAL();
 
-    // Signal to CDC task to stop, unblock it and wait for its deletion
-    xEventGroupSetBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN);
-    usb_host_client_unblock(cdc_acm_obj->cdc_acm_client_hdl);
-    ESP_GOTO_ON_FALSE(
-        xEventGroupWaitBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
-        ESP_ERR_NOT_FINISHED, unblock, TAG,);
+    if (cdc_acm_obj->background_task) {
+        // Signal to CDC task to stop, unblock it and wait for its deletion
+        xEventGroupSetBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN);
+        usb_host_client_unblock(cdc_acm_obj->cdc_acm_client_hdl);
+        ESP_GOTO_ON_FALSE(
+            xEventGroupWaitBits(cdc_acm_obj->event_group, CDC_ACM_TEARDOWN_COMPLETE, pdFALSE, pdFALSE, pdMS_TO_TICKS(100)),
+            ESP_ERR_NOT_FINISHED, unblock, TAG,);
+    } else {
+        // The application no longer calls cdc_acm_host_handle_events()
+        ESP_LOGD(TAG, "Deregistering client");
+        ESP_GOTO_ON_ERROR(usb_host_client_deregister(cdc_acm_obj->cdc_acm_client_hdl), unblock, TAG,);
+    }
+
+    if (cdc_acm_obj->auto_open_task.task) {
+        // No new devices are queued from now on. The task skips queued ones, as p_cdc_acm_obj is NULL,
+        // but it needs open_close_mutex to find that out
+        xSemaphoreGive(cdc_acm_obj->open_close_mutex);
+        cdc_acm_obj->auto_open_task.closing_task = xTaskGetCurrentTaskHandle();
+        const uint8_t stop = 0;
+        xQueueSend(cdc_acm_obj->auto_open_task.queue, &stop, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        vQueueDelete(cdc_acm_obj->auto_open_task.queue);
+        xSemaphoreTake(cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    }
 
     // Free remaining resources and return
+    while (!SLIST_EMPTY(&cdc_acm_obj->auto_open_list)) {
+        cdc_acm_auto_open_t *auto_open = SLIST_FIRST(&cdc_acm_obj->auto_open_list);
+        SLIST_REMOVE_HEAD(&cdc_acm_obj->auto_open_list, list_entry);
+        free(auto_open);
+    }
     vEventGroupDelete(cdc_acm_obj->event_group);
     xSemaphoreGive(cdc_acm_obj->open_close_mutex);
     vSemaphoreDelete(cdc_acm_obj->open_close_mutex);
@@ -438,11 +855,22 @@ unblock:
     return ret;
 }
 
-esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_dev_cb)
+esp_err_t cdc_acm_host_handle_events(TickType_t timeout)
 {
     CDC_ACM_ENTER_CRITICAL();
-    p_cdc_acm_obj->new_dev_cb = new_dev_cb;
+    CDC_ACM_CHECK_FROM_CRIT(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK_FROM_CRIT(!p_cdc_acm_obj->background_task, ESP_ERR_INVALID_STATE);
+    cdc_acm_obj_t *cdc_acm_obj = p_cdc_acm_obj;
     CDC_ACM_EXIT_CRITICAL();
+
+    const esp_err_t ret = usb_host_client_handle_events(cdc_acm_obj->cdc_acm_client_hdl, timeout);
+    cdc_acm_notif_poll_process(cdc_acm_obj);
+    return ret;
+}
+
+esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_dev_cb)
+{
+    __atomic_store_n(&p_cdc_acm_obj->new_dev_cb, new_dev_cb, __ATOMIC_RELEASE);
     return ESP_OK;
 }
 
@@ -455,21 +883,83 @@ esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_
 static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
 {
     assert(cdc_dev);
+    if (cdc_dev->notif.poll_timer) {
+        esp_timer_stop(cdc_dev->notif.poll_timer);
+        // Wait for the timer callback, which might be in progress
+        CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+        CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+        esp_timer_delete(cdc_dev->notif.poll_timer);
+        cdc_dev->notif.poll_timer = NULL;
+    }
+    if (cdc_dev->notif.poll_mux) {
+        vSemaphoreDelete(cdc_dev->notif.poll_mux);
+        cdc_dev->notif.poll_mux = NULL;
+    }
     if (cdc_dev->notif.xfer != NULL) {
-        usb_host_transfer_free(cdc_dev->notif.xfer);
+        USB_HOST_XFER_POOL_FREE(cdc_dev->notif.xfer);
+        cdc_dev->notif.xfer = NULL;
     }
     if (cdc_dev->data.in_xfer != NULL) {
-        cdc_acm_reset_in_transfer(cdc_dev);
-        usb_host_transfer_free(cdc_dev->data.in_xfer);
+        for (int i = 0; i < cdc_dev->data.in_xfer_num; i++) {
+            if (cdc_dev->data.in_xfer[i] != NULL) {
+                cdc_acm_reset_in_transfer(cdc_dev, cdc_dev->data.in_xfer[i]);
+                USB_HOST_XFER_POOL_FREE(cdc_dev->data.in_xfer[i]);
+            }
+        }
+        free(cdc_dev->data.in_xfer);
+        cdc_dev->data.in_xfer = NULL;
+        cdc_dev->data.in_xfer_num = 0;
     }
     if (cdc_dev->data.out_xfer != NULL) {
-        if (cdc_dev->data.out_xfer->context != NULL) {
-            vSemaphoreDelete((SemaphoreHandle_t)cdc_dev->data.out_xfer->context);
+        if (cdc_dev->data.out_done != NULL) {
+            vSemaphoreDelete(cdc_dev->data.out_done);
         }
         if (cdc_dev->data.out_mux != NULL) {
             vSemaphoreDelete(cdc_dev->data.out_mux);
         }
-        usb_host_transfer_free(cdc_dev->data.out_xfer);
+        USB_HOST_XFER_POOL_FREE(cdc_dev->data.out_xfer);
+        cdc_dev->data.out_xfer = NULL;
+        cdc_dev->data.out_done = NULL;
+        cdc_dev->data.out_mux = NULL;
+    }
+    if (cdc_dev->data.out_async_xfer != NULL) {
+        for (int i = 0; i < cdc_dev->data.out_async_xfer_num; i++) {
+            if (cdc_dev->data.out_async_xfer[i] != NULL) {
+                USB_HOST_XFER_POOL_FREE(cdc_dev->data.out_async_xfer[i]);
+            }
+        }
+        free(cdc_dev->data.out_async_xfer);
+        free(cdc_dev->data.out_async_ctx);
+        cdc_dev->data.out_async_xfer = NULL;
+        cdc_dev->data.out_async_ctx = NULL;
+        cdc_dev->data.out_async_xfer_num = 0;
+    }
+    if (cdc_dev->data.out_async_free != NULL) {
+        vQueueDelete(cdc_dev->data.out_async_free);
+        cdc_dev->data.out_async_free = NULL;
+    }
+    if (cdc_dev->data.out_async_mux != NULL) {
+        vSemaphoreDelete(cdc_dev->data.out_async_mux);
+        cdc_dev->data.out_async_mux = NULL;
+    }
+    if (cdc_dev->data.rx_ring != NULL) {
+        vStreamBufferDelete(cdc_dev->data.rx_ring);
+        cdc_dev->data.rx_ring = NULL;
+    }
+    if (cdc_dev->data.rx_framing != NULL) {
+        cdc_rx_framing_deinit(cdc_dev->data.rx_framing);
+        free(cdc_dev->data.rx_framing);
+        cdc_dev->data.rx_framing = NULL;
+    }
+    if (cdc_dev->ctrl_shared != NULL) {
+        // Shared CTRL transfer is freed with its last user
+        if (--cdc_dev->ctrl_shared->refs > 0) {
+            cdc_dev->ctrl_transfer = NULL;
+            cdc_dev->ctrl_mux = NULL;
+        } else {
+            free(cdc_dev->ctrl_shared);
+        }
+        cdc_dev->ctrl_shared = NULL;
     }
     if (cdc_dev->ctrl_transfer != NULL) {
         if (cdc_dev->ctrl_transfer->context != NULL) {
@@ -478,7 +968,9 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
         if (cdc_dev->ctrl_mux != NULL) {
             vSemaphoreDelete(cdc_dev->ctrl_mux);
         }
-        usb_host_transfer_free(cdc_dev->ctrl_transfer);
+        USB_HOST_XFER_POOL_FREE(cdc_dev->ctrl_transfer);
+        cdc_dev->ctrl_transfer = NULL;
+        cdc_dev->ctrl_mux = NULL;
     }
 }
 
@@ -489,23 +981,28 @@ static void cdc_acm_transfers_free(cdc_dev_t *cdc_dev)
  * @param[in] notif_ep_desc Pointer to notification EP descriptor
  * @param[in] in_ep_desc-   Pointer to data IN EP descriptor
  * @param[in] in_buf_len    Length of data IN buffer
+ * @param[in] in_xfer_num   Number of data IN transfers kept in flight
  * @param[in] out_ep_desc   Pointer to data OUT EP descriptor
  * @param[in] out_buf_len   Length of data OUT buffer
+ * @param[in] out_xfer_num  Number of data OUT transfers in the asynchronous TX pool
+ * @param[in] rx_ring_size  Size of RX ring buffer, 0 if not used
+ * @param[in] rx_ring_framed RX ring stores complete frames, i.e. it is a message buffer
  * @return
  *     - ESP_OK:            Success
  *     - ESP_ERR_NO_MEM:    Not enough memory for transfers and semaphores allocation
  *     - ESP_ERR_NOT_FOUND: IN or OUT endpoints were not found in the selected interface
  */
-static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const usb_ep_desc_t *in_ep_desc, size_t in_buf_len, const usb_ep_desc_t *out_ep_desc, size_t out_buf_len)
+static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_desc_t *notif_ep_desc, const usb_ep_desc_t *in_ep_desc, size_t in_buf_len, uint8_t in_xfer_num, const usb_ep_desc_t *out_ep_desc, size_t out_buf_len, uint8_t out_xfer_num, size_t rx_ring_size, bool rx_ring_framed)
 {
     assert(in_ep_desc);
+    assert(in_xfer_num > 0);
     assert(out_ep_desc);
     esp_err_t ret;
 
     // 1. Setup notification transfer if it is supported
     if (notif_ep_desc) {
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(USB_EP_DESC_GET_MPS(notif_ep_desc), 0, &cdc_dev->notif.xfer),
+            USB_HOST_XFER_POOL_ALLOC(USB_EP_DESC_GET_MPS(notif_ep_desc), 0, &cdc_dev->notif.xfer),
             err, TAG,);
         cdc_dev->notif.xfer->device_handle = cdc_dev->dev_hdl;
         cdc_dev->notif.xfer->bEndpointAddress = notif_ep_desc->bEndpointAddress;
@@ -514,49 +1011,94 @@ static esp_err_t cdc_acm_transfers_allocate(cdc_dev_t *cdc_dev, const usb_ep_des
         cdc_dev->notif.xfer->num_bytes = USB_EP_DESC_GET_MPS(notif_ep_desc);
     }
 
-    // 2. Setup control transfer
-    ESP_GOTO_ON_ERROR(
-        usb_host_transfer_alloc(CDC_ACM_CTRL_TRANSFER_SIZE, 0, &cdc_dev->ctrl_transfer),
-        err, TAG,);
-    cdc_dev->ctrl_transfer->timeout_ms = 1000;
-    cdc_dev->ctrl_transfer->bEndpointAddress = 0;
-    cdc_dev->ctrl_transfer->device_handle = cdc_dev->dev_hdl;
-    cdc_dev->ctrl_transfer->callback = out_xfer_cb;
-    cdc_dev->ctrl_transfer->context = xSemaphoreCreateBinary();
-    ESP_GOTO_ON_FALSE(cdc_dev->ctrl_transfer->context, ESP_ERR_NO_MEM, err, TAG,);
-    cdc_dev->ctrl_mux = xSemaphoreCreateMutex();
-    ESP_GOTO_ON_FALSE(cdc_dev->ctrl_mux, ESP_ERR_NO_MEM, err, TAG,);
-
-    // 3. Setup IN data transfer (if it is required (in_buf_len > 0))
-    if (in_buf_len != 0) {
+    // 2. Setup control transfer, unless it is shared with another interface of the USB device
+    if (cdc_dev->ctrl_transfer == NULL) {
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(in_buf_len, 0, &cdc_dev->data.in_xfer),
-            err, TAG,
-        );
-        assert(cdc_dev->data.in_xfer);
-        cdc_dev->data.in_xfer->callback = in_xfer_cb;
-        cdc_dev->data.in_xfer->num_bytes = in_buf_len;
-        cdc_dev->data.in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
-        cdc_dev->data.in_xfer->device_handle = cdc_dev->dev_hdl;
-        cdc_dev->data.in_xfer->context = cdc_dev;
+            USB_HOST_XFER_POOL_ALLOC(CDC_ACM_CTRL_TRANSFER_SIZE, 0, &cdc_dev->ctrl_transfer),
+            err, TAG,);
+        cdc_dev->ctrl_transfer->timeout_ms = 1000;
+        cdc_dev->ctrl_transfer->bEndpointAddress = 0;
+        cdc_dev->ctrl_transfer->device_handle = cdc_dev->dev_hdl;
+        cdc_dev->ctrl_transfer->callback = out_xfer_cb;
+        cdc_dev->ctrl_transfer->context = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(cdc_dev->ctrl_transfer->context, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->ctrl_mux = xSemaphoreCreateMutex();
+        ESP_GOTO_ON_FALSE(cdc_dev->ctrl_mux, ESP_ERR_NO_MEM, err, TAG,);
+    }
+
+    // 3. Setup ring of IN data transfers (if it is required (in_buf_len > 0))
+    if (in_buf_len != 0) {
+        cdc_dev->data.in_xfer = calloc(in_xfer_num, sizeof(usb_transfer_t *));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.in_xfer, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.in_xfer_num = in_xfer_num;
+        cdc_dev->data.in_buffer_size = in_buf_len;
         cdc_dev->data.in_mps = USB_EP_DESC_GET_MPS(in_ep_desc);
-        cdc_dev->data.in_data_buffer_base = cdc_dev->data.in_xfer->data_buffer;
+        for (int i = 0; i < in_xfer_num; i++) {
+            ESP_GOTO_ON_ERROR(
+                USB_HOST_XFER_POOL_ALLOC(in_buf_len, 0, &cdc_dev->data.in_xfer[i]),
+                err, TAG,
+            );
+            usb_transfer_t *in_xfer = cdc_dev->data.in_xfer[i];
+            assert(in_xfer);
+            in_xfer->callback = in_xfer_cb;
+            in_xfer->num_bytes = in_buf_len;
+            in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
+            in_xfer->device_handle = cdc_dev->dev_hdl;
+            in_xfer->context = cdc_dev;
+            if (i == 0) {
+                cdc_dev->data.in_data_buffer_base = in_xfer->data_buffer;
+            }
+        }
     }
 
     // 4. Setup OUT bulk transfer (if it is required (out_buf_len > 0))
     if (out_buf_len != 0) {
+        cdc_dev->data.out_buffer_size = out_buf_len;
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(out_buf_len, 0, &cdc_dev->data.out_xfer),
+            USB_HOST_XFER_POOL_ALLOC(out_buf_len, 0, &cdc_dev->data.out_xfer),
             err, TAG,
         );
         assert(cdc_dev->data.out_xfer);
         cdc_dev->data.out_xfer->device_handle = cdc_dev->dev_hdl;
-        cdc_dev->data.out_xfer->context = xSemaphoreCreateBinary();
-        ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->context, ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.out_xfer->context = cdc_dev;
+        cdc_dev->data.out_done = xSemaphoreCreateBinary();
+        ESP_GOTO_ON_FALSE(cdc_dev->data.out_done, ESP_ERR_NO_MEM, err, TAG,);
         cdc_dev->data.out_mux = xSemaphoreCreateMutex();
         ESP_GOTO_ON_FALSE(cdc_dev->data.out_mux, ESP_ERR_NO_MEM, err, TAG,);
         cdc_dev->data.out_xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
-        cdc_dev->data.out_xfer->callback = out_xfer_cb;
+        cdc_dev->data.out_xfer->callback = out_bulk_xfer_cb;
+    }
+
+    // 5. Setup pool of OUT bulk transfers for asynchronous TX (if it is required (out_xfer_num > 0))
+    if (out_buf_len != 0 && out_xfer_num != 0) {
+        cdc_dev->data.out_async_xfer = calloc(out_xfer_num, sizeof(usb_transfer_t *));
+        cdc_dev->data.out_async_ctx = calloc(out_xfer_num, sizeof(cdc_acm_tx_ctx_t));
+        cdc_dev->data.out_async_free = xQueueCreate(out_xfer_num, sizeof(usb_transfer_t *));
+        cdc_dev->data.out_async_mux = xSemaphoreCreateMutex();
+        ESP_GOTO_ON_FALSE(cdc_dev->data.out_async_xfer && cdc_dev->data.out_async_ctx && cdc_dev->data.out_async_free && cdc_dev->data.out_async_mux,
+                          ESP_ERR_NO_MEM, err, TAG,);
+        cdc_dev->data.out_async_xfer_num = out_xfer_num;
+        for (int i = 0; i < out_xfer_num; i++) {
+            ESP_GOTO_ON_ERROR(
+                USB_HOST_XFER_POOL_ALLOC(out_buf_len, 0, &cdc_dev->data.out_async_xfer[i]),
+                err, TAG,
+            );
+            usb_transfer_t *out_xfer = cdc_dev->data.out_async_xfer[i];
+            assert(out_xfer);
+            cdc_dev->data.out_async_ctx[i].cdc_dev = cdc_dev;
+            cdc_dev->data.out_async_ctx[i].xfer = out_xfer;
+            out_xfer->device_handle = cdc_dev->dev_hdl;
+            out_xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
+            out_xfer->callback = out_async_xfer_cb;
+            out_xfer->context = &cdc_dev->data.out_async_ctx[i];
+            xQueueSend(cdc_dev->data.out_async_free, &out_xfer, 0);
+        }
+    }
+
+    // 6. Setup RX ring buffer (if it is required (in_buf_len > 0 and rx_ring_size > 0))
+    if (in_buf_len != 0 && rx_ring_size != 0) {
+        cdc_dev->data.rx_ring = rx_ring_framed ? xMessageBufferCreate(rx_ring_size) : xStreamBufferCreate(rx_ring_size, 1);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_ring, ESP_ERR_NO_MEM, err, TAG,);
     }
     return ESP_OK;
 
@@ -565,20 +1107,19 @@ err:
     return ret;
 }
 
-esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
+/**
+ * @brief Open CDC interface on already opened USB device
+ *
+ * @note Must be called with open_close_mutex taken. The CDC device is freed on failure.
+ * @param[in]  cdc_dev       CDC device with opened USB device handle
+ * @param[in]  interface_idx Index of CDC interface that should be used
+ * @param[in]  dev_config    Configuration structure of the device
+ * @param[out] cdc_hdl_ret   CDC device handle
+ * @return esp_err_t
+ */
+static esp_err_t cdc_acm_open(cdc_dev_t *cdc_dev, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     esp_err_t ret;
-    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
-    CDC_ACM_CHECK(dev_config, ESP_ERR_INVALID_ARG);
-    CDC_ACM_CHECK(cdc_hdl_ret, ESP_ERR_INVALID_ARG);
-
-    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
-    // Find underlying USB device
-    cdc_dev_t *cdc_dev;
-    ret =  cdc_acm_find_and_open_usb_device(vid, pid, dev_config->connection_timeout_ms, &cdc_dev);
-    if (ESP_OK != ret) {
-        goto exit;
-    }
 
     // Get Device and Configuration descriptors
     const usb_config_desc_t *config_desc;
@@ -599,8 +1140,11 @@ esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, c
     if (cdc_info.notif_intf) {
         cdc_dev->comm_protocol = (cdc_comm_protocol_t)cdc_dev->notif.intf_desc->bInterfaceProtocol;
     }
+    cdc_dev->intf_idx = interface_idx;
     cdc_dev->cdc_func_desc = cdc_info.func;
     cdc_dev->cdc_func_desc_cnt = cdc_info.func_cnt;
+    cdc_dev->notif.serial_state_dedup = dev_config->serial_state_filter.suppress_unchanged;
+    cdc_dev->notif.serial_state_interval_ms = dev_config->serial_state_filter.min_interval_ms;
 
     // For CDC compliant devices, this driver provides default implementation of CDC-ACM specific functions.
     if (cdc_dev->cdc_func_desc_cnt > 1) {
@@ -612,80 +1156,475 @@ esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, c
 
     // The following line is here for backward compatibility with v1.0.*
     // where fixed size of IN buffer (equal to IN Maximum Packet Size) was used
-    const size_t in_buf_size = (dev_config->data_cb && (dev_config->in_buffer_size == 0)) ? USB_EP_DESC_GET_MPS(cdc_info.in_ep) : dev_config->in_buffer_size;
+    const bool rx_required = dev_config->data_cb || dev_config->data_ts_cb || dev_config->rx_ring_size;
+    const size_t in_buf_size = (rx_required && (dev_config->in_buffer_size == 0)) ? USB_EP_DESC_GET_MPS(cdc_info.in_ep) : dev_config->in_buffer_size;
+    const uint8_t in_xfer_num = (dev_config->in_xfer_count == 0) ? 1 : dev_config->in_xfer_count;
 
     // Allocate USB transfers, claim CDC interfaces and return CDC-ACM handle
     ESP_GOTO_ON_ERROR(
-        cdc_acm_transfers_allocate(cdc_dev, cdc_info.notif_ep, cdc_info.in_ep, in_buf_size, cdc_info.out_ep, dev_config->out_buffer_size),
+        cdc_acm_transfers_allocate(cdc_dev, cdc_info.notif_ep, cdc_info.in_ep, in_buf_size, in_xfer_num, cdc_info.out_ep, dev_config->out_buffer_size, dev_config->out_xfer_count, dev_config->rx_ring_size,
+                                   dev_config->rx_framing.mode != CDC_ACM_RX_FRAMING_NONE),
         err, TAG,);
-    ESP_GOTO_ON_ERROR(cdc_acm_start(cdc_dev, dev_config->event_cb, dev_config->data_cb, dev_config->user_arg), err, TAG,);
+    if (dev_config->notif_poll.idle_timeout_ms && cdc_dev->notif.xfer) {
+        ESP_GOTO_ON_ERROR(cdc_acm_notif_poll_init(cdc_dev, cdc_info.notif_ep, dev_config), err, TAG,);
+    }
+    if (dev_config->rx_framing.mode != CDC_ACM_RX_FRAMING_NONE && cdc_dev->data.in_xfer) {
+        cdc_dev->data.rx_framing = calloc(1, sizeof(cdc_rx_framing_t));
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_framing, ESP_ERR_NO_MEM, err, TAG,);
+        const size_t max_frame_size = dev_config->rx_framing.max_frame_size ? dev_config->rx_framing.max_frame_size : in_buf_size;
+        ESP_GOTO_ON_ERROR(
+            cdc_rx_framing_init(cdc_dev->data.rx_framing, dev_config->rx_framing.mode, dev_config->rx_framing.delimiter, max_frame_size),
+            err, TAG,);
+    }
+    if (dev_config->rx_task.stack_size > 0 && cdc_dev->data.in_xfer) {
+        cdc_dev->data.rx_queue = xQueueCreate(cdc_dev->data.in_xfer_num + 1, sizeof(cdc_acm_rx_event_t)); // +1 for the stop request
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_queue, ESP_ERR_NO_MEM, err, TAG,);
+        xTaskCreatePinnedToCore(
+            cdc_acm_rx_task, "USB-CDC-RX", dev_config->rx_task.stack_size, cdc_dev,
+            dev_config->rx_task.priority, &cdc_dev->data.rx_task, dev_config->rx_task.xCoreID);
+        ESP_GOTO_ON_FALSE(cdc_dev->data.rx_task, ESP_ERR_NO_MEM, err, TAG,);
+    }
+    ESP_GOTO_ON_ERROR(cdc_acm_start(cdc_dev, dev_config->event_cb, dev_config->data_cb, dev_config->data_ts_cb, dev_config->user_arg), err, TAG,);
     *cdc_hdl_ret = (cdc_acm_dev_hdl_t)cdc_dev;
-    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
     return ESP_OK;
 
 err:
     cdc_acm_device_remove(cdc_dev);
-exit:
-    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
     *cdc_hdl_ret = NULL;
     return ret;
 }
 
-esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
+esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
+    esp_err_t ret;
     CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
-    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(dev_config, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_hdl_ret, ESP_ERR_INVALID_ARG);
 
     xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
-
-    // Make sure that the device is in the devices list (that it is not already closed)
+    // Find underlying USB device
     cdc_dev_t *cdc_dev;
-    bool device_found = false;
-    CDC_ACM_ENTER_CRITICAL();
-    SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
-        if (cdc_dev == (cdc_dev_t *)cdc_hdl) {
-            device_found = true;
-            break;
+    ret =  cdc_acm_find_and_open_usb_device(vid, pid, interface_idx, dev_config->connection_timeout_ms, &cdc_dev);
+    if (ESP_OK == ret) {
+        const uint8_t dev_addr = cdc_dev->dev_addr;
+        ret = cdc_acm_open(cdc_dev, interface_idx, dev_config, cdc_hdl_ret);
+        if (ESP_OK == ret) {
+            CDC_ACM_ENUM_MARK(dev_addr, "opened");
         }
+    } else {
+        *cdc_hdl_ret = NULL;
     }
+    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    return ret;
+}
 
-    // Device was not found in the cdc_devices_list; it was already closed, return OK
-    if (!device_found) {
-        CDC_ACM_EXIT_CRITICAL();
-        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
-        return ESP_OK;
-    }
+esp_err_t cdc_acm_host_open_multi(uint16_t vid, uint16_t pid, const uint8_t *interface_idx, size_t intf_cnt, const cdc_acm_host_device_config_t *dev_configs, cdc_acm_dev_hdl_t *cdc_hdls_ret)
+{
+    esp_err_t ret;
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(interface_idx && dev_configs && cdc_hdls_ret && intf_cnt > 0, ESP_ERR_INVALID_ARG);
+    memset(cdc_hdls_ret, 0, intf_cnt * sizeof(cdc_acm_dev_hdl_t));
 
-    // No user callbacks from this point
-    cdc_dev->notif.cb = NULL;
-    cdc_dev->data.in_cb = NULL;
-    CDC_ACM_EXIT_CRITICAL();
+    cdc_ctrl_shared_t *ctrl_shared = calloc(1, sizeof(cdc_ctrl_shared_t));
+    CDC_ACM_CHECK(ctrl_shared, ESP_ERR_NO_MEM);
 
-    // Cancel polling of BULK IN and INTERRUPT IN
-    if (cdc_dev->data.in_xfer) {
-        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.in_xfer));
+    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    // Find underlying USB device once and open the first interface with its own CTRL transfer
+    cdc_dev_t *first;
+    ret = cdc_acm_find_and_open_usb_device(vid, pid, interface_idx[0], dev_configs[0].connection_timeout_ms, &first);
+    if (ret == ESP_OK) {
+        ret = cdc_acm_open(first, interface_idx[0], &dev_configs[0], &cdc_hdls_ret[0]);
     }
-    if (cdc_dev->notif.xfer != NULL) {
-        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->notif.xfer));
+    if (ret != ESP_OK) {
+        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+        free(ctrl_shared);
+        return ret;
     }
-
-    // Release all interfaces
-    ESP_ERROR_CHECK(usb_host_interface_release(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl, cdc_dev->data.intf_desc->bInterfaceNumber));
-    if ((cdc_dev->notif.intf_desc != NULL) && (cdc_dev->notif.intf_desc != cdc_dev->data.intf_desc)) {
-        ESP_ERROR_CHECK(usb_host_interface_release(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl, cdc_dev->notif.intf_desc->bInterfaceNumber));
+    ctrl_shared->refs = 1;
+    first->ctrl_shared = ctrl_shared;
+
+    // Other interfaces reuse the USB device handle, descriptors and CTRL transfer of the first one
+    for (size_t i = 1; i < intf_cnt; i++) {
+        cdc_dev_t *cdc_dev = calloc(1, sizeof(cdc_dev_t));
+        ESP_GOTO_ON_FALSE(cdc_dev, ESP_ERR_NO_MEM, err, TAG, "Could not allocate CDC device");
+        portMUX_INITIALIZE(&cdc_dev->lock);
+        cdc_dev->dev_hdl = first->dev_hdl;
+        cdc_dev->dev_addr = first->dev_addr;
+        cdc_dev->vid = first->vid;
+        cdc_dev->pid = first->pid;
+        cdc_dev->ctrl_transfer = first->ctrl_transfer;
+        cdc_dev->ctrl_mux = first->ctrl_mux;
+        cdc_dev->ctrl_shared = ctrl_shared;
+        ctrl_shared->refs++;
+        ESP_GOTO_ON_ERROR(
+            cdc_acm_open(cdc_dev, interface_idx[i], &dev_configs[i], &cdc_hdls_ret[i]),
+            err, TAG, "Could not open interface %d", interface_idx[i]);
     }
-
-    CDC_ACM_ENTER_CRITICAL();
-    SLIST_REMOVE(&p_cdc_acm_obj->cdc_devices_list, cdc_dev, cdc_dev_s, list_entry);
-    CDC_ACM_EXIT_CRITICAL();
-
-    cdc_acm_device_remove(cdc_dev);
     xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
     return ESP_OK;
-}
 
-void cdc_acm_host_desc_print(cdc_acm_dev_hdl_t cdc_hdl)
-{
+err:
+    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    // All or nothing: close the interfaces opened so far
+    for (size_t i = 0; i < intf_cnt; i++) {
+        if (cdc_hdls_ret[i]) {
+            cdc_acm_host_close(cdc_hdls_ret[i]);
+            cdc_hdls_ret[i] = NULL;
+        }
+    }
+    return ret;
+}
+
+esp_err_t cdc_acm_host_get_connected_devices(cdc_acm_host_connected_dev_t *devs, size_t devs_len, size_t *devs_num)
+{
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(devs && devs_num, ESP_ERR_INVALID_ARG);
+
+    uint8_t dev_addr_list[CDC_ACM_CONNECTED_DEV_MAX];
+    int num_of_devices;
+    size_t num = 0;
+    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    ESP_ERROR_CHECK(usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_of_devices));
+    for (int i = 0; i < num_of_devices && num < devs_len; i++) {
+        // VID and PID of opened devices were saved when they were opened
+        bool known = false;
+        cdc_dev_t *cdc_dev;
+        SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+            if (cdc_dev->dev_addr == dev_addr_list[i]) {
+                devs[num].vid = cdc_dev->vid;
+                devs[num].pid = cdc_dev->pid;
+                known = true;
+                break;
+            }
+        }
+        if (!known) {
+            usb_device_handle_t current_device;
+            if (usb_host_device_open(p_cdc_acm_obj->cdc_acm_client_hdl, dev_addr_list[i], &current_device) != ESP_OK) {
+                continue; // Device was disconnected in the meantime
+            }
+            const usb_device_desc_t *device_desc;
+            ESP_ERROR_CHECK(usb_host_get_device_descriptor(current_device, &device_desc));
+            devs[num].vid = device_desc->idVendor;
+            devs[num].pid = device_desc->idProduct;
+            usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, current_device);
+        }
+        devs[num].dev_addr = dev_addr_list[i];
+        num++;
+    }
+    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    *devs_num = num;
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_auto_open_register(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_auto_open_callback_t opened_cb)
+{
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(dev_config, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(opened_cb, ESP_ERR_INVALID_ARG);
+
+    cdc_acm_auto_open_t *auto_open = calloc(1, sizeof(cdc_acm_auto_open_t));
+    CDC_ACM_CHECK(auto_open, ESP_ERR_NO_MEM);
+    auto_open->vid = vid;
+    auto_open->pid = pid;
+    auto_open->interface_idx = interface_idx;
+    auto_open->dev_config = *dev_config;
+    auto_open->opened_cb = opened_cb;
+
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    if (p_cdc_acm_obj->auto_open_task.task == NULL) {
+        // Devices are opened in a dedicated task, so the client events of other devices are not delayed by the opening
+        QueueHandle_t queue = xQueueCreate(CDC_ACM_AUTO_OPEN_QUEUE_LEN, sizeof(uint8_t));
+        TaskHandle_t task = NULL;
+        if (queue) {
+            p_cdc_acm_obj->auto_open_task.queue = queue;
+            xTaskCreatePinnedToCore(
+                cdc_acm_auto_open_task, "USB-CDC-AUTO", p_cdc_acm_obj->auto_open_task.stack_size, p_cdc_acm_obj,
+                p_cdc_acm_obj->auto_open_task.priority, &task, p_cdc_acm_obj->auto_open_task.xCoreID);
+        }
+        if (task == NULL) {
+            if (queue) {
+                vQueueDelete(queue);
+            }
+            p_cdc_acm_obj->auto_open_task.queue = NULL;
+            xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+            free(auto_open);
+            return ESP_ERR_NO_MEM;
+        }
+        p_cdc_acm_obj->auto_open_task.task = task;
+    }
+    cdc_acm_auto_open_t *registered;
+    CDC_ACM_ENTER_CRITICAL();
+    SLIST_FOREACH(registered, &p_cdc_acm_obj->auto_open_list, list_entry) {
+        if (registered->vid == vid && registered->pid == pid && registered->interface_idx == interface_idx) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+    }
+    if (ret == ESP_OK) {
+        SLIST_INSERT_HEAD(&p_cdc_acm_obj->auto_open_list, auto_open, list_entry);
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+
+    if (ret != ESP_OK) {
+        free(auto_open);
+    }
+    return ret;
+}
+
+esp_err_t cdc_acm_host_auto_open_unregister(uint16_t vid, uint16_t pid, uint8_t interface_idx)
+{
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+
+    cdc_acm_auto_open_t *auto_open;
+    xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    CDC_ACM_ENTER_CRITICAL();
+    SLIST_FOREACH(auto_open, &p_cdc_acm_obj->auto_open_list, list_entry) {
+        if (auto_open->vid == vid && auto_open->pid == pid && auto_open->interface_idx == interface_idx) {
+            SLIST_REMOVE(&p_cdc_acm_obj->auto_open_list, auto_open, cdc_acm_auto_open_s, list_entry);
+            break;
+        }
+    }
+    CDC_ACM_EXIT_CRITICAL();
+    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+
+    CDC_ACM_CHECK(auto_open, ESP_ERR_NOT_FOUND);
+    free(auto_open);
+    return ESP_OK;
+}
+
+/**
+ * @brief Open all registered CDC interfaces of newly connected USB device
+ *
+ * Called from the auto-open task for every USB_HOST_CLIENT_EVENT_NEW_DEV event, so the device is opened right after its enumeration.
+ *
+ * @param[in] cdc_acm_obj Driver object the device was queued to
+ * @param[in] dev_addr    Address of the new USB device
+ */
+static void cdc_acm_auto_open(cdc_acm_obj_t *cdc_acm_obj, uint8_t dev_addr)
+{
+    cdc_acm_auto_opened_t *opened = NULL;
+    size_t opened_num = 0;
+
+    xSemaphoreTake(cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+    if (p_cdc_acm_obj != cdc_acm_obj) {
+        goto exit; // The driver is being uninstalled
+    }
+    size_t auto_open_num = 0;
+    cdc_acm_auto_open_t *auto_open;
+    SLIST_FOREACH(auto_open, &cdc_acm_obj->auto_open_list, list_entry) {
+        auto_open_num++;
+    }
+    if (auto_open_num == 0) {
+        goto exit; // The interfaces were unregistered meanwhile
+    }
+    opened = calloc(auto_open_num, sizeof(cdc_acm_auto_opened_t));
+    if (opened == NULL) {
+        ESP_LOGE(TAG, "Could not auto-open device at address %d, no memory", dev_addr);
+        goto exit;
+    }
+    usb_device_handle_t usb_dev;
+    if (usb_host_device_open(cdc_acm_obj->cdc_acm_client_hdl, dev_addr, &usb_dev) != ESP_OK) {
+        goto exit;
+    }
+    const usb_device_desc_t *device_desc;
+    ESP_ERROR_CHECK(usb_host_get_device_descriptor(usb_dev, &device_desc));
+    const uint16_t vid = device_desc->idVendor;
+    const uint16_t pid = device_desc->idProduct;
+
+    // All CDC devices share the USB device handle, same as if the interfaces were opened by cdc_acm_host_open()
+    bool usb_dev_open = true;
+    bool usb_dev_used = false;
+    SLIST_FOREACH(auto_open, &cdc_acm_obj->auto_open_list, list_entry) {
+        if ((auto_open->vid != vid && auto_open->vid != CDC_HOST_ANY_VID) ||
+                (auto_open->pid != pid && auto_open->pid != CDC_HOST_ANY_PID)) {
+            continue;
+        }
+        // Failed opening closes the USB device, if none of its interfaces is claimed. Open it again
+        if (!usb_dev_open) {
+            if (usb_host_device_open(cdc_acm_obj->cdc_acm_client_hdl, dev_addr, &usb_dev) != ESP_OK) {
+                break;
+            }
+            usb_dev_open = true;
+        }
+        cdc_dev_t *cdc_dev = calloc(1, sizeof(cdc_dev_t));
+        if (cdc_dev == NULL) {
+            ESP_LOGE(TAG, "Could not allocate CDC device");
+            break;
+        }
+        portMUX_INITIALIZE(&cdc_dev->lock);
+        cdc_dev->dev_hdl = usb_dev;
+        cdc_dev->dev_addr = dev_addr;
+        cdc_dev->vid = vid;
+        cdc_dev->pid = pid;
+
+        cdc_acm_dev_hdl_t cdc_hdl;
+        if (cdc_acm_open(cdc_dev, auto_open->interface_idx, &auto_open->dev_config, &cdc_hdl) == ESP_OK) {
+            usb_dev_used = true;
+            // The registration can be removed while the callbacks run, its callback and argument are copied
+            cdc_dev->auto_open_cb_running = true;
+            opened[opened_num].cdc_dev = cdc_dev;
+            opened[opened_num].opened_cb = auto_open->opened_cb;
+            opened[opened_num].user_arg = auto_open->dev_config.user_arg;
+            opened_num++;
+        } else {
+            ESP_LOGW(TAG, "Could not auto-open interface %d of device at address %d", auto_open->interface_idx, dev_addr);
+            usb_dev_open = usb_dev_used;
+        }
+    }
+
+    if (usb_dev_open && !usb_dev_used) {
+        usb_host_device_close(cdc_acm_obj->cdc_acm_client_hdl, usb_dev);
+    }
+exit:
+    xSemaphoreGive(cdc_acm_obj->open_close_mutex);
+
+    // The callbacks run without open_close_mutex, so they can call any function of this driver.
+    // cdc_acm_host_close() from other tasks waits for the callback, so the handle stays valid
+    for (size_t i = 0; i < opened_num; i++) {
+        opened[i].opened_cb((cdc_acm_dev_hdl_t)opened[i].cdc_dev, opened[i].user_arg);
+
+        // The callback could close the device
+        xSemaphoreTake(cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+        cdc_dev_t *cdc_dev;
+        CDC_ACM_ENTER_CRITICAL();
+        SLIST_FOREACH(cdc_dev, &cdc_acm_obj->cdc_devices_list, list_entry) {
+            if (cdc_dev == opened[i].cdc_dev) {
+                cdc_dev->auto_open_cb_running = false;
+                break;
+            }
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        xSemaphoreGive(cdc_acm_obj->open_close_mutex);
+    }
+    free(opened);
+}
+
+static void cdc_acm_auto_open_task(void *arg)
+{
+    cdc_acm_obj_t *cdc_acm_obj = (cdc_acm_obj_t *)arg;
+    uint8_t dev_addr;
+
+    while (1) {
+        xQueueReceive(cdc_acm_obj->auto_open_task.queue, &dev_addr, portMAX_DELAY);
+        if (dev_addr == 0) {
+            break;
+        }
+        cdc_acm_auto_open(cdc_acm_obj, dev_addr);
+    }
+
+    // Inform the uninstalling task that this task will not touch the driver object anymore
+    const TaskHandle_t closing_task = cdc_acm_obj->auto_open_task.closing_task;
+    cdc_acm_obj->auto_open_task.task = NULL;
+    xTaskNotifyGive(closing_task);
+    vTaskDelete(NULL);
+}
+
+esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    CDC_ACM_CHECK(p_cdc_acm_obj, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+
+    cdc_dev_t *cdc_dev;
+    bool device_found;
+    while (1) {
+        xSemaphoreTake(p_cdc_acm_obj->open_close_mutex, portMAX_DELAY);
+
+        // Make sure that the device is in the devices list (that it is not already closed)
+        device_found = false;
+        CDC_ACM_ENTER_CRITICAL();
+        SLIST_FOREACH(cdc_dev, &p_cdc_acm_obj->cdc_devices_list, list_entry) {
+            if (cdc_dev == (cdc_dev_t *)cdc_hdl) {
+                device_found = true;
+                break;
+            }
+        }
+
+        // The auto-open callback gets a valid handle: other tasks wait for its return, the callback itself can close the device
+        if (!device_found || !cdc_dev->auto_open_cb_running || xTaskGetCurrentTaskHandle() == p_cdc_acm_obj->auto_open_task.task) {
+            break;
+        }
+        CDC_ACM_EXIT_CRITICAL();
+        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+        vTaskDelay(1);
+    }
+
+    // Device was not found in the cdc_devices_list; it was already closed, return OK
+    if (!device_found) {
+        CDC_ACM_EXIT_CRITICAL();
+        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+        return ESP_OK;
+    }
+
+    // RX dispatch task cannot wait for its own end
+    if (cdc_dev->data.rx_task && cdc_dev->data.rx_task == xTaskGetCurrentTaskHandle()) {
+        CDC_ACM_EXIT_CRITICAL();
+        xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+        ESP_LOGE(TAG, "Device cannot be closed from its data callback with RX dispatch task");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // No user callbacks from this point
+    cdc_dev->notif.cb = NULL;
+    cdc_dev->data.in_cb = NULL;
+    cdc_dev->data.in_ts_cb = NULL;
+    CDC_ACM_EXIT_CRITICAL();
+
+    // Stop RX dispatch task. Transfers queued before the stop request are resubmitted and canceled with the endpoint below
+    if (cdc_dev->data.rx_task) {
+        const cdc_acm_rx_event_t stop_request = { .transfer = NULL };
+        cdc_dev->data.rx_task_closing = xTaskGetCurrentTaskHandle();
+        xQueueSend(cdc_dev->data.rx_queue, &stop_request, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+
+    // Cancel polling of BULK IN and INTERRUPT IN. All IN transfers of the ring share one endpoint
+    if (cdc_dev->data.in_xfer) {
+        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.in_xfer[0]));
+    }
+    if (cdc_dev->notif.xfer != NULL) {
+        if (cdc_dev->notif.poll_timer) {
+            // Adaptive polling does not submit the transfer of a closed device
+            xSemaphoreTake(cdc_dev->notif.poll_mux, portMAX_DELAY);
+            esp_timer_stop(cdc_dev->notif.poll_timer);
+            cdc_dev->notif.poll_running = false;
+            xSemaphoreGive(cdc_dev->notif.poll_mux);
+        }
+        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->notif.xfer));
+    }
+
+    // Cancel asynchronous OUT transfers that are still in flight
+    if (cdc_dev->data.out_async_xfer) {
+        ESP_ERROR_CHECK(cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, cdc_dev->data.out_async_xfer[0]));
+    }
+
+    // Release all interfaces
+    ESP_ERROR_CHECK(usb_host_interface_release(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl, cdc_dev->data.intf_desc->bInterfaceNumber));
+    if ((cdc_dev->notif.intf_desc != NULL) && (cdc_dev->notif.intf_desc != cdc_dev->data.intf_desc)) {
+        ESP_ERROR_CHECK(usb_host_interface_release(p_cdc_acm_obj->cdc_acm_client_hdl, cdc_dev->dev_hdl, cdc_dev->notif.intf_desc->bInterfaceNumber));
+    }
+
+    CDC_ACM_ENTER_CRITICAL();
+    SLIST_REMOVE(&p_cdc_acm_obj->cdc_devices_list, cdc_dev, cdc_dev_s, list_entry);
+    bool poll_claimed = cdc_dev->notif.poll_claimed;
+    CDC_ACM_EXIT_CRITICAL();
+
+    // The driver task does not find the device in the list anymore, wait for its adaptive polling step in progress
+    while (poll_claimed) {
+        vTaskDelay(1);
+        CDC_ACM_ENTER_CRITICAL();
+        poll_claimed = cdc_dev->notif.poll_claimed;
+        CDC_ACM_EXIT_CRITICAL();
+    }
+
+    cdc_acm_device_remove(cdc_dev);
+    xSemaphoreGive(p_cdc_acm_obj->open_close_mutex);
+    return ESP_OK;
+}
+
+void cdc_acm_host_desc_print(cdc_acm_dev_hdl_t cdc_hdl)
+{
     assert(cdc_hdl);
     cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
 
@@ -697,6 +1636,45 @@ void cdc_acm_host_desc_print(cdc_acm_dev_hdl_t cdc_hdl)
     usb_print_config_descriptor(config_desc, cdc_print_desc);
 }
 
+/**
+ * @brief Update device statistics with a finished transfer
+ *
+ * @param[in] cdc_dev      Pointer to CDC device
+ * @param[in] transfer     Finished data or notification transfer
+ * @param[in] submit_time_us Submission time of BULK OUT transfer, ignored for IN transfers
+ */
+static void cdc_acm_stats_update(cdc_dev_t *cdc_dev, const usb_transfer_t *transfer, int64_t submit_time_us)
+{
+    const bool completed = (transfer->status == USB_TRANSFER_STATUS_COMPLETED);
+    const bool is_in = transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK;
+    const uint32_t latency_us = (!is_in && completed) ? (uint32_t)(esp_timer_get_time() - submit_time_us) : 0;
+
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    cdc_acm_host_stats_t *cnt = &cdc_dev->stats.cnt;
+    if (transfer->status < CDC_ACM_XFER_STATUS_NUM) {
+        cnt->xfer_status[transfer->status]++;
+    }
+    if (completed) {
+        if (transfer == cdc_dev->notif.xfer) {
+            cnt->notif_transfers++;
+        } else if (is_in) {
+            cnt->rx_transfers++;
+            cnt->rx_bytes += transfer->actual_num_bytes;
+        } else {
+            cnt->tx_transfers++;
+            cnt->tx_bytes += transfer->actual_num_bytes;
+            cdc_dev->stats.tx_latency_sum_us += latency_us;
+            if (cnt->tx_transfers == 1 || latency_us < cnt->tx_latency_min_us) {
+                cnt->tx_latency_min_us = latency_us;
+            }
+            if (latency_us > cnt->tx_latency_max_us) {
+                cnt->tx_latency_max_us = latency_us;
+            }
+        }
+    }
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+}
+
 /**
  * @brief Check finished transfer status
  *
@@ -711,6 +1689,7 @@ static bool cdc_acm_is_transfer_completed(usb_transfer_t *transfer)
 {
     cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
     bool completed = false;
+    cdc_acm_stats_update(cdc_dev, transfer, 0);
 
     switch (transfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED:
@@ -737,66 +1716,298 @@ static bool cdc_acm_is_transfer_completed(usb_transfer_t *transfer)
     return completed;
 }
 
-static void in_xfer_cb(usb_transfer_t *transfer)
+/**
+ * @brief Notify user about RX overrun
+ *
+ * @param[in] cdc_dev Pointer to CDC device
+ */
+static void cdc_acm_rx_overrun_notify(cdc_dev_t *cdc_dev)
 {
-    ESP_LOGD(TAG, "in xfer cb");
-    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    cdc_dev->stats.cnt.rx_overruns++;
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+
+    cdc_dev->serial_state.bOverRun = true;
+    if (cdc_dev->notif.cb) {
+        const cdc_acm_host_dev_event_data_t serial_state_event = {
+            .type = CDC_ACM_HOST_SERIAL_STATE,
+            .data.serial_state = cdc_dev->serial_state
+        };
+        cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
+    }
+    cdc_dev->serial_state.bOverRun = false;
+}
 
-    if (!cdc_acm_is_transfer_completed(transfer)) {
+/**
+ * @brief Pass received data to user's data callback
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] data     Received data
+ * @param[in] data_len Length of the data in bytes
+ * @return Return value of the callback: received data was processed
+ */
+static bool cdc_acm_data_dispatch(cdc_dev_t *cdc_dev, const uint8_t *data, size_t data_len)
+{
+    if (cdc_dev->data.in_ts_cb) {
+        return cdc_dev->data.in_ts_cb(data, data_len, cdc_dev->data.in_time_us, cdc_dev->cb_arg);
+    }
+    return cdc_dev->data.in_cb(data, data_len, cdc_dev->cb_arg);
+}
+
+/**
+ * @brief Start round-trip latency measurement
+ *
+ * Only the first OUT transfer submitted after the last received data starts the measurement.
+ *
+ * @param[in] cdc_dev        Pointer to CDC device
+ * @param[in] submit_time_us Submission time of BULK OUT transfer
+ */
+static void cdc_acm_rtt_tx_mark(cdc_dev_t *cdc_dev, int64_t submit_time_us)
+{
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    if (cdc_dev->stats.rtt_tx_time_us == 0) {
+        cdc_dev->stats.rtt_tx_time_us = submit_time_us;
+    }
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+}
+
+/**
+ * @brief Check whether completed IN transfer contains data, not only vendor specific status of its packets
+ *
+ * @param[in] cdc_dev  Pointer to CDC device
+ * @param[in] transfer Completed IN transfer
+ * @return true if the transfer contains data
+ */
+static bool cdc_acm_in_has_data(const cdc_dev_t *cdc_dev, const usb_transfer_t *transfer)
+{
+    const size_t len = transfer->actual_num_bytes;
+    const size_t status_len = cdc_dev->data.in_status_len;
+    const size_t mps = cdc_dev->data.in_mps;
+    if (status_len == 0 || mps == 0) {
+        return len > 0;
+    }
+    for (size_t pkt = 0; pkt < len; pkt += mps) {
+        if (((len - pkt < mps) ? (len - pkt) : mps) > status_len) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Finish round-trip latency measurement and add the sample to the histogram
+ *
+ * @param[in] cdc_dev    Pointer to CDC device
+ * @param[in] transfer   Completed IN transfer
+ * @param[in] rx_time_us Completion time of the IN transfer
+ */
+static void cdc_acm_rtt_rx_mark(cdc_dev_t *cdc_dev, const usb_transfer_t *transfer, int64_t rx_time_us)
+{
+    if (!cdc_acm_in_has_data(cdc_dev, transfer)) {
         return;
     }
 
-    if (cdc_dev->data.in_cb) {
-        const bool data_processed = cdc_dev->data.in_cb(transfer->data_buffer, transfer->actual_num_bytes, cdc_dev->cb_arg);
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    const int64_t tx_time_us = cdc_dev->stats.rtt_tx_time_us;
+    // OUT transfer submitted after this IN transfer completed is answered by later data
+    if (tx_time_us != 0 && tx_time_us <= rx_time_us) {
+        cdc_acm_host_rtt_hist_t *rtt = &cdc_dev->stats.rtt;
+        const uint32_t rtt_us = (uint32_t)(rx_time_us - tx_time_us);
+        const uint32_t scaled = rtt_us / CDC_ACM_RTT_HIST_BUCKET0_US;
+        const int bucket = (scaled == 0) ? 0 : 32 - __builtin_clz(scaled);
+        rtt->buckets[(bucket < CDC_ACM_RTT_HIST_BUCKETS) ? bucket : CDC_ACM_RTT_HIST_BUCKETS - 1]++;
+        rtt->samples++;
+        cdc_dev->stats.rtt_sum_us += rtt_us;
+        if (rtt->samples == 1 || rtt_us < rtt->min_us) {
+            rtt->min_us = rtt_us;
+        }
+        if (rtt_us > rtt->max_us) {
+            rtt->max_us = rtt_us;
+        }
+        cdc_dev->stats.rtt_tx_time_us = 0;
+    }
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+}
+
+/**
+ * @brief Pass complete RX frame to the RX ring or to user's data callback
+ *
+ * @param[in] frame Received frame, in the IN transfer buffer or in the frame buffer
+ * @param[in] len   Length of the frame in bytes
+ * @param[in] arg   Pointer to CDC device
+ */
+static void cdc_acm_rx_frame(uint8_t *frame, size_t len, void *arg)
+{
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)arg;
+    if (cdc_dev->data.rx_ring) {
+        if (xMessageBufferSend(cdc_dev->data.rx_ring, frame, len, 0) == 0) {
+            ESP_LOGW(TAG, "RX ring overflow, frame of %d bytes dropped", (int)len);
+            cdc_acm_rx_overrun_notify(cdc_dev);
+        }
+    } else if (cdc_dev->data.in_cb || cdc_dev->data.in_ts_cb) {
+        // Complete frames are never appended, so the return value is not used
+        cdc_acm_data_dispatch(cdc_dev, frame, len);
+    }
+}
+
+/**
+ * @brief Process completed IN transfer
+ *
+ * Received data are passed to the RX ring or to user's data callback and the transfer is resubmitted.
+ * Called from in_xfer_cb() or from RX dispatch task.
+ *
+ * @param[in] cdc_dev    Pointer to CDC device
+ * @param[in] transfer   Completed IN transfer
+ * @param[in] rx_time_us Completion time of the IN transfer
+ */
+static void cdc_acm_in_xfer_process(cdc_dev_t *cdc_dev, usb_transfer_t *transfer, int64_t rx_time_us)
+{
+    cdc_dev->data.in_time_us = rx_time_us;
+    if (cdc_dev->data.rx_framing) {
+        // Frames are decoded in the transfer buffer, which is overwritten by the next transfer anyway
+        const size_t dropped = cdc_rx_framing_process(cdc_dev->data.rx_framing, transfer->data_buffer, transfer->actual_num_bytes, cdc_acm_rx_frame, cdc_dev);
+        if (dropped > 0) {
+            ESP_LOGW(TAG, "%d RX frames too long or malformed, dropped", (int)dropped);
+            cdc_acm_rx_overrun_notify(cdc_dev);
+        }
+    } else if (cdc_dev->data.rx_ring) {
+        // This task is the only writer of the ring, the user is the only reader, so no locking is needed
+        const size_t written = xStreamBufferSend(cdc_dev->data.rx_ring, transfer->data_buffer, transfer->actual_num_bytes, 0);
+        if (written < transfer->actual_num_bytes) {
+            ESP_LOGW(TAG, "RX ring overflow, %d bytes dropped", (int)(transfer->actual_num_bytes - written));
+            cdc_acm_rx_overrun_notify(cdc_dev);
+        }
+    } else if (cdc_dev->data.in_cb || cdc_dev->data.in_ts_cb) {
+        uint8_t *data = transfer->data_buffer;
+        if (cdc_dev->data.in_data_len > 0) {
+            // Appended data were received to an aligned position, move them right behind the previous data
+            data = cdc_dev->data.in_data_buffer_base + cdc_dev->data.in_data_len;
+            if (data != transfer->data_buffer) {
+                memmove(data, transfer->data_buffer, transfer->actual_num_bytes);
+            }
+        }
+        const bool data_processed = cdc_acm_data_dispatch(cdc_dev, data, transfer->actual_num_bytes);
 
         // Information for developers:
         // In order to save RAM and CPU time, the application can indicate that the received data was not processed and that the application expects more data.
         // In this case, the next received data must be appended to the existing buffer.
         // Since the data_buffer in usb_transfer_t is a constant pointer, we must cast away to const qualifier.
-        if (!data_processed) {
-#if !SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+        if (data_processed) {
+            cdc_acm_reset_in_transfer(cdc_dev, transfer);
+        } else if (cdc_dev->data.in_xfer_num > 1) {
+            // Every transfer in the ring has its own buffer, so the data cannot be appended across transfers
+            ESP_LOGW(TAG, "RX buffer append is not supported with multiple IN transfers!");
+            cdc_acm_reset_in_transfer(cdc_dev, transfer);
+        } else {
             // In case the received data was not processed, the next RX data must be appended to current buffer
+            cdc_dev->data.in_data_len += transfer->actual_num_bytes;
+            const size_t offset = ((cdc_dev->data.in_data_len + CDC_ACM_IN_APPEND_ALIGN - 1) / CDC_ACM_IN_APPEND_ALIGN) * CDC_ACM_IN_APPEND_ALIGN;
             uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
-            *ptr += transfer->actual_num_bytes;
+            *ptr = cdc_dev->data.in_data_buffer_base + offset;
 
-            // Calculate remaining space in the buffer. Attention: pointer arithmetic!
-            size_t space_left = transfer->data_buffer_size - (transfer->data_buffer - cdc_dev->data.in_data_buffer_base);
-            uint16_t mps = cdc_dev->data.in_mps;
-            transfer->num_bytes = (space_left / mps) * mps; // Round down to MPS for next transfer
+            // Calculate remaining space in the buffer. The transfer length must be a multiple of MPS and of cache line
+            const size_t space_left = (cdc_dev->data.in_buffer_size > offset) ? cdc_dev->data.in_buffer_size - offset : 0;
+            const uint16_t mps = cdc_dev->data.in_mps;
+            const size_t step = (mps > CDC_ACM_IN_APPEND_ALIGN) ? mps : CDC_ACM_IN_APPEND_ALIGN;
+            transfer->num_bytes = (space_left / step) * step; // Round down for next transfer
 
             if (transfer->num_bytes == 0) {
                 // The IN buffer cannot accept more data, inform the user and reset the buffer
                 ESP_LOGW(TAG, "IN buffer overflow");
-                cdc_dev->serial_state.bOverRun = true;
-                if (cdc_dev->notif.cb) {
-                    const cdc_acm_host_dev_event_data_t serial_state_event = {
-                        .type = CDC_ACM_HOST_SERIAL_STATE,
-                        .data.serial_state = cdc_dev->serial_state
-                    };
-                    cdc_dev->notif.cb(&serial_state_event, cdc_dev->cb_arg);
-                }
-
-                cdc_acm_reset_in_transfer(cdc_dev);
-                cdc_dev->serial_state.bOverRun = false;
+                cdc_acm_rx_overrun_notify(cdc_dev);
+                cdc_acm_reset_in_transfer(cdc_dev, transfer);
             }
-#else
-            // For targets that must sync internal memory through L1CACHE, we cannot change the data_buffer
-            // because it would lead to unaligned cache sync, which is not allowed
-            ESP_LOGW(TAG, "RX buffer append is not yet supported on ESP32-P4!");
-#endif
-        } else {
-            cdc_acm_reset_in_transfer(cdc_dev);
         }
     }
 
-    ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-    usb_host_transfer_submit(cdc_dev->data.in_xfer);
+    // Other transfers of the ring are still queued on the endpoint, this one goes to the end of the queue
+    ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
+    CDC_ACM_TRACE_SUBMIT(cdc_dev, transfer);
+    usb_host_transfer_submit(transfer);
+}
+
+static void in_xfer_cb(usb_transfer_t *transfer)
+{
+    // Timestamp first, so that the RX time does not include the processing below
+    const int64_t rx_time_us = esp_timer_get_time();
+    ESP_LOGD(TAG, "in xfer cb");
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+    CDC_ACM_TRACE_COMPLETE(cdc_dev, transfer);
+
+    if (!cdc_acm_is_transfer_completed(transfer)) {
+        return;
+    }
+    cdc_acm_rtt_rx_mark(cdc_dev, transfer, rx_time_us);
+
+    if (cdc_dev->data.rx_queue) {
+        // The queue can hold all IN transfers of the ring, so it never overflows
+        const cdc_acm_rx_event_t rx_event = {
+            .transfer = transfer,
+            .rx_time_us = rx_time_us,
+        };
+        xQueueSend(cdc_dev->data.rx_queue, &rx_event, 0);
+    } else {
+        cdc_acm_in_xfer_process(cdc_dev, transfer, rx_time_us);
+    }
+}
+
+static void cdc_acm_rx_task(void *arg)
+{
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)arg;
+    cdc_acm_rx_event_t rx_event;
+
+    while (1) {
+        xQueueReceive(cdc_dev->data.rx_queue, &rx_event, portMAX_DELAY);
+        if (rx_event.transfer == NULL) {
+            break;
+        }
+        cdc_acm_in_xfer_process(cdc_dev, rx_event.transfer, rx_event.rx_time_us);
+    }
+
+    // Inform the closing task that this task will not touch the device anymore
+    const TaskHandle_t closing_task = cdc_dev->data.rx_task_closing;
+    cdc_dev->data.rx_task = NULL;
+    xTaskNotifyGive(closing_task);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Check whether the received serial state should be reported to the user
+ *
+ * Applies the optional serial state filter from device configuration. Suppressed changes are not lost:
+ * the state is compared with the last reported one, so the change is reported with the next notification after the interval.
+ *
+ * @param[in] cdc_dev Pointer to CDC device with already updated serial_state
+ * @return true if CDC_ACM_HOST_SERIAL_STATE event should be reported
+ */
+static bool cdc_acm_serial_state_filter(cdc_dev_t *cdc_dev)
+{
+    if (cdc_dev->notif.serial_state_reported) {
+        if (cdc_dev->notif.serial_state_dedup && cdc_dev->serial_state.val == cdc_dev->notif.serial_state_last) {
+            return false;
+        }
+        if (cdc_dev->notif.serial_state_interval_ms &&
+                esp_timer_get_time() - cdc_dev->notif.serial_state_time_us < (int64_t)cdc_dev->notif.serial_state_interval_ms * 1000) {
+            return false;
+        }
+    }
+    cdc_dev->notif.serial_state_reported = true;
+    cdc_dev->notif.serial_state_last = cdc_dev->serial_state.val;
+    if (cdc_dev->notif.serial_state_interval_ms) {
+        cdc_dev->notif.serial_state_time_us = esp_timer_get_time();
+    }
+    return true;
 }
 
 static void notif_xfer_cb(usb_transfer_t *transfer)
 {
     ESP_LOGD(TAG, "notif xfer cb");
     cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+    if (cdc_dev->notif.poll_timer) {
+        cdc_acm_notif_poll_returned(cdc_dev, transfer->status == USB_TRANSFER_STATUS_COMPLETED);
+    } else {
+        cdc_dev->notif.xfer_busy = false;
+    }
 
     if (cdc_acm_is_transfer_completed(transfer)) {
         cdc_notification_t *notif = (cdc_notification_t *)transfer->data_buffer;
@@ -813,7 +2024,7 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
         }
         case USB_CDC_NOTIF_SERIAL_STATE: {
             cdc_dev->serial_state.val = *((uint16_t *)notif->Data);
-            if (cdc_dev->notif.cb) {
+            if (cdc_dev->notif.cb && cdc_acm_serial_state_filter(cdc_dev)) {
                 const cdc_acm_host_dev_event_data_t serial_state_event = {
                     .type = CDC_ACM_HOST_SERIAL_STATE,
                     .data.serial_state = cdc_dev->serial_state
@@ -822,7 +2033,15 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
             }
             break;
         }
-        case USB_CDC_NOTIF_RESPONSE_AVAILABLE: // Encapsulated commands not implemented - fallthrough
+        case USB_CDC_NOTIF_RESPONSE_AVAILABLE: {
+            if (cdc_dev->notif.cb) {
+                const cdc_acm_host_dev_event_data_t response_event = {
+                    .type = CDC_ACM_HOST_RESPONSE_AVAILABLE,
+                };
+                cdc_dev->notif.cb(&response_event, cdc_dev->cb_arg);
+            }
+            break;
+        }
         default:
             ESP_LOGW(TAG, "Unsupported notification type 0x%02X", notif->bNotificationCode);
             ESP_LOG_BUFFER_HEX(TAG, transfer->data_buffer, transfer->actual_num_bytes);
@@ -831,26 +2050,84 @@ static void notif_xfer_cb(usb_transfer_t *transfer)
 
         // Start polling for new data again
         ESP_LOGD(TAG, "Submitting poll for INTR IN transfer");
-        usb_host_transfer_submit(cdc_dev->notif.xfer);
+        cdc_acm_notif_submit(cdc_dev);
     }
 }
 
 static void out_xfer_cb(usb_transfer_t *transfer)
 {
-    ESP_LOGD(TAG, "out/ctrl xfer cb");
+    ESP_LOGD(TAG, "ctrl xfer cb");
     assert(transfer->context);
     xSemaphoreGive((SemaphoreHandle_t)transfer->context);
 }
 
+static void out_bulk_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "out xfer cb");
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)transfer->context;
+    assert(cdc_dev);
+    CDC_ACM_TRACE_COMPLETE(cdc_dev, transfer);
+    xSemaphoreGive(cdc_dev->data.out_done);
+}
+
+/**
+ * @brief Account finished transfers of an asynchronous write
+ *
+ * The last finished transfer returns the first transfer of the write to the pool and calls the user's callback,
+ * once for the whole write.
+ *
+ * @param[in] group    Context of the first transfer of the write
+ * @param[in] finished Number of finished transfers
+ */
+static void cdc_acm_tx_group_finish(cdc_acm_tx_ctx_t *group, uint32_t finished)
+{
+    if (__atomic_sub_fetch(&group->group_remaining, finished, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+
+    // Make local copy of the context, the transfer can be reused as soon as it is returned to the pool
+    cdc_dev_t *cdc_dev = group->cdc_dev;
+    usb_transfer_t *transfer = group->xfer;
+    const cdc_acm_tx_callback_t tx_cb = group->cb;
+    void *tx_cb_arg = group->cb_arg;
+    const esp_err_t status = __atomic_load_n(&group->group_status, __ATOMIC_RELAXED);
+
+    xQueueSend(cdc_dev->data.out_async_free, &transfer, 0);
+    if (tx_cb) {
+        tx_cb((cdc_acm_dev_hdl_t)cdc_dev, status, tx_cb_arg);
+    }
+}
+
+static void out_async_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "out async xfer cb");
+    cdc_acm_tx_ctx_t *ctx = (cdc_acm_tx_ctx_t *)transfer->context;
+    assert(ctx);
+
+    cdc_dev_t *cdc_dev = ctx->cdc_dev;
+    CDC_ACM_TRACE_COMPLETE(cdc_dev, transfer);
+    cdc_acm_tx_ctx_t *group = ctx->group;
+    const bool completed = (transfer->status == USB_TRANSFER_STATUS_COMPLETED) && (transfer->actual_num_bytes == transfer->num_bytes);
+    cdc_acm_stats_update(cdc_dev, transfer, ctx->submit_time_us);
+    if (!completed) {
+        __atomic_store_n(&group->group_status, ESP_ERR_INVALID_RESPONSE, __ATOMIC_RELAXED);
+    }
+
+    // The first transfer holds the state of the write, it is returned to the pool when the whole write finished
+    if (ctx != group) {
+        xQueueSend(cdc_dev->data.out_async_free, &transfer, 0);
+    }
+    cdc_acm_tx_group_finish(group, 1);
+}
+
 static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg)
 {
     switch (event_msg->event) {
     case USB_HOST_CLIENT_EVENT_NEW_DEV:
-        // Guard p_cdc_acm_obj->new_dev_cb from concurrent access
         ESP_LOGD(TAG, "New device connected");
-        CDC_ACM_ENTER_CRITICAL();
-        cdc_acm_new_dev_callback_t _new_dev_cb = p_cdc_acm_obj->new_dev_cb;
-        CDC_ACM_EXIT_CRITICAL();
+        CDC_ACM_ENUM_MARK(event_msg->new_dev.address, "new_dev");
+        // p_cdc_acm_obj->new_dev_cb can be changed concurrently by cdc_acm_host_register_new_dev_callback()
+        cdc_acm_new_dev_callback_t _new_dev_cb = __atomic_load_n(&p_cdc_acm_obj->new_dev_cb, __ATOMIC_ACQUIRE);
 
         if (_new_dev_cb) {
             usb_device_handle_t new_dev;
@@ -862,6 +2139,14 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
             usb_host_device_close(p_cdc_acm_obj->cdc_acm_client_hdl, new_dev);
         }
 
+        // Only the list head is read, it is modified under open_close_mutex by (un)registering
+        if (__atomic_load_n(&SLIST_FIRST(&p_cdc_acm_obj->auto_open_list), __ATOMIC_ACQUIRE) != NULL) {
+            // The task exists since the first registration. Opening takes several control transfers, do not wait for it here
+            const uint8_t dev_addr = event_msg->new_dev.address;
+            if (xQueueSend(p_cdc_acm_obj->auto_open_task.queue, &dev_addr, 0) != pdTRUE) {
+                ESP_LOGW(TAG, "Auto-open queue full, device at address %d is not opened", dev_addr);
+            }
+        }
         break;
     case USB_HOST_CLIENT_EVENT_DEV_GONE: {
         ESP_LOGD(TAG, "Device suddenly disconnected");
@@ -887,14 +2172,19 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
     }
 }
 
-esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms)
+/**
+ * @brief Gather data segments into the OUT transfer and send it - blocking mode
+ *
+ * @param[in] cdc_dev     Pointer to CDC device
+ * @param[in] segments    Array of data segments, already checked by the caller
+ * @param[in] segment_cnt Number of segments in the array
+ * @param[in] data_len    Total length of all segments
+ * @param[in] timeout_ms  Timeout in [ms]
+ * @return esp_err_t
+ */
+static esp_err_t cdc_acm_tx_gather_blocking(cdc_dev_t *cdc_dev, const cdc_acm_tx_segment_t *segments, size_t segment_cnt, size_t data_len, uint32_t timeout_ms)
 {
     esp_err_t ret;
-    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
-    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
-    CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
-    CDC_ACM_CHECK(cdc_dev->data.out_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
-    CDC_ACM_CHECK(data_len <= cdc_dev->data.out_xfer->data_buffer_size, ESP_ERR_INVALID_SIZE);
 
     // Take OUT mutex and fill the OUT transfer
     BaseType_t taken = xSemaphoreTake(cdc_dev->data.out_mux, pdMS_TO_TICKS(timeout_ms));
@@ -903,12 +2193,21 @@ esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t
     }
 
     ESP_LOGD(TAG, "Submitting BULK OUT transfer");
-    SemaphoreHandle_t transfer_finished_semaphore = (SemaphoreHandle_t)cdc_dev->data.out_xfer->context;
+    SemaphoreHandle_t transfer_finished_semaphore = cdc_dev->data.out_done;
     xSemaphoreTake(transfer_finished_semaphore, 0); // Make sure the semaphore is taken before we submit new transfer
 
-    memcpy(cdc_dev->data.out_xfer->data_buffer, data, data_len);
+    size_t offset = 0;
+    for (size_t i = 0; i < segment_cnt; i++) {
+        if (segments[i].len > 0) {
+            memcpy(cdc_dev->data.out_xfer->data_buffer + offset, segments[i].data, segments[i].len);
+            offset += segments[i].len;
+        }
+    }
     cdc_dev->data.out_xfer->num_bytes = data_len;
     cdc_dev->data.out_xfer->timeout_ms = timeout_ms;
+    const int64_t submit_time_us = esp_timer_get_time();
+    cdc_acm_rtt_tx_mark(cdc_dev, submit_time_us);
+    CDC_ACM_TRACE_SUBMIT(cdc_dev, cdc_dev->data.out_xfer);
     ESP_GOTO_ON_ERROR(usb_host_transfer_submit(cdc_dev->data.out_xfer), unblock, TAG,);
 
     // Wait for OUT transfer completion
@@ -920,6 +2219,7 @@ esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t
         goto unblock;
     }
 
+    cdc_acm_stats_update(cdc_dev, cdc_dev->data.out_xfer, submit_time_us);
     ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Bulk OUT transfer error");
     ESP_GOTO_ON_FALSE(cdc_dev->data.out_xfer->actual_num_bytes == data_len, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
     ret = ESP_OK;
@@ -929,6 +2229,247 @@ unblock:
     return ret;
 }
 
+esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.out_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
+    CDC_ACM_CHECK(data_len <= cdc_dev->data.out_buffer_size, ESP_ERR_INVALID_SIZE);
+
+    const cdc_acm_tx_segment_t segment = {
+        .data = data,
+        .len = data_len,
+    };
+    return cdc_acm_tx_gather_blocking(cdc_dev, &segment, 1, data_len, timeout_ms);
+}
+
+esp_err_t cdc_acm_host_data_tx_vectored(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_tx_segment_t *segments, size_t segment_cnt, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(segments && (segment_cnt > 0), ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.out_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened as read-only.
+
+    size_t data_len = 0;
+    for (size_t i = 0; i < segment_cnt; i++) {
+        CDC_ACM_CHECK(segments[i].data || (segments[i].len == 0), ESP_ERR_INVALID_ARG);
+        CDC_ACM_CHECK(segments[i].len <= cdc_dev->data.out_buffer_size - data_len, ESP_ERR_INVALID_SIZE); // All segments must fit into one OUT transfer
+        data_len += segments[i].len;
+    }
+    CDC_ACM_CHECK(data_len > 0, ESP_ERR_INVALID_ARG);
+
+    return cdc_acm_tx_gather_blocking(cdc_dev, segments, segment_cnt, data_len, timeout_ms);
+}
+
+/**
+ * @brief Take free transfers from the asynchronous TX pool
+ *
+ * Either all requested transfers are taken, or none.
+ *
+ * @param[in]  cdc_dev    Pointer to CDC device
+ * @param[out] xfers      Array of taken transfers
+ * @param[in]  xfer_cnt   Number of transfers to take
+ * @param[in]  timeout_ms Timeout in [ms] for waiting for all free transfers
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_TIMEOUT: Not enough free transfers in the pool within timeout_ms
+ */
+static esp_err_t cdc_acm_async_xfers_take(cdc_dev_t *cdc_dev, usb_transfer_t **xfers, size_t xfer_cnt, uint32_t timeout_ms)
+{
+    TickType_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
+    TimeOut_t take_timeout;
+    vTaskSetTimeOutState(&take_timeout);
+
+    for (size_t i = 0; i < xfer_cnt; i++) {
+        if (xQueueReceive(cdc_dev->data.out_async_free, &xfers[i], timeout_ticks) != pdTRUE) {
+            // Return the transfers we have taken so far
+            for (size_t j = 0; j < i; j++) {
+                xQueueSend(cdc_dev->data.out_async_free, &xfers[j], 0);
+            }
+            return ESP_ERR_TIMEOUT;
+        }
+        xTaskCheckForTimeOut(&take_timeout, &timeout_ticks); // Update remaining time
+    }
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_data_tx_async(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_tx_callback_t tx_cb, void *user_arg, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(data && (data_len > 0), ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.out_async_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened without asynchronous TX pool
+
+    // Data larger than one transfer buffer are split into several transfers from the pool
+    const size_t buf_size = cdc_dev->data.out_buffer_size;
+    const size_t xfer_cnt = (data_len + buf_size - 1) / buf_size;
+    CDC_ACM_CHECK(xfer_cnt <= cdc_dev->data.out_async_xfer_num, ESP_ERR_INVALID_SIZE);
+
+    usb_transfer_t *xfers[xfer_cnt];
+    ESP_RETURN_ON_ERROR(cdc_acm_async_xfers_take(cdc_dev, xfers, xfer_cnt, timeout_ms), TAG,);
+
+    // The first transfer reports completion of the whole write
+    cdc_acm_tx_ctx_t *group = (cdc_acm_tx_ctx_t *)xfers[0]->context;
+    group->cb = tx_cb;
+    group->cb_arg = user_arg;
+    group->group_remaining = xfer_cnt;
+    group->group_status = ESP_OK;
+
+    // Concurrent writes must not interleave their transfers
+    xSemaphoreTake(cdc_dev->data.out_async_mux, portMAX_DELAY);
+    esp_err_t ret = ESP_OK;
+    size_t submitted;
+    for (submitted = 0; submitted < xfer_cnt; submitted++) {
+        const size_t offset = submitted * buf_size;
+        const size_t len = ((data_len - offset) > buf_size) ? buf_size : (data_len - offset);
+        usb_transfer_t *transfer = xfers[submitted];
+        cdc_acm_tx_ctx_t *ctx = (cdc_acm_tx_ctx_t *)transfer->context;
+
+        ctx->group = group;
+        memcpy(transfer->data_buffer, data + offset, len);
+        transfer->num_bytes = len;
+        ctx->submit_time_us = esp_timer_get_time();
+        cdc_acm_rtt_tx_mark(cdc_dev, ctx->submit_time_us);
+
+        ESP_LOGD(TAG, "Submitting async BULK OUT transfer");
+        CDC_ACM_TRACE_SUBMIT(cdc_dev, transfer);
+        ret = usb_host_transfer_submit(transfer);
+        if (ret != ESP_OK) {
+            break;
+        }
+    }
+    xSemaphoreGive(cdc_dev->data.out_async_mux);
+
+    if (submitted < xfer_cnt) {
+        // Transfers that are not in flight are returned to the pool, the first one by cdc_acm_tx_group_finish()
+        for (size_t j = MAX(submitted, 1); j < xfer_cnt; j++) {
+            xQueueSend(cdc_dev->data.out_async_free, &xfers[j], 0);
+        }
+        if (submitted == 0) {
+            // Nothing was sent, the error is only returned
+            group->cb = NULL;
+        } else {
+            // The submitted part of the data cannot be taken back, the user's callback reports the failure
+            __atomic_store_n(&group->group_status, ESP_ERR_INVALID_RESPONSE, __ATOMIC_RELAXED);
+        }
+        cdc_acm_tx_group_finish(group, xfer_cnt - submitted);
+    }
+    return ret;
+}
+
+esp_err_t cdc_acm_host_data_tx_buffer_get(cdc_acm_dev_hdl_t cdc_hdl, uint8_t **buf, size_t *buf_size, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(buf && buf_size, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.out_async_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened without asynchronous TX pool
+
+    usb_transfer_t *transfer;
+    if (xQueueReceive(cdc_dev->data.out_async_free, &transfer, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // Transfer buffers are allocated by USB Host Library, so they are DMA capable
+    ((cdc_acm_tx_ctx_t *)transfer->context)->lent = true;
+    *buf = transfer->data_buffer;
+    *buf_size = cdc_dev->data.out_buffer_size;
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_data_tx_buffer_submit(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *buf, size_t data_len, cdc_acm_tx_callback_t tx_cb, void *user_arg)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(buf, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.out_async_xfer, ESP_ERR_NOT_SUPPORTED); // Device was opened without asynchronous TX pool
+
+    // Find the transfer that owns this buffer. The pool is small, linear search is sufficient
+    usb_transfer_t *transfer = NULL;
+    for (int i = 0; i < cdc_dev->data.out_async_xfer_num; i++) {
+        if (cdc_dev->data.out_async_xfer[i]->data_buffer == buf) {
+            transfer = cdc_dev->data.out_async_xfer[i];
+            break;
+        }
+    }
+    CDC_ACM_CHECK(transfer, ESP_ERR_INVALID_ARG);
+    cdc_acm_tx_ctx_t *ctx = (cdc_acm_tx_ctx_t *)transfer->context;
+    CDC_ACM_CHECK(ctx->lent, ESP_ERR_INVALID_STATE);
+    CDC_ACM_CHECK(data_len <= cdc_dev->data.out_buffer_size, ESP_ERR_INVALID_SIZE);
+    ctx->lent = false;
+
+    if (data_len == 0) {
+        // Nothing to send, return the buffer to the pool
+        xQueueSend(cdc_dev->data.out_async_free, &transfer, 0);
+        return ESP_OK;
+    }
+
+    ctx->group = ctx;
+    ctx->cb = tx_cb;
+    ctx->cb_arg = user_arg;
+    ctx->group_remaining = 1;
+    ctx->group_status = ESP_OK;
+    transfer->num_bytes = data_len;
+    ctx->submit_time_us = esp_timer_get_time();
+    cdc_acm_rtt_tx_mark(cdc_dev, ctx->submit_time_us);
+
+    ESP_LOGD(TAG, "Submitting zero-copy BULK OUT transfer");
+    xSemaphoreTake(cdc_dev->data.out_async_mux, portMAX_DELAY);
+    CDC_ACM_TRACE_SUBMIT(cdc_dev, transfer);
+    const esp_err_t ret = usb_host_transfer_submit(transfer);
+    xSemaphoreGive(cdc_dev->data.out_async_mux);
+    if (ret != ESP_OK) {
+        // The transfer is not in flight, return it to the pool
+        xQueueSend(cdc_dev->data.out_async_free, &transfer, 0);
+    }
+    return ret;
+}
+
+esp_err_t cdc_acm_host_data_rx(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(data && (data_len > 0) && rx_len, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(cdc_dev->data.rx_ring, ESP_ERR_NOT_SUPPORTED); // Device was opened without RX ring buffer
+    // Frame that does not fit into the buffer would stay in the ring forever
+    CDC_ACM_CHECK(!cdc_dev->data.rx_framing || data_len >= cdc_dev->data.rx_framing->buf_size, ESP_ERR_INVALID_SIZE);
+
+    *rx_len = xStreamBufferReceive(cdc_dev->data.rx_ring, data, data_len, pdMS_TO_TICKS(timeout_ms));
+    return (*rx_len > 0) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t cdc_acm_host_get_stats(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_host_stats_t *stats)
+{
+    CDC_ACM_CHECK(cdc_hdl && stats, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    *stats = cdc_dev->stats.cnt;
+    const uint64_t tx_latency_sum_us = cdc_dev->stats.tx_latency_sum_us;
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+
+    stats->tx_latency_avg_us = (stats->tx_transfers > 0) ? (uint32_t)(tx_latency_sum_us / stats->tx_transfers) : 0;
+    return ESP_OK;
+}
+
+esp_err_t cdc_acm_host_get_rtt_histogram(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_host_rtt_hist_t *hist, bool reset)
+{
+    CDC_ACM_CHECK(cdc_hdl && hist, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+
+    CDC_ACM_DEV_ENTER_CRITICAL(cdc_dev);
+    *hist = cdc_dev->stats.rtt;
+    const uint64_t rtt_sum_us = cdc_dev->stats.rtt_sum_us;
+    if (reset) {
+        memset(&cdc_dev->stats.rtt, 0, sizeof(cdc_acm_host_rtt_hist_t));
+        cdc_dev->stats.rtt_sum_us = 0;
+    }
+    CDC_ACM_DEV_EXIT_CRITICAL(cdc_dev);
+
+    hist->avg_us = (hist->samples > 0) ? (uint32_t)(rtt_sum_us / hist->samples) : 0;
+    return ESP_OK;
+}
+
 esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
 {
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
@@ -936,7 +2477,7 @@ esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bm
     if (wLength > 0) {
         CDC_ACM_CHECK(data, ESP_ERR_INVALID_ARG);
     }
-    CDC_ACM_CHECK(cdc_dev->ctrl_transfer->data_buffer_size >= wLength, ESP_ERR_INVALID_SIZE);
+    CDC_ACM_CHECK(CDC_ACM_CTRL_TRANSFER_SIZE >= wLength, ESP_ERR_INVALID_SIZE);
 
     esp_err_t ret;
 
@@ -986,6 +2527,277 @@ unblock:
     return ret;
 }
 
+/**
+ * @brief Send or receive encapsulated message of the Communication Class Interface
+ *
+ * Messages of encapsulated protocols (e.g. MBIM) are larger than the CTRL transfer of the device,
+ * so a transfer of the message size is taken from the transfer pool for each request.
+ *
+ * @param[in]    cdc_dev    Pointer to CDC device
+ * @param[in]    bRequest   SEND_ENCAPSULATED_COMMAND or GET_ENCAPSULATED_RESPONSE
+ * @param[inout] data       Message
+ * @param[in]    data_len   Length of the command or size of the response buffer
+ * @param[out]   rx_len     Length of the received response, NULL for commands
+ * @param[in]    timeout_ms Timeout of the request in [ms]
+ * @return esp_err_t
+ */
+/**
+ * @brief Callback of encapsulated command transfer
+ *
+ * The context is the completion semaphore, the callback takes it from the transfer and gives it.
+ * If the caller gave up waiting, the context is NULL and the transfer is owned by this callback, so it is freed here.
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void encapsulated_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "encapsulated xfer cb");
+    SemaphoreHandle_t done = (SemaphoreHandle_t)__atomic_exchange_n(&transfer->context, NULL, __ATOMIC_ACQ_REL);
+    if (done) {
+        xSemaphoreGive(done);
+    } else {
+        USB_HOST_XFER_POOL_FREE(transfer);
+    }
+}
+
+static esp_err_t cdc_acm_encapsulated_request(cdc_dev_t *cdc_dev, uint8_t bRequest, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms)
+{
+    esp_err_t ret;
+    const bool in_transfer = (bRequest == USB_CDC_REQ_GET_ENCAPSULATED_RESPONSE);
+    usb_transfer_t *xfer = NULL;
+
+    // IN data stage may end with a full packet, round the buffer up to the largest EP0 MPS
+    const size_t buf_len = sizeof(usb_setup_packet_t) + (in_transfer ? ((data_len + 63) / 64) * 64 : data_len);
+    ESP_RETURN_ON_ERROR(USB_HOST_XFER_POOL_ALLOC(buf_len, 0, &xfer), TAG,);
+    usb_setup_packet_t *req = (usb_setup_packet_t *)(xfer->data_buffer);
+    req->bmRequestType = USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE |
+                         (in_transfer ? USB_BM_REQUEST_TYPE_DIR_IN : USB_BM_REQUEST_TYPE_DIR_OUT);
+    req->bRequest = bRequest;
+    req->wValue = 0;
+    req->wIndex = cdc_dev->notif.intf_desc->bInterfaceNumber;
+    req->wLength = (uint16_t)data_len;
+    if (!in_transfer) {
+        memcpy(xfer->data_buffer + sizeof(usb_setup_packet_t), data, data_len);
+    }
+    xfer->num_bytes = sizeof(usb_setup_packet_t) + data_len;
+    xfer->timeout_ms = timeout_ms;
+    xfer->bEndpointAddress = 0;
+    xfer->device_handle = cdc_dev->dev_hdl;
+    xfer->callback = encapsulated_xfer_cb;
+
+    // Completion semaphore of the CTRL transfer is reused, it is given only while the CTRL mutex is taken
+    if (xSemaphoreTake(cdc_dev->ctrl_mux, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS)) != pdTRUE) {
+        ret = ESP_ERR_TIMEOUT;
+        goto free_xfer;
+    }
+    SemaphoreHandle_t done = (SemaphoreHandle_t)cdc_dev->ctrl_transfer->context;
+    xfer->context = done;
+    ESP_GOTO_ON_ERROR(
+        usb_host_transfer_submit_control(p_cdc_acm_obj->cdc_acm_client_hdl, xfer),
+        unblock, TAG, "CTRL transfer failed");
+
+    if (xSemaphoreTake(done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        // Transfer was not finished, error in USB LIB. Reset the endpoint and wait for the canceled transfer
+        cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, xfer);
+        if (xSemaphoreTake(done, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS)) != pdTRUE) {
+            if (__atomic_exchange_n(&xfer->context, NULL, __ATOMIC_ACQ_REL) != NULL) {
+                // The transfer is still in flight, its callback frees it and does not give the semaphore
+                xSemaphoreGive(cdc_dev->ctrl_mux);
+                ESP_LOGW(TAG, "CTRL transfer not returned");
+                return ESP_ERR_TIMEOUT;
+            }
+            // The callback took the context just now and is giving the semaphore, consume it for the next CTRL transfer
+            xSemaphoreTake(done, portMAX_DELAY);
+        }
+        ret = ESP_ERR_TIMEOUT;
+        goto unblock;
+    }
+
+    ESP_GOTO_ON_FALSE(xfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Control transfer error");
+    if (in_transfer) {
+        // Responses are usually shorter than the buffer
+        ESP_GOTO_ON_FALSE(xfer->actual_num_bytes >= (int)sizeof(usb_setup_packet_t), ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
+        *rx_len = xfer->actual_num_bytes - sizeof(usb_setup_packet_t);
+        memcpy(data, xfer->data_buffer + sizeof(usb_setup_packet_t), *rx_len);
+    } else {
+        ESP_GOTO_ON_FALSE(xfer->actual_num_bytes == xfer->num_bytes, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
+    }
+    ret = ESP_OK;
+
+unblock:
+    xSemaphoreGive(cdc_dev->ctrl_mux);
+free_xfer:
+    USB_HOST_XFER_POOL_FREE(xfer);
+    return ret;
+}
+
+esp_err_t cdc_acm_host_send_encapsulated_command(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl && data && (data_len > 0), ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(data_len <= UINT16_MAX, ESP_ERR_INVALID_SIZE);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(cdc_dev->notif.intf_desc, ESP_ERR_NOT_SUPPORTED);
+    return cdc_acm_encapsulated_request(cdc_dev, USB_CDC_REQ_SEND_ENCAPSULATED_COMMAND, (uint8_t *)data, data_len, NULL, timeout_ms);
+}
+
+esp_err_t cdc_acm_host_get_encapsulated_response(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms)
+{
+    CDC_ACM_CHECK(cdc_hdl && data && (data_len > 0) && rx_len, ESP_ERR_INVALID_ARG);
+    CDC_ACM_CHECK(data_len <= UINT16_MAX, ESP_ERR_INVALID_SIZE);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(cdc_dev->notif.intf_desc, ESP_ERR_NOT_SUPPORTED);
+    *rx_len = 0;
+    return cdc_acm_encapsulated_request(cdc_dev, USB_CDC_REQ_GET_ENCAPSULATED_RESPONSE, data, data_len, rx_len, timeout_ms);
+}
+
+// Context shared by all control transfers of one cdc_acm_host_send_custom_requests() call
+// It is allocated on heap: after a timeout, the caller returns and the last finished transfer frees the batch
+typedef struct {
+    SemaphoreHandle_t done;   // Given when all submitted transfers of the batch finished
+    size_t refs;              // Submitted transfers that did not finish yet + 1 for the caller
+    size_t xfer_cnt;          // Number of transfers in the batch
+    usb_transfer_t *xfers[];  // Transfers of the batch, one per request
+} cdc_acm_ctrl_batch_t;
+
+/**
+ * @brief Free batch of control transfers
+ *
+ * @param[in] batch Batch whose transfers are not in flight
+ */
+static void ctrl_batch_free(cdc_acm_ctrl_batch_t *batch)
+{
+    for (size_t i = 0; i < batch->xfer_cnt; i++) {
+        USB_HOST_XFER_POOL_FREE(batch->xfers[i]);
+    }
+    if (batch->done) {
+        vSemaphoreDelete(batch->done);
+    }
+    free(batch);
+}
+
+/**
+ * @brief Drop one reference of the batch
+ *
+ * @param[in] batch Batch of control transfers
+ * @param[in] cnt   Number of references to drop
+ * @return Number of remaining references, the batch is freed at 0
+ */
+static size_t ctrl_batch_release(cdc_acm_ctrl_batch_t *batch, size_t cnt)
+{
+    const size_t refs = __atomic_sub_fetch(&batch->refs, cnt, __ATOMIC_ACQ_REL);
+    if (refs == 0) {
+        ctrl_batch_free(batch);
+    }
+    return refs;
+}
+
+/**
+ * @brief Batched control transfer callback
+ *
+ * @param[in] transfer Transfer that triggered the callback
+ */
+static void ctrl_batch_xfer_cb(usb_transfer_t *transfer)
+{
+    ESP_LOGD(TAG, "ctrl batch xfer cb");
+    cdc_acm_ctrl_batch_t *batch = (cdc_acm_ctrl_batch_t *)transfer->context;
+    SemaphoreHandle_t done = batch->done;
+    // Only the caller's reference is left: all transfers finished. At 0, the caller gave up and the batch is freed
+    if (ctrl_batch_release(batch, 1) == 1) {
+        xSemaphoreGive(done);
+    }
+}
+
+esp_err_t cdc_acm_host_send_custom_requests(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_ctrl_request_t *requests, size_t request_cnt)
+{
+    CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
+    cdc_dev_t *cdc_dev = (cdc_dev_t *)cdc_hdl;
+    CDC_ACM_CHECK(requests && (request_cnt > 0), ESP_ERR_INVALID_ARG);
+    for (size_t i = 0; i < request_cnt; i++) {
+        if (requests[i].wLength > 0) {
+            CDC_ACM_CHECK(requests[i].data, ESP_ERR_INVALID_ARG);
+        }
+        CDC_ACM_CHECK(CDC_ACM_CTRL_TRANSFER_SIZE >= requests[i].wLength, ESP_ERR_INVALID_SIZE);
+    }
+
+    esp_err_t ret = ESP_OK;
+    cdc_acm_ctrl_batch_t *batch = calloc(1, sizeof(cdc_acm_ctrl_batch_t) + request_cnt * sizeof(usb_transfer_t *));
+    CDC_ACM_CHECK(batch, ESP_ERR_NO_MEM);
+    batch->xfer_cnt = request_cnt;
+    batch->refs = 1;
+    batch->done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(batch->done, ESP_ERR_NO_MEM, free_batch, TAG,);
+
+    // Prepare all transfers before taking the CTRL mutex
+    for (size_t i = 0; i < request_cnt; i++) {
+        const cdc_acm_ctrl_request_t *r = &requests[i];
+        ESP_GOTO_ON_ERROR(USB_HOST_XFER_POOL_ALLOC(sizeof(usb_setup_packet_t) + r->wLength, 0, &batch->xfers[i]), free_batch, TAG,);
+        usb_transfer_t *xfer = batch->xfers[i];
+        usb_setup_packet_t *req = (usb_setup_packet_t *)(xfer->data_buffer);
+        req->bmRequestType = r->bmRequestType;
+        req->bRequest = r->bRequest;
+        req->wValue = r->wValue;
+        req->wIndex = r->wIndex;
+        req->wLength = r->wLength;
+        if (!(r->bmRequestType & USB_BM_REQUEST_TYPE_DIR_IN)) {
+            memcpy(xfer->data_buffer + sizeof(usb_setup_packet_t), r->data, r->wLength);
+        }
+        xfer->num_bytes = sizeof(usb_setup_packet_t) + r->wLength;
+        xfer->timeout_ms = CDC_ACM_CTRL_TIMEOUT_MS;
+        xfer->bEndpointAddress = 0;
+        xfer->device_handle = cdc_dev->dev_hdl;
+        xfer->callback = ctrl_batch_xfer_cb;
+        xfer->context = batch;
+    }
+
+    // Take Mutex and submit all requests back-to-back
+    if (xSemaphoreTake(cdc_dev->ctrl_mux, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS)) != pdTRUE) {
+        ret = ESP_ERR_TIMEOUT;
+        goto free_batch;
+    }
+    // All transfers are counted before the first submission, so that the first callback cannot see the caller's reference only
+    __atomic_add_fetch(&batch->refs, request_cnt, __ATOMIC_ACQ_REL);
+    size_t submitted = 0;
+    for (; submitted < request_cnt; submitted++) {
+        ret = usb_host_transfer_submit_control(p_cdc_acm_obj->cdc_acm_client_hdl, batch->xfers[submitted]);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "CTRL transfer failed");
+            break;
+        }
+    }
+
+    // Transfers that were not submitted will never finish
+    const bool all_finished = (ctrl_batch_release(batch, request_cnt - submitted) == 1);
+
+    if (!all_finished && xSemaphoreTake(batch->done, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS)) != pdTRUE) {
+        // Transfers were not finished, error in USB LIB. Reset the endpoint and wait for canceled transfers
+        cdc_acm_reset_transfer_endpoint(cdc_dev->dev_hdl, batch->xfers[0]);
+        if (xSemaphoreTake(batch->done, pdMS_TO_TICKS(CDC_ACM_CTRL_TIMEOUT_MS)) != pdTRUE) {
+            // The transfers are still in flight, the last one frees the batch
+            xSemaphoreGive(cdc_dev->ctrl_mux);
+            ESP_LOGW(TAG, "CTRL transfers not returned");
+            ctrl_batch_release(batch, 1);
+            return ESP_ERR_TIMEOUT;
+        }
+        ret = ESP_ERR_TIMEOUT;
+    }
+    xSemaphoreGive(cdc_dev->ctrl_mux);
+
+    // Check results of submitted transfers and transfer data ownership to user for IN requests
+    for (size_t i = 0; (ret == ESP_OK) && (i < submitted); i++) {
+        const usb_transfer_t *xfer = batch->xfers[i];
+        ESP_GOTO_ON_FALSE(xfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, free_batch, TAG, "Control transfer error");
+        ESP_GOTO_ON_FALSE(xfer->actual_num_bytes == xfer->num_bytes, ESP_ERR_INVALID_RESPONSE, free_batch, TAG, "Incorrect number of bytes transferred");
+        if (requests[i].bmRequestType & USB_BM_REQUEST_TYPE_DIR_IN) {
+            memcpy(requests[i].data, xfer->data_buffer + sizeof(usb_setup_packet_t), requests[i].wLength);
+        }
+    }
+
+free_batch:
+    // No transfer is in flight anymore, only the caller's reference is left
+    ctrl_batch_free(batch);
+    return ret;
+}
+
 esp_err_t cdc_acm_host_protocols_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_comm_protocol_t *comm, cdc_data_protocol_t *data)
 {
     CDC_ACM_CHECK(cdc_hdl, ESP_ERR_INVALID_ARG);
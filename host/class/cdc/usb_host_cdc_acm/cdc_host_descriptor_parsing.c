@@ -23,6 +23,35 @@
 
 static const char *TAG = "cdc_acm_parsing";
 
+// Parsed interface layouts are cached, so reopening the same interface does not walk the whole Configuration descriptor again
+#define CDC_PARSE_CACHE_SIZE       4
+
+/**
+ * @brief Cached layout of one parsed CDC interface
+ *
+ * Offsets are relative to the beginning of the Configuration descriptor, so the entry can be used
+ * for any instance of the same device. Offset 0 means that the descriptor is not present.
+ */
+typedef struct {
+    bool valid;
+    uint16_t vid;
+    uint16_t pid;
+    uint8_t bConfigurationValue;
+    uint16_t wTotalLength;
+    uint8_t intf_idx;
+    uint16_t notif_ep;
+    uint16_t in_ep;
+    uint16_t out_ep;
+    uint16_t notif_intf;
+    uint16_t data_intf;
+    uint16_t func;                // Offset of the first Functional descriptor, the others follow it
+    int func_cnt;
+} cdc_parse_cache_entry_t;
+
+// Accessed only from cdc_acm_host_open(), which is serialized by the driver's open/close mutex
+static cdc_parse_cache_entry_t s_parse_cache[CDC_PARSE_CACHE_SIZE];
+static int s_parse_cache_next = 0;
+
 /**
  * @brief Searches interface by index and verifies its CDC-compliance
  *
@@ -110,7 +139,12 @@ static cdc_func_array_t *cdc_parse_functional_descriptors(const usb_intf_desc_t
     return func_desc;
 }
 
-esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx, cdc_parsed_info_t *info_ret)
+/**
+ * @brief Parse CDC interface descriptor without the cache
+ *
+ * @see cdc_parse_interface_descriptor()
+ */
+static esp_err_t cdc_parse_interface_descriptor_uncached(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx, cdc_parsed_info_t *info_ret)
 {
     int desc_offset = 0;
 
@@ -177,6 +211,117 @@ esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, c
     return (info_ret->in_ep && info_ret->out_ep) ? ESP_OK : ESP_ERR_NOT_FOUND;
 }
 
+/**
+ * @brief Get offset of a descriptor in Configuration descriptor
+ *
+ * @return Offset in bytes, 0 if desc is NULL
+ */
+static uint16_t cdc_parse_offset(const usb_config_desc_t *config_desc, const void *desc)
+{
+    return desc ? (uint16_t)((const uint8_t *)desc - (const uint8_t *)config_desc) : 0;
+}
+
+/**
+ * @brief Get descriptor from its offset and check its type
+ *
+ * @param[out] ok Set to false if the descriptor has unexpected type
+ * @return Pointer to descriptor, NULL if offset is 0
+ */
+static const void *cdc_parse_from_offset(const usb_config_desc_t *config_desc, uint16_t offset, uint8_t desc_type, bool *ok)
+{
+    if (offset == 0) {
+        return NULL;
+    }
+    const usb_standard_desc_t *desc = (const usb_standard_desc_t *)((const uint8_t *)config_desc + offset);
+    if (offset >= config_desc->wTotalLength || desc->bDescriptorType != desc_type) {
+        *ok = false;
+    }
+    return desc;
+}
+
+/**
+ * @brief Restore parsed information from cache entry
+ *
+ * @return true  Parsed information restored
+ * @return false Cached layout does not match the Configuration descriptor or out of memory
+ */
+static bool cdc_parse_cache_restore(const cdc_parse_cache_entry_t *entry, const usb_config_desc_t *config_desc, cdc_parsed_info_t *info_ret)
+{
+    bool ok = true;
+    memset(info_ret, 0, sizeof(cdc_parsed_info_t));
+    info_ret->notif_ep = cdc_parse_from_offset(config_desc, entry->notif_ep, USB_B_DESCRIPTOR_TYPE_ENDPOINT, &ok);
+    info_ret->in_ep = cdc_parse_from_offset(config_desc, entry->in_ep, USB_B_DESCRIPTOR_TYPE_ENDPOINT, &ok);
+    info_ret->out_ep = cdc_parse_from_offset(config_desc, entry->out_ep, USB_B_DESCRIPTOR_TYPE_ENDPOINT, &ok);
+    info_ret->notif_intf = cdc_parse_from_offset(config_desc, entry->notif_intf, USB_B_DESCRIPTOR_TYPE_INTERFACE, &ok);
+    info_ret->data_intf = cdc_parse_from_offset(config_desc, entry->data_intf, USB_B_DESCRIPTOR_TYPE_INTERFACE, &ok);
+    const usb_standard_desc_t *cdc_desc = cdc_parse_from_offset(config_desc, entry->func, (USB_CLASS_COMM << 4) | USB_B_DESCRIPTOR_TYPE_INTERFACE, &ok);
+    if (!ok || !info_ret->in_ep || !info_ret->out_ep ||
+            !USB_EP_DESC_GET_EP_DIR(info_ret->in_ep) || USB_EP_DESC_GET_EP_DIR(info_ret->out_ep) ||
+            USB_EP_DESC_GET_XFERTYPE(info_ret->in_ep) != USB_TRANSFER_TYPE_BULK ||
+            USB_EP_DESC_GET_XFERTYPE(info_ret->out_ep) != USB_TRANSFER_TYPE_BULK ||
+            (info_ret->notif_ep && USB_EP_DESC_GET_XFERTYPE(info_ret->notif_ep) != USB_TRANSFER_TYPE_INTR)) {
+        return false;
+    }
+
+    if (cdc_desc) {
+        // Functional descriptors follow each other, no need to search for them
+        cdc_func_array_t *func_desc = malloc(entry->func_cnt * (sizeof(usb_standard_desc_t *)));
+        if (!func_desc) {
+            return false;
+        }
+        for (int i = 0; i < entry->func_cnt; i++) {
+            (*func_desc)[i] = cdc_desc;
+            cdc_desc = (const usb_standard_desc_t *)((const uint8_t *)cdc_desc + cdc_desc->bLength);
+        }
+        info_ret->func = func_desc;
+        info_ret->func_cnt = entry->func_cnt;
+    }
+    return true;
+}
+
+esp_err_t cdc_parse_interface_descriptor(const usb_device_desc_t *device_desc, const usb_config_desc_t *config_desc, uint8_t intf_idx, cdc_parsed_info_t *info_ret)
+{
+    // Try the cache first
+    for (int i = 0; i < CDC_PARSE_CACHE_SIZE; i++) {
+        cdc_parse_cache_entry_t *entry = &s_parse_cache[i];
+        if (entry->valid &&
+                entry->vid == device_desc->idVendor &&
+                entry->pid == device_desc->idProduct &&
+                entry->bConfigurationValue == config_desc->bConfigurationValue &&
+                entry->wTotalLength == config_desc->wTotalLength &&
+                entry->intf_idx == intf_idx) {
+            if (cdc_parse_cache_restore(entry, config_desc, info_ret)) {
+                ESP_LOGD(TAG, "Interface %d layout found in cache", intf_idx);
+                return ESP_OK;
+            }
+            entry->valid = false; // Stale entry, parse the descriptor again
+            break;
+        }
+    }
+
+    ESP_RETURN_ON_ERROR(cdc_parse_interface_descriptor_uncached(device_desc, config_desc, intf_idx, info_ret), TAG,);
+
+    // Save the parsed layout, replacing the oldest entry
+    cdc_parse_cache_entry_t *entry = &s_parse_cache[s_parse_cache_next];
+    s_parse_cache_next = (s_parse_cache_next + 1) % CDC_PARSE_CACHE_SIZE;
+    *entry = (cdc_parse_cache_entry_t) {
+        .valid = true,
+        .vid = device_desc->idVendor,
+        .pid = device_desc->idProduct,
+        .bConfigurationValue = config_desc->bConfigurationValue,
+        .wTotalLength = config_desc->wTotalLength,
+        .intf_idx = intf_idx,
+        .notif_ep = cdc_parse_offset(config_desc, info_ret->notif_ep),
+        .in_ep = cdc_parse_offset(config_desc, info_ret->in_ep),
+        .out_ep = cdc_parse_offset(config_desc, info_ret->out_ep),
+        .notif_intf = cdc_parse_offset(config_desc, info_ret->notif_intf),
+        .data_intf = cdc_parse_offset(config_desc, info_ret->data_intf),
+        .func = info_ret->func ? cdc_parse_offset(config_desc, (*info_ret->func)[0]) : 0,
+        .func_cnt = info_ret->func ? info_ret->func_cnt : 0,
+    };
+    return ESP_OK;
+}
+
 void cdc_print_desc(const usb_standard_desc_t *_desc)
 {
     if (_desc->bDescriptorType != ((USB_CLASS_COMM << 4) | USB_B_DESCRIPTOR_TYPE_INTERFACE )) {
@@ -0,0 +1,177 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_check.h"
+#include "cdc_host_rx_framing.h"
+
+static const char *TAG = "cdc_rx_framing";
+
+// SLIP special characters, RFC 1055
+#define SLIP_END     (0xC0)
+#define SLIP_ESC     (0xDB)
+#define SLIP_ESC_END (0xDC)
+#define SLIP_ESC_ESC (0xDD)
+
+#define COBS_BLOCK_MAX (0xFF) // COBS code of a block that is not followed by a zero byte
+
+static uint8_t slip_unescape(uint8_t c)
+{
+    switch (c) {
+    case SLIP_ESC_END: return SLIP_END;
+    case SLIP_ESC_ESC: return SLIP_ESC;
+    default: return c; // Protocol violation, RFC 1055 keeps the byte
+    }
+}
+
+static size_t slip_decode(cdc_rx_framing_t *framing, uint8_t *data, size_t len)
+{
+    uint8_t *p = data;
+    uint8_t *const end = data + len;
+    uint8_t *out = data;
+    if (framing->slip_escape && p < end) {
+        *out++ = slip_unescape(*p++);
+        framing->slip_escape = false;
+    }
+    while (p < end) {
+        uint8_t *esc = memchr(p, SLIP_ESC, end - p);
+        const size_t run = (esc ? esc : end) - p;
+        if (out != p) {
+            memmove(out, p, run);
+        }
+        out += run;
+        p += run;
+        if (p == end) {
+            break;
+        }
+        if (++p == end) {
+            framing->slip_escape = true; // The escaped byte is in the next buffer
+            break;
+        }
+        *out++ = slip_unescape(*p++);
+    }
+    return out - data;
+}
+
+static size_t cobs_decode(cdc_rx_framing_t *framing, uint8_t *data, size_t len)
+{
+    uint8_t *p = data;
+    uint8_t *const end = data + len;
+    uint8_t *out = data; // Never ahead of p, every block starts with its code byte
+    while (p < end) {
+        if (framing->cobs_left == 0) {
+            const uint8_t code = *p++;
+            if (framing->cobs_zero) {
+                *out++ = 0;
+            }
+            framing->cobs_left = code - 1;
+            framing->cobs_zero = (code != COBS_BLOCK_MAX);
+        } else {
+            const size_t avail = end - p;
+            const size_t run = (framing->cobs_left < avail) ? framing->cobs_left : avail;
+            if (out != p) {
+                memmove(out, p, run);
+            }
+            out += run;
+            p += run;
+            framing->cobs_left -= run;
+        }
+    }
+    return out - data;
+}
+
+// Decode data of a frame without the delimiter in place, return decoded length
+static size_t rx_framing_decode(cdc_rx_framing_t *framing, uint8_t *data, size_t len)
+{
+    switch (framing->mode) {
+    case CDC_ACM_RX_FRAMING_SLIP: return slip_decode(framing, data, len);
+    case CDC_ACM_RX_FRAMING_COBS: return cobs_decode(framing, data, len);
+    default: return len;
+    }
+}
+
+// Check that the decoder is not inside of an escape sequence or block at the end of frame and reset it for the next frame
+static bool rx_framing_frame_end(cdc_rx_framing_t *framing)
+{
+    const bool valid = !framing->slip_escape && framing->cobs_left == 0;
+    framing->slip_escape = false;
+    framing->cobs_left = 0;
+    framing->cobs_zero = false; // Zero byte behind the last block is not part of the frame
+    return valid;
+}
+
+esp_err_t cdc_rx_framing_init(cdc_rx_framing_t *framing, cdc_acm_rx_framing_t mode, uint8_t delimiter, size_t max_frame_size)
+{
+    ESP_RETURN_ON_FALSE(mode == CDC_ACM_RX_FRAMING_DELIMITER || mode == CDC_ACM_RX_FRAMING_SLIP || mode == CDC_ACM_RX_FRAMING_COBS,
+                        ESP_ERR_INVALID_ARG, TAG, "Unknown RX framing mode %d", (int)mode);
+    ESP_RETURN_ON_FALSE(max_frame_size > 0, ESP_ERR_INVALID_ARG, TAG, "Zero maximum frame size");
+    memset(framing, 0, sizeof(cdc_rx_framing_t));
+    framing->buf = malloc(max_frame_size);
+    ESP_RETURN_ON_FALSE(framing->buf, ESP_ERR_NO_MEM, TAG,);
+    framing->mode = mode;
+    framing->buf_size = max_frame_size;
+    switch (mode) {
+    case CDC_ACM_RX_FRAMING_SLIP: framing->delimiter = SLIP_END; break;
+    case CDC_ACM_RX_FRAMING_COBS: framing->delimiter = 0; break;
+    default: framing->delimiter = delimiter; break;
+    }
+    return ESP_OK;
+}
+
+void cdc_rx_framing_deinit(cdc_rx_framing_t *framing)
+{
+    free(framing->buf);
+    framing->buf = NULL;
+}
+
+size_t cdc_rx_framing_process(cdc_rx_framing_t *framing, uint8_t *data, size_t len, cdc_rx_frame_cb_t cb, void *arg)
+{
+    size_t dropped = 0;
+    uint8_t *p = data;
+    uint8_t *const end = data + len;
+    while (p < end) {
+        uint8_t *delim = memchr(p, framing->delimiter, end - p);
+        const bool complete = (delim != NULL);
+        uint8_t *raw_end = complete ? delim : end;
+        if (complete && framing->mode == CDC_ACM_RX_FRAMING_DELIMITER) {
+            raw_end++; // The delimiter is passed with the frame
+        }
+        uint8_t *frame = p;
+        size_t frame_len = rx_framing_decode(framing, p, raw_end - p);
+
+        if (framing->partial || !complete) {
+            // Frame split over several buffers is collected in the frame buffer
+            if (!framing->overrun) {
+                if (framing->buf_len + frame_len <= framing->buf_size) {
+                    memcpy(framing->buf + framing->buf_len, p, frame_len);
+                    framing->buf_len += frame_len;
+                } else {
+                    framing->overrun = true;
+                }
+            }
+            frame = framing->buf;
+            frame_len = framing->buf_len;
+            framing->partial = true;
+        }
+
+        if (!complete) {
+            break;
+        }
+        const bool valid = rx_framing_frame_end(framing);
+        if (framing->overrun || frame_len > framing->buf_size || !valid) {
+            dropped++;
+        } else if (frame_len > 0) {
+            // Empty SLIP and COBS frames only separate frames
+            cb(frame, frame_len, arg);
+        }
+        framing->buf_len = 0;
+        framing->partial = false;
+        framing->overrun = false;
+        p = delim + 1;
+    }
+    return dropped;
+}
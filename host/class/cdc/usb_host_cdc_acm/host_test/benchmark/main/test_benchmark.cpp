@@ -0,0 +1,227 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "esp_private/cdc_host_common.h"
+#include "mock_add_usb_device.h"
+#include "common_test_fixtures.hpp"
+#include "usb_bench.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+// CP210x is used for all benchmarks, it is the only mocked device
+#define BENCH_DEV_ADDR          0
+#define BENCH_DEV_VID           0x10C4
+#define BENCH_DEV_PID           0xEA60
+#define BENCH_DEV_INTF          0
+#define BENCH_EP_IN             0x82
+#define BENCH_EP_OUT            0x02
+#define BENCH_EP_MPS            64
+#define BENCH_TRANSFERS_NUM     2000   // Number of transfers in one benchmark run
+
+/**
+ * @brief Simulated Full Speed link
+ *
+ * Submitted transfers are completed by the bus model of usb_bench.hpp, in FIFO order per endpoint, like on a real bus.
+ * OUT transfers can be completed immediately during submission, which is needed for blocking TX in a single task.
+ */
+static usb_bench::bus *link_bus;
+static usb_bench::callback_timer link_timer;
+static bool link_queue_out = false;
+
+static esp_err_t link_submit_cb(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    const bool is_in = transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK;
+    if (is_in || link_queue_out) {
+        link_bus->submit(transfer);
+    } else {
+        transfer->actual_num_bytes = transfer->num_bytes;
+        transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+        link_timer.measure([transfer] { transfer->callback(transfer); });
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Simulate the bus until the number of transfers completed
+ *
+ * @param[in] cnt Number of transfers to complete
+ * @return Number of completed transfers, less than cnt if no transfer is in flight
+ */
+static size_t link_pump(size_t cnt)
+{
+    size_t done = 0;
+    while (done < cnt && (link_bus->in_flight(BENCH_EP_IN) || link_bus->in_flight(BENCH_EP_OUT))) {
+        done += link_bus->tick(link_timer);
+    }
+    return done;
+}
+
+static bool bench_rx_cb(const uint8_t *data, size_t data_len, void *user_arg)
+{
+    *static_cast<size_t *>(user_arg) += data_len;
+    return true;
+}
+
+static void bench_tx_done(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg)
+{
+    if (status == ESP_OK) {
+        (*static_cast<size_t *>(user_arg))++;
+    }
+}
+
+/**
+ * @brief Print result: host time per transfer callback and throughput of the simulated bus
+ */
+static void bench_report(const char *name, size_t buf_size, int xfer_cnt, uint32_t rate_hz, size_t bytes)
+{
+    const uint64_t bus_us = link_bus->now_us();
+    usb_bench::report("cdc", name)
+    .value("buf_size", buf_size)
+    .value("xfers", xfer_cnt)
+    .value("rate_hz", rate_hz)
+    .value("bytes", bytes)
+    .value("bus_mbps", bus_us ? (double)bytes / bus_us : 0.0)
+    .timer(link_timer)
+    .print();
+}
+
+/**
+ * @brief Open mocked CDC device and route all transfer submissions to the simulated link
+ *
+ * @param[in] dev_config CDC device configuration
+ * @param[in] rate_hz    Completions of IN transfers per second at most, 0 for the rate of the bus
+ */
+static cdc_acm_dev_hdl_t bench_open(const cdc_acm_host_device_config_t *dev_config, uint32_t rate_hz)
+{
+    cdc_acm_dev_hdl_t dev = nullptr;
+    REQUIRE(ESP_OK == test_cdc_acm_host_open(BENCH_DEV_ADDR, BENCH_DEV_VID, BENCH_DEV_PID, BENCH_DEV_INTF, dev_config, &dev));
+    REQUIRE(dev != nullptr);
+
+    link_bus = new usb_bench::bus(USB_SPEED_FULL);
+    link_bus->endpoint_add(BENCH_EP_IN, usb_bench::ep_type::bulk, BENCH_EP_MPS, 1, rate_hz);
+    link_bus->endpoint_add(BENCH_EP_OUT, usb_bench::ep_type::bulk, BENCH_EP_MPS);
+    link_timer.reset();
+    link_queue_out = false;
+
+    // IN transfers were submitted during opening, before the link was connected. Put them to the link now
+    const cdc_dev_t *cdc_dev = (const cdc_dev_t *)dev;
+    for (int i = 0; i < cdc_dev->data.in_xfer_num; i++) {
+        link_bus->submit(cdc_dev->data.in_xfer[i]);
+    }
+    usb_host_transfer_submit_Stub(link_submit_cb);
+    return dev;
+}
+
+static void bench_close(cdc_acm_dev_hdl_t dev)
+{
+    // Transfers still in the link are canceled by endpoint reset in real USB Host stack, here we just drop them
+    link_bus->flush(BENCH_EP_IN, USB_TRANSFER_STATUS_COMPLETED);
+    link_bus->flush(BENCH_EP_OUT, USB_TRANSFER_STATUS_COMPLETED);
+    usb_host_transfer_submit_Stub(nullptr);
+    REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, BENCH_DEV_INTF));
+    delete link_bus;
+    link_bus = nullptr;
+}
+
+TEST_CASE("CDC-ACM throughput benchmark", "[benchmark]")
+{
+    usb_host_mock_dev_list_init();
+    REQUIRE(ESP_OK == usb_host_mock_add_device(BENCH_DEV_ADDR, (const usb_device_desc_t *)cp210x_device_desc,
+            (const usb_config_desc_t *)cp210x_config_desc));
+    REQUIRE(ESP_OK == test_cdc_acm_host_install(nullptr));
+
+    const size_t buf_size = GENERATE(64, 512, 4096);
+    const int xfer_cnt = GENERATE(1, 2, 4);
+
+    SECTION("BULK IN") {
+        // Device sends as fast as the bus allows, or slower
+        const uint32_t rate_hz = GENERATE(0, 250);
+        size_t rx_bytes = 0;
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1000,
+            .out_buffer_size = 64,
+            .in_buffer_size = buf_size,
+            .event_cb = nullptr,
+            .data_cb = bench_rx_cb,
+            .user_arg = &rx_bytes,
+            .in_xfer_count = (uint8_t)xfer_cnt,
+        };
+        cdc_acm_dev_hdl_t dev = bench_open(&dev_config, rate_hz);
+
+        REQUIRE(BENCH_TRANSFERS_NUM == link_pump(BENCH_TRANSFERS_NUM));
+
+        REQUIRE(rx_bytes == BENCH_TRANSFERS_NUM * buf_size);
+        bench_report("bulk_in", buf_size, xfer_cnt, rate_hz, rx_bytes);
+        bench_close(dev);
+    }
+
+    SECTION("BULK OUT blocking") {
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1000,
+            .out_buffer_size = buf_size,
+            .in_buffer_size = 64,
+            .event_cb = nullptr,
+            .data_cb = nullptr,
+            .user_arg = nullptr,
+        };
+        cdc_acm_dev_hdl_t dev = bench_open(&dev_config, 0);
+        const std::vector<uint8_t> tx_buf(buf_size, 0x55);
+
+        // Completed during submission, the bus does not advance
+        for (int i = 0; i < BENCH_TRANSFERS_NUM; i++) {
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_blocking(dev, tx_buf.data(), tx_buf.size(), 100));
+        }
+
+        REQUIRE((size_t)BENCH_TRANSFERS_NUM == link_timer.count());
+        bench_report("bulk_out_blocking", buf_size, 1, 0, BENCH_TRANSFERS_NUM * buf_size);
+        bench_close(dev);
+    }
+
+    SECTION("BULK OUT async") {
+        const cdc_acm_host_device_config_t dev_config = {
+            .connection_timeout_ms = 1000,
+            .out_buffer_size = buf_size,
+            .in_buffer_size = 64,
+            .event_cb = nullptr,
+            .data_cb = nullptr,
+            .user_arg = nullptr,
+            .in_xfer_count = 0,
+            .out_xfer_count = (uint8_t)xfer_cnt,
+        };
+        cdc_acm_dev_hdl_t dev = bench_open(&dev_config, 0);
+        link_bus->flush(BENCH_EP_IN, USB_TRANSFER_STATUS_COMPLETED); // Do not complete IN transfers in this benchmark
+        link_queue_out = true;
+        const std::vector<uint8_t> tx_buf(buf_size, 0x55);
+        size_t tx_done = 0;
+
+        for (int i = 0; i < BENCH_TRANSFERS_NUM;) {
+            const esp_err_t ret = cdc_acm_host_data_tx_async(dev, tx_buf.data(), tx_buf.size(), bench_tx_done, &tx_done, 0);
+            if (ret == ESP_OK) {
+                i++;
+            } else {
+                // The pool is exhausted, the link must complete the oldest transfer
+                REQUIRE(ESP_ERR_TIMEOUT == ret);
+                REQUIRE(1 == link_pump(1));
+            }
+        }
+        link_pump(xfer_cnt);
+
+        REQUIRE(tx_done == BENCH_TRANSFERS_NUM);
+        bench_report("bulk_out_async", buf_size, xfer_cnt, 0, BENCH_TRANSFERS_NUM * buf_size);
+        bench_close(dev);
+    }
+
+    REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
+}
@@ -29,7 +29,9 @@ extern "C" {
 typedef struct {
     struct {
         usb_transfer_t *out_xfer;
+        int out_async_xfer_num;
         usb_transfer_t *in_xfer;
+        int in_xfer_num;
         uint8_t in_bEndpointAddress;
         uint8_t out_bEndpointAddress;
     } data;
@@ -42,6 +44,17 @@ typedef struct {
 
 static cdc_dev_expects_t *p_cdc_dev_expects = nullptr;
 
+// Client event callback of the installed driver, for delivering mocked client events
+static usb_host_client_event_cb_t p_client_event_cb = nullptr;
+static void *p_client_event_cb_arg = nullptr;
+
+static esp_err_t _test_client_register_callback(const usb_host_client_config_t *client_config, usb_host_client_handle_t *client_hdl_ret, int call_count)
+{
+    p_client_event_cb = client_config->async.client_event_callback;
+    p_client_event_cb_arg = client_config->async.callback_arg;
+    return usb_host_client_register_mock_callback(client_config, client_hdl_ret, call_count);
+}
+
 /**
  * @brief Create CMock expectations for current device
  *
@@ -89,6 +102,7 @@ static esp_err_t _test_create_cmock_expectations(uint8_t dev_address, uint8_t in
     // Check, if IN data transfer is allocated
     if (dev_config->in_buffer_size) {
         cdc_dev_expects->data.in_xfer = reinterpret_cast<usb_transfer_t *>(&data_in_xfer);
+        cdc_dev_expects->data.in_xfer_num = (dev_config->in_xfer_count == 0) ? 1 : dev_config->in_xfer_count;
     } else {
         cdc_dev_expects->data.in_xfer = nullptr;
     }
@@ -96,6 +110,7 @@ static esp_err_t _test_create_cmock_expectations(uint8_t dev_address, uint8_t in
     // Check if OUT data transfer is allocated
     if (dev_config->out_buffer_size) {
         cdc_dev_expects->data.out_xfer = reinterpret_cast<usb_transfer_t *>(&data_out_xfer);
+        cdc_dev_expects->data.out_async_xfer_num = dev_config->out_xfer_count;
     } else {
         cdc_dev_expects->data.out_xfer = nullptr;
     }
@@ -116,7 +131,7 @@ static void _test_delete_cmock_expectations(void)
 esp_err_t test_cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config)
 {
     usb_host_client_register_ExpectAnyArgsAndReturn(ESP_OK);
-    usb_host_client_register_AddCallback(usb_host_client_register_mock_callback);
+    usb_host_client_register_AddCallback(_test_client_register_callback);
 
     usb_host_client_handle_events_ExpectAnyArgsAndReturn(ESP_OK);
     usb_host_client_handle_events_AddCallback(usb_host_client_handle_events_mock_callback);
@@ -125,6 +140,14 @@ esp_err_t test_cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_c
     return cdc_acm_host_install(driver_config);
 }
 
+void test_cdc_acm_host_new_dev_event(uint8_t dev_address)
+{
+    usb_host_client_event_msg_t event_msg = {};
+    event_msg.event = USB_HOST_CLIENT_EVENT_NEW_DEV;
+    event_msg.new_dev.address = dev_address;
+    p_client_event_cb(&event_msg, p_client_event_cb_arg);
+}
+
 esp_err_t test_cdc_acm_host_uninstall(void)
 {
     usb_host_client_unblock_ExpectAnyArgsAndReturn(ESP_OK);
@@ -178,14 +201,20 @@ esp_err_t test_cdc_acm_host_open(uint8_t dev_address, uint16_t vid, uint16_t pid
         usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
     }
 
-    //  Setup IN data transfer
+    //  Setup IN data transfers, one for each transfer in the ring
+    const int in_xfer_num = (dev_config->in_xfer_count == 0) ? 1 : dev_config->in_xfer_count;
     if (dev_config->in_buffer_size) {
-        usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
+        for (int i = 0; i < in_xfer_num; i++) {
+            usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
+        }
     }
 
-    // Setup OUT bulk transfer
+    // Setup OUT bulk transfer and the asynchronous TX pool
     if (dev_config->out_buffer_size) {
         usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
+        for (int i = 0; i < dev_config->out_xfer_count; i++) {
+            usb_host_transfer_alloc_ExpectAnyArgsAndReturn(ESP_OK);
+        }
     }
 
     // Register callback
@@ -197,6 +226,13 @@ esp_err_t test_cdc_acm_host_open(uint8_t dev_address, uint16_t vid, uint16_t pid
     // Make sure that the interface_index has been claimed
     test_usb_host_interface_claim(interface_index);
 
+    // Remaining IN transfers of the ring are submitted right after the first one
+    if (dev_config->in_buffer_size) {
+        for (int i = 1; i < in_xfer_num; i++) {
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+        }
+    }
+
     // Claim 2nd interface (if supported)
     if (p_cdc_dev_expects->notif.has_separate_interface) {
         test_usb_host_interface_claim(interface_index + 1);
@@ -226,6 +262,11 @@ esp_err_t test_cdc_acm_host_close(cdc_acm_dev_hdl_t *cdc_hdl, uint8_t interface_
         test_cdc_acm_reset_transfer_endpoint(p_cdc_dev_expects->notif.bEndpointAddress);
     }
 
+    // Cancel asynchronous OUT transfers -> halt, flush, clear
+    if (p_cdc_dev_expects->data.out_async_xfer_num) {
+        test_cdc_acm_reset_transfer_endpoint(p_cdc_dev_expects->data.out_bEndpointAddress);
+    }
+
     // Release data interface
     usb_host_interface_release_ExpectAndReturn(nullptr, nullptr, interface_index, ESP_OK);
     usb_host_interface_release_IgnoreArg_client_hdl();  // Ignore all function parameters, except interface_index
@@ -238,15 +279,20 @@ esp_err_t test_cdc_acm_host_close(cdc_acm_dev_hdl_t *cdc_hdl, uint8_t interface_
         p_cdc_dev_expects->notif.xfer = nullptr;
     }
 
-    // Free in transfer
+    // Free in transfers
     if (p_cdc_dev_expects->data.in_xfer) {
-        usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        for (int i = 0; i < p_cdc_dev_expects->data.in_xfer_num; i++) {
+            usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        }
         p_cdc_dev_expects->data.in_xfer = nullptr;
     }
 
-    // Free out transfer
+    // Free out transfer and the asynchronous TX pool
     if (p_cdc_dev_expects->data.out_xfer) {
         usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        for (int i = 0; i < p_cdc_dev_expects->data.out_async_xfer_num; i++) {
+            usb_host_transfer_free_ExpectAnyArgsAndReturn(ESP_OK);
+        }
         p_cdc_dev_expects->data.out_xfer = nullptr;
     }
 
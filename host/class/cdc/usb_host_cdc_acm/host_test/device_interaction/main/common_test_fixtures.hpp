@@ -49,6 +49,15 @@ esp_err_t test_cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_c
  */
 esp_err_t test_cdc_acm_host_uninstall(void);
 
+/**
+ * @brief Host test fixture function, deliver new device event to the CDC-ACM host driver
+ *
+ * - This function calls the client event callback, which the driver registered in test_cdc_acm_host_install()
+ *
+ * @param[in] dev_address Address of the new device
+ */
+void test_cdc_acm_host_new_dev_event(uint8_t dev_address);
+
 /**
  * @brief Host test fixture function, for opening CDC-ACM device
  *
@@ -5,14 +5,20 @@
  */
 
 #include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
 #include <catch2/catch_test_macros.hpp>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "descriptors/cdc_descriptors.hpp"
 #include "usb/cdc_acm_host.h"
 #include "mock_add_usb_device.h"
 #include "common_test_fixtures.hpp"
 #include "usb_helpers.h"
 #include "cdc_host_descriptor_parsing.h"
+#include "esp_private/cdc_host_common.h"
 
 extern "C" {
 #include "Mockusb_host.h"
@@ -74,6 +80,121 @@ static void _submit_mock_transfer(cdc_acm_dev_hdl_t *dev)
     REQUIRE(ESP_ERR_TIMEOUT == test_cdc_acm_host_data_tx_blocking(*dev, tx_buf, sizeof(tx_buf), 200, MOCK_USB_TRANSFER_TIMEOUT));
 }
 
+/**
+ * @brief Asynchronous TX done callback
+ *
+ * @param[in] cdc_hdl  CDC handle
+ * @param[in] status   Transfer status
+ * @param[in] user_arg Pointer to counter of successfully finished transfers
+ */
+static void _tx_async_done(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg)
+{
+    if (status == ESP_OK) {
+        (*static_cast<int *>(user_arg))++;
+    }
+}
+
+/**
+ * @brief Asynchronous TX done callback, that keeps all statuses
+ *
+ * @param[in] cdc_hdl  CDC handle
+ * @param[in] status   Status of the whole write
+ * @param[in] user_arg Pointer to vector of reported statuses
+ */
+static void _tx_async_status(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg)
+{
+    static_cast<std::vector<esp_err_t> *>(user_arg)->push_back(status);
+}
+
+// Number of submissions that _submit_then_fail_mock_callback() lets pass, the next ones fail
+static int submit_pass_left;
+
+/**
+ * @brief Transfer submit callback, that completes submit_pass_left transfers and fails the next ones
+ */
+static esp_err_t _submit_then_fail_mock_callback(usb_transfer_t *transfer, int call_count)
+{
+    if (submit_pass_left > 0) {
+        submit_pass_left--;
+        return usb_host_transfer_submit_success_mock_callback(transfer, call_count);
+    }
+    return ESP_FAIL;
+}
+
+/**
+ * @brief Device event callback
+ *
+ * @param[in] event    Device event
+ * @param[in] user_arg Pointer to vector of reported serial states
+ */
+static void _serial_state_event_cb(const cdc_acm_host_dev_event_data_t *event, void *user_arg)
+{
+    if (event->type == CDC_ACM_HOST_SERIAL_STATE) {
+        static_cast<std::vector<uint16_t> *>(user_arg)->push_back(event->data.serial_state.val);
+    }
+}
+
+/**
+ * @brief Complete notification transfer with SERIAL_STATE notification
+ *
+ * @param[in] dev          CDC handle obtained from cdc_acm_host_open()
+ * @param[in] serial_state Serial state reported by the device
+ */
+static void _receive_serial_state(cdc_acm_dev_hdl_t dev, uint16_t serial_state)
+{
+    usb_transfer_t *transfer = ((cdc_dev_t *)dev)->notif.xfer;
+    const uint8_t notif[] = {0xA1, USB_CDC_NOTIF_SERIAL_STATE, 0, 0, 0, 0, 2, 0, (uint8_t)serial_state, (uint8_t)(serial_state >> 8)};
+    memcpy(transfer->data_buffer, notif, sizeof(notif));
+    transfer->actual_num_bytes = sizeof(notif);
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+}
+
+/**
+ * @brief Data received callback
+ *
+ * @param[in] data     Received frame
+ * @param[in] data_len Length of the frame
+ * @param[in] user_arg Pointer to vector of received frames
+ * @return true
+ */
+static bool _frame_rx_cb(const uint8_t *data, size_t data_len, void *user_arg)
+{
+    static_cast<std::vector<std::string> *>(user_arg)->emplace_back(reinterpret_cast<const char *>(data), data_len);
+    return true;
+}
+
+/**
+ * @brief Data received callback with RX timestamp
+ *
+ * @param[in] data       Received data
+ * @param[in] data_len   Length of the data
+ * @param[in] rx_time_us RX timestamp
+ * @param[in] user_arg   Pointer to vector of received timestamps
+ * @return true
+ */
+static bool _timestamped_rx_cb(const uint8_t *data, size_t data_len, int64_t rx_time_us, void *user_arg)
+{
+    static_cast<std::vector<int64_t> *>(user_arg)->push_back(rx_time_us);
+    return true;
+}
+
+/**
+ * @brief Complete BULK IN transfer with received data
+ *
+ * @param[in] dev  CDC handle obtained from cdc_acm_host_open()
+ * @param[in] data Data received from the device
+ */
+static void _receive_data(cdc_acm_dev_hdl_t dev, const char *data)
+{
+    usb_transfer_t *transfer = ((cdc_dev_t *)dev)->data.in_xfer[0];
+    const size_t len = strlen(data);
+    memcpy(transfer->data_buffer, data, len);
+    transfer->actual_num_bytes = len;
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->callback(transfer);
+}
+
 SCENARIO("Interact with mocked USB devices")
 {
     // We put the device adding to the SECTION, to run it just once, not repeatedly for all the following SECTIONs
@@ -215,6 +336,278 @@ SCENARIO("Interact with mocked USB devices")
             REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
         }
 
+        SECTION("Interact with device: CP210x with multiple IN transfers") {
+
+            // Define details of a device which will be opened
+            const uint16_t vid = 0x10C4, pid = 0xEA60;
+            const uint8_t device_address = 4, interface_index = 0;
+
+            // Keep 4 BULK IN transfers in flight
+            cdc_acm_host_device_config_t ring_dev_config = dev_config;
+            ring_dev_config.in_xfer_count = 4;
+
+            // Open a device
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &ring_dev_config, &dev));
+            REQUIRE(dev != nullptr);
+            // Device was opened without RX ring buffer
+            uint8_t rx_buf[8];
+            size_t rx_len;
+            REQUIRE(ESP_ERR_NOT_SUPPORTED == cdc_acm_host_data_rx(dev, rx_buf, sizeof(rx_buf), &rx_len, 0));
+            // Interact with the device - submit mocked transfers
+            _submit_mock_transfer(&dev);
+
+            // Close the device
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("Interact with device: CP210x with RX dispatch task") {
+
+            // Define details of a device which will be opened
+            const uint16_t vid = 0x10C4, pid = 0xEA60;
+            const uint8_t device_address = 4, interface_index = 0;
+
+            // Call data callback from a dedicated task
+            cdc_acm_host_device_config_t task_dev_config = dev_config;
+            task_dev_config.in_xfer_count = 2;
+            task_dev_config.rx_task.stack_size = 4096;
+            task_dev_config.rx_task.priority = 5;
+            task_dev_config.rx_task.xCoreID = 0;
+
+            // Open a device
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &task_dev_config, &dev));
+            REQUIRE(dev != nullptr);
+            // Interact with the device - submit mocked transfers
+            _submit_mock_transfer(&dev);
+
+            // Close the device, the RX dispatch task is stopped
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("Interact with device: CP210x with RX ring buffer") {
+
+            // Define details of a device which will be opened
+            const uint16_t vid = 0x10C4, pid = 0xEA60;
+            const uint8_t device_address = 4, interface_index = 0;
+
+            // Received data are stored in the RX ring buffer
+            cdc_acm_host_device_config_t ring_dev_config = dev_config;
+            ring_dev_config.rx_ring_size = 256;
+
+            // Open a device
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &ring_dev_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            // No data were received yet
+            uint8_t rx_buf[64];
+            size_t rx_len = 1;
+            REQUIRE(ESP_ERR_TIMEOUT == cdc_acm_host_data_rx(dev, rx_buf, sizeof(rx_buf), &rx_len, 0));
+            REQUIRE(0 == rx_len);
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_host_data_rx(dev, rx_buf, sizeof(rx_buf), nullptr, 0));
+            _submit_mock_transfer(&dev);
+
+            // Close the device
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("Interact with device: CP210x with asynchronous TX") {
+
+            // Define details of a device which will be opened
+            const uint16_t vid = 0x10C4, pid = 0xEA60;
+            const uint8_t device_address = 4, interface_index = 0;
+
+            // Allocate pool of 2 OUT transfers for asynchronous TX
+            cdc_acm_host_device_config_t async_dev_config = dev_config;
+            async_dev_config.out_xfer_count = 2;
+
+            // Open a device
+            REQUIRE(ESP_OK == test_cdc_acm_host_open(device_address, vid, pid, interface_index, &async_dev_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            // Mocked transfers finish immediately, so the transfers are returned to the pool during submission
+            const uint8_t tx_buf[] = "HELLO";
+            int tx_done = 0;
+            for (int i = 0; i < 4; i++) {
+                usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+                usb_host_transfer_submit_AddCallback(usb_host_transfer_submit_success_mock_callback);
+                REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, tx_buf, sizeof(tx_buf), _tx_async_done, &tx_done, 0));
+            }
+            REQUIRE(4 == tx_done);
+
+            // Data larger than OUT buffer are split into several transfers, callback is called once
+            const uint8_t large_buf[101] = {};
+            for (int i = 0; i < 2; i++) {
+                usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+                usb_host_transfer_submit_AddCallback(usb_host_transfer_submit_success_mock_callback);
+            }
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, large_buf, sizeof(large_buf), _tx_async_done, &tx_done, 0));
+            REQUIRE(5 == tx_done);
+
+            // Data that do not fit into the whole pool are rejected
+            const uint8_t huge_buf[1024] = {};
+            REQUIRE(ESP_ERR_INVALID_SIZE == cdc_acm_host_data_tx_async(dev, huge_buf, sizeof(huge_buf), nullptr, nullptr, 0));
+
+            // Zero-copy TX: fill a buffer lent from the pool and submit it
+            uint8_t *zc_buf = nullptr;
+            size_t zc_buf_size = 0;
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_buffer_get(dev, &zc_buf, &zc_buf_size, 0));
+            REQUIRE(zc_buf != nullptr);
+            REQUIRE(zc_buf_size >= 100);
+            REQUIRE(ESP_ERR_INVALID_SIZE == cdc_acm_host_data_tx_buffer_submit(dev, zc_buf, zc_buf_size + 1, nullptr, nullptr));
+            memcpy(zc_buf, tx_buf, sizeof(tx_buf));
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_AddCallback(usb_host_transfer_submit_success_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_buffer_submit(dev, zc_buf, sizeof(tx_buf), _tx_async_done, &tx_done));
+            REQUIRE(6 == tx_done);
+            // The buffer was returned to the pool and cannot be submitted again
+            REQUIRE(ESP_ERR_INVALID_STATE == cdc_acm_host_data_tx_buffer_submit(dev, zc_buf, sizeof(tx_buf), nullptr, nullptr));
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_host_data_tx_buffer_submit(dev, const_cast<uint8_t *>(tx_buf), sizeof(tx_buf), nullptr, nullptr));
+
+            // All successful OUT transfers are counted in device statistics
+            cdc_acm_host_stats_t stats = {};
+            REQUIRE(ESP_OK == cdc_acm_host_get_stats(dev, &stats));
+            REQUIRE(7 == stats.tx_transfers);
+            REQUIRE(4 * sizeof(tx_buf) + sizeof(large_buf) + sizeof(tx_buf) == stats.tx_bytes);
+            REQUIRE(7 == stats.xfer_status[USB_TRANSFER_STATUS_COMPLETED]);
+            REQUIRE(0 == stats.rx_transfers);
+            REQUIRE(stats.tx_latency_min_us <= stats.tx_latency_avg_us);
+            REQUIRE(stats.tx_latency_avg_us <= stats.tx_latency_max_us);
+
+            // Submission of the second transfer fails: the first one is sent, the error is returned and reported once
+            std::vector<esp_err_t> tx_status;
+            submit_pass_left = 1;
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_AddCallback(_submit_then_fail_mock_callback);
+            REQUIRE(ESP_FAIL == cdc_acm_host_data_tx_async(dev, large_buf, sizeof(large_buf), _tx_async_status, &tx_status, 0));
+            REQUIRE(tx_status == std::vector<esp_err_t> {ESP_ERR_INVALID_RESPONSE});
+
+            // Submission of the first transfer fails: nothing is sent and the callback is not called
+            submit_pass_left = 0;
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            REQUIRE(ESP_FAIL == cdc_acm_host_data_tx_async(dev, large_buf, sizeof(large_buf), _tx_async_status, &tx_status, 0));
+            REQUIRE(1 == tx_status.size());
+
+            // All transfers were returned to the pool
+            tx_status.clear();
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_AddCallback(usb_host_transfer_submit_success_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, large_buf, sizeof(large_buf), _tx_async_status, &tx_status, 0));
+            REQUIRE(tx_status == std::vector<esp_err_t> {ESP_OK});
+
+            // Blocking TX still works alongside the pool
+            _submit_mock_transfer(&dev);
+
+            // Close the device
+            REQUIRE(ESP_OK == test_cdc_acm_host_close(&dev, interface_index));
+        }
+
+        SECTION("Auto-open registration") {
+            // Opening itself happens on USB_HOST_CLIENT_EVENT_NEW_DEV, here we only check the registration bookkeeping
+            const auto opened_cb = [](cdc_acm_dev_hdl_t cdc_hdl, void *user_arg) {};
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_host_auto_open_register(0x10C4, 0xEA60, 0, nullptr, opened_cb));
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_host_auto_open_register(0x10C4, 0xEA60, 0, &dev_config, nullptr));
+            REQUIRE(ESP_OK == cdc_acm_host_auto_open_register(0x10C4, 0xEA60, 0, &dev_config, opened_cb));
+            REQUIRE(ESP_ERR_INVALID_STATE == cdc_acm_host_auto_open_register(0x10C4, 0xEA60, 0, &dev_config, opened_cb));
+            REQUIRE(ESP_OK == cdc_acm_host_auto_open_register(0x303A, 0x4001, 0, &dev_config, opened_cb));
+
+            REQUIRE(ESP_OK == cdc_acm_host_auto_open_unregister(0x10C4, 0xEA60, 0));
+            REQUIRE(ESP_ERR_NOT_FOUND == cdc_acm_host_auto_open_unregister(0x10C4, 0xEA60, 0));
+            // The remaining registration is freed during driver uninstall
+        }
+
+        SECTION("Auto-open device on connection") {
+            usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+            usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+            usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+            usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+            usb_host_device_info_Stub(usb_host_device_info_mock_callback);
+            usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+            usb_host_transfer_submit_Stub([](usb_transfer_t *transfer, int cmock_num_calls) {
+                return ESP_OK; // Transfers are not completed in this test
+            });
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+
+            struct auto_opened_t {
+                SemaphoreHandle_t opened;
+                cdc_acm_dev_hdl_t cdc_hdl;
+            };
+            auto_opened_t auto_opened = {xSemaphoreCreateBinary(), nullptr};
+            REQUIRE(auto_opened.opened != nullptr);
+            cdc_acm_host_device_config_t auto_open_config = dev_config;
+            auto_open_config.user_arg = &auto_opened;
+            const auto opened_cb = [](cdc_acm_dev_hdl_t cdc_hdl, void *user_arg) {
+                auto *opened = static_cast<auto_opened_t *>(user_arg);
+                opened->cdc_hdl = cdc_hdl;
+                xSemaphoreGive(opened->opened);
+            };
+            REQUIRE(ESP_OK == cdc_acm_host_auto_open_register(0x303A, 0x4001, 0, &auto_open_config, opened_cb));
+
+            // TinyUSB serial device is connected: the event only queues the device, it is opened by the auto-open task
+            test_cdc_acm_host_new_dev_event(5);
+            REQUIRE(pdTRUE == xSemaphoreTake(auto_opened.opened, pdMS_TO_TICKS(1000)));
+            REQUIRE(auto_opened.cdc_hdl != nullptr);
+
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_close(auto_opened.cdc_hdl));
+            usb_host_transfer_submit_Stub(nullptr);
+            vSemaphoreDelete(auto_opened.opened);
+        }
+
+        SECTION("Auto-opened device is closed from its callback") {
+            usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+            usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+            usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+            usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+            usb_host_device_info_Stub(usb_host_device_info_mock_callback);
+            usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+            usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+            usb_host_transfer_submit_Stub([](usb_transfer_t *transfer, int cmock_num_calls) {
+                return ESP_OK; // Transfers are not completed in this test
+            });
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+
+            struct auto_closed_t {
+                SemaphoreHandle_t closed;
+                esp_err_t close_ret;
+            };
+            auto_closed_t auto_closed = {xSemaphoreCreateBinary(), ESP_FAIL};
+            REQUIRE(auto_closed.closed != nullptr);
+            cdc_acm_host_device_config_t auto_open_config = dev_config;
+            auto_open_config.user_arg = &auto_closed;
+            const auto opened_cb = [](cdc_acm_dev_hdl_t cdc_hdl, void *user_arg) {
+                // The callback runs without the open/close mutex of the driver, so it can close the device
+                auto *closed = static_cast<auto_closed_t *>(user_arg);
+                closed->close_ret = cdc_acm_host_close(cdc_hdl);
+                xSemaphoreGive(closed->closed);
+            };
+            REQUIRE(ESP_OK == cdc_acm_host_auto_open_register(0x303A, 0x4001, 0, &auto_open_config, opened_cb));
+
+            test_cdc_acm_host_new_dev_event(5);
+            REQUIRE(pdTRUE == xSemaphoreTake(auto_closed.closed, pdMS_TO_TICKS(1000)));
+            REQUIRE(ESP_OK == auto_closed.close_ret);
+            usb_host_transfer_submit_Stub(nullptr);
+            vSemaphoreDelete(auto_closed.closed);
+        }
+
         SECTION("Interact with device: TinyUSB serial") {
             /*
             Purpose of this test:
@@ -250,6 +643,40 @@ SCENARIO("Interact with mocked USB devices")
             REQUIRE(ESP_OK == cdc_acm_device.set_control_line_state( false, false));
             REQUIRE(ESP_OK == cdc_acm_device.send_break(10));
 
+            // Send a batch of control requests (typical device initialization sequence)
+            uint8_t line_coding_raw[7] = {};
+            const cdc_acm_ctrl_request_t init_requests[] = {
+                {0x21, USB_CDC_REQ_SET_CONTROL_LINE_STATE, 0x0003, 0, 0, nullptr},
+                {0xA1, USB_CDC_REQ_GET_LINE_CODING, 0, 0, sizeof(line_coding_raw), line_coding_raw},
+                {0x21, USB_CDC_REQ_SET_LINE_CODING, 0, 0, sizeof(line_coding_raw), line_coding_raw},
+            };
+            usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_device.send_custom_requests(init_requests, 3));
+            const cdc_acm_ctrl_request_t missing_data_request = {0x21, USB_CDC_REQ_SET_LINE_CODING, 0, 0, 7, nullptr};
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_device.send_custom_requests(&missing_data_request, 1));
+
+            // Send a frame gathered from several segments
+            const uint8_t header[] = {0xAA, 0x55};
+            const uint8_t payload[] = "HELLO";
+            const uint8_t crc[] = {0x12, 0x34};
+            const cdc_acm_tx_segment_t segments[] = {
+                {header, sizeof(header)},
+                {nullptr, 0},
+                {payload, sizeof(payload)},
+                {crc, sizeof(crc)},
+            };
+            usb_host_transfer_submit_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_submit_AddCallback(usb_host_transfer_submit_success_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_device.tx_vectored(segments, sizeof(segments) / sizeof(segments[0])));
+
+            // Segments that do not fit into one OUT transfer are rejected
+            const uint8_t large_buf[60] = {};
+            const cdc_acm_tx_segment_t large_segments[] = {
+                {large_buf, sizeof(large_buf)},
+                {large_buf, sizeof(large_buf)},
+            };
+            REQUIRE(ESP_ERR_INVALID_SIZE == cdc_acm_device.tx_vectored(large_segments, 2));
+
             // C++ destructor is automatically called at the end of the scope
             // So we can expect that the device will be closed
             usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
@@ -264,6 +691,159 @@ SCENARIO("Interact with mocked USB devices")
             usb_host_device_close_ExpectAnyArgsAndReturn(ESP_OK);      // Close the device
         }
 
+        SECTION("Interact with device: TinyUSB serial with serial state filter") {
+            usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+            usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+            usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+            usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+            usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+            usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+            usb_host_transfer_submit_Stub([](usb_transfer_t *transfer, int cmock_num_calls) {
+                return ESP_OK; // Transfers are completed manually in this test
+            });
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+
+            std::vector<uint16_t> events;
+            cdc_acm_host_device_config_t filter_config = dev_config;
+            filter_config.event_cb = _serial_state_event_cb;
+            filter_config.user_arg = &events;
+            filter_config.serial_state_filter.suppress_unchanged = true;
+            REQUIRE(ESP_OK == cdc_acm_host_open(0x303A, 0x4001, 0, &filter_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            // Repeated serial state is reported only once
+            _receive_serial_state(dev, 0x0003);
+            _receive_serial_state(dev, 0x0003);
+            _receive_serial_state(dev, 0x0003);
+            _receive_serial_state(dev, 0x0001);
+            _receive_serial_state(dev, 0x0001);
+            const std::vector<uint16_t> expected_events = {0x0003, 0x0001};
+            REQUIRE(events == expected_events);
+
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_close(dev));
+            usb_host_transfer_submit_Stub(nullptr);
+        }
+
+        SECTION("Interact with device: TinyUSB serial with delimiter framing") {
+            usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+            usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+            usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+            usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+            usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+            usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+            usb_host_transfer_submit_Stub([](usb_transfer_t *transfer, int cmock_num_calls) {
+                return ESP_OK; // Transfers are completed manually in this test
+            });
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+
+            std::vector<std::string> frames;
+            cdc_acm_host_device_config_t framing_config = dev_config;
+            framing_config.data_cb = _frame_rx_cb;
+            framing_config.user_arg = &frames;
+            framing_config.rx_framing.mode = CDC_ACM_RX_FRAMING_DELIMITER;
+            framing_config.rx_framing.delimiter = '\n';
+            framing_config.rx_framing.max_frame_size = 16;
+            REQUIRE(ESP_OK == cdc_acm_host_open(0x303A, 0x4001, 0, &framing_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            // Lines are passed complete, regardless of transfer boundaries
+            _receive_data(dev, "\r\nOK\r\n+CS");
+            _receive_data(dev, "Q: 20,");
+            _receive_data(dev, "99\r\n");
+            // Line longer than max_frame_size is dropped and reported as overrun
+            _receive_data(dev, "+COPS: 0,0,\"Operator\"\r\nOK\r\n");
+            const std::vector<std::string> expected_frames = {"\r\n", "OK\r\n", "+CSQ: 20,99\r\n", "OK\r\n"};
+            REQUIRE(frames == expected_frames);
+            cdc_acm_host_stats_t stats;
+            REQUIRE(ESP_OK == cdc_acm_host_get_stats(dev, &stats));
+            REQUIRE(1 == stats.rx_overruns);
+
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_close(dev));
+            usb_host_transfer_submit_Stub(nullptr);
+        }
+
+        SECTION("Interact with device: TinyUSB serial with RX timestamps") {
+            usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+            usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+            usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+            usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+            usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+            usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+            usb_host_transfer_submit_Stub([](usb_transfer_t *transfer, int cmock_num_calls) {
+                return ESP_OK; // Transfers are completed manually in this test
+            });
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);
+
+            std::vector<int64_t> timestamps;
+            cdc_acm_host_device_config_t ts_config = dev_config;
+            ts_config.data_ts_cb = _timestamped_rx_cb;
+            ts_config.user_arg = &timestamps;
+            ts_config.out_xfer_count = 1;
+            REQUIRE(ESP_OK == cdc_acm_host_open(0x303A, 0x4001, 0, &ts_config, &dev));
+            REQUIRE(dev != nullptr);
+
+            // Request and its response is one round-trip sample
+            const uint8_t request[] = "?";
+            REQUIRE(ESP_OK == cdc_acm_host_data_tx_async(dev, request, sizeof(request), nullptr, nullptr, 0));
+            _receive_data(dev, "OK");
+            // Data not preceded by a request are not sampled
+            _receive_data(dev, "OK");
+            REQUIRE(2 == timestamps.size());
+            REQUIRE(timestamps[0] > 0);
+            REQUIRE(timestamps[1] >= timestamps[0]);
+
+            cdc_acm_host_rtt_hist_t hist;
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_host_get_rtt_histogram(dev, nullptr, false));
+            REQUIRE(ESP_OK == cdc_acm_host_get_rtt_histogram(dev, &hist, true));
+            REQUIRE(1 == hist.samples);
+            REQUIRE(hist.min_us <= hist.avg_us);
+            REQUIRE(hist.avg_us <= hist.max_us);
+            uint32_t bucket_sum = 0;
+            for (int i = 0; i < CDC_ACM_RTT_HIST_BUCKETS; i++) {
+                bucket_sum += hist.buckets[i];
+            }
+            REQUIRE(1 == bucket_sum);
+            REQUIRE(ESP_OK == cdc_acm_host_get_rtt_histogram(dev, &hist, false));
+            REQUIRE(0 == hist.samples);
+
+            // BULK IN, notification and asynchronous BULK OUT endpoints are reset
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_halt_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_flush_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_endpoint_clear_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_interface_release_ExpectAnyArgsAndReturn(ESP_OK);
+            usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+            REQUIRE(ESP_OK == cdc_acm_host_close(dev));
+            usb_host_transfer_submit_Stub(nullptr);
+        }
+
         // Uninstall CDC-ACM driver
         REQUIRE(ESP_OK == test_cdc_acm_host_uninstall());
     }
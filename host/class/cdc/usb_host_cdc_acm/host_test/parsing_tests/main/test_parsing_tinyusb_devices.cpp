@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <catch2/catch_test_macros.hpp>
 #include "usb/usb_helpers.h"
 
@@ -24,6 +25,25 @@ SCENARIO("TinyUSB devices descriptor parsing", "[tinyusb]")
             esp_err_t ret = cdc_parse_interface_descriptor(dev_desc, cfg_desc, 0, &parsed_result);
             REQUIRE_CDC_COMPLIANT(ret, parsed_result, 4);
         }
+
+        SECTION("Interface 0 parsed repeatedly") {
+            // Second parsing is served from the parse cache, the result must be identical
+            cdc_parsed_info_t first = {};
+            cdc_parsed_info_t second = {};
+            REQUIRE(ESP_OK == cdc_parse_interface_descriptor(dev_desc, cfg_desc, 0, &first));
+            esp_err_t ret = cdc_parse_interface_descriptor(dev_desc, cfg_desc, 0, &second);
+            REQUIRE_CDC_COMPLIANT(ret, second, 4);
+            REQUIRE(first.notif_intf == second.notif_intf);
+            REQUIRE(first.notif_ep == second.notif_ep);
+            REQUIRE(first.data_intf == second.data_intf);
+            REQUIRE(first.in_ep == second.in_ep);
+            REQUIRE(first.out_ep == second.out_ep);
+            for (int i = 0; i < second.func_cnt; i++) {
+                REQUIRE((*first.func)[i] == (*second.func)[i]);
+            }
+            free(first.func);
+            free(second.func);
+        }
     }
 
     GIVEN("TinyUSB single HS") {
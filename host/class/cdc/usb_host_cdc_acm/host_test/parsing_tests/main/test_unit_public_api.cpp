@@ -133,3 +133,79 @@ SCENARIO("CDC-ACM Host install/uninstall")
         }
     }
 }
+
+SCENARIO("CDC-ACM Host install/uninstall without driver task")
+{
+    const cdc_acm_host_driver_config_t driver_config = {
+        .driver_task_stack_size = 0,
+        .driver_task_priority = 10,
+        .xCoreID = 0,
+        .new_dev_cb = nullptr,
+    };
+
+    GIVEN("CDC-ACM Host driver config without driver task, driver not installed") {
+
+        // Handle events of not installed CDC ACM Host
+        // Expect fail because of p_cdc_acm_obj being nullptr
+        SECTION("Try to handle events of not installed CDC ACM Host") {
+
+            vPortEnterCritical_Expect();
+            vPortExitCritical_Expect();
+
+            // Call the DUT function, expect ESP_ERR_INVALID_STATE
+            REQUIRE(ESP_ERR_INVALID_STATE == cdc_acm_host_handle_events(0));
+        }
+
+        // Install CDC ACM Host, no task is created
+        SECTION("Successfully install CDC ACM Host without driver task") {
+
+            xEventGroupCreate_ExpectAndReturn(reinterpret_cast<EventGroupHandle_t>(&event_group));
+            xQueueCreateMutex_ExpectAnyArgsAndReturn(reinterpret_cast<QueueHandle_t>(&sem));
+            vPortEnterCritical_Expect();
+            vPortExitCritical_Expect();
+
+            // Call mocked function from USB Host
+            // return ESP_OK, so the client is registered successfully
+            usb_host_client_register_ExpectAnyArgsAndReturn(ESP_OK);
+
+            // Call the DUT Function, expect ESP_OK
+            REQUIRE(ESP_OK == cdc_acm_host_install(&driver_config));
+        }
+    }
+
+    GIVEN("CDC-ACM Host installed without driver task") {
+
+        // The application handles the client events
+        SECTION("Handle events") {
+
+            vPortEnterCritical_Expect();
+            vPortExitCritical_Expect();
+            usb_host_client_handle_events_ExpectAnyArgsAndReturn(ESP_OK);
+
+            // Call the DUT function, expect ESP_OK
+            REQUIRE(ESP_OK == cdc_acm_host_handle_events(0));
+        }
+
+        // Uninstall CDC ACM Host, the client is deregistered directly
+        SECTION("Successfully uninstall CDC ACM Host without driver task") {
+
+            vPortEnterCritical_Expect();
+            vPortExitCritical_Expect();
+            xQueueSemaphoreTake_ExpectAndReturn(reinterpret_cast<QueueHandle_t>(&sem), portMAX_DELAY, pdTRUE);
+            vPortEnterCritical_Expect();
+            vPortExitCritical_Expect();
+
+            // Call mocked function from USB Host
+            // return ESP_OK, so the client is deregistered successfully
+            usb_host_client_deregister_ExpectAnyArgsAndReturn(ESP_OK);
+
+            // Free remaining resources
+            vEventGroupDelete_Expect(reinterpret_cast<EventGroupHandle_t>(&event_group));
+            xQueueGenericSend_ExpectAnyArgsAndReturn(pdTRUE);
+            vQueueDelete_Expect(reinterpret_cast<QueueHandle_t>(&sem));
+
+            // Call the DUT function, expect ESP_OK
+            REQUIRE(ESP_OK == cdc_acm_host_uninstall());
+        }
+    }
+}
@@ -11,7 +11,11 @@
 #include <sys/queue.h>                  // For singly linked list
 
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"             // For RX dispatch task
 #include "freertos/semphr.h"            // For mutexes and semaphores
+#include "freertos/queue.h"             // For queue of free asynchronous OUT transfers
+#include "freertos/stream_buffer.h"     // For RX ring buffer
+#include "esp_timer.h"                  // For adaptive polling of notifications
 
 #include "usb/usb_host.h"               // For USB device handle and transfers
 #include "usb/cdc_acm_host_interface.h" // For CDC interface function table
@@ -32,29 +36,102 @@
 })
 
 typedef struct cdc_dev_s cdc_dev_t;
+
+// Adaptive polling state of the notification endpoint
+typedef enum {
+    CDC_NOTIF_POLL_CONTINUOUS = 0,        // Notification transfer is submitted all the time
+    CDC_NOTIF_POLL_STOPPED,               // Idle, the endpoint is not polled until the next window
+    CDC_NOTIF_POLL_WINDOW,                // Idle, the notification transfer is submitted for a poll window
+} cdc_notif_poll_state_t;
+
+// Context of one OUT transfer from the asynchronous TX pool
+// Transfers of one asynchronous write form a group, its first transfer reports completion of the whole write
+typedef struct cdc_acm_tx_ctx_s {
+    cdc_dev_t *cdc_dev;                   // CDC device that owns the transfer
+    usb_transfer_t *xfer;                 // Transfer of this context
+    struct cdc_acm_tx_ctx_s *group;       // First transfer of the write that this transfer belongs to
+    cdc_acm_tx_callback_t cb;             // First transfer only: User's TX done callback, can be NULL
+    void *cb_arg;                         // First transfer only: Argument of the TX done callback
+    uint32_t group_remaining;             // First transfer only: Transfers of the write that did not finish yet
+    esp_err_t group_status;               // First transfer only: ESP_OK, unless a transfer of the write failed
+    bool lent;                            // The transfer buffer is lent to the user by cdc_acm_host_data_tx_buffer_get()
+    int64_t submit_time_us;               // Time of the transfer submission, for TX latency statistics
+} cdc_acm_tx_ctx_t;
+
 struct cdc_dev_s {
     cdc_acm_intf_t intf_func;             // CDC interface function table
     usb_device_handle_t dev_hdl;          // USB device handle
+    uint8_t dev_addr;                     // USB device address
+    uint16_t vid;                         // Vendor ID of the USB device
+    uint16_t pid;                         // Product ID of the USB device
+    uint8_t intf_idx;                     // Index of the opened CDC interface
+    bool auto_open_cb_running;            // Auto-open callback of this device did not return yet, protected by open_close_mutex
     void *cb_arg;                         // Common argument for user's callbacks (data IN and Notification)
     struct {
         usb_transfer_t *out_xfer;         // OUT data transfer
-        usb_transfer_t *in_xfer;          // IN data transfer
+        size_t out_buffer_size;           // Configured size of OUT transfer buffers, pooled buffers can be larger
+        usb_transfer_t **in_xfer;         // Ring of IN data transfers
+        uint8_t in_xfer_num;              // Number of IN data transfers in the ring
+        size_t in_buffer_size;            // Configured size of IN transfer buffers, pooled buffers can be larger
         cdc_acm_data_callback_t in_cb;    // User's callback for async (non-blocking) data IN
+        cdc_acm_data_ts_callback_t in_ts_cb; // User's callback for data IN with RX timestamp, called instead of in_cb
+        int64_t in_time_us;               // Completion time of the IN transfer that is being processed
+        uint8_t in_status_len;            // Vendor specific status at the start of every IN packet, e.g. FTDI modem status. Packets with status only do not end RTT measurement
         uint16_t in_mps;                  // IN endpoint Maximum Packet Size
-        uint8_t *in_data_buffer_base;     // Pointer to IN data buffer in usb_transfer_t
+        uint8_t *in_data_buffer_base;     // Pointer to IN data buffer in in_xfer[0], used for RX buffer append
+        size_t in_data_len;               // Length of RX data appended in in_xfer[0] buffer
         const usb_intf_desc_t *intf_desc; // Pointer to data interface descriptor
         SemaphoreHandle_t out_mux;        // OUT mutex
+        SemaphoreHandle_t out_done;       // Given when out_xfer finished
+        usb_transfer_t **out_async_xfer;  // Pool of OUT transfers for asynchronous TX
+        cdc_acm_tx_ctx_t *out_async_ctx;  // Contexts of OUT transfers in the pool
+        uint8_t out_async_xfer_num;       // Number of OUT transfers in the pool
+        QueueHandle_t out_async_free;     // Queue of OUT transfers from the pool that are not in flight
+        SemaphoreHandle_t out_async_mux;  // Keeps transfers of one asynchronous write consecutive on the endpoint
+        StreamBufferHandle_t rx_ring;     // RX ring buffer for cdc_acm_host_data_rx(). NULL if not used
+        TaskHandle_t rx_task;             // RX dispatch task. NULL if data callback is called from the driver's task
+        QueueHandle_t rx_queue;           // Queue of completed IN transfers for RX dispatch task
+        TaskHandle_t rx_task_closing;     // Task that waits for the end of RX dispatch task in cdc_acm_host_close()
+        struct cdc_rx_framing_s *rx_framing; // Splitting of received data into frames. NULL if not used
     } data;
 
     struct {
         usb_transfer_t *xfer;             // IN notification transfer
         const usb_intf_desc_t *intf_desc; // Pointer to notification interface descriptor, can be NULL if there is no notification channel in the device
         cdc_acm_host_dev_callback_t cb;   // User's callback for device events
+        bool serial_state_dedup;          // Suppress serial state events that do not change the last reported state
+        uint32_t serial_state_interval_ms; // Minimum interval between serial state events, 0 if not limited
+        bool serial_state_reported;       // At least one serial state event was reported
+        uint16_t serial_state_last;       // Last reported serial state
+        int64_t serial_state_time_us;     // Time of the last reported serial state event
+        bool xfer_busy;                   // Notification transfer is submitted, protected by poll_mux with adaptive polling
+        bool poll_running;                // Device is started, the timer may change polling, protected by poll_mux
+        cdc_notif_poll_state_t poll_state; // Adaptive polling state, protected by poll_mux
+        uint64_t poll_timeout_us;         // Time without notifications, after which the endpoint is stopped
+        uint64_t poll_max_gap_us;         // Longest gap between the poll windows
+        uint64_t poll_window_us;          // Length of a poll window, two polling intervals of the endpoint
+        uint64_t poll_gap_us;             // Gap before the next poll window
+        int64_t poll_last_us;             // Time of the last notification, or of the start of polling
+        int64_t poll_stopped_us;          // Time the endpoint was stopped last
+        uint32_t poll_unpolled_us;        // Time without polling before the current window
+        SemaphoreHandle_t poll_mux;       // Adaptive polling is changed by notification callback and driver task
+        bool poll_expired;                // Adaptive polling timer expired, the driver task runs the next step. Set under lock
+        bool poll_claimed;                // The driver task runs a polling step, protected by driver's spinlock
+        esp_timer_handle_t poll_timer;    // Adaptive polling timer, NULL if disabled
     } notif;                              // Structure with Notif pipe data
 
     usb_transfer_t *ctrl_transfer;        // CTRL (endpoint 0) transfer
     SemaphoreHandle_t ctrl_mux;           // CTRL mutex
+    struct cdc_ctrl_shared_s *ctrl_shared; // CTRL transfer and mutex shared with other interfaces opened by cdc_acm_host_open_multi(), NULL if owned by this device
     cdc_acm_uart_state_t serial_state;    // Serial State
+    struct {
+        cdc_acm_host_stats_t cnt;         // Statistics counters reported to the user
+        uint64_t tx_latency_sum_us;       // Sum of TX latencies, for average calculation
+        cdc_acm_host_rtt_hist_t rtt;      // Round-trip latency histogram reported to the user
+        uint64_t rtt_sum_us;              // Sum of round-trip latencies, for average calculation
+        int64_t rtt_tx_time_us;           // Submission time of the first OUT transfer not answered by IN data yet, 0 if none
+    } stats;                              // Device statistics, protected by lock
+    portMUX_TYPE lock;                    // Spinlock of this device, for callbacks and statistics
     cdc_comm_protocol_t comm_protocol;
     cdc_data_protocol_t data_protocol;
     int cdc_func_desc_cnt;                // Number of CDC Functional descriptors in following array
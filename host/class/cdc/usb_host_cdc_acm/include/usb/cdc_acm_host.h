@@ -31,17 +31,40 @@ extern "C" {
  */
 typedef void (*cdc_acm_new_dev_callback_t)(usb_device_handle_t usb_dev);
 
+/**
+ * @brief Auto-opened CDC device callback
+ *
+ * Provides CDC device that was opened by the driver right after its connection, see cdc_acm_host_auto_open_register().
+ *
+ * @attention This callback is called from the auto-open task of the CDC driver. All functions of this driver, also
+ *            the blocking ones, can be called here, the device can be closed too. cdc_acm_host_close() of this device
+ *            from other tasks waits until the callback returns.
+ * @param[in] cdc_hdl  CDC handle of the opened device
+ * @param[in] user_arg user_arg from the device configuration
+ */
+typedef void (*cdc_acm_auto_open_callback_t)(cdc_acm_dev_hdl_t cdc_hdl, void *user_arg);
+
 /**
  * @brief Configuration structure of USB Host CDC-ACM driver
  *
  */
 typedef struct {
-    size_t driver_task_stack_size;         /**< Stack size of the driver's task */
+    size_t driver_task_stack_size;         /**< Stack size of the driver's task. If set to 0, no task is created and
+                                                the application has to call cdc_acm_host_handle_events() */
     unsigned driver_task_priority;         /**< Priority of the driver's task */
     int  xCoreID;                          /**< Core affinity of the driver's task */
     cdc_acm_new_dev_callback_t new_dev_cb; /**< New USB device connected callback. Can be NULL. */
 } cdc_acm_host_driver_config_t;
 
+/**
+ * @brief Connected USB device, see cdc_acm_host_get_connected_devices()
+ */
+typedef struct {
+    uint8_t dev_addr;                      /**< USB device address */
+    uint16_t vid;                          /**< Vendor ID */
+    uint16_t pid;                          /**< Product ID */
+} cdc_acm_host_connected_dev_t;
+
 /**
  * @brief Install CDC-ACM driver
  *
@@ -68,6 +91,22 @@ esp_err_t cdc_acm_host_install(const cdc_acm_host_driver_config_t *driver_config
  */
 esp_err_t cdc_acm_host_uninstall(void);
 
+/**
+ * @brief Handle USB Host events of the CDC-ACM driver
+ *
+ * If the driver was installed with driver_task_stack_size = 0, the application handles the client events,
+ * e.g. from one task together with the events of other class drivers installed without a background task.
+ * Transfer callbacks of the CDC devices, including the Data Received callback, run from this function.
+ * The application must stop calling this function before cdc_acm_host_uninstall().
+ *
+ * @param[in] timeout Timeout in ticks to wait for an event
+ * @return
+ *   - ESP_OK: Events handled
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed or it has its own task
+ *   - ESP_ERR_TIMEOUT: No event within the timeout
+ */
+esp_err_t cdc_acm_host_handle_events(TickType_t timeout);
+
 /**
  * @brief Register new USB device callback
  *
@@ -87,6 +126,9 @@ esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_
  * Use CDC_HOST_ANY_* macros to signal that you don't care about the device's VID and PID. In this case, first USB device will be opened.
  * It is recommended to use this feature if only one device can ever be in the system (there is no USB HUB connected).
  *
+ * @note USB devices with matching VID/PID whose interface_idx is already opened are skipped, the next matching device is opened.
+ *       Calling this function repeatedly thus opens several devices with the same VID/PID one after another.
+ *
  * @param[in] vid           Device's Vendor ID, set to CDC_HOST_ANY_VID for any
  * @param[in] pid           Device's Product ID, set to CDC_HOST_ANY_PID for any
  * @param[in] interface_idx Index of device's interface used for CDC-ACM communication
@@ -101,12 +143,92 @@ esp_err_t cdc_acm_host_register_new_dev_callback(cdc_acm_new_dev_callback_t new_
  */
 esp_err_t cdc_acm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret);
 
+/**
+ * @brief Open several interfaces of one CDC-ACM device
+ *
+ * For multi-channel USB <-> UART bridges, e.g. FT4232H or CP2108. The USB device is looked up once and all interfaces
+ * are opened on it. Each interface has its own data transfers and callbacks, the CTRL transfer is shared:
+ * control requests of all interfaces are serialized on it.
+ *
+ * The interfaces are opened all or nothing: if one of them fails, the already opened ones are closed.
+ * Each handle is closed by cdc_acm_host_close(), the CTRL transfer is freed with the last one.
+ *
+ * @param[in]  vid           Device's Vendor ID, set to CDC_HOST_ANY_VID for any
+ * @param[in]  pid           Device's Product ID, set to CDC_HOST_ANY_PID for any
+ * @param[in]  interface_idx Array of intf_cnt interface indexes
+ * @param[in]  intf_cnt      Number of interfaces
+ * @param[in]  dev_configs   Array of intf_cnt device configurations. connection_timeout_ms of the first one is used
+ * @param[out] cdc_hdls_ret  Array of intf_cnt CDC device handles
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed
+ *   - ESP_ERR_INVALID_ARG: An array is NULL or intf_cnt is 0
+ *   - ESP_ERR_NO_MEM: Not enough memory for opening the interfaces
+ *   - ESP_ERR_NOT_FOUND: USB device with specified VID/PID is not connected or does not have one of the interfaces
+ */
+esp_err_t cdc_acm_host_open_multi(uint16_t vid, uint16_t pid, const uint8_t *interface_idx, size_t intf_cnt, const cdc_acm_host_device_config_t *dev_configs, cdc_acm_dev_hdl_t *cdc_hdls_ret);
+
+/**
+ * @brief Get VID/PID of all connected USB devices
+ *
+ * The USB device address list is read once. VID/PID of devices opened by this driver are taken from the driver,
+ * only the other devices are opened shortly for reading their Device descriptor.
+ * Use this to match all connected devices in one pass, e.g. before opening them with cdc_acm_host_open().
+ *
+ * @param[out] devs     Array to be filled with connected devices
+ * @param[in]  devs_len Length of the array
+ * @param[out] devs_num Number of connected devices filled in, at most devs_len
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed
+ *   - ESP_ERR_INVALID_ARG: devs or devs_num is NULL
+ */
+esp_err_t cdc_acm_host_get_connected_devices(cdc_acm_host_connected_dev_t *devs, size_t devs_len, size_t *devs_num);
+
 // This function is deprecated, please use cdc_acm_host_open()
 static inline esp_err_t cdc_acm_host_open_vendor_specific(uint16_t vid, uint16_t pid, uint8_t interface_num, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     return cdc_acm_host_open(vid, pid, interface_num, dev_config, cdc_hdl_ret);
 }
 
+/**
+ * @brief Register CDC interface for opening on device connection
+ *
+ * Every newly connected USB device with matching VID/PID is opened right after its enumeration.
+ * The USB Host new device event only queues the device, it is opened by the auto-open task "USB-CDC-AUTO", created
+ * on first registration with stack size, priority and core of the driver task. This is an alternative to calling
+ * cdc_acm_host_open() with connection_timeout_ms, which polls connected devices.
+ *
+ * @note Devices that are already connected are not opened, use cdc_acm_host_open() for them.
+ * @note connection_timeout_ms from dev_config is ignored. The configuration is copied.
+ * @param[in] vid           Device's Vendor ID, set to CDC_HOST_ANY_VID for any
+ * @param[in] pid           Device's Product ID, set to CDC_HOST_ANY_PID for any
+ * @param[in] interface_idx Index of device's interface used for CDC-ACM communication
+ * @param[in] dev_config    Configuration structure of the device
+ * @param[in] opened_cb     Called for every opened device
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed or this VID/PID/interface is already registered
+ *   - ESP_ERR_INVALID_ARG: dev_config or opened_cb is NULL
+ *   - ESP_ERR_NO_MEM: Not enough memory for the registration or the auto-open task
+ */
+esp_err_t cdc_acm_host_auto_open_register(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_auto_open_callback_t opened_cb);
+
+/**
+ * @brief Unregister CDC interface registered by cdc_acm_host_auto_open_register()
+ *
+ * Already opened devices are not closed.
+ *
+ * @param[in] vid           Device's Vendor ID
+ * @param[in] pid           Device's Product ID
+ * @param[in] interface_idx Index of device's interface
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_STATE: The CDC driver is not installed
+ *   - ESP_ERR_NOT_FOUND: This VID/PID/interface is not registered
+ */
+esp_err_t cdc_acm_host_auto_open_unregister(uint16_t vid, uint16_t pid, uint8_t interface_idx);
+
 /**
  * @brief Close CDC device and release its resources
  *
@@ -129,6 +251,147 @@ esp_err_t cdc_acm_host_close(cdc_acm_dev_hdl_t cdc_hdl);
  */
 esp_err_t cdc_acm_host_data_tx_blocking(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms);
 
+/**
+ * @brief Receive data from RX ring buffer
+ *
+ * Available only if the device was opened with rx_ring_size > 0. The ring is filled from the CDC driver task,
+ * so a slow consumer does not block the IN endpoint polling. If the ring is full, new data are dropped
+ * and CDC_ACM_HOST_SERIAL_STATE event with bOverRun flag is sent.
+ *
+ * If the device was opened with rx_framing, each call returns exactly one complete frame.
+ * Every frame occupies its length plus sizeof(size_t) bytes of the ring.
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[out] data       Buffer for received data
+ * @param[in]  data_len   Size of the buffer. With rx_framing, it must be at least rx_framing.max_frame_size
+ * @param[out] rx_len     Number of bytes copied to the buffer
+ * @param[in]  timeout_ms Timeout in [ms] for waiting for at least one byte
+ * @return
+ *   - ESP_OK: Success, at least one byte was received
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_NOT_SUPPORTED: Device was opened without RX ring buffer
+ *   - ESP_ERR_INVALID_SIZE: With rx_framing, the buffer is smaller than the maximum frame size
+ *   - ESP_ERR_TIMEOUT: No data received within timeout_ms
+ */
+esp_err_t cdc_acm_host_data_rx(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms);
+
+/**
+ * @brief Get CDC device statistics
+ *
+ * Counters of transferred data, transfer statuses, RX overruns and TX latency since the device was opened.
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[out] stats Device statistics
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ */
+esp_err_t cdc_acm_host_get_stats(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_host_stats_t *stats);
+
+/**
+ * @brief Get round-trip latency histogram
+ *
+ * Latency is measured from BULK OUT submission to completion of the next BULK IN transfer with data,
+ * e.g. from a request sent to a motor controller to its response. Both timestamps are taken by esp_timer in the driver,
+ * so the histogram does not include scheduling of the user's tasks.
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[out] hist  Round-trip latency histogram
+ * @param[in]  reset Clear the histogram after reading, e.g. for measurement in fixed intervals
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ */
+esp_err_t cdc_acm_host_get_rtt_histogram(cdc_acm_dev_hdl_t cdc_hdl, cdc_acm_host_rtt_hist_t *hist, bool reset);
+
+/**
+ * @brief Transmit data segments - blocking mode
+ *
+ * Segments are gathered directly into the OUT transfer buffer and sent as one transfer.
+ * Useful for frames built from several pieces (e.g. header, payload and CRC) without concatenating them first.
+ *
+ * @param cdc_hdl CDC handle obtained from cdc_acm_host_open()
+ * @param[in] segments    Array of data segments
+ * @param[in] segment_cnt Number of segments in the array
+ * @param[in] timeout_ms  Timeout in [ms]
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments or total length is 0
+ *   - ESP_ERR_INVALID_SIZE: Total length of the segments is larger than out_buffer_size
+ *   - ESP_ERR_NOT_SUPPORTED: Device was opened as read-only
+ *   - ESP_ERR_TIMEOUT: Transfer was not finished within timeout_ms
+ *   - ESP_ERR_INVALID_RESPONSE: Transfer failed
+ */
+esp_err_t cdc_acm_host_data_tx_vectored(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_tx_segment_t *segments, size_t segment_cnt, uint32_t timeout_ms);
+
+/**
+ * @brief Transmit data - non-blocking mode
+ *
+ * Data are copied to free transfers from the asynchronous TX pool and the transfers are submitted.
+ * This function returns without waiting for the transfers to finish, so several transfers can be queued on the OUT endpoint.
+ * The pool is allocated during device opening, see out_xfer_count in cdc_acm_host_device_config_t.
+ *
+ * Data larger than out_buffer_size are split into several transfers, which are submitted one after another,
+ * also if this function is called from several tasks. tx_cb is called once for the whole data, when all the transfers finish,
+ * with ESP_OK only if all of them were completed.
+ *
+ * If this function fails before any data are submitted, tx_cb is not called. If the submission fails after a part of the
+ * data was submitted, the submitted part is still sent: the error is returned and tx_cb reports ESP_ERR_INVALID_RESPONSE
+ * when the submitted transfers finish.
+ *
+ * @param cdc_hdl        CDC handle obtained from cdc_acm_host_open()
+ * @param[in] data       Data to be sent
+ * @param[in] data_len   Data length, must not be larger than out_buffer_size * out_xfer_count
+ * @param[in] tx_cb      Callback called when the (last) transfer finishes. Can be NULL
+ * @param[in] user_arg   User's argument passed to tx_cb
+ * @param[in] timeout_ms Timeout in [ms] for waiting for free transfers in the pool
+ * @return
+ *   - ESP_OK: Success, data submitted
+ *   - ESP_ERR_INVALID_ARG: Invalid device or data
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened without asynchronous TX pool
+ *   - ESP_ERR_INVALID_SIZE: data_len is larger than the whole pool
+ *   - ESP_ERR_TIMEOUT: Not enough free transfers in the pool within timeout_ms
+ *   - Error of usb_host_transfer_submit(): Data were not submitted, or only a part of them, see above
+ */
+esp_err_t cdc_acm_host_data_tx_async(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, cdc_acm_tx_callback_t tx_cb, void *user_arg, uint32_t timeout_ms);
+
+/**
+ * @brief Get a transfer buffer from the asynchronous TX pool - zero-copy TX
+ *
+ * The buffer is lent to the application, which fills it in place and passes it to cdc_acm_host_data_tx_buffer_submit().
+ * The buffer is allocated by USB Host Library, so it is DMA capable and no copy is needed before the transmission.
+ *
+ * @param cdc_hdl         CDC handle obtained from cdc_acm_host_open()
+ * @param[out] buf        Lent transfer buffer
+ * @param[out] buf_size   Size of the lent buffer
+ * @param[in]  timeout_ms Timeout in [ms] for waiting for a free transfer in the pool
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid device or output pointers
+ *   - ESP_ERR_NOT_SUPPORTED: The device was opened without asynchronous TX pool
+ *   - ESP_ERR_TIMEOUT: No free transfer in the pool within timeout_ms
+ */
+esp_err_t cdc_acm_host_data_tx_buffer_get(cdc_acm_dev_hdl_t cdc_hdl, uint8_t **buf, size_t *buf_size, uint32_t timeout_ms);
+
+/**
+ * @brief Submit a transfer buffer obtained from cdc_acm_host_data_tx_buffer_get()
+ *
+ * The buffer is returned to the driver and must not be accessed by the application after this call.
+ * Set data_len to 0 to return the buffer to the pool without transmitting anything.
+ *
+ * @param cdc_hdl      CDC handle obtained from cdc_acm_host_open()
+ * @param[in] buf      Buffer obtained from cdc_acm_host_data_tx_buffer_get()
+ * @param[in] data_len Number of bytes filled in the buffer
+ * @param[in] tx_cb    Callback called when the transfer finishes. Can be NULL
+ * @param[in] user_arg User's argument passed to tx_cb
+ * @return
+ *   - ESP_OK: Success, data submitted
+ *   - ESP_ERR_INVALID_ARG: Invalid device or buf does not belong to the pool
+ *   - ESP_ERR_INVALID_STATE: buf is not lent to the application
+ *   - ESP_ERR_INVALID_SIZE: data_len is larger than the buffer
+ */
+esp_err_t cdc_acm_host_data_tx_buffer_submit(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *buf, size_t data_len, cdc_acm_tx_callback_t tx_cb, void *user_arg);
+
 /**
  * @brief Print device's descriptors
  *
@@ -181,6 +444,70 @@ esp_err_t cdc_acm_host_cdc_desc_get(cdc_acm_dev_hdl_t cdc_hdl, cdc_desc_subtype_
  */
 esp_err_t cdc_acm_host_send_custom_request(cdc_acm_dev_hdl_t cdc_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data);
 
+/**
+ * @brief Send several commands to CTRL endpoint
+ *
+ * All requests are submitted back-to-back to the USB Host Library and executed in the given order.
+ * The function returns after the last request finishes, which saves round trips compared to
+ * calling cdc_acm_host_send_custom_request() for each request. Useful for device initialization sequences.
+ *
+ * @note Data of IN requests are valid only if the function returns ESP_OK
+ * @param        cdc_hdl     CDC handle obtained from cdc_acm_host_open()
+ * @param[inout] requests    Array of control requests
+ * @param[in]    request_cnt Number of requests in the array
+ * @return
+ *   - ESP_OK: All requests finished successfully
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_INVALID_SIZE: Data of a request are larger than CTRL transfer buffer
+ *   - ESP_ERR_NO_MEM: Not enough memory for the transfers
+ *   - ESP_ERR_TIMEOUT: Requests were not finished in time
+ *   - ESP_ERR_INVALID_RESPONSE: At least one request failed
+ */
+esp_err_t cdc_acm_host_send_custom_requests(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_ctrl_request_t *requests, size_t request_cnt);
+
+/**
+ * @brief Send encapsulated command to the Communication Class Interface
+ *
+ * SEND_ENCAPSULATED_COMMAND request carries messages of the control protocol of the interface, e.g. MBIM.
+ * Unlike cdc_acm_host_send_custom_request(), the message is not limited by the size of the CTRL transfer buffer.
+ *
+ * @param     cdc_hdl    CDC handle obtained from cdc_acm_host_open()
+ * @param[in] data       Command
+ * @param[in] data_len   Length of the command in bytes
+ * @param[in] timeout_ms Timeout of the request in [ms]
+ * @return
+ *   - ESP_OK: Command sent
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_INVALID_SIZE: Command longer than 65535 bytes
+ *   - ESP_ERR_NOT_SUPPORTED: The device has no Communication Class Interface
+ *   - ESP_ERR_NO_MEM: Not enough memory for the transfer
+ *   - ESP_ERR_TIMEOUT: The request was not finished in time
+ *   - ESP_ERR_INVALID_RESPONSE: The request failed
+ */
+esp_err_t cdc_acm_host_send_encapsulated_command(cdc_acm_dev_hdl_t cdc_hdl, const uint8_t *data, size_t data_len, uint32_t timeout_ms);
+
+/**
+ * @brief Read encapsulated response of the Communication Class Interface
+ *
+ * Call it after CDC_ACM_HOST_RESPONSE_AVAILABLE event, the response is usually shorter than the buffer.
+ *
+ * @note The event is reported from the driver task, so read the response from another task
+ * @param      cdc_hdl    CDC handle obtained from cdc_acm_host_open()
+ * @param[out] data       Buffer for the response
+ * @param[in]  data_len   Size of the buffer, e.g. wMaxControlMessage of the device
+ * @param[out] rx_len     Length of the response in bytes
+ * @param[in]  timeout_ms Timeout of the request in [ms]
+ * @return
+ *   - ESP_OK: Response received
+ *   - ESP_ERR_INVALID_ARG: Invalid input arguments
+ *   - ESP_ERR_INVALID_SIZE: Buffer larger than 65535 bytes
+ *   - ESP_ERR_NOT_SUPPORTED: The device has no Communication Class Interface
+ *   - ESP_ERR_NO_MEM: Not enough memory for the transfer
+ *   - ESP_ERR_TIMEOUT: The request was not finished in time
+ *   - ESP_ERR_INVALID_RESPONSE: The request failed
+ */
+esp_err_t cdc_acm_host_get_encapsulated_response(cdc_acm_dev_hdl_t cdc_hdl, uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms);
+
 #ifdef __cplusplus
 }
 class CdcAcmDevice {
@@ -200,6 +527,31 @@ public:
         return cdc_acm_host_data_tx_blocking(this->cdc_hdl, data, len, timeout_ms);
     }
 
+    inline esp_err_t rx(uint8_t *data, size_t len, size_t *rx_len, uint32_t timeout_ms = 100)
+    {
+        return cdc_acm_host_data_rx(this->cdc_hdl, data, len, rx_len, timeout_ms);
+    }
+
+    inline esp_err_t tx_vectored(const cdc_acm_tx_segment_t *segments, size_t segment_cnt, uint32_t timeout_ms = 100)
+    {
+        return cdc_acm_host_data_tx_vectored(this->cdc_hdl, segments, segment_cnt, timeout_ms);
+    }
+
+    inline esp_err_t tx_async(const uint8_t *data, size_t len, cdc_acm_tx_callback_t tx_cb = nullptr, void *user_arg = nullptr, uint32_t timeout_ms = 0)
+    {
+        return cdc_acm_host_data_tx_async(this->cdc_hdl, data, len, tx_cb, user_arg, timeout_ms);
+    }
+
+    inline esp_err_t tx_buffer_get(uint8_t **buf, size_t *buf_size, uint32_t timeout_ms = 0)
+    {
+        return cdc_acm_host_data_tx_buffer_get(this->cdc_hdl, buf, buf_size, timeout_ms);
+    }
+
+    inline esp_err_t tx_buffer_submit(uint8_t *buf, size_t len, cdc_acm_tx_callback_t tx_cb = nullptr, void *user_arg = nullptr)
+    {
+        return cdc_acm_host_data_tx_buffer_submit(this->cdc_hdl, buf, len, tx_cb, user_arg);
+    }
+
     inline esp_err_t open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config)
     {
         return cdc_acm_host_open(vid, pid, interface_idx, dev_config, &this->cdc_hdl);
@@ -239,11 +591,36 @@ public:
         return cdc_acm_host_send_break(this->cdc_hdl, duration_ms);
     }
 
+    inline esp_err_t get_stats(cdc_acm_host_stats_t *stats) const
+    {
+        return cdc_acm_host_get_stats(this->cdc_hdl, stats);
+    }
+
+    inline esp_err_t get_rtt_histogram(cdc_acm_host_rtt_hist_t *hist, bool reset = false)
+    {
+        return cdc_acm_host_get_rtt_histogram(this->cdc_hdl, hist, reset);
+    }
+
     inline esp_err_t send_custom_request(uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data)
     {
         return cdc_acm_host_send_custom_request(this->cdc_hdl, bmRequestType, bRequest, wValue, wIndex, wLength, data);
     }
 
+    inline esp_err_t send_custom_requests(const cdc_acm_ctrl_request_t *requests, size_t request_cnt)
+    {
+        return cdc_acm_host_send_custom_requests(this->cdc_hdl, requests, request_cnt);
+    }
+
+    inline esp_err_t send_encapsulated_command(const uint8_t *data, size_t data_len, uint32_t timeout_ms = 1000)
+    {
+        return cdc_acm_host_send_encapsulated_command(this->cdc_hdl, data, data_len, timeout_ms);
+    }
+
+    inline esp_err_t get_encapsulated_response(uint8_t *data, size_t data_len, size_t *rx_len, uint32_t timeout_ms = 1000)
+    {
+        return cdc_acm_host_get_encapsulated_response(this->cdc_hdl, data, data_len, rx_len, timeout_ms);
+    }
+
 protected:
     cdc_acm_dev_hdl_t cdc_hdl;
 
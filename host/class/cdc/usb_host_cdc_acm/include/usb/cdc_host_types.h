@@ -8,7 +8,9 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_err.h"
 #include "usb/usb_types_cdc.h"
+#include "usb/usb_types_stack.h"
 
 typedef struct cdc_dev_s *cdc_acm_dev_hdl_t;
 
@@ -19,7 +21,8 @@ typedef enum {
     CDC_ACM_HOST_ERROR,
     CDC_ACM_HOST_SERIAL_STATE,
     CDC_ACM_HOST_NETWORK_CONNECTION,
-    CDC_ACM_HOST_DEVICE_DISCONNECTED
+    CDC_ACM_HOST_DEVICE_DISCONNECTED,
+    CDC_ACM_HOST_RESPONSE_AVAILABLE     //!< Encapsulated response can be read by cdc_acm_host_get_encapsulated_response()
 } cdc_acm_host_dev_event_t;
 
 /**
@@ -46,6 +49,106 @@ typedef struct {
  */
 typedef bool (*cdc_acm_data_callback_t)(const uint8_t *data, size_t data_len, void *user_arg);
 
+/**
+ * @brief Data receive callback type with RX timestamp
+ *
+ * @param[in] data       Pointer to received data
+ * @param[in] data_len   Length of received data in bytes
+ * @param[in] rx_time_us Time of BULK IN transfer completion from esp_timer_get_time(), taken in the transfer callback
+ * @param[in] user_arg   User's argument passed to open function
+ * @return true          Received data was processed     -> Flush RX buffer
+ * @return false         Received data was NOT processed -> Append new data to the buffer
+ */
+typedef bool (*cdc_acm_data_ts_callback_t)(const uint8_t *data, size_t data_len, int64_t rx_time_us, void *user_arg);
+
+/**
+ * @brief Framing of received data
+ *
+ * @see rx_framing in cdc_acm_host_device_config_t
+ */
+typedef enum {
+    CDC_ACM_RX_FRAMING_NONE = 0,        //!< Received data are passed in chunks as they come from BULK IN endpoint
+    CDC_ACM_RX_FRAMING_DELIMITER,       //!< Frames end with the delimiter byte, e.g. '\n' for AT responses or NMEA sentences. The delimiter is passed with the frame
+    CDC_ACM_RX_FRAMING_SLIP,            //!< SLIP frames (RFC 1055). Frames are passed decoded, without END bytes
+    CDC_ACM_RX_FRAMING_COBS,            //!< COBS frames delimited by zero byte. Frames are passed decoded, without the delimiter
+} cdc_acm_rx_framing_t;
+
+/**
+ * @brief Data transmitted callback type
+ *
+ * Called from the CDC driver task when a transfer submitted with cdc_acm_host_data_tx_async() finishes.
+ * The transfer is already returned to the pool, so new data can be submitted from this callback.
+ *
+ * @param[in] cdc_hdl  CDC handle the data was sent to
+ * @param[in] status   ESP_OK: All data were transmitted; ESP_ERR_INVALID_RESPONSE: Transfer failed or was canceled
+ * @param[in] user_arg User's argument passed to cdc_acm_host_data_tx_async()
+ */
+typedef void (*cdc_acm_tx_callback_t)(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg);
+
+/**
+ * @brief Control request for cdc_acm_host_send_custom_requests()
+ */
+typedef struct {
+    uint8_t bmRequestType; /**< Field of USB control request */
+    uint8_t bRequest;      /**< Field of USB control request */
+    uint16_t wValue;       /**< Field of USB control request */
+    uint16_t wIndex;       /**< Field of USB control request */
+    uint16_t wLength;      /**< Field of USB control request */
+    uint8_t *data;         /**< Data of the request, can be NULL if wLength is 0 */
+} cdc_acm_ctrl_request_t;
+
+#define CDC_ACM_XFER_STATUS_NUM (USB_TRANSFER_STATUS_NO_DEVICE + 1) // Number of usb_transfer_status_t values
+
+/**
+ * @brief CDC-ACM device statistics
+ *
+ * Counters are maintained from device opening. Use them to size buffers and transfer counts.
+ */
+typedef struct {
+    uint64_t rx_bytes;                               /**< Bytes received on BULK IN endpoint */
+    uint32_t rx_transfers;                           /**< Successfully completed BULK IN transfers */
+    uint64_t tx_bytes;                               /**< Bytes transmitted on BULK OUT endpoint */
+    uint32_t tx_transfers;                           /**< Successfully completed BULK OUT transfers */
+    uint32_t notif_transfers;                        /**< Successfully completed notification transfers */
+    uint32_t rx_overruns;                            /**< RX data dropped because IN buffer or RX ring was full, or RX frames dropped because they were too long or malformed */
+    uint32_t xfer_status[CDC_ACM_XFER_STATUS_NUM];   /**< Histogram of finished data and notification transfers, indexed by usb_transfer_status_t */
+    uint32_t tx_latency_min_us;                      /**< Minimum time from BULK OUT submission to its completion in [us] */
+    uint32_t tx_latency_avg_us;                      /**< Average time from BULK OUT submission to its completion in [us] */
+    uint32_t tx_latency_max_us;                      /**< Maximum time from BULK OUT submission to its completion in [us] */
+    uint32_t notif_poll_stops;                       /**< Times the idle notification endpoint was stopped, adaptive polling only */
+    uint32_t notif_poll_windows;                     /**< Poll windows of the stopped notification endpoint */
+    uint32_t notif_poll_wakeups;                     /**< Notifications received in a poll window, which resumed polling at bInterval */
+    uint32_t notif_poll_gap_max_us;                  /**< Longest time without polling before such a notification in [us], the upper bound of the latency added by adaptive polling */
+} cdc_acm_host_stats_t;
+
+#define CDC_ACM_RTT_HIST_BUCKETS   16 // Number of buckets of round-trip latency histogram
+#define CDC_ACM_RTT_HIST_BUCKET0_US 32 // Upper bound of the first bucket in [us]
+
+/**
+ * @brief Round-trip latency histogram
+ *
+ * One sample is the time from BULK OUT submission to completion of the next BULK IN transfer with data.
+ * If several transfers are submitted before the data arrive, the time is measured from the first of them.
+ *
+ * Bucket 0 counts samples below CDC_ACM_RTT_HIST_BUCKET0_US, bucket n samples from (CDC_ACM_RTT_HIST_BUCKET0_US << (n - 1))
+ * below (CDC_ACM_RTT_HIST_BUCKET0_US << n). The last bucket counts all longer samples.
+ */
+typedef struct {
+    uint32_t buckets[CDC_ACM_RTT_HIST_BUCKETS];      /**< Number of samples in each bucket */
+    uint32_t samples;                                /**< Number of all samples */
+    uint32_t min_us;                                 /**< Minimum round-trip latency in [us] */
+    uint32_t avg_us;                                 /**< Average round-trip latency in [us] */
+    uint32_t max_us;                                 /**< Maximum round-trip latency in [us] */
+} cdc_acm_host_rtt_hist_t;
+
+/**
+ * @brief Data segment for scatter-gather transmission with cdc_acm_host_data_tx_vectored()
+ */
+typedef struct {
+    const uint8_t *data; /**< Pointer to segment data. Can be NULL if len is 0 */
+    size_t len;          /**< Length of the segment in bytes */
+} cdc_acm_tx_segment_t;
+
 /**
  * @brief Device event callback type
  *
@@ -64,4 +167,26 @@ typedef struct {
     cdc_acm_host_dev_callback_t event_cb; /**< Device's event callback function. Can be NULL */
     cdc_acm_data_callback_t data_cb;      /**< Device's data RX callback function. Can be NULL for write-only devices */
     void *user_arg;                       /**< User's argument that will be passed to the callbacks */
+    uint8_t in_xfer_count;                /**< Number of BULK IN transfers kept in flight. Set to 0 or 1 for a single transfer */
+    uint8_t out_xfer_count;               /**< Number of BULK OUT transfers (each out_buffer_size long) for cdc_acm_host_data_tx_async(). Set to 0 to disable async TX */
+    size_t rx_ring_size;                  /**< Size of RX ring buffer for cdc_acm_host_data_rx() in bytes. If not 0, received data are stored in the ring and data_cb is not called */
+    struct {
+        size_t stack_size;                /**< Stack size of RX dispatch task. Set to 0 to call data_cb from the driver's task */
+        unsigned priority;                /**< Priority of RX dispatch task */
+        int xCoreID;                      /**< Core affinity of RX dispatch task */
+    } rx_task;                            /**< Optional per-device task for data_cb, so a slow consumer does not block other devices */
+    struct {
+        bool suppress_unchanged;          /**< Do not report CDC_ACM_HOST_SERIAL_STATE event if the serial state did not change since the last reported event */
+        uint32_t min_interval_ms;         /**< Minimum interval between reported CDC_ACM_HOST_SERIAL_STATE events in [ms]. Set to 0 to disable rate limiting */
+    } serial_state_filter;                /**< Optional filter of serial state notifications, for devices that flood the notification endpoint */
+    struct {
+        cdc_acm_rx_framing_t mode;        /**< Framing of received data. CDC_ACM_RX_FRAMING_NONE (default) disables framing */
+        uint8_t delimiter;                /**< Delimiter byte for CDC_ACM_RX_FRAMING_DELIMITER */
+        size_t max_frame_size;            /**< Maximum frame size in bytes, longer frames are dropped. Set to 0 to use in_buffer_size */
+    } rx_framing;                         /**< Optional splitting of received data into frames: data_cb is called and RX ring is filled with complete frames */
+    cdc_acm_data_ts_callback_t data_ts_cb; /**< Data RX callback with RX timestamp. If not NULL, it is called instead of data_cb */
+    struct {
+        uint32_t idle_timeout_ms;         /**< After this time without notifications in [ms], the notification endpoint is polled only in short windows with growing gaps, and again at bInterval from the next notification. Set to 0 to poll at bInterval all the time */
+        uint32_t max_gap_ms;              /**< Longest gap between the poll windows in [ms], i.e. the latency added to the first notification after idle time. Set to 0 for 250 ms */
+    } notif_poll;                         /**< Optional adaptive polling of the notification endpoint, for devices that rarely notify */
 } cdc_acm_host_device_config_t;
@@ -40,6 +40,8 @@ typedef enum {
     USB_CDC_DESC_SUBTYPE_TEL_CM = 0x18,             // Telephone Control Model Functional Descriptor
     USB_CDC_DESC_SUBTYPE_OBEX_SERVICE = 0x19,       // OBEX Service Identifier Functional Descriptor
     USB_CDC_DESC_SUBTYPE_NCM = 0x1A,                // NCM Functional Descriptor
+    USB_CDC_DESC_SUBTYPE_MBIM = 0x1B,               // MBIM Functional Descriptor
+    USB_CDC_DESC_SUBTYPE_MBIM_EXTENDED = 0x1C,      // MBIM Extended Functional Descriptor
     USB_CDC_DESC_SUBTYPE_MAX
 } __attribute__((packed)) cdc_desc_subtype_t;
 
@@ -61,7 +63,8 @@ typedef enum {
     USB_CDC_SUBCLASS_MOBILE = 0x0A,  // Mobile Direct Line Model
     USB_CDC_SUBCLASS_OBEX = 0x0B,    // OBEX
     USB_CDC_SUBCLASS_EEM = 0x0C,     // Ethernet Emulation Model
-    USB_CDC_SUBCLASS_NCM = 0x0D      // Network Control Model
+    USB_CDC_SUBCLASS_NCM = 0x0D,     // Network Control Model
+    USB_CDC_SUBCLASS_MBIM = 0x0E     // Mobile Broadband Interface Model
 } __attribute__((packed)) cdc_subclass_t;
 
 /**
@@ -90,6 +93,7 @@ typedef enum {
 typedef enum {
     USB_CDC_DATA_PROTOCOL_NONE = 0x00,   // No class specific protocol required
     USB_CDC_DATA_PROTOCOL_NCM = 0x01,    // Network Transfer Block
+    USB_CDC_DATA_PROTOCOL_MBIM = 0x02,   // Network Transfer Block (IP + DSS)
     USB_CDC_DATA_PROTOCOL_I430 = 0x30,   // Physical interface protocol for ISDN BRI
     USB_CDC_DATA_PROTOCOL_HDLC = 0x31,   // HDLC
     USB_CDC_DATA_PROTOCOL_Q921M = 0x50,  // Management protocol for Q.921 data link protocol
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/cdc_host_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Complete frame callback
+ *
+ * @param[in] frame Frame, it is valid only during the callback
+ * @param[in] len   Length of the frame in bytes
+ * @param[in] arg   Argument passed to cdc_rx_framing_process()
+ */
+typedef void (*cdc_rx_frame_cb_t)(uint8_t *frame, size_t len, void *arg);
+
+/**
+ * @brief RX framing state
+ *
+ * Frames completely contained in one received buffer are decoded in this buffer and passed without copying.
+ * Frames split over several received buffers are collected in the frame buffer.
+ */
+typedef struct cdc_rx_framing_s {
+    cdc_acm_rx_framing_t mode;
+    uint8_t delimiter;                  // Byte that ends a frame
+    uint8_t *buf;                       // Frame buffer for frames split over several received buffers
+    size_t buf_size;                    // Maximum frame size
+    size_t buf_len;                     // Length of the frame collected in the frame buffer
+    bool partial;                       // The previous buffer ended inside of a frame
+    bool overrun;                       // The frame in the frame buffer is too long and will be dropped
+    bool slip_escape;                   // SLIP: last byte of the previous buffer was ESC
+    uint8_t cobs_left;                  // COBS: bytes left in the current block
+    bool cobs_zero;                     // COBS: the current block is followed by a zero byte
+} cdc_rx_framing_t;
+
+/**
+ * @brief Allocate frame buffer and reset the framing state
+ *
+ * @param[out] framing        Framing state
+ * @param[in]  mode           Framing mode, not CDC_ACM_RX_FRAMING_NONE
+ * @param[in]  delimiter      Delimiter byte for CDC_ACM_RX_FRAMING_DELIMITER
+ * @param[in]  max_frame_size Maximum frame size, longer frames are dropped
+ * @return
+ *     - ESP_OK:              Success
+ *     - ESP_ERR_INVALID_ARG: Unknown mode or zero max_frame_size
+ *     - ESP_ERR_NO_MEM:      Not enough memory for the frame buffer
+ */
+esp_err_t cdc_rx_framing_init(cdc_rx_framing_t *framing, cdc_acm_rx_framing_t mode, uint8_t delimiter, size_t max_frame_size);
+
+/**
+ * @brief Free frame buffer
+ *
+ * @param[in] framing Framing state
+ */
+void cdc_rx_framing_deinit(cdc_rx_framing_t *framing);
+
+/**
+ * @brief Split received data into frames
+ *
+ * @param[inout] framing Framing state
+ * @param[inout] data    Received data, decoded in place
+ * @param[in]    len     Length of the data in bytes
+ * @param[in]    cb      Called for each complete frame
+ * @param[in]    arg     Argument of the callback
+ * @return Number of frames dropped because they were longer than the maximum frame size or could not be decoded
+ */
+size_t cdc_rx_framing_process(cdc_rx_framing_t *framing, uint8_t *data, size_t len, cdc_rx_frame_cb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
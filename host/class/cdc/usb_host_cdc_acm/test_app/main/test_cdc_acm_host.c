@@ -330,6 +330,64 @@ TEST_CASE("multiple_devices", "[cdc_acm]")
     vTaskDelay(20); // Short delay to allow task to be cleaned up
 }
 
+TEST_CASE("multiple_interfaces", "[cdc_acm]")
+{
+    nb_of_responses = 0;
+    nb_of_responses2 = 0;
+
+    test_install_cdc_driver();
+
+    printf("Opening 2 interfaces of one CDC-ACM device\n");
+    const uint8_t interfaces[2] = {0, 2};
+    cdc_acm_dev_hdl_t cdc_devs[2];
+    cdc_acm_host_device_config_t dev_configs[2] = {
+        {
+            .connection_timeout_ms = 1000,
+            .out_buffer_size = 64,
+            .event_cb = notif_cb,
+            .data_cb = handle_rx,
+            .user_arg = tx_buf,
+        },
+        {
+            .out_buffer_size = 64,
+            .event_cb = notif_cb,
+            .data_cb = handle_rx2,
+            .user_arg = tx_buf2,
+        },
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_open_multi(0x303A, 0x4002, interfaces, 2, dev_configs, cdc_devs)); // 0x303A:0x4002 (TinyUSB Dual CDC device)
+    TEST_ASSERT_NOT_NULL(cdc_devs[0]);
+    TEST_ASSERT_NOT_NULL(cdc_devs[1]);
+
+    // Both interfaces send control requests on the shared CTRL transfer
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_set_control_line_state(cdc_devs[0], true, false));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_set_control_line_state(cdc_devs[1], true, false));
+
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_devs[0], tx_buf, sizeof(tx_buf), 1000));
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_data_tx_blocking(cdc_devs[1], tx_buf2, sizeof(tx_buf2), 1000));
+
+    vTaskDelay(10); // Wait for RX callbacks
+
+    TEST_ASSERT_EQUAL(1, nb_of_responses);
+    TEST_ASSERT_EQUAL(1, nb_of_responses2);
+
+    // The second interface keeps working after the first one, which allocated the CTRL transfer, is closed
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_devs[0]));
+    cdc_acm_line_coding_t line_coding;
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_line_coding_get(cdc_devs[1], &line_coding));
+
+    // Failing interface closes the opened ones
+    const uint8_t bad_interfaces[2] = {0, 5};
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_close(cdc_devs[1]));
+    TEST_ASSERT_NOT_EQUAL(ESP_OK, cdc_acm_host_open_multi(0x303A, 0x4002, bad_interfaces, 2, dev_configs, cdc_devs));
+    TEST_ASSERT_NULL(cdc_devs[0]);
+    TEST_ASSERT_NULL(cdc_devs[1]);
+
+    // Clean-up
+    TEST_ASSERT_EQUAL(ESP_OK, cdc_acm_host_uninstall());
+    vTaskDelay(20); // Short delay to allow task to be cleaned up
+}
+
 #define MULTIPLE_THREADS_TRANSFERS_NUM 5
 #define MULTIPLE_THREADS_TASKS_NUM 4
 void tx_task(void *arg)
@@ -0,0 +1,693 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "usb/usb_helpers.h"
+#include "usb/usb_types_ch9.h"
+#include "usb/usb_types_cdc.h"
+#include "usb/cdc_acm_host.h"
+#include "esp_private/cdc_host_common.h"
+#include "usb/cdc_ncm_host.h"
+#include "cdc_ncm_ntb.h"
+
+static const char *TAG = "cdc_ncm";
+
+#define CDC_NCM_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE | USB_BM_REQUEST_TYPE_DIR_IN)
+#define CDC_NCM_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE | USB_BM_REQUEST_TYPE_DIR_OUT)
+
+// @see Table 8, USB CDC Subclass Specification for Ethernet Control Model Devices rev. 1.2
+#define CDC_ECM_PACKET_TYPE_ALL_MULTICAST (1 << 1)
+#define CDC_ECM_PACKET_TYPE_DIRECTED      (1 << 2)
+#define CDC_ECM_PACKET_TYPE_BROADCAST     (1 << 3)
+
+#define CDC_NCM_MAC_STR_LANGID (0x0409) // English (United States), the MAC address string consists of hexadecimal digits only
+#define CDC_NCM_TX_SIZE_MIN    (1600)   // Ethernet frame of 1514 bytes with NTH16, NDP16 and padding
+
+#define CDC_NCM_ENTER_CRITICAL(ncm_dev) portENTER_CRITICAL(&(ncm_dev)->lock)
+#define CDC_NCM_EXIT_CRITICAL(ncm_dev)  portEXIT_CRITICAL(&(ncm_dev)->lock)
+
+typedef struct cdc_ncm_dev_s cdc_ncm_dev_t;
+
+struct cdc_ncm_dev_s {
+    esp_netif_driver_base_t base;         // I/O driver handle of esp_netif, must be the first member
+    cdc_acm_dev_hdl_t cdc_hdl;            // Underlying CDC-ACM device
+    cdc_ncm_host_model_t model;           // ECM, NCM or MBIM
+    uint8_t mac[6];                       // MAC address from the Ethernet Networking Functional Descriptor
+    bool mac_valid;                       // The MAC address was read from the device
+    uint16_t out_mps;                     // BULK OUT Maximum Packet Size, for ZLP avoidance
+    cdc_ncm_host_event_cb_t event_cb;     // User's event callback, can be NULL
+    cdc_ncm_host_ip_rx_cb_t ip_rx_cb;     // User's IP datagram callback of MBIM, can be NULL
+    void *user_arg;                       // User's argument of the callbacks
+    bool ready;                           // The device is set up, received data are dropped until then
+    bool link_up;                         // Last link state reported by the device, protected by lock
+    bool closed;                          // cdc_ncm_host_close() was called, protected by lock
+    struct {
+        uint8_t *pool;                    // RX blocks, each block_size long
+        size_t block_size;                // Size of one RX block
+        uint8_t block_num;                // Number of RX blocks
+        uint8_t blocks_in_use;            // RX blocks with references, protected by lock
+        uint32_t *refs;                   // References of each RX block: one for each datagram held by the TCP/IP stack or the user
+    } rx;
+    struct {
+        SemaphoreHandle_t mux;            // TX mutex, protects members below
+        cdc_ncm_ntb_parameters_t params;  // NTB parameters of the device
+        size_t ntb_size;                  // Maximum size of NTBs sent to the device
+        uint32_t timeout_ms;              // Timeout for a free OUT transfer
+        uint8_t *pending;                 // Lent OUT transfer buffer with NTB waiting for submission, NULL if there is none
+        cdc_ncm_ntb_t ntb;                // NTB in the pending buffer
+        uint16_t sequence;                // Sequence number of the next NTB
+        uint8_t in_flight;                // Submitted OUT transfers
+    } tx;
+    cdc_ncm_host_stats_t stats;           // Statistics counters, protected by lock
+    portMUX_TYPE lock;                    // Spinlock of this device
+};
+
+// Context of datagrams of one received NTB
+typedef struct {
+    cdc_ncm_dev_t *ncm_dev;
+    esp_netif_t *netif;
+    int block;
+    uint32_t datagram_cnt;
+} cdc_ncm_rx_ctx_t;
+
+static void ncm_dev_free(cdc_ncm_dev_t *ncm_dev)
+{
+    if (ncm_dev->tx.mux) {
+        vSemaphoreDelete(ncm_dev->tx.mux);
+    }
+    free(ncm_dev->rx.refs);
+    free(ncm_dev->rx.pool);
+    free(ncm_dev);
+}
+
+/**
+ * @brief Take a free RX block
+ *
+ * Blocks are taken only from the data callback, so a block cannot be taken twice.
+ *
+ * @return Index of the block with one reference, -1 if all blocks are held by the TCP/IP stack
+ */
+static int ncm_rx_block_take(cdc_ncm_dev_t *ncm_dev)
+{
+    for (int i = 0; i < ncm_dev->rx.block_num; i++) {
+        if (__atomic_load_n(&ncm_dev->rx.refs[i], __ATOMIC_ACQUIRE) == 0) {
+            __atomic_store_n(&ncm_dev->rx.refs[i], 1, __ATOMIC_RELAXED);
+            CDC_NCM_ENTER_CRITICAL(ncm_dev);
+            ncm_dev->rx.blocks_in_use++;
+            CDC_NCM_EXIT_CRITICAL(ncm_dev);
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Drop one reference of RX block
+ *
+ * The device is freed with the last RX block, if it was closed while the TCP/IP stack held received frames.
+ */
+static void ncm_rx_block_release(cdc_ncm_dev_t *ncm_dev, int block)
+{
+    if (__atomic_sub_fetch(&ncm_dev->rx.refs[block], 1, __ATOMIC_ACQ_REL) != 0) {
+        return;
+    }
+    CDC_NCM_ENTER_CRITICAL(ncm_dev);
+    ncm_dev->rx.blocks_in_use--;
+    const bool free_dev = ncm_dev->closed && (ncm_dev->rx.blocks_in_use == 0);
+    CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    if (free_dev) {
+        ncm_dev_free(ncm_dev);
+    }
+}
+
+/**
+ * @brief Pass datagram to the TCP/IP stack or to the user without copying it
+ *
+ * Each datagram holds a reference of its RX block until lwIP frees its pbuf by ncm_netif_free_rx_buffer(),
+ * or until the user releases it by cdc_ncm_host_ip_rx_free().
+ */
+static void ncm_rx_datagram(const uint8_t *datagram, size_t len, uint8_t session, void *arg)
+{
+    cdc_ncm_rx_ctx_t *ctx = (cdc_ncm_rx_ctx_t *)arg;
+    cdc_ncm_dev_t *ncm_dev = ctx->ncm_dev;
+    __atomic_add_fetch(&ncm_dev->rx.refs[ctx->block], 1, __ATOMIC_RELAXED);
+    if (ncm_dev->model == CDC_NCM_HOST_MODEL_MBIM) {
+        if (!ncm_dev->ip_rx_cb(ncm_dev, session, datagram, len, ncm_dev->user_arg)) {
+            ncm_rx_block_release(ncm_dev, ctx->block); // Datagram was consumed in the callback
+        }
+    } else {
+        esp_netif_receive(ctx->netif, (void *)datagram, len, (void *)datagram);
+    }
+    ctx->datagram_cnt++;
+}
+
+/**
+ * @brief Data callback of the CDC-ACM driver
+ *
+ * The NTB (or Ethernet frame) is copied once from the IN transfer to an RX block, so that the transfer is resubmitted right away
+ * while the datagrams in the block are held by the TCP/IP stack.
+ */
+static bool ncm_rx_cb(const uint8_t *data, size_t data_len, void *user_arg)
+{
+    cdc_ncm_dev_t *ncm_dev = (cdc_ncm_dev_t *)user_arg;
+    if (!__atomic_load_n(&ncm_dev->ready, __ATOMIC_ACQUIRE) || data_len == 0) {
+        return true;
+    }
+
+    cdc_ncm_rx_ctx_t ctx = {
+        .ncm_dev = ncm_dev,
+        .netif = __atomic_load_n(&ncm_dev->base.netif, __ATOMIC_ACQUIRE),
+        .block = -1,
+    };
+    const bool consumer = (ncm_dev->model == CDC_NCM_HOST_MODEL_MBIM) ? (ncm_dev->ip_rx_cb != NULL) : (ctx.netif != NULL);
+    if (consumer && data_len <= ncm_dev->rx.block_size) {
+        ctx.block = ncm_rx_block_take(ncm_dev);
+    }
+    if (ctx.block < 0) {
+        CDC_NCM_ENTER_CRITICAL(ncm_dev);
+        ncm_dev->stats.rx_ntbs++;
+        ncm_dev->stats.rx_dropped++;
+        CDC_NCM_EXIT_CRITICAL(ncm_dev);
+        return true;
+    }
+
+    uint8_t *block = ncm_dev->rx.pool + ctx.block * ncm_dev->rx.block_size;
+    memcpy(block, data, data_len);
+    bool malformed = false;
+    if (ncm_dev->model != CDC_NCM_HOST_MODEL_ECM) {
+        malformed = (cdc_ncm_ntb_parse(block, data_len, ncm_rx_datagram, &ctx, NULL) != ESP_OK);
+    } else {
+        ncm_rx_datagram(block, data_len, 0, &ctx);
+    }
+    ncm_rx_block_release(ncm_dev, ctx.block); // Reference of this function, the block stays taken by the datagrams
+
+    CDC_NCM_ENTER_CRITICAL(ncm_dev);
+    ncm_dev->stats.rx_ntbs++;
+    ncm_dev->stats.rx_datagrams += ctx.datagram_cnt;
+    if (malformed) {
+        ncm_dev->stats.rx_errors++;
+    }
+    CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    return true;
+}
+
+static bool ncm_rx_buffer_owned(const cdc_ncm_dev_t *ncm_dev, const uint8_t *datagram)
+{
+    return datagram >= ncm_dev->rx.pool && datagram < ncm_dev->rx.pool + ncm_dev->rx.block_num * ncm_dev->rx.block_size;
+}
+
+static void ncm_netif_free_rx_buffer(void *h, void *buffer)
+{
+    cdc_ncm_dev_t *ncm_dev = (cdc_ncm_dev_t *)h;
+    const uint8_t *datagram = (const uint8_t *)buffer;
+    assert(ncm_rx_buffer_owned(ncm_dev, datagram));
+    ncm_rx_block_release(ncm_dev, (int)((datagram - ncm_dev->rx.pool) / ncm_dev->rx.block_size));
+}
+
+static void ncm_tx_done_cb(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg);
+
+/**
+ * @brief Submit the pending NTB
+ *
+ * @note Called with TX mutex taken
+ */
+static esp_err_t ncm_tx_pending_submit(cdc_ncm_dev_t *ncm_dev)
+{
+    const size_t ntb_len = cdc_ncm_ntb_finalize(&ncm_dev->tx.ntb, ncm_dev->tx.sequence++, ncm_dev->out_mps);
+    uint8_t *buf = ncm_dev->tx.pending;
+    ncm_dev->tx.pending = NULL;
+
+    const esp_err_t ret = cdc_acm_host_data_tx_buffer_submit(ncm_dev->cdc_hdl, buf, ntb_len, ncm_tx_done_cb, ncm_dev);
+    if (ret == ESP_OK) {
+        ncm_dev->tx.in_flight++;
+        CDC_NCM_ENTER_CRITICAL(ncm_dev);
+        ncm_dev->stats.tx_ntbs++;
+        CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    }
+    return ret;
+}
+
+static void ncm_tx_done_cb(cdc_acm_dev_hdl_t cdc_hdl, esp_err_t status, void *user_arg)
+{
+    cdc_ncm_dev_t *ncm_dev = (cdc_ncm_dev_t *)user_arg;
+    // The OUT transfer is already back in the pool, so ncm_netif_transmit() cannot wait for it with the mutex taken
+    xSemaphoreTake(ncm_dev->tx.mux, portMAX_DELAY);
+    ncm_dev->tx.in_flight--;
+    if (ncm_dev->tx.pending && ncm_dev->tx.in_flight == 0) {
+        // Frames aggregated while the previous transfer was in flight
+        ncm_tx_pending_submit(ncm_dev);
+    }
+    xSemaphoreGive(ncm_dev->tx.mux);
+}
+
+/**
+ * @brief Send one Ethernet frame in its own transfer
+ *
+ * @note Called with TX mutex taken
+ */
+static esp_err_t ncm_tx_ecm(cdc_ncm_dev_t *ncm_dev, const uint8_t *frame, size_t len)
+{
+    uint8_t *buf;
+    size_t buf_size;
+    esp_err_t ret = cdc_acm_host_data_tx_buffer_get(ncm_dev->cdc_hdl, &buf, &buf_size, ncm_dev->tx.timeout_ms);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (len + 1 > buf_size) {
+        cdc_acm_host_data_tx_buffer_submit(ncm_dev->cdc_hdl, buf, 0, NULL, NULL);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, frame, len);
+    if (ncm_dev->out_mps != 0 && (len % ncm_dev->out_mps) == 0) {
+        // The frame would end with a full packet, one byte of padding makes a short packet instead of a ZLP
+        buf[len++] = 0;
+    }
+    ret = cdc_acm_host_data_tx_buffer_submit(ncm_dev->cdc_hdl, buf, len, ncm_tx_done_cb, ncm_dev);
+    if (ret == ESP_OK) {
+        ncm_dev->tx.in_flight++;
+        CDC_NCM_ENTER_CRITICAL(ncm_dev);
+        ncm_dev->stats.tx_ntbs++;
+        CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    }
+    return ret;
+}
+
+/**
+ * @brief Aggregate Ethernet frame or MBIM IP datagram into the pending NTB
+ *
+ * The NTB is submitted right away if no OUT transfer is in flight, so a single frame is not delayed.
+ * Otherwise frames are aggregated until the NTB is full or the transfer in flight finishes.
+ *
+ * @note Called with TX mutex taken
+ */
+static esp_err_t ncm_tx_ncm(cdc_ncm_dev_t *ncm_dev, uint8_t session, const uint8_t *frame, size_t len)
+{
+    esp_err_t ret;
+    if (ncm_dev->tx.pending && !cdc_ncm_ntb_append(&ncm_dev->tx.ntb, session, frame, len)) {
+        // The pending NTB is full
+        ret = ncm_tx_pending_submit(ncm_dev);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (!ncm_dev->tx.pending) {
+        uint8_t *buf;
+        size_t buf_size;
+        ret = cdc_acm_host_data_tx_buffer_get(ncm_dev->cdc_hdl, &buf, &buf_size, ncm_dev->tx.timeout_ms);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        cdc_ncm_ntb_init(&ncm_dev->tx.ntb, buf, (buf_size < ncm_dev->tx.ntb_size) ? buf_size : ncm_dev->tx.ntb_size, &ncm_dev->tx.params,
+                         ncm_dev->model == CDC_NCM_HOST_MODEL_MBIM);
+        if (!cdc_ncm_ntb_append(&ncm_dev->tx.ntb, session, frame, len)) {
+            cdc_acm_host_data_tx_buffer_submit(ncm_dev->cdc_hdl, buf, 0, NULL, NULL);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        ncm_dev->tx.pending = buf;
+    }
+
+    if (ncm_dev->tx.in_flight == 0) {
+        return ncm_tx_pending_submit(ncm_dev);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ncm_tx(cdc_ncm_dev_t *ncm_dev, uint8_t session, const uint8_t *datagram, size_t len)
+{
+    xSemaphoreTake(ncm_dev->tx.mux, portMAX_DELAY);
+    const esp_err_t ret = (ncm_dev->model != CDC_NCM_HOST_MODEL_ECM) ?
+                          ncm_tx_ncm(ncm_dev, session, datagram, len) :
+                          ncm_tx_ecm(ncm_dev, datagram, len);
+    xSemaphoreGive(ncm_dev->tx.mux);
+
+    CDC_NCM_ENTER_CRITICAL(ncm_dev);
+    if (ret == ESP_OK) {
+        ncm_dev->stats.tx_datagrams++;
+    } else {
+        ncm_dev->stats.tx_dropped++;
+    }
+    CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    return ret;
+}
+
+static esp_err_t ncm_netif_transmit(void *h, void *buffer, size_t len)
+{
+    return ncm_tx((cdc_ncm_dev_t *)h, 0, (const uint8_t *)buffer, len);
+}
+
+static void ncm_link_set(cdc_ncm_dev_t *ncm_dev, bool up)
+{
+    CDC_NCM_ENTER_CRITICAL(ncm_dev);
+    const bool changed = (ncm_dev->link_up != up);
+    ncm_dev->link_up = up;
+    esp_netif_t *netif = ncm_dev->base.netif;
+    CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    if (!changed) {
+        return;
+    }
+
+    ESP_LOGI(TAG, "Link %s", up ? "up" : "down");
+    if (netif) {
+        if (up) {
+            esp_netif_action_connected(netif, NULL, 0, NULL);
+        } else {
+            esp_netif_action_disconnected(netif, NULL, 0, NULL);
+        }
+    }
+    if (ncm_dev->event_cb) {
+        ncm_dev->event_cb(ncm_dev, up ? CDC_NCM_HOST_LINK_UP : CDC_NCM_HOST_LINK_DOWN, ncm_dev->user_arg);
+    }
+}
+
+static void ncm_event_cb(const cdc_acm_host_dev_event_data_t *event, void *user_ctx)
+{
+    cdc_ncm_dev_t *ncm_dev = (cdc_ncm_dev_t *)user_ctx;
+    switch (event->type) {
+    case CDC_ACM_HOST_NETWORK_CONNECTION:
+        ncm_link_set(ncm_dev, event->data.network_connected);
+        break;
+    case CDC_ACM_HOST_DEVICE_DISCONNECTED:
+        ncm_link_set(ncm_dev, false);
+        if (ncm_dev->event_cb) {
+            ncm_dev->event_cb(ncm_dev, CDC_NCM_HOST_DEVICE_DISCONNECTED, ncm_dev->user_arg);
+        }
+        break;
+    case CDC_ACM_HOST_RESPONSE_AVAILABLE:
+        if (ncm_dev->event_cb) {
+            ncm_dev->event_cb(ncm_dev, CDC_NCM_HOST_RESPONSE_AVAILABLE, ncm_dev->user_arg);
+        }
+        break;
+    case CDC_ACM_HOST_ERROR:
+        ESP_LOGW(TAG, "CDC-ACM error has occurred, err_no = %d", event->data.error);
+        break;
+    default:
+        break;
+    }
+}
+
+static esp_err_t ncm_post_attach(esp_netif_t *netif, esp_netif_iodriver_handle h)
+{
+    cdc_ncm_dev_t *ncm_dev = (cdc_ncm_dev_t *)h;
+    // MBIM carries IP datagrams without Ethernet header, they are exchanged by cdc_ncm_host_ip_tx() and ip_rx_cb
+    ESP_RETURN_ON_FALSE(ncm_dev->model != CDC_NCM_HOST_MODEL_MBIM, ESP_ERR_NOT_SUPPORTED, TAG, "MBIM device cannot be attached to Ethernet esp_netif");
+    const esp_netif_driver_ifconfig_t driver_ifconfig = {
+        .handle = ncm_dev,
+        .transmit = ncm_netif_transmit,
+        .driver_free_rx_buffer = ncm_netif_free_rx_buffer,
+    };
+    ESP_RETURN_ON_ERROR(esp_netif_set_driver_config(netif, &driver_ifconfig), TAG, "Could not set driver config");
+    if (ncm_dev->mac_valid) {
+        ESP_RETURN_ON_ERROR(esp_netif_set_mac(netif, ncm_dev->mac), TAG, "Could not set MAC address");
+    }
+
+    CDC_NCM_ENTER_CRITICAL(ncm_dev);
+    __atomic_store_n(&ncm_dev->base.netif, netif, __ATOMIC_RELEASE);
+    const bool link_up = ncm_dev->link_up;
+    CDC_NCM_EXIT_CRITICAL(ncm_dev);
+
+    esp_netif_action_start(netif, NULL, 0, NULL);
+    if (link_up) {
+        esp_netif_action_connected(netif, NULL, 0, NULL);
+    }
+    return ESP_OK;
+}
+
+static int ncm_hex_digit(uint16_t c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Read MAC address from the string descriptor of Ethernet Networking Functional Descriptor
+ */
+static esp_err_t ncm_mac_read(cdc_ncm_dev_t *ncm_dev, uint8_t mac_str_idx)
+{
+    uint8_t str_desc[2 + 12 * 2]; // bLength, bDescriptorType and 12 hexadecimal digits in UTF-16LE
+    ESP_RETURN_ON_FALSE(mac_str_idx != 0, ESP_ERR_NOT_FOUND, TAG, "No MAC address string");
+    ESP_RETURN_ON_ERROR(
+        cdc_acm_host_send_custom_request(
+            ncm_dev->cdc_hdl, USB_BM_REQUEST_TYPE_DIR_IN | USB_BM_REQUEST_TYPE_TYPE_STANDARD | USB_BM_REQUEST_TYPE_RECIP_DEVICE,
+            USB_B_REQUEST_GET_DESCRIPTOR, (USB_B_DESCRIPTOR_TYPE_STRING << 8) | mac_str_idx, CDC_NCM_MAC_STR_LANGID,
+            sizeof(str_desc), str_desc), TAG, "Could not read MAC address string");
+    ESP_RETURN_ON_FALSE(str_desc[0] >= sizeof(str_desc) && str_desc[1] == USB_B_DESCRIPTOR_TYPE_STRING,
+                        ESP_ERR_NOT_FOUND, TAG, "Invalid MAC address string");
+
+    for (int i = 0; i < 12; i++) {
+        const int digit = ncm_hex_digit(str_desc[2 + 2 * i] | (str_desc[3 + 2 * i] << 8));
+        ESP_RETURN_ON_FALSE(digit >= 0, ESP_ERR_NOT_FOUND, TAG, "Invalid MAC address string");
+        ncm_dev->mac[i / 2] = (ncm_dev->mac[i / 2] << 4) | digit;
+    }
+    ncm_dev->mac_valid = true;
+    return ESP_OK;
+}
+
+static esp_err_t ncm_out_mps_get(cdc_ncm_dev_t *ncm_dev)
+{
+    const usb_config_desc_t *config_desc;
+    ESP_RETURN_ON_ERROR(usb_host_get_active_config_descriptor(ncm_dev->cdc_hdl->dev_hdl, &config_desc), TAG,);
+    const usb_intf_desc_t *data_intf = ncm_dev->cdc_hdl->data.intf_desc;
+    for (int i = 0; i < data_intf->bNumEndpoints; i++) {
+        int offset = (int)((const uint8_t *)data_intf - (const uint8_t *)config_desc);
+        const usb_ep_desc_t *ep = usb_parse_endpoint_descriptor_by_index(data_intf, i, config_desc->wTotalLength, &offset);
+        if (ep && !USB_EP_DESC_GET_EP_DIR(ep) && USB_EP_DESC_GET_XFERTYPE(ep) == USB_TRANSFER_TYPE_BULK) {
+            ncm_dev->out_mps = USB_EP_DESC_GET_MPS(ep);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+/**
+ * @brief Detect networking model and configure the device
+ *
+ * The interface was parsed and claimed by cdc_acm_host_open(), its descriptors are taken from the CDC-ACM device.
+ */
+static esp_err_t ncm_device_setup(cdc_ncm_dev_t *ncm_dev, size_t rx_ntb_size, size_t tx_ntb_size)
+{
+    cdc_acm_dev_hdl_t cdc_hdl = ncm_dev->cdc_hdl;
+    const usb_intf_desc_t *comm_intf = cdc_hdl->notif.intf_desc;
+    ESP_RETURN_ON_FALSE(comm_intf && comm_intf->bInterfaceClass == USB_CLASS_COMM, ESP_ERR_NOT_SUPPORTED, TAG, "Not a CDC interface");
+    switch (comm_intf->bInterfaceSubClass) {
+    case USB_CDC_SUBCLASS_ECM:
+        ncm_dev->model = CDC_NCM_HOST_MODEL_ECM;
+        break;
+    case USB_CDC_SUBCLASS_NCM:
+        ncm_dev->model = CDC_NCM_HOST_MODEL_NCM;
+        break;
+    case USB_CDC_SUBCLASS_MBIM:
+        ncm_dev->model = CDC_NCM_HOST_MODEL_MBIM;
+        break;
+    default:
+        ESP_LOGE(TAG, "Interface subclass 0x%02X is not ECM, NCM or MBIM", comm_intf->bInterfaceSubClass);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    const uint8_t intf_num = comm_intf->bInterfaceNumber;
+    ESP_RETURN_ON_ERROR(ncm_out_mps_get(ncm_dev), TAG, "BULK OUT endpoint not found");
+
+    // MBIM has no Ethernet Networking Functional Descriptor, IP datagrams are sent without MAC addresses
+    const cdc_ecm_eth_desc_t *eth_desc = NULL;
+    if (ncm_dev->model != CDC_NCM_HOST_MODEL_MBIM) {
+        if (cdc_acm_host_cdc_desc_get(cdc_hdl, USB_CDC_DESC_SUBTYPE_ETH, (const usb_standard_desc_t **)&eth_desc) == ESP_OK) {
+            if (ncm_mac_read(ncm_dev, eth_desc->iMACAddress) != ESP_OK) {
+                ESP_LOGW(TAG, "MAC address of esp_netif is not changed");
+            }
+        } else {
+            ESP_LOGW(TAG, "Ethernet Networking Functional Descriptor not found");
+        }
+    }
+
+    // ECM frames are not aggregated, an RX block holds one frame
+    ncm_dev->rx.block_size = rx_ntb_size;
+    ncm_dev->tx.ntb_size = tx_ntb_size;
+    if (ncm_dev->model == CDC_NCM_HOST_MODEL_ECM) {
+        if (eth_desc && eth_desc->wMaxSegmentSize > 0 && eth_desc->wMaxSegmentSize < rx_ntb_size) {
+            ncm_dev->rx.block_size = eth_desc->wMaxSegmentSize;
+        }
+    } else {
+        cdc_ncm_ntb_parameters_t *params = &ncm_dev->tx.params;
+        ESP_RETURN_ON_ERROR(
+            cdc_acm_host_send_custom_request(cdc_hdl, CDC_NCM_READ_REQ, USB_CDC_REQ_GET_NTB_PARAMETERS, 0, intf_num, sizeof(cdc_ncm_ntb_parameters_t), (uint8_t *)params),
+            TAG, "Could not get NTB parameters");
+        ESP_RETURN_ON_FALSE(params->bmNtbFormatsSupported & CDC_NCM_NTB16_FORMAT, ESP_ERR_NOT_SUPPORTED, TAG, "NTB16 format not supported");
+        if (params->dwNtbOutMaxSize < tx_ntb_size) {
+            ncm_dev->tx.ntb_size = params->dwNtbOutMaxSize;
+        }
+        if (params->dwNtbInMaxSize > rx_ntb_size) {
+            // NTBs of the device must fit into one IN transfer
+            uint32_t ntb_in_size = rx_ntb_size;
+            ESP_RETURN_ON_ERROR(
+                cdc_acm_host_send_custom_request(cdc_hdl, CDC_NCM_WRITE_REQ, USB_CDC_REQ_SET_NTB_INPUT_SIZE, 0, intf_num, sizeof(ntb_in_size), (uint8_t *)&ntb_in_size),
+                TAG, "Could not set NTB input size");
+        }
+        ESP_LOGD(TAG, "NTB in %"PRIu32" (%d), out %"PRIu32" bytes", params->dwNtbInMaxSize, (int)rx_ntb_size, params->dwNtbOutMaxSize);
+    }
+
+    // Optional request, some devices forward directed and broadcast frames without it and stall it
+    if (ncm_dev->model != CDC_NCM_HOST_MODEL_MBIM && cdc_acm_host_send_custom_request(cdc_hdl, CDC_NCM_WRITE_REQ, USB_CDC_REQ_SET_ETHERNET_PACKET_FILTER,
+                                         CDC_ECM_PACKET_TYPE_DIRECTED | CDC_ECM_PACKET_TYPE_BROADCAST | CDC_ECM_PACKET_TYPE_ALL_MULTICAST,
+                                         intf_num, 0, NULL) != ESP_OK) {
+        ESP_LOGW(TAG, "Packet filter not set");
+    }
+    return ESP_OK;
+}
+
+esp_err_t cdc_ncm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_ncm_host_device_config_t *config, cdc_ncm_dev_hdl_t *ncm_hdl_ret)
+{
+    esp_err_t ret;
+    ESP_RETURN_ON_FALSE(config && ncm_hdl_ret, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    const size_t rx_ntb_size = config->rx_ntb_size ? config->rx_ntb_size : CDC_NCM_HOST_RX_NTB_SIZE_DEFAULT;
+    const size_t tx_ntb_size = config->tx_ntb_size ? config->tx_ntb_size : CDC_NCM_HOST_TX_NTB_SIZE_DEFAULT;
+    ESP_RETURN_ON_FALSE(tx_ntb_size >= CDC_NCM_TX_SIZE_MIN, ESP_ERR_INVALID_ARG, TAG, "TX NTB size must be at least %d", CDC_NCM_TX_SIZE_MIN);
+
+    cdc_ncm_dev_t *ncm_dev = calloc(1, sizeof(cdc_ncm_dev_t));
+    ESP_RETURN_ON_FALSE(ncm_dev, ESP_ERR_NO_MEM, TAG,);
+    ncm_dev->base.post_attach = ncm_post_attach;
+    ncm_dev->event_cb = config->event_cb;
+    ncm_dev->ip_rx_cb = config->ip_rx_cb;
+    ncm_dev->user_arg = config->user_arg;
+    portMUX_INITIALIZE(&ncm_dev->lock);
+    ncm_dev->tx.timeout_ms = config->tx_timeout_ms;
+    ncm_dev->tx.mux = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(ncm_dev->tx.mux, ESP_ERR_NO_MEM, err, TAG,);
+
+    const cdc_acm_host_device_config_t acm_config = {
+        .connection_timeout_ms = config->connection_timeout_ms,
+        .out_buffer_size = tx_ntb_size,
+        .in_buffer_size = rx_ntb_size,
+        .event_cb = ncm_event_cb,
+        .data_cb = ncm_rx_cb,
+        .user_arg = ncm_dev,
+        .in_xfer_count = config->rx_xfer_count ? config->rx_xfer_count : CDC_NCM_HOST_RX_XFER_COUNT_DEFAULT,
+        .out_xfer_count = config->tx_xfer_count ? config->tx_xfer_count : CDC_NCM_HOST_TX_XFER_COUNT_DEFAULT,
+    };
+    ESP_GOTO_ON_ERROR(cdc_acm_host_open(vid, pid, interface_idx, &acm_config, &ncm_dev->cdc_hdl), err, TAG, "Could not open CDC interface");
+    ESP_GOTO_ON_ERROR(ncm_device_setup(ncm_dev, rx_ntb_size, tx_ntb_size), err, TAG,);
+
+    // RX blocks are allocated once the networking model is known, received data are dropped until then
+    ncm_dev->rx.block_size = (ncm_dev->rx.block_size + 3) & ~3; // Datagrams of each block start word aligned
+    ncm_dev->rx.block_num = config->rx_block_count ? config->rx_block_count : CDC_NCM_HOST_RX_BLOCK_COUNT_DEFAULT;
+    ncm_dev->rx.pool = malloc(ncm_dev->rx.block_num * ncm_dev->rx.block_size);
+    ncm_dev->rx.refs = calloc(ncm_dev->rx.block_num, sizeof(uint32_t));
+    ESP_GOTO_ON_FALSE(ncm_dev->rx.pool && ncm_dev->rx.refs, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for RX blocks");
+    __atomic_store_n(&ncm_dev->ready, true, __ATOMIC_RELEASE);
+
+    if (ncm_dev->cdc_hdl->notif.xfer == NULL) {
+        // No notification endpoint, the device cannot report its link state
+        ncm_link_set(ncm_dev, true);
+    }
+    static const char *const model_names[] = {"ECM", "NCM", "MBIM"};
+    ESP_LOGI(TAG, "CDC-%s device opened", model_names[ncm_dev->model]);
+    *ncm_hdl_ret = ncm_dev;
+    return ESP_OK;
+
+err:
+    if (ncm_dev->cdc_hdl) {
+        cdc_acm_host_close(ncm_dev->cdc_hdl);
+    }
+    ncm_dev_free(ncm_dev);
+    *ncm_hdl_ret = NULL;
+    return ret;
+}
+
+esp_err_t cdc_ncm_host_close(cdc_ncm_dev_hdl_t ncm_hdl)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl, ESP_ERR_INVALID_ARG, TAG, "Invalid handle");
+    cdc_ncm_dev_t *ncm_dev = ncm_hdl;
+
+    // Received data are dropped and lwIP stops calling ncm_netif_transmit() from this point, cdc_ncm_host_ip_tx() fails
+    __atomic_store_n(&ncm_dev->ready, false, __ATOMIC_RELEASE);
+    esp_netif_t *netif = __atomic_load_n(&ncm_dev->base.netif, __ATOMIC_ACQUIRE);
+    if (netif) {
+        esp_netif_action_disconnected(netif, NULL, 0, NULL);
+        esp_netif_action_stop(netif, NULL, 0, NULL);
+    }
+
+    // Return the lent buffer of the pending NTB, transfers in flight are canceled by the CDC-ACM driver
+    xSemaphoreTake(ncm_dev->tx.mux, portMAX_DELAY);
+    if (ncm_dev->tx.pending) {
+        cdc_acm_host_data_tx_buffer_submit(ncm_dev->cdc_hdl, ncm_dev->tx.pending, 0, NULL, NULL);
+        ncm_dev->tx.pending = NULL;
+    }
+    xSemaphoreGive(ncm_dev->tx.mux);
+    ESP_RETURN_ON_ERROR(cdc_acm_host_close(ncm_dev->cdc_hdl), TAG, "Could not close CDC interface");
+
+    // The TCP/IP stack may still hold received frames, the last released RX block frees the device
+    CDC_NCM_ENTER_CRITICAL(ncm_dev);
+    ncm_dev->closed = true;
+    const bool free_dev = (ncm_dev->rx.blocks_in_use == 0);
+    CDC_NCM_EXIT_CRITICAL(ncm_dev);
+    if (free_dev) {
+        ncm_dev_free(ncm_dev);
+    }
+    return ESP_OK;
+}
+
+esp_netif_iodriver_handle cdc_ncm_host_netif_glue(cdc_ncm_dev_hdl_t ncm_hdl)
+{
+    return ncm_hdl ? &ncm_hdl->base : NULL;
+}
+
+esp_err_t cdc_ncm_host_mac_get(cdc_ncm_dev_hdl_t ncm_hdl, uint8_t mac[6])
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && mac, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    ESP_RETURN_ON_FALSE(ncm_hdl->mac_valid, ESP_ERR_NOT_FOUND, TAG, "No valid MAC address");
+    memcpy(mac, ncm_hdl->mac, sizeof(ncm_hdl->mac));
+    return ESP_OK;
+}
+
+esp_err_t cdc_ncm_host_model_get(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_model_t *model)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && model, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    *model = ncm_hdl->model;
+    return ESP_OK;
+}
+
+esp_err_t cdc_ncm_host_get_stats(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    CDC_NCM_ENTER_CRITICAL(ncm_hdl);
+    *stats = ncm_hdl->stats;
+    CDC_NCM_EXIT_CRITICAL(ncm_hdl);
+    return ESP_OK;
+}
+
+cdc_acm_dev_hdl_t cdc_ncm_host_acm_handle(cdc_ncm_dev_hdl_t ncm_hdl)
+{
+    return ncm_hdl ? ncm_hdl->cdc_hdl : NULL;
+}
+
+esp_err_t cdc_ncm_host_ip_tx(cdc_ncm_dev_hdl_t ncm_hdl, uint8_t session, const uint8_t *datagram, size_t len)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && datagram && len > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    ESP_RETURN_ON_FALSE(ncm_hdl->model == CDC_NCM_HOST_MODEL_MBIM, ESP_ERR_NOT_SUPPORTED, TAG, "Not an MBIM device");
+    ESP_RETURN_ON_FALSE(__atomic_load_n(&ncm_hdl->ready, __ATOMIC_ACQUIRE), ESP_ERR_INVALID_STATE, TAG, "Device closed");
+    return ncm_tx(ncm_hdl, session, datagram, len);
+}
+
+esp_err_t cdc_ncm_host_ip_rx_free(cdc_ncm_dev_hdl_t ncm_hdl, const uint8_t *datagram)
+{
+    ESP_RETURN_ON_FALSE(ncm_hdl && datagram, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    ESP_RETURN_ON_FALSE(ncm_rx_buffer_owned(ncm_hdl, datagram), ESP_ERR_INVALID_ARG, TAG, "Datagram not received by this device");
+    ncm_rx_block_release(ncm_hdl, (int)((datagram - ncm_hdl->rx.pool) / ncm_hdl->rx.block_size));
+    return ESP_OK;
+}
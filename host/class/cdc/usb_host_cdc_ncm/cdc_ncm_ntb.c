@@ -0,0 +1,234 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <string.h>
+#include "esp_check.h"
+#include "cdc_ncm_ntb.h"
+
+static const char *TAG = "cdc_ncm_ntb";
+
+#define CDC_NCM_NDP_CHAIN_MAX (8) // Maximum number of NDP16 in one received NTB, guards against NDP loops
+#define CDC_NCM_CRC_LEN       (4) // Datagrams of NDP16 with CRC end with CRC-32
+
+/**
+ * @brief NCM Transfer Header, 16-bit
+ *
+ * @see Table 3-1, USB NCM specification rev. 1.0
+ */
+typedef struct {
+    uint32_t dwSignature;
+    uint16_t wHeaderLength;
+    uint16_t wSequence;
+    uint16_t wBlockLength;
+    uint16_t wNdpIndex;
+} __attribute__((packed)) cdc_ncm_nth16_t;
+
+/**
+ * @brief NCM Datagram Pointer Table, 16-bit
+ *
+ * @see Table 3-3, USB NCM specification rev. 1.0
+ */
+typedef struct {
+    uint32_t dwSignature;
+    uint16_t wLength;
+    uint16_t wNextNdpIndex;
+    struct {
+        uint16_t wDatagramIndex;
+        uint16_t wDatagramLength;
+    } __attribute__((packed)) datagram[]; // Terminated by entry with zero index and length
+} __attribute__((packed)) cdc_ncm_ndp16_t;
+
+static size_t ntb_align_up(size_t offset, size_t alignment)
+{
+    return ((offset + alignment - 1) / alignment) * alignment;
+}
+
+// First offset from 'offset' on, at which (offset % divisor) == remainder
+static size_t ntb_payload_offset(const cdc_ncm_ntb_t *ntb, size_t offset)
+{
+    if (offset <= ntb->remainder) {
+        return ntb->remainder;
+    }
+    return ntb->remainder + ntb_align_up(offset - ntb->remainder, ntb->divisor);
+}
+
+// NDP16 with 'datagram_cnt' entries and the terminating entry
+static size_t ntb_ndp_len(size_t datagram_cnt)
+{
+    return sizeof(cdc_ncm_ndp16_t) + (datagram_cnt + 1) * sizeof(((cdc_ncm_ndp16_t *)0)->datagram[0]);
+}
+
+// All NDP16s, if datagram of sessions[session] was added. Each NDP16 starts aligned
+static size_t ntb_ndps_len(const cdc_ncm_ntb_t *ntb, uint8_t session)
+{
+    const uint8_t session_cnt = (session < ntb->session_cnt) ? ntb->session_cnt : session + 1;
+    size_t len = 0;
+    for (uint8_t i = 0; i < session_cnt; i++) {
+        const size_t datagram_cnt = ((i < ntb->session_cnt) ? ntb->sessions[i].datagram_cnt : 0) + ((i == session) ? 1 : 0);
+        len += ntb_align_up(ntb_ndp_len(datagram_cnt), ntb->ndp_alignment);
+    }
+    return len;
+}
+
+void cdc_ncm_ntb_init(cdc_ncm_ntb_t *ntb, uint8_t *buf, size_t size, const cdc_ncm_ntb_parameters_t *params, bool mbim)
+{
+    assert(ntb && buf);
+    memset(ntb, 0, sizeof(cdc_ncm_ntb_t));
+    ntb->buf = buf;
+    ntb->size = (size > UINT16_MAX) ? UINT16_MAX : size; // Offsets of NTB16 are 16-bit
+    ntb->len = sizeof(cdc_ncm_nth16_t);
+    ntb->divisor = 1;
+    ntb->ndp_alignment = 4;
+    ntb->datagrams_max = CDC_NCM_TX_DATAGRAMS_MAX;
+    ntb->mbim = mbim;
+    if (params) {
+        if (params->wNdpOutDivisor > 1) {
+            ntb->divisor = params->wNdpOutDivisor;
+            ntb->remainder = params->wNdpOutPayloadRemainder % params->wNdpOutDivisor;
+        }
+        if (params->wNdpOutAlignment > 4) {
+            ntb->ndp_alignment = params->wNdpOutAlignment;
+        }
+        if (params->wNtbOutMaxDatagrams != 0 && params->wNtbOutMaxDatagrams < CDC_NCM_TX_DATAGRAMS_MAX) {
+            ntb->datagrams_max = params->wNtbOutMaxDatagrams;
+        }
+    }
+}
+
+bool cdc_ncm_ntb_append(cdc_ncm_ntb_t *ntb, uint8_t session, const uint8_t *datagram, size_t len)
+{
+    if (len == 0 || ntb->datagram_cnt >= ntb->datagrams_max) {
+        return false;
+    }
+    const uint8_t id = ntb->mbim ? session : 0;
+    uint8_t s = 0;
+    while (s < ntb->session_cnt && ntb->sessions[s].id != id) {
+        s++;
+    }
+    if (s == CDC_NCM_TX_SESSIONS_MAX) {
+        return false;
+    }
+    const size_t index = ntb_payload_offset(ntb, ntb->len);
+    const size_t end = index + len;
+
+    // NDP16s pointing to the datagrams and one byte of ZLP padding must fit behind it
+    if (ntb_align_up(end, ntb->ndp_alignment) + ntb_ndps_len(ntb, s) + 1 > ntb->size) {
+        return false;
+    }
+    if (s == ntb->session_cnt) {
+        ntb->sessions[s].id = id;
+        ntb->sessions[s].datagram_cnt = 0;
+        ntb->session_cnt++;
+    }
+    memcpy(ntb->buf + index, datagram, len);
+    ntb->datagrams[ntb->datagram_cnt].index = (uint16_t)index;
+    ntb->datagrams[ntb->datagram_cnt].len = (uint16_t)len;
+    ntb->datagrams[ntb->datagram_cnt].session = s;
+    ntb->datagram_cnt++;
+    ntb->sessions[s].datagram_cnt++;
+    ntb->len = end;
+    return true;
+}
+
+size_t cdc_ncm_ntb_finalize(cdc_ncm_ntb_t *ntb, uint16_t sequence, uint16_t mps)
+{
+    assert(ntb->datagram_cnt > 0);
+    const size_t first_ndp_index = ntb_align_up(ntb->len, ntb->ndp_alignment);
+    size_t ndp_index = first_ndp_index;
+    size_t block_len = 0;
+
+    // One NDP16 for each session, chained in the order of their first datagrams
+    for (uint8_t s = 0; s < ntb->session_cnt; s++) {
+        const size_t ndp_len = ntb_ndp_len(ntb->sessions[s].datagram_cnt);
+        const size_t next_ndp_index = (s + 1 < ntb->session_cnt) ? ntb_align_up(ndp_index + ndp_len, ntb->ndp_alignment) : 0;
+        cdc_ncm_ndp16_t *ndp = (cdc_ncm_ndp16_t *)(ntb->buf + ndp_index);
+        ndp->dwSignature = ntb->mbim ? (CDC_MBIM_NDP16_SIGNATURE_IPS | ((uint32_t)ntb->sessions[s].id << 24)) : CDC_NCM_NDP16_SIGNATURE_NOCRC;
+        ndp->wLength = (uint16_t)ndp_len;
+        ndp->wNextNdpIndex = (uint16_t)next_ndp_index;
+        uint16_t entry = 0;
+        for (uint16_t i = 0; i < ntb->datagram_cnt; i++) {
+            if (ntb->datagrams[i].session == s) {
+                ndp->datagram[entry].wDatagramIndex = ntb->datagrams[i].index;
+                ndp->datagram[entry].wDatagramLength = ntb->datagrams[i].len;
+                entry++;
+            }
+        }
+        ndp->datagram[entry].wDatagramIndex = 0;
+        ndp->datagram[entry].wDatagramLength = 0;
+        block_len = ndp_index + ndp_len;
+        ndp_index = next_ndp_index;
+    }
+
+    if (mps != 0 && (block_len % mps) == 0) {
+        // Short packet terminates the NTB instead of a ZLP, the padding byte was reserved by cdc_ncm_ntb_append()
+        ntb->buf[block_len++] = 0;
+    }
+
+    cdc_ncm_nth16_t *nth = (cdc_ncm_nth16_t *)ntb->buf;
+    nth->dwSignature = CDC_NCM_NTH16_SIGNATURE;
+    nth->wHeaderLength = sizeof(cdc_ncm_nth16_t);
+    nth->wSequence = sequence;
+    nth->wBlockLength = (uint16_t)block_len;
+    nth->wNdpIndex = (uint16_t)first_ndp_index;
+    return block_len;
+}
+
+esp_err_t cdc_ncm_ntb_parse(const uint8_t *data, size_t len, cdc_ncm_datagram_cb_t cb, void *arg, size_t *datagram_cnt)
+{
+    esp_err_t ret = ESP_OK;
+    size_t cnt = 0;
+
+    const cdc_ncm_nth16_t *nth = (const cdc_ncm_nth16_t *)data;
+    ESP_GOTO_ON_FALSE(len >= sizeof(cdc_ncm_nth16_t) &&
+                      nth->dwSignature == CDC_NCM_NTH16_SIGNATURE &&
+                      nth->wHeaderLength == sizeof(cdc_ncm_nth16_t),
+                      ESP_ERR_INVALID_RESPONSE, done, TAG, "Invalid NTH16");
+    const size_t block_len = nth->wBlockLength;
+    ESP_GOTO_ON_FALSE(block_len >= sizeof(cdc_ncm_nth16_t) && block_len <= len,
+                      ESP_ERR_INVALID_RESPONSE, done, TAG, "Invalid NTB length %d of %d received bytes", (int)block_len, (int)len);
+
+    size_t ndp_index = nth->wNdpIndex;
+    for (int i = 0; ndp_index != 0; i++) {
+        ESP_GOTO_ON_FALSE(i < CDC_NCM_NDP_CHAIN_MAX && (ndp_index % 4) == 0 &&
+                          ndp_index >= sizeof(cdc_ncm_nth16_t) && ndp_index + sizeof(cdc_ncm_ndp16_t) <= block_len,
+                          ESP_ERR_INVALID_RESPONSE, done, TAG, "Invalid NDP16 index %d", (int)ndp_index);
+        const cdc_ncm_ndp16_t *ndp = (const cdc_ncm_ndp16_t *)(data + ndp_index);
+        const uint32_t signature = ndp->dwSignature;
+        const bool crc = (signature == CDC_NCM_NDP16_SIGNATURE_CRC);
+        const bool ips = ((signature & CDC_MBIM_NDP16_SIGNATURE_MASK) == CDC_MBIM_NDP16_SIGNATURE_IPS);
+        const bool dss = ((signature & CDC_MBIM_NDP16_SIGNATURE_MASK) == CDC_MBIM_NDP16_SIGNATURE_DSS);
+        ESP_GOTO_ON_FALSE((crc || ips || dss || signature == CDC_NCM_NDP16_SIGNATURE_NOCRC) &&
+                          ndp->wLength >= ntb_ndp_len(1) && (ndp->wLength % 4) == 0 &&
+                          ndp_index + ndp->wLength <= block_len,
+                          ESP_ERR_INVALID_RESPONSE, done, TAG, "Invalid NDP16");
+        const uint8_t session = ips ? (uint8_t)(signature >> 24) : 0;
+
+        // Device Service Streams are not IP traffic, skip them
+        const size_t entries = dss ? 0 : (ndp->wLength - sizeof(cdc_ncm_ndp16_t)) / sizeof(ndp->datagram[0]);
+        for (size_t j = 0; j < entries; j++) {
+            const size_t index = ndp->datagram[j].wDatagramIndex;
+            size_t datagram_len = ndp->datagram[j].wDatagramLength;
+            if (index == 0 || datagram_len == 0) {
+                break; // Terminating entry
+            }
+            ESP_GOTO_ON_FALSE(index + datagram_len <= block_len && (!crc || datagram_len > CDC_NCM_CRC_LEN),
+                              ESP_ERR_INVALID_RESPONSE, done, TAG, "Datagram out of NTB");
+            if (crc) {
+                datagram_len -= CDC_NCM_CRC_LEN;
+            }
+            cb(data + index, datagram_len, session, arg);
+            cnt++;
+        }
+        ndp_index = ndp->wNextNdpIndex;
+    }
+
+done:
+    if (datagram_cnt) {
+        *datagram_cnt = cnt;
+    }
+    return ret;
+}
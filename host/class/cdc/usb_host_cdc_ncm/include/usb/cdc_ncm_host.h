@@ -0,0 +1,240 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "usb/cdc_acm_host.h"
+
+// Defaults used for zero fields of cdc_ncm_host_device_config_t
+#define CDC_NCM_HOST_RX_NTB_SIZE_DEFAULT    (4096)
+#define CDC_NCM_HOST_RX_XFER_COUNT_DEFAULT  (2)
+#define CDC_NCM_HOST_RX_BLOCK_COUNT_DEFAULT (8)
+#define CDC_NCM_HOST_TX_NTB_SIZE_DEFAULT    (4096)
+#define CDC_NCM_HOST_TX_XFER_COUNT_DEFAULT  (2)
+
+typedef struct cdc_ncm_dev_s *cdc_ncm_dev_hdl_t;
+
+/**
+ * @brief Networking model of the opened interface
+ */
+typedef enum {
+    CDC_NCM_HOST_MODEL_ECM,             /**< Ethernet Control Model: one Ethernet frame per transfer */
+    CDC_NCM_HOST_MODEL_NCM,             /**< Network Control Model: several Ethernet frames per NCM Transfer Block (NTB) */
+    CDC_NCM_HOST_MODEL_MBIM,            /**< Mobile Broadband Interface Model: IP datagrams of several sessions (PDN connections) per NTB */
+} cdc_ncm_host_model_t;
+
+/**
+ * @brief Device events
+ */
+typedef enum {
+    CDC_NCM_HOST_LINK_UP,               /**< Device reported connection to the network */
+    CDC_NCM_HOST_LINK_DOWN,             /**< Device reported disconnection from the network */
+    CDC_NCM_HOST_DEVICE_DISCONNECTED,   /**< USB device was disconnected, close it with cdc_ncm_host_close() */
+    CDC_NCM_HOST_RESPONSE_AVAILABLE,    /**< MBIM control message can be read by cdc_acm_host_get_encapsulated_response() */
+} cdc_ncm_host_event_t;
+
+/**
+ * @brief Device event callback type
+ *
+ * Called from the CDC-ACM driver task.
+ *
+ * @param[in] ncm_hdl  NCM handle
+ * @param[in] event    Event
+ * @param[in] user_arg User's argument of the device configuration
+ */
+typedef void (*cdc_ncm_host_event_cb_t)(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_event_t event, void *user_arg);
+
+/**
+ * @brief Received IP datagram callback type of MBIM devices
+ *
+ * Called from the CDC-ACM driver task for each IP datagram of a received NTB. The datagram stays in its RX block:
+ * return true to keep it after the callback and release it later by cdc_ncm_host_ip_rx_free(),
+ * e.g. after passing it to a TCP/IP stack. Return false if the datagram was consumed in the callback.
+ *
+ * @param[in] ncm_hdl  NCM handle
+ * @param[in] session  MBIM session ID, i.e. PDN connection of MBIM_CID_CONNECT
+ * @param[in] datagram IP datagram
+ * @param[in] len      Length of the datagram in bytes
+ * @param[in] user_arg User's argument of the device configuration
+ * @return true if the datagram is held by the user
+ */
+typedef bool (*cdc_ncm_host_ip_rx_cb_t)(cdc_ncm_dev_hdl_t ncm_hdl, uint8_t session, const uint8_t *datagram, size_t len, void *user_arg);
+
+/**
+ * @brief Configuration of CDC-NCM/ECM device
+ *
+ * Zero fields are replaced by the defaults CDC_NCM_HOST_*_DEFAULT.
+ */
+typedef struct {
+    uint32_t connection_timeout_ms;     /**< Timeout for USB device connection in [ms] */
+    size_t rx_ntb_size;                 /**< Size of BULK IN transfers. NCM: maximum size of NTBs sent by the device */
+    uint8_t rx_xfer_count;              /**< Number of BULK IN transfers kept in flight */
+    uint8_t rx_block_count;             /**< Number of received NTBs or frames that can be held by the TCP/IP stack at once */
+    size_t tx_ntb_size;                 /**< Size of BULK OUT transfers. NCM: frames sent while a transfer is in flight are aggregated up to this size */
+    uint8_t tx_xfer_count;              /**< Number of BULK OUT transfers */
+    uint32_t tx_timeout_ms;             /**< Timeout for waiting for a free BULK OUT transfer in [ms]. 0: frames are dropped if no transfer is free */
+    cdc_ncm_host_event_cb_t event_cb;   /**< Device event callback. Can be NULL */
+    cdc_ncm_host_ip_rx_cb_t ip_rx_cb;   /**< MBIM only: received IP datagram callback. Can be NULL, received datagrams are dropped */
+    void *user_arg;                     /**< User's argument passed to the callbacks */
+} cdc_ncm_host_device_config_t;
+
+/**
+ * @brief Device statistics
+ */
+typedef struct {
+    uint32_t rx_ntbs;                   /**< Received NTBs (NCM) or frames (ECM) */
+    uint32_t rx_datagrams;              /**< Ethernet frames passed to the TCP/IP stack, or IP datagrams passed to ip_rx_cb */
+    uint32_t rx_dropped;                /**< Received NTBs or frames dropped, because no RX block was free or no esp_netif (ip_rx_cb) was attached */
+    uint32_t rx_errors;                 /**< Received NTBs with malformed headers */
+    uint32_t tx_ntbs;                   /**< Submitted NTBs (NCM) or frames (ECM) */
+    uint32_t tx_datagrams;              /**< Ethernet frames taken from the TCP/IP stack, or IP datagrams of cdc_ncm_host_ip_tx() */
+    uint32_t tx_dropped;                /**< Datagrams dropped, because no BULK OUT transfer was free in time */
+} cdc_ncm_host_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Open CDC-NCM, CDC-ECM or MBIM interface
+ *
+ * The interface is opened by the CDC-ACM driver, which must be installed by cdc_acm_host_install().
+ * The networking model is detected from the subclass of the Communication Class Interface.
+ * If the device has no notification endpoint, the link is considered up.
+ *
+ * MBIM devices are only set up for the NTB data path. Their control plane (MBIM_OPEN_MSG, MBIM_CID_CONNECT, ...)
+ * is run by the user with cdc_acm_host_send_encapsulated_command() on cdc_ncm_host_acm_handle().
+ *
+ * @param[in]  vid           Device's Vendor ID, set to CDC_HOST_ANY_VID for any
+ * @param[in]  pid           Device's Product ID, set to CDC_HOST_ANY_PID for any
+ * @param[in]  interface_idx Index of the Communication Class Interface
+ * @param[in]  config        Configuration
+ * @param[out] ncm_hdl_ret   NCM handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ *   - ESP_ERR_NO_MEM: Not enough memory
+ *   - ESP_ERR_NOT_SUPPORTED: The interface is not CDC-ECM, or CDC-NCM or MBIM with NTB16 format
+ *   - Errors of cdc_acm_host_open()
+ */
+esp_err_t cdc_ncm_host_open(uint16_t vid, uint16_t pid, uint8_t interface_idx, const cdc_ncm_host_device_config_t *config, cdc_ncm_dev_hdl_t *ncm_hdl_ret);
+
+/**
+ * @brief Close CDC-NCM/ECM device
+ *
+ * The attached esp_netif is stopped, destroy it after this call. Received frames that are still held by the TCP/IP stack
+ * keep their RX blocks, the memory of the device is released with the last of them.
+ *
+ * @param[in] ncm_hdl NCM handle
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid handle
+ *   - Errors of cdc_acm_host_close()
+ */
+esp_err_t cdc_ncm_host_close(cdc_ncm_dev_hdl_t ncm_hdl);
+
+/**
+ * @brief Get I/O driver handle for esp_netif_attach()
+ *
+ * The esp_netif is created with Ethernet network stack, e.g. ESP_NETIF_DEFAULT_ETH().
+ * After attaching, the MAC address of the device is assigned to the esp_netif and the interface is started.
+ * Link events of the device connect and disconnect it. MBIM devices cannot be attached, see cdc_ncm_host_ip_tx().
+ *
+ * @code{c}
+ * esp_netif_config_t netif_config = ESP_NETIF_DEFAULT_ETH();
+ * esp_netif_t *netif = esp_netif_new(&netif_config);
+ * ESP_ERROR_CHECK(esp_netif_attach(netif, cdc_ncm_host_netif_glue(ncm_hdl)));
+ * @endcode
+ *
+ * @param[in] ncm_hdl NCM handle
+ * @return I/O driver handle, NULL for invalid handle
+ */
+esp_netif_iodriver_handle cdc_ncm_host_netif_glue(cdc_ncm_dev_hdl_t ncm_hdl);
+
+/**
+ * @brief Get MAC address of the device
+ *
+ * @param[in]  ncm_hdl NCM handle
+ * @param[out] mac     MAC address from the Ethernet Networking Functional Descriptor
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ *   - ESP_ERR_NOT_FOUND: The device did not provide a valid MAC address
+ */
+esp_err_t cdc_ncm_host_mac_get(cdc_ncm_dev_hdl_t ncm_hdl, uint8_t mac[6]);
+
+/**
+ * @brief Get networking model of the device
+ *
+ * @param[in]  ncm_hdl NCM handle
+ * @param[out] model   Networking model
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ */
+esp_err_t cdc_ncm_host_model_get(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_model_t *model);
+
+/**
+ * @brief Get device statistics
+ *
+ * @param[in]  ncm_hdl NCM handle
+ * @param[out] stats   Counters since the device was opened
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ */
+esp_err_t cdc_ncm_host_get_stats(cdc_ncm_dev_hdl_t ncm_hdl, cdc_ncm_host_stats_t *stats);
+
+/**
+ * @brief Send IP datagram to MBIM session
+ *
+ * Datagrams sent while a BULK OUT transfer is in flight are aggregated into one NTB, with one NDP16 for each session.
+ *
+ * @param[in] ncm_hdl  NCM handle
+ * @param[in] session  MBIM session ID
+ * @param[in] datagram IP datagram, copied into the NTB
+ * @param[in] len      Length of the datagram in bytes
+ * @return
+ *   - ESP_OK: Datagram sent or queued in the pending NTB
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ *   - ESP_ERR_NOT_SUPPORTED: Not an MBIM device
+ *   - ESP_ERR_INVALID_STATE: The device is being closed
+ *   - ESP_ERR_INVALID_SIZE: The datagram does not fit into an NTB
+ *   - ESP_ERR_TIMEOUT: No BULK OUT transfer was free in tx_timeout_ms
+ */
+esp_err_t cdc_ncm_host_ip_tx(cdc_ncm_dev_hdl_t ncm_hdl, uint8_t session, const uint8_t *datagram, size_t len);
+
+/**
+ * @brief Release IP datagram held by ip_rx_cb
+ *
+ * Can be called from any task, also after cdc_ncm_host_close().
+ *
+ * @param[in] ncm_hdl  NCM handle
+ * @param[in] datagram Datagram of ip_rx_cb, for which the callback returned true
+ * @return
+ *   - ESP_OK: Success
+ *   - ESP_ERR_INVALID_ARG: Invalid arguments
+ */
+esp_err_t cdc_ncm_host_ip_rx_free(cdc_ncm_dev_hdl_t ncm_hdl, const uint8_t *datagram);
+
+/**
+ * @brief Get CDC-ACM handle of the device
+ *
+ * E.g. for vendor specific control requests with cdc_acm_host_send_custom_request().
+ * The data functions of the CDC-ACM driver must not be used with this handle.
+ *
+ * @param[in] ncm_hdl NCM handle
+ * @return CDC-ACM handle, NULL for invalid handle
+ */
+cdc_acm_dev_hdl_t cdc_ncm_host_acm_handle(cdc_ncm_dev_hdl_t ncm_hdl);
+
+#ifdef __cplusplus
+}
+#endif
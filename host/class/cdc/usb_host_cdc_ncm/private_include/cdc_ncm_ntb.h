@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/usb_types_cdc.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// @see USB CDC Subclass Specification for Network Control Model Devices rev. 1.0, chapter 3
+#define CDC_NCM_NTH16_SIGNATURE       (0x484D434E) // "NCMH"
+#define CDC_NCM_NDP16_SIGNATURE_NOCRC (0x304D434E) // "NCM0"
+#define CDC_NCM_NDP16_SIGNATURE_CRC   (0x314D434E) // "NCM1"
+#define CDC_NCM_NTB16_FORMAT          (0x0001)     // Bit of bmNtbFormatsSupported
+
+// @see USB MBIM specification rev. 1.0, chapter 7. The session ID is in the most significant byte
+#define CDC_MBIM_NDP16_SIGNATURE_IPS  (0x00535049) // "IPS" + session ID: IP datagrams of one session
+#define CDC_MBIM_NDP16_SIGNATURE_DSS  (0x00535344) // "DSS" + session ID: Device Service Stream
+#define CDC_MBIM_NDP16_SIGNATURE_MASK (0x00FFFFFF)
+
+#define CDC_NCM_TX_DATAGRAMS_MAX      (32)         // Maximum number of datagrams aggregated in one NTB by this driver
+#define CDC_NCM_TX_SESSIONS_MAX       (8)          // Maximum number of MBIM sessions (NDP16) in one NTB by this driver
+
+/**
+ * @brief NTB Parameter Structure, response of GET_NTB_PARAMETERS request
+ *
+ * @see Table 6-3, USB NCM specification rev. 1.0
+ */
+typedef struct {
+    uint16_t wLength;
+    uint16_t bmNtbFormatsSupported;
+    uint32_t dwNtbInMaxSize;
+    uint16_t wNdpInDivisor;
+    uint16_t wNdpInPayloadRemainder;
+    uint16_t wNdpInAlignment;
+    uint16_t wReserved;
+    uint32_t dwNtbOutMaxSize;
+    uint16_t wNdpOutDivisor;
+    uint16_t wNdpOutPayloadRemainder;
+    uint16_t wNdpOutAlignment;
+    uint16_t wNtbOutMaxDatagrams;
+} __attribute__((packed)) cdc_ncm_ntb_parameters_t;
+
+/**
+ * @brief Ethernet Networking Functional Descriptor
+ *
+ * @see Table 3, USB CDC Subclass Specification for Ethernet Control Model Devices rev. 1.2
+ */
+typedef struct {
+    uint8_t bFunctionLength;
+    const uint8_t bDescriptorType; // Upper nibble: CDC code 0x02, Lower nibble: intf/ep descriptor type 0x04/0x05
+    const cdc_desc_subtype_t bDescriptorSubtype;
+    uint8_t iMACAddress; // Index of string descriptor with the MAC address as 12 hexadecimal digits
+    uint32_t bmEthernetStatistics;
+    uint16_t wMaxSegmentSize;
+    uint16_t wNumberMCFilters;
+    uint8_t bNumberPowerFilters;
+} __attribute__((packed)) cdc_ecm_eth_desc_t;
+
+/**
+ * @brief NTB16 under construction
+ *
+ * Datagrams are placed behind the NTH16 as they come, the NDP16 pointing to them is written behind the last datagram
+ * by cdc_ncm_ntb_finalize(). MBIM NTBs get one NDP16 for each session with datagrams in the NTB.
+ */
+typedef struct {
+    uint8_t *buf;                       // Buffer of the NTB, e.g. lent OUT transfer buffer
+    size_t size;                        // Maximum NTB size
+    size_t len;                         // End of the last datagram
+    uint16_t divisor;                   // wNdpOutDivisor, at least 1
+    uint16_t remainder;                 // wNdpOutPayloadRemainder
+    uint16_t ndp_alignment;             // wNdpOutAlignment, at least 4
+    uint16_t datagrams_max;             // Maximum number of datagrams in the NTB
+    uint16_t datagram_cnt;              // Number of appended datagrams
+    bool mbim;                          // NDP16 of MBIM IP sessions instead of NCM
+    uint8_t session_cnt;                // Number of sessions with datagrams in the NTB, always 1 for NCM
+    struct {
+        uint8_t id;                     // MBIM session ID
+        uint16_t datagram_cnt;          // Datagrams of this session
+    } sessions[CDC_NCM_TX_SESSIONS_MAX];
+    struct {
+        uint16_t index;
+        uint16_t len;
+        uint8_t session;                // Index to sessions[]
+    } datagrams[CDC_NCM_TX_DATAGRAMS_MAX];
+} cdc_ncm_ntb_t;
+
+/**
+ * @brief Callback for datagrams of a parsed NTB
+ *
+ * @param[in] datagram Pointer to datagram in the NTB
+ * @param[in] len      Length of the datagram in bytes
+ * @param[in] session  MBIM session ID of IP datagrams, 0 for NCM
+ * @param[in] arg      Argument of cdc_ncm_ntb_parse()
+ */
+typedef void (*cdc_ncm_datagram_cb_t)(const uint8_t *datagram, size_t len, uint8_t session, void *arg);
+
+/**
+ * @brief Start new NTB16 in a buffer
+ *
+ * @param[out] ntb    NTB
+ * @param[in]  buf    Buffer of the NTB
+ * @param[in]  size   Maximum NTB size, e.g. minimum of the buffer size and dwNtbOutMaxSize
+ * @param[in]  params NTB parameters of the device, NULL for no alignment requirements
+ * @param[in]  mbim   Build MBIM NTB with IP session NDP16s
+ */
+void cdc_ncm_ntb_init(cdc_ncm_ntb_t *ntb, uint8_t *buf, size_t size, const cdc_ncm_ntb_parameters_t *params, bool mbim);
+
+/**
+ * @brief Copy datagram to the NTB
+ *
+ * @param[inout] ntb      NTB
+ * @param[in]    session  MBIM session ID, ignored for NCM
+ * @param[in]    datagram Datagram, i.e. Ethernet frame without FCS or IP packet of MBIM
+ * @param[in]    len      Length of the datagram in bytes
+ * @return true if the datagram was appended, false if the NTB cannot take it
+ */
+bool cdc_ncm_ntb_append(cdc_ncm_ntb_t *ntb, uint8_t session, const uint8_t *datagram, size_t len);
+
+/**
+ * @brief Write NTH16 and NDP16s of the NTB
+ *
+ * If the NTB would end with a full packet, one byte of padding is added, so that no ZLP needs to be sent.
+ *
+ * @param[inout] ntb      NTB with at least one datagram
+ * @param[in]    sequence Sequence number of the NTB
+ * @param[in]    mps      Maximum Packet Size of the BULK OUT endpoint
+ * @return Length of the NTB in bytes
+ */
+size_t cdc_ncm_ntb_finalize(cdc_ncm_ntb_t *ntb, uint16_t sequence, uint16_t mps);
+
+/**
+ * @brief Parse received NTB16 and call the callback for each of its datagrams
+ *
+ * Both NCM and MBIM NDP16s are accepted. Datagrams of MBIM Device Service Streams are skipped.
+ * Datagrams found before a malformed part of the NTB are passed to the callback.
+ *
+ * @param[in]  data          Received NTB
+ * @param[in]  len           Number of received bytes
+ * @param[in]  cb            Callback for datagrams
+ * @param[in]  arg           Argument of the callback
+ * @param[out] datagram_cnt  Number of datagrams passed to the callback, can be NULL
+ * @return
+ *   - ESP_OK: NTB parsed
+ *   - ESP_ERR_INVALID_RESPONSE: NTH16 or NDP16 are malformed
+ */
+esp_err_t cdc_ncm_ntb_parse(const uint8_t *data, size_t len, cdc_ncm_datagram_cb_t cb, void *arg, size_t *datagram_cnt);
+
+#ifdef __cplusplus
+}
+#endif
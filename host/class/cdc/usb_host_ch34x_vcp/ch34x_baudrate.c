@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <inttypes.h>
+#include "esp_check.h"
+#include "ch34x_baudrate.h"
+
+// Baud rate = 48 MHz / (clock divider * divisor)
+// The prescaler register selects clock divider 4096, 512, 64 or 8 (bits 0-1) and bit 2 halves it
+#define CH34x_CLKRATE       48000000
+#define CH34x_PRESCALER_X2  0x04
+#define CH34x_DIVISOR_MIN   2
+#define CH34x_DIVISOR_MAX   255
+
+static const char *TAG = "CH34x";
+
+/**
+ * @brief Clock of the baud rate generator
+ */
+typedef struct {
+    uint16_t clk_div;  /**< 48 MHz is divided by this value */
+    uint8_t prescaler; /**< Value of prescaler register */
+} ch34x_baud_clock_t;
+
+// Mode without the x2 bit first: when two clocks give the same rate, the first one is used
+static const ch34x_baud_clock_t ch34x_baud_clocks[] = {
+    {8,    3},
+    {64,   2},
+    {512,  1},
+    {4096, 0},
+    {4,    3 | CH34x_PRESCALER_X2},
+    {32,   2 | CH34x_PRESCALER_X2},
+    {256,  1 | CH34x_PRESCALER_X2},
+    {2048, 0 | CH34x_PRESCALER_X2},
+};
+
+esp_err_t ch34x_baudrate_reg_calc(uint32_t baud_rate, uint16_t *reg_val, uint32_t *actual_rate)
+{
+    assert(reg_val);
+    assert(actual_rate);
+    ESP_RETURN_ON_FALSE(baud_rate >= CH34x_MIN_BAUDRATE && baud_rate <= CH34x_MAX_BAUDRATE, ESP_ERR_INVALID_ARG, TAG,
+                        "Baud rate %" PRIu32 " out of range %d - %d", baud_rate, CH34x_MIN_BAUDRATE, CH34x_MAX_BAUDRATE);
+
+    uint32_t best_error = UINT32_MAX;
+    uint32_t best_rate = 0;
+    uint16_t best_reg = 0;
+    for (size_t i = 0; i < sizeof(ch34x_baud_clocks) / sizeof(ch34x_baud_clocks[0]); i++) {
+        const ch34x_baud_clock_t *clock = &ch34x_baud_clocks[i];
+        const uint64_t rate_x_div = (uint64_t)clock->clk_div * baud_rate;
+        const uint64_t divisor = (CH34x_CLKRATE + rate_x_div / 2) / rate_x_div; // Closest divisor
+        if (divisor < CH34x_DIVISOR_MIN || divisor > CH34x_DIVISOR_MAX) {
+            continue;
+        }
+
+        const uint32_t rate = CH34x_CLKRATE / (clock->clk_div * (uint32_t)divisor);
+        const uint32_t error = (rate > baud_rate) ? (rate - baud_rate) : (baud_rate - rate);
+        if (error < best_error) {
+            best_error = error;
+            best_rate = rate;
+            // The divisor register counts up to 256
+            best_reg = (uint16_t)(((256 - divisor) << 8) | clock->prescaler);
+        }
+    }
+
+    ESP_RETURN_ON_FALSE(best_rate != 0 && (uint64_t)best_error * 100 <= (uint64_t)baud_rate * CH34x_BAUDRATE_MAX_ERROR,
+                        ESP_ERR_INVALID_ARG, TAG, "Baud rate %" PRIu32 " can't be set, closest is %" PRIu32, baud_rate, best_rate);
+    *reg_val = best_reg;
+    *actual_rate = best_rate;
+    return ESP_OK;
+}
@@ -0,0 +1,63 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "ch34x_baudrate.h"
+
+SCENARIO("CH34x baud rate registers", "[ch34x][baudrate]")
+{
+    uint16_t reg_val = 0;
+    uint32_t actual_rate = 0;
+
+    GIVEN("Standard baud rates") {
+        const struct {
+            uint32_t baud_rate;
+            uint16_t reg_val;
+            uint32_t actual_rate;
+        } rates[] = {
+            {300,     0xD900, 300},
+            {1200,    0xB201, 1201},
+            {9600,    0xB202, 9615},
+            {19200,   0xD902, 19230},
+            {38400,   0x6403, 38461},
+            {57600,   0x9803, 57692},
+            {115200,  0xCC03, 115384},
+            {230400,  0xE603, 230769},
+            {460800,  0xF303, 461538},
+            {921600,  0xF307, 923076},
+            {1000000, 0xFA03, 1000000},
+            {2000000, 0xFD03, 2000000},
+            {3000000, 0xFE03, 3000000},
+        };
+        for (const auto &rate : rates) {
+            INFO("Baud rate " << rate.baud_rate);
+            REQUIRE(ESP_OK == ch34x_baudrate_reg_calc(rate.baud_rate, &reg_val, &actual_rate));
+            REQUIRE(reg_val == rate.reg_val);
+            REQUIRE(actual_rate == rate.actual_rate);
+        }
+    }
+
+    GIVEN("Limits of the range") {
+        REQUIRE(ESP_OK == ch34x_baudrate_reg_calc(CH34x_MIN_BAUDRATE, &reg_val, &actual_rate));
+        REQUIRE(reg_val == 0x0100);
+        REQUIRE(ESP_OK == ch34x_baudrate_reg_calc(CH34x_MAX_BAUDRATE, &reg_val, &actual_rate));
+        REQUIRE(actual_rate == CH34x_MAX_BAUDRATE);
+    }
+
+    GIVEN("Baud rates out of range") {
+        REQUIRE(ESP_ERR_INVALID_ARG == ch34x_baudrate_reg_calc(0, &reg_val, &actual_rate));
+        REQUIRE(ESP_ERR_INVALID_ARG == ch34x_baudrate_reg_calc(CH34x_MIN_BAUDRATE - 1, &reg_val, &actual_rate));
+        REQUIRE(ESP_ERR_INVALID_ARG == ch34x_baudrate_reg_calc(CH34x_MAX_BAUDRATE + 1, &reg_val, &actual_rate));
+    }
+
+    GIVEN("Baud rates with too much error") {
+        // Closest rates are 2.4 Mbaud and 3 Mbaud
+        REQUIRE(ESP_ERR_INVALID_ARG == ch34x_baudrate_reg_calc(2500000, &reg_val, &actual_rate));
+        REQUIRE(ESP_ERR_INVALID_ARG == ch34x_baudrate_reg_calc(2700000, &reg_val, &actual_rate));
+    }
+}
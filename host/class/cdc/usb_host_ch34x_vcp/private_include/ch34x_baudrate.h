@@ -0,0 +1,35 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#define CH34x_MIN_BAUDRATE        46      // 48 MHz / (4096 * 255)
+#define CH34x_MAX_BAUDRATE        3000000 // 48 MHz / (8 * 2)
+#define CH34x_BAUDRATE_MAX_ERROR  3       // Maximum accepted baud rate error in [%]
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Calculate value of CH34x baud rate registers
+ *
+ * All clocks of the baud rate generator are tried and the one that gives the smallest error is selected.
+ *
+ * @param[in]  baud_rate   Required baud rate
+ * @param[out] reg_val     Value of divisor (high byte) and prescaler (low byte) registers
+ * @param[out] actual_rate Baud rate that will be really set
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: The baud rate is out of range or can't be set with error up to CH34x_BAUDRATE_MAX_ERROR
+ */
+esp_err_t ch34x_baudrate_reg_calc(uint32_t baud_rate, uint16_t *reg_val, uint32_t *actual_rate);
+
+#ifdef __cplusplus
+}
+#endif
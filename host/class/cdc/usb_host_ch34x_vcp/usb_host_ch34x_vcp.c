@@ -4,12 +4,14 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <inttypes.h>
 #include "esp_check.h"
 #include "esp_bit_defs.h"
 #include "usb/usb_types_ch9.h"
 #include "usb/cdc_acm_host.h"
 #include "esp_private/cdc_host_common.h"
 #include "usb/vcp_ch34x.h"
+#include "ch34x_baudrate.h"
 
 #define CH34X_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE | USB_BM_REQUEST_TYPE_DIR_IN)
 #define CH34X_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_RECIP_DEVICE | USB_BM_REQUEST_TYPE_DIR_OUT)
@@ -39,10 +41,6 @@
 #define CH34X_UART_RECV_ERROR 0x02
 #define CH34X_UART_STATE_TRANSIENT_MASK 0x07
 
-//CH34x Baud Rate
-#define CH34x_BAUDRATE_FACTOR 1532620800
-#define CH34x_BAUDRATE_DIVMAX 3
-
 // Line Coding Register (LCR)
 #define CH34x_REG_LCR          0x18
 #define CH34x_LCR_ENABLE_RX    0x80
@@ -58,58 +56,6 @@
 
 static const char *TAG = "CH34x";
 
-static int calculate_baud_divisor(unsigned int baud_rate, unsigned char *factor, unsigned char *divisor)
-{
-    unsigned char a;
-    unsigned char b;
-    unsigned long c;
-
-    assert(factor);
-    assert(divisor);
-
-    switch (baud_rate) {
-    case 921600:
-        a = 0xf3;
-        b = 7;
-        break;
-    case 307200:
-        a = 0xd9;
-        b = 7;
-        break;
-    default:
-        if (baud_rate > 6000000 / 255) {
-            b = 3;
-            c = 6000000;
-        } else if (baud_rate > 750000 / 255) {
-            b = 2;
-            c = 750000;
-        } else if (baud_rate > 93750 / 255) {
-            b = 1;
-            c = 93750;
-        } else {
-            b = 0;
-            c = 11719;
-        }
-
-        a = (unsigned char)(c / baud_rate);
-        if (a == 0 || a == 0xFF) {
-            return -1; // Can't set required baud rate
-        }
-        // Deal with integer division
-        const int delta_0 = c / a - baud_rate;
-        const int delta_1 = baud_rate - c / (a + 1);
-        if (delta_0 > delta_1) {
-            a++;
-        }
-        a = 256 - a;
-        break;
-    }
-
-    *factor = a;
-    *divisor = b;
-    return 0;
-}
-
 // This is implementation of USB CDC-ACM compliant functions.
 // It strictly follows interface defined in interface/usb/cdc_acm_host_inteface.h
 static esp_err_t ch34x_set_control_line_state(cdc_acm_dev_hdl_t cdc_hdl, bool dtr, bool rts)
@@ -130,11 +76,10 @@ static esp_err_t ch34x_line_coding_set(cdc_acm_dev_hdl_t cdc_hdl, const cdc_acm_
 
     // Baudrate
     if (line_coding->dwDTERate != 0) {
-        uint8_t factor, divisor;
-        if (calculate_baud_divisor(line_coding->dwDTERate, &factor, &divisor) != 0) {
-            return ESP_ERR_INVALID_ARG;
-        }
-        uint16_t baud_reg_val = (factor << 8) | divisor;
+        uint16_t baud_reg_val;
+        uint32_t actual_rate;
+        ESP_RETURN_ON_ERROR(ch34x_baudrate_reg_calc(line_coding->dwDTERate, &baud_reg_val, &actual_rate), TAG,);
+        ESP_LOGD(TAG, "Baud rate required: %" PRIu32 ", set: %" PRIu32, line_coding->dwDTERate, actual_rate);
         baud_reg_val |= BIT7;
         ESP_RETURN_ON_ERROR(cdc_acm_host_send_custom_request(cdc_hdl, CH34X_WRITE_REQ, CH34X_CMD_WRITE, 0x1312, baud_reg_val, 0, NULL), TAG, "Set baudrate failed");
     }
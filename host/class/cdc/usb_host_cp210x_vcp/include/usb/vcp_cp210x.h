@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <stddef.h>
 #include "esp_err.h"
 #include "usb/cdc_host_types.h"
 
@@ -14,6 +15,8 @@
 #define CP2105_PID       (0xEA70) // Dual
 #define CP2108_PID       (0xEA71) // Quad
 
+#define CP210X_CHANNELS_MAX (4) // Channels of CP2108
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -32,6 +35,36 @@ extern "C" {
  */
 esp_err_t cp210x_vcp_open(uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret);
 
+/**
+ * @brief Get number of channels of CP210x device
+ *
+ * @param[in] pid PID of the device
+ * @return Number of channels: 4 for CP2108, 2 for CP2105, 1 otherwise
+ */
+static inline size_t cp210x_vcp_max_channels(uint16_t pid)
+{
+    return (pid == CP2108_PID) ? 4 : (pid == CP2105_PID) ? 2 : 1;
+}
+
+/**
+ * @brief Open several channels of multi-channel CP210x device, e.g. CP2108
+ *
+ * The USB device is opened once and channels 0 to channel_cnt - 1 are opened on it, see cdc_acm_host_open_multi().
+ * Each channel has its own RX/TX transfers and callbacks, control requests of all channels share one CTRL transfer.
+ * Each handle is closed by cdc_acm_host_close().
+ *
+ * @param[in]  pid          PID of the device
+ * @param[in]  channel_cnt  Number of channels to open, up to cp210x_vcp_max_channels()
+ * @param[in]  dev_configs  Array of channel_cnt CDC device configurations
+ * @param[out] cdc_hdls_ret Array of channel_cnt CDC handles
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Unsupported number of channels
+ *    - ESP_ERR_NOT_FOUND: Device not found
+ *    - ESP_ERR_NO_MEM: No memory
+ */
+esp_err_t cp210x_vcp_open_multi(uint16_t pid, size_t channel_cnt, const cdc_acm_host_device_config_t *dev_configs, cdc_acm_dev_hdl_t *cdc_hdls_ret);
+
 #ifdef __cplusplus
 }
 #endif
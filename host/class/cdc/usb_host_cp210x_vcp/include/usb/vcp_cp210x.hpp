@@ -44,8 +44,79 @@ public:
     static constexpr std::array<uint16_t, 3> pids = {CP210X_PID, CP2105_PID, CP2108_PID};
 
 private:
+    friend class CP210xMulti;
+
+    // Channel of CP210xMulti, it is opened by CP210xMulti
+    CP210x() {};
+
     // Make open functions from CdcAcmDevice class private
     using CdcAcmDevice::open;
     using CdcAcmDevice::open_vendor_specific;
 };
+
+/**
+ * @brief Driver of multi-channel CP210x devices: CP2105 and CP2108
+ *
+ * The USB device is opened once by cp210x_vcp_open_multi() and every channel is exposed as CP210x device with its own
+ * RX/TX transfers and callbacks. Control requests of all channels share one CTRL transfer.
+ *
+ * @note This driver cannot be registered to VCP service, it opens several CDC devices at once
+ */
+class CP210xMulti {
+public:
+    /**
+     * @brief Open multi-channel CP210x device
+     *
+     * @note USB Host library and CDC-ACM driver must be already installed
+     *
+     * @param[in] pid         CP2105_PID or CP2108_PID
+     * @param[in] dev_configs Array of channel_cnt CDC device configurations
+     * @param[in] channel_cnt Number of channels to open, up to cp210x_vcp_max_channels()
+     */
+    CP210xMulti(uint16_t pid, const cdc_acm_host_device_config_t *dev_configs, size_t channel_cnt)
+    {
+        if (channel_cnt == 0 || channel_cnt > cp210x_vcp_max_channels(pid)) {
+            throw (ESP_ERR_INVALID_ARG);
+        }
+        this->channels.reserve(channel_cnt);
+        for (size_t i = 0; i < channel_cnt; i++) {
+            this->channels.push_back(std::unique_ptr<CP210x>(new CP210x()));
+        }
+        std::array<cdc_acm_dev_hdl_t, CP210X_CHANNELS_MAX> cdc_hdls;
+        const esp_err_t err = cp210x_vcp_open_multi(pid, channel_cnt, dev_configs, cdc_hdls.data());
+        if (err != ESP_OK) {
+            throw (err);
+        }
+        for (size_t i = 0; i < channel_cnt; i++) {
+            this->channels[i]->cdc_hdl = cdc_hdls[i];
+        }
+    };
+
+    /**
+     * @brief Get channel
+     *
+     * @param[in] idx Channel index
+     * @return CP210x* Channel, nullptr if idx is out of range
+     */
+    CP210x *channel(size_t idx) const
+    {
+        return (idx < this->channels.size()) ? this->channels[idx].get() : nullptr;
+    }
+
+    /**
+     * @brief Get number of opened channels
+     */
+    size_t channel_count() const
+    {
+        return this->channels.size();
+    }
+
+    static constexpr uint16_t vid = SILICON_LABS_VID;
+
+private:
+    std::vector<std::unique_ptr<CP210x>> channels;
+
+    CP210xMulti(const CP210xMulti &) = delete;
+    CP210xMulti &operator=(const CP210xMulti &) = delete;
+};
 } // namespace esp_usb
@@ -99,23 +99,56 @@ static esp_err_t cp210x_send_break(cdc_acm_dev_hdl_t cdc_hdl, uint16_t duration_
     return cdc_acm_host_send_custom_request(cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_SET_BREAK, 0, cdc_hdl->data.intf_desc->bInterfaceNumber, 0, NULL);
 }
 
+/**
+ * @brief Set custom functions of this driver and enable the opened interface
+ *
+ * @param[in] cdc_hdl CDC handle of the interface
+ * @return esp_err_t
+ */
+static esp_err_t cp210x_setup(cdc_acm_dev_hdl_t cdc_hdl)
+{
+    cdc_hdl->intf_func.line_coding_set = cp210x_line_coding_set;
+    cdc_hdl->intf_func.line_coding_get = cp210x_line_coding_get;
+    cdc_hdl->intf_func.set_control_line_state = cp210x_set_control_line_state;
+    cdc_hdl->intf_func.send_break = cp210x_send_break;
+
+    // CP210x interfaces must be explicitly enabled
+    return cdc_acm_host_send_custom_request(cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_IFC_ENABLE, 1, cdc_hdl->data.intf_desc->bInterfaceNumber, 0, NULL);
+}
+
 esp_err_t cp210x_vcp_open(uint16_t pid, uint8_t interface_idx, const cdc_acm_host_device_config_t *dev_config, cdc_acm_dev_hdl_t *cdc_hdl_ret)
 {
     esp_err_t ret = cdc_acm_host_open(SILICON_LABS_VID, pid, interface_idx, dev_config, cdc_hdl_ret);
-    // Set custom function for this driver
     if (ret == ESP_OK) {
-        cdc_acm_dev_hdl_t cdc_hdl = *cdc_hdl_ret;
-        cdc_hdl->intf_func.line_coding_set = cp210x_line_coding_set;
-        cdc_hdl->intf_func.line_coding_get = cp210x_line_coding_get;
-        cdc_hdl->intf_func.set_control_line_state = cp210x_set_control_line_state;
-        cdc_hdl->intf_func.send_break = cp210x_send_break;
-
-        // CP210x interfaces must be explicitly enabled
-        ret = cdc_acm_host_send_custom_request(cdc_hdl, CP210X_WRITE_REQ, CP210X_CMD_IFC_ENABLE, 1, cdc_hdl->data.intf_desc->bInterfaceNumber, 0, NULL);
+        ret = cp210x_setup(*cdc_hdl_ret);
         if (ret != ESP_OK) {
-            cdc_acm_host_close(cdc_hdl);
+            cdc_acm_host_close(*cdc_hdl_ret);
             *cdc_hdl_ret = NULL;
         }
     }
     return ret;
 };
+
+esp_err_t cp210x_vcp_open_multi(uint16_t pid, size_t channel_cnt, const cdc_acm_host_device_config_t *dev_configs, cdc_acm_dev_hdl_t *cdc_hdls_ret)
+{
+    ESP_RETURN_ON_FALSE(channel_cnt > 0 && channel_cnt <= cp210x_vcp_max_channels(pid), ESP_ERR_INVALID_ARG, TAG, "Unsupported number of channels");
+
+    // Channels are interfaces 0, 1... of one USB device, it is looked up once and they share the CTRL transfer
+    uint8_t interfaces[CP210X_CHANNELS_MAX];
+    for (size_t i = 0; i < channel_cnt; i++) {
+        interfaces[i] = i;
+    }
+    esp_err_t ret = cdc_acm_host_open_multi(SILICON_LABS_VID, pid, interfaces, channel_cnt, dev_configs, cdc_hdls_ret);
+    ESP_RETURN_ON_ERROR(ret, TAG,);
+
+    for (size_t i = 0; i < channel_cnt && ret == ESP_OK; i++) {
+        ret = cp210x_setup(cdc_hdls_ret[i]);
+    }
+    if (ret != ESP_OK) {
+        for (size_t i = 0; i < channel_cnt; i++) {
+            cdc_acm_host_close(cdc_hdls_ret[i]);
+            cdc_hdls_ret[i] = NULL;
+        }
+    }
+    return ret;
+}
@@ -14,6 +14,8 @@
 #define FTDI_VID             (0x0403)
 #define FT232_PID            (0x6001)
 #define FT231_PID            (0x6015)
+#define FT2232_PID           (0x6010) // Dual, FT2232C/D/H
+#define FT4232_PID           (0x6011) // Quad, FT4232H
 
 #define FTDI_CMD_RESET        (0x00)
 #define FTDI_CMD_SET_FLOW     (0x01)
@@ -21,8 +23,32 @@
 #define FTDI_CMD_SET_BAUDRATE (0x03)
 #define FTDI_CMD_SET_LINE_CTL (0x04)
 #define FTDI_CMD_GET_MDMSTS   (0x05) // Modem status
+#define FTDI_CMD_SET_LATENCY  (0x09) // Latency timer
+#define FTDI_CMD_GET_LATENCY  (0x0A)
+
+#define FTDI_MPS             (64)  // Maximum Packet Size of BULK IN endpoint of Full-Speed chips. High-Speed FT2232H/FT4232H use 512
+#define FTDI_STATUS_LEN      (2)   // Length of modem status at the beginning of each BULK IN packet
 
 namespace esp_usb {
+class FTMulti;
+
+/**
+ * @brief Payload region of received FTDI data
+ */
+typedef struct {
+    const uint8_t *data; /**< Payload, points to the original transfer buffer */
+    size_t len;          /**< Payload length */
+} ftdi_rx_segment_t;
+
+/**
+ * @brief Packet-aware RX callback
+ *
+ * @param[in] segments    Payload regions of all packets in the transfer, without the status bytes. Empty packets are skipped
+ * @param[in] segment_cnt Number of segments
+ * @param[in] user_arg    User's argument from device configuration
+ */
+typedef void (*ftdi_rx_segments_callback_t)(const ftdi_rx_segment_t *segments, size_t segment_cnt, void *user_arg);
+
 class FT23x : public CdcAcmDevice {
 public:
     /**
@@ -32,10 +58,28 @@ public:
      *
      * @param[in] pid            PID eg. FTDI_FT232_PID
      * @param[in] dev_config     CDC device configuration
-     * @param[in] interface_idx  Interface number
+     * @param[in] interface_idx    Interface number
+     * @param[in] latency_timer_ms Latency timer set during opening, see set_latency_timer(). Set to 0 to keep the chip's default (16 ms)
      * @return CdcAcmDevice      Pointer to created and opened FTDI device
      */
-    FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0);
+    FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0, uint8_t latency_timer_ms = 0);
+
+    /**
+     * @brief Constructor for this FTDI driver with packet-aware RX
+     *
+     * Every BULK IN packet of FTDI starts with modem status bytes. Instead of compacting the payloads of all packets
+     * into contiguous data, received payloads are passed to rx_segments_cb as regions in the original transfer buffer.
+     * dev_config->data_cb is not used.
+     *
+     * @note USB Host library and CDC-ACM driver must be already installed
+     *
+     * @param[in] pid            PID eg. FTDI_FT232_PID
+     * @param[in] dev_config     CDC device configuration
+     * @param[in] rx_segments_cb Packet-aware RX callback
+     * @param[in] interface_idx  Interface number
+     * @param[in] latency_timer_ms Latency timer set during opening, see set_latency_timer(). Set to 0 to keep the chip's default (16 ms)
+     */
+    FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, ftdi_rx_segments_callback_t rx_segments_cb, uint8_t interface_idx = 0, uint8_t latency_timer_ms = 0);
 
     /**
      * @brief Set Line Coding method
@@ -57,21 +101,101 @@ public:
      */
     esp_err_t set_control_line_state(bool dtr, bool rts);
 
+    /**
+     * @brief Set latency timer
+     *
+     * FT23x sends a short BULK IN packet when its RX buffer is not full only after the latency timer expires.
+     * Lower values reduce round-trip latency of request/response protocols, at the cost of more IN packets.
+     *
+     * @note The FTDI chip has no setting of USB transfer size. Size of IN transfers on the host side is set by
+     *       in_buffer_size in device configuration, one transfer can hold several packets.
+     * @param[in] latency_ms Latency timer in [ms], 1 - 255
+     * @return esp_err_t
+     */
+    esp_err_t set_latency_timer(uint8_t latency_ms);
+
+    /**
+     * @brief Get latency timer
+     *
+     * @param[out] latency_ms Latency timer in [ms]
+     * @return esp_err_t
+     */
+    esp_err_t get_latency_timer(uint8_t *latency_ms);
+
     // List of supported VIDs and PIDs
     static constexpr uint16_t vid = FTDI_VID;
     static constexpr std::array<uint16_t, 2> pids = {FT232_PID, FT231_PID};
 
 private:
+    friend class FTMulti;
+
     const uint8_t intf;
+    bool multi_channel;     // Channel of FT2232/FT4232, requests are addressed to channel intf + 1
+    bool hi_speed_clk;      // Baud rate generator of FT2232H/FT4232H, with 120 MHz clock
+    uint16_t mps;           // Maximum Packet Size of BULK IN endpoint, every packet starts with status bytes
     const cdc_acm_data_callback_t user_data_cb;
+    const cdc_acm_data_ts_callback_t user_data_ts_cb;
+    const ftdi_rx_segments_callback_t user_rx_segments_cb;
     const cdc_acm_host_dev_callback_t user_event_cb;
     void *user_arg;
     uint16_t uart_state;
+    std::vector<ftdi_rx_segment_t> rx_segments; // Preallocated for one IN transfer, used by packet-aware RX
+
+    /**
+     * @brief Constructor of one channel of FTMulti, the channel is opened by FTMulti
+     *
+     * @param[in] dev_config    CDC device configuration
+     * @param[in] interface_idx Interface number of the channel
+     */
+    FT23x(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
+    /**
+     * @brief Open the device, shared by both constructors
+     *
+     * @param[in] pid              PID
+     * @param[in] dev_config       CDC device configuration
+     * @param[in] latency_timer_ms Latency timer, 0 to keep the default
+     */
+    void ftdi_open(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t latency_timer_ms);
+
+    /**
+     * @brief Make CDC device configuration with this driver's callbacks
+     *
+     * @param[in]  dev_config  User's CDC device configuration
+     * @param[out] ftdi_config CDC device configuration for opening
+     */
+    void ftdi_config_make(const cdc_acm_host_device_config_t *dev_config, cdc_acm_host_device_config_t *ftdi_config);
+
+    /**
+     * @brief Reset and configure the opened interface
+     *
+     * @param[in] latency_timer_ms Latency timer, 0 to keep the default
+     */
+    void ftdi_setup(uint8_t latency_timer_ms);
+
+    /**
+     * @brief Channel index of vendor requests
+     *
+     * @return intf + 1 for channels of multi-channel chips, intf for single channel chips
+     */
+    uint16_t ftdi_port() const
+    {
+        return this->multi_channel ? this->intf + 1 : this->intf;
+    }
+
+    /**
+     * @brief Dispatch serial state from status bytes of one packet, if it has changed
+     *
+     * @param[in] status Status bytes of the packet
+     */
+    void ftdi_status_update(const uint8_t *status);
 
     /**
      * @brief FT23x's RX data handler
      *
-     * First two bytes are status bytes, the RX data start at data[2].
+     * Every packet (mps long, the last one can be shorter) starts with two status bytes, followed by the RX data.
+     * Payloads are passed to the user either as segments, or compacted in place in one pass behind the first payload.
+     * Receive buffer append (returning false from the data callback) is not supported, the status bytes would be stripped twice.
      * Coding of status bytes:
      * Byte 0:
      *      Bit 0: Full Speed packet
@@ -91,10 +215,11 @@ private:
      * @todo When CTS is asserted, this driver should stop sending data.
      *
      * @param[in] data     Received data
-     * @param[in] data_len Received data length
-     * @param[in] user_arg Pointer to FT23x class
+     * @param[in] data_len   Received data length
+     * @param[in] rx_time_us RX timestamp, passed to user's data_ts_cb
+     * @param[in] user_arg   Pointer to FT23x class
      */
-    static bool ftdi_rx(const uint8_t *data, size_t data_len, void *user_arg);
+    static bool ftdi_rx(const uint8_t *data, size_t data_len, int64_t rx_time_us, void *user_arg);
 
     // Just a wrapper to recover user's argument
     static void ftdi_event(const cdc_acm_host_dev_event_data_t *event, void *user_ctx);
@@ -123,10 +248,100 @@ private:
      */
     static int calculate_baudrate(uint32_t baudrate, uint16_t *wValue, uint16_t *wIndex);
 
+    /**
+     * @brief Calculate baudrate divisor of FT2232H and FT4232H
+     *
+     * Hi-speed chips sample the RX line 10 times per bit with 120 MHz clock, so the reference clock is 12 MHz.
+     * The fractions of the divisor are the same as in calculate_baudrate(). Baud rates below 1200 use the 3 MHz reference.
+     *
+     * @param[in]  baudrate Required baudrate, up to 12 MBaud
+     * @param[out] wValue
+     * @param[out] wIndex   Upper bits of the divisor, without the channel index
+     * @return Baudrate that is set, 0 if the required baudrate is not supported
+     */
+    static int calculate_baudrate_hs(uint32_t baudrate, uint16_t *wValue, uint16_t *wIndex);
+
     // Make open functions from CdcAcmDevice class private
     using CdcAcmDevice::open;
     using CdcAcmDevice::open_vendor_specific;
     using CdcAcmDevice::line_coding_get; // Not implemented
     using CdcAcmDevice::send_break; // Not implemented
 };
+
+/**
+ * @brief Driver of multi-channel FTDI chips: FT2232C/D/H and FT4232H
+ *
+ * The USB device is opened once by cdc_acm_host_open_multi() and every channel is exposed as FT23x device with its own
+ * RX/TX transfers and callbacks. Control requests of all channels share one CTRL transfer; the chip type is detected once.
+ *
+ * @note This driver cannot be registered to VCP service, it opens several CDC devices at once
+ *
+ * Example usage:
+ * \code{.cpp}
+ * cdc_acm_host_device_config_t configs[4] = {...}; // e.g. different user_arg per channel
+ * FTMulti ft4232(FT4232_PID, configs, 4);
+ * ft4232.channel(2)->tx_blocking(data, len);
+ * \endcode
+ */
+class FTMulti {
+public:
+    /**
+     * @brief Open multi-channel FTDI chip
+     *
+     * @note USB Host library and CDC-ACM driver must be already installed
+     *
+     * @param[in] pid              FT2232_PID or FT4232_PID
+     * @param[in] dev_configs      Array of channel_cnt CDC device configurations, for channels A, B...
+     * @param[in] channel_cnt      Number of channels to open, up to max_channels()
+     * @param[in] latency_timer_ms Latency timer of all channels, see FT23x::set_latency_timer(). Set to 0 to keep the chip's default (16 ms)
+     */
+    FTMulti(uint16_t pid, const cdc_acm_host_device_config_t *dev_configs, size_t channel_cnt, uint8_t latency_timer_ms = 0);
+
+    /**
+     * @brief Get channel
+     *
+     * @param[in] idx Channel index, 0 for channel A
+     * @return FT23x* Channel, nullptr if idx is out of range
+     */
+    FT23x *channel(size_t idx) const
+    {
+        return (idx < this->channels.size()) ? this->channels[idx].get() : nullptr;
+    }
+
+    /**
+     * @brief Get number of opened channels
+     */
+    size_t channel_count() const
+    {
+        return this->channels.size();
+    }
+
+    /**
+     * @brief The chip is FT2232H or FT4232H, with High-Speed USB and baud rates up to 12 MBaud
+     */
+    bool is_hi_speed() const
+    {
+        return this->hi_speed;
+    }
+
+    /**
+     * @brief Number of channels of the chip
+     *
+     * @param[in] pid PID of the chip
+     * @return Number of channels, 0 for unsupported PID
+     */
+    static constexpr size_t max_channels(uint16_t pid)
+    {
+        return (pid == FT4232_PID) ? 4 : (pid == FT2232_PID) ? 2 : 0;
+    }
+
+    static constexpr uint16_t vid = FTDI_VID;
+
+private:
+    std::vector<std::unique_ptr<FT23x>> channels;
+    bool hi_speed;
+
+    FTMulti(const FTMulti &) = delete;
+    FTMulti &operator=(const FTMulti &) = delete;
+};
 } // namespace esp_usb
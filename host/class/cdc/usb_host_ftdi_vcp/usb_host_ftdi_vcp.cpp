@@ -7,6 +7,7 @@
 #include <string.h>
 #include <inttypes.h>
 #include "usb/vcp_ftdi.hpp"
+#include "esp_private/cdc_host_common.h"
 #include "usb/usb_types_ch9.h"
 #include "esp_log.h"
 #include "esp_check.h"
@@ -19,34 +20,73 @@
 #define FTDI_READ_REQ  (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_DIR_IN)
 #define FTDI_WRITE_REQ (USB_BM_REQUEST_TYPE_TYPE_VENDOR | USB_BM_REQUEST_TYPE_DIR_OUT)
 
+#define FTDI_BCD_2232H (0x0700) // bcdDevice of FT2232H, FT4232H has 0x0800 and FT2232C/D 0x0500
+
 namespace esp_usb {
-FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
-    : intf(interface_idx), user_data_cb(dev_config->data_cb), user_event_cb(dev_config->event_cb),
+FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx, uint8_t latency_timer_ms)
+    : intf(interface_idx), multi_channel(false), hi_speed_clk(false), mps(FTDI_MPS), user_data_cb(dev_config->data_cb), user_data_ts_cb(dev_config->data_ts_cb), user_rx_segments_cb(nullptr), user_event_cb(dev_config->event_cb),
       user_arg(dev_config->user_arg), uart_state(0)
 {
-    cdc_acm_host_device_config_t ftdi_config;
-    memcpy(&ftdi_config, dev_config, sizeof(cdc_acm_host_device_config_t));
-    // FT23x reports modem status in first two bytes of RX data
+    ftdi_open(pid, dev_config, latency_timer_ms);
+}
+
+FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, ftdi_rx_segments_callback_t rx_segments_cb, uint8_t interface_idx, uint8_t latency_timer_ms)
+    : intf(interface_idx), multi_channel(false), hi_speed_clk(false), mps(FTDI_MPS), user_data_cb(nullptr), user_data_ts_cb(nullptr), user_rx_segments_cb(rx_segments_cb), user_event_cb(dev_config->event_cb),
+      user_arg(dev_config->user_arg), uart_state(0)
+{
+    // One segment per packet; in_buffer_size 0 means one packet (see cdc_acm_host_open())
+    const size_t in_buffer_size = (dev_config->in_buffer_size == 0) ? FTDI_MPS : dev_config->in_buffer_size;
+    rx_segments.resize((in_buffer_size + FTDI_MPS - 1) / FTDI_MPS);
+    ftdi_open(pid, dev_config, latency_timer_ms);
+}
+
+FT23x::FT23x(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+    : intf(interface_idx), multi_channel(true), hi_speed_clk(false), mps(FTDI_MPS), user_data_cb(dev_config->data_cb), user_data_ts_cb(dev_config->data_ts_cb), user_rx_segments_cb(nullptr),
+      user_event_cb(dev_config->event_cb), user_arg(dev_config->user_arg), uart_state(0)
+{
+}
+
+void FT23x::ftdi_config_make(const cdc_acm_host_device_config_t *dev_config, cdc_acm_host_device_config_t *ftdi_config)
+{
+    memcpy(ftdi_config, dev_config, sizeof(cdc_acm_host_device_config_t));
+    // FT23x reports modem status in first two bytes of each RX packet
     // so here we override the RX handler with our own
 
-    if (dev_config->data_cb) {
-        ftdi_config.data_cb = ftdi_rx;
-        ftdi_config.user_arg = this;
+    if (this->user_data_cb || this->user_data_ts_cb || this->user_rx_segments_cb) {
+        ftdi_config->data_cb = nullptr;
+        ftdi_config->data_ts_cb = ftdi_rx;
+        ftdi_config->user_arg = this;
     }
 
     if (dev_config->event_cb) {
-        ftdi_config.event_cb = ftdi_event;
-        ftdi_config.user_arg = this;
+        ftdi_config->event_cb = ftdi_event;
+        ftdi_config->user_arg = this;
     }
+}
 
-    esp_err_t err;
-    err = this->open_vendor_specific(vid, pid, this->intf, &ftdi_config);
+void FT23x::ftdi_open(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t latency_timer_ms)
+{
+    cdc_acm_host_device_config_t ftdi_config;
+    ftdi_config_make(dev_config, &ftdi_config);
+
+    const esp_err_t err = this->open_vendor_specific(vid, pid, this->intf, &ftdi_config);
     if (err != ESP_OK) {
         throw (err);
     }
+    ftdi_setup(latency_timer_ms);
+}
+
+void FT23x::ftdi_setup(uint8_t latency_timer_ms)
+{
+    cdc_dev_t *cdc_dev = reinterpret_cast<cdc_dev_t *>(this->cdc_hdl);
+    // Packets with modem status only are sent every latency timer period, they are not responses for RTT measurement
+    cdc_dev->data.in_status_len = FTDI_STATUS_LEN;
+    if (cdc_dev->data.in_mps != 0) {
+        this->mps = cdc_dev->data.in_mps; // 512 for FT2232H/FT4232H on High-Speed host
+    }
 
     // FT23x interface must be first reset and configured (115200 8N1)
-    err = this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_RESET, 0, this->intf + 1, 0, NULL);
+    esp_err_t err = this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_RESET, 0, this->ftdi_port(), 0, NULL);
     if (err != ESP_OK) {
         throw (err);
     }
@@ -61,7 +101,14 @@ FT23x::FT23x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8
     if (err != ESP_OK) {
         throw (err);
     }
-};
+
+    if (latency_timer_ms != 0) {
+        err = this->set_latency_timer(latency_timer_ms);
+        if (err != ESP_OK) {
+            throw (err);
+        }
+    }
+}
 
 esp_err_t FT23x::line_coding_set(cdc_acm_line_coding_t *line_coding)
 {
@@ -69,51 +116,114 @@ esp_err_t FT23x::line_coding_set(cdc_acm_line_coding_t *line_coding)
 
     if (line_coding->dwDTERate != 0) {
         uint16_t wIndex, wValue;
-        calculate_baudrate(line_coding->dwDTERate, &wValue, &wIndex);
+        if (this->hi_speed_clk) {
+            ESP_RETURN_ON_FALSE(calculate_baudrate_hs(line_coding->dwDTERate, &wValue, &wIndex) != 0, ESP_ERR_INVALID_ARG, "FT23x", "Baudrate not supported");
+        } else {
+            calculate_baudrate(line_coding->dwDTERate, &wValue, &wIndex);
+        }
+        if (this->multi_channel) {
+            // Upper bits of the divisor are in the high byte, the channel in the low byte
+            wIndex = (wIndex << 8) | this->ftdi_port();
+        }
         ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_BAUDRATE, wValue, wIndex, 0, NULL), "FT23x",);
     }
 
     if (line_coding->bDataBits != 0) {
         const uint16_t wValue = (line_coding->bDataBits) | (line_coding->bParityType << 8) | (line_coding->bCharFormat << 11);
-        return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_LINE_CTL, wValue, this->intf, 0, NULL);
+        return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_LINE_CTL, wValue, this->ftdi_port(), 0, NULL);
     }
     return ESP_OK;
 }
 
 esp_err_t FT23x::set_control_line_state(bool dtr, bool rts)
 {
-    ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, dtr ? 0x11 : 0x10, this->intf, 0, NULL), "FT23x",); // DTR
-    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, rts ? 0x21 : 0x20, this->intf, 0, NULL); // RTS
+    ESP_RETURN_ON_ERROR(this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, dtr ? 0x11 : 0x10, this->ftdi_port(), 0, NULL), "FT23x",); // DTR
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_MHS, rts ? 0x21 : 0x20, this->ftdi_port(), 0, NULL); // RTS
+}
+
+esp_err_t FT23x::set_latency_timer(uint8_t latency_ms)
+{
+    ESP_RETURN_ON_FALSE(latency_ms != 0, ESP_ERR_INVALID_ARG, "FT23x", "Latency timer must be at least 1 ms");
+    return this->send_custom_request(FTDI_WRITE_REQ, FTDI_CMD_SET_LATENCY, latency_ms, this->ftdi_port(), 0, NULL);
+}
+
+esp_err_t FT23x::get_latency_timer(uint8_t *latency_ms)
+{
+    ESP_RETURN_ON_FALSE(latency_ms, ESP_ERR_INVALID_ARG, "FT23x",);
+    return this->send_custom_request(FTDI_READ_REQ, FTDI_CMD_GET_LATENCY, 0, this->ftdi_port(), 1, latency_ms);
+}
+
+void FT23x::ftdi_status_update(const uint8_t *status)
+{
+    cdc_acm_uart_state_t new_state;
+    new_state.val = 0;
+    new_state.bRxCarrier =  status[0] & 0x80; // DCD
+    new_state.bTxCarrier =  status[0] & 0x20; // DSR
+    new_state.bBreak =      status[1] & 0x10;
+    new_state.bRingSignal = status[0] & 0x40;
+    new_state.bFraming =    status[1] & 0x08;
+    new_state.bParity =     status[1] & 0x04;
+    new_state.bOverRun =    status[1] & 0x02;
+
+    if (this->uart_state != new_state.val) {
+        cdc_acm_host_dev_event_data_t serial_event;
+        serial_event.type = CDC_ACM_HOST_SERIAL_STATE;
+        serial_event.data.serial_state = new_state;
+        this->user_event_cb(&serial_event, this->user_arg);
+        this->uart_state = new_state.val;
+    }
 }
 
-bool FT23x::ftdi_rx(const uint8_t *data, size_t data_len, void *user_arg)
+bool FT23x::ftdi_rx(const uint8_t *data, size_t data_len, int64_t rx_time_us, void *user_arg)
 {
     FT23x *this_ftdi = (FT23x *)user_arg;
+    size_t segment_cnt = 0;
+    uint8_t *payload_end = nullptr; // End of compacted payload, for contiguous RX
+    const uint8_t *first_payload = nullptr;
 
-    // Dispatch serial state if it has changed
-    if (this_ftdi->user_event_cb) {
-        cdc_acm_uart_state_t new_state;
-        new_state.val = 0;
-        new_state.bRxCarrier =  data[0] & 0x80; // DCD
-        new_state.bTxCarrier =  data[0] & 0x20; // DSR
-        new_state.bBreak =      data[1] & 0x10;
-        new_state.bRingSignal = data[0] & 0x40;
-        new_state.bFraming =    data[1] & 0x08;
-        new_state.bParity =     data[1] & 0x04;
-        new_state.bOverRun =    data[1] & 0x02;
-
-        if (this_ftdi->uart_state != new_state.val) {
-            cdc_acm_host_dev_event_data_t serial_event;
-            serial_event.type = CDC_ACM_HOST_SERIAL_STATE;
-            serial_event.data.serial_state = new_state;
-            this_ftdi->user_event_cb(&serial_event, this_ftdi->user_arg);
-            this_ftdi->uart_state = new_state.val;
+    // One pass over all packets in the transfer: dispatch serial state and locate (or compact) payloads
+    const size_t mps = this_ftdi->mps;
+    for (size_t pkt = 0; pkt < data_len; pkt += mps) {
+        const size_t pkt_len = (data_len - pkt < mps) ? (data_len - pkt) : mps;
+        if (pkt_len < FTDI_STATUS_LEN) {
+            break; // Malformed packet
+        }
+        if (this_ftdi->user_event_cb) {
+            this_ftdi->ftdi_status_update(&data[pkt]);
+        }
+
+        const uint8_t *payload = &data[pkt + FTDI_STATUS_LEN];
+        const size_t payload_len = pkt_len - FTDI_STATUS_LEN;
+        if (payload_len == 0) {
+            continue;
+        }
+        if (this_ftdi->user_rx_segments_cb) {
+            if (segment_cnt < this_ftdi->rx_segments.size()) {
+                this_ftdi->rx_segments[segment_cnt++] = {payload, payload_len};
+            }
+        } else if (first_payload == nullptr) {
+            // First payload stays in place, single packet transfers are not copied at all
+            first_payload = payload;
+            payload_end = const_cast<uint8_t *>(payload) + payload_len;
+        } else {
+            // The transfer buffer is owned by CDC-ACM driver and is resubmitted after this callback, so it can be modified
+            memmove(payload_end, payload, payload_len);
+            payload_end += payload_len;
         }
     }
 
     // Dispatch data if any
-    if (data_len > 2) {
-        return this_ftdi->user_data_cb(&data[2], data_len - 2, this_ftdi->user_arg);
+    if (this_ftdi->user_rx_segments_cb) {
+        if (segment_cnt > 0) {
+            this_ftdi->user_rx_segments_cb(this_ftdi->rx_segments.data(), segment_cnt, this_ftdi->user_arg);
+        }
+        return true;
+    }
+    if (first_payload) {
+        if (this_ftdi->user_data_ts_cb) {
+            return this_ftdi->user_data_ts_cb(first_payload, payload_end - first_payload, rx_time_us, this_ftdi->user_arg);
+        }
+        return this_ftdi->user_data_cb(first_payload, payload_end - first_payload, this_ftdi->user_arg);
     }
     return true;
 }
@@ -173,4 +283,74 @@ int FT23x::calculate_baudrate(uint32_t baudrate, uint16_t *wValue, uint16_t *wIn
 
     return baudrate_real;
 }
+
+int FT23x::calculate_baudrate_hs(uint32_t baudrate, uint16_t *wValue, uint16_t *wIndex)
+{
+#define FTDI_HS_REF_CLK (12000000)
+#define FTDI_HS_CLK_BIT (0x20000) // Divisor bit 17 selects the 120 MHz clock
+
+    if (baudrate < 1200) {
+        return calculate_baudrate(baudrate, wValue, wIndex);
+    }
+    if (baudrate > FTDI_HS_REF_CLK) {
+        return 0;
+    }
+
+    const uint8_t ftdi_fractal_bits[] = {0, 0x03, 0x02, 0x04, 0x01, 0x05, 0x06, 0x07};
+    const uint32_t divider_x8 = (8 * FTDI_HS_REF_CLK + baudrate / 2) / baudrate; // Divisor in 1/8, rounded to the closest
+    uint32_t divisor = (divider_x8 >> 3) | ((uint32_t)ftdi_fractal_bits[divider_x8 & 0x07] << 14);
+    // Special cases, see calculate_baudrate(): 0 gives the reference clock, 1 gives 2/3 of it
+    if (divisor == 1) {
+        divisor = 0;
+    } else if (divisor == 0x4001) {
+        divisor = 1;
+    }
+    divisor |= FTDI_HS_CLK_BIT;
+
+    const int baudrate_real = (8 * FTDI_HS_REF_CLK) / divider_x8;
+    *wValue = divisor & 0xFFFF;
+    *wIndex = divisor >> 16;
+    ESP_LOGD("FT23x", "wValue: 0x%04X wIndex: 0x%04X", *wValue, *wIndex);
+    ESP_LOGI("FT23x", "Baudrate required: %" PRIu32", set: %d", baudrate, baudrate_real);
+
+    return baudrate_real;
+}
+
+FTMulti::FTMulti(uint16_t pid, const cdc_acm_host_device_config_t *dev_configs, size_t channel_cnt, uint8_t latency_timer_ms)
+    : hi_speed(false)
+{
+    if (dev_configs == nullptr || channel_cnt == 0 || channel_cnt > max_channels(pid)) {
+        throw (ESP_ERR_INVALID_ARG);
+    }
+
+    std::array<cdc_acm_host_device_config_t, 4> ftdi_configs;
+    std::array<uint8_t, 4> interfaces;
+    std::array<cdc_acm_dev_hdl_t, 4> cdc_hdls;
+    this->channels.reserve(channel_cnt);
+    for (size_t i = 0; i < channel_cnt; i++) {
+        this->channels.push_back(std::unique_ptr<FT23x>(new FT23x(&dev_configs[i], i)));
+        this->channels[i]->ftdi_config_make(&dev_configs[i], &ftdi_configs[i]);
+        interfaces[i] = i;
+    }
+
+    // The USB device is looked up once, all channels share its CTRL transfer
+    const esp_err_t err = cdc_acm_host_open_multi(FTDI_VID, pid, interfaces.data(), channel_cnt, ftdi_configs.data(), cdc_hdls.data());
+    if (err != ESP_OK) {
+        throw (err);
+    }
+    for (size_t i = 0; i < channel_cnt; i++) {
+        this->channels[i]->cdc_hdl = cdc_hdls[i];
+    }
+
+    // Chip type is common for all channels, it is detected once from the Device descriptor
+    const usb_device_desc_t *device_desc;
+    ESP_ERROR_CHECK(usb_host_get_device_descriptor(reinterpret_cast<cdc_dev_t *>(cdc_hdls[0])->dev_hdl, &device_desc));
+    this->hi_speed = (device_desc->bcdDevice >= FTDI_BCD_2232H);
+
+    // Opened channels are closed by their destructors, if setup of one of them fails
+    for (auto &ch : this->channels) {
+        ch->hi_speed_clk = this->hi_speed;
+        ch->ftdi_setup(latency_timer_ms);
+    }
+}
 } // esp_usb
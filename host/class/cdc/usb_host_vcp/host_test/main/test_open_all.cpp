@@ -0,0 +1,206 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <array>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "descriptors/cdc_descriptors.hpp"
+#include "usb/cdc_acm_host.h"
+#include "usb/vcp.hpp"
+#include "mock_add_usb_device.h"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+using namespace esp_usb;
+
+static const uint16_t cp210x_vid = 0x10C4, cp210x_pid = 0xEA60;
+static const uint16_t tusb_vid = 0x303A, tusb_pid = 0x4001;
+
+/**
+ * @brief Minimal VCP driver for the mocked CP210x devices
+ *
+ * Has the members required by VCP::register_driver() and VCPRegistry, opens the device as vendor specific
+ */
+class TestCP210x : public CdcAcmDevice {
+public:
+    TestCP210x(uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0)
+    {
+        const esp_err_t err = this->open_vendor_specific(vid, pid, interface_idx, dev_config);
+        if (err != ESP_OK) {
+            throw (err);
+        }
+    };
+
+    static constexpr uint16_t vid = cp210x_vid;
+    static constexpr std::array<uint16_t, 2> pids = {cp210x_pid, 0xEA70};
+};
+
+using TestRegistry = VCPRegistry<TestCP210x>;
+static_assert(TestRegistry::supports(cp210x_vid, cp210x_pid), "CP210x must be supported");
+static_assert(!TestRegistry::supports(tusb_vid, tusb_pid), "TinyUSB serial device must not be supported");
+
+/**
+ * @brief Add mocked devices
+ *
+ * Two identical CP210x devices behind a hub and one TinyUSB serial device, which is not supported by the test driver
+ */
+static void _add_mocked_devices(void)
+{
+    usb_host_mock_dev_list_init();
+
+    REQUIRE(ESP_OK == usb_host_mock_add_device(1, (const usb_device_desc_t *)cp210x_device_desc,
+            (const usb_config_desc_t *)cp210x_config_desc));
+    REQUIRE(ESP_OK == usb_host_mock_add_device(2, (const usb_device_desc_t *)cp210x_device_desc,
+            (const usb_config_desc_t *)cp210x_config_desc));
+    REQUIRE(ESP_OK == usb_host_mock_add_device(3, (const usb_device_desc_t *)tusb_serial_device_device_desc_fs_hs,
+            (const usb_config_desc_t *)tusb_serial_device_config_desc_hs));
+}
+
+/**
+ * @brief Stub all USB Host functions used for opening and closing the devices
+ *
+ * Transfers are submitted, but never completed in this test
+ */
+static void _stub_usb_host(void)
+{
+    usb_host_client_register_Stub(usb_host_client_register_mock_callback);
+    usb_host_client_deregister_Stub(usb_host_client_deregister_mock_callback);
+    usb_host_device_addr_list_fill_Stub(usb_host_device_addr_list_fill_mock_callback);
+    usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+    usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+    usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+    usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+    usb_host_device_info_Stub(usb_host_device_info_mock_callback);
+    usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+    usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+    usb_host_transfer_submit_Stub([](usb_transfer_t *transfer, int cmock_num_calls) {
+        return ESP_OK;
+    });
+    usb_host_interface_claim_Stub([](usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, uint8_t bAlternateSetting, int cmock_num_calls) {
+        return ESP_OK;
+    });
+    usb_host_interface_release_Stub([](usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber, int cmock_num_calls) {
+        return ESP_OK;
+    });
+    usb_host_endpoint_halt_Stub([](usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls) {
+        return ESP_OK;
+    });
+    usb_host_endpoint_flush_Stub([](usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls) {
+        return ESP_OK;
+    });
+    usb_host_endpoint_clear_Stub([](usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls) {
+        return ESP_OK;
+    });
+}
+
+static void _close_all(std::vector<CdcAcmDevice *> &devices)
+{
+    for (CdcAcmDevice *dev : devices) {
+        delete dev;
+    }
+    devices.clear();
+}
+
+SCENARIO("Open all connected VCP devices")
+{
+    // Devices and the driver are added once, not repeatedly for all the following SECTIONs
+    SECTION("Add mocked devices and register driver") {
+        _add_mocked_devices();
+        VCP::register_driver<TestCP210x>();
+    }
+
+    GIVEN("Two CP210x devices and a TinyUSB serial device are connected") {
+        _stub_usb_host();
+
+        // No driver task, the client events are not needed in this test
+        const cdc_acm_host_driver_config_t driver_config = {
+            .driver_task_stack_size = 0,
+            .driver_task_priority = 0,
+            .xCoreID = 0,
+            .new_dev_cb = nullptr,
+        };
+        REQUIRE(ESP_OK == cdc_acm_host_install(&driver_config));
+
+        cdc_acm_host_device_config_t dev_config = {};
+        dev_config.connection_timeout_ms = 1000;
+        dev_config.out_buffer_size = 64;
+        dev_config.in_buffer_size = 64;
+
+        SECTION("Connected devices are listed in one pass") {
+            cdc_acm_host_connected_dev_t connected[4];
+            size_t connected_num = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == cdc_acm_host_get_connected_devices(nullptr, 4, &connected_num));
+            REQUIRE(ESP_OK == cdc_acm_host_get_connected_devices(connected, 4, &connected_num));
+            REQUIRE(3 == connected_num);
+            REQUIRE(1 == connected[0].dev_addr);
+            REQUIRE(cp210x_vid == connected[0].vid);
+            REQUIRE(cp210x_pid == connected[0].pid);
+            REQUIRE(2 == connected[1].dev_addr);
+            REQUIRE(cp210x_pid == connected[1].pid);
+            REQUIRE(3 == connected[2].dev_addr);
+            REQUIRE(tusb_vid == connected[2].vid);
+            REQUIRE(tusb_pid == connected[2].pid);
+
+            // The list is truncated to the array length
+            REQUIRE(ESP_OK == cdc_acm_host_get_connected_devices(connected, 2, &connected_num));
+            REQUIRE(2 == connected_num);
+        }
+
+        SECTION("Devices with the same VID/PID are opened one after another") {
+            cdc_acm_dev_hdl_t first = nullptr, second = nullptr, third = nullptr;
+            dev_config.connection_timeout_ms = 1;
+            REQUIRE(ESP_OK == cdc_acm_host_open(cp210x_vid, cp210x_pid, 0, &dev_config, &first));
+            REQUIRE(ESP_OK == cdc_acm_host_open(cp210x_vid, cp210x_pid, 0, &dev_config, &second));
+            REQUIRE(first != second);
+            // Both devices have their interface opened, they are skipped
+            REQUIRE(ESP_ERR_NOT_FOUND == cdc_acm_host_open(cp210x_vid, cp210x_pid, 0, &dev_config, &third));
+            REQUIRE(third == nullptr);
+
+            // Opened devices are listed with their cached VID/PID
+            cdc_acm_host_connected_dev_t connected[4];
+            size_t connected_num = 0;
+            REQUIRE(ESP_OK == cdc_acm_host_get_connected_devices(connected, 4, &connected_num));
+            REQUIRE(3 == connected_num);
+            REQUIRE(cp210x_pid == connected[1].pid);
+
+            REQUIRE(ESP_OK == cdc_acm_host_close(first));
+            REQUIRE(ESP_OK == cdc_acm_host_close(second));
+        }
+
+        SECTION("VCP::open_all opens every supported device") {
+            std::vector<CdcAcmDevice *> devices = VCP::open_all(&dev_config);
+            REQUIRE(2 == devices.size());
+            REQUIRE(devices[0] != devices[1]);
+
+            // All supported devices are opened already
+            REQUIRE(VCP::open_all(&dev_config).empty());
+            _close_all(devices);
+        }
+
+        SECTION("VCPRegistry::open_all opens every supported device") {
+            std::vector<CdcAcmDevice *> devices = TestRegistry::open_all(&dev_config);
+            REQUIRE(2 == devices.size());
+            _close_all(devices);
+
+            // Device with VID/PID not supported by the registry is not opened
+            REQUIRE(nullptr == TestRegistry::open(tusb_vid, tusb_pid, &dev_config));
+        }
+
+        SECTION("Only devices that are not opened yet are opened") {
+            TestCP210x *opened = new TestCP210x(cp210x_pid, &dev_config);
+            std::vector<CdcAcmDevice *> devices = TestRegistry::open_all(&dev_config);
+            REQUIRE(1 == devices.size());
+            _close_all(devices);
+            delete opened;
+        }
+
+        REQUIRE(ESP_OK == cdc_acm_host_uninstall());
+    }
+}
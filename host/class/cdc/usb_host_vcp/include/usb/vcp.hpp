@@ -7,6 +7,7 @@
 #pragma once
 
 #include <memory>
+#include <new>
 #include <vector>
 #include "usb/cdc_acm_host.h"
 
@@ -90,7 +91,97 @@ public:
     static CdcAcmDevice *
     open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0);
 
+    /**
+     * @brief VCP factory for all connected devices
+     *
+     * Opens every connected VCP device that is supported by one of the registered drivers, in one sweep.
+     * Useful for USB hubs with many USB <-> UART converters, e.g. serial concentrators.
+     *
+     * Connected devices are listed once by cdc_acm_host_get_connected_devices() and only devices with a supported VID/PID are opened.
+     * The drivers are constructed with VID/PID, so each match is opened by cdc_acm_host_open(), which looks the device up
+     * by VID/PID again; devices whose interface is already opened are skipped there and descriptors of opened devices are not re-read.
+     *
+     * Unlike VCP::open(const cdc_acm_host_device_config_t *, uint8_t), this function does not wait for a device connection;
+     * dev_config->connection_timeout_ms is ignored.
+     *
+     * @attention USB Host Library must be installed before calling this function!
+     *
+     * @param[in] dev_config    Configuration of the devices
+     * @param[in] interface_idx USB interface to use
+     * @return std::vector<CdcAcmDevice *> Opened devices, empty if no supported device is connected
+     */
+    static std::vector<CdcAcmDevice *>
+    open_all(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0);
+
 private:
+    template<class... Drivers> friend class VCPRegistry;
+
+    /**
+     * @brief Probe function of a set of VCP drivers
+     *
+     * Tries to open a device with all drivers of the set, returns on first success.
+     *
+     * @param[in]  dev_config    Configuration of the device
+     * @param[in]  interface_idx USB interface to use
+     * @param[out] vcp           Opened VCP device
+     * @return
+     *   - ESP_OK: Device opened
+     *   - ESP_ERR_NOT_FOUND: No supported device is connected
+     *   - Other: Opening failed with error which is not recoverable by repeated probing
+     */
+    typedef esp_err_t (*probe_func_t)(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx, CdcAcmDevice **vcp);
+
+    /**
+     * @brief Factory function of a set of VCP drivers
+     *
+     * Opens a device with the driver supporting its VID/PID.
+     *
+     * @param[in] vid           VID of the device
+     * @param[in] pid           PID of the device
+     * @param[in] dev_config    Configuration of the device
+     * @param[in] interface_idx USB interface to use
+     * @return CdcAcmDevice* Opened device, nullptr if no driver supports the VID/PID
+     * @throw esp_err_t Opening with the supporting driver failed
+     */
+    typedef CdcAcmDevice *(*create_func_t)(uint16_t vid, uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
+    /**
+     * @brief Install CDC-ACM driver, if it is not installed yet
+     *
+     * @return true if the CDC-ACM driver is installed
+     */
+    static bool cdc_acm_install(void);
+
+    /**
+     * @brief Repeat probing until a device is opened or dev_config->connection_timeout_ms expires
+     *
+     * @param[in] probe         Probe function
+     * @param[in] dev_config    Configuration of the device
+     * @param[in] interface_idx USB interface to use
+     * @return CdcAcmDevice* Opened device or nullptr
+     */
+    static CdcAcmDevice *open_any(probe_func_t probe, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
+    /**
+     * @brief Open all connected devices supported by the factory function, in one pass over the connected devices
+     *
+     * @param[in] create        Factory function
+     * @param[in] dev_config    Configuration of the devices
+     * @param[in] interface_idx USB interface to use
+     * @return std::vector<CdcAcmDevice *> Opened devices
+     */
+    static std::vector<CdcAcmDevice *> open_all(create_func_t create, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
+    /**
+     * @brief Probe function of drivers registered by VCP::register_driver()
+     */
+    static esp_err_t probe_registered(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx, CdcAcmDevice **vcp);
+
+    /**
+     * @brief Factory function of drivers registered by VCP::register_driver()
+     */
+    static CdcAcmDevice *create_registered(uint16_t vid, uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx);
+
     // Default operators
     VCP() = delete; // This driver acts as a service, you can't instantiate it
     VCP(const VCP &) = delete;
@@ -113,4 +204,165 @@ private:
      */
     static std::vector<vcp_driver> drivers;
 }; // VCP class
+
+namespace detail {
+/**
+ * @brief List of VCP driver types used by VCPRegistry
+ *
+ * Recursion over the driver types, compatible with C++14 (no fold expressions).
+ * Empty list terminates the recursion.
+ */
+template<class... Ts>
+struct vcp_driver_list {
+    static constexpr bool supports(uint16_t vid, uint16_t pid)
+    {
+        return false;
+    }
+
+    static CdcAcmDevice *create(uint16_t vid, uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+    {
+        return nullptr;
+    }
+
+    static esp_err_t probe(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx, CdcAcmDevice **vcp)
+    {
+        return ESP_ERR_NOT_FOUND;
+    }
+};
+
+template<class T, class... Rest>
+struct vcp_driver_list<T, Rest...> {
+    static_assert(T::pids.size() != 0, "Every VCP driver must contain array of supported PIDs in 'pids' array");
+    static_assert(T::vid != 0, "Every VCP driver must contain supported VID in'vid' integer");
+
+    static constexpr bool has_pid(uint16_t pid, size_t i = 0)
+    {
+        return (i < T::pids.size()) && ((T::pids[i] == pid) || has_pid(pid, i + 1));
+    }
+
+    static constexpr bool supports(uint16_t vid, uint16_t pid)
+    {
+        return ((vid == T::vid) && has_pid(pid)) || vcp_driver_list<Rest...>::supports(vid, pid);
+    }
+
+    static CdcAcmDevice *create(uint16_t vid, uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+    {
+        if ((vid == T::vid) && has_pid(pid)) {
+            return static_cast<CdcAcmDevice *>(new T(pid, dev_config, interface_idx));
+        }
+        return vcp_driver_list<Rest...>::create(vid, pid, dev_config, interface_idx);
+    }
+
+    static esp_err_t probe(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx, CdcAcmDevice **vcp)
+    {
+        for (size_t i = 0; i < T::pids.size(); i++) {
+            try {
+                *vcp = static_cast<CdcAcmDevice *>(new T(T::pids[i], dev_config, interface_idx));
+                return ESP_OK;
+            } catch (esp_err_t &e) {
+                if (e != ESP_ERR_NOT_FOUND) {
+                    return e;
+                }
+            }
+        }
+        return vcp_driver_list<Rest...>::probe(dev_config, interface_idx, vcp);
+    }
+};
+} // namespace detail
+
+/**
+ * @brief Compile-time registry of VCP drivers
+ *
+ * Alternative to VCP::register_driver() for applications that know the set of their VCP drivers at compile time.
+ * VID/PID are resolved from the drivers' constexpr 'vid' and 'pids' members, there is no heap allocation and no static initialization.
+ *
+ * Example usage:
+ * \code{.cpp}
+ * using MyVCP = VCPRegistry<FT23x, CP210x, CH34x>;
+ * static_assert(MyVCP::supports(FTDI_VID, FT232_PID), "FT232 must be supported");
+ * auto vcp = MyVCP::open(&dev_config);
+ * \endcode
+ *
+ * @tparam Drivers VCP driver types, with the same requirements as in VCP::register_driver()
+ */
+template<class... Drivers>
+class VCPRegistry {
+public:
+    /**
+     * @brief Check whether a device is supported by one of the drivers
+     *
+     * @param[in] vid VID of the device
+     * @param[in] pid PID of the device
+     * @return true if the device is supported
+     */
+    static constexpr bool supports(uint16_t vid, uint16_t pid)
+    {
+        return detail::vcp_driver_list<Drivers...>::supports(vid, pid);
+    }
+
+    /**
+     * @brief VCP factory with VID and PID
+     *
+     * Same as VCP::open(uint16_t, uint16_t, const cdc_acm_host_device_config_t *, uint8_t), but only drivers of this registry are used.
+     *
+     * @attention USB Host Library must be installed before calling this function!
+     *
+     * @param[in] vid           VID of the device
+     * @param[in] pid           PID of the device
+     * @param[in] dev_config    Configuration of the device
+     * @param[in] interface_idx USB interface to use
+     * @return CdcAcmDevice* Opened device or nullptr
+     */
+    static CdcAcmDevice *open(uint16_t vid, uint16_t pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0)
+    {
+        if (!VCP::cdc_acm_install()) {
+            return nullptr;
+        }
+        try {
+            return detail::vcp_driver_list<Drivers...>::create(vid, pid, dev_config, interface_idx);
+        } catch (esp_err_t &e) {
+            switch (e) {
+            case ESP_ERR_NO_MEM: throw std::bad_alloc();
+            case ESP_ERR_NOT_FOUND: // fallthrough
+            default: return nullptr;
+            }
+        }
+    }
+
+    /**
+     * @brief VCP factory
+     *
+     * Same as VCP::open(const cdc_acm_host_device_config_t *, uint8_t), but only drivers of this registry are used.
+     *
+     * @attention USB Host Library must be installed before calling this function!
+     *
+     * @param[in] dev_config    Configuration of the device
+     * @param[in] interface_idx USB interface to use
+     * @return CdcAcmDevice* Opened device or nullptr
+     */
+    static CdcAcmDevice *open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0)
+    {
+        return VCP::open_any(detail::vcp_driver_list<Drivers...>::probe, dev_config, interface_idx);
+    }
+
+    /**
+     * @brief VCP factory for all connected devices
+     *
+     * Same as VCP::open_all(const cdc_acm_host_device_config_t *, uint8_t), but only drivers of this registry are used.
+     *
+     * @attention USB Host Library must be installed before calling this function!
+     *
+     * @param[in] dev_config    Configuration of the devices
+     * @param[in] interface_idx USB interface to use
+     * @return std::vector<CdcAcmDevice *> Opened devices, empty if no supported device is connected
+     */
+    static std::vector<CdcAcmDevice *> open_all(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx = 0)
+    {
+        return VCP::open_all(detail::vcp_driver_list<Drivers...>::create, dev_config, interface_idx);
+    }
+
+private:
+    VCPRegistry() = delete; // This registry is only a type, you can't instantiate it
+};
+
 }  // namespace esp_usb
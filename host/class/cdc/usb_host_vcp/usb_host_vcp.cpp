@@ -11,52 +11,49 @@
 #include "freertos/task.h"
 
 static const char *TAG = "VCP service";
+static const size_t VCP_CONNECTED_DEV_MAX = 32; // Longest list of connected devices matched by VCP::open_all()
 
 namespace esp_usb {
 std::vector<VCP::vcp_driver> VCP::drivers;
-CdcAcmDevice *VCP::open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+
+bool VCP::cdc_acm_install(void)
 {
     // In case user didn't install CDC-ACM driver, we try to install it here.
     const esp_err_t err = cdc_acm_host_install(NULL);
     switch (err) {
     case ESP_OK: ESP_LOGD(TAG, "CDC-ACM driver installed"); break;
     case ESP_ERR_INVALID_STATE: ESP_LOGD(TAG, "CDC-ACM driver already installed"); break;
-    default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return nullptr;
+    default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return false;
     }
+    return true;
+}
 
-    for (vcp_driver drv : drivers) {
-        if (drv.vid == _vid) {
-            for (uint16_t p : drv.pids) {
-                if (p == _pid) {
-                    try {
-                        return drv.open(_pid, dev_config, interface_idx);
-                    } catch (esp_err_t &e) {
-                        switch (e) {
-                        case ESP_ERR_NO_MEM: throw std::bad_alloc();
-                        case ESP_ERR_NOT_FOUND: // fallthrough
-                        default: return nullptr;
-                        }
-                    }
-                }
-            }
+CdcAcmDevice *VCP::open(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+{
+    if (!cdc_acm_install()) {
+        return nullptr;
+    }
+
+    try {
+        return create_registered(_vid, _pid, dev_config, interface_idx);
+    } catch (esp_err_t &e) {
+        switch (e) {
+        case ESP_ERR_NO_MEM: throw std::bad_alloc();
+        case ESP_ERR_NOT_FOUND: // fallthrough
+        default: return nullptr;
         }
     }
-    return nullptr;
 }
 
-CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+CdcAcmDevice *VCP::open_any(probe_func_t probe, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
 {
     // Setup this function timeout
     TickType_t timeout_ticks = (dev_config->connection_timeout_ms == 0) ? portMAX_DELAY : pdMS_TO_TICKS(dev_config->connection_timeout_ms);
     TimeOut_t connection_timeout;
     vTaskSetTimeOutState(&connection_timeout);
 
-    // In case user didn't install CDC-ACM driver, we try to install it here.
-    esp_err_t err = cdc_acm_host_install(NULL);
-    switch (err) {
-    case ESP_OK: ESP_LOGD(TAG, "CDC-ACM driver installed"); break;
-    case ESP_ERR_INVALID_STATE: ESP_LOGD(TAG, "CDC-ACM driver already installed"); break;
-    default: ESP_LOGE(TAG, "Failed to install CDC-ACM driver"); return nullptr;
+    if (!cdc_acm_install()) {
+        return nullptr;
     }
 
     // dev_config->connection_timeout_ms is normally meant for 1 device,
@@ -64,23 +61,104 @@ CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t
     cdc_acm_host_device_config_t _config = *dev_config;
     _config.connection_timeout_ms = 1;
 
-    // Try opening all registered devices, return on first success
+    // Probe all drivers, return on first success
     do {
-        for (vcp_driver drv : drivers) {
-            for (uint16_t pid : drv.pids) {
-                try {
-                    return drv.open(pid, &_config, interface_idx);
-                } catch (esp_err_t &e) {
-                    switch (e) {
-                    case ESP_ERR_NOT_FOUND: break;
-                    case ESP_ERR_NO_MEM: throw std::bad_alloc();
-                    default: return nullptr;
-                    }
-                }
-            }
+        CdcAcmDevice *vcp = nullptr;
+        switch (probe(&_config, interface_idx, &vcp)) {
+        case ESP_OK: return vcp;
+        case ESP_ERR_NOT_FOUND: break;
+        case ESP_ERR_NO_MEM: throw std::bad_alloc();
+        default: return nullptr;
         }
         vTaskDelay(pdMS_TO_TICKS(50));
     } while (xTaskCheckForTimeOut(&connection_timeout, &timeout_ticks) == pdFALSE);
     return nullptr;
 }
+
+std::vector<CdcAcmDevice *> VCP::open_all(create_func_t create, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+{
+    std::vector<CdcAcmDevice *> devices;
+    if (!cdc_acm_install()) {
+        return devices;
+    }
+
+    // List connected devices once and match their VID/PID against the drivers, instead of probing every supported PID
+    cdc_acm_host_connected_dev_t connected[VCP_CONNECTED_DEV_MAX];
+    size_t connected_num = 0;
+    if (cdc_acm_host_get_connected_devices(connected, VCP_CONNECTED_DEV_MAX, &connected_num) != ESP_OK) {
+        return devices;
+    }
+
+    // Do not wait for connection of new devices, only open the connected ones
+    cdc_acm_host_device_config_t _config = *dev_config;
+    _config.connection_timeout_ms = 1;
+
+    // Every match opens one device: the CDC-ACM driver skips devices whose interface is already opened,
+    // so N connected devices with the same VID/PID are opened by N calls
+    for (size_t i = 0; i < connected_num; i++) {
+        try {
+            CdcAcmDevice *vcp = create(connected[i].vid, connected[i].pid, &_config, interface_idx);
+            if (vcp) {
+                devices.push_back(vcp);
+            }
+        } catch (esp_err_t &e) {
+            switch (e) {
+            case ESP_ERR_NO_MEM:
+                for (CdcAcmDevice *dev : devices) {
+                    delete dev;
+                }
+                throw std::bad_alloc();
+            case ESP_ERR_NOT_FOUND:
+                ESP_LOGD(TAG, "Device %04X:%04X not opened, it is already opened or disconnected", connected[i].vid, connected[i].pid);
+                break;
+            default:
+                ESP_LOGW(TAG, "Opening device %04X:%04X failed with error %s", connected[i].vid, connected[i].pid, esp_err_to_name(e));
+                break;
+            }
+        }
+    }
+    return devices;
+}
+
+CdcAcmDevice *VCP::create_registered(uint16_t _vid, uint16_t _pid, const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+{
+    for (const vcp_driver &drv : drivers) {
+        if (drv.vid == _vid) {
+            for (uint16_t p : drv.pids) {
+                if (p == _pid) {
+                    return drv.open(_pid, dev_config, interface_idx);
+                }
+            }
+        }
+    }
+    return nullptr;
+}
+
+esp_err_t VCP::probe_registered(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx, CdcAcmDevice **vcp)
+{
+    for (vcp_driver drv : drivers) {
+        for (uint16_t pid : drv.pids) {
+            try {
+                *vcp = drv.open(pid, dev_config, interface_idx);
+                return ESP_OK;
+            } catch (esp_err_t &e) {
+                if (e != ESP_ERR_NOT_FOUND) {
+                    return e;
+                }
+            }
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+CdcAcmDevice *VCP::open(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+{
+    // Try opening all registered devices
+    return open_any(probe_registered, dev_config, interface_idx);
+}
+
+std::vector<CdcAcmDevice *> VCP::open_all(const cdc_acm_host_device_config_t *dev_config, uint8_t interface_idx)
+{
+    return open_all(create_registered, dev_config, interface_idx);
+}
 } // namespace esp_usb
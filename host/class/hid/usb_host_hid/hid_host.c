@@ -12,18 +12,26 @@
 #include <sys/param.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "usb/usb_host.h"
+#include "usb/usb_host_xfer_pool_weak.h"
 
 #include "usb/hid_host.h"
+#include "usb/hid_report_map.h"
 
 // HID spinlock
 static portMUX_TYPE hid_lock = portMUX_INITIALIZER_UNLOCKED;
 #define HID_ENTER_CRITICAL()    portENTER_CRITICAL(&hid_lock)
 #define HID_EXIT_CRITICAL()     portEXIT_CRITICAL(&hid_lock)
 
+// Interface spinlock, for the transfers and reports of one Interface accessed from its transfer callbacks
+#define HID_IFACE_ENTER_CRITICAL(iface) portENTER_CRITICAL(&(iface)->lock)
+#define HID_IFACE_EXIT_CRITICAL(iface)  portEXIT_CRITICAL(&(iface)->lock)
+
 // HID verification macros
 #define HID_GOTO_ON_FALSE_CRITICAL(exp, err)    \
     do {                                        \
@@ -67,7 +75,47 @@ static portMUX_TYPE hid_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static const char *TAG = "hid-host";
 
+// Optional enumeration profiler, marks are made only if the usb_host_enum_profiler component is linked
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase) __attribute__((weak));
+#define HID_ENUM_MARK(addr, phase)                               \
+    do {                                                         \
+        if (usb_host_enum_profiler_mark) {                       \
+            usb_host_enum_profiler_mark((addr), "hid", (phase)); \
+        }                                                        \
+    } while(0)
+
 #define DEFAULT_TIMEOUT_MS  (5000)
+#define HID_IN_XFER_NUM     (2)     // Default IN transfers of an Interface, one is queued while the other one is reported
+#define HID_IN_XFER_NUM_MAX (8)
+#define HID_BATCH_REPORTS   (8)     // Default reports in a batch
+#define HID_OUT_XFER_NUM    (4)     // Asynchronous output and control transfers of an Interface
+#define HID_ASYNC_REPORT_MAX_LEN (64)   // Max report length of asynchronous control requests
+#define HID_REPORT_DESC_CACHE_SIZE (8) // Report Descriptors kept for reconnection of known devices
+#define HID_IFACE_SLOTS_MAX (32)    // HID Interfaces of all connected devices
+#define HID_HANDLE_SLOT_BITS (8)    // Handle is slot index + 1 in low bits, slot generation in the others
+#define HID_LATENCY_BUCKET_US (125) // Upper bound of the first delivery latency bucket, doubled by each next one
+#define HID_POLL_MAX_GAP_MS (250)   // Default longest gap between the poll windows of an idle Interface
+
+/**
+ * @brief Input report in the report queue
+ */
+typedef struct {
+    int64_t timestamp_us;                   /**< Completion time of the IN transfer */
+    uint16_t length;                        /**< Length of the report */
+    uint8_t data[];                         /**< Report data, up to EP IN max size */
+} hid_report_item_t;
+
+struct hid_interface;
+
+/**
+ * @brief Asynchronous output or control transfer of an Interface
+ */
+typedef struct {
+    usb_transfer_t *xfer;                   /**< Transfer, interrupt OUT or control */
+    struct hid_interface *iface;            /**< Interface of the transfer */
+    hid_host_report_done_cb_t callback;     /**< Completion callback */
+    void *callback_arg;                     /**< Completion callback argument */
+} hid_out_xfer_t;
 
 /**
  * @brief HID Device structure.
@@ -94,6 +142,15 @@ typedef enum {
     HID_INTERFACE_STATE_MAX
 } hid_iface_state_t;
 
+/**
+ * @brief Adaptive polling state of the interrupt IN endpoint
+ */
+typedef enum {
+    HID_POLL_CONTINUOUS = 0,                /**< IN transfers are queued all the time */
+    HID_POLL_STOPPED,                       /**< Idle, the endpoint is not polled until the next window */
+    HID_POLL_WINDOW,                        /**< Idle, one IN transfer is queued for a poll window */
+} hid_poll_state_t;
+
 /**
  * @brief HID Interface structure in device to interact with. After HID device opening keeps the interface configuration
  *
@@ -104,15 +161,82 @@ typedef struct hid_interface {
     hid_host_dev_params_t dev_params;       /**< USB device parameters */
     uint8_t ep_in;                          /**< Interrupt IN EP number */
     uint16_t ep_in_mps;                     /**< Interrupt IN max size */
+    uint8_t ep_out;                         /**< Interrupt OUT EP number, 0 if the Interface has none */
+    uint16_t ep_out_mps;                    /**< Interrupt OUT max size */
     uint8_t country_code;                   /**< Country code */
     uint16_t report_desc_size;              /**< Size of Report */
     uint8_t *report_desc;                   /**< Pointer to HID Report */
-    usb_transfer_t *in_xfer;                /**< Pointer to IN transfer buffer */
+    hid_report_map_t *report_map;           /**< Compiled Report Descriptor, NULL until requested */
+    usb_transfer_t *in_xfer[HID_IN_XFER_NUM_MAX]; /**< IN transfers, all of them are queued while active */
+    uint8_t in_xfer_num;                    /**< Number of IN transfers */
+    usb_transfer_t *last_in_xfer;           /**< Last completed IN transfer */
+    QueueHandle_t report_queue;             /**< Received input reports, NULL if not enabled */
+    hid_report_item_t *report_item;         /**< Report being queued by the IN transfer callback */
+    hid_report_item_t *read_item;           /**< Report being taken from the queue by the reader */
+    hid_host_report_stats_t report_stats;   /**< Received and dropped input reports */
+    uint8_t ep_in_interval;                 /**< bInterval of the interrupt IN endpoint */
+    hid_host_latency_stats_t latency_stats; /**< Delivery latency and polling intervals, protected by lock */
+    int64_t last_completion_us;             /**< Completion time of the previous IN transfer, 0 if none */
+    uint64_t interval_sum_us;               /**< Sum of the intervals between completions */
+    uint32_t interval_count;                /**< Number of the intervals between completions */
+    int64_t delivered_us;                   /**< Completion time of the report last read by the application */
+    uint32_t latest_read_seq;               /**< Number of the latest report last read, HID_HOST_REPORT_DELIVERY_LATEST only */
+    hid_out_xfer_t out_xfer[HID_OUT_XFER_NUM]; /**< Asynchronous output and control transfers */
+    uint32_t out_xfer_busy;                 /**< Bit mask of the output transfers in flight, protected by lock */
+    portMUX_TYPE lock;                      /**< Interface spinlock, see HID_IFACE_ENTER_CRITICAL() */
+    hid_host_report_delivery_t report_delivery; /**< Input report delivery */
+    hid_report_item_t *latest;              /**< Latest report, HID_HOST_REPORT_DELIVERY_LATEST only */
+    uint32_t latest_seq;                    /**< Number of the latest report */
+    hid_host_input_report_t *batch;         /**< Reports of the batch, HID_HOST_REPORT_DELIVERY_BATCH only */
+    uint8_t *batch_data;                    /**< Data of the batch, EP IN max size per report */
+    uint8_t batch_size;                     /**< Reports in a full batch */
+    uint8_t batch_count;                    /**< Reports in the current batch */
+    uint32_t batch_time_ms;                 /**< Max time from the first report of a batch to its callback */
+    SemaphoreHandle_t batch_mutex;          /**< Batch is collected by IN transfer callback and flushed by timer */
+    esp_timer_handle_t batch_timer;         /**< Batch flush timer, NULL if batch_time_ms is 0 */
+    uint32_t in_xfer_busy;                  /**< Bit mask of the IN transfers submitted, protected by lock */
+    uint64_t poll_timeout_us;               /**< Time without reports, after which the IN endpoint is stopped */
+    uint64_t poll_max_gap_us;               /**< Longest gap between the poll windows */
+    uint64_t poll_window_us;                /**< Length of a poll window, two polling intervals of the IN endpoint */
+    uint64_t poll_gap_us;                   /**< Gap before the next poll window */
+    hid_poll_state_t poll_state;            /**< Adaptive polling state, protected by poll_mutex */
+    int64_t poll_last_us;                   /**< Time of the last report, or of the start of polling */
+    int64_t poll_stopped_us;                /**< Time the IN endpoint was stopped last */
+    uint32_t poll_unpolled_us;              /**< Time without polling before the current window */
+    SemaphoreHandle_t poll_mutex;           /**< Adaptive polling is changed by IN transfer callback and driver task */
+    bool poll_running;                      /**< Interface is started, adaptive polling may submit IN transfers, protected by poll_mutex */
+    bool poll_expired;                      /**< Adaptive polling timer expired, the driver task runs the next step. Set under lock */
+    bool poll_claimed;                      /**< The driver task runs a polling step, protected by hid_lock */
+    esp_timer_handle_t poll_timer;          /**< Adaptive polling timer, NULL if idle_poll_timeout_ms is 0 */
     hid_host_interface_event_cb_t user_cb;  /**< Interface application callback */
+    hid_host_interface_event_data_cb_t user_data_cb; /**< Interface application callback with event data */
     void *user_cb_arg;                      /**< Interface application callback arg */
     hid_iface_state_t state;                /**< Interface state */
+    uint8_t slot;                           /**< Index in the Interface slots */
+    hid_host_device_handle_t handle;        /**< Handle given to the user, tagged with the slot generation */
 } hid_iface_t;
 
+/**
+ * @brief HID Interface slot, the handle is validated by the slot without a list scan
+ */
+typedef struct {
+    hid_iface_t *iface;                     /**< Interface in the slot, NULL if free */
+    uint32_t generation;                    /**< Incremented when the slot is freed, so stale handles are refused */
+} hid_iface_slot_t;
+
+/**
+ * @brief Cached Report Descriptor of an Interface, identified by the device and the Interface number
+ */
+typedef struct {
+    uint16_t vid;                           /**< Vendor ID */
+    uint16_t pid;                           /**< Product ID */
+    uint16_t bcd_device;                    /**< Device release number */
+    uint8_t iface_num;                      /**< Interface number */
+    uint16_t size;                          /**< Size of Report Descriptor */
+    uint8_t *desc;                          /**< Report Descriptor, NULL if the entry is free */
+    uint32_t last_used;                     /**< Use counter of the entry, the least recently used one is replaced */
+} hid_report_desc_cache_t;
+
 /**
  * @brief HID driver default context
  *
@@ -127,6 +251,9 @@ typedef struct {
     bool event_handling_started;                                /**< Events handler started flag */
     SemaphoreHandle_t all_events_handled;                       /**< Events handler semaphore */
     volatile bool end_client_event_handling;                    /**< Client event handling flag */
+    hid_iface_slot_t iface_slots[HID_IFACE_SLOTS_MAX];          /**< Interfaces by handle */
+    hid_report_desc_cache_t report_desc_cache[HID_REPORT_DESC_CACHE_SIZE]; /**< Report Descriptors of known devices */
+    uint32_t report_desc_cache_uses;                            /**< Use counter of the cache */
 } hid_driver_t;
 
 static hid_driver_t *s_hid_driver;                              /**< Internal pointer to HID driver */
@@ -207,37 +334,38 @@ static inline hid_device_t *get_hid_device_from_context(usb_transfer_t *xfer)
 /**
  * @brief Verify presence of Interface in the RAM list
  *
+ * The Interface is checked against its slot, without a list scan and without a critical section.
+ * Slots are only changed in a critical section, when Interfaces are added and removed.
+ *
  * @param[in] iface         Pointer to an Interface structure
  * @return true             Interface is in the list
  * @return false            Interface is not in the list
  */
 static inline bool is_interface_in_list(hid_iface_t *iface)
 {
-    hid_iface_t *interface = NULL;
-
-    HID_ENTER_CRITICAL();
-    STAILQ_FOREACH(interface, &s_hid_driver->hid_ifaces_tailq, tailq_entry) {
-        if (iface == interface) {
-            HID_EXIT_CRITICAL();
-            return true;
-        }
-    }
-
-    HID_EXIT_CRITICAL();
-    return false;
+    return iface && (iface->slot < HID_IFACE_SLOTS_MAX) && (s_hid_driver->iface_slots[iface->slot].iface == iface);
 }
 
 /**
- * @brief Get HID Interface pointer by external HID Device handle with verification in RAM list
+ * @brief Get HID Interface pointer by external HID Device handle with verification of the slot generation
  *
  * @param[in] hid_dev_handle HID Device handle
  * @return hid_iface_t       Pointer to an Interface structure
  */
 static hid_iface_t *get_iface_by_handle(hid_host_device_handle_t hid_dev_handle)
 {
-    hid_iface_t *hid_iface = (hid_iface_t *) hid_dev_handle;
+    const uintptr_t handle = (uintptr_t) hid_dev_handle;
+    const uintptr_t slot = (handle & ((1U << HID_HANDLE_SLOT_BITS) - 1)) - 1;
 
-    if (!is_interface_in_list(hid_iface)) {
+    if (!s_hid_driver || slot >= HID_IFACE_SLOTS_MAX) {
+        ESP_LOGE(TAG, "HID interface handle not found");
+        return NULL;
+    }
+
+    const hid_iface_slot_t *iface_slot = &s_hid_driver->iface_slots[slot];
+    hid_iface_t *hid_iface = iface_slot->iface;
+
+    if (!hid_iface || (iface_slot->generation != (uint32_t)(handle >> HID_HANDLE_SLOT_BITS))) {
         ESP_LOGE(TAG, "HID interface handle not found");
         return NULL;
     }
@@ -269,6 +397,29 @@ static inline const usb_ep_desc_t *get_iface_ep_in(const usb_intf_desc_t *iface_
     return NULL;
 }
 
+/**
+ * @brief Returns pointer to first interrupt OUT Endpoint descriptor
+ *
+ * @param[in] iface_desc    Pointer to Interface Descriptor
+ * @param[in] total_length  Total length of configuration descriptor
+ * @return usb_ep_desc_t Pointer to EP OUT Descriptor, NULL if the Interface has none
+ */
+static inline const usb_ep_desc_t *get_iface_ep_out(const usb_intf_desc_t *iface_desc,
+        const size_t total_length)
+{
+    assert(iface_desc);
+    const usb_ep_desc_t *ep_desc = NULL;
+    for (int i = 0; i < iface_desc->bNumEndpoints; i++) {
+        int ep_offset = 0;
+        ep_desc = usb_parse_endpoint_descriptor_by_index(iface_desc, i, total_length, &ep_offset);
+        if (ep_desc && !USB_EP_DESC_GET_EP_DIR(ep_desc) &&
+                (USB_EP_DESC_GET_XFERTYPE(ep_desc) == USB_BM_ATTRIBUTES_XFER_INT)) {
+            return ep_desc;
+        }
+    }
+    return NULL;
+}
+
 /**
  * @brief Check HID interface descriptor present
  *
@@ -291,13 +442,19 @@ static bool hid_interface_present(const usb_config_desc_t *config_desc)
 }
 
 /**
- * @brief HID Interface user callback function.
+ * @brief HID Interface user callback function with event data.
  *
  * @param[in] iface   Pointer to an Interface structure
  * @param[in] event   HID Interface event
+ * @param[in] data    Input report, NULL for other events
+ * @param[in] length  Length of the input report
+ * @param[in] timestamp_us Completion time of the IN transfer of the input report
  */
-static inline void hid_host_user_interface_callback(hid_iface_t *iface,
-        const hid_host_interface_event_t event)
+static inline void hid_host_user_interface_data_callback(hid_iface_t *iface,
+        const hid_host_interface_event_t event,
+        const uint8_t *data,
+        size_t length,
+        int64_t timestamp_us)
 {
     assert(iface);
 
@@ -305,9 +462,69 @@ static inline void hid_host_user_interface_callback(hid_iface_t *iface,
 
     assert(dev_params);
 
-    if (iface->user_cb) {
-        iface->user_cb(iface, event, iface->user_cb_arg);
+    if (iface->user_data_cb) {
+        const hid_host_interface_event_data_t event_data = {
+            .event = event,
+            .data = data,
+            .length = length,
+            .timestamp_us = timestamp_us,
+        };
+        iface->user_data_cb(iface->handle, &event_data, iface->user_cb_arg);
+    } else if (iface->user_cb) {
+        iface->user_cb(iface->handle, event, iface->user_cb_arg);
+    }
+}
+
+/**
+ * @brief HID Interface user callback function.
+ *
+ * @param[in] iface   Pointer to an Interface structure
+ * @param[in] event   HID Interface event
+ */
+static inline void hid_host_user_interface_callback(hid_iface_t *iface,
+        const hid_host_interface_event_t event)
+{
+    hid_host_user_interface_data_callback(iface, event, NULL, 0, 0);
+}
+
+/**
+ * @brief Add the time from the completion of an input report to its delivery to the application
+ *
+ * @param[in] iface         Pointer to an Interface structure
+ * @param[in] timestamp_us  Completion time of the IN transfer of the report
+ */
+static void hid_host_record_delivery(hid_iface_t *iface, int64_t timestamp_us)
+{
+    const int64_t latency_us = esp_timer_get_time() - timestamp_us;
+    int bucket = 0;
+    while (bucket < HID_HOST_LATENCY_BUCKETS - 1 && latency_us >= ((int64_t)HID_LATENCY_BUCKET_US << bucket)) {
+        bucket++;
     }
+    HID_IFACE_ENTER_CRITICAL(iface);
+    iface->latency_stats.delivery_hist[bucket]++;
+    iface->latency_stats.delivery_max_us = MAX(iface->latency_stats.delivery_max_us, (uint32_t)latency_us);
+    HID_IFACE_EXIT_CRITICAL(iface);
+}
+
+/**
+ * @brief Add the interval from the previous completed IN transfer
+ *
+ * @param[in] iface         Pointer to an Interface structure
+ * @param[in] timestamp_us  Completion time of the IN transfer
+ */
+static void hid_host_record_completion(hid_iface_t *iface, int64_t timestamp_us)
+{
+    HID_IFACE_ENTER_CRITICAL(iface);
+    if (iface->last_completion_us) {
+        const uint32_t interval_us = (uint32_t)(timestamp_us - iface->last_completion_us);
+        hid_host_latency_stats_t *stats = &iface->latency_stats;
+        stats->interval_min_us = iface->interval_count ? MIN(stats->interval_min_us, interval_us) : interval_us;
+        stats->interval_max_us = MAX(stats->interval_max_us, interval_us);
+        iface->interval_sum_us += interval_us;
+        iface->interval_count++;
+    }
+    iface->last_completion_us = timestamp_us;
+    HID_IFACE_EXIT_CRITICAL(iface);
 }
 
 /**
@@ -326,7 +543,7 @@ static inline void hid_host_user_device_callback(hid_iface_t *iface,
     assert(dev_params);
 
     if (s_hid_driver && s_hid_driver->user_cb) {
-        s_hid_driver->user_cb(iface, event, s_hid_driver->user_arg);
+        s_hid_driver->user_cb(iface->handle, event, s_hid_driver->user_arg);
     }
 }
 
@@ -337,18 +554,21 @@ static inline void hid_host_user_device_callback(hid_iface_t *iface,
  * @param[in] iface_desc  Pointer to an Interface descriptor
  * @param[in] hid_desc    Pointer to an HID device descriptor
  * @param[in] ep_desc     Pointer to an EP descriptor
+ * @param[in] ep_out_desc Pointer to an interrupt OUT EP descriptor, NULL if the Interface has none
  * @return esp_err_t
  */
 static esp_err_t hid_host_add_interface(hid_device_t *hid_device,
                                         const usb_intf_desc_t *iface_desc,
                                         const hid_descriptor_t *hid_desc,
-                                        const usb_ep_desc_t *ep_in_desc)
+                                        const usb_ep_desc_t *ep_in_desc,
+                                        const usb_ep_desc_t *ep_out_desc)
 {
     hid_iface_t *hid_iface = calloc(1, sizeof(hid_iface_t));
 
     HID_RETURN_ON_FALSE(hid_iface,
                         ESP_ERR_NO_MEM,
                         "Unable to allocate memory");
+    portMUX_INITIALIZE(&hid_iface->lock);
 
     HID_ENTER_CRITICAL();
     hid_iface->parent = hid_device;
@@ -372,16 +592,41 @@ static esp_err_t hid_host_add_interface(hid_device_t *hid_device,
                 (ep_in_desc->bmAttributes & USB_B_ENDPOINT_ADDRESS_EP_NUM_MASK) ) {
             hid_iface->ep_in = ep_in_desc->bEndpointAddress;
             hid_iface->ep_in_mps = USB_EP_DESC_GET_MPS(ep_in_desc);
+            hid_iface->ep_in_interval = ep_in_desc->bInterval;
         } else {
             ESP_EARLY_LOGE(TAG, "HID device EP IN %#X configuration error",
                            ep_in_desc->bEndpointAddress);
         }
     }
 
+    if (ep_out_desc) {
+        hid_iface->ep_out = ep_out_desc->bEndpointAddress;
+        hid_iface->ep_out_mps = USB_EP_DESC_GET_MPS(ep_out_desc);
+    }
+
     if (iface_desc && hid_desc && ep_in_desc) {
         hid_iface->state = HID_INTERFACE_STATE_IDLE;
     }
 
+    // Take a free slot, the handle is tagged with the slot generation
+    hid_iface->slot = HID_IFACE_SLOTS_MAX;
+    for (uint8_t i = 0; i < HID_IFACE_SLOTS_MAX; i++) {
+        hid_iface_slot_t *iface_slot = &s_hid_driver->iface_slots[i];
+        if (!iface_slot->iface) {
+            iface_slot->iface = hid_iface;
+            hid_iface->slot = i;
+            hid_iface->handle = (hid_host_device_handle_t)(((uintptr_t)iface_slot->generation << HID_HANDLE_SLOT_BITS)
+                                                           | (uintptr_t)(i + 1));
+            break;
+        }
+    }
+    if (hid_iface->slot == HID_IFACE_SLOTS_MAX) {
+        HID_EXIT_CRITICAL();
+        free(hid_iface);
+        ESP_LOGE(TAG, "Too many HID interfaces");
+        return ESP_ERR_NO_MEM;
+    }
+
     STAILQ_INSERT_TAIL(&s_hid_driver->hid_ifaces_tailq, hid_iface, tailq_entry);
     HID_EXIT_CRITICAL();
 
@@ -400,6 +645,9 @@ static esp_err_t _hid_host_remove_interface(hid_iface_t *iface)
 {
     iface->state = HID_INTERFACE_STATE_NOT_INITIALIZED;
     STAILQ_REMOVE(&s_hid_driver->hid_ifaces_tailq, iface, hid_interface, tailq_entry);
+    s_hid_driver->iface_slots[iface->slot].iface = NULL;
+    s_hid_driver->iface_slots[iface->slot].generation =
+        (s_hid_driver->iface_slots[iface->slot].generation + 1) & (UINTPTR_MAX >> HID_HANDLE_SLOT_BITS);
     free(iface);
     return ESP_OK;
 }
@@ -467,7 +715,8 @@ static esp_err_t hid_host_interface_list_create(hid_device_t *hid_device,
                     HID_RETURN_ON_ERROR( hid_host_add_interface(hid_device,
                                          iface_desc,
                                          hid_desc,
-                                         ep_in_desc),
+                                         ep_in_desc,
+                                         get_iface_ep_out(iface_desc, total_length)),
                                          "Unable to add HID Interface to the RAM list");
                 }
             }
@@ -499,6 +748,9 @@ static bool hid_host_device_init_attempt(uint8_t dev_addr)
             is_hid_device = hid_interface_present(config_desc);
         }
     }
+    if (is_hid_device) {
+        HID_ENUM_MARK(dev_addr, "class_check");
+    }
 
     // Create HID interfaces list in RAM, connected to the particular USB dev
     if (is_hid_device) {
@@ -506,6 +758,7 @@ static bool hid_host_device_init_attempt(uint8_t dev_addr)
         ESP_ERROR_CHECK( hid_host_install_device(dev_addr, dev_hdl, &hid_device) );
         // Create Interfaces list for a possibility to claim Interface
         ESP_ERROR_CHECK( hid_host_interface_list_create(hid_device, config_desc) );
+        HID_ENUM_MARK(dev_addr, "interfaces");
     } else {
         usb_host_device_close(s_hid_driver->client_handle, dev_hdl);
         ESP_LOGW(TAG, "No HID device at USB port %d", dev_addr);
@@ -535,7 +788,7 @@ static esp_err_t hid_host_device_disconnected(usb_device_handle_t dev_hdl)
         HID_EXIT_CRITICAL();
 
         if (hid_iface_curr->parent && (hid_iface_curr->parent->dev_addr == hid_device->dev_addr)) {
-            HID_RETURN_ON_ERROR( hid_host_device_close(hid_iface_curr),
+            HID_RETURN_ON_ERROR( hid_host_device_close(hid_iface_curr->handle),
                                  "Unable to close device");
         }
         HID_ENTER_CRITICAL();
@@ -559,27 +812,516 @@ static esp_err_t hid_host_device_disconnected(usb_device_handle_t dev_hdl)
 static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
 {
     if (event->event == USB_HOST_CLIENT_EVENT_NEW_DEV) {
+        HID_ENUM_MARK(event->new_dev.address, "new_dev");
         hid_host_device_init_attempt(event->new_dev.address);
     } else if (event->event == USB_HOST_CLIENT_EVENT_DEV_GONE) {
         hid_host_device_disconnected(event->dev_gone.dev_hdl);
     }
 }
 
+/**
+ * @brief Free IN transfers and report queue of the Interface
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void hid_host_interface_free_transfers(hid_iface_t *iface)
+{
+    for (int i = 0; i < HID_IN_XFER_NUM_MAX; i++) {
+        if (iface->in_xfer[i]) {
+            ESP_ERROR_CHECK( USB_HOST_XFER_POOL_FREE(iface->in_xfer[i]) );
+            iface->in_xfer[i] = NULL;
+        }
+    }
+    iface->last_in_xfer = NULL;
+
+    for (int i = 0; i < HID_OUT_XFER_NUM; i++) {
+        if (iface->out_xfer[i].xfer) {
+            ESP_ERROR_CHECK( USB_HOST_XFER_POOL_FREE(iface->out_xfer[i].xfer) );
+            iface->out_xfer[i].xfer = NULL;
+        }
+    }
+    iface->out_xfer_busy = 0;
+
+    if (iface->report_queue) {
+        vQueueDelete(iface->report_queue);
+        iface->report_queue = NULL;
+    }
+    free(iface->report_item);
+    iface->report_item = NULL;
+    free(iface->read_item);
+    iface->read_item = NULL;
+
+    if (iface->batch_timer) {
+        esp_timer_stop(iface->batch_timer);
+        // Wait for the timer callback, which might be in progress
+        xSemaphoreTake(iface->batch_mutex, portMAX_DELAY);
+        esp_timer_delete(iface->batch_timer);
+        iface->batch_timer = NULL;
+        xSemaphoreGive(iface->batch_mutex);
+    }
+    if (iface->batch_mutex) {
+        vSemaphoreDelete(iface->batch_mutex);
+        iface->batch_mutex = NULL;
+    }
+    free(iface->batch);
+    iface->batch = NULL;
+
+    if (iface->poll_timer) {
+        esp_timer_stop(iface->poll_timer);
+        // Wait for the timer callback, which might be in progress
+        HID_IFACE_ENTER_CRITICAL(iface);
+        HID_IFACE_EXIT_CRITICAL(iface);
+        // No new polling step is started for this Interface, wait for the step in progress in the driver task
+        __atomic_store_n(&iface->poll_expired, false, __ATOMIC_RELEASE);
+        HID_ENTER_CRITICAL();
+        bool poll_claimed = iface->poll_claimed;
+        HID_EXIT_CRITICAL();
+        while (poll_claimed) {
+            vTaskDelay(1);
+            HID_ENTER_CRITICAL();
+            poll_claimed = iface->poll_claimed;
+            HID_EXIT_CRITICAL();
+        }
+        esp_timer_delete(iface->poll_timer);
+        iface->poll_timer = NULL;
+    }
+    if (iface->poll_mutex) {
+        vSemaphoreDelete(iface->poll_mutex);
+        iface->poll_mutex = NULL;
+    }
+    free(iface->batch_data);
+    iface->batch_data = NULL;
+    iface->batch_count = 0;
+    free(iface->latest);
+    iface->latest = NULL;
+}
+
+/**
+ * @brief Report the collected batch to the user, the caller holds the batch mutex
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void hid_host_interface_flush_batch(hid_iface_t *iface)
+{
+    if (iface->batch_count == 0) {
+        return;
+    }
+    if (iface->batch_timer) {
+        esp_timer_stop(iface->batch_timer);  // Not running, if the batch is full after the timeout
+    }
+    for (int i = 0; i < iface->batch_count; i++) {
+        hid_host_record_delivery(iface, iface->batch[i].timestamp_us);
+    }
+    if (iface->user_data_cb) {
+        const hid_host_interface_event_data_t event_data = {
+            .event = HID_HOST_INTERFACE_EVENT_INPUT_REPORT_BATCH,
+            .reports = iface->batch,
+            .report_count = iface->batch_count,
+        };
+        iface->user_data_cb(iface->handle, &event_data, iface->user_cb_arg);
+    }
+    iface->batch_count = 0;
+}
+
+/**
+ * @brief Batch timer callback, reports the batch before it is full
+ *
+ * @param[in] arg         Pointer to Interface structure
+ */
+static void hid_host_batch_timer_cb(void *arg)
+{
+    hid_iface_t *iface = (hid_iface_t *) arg;
+
+    xSemaphoreTake(iface->batch_mutex, portMAX_DELAY);
+    hid_host_interface_flush_batch(iface);
+    xSemaphoreGive(iface->batch_mutex);
+}
+
+/**
+ * @brief Allocate the resources of the input report delivery
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] config      HID device configuration
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_interface_prepare_delivery(hid_iface_t *iface,
+        const hid_host_device_config_t *config)
+{
+    iface->report_delivery = config->report_delivery;
+    iface->latest_seq = 0;
+
+    switch (config->report_delivery) {
+    case HID_HOST_REPORT_DELIVERY_LATEST:
+        iface->latest = calloc(1, sizeof(hid_report_item_t) + iface->ep_in_mps);
+        return iface->latest ? ESP_OK : ESP_ERR_NO_MEM;
+    case HID_HOST_REPORT_DELIVERY_BATCH:
+        iface->batch_size = config->batch_reports ? config->batch_reports : HID_BATCH_REPORTS;
+        iface->batch_time_ms = config->batch_time_ms;
+        iface->batch_count = 0;
+        iface->batch = calloc(iface->batch_size, sizeof(hid_host_input_report_t));
+        iface->batch_data = malloc((size_t)iface->batch_size * iface->ep_in_mps);
+        iface->batch_mutex = xSemaphoreCreateMutex();
+        if (!iface->batch || !iface->batch_data || !iface->batch_mutex) {
+            return ESP_ERR_NO_MEM;
+        }
+        if (iface->batch_time_ms) {
+            const esp_timer_create_args_t timer_args = {
+                .callback = hid_host_batch_timer_cb,
+                .arg = iface,
+                .name = "hid_batch",
+            };
+            return esp_timer_create(&timer_args, &iface->batch_timer);
+        }
+        return ESP_OK;
+    default:
+        return ESP_OK;
+    }
+}
+
+/**
+ * @brief Polling interval of the interrupt IN endpoint
+ *
+ * Interrupt endpoints of high-speed devices are polled every 2^(bInterval-1) microframes, others every bInterval ms
+ *
+ * @param[in] iface         Pointer to Interface structure
+ * @param[out] interval_us  Polling interval
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_ep_in_interval_us(hid_iface_t *iface, uint32_t *interval_us)
+{
+    usb_device_info_t dev_info;
+    HID_RETURN_ON_ERROR( usb_host_device_info(iface->parent->dev_hdl, &dev_info),
+                         "Unable to get device info");
+    const uint8_t interval = MAX(iface->ep_in_interval, 1);
+    *interval_us = (dev_info.speed == USB_SPEED_HIGH)
+                   ? (125u << MIN(interval - 1, 15)) : (uint32_t)interval * 1000;
+    return ESP_OK;
+}
+
+static uint32_t hid_host_in_xfer_bit(const hid_iface_t *iface, const usb_transfer_t *in_xfer)
+{
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        if (iface->in_xfer[i] == in_xfer) {
+            return 1U << i;
+        }
+    }
+    return 0;
+}
+
+static uint32_t hid_host_in_xfer_busy(hid_iface_t *iface)
+{
+    HID_IFACE_ENTER_CRITICAL(iface);
+    const uint32_t busy = iface->in_xfer_busy;
+    HID_IFACE_EXIT_CRITICAL(iface);
+    return busy;
+}
+
+/**
+ * @brief Mark IN transfer as returned by its callback
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] in_xfer     IN transfer
+ */
+static void hid_host_in_xfer_returned(hid_iface_t *iface, const usb_transfer_t *in_xfer)
+{
+    const uint32_t bit = hid_host_in_xfer_bit(iface, in_xfer);
+    HID_IFACE_ENTER_CRITICAL(iface);
+    iface->in_xfer_busy &= ~bit;
+    HID_IFACE_EXIT_CRITICAL(iface);
+}
+
+/**
+ * @brief Submit IN transfer, it is busy until its callback
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] in_xfer     IN transfer
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_in_xfer_submit(hid_iface_t *iface, usb_transfer_t *in_xfer)
+{
+    const uint32_t bit = hid_host_in_xfer_bit(iface, in_xfer);
+    HID_IFACE_ENTER_CRITICAL(iface);
+    iface->in_xfer_busy |= bit;
+    HID_IFACE_EXIT_CRITICAL(iface);
+    const esp_err_t ret = usb_host_transfer_submit(in_xfer);
+    if (ret != ESP_OK) {
+        hid_host_in_xfer_returned(iface, in_xfer);
+    }
+    return ret;
+}
+
+/**
+ * @brief Stop polling of the idle IN endpoint until the next window, the caller holds the poll mutex
+ *
+ * The cancelled IN transfers return through their callback.
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void hid_host_poll_stop(hid_iface_t *iface)
+{
+    usb_device_handle_t dev_hdl = iface->parent->dev_hdl;
+    if (usb_host_endpoint_halt(dev_hdl, iface->ep_in) == ESP_OK) {
+        usb_host_endpoint_flush(dev_hdl, iface->ep_in);
+        usb_host_endpoint_clear(dev_hdl, iface->ep_in);
+    }
+    iface->poll_state = HID_POLL_STOPPED;
+    iface->poll_stopped_us = esp_timer_get_time();
+    esp_timer_start_once(iface->poll_timer, iface->poll_gap_us);
+}
+
+/**
+ * @brief Adaptive polling step, stops the idle IN endpoint and opens the poll windows
+ *
+ * Runs in the driver task, after the adaptive polling timer expired.
+ *
+ * @param[in] iface  Pointer to Interface structure
+ */
+static void hid_host_poll_step(hid_iface_t *iface)
+{
+    xSemaphoreTake(iface->poll_mutex, portMAX_DELAY);
+    if (!iface->poll_running) {
+        xSemaphoreGive(iface->poll_mutex);
+        return;
+    }
+    const int64_t now = esp_timer_get_time();
+    switch (iface->poll_state) {
+    case HID_POLL_CONTINUOUS: {
+        // The timer is not restarted by each report, the time left is checked here
+        const uint64_t idle_us = (uint64_t)(now - iface->poll_last_us);
+        if (idle_us < iface->poll_timeout_us) {
+            esp_timer_start_once(iface->poll_timer, iface->poll_timeout_us - idle_us);
+            break;
+        }
+        iface->poll_gap_us = MIN(iface->poll_window_us, iface->poll_max_gap_us);
+        iface->poll_unpolled_us = 0;
+        hid_host_poll_stop(iface);
+        HID_IFACE_ENTER_CRITICAL(iface);
+        iface->latency_stats.poll_stops++;
+        HID_IFACE_EXIT_CRITICAL(iface);
+        break;
+    }
+    case HID_POLL_STOPPED:
+        // The window needs a transfer, which returned from the cancellation
+        if (hid_host_in_xfer_busy(iface) == 0 && hid_host_in_xfer_submit(iface, iface->in_xfer[0]) == ESP_OK) {
+            iface->poll_unpolled_us = (uint32_t)(now - iface->poll_stopped_us);
+            iface->poll_state = HID_POLL_WINDOW;
+            HID_IFACE_ENTER_CRITICAL(iface);
+            iface->latency_stats.poll_windows++;
+            HID_IFACE_EXIT_CRITICAL(iface);
+            esp_timer_start_once(iface->poll_timer, iface->poll_window_us);
+        } else {
+            esp_timer_start_once(iface->poll_timer, iface->poll_gap_us);
+        }
+        break;
+    case HID_POLL_WINDOW:
+        // No report in the window, the next gap is longer
+        iface->poll_gap_us = MIN(iface->poll_gap_us * 2, iface->poll_max_gap_us);
+        hid_host_poll_stop(iface);
+        break;
+    }
+    xSemaphoreGive(iface->poll_mutex);
+}
+
+/**
+ * @brief Adaptive polling timer callback
+ *
+ * The esp_timer task must not wait for the driver task or run endpoint operations.
+ * The Interface is only marked and the driver task is woken up to run hid_host_poll_step().
+ *
+ * @param[in] arg  Pointer to Interface structure
+ */
+static void hid_host_poll_timer_cb(void *arg)
+{
+    hid_iface_t *iface = (hid_iface_t *)arg;
+
+    // hid_host_interface_free_transfers() takes the same lock, so it waits for this callback before the timer is deleted
+    HID_IFACE_ENTER_CRITICAL(iface);
+    __atomic_store_n(&iface->poll_expired, true, __ATOMIC_RELEASE);
+    HID_IFACE_EXIT_CRITICAL(iface);
+    usb_host_client_unblock(s_hid_driver->client_handle);
+}
+
+/**
+ * @brief Run adaptive polling steps of Interfaces, whose polling timer expired
+ *
+ * Called by the driver task after handling of client events.
+ * An Interface is claimed while its step runs, hid_host_interface_free_transfers() waits for the step to finish.
+ */
+static void hid_host_poll_process(void)
+{
+    while (1) {
+        hid_iface_t *iface;
+        HID_ENTER_CRITICAL();
+        STAILQ_FOREACH(iface, &s_hid_driver->hid_ifaces_tailq, tailq_entry) {
+            if (__atomic_exchange_n(&iface->poll_expired, false, __ATOMIC_ACQ_REL)) {
+                iface->poll_claimed = true;
+                break;
+            }
+        }
+        HID_EXIT_CRITICAL();
+        if (!iface) {
+            return;
+        }
+
+        hid_host_poll_step(iface);
+        HID_ENTER_CRITICAL();
+        iface->poll_claimed = false;
+        HID_EXIT_CRITICAL();
+    }
+}
+
+/**
+ * @brief Resume polling at bInterval on a report of the stopped IN endpoint
+ *
+ * @param[in] iface         Pointer to Interface structure
+ * @param[in] in_xfer       Completed IN transfer, relaunched by the caller
+ * @param[in] timestamp_us  Completion time of the IN transfer
+ */
+static void hid_host_poll_report(hid_iface_t *iface, const usb_transfer_t *in_xfer, int64_t timestamp_us)
+{
+    xSemaphoreTake(iface->poll_mutex, portMAX_DELAY);
+    iface->poll_last_us = timestamp_us;
+    if (iface->poll_state != HID_POLL_CONTINUOUS && iface->poll_running) {
+        esp_timer_stop(iface->poll_timer);
+        HID_IFACE_ENTER_CRITICAL(iface);
+        iface->latency_stats.poll_wakeups++;
+        iface->latency_stats.poll_gap_max_us = MAX(iface->latency_stats.poll_gap_max_us, iface->poll_unpolled_us);
+        HID_IFACE_EXIT_CRITICAL(iface);
+        iface->poll_state = HID_POLL_CONTINUOUS;
+        const uint32_t busy = hid_host_in_xfer_busy(iface);
+        for (int i = 0; i < iface->in_xfer_num; i++) {
+            if (iface->in_xfer[i] != in_xfer && !(busy & (1U << i))) {
+                hid_host_in_xfer_submit(iface, iface->in_xfer[i]);
+            }
+        }
+        esp_timer_start_once(iface->poll_timer, iface->poll_timeout_us);
+    }
+    xSemaphoreGive(iface->poll_mutex);
+}
+
+/**
+ * @brief Relaunch IN transfer cancelled by stopping the IN endpoint, if polling was resumed meanwhile
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] in_xfer     Cancelled IN transfer
+ */
+static void hid_host_poll_cancelled(hid_iface_t *iface, usb_transfer_t *in_xfer)
+{
+    xSemaphoreTake(iface->poll_mutex, portMAX_DELAY);
+    if (iface->poll_state == HID_POLL_CONTINUOUS && iface->poll_running) {
+        hid_host_in_xfer_submit(iface, in_xfer);
+    }
+    xSemaphoreGive(iface->poll_mutex);
+}
+
+/**
+ * @brief Prepare adaptive polling of the IN endpoint
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] config      HID device configuration
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_interface_prepare_polling(hid_iface_t *iface,
+        const hid_host_device_config_t *config)
+{
+    uint32_t interval_us;
+    HID_RETURN_ON_ERROR( hid_host_ep_in_interval_us(iface, &interval_us),
+                         "Unable to get polling interval");
+    iface->poll_timeout_us = (uint64_t)config->idle_poll_timeout_ms * 1000;
+    iface->poll_max_gap_us = (uint64_t)(config->idle_poll_max_gap_ms ? config->idle_poll_max_gap_ms : HID_POLL_MAX_GAP_MS) * 1000;
+    iface->poll_window_us = MAX(2 * (uint64_t)interval_us, 1000);
+    iface->poll_mutex = xSemaphoreCreateMutex();
+    if (!iface->poll_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = hid_host_poll_timer_cb,
+        .arg = iface,
+        .name = "hid_poll",
+    };
+    return esp_timer_create(&timer_args, &iface->poll_timer);
+}
+
+/**
+ * @brief Check for asynchronous control requests in flight
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return true, if a control request has not completed yet
+ */
+static bool hid_host_interface_control_in_flight(hid_iface_t *iface)
+{
+    bool in_flight = false;
+
+    HID_IFACE_ENTER_CRITICAL(iface);
+    for (int i = 0; i < HID_OUT_XFER_NUM; i++) {
+        if ((iface->out_xfer_busy & (1U << i)) && iface->out_xfer[i].xfer->bEndpointAddress == 0) {
+            in_flight = true;
+        }
+    }
+    HID_IFACE_EXIT_CRITICAL(iface);
+    return in_flight;
+}
+
 /**
  * @brief HID Host claim Interface and prepare transfer, change state to READY
  *
  * @param[in] iface       Pointer to Interface structure,
+ * @param[in] config      HID device configuration
  * @return esp_err_t
  */
-static esp_err_t hid_host_interface_claim_and_prepare_transfer(hid_iface_t *iface)
+static esp_err_t hid_host_interface_claim_and_prepare_transfer(hid_iface_t *iface,
+        const hid_host_device_config_t *config)
 {
     HID_RETURN_ON_ERROR( usb_host_interface_claim( s_hid_driver->client_handle,
                          iface->parent->dev_hdl,
                          iface->dev_params.iface_num, 0),
                          "Unable to claim Interface");
 
-    HID_RETURN_ON_ERROR( usb_host_transfer_alloc(iface->ep_in_mps, 0, &iface->in_xfer),
-                         "Unable to allocate transfer buffer for EP IN");
+    esp_err_t ret = ESP_OK;
+    iface->in_xfer_num = config->in_xfer_num ? config->in_xfer_num : HID_IN_XFER_NUM;
+    for (int i = 0; i < iface->in_xfer_num && ret == ESP_OK; i++) {
+        ret = USB_HOST_XFER_POOL_ALLOC(iface->ep_in_mps, 0, &iface->in_xfer[i]);
+    }
+
+    // Output transfers serve both the interrupt OUT EP and the control fallback
+    const size_t out_xfer_size = MAX(iface->ep_out_mps, USB_SETUP_PACKET_SIZE + HID_ASYNC_REPORT_MAX_LEN);
+    for (int i = 0; i < HID_OUT_XFER_NUM && ret == ESP_OK; i++) {
+        ret = USB_HOST_XFER_POOL_ALLOC(out_xfer_size, 0, &iface->out_xfer[i].xfer);
+        iface->out_xfer[i].iface = iface;
+    }
+    iface->out_xfer_busy = 0;
+
+    if (ret == ESP_OK && config->report_queue_size) {
+        const size_t item_size = sizeof(hid_report_item_t) + iface->ep_in_mps;
+        iface->report_queue = xQueueCreate(config->report_queue_size, item_size);
+        iface->report_item = malloc(item_size);
+        iface->read_item = malloc(item_size);
+        if (!iface->report_queue || !iface->report_item || !iface->read_item) {
+            ret = ESP_ERR_NO_MEM;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = hid_host_interface_prepare_delivery(iface, config);
+    }
+    if (ret == ESP_OK && config->idle_poll_timeout_ms) {
+        ret = hid_host_interface_prepare_polling(iface, config);
+    }
+    memset(&iface->report_stats, 0, sizeof(hid_host_report_stats_t));
+    memset(&iface->latency_stats, 0, sizeof(hid_host_latency_stats_t));
+    iface->last_completion_us = 0;
+    iface->interval_sum_us = 0;
+    iface->interval_count = 0;
+    iface->delivered_us = 0;
+    iface->latest_read_seq = 0;
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Unable to allocate transfer buffer for EP IN");
+        hid_host_interface_free_transfers(iface);
+        usb_host_interface_release(s_hid_driver->client_handle,
+                                   iface->parent->dev_hdl,
+                                   iface->dev_params.iface_num);
+        return ret;
+    }
 
     // Change state
     iface->state = HID_INTERFACE_STATE_READY;
@@ -601,12 +1343,26 @@ static esp_err_t hid_host_interface_release_and_free_transfer(hid_iface_t *iface
                         ESP_ERR_NOT_FOUND,
                         "Interface handle not found");
 
+    if (iface->ep_out) {
+        // Cancel output reports in flight
+        HID_RETURN_ON_ERROR( usb_host_endpoint_halt(iface->parent->dev_hdl, iface->ep_out),
+                             "Unable to HALT EP");
+        HID_RETURN_ON_ERROR( usb_host_endpoint_flush(iface->parent->dev_hdl, iface->ep_out),
+                             "Unable to FLUSH EP");
+        usb_host_endpoint_clear(iface->parent->dev_hdl, iface->ep_out);
+    }
+
+    // Control transfers can't be cancelled, they complete with the device or time out
+    HID_RETURN_ON_FALSE(!hid_host_interface_control_in_flight(iface),
+                        ESP_ERR_NOT_FINISHED,
+                        "Asynchronous control requests in flight");
+
     HID_RETURN_ON_ERROR( usb_host_interface_release(s_hid_driver->client_handle,
                          iface->parent->dev_hdl,
                          iface->dev_params.iface_num),
                          "Unable to release HID Interface");
 
-    ESP_ERROR_CHECK( usb_host_transfer_free(iface->in_xfer) );
+    hid_host_interface_free_transfers(iface);
 
     // Change state
     iface->state = HID_INTERFACE_STATE_IDLE;
@@ -614,67 +1370,282 @@ static esp_err_t hid_host_interface_release_and_free_transfer(hid_iface_t *iface
 }
 
 /**
- * @brief Disable active interface
+ * @brief Disable active interface
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t hid_host_disable_interface(hid_iface_t *iface)
+{
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(iface->parent);
+
+    HID_RETURN_ON_FALSE(is_interface_in_list(iface),
+                        ESP_ERR_NOT_FOUND,
+                        "Interface handle not found");
+
+    HID_RETURN_ON_FALSE((HID_INTERFACE_STATE_ACTIVE == iface->state),
+                        ESP_ERR_INVALID_STATE,
+                        "Interface wrong state");
+
+    if (iface->poll_timer) {
+        // Adaptive polling does not submit transfers from this point, the mutex is not held across the endpoint calls
+        xSemaphoreTake(iface->poll_mutex, portMAX_DELAY);
+        esp_timer_stop(iface->poll_timer);
+        iface->poll_running = false;
+        xSemaphoreGive(iface->poll_mutex);
+    }
+    esp_err_t ret = usb_host_endpoint_halt(iface->parent->dev_hdl, iface->ep_in);
+    if (ret == ESP_OK) {
+        ret = usb_host_endpoint_flush(iface->parent->dev_hdl, iface->ep_in);
+    }
+    if (ret == ESP_OK) {
+        usb_host_endpoint_clear(iface->parent->dev_hdl, iface->ep_in);
+        iface->state = HID_INTERFACE_STATE_READY;
+    }
+    HID_RETURN_ON_ERROR( ret, "Unable to HALT and FLUSH EP");
+
+    return ESP_OK;
+}
+
+/**
+ * @brief HID IN Transfer complete callback
+ *
+ * @param[in] transfer  Pointer to transfer data structure
+ */
+static void in_xfer_done(usb_transfer_t *in_xfer)
+{
+    assert(in_xfer);
+    assert(in_xfer->context);
+
+    hid_iface_t *iface = (hid_iface_t *) in_xfer->context;
+    hid_host_in_xfer_returned(iface, in_xfer);
+
+    switch (in_xfer->status) {
+    case USB_TRANSFER_STATUS_COMPLETED: {
+        // Completion time, before any processing of the report
+        const int64_t timestamp_us = esp_timer_get_time();
+        hid_host_record_completion(iface, timestamp_us);
+        if (iface->poll_timer) {
+            hid_host_poll_report(iface, in_xfer, timestamp_us);
+        }
+        iface->last_in_xfer = in_xfer;
+        iface->report_stats.received++;
+        if (iface->report_queue) {
+            // The report is queued for the reader task and the transfer is relaunched at once,
+            // no matter how long the reader takes
+            hid_report_item_t *item = iface->report_item;
+            item->timestamp_us = timestamp_us;
+            item->length = in_xfer->actual_num_bytes;
+            memcpy(item->data, in_xfer->data_buffer, item->length);
+            hid_host_in_xfer_submit(iface, in_xfer);
+            if (xQueueSend(iface->report_queue, item, 0) != pdTRUE) {
+                iface->report_stats.dropped++;
+            }
+            return;
+        }
+        if (iface->report_delivery == HID_HOST_REPORT_DELIVERY_LATEST) {
+            HID_IFACE_ENTER_CRITICAL(iface);
+            iface->latest->timestamp_us = timestamp_us;
+            iface->latest->length = in_xfer->actual_num_bytes;
+            memcpy(iface->latest->data, in_xfer->data_buffer, in_xfer->actual_num_bytes);
+            iface->latest_seq++;
+            HID_IFACE_EXIT_CRITICAL(iface);
+            hid_host_in_xfer_submit(iface, in_xfer);
+            return;
+        }
+        if (iface->report_delivery == HID_HOST_REPORT_DELIVERY_BATCH) {
+            xSemaphoreTake(iface->batch_mutex, portMAX_DELAY);
+            uint8_t *slot = iface->batch_data + (size_t)iface->batch_count * iface->ep_in_mps;
+            memcpy(slot, in_xfer->data_buffer, in_xfer->actual_num_bytes);
+            iface->batch[iface->batch_count].data = slot;
+            iface->batch[iface->batch_count].length = in_xfer->actual_num_bytes;
+            iface->batch[iface->batch_count].timestamp_us = timestamp_us;
+            if (++iface->batch_count == 1 && iface->batch_timer) {
+                esp_timer_start_once(iface->batch_timer, (uint64_t)iface->batch_time_ms * 1000);
+            }
+            hid_host_in_xfer_submit(iface, in_xfer);
+            if (iface->batch_count == iface->batch_size) {
+                hid_host_interface_flush_batch(iface);
+            }
+            xSemaphoreGive(iface->batch_mutex);
+            return;
+        }
+        // Notify user, the other transfer is already queued for the next report,
+        // while the buffer of this one stays unchanged until the callback returns
+        hid_host_record_delivery(iface, timestamp_us);
+        hid_host_user_interface_data_callback(iface,
+                                              HID_HOST_INTERFACE_EVENT_INPUT_REPORT,
+                                              in_xfer->data_buffer,
+                                              in_xfer->actual_num_bytes,
+                                              timestamp_us);
+        // Relaunch transfer
+        hid_host_in_xfer_submit(iface, in_xfer);
+        return;
+    }
+    case USB_TRANSFER_STATUS_CANCELED:
+        if (iface->poll_timer) {
+            hid_host_poll_cancelled(iface, in_xfer);
+        }
+        return;
+    case USB_TRANSFER_STATUS_NO_DEVICE:
+        // User is notified about device disconnection from usb_event_cb
+        // No need to do anything
+        return;
+    default:
+        // Any other error
+        break;
+    }
+
+    ESP_LOGE(TAG, "Transfer failed, status %d", in_xfer->status);
+    // Notify user about transfer or any other error
+    hid_host_user_interface_callback(iface, HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR);
+}
+
+/**
+ * @brief HID asynchronous output or control transfer complete callback
+ *
+ * @param[in] out_xfer  Pointer to transfer data structure
+ */
+static void out_xfer_done(usb_transfer_t *out_xfer)
+{
+    assert(out_xfer);
+    assert(out_xfer->context);
+
+    hid_out_xfer_t *ctx = (hid_out_xfer_t *) out_xfer->context;
+    hid_iface_t *iface = ctx->iface;
+    const bool is_control = (out_xfer->bEndpointAddress == 0);
+    const uint8_t *data = NULL;
+    size_t length = 0;
+    esp_err_t status;
+
+    switch (out_xfer->status) {
+    case USB_TRANSFER_STATUS_COMPLETED:
+        status = ESP_OK;
+        if (is_control && (out_xfer->actual_num_bytes > USB_SETUP_PACKET_SIZE)) {
+            // Response of GET_REPORT follows the setup packet
+            data = out_xfer->data_buffer + USB_SETUP_PACKET_SIZE;
+            length = out_xfer->actual_num_bytes - USB_SETUP_PACKET_SIZE;
+        }
+        break;
+    case USB_TRANSFER_STATUS_TIMED_OUT:
+        status = ESP_ERR_TIMEOUT;
+        break;
+    case USB_TRANSFER_STATUS_NO_DEVICE:
+    case USB_TRANSFER_STATUS_CANCELED:
+        status = ESP_ERR_INVALID_STATE;
+        break;
+    default:
+        status = ESP_FAIL;
+        break;
+    }
+
+    if (ctx->callback) {
+        ctx->callback(iface->handle, status, data, length, ctx->callback_arg);
+    }
+
+    // Release the transfer after the callback, the response buffer is valid until it returns
+    HID_IFACE_ENTER_CRITICAL(iface);
+    iface->out_xfer_busy &= ~(1U << (ctx - iface->out_xfer));
+    HID_IFACE_EXIT_CRITICAL(iface);
+}
+
+/**
+ * @brief Take a free asynchronous transfer of the Interface
  *
  * @param[in] iface       Pointer to Interface structure
- * @return esp_err_t
+ * @param[in] callback    Completion callback
+ * @param[in] arg         Completion callback argument
+ * @return hid_out_xfer_t Pointer to the transfer, NULL if all are in flight
  */
-static esp_err_t hid_host_disable_interface(hid_iface_t *iface)
+static hid_out_xfer_t *hid_host_interface_take_out_xfer(hid_iface_t *iface,
+        hid_host_report_done_cb_t callback,
+        void *arg)
 {
-    HID_RETURN_ON_INVALID_ARG(iface);
-    HID_RETURN_ON_INVALID_ARG(iface->parent);
-
-    HID_RETURN_ON_FALSE(is_interface_in_list(iface),
-                        ESP_ERR_NOT_FOUND,
-                        "Interface handle not found");
-
-    HID_RETURN_ON_FALSE((HID_INTERFACE_STATE_ACTIVE == iface->state),
-                        ESP_ERR_INVALID_STATE,
-                        "Interface wrong state");
-
-    HID_RETURN_ON_ERROR( usb_host_endpoint_halt(iface->parent->dev_hdl, iface->ep_in),
-                         "Unable to HALT EP");
-    HID_RETURN_ON_ERROR( usb_host_endpoint_flush(iface->parent->dev_hdl, iface->ep_in),
-                         "Unable to FLUSH EP");
-    usb_host_endpoint_clear(iface->parent->dev_hdl, iface->ep_in);
-
-    iface->state = HID_INTERFACE_STATE_READY;
+    hid_out_xfer_t *ctx = NULL;
+
+    HID_IFACE_ENTER_CRITICAL(iface);
+    for (int i = 0; i < HID_OUT_XFER_NUM; i++) {
+        if (iface->out_xfer[i].xfer && !(iface->out_xfer_busy & (1U << i))) {
+            iface->out_xfer_busy |= (1U << i);
+            ctx = &iface->out_xfer[i];
+            break;
+        }
+    }
+    HID_IFACE_EXIT_CRITICAL(iface);
+
+    if (ctx) {
+        ctx->callback = callback;
+        ctx->callback_arg = arg;
+        ctx->xfer->device_handle = iface->parent->dev_hdl;
+        ctx->xfer->callback = out_xfer_done;
+        ctx->xfer->context = ctx;
+        ctx->xfer->timeout_ms = DEFAULT_TIMEOUT_MS;
+    }
+    return ctx;
+}
 
-    return ESP_OK;
+/**
+ * @brief Give back a transfer, which was not submitted
+ *
+ * @param[in] ctx         Pointer to the transfer
+ */
+static void hid_host_interface_give_out_xfer(hid_out_xfer_t *ctx)
+{
+    HID_IFACE_ENTER_CRITICAL(ctx->iface);
+    ctx->iface->out_xfer_busy &= ~(1U << (ctx - ctx->iface->out_xfer));
+    HID_IFACE_EXIT_CRITICAL(ctx->iface);
 }
 
 /**
- * @brief HID IN Transfer complete callback
+ * @brief Submit asynchronous class specific request of the Interface
  *
- * @param[in] transfer  Pointer to transfer data structure
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] req         Pointer to a class specific request structure, data is sent with OUT requests
+ * @param[in] dir_in      Direction of the request, true for IN
+ * @param[in] callback    Completion callback
+ * @param[in] arg         Completion callback argument
+ * @return esp_err_t
  */
-static void in_xfer_done(usb_transfer_t *in_xfer)
+static esp_err_t hid_class_request_async(hid_iface_t *iface,
+        const hid_class_request_t *req,
+        bool dir_in,
+        hid_host_report_done_cb_t callback,
+        void *arg)
 {
-    assert(in_xfer);
-    assert(in_xfer->context);
+    HID_RETURN_ON_FALSE(req->wLength <= HID_ASYNC_REPORT_MAX_LEN,
+                        ESP_ERR_INVALID_SIZE,
+                        "Report is too long for asynchronous request");
 
-    hid_iface_t *iface = (hid_iface_t *) in_xfer->context;
+    hid_out_xfer_t *ctx = hid_host_interface_take_out_xfer(iface, callback, arg);
 
-    switch (in_xfer->status) {
-    case USB_TRANSFER_STATUS_COMPLETED:
-        // Notify user
-        hid_host_user_interface_callback(iface, HID_HOST_INTERFACE_EVENT_INPUT_REPORT);
-        // Relaunch transfer
-        usb_host_transfer_submit(in_xfer);
-        return;
-    case USB_TRANSFER_STATUS_NO_DEVICE:
-    case USB_TRANSFER_STATUS_CANCELED:
-        // User is notified about device disconnection from usb_event_cb
-        // No need to do anything
-        return;
-    default:
-        // Any other error
-        break;
+    HID_RETURN_ON_FALSE(ctx,
+                        ESP_ERR_NO_MEM,
+                        "All asynchronous transfers are in flight");
+
+    usb_transfer_t *xfer = ctx->xfer;
+    usb_setup_packet_t *setup = (usb_setup_packet_t *)xfer->data_buffer;
+    setup->bmRequestType = (dir_in ? USB_BM_REQUEST_TYPE_DIR_IN : USB_BM_REQUEST_TYPE_DIR_OUT) |
+                           USB_BM_REQUEST_TYPE_TYPE_CLASS |
+                           USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    setup->bRequest = req->bRequest;
+    setup->wValue = req->wValue;
+    setup->wIndex = req->wIndex;
+    setup->wLength = req->wLength;
+
+    if (!dir_in && req->wLength && req->data) {
+        memcpy(xfer->data_buffer + USB_SETUP_PACKET_SIZE, req->data, req->wLength);
     }
 
-    ESP_LOGE(TAG, "Transfer failed, status %d", in_xfer->status);
-    // Notify user about transfer or any other error
-    hid_host_user_interface_callback(iface, HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR);
+    xfer->bEndpointAddress = 0;
+    xfer->num_bytes = USB_SETUP_PACKET_SIZE + req->wLength;
+
+    esp_err_t ret = usb_host_transfer_submit_control(s_hid_driver->client_handle, xfer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Unable to submit control transfer");
+        hid_host_interface_give_out_xfer(ctx);
+    }
+    return ret;
 }
 
 /** Lock HID device from other task
@@ -791,8 +1762,8 @@ static esp_err_t usb_class_request_get_descriptor(hid_device_t *hid_device, cons
                  (int) ctrl_size,
                  (int) (USB_SETUP_PACKET_SIZE + req->wLength));
 
-        usb_host_transfer_free(hid_device->ctrl_xfer);
-        HID_RETURN_ON_ERROR( usb_host_transfer_alloc(USB_SETUP_PACKET_SIZE + req->wLength,
+        USB_HOST_XFER_POOL_FREE(hid_device->ctrl_xfer);
+        HID_RETURN_ON_ERROR( USB_HOST_XFER_POOL_ALLOC(USB_SETUP_PACKET_SIZE + req->wLength,
                              0,
                              &hid_device->ctrl_xfer),
                              "Unable to allocate transfer buffer for EP0");
@@ -826,9 +1797,74 @@ static esp_err_t usb_class_request_get_descriptor(hid_device_t *hid_device, cons
     return ret;
 }
 
+/**
+ * @brief Copy Report Descriptor of a known device from the cache
+ *
+ * @param[in] iface       Pointer to HID Interface, report_desc is allocated with report_desc_size
+ * @param[in] dev_desc    Device descriptor
+ * @return true, if the Report Descriptor was found
+ */
+static bool hid_report_desc_cache_get(hid_iface_t *iface, const usb_device_desc_t *dev_desc)
+{
+    bool found = false;
+
+    HID_ENTER_CRITICAL();
+    for (int i = 0; i < HID_REPORT_DESC_CACHE_SIZE; i++) {
+        hid_report_desc_cache_t *entry = &s_hid_driver->report_desc_cache[i];
+        if (entry->desc && entry->vid == dev_desc->idVendor && entry->pid == dev_desc->idProduct &&
+                entry->bcd_device == dev_desc->bcdDevice && entry->iface_num == iface->dev_params.iface_num &&
+                entry->size == iface->report_desc_size) {
+            memcpy(iface->report_desc, entry->desc, entry->size);
+            entry->last_used = ++s_hid_driver->report_desc_cache_uses;
+            found = true;
+            break;
+        }
+    }
+    HID_EXIT_CRITICAL();
+    return found;
+}
+
+/**
+ * @brief Add Report Descriptor to the cache, in place of the least recently used one
+ *
+ * @param[in] iface       Pointer to HID Interface with the Report Descriptor
+ * @param[in] dev_desc    Device descriptor
+ */
+static void hid_report_desc_cache_put(hid_iface_t *iface, const usb_device_desc_t *dev_desc)
+{
+    uint8_t *desc = malloc(iface->report_desc_size);
+    if (!desc) {
+        return; // The cache is optional
+    }
+    memcpy(desc, iface->report_desc, iface->report_desc_size);
+
+    HID_ENTER_CRITICAL();
+    hid_report_desc_cache_t *entry = &s_hid_driver->report_desc_cache[0];
+    for (int i = 1; i < HID_REPORT_DESC_CACHE_SIZE && entry->desc; i++) {
+        hid_report_desc_cache_t *other = &s_hid_driver->report_desc_cache[i];
+        if (!other->desc || other->last_used < entry->last_used) {
+            entry = other;
+        }
+    }
+    uint8_t *old_desc = entry->desc;
+    entry->vid = dev_desc->idVendor;
+    entry->pid = dev_desc->idProduct;
+    entry->bcd_device = dev_desc->bcdDevice;
+    entry->iface_num = iface->dev_params.iface_num;
+    entry->size = iface->report_desc_size;
+    entry->desc = desc;
+    entry->last_used = ++s_hid_driver->report_desc_cache_uses;
+    HID_EXIT_CRITICAL();
+
+    free(old_desc);
+}
+
 /**
  * @brief HID Host Request Report Descriptor
  *
+ * The Report Descriptor of a known device (VID, PID, bcdDevice and Interface number) is taken from the cache,
+ * without a control transfer.
+ *
  * @param[in] iface       Pointer to HID Interface configuration structure
  * @return esp_err_t
  */
@@ -855,7 +1891,27 @@ static esp_err_t hid_class_request_report_descriptor(hid_iface_t *iface)
         .data = iface->report_desc
     };
 
-    return usb_class_request_get_descriptor(iface->parent, &get_desc);
+    const usb_device_desc_t *dev_desc = NULL;
+    if (usb_host_get_device_descriptor(iface->parent->dev_hdl, &dev_desc) != ESP_OK) {
+        dev_desc = NULL;
+    }
+    if (dev_desc && hid_report_desc_cache_get(iface, dev_desc)) {
+        ESP_LOGD(TAG, "Report descriptor of iface %d from cache", iface->dev_params.iface_num);
+        return ESP_OK;
+    }
+
+    esp_err_t ret = usb_class_request_get_descriptor(iface->parent, &get_desc);
+    if (ret != ESP_OK) {
+        // Request again on the next call
+        free(iface->report_desc);
+        iface->report_desc = NULL;
+        return ret;
+    }
+
+    if (dev_desc) {
+        hid_report_desc_cache_put(iface, dev_desc);
+    }
+    return ESP_OK;
 }
 
 /**
@@ -1001,7 +2057,7 @@ esp_err_t hid_host_install_device(uint8_t dev_addr,
     * To take the size of a report descriptor into a consideration,
     * we need to allocate more here, e.g. 512 bytes.
     */
-    HID_GOTO_ON_ERROR(usb_host_transfer_alloc(512, 0, &hid_device->ctrl_xfer),
+    HID_GOTO_ON_ERROR(USB_HOST_XFER_POOL_ALLOC(512, 0, &hid_device->ctrl_xfer),
                       "Unable to allocate transfer buffer");
 
     HID_ENTER_CRITICAL();
@@ -1025,7 +2081,7 @@ esp_err_t hid_host_uninstall_device(hid_device_t *hid_device)
 {
     HID_RETURN_ON_INVALID_ARG(hid_device);
 
-    HID_RETURN_ON_ERROR( usb_host_transfer_free(hid_device->ctrl_xfer),
+    HID_RETURN_ON_ERROR( USB_HOST_XFER_POOL_FREE(hid_device->ctrl_xfer),
                          "Unable to free transfer buffer for EP0");
     HID_RETURN_ON_ERROR( usb_host_device_close(s_hid_driver->client_handle,
                          hid_device->dev_hdl),
@@ -1157,6 +2213,9 @@ esp_err_t hid_host_uninstall(void)
     }
     vSemaphoreDelete(s_hid_driver->all_events_handled);
     ESP_ERROR_CHECK( usb_host_client_deregister(s_hid_driver->client_handle) );
+    for (int i = 0; i < HID_REPORT_DESC_CACHE_SIZE; i++) {
+        free(s_hid_driver->report_desc_cache[i].desc);
+    }
     free(s_hid_driver);
     s_hid_driver = NULL;
     return ESP_OK;
@@ -1182,13 +2241,29 @@ esp_err_t hid_host_device_open(hid_host_device_handle_t hid_dev_handle,
                         ESP_ERR_INVALID_STATE,
                         "Interface wrong state");
 
+    HID_RETURN_ON_FALSE(config->in_xfer_num <= HID_IN_XFER_NUM_MAX,
+                        ESP_ERR_INVALID_ARG,
+                        "Too many IN transfers");
+
+    HID_RETURN_ON_FALSE((config->report_delivery == HID_HOST_REPORT_DELIVERY_EACH)
+                        || (config->report_queue_size == 0),
+                        ESP_ERR_INVALID_ARG,
+                        "Report queue requires HID_HOST_REPORT_DELIVERY_EACH");
+
+    HID_RETURN_ON_FALSE((config->report_delivery != HID_HOST_REPORT_DELIVERY_BATCH)
+                        || config->event_data_callback,
+                        ESP_ERR_INVALID_ARG,
+                        "Report batch requires event_data_callback");
+
     // Claim interface, allocate xfer and save report callback
-    HID_RETURN_ON_ERROR( hid_host_interface_claim_and_prepare_transfer(hid_iface),
+    HID_RETURN_ON_ERROR( hid_host_interface_claim_and_prepare_transfer(hid_iface, config),
                          "Unable to claim interface");
 
     // Save HID Interface callback
     hid_iface->user_cb = config->callback;
+    hid_iface->user_data_cb = config->event_data_callback;
     hid_iface->user_cb_arg = config->callback_arg;
+    HID_ENUM_MARK(hid_iface->dev_params.addr, "opened");
 
     return ESP_OK;
 }
@@ -1216,15 +2291,19 @@ esp_err_t hid_host_device_close(hid_host_device_handle_t hid_dev_handle)
         // If the device is closing by user before device detached we need to flush user callback here
         free(hid_iface->report_desc);
         hid_iface->report_desc = NULL;
+        hid_report_map_delete(hid_iface->report_map);
+        hid_iface->report_map = NULL;
     }
 
-    if (hid_iface->user_cb && hid_iface->state != HID_INTERFACE_STATE_WAIT_USER_DELETION) {
+    if ((hid_iface->user_cb || hid_iface->user_data_cb) &&
+            hid_iface->state != HID_INTERFACE_STATE_WAIT_USER_DELETION) {
         // Let user handle the remove process and wait for next hid_host_device_close() call
         hid_iface->state = HID_INTERFACE_STATE_WAIT_USER_DELETION;
         hid_host_user_interface_callback(hid_iface, HID_HOST_INTERFACE_EVENT_DISCONNECTED);
     } else {
         // Second call
         hid_iface->user_cb = NULL;
+        hid_iface->user_data_cb = NULL;
         hid_iface->user_cb_arg = NULL;
 
         /* Remove Interface from the list */
@@ -1248,6 +2327,7 @@ esp_err_t hid_host_handle_events(uint32_t timeout)
     ESP_LOGD(TAG, "USB HID handling");
     s_hid_driver->event_handling_started = true;
     esp_err_t ret = usb_host_client_handle_events(s_hid_driver->client_handle, timeout);
+    hid_host_poll_process();
     if (s_hid_driver->end_client_event_handling) {
         xSemaphoreGive(s_hid_driver->all_events_handled);
         return ESP_FAIL;
@@ -1291,11 +2371,154 @@ esp_err_t hid_host_device_get_raw_input_report_data(hid_host_device_handle_t hid
                         ESP_ERR_INVALID_ARG,
                         "Wrong argument");
 
-    size_t copied = (data_length_max >= iface->in_xfer->actual_num_bytes)
-                    ? iface->in_xfer->actual_num_bytes
+    HID_RETURN_ON_FALSE(iface->last_in_xfer,
+                        ESP_ERR_INVALID_STATE,
+                        "No input report received");
+
+    const usb_transfer_t *in_xfer = iface->last_in_xfer;
+    size_t copied = (data_length_max >= in_xfer->actual_num_bytes)
+                    ? in_xfer->actual_num_bytes
                     : data_length_max;
-    memcpy(data, iface->in_xfer->data_buffer, copied);
+    memcpy(data, in_xfer->data_buffer, copied);
+    *data_length = copied;
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_read_input_report(hid_host_device_handle_t hid_dev_handle,
+        uint8_t *data,
+        size_t data_length_max,
+        size_t *data_length,
+        TickType_t timeout)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_FALSE(iface,
+                        ESP_ERR_INVALID_STATE,
+                        "HID Interface not found");
+
+    HID_RETURN_ON_FALSE(data && data_length,
+                        ESP_ERR_INVALID_ARG,
+                        "Wrong argument");
+
+    HID_RETURN_ON_FALSE(iface->report_queue,
+                        ESP_ERR_INVALID_STATE,
+                        "Report queue is not enabled");
+
+    if (xQueueReceive(iface->report_queue, iface->read_item, timeout) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    const size_t copied = MIN(data_length_max, iface->read_item->length);
+    memcpy(data, iface->read_item->data, copied);
+    *data_length = copied;
+    iface->delivered_us = iface->read_item->timestamp_us;
+    hid_host_record_delivery(iface, iface->read_item->timestamp_us);
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_get_latest_input_report(hid_host_device_handle_t hid_dev_handle,
+        uint8_t *data,
+        size_t data_length_max,
+        size_t *data_length,
+        uint32_t *sequence)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_FALSE(iface,
+                        ESP_ERR_INVALID_STATE,
+                        "HID Interface not found");
+
+    HID_RETURN_ON_FALSE(data && data_length,
+                        ESP_ERR_INVALID_ARG,
+                        "Wrong argument");
+
+    HID_RETURN_ON_FALSE(iface->latest,
+                        ESP_ERR_INVALID_STATE,
+                        "Report delivery is not HID_HOST_REPORT_DELIVERY_LATEST");
+
+    HID_IFACE_ENTER_CRITICAL(iface);
+    const uint32_t seq = iface->latest_seq;
+    const size_t copied = MIN(data_length_max, iface->latest->length);
+    memcpy(data, iface->latest->data, copied);
+    const int64_t timestamp_us = iface->latest->timestamp_us;
+    // Only the first read of each report is its delivery
+    const bool delivered = seq != iface->latest_read_seq;
+    iface->latest_read_seq = seq;
+    HID_IFACE_EXIT_CRITICAL(iface);
+
+    if (seq == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    iface->delivered_us = timestamp_us;
+    if (delivered) {
+        hid_host_record_delivery(iface, timestamp_us);
+    }
     *data_length = copied;
+    if (sequence) {
+        *sequence = seq;
+    }
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_get_report_stats(hid_host_device_handle_t hid_dev_handle,
+        hid_host_report_stats_t *stats)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_FALSE(iface,
+                        ESP_ERR_INVALID_STATE,
+                        "HID Interface not found");
+
+    HID_RETURN_ON_FALSE(stats,
+                        ESP_ERR_INVALID_ARG,
+                        "Wrong argument");
+
+    *stats = iface->report_stats;
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_get_report_time(hid_host_device_handle_t hid_dev_handle,
+        int64_t *timestamp_us)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_FALSE(iface,
+                        ESP_ERR_INVALID_STATE,
+                        "HID Interface not found");
+
+    HID_RETURN_ON_FALSE(timestamp_us,
+                        ESP_ERR_INVALID_ARG,
+                        "Wrong argument");
+
+    if (iface->delivered_us == 0) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *timestamp_us = iface->delivered_us;
+    return ESP_OK;
+}
+
+esp_err_t hid_host_device_get_latency_stats(hid_host_device_handle_t hid_dev_handle,
+        hid_host_latency_stats_t *stats)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_FALSE(iface,
+                        ESP_ERR_INVALID_STATE,
+                        "HID Interface not found");
+
+    HID_RETURN_ON_FALSE(stats,
+                        ESP_ERR_INVALID_ARG,
+                        "Wrong argument");
+
+    uint32_t interval_us;
+    HID_RETURN_ON_ERROR( hid_host_ep_in_interval_us(iface, &interval_us),
+                         "Unable to get polling interval");
+
+    HID_IFACE_ENTER_CRITICAL(iface);
+    *stats = iface->latency_stats;
+    stats->interval_avg_us = iface->interval_count ? (uint32_t)(iface->interval_sum_us / iface->interval_count) : 0;
+    HID_IFACE_EXIT_CRITICAL(iface);
+    stats->ep_interval_us = interval_us;
     return ESP_OK;
 }
 
@@ -1306,7 +2529,7 @@ esp_err_t hid_host_device_start(hid_host_device_handle_t hid_dev_handle)
     hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
 
     HID_RETURN_ON_INVALID_ARG(iface);
-    HID_RETURN_ON_INVALID_ARG(iface->in_xfer);
+    HID_RETURN_ON_INVALID_ARG(iface->in_xfer[0]);
     HID_RETURN_ON_INVALID_ARG(iface->parent);
 
     HID_RETURN_ON_FALSE(is_interface_in_list(iface),
@@ -1317,18 +2540,30 @@ esp_err_t hid_host_device_start(hid_host_device_handle_t hid_dev_handle)
                          ESP_ERR_INVALID_STATE,
                          "Interface wrong state");
 
-    // prepare transfer
-    iface->in_xfer->device_handle = iface->parent->dev_hdl;
-    iface->in_xfer->callback = in_xfer_done;
-    iface->in_xfer->context = iface;
-    iface->in_xfer->timeout_ms = DEFAULT_TIMEOUT_MS;
-    iface->in_xfer->bEndpointAddress = iface->ep_in;
-    iface->in_xfer->num_bytes = iface->ep_in_mps;
-
+    iface->in_xfer_busy = 0;
+    iface->poll_state = HID_POLL_CONTINUOUS;
+    iface->poll_last_us = esp_timer_get_time();
     iface->state = HID_INTERFACE_STATE_ACTIVE;
 
-    // start data transfer
-    return usb_host_transfer_submit(iface->in_xfer);
+    // prepare and start data transfers
+    for (int i = 0; i < iface->in_xfer_num; i++) {
+        usb_transfer_t *in_xfer = iface->in_xfer[i];
+        in_xfer->device_handle = iface->parent->dev_hdl;
+        in_xfer->callback = in_xfer_done;
+        in_xfer->context = iface;
+        in_xfer->timeout_ms = DEFAULT_TIMEOUT_MS;
+        in_xfer->bEndpointAddress = iface->ep_in;
+        in_xfer->num_bytes = iface->ep_in_mps;
+
+        HID_RETURN_ON_ERROR( hid_host_in_xfer_submit(iface, in_xfer),
+                             "Unable to submit IN transfer");
+    }
+    if (iface->poll_timer) {
+        iface->poll_running = true;
+        esp_timer_start_once(iface->poll_timer, iface->poll_timeout_us);
+    }
+    HID_ENUM_MARK(iface->dev_params.addr, "started");
+    return ESP_OK;
 }
 
 esp_err_t hid_host_device_stop(hid_host_device_handle_t hid_dev_handle)
@@ -1364,6 +2599,29 @@ uint8_t *hid_host_get_report_descriptor(hid_host_device_handle_t hid_dev_handle,
     return NULL;
 }
 
+esp_err_t hid_host_get_report_map(hid_host_device_handle_t hid_dev_handle,
+                                  const hid_report_map_t **report_map)
+{
+    HID_RETURN_ON_INVALID_ARG(report_map);
+
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+    HID_RETURN_ON_INVALID_ARG(iface);
+
+    // Report Descriptor is compiled once per Interface
+    if (!iface->report_map) {
+        size_t report_desc_len;
+        const uint8_t *report_desc = hid_host_get_report_descriptor(hid_dev_handle, &report_desc_len);
+        HID_RETURN_ON_FALSE(report_desc,
+                            ESP_ERR_INVALID_STATE,
+                            "Unable to get report descriptor");
+        HID_RETURN_ON_ERROR( hid_report_map_create(report_desc, report_desc_len, &iface->report_map),
+                             "Unable to parse report descriptor");
+    }
+
+    *report_map = iface->report_map;
+    return ESP_OK;
+}
+
 esp_err_t hid_host_get_device_info(hid_host_device_handle_t hid_dev_handle,
                                    hid_host_dev_info_t *hid_dev_info)
 {
@@ -1525,3 +2783,110 @@ esp_err_t hid_class_request_set_protocol(hid_host_device_handle_t hid_dev_handle
 
     return hid_class_request_set(iface->parent, &set_proto);
 }
+
+esp_err_t hid_host_device_send_output_report_async(hid_host_device_handle_t hid_dev_handle,
+        uint8_t report_id,
+        const uint8_t *report,
+        size_t report_length,
+        hid_host_report_done_cb_t callback,
+        void *arg)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(report);
+
+    HID_RETURN_ON_FALSE((HID_INTERFACE_STATE_READY == iface->state) ||
+                        (HID_INTERFACE_STATE_ACTIVE == iface->state),
+                        ESP_ERR_INVALID_STATE,
+                        "Interface is not opened");
+
+    if (!iface->ep_out) {
+        // No interrupt OUT EP, the report is sent by SET_REPORT
+        const hid_class_request_t set_report = {
+            .bRequest = HID_CLASS_SPECIFIC_REQ_SET_REPORT,
+            .wValue = (HID_REPORT_TYPE_OUTPUT << 8) | report_id,
+            .wIndex = iface->dev_params.iface_num,
+            .wLength = report_length,
+            .data = (uint8_t *)report
+        };
+        return hid_class_request_async(iface, &set_report, false, callback, arg);
+    }
+
+    HID_RETURN_ON_FALSE(report_length <= iface->ep_out_mps,
+                        ESP_ERR_INVALID_SIZE,
+                        "Report is longer than EP OUT max size");
+
+    hid_out_xfer_t *ctx = hid_host_interface_take_out_xfer(iface, callback, arg);
+
+    HID_RETURN_ON_FALSE(ctx,
+                        ESP_ERR_NO_MEM,
+                        "All asynchronous transfers are in flight");
+
+    memcpy(ctx->xfer->data_buffer, report, report_length);
+    ctx->xfer->bEndpointAddress = iface->ep_out;
+    ctx->xfer->num_bytes = report_length;
+
+    esp_err_t ret = usb_host_transfer_submit(ctx->xfer);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Unable to submit EP OUT transfer");
+        hid_host_interface_give_out_xfer(ctx);
+    }
+    return ret;
+}
+
+esp_err_t hid_class_request_set_report_async(hid_host_device_handle_t hid_dev_handle,
+        uint8_t report_type,
+        uint8_t report_id,
+        const uint8_t *report,
+        size_t report_length,
+        hid_host_report_done_cb_t callback,
+        void *arg)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+
+    HID_RETURN_ON_FALSE((HID_INTERFACE_STATE_READY == iface->state) ||
+                        (HID_INTERFACE_STATE_ACTIVE == iface->state),
+                        ESP_ERR_INVALID_STATE,
+                        "Interface is not opened");
+
+    const hid_class_request_t set_report = {
+        .bRequest = HID_CLASS_SPECIFIC_REQ_SET_REPORT,
+        .wValue = (report_type << 8) | report_id,
+        .wIndex = iface->dev_params.iface_num,
+        .wLength = report_length,
+        .data = (uint8_t *)report
+    };
+
+    return hid_class_request_async(iface, &set_report, false, callback, arg);
+}
+
+esp_err_t hid_class_request_get_report_async(hid_host_device_handle_t hid_dev_handle,
+        uint8_t report_type,
+        uint8_t report_id,
+        size_t report_length,
+        hid_host_report_done_cb_t callback,
+        void *arg)
+{
+    hid_iface_t *iface = get_iface_by_handle(hid_dev_handle);
+
+    HID_RETURN_ON_INVALID_ARG(iface);
+    HID_RETURN_ON_INVALID_ARG(callback);
+
+    HID_RETURN_ON_FALSE((HID_INTERFACE_STATE_READY == iface->state) ||
+                        (HID_INTERFACE_STATE_ACTIVE == iface->state),
+                        ESP_ERR_INVALID_STATE,
+                        "Interface is not opened");
+
+    const hid_class_request_t get_report = {
+        .bRequest = HID_CLASS_SPECIFIC_REQ_GET_REPORT,
+        .wValue = (report_type << 8) | report_id,
+        .wIndex = iface->dev_params.iface_num,
+        .wLength = report_length,
+        .data = NULL
+    };
+
+    return hid_class_request_async(iface, &get_report, true, callback, arg);
+}
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_err.h"
+
+#include "usb/hid.h"
+#include "usb/hid_usage_keyboard.h"
+#include "usb/hid_keyboard.h"
+
+#define HID_KEYBOARD_USAGE_PAGE     (0x07)  // Keyboard/Keypad page
+#define HID_KEYBOARD_MODIFIER_FIRST (0xE0)  // Left Control, modifier bits of boot report follow in order
+#define HID_KEYBOARD_ERROR_LAST     (0x03)  // ErrorRollOver, POSTFail and ErrorUndefined are not keys
+
+static inline void keys_set(hid_keyboard_keys_t *keys, uint32_t key)
+{
+    keys->bits[key / 32] |= 1UL << (key % 32);
+}
+
+void hid_keyboard_state_reset(hid_keyboard_state_t *state)
+{
+    memset(state, 0, sizeof(hid_keyboard_state_t));
+}
+
+bool hid_keyboard_state_is_pressed(const hid_keyboard_state_t *state, uint8_t key)
+{
+    return (state->pressed.bits[key / 32] >> (key % 32)) & 1;
+}
+
+size_t hid_keyboard_state_update(hid_keyboard_state_t *state, const hid_keyboard_keys_t *keys,
+                                 hid_keyboard_key_event_t *events, size_t max_events)
+{
+    size_t count = 0;
+
+    for (int w = 0; w < HID_KEYBOARD_KEYS_WORDS; w++) {
+        uint32_t changed = state->pressed.bits[w] ^ keys->bits[w];
+        // Whole words without a change are skipped, only the changed bits are visited
+        while (changed && count < max_events) {
+            const int bit = __builtin_ctz(changed);
+            events[count].key = (uint8_t)(w * 32 + bit);
+            events[count].pressed = (keys->bits[w] >> bit) & 1;
+            count++;
+            changed &= changed - 1;
+        }
+        state->pressed.bits[w] = keys->bits[w];
+    }
+    return count;
+}
+
+esp_err_t hid_keyboard_keys_from_boot_report(const uint8_t *report, size_t length, hid_keyboard_keys_t *keys)
+{
+    if (!report || !keys || length < sizeof(hid_keyboard_input_report_boot_t)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const hid_keyboard_input_report_boot_t *boot = (const hid_keyboard_input_report_boot_t *)report;
+    memset(keys, 0, sizeof(hid_keyboard_keys_t));
+    // Modifiers are the bits 0xE0 to 0xE7, all in the last word
+    keys->bits[HID_KEYBOARD_MODIFIER_FIRST / 32] = (uint32_t)boot->modifier.val << (HID_KEYBOARD_MODIFIER_FIRST % 32);
+
+    for (int i = 0; i < HID_KEYBOARD_KEY_MAX; i++) {
+        const uint8_t key = boot->key[i];
+        if (key == HID_KEY_ROLLOVER) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (key > HID_KEYBOARD_ERROR_LAST) {
+            keys_set(keys, key);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t hid_keyboard_keys_from_report(const hid_report_map_t *map, const uint8_t *report, size_t length,
+                                        hid_keyboard_keys_t *keys)
+{
+    if (!map || !report || !keys) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bool found = false;
+    memset(keys, 0, sizeof(hid_keyboard_keys_t));
+
+    for (size_t i = 0; i < map->field_count; i++) {
+        const hid_report_field_t *field = &map->fields[i];
+        if (field->report_type != HID_REPORT_TYPE_INPUT || field->usage_page != HID_KEYBOARD_USAGE_PAGE ||
+                !hid_report_field_present(field, report, length)) {
+            continue;
+        }
+        found = true;
+
+        const int32_t value = hid_report_field_get_value(field, report);
+        uint32_t key;
+        if (field->flags & HID_FIELD_FLAG_VARIABLE) {
+            // Bitmap of N-key rollover keyboards and modifiers, one bit per key
+            if (!value) {
+                continue;
+            }
+            key = field->usage;
+        } else {
+            // Key array, the value is the index of the usage
+            if (value < field->logical_min || value > field->logical_max) {
+                continue;
+            }
+            key = field->usage + (uint32_t)(value - field->logical_min);
+        }
+
+        if (key == HID_KEY_ROLLOVER) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (key > HID_KEYBOARD_ERROR_LAST && key <= UINT8_MAX) {
+            keys_set(keys, key);
+        }
+    }
+    return found ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
@@ -0,0 +1,389 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "usb/hid.h"
+#include "usb/hid_report_map.h"
+
+static const char *TAG = "hid-report-map";
+
+#define HID_PARSER_MAX_USAGES       (32)    // Usages of one main item, further ones are ignored
+#define HID_PARSER_MAX_REPORTS      (32)    // Different reports (ID and type) of one descriptor
+#define HID_PARSER_STACK_DEPTH      (4)     // Push items
+#define HID_LONG_ITEM_PREFIX        (0xFE)
+
+/**
+ * @brief Item types and tags
+ *
+ * @see 6.2.2 Report Descriptor, p.26 of Device Class Definition for Human Interface Devices (HID) Version 1.11
+ */
+enum {
+    HID_ITEM_TYPE_MAIN = 0,
+    HID_ITEM_TYPE_GLOBAL,
+    HID_ITEM_TYPE_LOCAL,
+};
+
+enum {
+    HID_MAIN_INPUT = 0x8,
+    HID_MAIN_OUTPUT = 0x9,
+    HID_MAIN_COLLECTION = 0xA,
+    HID_MAIN_FEATURE = 0xB,
+    HID_MAIN_END_COLLECTION = 0xC,
+};
+
+enum {
+    HID_GLOBAL_USAGE_PAGE = 0x0,
+    HID_GLOBAL_LOGICAL_MIN = 0x1,
+    HID_GLOBAL_LOGICAL_MAX = 0x2,
+    HID_GLOBAL_REPORT_SIZE = 0x7,
+    HID_GLOBAL_REPORT_ID = 0x8,
+    HID_GLOBAL_REPORT_COUNT = 0x9,
+    HID_GLOBAL_PUSH = 0xA,
+    HID_GLOBAL_POP = 0xB,
+};
+
+enum {
+    HID_LOCAL_USAGE = 0x0,
+    HID_LOCAL_USAGE_MIN = 0x1,
+    HID_LOCAL_USAGE_MAX = 0x2,
+};
+
+typedef struct {
+    uint16_t usage_page;
+    int32_t logical_min;
+    int32_t logical_max;
+    uint32_t logical_max_unsigned;  // Logical maximum without sign extension, for unsigned ranges
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+} hid_parser_global_t;
+
+typedef struct {
+    uint32_t usages[HID_PARSER_MAX_USAGES]; // Usage page in upper 16 bits
+    size_t usage_count;
+    uint32_t usage_min;
+    uint32_t usage_max;
+    bool has_range;
+} hid_parser_local_t;
+
+typedef struct {
+    uint8_t id;
+    uint8_t type;
+    uint32_t bits;
+} hid_parser_report_t;
+
+typedef struct {
+    hid_parser_global_t global;
+    hid_parser_global_t stack[HID_PARSER_STACK_DEPTH];
+    size_t stack_depth;
+    hid_parser_local_t local;
+    hid_parser_report_t reports[HID_PARSER_MAX_REPORTS];
+    size_t report_count;
+    bool has_report_ids;
+    hid_report_field_t *fields;     // NULL when only counting the fields
+    size_t field_count;
+} hid_parser_t;
+
+/**
+ * @brief Bit position of the next field in the report
+ */
+static uint32_t *parser_report_bits(hid_parser_t *parser, uint8_t type)
+{
+    for (size_t i = 0; i < parser->report_count; i++) {
+        if (parser->reports[i].id == parser->global.report_id && parser->reports[i].type == type) {
+            return &parser->reports[i].bits;
+        }
+    }
+    if (parser->report_count == HID_PARSER_MAX_REPORTS) {
+        return NULL;
+    }
+    hid_parser_report_t *report = &parser->reports[parser->report_count++];
+    report->id = parser->global.report_id;
+    report->type = type;
+    // Report ID byte precedes the data
+    report->bits = parser->global.report_id ? 8 : 0;
+    return &report->bits;
+}
+
+/**
+ * @brief Usage of the element of a variable main item
+ */
+static uint32_t parser_variable_usage(const hid_parser_local_t *local, uint32_t index)
+{
+    if (local->usage_count) {
+        // The last usage applies to the remaining elements
+        return local->usages[index < local->usage_count ? index : local->usage_count - 1];
+    }
+    if (local->has_range) {
+        const uint32_t usage = local->usage_min + index;
+        return usage <= local->usage_max ? usage : local->usage_max;
+    }
+    return 0;
+}
+
+static esp_err_t parser_main_item(hid_parser_t *parser, uint8_t type, uint32_t data)
+{
+    const hid_parser_global_t *global = &parser->global;
+    const hid_parser_local_t *local = &parser->local;
+    uint32_t *bits = parser_report_bits(parser, type);
+    ESP_RETURN_ON_FALSE(bits, ESP_ERR_INVALID_STATE, TAG, "Too many reports");
+
+    // Unsigned logical range, e.g. 0 to 255 encoded in one byte
+    const int32_t logical_max = global->logical_min >= 0 && global->logical_max < 0 ?
+                                (int32_t)global->logical_max_unsigned : global->logical_max;
+    const bool mapped = !(data & HID_FIELD_FLAG_CONSTANT) && global->report_size > 0 && global->report_size <= 32;
+
+    for (uint32_t i = 0; i < global->report_count; i++) {
+        if (mapped) {
+            uint32_t usage;
+            uint32_t usage_max;
+            if (data & HID_FIELD_FLAG_VARIABLE) {
+                usage = usage_max = parser_variable_usage(local, i);
+            } else if (local->has_range) {
+                usage = local->usage_min;
+                usage_max = local->usage_max;
+            } else {
+                usage = local->usage_count ? local->usages[0] : 0;
+                usage_max = local->usage_count ? local->usages[local->usage_count - 1] : 0;
+            }
+            if (parser->fields) {
+                hid_report_field_t *field = &parser->fields[parser->field_count];
+                field->bit_offset = *bits;
+                field->bit_size = global->report_size;
+                field->report_id = global->report_id;
+                field->report_type = type;
+                field->flags = data & 0xFF;
+                field->usage_page = usage >> 16;
+                field->usage = usage & 0xFFFF;
+                field->usage_max = usage_max & 0xFFFF;
+                field->logical_min = global->logical_min;
+                field->logical_max = logical_max;
+            }
+            parser->field_count++;
+        }
+        *bits += global->report_size;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Usage with the current usage page, unless the page is in the item
+ */
+static uint32_t parser_usage(const hid_parser_t *parser, uint32_t data, uint8_t size)
+{
+    return size == 4 ? data : ((uint32_t)parser->global.usage_page << 16) | (data & 0xFFFF);
+}
+
+static esp_err_t parser_item(hid_parser_t *parser, uint8_t type, uint8_t tag, uint32_t data, int32_t sdata,
+                             uint8_t size)
+{
+    hid_parser_global_t *global = &parser->global;
+    hid_parser_local_t *local = &parser->local;
+
+    switch (type) {
+    case HID_ITEM_TYPE_MAIN:
+        switch (tag) {
+        case HID_MAIN_INPUT:
+            ESP_RETURN_ON_ERROR(parser_main_item(parser, HID_REPORT_TYPE_INPUT, data), TAG, "Input item");
+            break;
+        case HID_MAIN_OUTPUT:
+            ESP_RETURN_ON_ERROR(parser_main_item(parser, HID_REPORT_TYPE_OUTPUT, data), TAG, "Output item");
+            break;
+        case HID_MAIN_FEATURE:
+            ESP_RETURN_ON_ERROR(parser_main_item(parser, HID_REPORT_TYPE_FEATURE, data), TAG, "Feature item");
+            break;
+        default:
+            // Collections only group the fields
+            break;
+        }
+        // Local items apply to the next main item only
+        memset(local, 0, sizeof(hid_parser_local_t));
+        break;
+    case HID_ITEM_TYPE_GLOBAL:
+        switch (tag) {
+        case HID_GLOBAL_USAGE_PAGE:
+            global->usage_page = data;
+            break;
+        case HID_GLOBAL_LOGICAL_MIN:
+            global->logical_min = sdata;
+            break;
+        case HID_GLOBAL_LOGICAL_MAX:
+            global->logical_max = sdata;
+            global->logical_max_unsigned = data;
+            break;
+        case HID_GLOBAL_REPORT_SIZE:
+            global->report_size = data;
+            break;
+        case HID_GLOBAL_REPORT_ID:
+            ESP_RETURN_ON_FALSE(data > 0 && data <= 0xFF, ESP_ERR_INVALID_STATE, TAG, "Report ID %"PRIu32, data);
+            global->report_id = data;
+            parser->has_report_ids = true;
+            break;
+        case HID_GLOBAL_REPORT_COUNT:
+            global->report_count = data;
+            break;
+        case HID_GLOBAL_PUSH:
+            ESP_RETURN_ON_FALSE(parser->stack_depth < HID_PARSER_STACK_DEPTH, ESP_ERR_INVALID_STATE, TAG,
+                                "Push overflow");
+            parser->stack[parser->stack_depth++] = *global;
+            break;
+        case HID_GLOBAL_POP:
+            ESP_RETURN_ON_FALSE(parser->stack_depth > 0, ESP_ERR_INVALID_STATE, TAG, "Pop underflow");
+            *global = parser->stack[--parser->stack_depth];
+            break;
+        default:
+            // Physical range and units are not needed to extract the values
+            break;
+        }
+        break;
+    case HID_ITEM_TYPE_LOCAL:
+        switch (tag) {
+        case HID_LOCAL_USAGE:
+            if (local->usage_count < HID_PARSER_MAX_USAGES) {
+                local->usages[local->usage_count++] = parser_usage(parser, data, size);
+            }
+            break;
+        case HID_LOCAL_USAGE_MIN:
+            local->usage_min = parser_usage(parser, data, size);
+            local->has_range = true;
+            break;
+        case HID_LOCAL_USAGE_MAX:
+            local->usage_max = parser_usage(parser, data, size);
+            local->has_range = true;
+            break;
+        default:
+            break;
+        }
+        break;
+    default:
+        // Reserved item type
+        break;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Walk the report descriptor, fill the fields if provided
+ */
+static esp_err_t parser_run(hid_parser_t *parser, const uint8_t *desc, size_t len)
+{
+    size_t pos = 0;
+
+    while (pos < len) {
+        const uint8_t prefix = desc[pos++];
+
+        if (prefix == HID_LONG_ITEM_PREFIX) {
+            // Long items are reserved for future use, skip them
+            ESP_RETURN_ON_FALSE(pos < len, ESP_ERR_INVALID_STATE, TAG, "Truncated long item");
+            pos += 2 + desc[pos];
+            ESP_RETURN_ON_FALSE(pos <= len, ESP_ERR_INVALID_STATE, TAG, "Truncated long item");
+            continue;
+        }
+
+        const uint8_t size = (prefix & 0x03) == 3 ? 4 : (prefix & 0x03);
+        ESP_RETURN_ON_FALSE(pos + size <= len, ESP_ERR_INVALID_STATE, TAG, "Truncated item at %d", (int)pos);
+        uint32_t data = 0;
+        for (uint8_t i = 0; i < size; i++) {
+            data |= (uint32_t)desc[pos + i] << (8 * i);
+        }
+        pos += size;
+        int32_t sdata = (int32_t)data;
+        if (size && size < 4 && (data & (1UL << (8 * size - 1)))) {
+            sdata = (int32_t)(data | (UINT32_MAX << (8 * size)));
+        }
+        ESP_RETURN_ON_ERROR(parser_item(parser, (prefix >> 2) & 0x03, prefix >> 4, data, sdata, size),
+                            TAG, "Report descriptor");
+    }
+    return ESP_OK;
+}
+
+esp_err_t hid_report_map_create(const uint8_t *report_desc, size_t report_desc_len, hid_report_map_t **map)
+{
+    ESP_RETURN_ON_FALSE(report_desc && report_desc_len && map, ESP_ERR_INVALID_ARG, TAG, "Argument error");
+
+    hid_parser_t *parser = calloc(1, sizeof(hid_parser_t));
+    ESP_RETURN_ON_FALSE(parser, ESP_ERR_NO_MEM, TAG, "Unable to allocate memory");
+
+    // First pass counts the fields, the second one fills them
+    esp_err_t ret = parser_run(parser, report_desc, report_desc_len);
+    if (ret != ESP_OK) {
+        free(parser);
+        return ret;
+    }
+    const size_t field_count = parser->field_count;
+    hid_report_map_t *new_map = calloc(1, sizeof(hid_report_map_t) + field_count * sizeof(hid_report_field_t));
+    if (!new_map) {
+        free(parser);
+        return ESP_ERR_NO_MEM;
+    }
+    new_map->fields = (hid_report_field_t *)(new_map + 1);
+
+    memset(parser, 0, sizeof(hid_parser_t));
+    parser->fields = new_map->fields;
+    ret = parser_run(parser, report_desc, report_desc_len);
+    assert(ret == ESP_OK && parser->field_count == field_count);
+    new_map->field_count = field_count;
+    new_map->has_report_ids = parser->has_report_ids;
+    free(parser);
+
+    ESP_LOGD(TAG, "%d fields", (int)field_count);
+    *map = new_map;
+    return ESP_OK;
+}
+
+void hid_report_map_delete(hid_report_map_t *map)
+{
+    free(map);
+}
+
+const hid_report_field_t *hid_report_map_find(const hid_report_map_t *map, uint8_t report_type,
+                                              uint16_t usage_page, uint16_t usage)
+{
+    if (!map) {
+        return NULL;
+    }
+    for (size_t i = 0; i < map->field_count; i++) {
+        const hid_report_field_t *field = &map->fields[i];
+        if (field->report_type == report_type && field->usage_page == usage_page &&
+                usage >= field->usage && usage <= field->usage_max) {
+            return field;
+        }
+    }
+    return NULL;
+}
+
+bool hid_report_field_present(const hid_report_field_t *field, const uint8_t *report, size_t length)
+{
+    if (!field || !report || (field->report_id && (length == 0 || report[0] != field->report_id))) {
+        return false;
+    }
+    return field->bit_offset + field->bit_size <= length * 8;
+}
+
+int32_t hid_report_field_get_value(const hid_report_field_t *field, const uint8_t *report)
+{
+    const uint8_t *data = report + field->bit_offset / 8;
+    const uint32_t shift = field->bit_offset % 8;
+    const uint32_t bytes = (shift + field->bit_size + 7) / 8;
+    uint64_t value = 0;
+
+    for (uint32_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)data[i] << (8 * i);
+    }
+    value = (value >> shift) & ((1ULL << field->bit_size) - 1);
+    if (field->logical_min < 0 && (value >> (field->bit_size - 1))) {
+        value |= UINT64_MAX << field->bit_size;
+    }
+    return (int32_t)value;
+}
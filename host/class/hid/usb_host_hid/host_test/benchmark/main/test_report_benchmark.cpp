@@ -0,0 +1,457 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "usb/hid_host.h"
+#include "mock_add_usb_device.h"
+#include "usb_bench.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+#define BENCH_DEV_NUM           4       // HID devices on a hub, one Interface each
+#define BENCH_REPORT_LEN        16      // EP IN max size and report length
+#define BENCH_DURATION_US       1000000 // Simulated time of one benchmark run
+#define BENCH_QUEUE_SIZE        32      // Reports in the report queue
+#define BENCH_QUEUE_READ_US     5000    // Report queue is read by the application every 5 ms
+#define BENCH_LATEST_READ_US    1000    // Latest report is polled by the application every 1 ms
+#define BENCH_BATCH_REPORTS     8
+
+/**
+ * @brief HID device with one Interface, no boot protocol, interrupt EP 0x81 of 16 bytes
+ *
+ * The report descriptor is not requested, when the Interface is opened and started.
+ */
+static const uint8_t bench_device_desc[] = {
+    0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x3A, 0x30, 0x01, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+};
+
+static const uint8_t bench_config_desc[] = {
+    0x09, 0x02, 0x22, 0x00, 0x01, 0x01, 0x00, 0x80, 0x32,                         // Configuration, 34 bytes, 1 interface
+    0x09, 0x04, 0x00, 0x00, 0x01, 0x03, 0x00, 0x00, 0x00,                         // HID interface, no subclass
+    0x09, 0x21, 0x11, 0x01, 0x00, 0x01, 0x22, 0x20, 0x00,                         // HID 1.11, report descriptor of 32 bytes
+    0x07, 0x05, 0x81, 0x03, BENCH_REPORT_LEN, 0x00, 0x01,                         // EP 0x81 interrupt, 16 bytes, 1 ms
+};
+
+/**
+ * @brief Simulated interrupt link
+ *
+ * Every Interface has a report in each period of the polling rate. The report is taken by the oldest submitted
+ * IN transfer of the Interface, or missed if no transfer is queued. Every report carries its sequence number,
+ * which is the period it was sent in, so the latency of the report is known when the application gets it.
+ */
+typedef struct {
+    usb_device_handle_t dev_hdl;
+    std::deque<usb_transfer_t *> in_flight;
+    uint32_t next_seq;              // Sequence number of the next report sent by the device
+    uint32_t expected_seq;          // Next sequence number expected by the application
+} link_dev_t;
+
+typedef struct {
+    uint32_t sent;                  // Reports sent by the devices
+    uint32_t missed;                // Reports not sent, because no IN transfer was queued
+    uint32_t delivered;             // Reports given to the application
+    uint32_t skipped;               // Reports not seen by the application, e.g. superseded by the latest report
+    uint32_t order_errors;          // Reports repeated or out of order
+    uint32_t callbacks;             // Application callbacks
+    uint64_t latency_sum;           // Simulated us of the delivered reports
+    uint32_t latency_max;
+} bench_stats_t;
+
+static link_dev_t link_devs[BENCH_DEV_NUM];
+static int link_dev_cnt;
+static uint32_t link_us;
+static uint32_t link_period_us;
+static bench_stats_t bench_stats;
+static usb_bench::callback_timer bench_timer;
+static std::vector<hid_host_device_handle_t> bench_handles;
+static usb_host_client_event_cb_t bench_client_event_cb;
+static void *bench_client_event_arg;
+
+static link_dev_t *link_dev_by_handle(usb_device_handle_t dev_hdl)
+{
+    for (int i = 0; i < link_dev_cnt; i++) {
+        if (link_devs[i].dev_hdl == dev_hdl) {
+            return &link_devs[i];
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Check order and latency of a report given to the application
+ *
+ * @param[in] data        Report
+ * @param[in] length      Report length
+ */
+static void bench_report_check(const uint8_t *data, size_t length)
+{
+    uint32_t seq;
+    uint32_t dev;
+    REQUIRE(length == BENCH_REPORT_LEN);
+    memcpy(&seq, data, sizeof(seq));
+    memcpy(&dev, data + sizeof(seq), sizeof(dev));
+    REQUIRE(dev < (uint32_t)link_dev_cnt);
+
+    link_dev_t *link_dev = &link_devs[dev];
+    if (seq < link_dev->expected_seq) {
+        bench_stats.order_errors++;
+        return;
+    }
+    bench_stats.skipped += seq - link_dev->expected_seq;
+    link_dev->expected_seq = seq + 1;
+
+    const uint32_t latency = link_us - seq * link_period_us;
+    bench_stats.latency_sum += latency;
+    bench_stats.latency_max = std::max(bench_stats.latency_max, latency);
+    bench_stats.delivered++;
+}
+
+/**
+ * @brief Simulate one period of the polling rate
+ */
+static void link_tick(void)
+{
+    for (int i = 0; i < link_dev_cnt; i++) {
+        link_dev_t *link_dev = &link_devs[i];
+        const uint32_t seq = link_dev->next_seq++;
+        bench_stats.sent++;
+        if (link_dev->in_flight.empty()) {
+            bench_stats.missed++;
+            continue;
+        }
+
+        usb_transfer_t *transfer = link_dev->in_flight.front();
+        link_dev->in_flight.pop_front();
+        const uint32_t dev = i;
+        memset(transfer->data_buffer, 0, BENCH_REPORT_LEN);
+        memcpy(transfer->data_buffer, &seq, sizeof(seq));
+        memcpy(transfer->data_buffer + sizeof(seq), &dev, sizeof(dev));
+        transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+        transfer->actual_num_bytes = BENCH_REPORT_LEN;
+
+        // The transfer is resubmitted from the callback
+        bench_timer.measure([transfer] { transfer->callback(transfer); });
+    }
+    link_us += link_period_us;
+}
+
+static esp_err_t link_submit_cb(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    link_dev_t *link_dev = link_dev_by_handle(transfer->device_handle);
+    REQUIRE(link_dev != nullptr);
+    link_dev->in_flight.push_back(transfer);
+    return ESP_OK;
+}
+
+static esp_err_t link_flush_cb(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls)
+{
+    // Transfers in the link are returned canceled, as by the endpoint flush of the real USB Host stack
+    link_dev_t *link_dev = link_dev_by_handle(dev_hdl);
+    REQUIRE(link_dev != nullptr);
+    std::deque<usb_transfer_t *> canceled;
+    canceled.swap(link_dev->in_flight);
+    for (usb_transfer_t *transfer : canceled) {
+        transfer->status = USB_TRANSFER_STATUS_CANCELED;
+        transfer->callback(transfer);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t link_endpoint_cb(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t bench_device_open_cb(usb_host_client_handle_t client_hdl, uint8_t dev_addr,
+                                      usb_device_handle_t *dev_hdl_ret, int cmock_num_calls)
+{
+    esp_err_t ret = usb_host_device_open_mock_callback(client_hdl, dev_addr, dev_hdl_ret, cmock_num_calls);
+    if (ret == ESP_OK && !link_dev_by_handle(*dev_hdl_ret)) {
+        REQUIRE(link_dev_cnt < BENCH_DEV_NUM);
+        link_devs[link_dev_cnt++].dev_hdl = *dev_hdl_ret;
+    }
+    return ret;
+}
+
+static esp_err_t bench_client_register_cb(const usb_host_client_config_t *client_config,
+                                          usb_host_client_handle_t *client_hdl_ret, int cmock_num_calls)
+{
+    // Connection events are sent by the benchmark
+    bench_client_event_cb = client_config->async.client_event_callback;
+    bench_client_event_arg = client_config->async.callback_arg;
+    *client_hdl_ret = reinterpret_cast<usb_host_client_handle_t>(0xdeadbeef);
+    return ESP_OK;
+}
+
+static esp_err_t bench_client_deregister_cb(usb_host_client_handle_t client_hdl, int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t bench_claim_cb(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber,
+                                uint8_t bAlternateSetting, int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t bench_release_cb(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber,
+                                  int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t bench_device_info_cb(usb_device_handle_t dev_hdl, usb_device_info_t *dev_info, int cmock_num_calls)
+{
+    memset(dev_info, 0, sizeof(usb_device_info_t));
+    dev_info->speed = USB_SPEED_FULL;
+    return ESP_OK;
+}
+
+static void bench_driver_cb(hid_host_device_handle_t hid_device_handle, const hid_host_driver_event_t event, void *arg)
+{
+    if (event == HID_HOST_DRIVER_EVENT_CONNECTED) {
+        bench_handles.push_back(hid_device_handle);
+    }
+}
+
+static void bench_interface_cb(hid_host_device_handle_t hid_device_handle,
+                               const hid_host_interface_event_data_t *event_data,
+                               void *arg)
+{
+    switch (event_data->event) {
+    case HID_HOST_INTERFACE_EVENT_INPUT_REPORT:
+        bench_stats.callbacks++;
+        bench_report_check(event_data->data, event_data->length);
+        break;
+    case HID_HOST_INTERFACE_EVENT_INPUT_REPORT_BATCH:
+        bench_stats.callbacks++;
+        for (size_t i = 0; i < event_data->report_count; i++) {
+            bench_report_check(event_data->reports[i].data, event_data->reports[i].length);
+        }
+        break;
+    case HID_HOST_INTERFACE_EVENT_DISCONNECTED:
+        REQUIRE(ESP_OK == hid_host_device_close(hid_device_handle));
+        break;
+    default:
+        break;
+    }
+}
+
+static void bench_link_reset(uint32_t rate_hz)
+{
+    for (int i = 0; i < link_dev_cnt; i++) {
+        link_devs[i].in_flight.clear();
+        link_devs[i].next_seq = 0;
+        link_devs[i].expected_seq = 0;
+    }
+    link_us = 0;
+    link_period_us = 1000000 / rate_hz;
+    bench_stats = {};
+    bench_timer.reset();
+}
+
+/**
+ * @brief Install HID driver with mocked USB Host stack and connect the devices
+ */
+static void bench_install(void)
+{
+    usb_host_mock_dev_list_init();
+    for (int i = 0; i < BENCH_DEV_NUM; i++) {
+        REQUIRE(ESP_OK == usb_host_mock_add_device(i + 1, (const usb_device_desc_t *)bench_device_desc,
+                (const usb_config_desc_t *)bench_config_desc));
+    }
+    link_dev_cnt = 0;
+    bench_handles.clear();
+
+    usb_host_client_register_Stub(bench_client_register_cb);
+    usb_host_client_deregister_Stub(bench_client_deregister_cb);
+    usb_host_device_open_Stub(bench_device_open_cb);
+    usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+    usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+    usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+    usb_host_transfer_alloc_Stub(usb_host_transfer_alloc_mock_callback);
+    usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+    usb_host_transfer_submit_Stub(link_submit_cb);
+    usb_host_interface_claim_Stub(bench_claim_cb);
+    usb_host_interface_release_Stub(bench_release_cb);
+    usb_host_endpoint_halt_Stub(link_endpoint_cb);
+    usb_host_endpoint_flush_Stub(link_flush_cb);
+    usb_host_endpoint_clear_Stub(link_endpoint_cb);
+    usb_host_device_info_Stub(bench_device_info_cb);
+
+    // No background task, the events are sent by the benchmark
+    const hid_host_driver_config_t driver_config = {
+        .create_background_task = false,
+        .task_priority = 0,
+        .stack_size = 0,
+        .core_id = 0,
+        .callback = bench_driver_cb,
+        .callback_arg = NULL
+    };
+    REQUIRE(ESP_OK == hid_host_install(&driver_config));
+    REQUIRE(bench_client_event_cb != nullptr);
+
+    for (int i = 0; i < BENCH_DEV_NUM; i++) {
+        usb_host_client_event_msg_t msg = {};
+        msg.event = USB_HOST_CLIENT_EVENT_NEW_DEV;
+        msg.new_dev.address = i + 1;
+        bench_client_event_cb(&msg, bench_client_event_arg);
+    }
+    REQUIRE((size_t)BENCH_DEV_NUM == bench_handles.size());
+    REQUIRE(BENCH_DEV_NUM == link_dev_cnt);
+}
+
+/**
+ * @brief Disconnect the devices and uninstall HID driver
+ */
+static void bench_uninstall(void)
+{
+    for (int i = 0; i < link_dev_cnt; i++) {
+        usb_host_client_event_msg_t msg = {};
+        msg.event = USB_HOST_CLIENT_EVENT_DEV_GONE;
+        msg.dev_gone.dev_hdl = link_devs[i].dev_hdl;
+        bench_client_event_cb(&msg, bench_client_event_arg);
+    }
+    REQUIRE(ESP_OK == hid_host_uninstall());
+}
+
+static void bench_open_all(const hid_host_device_config_t *dev_config)
+{
+    for (hid_host_device_handle_t handle : bench_handles) {
+        REQUIRE(ESP_OK == hid_host_device_open(handle, dev_config));
+        REQUIRE(ESP_OK == hid_host_device_start(handle));
+    }
+}
+
+static void bench_report(const char *name, uint32_t rate_hz, uint8_t in_xfer_num, uint32_t dropped)
+{
+    const double latency_avg = bench_stats.delivered ? (double)bench_stats.latency_sum / bench_stats.delivered : 0;
+    usb_bench::report("hid", name)
+    .value("rate_hz", rate_hz)
+    .value("xfers", in_xfer_num)
+    .value("app_callbacks", bench_stats.callbacks)
+    .value("latency_us_avg", latency_avg)
+    .value("latency_us_max", bench_stats.latency_max)
+    .value("missed", bench_stats.missed)
+    .value("dropped", dropped)
+    .value("skipped", bench_stats.skipped)
+    .timer(bench_timer)
+    .print();
+}
+
+TEST_CASE("HID input report benchmark", "[benchmark]")
+{
+    bench_install();
+
+    const uint32_t rate_hz = GENERATE(1000, 8000);
+    const uint8_t in_xfer_num = GENERATE(1, 2, 4);
+    hid_host_device_config_t dev_config = {};
+    dev_config.event_data_callback = bench_interface_cb;
+    dev_config.in_xfer_num = in_xfer_num;
+    bench_link_reset(rate_hz);
+    const uint32_t ticks = BENCH_DURATION_US / link_period_us;
+
+    SECTION("Each report") {
+        bench_open_all(&dev_config);
+        for (uint32_t t = 0; t < ticks; t++) {
+            link_tick();
+        }
+        REQUIRE(bench_stats.order_errors == 0);
+        REQUIRE(bench_stats.missed == 0);
+        REQUIRE(bench_stats.delivered == bench_stats.sent);
+        bench_report("each", rate_hz, in_xfer_num, 0);
+    }
+
+    SECTION("Report queue") {
+        dev_config.report_queue_size = BENCH_QUEUE_SIZE;
+        bench_open_all(&dev_config);
+        const uint32_t read_ticks = std::max<uint32_t>(1, BENCH_QUEUE_READ_US / link_period_us);
+        uint8_t report[BENCH_REPORT_LEN];
+        size_t report_len;
+        for (uint32_t t = 0; t < ticks; t++) {
+            link_tick();
+            if ((t + 1) % read_ticks) {
+                continue;
+            }
+            // the application reads all queued reports
+            for (hid_host_device_handle_t handle : bench_handles) {
+                while (ESP_OK == hid_host_device_read_input_report(handle, report, sizeof(report), &report_len, 0)) {
+                    bench_report_check(report, report_len);
+                }
+            }
+        }
+
+        uint32_t dropped = 0;
+        uint32_t timed = 0;
+        for (hid_host_device_handle_t handle : bench_handles) {
+            hid_host_report_stats_t stats;
+            REQUIRE(ESP_OK == hid_host_device_get_report_stats(handle, &stats));
+            dropped += stats.dropped;
+            // every read report has its delivery latency in the histogram
+            hid_host_latency_stats_t latency;
+            REQUIRE(ESP_OK == hid_host_device_get_latency_stats(handle, &latency));
+            REQUIRE(latency.ep_interval_us == 1000);
+            for (int i = 0; i < HID_HOST_LATENCY_BUCKETS; i++) {
+                timed += latency.delivery_hist[i];
+            }
+        }
+        REQUIRE(timed == bench_stats.delivered);
+        REQUIRE(bench_stats.order_errors == 0);
+        REQUIRE(bench_stats.delivered + dropped == bench_stats.sent - bench_stats.missed);
+        bench_report("queue", rate_hz, in_xfer_num, dropped);
+    }
+
+    SECTION("Latest report") {
+        dev_config.report_delivery = HID_HOST_REPORT_DELIVERY_LATEST;
+        bench_open_all(&dev_config);
+        const uint32_t read_ticks = std::max<uint32_t>(1, BENCH_LATEST_READ_US / link_period_us);
+        uint8_t report[BENCH_REPORT_LEN];
+        size_t report_len;
+        uint32_t last_seq[BENCH_DEV_NUM] = {};
+        for (uint32_t t = 0; t < ticks; t++) {
+            link_tick();
+            if ((t + 1) % read_ticks) {
+                continue;
+            }
+            // the application polls the state of every Interface
+            for (size_t i = 0; i < bench_handles.size(); i++) {
+                uint32_t seq;
+                if (ESP_OK == hid_host_device_get_latest_input_report(bench_handles[i], report, sizeof(report),
+                        &report_len, &seq) && seq != last_seq[i]) {
+                    last_seq[i] = seq;
+                    bench_report_check(report, report_len);
+                }
+            }
+        }
+        REQUIRE(bench_stats.order_errors == 0);
+        REQUIRE(bench_stats.callbacks == 0);
+        bench_report("latest", rate_hz, in_xfer_num, 0);
+    }
+
+    SECTION("Report batch") {
+        dev_config.report_delivery = HID_HOST_REPORT_DELIVERY_BATCH;
+        dev_config.batch_reports = BENCH_BATCH_REPORTS;
+        bench_open_all(&dev_config);
+        for (uint32_t t = 0; t < ticks; t++) {
+            link_tick();
+        }
+        REQUIRE(bench_stats.order_errors == 0);
+        REQUIRE(bench_stats.skipped == 0);
+        REQUIRE(bench_stats.callbacks == bench_stats.delivered / BENCH_BATCH_REPORTS);
+        bench_report("batch", rate_hz, in_xfer_num, 0);
+    }
+
+    bench_uninstall();
+}
@@ -0,0 +1,101 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/hid.h"
+#include "usb/hid_usage_keyboard.h"
+#include "usb/hid_keyboard.h"
+
+// N-key rollover keyboard with report ID 1: modifiers and 104 keys bitmap, report ID 2 is consumer control
+static const uint8_t nkro_report_desc[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01, 0x85, 0x01,
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+    0x19, 0x00, 0x29, 0x67, 0x95, 0x68, 0x81, 0x02,
+    0xC0,
+    0x05, 0x0C, 0x09, 0x01, 0xA1, 0x01, 0x85, 0x02,
+    0x15, 0x00, 0x26, 0xFF, 0x03, 0x19, 0x00, 0x2A, 0xFF, 0x03, 0x75, 0x10, 0x95, 0x01, 0x81, 0x00,
+    0xC0,
+};
+
+SCENARIO("HID keyboard state")
+{
+    hid_keyboard_state_t state;
+    hid_keyboard_keys_t keys;
+    hid_keyboard_key_event_t events[8];
+
+    hid_keyboard_state_reset(&state);
+
+    GIVEN("Boot protocol reports") {
+        const uint8_t report_a_b[] = { HID_LEFT_SHIFT, 0x00, HID_KEY_A, HID_KEY_B, 0, 0, 0, 0 };
+        const uint8_t report_b_c[] = { 0x00, 0x00, HID_KEY_C, HID_KEY_B, 0, 0, 0, 0 };
+        const uint8_t report_rollover[] = { 0x00, 0x00, HID_KEY_ROLLOVER, HID_KEY_ROLLOVER, 0, 0, 0, 0 };
+
+        REQUIRE(ESP_OK == hid_keyboard_keys_from_boot_report(report_a_b, sizeof(report_a_b), &keys));
+        REQUIRE(3 == hid_keyboard_state_update(&state, &keys, events, 8));
+        REQUIRE(HID_KEY_A == events[0].key);
+        REQUIRE(events[0].pressed);
+        REQUIRE(HID_KEY_B == events[1].key);
+        REQUIRE(0xE1 == events[2].key);
+        REQUIRE(hid_keyboard_state_is_pressed(&state, 0xE1));
+
+        SECTION("Press and release events are derived from the change") {
+            REQUIRE(ESP_OK == hid_keyboard_keys_from_boot_report(report_b_c, sizeof(report_b_c), &keys));
+            REQUIRE(3 == hid_keyboard_state_update(&state, &keys, events, 8));
+            REQUIRE(HID_KEY_A == events[0].key);
+            REQUIRE_FALSE(events[0].pressed);
+            REQUIRE(HID_KEY_C == events[1].key);
+            REQUIRE(events[1].pressed);
+            REQUIRE(0xE1 == events[2].key);
+            REQUIRE_FALSE(events[2].pressed);
+            REQUIRE(hid_keyboard_state_is_pressed(&state, HID_KEY_B));
+        }
+
+        SECTION("Same report gives no events") {
+            REQUIRE(ESP_OK == hid_keyboard_keys_from_boot_report(report_a_b, sizeof(report_a_b), &keys));
+            REQUIRE(0 == hid_keyboard_state_update(&state, &keys, events, 8));
+        }
+
+        SECTION("Phantom state is reported") {
+            REQUIRE(ESP_ERR_INVALID_STATE ==
+                    hid_keyboard_keys_from_boot_report(report_rollover, sizeof(report_rollover), &keys));
+            REQUIRE(ESP_ERR_INVALID_ARG == hid_keyboard_keys_from_boot_report(report_a_b, 4, &keys));
+        }
+    }
+
+    GIVEN("N-key rollover keyboard") {
+        hid_report_map_t *map = nullptr;
+        REQUIRE(ESP_OK == hid_report_map_create(nkro_report_desc, sizeof(nkro_report_desc), &map));
+
+        // Left Control, A (0x04) and Keypad 1 (0x59)
+        uint8_t report[15] = { 0x01, 0x01 };
+        report[2 + HID_KEY_A / 8] |= 1 << (HID_KEY_A % 8);
+        report[2 + 0x59 / 8] |= 1 << (0x59 % 8);
+
+        SECTION("Keys of the bitmap are pressed") {
+            REQUIRE(ESP_OK == hid_keyboard_keys_from_report(map, report, sizeof(report), &keys));
+            REQUIRE(3 == hid_keyboard_state_update(&state, &keys, events, 8));
+            REQUIRE(HID_KEY_A == events[0].key);
+            REQUIRE(0x59 == events[1].key);
+            REQUIRE(0xE0 == events[2].key);
+        }
+
+        SECTION("Report of other ID contains no keys") {
+            const uint8_t consumer_report[] = { 0x02, 0xE9, 0x00 };
+            REQUIRE(ESP_ERR_NOT_FOUND ==
+                    hid_keyboard_keys_from_report(map, consumer_report, sizeof(consumer_report), &keys));
+        }
+
+        SECTION("Events beyond the limit are not reported, the state is updated") {
+            REQUIRE(ESP_OK == hid_keyboard_keys_from_report(map, report, sizeof(report), &keys));
+            REQUIRE(1 == hid_keyboard_state_update(&state, &keys, events, 1));
+            REQUIRE(hid_keyboard_state_is_pressed(&state, 0xE0));
+        }
+
+        hid_report_map_delete(map);
+    }
+}
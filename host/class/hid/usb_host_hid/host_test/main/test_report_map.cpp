@@ -0,0 +1,113 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/hid.h"
+#include "usb/hid_report_map.h"
+
+// Mouse with report ID 2: 5 buttons, 3 bits padding, 16-bit X and Y, 8-bit wheel
+static const uint8_t mouse_report_desc[] = {
+    0x05, 0x01, 0x09, 0x02, 0xA1, 0x01, 0x85, 0x02, 0x09, 0x01, 0xA1, 0x00,
+    0x05, 0x09, 0x19, 0x01, 0x29, 0x05, 0x15, 0x00, 0x25, 0x01, 0x95, 0x05, 0x75, 0x01, 0x81, 0x02,
+    0x95, 0x01, 0x75, 0x03, 0x81, 0x03,
+    0x05, 0x01, 0x16, 0x01, 0x80, 0x26, 0xFF, 0x7F, 0x75, 0x10, 0x95, 0x02, 0x09, 0x30, 0x09, 0x31, 0x81, 0x06,
+    0x15, 0x81, 0x25, 0x7F, 0x75, 0x08, 0x95, 0x01, 0x09, 0x38, 0x81, 0x06,
+    0xC0, 0xC0,
+};
+
+// Boot keyboard without report IDs: modifiers, reserved byte, 6 key array, 5 LEDs output
+static const uint8_t keyboard_report_desc[] = {
+    0x05, 0x01, 0x09, 0x06, 0xA1, 0x01,
+    0x05, 0x07, 0x19, 0xE0, 0x29, 0xE7, 0x15, 0x00, 0x25, 0x01, 0x75, 0x01, 0x95, 0x08, 0x81, 0x02,
+    0x95, 0x01, 0x75, 0x08, 0x81, 0x01,
+    0x95, 0x05, 0x75, 0x01, 0x05, 0x08, 0x19, 0x01, 0x29, 0x05, 0x91, 0x02,
+    0x95, 0x01, 0x75, 0x03, 0x91, 0x01,
+    0x95, 0x06, 0x75, 0x08, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x05, 0x07, 0x19, 0x00, 0x2A, 0xFF, 0x00, 0x81, 0x00,
+    0xC0,
+};
+
+SCENARIO("HID report map")
+{
+    hid_report_map_t *map = nullptr;
+
+    GIVEN("Mouse report descriptor with report ID") {
+        REQUIRE(ESP_OK == hid_report_map_create(mouse_report_desc, sizeof(mouse_report_desc), &map));
+        REQUIRE(map->has_report_ids);
+        // 5 buttons, X, Y and wheel, padding is left out
+        REQUIRE(8 == map->field_count);
+
+        const hid_report_field_t *x = hid_report_map_find(map, HID_REPORT_TYPE_INPUT, 0x01, 0x30);
+        const hid_report_field_t *wheel = hid_report_map_find(map, HID_REPORT_TYPE_INPUT, 0x01, 0x38);
+        const hid_report_field_t *button3 = hid_report_map_find(map, HID_REPORT_TYPE_INPUT, 0x09, 3);
+        REQUIRE(x != nullptr);
+        REQUIRE(wheel != nullptr);
+        REQUIRE(button3 != nullptr);
+
+        SECTION("Fields follow the report ID byte") {
+            REQUIRE(16 == x->bit_offset);
+            REQUIRE(16 == x->bit_size);
+            REQUIRE(2 == x->report_id);
+            REQUIRE(-32767 == x->logical_min);
+            REQUIRE(32767 == x->logical_max);
+            REQUIRE(10 == button3->bit_offset);
+        }
+
+        SECTION("Values are extracted and sign extended") {
+            const uint8_t report[] = { 0x02, 0x04, 0xFE, 0xFF, 0x10, 0x00, 0xFF };
+            REQUIRE(hid_report_field_present(x, report, sizeof(report)));
+            REQUIRE(-2 == hid_report_field_get_value(x, report));
+            REQUIRE(-1 == hid_report_field_get_value(wheel, report));
+            REQUIRE(1 == hid_report_field_get_value(button3, report));
+        }
+
+        SECTION("Report of other ID or too short does not contain the field") {
+            const uint8_t other_report[] = { 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+            const uint8_t short_report[] = { 0x02, 0x00, 0x00 };
+            REQUIRE_FALSE(hid_report_field_present(x, other_report, sizeof(other_report)));
+            REQUIRE_FALSE(hid_report_field_present(x, short_report, sizeof(short_report)));
+        }
+
+        hid_report_map_delete(map);
+    }
+
+    GIVEN("Keyboard report descriptor without report ID") {
+        REQUIRE(ESP_OK == hid_report_map_create(keyboard_report_desc, sizeof(keyboard_report_desc), &map));
+        REQUIRE_FALSE(map->has_report_ids);
+
+        SECTION("Key array has unsigned range and follows the reserved byte") {
+            const hid_report_field_t *key = hid_report_map_find(map, HID_REPORT_TYPE_INPUT, 0x07, 0x04);
+            REQUIRE(key != nullptr);
+            REQUIRE(16 == key->bit_offset);
+            REQUIRE(255 == key->logical_max);
+            REQUIRE_FALSE(key->flags & HID_FIELD_FLAG_VARIABLE);
+
+            const uint8_t report[] = { 0x02, 0x00, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00 };
+            REQUIRE(0x04 == hid_report_field_get_value(key, report));
+        }
+
+        SECTION("LEDs are in the output report") {
+            const hid_report_field_t *caps_lock = hid_report_map_find(map, HID_REPORT_TYPE_OUTPUT, 0x08, 0x02);
+            REQUIRE(caps_lock != nullptr);
+            REQUIRE(1 == caps_lock->bit_offset);
+        }
+
+        hid_report_map_delete(map);
+    }
+
+    GIVEN("Malformed report descriptor") {
+        SECTION("Truncated item") {
+            const uint8_t truncated[] = { 0x05, 0x01, 0x26, 0xFF };
+            REQUIRE(ESP_ERR_INVALID_STATE == hid_report_map_create(truncated, sizeof(truncated), &map));
+        }
+
+        SECTION("Pop without push") {
+            const uint8_t pop[] = { 0x05, 0x01, 0xB4 };
+            REQUIRE(ESP_ERR_INVALID_STATE == hid_report_map_create(pop, sizeof(pop), &map));
+        }
+    }
+}
@@ -12,6 +12,7 @@
 #include <freertos/FreeRTOS.h>
 
 #include "hid.h"
+#include "hid_report_map.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -46,8 +47,20 @@ typedef enum {
     HID_HOST_INTERFACE_EVENT_INPUT_REPORT = 0x00,     /**< HID Device input report */
     HID_HOST_INTERFACE_EVENT_TRANSFER_ERROR,          /**< HID Device transfer error */
     HID_HOST_INTERFACE_EVENT_DISCONNECTED,            /**< HID Device has been disconnected */
+    HID_HOST_INTERFACE_EVENT_INPUT_REPORT_BATCH,      /**< HID Device input reports, batched */
 } hid_host_interface_event_t;
 
+/**
+ * @brief USB HID HOST Interface input report delivery
+*/
+typedef enum {
+    HID_HOST_REPORT_DELIVERY_EACH = 0x00,             /**< Each report is reported by HID_HOST_INTERFACE_EVENT_INPUT_REPORT */
+    HID_HOST_REPORT_DELIVERY_LATEST,                  /**< Only the latest report is kept, read by
+                                                           hid_host_device_get_latest_input_report(), no events */
+    HID_HOST_REPORT_DELIVERY_BATCH,                   /**< Reports are collected and reported by
+                                                           HID_HOST_INTERFACE_EVENT_INPUT_REPORT_BATCH */
+} hid_host_report_delivery_t;
+
 /**
  * @brief HID device descriptor common data.
 */
@@ -93,6 +106,62 @@ typedef void (*hid_host_interface_event_cb_t)(hid_host_device_handle_t hid_devic
         const hid_host_interface_event_t event,
         void *arg);
 
+/**
+ * @brief Input report of a batch
+*/
+typedef struct {
+    const uint8_t *data;                /**< Input report */
+    size_t length;                      /**< Length of the input report */
+    int64_t timestamp_us;               /**< esp_timer time of the completion of the IN transfer of the report */
+} hid_host_input_report_t;
+
+/**
+ * @brief USB HID Interface event data
+*/
+typedef struct {
+    hid_host_interface_event_t event;   /**< HID Interface event */
+    const uint8_t *data;                /**< Input report of HID_HOST_INTERFACE_EVENT_INPUT_REPORT, NULL otherwise.
+                                             The buffer is valid until the callback returns */
+    size_t length;                      /**< Length of the input report */
+    const hid_host_input_report_t *reports; /**< Input reports of HID_HOST_INTERFACE_EVENT_INPUT_REPORT_BATCH,
+                                                 in the order of reception, valid until the callback returns */
+    size_t report_count;                /**< Number of reports in the batch */
+    int64_t timestamp_us;               /**< esp_timer time of the completion of the IN transfer of
+                                             HID_HOST_INTERFACE_EVENT_INPUT_REPORT, 0 for other events */
+} hid_host_interface_event_data_t;
+
+/**
+ * @brief USB HID Interface event callback with event data.
+ *
+ * The input report is passed in the event, there is no need to call hid_host_device_get_raw_input_report_data().
+ *
+ * @param[in] hid_device_handle     HID device handle (HID Interface)
+ * @param[in] event_data            HID Interface event and its data
+ * @param[in] arg                   User argument
+*/
+typedef void (*hid_host_interface_event_data_cb_t)(hid_host_device_handle_t hid_device_handle,
+        const hid_host_interface_event_data_t *event_data,
+        void *arg);
+
+/**
+ * @brief Completion callback of asynchronous report requests
+ *
+ * Invoked from the USB event handling, see hid_host_handle_events().
+ *
+ * @param[in] hid_device_handle     HID device handle (HID Interface)
+ * @param[in] status                ESP_OK on success, ESP_ERR_TIMEOUT, ESP_ERR_INVALID_STATE if the device is gone
+ *                                  or the request was cancelled, ESP_FAIL on other errors, e.g. STALL
+ * @param[in] data                  Report of hid_class_request_get_report_async(), NULL otherwise.
+ *                                  The buffer is valid until the callback returns
+ * @param[in] length                Length of the report
+ * @param[in] arg                   User argument
+*/
+typedef void (*hid_host_report_done_cb_t)(hid_host_device_handle_t hid_device_handle,
+        esp_err_t status,
+        const uint8_t *data,
+        size_t length,
+        void *arg);
+
 // ----------------------------- Public ---------------------------------------
 /**
  * @brief HID configuration structure.
@@ -113,8 +182,58 @@ typedef struct {
 typedef struct {
     hid_host_interface_event_cb_t callback;     /**< Callback invoked when HID Interface event occurs */
     void *callback_arg;                         /**< User provided argument passed to callback */
+    hid_host_interface_event_data_cb_t event_data_callback; /**< Optional callback with the input report in the
+                                                                 event, invoked instead of callback if set */
+    uint8_t in_xfer_num;                        /**< IN transfers queued at once, up to 8. 0 for default 2.
+                                                     More transfers sustain high polling rates, e.g. 1000 Hz and more */
+    size_t report_queue_size;                   /**< Number of input reports in the report queue. When set,
+                                                     HID_HOST_INTERFACE_EVENT_INPUT_REPORT is not reported, the reports
+                                                     are read by hid_host_device_read_input_report(). 0 to disable */
+    hid_host_report_delivery_t report_delivery; /**< Input report delivery, HID_HOST_REPORT_DELIVERY_EACH by default.
+                                                     Batches require event_data_callback */
+    uint8_t batch_reports;                      /**< Reports in a batch, the batch is reported when full. 0 for 8 */
+    uint32_t batch_time_ms;                     /**< Max time from the first report of a batch to its callback.
+                                                     Such callbacks run in esp_timer task. 0 to wait for full batches */
+    uint32_t idle_poll_timeout_ms;              /**< Adaptive polling: after this time without input reports, the IN
+                                                     endpoint is polled only in short windows with growing gaps, and again
+                                                     at bInterval from the next report. 0 to poll at bInterval all the time */
+    uint32_t idle_poll_max_gap_ms;              /**< Longest gap between the poll windows of an idle Interface, i.e. the
+                                                     latency added to the first report after idle time. 0 for 250 ms */
 } hid_host_device_config_t;
 
+/**
+ * @brief Input report statistics of HID Interface
+*/
+typedef struct {
+    uint32_t received;                          /**< Input reports received since hid_host_device_open() */
+    uint32_t dropped;                           /**< Input reports dropped, because the report queue was full */
+} hid_host_report_stats_t;
+
+#define HID_HOST_LATENCY_BUCKETS (8)            /**< Buckets of the delivery latency histogram */
+
+/**
+ * @brief Input report timing of HID Interface
+ *
+ * Delivery latency is the time from the completion of the IN transfer of a report to its delivery:
+ * the event callback, hid_host_device_read_input_report(), the first hid_host_device_get_latest_input_report()
+ * of the report, or the callback of its batch.
+*/
+typedef struct {
+    uint32_t delivery_hist[HID_HOST_LATENCY_BUCKETS]; /**< Reports by delivery latency. Bucket i counts latencies
+                                                           below 125 << i microseconds, the last one all longer ones */
+    uint32_t delivery_max_us;                   /**< Longest delivery latency */
+    uint32_t ep_interval_us;                    /**< Polling interval of the IN endpoint, by bInterval and device speed */
+    uint32_t interval_min_us;                   /**< Shortest time between two completed IN transfers, 0 if none yet */
+    uint32_t interval_avg_us;                   /**< Average time between two completed IN transfers, 0 if none yet */
+    uint32_t interval_max_us;                   /**< Longest time between two completed IN transfers. Devices NAK polls
+                                                     without a new report, so it grows while nothing changes */
+    uint32_t poll_stops;                        /**< Times the idle IN endpoint was stopped, adaptive polling only */
+    uint32_t poll_windows;                      /**< Poll windows of the stopped IN endpoint */
+    uint32_t poll_wakeups;                      /**< Reports received in a poll window, which resumed polling at bInterval */
+    uint32_t poll_gap_max_us;                   /**< Longest time without polling before such a report, the upper bound
+                                                     of the latency added by adaptive polling */
+} hid_host_latency_stats_t;
+
 /**
  * @brief USB HID Host install USB Host HID Class driver
  *
@@ -175,6 +294,10 @@ esp_err_t hid_host_device_get_params(hid_host_device_handle_t hid_dev_handle,
  * This functions should be called after HID Interface device event HID_HOST_INTERFACE_EVENT_INPUT_REPORT
  * to get the actual raw data of input report.
  *
+ * @note The data are copied from the last completed transfer, which is queued again after the callback returns.
+ *       Call this function from the callback, or use event_data_callback of hid_host_device_config_t,
+ *       which passes the report without copying.
+ *
  * @param[in] hid_dev_handle    HID Device handle
  * @param[in] data              Pointer to buffer where the input data will be copied
  * @param[in] data_length_max   Max length of data can be copied to data buffer
@@ -187,6 +310,125 @@ esp_err_t hid_host_device_get_raw_input_report_data(hid_host_device_handle_t hid
         size_t data_length_max,
         size_t *data_length);
 
+/**
+ * @brief HID Host read input report from the report queue
+ *
+ * Available if report_queue_size of hid_host_device_config_t is set. Reports are queued by the driver
+ * and IN transfers are queued again at once, so that no report is lost while the reader is busy.
+ * Only one task can read the reports of the Interface, it must stop reading before hid_host_device_close().
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] data             Pointer to buffer where the report will be copied
+ * @param[in] data_length_max   Max length of data can be copied to data buffer
+ * @param[out] data_length      Length of the copied report
+ * @param[in] timeout           Timeout in ticks
+ *
+ * @return
+ *     - ESP_OK:                The report was read
+ *     - ESP_ERR_TIMEOUT:       No report received in the timeout
+ *     - ESP_ERR_INVALID_STATE: Interface not found or the report queue is not enabled
+ */
+esp_err_t hid_host_device_read_input_report(hid_host_device_handle_t hid_dev_handle,
+        uint8_t *data,
+        size_t data_length_max,
+        size_t *data_length,
+        TickType_t timeout);
+
+/**
+ * @brief HID Host get the latest input report
+ *
+ * Available if report_delivery of hid_host_device_config_t is HID_HOST_REPORT_DELIVERY_LATEST.
+ * Each report overwrites the previous one, the application polls the state at its own rate.
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] data             Pointer to buffer where the report will be copied
+ * @param[in] data_length_max   Max length of data can be copied to data buffer
+ * @param[out] data_length      Length of the copied report
+ * @param[out] sequence         Optional, number of the report since hid_host_device_open(), changes with a new report
+ *
+ * @return
+ *     - ESP_OK:                The report was copied
+ *     - ESP_ERR_NOT_FOUND:     No report received yet
+ *     - ESP_ERR_INVALID_STATE: Interface not found or report delivery is not HID_HOST_REPORT_DELIVERY_LATEST
+ */
+esp_err_t hid_host_device_get_latest_input_report(hid_host_device_handle_t hid_dev_handle,
+        uint8_t *data,
+        size_t data_length_max,
+        size_t *data_length,
+        uint32_t *sequence);
+
+/**
+ * @brief HID Host get input report statistics
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] stats            Received and dropped reports
+ *
+ * @return esp_err_t
+ */
+esp_err_t hid_host_device_get_report_stats(hid_host_device_handle_t hid_dev_handle,
+        hid_host_report_stats_t *stats);
+
+/**
+ * @brief HID Host get completion time of the report last read by the application
+ *
+ * The esp_timer time of the completion of the IN transfer, of the report of the last
+ * hid_host_device_read_input_report() or hid_host_device_get_latest_input_report().
+ * Reports of events carry their time in hid_host_interface_event_data_t.
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] timestamp_us     Completion time in microseconds
+ *
+ * @return
+ *     - ESP_OK:                Success
+ *     - ESP_ERR_NOT_FOUND:     No report read yet
+ *     - ESP_ERR_INVALID_STATE: Interface not found
+ */
+esp_err_t hid_host_device_get_report_time(hid_host_device_handle_t hid_dev_handle,
+        int64_t *timestamp_us);
+
+/**
+ * @brief HID Host get input report timing
+ *
+ * Statistics are reset by hid_host_device_open().
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[out] stats            Delivery latency histogram and polling intervals
+ *
+ * @return esp_err_t
+ */
+esp_err_t hid_host_device_get_latency_stats(hid_host_device_handle_t hid_dev_handle,
+        hid_host_latency_stats_t *stats);
+
+/**
+ * @brief HID Host send output report asynchronously
+ *
+ * The report is sent by the interrupt OUT endpoint if the Interface has one, otherwise by SET_REPORT request.
+ * Up to 4 asynchronous requests of an Interface are in flight at once. The report is copied, the buffer
+ * may be reused when the function returns.
+ *
+ * @note Interrupt OUT endpoint gets the report as it is. With report IDs, the report must start with the ID byte.
+ * @note Control requests can't be cancelled, hid_host_device_close() returns ESP_ERR_NOT_FINISHED until they complete.
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[in] report_id         Report ID, wValue of SET_REPORT request
+ * @param[in] report            Pointer to the report
+ * @param[in] report_length     Report length, up to EP OUT max size or 64 bytes for SET_REPORT
+ * @param[in] callback          Optional completion callback
+ * @param[in] arg               User argument of the callback
+ *
+ * @return
+ *     - ESP_OK:                The report was submitted
+ *     - ESP_ERR_INVALID_STATE: Interface is not opened
+ *     - ESP_ERR_INVALID_SIZE:  Report is too long
+ *     - ESP_ERR_NO_MEM:        All asynchronous transfers of the Interface are in flight, try again later
+ */
+esp_err_t hid_host_device_send_output_report_async(hid_host_device_handle_t hid_dev_handle,
+        uint8_t report_id,
+        const uint8_t *report,
+        size_t report_length,
+        hid_host_report_done_cb_t callback,
+        void *arg);
+
 // ------------------------ USB HID Host driver API ----------------------------
 
 /**
@@ -220,6 +462,21 @@ uint8_t *hid_host_get_report_descriptor(hid_host_device_handle_t hid_dev_handle,
                                         size_t *report_desc_len);
 
 
+/**
+ * @brief HID Host Get Report Map
+ *
+ * Report Descriptor is requested, if not yet, and compiled into a flat table of fields once per Interface.
+ * Values of the fields are then extracted from input reports by hid_report_field_get_value().
+ * The map is valid until hid_host_device_close().
+ *
+ * @param[in] hid_dev_handle   HID Device handle
+ * @param[out] report_map      Pointer to the compiled report map
+ *
+ * @return esp_err_t
+ */
+esp_err_t hid_host_get_report_map(hid_host_device_handle_t hid_dev_handle,
+                                  const hid_report_map_t **report_map);
+
 /**
  * @brief HID Host Get device information
  *
@@ -245,6 +502,27 @@ esp_err_t hid_class_request_get_report(hid_host_device_handle_t hid_dev_handle,
                                        uint8_t *report,
                                        size_t *report_length);
 
+/**
+ * @brief HID class specific request GET REPORT, asynchronous
+ *
+ * Shares asynchronous transfers with hid_host_device_send_output_report_async().
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[in] report_type       Report type
+ * @param[in] report_id         Report ID
+ * @param[in] report_length     Report length, up to 64 bytes
+ * @param[in] callback          Completion callback, gets the report
+ * @param[in] arg               User argument of the callback
+ *
+ * @return esp_err_t
+ */
+esp_err_t hid_class_request_get_report_async(hid_host_device_handle_t hid_dev_handle,
+        uint8_t report_type,
+        uint8_t report_id,
+        size_t report_length,
+        hid_host_report_done_cb_t callback,
+        void *arg);
+
 /**
  * @brief HID class specific request GET IDLE
  *
@@ -286,6 +564,29 @@ esp_err_t hid_class_request_set_report(hid_host_device_handle_t hid_dev_handle,
                                        uint8_t *report,
                                        size_t report_length);
 
+/**
+ * @brief HID class specific request SET REPORT, asynchronous
+ *
+ * Shares asynchronous transfers with hid_host_device_send_output_report_async(). The report is copied.
+ *
+ * @param[in] hid_dev_handle    HID Device handle
+ * @param[in] report_type       Report type
+ * @param[in] report_id         Report ID
+ * @param[in] report            Pointer to a buffer with report data
+ * @param[in] report_length     Report data length, up to 64 bytes
+ * @param[in] callback          Optional completion callback
+ * @param[in] arg               User argument of the callback
+ *
+ * @return esp_err_t
+ */
+esp_err_t hid_class_request_set_report_async(hid_host_device_handle_t hid_dev_handle,
+        uint8_t report_type,
+        uint8_t report_id,
+        const uint8_t *report,
+        size_t report_length,
+        hid_host_report_done_cb_t callback,
+        void *arg);
+
 /**
  * @brief HID class specific request SET IDLE
  *
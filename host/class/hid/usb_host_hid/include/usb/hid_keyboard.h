@@ -0,0 +1,110 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "hid_report_map.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define HID_KEYBOARD_KEYS_WORDS     (8)     /**< 256 key usages of Keyboard/Keypad page, 32 per word */
+
+/**
+ * @brief Pressed keys, one bit per key usage of the Keyboard/Keypad page
+ *
+ * Modifiers are key usages 0xE0 (Left Control) to 0xE7 (Right GUI).
+ */
+typedef struct {
+    uint32_t bits[HID_KEYBOARD_KEYS_WORDS];
+} hid_keyboard_keys_t;
+
+/**
+ * @brief Key press or release
+ */
+typedef struct {
+    uint8_t key;                /**< Key usage, hid_key_t */
+    bool pressed;               /**< true if pressed, false if released */
+} hid_keyboard_key_event_t;
+
+/**
+ * @brief Keyboard state, pressed keys of the last report
+ */
+typedef struct {
+    hid_keyboard_keys_t pressed;
+} hid_keyboard_state_t;
+
+/**
+ * @brief Reset keyboard state, no key is pressed
+ *
+ * @param[in] state Keyboard state
+ */
+void hid_keyboard_state_reset(hid_keyboard_state_t *state);
+
+/**
+ * @brief Check that the key is pressed
+ *
+ * @param[in] state Keyboard state
+ * @param[in] key   Key usage, hid_key_t
+ * @return true, if the key is pressed
+ */
+bool hid_keyboard_state_is_pressed(const hid_keyboard_state_t *state, uint8_t key);
+
+/**
+ * @brief Set keyboard state to the new keys and report the changes
+ *
+ * Changed keys are found by XOR of the bitmaps, word by word. Events are ordered by the key usage.
+ * The state is always updated, changes beyond max_events are not reported.
+ *
+ * @param[in]  state       Keyboard state
+ * @param[in]  keys        Pressed keys of the new report
+ * @param[out] events      Key events, may be NULL if max_events is 0
+ * @param[in]  max_events  Size of events
+ * @return Number of events written to events
+ */
+size_t hid_keyboard_state_update(hid_keyboard_state_t *state, const hid_keyboard_keys_t *keys,
+                                 hid_keyboard_key_event_t *events, size_t max_events);
+
+/**
+ * @brief Get pressed keys of boot protocol keyboard input report
+ *
+ * @param[in]  report  Report data, hid_keyboard_input_report_boot_t
+ * @param[in]  length  Length of the report data
+ * @param[out] keys    Pressed keys
+ * @return
+ *     - ESP_OK:                Keys were decoded
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument or report is too short
+ *     - ESP_ERR_INVALID_STATE: Keyboard reports phantom state (ErrorRollOver), the state must be kept
+ */
+esp_err_t hid_keyboard_keys_from_boot_report(const uint8_t *report, size_t length, hid_keyboard_keys_t *keys);
+
+/**
+ * @brief Get pressed keys of report protocol keyboard input report
+ *
+ * Key arrays and key bitmaps (N-key rollover) of the Keyboard/Keypad page are decoded by the report map,
+ * see hid_host_get_report_map().
+ *
+ * @param[in]  map     Report map of the keyboard Interface
+ * @param[in]  report  Report data, starting with the report ID byte if report IDs are used
+ * @param[in]  length  Length of the report data
+ * @param[out] keys    Pressed keys
+ * @return
+ *     - ESP_OK:                Keys were decoded
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_NOT_FOUND:     The report contains no keys, e.g. report of other ID
+ *     - ESP_ERR_INVALID_STATE: Keyboard reports phantom state (ErrorRollOver), the state must be kept
+ */
+esp_err_t hid_keyboard_keys_from_report(const hid_report_map_t *map, const uint8_t *report, size_t length,
+                                        hid_keyboard_keys_t *keys);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
@@ -0,0 +1,116 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Data bits of Input, Output and Feature main items
+ *
+ * @see 6.2.2.5, p.30 of Device Class Definition for Human Interface Devices (HID) Version 1.11
+ */
+#define HID_FIELD_FLAG_CONSTANT     (1 << 0)    /**< Constant, e.g. padding. Such fields are not in the map */
+#define HID_FIELD_FLAG_VARIABLE     (1 << 1)    /**< Variable, otherwise array of usage indexes */
+#define HID_FIELD_FLAG_RELATIVE     (1 << 2)    /**< Relative, otherwise absolute */
+#define HID_FIELD_FLAG_WRAP         (1 << 3)
+#define HID_FIELD_FLAG_NON_LINEAR   (1 << 4)
+#define HID_FIELD_FLAG_NO_PREFERRED (1 << 5)
+#define HID_FIELD_FLAG_NULL_STATE   (1 << 6)
+
+/**
+ * @brief One field of a report, e.g. X axis of a mouse or one key slot of a keyboard
+ *
+ * Report Count of a main item is flattened, each element is a separate field.
+ */
+typedef struct {
+    uint32_t bit_offset;        /**< Offset in the report data, including the report ID byte if report IDs are used */
+    uint8_t bit_size;           /**< Size of the field in bits, 1 to 32 */
+    uint8_t report_id;          /**< Report ID, 0 if the descriptor does not use report IDs */
+    uint8_t report_type;        /**< Report type, hid_report_type_t */
+    uint8_t flags;              /**< Data bits of the main item, HID_FIELD_FLAG_* */
+    uint16_t usage_page;        /**< Usage page */
+    uint16_t usage;             /**< Usage of a variable field, first usage of an array field */
+    uint16_t usage_max;         /**< Usage of a variable field, last usage of an array field */
+    int32_t logical_min;        /**< Logical minimum, if negative, values are sign extended */
+    int32_t logical_max;        /**< Logical maximum */
+} hid_report_field_t;
+
+/**
+ * @brief Report descriptor compiled into a flat table of fields
+ */
+typedef struct {
+    bool has_report_ids;        /**< Reports start with report ID byte */
+    size_t field_count;         /**< Number of fields */
+    hid_report_field_t *fields; /**< Fields in the order of the report descriptor */
+} hid_report_map_t;
+
+/**
+ * @brief Compile report descriptor into a report map
+ *
+ * Constant fields and fields larger than 32 bits are left out of the map.
+ *
+ * @param[in]  report_desc     Report descriptor
+ * @param[in]  report_desc_len Length of the report descriptor
+ * @param[out] map             Report map, delete by hid_report_map_delete()
+ * @return
+ *     - ESP_OK:                The descriptor was compiled
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_INVALID_STATE: Malformed report descriptor, e.g. truncated item or unbalanced Pop
+ *     - ESP_ERR_NO_MEM:        Not enough memory
+ */
+esp_err_t hid_report_map_create(const uint8_t *report_desc, size_t report_desc_len, hid_report_map_t **map);
+
+/**
+ * @brief Delete report map
+ *
+ * @param[in] map Report map
+ */
+void hid_report_map_delete(hid_report_map_t *map);
+
+/**
+ * @brief Find the first field with the usage
+ *
+ * @param[in] map         Report map
+ * @param[in] report_type Report type, hid_report_type_t
+ * @param[in] usage_page  Usage page
+ * @param[in] usage       Usage, in the usage range of an array field
+ * @return Pointer to the field in the map, NULL if not found
+ */
+const hid_report_field_t *hid_report_map_find(const hid_report_map_t *map, uint8_t report_type,
+                                              uint16_t usage_page, uint16_t usage);
+
+/**
+ * @brief Check that the report contains the field
+ *
+ * @param[in] field  Field of the report map
+ * @param[in] report Report data, starting with the report ID byte if report IDs are used
+ * @param[in] length Length of the report data
+ * @return true, if the report ID matches and the report is long enough
+ */
+bool hid_report_field_present(const hid_report_field_t *field, const uint8_t *report, size_t length);
+
+/**
+ * @brief Extract value of the field from the report
+ *
+ * The report must contain the field, see hid_report_field_present().
+ *
+ * @param[in] field  Field of the report map
+ * @param[in] report Report data, starting with the report ID byte if report IDs are used
+ * @return Value of the field, sign extended if logical minimum is negative
+ */
+int32_t hid_report_field_get_value(const hid_report_field_t *field, const uint8_t *report);
+
+#ifdef __cplusplus
+}
+#endif //__cplusplus
@@ -0,0 +1,364 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file usb_bench.hpp
+ * @brief Benchmark harness shared by host tests of the USB Host class drivers
+ *
+ * - usb_bench::callback_timer measures host time spent in transfer callbacks of the driver
+ * - usb_bench::bus completes submitted transfers in simulated (micro)frames of a Full or High Speed bus
+ * - usb_bench::report prints one JSON object per benchmark configuration, collected by run_host_tests.sh --bench
+ *
+ * The USB Host Library is mocked by CMock, the benchmark routes usb_host_transfer_submit() to the bus.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <time.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "usb/usb_types_ch9.h"
+#include "usb/usb_types_stack.h"
+
+namespace usb_bench {
+
+/**
+ * @brief Host time spent in callbacks
+ *
+ * Wall time of each callback is kept for percentiles, CPU time of the calling thread is summed,
+ * so that preemption by other tasks of the FreeRTOS Linux port does not count.
+ */
+class callback_timer {
+public:
+    template <typename F>
+    void measure(F &&callback)
+    {
+        timespec cpu_start, cpu_end;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_start);
+        const auto start = std::chrono::steady_clock::now();
+        callback();
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &cpu_end);
+
+        wall_ns.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        cpu_ns += (int64_t)(cpu_end.tv_sec - cpu_start.tv_sec) * 1000000000 + (cpu_end.tv_nsec - cpu_start.tv_nsec);
+    }
+
+    void reset()
+    {
+        wall_ns.clear();
+        cpu_ns = 0;
+    }
+
+    size_t count() const
+    {
+        return wall_ns.size();
+    }
+
+    double cpu_ns_avg() const
+    {
+        return wall_ns.empty() ? 0 : (double)cpu_ns / wall_ns.size();
+    }
+
+    int64_t wall_ns_total() const
+    {
+        int64_t total = 0;
+        for (int64_t ns : wall_ns) {
+            total += ns;
+        }
+        return total;
+    }
+
+    /**
+     * @param[in] percentile 0 to 100, 100 is the maximum
+     */
+    int64_t wall_ns_percentile(double percentile) const
+    {
+        if (wall_ns.empty()) {
+            return 0;
+        }
+        std::vector<int64_t> sorted(wall_ns);
+        const size_t idx = std::min(sorted.size() - 1, (size_t)(percentile / 100.0 * sorted.size()));
+        std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+        return sorted[idx];
+    }
+
+private:
+    std::vector<int64_t> wall_ns;
+    int64_t cpu_ns = 0;
+};
+
+enum class ep_type {
+    bulk,
+    interrupt,
+    isoc,
+};
+
+/**
+ * @brief Simulated bus timing
+ *
+ * Time advances in frames of 1 ms (Full Speed) or microframes of 125 us (High Speed). Each endpoint moves the data of its oldest
+ * submitted transfer, in every (micro)frame:
+ * - Bulk: up to 19 packets (Full Speed) or 13 packets (High Speed) of MPS, which is the bandwidth of an otherwise idle bus
+ * - Interrupt: one packet of MPS every service interval
+ * - ISOC: one packet, as described by the isoc_packet_desc of the transfer, every service interval
+ *
+ * The transfer completes with its last byte or packet. The completion rate of an endpoint can be limited further,
+ * e.g. to model a device that produces data slower than the bus could carry them.
+ */
+class bus {
+public:
+    /**
+     * @brief Fill a transfer right before it completes, e.g. with data and actual_num_bytes of an IN transfer
+     *
+     * Without filler, the transfer completes with all requested bytes and packets.
+     */
+    using filler_t = std::function<void(usb_transfer_t *)>;
+
+    explicit bus(usb_speed_t speed) : speed(speed) {}
+
+    uint32_t interval_us() const
+    {
+        return (speed == USB_SPEED_HIGH) ? 125 : 1000;
+    }
+
+    uint64_t now_us() const
+    {
+        return time_us;
+    }
+
+    /**
+     * @param[in] addr     Endpoint address
+     * @param[in] type     Transfer type of the endpoint
+     * @param[in] mps      Maximum packet size
+     * @param[in] interval Interrupt and ISOC: Service interval in (micro)frames
+     * @param[in] rate_hz  Completions per second at most, 0 for the rate of the bus
+     */
+    void endpoint_add(uint8_t addr, ep_type type, uint16_t mps, unsigned interval = 1, uint32_t rate_hz = 0)
+    {
+        endpoint_t &ep = endpoints[addr];
+        ep = {};
+        ep.type = type;
+        ep.mps = mps;
+        ep.interval = std::max(1u, interval);
+        ep.min_spacing_us = rate_hz ? 1000000 / rate_hz : 0;
+    }
+
+    void filler_set(uint8_t addr, filler_t filler)
+    {
+        endpoints.at(addr).filler = filler;
+    }
+
+    /**
+     * @brief Queue transfer on its endpoint, to be called from the usb_host_transfer_submit() stub
+     */
+    void submit(usb_transfer_t *transfer)
+    {
+        endpoints.at(transfer->bEndpointAddress).in_flight.push_back({transfer, 0});
+    }
+
+    size_t in_flight(uint8_t addr) const
+    {
+        return endpoints.at(addr).in_flight.size();
+    }
+
+    /**
+     * @brief Return all transfers of the endpoint, e.g. from the usb_host_endpoint_flush() stub
+     *
+     * @param[in] status Status of the returned transfers, their callbacks are called if it is not USB_TRANSFER_STATUS_COMPLETED
+     */
+    void flush(uint8_t addr, usb_transfer_status_t status = USB_TRANSFER_STATUS_CANCELED)
+    {
+        std::deque<xfer_t> flushed;
+        flushed.swap(endpoints.at(addr).in_flight);
+        if (status == USB_TRANSFER_STATUS_COMPLETED) {
+            return;
+        }
+        for (xfer_t &xfer : flushed) {
+            xfer.transfer->status = status;
+            xfer.transfer->actual_num_bytes = 0;
+            xfer.transfer->callback(xfer.transfer);
+        }
+    }
+
+    /**
+     * @brief Simulate one (micro)frame
+     *
+     * The callbacks of completed transfers are measured by the timer. They can submit transfers again.
+     *
+     * @return Number of completed transfers
+     */
+    size_t tick(callback_timer &timer)
+    {
+        std::vector<usb_transfer_t *> completed;
+        for (auto &it : endpoints) {
+            endpoint_t &ep = it.second;
+            if (ep.in_flight.empty() || (frame % ep.interval) != 0 ||
+                    (ep.completions > 0 && time_us < ep.last_completion_us + ep.min_spacing_us)) {
+                continue;
+            }
+            xfer_t &xfer = ep.in_flight.front();
+            if (progress(ep, xfer)) {
+                completed.push_back(xfer.transfer);
+                ep.in_flight.pop_front();
+                ep.last_completion_us = time_us;
+                ep.completions++;
+            }
+        }
+
+        for (usb_transfer_t *transfer : completed) {
+            endpoint_t &ep = endpoints.at(transfer->bEndpointAddress);
+            complete(ep, transfer);
+            timer.measure([transfer] { transfer->callback(transfer); });
+        }
+        frame++;
+        time_us += interval_us();
+        return completed.size();
+    }
+
+    /**
+     * @brief Simulate the bus for a period of time
+     *
+     * @return Number of completed transfers
+     */
+    size_t run_for(uint64_t duration_us, callback_timer &timer)
+    {
+        size_t cnt = 0;
+        const uint64_t end_us = time_us + duration_us;
+        while (time_us < end_us) {
+            cnt += tick(timer);
+        }
+        return cnt;
+    }
+
+private:
+    typedef struct {
+        usb_transfer_t *transfer;
+        size_t done;                        // Bulk and interrupt: bytes moved. ISOC: packets moved
+    } xfer_t;
+
+    typedef struct {
+        ep_type type;
+        uint16_t mps;
+        unsigned interval;
+        uint32_t min_spacing_us;
+        uint64_t last_completion_us;
+        uint32_t completions;
+        filler_t filler;
+        std::deque<xfer_t> in_flight;
+    } endpoint_t;
+
+    // Move data of this (micro)frame, return true if the transfer is complete
+    bool progress(const endpoint_t &ep, xfer_t &xfer) const
+    {
+        const usb_transfer_t *transfer = xfer.transfer;
+        switch (ep.type) {
+        case ep_type::isoc:
+            return ++xfer.done >= (size_t)transfer->num_isoc_packets;
+        case ep_type::interrupt:
+            xfer.done += ep.mps;
+            break;
+        case ep_type::bulk:
+        default:
+            xfer.done += (size_t)ep.mps * ((speed == USB_SPEED_HIGH) ? 13 : 19);
+            break;
+        }
+        return xfer.done >= (size_t)transfer->num_bytes;
+    }
+
+    void complete(const endpoint_t &ep, usb_transfer_t *transfer) const
+    {
+        transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+        transfer->actual_num_bytes = 0;
+        for (int i = 0; i < transfer->num_isoc_packets; i++) {
+            transfer->isoc_packet_desc[i].status = USB_TRANSFER_STATUS_COMPLETED;
+            transfer->isoc_packet_desc[i].actual_num_bytes = transfer->isoc_packet_desc[i].num_bytes;
+            transfer->actual_num_bytes += transfer->isoc_packet_desc[i].num_bytes;
+        }
+        if (transfer->num_isoc_packets == 0) {
+            transfer->actual_num_bytes = transfer->num_bytes;
+        }
+        if (ep.filler) {
+            ep.filler(transfer);
+        }
+    }
+
+    usb_speed_t speed;
+    uint64_t time_us = 0;
+    uint64_t frame = 0;
+    std::map<uint8_t, endpoint_t> endpoints;
+};
+
+/**
+ * @brief Result of one benchmark configuration
+ *
+ * Printed as one JSON object per line, so that results of all class drivers can be collected and compared:
+ *
+ * {"driver": "cdc", "case": "bulk_in", <parameters and values>, "callbacks": N, "cpu_ns_avg": ..}
+ */
+class report {
+public:
+    report(const char *driver, const char *name)
+    {
+        json = std::string("{\"driver\": \"") + driver + "\", \"case\": \"" + name + "\"";
+    }
+
+    report &value(const char *key, const char *val)
+    {
+        json += std::string(", \"") + key + "\": \"" + val + "\"";
+        return *this;
+    }
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    report &value(const char *key, T val)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%" PRId64, (int64_t)val);
+        json += std::string(", \"") + key + "\": " + buf;
+        return *this;
+    }
+
+    report &value(const char *key, double val)
+    {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.2f", val);
+        json += std::string(", \"") + key + "\": " + buf;
+        return *this;
+    }
+
+    /**
+     * @brief Add callback times: number of callbacks, average CPU time, median, 99th percentile and maximum of wall time
+     */
+    report &timer(const callback_timer &t)
+    {
+        value("callbacks", t.count());
+        value("cpu_ns_avg", t.cpu_ns_avg());
+        value("ns_p50", t.wall_ns_percentile(50));
+        value("ns_p99", t.wall_ns_percentile(99));
+        value("ns_max", t.wall_ns_percentile(100));
+        return *this;
+    }
+
+    void print() const
+    {
+        printf("%s}\n", json.c_str());
+    }
+
+private:
+    std::string json;
+};
+
+} // namespace usb_bench
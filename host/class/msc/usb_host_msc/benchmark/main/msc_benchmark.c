@@ -0,0 +1,445 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <sys/stat.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "usb/usb_host.h"
+#include "usb/msc_host.h"
+#include "usb/msc_host_vfs.h"
+#include "esp_private/msc_scsi_bot.h"
+#include "../private_include/msc_common.h"
+#include "../private_include/msc_cache.h"
+#include "../private_include/msc_async.h"
+
+static const char *TAG = "MSC_BENCHMARK";
+
+#define BENCH_BLOCK_MIN         (512)               // Smallest block of a case
+#define BENCH_BLOCK_MAX         (64 * 1024)         // Largest block of a case
+#define BENCH_BUFFER_SIZE       (128 * 1024)        // Data of all requests in flight
+#define BENCH_AREA_SIZE         (16 * 1024 * 1024)  // Sectors accessed by raw cases
+#define BENCH_CASE_BYTES        (4 * 1024 * 1024)   // A case ends after this amount of data...
+#define BENCH_CASE_TIME_US      (3 * 1000 * 1000)   // ...or after this time
+#define BENCH_FILE_SIZE         (4 * 1024 * 1024)   // Size of the file of VFS cases
+#define BENCH_FILE_PATH         "/usb/bench.bin"
+#define BENCH_CACHE_SECTORS     (64)
+#define BENCH_CACHE_READ_AHEAD  (16)
+
+static const size_t s_queue_depths[] = {1, 2, 4, 8};
+
+typedef enum {
+    BENCH_LAYER_SECTOR,     // msc_host_read_sector() and msc_host_write_sector(), one sector per call
+    BENCH_LAYER_BOT,        // scsi_read_sectors() and scsi_write_sectors(), below the cache
+    BENCH_LAYER_ASYNC,      // msc_host_read_async() and msc_host_write_async()
+    BENCH_LAYER_VFS,        // fread() and fwrite() of a file on FATFS
+} bench_layer_t;
+
+static const char *const s_layer_names[] = {"sector", "bot", "async", "vfs"};
+
+typedef struct {
+    bench_layer_t layer;
+    bool random;
+    bool cache;
+    size_t block_size;
+    size_t queue_depth;
+} bench_case_t;
+
+typedef struct {
+    uint64_t bytes;
+    int64_t time_us;
+    uint32_t requests;
+} bench_result_t;
+
+static QueueHandle_t app_queue;
+static msc_host_device_handle_t device;
+static msc_host_vfs_handle_t vfs_handle;
+static uint8_t *buffer;
+static uint64_t area_first_sector;
+static uint32_t area_sectors;
+static uint32_t sector_size;
+
+static SemaphoreHandle_t async_slots;
+static volatile esp_err_t async_status;
+
+static const esp_vfs_fat_mount_config_t mount_config = {
+    .format_if_mount_failed = true,
+    .max_files = 2,
+    .allocation_unit_size = 16 * 1024,
+};
+
+static void msc_event_cb(const msc_host_event_t *event, void *arg)
+{
+    if (event->event == MSC_DEVICE_CONNECTED || event->event == MSC_DEVICE_DISCONNECTED) {
+        xQueueSend(app_queue, event, 10);
+    }
+}
+
+static void usb_lib_task(void *arg)
+{
+    while (1) {
+        uint32_t event_flags;
+        usb_host_lib_handle_events(portMAX_DELAY, &event_flags);
+        if (event_flags & USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS) {
+            usb_host_device_free_all();
+        }
+    }
+}
+
+/**
+ * @brief Reproducible pseudo-random block index, the same sequence for every drive
+ */
+static uint32_t bench_random(uint32_t *state, uint32_t range)
+{
+    *state = *state * 1664525 + 1013904223;
+    return (uint32_t)(((uint64_t)*state * range) >> 32);
+}
+
+static uint64_t block_sector(const bench_case_t *bench, uint32_t *rng, uint32_t index)
+{
+    const uint32_t sectors = bench->block_size / sector_size;
+    const uint32_t blocks = area_sectors / sectors;
+    const uint32_t block = bench->random ? bench_random(rng, blocks) : index % blocks;
+    return area_first_sector + (uint64_t)block * sectors;
+}
+
+static bool case_done(const bench_result_t *result, int64_t start)
+{
+    return result->bytes >= BENCH_CASE_BYTES || esp_timer_get_time() - start >= BENCH_CASE_TIME_US;
+}
+
+static void async_done_cb(msc_host_device_handle_t dev, esp_err_t status, void *arg)
+{
+    if (status != ESP_OK) {
+        async_status = status;
+    }
+    xSemaphoreGive(async_slots);
+}
+
+static esp_err_t run_blocks(const bench_case_t *bench, bool write, bench_result_t *result)
+{
+    msc_device_t *dev = (msc_device_t *)device;
+    const uint32_t sectors = bench->block_size / sector_size;
+    uint32_t rng = 1;
+    esp_err_t ret = ESP_OK;
+
+    async_status = ESP_OK;
+    const int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; ret == ESP_OK && !case_done(result, start); i++) {
+        const uint64_t sector = block_sector(bench, &rng, i);
+        switch (bench->layer) {
+        case BENCH_LAYER_SECTOR:
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+            for (uint32_t s = 0; ret == ESP_OK && s < sectors; s++) {
+                uint8_t *data = buffer + s * sector_size;
+                ret = write ? msc_host_write_sector(device, sector + s, data, sector_size)
+                      : msc_host_read_sector(device, sector + s, data, sector_size);
+            }
+#pragma GCC diagnostic pop
+            break;
+        case BENCH_LAYER_BOT:
+            ret = write ? scsi_write_sectors(device, 0, buffer, sector, sectors, sector_size)
+                  : scsi_read_sectors(device, 0, buffer, sector, sectors, sector_size);
+            break;
+        case BENCH_LAYER_ASYNC: {
+            // Requests complete in order, so the buffer of the oldest one is free, once its slot is returned
+            uint8_t *data = buffer + (i % bench->queue_depth) * bench->block_size;
+            xSemaphoreTake(async_slots, portMAX_DELAY);
+            ret = write ? msc_host_write_async(device, 0, sector, sectors, data, async_done_cb, NULL)
+                  : msc_host_read_async(device, 0, sector, sectors, data, async_done_cb, NULL);
+            if (ret != ESP_OK) {
+                xSemaphoreGive(async_slots);
+            } else {
+                ret = async_status;
+            }
+            break;
+        }
+        default:
+            ret = ESP_ERR_NOT_SUPPORTED;
+            break;
+        }
+        result->bytes += bench->block_size;
+        result->requests++;
+    }
+
+    if (bench->layer == BENCH_LAYER_ASYNC) {
+        for (size_t i = 0; i < bench->queue_depth; i++) {
+            xSemaphoreTake(async_slots, portMAX_DELAY);
+        }
+        for (size_t i = 0; i < bench->queue_depth; i++) {
+            xSemaphoreGive(async_slots);
+        }
+        if (ret == ESP_OK) {
+            ret = async_status;
+        }
+    }
+    // Written sectors held by the cache are part of the measurement
+    if (ret == ESP_OK && write) {
+        ret = msc_disk_sync(&dev->luns[0].disk);
+    }
+    result->time_us = esp_timer_get_time() - start;
+    return ret;
+}
+
+static esp_err_t run_file(const bench_case_t *bench, bool write, bench_result_t *result)
+{
+    const bool create = write && !bench->random;
+    uint32_t rng = 1;
+    esp_err_t ret = ESP_OK;
+
+    // Sequential write creates the file, other cases access the blocks it has written
+    FILE *f = fopen(BENCH_FILE_PATH, create ? "wb" : write ? "r+b" : "rb");
+    struct stat st = {0};
+    if (!f) {
+        return ESP_FAIL;
+    }
+    if (!create && fstat(fileno(f), &st) != 0) {
+        fclose(f);
+        return ESP_FAIL;
+    }
+    const uint32_t blocks = (create ? BENCH_FILE_SIZE : st.st_size) / bench->block_size;
+    // Each block is one call of FATFS, not merged by newlib
+    setvbuf(f, NULL, _IONBF, 0);
+
+    const int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < blocks && !case_done(result, start); i++) {
+        if (bench->random && fseek(f, (long)bench_random(&rng, blocks) * bench->block_size, SEEK_SET) != 0) {
+            ret = ESP_FAIL;
+            break;
+        }
+        const size_t done = write ? fwrite(buffer, 1, bench->block_size, f) : fread(buffer, 1, bench->block_size, f);
+        if (done != bench->block_size) {
+            ret = ESP_FAIL;
+            break;
+        }
+        result->bytes += bench->block_size;
+        result->requests++;
+    }
+    if (write && fsync(fileno(f)) != 0) {
+        ret = ESP_FAIL;
+    }
+    fclose(f);
+    result->time_us = esp_timer_get_time() - start;
+    return ret;
+}
+
+static void print_header(void)
+{
+    printf("\n| %-6s | %-10s | %7s | %-5s | %2s | %10s | %10s | %10s | %10s |\n",
+           "Layer", "Access", "Block", "Cache", "QD", "Read MB/s", "Read IOPS", "Write MB/s", "Write IOPS");
+    printf("|--------|------------|---------|-------|----|------------|------------|------------|------------|\n");
+}
+
+static void print_result(const bench_result_t *result, esp_err_t ret)
+{
+    if (ret != ESP_OK) {
+        printf(" %10s | %10s |", esp_err_to_name(ret), "-");
+        return;
+    }
+    const double seconds = result->time_us / 1e6;
+    printf(" %10.2f | %10.0f |", result->bytes / seconds / 1e6, result->requests / seconds);
+}
+
+static void run_case(const bench_case_t *bench)
+{
+    bench_result_t read = {0};
+    bench_result_t write = {0};
+    esp_err_t ret;
+
+    printf("| %-6s | %-10s | %7u | %-5s | %2u |", s_layer_names[bench->layer],
+           bench->random ? "random" : "sequential", (unsigned)bench->block_size, bench->cache ? "on" : "off",
+           (unsigned)bench->queue_depth);
+    fflush(stdout);
+
+    // Written first, so sequential file reads find the file
+    if (bench->layer == BENCH_LAYER_VFS) {
+        ret = run_file(bench, true, &write);
+        const esp_err_t read_ret = ret == ESP_OK ? run_file(bench, false, &read) : ret;
+        print_result(&read, read_ret);
+    } else {
+        const esp_err_t read_ret = run_blocks(bench, false, &read);
+        print_result(&read, read_ret);
+        ret = run_blocks(bench, true, &write);
+    }
+    print_result(&write, ret);
+    printf("\n");
+}
+
+static esp_err_t set_cache(bool enable)
+{
+    msc_device_t *dev = (msc_device_t *)device;
+    const msc_host_cache_config_t cache = {
+        .sectors = enable ? BENCH_CACHE_SECTORS : 0,
+        .read_ahead = BENCH_CACHE_READ_AHEAD,
+    };
+
+    ESP_RETURN_ON_ERROR(msc_disk_sync(&dev->luns[0].disk), TAG, "Cache sync failed");
+    msc_cache_uninstall(&dev->luns[0].disk);
+    return msc_cache_install(&dev->luns[0].disk, &cache);
+}
+
+static esp_err_t set_queue_depth(size_t queue_depth)
+{
+    msc_device_t *dev = (msc_device_t *)device;
+    const msc_host_async_config_t async = {
+        .queue_size = queue_depth,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .core_id = tskNO_AFFINITY,
+    };
+
+    msc_async_uninstall(dev);
+    if (async_slots) {
+        vSemaphoreDelete(async_slots);
+        async_slots = NULL;
+    }
+    if (queue_depth == 0) {
+        return ESP_OK;
+    }
+    async_slots = xSemaphoreCreateCounting(queue_depth, queue_depth);
+    ESP_RETURN_ON_FALSE(async_slots, ESP_ERR_NO_MEM, TAG, "Semaphore not created");
+    return msc_async_install(dev, &async);
+}
+
+static void run_raw_cases(void)
+{
+    for (int cache = 0; cache <= 1; cache++) {
+        ESP_ERROR_CHECK(set_cache(cache));
+        for (int random = 0; random <= 1; random++) {
+            for (size_t block = BENCH_BLOCK_MIN; block <= BENCH_BLOCK_MAX; block *= 2) {
+                if (block < sector_size) {
+                    continue;
+                }
+                bench_case_t bench = {
+                    .layer = BENCH_LAYER_SECTOR,
+                    .random = random,
+                    .cache = cache,
+                    .block_size = block,
+                    .queue_depth = 1,
+                };
+                run_case(&bench);
+                // The cache is not used below the sector API
+                if (!cache) {
+                    bench.layer = BENCH_LAYER_BOT;
+                    run_case(&bench);
+                }
+                bench.layer = BENCH_LAYER_ASYNC;
+                for (size_t q = 0; q < sizeof(s_queue_depths) / sizeof(s_queue_depths[0]); q++) {
+                    if (s_queue_depths[q] * block > BENCH_BUFFER_SIZE) {
+                        break;
+                    }
+                    bench.queue_depth = s_queue_depths[q];
+                    ESP_ERROR_CHECK(set_queue_depth(bench.queue_depth));
+                    run_case(&bench);
+                }
+                ESP_ERROR_CHECK(set_queue_depth(0));
+            }
+        }
+    }
+    ESP_ERROR_CHECK(set_cache(false));
+}
+
+static void run_vfs_cases(void)
+{
+    ESP_ERROR_CHECK(msc_host_vfs_register(device, "/usb", &mount_config, &vfs_handle));
+    // Raw cases overwrite sectors of the file system
+    ESP_ERROR_CHECK(msc_host_vfs_format(device, &mount_config, vfs_handle));
+
+    for (int cache = 0; cache <= 1; cache++) {
+        ESP_ERROR_CHECK(set_cache(cache));
+        for (int random = 0; random <= 1; random++) {
+            for (size_t block = BENCH_BLOCK_MIN; block <= BENCH_BLOCK_MAX; block *= 2) {
+                const bench_case_t bench = {
+                    .layer = BENCH_LAYER_VFS,
+                    .random = random,
+                    .cache = cache,
+                    .block_size = block,
+                    .queue_depth = 1,
+                };
+                run_case(&bench);
+            }
+        }
+    }
+    unlink(BENCH_FILE_PATH);
+    ESP_ERROR_CHECK(msc_host_vfs_unregister(vfs_handle));
+    ESP_ERROR_CHECK(set_cache(false));
+}
+
+static void print_device(void)
+{
+    msc_host_device_info_t info;
+    ESP_ERROR_CHECK(msc_host_get_device_info(device, &info));
+    const uint64_t capacity = (uint64_t)info.sector_count * info.sector_size;
+
+    printf("\nIDF: %s\n", esp_get_idf_version());
+    printf("Device: VID 0x%04X, PID 0x%04X, %ls %ls\n", info.idVendor, info.idProduct, info.iManufacturer,
+           info.iProduct);
+    printf("Capacity: %"PRIu64" MB, sector size %"PRIu32" B\n", capacity / (1024 * 1024), info.sector_size);
+    printf("Raw area: %"PRIu32" sectors from %"PRIu64"\n", area_sectors, area_first_sector);
+}
+
+void app_main(void)
+{
+    app_queue = xQueueCreate(5, sizeof(msc_host_event_t));
+    buffer = heap_caps_malloc(BENCH_BUFFER_SIZE, MALLOC_CAP_DMA);
+    assert(app_queue && buffer);
+    for (size_t i = 0; i < BENCH_BUFFER_SIZE; i++) {
+        buffer[i] = (uint8_t)i;
+    }
+
+    const usb_host_config_t host_config = {
+        .intr_flags = ESP_INTR_FLAG_LEVEL1,
+    };
+    ESP_ERROR_CHECK(usb_host_install(&host_config));
+    BaseType_t task_created = xTaskCreatePinnedToCore(usb_lib_task, "usb_lib", 4096, NULL, 2, NULL, 0);
+    assert(task_created);
+
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .task_priority = 5,
+        .stack_size = 4096,
+        .callback = msc_event_cb,
+        .max_io_size = BENCH_BLOCK_MAX,
+    };
+    ESP_ERROR_CHECK(msc_host_install(&msc_config));
+
+    printf("Waiting for USB drive. All data of the drive will be lost!\n");
+    msc_host_event_t event;
+    do {
+        xQueueReceive(app_queue, &event, portMAX_DELAY);
+    } while (event.event != MSC_DEVICE_CONNECTED);
+    ESP_ERROR_CHECK(msc_host_install_device(event.device.address, &device));
+
+    msc_host_device_info_t info;
+    ESP_ERROR_CHECK(msc_host_get_device_info(device, &info));
+    sector_size = info.sector_size;
+    // The area is in the middle of the drive, away from the file system structures at its start
+    area_sectors = MIN(BENCH_AREA_SIZE / sector_size, info.sector_count / 2);
+    area_first_sector = info.sector_count / 2;
+    print_device();
+
+    print_header();
+    run_raw_cases();
+    run_vfs_cases();
+    printf("\nBenchmark done\n");
+
+    ESP_ERROR_CHECK(msc_host_uninstall_device(device));
+    ESP_ERROR_CHECK(msc_host_uninstall());
+}
@@ -7,6 +7,8 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "usb/msc_host.h"
 
@@ -21,31 +23,170 @@ typedef struct {
     uint8_t code_q;
 } scsi_sense_data_t;
 
+// Commands below are addressed to the logical unit 'lun', 0 for devices with a single logical unit
+
 esp_err_t scsi_cmd_read10(msc_host_device_handle_t device,
+                          uint8_t lun,
                           uint8_t *data,
                           uint32_t sector_address,
                           uint32_t num_sectors,
                           uint32_t sector_size);
 
 esp_err_t scsi_cmd_write10(msc_host_device_handle_t device,
+                           uint8_t lun,
                            const uint8_t *data,
                            uint32_t sector_address,
                            uint32_t num_sectors,
                            uint32_t sector_size);
 
+esp_err_t scsi_cmd_read16(msc_host_device_handle_t device,
+                          uint8_t lun,
+                          uint8_t *data,
+                          uint64_t sector_address,
+                          uint32_t num_sectors,
+                          uint32_t sector_size);
+
+esp_err_t scsi_cmd_write16(msc_host_device_handle_t device,
+                           uint8_t lun,
+                           const uint8_t *data,
+                           uint64_t sector_address,
+                           uint32_t num_sectors,
+                           uint32_t sector_size);
+
+/**
+ * @brief Read sectors of any count and address
+ *
+ * READ(10) or READ(16) is selected by capacity of the device and the address.
+ * The request is split into commands of the transfer length from the Block Limits VPD page.
+ */
+esp_err_t scsi_read_sectors(msc_host_device_handle_t device,
+                            uint8_t lun,
+                            uint8_t *data,
+                            uint64_t sector_address,
+                            uint32_t num_sectors,
+                            uint32_t sector_size);
+
+/**
+ * @brief Write sectors of any count and address
+ *
+ * WRITE(10) or WRITE(16) is selected by capacity of the device and the address.
+ * The request is split into commands of the transfer length from the Block Limits VPD page.
+ */
+esp_err_t scsi_write_sectors(msc_host_device_handle_t device,
+                             uint8_t lun,
+                             const uint8_t *data,
+                             uint64_t sector_address,
+                             uint32_t num_sectors,
+                             uint32_t sector_size);
+
+/**
+ * @brief Data segment of a command, transferred by its own bulk transfer
+ */
+typedef struct {
+    uint8_t *data;  /**< Data buffer */
+    size_t size;    /**< Size of the segment in bytes, multiple of sector size */
+} msc_data_segment_t;
+
+/**
+ * @brief Maximum number of sectors of one read or write command at the address
+ */
+uint32_t scsi_max_sectors(msc_host_device_handle_t device, uint8_t lun, uint64_t sector_address, uint32_t sector_size);
+
+/**
+ * @brief Read or write adjacent sectors by one command, with data in separate buffers
+ *
+ * @note Total number of sectors cannot exceed scsi_max_sectors()
+ *
+ * @param[in] device         Device handle
+ * @param[in] lun            Logical Unit Number
+ * @param[in] write          true for WRITE, false for READ
+ * @param[in] sector_address First sector
+ * @param[in] segments       Data buffers, in order of the sectors
+ * @param[in] segment_count  Number of segments
+ * @param[in] sector_size    Sector size in bytes
+ * @return esp_err_t
+ */
+esp_err_t scsi_cmd_rw_segments(msc_host_device_handle_t device,
+                               uint8_t lun,
+                               bool write,
+                               uint64_t sector_address,
+                               const msc_data_segment_t *segments,
+                               size_t segment_count,
+                               uint32_t sector_size);
+
 esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t device,
+                                 uint8_t lun,
                                  uint32_t *block_size,
                                  uint32_t *block_count);
 
-esp_err_t scsi_cmd_sense(msc_host_device_handle_t device, scsi_sense_data_t *sense);
+esp_err_t scsi_cmd_read_capacity16(msc_host_device_handle_t device,
+                                   uint8_t lun,
+                                   uint32_t *block_size,
+                                   uint64_t *block_count);
+
+/**
+ * @brief Get capacity by READ CAPACITY(10), or READ CAPACITY(16) for drives beyond 32-bit LBA
+ *
+ * Selects 16-byte read and write commands for the device by the capacity.
+ */
+esp_err_t scsi_cmd_capacity(msc_host_device_handle_t device,
+                            uint8_t lun,
+                            uint32_t *block_size,
+                            uint64_t *block_count);
+
+/**
+ * @brief Limits of the device from the Block Limits and Logical Block Provisioning VPD pages
+ */
+typedef struct {
+    uint32_t max_transfer_blocks;   /**< Optimal transfer length, or maximum if optimal is not reported. 0 if no limit */
+    uint32_t erase_blocks;          /**< Optimal unmap or transfer length granularity. 0 if not reported */
+    uint32_t max_unmap_blocks;      /**< Maximum number of blocks of one UNMAP command. 0 if UNMAP is not supported */
+} scsi_block_limits_t;
+
+/**
+ * @brief Get the preferred transfer length, erase block and UNMAP support from the VPD pages
+ *
+ * @param[out] limits Limits of the device, zeroed if the pages are not available
+ * @return ESP_ERR_NOT_SUPPORTED if the device does not have the Block Limits page
+ */
+esp_err_t scsi_cmd_block_limits(msc_host_device_handle_t device, uint8_t lun, scsi_block_limits_t *limits);
+
+/**
+ * @brief Release sectors by UNMAP command with one block descriptor
+ *
+ * @note Number of sectors cannot exceed max_unmap_blocks of scsi_block_limits_t
+ */
+esp_err_t scsi_cmd_unmap(msc_host_device_handle_t device, uint8_t lun, uint64_t sector_address, uint32_t num_sectors);
+
+/**
+ * @brief Get state of the volatile write cache from the Caching mode page
+ *
+ * @param[out] enabled Write cache is enabled
+ * @return ESP_ERR_NOT_SUPPORTED if the device does not report the page
+ */
+esp_err_t scsi_cmd_get_write_cache(msc_host_device_handle_t device, uint8_t lun, bool *enabled);
+
+/**
+ * @brief Enable or disable the volatile write cache by MODE SELECT of the Caching mode page
+ *
+ * Other parameters of the page are kept. Nothing is sent if the cache is already in the requested state.
+ */
+esp_err_t scsi_cmd_set_write_cache(msc_host_device_handle_t device, uint8_t lun, bool enable);
+
+/**
+ * @brief Write data held by the volatile write cache of the device to the medium, SYNCHRONIZE CACHE(10)
+ */
+esp_err_t scsi_cmd_sync_cache(msc_host_device_handle_t device, uint8_t lun);
+
+esp_err_t scsi_cmd_sense(msc_host_device_handle_t device, uint8_t lun, scsi_sense_data_t *sense);
 
-esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t device);
+esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t device, uint8_t lun);
 
-esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t device);
+esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t device, uint8_t lun);
 
-esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t device, bool prevent);
+esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t device, uint8_t lun, bool prevent);
 
-esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t device);
+esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t device, uint8_t lun);
 
 #ifdef __cplusplus
 }
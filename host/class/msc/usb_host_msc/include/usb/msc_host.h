@@ -32,20 +32,109 @@ typedef struct {
     enum {
         MSC_DEVICE_CONNECTED,       /**< MSC device has been connected to the system.*/
         MSC_DEVICE_DISCONNECTED,    /**< MSC device has been disconnected from the system.*/
+        MSC_DEVICE_IO_STALLED,      /**< Read or write of MSC device failed or is late, before error recovery.
+                                         Reported only if enabled by stall_notify_ms of the driver configuration. */
+        MSC_DEVICE_READY,           /**< Logical unit became ready after msc_host_install_device_fast(). */
     } event;
     union {
         uint8_t address;                /**< Address of connected MSC device.*/
-        msc_host_device_handle_t handle; /**< MSC device handle to disconnected device.*/
+        msc_host_device_handle_t handle; /**< MSC device handle to disconnected, stalled or ready device.*/
     } device;
+    uint8_t lun;                        /**< Logical unit of MSC_DEVICE_READY */
 } msc_host_event_t;
 
 /**
  * @brief USB Mass Storage event callback.
  *
+ * @note MSC_DEVICE_IO_STALLED is reported from the task executing the command, the callback must not block
+ *
  * @param[in] event mass storage event
 */
 typedef void (*msc_host_event_cb_t)(const msc_host_event_t *event, void *arg);
 
+/**
+ * @brief Sector cache configuration
+ *
+ * The cache sits between the file system and the device. It keeps recently used sectors,
+ * reads ahead on sequential reads and holds written sectors until they are evicted or synced.
+ */
+typedef struct {
+    size_t sectors;                 /**< Number of cached sectors per device. Set to 0 to disable the cache */
+    uint32_t heap_caps;             /**< Heap capabilities of the cached data, e.g. MALLOC_CAP_SPIRAM. 0 for default */
+    size_t read_ahead;              /**< Number of sectors read ahead, when sequential reading is detected. 0 to disable */
+} msc_host_cache_config_t;
+
+/**
+ * @brief Asynchronous I/O configuration
+ *
+ * Requests of msc_host_read_async() and msc_host_write_async() are executed by a worker task of each device.
+ */
+typedef struct {
+    size_t queue_size;              /**< Number of queued requests per device. Set to 0 to disable asynchronous I/O */
+    size_t stack_size;              /**< Stack size of the worker task */
+    unsigned task_priority;         /**< Priority of the worker task */
+    BaseType_t core_id;             /**< Select core on which the worker task will run or tskNO_AFFINITY */
+} msc_host_async_config_t;
+
+/**
+ * @brief Completion callback of asynchronous read or write
+ *
+ * Called from the worker task of the device. The data buffer of the request can be reused.
+ *
+ * @param[in] device Device handle
+ * @param[in] status ESP_OK, or error of the request
+ * @param[in] arg    User provided argument of the request
+ */
+typedef void (*msc_host_io_cb_t)(msc_host_device_handle_t device, esp_err_t status, void *arg);
+
+/**
+ * @brief Priority class of a scheduled request
+ */
+typedef enum {
+    MSC_HOST_IO_PRIORITY_HIGH,      /**< E.g. reads of a player, which must not be late */
+    MSC_HOST_IO_PRIORITY_NORMAL,
+    MSC_HOST_IO_PRIORITY_LOW,       /**< E.g. background copying */
+    MSC_HOST_IO_PRIORITY_MAX,
+} msc_host_io_priority_t;
+
+/**
+ * @brief I/O scheduler configuration
+ *
+ * A scheduler task dispatches requests of msc_host_sched_read() and msc_host_sched_write() of all devices
+ * to the worker tasks of the devices, see msc_host_async_config_t. Higher priority classes go first,
+ * devices take turns within a class and the number of requests on the bus is limited.
+ */
+typedef struct {
+    size_t queue_size;              /**< Number of requests queued or in progress, shared by all devices.
+                                         Set to 0 to disable the scheduler */
+    size_t max_inflight;            /**< Requests dispatched to all devices at once. 0 for queue_size */
+    size_t device_inflight;         /**< Requests dispatched to one device at once, up to queue_size of
+                                         msc_host_async_config_t. 0 for 2 */
+    size_t stack_size;              /**< Stack size of the scheduler task */
+    unsigned task_priority;         /**< Priority of the scheduler task */
+    BaseType_t core_id;             /**< Select core on which the scheduler task will run or tskNO_AFFINITY */
+} msc_host_sched_config_t;
+
+#define MSC_HOST_STRIPE_MAX_DEVICES (4)
+
+typedef struct msc_host_stripe *msc_host_stripe_handle_t;    /**< Handle to a volume striped across devices */
+
+/**
+ * @brief Striped volume configuration
+ *
+ * Sectors of the volume are distributed over the logical units in chunks of stripe_sectors (RAID-0),
+ * so that the devices transfer in parallel. The volume has no redundancy, it is lost with any of the devices.
+ */
+typedef struct {
+    size_t device_count;            /**< Number of logical units, 2 to MSC_HOST_STRIPE_MAX_DEVICES */
+    struct {
+        msc_host_device_handle_t device;
+        uint8_t lun;
+    } members[MSC_HOST_STRIPE_MAX_DEVICES]; /**< Logical units of the volume in order, with the same sector size */
+    uint32_t stripe_sectors;        /**< Sectors of one chunk. 0 for 64 */
+    msc_host_io_priority_t priority; /**< Priority class of requests of the volume */
+} msc_host_stripe_config_t;
+
 /**
  * @brief MSC configuration structure.
 */
@@ -57,14 +146,27 @@ typedef struct {
     BaseType_t core_id;             /**< Select core on which background task will run or tskNO_AFFINITY  */
     msc_host_event_cb_t callback;   /**< Callback invoked when MSC event occurs. Must not be NULL. */
     void *callback_arg;             /**< User provided argument passed to callback */
+    size_t max_io_size;             /**< Size of the data transfer preallocated for each device, in bytes.
+                                         Larger data phases are split. Set to 0 for default 4096 bytes */
+    msc_host_cache_config_t cache;  /**< Sector cache of each device, disabled by default */
+    msc_host_async_config_t async;  /**< Asynchronous I/O of each device, disabled by default */
+    msc_host_sched_config_t sched;  /**< I/O scheduler of all devices, disabled by default. Requires async */
+    uint32_t timeout_ms;            /**< Maximum timeout of a command in ms. Timeouts are derived from the measured
+                                         duration of commands, up to this value. Set to 0 for default 5000 ms */
+    uint32_t stall_notify_ms;       /**< MSC_DEVICE_IO_STALLED is reported, if read or write fails or is not done
+                                         in this time, or twice the expected time if longer. 0 to disable */
+    bool enable_write_cache;        /**< Enable the volatile write cache of devices, which report it disabled in the
+                                         Caching mode page. Data are written to the medium by SYNCHRONIZE CACHE at
+                                         fsync(), fclose() and uninstall of the device */
 } msc_host_driver_config_t;
 
 /**
  * @brief MSC device info.
 */
 typedef struct {
-    uint32_t sector_count;
-    uint32_t sector_size;
+    uint32_t sector_count;          /**< Sector count of LUN 0, see msc_host_get_lun_info() for the others */
+    uint32_t sector_size;           /**< Sector size of LUN 0 */
+    uint8_t lun_count;              /**< Number of logical units, e.g. slots of a card reader */
     uint16_t idProduct;
     uint16_t idVendor;
     wchar_t iManufacturer[MSC_STR_DESC_SIZE];
@@ -72,6 +174,15 @@ typedef struct {
     wchar_t iSerialNumber[MSC_STR_DESC_SIZE];
 } msc_host_device_info_t;
 
+/**
+ * @brief Logical unit info.
+*/
+typedef struct {
+    uint64_t sector_count;          /**< Sector count, 0 if the logical unit is not ready, e.g. empty slot */
+    uint32_t sector_size;           /**< Sector size */
+    bool write_cache;               /**< Volatile write cache of the device is enabled */
+} msc_host_lun_info_t;
+
 /**
  * @brief Install USB Host Mass Storage Class driver
  *
@@ -95,6 +206,19 @@ esp_err_t msc_host_uninstall(void);
  */
 esp_err_t msc_host_install_device(uint8_t device_address, msc_host_device_handle_t *device);
 
+/**
+ * @brief Initialization of MSC device without waiting for its logical units to become ready
+ *
+ * Returns after INQUIRY and READ CAPACITY of each logical unit. Logical units, which are not ready yet,
+ * are polled by a background task with increasing delays. MSC_DEVICE_READY event is reported, when one of them
+ * becomes ready, it can be mounted then. Logical units, which are not ready in 5 seconds, are not reported.
+ *
+ * @param[in]  device_address  Device address obtained from MSC callback provided upon connection and enumeration
+ * @param[out] device          Mass storage device handle to be used for subsequent calls.
+ * @return esp_err_t
+ */
+esp_err_t msc_host_install_device_fast(uint8_t device_address, msc_host_device_handle_t *device);
+
 /**
  * @brief Deinitialization of MSC device.
  *
@@ -139,6 +263,160 @@ __attribute__((deprecated("use API from esp_private/msc_scsi_bot.h")));
 esp_err_t msc_host_write_sector(msc_host_device_handle_t device, size_t sector, const void *data, size_t size)
 __attribute__((deprecated("use API from esp_private/msc_scsi_bot.h")));
 
+/**
+ * @brief Queue reading of sectors
+ *
+ * The request is executed by the worker task of the device, adjacent requests are merged into one command.
+ * Blocks, if the queue is full.
+ *
+ * @param[in]  device   Device handle
+ * @param[in]  lun      Logical Unit Number
+ * @param[in]  sector   First sector to be read
+ * @param[in]  count    Number of sectors
+ * @param[out] data     Buffer into which data will be written, must be valid until the callback
+ * @param[in]  callback Completion callback
+ * @param[in]  arg      User provided argument passed to callback
+ * @return
+ *     - ESP_OK:                The request was queued
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_INVALID_STATE: Asynchronous I/O is disabled by the driver configuration
+ */
+esp_err_t msc_host_read_async(msc_host_device_handle_t device, uint8_t lun, uint64_t sector, uint32_t count,
+                              void *data, msc_host_io_cb_t callback, void *arg);
+
+/**
+ * @brief Queue writing of sectors
+ *
+ * The request is executed by the worker task of the device, adjacent requests are merged into one command.
+ * Blocks, if the queue is full.
+ *
+ * @param[in] device   Device handle
+ * @param[in] lun      Logical Unit Number
+ * @param[in] sector   First sector to be written
+ * @param[in] count    Number of sectors
+ * @param[in] data     Data to be written, must be valid until the callback
+ * @param[in] callback Completion callback
+ * @param[in] arg      User provided argument passed to callback
+ * @return
+ *     - ESP_OK:                The request was queued
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_INVALID_STATE: Asynchronous I/O is disabled by the driver configuration
+ */
+esp_err_t msc_host_write_async(msc_host_device_handle_t device, uint8_t lun, uint64_t sector, uint32_t count,
+                               const void *data, msc_host_io_cb_t callback, void *arg);
+
+/**
+ * @brief Queue reading of sectors to the I/O scheduler
+ *
+ * The request is dispatched to the worker task of the device by its priority, after the requests
+ * of other devices in the same priority class had their turn. Blocks, if the scheduler queue is full.
+ *
+ * @param[in]  device   Device handle
+ * @param[in]  lun      Logical Unit Number
+ * @param[in]  priority Priority class of the request
+ * @param[in]  sector   First sector to be read
+ * @param[in]  count    Number of sectors
+ * @param[out] data     Buffer into which data will be written, must be valid until the callback
+ * @param[in]  callback Completion callback
+ * @param[in]  arg      User provided argument passed to callback
+ * @return
+ *     - ESP_OK:                The request was queued
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_INVALID_STATE: The scheduler or asynchronous I/O is disabled by the driver configuration
+ */
+esp_err_t msc_host_sched_read(msc_host_device_handle_t device, uint8_t lun, msc_host_io_priority_t priority,
+                              uint64_t sector, uint32_t count, void *data, msc_host_io_cb_t callback, void *arg);
+
+/**
+ * @brief Queue writing of sectors to the I/O scheduler
+ *
+ * @see msc_host_sched_read()
+ *
+ * @param[in] device   Device handle
+ * @param[in] lun      Logical Unit Number
+ * @param[in] priority Priority class of the request
+ * @param[in] sector   First sector to be written
+ * @param[in] count    Number of sectors
+ * @param[in] data     Data to be written, must be valid until the callback
+ * @param[in] callback Completion callback
+ * @param[in] arg      User provided argument passed to callback
+ * @return
+ *     - ESP_OK:                The request was queued
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_INVALID_STATE: The scheduler or asynchronous I/O is disabled by the driver configuration
+ */
+esp_err_t msc_host_sched_write(msc_host_device_handle_t device, uint8_t lun, msc_host_io_priority_t priority,
+                               uint64_t sector, uint32_t count, const void *data, msc_host_io_cb_t callback,
+                               void *arg);
+
+/**
+ * @brief Create a volume striped across logical units of several devices
+ *
+ * Requests of the volume go through the I/O scheduler. The volume must be deleted before any of its devices
+ * is uninstalled.
+ *
+ * @param[in]  config Striped volume configuration
+ * @param[out] stripe Handle of the volume
+ * @return
+ *     - ESP_OK:                The volume was created
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument, or the sector sizes differ
+ *     - ESP_ERR_INVALID_STATE: The scheduler is disabled, or a logical unit is not ready
+ *     - ESP_ERR_NO_MEM:        Not enough memory
+ */
+esp_err_t msc_host_stripe_create(const msc_host_stripe_config_t *config, msc_host_stripe_handle_t *stripe);
+
+/**
+ * @brief Delete a striped volume
+ *
+ * @param[in] stripe Handle of the volume
+ * @return esp_err_t
+ */
+esp_err_t msc_host_stripe_delete(msc_host_stripe_handle_t stripe);
+
+/**
+ * @brief Gets striped volume information
+ *
+ * Sector count is the smallest logical unit, rounded down to whole chunks, times the number of devices.
+ *
+ * @param[in]  stripe Handle of the volume
+ * @param[out] info   Structure to be populated with the volume info
+ * @return esp_err_t
+ */
+esp_err_t msc_host_stripe_get_info(msc_host_stripe_handle_t stripe, msc_host_lun_info_t *info);
+
+/**
+ * @brief Read sectors of a striped volume
+ *
+ * Chunks of all devices are requested at once and the call returns, when all of them are done.
+ *
+ * @param[in]  stripe Handle of the volume
+ * @param[in]  sector First sector to be read
+ * @param[in]  count  Number of sectors
+ * @param[out] data   Buffer into which data will be written
+ * @return
+ *     - ESP_OK:              All sectors were read
+ *     - ESP_ERR_INVALID_ARG: Invalid argument, or the sectors are out of the volume
+ *     - Error of the first failed request
+ */
+esp_err_t msc_host_stripe_read(msc_host_stripe_handle_t stripe, uint64_t sector, uint32_t count, void *data);
+
+/**
+ * @brief Write sectors of a striped volume
+ *
+ * @see msc_host_stripe_read()
+ *
+ * @param[in] stripe Handle of the volume
+ * @param[in] sector First sector to be written
+ * @param[in] count  Number of sectors
+ * @param[in] data   Data to be written
+ * @return
+ *     - ESP_OK:              All sectors were written
+ *     - ESP_ERR_INVALID_ARG: Invalid argument, or the sectors are out of the volume
+ *     - Error of the first failed request
+ */
+esp_err_t msc_host_stripe_write(msc_host_stripe_handle_t stripe, uint64_t sector, uint32_t count,
+                                const void *data);
+
 /**
  * @brief Handle MSC HOST events.
  *
@@ -163,6 +441,16 @@ esp_err_t msc_host_handle_events(uint32_t timeout);
  */
 esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_device_info_t *info);
 
+/**
+ * @brief Gets logical unit information.
+ *
+ * @param[in]  device Handle to device
+ * @param[in]  lun    Logical Unit Number, less than lun_count of msc_host_device_info_t
+ * @param[out] info   Structure to be populated with logical unit info
+ * @return esp_err_t
+ */
+esp_err_t msc_host_get_lun_info(msc_host_device_handle_t device, uint8_t lun, msc_host_lun_info_t *info);
+
 /**
  * @brief Print configuration descriptor.
  *
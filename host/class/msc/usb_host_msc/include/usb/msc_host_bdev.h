@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/msc_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct msc_host_bdev *msc_host_bdev_handle_t;        /**< Handle to a logical unit used as a raw block device */
+
+/**
+ * @brief Geometry of a block device
+ */
+typedef struct {
+    uint32_t block_size;            /**< Size of a block in bytes, the unit of read, write and trim */
+    uint64_t block_count;           /**< Number of blocks */
+    uint32_t erase_blocks;          /**< Erase block of the medium in blocks, 1 if not reported. Writes of whole
+                                         aligned erase blocks avoid read-modify-write in the device */
+    uint32_t max_transfer_blocks;   /**< Preferred number of blocks of one request, 0 if not limited */
+    bool trim;                      /**< msc_host_bdev_trim() releases blocks, the device supports UNMAP */
+    bool write_cache;               /**< Volatile write cache of the device is enabled, see msc_host_bdev_sync() */
+} msc_host_bdev_info_t;
+
+/**
+ * @brief Open a logical unit of MSC device as a raw block device, e.g. for littlefs
+ *
+ * The logical unit must not be registered to VFS while the block device is open.
+ * Close it before the device is uninstalled.
+ *
+ * @param[in]  device Device handle
+ * @param[in]  lun    Logical Unit Number
+ * @param[out] bdev   Block device handle
+ * @return
+ *     - ESP_OK:                Block device opened
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument or LUN
+ *     - ESP_ERR_INVALID_STATE: Logical unit is not ready, registered to VFS or already open
+ *     - ESP_ERR_NO_MEM:        Not enough memory
+ */
+esp_err_t msc_host_bdev_open(msc_host_device_handle_t device, uint8_t lun, msc_host_bdev_handle_t *bdev);
+
+/**
+ * @brief Close the block device, written blocks are synchronized to the device
+ *
+ * @param[in] bdev Block device handle
+ * @return
+ *     - ESP_OK:              Block device closed
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - Error of msc_host_bdev_sync(), the block device is closed anyway
+ */
+esp_err_t msc_host_bdev_close(msc_host_bdev_handle_t bdev);
+
+/**
+ * @brief Get geometry of the block device
+ *
+ * @param[in]  bdev Block device handle
+ * @param[out] info Geometry
+ * @return esp_err_t
+ */
+esp_err_t msc_host_bdev_get_info(msc_host_bdev_handle_t bdev, msc_host_bdev_info_t *info);
+
+/**
+ * @brief Read blocks
+ *
+ * Blocks go through the sector cache of the device, if enabled. Large requests are split
+ * into commands of the preferred transfer length.
+ *
+ * @param[in]  bdev   Block device handle
+ * @param[in]  block  First block
+ * @param[in]  count  Number of blocks
+ * @param[out] data   Buffer of count * block_size bytes
+ * @return
+ *     - ESP_OK:              Blocks read
+ *     - ESP_ERR_INVALID_ARG: Invalid argument, or the blocks are out of the device
+ *     - Error of the command
+ */
+esp_err_t msc_host_bdev_read(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, void *data);
+
+/**
+ * @brief Write blocks
+ *
+ * @see msc_host_bdev_read()
+ *
+ * Written blocks may be held by the sector cache or the write cache of the device until msc_host_bdev_sync().
+ *
+ * @param[in] bdev  Block device handle
+ * @param[in] block First block
+ * @param[in] count Number of blocks
+ * @param[in] data  Data of count * block_size bytes
+ * @return
+ *     - ESP_OK:              Blocks written
+ *     - ESP_ERR_INVALID_ARG: Invalid argument, or the blocks are out of the device
+ *     - Error of the command
+ */
+esp_err_t msc_host_bdev_write(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, const void *data);
+
+/**
+ * @brief Queue reading of blocks to the worker task of the device
+ *
+ * @see msc_host_read_async()
+ *
+ * @return
+ *     - ESP_OK:                The request was queued
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument, or the blocks are out of the device
+ *     - ESP_ERR_INVALID_STATE: Asynchronous I/O is disabled by the driver configuration
+ */
+esp_err_t msc_host_bdev_read_async(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, void *data,
+                                   msc_host_io_cb_t callback, void *arg);
+
+/**
+ * @brief Queue writing of blocks to the worker task of the device
+ *
+ * @see msc_host_write_async()
+ *
+ * @return
+ *     - ESP_OK:                The request was queued
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument, or the blocks are out of the device
+ *     - ESP_ERR_INVALID_STATE: Asynchronous I/O is disabled by the driver configuration
+ */
+esp_err_t msc_host_bdev_write_async(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, const void *data,
+                                    msc_host_io_cb_t callback, void *arg);
+
+/**
+ * @brief Release blocks, which do not hold data any more, e.g. erased blocks of littlefs
+ *
+ * Released blocks read back as undefined data. Cached copies are dropped without write back.
+ *
+ * @param[in] bdev  Block device handle
+ * @param[in] block First block
+ * @param[in] count Number of blocks
+ * @return
+ *     - ESP_OK:                Blocks released
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument, or the blocks are out of the device
+ *     - ESP_ERR_NOT_SUPPORTED: The device does not support UNMAP, see trim of msc_host_bdev_info_t
+ *     - Error of the command
+ */
+esp_err_t msc_host_bdev_trim(msc_host_bdev_handle_t bdev, uint64_t block, uint64_t count);
+
+/**
+ * @brief Write blocks held by the sector cache, then flush the write cache of the device
+ *
+ * Blocks written before are on the medium after this call, e.g. for a commit of a power-fail-safe log.
+ * Completed asynchronous writes are included.
+ *
+ * @param[in] bdev Block device handle
+ * @return esp_err_t
+ */
+esp_err_t msc_host_bdev_sync(msc_host_bdev_handle_t bdev);
+
+#ifdef __cplusplus
+}
+#endif
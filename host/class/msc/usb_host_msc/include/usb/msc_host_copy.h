@@ -0,0 +1,115 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/msc_host.h"
+#include "usb/msc_host_vfs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Source or destination of a sector copy
+ *
+ * Either a logical unit of an MSC device, or other media such as an SD card, accessed by the callbacks.
+ */
+typedef struct {
+    msc_host_device_handle_t device; /**< MSC device, or NULL for other media */
+    uint8_t lun;                     /**< Logical Unit Number of the MSC device */
+    esp_err_t (*read)(void *ctx, uint64_t sector, uint32_t count, void *data);        /**< Read sectors of other media,
+                                                                                          e.g. by sdmmc_read_sectors() */
+    esp_err_t (*write)(void *ctx, uint64_t sector, uint32_t count, const void *data); /**< Write sectors of other media,
+                                                                                          e.g. by sdmmc_write_sectors() */
+    void *ctx;                       /**< Argument of the callbacks, e.g. sdmmc_card_t */
+    uint32_t sector_size;            /**< Sector size of other media */
+} msc_host_copy_media_t;
+
+/**
+ * @brief Progress callback of a copy
+ *
+ * Called from the task calling the copy function, whenever a chunk was written, and once at the end.
+ *
+ * @param[in] done  Bytes written to the destination
+ * @param[in] total Bytes of the copy
+ * @param[in] arg   User provided argument
+ * @return false to cancel the copy
+ */
+typedef bool (*msc_host_copy_progress_cb_t)(uint64_t done, uint64_t total, void *arg);
+
+/**
+ * @brief Copy configuration
+ *
+ * The source is read into one buffer by the calling task, while the other buffer is written
+ * to the destination by a writer task, so reads of one side overlap writes of the other.
+ */
+typedef struct {
+    size_t chunk_size;              /**< Size of each of the two buffers in bytes, multiple of the sector size.
+                                         0 for 64 KiB */
+    uint32_t heap_caps;             /**< Heap capabilities of the buffers. 0 for MALLOC_CAP_DMA */
+    size_t stack_size;              /**< Stack size of the writer task. 0 for 4096 */
+    unsigned task_priority;         /**< Priority of the writer task. 0 for priority of the calling task */
+    msc_host_copy_progress_cb_t progress_cb; /**< Progress callback, may be NULL */
+    void *progress_arg;             /**< User provided argument passed to progress_cb */
+} msc_host_copy_config_t;
+
+/**
+ * @brief Copy sectors between two media
+ *
+ * Sectors of MSC logical units go through the sector cache of the device, if enabled, and the written
+ * sectors are synchronized to the device in the end.
+ * Blocks until all sectors are written, the copy fails or it is cancelled by the progress callback.
+ *
+ * @param[in] config     Copy configuration, NULL for default
+ * @param[in] src        Source media
+ * @param[in] src_sector First sector of the source
+ * @param[in] dst        Destination media
+ * @param[in] dst_sector First sector of the destination
+ * @param[in] count      Number of sectors
+ * @return
+ *     - ESP_OK:                All sectors were copied
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument, or the sectors are out of an MSC logical unit
+ *     - ESP_ERR_INVALID_SIZE:  Sector sizes of the media differ, or chunk_size is not a multiple of them
+ *     - ESP_ERR_INVALID_STATE: An MSC logical unit is not ready, or the copy was cancelled
+ *     - ESP_ERR_NO_MEM:        Not enough memory
+ *     - Error of the first failed read or write
+ */
+esp_err_t msc_host_copy_sectors(const msc_host_copy_config_t *config,
+                                const msc_host_copy_media_t *src, uint64_t src_sector,
+                                const msc_host_copy_media_t *dst, uint64_t dst_sector,
+                                uint64_t count);
+
+/**
+ * @brief Copy a file between two volumes mounted to VFS, e.g. from an SD card to an MSC device
+ *
+ * The destination is preallocated to the size of the source before the data are copied. If dst_vfs
+ * is given, the destination is created by msc_host_vfs_stream_open() in contiguous clusters and its
+ * sectors are written without FATFS. Otherwise the clusters are allocated by writing the last byte first.
+ * The destination is removed, if the copy fails.
+ *
+ * @param[in] config   Copy configuration, NULL for default
+ * @param[in] src_path Path of the source file
+ * @param[in] dst_path Path of the destination file, it is overwritten
+ * @param[in] dst_vfs  MSC logical unit holding dst_path, or NULL if the destination is on other media
+ * @return
+ *     - ESP_OK:                The file was copied
+ *     - ESP_ERR_INVALID_ARG:   Invalid argument
+ *     - ESP_ERR_NOT_FOUND:     The source file was not opened
+ *     - ESP_ERR_INVALID_STATE: The copy was cancelled
+ *     - ESP_ERR_NO_MEM:        Not enough memory
+ *     - ESP_FAIL:              The destination was not created or written, e.g. not enough free space
+ */
+esp_err_t msc_host_copy_file(const msc_host_copy_config_t *config, const char *src_path, const char *dst_path,
+                             msc_host_vfs_handle_t dst_vfs);
+
+#ifdef __cplusplus
+}
+#endif
@@ -15,6 +15,18 @@ extern "C" {
 #endif
 
 typedef struct msc_host_vfs *msc_host_vfs_handle_t;           /**< VFS handle to attached Mass Storage device */
+typedef struct msc_host_stream *msc_host_stream_handle_t;     /**< Handle to a file written by streaming */
+
+/**
+ * @brief Options of msc_host_vfs_register_ex()
+ */
+typedef struct {
+    bool lazy_mount;                /**< The volume is mounted by FATFS at the first access to it, not at registration.
+                                         format_if_mount_failed of the mount configuration is not applied */
+    bool scan_free_space;           /**< If FSINFO does not hold the free cluster count, it is counted in a background task
+                                         by multi-sector reads of the FAT. FATFS would count it at the first statvfs(),
+                                         by single sector reads, blocking the volume for seconds on large drives */
+} msc_host_vfs_options_t;
 
 /**
  * @brief Format MSC device.
@@ -44,6 +56,67 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
                                 const esp_vfs_fat_mount_config_t *mount_config,
                                 msc_host_vfs_handle_t *vfs_handle);
 
+/**
+ * @brief Register logical unit of MSC device to Virtual filesystem.
+ *
+ * Each logical unit, e.g. a slot of a card reader, is mounted to its own base path.
+ * msc_host_vfs_register() registers LUN 0.
+ *
+ * @param[in]  device  Device handle obtained from MSC callback provided upon initialization
+ * @param[in]  lun     Logical Unit Number, less than lun_count of msc_host_device_info_t
+ * @param[in]  base_path Base VFS path to be used to access file storage
+ * @param[in]  mount_config Mount configuration.
+ * @param[out] vfs_handle Handle to MSC device associated with registered VFS
+ * @return
+ *    - ESP_OK: Logical unit mounted
+ *    - ESP_ERR_INVALID_ARG: Invalid argument or LUN
+ *    - ESP_ERR_INVALID_STATE: Logical unit is not ready, e.g. no card in the slot
+ *    - ESP_ERR_MSC_MOUNT_FAILED: Mounting failed
+ */
+esp_err_t msc_host_vfs_register_lun(msc_host_device_handle_t device,
+                                    uint8_t lun,
+                                    const char *base_path,
+                                    const esp_vfs_fat_mount_config_t *mount_config,
+                                    msc_host_vfs_handle_t *vfs_handle);
+
+/**
+ * @brief Register logical unit of MSC device to Virtual filesystem, with options
+ *
+ * @param[in]  device  Device handle obtained from MSC callback provided upon initialization
+ * @param[in]  lun     Logical Unit Number, less than lun_count of msc_host_device_info_t
+ * @param[in]  base_path Base VFS path to be used to access file storage
+ * @param[in]  mount_config Mount configuration.
+ * @param[in]  options Options, NULL for behavior of msc_host_vfs_register_lun()
+ * @param[out] vfs_handle Handle to MSC device associated with registered VFS
+ * @return
+ *    - ESP_OK: Logical unit registered, and mounted unless lazy_mount is set
+ *    - ESP_ERR_INVALID_ARG: Invalid argument or LUN
+ *    - ESP_ERR_INVALID_STATE: Logical unit is not ready, e.g. no card in the slot
+ *    - ESP_ERR_NO_MEM: Not enough memory for the free space scan
+ *    - ESP_ERR_MSC_MOUNT_FAILED: Mounting failed
+ */
+esp_err_t msc_host_vfs_register_ex(msc_host_device_handle_t device,
+                                   uint8_t lun,
+                                   const char *base_path,
+                                   const esp_vfs_fat_mount_config_t *mount_config,
+                                   const msc_host_vfs_options_t *options,
+                                   msc_host_vfs_handle_t *vfs_handle);
+
+/**
+ * @brief Get size and free space of the volume, without counting free clusters
+ *
+ * Free space is known from FSINFO, from the free space scan of msc_host_vfs_options_t
+ * or after FATFS counted it, e.g. by statvfs().
+ *
+ * @param[in]  vfs_handle  Handle of the registered logical unit
+ * @param[out] total_bytes Size of the data area
+ * @param[out] free_bytes  Free space
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: Invalid argument
+ *    - ESP_ERR_INVALID_STATE: The volume is not mounted yet or its free space is not known yet
+ */
+esp_err_t msc_host_vfs_get_free_space(msc_host_vfs_handle_t vfs_handle, uint64_t *total_bytes, uint64_t *free_bytes);
 
 /**
  * @brief Unregister MSC device from Virtual filesystem.
@@ -53,6 +126,55 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
  */
 esp_err_t msc_host_vfs_unregister(msc_host_vfs_handle_t vfs_handle);
 
+/**
+ * @brief Create a file of contiguous clusters for streaming
+ *
+ * The clusters are allocated at once and the file entry is written with the preallocated size.
+ * Data are then written directly to the sectors of the file, FATFS is not involved
+ * until msc_host_vfs_stream_close() sets the final size.
+ *
+ * @note Requires FATFS with FF_USE_EXPAND. The file must not be accessed through VFS until it is closed.
+ *
+ * @param[in]  vfs_handle Handle of the mounted logical unit
+ * @param[in]  path       Path of the file under the base path of the VFS, e.g. "/usb/video.mjpeg"
+ * @param[in]  size       Preallocated size of the file in bytes, maximum size of the stream
+ * @param[out] stream     Stream handle
+ * @return
+ *    - ESP_OK: File created
+ *    - ESP_ERR_INVALID_ARG: Invalid argument or path outside of the base path
+ *    - ESP_ERR_NO_MEM: Not enough memory
+ *    - ESP_ERR_NOT_SUPPORTED: FATFS is built without FF_USE_EXPAND
+ *    - ESP_FAIL: File was not created, e.g. not enough contiguous free space
+ */
+esp_err_t msc_host_vfs_stream_open(msc_host_vfs_handle_t vfs_handle, const char *path, uint64_t size,
+                                   msc_host_stream_handle_t *stream);
+
+/**
+ * @brief Write data at the end of the stream
+ *
+ * Size of the data must be a multiple of sector size, except the last write of the stream.
+ * The tail of the last write is padded by zeros to a whole sector.
+ *
+ * @param[in] stream Stream handle
+ * @param[in] data   Data
+ * @param[in] size   Size of the data in bytes
+ * @return
+ *    - ESP_OK: Data written
+ *    - ESP_ERR_INVALID_SIZE: Data exceed the preallocated size
+ *    - ESP_ERR_INVALID_STATE: Last write of the stream has been done
+ */
+esp_err_t msc_host_vfs_stream_write(msc_host_stream_handle_t stream, const void *data, size_t size);
+
+/**
+ * @brief Close the stream, the file is truncated to the written size
+ *
+ * Clusters beyond the written data are released.
+ *
+ * @param[in] stream Stream handle
+ * @return esp_err_t
+ */
+esp_err_t msc_host_vfs_stream_close(msc_host_stream_handle_t stream);
+
 #ifdef __cplusplus
 }
 #endif
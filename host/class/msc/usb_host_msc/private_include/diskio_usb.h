@@ -6,16 +6,33 @@
 
 #pragma once
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+typedef struct msc_cache msc_cache_t;
+struct msc_host_device;
+
 /**
  * @brief Mass storage disk initialization structure
  */
 typedef struct {
-    uint32_t block_size;    /**< Block size */
-    uint32_t block_count;   /**< Block count */
+    struct msc_host_device *device; /**< Device of the logical unit */
+    uint8_t lun;                    /**< Logical Unit Number */
+    uint32_t block_size;            /**< Block size */
+    uint64_t block_count;           /**< Block count */
+    uint32_t max_transfer_blocks;   /**< Preferred number of blocks of one command, 0 if not limited */
+    uint32_t erase_blocks;          /**< Erase block size in blocks, 0 if not reported */
+    uint32_t max_unmap_blocks;      /**< Maximum number of blocks of one UNMAP command, 0 if UNMAP is not supported */
+    bool cmd16;                     /**< 16-byte commands are required by the capacity */
+    bool write_cache;               /**< Volatile write cache of the device is enabled, flushed by SYNCHRONIZE CACHE */
+    msc_cache_t *cache;             /**< Sector cache, NULL if disabled */
+    uint64_t watch_sector;          /**< First sector of the range, whose writes by FATFS are counted, e.g. FAT during the free space scan */
+    uint32_t watch_count;           /**< Sectors of the watched range, 0 if none */
+    volatile uint32_t watch_writes; /**< Writes by FATFS overlapping the watched range */
 } usb_disk_t;
 
 /**
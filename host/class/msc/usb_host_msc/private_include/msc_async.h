@@ -0,0 +1,36 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "usb/msc_host.h"
+#include "msc_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Create request queue and worker task of the device, if enabled by the configuration
+ *
+ * @param[in] device MSC device handle
+ * @param[in] config Asynchronous I/O configuration
+ * @return esp_err_t
+ */
+esp_err_t msc_async_install(msc_device_t *device, const msc_host_async_config_t *config);
+
+/**
+ * @brief Complete queued requests, stop the worker task and delete the queue
+ *
+ * @param[in] device MSC device handle
+ */
+void msc_async_uninstall(msc_device_t *device);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,81 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/msc_host.h"
+#include "msc_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Create sector cache of the logical unit, if enabled by the configuration
+ *
+ * @param[in] disk   Logical unit
+ * @param[in] config Cache configuration
+ * @return esp_err_t
+ */
+esp_err_t msc_cache_install(usb_disk_t *disk, const msc_host_cache_config_t *config);
+
+/**
+ * @brief Delete sector cache of the logical unit, dirty sectors are lost
+ *
+ * Call msc_disk_sync() before, to write them to the device
+ *
+ * @param[in] disk Logical unit
+ */
+void msc_cache_uninstall(usb_disk_t *disk);
+
+/**
+ * @brief Read sectors through the cache
+ *
+ * @param[in]  disk   Logical unit
+ * @param[out] data   Data buffer
+ * @param[in]  sector First sector
+ * @param[in]  count  Number of sectors
+ * @return esp_err_t
+ */
+esp_err_t msc_disk_read(usb_disk_t *disk, uint8_t *data, uint64_t sector, uint32_t count);
+
+/**
+ * @brief Write sectors through the cache
+ *
+ * Written sectors are kept in the cache, until they are evicted or msc_disk_sync() is called
+ *
+ * @param[in] disk   Logical unit
+ * @param[in] data   Data buffer
+ * @param[in] sector First sector
+ * @param[in] count  Number of sectors
+ * @return esp_err_t
+ */
+esp_err_t msc_disk_write(usb_disk_t *disk, const uint8_t *data, uint64_t sector, uint32_t count);
+
+/**
+ * @brief Write all dirty sectors of the cache to the device, then flush the write cache of the device
+ *
+ * @param[in] disk Logical unit
+ * @return esp_err_t
+ */
+esp_err_t msc_disk_sync(usb_disk_t *disk);
+
+/**
+ * @brief Release sectors of the device by UNMAP, cached copies are dropped without write back
+ *
+ * @param[in] disk   Logical unit
+ * @param[in] sector First sector
+ * @param[in] count  Number of sectors
+ * @return ESP_ERR_NOT_SUPPORTED if the device does not support UNMAP
+ */
+esp_err_t msc_disk_trim(usb_disk_t *disk, uint64_t sector, uint64_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,12 +7,16 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/queue.h>
 #include "esp_err.h"
 #include "esp_check.h"
 #include "diskio_usb.h"
+#include "msc_scsi_bot.h"
 #include "usb/usb_host.h"
 #include "usb/usb_types_stack.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
 
 #ifdef __cplusplus
@@ -22,25 +26,105 @@ extern "C"
 
 typedef enum {
     MSC_EP_OUT,
-    MSC_EP_IN
+    MSC_EP_IN,
+    MSC_EP_UAS_COMMAND,
+    MSC_EP_UAS_STATUS,
 } msc_endpoint_t;
 
 typedef struct {
     uint16_t bulk_in_mps;
-    uint8_t bulk_in_ep;
-    uint8_t bulk_out_ep;
+    uint8_t bulk_in_ep;             // BOT bulk IN, or UAS data-in pipe
+    uint8_t bulk_out_ep;            // BOT bulk OUT, or UAS data-out pipe
     uint8_t iface_num;
+    uint8_t alt_setting;
+    bool uas;                       // USB Attached SCSI transport
+    uint8_t uas_cmd_ep;
+    uint8_t uas_status_ep;
 } msc_config_t;
 
+typedef struct msc_async msc_async_t;
+
+#define MSC_LUN_MAX 16              // Logical units of BOT device, by 4-bit bCBWLUN
+
+/**
+ * @brief Logical unit of the device, e.g. a slot of a card reader
+ */
+typedef struct {
+    usb_disk_t disk;
+    SemaphoreHandle_t cmd_turn;     // Given to a waiting command of this LUN, when it is its turn
+    uint8_t cmd_waiting;            // Commands waiting for the turn
+    scsi_sense_data_t sense;        // Sense data of the last failed command, read by the transport
+    bool sense_valid;               // Sense data were not taken by scsi_cmd_sense() yet
+    scsi_sense_data_t sense_logged; // Last logged sense data, repeated ones are rate limited
+    int64_t sense_log_us;           // Time of the last logged sense data
+    uint32_t sense_suppressed;      // Sense data not logged since then
+    bool ready_pending;             // Readiness is polled in the background, see msc_host_install_device_fast()
+    bool bdev_open;                 // Opened by msc_host_bdev_open(), it cannot be registered to VFS
+} msc_lun_t;
+
+/**
+ * @brief Timing of commands, timeouts are derived from the measured durations
+ */
+typedef struct {
+    uint32_t latency_us;            // Duration of a command with little data, 0 if not measured
+    uint32_t in_us_per_kib;         // Data-in duration per KiB, 0 if not measured
+    uint32_t out_us_per_kib;        // Data-out duration per KiB, 0 if not measured
+    int64_t start_us;               // Start of the current command
+    size_t size;                    // Data of the current command in bytes
+    bool data_in;                   // Direction of the current command
+    bool rw;                        // The current command reads or writes sectors
+    bool notified;                  // The current command has been reported as stalled
+    uint32_t timeout_ms;            // Timeout of bulk transfers of the current command
+    uint32_t notify_ms;             // The application is notified, if a transfer is not done in this time
+} msc_timing_t;
+
 typedef struct msc_host_device {
     STAILQ_ENTRY(msc_host_device) tailq_entry;
     SemaphoreHandle_t transfer_done;
+    SemaphoreHandle_t cmd_lock;     // Protects the command scheduling below
+    TaskHandle_t cmd_owner;         // Task executing commands, NULL while the turn is handed over
+    uint8_t cmd_depth;              // Nested commands of the owner, e.g. of reset recovery
+    msc_async_t *async;             // Asynchronous I/O, NULL if disabled
+    uint8_t sched_inflight;         // Requests dispatched by the I/O scheduler, not completed yet
+    uint32_t sched_served;          // Dispatch sequence number of the last request of this device
     usb_device_handle_t handle;
-    usb_transfer_t *xfer;
+    usb_transfer_t *xfer;           // Data phase and control transfers, preallocated by max I/O size
+    size_t xfer_size;               // Requested buffer size of xfer, a pooled buffer can be larger
+    usb_transfer_t *cbw_xfer;       // Command transport
+    usb_transfer_t *csw_xfer;       // Status transport
+    uint8_t xfer_pending;           // Pipelined transfers not done yet
+    bool xfer_failed;               // Any pipelined transfer failed
+    portMUX_TYPE lock;              // Protects xfer_pending and xfer_failed
+    msc_timing_t timing;
     msc_config_t config;
-    usb_disk_t disk;
+    uint8_t lun_count;
+    msc_lun_t *luns;                // Logical units, lun_count items
+    TaskHandle_t ready_task;        // Background readiness polling, NULL if not started
+    SemaphoreHandle_t ready_wake;   // Wakes the polling up from its delay, when it is stopped
+    SemaphoreHandle_t ready_done;   // Given by the polling task, when it ends
+    volatile bool ready_stop;       // The polling is stopped by uninstall of the device
 } msc_device_t;
 
+/**
+ * @brief Set timeouts of the command by the expected duration
+ *
+ * @param[in] device_handle MSC device handle
+ * @param[in] size          Size of data in bytes
+ * @param[in] data_in       Direction of the data
+ * @param[in] rw            The command reads or writes sectors, its stall is reported to the application
+ */
+void msc_command_begin(msc_device_t *device_handle, size_t size, bool data_in, bool rw);
+
+/**
+ * @brief Update expected durations by the finished command
+ *
+ * Failed transport resets them, so recovery and retries get the full timeout.
+ *
+ * @param[in] device_handle MSC device handle
+ * @param[in] ret           Result of the command
+ */
+void msc_command_end(msc_device_t *device_handle, esp_err_t ret);
+
 /**
  * @brief Trigger a BULK transfer to device
  *
@@ -54,6 +138,70 @@ typedef struct msc_host_device {
  */
 esp_err_t msc_bulk_transfer(msc_device_t *device_handle, uint8_t *data, size_t size, msc_endpoint_t ep);
 
+/**
+ * @brief Send Command Block Wrapper to device
+ *
+ * @param[in] device_handle MSC device handle
+ * @param[in] cbw           Command Block Wrapper
+ * @param[in] size          Size of CBW in bytes
+ * @return esp_err_t
+ */
+esp_err_t msc_cbw_transfer(msc_device_t *device_handle, const uint8_t *cbw, size_t size);
+
+/**
+ * @brief Receive Command Status Wrapper from device
+ *
+ * @param[in]  device_handle MSC device handle
+ * @param[out] csw           Command Status Wrapper
+ * @param[in]  size          Size of CSW in bytes
+ * @return esp_err_t
+ */
+esp_err_t msc_csw_transfer(msc_device_t *device_handle, uint8_t *csw, size_t size);
+
+/**
+ * @brief Send UAS Information Unit to the command pipe
+ *
+ * @param[in] device_handle MSC device handle
+ * @param[in] iu            Information Unit
+ * @param[in] size          Size of IU in bytes
+ * @return esp_err_t
+ */
+esp_err_t msc_uas_command_transfer(msc_device_t *device_handle, const uint8_t *iu, size_t size);
+
+/**
+ * @brief Receive UAS Information Unit from the status pipe
+ *
+ * @param[in]  device_handle MSC device handle
+ * @param[out] iu            Information Unit
+ * @param[in]  size          Size of the buffer in bytes
+ * @return esp_err_t
+ */
+esp_err_t msc_uas_status_transfer(msc_device_t *device_handle, uint8_t *iu, size_t size);
+
+/**
+ * @brief Execute BOT transports of one command in a pipeline
+ *
+ * CBW, data and CSW transfers are submitted at once and the task waits once, for the last of them.
+ * In case of a failure, the rest of the queued transfers is canceled.
+ *
+ * @param[in]    device_handle MSC device handle
+ * @param[in]    cbw           Command Block Wrapper
+ * @param[in]    cbw_size      Size of CBW in bytes
+ * @param[inout] data          Data buffer (optional). Direction depends on 'ep'.
+ * @param[in]    size          Size of data in bytes
+ * @param[in]    ep            Direction of the data transport
+ * @param[out]   csw           Command Status Wrapper
+ * @param[in]    csw_size      Size of CSW in bytes
+ * @param[out]   csw_err       Result of the status transport, valid if ESP_OK is returned
+ * @return
+ *     - ESP_OK: Command and data transport succeeded
+ *     - ESP_ERR_NOT_SUPPORTED: Data do not fit in one transfer, transports must be executed one by one
+ *     - Error of the command or data transport otherwise
+ */
+esp_err_t msc_bot_transfer(msc_device_t *device_handle, const uint8_t *cbw, size_t cbw_size,
+                           uint8_t *data, size_t size, msc_endpoint_t ep,
+                           uint8_t *csw, size_t csw_size, esp_err_t *csw_err);
+
 /**
  * @brief Trigger a CTRL transfer to device
  *
@@ -0,0 +1,45 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "usb/msc_host.h"
+#include "msc_common.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Create the request pool and scheduler task, if enabled by the configuration
+ *
+ * @param[in] config       I/O scheduler configuration
+ * @param[in] async_config Asynchronous I/O configuration of the devices, the scheduler dispatches to
+ * @return esp_err_t
+ */
+esp_err_t msc_sched_install(const msc_host_sched_config_t *config, const msc_host_async_config_t *async_config);
+
+/**
+ * @brief Stop the scheduler task and delete the request pool
+ *
+ * All devices must be removed before.
+ */
+void msc_sched_uninstall(void);
+
+/**
+ * @brief Complete queued requests of the device with ESP_ERR_INVALID_STATE
+ *
+ * Requests already dispatched to the device are completed by msc_async_uninstall().
+ *
+ * @param[in] device MSC device handle
+ */
+void msc_sched_remove_device(msc_device_t *device);
+
+#ifdef __cplusplus
+}
+#endif
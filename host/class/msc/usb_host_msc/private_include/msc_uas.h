@@ -0,0 +1,55 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "msc_common.h"
+#include "msc_scsi_bot.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// Pipe Usage descriptor, follows each endpoint descriptor of UAS interface
+#define UAS_DESC_TYPE_PIPE_USAGE        0x24
+#define UAS_PIPE_USAGE_PIPE_ID_OFFSET   0       // bPipeID, offset in 'val' of usb_standard_desc_t
+#define UAS_PIPE_ID_COMMAND             0x01
+#define UAS_PIPE_ID_STATUS              0x02
+#define UAS_PIPE_ID_DATA_IN             0x03
+#define UAS_PIPE_ID_DATA_OUT            0x04
+#define UAS_PIPE_COUNT                  4
+
+/**
+ * @brief Execute SCSI command by USB Attached SCSI transport
+ *
+ * Without streams, which USB 2.0 does not have, the device announces the data phase by READ READY or
+ * WRITE READY IU on the status pipe and finishes the command by SENSE IU.
+ *
+ * @see Universal Serial Bus Attached SCSI (UAS), Revision 1.0, Chapter 6.2
+ *
+ * @param[in] device        MSC device handle
+ * @param[in] lun           Logical Unit Number
+ * @param[in] cdb           Command Descriptor Block
+ * @param[in] cdb_len       Length of CDB, up to 16 bytes
+ * @param[in] data_in       Direction of the data phase
+ * @param[in] segments      Data buffers (optional)
+ * @param[in] segment_count Number of segments
+ * @return
+ *     - ESP_OK: Command succeeded with GOOD status
+ *     - ESP_FAIL: Command failed, sense data of SENSE IU are logged
+ *     - Error of the transfers otherwise
+ */
+esp_err_t uas_execute_command(msc_device_t *device, uint8_t lun, const uint8_t *cdb, uint8_t cdb_len,
+                              bool data_in, const msc_data_segment_t *segments, size_t segment_count,
+                              scsi_sense_data_t *sense);
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,10 +7,12 @@
 #include "diskio_impl.h"
 #include "ffconf.h"
 #include "ff.h"
+#include <sys/param.h>
 #include "esp_log.h"
 #include "diskio_usb.h"
 #include "msc_scsi_bot.h"
 #include "msc_common.h"
+#include "msc_cache.h"
 #include "usb/usb_types_stack.h"
 
 static usb_disk_t *s_disks[FF_VOLUMES] = { NULL };
@@ -32,13 +34,9 @@ static DRESULT usb_disk_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
     assert(pdrv < FF_VOLUMES);
     assert(s_disks[pdrv]);
 
-    usb_disk_t *disk = s_disks[pdrv];
-    size_t sector_size = disk->block_size;
-    msc_device_t *dev = __containerof(disk, msc_device_t, disk);
-
-    esp_err_t err = scsi_cmd_read10(dev, buff, sector, count, sector_size);
+    esp_err_t err = msc_disk_read(s_disks[pdrv], buff, sector, count);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "scsi_cmd_read10 failed (%d)", err);
+        ESP_LOGE(TAG, "msc_disk_read failed (%d)", err);
         return RES_ERROR;
     }
 
@@ -51,12 +49,12 @@ static DRESULT usb_disk_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT c
     assert(s_disks[pdrv]);
 
     usb_disk_t *disk = s_disks[pdrv];
-    size_t sector_size = disk->block_size;
-    msc_device_t *dev = __containerof(disk, msc_device_t, disk);
-
-    esp_err_t err = scsi_cmd_write10(dev, buff, sector, count, sector_size);
+    if (disk->watch_count && sector < disk->watch_sector + disk->watch_count && sector + count > disk->watch_sector) {
+        disk->watch_writes++;
+    }
+    esp_err_t err = msc_disk_write(disk, buff, sector, count);
     if (err != ESP_OK) {
-        ESP_LOGE(TAG, "scsi_cmd_write10 failed (%d)", err);
+        ESP_LOGE(TAG, "msc_disk_write failed (%d)", err);
         return RES_ERROR;
     }
     return RES_OK;
@@ -71,15 +69,31 @@ static DRESULT usb_disk_ioctl (BYTE pdrv, BYTE cmd, void *buff)
 
     switch (cmd) {
     case CTRL_SYNC:
-        return RES_OK;
+        return msc_disk_sync(disk) == ESP_OK ? RES_OK : RES_ERROR;
     case GET_SECTOR_COUNT:
-        *((DWORD *) buff) = disk->block_count;
+        // Sectors beyond the LBA of FATFS are not accessible
+        *((LBA_t *) buff) = (LBA_t)MIN(disk->block_count, (LBA_t) -1);
         return RES_OK;
     case GET_SECTOR_SIZE:
         *((WORD *) buff) = disk->block_size;
         return RES_OK;
     case GET_BLOCK_SIZE:
-        return RES_ERROR;
+        // FATFS aligns the data area to the erase block, which must be a power of 2 up to 32768
+        *((DWORD *) buff) = (disk->erase_blocks && disk->erase_blocks <= 32768 &&
+                             (disk->erase_blocks & (disk->erase_blocks - 1)) == 0) ? disk->erase_blocks : 1;
+        return RES_OK;
+#if FF_USE_TRIM
+    case CTRL_TRIM: {
+        // Freed clusters are only a hint for the device, nothing is done without UNMAP
+        const LBA_t *range = (const LBA_t *) buff;
+        esp_err_t err = msc_disk_trim(disk, range[0], range[1] - range[0] + 1);
+        if (err != ESP_OK && err != ESP_ERR_NOT_SUPPORTED) {
+            ESP_LOGE(TAG, "msc_disk_trim failed (%d)", err);
+            return RES_ERROR;
+        }
+        return RES_OK;
+    }
+#endif
     }
     return RES_ERROR;
 }
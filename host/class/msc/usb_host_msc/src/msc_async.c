@@ -0,0 +1,198 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "msc_common.h"
+#include "msc_async.h"
+#include "msc_cache.h"
+#include "msc_scsi_bot.h"
+
+static const char *TAG = "USB_MSC_ASYNC";
+
+#define ASYNC_MERGE_MAX (8) // Maximum number of requests merged into one command
+
+typedef enum {
+    MSC_ASYNC_READ,
+    MSC_ASYNC_WRITE,
+    MSC_ASYNC_STOP,
+} msc_async_op_t;
+
+typedef struct {
+    msc_async_op_t op;
+    uint8_t lun;
+    uint64_t sector;
+    uint32_t count;
+    uint8_t *data;
+    msc_host_io_cb_t callback;
+    void *arg;
+} msc_async_request_t;
+
+struct msc_async {
+    QueueHandle_t queue;
+    SemaphoreHandle_t stopped;
+};
+
+/**
+ * @brief Take the queued requests, that continue the batch, with the same operation
+ */
+static size_t async_merge(msc_device_t *device, msc_async_request_t *batch)
+{
+    const uint32_t block_size = device->luns[batch[0].lun].disk.block_size;
+    uint32_t count = batch[0].count;
+    const uint32_t max_count = scsi_max_sectors(device, batch[0].lun, batch[0].sector, block_size);
+    size_t n = 1;
+    msc_async_request_t next;
+
+    while (n < ASYNC_MERGE_MAX && xQueuePeek(device->async->queue, &next, 0) == pdTRUE) {
+        if (next.op != batch[0].op || next.lun != batch[0].lun || next.sector != batch[n - 1].sector + batch[n - 1].count ||
+                (uint64_t)count + next.count > max_count) {
+            break;
+        }
+        xQueueReceive(device->async->queue, &batch[n++], 0);
+        count += next.count;
+    }
+    return n;
+}
+
+static esp_err_t async_execute(msc_device_t *device, const msc_async_request_t *batch, size_t n)
+{
+    usb_disk_t *disk = &device->luns[batch[0].lun].disk;
+    const bool write = batch[0].op == MSC_ASYNC_WRITE;
+
+    if (n == 1) {
+        return write ? msc_disk_write(disk, batch[0].data, batch[0].sector, batch[0].count)
+               : msc_disk_read(disk, batch[0].data, batch[0].sector, batch[0].count);
+    }
+
+    msc_data_segment_t segments[ASYNC_MERGE_MAX];
+    for (size_t i = 0; i < n; i++) {
+        segments[i].data = batch[i].data;
+        segments[i].size = (size_t)batch[i].count * disk->block_size;
+    }
+    return scsi_cmd_rw_segments(device, disk->lun, write, batch[0].sector, segments, n, disk->block_size);
+}
+
+static void async_task(void *arg)
+{
+    msc_device_t *device = (msc_device_t *)arg;
+    msc_async_request_t batch[ASYNC_MERGE_MAX];
+
+    while (xQueueReceive(device->async->queue, &batch[0], portMAX_DELAY) == pdTRUE) {
+        if (batch[0].op == MSC_ASYNC_STOP) {
+            break;
+        }
+        // Merged requests go around the cache, so they are merged only without it
+        const size_t n = device->luns[batch[0].lun].disk.cache ? 1 : async_merge(device, batch);
+        const esp_err_t status = async_execute(device, batch, n);
+        if (status != ESP_OK) {
+            ESP_LOGD(TAG, "Request of %"PRIu32" sectors at %"PRIu64" of LUN %d failed (%d)", batch[0].count,
+                     batch[0].sector, batch[0].lun, status);
+        }
+        for (size_t i = 0; i < n; i++) {
+            batch[i].callback(device, status, batch[i].arg);
+        }
+    }
+
+    xSemaphoreGive(device->async->stopped);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t async_submit(msc_host_device_handle_t handle, msc_async_op_t op, uint8_t lun, uint64_t sector,
+                              uint32_t count, void *data, msc_host_io_cb_t callback, void *arg)
+{
+    MSC_RETURN_ON_INVALID_ARG(handle);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_INVALID_ARG(callback);
+    MSC_RETURN_ON_FALSE(count > 0, ESP_ERR_INVALID_ARG);
+    msc_device_t *device = (msc_device_t *)handle;
+    MSC_RETURN_ON_FALSE(device->async, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(lun < device->lun_count, ESP_ERR_INVALID_ARG);
+
+    const msc_async_request_t request = {
+        .op = op,
+        .lun = lun,
+        .sector = sector,
+        .count = count,
+        .data = data,
+        .callback = callback,
+        .arg = arg,
+    };
+    xQueueSend(device->async->queue, &request, portMAX_DELAY);
+    return ESP_OK;
+}
+
+esp_err_t msc_host_read_async(msc_host_device_handle_t device, uint8_t lun, uint64_t sector, uint32_t count,
+                              void *data, msc_host_io_cb_t callback, void *arg)
+{
+    return async_submit(device, MSC_ASYNC_READ, lun, sector, count, data, callback, arg);
+}
+
+esp_err_t msc_host_write_async(msc_host_device_handle_t device, uint8_t lun, uint64_t sector, uint32_t count,
+                               const void *data, msc_host_io_cb_t callback, void *arg)
+{
+    return async_submit(device, MSC_ASYNC_WRITE, lun, sector, count, (void *)data, callback, arg);
+}
+
+esp_err_t msc_async_install(msc_device_t *device, const msc_host_async_config_t *config)
+{
+    esp_err_t ret;
+
+    if (config->queue_size == 0) {
+        return ESP_OK;
+    }
+    MSC_RETURN_ON_FALSE(config->stack_size != 0, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(config->task_priority != 0, ESP_ERR_INVALID_ARG);
+
+    msc_async_t *async = calloc(1, sizeof(msc_async_t));
+    MSC_RETURN_ON_FALSE(async, ESP_ERR_NO_MEM);
+    MSC_GOTO_ON_FALSE( async->queue = xQueueCreate(config->queue_size, sizeof(msc_async_request_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( async->stopped = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+
+    device->async = async;
+    BaseType_t task_created = xTaskCreatePinnedToCore(async_task, "USB MSC IO", config->stack_size, device,
+                                                      config->task_priority, NULL, config->core_id);
+    MSC_GOTO_ON_FALSE(task_created, ESP_ERR_NO_MEM);
+    return ESP_OK;
+
+fail:
+    device->async = NULL;
+    if (async->queue) {
+        vQueueDelete(async->queue);
+    }
+    if (async->stopped) {
+        vSemaphoreDelete(async->stopped);
+    }
+    free(async);
+    return ret;
+}
+
+void msc_async_uninstall(msc_device_t *device)
+{
+    msc_async_t *async = device->async;
+    if (!async) {
+        return;
+    }
+
+    // Stop request is queued behind the pending ones, they are completed first
+    const msc_async_request_t stop = {
+        .op = MSC_ASYNC_STOP,
+    };
+    xQueueSend(async->queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(async->stopped, portMAX_DELAY);
+
+    device->async = NULL;
+    vQueueDelete(async->queue);
+    vSemaphoreDelete(async->stopped);
+    free(async);
+}
@@ -0,0 +1,120 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "msc_common.h"
+#include "msc_cache.h"
+#include "diskio_usb.h"
+#include "usb/msc_host_bdev.h"
+
+static const char *TAG = "USB_MSC_BDEV";
+
+struct msc_host_bdev {
+    msc_device_t *device;
+    msc_lun_t *lun;
+    usb_disk_t *disk;
+};
+
+static inline bool bdev_in_range(const struct msc_host_bdev *bdev, uint64_t block, uint64_t count)
+{
+    return block <= bdev->disk->block_count && count <= bdev->disk->block_count - block;
+}
+
+esp_err_t msc_host_bdev_open(msc_host_device_handle_t device, uint8_t lun, msc_host_bdev_handle_t *bdev)
+{
+    MSC_RETURN_ON_INVALID_ARG(device);
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    msc_device_t *dev = (msc_device_t *)device;
+    MSC_RETURN_ON_FALSE(lun < dev->lun_count, ESP_ERR_INVALID_ARG);
+    msc_lun_t *l = &dev->luns[lun];
+    // Logical unit without medium, already open or used by FATFS
+    MSC_RETURN_ON_FALSE(l->disk.block_count, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(!l->bdev_open, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(ff_diskio_get_pdrv_disk(&l->disk) == 0xff, ESP_ERR_INVALID_STATE);
+
+    struct msc_host_bdev *b = calloc(1, sizeof(struct msc_host_bdev));
+    MSC_RETURN_ON_FALSE(b, ESP_ERR_NO_MEM);
+    b->device = dev;
+    b->lun = l;
+    b->disk = &l->disk;
+    l->bdev_open = true;
+    *bdev = b;
+    return ESP_OK;
+}
+
+esp_err_t msc_host_bdev_close(msc_host_bdev_handle_t bdev)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    const esp_err_t ret = msc_disk_sync(bdev->disk);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Sync of LUN %u failed (%d)", bdev->disk->lun, ret);
+    }
+    bdev->lun->bdev_open = false;
+    free(bdev);
+    return ret;
+}
+
+esp_err_t msc_host_bdev_get_info(msc_host_bdev_handle_t bdev, msc_host_bdev_info_t *info)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    MSC_RETURN_ON_INVALID_ARG(info);
+    const usb_disk_t *disk = bdev->disk;
+    info->block_size = disk->block_size;
+    info->block_count = disk->block_count;
+    info->erase_blocks = disk->erase_blocks ? disk->erase_blocks : 1;
+    info->max_transfer_blocks = disk->max_transfer_blocks;
+    info->trim = disk->max_unmap_blocks != 0;
+    info->write_cache = disk->write_cache;
+    return ESP_OK;
+}
+
+esp_err_t msc_host_bdev_read(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, void *data)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_FALSE(bdev_in_range(bdev, block, count), ESP_ERR_INVALID_ARG);
+    return msc_disk_read(bdev->disk, data, block, count);
+}
+
+esp_err_t msc_host_bdev_write(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, const void *data)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_FALSE(bdev_in_range(bdev, block, count), ESP_ERR_INVALID_ARG);
+    return msc_disk_write(bdev->disk, data, block, count);
+}
+
+esp_err_t msc_host_bdev_read_async(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, void *data,
+                                   msc_host_io_cb_t callback, void *arg)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    MSC_RETURN_ON_FALSE(bdev_in_range(bdev, block, count), ESP_ERR_INVALID_ARG);
+    return msc_host_read_async(bdev->device, bdev->disk->lun, block, count, data, callback, arg);
+}
+
+esp_err_t msc_host_bdev_write_async(msc_host_bdev_handle_t bdev, uint64_t block, uint32_t count, const void *data,
+                                    msc_host_io_cb_t callback, void *arg)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    MSC_RETURN_ON_FALSE(bdev_in_range(bdev, block, count), ESP_ERR_INVALID_ARG);
+    return msc_host_write_async(bdev->device, bdev->disk->lun, block, count, data, callback, arg);
+}
+
+esp_err_t msc_host_bdev_trim(msc_host_bdev_handle_t bdev, uint64_t block, uint64_t count)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    MSC_RETURN_ON_FALSE(bdev_in_range(bdev, block, count), ESP_ERR_INVALID_ARG);
+    return msc_disk_trim(bdev->disk, block, count);
+}
+
+esp_err_t msc_host_bdev_sync(msc_host_bdev_handle_t bdev)
+{
+    MSC_RETURN_ON_INVALID_ARG(bdev);
+    return msc_disk_sync(bdev->disk);
+}
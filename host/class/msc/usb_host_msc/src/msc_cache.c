@@ -0,0 +1,396 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "msc_common.h"
+#include "msc_cache.h"
+#include "msc_scsi_bot.h"
+
+static const char *TAG = "USB_MSC_CACHE";
+
+#define SENSE_ILLEGAL_REQUEST (0x05)
+#define CACHE_STAGE_SECTORS_MIN (16) // Adjacent dirty sectors written by one command, if read-ahead is smaller
+
+typedef struct {
+    uint64_t sector;
+    uint32_t last_use;      // LRU stamp
+    bool valid;
+    bool dirty;
+} msc_cache_line_t;
+
+struct msc_cache {
+    SemaphoreHandle_t lock;
+    uint8_t *data;          // Sector data of the lines
+    uint8_t *stage;         // Read-ahead and coalesced write-back
+    msc_cache_line_t *lines;
+    size_t line_count;
+    size_t stage_sectors;
+    size_t read_ahead;
+    uint32_t block_size;
+    uint32_t clock;
+    uint64_t next_sector;   // Sector following the last read, to detect sequential reading
+};
+
+static inline uint8_t *line_data(msc_cache_t *cache, const msc_cache_line_t *line)
+{
+    return cache->data + (size_t)(line - cache->lines) * cache->block_size;
+}
+
+static msc_cache_line_t *cache_find(msc_cache_t *cache, uint64_t sector)
+{
+    for (size_t i = 0; i < cache->line_count; i++) {
+        if (cache->lines[i].valid && cache->lines[i].sector == sector) {
+            return &cache->lines[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Write the dirty line and the dirty sectors following it with one command
+ */
+static esp_err_t cache_write_back(usb_disk_t *disk, msc_cache_t *cache, msc_cache_line_t *first)
+{
+    size_t count = 0;
+    for (msc_cache_line_t *line = first; line && line->dirty && count < cache->stage_sectors;
+            line = cache_find(cache, first->sector + count)) {
+        memcpy(cache->stage + count * cache->block_size, line_data(cache, line), cache->block_size);
+        count++;
+    }
+    MSC_RETURN_ON_ERROR( scsi_write_sectors(disk->device, disk->lun, cache->stage, first->sector, count,
+                                            cache->block_size) );
+
+    for (size_t i = 0; i < count; i++) {
+        cache_find(cache, first->sector + i)->dirty = false;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Least recently used line, free lines first
+ */
+static msc_cache_line_t *cache_victim(msc_cache_t *cache, bool evict_dirty)
+{
+    msc_cache_line_t *victim = NULL;
+    for (size_t i = 0; i < cache->line_count; i++) {
+        msc_cache_line_t *line = &cache->lines[i];
+        if (!line->valid) {
+            return line;
+        }
+        if ((evict_dirty || !line->dirty) && (!victim || line->last_use < victim->last_use)) {
+            victim = line;
+        }
+    }
+    return victim;
+}
+
+/**
+ * @brief Get a line for the sector, evicting the least recently used one
+ *
+ * @param[in] evict_dirty Dirty lines may be written back to free a line, it uses the stage buffer
+ * @return ESP_ERR_NOT_FOUND if only dirty lines could be evicted
+ */
+static esp_err_t cache_get_line(usb_disk_t *disk, msc_cache_t *cache, uint64_t sector, bool evict_dirty,
+                                msc_cache_line_t **line)
+{
+    msc_cache_line_t *victim = cache_find(cache, sector);
+    if (!victim) {
+        victim = cache_victim(cache, evict_dirty);
+        if (!victim) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        if (victim->valid && victim->dirty) {
+            MSC_RETURN_ON_ERROR( cache_write_back(disk, cache, victim) );
+        }
+    }
+    victim->sector = sector;
+    victim->valid = true;
+    victim->last_use = ++cache->clock;
+    *line = victim;
+    return ESP_OK;
+}
+
+/**
+ * @brief Insert clean sectors read from the device, cached sectors are newer and kept
+ */
+static esp_err_t cache_fill(usb_disk_t *disk, msc_cache_t *cache, const uint8_t *data, uint64_t sector,
+                            uint32_t count, bool evict_dirty)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        if (cache_find(cache, sector + i)) {
+            continue;
+        }
+        msc_cache_line_t *line;
+        MSC_RETURN_ON_ERROR( cache_get_line(disk, cache, sector + i, evict_dirty, &line) );
+        memcpy(line_data(cache, line), data + (size_t)i * cache->block_size, cache->block_size);
+        line->dirty = false;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t cache_read(usb_disk_t *disk, msc_cache_t *cache, uint8_t *data, uint64_t sector, uint32_t count)
+{
+    const bool sequential = sector == cache->next_sector;
+    const size_t block_size = cache->block_size;
+
+    // Requests larger than the cache bypass it, cached sectors are copied over, as they may be dirty
+    if (count > cache->line_count / 2) {
+        MSC_RETURN_ON_ERROR( scsi_read_sectors(disk->device, disk->lun, data, sector, count, block_size) );
+        for (uint32_t i = 0; i < count; i++) {
+            msc_cache_line_t *line = cache_find(cache, sector + i);
+            if (line) {
+                memcpy(data + (size_t)i * block_size, line_data(cache, line), block_size);
+            }
+        }
+        cache->next_sector = sector + count;
+        return ESP_OK;
+    }
+
+    uint32_t i = 0;
+    while (i < count) {
+        msc_cache_line_t *line = cache_find(cache, sector + i);
+        if (line) {
+            line->last_use = ++cache->clock;
+            memcpy(data + (size_t)i * block_size, line_data(cache, line), block_size);
+            i++;
+            continue;
+        }
+        // Sectors missing in a row are read by one command
+        uint32_t run = 1;
+        while (i + run < count && !cache_find(cache, sector + i + run)) {
+            run++;
+        }
+        MSC_RETURN_ON_ERROR( scsi_read_sectors(disk->device, disk->lun, data + (size_t)i * block_size, sector + i, run,
+                                               block_size) );
+        MSC_RETURN_ON_ERROR( cache_fill(disk, cache, data + (size_t)i * block_size, sector + i, run, true) );
+        i += run;
+    }
+
+    const uint64_t end = sector + count;
+    if (sequential && cache->read_ahead && !cache_find(cache, end) && end < disk->block_count) {
+        const uint32_t ahead = (uint32_t)MIN(cache->read_ahead, disk->block_count - end);
+        // Failed read-ahead is not an error of this request. Dirty lines are kept, the stage holds the sectors read.
+        if (scsi_read_sectors(disk->device, disk->lun, cache->stage, end, ahead, block_size) == ESP_OK) {
+            cache_fill(disk, cache, cache->stage, end, ahead, false);
+        }
+    }
+    cache->next_sector = end;
+    return ESP_OK;
+}
+
+static esp_err_t cache_write(usb_disk_t *disk, msc_cache_t *cache, const uint8_t *data, uint64_t sector,
+                             uint32_t count)
+{
+    const size_t block_size = cache->block_size;
+
+    // Large writes go directly to the device, cached copies are updated
+    if (count > cache->line_count / 2) {
+        MSC_RETURN_ON_ERROR( scsi_write_sectors(disk->device, disk->lun, data, sector, count, block_size) );
+        for (uint32_t i = 0; i < count; i++) {
+            msc_cache_line_t *line = cache_find(cache, sector + i);
+            if (line) {
+                memcpy(line_data(cache, line), data + (size_t)i * block_size, block_size);
+                line->dirty = false;
+            }
+        }
+        return ESP_OK;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        msc_cache_line_t *line;
+        MSC_RETURN_ON_ERROR( cache_get_line(disk, cache, sector + i, true, &line) );
+        memcpy(line_data(cache, line), data + (size_t)i * block_size, block_size);
+        line->dirty = true;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t cache_sync(usb_disk_t *disk, msc_cache_t *cache)
+{
+    while (true) {
+        // Write back from the lowest sector, so adjacent dirty sectors go in one command
+        msc_cache_line_t *first = NULL;
+        for (size_t i = 0; i < cache->line_count; i++) {
+            msc_cache_line_t *line = &cache->lines[i];
+            if (line->valid && line->dirty && (!first || line->sector < first->sector)) {
+                first = line;
+            }
+        }
+        if (!first) {
+            return ESP_OK;
+        }
+        MSC_RETURN_ON_ERROR( cache_write_back(disk, cache, first) );
+    }
+}
+
+/**
+ * @brief Drop the cached sectors of the range, including dirty ones, their data are released
+ */
+static void cache_discard(msc_cache_t *cache, uint64_t sector, uint64_t count)
+{
+    for (size_t i = 0; i < cache->line_count; i++) {
+        msc_cache_line_t *line = &cache->lines[i];
+        if (line->valid && line->sector >= sector && line->sector - sector < count) {
+            line->valid = false;
+            line->dirty = false;
+        }
+    }
+    if (cache->next_sector >= sector && cache->next_sector - sector < count) {
+        cache->next_sector = UINT64_MAX;
+    }
+}
+
+static esp_err_t disk_unmap(usb_disk_t *disk, uint64_t sector, uint64_t count)
+{
+    while (count) {
+        const uint32_t n = (uint32_t)MIN(count, disk->max_unmap_blocks);
+        MSC_RETURN_ON_ERROR( scsi_cmd_unmap(disk->device, disk->lun, sector, n) );
+        sector += n;
+        count -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t msc_cache_install(usb_disk_t *disk, const msc_host_cache_config_t *config)
+{
+    esp_err_t ret;
+
+    if (config->sectors == 0) {
+        return ESP_OK;
+    }
+
+    const uint32_t caps = config->heap_caps ? config->heap_caps : MALLOC_CAP_DEFAULT;
+    const uint32_t block_size = disk->block_size;
+    msc_cache_t *cache = calloc(1, sizeof(msc_cache_t));
+    MSC_RETURN_ON_FALSE(cache, ESP_ERR_NO_MEM);
+
+    cache->line_count = config->sectors;
+    cache->read_ahead = MIN(config->read_ahead, config->sectors / 2);
+    cache->stage_sectors = MAX(cache->read_ahead, CACHE_STAGE_SECTORS_MIN);
+    cache->block_size = block_size;
+    cache->next_sector = UINT64_MAX;
+
+    MSC_GOTO_ON_FALSE( cache->lock = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( cache->lines = calloc(cache->line_count, sizeof(msc_cache_line_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( cache->data = heap_caps_malloc(cache->line_count * block_size, caps), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( cache->stage = heap_caps_malloc(cache->stage_sectors * block_size, caps), ESP_ERR_NO_MEM );
+
+    disk->cache = cache;
+    return ESP_OK;
+
+fail:
+    if (cache->lock) {
+        vSemaphoreDelete(cache->lock);
+    }
+    free(cache->lines);
+    heap_caps_free(cache->data);
+    free(cache);
+    return ret;
+}
+
+void msc_cache_uninstall(usb_disk_t *disk)
+{
+    msc_cache_t *cache = disk->cache;
+    if (!cache) {
+        return;
+    }
+    disk->cache = NULL;
+    vSemaphoreDelete(cache->lock);
+    free(cache->lines);
+    heap_caps_free(cache->data);
+    heap_caps_free(cache->stage);
+    free(cache);
+}
+
+esp_err_t msc_disk_read(usb_disk_t *disk, uint8_t *data, uint64_t sector, uint32_t count)
+{
+    msc_cache_t *cache = disk->cache;
+    if (!cache) {
+        return scsi_read_sectors(disk->device, disk->lun, data, sector, count, disk->block_size);
+    }
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    esp_err_t ret = cache_read(disk, cache, data, sector, count);
+    xSemaphoreGive(cache->lock);
+    return ret;
+}
+
+esp_err_t msc_disk_write(usb_disk_t *disk, const uint8_t *data, uint64_t sector, uint32_t count)
+{
+    msc_cache_t *cache = disk->cache;
+    if (!cache) {
+        return scsi_write_sectors(disk->device, disk->lun, data, sector, count, disk->block_size);
+    }
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    esp_err_t ret = cache_write(disk, cache, data, sector, count);
+    xSemaphoreGive(cache->lock);
+    return ret;
+}
+
+/**
+ * @brief Flush the volatile write cache of the device
+ *
+ * Devices rejecting SYNCHRONIZE CACHE by ILLEGAL REQUEST are not asked again
+ */
+static esp_err_t disk_sync_cache(usb_disk_t *disk)
+{
+    if (!disk->write_cache) {
+        return ESP_OK;
+    }
+    esp_err_t ret = scsi_cmd_sync_cache(disk->device, disk->lun);
+    scsi_sense_data_t sense;
+    if (ret == ESP_FAIL && scsi_cmd_sense(disk->device, disk->lun, &sense) == ESP_OK &&
+            sense.key == SENSE_ILLEGAL_REQUEST) {
+        ESP_LOGW(TAG, "LUN %d does not support SYNCHRONIZE CACHE", disk->lun);
+        disk->write_cache = false;
+        ret = ESP_OK;
+    }
+    return ret;
+}
+
+esp_err_t msc_disk_sync(usb_disk_t *disk)
+{
+    msc_cache_t *cache = disk->cache;
+    if (!cache) {
+        return disk_sync_cache(disk);
+    }
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    esp_err_t ret = cache_sync(disk, cache);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Write back of cached sectors failed");
+    } else {
+        ret = disk_sync_cache(disk);
+    }
+    xSemaphoreGive(cache->lock);
+    return ret;
+}
+
+esp_err_t msc_disk_trim(usb_disk_t *disk, uint64_t sector, uint64_t count)
+{
+    if (disk->max_unmap_blocks == 0) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    msc_cache_t *cache = disk->cache;
+    if (!cache) {
+        return disk_unmap(disk, sector, count);
+    }
+
+    xSemaphoreTake(cache->lock, portMAX_DELAY);
+    cache_discard(cache, sector, count);
+    esp_err_t ret = disk_unmap(disk, sector, count);
+    xSemaphoreGive(cache->lock);
+    return ret;
+}
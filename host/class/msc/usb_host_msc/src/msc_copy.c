@@ -0,0 +1,328 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "msc_common.h"
+#include "msc_cache.h"
+#include "usb/msc_host_copy.h"
+
+static const char *TAG = "USB_MSC_COPY";
+
+#define COPY_BUFFERS            (2)             // Read into one buffer, while the other one is written
+#define COPY_CHUNK_DEFAULT      (64 * 1024)
+#define COPY_STACK_DEFAULT      (4096)
+#define COPY_ALIGN              (64)            // Cache line of DMA capable memory
+
+typedef struct {
+    uint8_t *data;
+    size_t size;                    // Bytes to be written, NULL data ends the writer task
+} copy_buf_t;
+
+typedef struct copy copy_t;
+
+/**
+ * @brief Copy in progress
+ *
+ * read and write access the next bytes of the source and the destination, sector or file copy keeps its own position.
+ */
+struct copy {
+    esp_err_t (*read)(copy_t *copy, uint8_t *data, size_t size);
+    esp_err_t (*write)(copy_t *copy, const uint8_t *data, size_t size);
+    uint64_t total;                 // Bytes of the copy
+    QueueHandle_t free_bufs;        // Buffers to be read into
+    QueueHandle_t full_bufs;        // Buffers to be written by the writer task
+    SemaphoreHandle_t done;         // Given by the writer task, when it ends
+    volatile esp_err_t write_err;   // First failed write, the following buffers are not written
+    volatile uint64_t written;      // Bytes written to the destination
+    // Sector copy
+    const msc_host_copy_media_t *src;
+    const msc_host_copy_media_t *dst;
+    uint64_t src_sector;
+    uint64_t dst_sector;
+    uint32_t sector_size;
+    // File copy
+    int src_fd;
+    int dst_fd;
+    msc_host_stream_handle_t stream; // Destination on an MSC logical unit, NULL for dst_fd
+};
+
+static void copy_writer_task(void *arg)
+{
+    copy_t *copy = (copy_t *)arg;
+    copy_buf_t buf;
+
+    while (xQueueReceive(copy->full_bufs, &buf, portMAX_DELAY) == pdTRUE && buf.data) {
+        if (copy->write_err == ESP_OK) {
+            const esp_err_t err = copy->write(copy, buf.data, buf.size);
+            if (err != ESP_OK) {
+                copy->write_err = err;
+            } else {
+                copy->written += buf.size;
+            }
+        }
+        xQueueSend(copy->free_bufs, &buf, portMAX_DELAY);
+    }
+    xSemaphoreGive(copy->done);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Copy total bytes by read and write of the copy, double-buffered
+ */
+static esp_err_t copy_run(copy_t *copy, const msc_host_copy_config_t *config)
+{
+    esp_err_t ret = ESP_OK;
+    const size_t chunk = config->chunk_size ? config->chunk_size : COPY_CHUNK_DEFAULT;
+    const uint32_t caps = config->heap_caps ? config->heap_caps : MALLOC_CAP_DMA;
+    const size_t stack_size = config->stack_size ? config->stack_size : COPY_STACK_DEFAULT;
+    const unsigned priority = config->task_priority ? config->task_priority : uxTaskPriorityGet(NULL);
+    uint8_t *data[COPY_BUFFERS] = { NULL };
+    bool writer_started = false;
+
+    // The queue of full buffers holds the end of the copy too
+    MSC_GOTO_ON_FALSE( copy->free_bufs = xQueueCreate(COPY_BUFFERS, sizeof(copy_buf_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( copy->full_bufs = xQueueCreate(COPY_BUFFERS + 1, sizeof(copy_buf_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( copy->done = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+    for (int i = 0; i < COPY_BUFFERS; i++) {
+        MSC_GOTO_ON_FALSE( data[i] = heap_caps_aligned_alloc(COPY_ALIGN, chunk, caps), ESP_ERR_NO_MEM );
+        const copy_buf_t buf = { .data = data[i] };
+        xQueueSend(copy->free_bufs, &buf, 0);
+    }
+    MSC_GOTO_ON_FALSE( xTaskCreate(copy_writer_task, "USB MSC copy", stack_size, copy, priority, NULL), ESP_ERR_NO_MEM );
+    writer_started = true;
+
+    for (uint64_t offset = 0; offset < copy->total; ) {
+        copy_buf_t buf;
+        xQueueReceive(copy->free_bufs, &buf, portMAX_DELAY);
+        if (copy->write_err != ESP_OK) {
+            break;
+        }
+        if (config->progress_cb && !config->progress_cb(copy->written, copy->total, config->progress_arg)) {
+            ret = ESP_ERR_INVALID_STATE;
+            break;
+        }
+        buf.size = MIN(chunk, copy->total - offset);
+        MSC_GOTO_ON_ERROR( copy->read(copy, buf.data, buf.size) );
+        xQueueSend(copy->full_bufs, &buf, portMAX_DELAY);
+        offset += buf.size;
+    }
+
+fail:
+    if (writer_started) {
+        const copy_buf_t end = { .data = NULL };
+        xQueueSend(copy->full_bufs, &end, portMAX_DELAY);
+        xSemaphoreTake(copy->done, portMAX_DELAY);
+        if (ret == ESP_OK) {
+            ret = copy->write_err;
+        }
+    }
+    if (ret == ESP_OK && config->progress_cb) {
+        config->progress_cb(copy->written, copy->total, config->progress_arg);
+    }
+    for (int i = 0; i < COPY_BUFFERS; i++) {
+        heap_caps_free(data[i]);
+    }
+    if (copy->done) {
+        vSemaphoreDelete(copy->done);
+    }
+    if (copy->full_bufs) {
+        vQueueDelete(copy->full_bufs);
+    }
+    if (copy->free_bufs) {
+        vQueueDelete(copy->free_bufs);
+    }
+    return ret;
+}
+
+static esp_err_t media_sector_size(const msc_host_copy_media_t *media, uint64_t sector, uint64_t count,
+                                   uint32_t *sector_size)
+{
+    if (!media->device) {
+        MSC_RETURN_ON_FALSE(media->read && media->write && media->sector_size, ESP_ERR_INVALID_ARG);
+        *sector_size = media->sector_size;
+        return ESP_OK;
+    }
+    msc_host_lun_info_t info;
+    MSC_RETURN_ON_ERROR( msc_host_get_lun_info(media->device, media->lun, &info) );
+    MSC_RETURN_ON_FALSE(info.sector_count, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(sector <= info.sector_count && count <= info.sector_count - sector, ESP_ERR_INVALID_ARG);
+    *sector_size = info.sector_size;
+    return ESP_OK;
+}
+
+static esp_err_t copy_sectors_read(copy_t *copy, uint8_t *data, size_t size)
+{
+    const uint32_t count = size / copy->sector_size;
+    const msc_host_copy_media_t *src = copy->src;
+    esp_err_t ret;
+    if (src->device) {
+        ret = msc_disk_read(&src->device->luns[src->lun].disk, data, copy->src_sector, count);
+    } else {
+        ret = src->read(src->ctx, copy->src_sector, count, data);
+    }
+    copy->src_sector += count;
+    return ret;
+}
+
+static esp_err_t copy_sectors_write(copy_t *copy, const uint8_t *data, size_t size)
+{
+    const uint32_t count = size / copy->sector_size;
+    const msc_host_copy_media_t *dst = copy->dst;
+    esp_err_t ret;
+    if (dst->device) {
+        ret = msc_disk_write(&dst->device->luns[dst->lun].disk, data, copy->dst_sector, count);
+    } else {
+        ret = dst->write(dst->ctx, copy->dst_sector, count, data);
+    }
+    copy->dst_sector += count;
+    return ret;
+}
+
+esp_err_t msc_host_copy_sectors(const msc_host_copy_config_t *config,
+                                const msc_host_copy_media_t *src, uint64_t src_sector,
+                                const msc_host_copy_media_t *dst, uint64_t dst_sector,
+                                uint64_t count)
+{
+    MSC_RETURN_ON_INVALID_ARG(src);
+    MSC_RETURN_ON_INVALID_ARG(dst);
+    const msc_host_copy_config_t default_config = { 0 };
+    if (!config) {
+        config = &default_config;
+    }
+
+    uint32_t src_size, dst_size;
+    MSC_RETURN_ON_ERROR( media_sector_size(src, src_sector, count, &src_size) );
+    MSC_RETURN_ON_ERROR( media_sector_size(dst, dst_sector, count, &dst_size) );
+    MSC_RETURN_ON_FALSE(src_size == dst_size, ESP_ERR_INVALID_SIZE);
+    MSC_RETURN_ON_FALSE(config->chunk_size % src_size == 0, ESP_ERR_INVALID_SIZE);
+    MSC_RETURN_ON_FALSE(count <= UINT64_MAX / src_size, ESP_ERR_INVALID_ARG);
+
+    copy_t copy = {
+        .read = copy_sectors_read,
+        .write = copy_sectors_write,
+        .total = count * src_size,
+        .src = src,
+        .dst = dst,
+        .src_sector = src_sector,
+        .dst_sector = dst_sector,
+        .sector_size = src_size,
+    };
+    esp_err_t ret = copy_run(&copy, config);
+    // Written sectors held by the sector cache go to the device before the copy returns
+    if (ret == ESP_OK && dst->device) {
+        ret = msc_disk_sync(&dst->device->luns[dst->lun].disk);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Copy of %"PRIu64" sectors failed after %"PRIu64" bytes", count, copy.written);
+    }
+    return ret;
+}
+
+static esp_err_t copy_file_read(copy_t *copy, uint8_t *data, size_t size)
+{
+    while (size) {
+        const ssize_t n = read(copy->src_fd, data, size);
+        MSC_RETURN_ON_FALSE(n > 0, ESP_FAIL);
+        data += n;
+        size -= n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t copy_file_write(copy_t *copy, const uint8_t *data, size_t size)
+{
+    if (copy->stream) {
+        return msc_host_vfs_stream_write(copy->stream, data, size);
+    }
+    while (size) {
+        const ssize_t n = write(copy->dst_fd, data, size);
+        MSC_RETURN_ON_FALSE(n > 0, ESP_FAIL);
+        data += n;
+        size -= n;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Create the destination with its clusters allocated, so they are not added one by one while writing
+ */
+static esp_err_t copy_file_create(copy_t *copy, const char *dst_path, msc_host_vfs_handle_t dst_vfs)
+{
+    if (dst_vfs && copy->total) {
+        const esp_err_t err = msc_host_vfs_stream_open(dst_vfs, dst_path, copy->total, &copy->stream);
+        if (err != ESP_ERR_NOT_SUPPORTED) {
+            return err;
+        }
+    }
+    copy->dst_fd = open(dst_path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    MSC_RETURN_ON_FALSE(copy->dst_fd >= 0, ESP_FAIL);
+    if (copy->total) {
+        const uint8_t last = 0;
+        MSC_RETURN_ON_FALSE(lseek(copy->dst_fd, (off_t)(copy->total - 1), SEEK_SET) >= 0 &&
+                            write(copy->dst_fd, &last, 1) == 1 &&
+                            lseek(copy->dst_fd, 0, SEEK_SET) == 0, ESP_FAIL);
+    }
+    return ESP_OK;
+}
+
+esp_err_t msc_host_copy_file(const msc_host_copy_config_t *config, const char *src_path, const char *dst_path,
+                             msc_host_vfs_handle_t dst_vfs)
+{
+    MSC_RETURN_ON_INVALID_ARG(src_path);
+    MSC_RETURN_ON_INVALID_ARG(dst_path);
+    const msc_host_copy_config_t default_config = { 0 };
+    if (!config) {
+        config = &default_config;
+    }
+
+    esp_err_t ret = ESP_OK;
+    copy_t copy = {
+        .read = copy_file_read,
+        .write = copy_file_write,
+        .src_fd = open(src_path, O_RDONLY),
+        .dst_fd = -1,
+    };
+    MSC_RETURN_ON_FALSE(copy.src_fd >= 0, ESP_ERR_NOT_FOUND);
+    struct stat st;
+    MSC_GOTO_ON_FALSE(fstat(copy.src_fd, &st) == 0 && st.st_size >= 0, ESP_FAIL);
+    copy.total = st.st_size;
+
+    ret = copy_file_create(&copy, dst_path, dst_vfs);
+    if (ret == ESP_OK) {
+        ret = copy_run(&copy, config);
+    } else {
+        ESP_LOGE(TAG, "%s of %"PRIu64" bytes not created", dst_path, copy.total);
+    }
+    if (copy.stream && msc_host_vfs_stream_close(copy.stream) != ESP_OK && ret == ESP_OK) {
+        ret = ESP_FAIL;
+    }
+    if (copy.dst_fd >= 0) {
+        const bool synced = fsync(copy.dst_fd) == 0;
+        if ((close(copy.dst_fd) != 0 || !synced) && ret == ESP_OK) {
+            ret = ESP_FAIL;
+        }
+    }
+    if (ret != ESP_OK) {
+        unlink(dst_path);
+    }
+
+fail:
+    close(copy.src_fd);
+    return ret;
+}
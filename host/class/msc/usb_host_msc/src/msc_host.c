@@ -13,23 +13,60 @@
 #include <sys/param.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "usb/usb_host.h"
+#include "usb/usb_host_xfer_pool_weak.h"
 #include "diskio_usb.h"
 #include "msc_common.h"
 #include "usb/msc_host.h"
 #include "msc_scsi_bot.h"
+#include "msc_cache.h"
+#include "msc_async.h"
+#include "msc_sched.h"
+#include "msc_uas.h"
 #include "usb/usb_types_ch9.h"
 #include "usb/usb_helpers.h"
 #include "soc/soc_memory_layout.h"
+#include "soc/soc_caps.h"
+
+// Alignment of caller buffers for zero-copy transfers. On targets with cache, the buffers must own whole cache lines
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+#define MSC_DMA_BUFFER_ALIGN    CONFIG_CACHE_L1_CACHE_LINE_SIZE
+#else
+#define MSC_DMA_BUFFER_ALIGN    4
+#endif
+
+/**
+ * @brief Writable view of the data buffer of usb_transfer_t
+ *
+ * data_buffer and data_buffer_size are the first members of usb_transfer_t, constant in its public definition.
+ */
+typedef struct {
+    uint8_t *data_buffer;
+    size_t data_buffer_size;
+} msc_transfer_buffer_t;
+
+// Optional enumeration profiler, marks are made only if the usb_host_enum_profiler component is linked
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase) __attribute__((weak));
+#define MSC_ENUM_MARK(addr, phase)                               \
+    do {                                                         \
+        if (usb_host_enum_profiler_mark) {                       \
+            usb_host_enum_profiler_mark((addr), "msc", (phase)); \
+        }                                                        \
+    } while(0)
 
 // MSC driver spin lock
 static portMUX_TYPE msc_lock = portMUX_INITIALIZER_UNLOCKED;
 #define MSC_ENTER_CRITICAL()    portENTER_CRITICAL(&msc_lock)
 #define MSC_EXIT_CRITICAL()     portEXIT_CRITICAL(&msc_lock)
 
+// Device spinlock, for the state of pipelined transfers of one device
+#define MSC_DEVICE_ENTER_CRITICAL(dev) portENTER_CRITICAL(&(dev)->lock)
+#define MSC_DEVICE_EXIT_CRITICAL(dev)  portEXIT_CRITICAL(&(dev)->lock)
+
 #define MSC_GOTO_ON_FALSE_CRITICAL(exp, err)    \
     do {                                        \
         if(!(exp)) {                            \
@@ -80,12 +117,22 @@ static portMUX_TYPE msc_lock = portMUX_INITIALIZER_UNLOCKED;
 })
 
 #define DEFAULT_XFER_SIZE   (64) // Transfer size used for all transfers apart from SCSI read/write
+#define DEFAULT_MAX_IO_SIZE (4096) // Size of the data transfer, if not configured
 #define WAIT_FOR_READY_TIMEOUT_MS 5000
+#define READY_POLL_DELAY_MIN_MS (10) // First delay of TEST UNIT READY polling, doubled after each poll
+#define READY_POLL_DELAY_MAX_MS (500)
+#define READY_POLL_STACK_SIZE (4096)
+#define DEFAULT_TIMEOUT_MS  (5000) // Maximum timeout of a command, if not configured
+#define TIMEOUT_MARGIN      (8) // Timeout is a multiple of the expected duration of the command
+#define TIMEOUT_SLACK_MS    (1000) // Added to the timeout, flash drives pause for internal erase
+#define TIMEOUT_MIN_DATA_SIZE (4096) // Commands with less data measure the latency, not the throughput
 #define SCSI_COMMAND_SET    0x06
 #define BULK_ONLY_TRANSFER  0x50
+#define USB_ATTACHED_SCSI   0x62
 #define MSC_NO_SENSE        0x00
 #define MSC_NOT_READY       0x02
 #define MSC_UNIT_ATTENTION  0x06
+#define MSC_ASC_MEDIUM_NOT_PRESENT 0x3A
 
 static const char *TAG = "USB_MSC";
 typedef struct {
@@ -95,6 +142,12 @@ typedef struct {
     SemaphoreHandle_t all_events_handled;
     volatile bool end_client_event_handling;
     bool event_handling_started;
+    size_t max_io_size;
+    msc_host_cache_config_t cache_config;
+    msc_host_async_config_t async_config;
+    uint32_t timeout_ms;
+    uint32_t stall_notify_ms;
+    bool enable_write_cache;
     STAILQ_HEAD(devices, msc_host_device) devices_tailq;
 } msc_driver_t;
 
@@ -116,7 +169,15 @@ static inline bool is_in_endpoint(uint8_t endpoint)
     return endpoint & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK ? true : false;
 }
 
-static const usb_intf_desc_t *find_msc_interface(const usb_config_desc_t *config_desc, size_t *offset)
+/**
+ * @brief Find mass storage interface of the protocol
+ *
+ * @param[in]    config_desc Configuration descriptor
+ * @param[inout] offset      Offset of the interface descriptor
+ * @param[in]    protocol    BULK_ONLY_TRANSFER or USB_ATTACHED_SCSI
+ */
+static const usb_intf_desc_t *find_msc_interface_protocol(const usb_config_desc_t *config_desc, size_t *offset,
+                                                          uint8_t protocol)
 {
     size_t total_length = config_desc->wTotalLength;
     const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)config_desc;
@@ -129,7 +190,7 @@ static const usb_intf_desc_t *find_msc_interface(const usb_config_desc_t *config
 
         if ( ifc_desc->bInterfaceClass == USB_CLASS_MASS_STORAGE &&
                 ifc_desc->bInterfaceSubClass == SCSI_COMMAND_SET &&
-                ifc_desc->bInterfaceProtocol == BULK_ONLY_TRANSFER ) {
+                ifc_desc->bInterfaceProtocol == protocol ) {
             return ifc_desc;
         }
 
@@ -138,6 +199,20 @@ static const usb_intf_desc_t *find_msc_interface(const usb_config_desc_t *config
     return NULL;
 }
 
+/**
+ * @brief Find mass storage interface, UAS is preferred over BOT
+ */
+static const usb_intf_desc_t *find_msc_interface(const usb_config_desc_t *config_desc, size_t *offset)
+{
+    const size_t start = *offset;
+    const usb_intf_desc_t *ifc_desc = find_msc_interface_protocol(config_desc, offset, USB_ATTACHED_SCSI);
+    if (ifc_desc) {
+        return ifc_desc;
+    }
+    *offset = start;
+    return find_msc_interface_protocol(config_desc, offset, BULK_ONLY_TRANSFER);
+}
+
 esp_err_t clear_feature(msc_device_t *device, uint8_t endpoint)
 {
     usb_device_handle_t dev = device->handle;
@@ -186,15 +261,13 @@ static esp_err_t msc_mass_reset(msc_host_device_handle_t dev)
  *
  * If the device implements 3 LUNs, the returned value is 2. (LUN0, LUN1, LUN2).
  *
- * This driver does not support multiple LUNs yet.
- *
  * @see USB Mass Storage Class – Bulk Only Transport, Chapter 3.2
  *
  * @param[in]  dev MSC device handle
  * @param[out] lun Maximum Logical Unit Number
  * @return esp_err_t
  */
-__attribute__((unused)) static esp_err_t msc_get_max_lun(msc_host_device_handle_t dev, uint8_t *lun)
+static esp_err_t msc_get_max_lun(msc_host_device_handle_t dev, uint8_t *lun)
 {
     msc_device_t *device = (msc_device_t *)dev;
     usb_transfer_t *xfer = device->xfer;
@@ -207,6 +280,55 @@ __attribute__((unused)) static esp_err_t msc_get_max_lun(msc_host_device_handle_
     return ESP_OK;
 }
 
+/**
+ * @brief Assign UAS pipes by Pipe Usage descriptors, which follow the endpoint descriptors
+ *
+ * @see Universal Serial Bus Attached SCSI (UAS), Revision 1.0, Chapter 5.3.3
+ */
+static esp_err_t extract_uas_pipes(const usb_config_desc_t *cfg_desc, const usb_intf_desc_t *ifc_desc,
+                                   size_t offset, msc_config_t *cfg)
+{
+    const size_t total_len = cfg_desc->wTotalLength;
+    const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)ifc_desc;
+    const usb_ep_desc_t *ep_desc = NULL;
+    int pipes = 0;
+
+    while ((next_desc = usb_parse_next_descriptor(next_desc, total_len, (int *)&offset)) != NULL &&
+            next_desc->bDescriptorType != USB_B_DESCRIPTOR_TYPE_INTERFACE) {
+        if (next_desc->bDescriptorType == USB_B_DESCRIPTOR_TYPE_ENDPOINT) {
+            ep_desc = (const usb_ep_desc_t *)next_desc;
+            continue;
+        }
+        if (next_desc->bDescriptorType != UAS_DESC_TYPE_PIPE_USAGE || !ep_desc) {
+            continue;
+        }
+        switch (next_desc->val[UAS_PIPE_USAGE_PIPE_ID_OFFSET]) {
+        case UAS_PIPE_ID_COMMAND:
+            cfg->uas_cmd_ep = ep_desc->bEndpointAddress;
+            break;
+        case UAS_PIPE_ID_STATUS:
+            cfg->uas_status_ep = ep_desc->bEndpointAddress;
+            break;
+        case UAS_PIPE_ID_DATA_IN:
+            cfg->bulk_in_ep = ep_desc->bEndpointAddress;
+            cfg->bulk_in_mps = ep_desc->wMaxPacketSize;
+            break;
+        case UAS_PIPE_ID_DATA_OUT:
+            cfg->bulk_out_ep = ep_desc->bEndpointAddress;
+            break;
+        default:
+            continue;
+        }
+        pipes++;
+        ep_desc = NULL;
+    }
+
+    MSC_RETURN_ON_FALSE(pipes == UAS_PIPE_COUNT, ESP_ERR_NOT_SUPPORTED);
+    cfg->uas = true;
+    cfg->alt_setting = ifc_desc->bAlternateSetting;
+    return ESP_OK;
+}
+
 /**
  * @brief Extracts configuration from configuration descriptor.
  *
@@ -229,6 +351,19 @@ static esp_err_t extract_config_from_descriptor(const usb_config_desc_t *cfg_des
 
     cfg->iface_num = ifc_desc->bInterfaceNumber;
 
+    if (ifc_desc->bInterfaceProtocol == USB_ATTACHED_SCSI) {
+        if (extract_uas_pipes(cfg_desc, ifc_desc, offset, cfg) == ESP_OK) {
+            return ESP_OK;
+        }
+        // Fall back to BOT alternate setting of the interface
+        ESP_LOGW(TAG, "UAS pipes not found, using BOT");
+        offset = 0;
+        ifc_desc = find_msc_interface_protocol(cfg_desc, &offset, BULK_ONLY_TRANSFER);
+        MSC_RETURN_ON_FALSE(ifc_desc, ESP_ERR_NOT_SUPPORTED);
+        next_desc = (const usb_standard_desc_t *)ifc_desc;
+        cfg->iface_num = ifc_desc->bInterfaceNumber;
+    }
+
     next_desc = next_endpoint_desc(next_desc, total_len, &offset);
     MSC_RETURN_ON_FALSE(next_desc, ESP_ERR_NOT_SUPPORTED);
     ep_desc = (const usb_ep_desc_t *)next_desc;
@@ -254,6 +389,22 @@ static esp_err_t extract_config_from_descriptor(const usb_config_desc_t *cfg_des
     return ESP_OK;
 }
 
+static void msc_ready_poll_stop(msc_device_t *device)
+{
+    if (device->ready_task) {
+        device->ready_stop = true;
+        xSemaphoreGive(device->ready_wake);
+        xSemaphoreTake(device->ready_done, portMAX_DELAY);
+        device->ready_task = NULL;
+    }
+    if (device->ready_wake) {
+        vSemaphoreDelete(device->ready_wake);
+    }
+    if (device->ready_done) {
+        vSemaphoreDelete(device->ready_done);
+    }
+}
+
 static esp_err_t msc_deinit_device(msc_device_t *dev, bool install_failed)
 {
     MSC_ENTER_CRITICAL();
@@ -261,48 +412,239 @@ static esp_err_t msc_deinit_device(msc_device_t *dev, bool install_failed)
     STAILQ_REMOVE(&s_msc_driver->devices_tailq, dev, msc_host_device, tailq_entry);
     MSC_EXIT_CRITICAL();
 
+    // Commands of the polling are done before the logical units are released
+    msc_ready_poll_stop(dev);
+    // Queued requests are completed before the cache is written back
+    msc_sched_remove_device(dev);
+    msc_async_uninstall(dev);
+    for (uint8_t lun = 0; lun < dev->lun_count; lun++) {
+        usb_disk_t *disk = &dev->luns[lun].disk;
+        if (!install_failed && msc_disk_sync(disk) != ESP_OK) {
+            ESP_LOGW(TAG, "Cached sectors of LUN %d were not written, device disconnected?", lun);
+        }
+        msc_cache_uninstall(disk);
+        if (dev->luns[lun].cmd_turn) {
+            vSemaphoreDelete(dev->luns[lun].cmd_turn);
+        }
+    }
+    free(dev->luns);
+
     if (dev->transfer_done) {
         vSemaphoreDelete(dev->transfer_done);
     }
+    if (dev->cmd_lock) {
+        vSemaphoreDelete(dev->cmd_lock);
+    }
     if (install_failed) {
         // Error code is unchecked, as it's unknown at what point installation failed.
         usb_host_interface_release(s_msc_driver->client_handle, dev->handle, dev->config.iface_num);
         usb_host_device_close(s_msc_driver->client_handle, dev->handle);
-        usb_host_transfer_free(dev->xfer);
+        USB_HOST_XFER_POOL_FREE(dev->xfer);
+        USB_HOST_XFER_POOL_FREE(dev->cbw_xfer);
+        USB_HOST_XFER_POOL_FREE(dev->csw_xfer);
     } else {
         MSC_RETURN_ON_ERROR( usb_host_interface_release(s_msc_driver->client_handle, dev->handle, dev->config.iface_num) );
         MSC_RETURN_ON_ERROR( usb_host_device_close(s_msc_driver->client_handle, dev->handle) );
-        MSC_RETURN_ON_ERROR( usb_host_transfer_free(dev->xfer) );
+        MSC_RETURN_ON_ERROR( USB_HOST_XFER_POOL_FREE(dev->xfer) );
+        MSC_RETURN_ON_ERROR( USB_HOST_XFER_POOL_FREE(dev->cbw_xfer) );
+        MSC_RETURN_ON_ERROR( USB_HOST_XFER_POOL_FREE(dev->csw_xfer) );
     }
 
     free(dev);
     return ESP_OK;
 }
 
+/**
+ * @brief Delay between polls of readiness
+ *
+ * @return false if the background polling has been stopped
+ */
+static bool msc_ready_poll_delay(msc_device_t *dev, uint32_t delay_ms)
+{
+    if (dev->ready_task == xTaskGetCurrentTaskHandle()) {
+        xSemaphoreTake(dev->ready_wake, pdMS_TO_TICKS(delay_ms));
+        return !dev->ready_stop;
+    }
+    vTaskDelay(pdMS_TO_TICKS(delay_ms));
+    return true;
+}
+
 // Some MSC devices requires to change its internal state from non-ready to ready
-static esp_err_t msc_wait_for_ready_state(msc_device_t *dev, size_t timeout_ms)
+static esp_err_t msc_wait_for_ready_state(msc_device_t *dev, uint8_t lun, size_t timeout_ms)
 {
     esp_err_t err;
     scsi_sense_data_t sense;
-    uint32_t trials = MAX(1, timeout_ms / 100);
+    const int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    uint32_t delay_ms = READY_POLL_DELAY_MIN_MS;
 
-    do {
-        err = scsi_cmd_unit_ready(dev);
+    // Most devices are ready after a few polls, slow ones are not polled on each 10 ms
+    while (true) {
+        err = scsi_cmd_unit_ready(dev, lun);
         if (err == ESP_OK) {
             return ESP_OK;
         } else {
             // Some MSC devices report 'NOT READY TO READY TRANSITION - MEDIA CHANGED', which isn't cleared until a REQUEST SENSE is performed.
-            MSC_RETURN_ON_ERROR( scsi_cmd_sense(dev, &sense) );
+            MSC_RETURN_ON_ERROR( scsi_cmd_sense(dev, lun, &sense) );
+            if (sense.key == MSC_NOT_READY && sense.code == MSC_ASC_MEDIUM_NOT_PRESENT && dev->lun_count > 1) {
+                // Empty slot of a card reader, waiting would not help
+                return ESP_ERR_NOT_FOUND;
+            }
             if (sense.key != MSC_NOT_READY &&
                     sense.key != MSC_UNIT_ATTENTION &&
                     sense.key != MSC_NO_SENSE) {
                 return ESP_ERR_MSC_INTERNAL;
             }
         }
-        vTaskDelay( pdMS_TO_TICKS(100) );
-    } while (trials-- && err);
+        if (esp_timer_get_time() + (int64_t)delay_ms * 1000 > deadline_us) {
+            return err;
+        }
+        if (!msc_ready_poll_delay(dev, delay_ms)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        delay_ms = MIN(delay_ms * 2, READY_POLL_DELAY_MAX_MS);
+    }
+}
 
-    return err;
+/**
+ * @brief Get capacity and transfer limits of the ready logical unit and create its cache
+ *
+ * Sector count is set last, the logical unit can be used then
+ */
+static esp_err_t msc_attach_lun(msc_device_t *device, uint8_t lun)
+{
+    usb_disk_t *disk = &device->luns[lun].disk;
+    uint32_t block_size;
+    uint64_t block_count;
+
+    MSC_RETURN_ON_ERROR( scsi_cmd_capacity(device, lun, &block_size, &block_count) );
+    // Block Limits VPD page is optional, without it the requests are limited only by the command
+    scsi_block_limits_t limits;
+    scsi_cmd_block_limits(device, lun, &limits);
+    disk->max_transfer_blocks = limits.max_transfer_blocks;
+    disk->erase_blocks = limits.erase_blocks;
+    disk->max_unmap_blocks = limits.max_unmap_blocks;
+    // Caching mode page is optional, SYNCHRONIZE CACHE is sent only to devices reporting the write cache enabled
+    bool write_cache = false;
+    if (scsi_cmd_get_write_cache(device, lun, &write_cache) == ESP_OK && !write_cache && s_msc_driver->enable_write_cache) {
+        write_cache = scsi_cmd_set_write_cache(device, lun, true) == ESP_OK;
+        if (!write_cache) {
+            ESP_LOGW(TAG, "LUN %d write cache could not be enabled", lun);
+        }
+    }
+    disk->write_cache = write_cache;
+
+    disk->block_size = block_size;
+    MSC_RETURN_ON_ERROR( msc_cache_install(disk, &s_msc_driver->cache_config) );
+    disk->block_count = block_count;
+    return ESP_OK;
+}
+
+/**
+ * @brief Wait for the logical unit to become ready and attach it
+ *
+ * @param[in] fast Do not wait, if the unit is not ready. It is marked to be polled in the background.
+ */
+static esp_err_t msc_init_lun(msc_device_t *device, uint8_t lun, bool fast)
+{
+    MSC_RETURN_ON_ERROR( scsi_cmd_inquiry(device, lun) );
+    if (fast) {
+        const esp_err_t err = msc_attach_lun(device, lun);
+        device->luns[lun].ready_pending = err != ESP_OK && err != ESP_ERR_NO_MEM;
+        return err;
+    }
+    MSC_RETURN_ON_ERROR( msc_wait_for_ready_state(device, lun, WAIT_FOR_READY_TIMEOUT_MS) );
+    return msc_attach_lun(device, lun);
+}
+
+/**
+ * @brief Poll logical units, which were not ready at installation, and report the ready ones
+ */
+static void msc_ready_poll_task(void *arg)
+{
+    msc_device_t *device = (msc_device_t *)arg;
+
+    for (uint8_t lun = 0; lun < device->lun_count && !device->ready_stop; lun++) {
+        msc_lun_t *unit = &device->luns[lun];
+        if (!unit->ready_pending) {
+            continue;
+        }
+        esp_err_t err = msc_wait_for_ready_state(device, lun, WAIT_FOR_READY_TIMEOUT_MS);
+        if (err == ESP_OK) {
+            err = msc_attach_lun(device, lun);
+        }
+        unit->ready_pending = false;
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "LUN %d is not ready (%s)", lun, esp_err_to_name(err));
+            continue;
+        }
+        const msc_host_event_t msc_event = {
+            .event = MSC_DEVICE_READY,
+            .device.handle = device,
+            .lun = lun,
+        };
+        s_msc_driver->user_cb(&msc_event, s_msc_driver->user_arg);
+    }
+
+    xSemaphoreGive(device->ready_done);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t msc_ready_poll_start(msc_device_t *device)
+{
+    bool pending = false;
+    for (uint8_t lun = 0; lun < device->lun_count; lun++) {
+        pending |= device->luns[lun].ready_pending;
+    }
+    if (!pending) {
+        return ESP_OK;
+    }
+
+    MSC_RETURN_ON_FALSE( device->ready_wake = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+    MSC_RETURN_ON_FALSE( device->ready_done = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+    // Polling runs at the priority of the installing task, it would wait for the device there otherwise
+    BaseType_t task_created = xTaskCreate(msc_ready_poll_task, "USB MSC ready", READY_POLL_STACK_SIZE, device,
+                                          uxTaskPriorityGet(NULL), &device->ready_task);
+    MSC_RETURN_ON_FALSE( task_created, ESP_ERR_NO_MEM );
+    return ESP_OK;
+}
+
+/**
+ * @brief Create logical units reported by GET MAX LUN and initialize them
+ *
+ * Logical units, which are not ready, e.g. empty slots of a card reader, are kept without sectors.
+ * Installation fails only if none of them is ready.
+ */
+static esp_err_t msc_init_luns(msc_device_t *device, bool fast)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t max_lun;
+    bool any_ready = false;
+
+    // Devices with a single LUN may stall the request. UAS would need REPORT LUNS, only LUN 0 is used.
+    if (device->config.uas || msc_get_max_lun(device, &max_lun) != ESP_OK) {
+        max_lun = 0;
+    }
+    const uint8_t lun_count = MIN(max_lun, MSC_LUN_MAX - 1) + 1;
+    MSC_RETURN_ON_FALSE( device->luns = calloc(lun_count, sizeof(msc_lun_t)), ESP_ERR_NO_MEM );
+    device->lun_count = lun_count;
+    for (uint8_t lun = 0; lun < lun_count; lun++) {
+        MSC_RETURN_ON_FALSE( device->luns[lun].cmd_turn = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+        device->luns[lun].disk.device = device;
+        device->luns[lun].disk.lun = lun;
+    }
+
+    for (uint8_t lun = 0; lun < lun_count; lun++) {
+        const esp_err_t err = msc_init_lun(device, lun, fast);
+        if (err == ESP_OK || device->luns[lun].ready_pending) {
+            any_ready = true;
+            continue;
+        }
+        MSC_RETURN_ON_FALSE( err != ESP_ERR_NO_MEM, ESP_ERR_NO_MEM );
+        ESP_LOGW(TAG, "LUN %d is not ready (%s)", lun, esp_err_to_name(err));
+        device->luns[lun].disk.block_count = 0;
+        ret = err;
+    }
+    return any_ready ? ESP_OK : ret;
 }
 
 static bool is_mass_storage_device(uint8_t dev_addr)
@@ -376,7 +718,9 @@ static msc_device_t *find_msc_device(usb_device_handle_t device_handle)
 static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
 {
     if (event->event == USB_HOST_CLIENT_EVENT_NEW_DEV) {
+        MSC_ENUM_MARK(event->new_dev.address, "new_dev");
         if (is_mass_storage_device(event->new_dev.address)) {
+            MSC_ENUM_MARK(event->new_dev.address, "class_check");
             const msc_host_event_t msc_event = {
                 .event = MSC_DEVICE_CONNECTED,
                 .device.address = event->new_dev.address,
@@ -411,6 +755,12 @@ esp_err_t msc_host_install(const msc_host_driver_config_t *config)
     MSC_RETURN_ON_FALSE(driver, ESP_ERR_NO_MEM);
     driver->user_cb = config->callback;
     driver->user_arg = config->callback_arg;
+    driver->max_io_size = config->max_io_size ? config->max_io_size : DEFAULT_MAX_IO_SIZE;
+    driver->cache_config = config->cache;
+    driver->async_config = config->async;
+    driver->timeout_ms = config->timeout_ms ? config->timeout_ms : DEFAULT_TIMEOUT_MS;
+    driver->stall_notify_ms = config->stall_notify_ms;
+    driver->enable_write_cache = config->enable_write_cache;
 
     usb_host_client_config_t client_config = {
         .async.client_event_callback = client_event_cb,
@@ -430,6 +780,8 @@ esp_err_t msc_host_install(const msc_host_driver_config_t *config)
     STAILQ_INIT(&s_msc_driver->devices_tailq);
     MSC_EXIT_CRITICAL();
 
+    MSC_GOTO_ON_ERROR( msc_sched_install(&config->sched, &config->async) );
+
     if (config->create_backround_task) {
         BaseType_t task_created = xTaskCreatePinnedToCore(
                                       event_handler_task,
@@ -445,6 +797,7 @@ esp_err_t msc_host_install(const msc_host_driver_config_t *config)
     return ESP_OK;
 
 fail:
+    msc_sched_uninstall();
     s_msc_driver = NULL;
     usb_host_client_deregister(driver->client_handle);
     if (driver->all_events_handled) {
@@ -471,6 +824,7 @@ esp_err_t msc_host_uninstall(void)
         // In case the event handling started, we must wait until it finishes
         xSemaphoreTake(s_msc_driver->all_events_handled, portMAX_DELAY);
     }
+    msc_sched_uninstall();
     vSemaphoreDelete(s_msc_driver->all_events_handled);
     ESP_ERROR_CHECK( usb_host_client_deregister(s_msc_driver->client_handle) );
     free(s_msc_driver);
@@ -478,14 +832,15 @@ esp_err_t msc_host_uninstall(void)
     return ESP_OK;
 }
 
-esp_err_t msc_host_install_device(uint8_t device_address, msc_host_device_handle_t *msc_device_handle)
+static esp_err_t msc_install_device(uint8_t device_address, msc_host_device_handle_t *msc_device_handle,
+                                    bool fast)
 {
     esp_err_t ret;
-    uint32_t block_size, block_count;
     const usb_config_desc_t *config_desc;
     msc_device_t *msc_device;
 
     MSC_GOTO_ON_FALSE( msc_device = calloc(1, sizeof(msc_device_t)), ESP_ERR_NO_MEM );
+    portMUX_INITIALIZE(&msc_device->lock);
 
     MSC_ENTER_CRITICAL();
     MSC_GOTO_ON_FALSE_CRITICAL( s_msc_driver, ESP_ERR_INVALID_STATE );
@@ -494,21 +849,36 @@ esp_err_t msc_host_install_device(uint8_t device_address, msc_host_device_handle
     MSC_EXIT_CRITICAL();
 
     MSC_GOTO_ON_FALSE( msc_device->transfer_done = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM);
+    MSC_GOTO_ON_FALSE( msc_device->cmd_lock = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM);
     MSC_GOTO_ON_ERROR( usb_host_device_open(s_msc_driver->client_handle, device_address, &msc_device->handle) );
     MSC_GOTO_ON_ERROR( usb_host_get_active_config_descriptor(msc_device->handle, &config_desc) );
     MSC_GOTO_ON_ERROR( extract_config_from_descriptor(config_desc, &msc_device->config) );
-    MSC_GOTO_ON_ERROR( usb_host_transfer_alloc(DEFAULT_XFER_SIZE, 0, &msc_device->xfer) );
+    // All transfers are allocated here, so no allocation is done during I/O
+    const uint16_t mps = msc_device->config.bulk_in_mps;
+    const size_t data_size = usb_round_up_to_mps(MAX(s_msc_driver->max_io_size, DEFAULT_XFER_SIZE), mps);
+    MSC_GOTO_ON_ERROR( USB_HOST_XFER_POOL_ALLOC(data_size, 0, &msc_device->xfer) );
+    msc_device->xfer_size = data_size;
+    MSC_GOTO_ON_ERROR( USB_HOST_XFER_POOL_ALLOC(DEFAULT_XFER_SIZE, 0, &msc_device->cbw_xfer) );
+    MSC_GOTO_ON_ERROR( USB_HOST_XFER_POOL_ALLOC(usb_round_up_to_mps(DEFAULT_XFER_SIZE, mps), 0, &msc_device->csw_xfer) );
     MSC_GOTO_ON_ERROR( usb_host_interface_claim(
                            s_msc_driver->client_handle,
                            msc_device->handle,
-                           msc_device->config.iface_num, 0) );
+                           msc_device->config.iface_num,
+                           msc_device->config.alt_setting) );
+    if (msc_device->config.alt_setting != 0) {
+        // UAS is an alternate setting of the interface, BOT is the default one
+        USB_SETUP_PACKET_INIT_SET_INTERFACE((usb_setup_packet_t *)msc_device->xfer->data_buffer,
+                                            msc_device->config.iface_num, msc_device->config.alt_setting);
+        MSC_GOTO_ON_ERROR( msc_control_transfer(msc_device, USB_SETUP_PACKET_SIZE) );
+    }
+    MSC_ENUM_MARK(device_address, "claimed");
 
-    MSC_GOTO_ON_ERROR( scsi_cmd_inquiry(msc_device) );
-    MSC_GOTO_ON_ERROR( msc_wait_for_ready_state(msc_device, WAIT_FOR_READY_TIMEOUT_MS) );
-    MSC_GOTO_ON_ERROR( scsi_cmd_read_capacity(msc_device, &block_size, &block_count) );
+    MSC_GOTO_ON_ERROR( msc_init_luns(msc_device, fast) );
+    MSC_ENUM_MARK(device_address, "luns");
+    MSC_GOTO_ON_ERROR( msc_async_install(msc_device, &s_msc_driver->async_config) );
+    MSC_GOTO_ON_ERROR( msc_ready_poll_start(msc_device) );
+    MSC_ENUM_MARK(device_address, "installed");
 
-    msc_device->disk.block_size = block_size;
-    msc_device->disk.block_count = block_count;
     *msc_device_handle = msc_device;
 
     return ESP_OK;
@@ -518,6 +888,16 @@ fail:
     return ret;
 }
 
+esp_err_t msc_host_install_device(uint8_t device_address, msc_host_device_handle_t *msc_device_handle)
+{
+    return msc_install_device(device_address, msc_device_handle, false);
+}
+
+esp_err_t msc_host_install_device_fast(uint8_t device_address, msc_host_device_handle_t *msc_device_handle)
+{
+    return msc_install_device(device_address, msc_device_handle, true);
+}
+
 esp_err_t msc_host_uninstall_device(msc_host_device_handle_t device)
 {
     MSC_RETURN_ON_INVALID_ARG(device);
@@ -529,7 +909,7 @@ esp_err_t msc_host_read_sector(msc_host_device_handle_t device, size_t sector, v
     MSC_RETURN_ON_INVALID_ARG(device);
     msc_device_t *dev = (msc_device_t *)device;
 
-    return scsi_cmd_read10(dev, data, sector, 1, dev->disk.block_size);
+    return msc_disk_read(&dev->luns[0].disk, data, sector, 1);
 }
 
 esp_err_t msc_host_write_sector(msc_host_device_handle_t device, size_t sector, const void *data, size_t size)
@@ -537,7 +917,7 @@ esp_err_t msc_host_write_sector(msc_host_device_handle_t device, size_t sector,
     MSC_RETURN_ON_INVALID_ARG(device);
     msc_device_t *dev = (msc_device_t *)device;
 
-    return scsi_cmd_write10(dev, data, sector, 1, dev->disk.block_size);
+    return msc_disk_write(&dev->luns[0].disk, data, sector, 1);
 }
 
 static void copy_string_desc(wchar_t *dest, const usb_str_desc_t *src)
@@ -572,8 +952,9 @@ esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_dev
 
     info->idProduct = desc->idProduct;
     info->idVendor = desc->idVendor;
-    info->sector_size = dev->disk.block_size;
-    info->sector_count = dev->disk.block_count;
+    info->sector_size = dev->luns[0].disk.block_size;
+    info->sector_count = (uint32_t)MIN(dev->luns[0].disk.block_count, UINT32_MAX);
+    info->lun_count = dev->lun_count;
 
     copy_string_desc(info->iManufacturer, dev_info.str_desc_manufacturer);
     copy_string_desc(info->iProduct, dev_info.str_desc_product);
@@ -582,6 +963,19 @@ esp_err_t msc_host_get_device_info(msc_host_device_handle_t device, msc_host_dev
     return ESP_OK;
 }
 
+esp_err_t msc_host_get_lun_info(msc_host_device_handle_t device, uint8_t lun, msc_host_lun_info_t *info)
+{
+    MSC_RETURN_ON_INVALID_ARG(device);
+    MSC_RETURN_ON_INVALID_ARG(info);
+    MSC_RETURN_ON_FALSE(lun < device->lun_count, ESP_ERR_INVALID_ARG);
+
+    const usb_disk_t *disk = &device->luns[lun].disk;
+    info->sector_count = disk->block_count;
+    info->sector_size = disk->block_size;
+    info->write_cache = disk->write_cache;
+    return ESP_OK;
+}
+
 esp_err_t msc_host_print_descriptors(msc_host_device_handle_t device)
 {
     msc_device_t *dev = (msc_device_t *)device;
@@ -594,6 +988,97 @@ esp_err_t msc_host_print_descriptors(msc_host_device_handle_t device)
     return ESP_OK;
 }
 
+static inline uint32_t ewma(uint32_t average, uint32_t sample)
+{
+    return average ? average - average / 8 + sample / 8 : sample;
+}
+
+/**
+ * @brief Expected duration of the current command in ms, 0 if the device has not been measured yet
+ */
+static uint32_t command_expected_ms(const msc_timing_t *timing)
+{
+    const uint32_t us_per_kib = timing->data_in ? timing->in_us_per_kib : timing->out_us_per_kib;
+    if (timing->latency_us == 0 || (timing->size >= TIMEOUT_MIN_DATA_SIZE && us_per_kib == 0)) {
+        return 0;
+    }
+    const uint64_t expected_us = timing->latency_us + (uint64_t)timing->size * us_per_kib / 1024;
+    return (uint32_t)MIN(expected_us / 1000 + 1, UINT32_MAX / (2 * TIMEOUT_MARGIN));
+}
+
+void msc_command_begin(msc_device_t *device, size_t size, bool data_in, bool rw)
+{
+    msc_timing_t *timing = &device->timing;
+    const uint32_t max_timeout_ms = s_msc_driver->timeout_ms;
+
+    timing->size = size;
+    timing->data_in = data_in;
+    timing->rw = rw;
+    timing->notified = false;
+
+    const uint32_t expected_ms = command_expected_ms(timing);
+    timing->timeout_ms = expected_ms ? MIN(expected_ms * TIMEOUT_MARGIN + TIMEOUT_SLACK_MS, max_timeout_ms)
+                         : max_timeout_ms;
+    timing->notify_ms = timing->timeout_ms;
+    if (rw && s_msc_driver->stall_notify_ms) {
+        timing->notify_ms = MIN(MAX(s_msc_driver->stall_notify_ms, 2 * expected_ms), timing->timeout_ms);
+    }
+    timing->start_us = esp_timer_get_time();
+}
+
+void msc_command_end(msc_device_t *device, esp_err_t ret)
+{
+    msc_timing_t *timing = &device->timing;
+    const uint32_t duration_us = (uint32_t)MIN(esp_timer_get_time() - timing->start_us, UINT32_MAX);
+
+    if (ret == ESP_OK) {
+        if (timing->size < TIMEOUT_MIN_DATA_SIZE) {
+            timing->latency_us = ewma(timing->latency_us, MAX(duration_us, 1));
+        } else {
+            uint32_t *us_per_kib = timing->data_in ? &timing->in_us_per_kib : &timing->out_us_per_kib;
+            const uint32_t data_us = duration_us > timing->latency_us ? duration_us - timing->latency_us : 0;
+            *us_per_kib = ewma(*us_per_kib, MAX(data_us / (timing->size / 1024), 1));
+        }
+    } else if (ret != ESP_FAIL) {
+        // Only failed status in CSW is answer of the device, other errors make the measurements unreliable
+        timing->latency_us = 0;
+        timing->in_us_per_kib = 0;
+        timing->out_us_per_kib = 0;
+    }
+}
+
+/**
+ * @brief Report read or write, which failed or is late, to the application, once per command
+ */
+static void notify_io_stalled(msc_device_t *device)
+{
+    if (!device->timing.rw || device->timing.notified || !s_msc_driver->stall_notify_ms) {
+        return;
+    }
+    device->timing.notified = true;
+    const msc_host_event_t msc_event = {
+        .event = MSC_DEVICE_IO_STALLED,
+        .device.handle = device,
+    };
+    s_msc_driver->user_cb(&msc_event, s_msc_driver->user_arg);
+}
+
+/**
+ * @brief Wait for done transfer. The application is notified, if it takes longer than expected.
+ */
+static bool take_transfer_done(msc_device_t *device, uint32_t timeout_ms)
+{
+    const uint32_t notify_ms = MIN(device->timing.notify_ms, timeout_ms);
+
+    if (notify_ms < timeout_ms) {
+        if (xSemaphoreTake(device->transfer_done, pdMS_TO_TICKS(notify_ms)) == pdTRUE) {
+            return true;
+        }
+        notify_io_stalled(device);
+    }
+    return xSemaphoreTake(device->transfer_done, pdMS_TO_TICKS(timeout_ms - notify_ms)) == pdTRUE;
+}
+
 static void transfer_callback(usb_transfer_t *transfer)
 {
     msc_device_t *device = (msc_device_t *)transfer->context;
@@ -608,64 +1093,341 @@ static void transfer_callback(usb_transfer_t *transfer)
 static usb_transfer_status_t wait_for_transfer_done(usb_transfer_t *xfer)
 {
     msc_device_t *device = (msc_device_t *)xfer->context;
-    BaseType_t received = xSemaphoreTake(device->transfer_done, pdMS_TO_TICKS(xfer->timeout_ms));
+    const bool received = take_transfer_done(device, xfer->timeout_ms);
     usb_transfer_status_t status = xfer->status;
 
-    if (received != pdTRUE) {
+    if (!received) {
         usb_host_endpoint_halt(xfer->device_handle, xfer->bEndpointAddress);
         usb_host_endpoint_flush(xfer->device_handle, xfer->bEndpointAddress);
         usb_host_endpoint_clear(xfer->device_handle, xfer->bEndpointAddress);
         xSemaphoreTake(device->transfer_done, portMAX_DELAY); // Since we flushed the EP, this should return immediately
         status = USB_TRANSFER_STATUS_TIMED_OUT;
     }
+    if (status != USB_TRANSFER_STATUS_COMPLETED) {
+        notify_io_stalled(device);
+    }
 
     return status;
 }
 
-esp_err_t msc_bulk_transfer(msc_device_t *device, uint8_t *data, size_t size, msc_endpoint_t ep)
+static esp_err_t bulk_transfer_status_to_err(usb_transfer_status_t status)
 {
-    esp_err_t ret = ESP_OK;
-    usb_transfer_t *xfer = device->xfer;
-    size_t transfer_size = (ep == MSC_EP_IN) ? usb_round_up_to_mps(size, device->config.bulk_in_mps) : size;
-
-    if (xfer->data_buffer_size < transfer_size) {
-        // The allocated buffer is not large enough -> realloc
-        MSC_RETURN_ON_ERROR( usb_host_transfer_free(xfer) );
-        MSC_RETURN_ON_ERROR( usb_host_transfer_alloc(transfer_size, 0, &device->xfer) );
-        xfer = device->xfer;
+    switch (status) {
+    case USB_TRANSFER_STATUS_COMPLETED:
+        return ESP_OK;
+    case USB_TRANSFER_STATUS_STALL:
+        return ESP_ERR_MSC_STALL;
+    default:
+        return ESP_ERR_MSC_INTERNAL;
     }
+}
 
-    if (ep == MSC_EP_IN) {
-        xfer->bEndpointAddress = device->config.bulk_in_ep;
-    } else {
-        xfer->bEndpointAddress = device->config.bulk_out_ep;
-        memcpy(xfer->data_buffer, data, size);
+static inline bool is_in_pipe(msc_endpoint_t ep)
+{
+    return ep == MSC_EP_IN || ep == MSC_EP_UAS_STATUS;
+}
+
+static uint8_t pipe_address(const msc_device_t *device, msc_endpoint_t ep)
+{
+    switch (ep) {
+    case MSC_EP_IN:
+        return device->config.bulk_in_ep;
+    case MSC_EP_UAS_COMMAND:
+        return device->config.uas_cmd_ep;
+    case MSC_EP_UAS_STATUS:
+        return device->config.uas_status_ep;
+    default:
+        return device->config.bulk_out_ep;
     }
+}
 
-    xfer->num_bytes = transfer_size;
+static void bulk_transfer_init(msc_device_t *device, usb_transfer_t *xfer, size_t num_bytes, msc_endpoint_t ep)
+{
+    xfer->bEndpointAddress = pipe_address(device, ep);
+    xfer->num_bytes = num_bytes;
     xfer->device_handle = device->handle;
     xfer->callback = transfer_callback;
-    xfer->timeout_ms = 5000;
+    xfer->timeout_ms = device->timing.timeout_ms;
     xfer->context = device;
+}
 
-    MSC_RETURN_ON_ERROR( usb_host_transfer_submit(xfer) );
-    const usb_transfer_status_t status = wait_for_transfer_done(xfer);
-    switch (status) {
-    case USB_TRANSFER_STATUS_COMPLETED:
-        if (ep == MSC_EP_IN) {
-            memcpy(data, xfer->data_buffer, xfer->actual_num_bytes);
-        }
-        ret = ESP_OK;
-        break;
-    case USB_TRANSFER_STATUS_STALL:
-        ret = ESP_ERR_MSC_STALL; break;
-    default:
-        ret = ESP_ERR_MSC_INTERNAL; break;
+/**
+ * @brief Length of the data, that can be transferred directly from/to the caller buffer
+ *
+ * The buffer must be DMA capable and aligned. The length is a multiple of MPS,
+ * so the device never writes behind the buffer and the remaining tail ends the data phase.
+ * On targets with cache, the buffer must not share a cache line with other data.
+ *
+ * @return Length of the zero-copy part, 0 if the buffer must be copied
+ */
+static size_t bulk_transfer_zero_copy_len(const msc_device_t *device, const uint8_t *data, size_t size)
+{
+    if (!esp_ptr_dma_capable(data) || ((uintptr_t)data % MSC_DMA_BUFFER_ALIGN) != 0) {
+        return 0;
     }
+    const size_t unit = MAX(device->config.bulk_in_mps, MSC_DMA_BUFFER_ALIGN);
+    return size - (size % unit);
+}
+
+/**
+ * @brief Lend the caller buffer to the USB transfer
+ *
+ * usb_transfer_t has constant data buffer, so its own buffer is swapped for the caller buffer.
+ * The own buffer must be restored by xfer_restore_buffer(), when the transfer is done.
+ */
+static void xfer_lend_buffer(usb_transfer_t *xfer, uint8_t *data, size_t size, msc_transfer_buffer_t *own)
+{
+    msc_transfer_buffer_t *buffer = (msc_transfer_buffer_t *)xfer;
+    *own = *buffer;
+    buffer->data_buffer = data;
+    buffer->data_buffer_size = size;
+}
+
+static void xfer_restore_buffer(usb_transfer_t *xfer, const msc_transfer_buffer_t *own)
+{
+    *(msc_transfer_buffer_t *)xfer = *own;
+}
 
+/**
+ * @brief Bulk transfer with the caller buffer lent to the USB transfer, no copy
+ */
+static esp_err_t bulk_transfer_zero_copy(msc_device_t *device, uint8_t *data, size_t size, msc_endpoint_t ep,
+                                         size_t *transferred)
+{
+    usb_transfer_t *xfer = device->xfer;
+    msc_transfer_buffer_t own_buffer;
+
+    xfer_lend_buffer(xfer, data, size, &own_buffer);
+    bulk_transfer_init(device, xfer, size, ep);
+
+    esp_err_t ret = usb_host_transfer_submit(xfer);
+    if (ret == ESP_OK) {
+        ret = bulk_transfer_status_to_err(wait_for_transfer_done(xfer));
+        *transferred = xfer->actual_num_bytes;
+    }
+    xfer_restore_buffer(xfer, &own_buffer);
     return ret;
 }
 
+/**
+ * @brief Requested buffer size of preallocated USB transfer
+ *
+ * A transfer taken from the transfer pool can have a larger buffer, the requested size limits the transfer length.
+ */
+static size_t xfer_buffer_size(const msc_device_t *device, const usb_transfer_t *xfer)
+{
+    if (xfer == device->xfer) {
+        return device->xfer_size;
+    }
+    if (xfer == device->csw_xfer) {
+        return usb_round_up_to_mps(DEFAULT_XFER_SIZE, device->config.bulk_in_mps);
+    }
+    return DEFAULT_XFER_SIZE;
+}
+
+/**
+ * @brief Bulk transfer through the buffer of preallocated USB transfer
+ *
+ * Data larger than the buffer are transferred in chunks, multiple of MPS.
+ */
+static esp_err_t bulk_transfer_copy(msc_device_t *device, usb_transfer_t *xfer, uint8_t *data, size_t size,
+                                    msc_endpoint_t ep)
+{
+    const uint16_t mps = device->config.bulk_in_mps;
+    // Buffers of IN transfers are at least MPS, the small CBW buffer is sent in one chunk
+    const size_t buffer_size = xfer_buffer_size(device, xfer);
+    const size_t chunk_size = (buffer_size >= mps) ? buffer_size - (buffer_size % mps) : buffer_size;
+
+    while (size > 0) {
+        const size_t len = MIN(size, chunk_size);
+        if (!is_in_pipe(ep)) {
+            memcpy(xfer->data_buffer, data, len);
+        }
+        bulk_transfer_init(device, xfer, is_in_pipe(ep) ? usb_round_up_to_mps(len, mps) : len, ep);
+
+        MSC_RETURN_ON_ERROR( usb_host_transfer_submit(xfer) );
+        MSC_RETURN_ON_ERROR( bulk_transfer_status_to_err(wait_for_transfer_done(xfer)) );
+        if (is_in_pipe(ep)) {
+            memcpy(data, xfer->data_buffer, MIN(xfer->actual_num_bytes, len));
+            if (xfer->actual_num_bytes < len) {
+                // Short packet ended the data phase
+                break;
+            }
+        }
+        data += len;
+        size -= len;
+    }
+    return ESP_OK;
+}
+
+esp_err_t msc_bulk_transfer(msc_device_t *device, uint8_t *data, size_t size, msc_endpoint_t ep)
+{
+    // Sector data go directly to/from the caller buffer, only the tail, not multiple of MPS, is copied.
+    // Buffers in PSRAM or unaligned are copied in whole.
+    const size_t zero_copy_len = bulk_transfer_zero_copy_len(device, data, size);
+    if (zero_copy_len > 0) {
+        size_t transferred = 0;
+        MSC_RETURN_ON_ERROR( bulk_transfer_zero_copy(device, data, zero_copy_len, ep, &transferred) );
+        if (transferred < zero_copy_len) {
+            // Short packet ended the data phase, there is no tail
+            return ESP_OK;
+        }
+        data += zero_copy_len;
+        size -= zero_copy_len;
+    }
+    if (size == 0) {
+        return ESP_OK;
+    }
+    return bulk_transfer_copy(device, device->xfer, data, size, ep);
+}
+
+esp_err_t msc_cbw_transfer(msc_device_t *device, const uint8_t *cbw, size_t size)
+{
+    MSC_RETURN_ON_FALSE( size <= xfer_buffer_size(device, device->cbw_xfer), ESP_ERR_INVALID_SIZE );
+    return bulk_transfer_copy(device, device->cbw_xfer, (uint8_t *)cbw, size, MSC_EP_OUT);
+}
+
+esp_err_t msc_csw_transfer(msc_device_t *device, uint8_t *csw, size_t size)
+{
+    MSC_RETURN_ON_FALSE( size <= xfer_buffer_size(device, device->csw_xfer), ESP_ERR_INVALID_SIZE );
+    return bulk_transfer_copy(device, device->csw_xfer, csw, size, MSC_EP_IN);
+}
+
+esp_err_t msc_uas_command_transfer(msc_device_t *device, const uint8_t *iu, size_t size)
+{
+    MSC_RETURN_ON_FALSE( size <= xfer_buffer_size(device, device->cbw_xfer), ESP_ERR_INVALID_SIZE );
+    return bulk_transfer_copy(device, device->cbw_xfer, (uint8_t *)iu, size, MSC_EP_UAS_COMMAND);
+}
+
+esp_err_t msc_uas_status_transfer(msc_device_t *device, uint8_t *iu, size_t size)
+{
+    MSC_RETURN_ON_FALSE( size <= xfer_buffer_size(device, device->csw_xfer), ESP_ERR_INVALID_SIZE );
+    return bulk_transfer_copy(device, device->csw_xfer, iu, size, MSC_EP_UAS_STATUS);
+}
+
+static void pipelined_transfer_callback(usb_transfer_t *transfer)
+{
+    msc_device_t *device = (msc_device_t *)transfer->context;
+    const bool failed = transfer->status != USB_TRANSFER_STATUS_COMPLETED;
+
+    if (failed && transfer->status != USB_TRANSFER_STATUS_CANCELED) {
+        ESP_LOGE("Transfer failed", "Status %d", transfer->status);
+    }
+
+    MSC_DEVICE_ENTER_CRITICAL(device);
+    device->xfer_pending--;
+    // Wake the task when the command is done or at the first failure, so it can cancel the queued transfers
+    const bool wake = device->xfer_pending == 0 || (failed && !device->xfer_failed);
+    device->xfer_failed |= failed;
+    MSC_DEVICE_EXIT_CRITICAL(device);
+
+    if (wake) {
+        xSemaphoreGive(device->transfer_done);
+    }
+}
+
+static uint8_t pipelined_transfers_pending(msc_device_t *device)
+{
+    const uint8_t pending = __atomic_load_n(&device->xfer_pending, __ATOMIC_ACQUIRE);
+    return pending;
+}
+
+static void wait_for_pipelined_transfers(msc_device_t *device, bool cancel, uint32_t timeout_ms)
+{
+    if (!cancel) {
+        cancel = !take_transfer_done(device, timeout_ms) || pipelined_transfers_pending(device) > 0;
+    }
+
+    if (cancel || device->xfer_failed) {
+        notify_io_stalled(device);
+    }
+    if (cancel) {
+        const uint8_t eps[] = { device->config.bulk_out_ep, device->config.bulk_in_ep };
+        for (int i = 0; i < sizeof(eps); i++) {
+            usb_host_endpoint_halt(device->handle, eps[i]);
+            usb_host_endpoint_flush(device->handle, eps[i]);
+            usb_host_endpoint_clear(device->handle, eps[i]);
+        }
+        // Flushed transfers return immediately
+        while (pipelined_transfers_pending(device) > 0) {
+            xSemaphoreTake(device->transfer_done, portMAX_DELAY);
+        }
+    }
+
+    // Drop the wakeup of an early failure, no transfer is in flight now
+    xSemaphoreTake(device->transfer_done, 0);
+}
+
+esp_err_t msc_bot_transfer(msc_device_t *device, const uint8_t *cbw, size_t cbw_size,
+                           uint8_t *data, size_t size, msc_endpoint_t ep,
+                           uint8_t *csw, size_t csw_size, esp_err_t *csw_err)
+{
+    const uint16_t mps = device->config.bulk_in_mps;
+    usb_transfer_t *data_xfer = (data && size) ? device->xfer : NULL;
+    const bool zero_copy = data_xfer && bulk_transfer_zero_copy_len(device, data, size) == size;
+    const size_t data_len = (ep == MSC_EP_IN) ? usb_round_up_to_mps(size, mps) : size;
+
+    // The data phase must be one transfer to be queued with the command and status
+    MSC_RETURN_ON_FALSE( !data_xfer || zero_copy || data_len <= device->xfer_size, ESP_ERR_NOT_SUPPORTED );
+    MSC_RETURN_ON_FALSE( cbw_size <= xfer_buffer_size(device, device->cbw_xfer), ESP_ERR_INVALID_SIZE );
+    MSC_RETURN_ON_FALSE( csw_size <= xfer_buffer_size(device, device->csw_xfer), ESP_ERR_INVALID_SIZE );
+
+    usb_transfer_t *xfers[3];
+    uint8_t xfer_count = 0;
+    msc_transfer_buffer_t own_buffer;
+
+    memcpy(device->cbw_xfer->data_buffer, cbw, cbw_size);
+    bulk_transfer_init(device, device->cbw_xfer, cbw_size, MSC_EP_OUT);
+    xfers[xfer_count++] = device->cbw_xfer;
+    if (data_xfer) {
+        if (zero_copy) {
+            xfer_lend_buffer(data_xfer, data, size, &own_buffer);
+        } else if (ep == MSC_EP_OUT) {
+            memcpy(data_xfer->data_buffer, data, size);
+        }
+        bulk_transfer_init(device, data_xfer, zero_copy ? size : data_len, ep);
+        xfers[xfer_count++] = data_xfer;
+    }
+    bulk_transfer_init(device, device->csw_xfer, usb_round_up_to_mps(csw_size, mps), MSC_EP_IN);
+    xfers[xfer_count++] = device->csw_xfer;
+
+    // Count all transfers before the first submit, the task is woken only when the last one is done
+    MSC_DEVICE_ENTER_CRITICAL(device);
+    device->xfer_pending = xfer_count;
+    device->xfer_failed = false;
+    MSC_DEVICE_EXIT_CRITICAL(device);
+
+    esp_err_t ret = ESP_OK;
+    for (int i = 0; i < xfer_count; i++) {
+        xfers[i]->callback = pipelined_transfer_callback;
+        ret = usb_host_transfer_submit(xfers[i]);
+        if (ret != ESP_OK) {
+            MSC_DEVICE_ENTER_CRITICAL(device);
+            device->xfer_pending -= xfer_count - i;
+            MSC_DEVICE_EXIT_CRITICAL(device);
+            break;
+        }
+    }
+    wait_for_pipelined_transfers(device, ret != ESP_OK, device->csw_xfer->timeout_ms);
+
+    if (data_xfer && zero_copy) {
+        xfer_restore_buffer(data_xfer, &own_buffer);
+    }
+    MSC_RETURN_ON_ERROR( ret );
+    MSC_RETURN_ON_ERROR( bulk_transfer_status_to_err(device->cbw_xfer->status) );
+    if (data_xfer) {
+        MSC_RETURN_ON_ERROR( bulk_transfer_status_to_err(data_xfer->status) );
+        if (!zero_copy && ep == MSC_EP_IN) {
+            memcpy(data, data_xfer->data_buffer, MIN(data_xfer->actual_num_bytes, size));
+        }
+    }
+    *csw_err = bulk_transfer_status_to_err(device->csw_xfer->status);
+    if (*csw_err == ESP_OK) {
+        memcpy(csw, device->csw_xfer->data_buffer, MIN(device->csw_xfer->actual_num_bytes, csw_size));
+    }
+    return ESP_OK;
+}
+
 esp_err_t msc_control_transfer(msc_device_t *device, size_t len)
 {
     usb_transfer_t *xfer = device->xfer;
@@ -680,8 +1442,29 @@ esp_err_t msc_control_transfer(msc_device_t *device, size_t len)
     return wait_for_transfer_done(xfer) == USB_TRANSFER_STATUS_COMPLETED ? ESP_OK : ESP_ERR_MSC_INTERNAL;
 }
 
+// LUN 0 may be an empty slot of a card reader
+static uint8_t msc_first_ready_lun(const msc_device_t *device)
+{
+    for (uint8_t lun = 0; lun < device->lun_count; lun++) {
+        if (device->luns[lun].disk.block_count) {
+            return lun;
+        }
+    }
+    return 0;
+}
+
 esp_err_t msc_host_reset_recovery(msc_host_device_handle_t device)
 {
+    if (device->config.uas) {
+        // UAS has no class reset request, pipes are cleared instead
+        clear_feature(device, device->config.uas_cmd_ep);
+        clear_feature(device, device->config.uas_status_ep);
+        clear_feature(device, device->config.bulk_in_ep);
+        clear_feature(device, device->config.bulk_out_ep);
+        MSC_RETURN_ON_ERROR( msc_wait_for_ready_state(device, msc_first_ready_lun(device), WAIT_FOR_READY_TIMEOUT_MS) );
+        return ESP_OK;
+    }
+
     // USB Mass Storage Class – Bulk Only Transport Revision 1.0
     // 5.3.4 Reset Recovery
     // For Reset Recovery the host shall issue in the following order: :
@@ -693,6 +1476,6 @@ esp_err_t msc_host_reset_recovery(msc_host_device_handle_t device)
     // Clear feature will fail if there is not STALL on the endpoint, so we don't check the errors here
     clear_feature(device, device->config.bulk_in_ep);
     clear_feature(device, device->config.bulk_out_ep);
-    MSC_RETURN_ON_ERROR( msc_wait_for_ready_state(device, WAIT_FOR_READY_TIMEOUT_MS) );
+    MSC_RETURN_ON_ERROR( msc_wait_for_ready_state(device, msc_first_ready_lun(device), WAIT_FOR_READY_TIMEOUT_MS) );
     return ESP_OK;
 }
@@ -6,23 +6,50 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
 #include <sys/param.h>
 #include "msc_common.h"
+#include "msc_cache.h"
 #include "usb/msc_host_vfs.h"
 #include "diskio_impl.h"
 #include "ffconf.h"
 #include "ff.h"
 #include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #define DRIVE_STR_LEN 3
 
+#define SCAN_CHUNK_SECTORS  (64)        // Sectors of the FAT read by one command of the free space scan
+#define SCAN_ATTEMPTS       (3)         // The scan is repeated if the FAT was changed meanwhile
+#define SCAN_RETRY_DELAY_MS (1000)
+#define SCAN_STACK_SIZE     (3072)
+#define SCAN_TASK_PRIORITY  (1)
+
 typedef struct msc_host_vfs {
     char drive[DRIVE_STR_LEN];
     char *base_path;
     uint8_t pdrv;
+    usb_disk_t *disk;
+    FATFS *fs;
+    TaskHandle_t scan_task;         // Free space scan, NULL if not started
+    SemaphoreHandle_t scan_wake;    // Wakes the scan up from its delay, when it is stopped
+    SemaphoreHandle_t scan_done;    // Given by the scan task, when it ends
+    volatile bool scan_stop;        // The scan is stopped by unregistration
 } msc_host_vfs_t;
 
+typedef struct msc_host_stream {
+    FIL file;
+    usb_disk_t *disk;
+    uint64_t first_sector;  // First sector of the contiguous clusters
+    uint64_t size;          // Preallocated size in bytes
+    uint64_t written;       // Written size in bytes
+    bool finished;          // Written size is not a multiple of sector size, no more data can be written
+} msc_host_stream_t;
+
 static const char *TAG = "MSC VFS";
 
 static esp_err_t msc_format_storage(size_t block_size, size_t allocation_size, const char *drv)
@@ -58,7 +85,7 @@ esp_err_t msc_host_vfs_format(msc_host_device_handle_t device, const esp_vfs_fat
     MSC_RETURN_ON_INVALID_ARG(mount_config);
     MSC_RETURN_ON_INVALID_ARG(vfs_handle);
 
-    size_t block_size = ((msc_device_t *)device)->disk.block_size;
+    size_t block_size = vfs_handle->disk->block_size;
     size_t alloc_size = mount_config->allocation_unit_size;
 
     return msc_format_storage(block_size, alloc_size, vfs_handle->drive);
@@ -66,14 +93,153 @@ esp_err_t msc_host_vfs_format(msc_host_device_handle_t device, const esp_vfs_fat
 
 static void dealloc_msc_vfs(msc_host_vfs_t *vfs)
 {
+    if (vfs->scan_wake) {
+        vSemaphoreDelete(vfs->scan_wake);
+    }
+    if (vfs->scan_done) {
+        vSemaphoreDelete(vfs->scan_done);
+    }
     free(vfs->base_path);
     free(vfs);
 }
 
+/**
+ * @brief Count free clusters by reading the first FAT in chunks of sectors
+ *
+ * @return ESP_ERR_INVALID_STATE if the scan has been stopped
+ */
+static esp_err_t vfs_count_free_clusters(msc_host_vfs_t *vfs, uint8_t *buf, uint32_t *free_clusters)
+{
+    const FATFS *fs = vfs->fs;
+    const uint32_t block_size = vfs->disk->block_size;
+    const bool fat32 = fs->fs_type == FS_FAT32;
+    const uint32_t entries_per_sector = block_size / (fat32 ? 4 : 2);
+    uint32_t count = 0;
+    uint32_t cluster = 0;  // Cluster of the next FAT entry, the first two entries are reserved
+
+    for (uint32_t offset = 0; offset < fs->fsize && cluster < fs->n_fatent; offset += SCAN_CHUNK_SECTORS) {
+        if (vfs->scan_stop) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        const uint32_t n = MIN(SCAN_CHUNK_SECTORS, fs->fsize - offset);
+        MSC_RETURN_ON_ERROR( msc_disk_read(vfs->disk, buf, fs->fatbase + offset, n) );
+        const uint32_t entries = MIN(n * entries_per_sector, fs->n_fatent - cluster);
+        for (uint32_t i = 0; i < entries; i++, cluster++) {
+            const uint32_t entry = fat32 ? (((const uint32_t *)buf)[i] & 0x0FFFFFFF) : ((const uint16_t *)buf)[i];
+            if (cluster >= 2 && entry == 0) {
+                count++;
+            }
+        }
+    }
+    *free_clusters = count;
+    return ESP_OK;
+}
+
+/**
+ * @brief Delay between attempts of the scan
+ *
+ * @return false if the scan has been stopped
+ */
+static bool vfs_scan_delay(msc_host_vfs_t *vfs, uint32_t delay_ms)
+{
+    xSemaphoreTake(vfs->scan_wake, pdMS_TO_TICKS(delay_ms));
+    return !vfs->scan_stop;
+}
+
+/**
+ * @brief Count free clusters, which are not known from FSINFO, without holding the volume
+ *
+ * FATFS would count them at the first f_getfree() by single sector reads, blocking the volume meanwhile.
+ * The count is used only if the FAT was not changed during the scan: no FAT sector was written
+ * and no cluster was allocated. It gets to FSINFO at the next sync.
+ */
+static void vfs_scan_task(void *arg)
+{
+    msc_host_vfs_t *vfs = (msc_host_vfs_t *)arg;
+    usb_disk_t *disk = vfs->disk;
+    uint8_t *buf = malloc(SCAN_CHUNK_SECTORS * disk->block_size);
+
+    for (int attempt = 0; buf && attempt < SCAN_ATTEMPTS; attempt++) {
+        if (!vfs_scan_delay(vfs, attempt ? SCAN_RETRY_DELAY_MS : 0)) {
+            break;
+        }
+        // Lazily registered volume is mounted here, only its boot sector and FSINFO are read
+        FATFS *fs = vfs->fs;
+        if (fs->fs_type == 0 && f_getlabel(vfs->drive, NULL, NULL) != FR_OK) {
+            break;
+        }
+        // FAT12 volumes are small, exFAT has the allocation bitmap counted by FATFS
+        if (fs->free_clst <= fs->n_fatent - 2 || (fs->fs_type != FS_FAT16 && fs->fs_type != FS_FAT32)) {
+            break;
+        }
+        const DWORD last_clst = fs->last_clst;
+        disk->watch_sector = fs->fatbase;
+        disk->watch_count = fs->fsize;
+        const uint32_t writes = disk->watch_writes;
+
+        uint32_t free_clusters;
+        const esp_err_t err = vfs_count_free_clusters(vfs, buf, &free_clusters);
+        if (err == ESP_ERR_INVALID_STATE) {
+            break;
+        }
+        const bool fat_dirty = fs->wflag && fs->winsect >= fs->fatbase && fs->winsect - fs->fatbase < fs->fsize;
+        if (err == ESP_OK && writes == disk->watch_writes && last_clst == fs->last_clst && !fat_dirty) {
+            fs->free_clst = free_clusters;
+            fs->fsi_flag |= 1;
+            ESP_LOGD(TAG, "%s %"PRIu32" free clusters", vfs->drive, free_clusters);
+            break;
+        }
+        ESP_LOGD(TAG, "%s FAT changed during the free space scan", vfs->drive);
+    }
+    disk->watch_count = 0;
+    free(buf);
+    xSemaphoreGive(vfs->scan_done);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t vfs_scan_start(msc_host_vfs_t *vfs)
+{
+    MSC_RETURN_ON_FALSE( vfs->scan_wake = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+    MSC_RETURN_ON_FALSE( vfs->scan_done = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+    BaseType_t task_created = xTaskCreate(vfs_scan_task, "USB MSC scan", SCAN_STACK_SIZE, vfs, SCAN_TASK_PRIORITY,
+                                          &vfs->scan_task);
+    MSC_RETURN_ON_FALSE( task_created, ESP_ERR_NO_MEM );
+    return ESP_OK;
+}
+
+static void vfs_scan_stop(msc_host_vfs_t *vfs)
+{
+    if (vfs->scan_task) {
+        vfs->scan_stop = true;
+        xSemaphoreGive(vfs->scan_wake);
+        xSemaphoreTake(vfs->scan_done, portMAX_DELAY);
+        vfs->scan_task = NULL;
+    }
+}
+
 esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
                                 const char *base_path,
                                 const esp_vfs_fat_mount_config_t *mount_config,
                                 msc_host_vfs_handle_t *vfs_handle)
+{
+    return msc_host_vfs_register_lun(device, 0, base_path, mount_config, vfs_handle);
+}
+
+esp_err_t msc_host_vfs_register_lun(msc_host_device_handle_t device,
+                                    uint8_t lun,
+                                    const char *base_path,
+                                    const esp_vfs_fat_mount_config_t *mount_config,
+                                    msc_host_vfs_handle_t *vfs_handle)
+{
+    return msc_host_vfs_register_ex(device, lun, base_path, mount_config, NULL, vfs_handle);
+}
+
+esp_err_t msc_host_vfs_register_ex(msc_host_device_handle_t device,
+                                   uint8_t lun,
+                                   const char *base_path,
+                                   const esp_vfs_fat_mount_config_t *mount_config,
+                                   const msc_host_vfs_options_t *options,
+                                   msc_host_vfs_handle_t *vfs_handle)
 {
     MSC_RETURN_ON_INVALID_ARG(device);
     MSC_RETURN_ON_INVALID_ARG(base_path);
@@ -85,7 +251,12 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
     bool diskio_registered = false;
     esp_err_t ret = ESP_ERR_MSC_MOUNT_FAILED;
     msc_device_t *dev = (msc_device_t *)device;
-    size_t block_size = dev->disk.block_size;
+    MSC_RETURN_ON_FALSE(lun < dev->lun_count, ESP_ERR_INVALID_ARG);
+    usb_disk_t *disk = &dev->luns[lun].disk;
+    // Logical unit without medium, e.g. empty slot of a card reader, or used as a raw block device
+    MSC_RETURN_ON_FALSE(disk->block_count, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(!dev->luns[lun].bdev_open, ESP_ERR_INVALID_STATE);
+    size_t block_size = disk->block_size;
     size_t alloc_size = mount_config->allocation_unit_size;
 
     msc_host_vfs_t *vfs = calloc(1, sizeof(msc_host_vfs_t));
@@ -93,17 +264,20 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
 
     MSC_GOTO_ON_ERROR( ff_diskio_get_drive(&pdrv) );
 
-    ff_diskio_register_msc(pdrv, &dev->disk);
+    ff_diskio_register_msc(pdrv, disk);
     char drive[DRIVE_STR_LEN] = {(char)('0' + pdrv), ':', 0};
     diskio_registered = true;
 
     strncpy(vfs->drive, drive, DRIVE_STR_LEN);
     MSC_GOTO_ON_FALSE( vfs->base_path = strdup(base_path), ESP_ERR_NO_MEM );
     vfs->pdrv = pdrv;
+    vfs->disk = disk;
 
     MSC_GOTO_ON_ERROR( esp_vfs_fat_register(base_path, drive, mount_config->max_files, &fs) );
+    vfs->fs = fs;
 
-    FRESULT fresult = f_mount(fs, drive, 1);
+    const bool lazy = options && options->lazy_mount;
+    FRESULT fresult = f_mount(fs, drive, lazy ? 0 : 1);
 
     if ( fresult != FR_OK) {
         if (mount_config->format_if_mount_failed &&
@@ -115,10 +289,15 @@ esp_err_t msc_host_vfs_register(msc_host_device_handle_t device,
         }
     }
 
+    if (options && options->scan_free_space) {
+        MSC_GOTO_ON_ERROR( vfs_scan_start(vfs) );
+    }
+
     *vfs_handle = vfs;
     return ESP_OK;
 
 fail:
+    vfs_scan_stop(vfs);
     if (diskio_registered) {
         ff_diskio_unregister(pdrv);
     }
@@ -135,9 +314,136 @@ esp_err_t msc_host_vfs_unregister(msc_host_vfs_handle_t vfs_handle)
     MSC_RETURN_ON_INVALID_ARG(vfs_handle);
     msc_host_vfs_t *vfs = (msc_host_vfs_t *)vfs_handle;
 
+    vfs_scan_stop(vfs);
     f_mount(NULL, vfs->drive, 0);
     ff_diskio_unregister(vfs->pdrv);
     esp_vfs_fat_unregister_path(vfs->base_path);
     dealloc_msc_vfs(vfs);
     return ESP_OK;
 }
+
+esp_err_t msc_host_vfs_get_free_space(msc_host_vfs_handle_t vfs_handle, uint64_t *total_bytes, uint64_t *free_bytes)
+{
+    MSC_RETURN_ON_INVALID_ARG(vfs_handle);
+    MSC_RETURN_ON_INVALID_ARG(total_bytes);
+    MSC_RETURN_ON_INVALID_ARG(free_bytes);
+    const FATFS *fs = vfs_handle->fs;
+
+    // Not mounted yet, or the free clusters were not counted
+    MSC_RETURN_ON_FALSE(fs->fs_type != 0, ESP_ERR_INVALID_STATE);
+    const DWORD free_clst = fs->free_clst;
+    MSC_RETURN_ON_FALSE(free_clst <= fs->n_fatent - 2, ESP_ERR_INVALID_STATE);
+
+    const uint64_t cluster_size = (uint64_t)fs->csize * vfs_handle->disk->block_size;
+    *total_bytes = (uint64_t)(fs->n_fatent - 2) * cluster_size;
+    *free_bytes = (uint64_t)free_clst * cluster_size;
+    return ESP_OK;
+}
+
+#if FF_USE_EXPAND
+esp_err_t msc_host_vfs_stream_open(msc_host_vfs_handle_t vfs_handle, const char *path, uint64_t size,
+                                   msc_host_stream_handle_t *stream)
+{
+    MSC_RETURN_ON_INVALID_ARG(vfs_handle);
+    MSC_RETURN_ON_INVALID_ARG(path);
+    MSC_RETURN_ON_INVALID_ARG(stream);
+    MSC_RETURN_ON_FALSE(size > 0 && (FSIZE_t)size == size, ESP_ERR_INVALID_ARG);
+
+    esp_err_t ret = ESP_FAIL;
+    msc_host_vfs_t *vfs = (msc_host_vfs_t *)vfs_handle;
+    const size_t base_len = strlen(vfs->base_path);
+    MSC_RETURN_ON_FALSE(strncmp(path, vfs->base_path, base_len) == 0 && path[base_len] == '/', ESP_ERR_INVALID_ARG);
+
+    // FATFS path is the drive followed by the path under the base path
+    const size_t fatfs_path_size = strlen(vfs->drive) + strlen(path + base_len) + 1;
+    char *fatfs_path = malloc(fatfs_path_size);
+    MSC_RETURN_ON_FALSE(fatfs_path, ESP_ERR_NO_MEM);
+    snprintf(fatfs_path, fatfs_path_size, "%s%s", vfs->drive, path + base_len);
+    msc_host_stream_t *s = calloc(1, sizeof(msc_host_stream_t));
+    MSC_GOTO_ON_FALSE(s, ESP_ERR_NO_MEM);
+
+    MSC_GOTO_ON_FALSE(f_open(&s->file, fatfs_path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK, ESP_FAIL);
+    if (f_expand(&s->file, (FSIZE_t)size, 1) != FR_OK || f_sync(&s->file) != FR_OK) {
+        ESP_LOGE(TAG, "Preallocation of %"PRIu64" bytes failed", size);
+        f_close(&s->file);
+        f_unlink(fatfs_path);
+        goto fail;
+    }
+
+    const FATFS *fs = s->file.obj.fs;
+    s->disk = vfs->disk;
+    s->first_sector = fs->database + (LBA_t)(s->file.obj.sclust - 2) * fs->csize;
+    s->size = size;
+    free(fatfs_path);
+    *stream = s;
+    return ESP_OK;
+
+fail:
+    free(fatfs_path);
+    free(s);
+    return ret;
+}
+
+esp_err_t msc_host_vfs_stream_write(msc_host_stream_handle_t stream, const void *data, size_t size)
+{
+    MSC_RETURN_ON_INVALID_ARG(stream);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_FALSE(!stream->finished, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(size <= stream->size - stream->written, ESP_ERR_INVALID_SIZE);
+
+    const uint32_t block_size = stream->disk->block_size;
+    const uint64_t sector = stream->first_sector + stream->written / block_size;
+    const uint32_t count = size / block_size;
+    const size_t tail = size % block_size;
+
+    // Sectors go directly to the clusters, no FAT or directory update for each write
+    if (count) {
+        MSC_RETURN_ON_ERROR( msc_disk_write(stream->disk, data, sector, count) );
+    }
+    if (tail) {
+        uint8_t *last = calloc(1, block_size);
+        MSC_RETURN_ON_FALSE(last, ESP_ERR_NO_MEM);
+        memcpy(last, (const uint8_t *)data + (size_t)count * block_size, tail);
+        const esp_err_t ret = msc_disk_write(stream->disk, last, sector + count, 1);
+        free(last);
+        MSC_RETURN_ON_ERROR(ret);
+        stream->finished = true;
+    }
+    stream->written += size;
+    return ESP_OK;
+}
+
+esp_err_t msc_host_vfs_stream_close(msc_host_stream_handle_t stream)
+{
+    MSC_RETURN_ON_INVALID_ARG(stream);
+    esp_err_t ret = ESP_OK;
+
+    // Written sectors held by the cache are written before the file gets its size
+    if (msc_disk_sync(stream->disk) != ESP_OK ||
+            f_lseek(&stream->file, (FSIZE_t)stream->written) != FR_OK ||
+            f_truncate(&stream->file) != FR_OK) {
+        ret = ESP_FAIL;
+    }
+    if (f_close(&stream->file) != FR_OK) {
+        ret = ESP_FAIL;
+    }
+    free(stream);
+    return ret;
+}
+#else
+esp_err_t msc_host_vfs_stream_open(msc_host_vfs_handle_t vfs_handle, const char *path, uint64_t size,
+                                   msc_host_stream_handle_t *stream)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t msc_host_vfs_stream_write(msc_host_stream_handle_t stream, const void *data, size_t size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t msc_host_vfs_stream_close(msc_host_stream_handle_t stream)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif // FF_USE_EXPAND
@@ -0,0 +1,471 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/queue.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "msc_common.h"
+#include "msc_sched.h"
+
+static const char *TAG = "USB_MSC_SCHED";
+
+#define SCHED_DEVICE_INFLIGHT_DEFAULT (2)  // Requests of one device on the bus, if not configured
+#define SCHED_AGING_LIMIT (8)              // Dispatches of higher classes, after which a waiting class goes first
+#define STRIPE_SECTORS_DEFAULT (64)        // Sectors of one chunk of a striped volume, if not configured
+
+typedef struct msc_sched_request {
+    STAILQ_ENTRY(msc_sched_request) entry;
+    msc_device_t *device;
+    uint8_t lun;
+    bool write;
+    uint64_t sector;
+    uint32_t count;
+    void *data;
+    msc_host_io_cb_t callback;
+    void *arg;
+} msc_sched_request_t;
+
+typedef STAILQ_HEAD(msc_sched_list, msc_sched_request) msc_sched_list_t;
+
+typedef struct {
+    msc_sched_request_t *requests;  // Pool of queue_size requests
+    msc_sched_list_t free;
+    msc_sched_list_t pending[MSC_HOST_IO_PRIORITY_MAX];
+    uint8_t passed[MSC_HOST_IO_PRIORITY_MAX]; // Dispatches of higher classes, while this class was waiting
+    SemaphoreHandle_t lock;         // Protects the lists and the counters
+    SemaphoreHandle_t slots;        // Free requests of the pool, submitters wait for them
+    SemaphoreHandle_t stopped;      // Given by the scheduler task, when it ends
+    TaskHandle_t task;
+    size_t inflight;                // Requests dispatched to all devices
+    size_t max_inflight;
+    size_t device_inflight;
+    uint32_t sequence;              // Dispatch sequence number, devices served longest ago have the turn
+    volatile bool stop;
+} msc_sched_t;
+
+struct msc_host_stripe {
+    msc_host_stripe_config_t config;
+    uint32_t block_size;
+    uint64_t block_count;
+    SemaphoreHandle_t lock;         // One read or write of the volume at a time
+    SemaphoreHandle_t done;         // Given by completion of each chunk
+    portMUX_TYPE status_lock;
+    esp_err_t status;               // Error of the first failed chunk
+};
+
+static msc_sched_t *s_sched;
+
+/**
+ * @brief Return the request to the pool and complete it
+ *
+ * The request is released before the callback, so that the callback can queue another one.
+ */
+static void sched_finish(msc_sched_request_t *request, bool dispatched, esp_err_t status)
+{
+    msc_device_t *device = request->device;
+    const msc_host_io_cb_t callback = request->callback;
+    void *arg = request->arg;
+
+    xSemaphoreTake(s_sched->lock, portMAX_DELAY);
+    if (dispatched) {
+        s_sched->inflight--;
+        device->sched_inflight--;
+    }
+    STAILQ_INSERT_TAIL(&s_sched->free, request, entry);
+    xSemaphoreGive(s_sched->lock);
+    xSemaphoreGive(s_sched->slots);
+    xTaskNotifyGive(s_sched->task);
+
+    callback(device, status, arg);
+}
+
+static void sched_complete(msc_host_device_handle_t device, esp_err_t status, void *arg)
+{
+    sched_finish((msc_sched_request_t *)arg, true, status);
+}
+
+/**
+ * @brief Take the first request of the device served longest ago, which can take another request
+ */
+static msc_sched_request_t *sched_pick_class(msc_sched_list_t *list)
+{
+    msc_sched_request_t *best = NULL;
+    msc_sched_request_t *request;
+
+    STAILQ_FOREACH(request, list, entry) {
+        const msc_device_t *device = request->device;
+        if (device->sched_inflight >= s_sched->device_inflight) {
+            continue;
+        }
+        // Only an earlier served device replaces the best one, so requests of a device keep their order
+        if (!best || (int32_t)(device->sched_served - best->device->sched_served) < 0) {
+            best = request;
+        }
+    }
+    return best;
+}
+
+static msc_sched_request_t *sched_pick(int *priority)
+{
+    msc_sched_request_t *request;
+
+    if (s_sched->inflight >= s_sched->max_inflight) {
+        return NULL;
+    }
+    // A class passed over too many times goes first, so that lower priorities are not starved
+    for (int p = MSC_HOST_IO_PRIORITY_MAX - 1; p > 0; p--) {
+        if (s_sched->passed[p] >= SCHED_AGING_LIMIT && (request = sched_pick_class(&s_sched->pending[p]))) {
+            *priority = p;
+            return request;
+        }
+    }
+    for (int p = 0; p < MSC_HOST_IO_PRIORITY_MAX; p++) {
+        if ((request = sched_pick_class(&s_sched->pending[p]))) {
+            *priority = p;
+            return request;
+        }
+    }
+    return NULL;
+}
+
+static void sched_dispatched(msc_sched_request_t *request, int priority)
+{
+    STAILQ_REMOVE(&s_sched->pending[priority], request, msc_sched_request, entry);
+    s_sched->passed[priority] = 0;
+    for (int p = priority + 1; p < MSC_HOST_IO_PRIORITY_MAX; p++) {
+        if (!STAILQ_EMPTY(&s_sched->pending[p]) && s_sched->passed[p] < UINT8_MAX) {
+            s_sched->passed[p]++;
+        }
+    }
+    s_sched->inflight++;
+    request->device->sched_inflight++;
+    request->device->sched_served = ++s_sched->sequence;
+}
+
+static void sched_task(void *arg)
+{
+    while (!s_sched->stop) {
+        int priority;
+
+        xSemaphoreTake(s_sched->lock, portMAX_DELAY);
+        msc_sched_request_t *request = sched_pick(&priority);
+        if (request) {
+            sched_dispatched(request, priority);
+        }
+        xSemaphoreGive(s_sched->lock);
+
+        if (!request) {
+            // Woken up by a new request or a completion
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        // Worker queue of the device has room, as long as device_inflight does not exceed its size
+        const esp_err_t err = request->write ?
+                              msc_host_write_async(request->device, request->lun, request->sector, request->count,
+                                                   request->data, sched_complete, request) :
+                              msc_host_read_async(request->device, request->lun, request->sector, request->count,
+                                                  request->data, sched_complete, request);
+        if (err != ESP_OK) {
+            ESP_LOGD(TAG, "Request of LUN %d was not dispatched (%d)", request->lun, err);
+            sched_finish(request, true, err);
+        }
+    }
+
+    xSemaphoreGive(s_sched->stopped);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t sched_submit(msc_host_device_handle_t handle, bool write, uint8_t lun,
+                              msc_host_io_priority_t priority, uint64_t sector, uint32_t count, void *data,
+                              msc_host_io_cb_t callback, void *arg)
+{
+    MSC_RETURN_ON_INVALID_ARG(handle);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_INVALID_ARG(callback);
+    MSC_RETURN_ON_FALSE(count > 0, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(priority >= 0 && priority < MSC_HOST_IO_PRIORITY_MAX, ESP_ERR_INVALID_ARG);
+    msc_device_t *device = (msc_device_t *)handle;
+    MSC_RETURN_ON_FALSE(s_sched && device->async, ESP_ERR_INVALID_STATE);
+    MSC_RETURN_ON_FALSE(lun < device->lun_count, ESP_ERR_INVALID_ARG);
+
+    xSemaphoreTake(s_sched->slots, portMAX_DELAY);
+    xSemaphoreTake(s_sched->lock, portMAX_DELAY);
+    msc_sched_request_t *request = STAILQ_FIRST(&s_sched->free);
+    STAILQ_REMOVE_HEAD(&s_sched->free, entry);
+    request->device = device;
+    request->lun = lun;
+    request->write = write;
+    request->sector = sector;
+    request->count = count;
+    request->data = data;
+    request->callback = callback;
+    request->arg = arg;
+    STAILQ_INSERT_TAIL(&s_sched->pending[priority], request, entry);
+    xSemaphoreGive(s_sched->lock);
+    xTaskNotifyGive(s_sched->task);
+    return ESP_OK;
+}
+
+esp_err_t msc_host_sched_read(msc_host_device_handle_t device, uint8_t lun, msc_host_io_priority_t priority,
+                              uint64_t sector, uint32_t count, void *data, msc_host_io_cb_t callback, void *arg)
+{
+    return sched_submit(device, false, lun, priority, sector, count, data, callback, arg);
+}
+
+esp_err_t msc_host_sched_write(msc_host_device_handle_t device, uint8_t lun, msc_host_io_priority_t priority,
+                               uint64_t sector, uint32_t count, const void *data, msc_host_io_cb_t callback,
+                               void *arg)
+{
+    return sched_submit(device, true, lun, priority, sector, count, (void *)data, callback, arg);
+}
+
+esp_err_t msc_sched_install(const msc_host_sched_config_t *config, const msc_host_async_config_t *async_config)
+{
+    esp_err_t ret;
+
+    if (config->queue_size == 0) {
+        return ESP_OK;
+    }
+    MSC_RETURN_ON_FALSE(async_config->queue_size != 0, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(config->stack_size != 0, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(config->task_priority != 0, ESP_ERR_INVALID_ARG);
+    const size_t device_inflight = config->device_inflight ? config->device_inflight : SCHED_DEVICE_INFLIGHT_DEFAULT;
+    MSC_RETURN_ON_FALSE(device_inflight <= async_config->queue_size && device_inflight <= UINT8_MAX,
+                        ESP_ERR_INVALID_ARG);
+
+    msc_sched_t *sched = calloc(1, sizeof(msc_sched_t));
+    MSC_RETURN_ON_FALSE(sched, ESP_ERR_NO_MEM);
+    MSC_GOTO_ON_FALSE( sched->requests = calloc(config->queue_size, sizeof(msc_sched_request_t)), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( sched->lock = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( sched->slots = xSemaphoreCreateCounting(config->queue_size, config->queue_size),
+                       ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( sched->stopped = xSemaphoreCreateBinary(), ESP_ERR_NO_MEM );
+
+    STAILQ_INIT(&sched->free);
+    for (int p = 0; p < MSC_HOST_IO_PRIORITY_MAX; p++) {
+        STAILQ_INIT(&sched->pending[p]);
+    }
+    for (size_t i = 0; i < config->queue_size; i++) {
+        STAILQ_INSERT_TAIL(&sched->free, &sched->requests[i], entry);
+    }
+    sched->max_inflight = config->max_inflight ? config->max_inflight : config->queue_size;
+    sched->device_inflight = device_inflight;
+
+    s_sched = sched;
+    BaseType_t task_created = xTaskCreatePinnedToCore(sched_task, "USB MSC sched", config->stack_size, NULL,
+                                                      config->task_priority, &sched->task, config->core_id);
+    MSC_GOTO_ON_FALSE(task_created, ESP_ERR_NO_MEM);
+    return ESP_OK;
+
+fail:
+    s_sched = NULL;
+    if (sched->lock) {
+        vSemaphoreDelete(sched->lock);
+    }
+    if (sched->slots) {
+        vSemaphoreDelete(sched->slots);
+    }
+    if (sched->stopped) {
+        vSemaphoreDelete(sched->stopped);
+    }
+    free(sched->requests);
+    free(sched);
+    return ret;
+}
+
+void msc_sched_uninstall(void)
+{
+    msc_sched_t *sched = s_sched;
+    if (!sched) {
+        return;
+    }
+
+    sched->stop = true;
+    xTaskNotifyGive(sched->task);
+    xSemaphoreTake(sched->stopped, portMAX_DELAY);
+
+    s_sched = NULL;
+    vSemaphoreDelete(sched->lock);
+    vSemaphoreDelete(sched->slots);
+    vSemaphoreDelete(sched->stopped);
+    free(sched->requests);
+    free(sched);
+}
+
+void msc_sched_remove_device(msc_device_t *device)
+{
+    msc_sched_list_t removed = STAILQ_HEAD_INITIALIZER(removed);
+    msc_sched_request_t *request;
+    msc_sched_request_t *next;
+
+    if (!s_sched) {
+        return;
+    }
+
+    xSemaphoreTake(s_sched->lock, portMAX_DELAY);
+    for (int p = 0; p < MSC_HOST_IO_PRIORITY_MAX; p++) {
+        STAILQ_FOREACH_SAFE(request, &s_sched->pending[p], entry, next) {
+            if (request->device == device) {
+                STAILQ_REMOVE(&s_sched->pending[p], request, msc_sched_request, entry);
+                STAILQ_INSERT_TAIL(&removed, request, entry);
+            }
+        }
+    }
+    xSemaphoreGive(s_sched->lock);
+
+    while ((request = STAILQ_FIRST(&removed))) {
+        STAILQ_REMOVE_HEAD(&removed, entry);
+        sched_finish(request, false, ESP_ERR_INVALID_STATE);
+    }
+}
+
+static void stripe_complete(msc_host_device_handle_t device, esp_err_t status, void *arg)
+{
+    msc_host_stripe_handle_t stripe = (msc_host_stripe_handle_t)arg;
+
+    if (status != ESP_OK) {
+        portENTER_CRITICAL(&stripe->status_lock);
+        if (stripe->status == ESP_OK) {
+            stripe->status = status;
+        }
+        portEXIT_CRITICAL(&stripe->status_lock);
+    }
+    xSemaphoreGive(stripe->done);
+}
+
+esp_err_t msc_host_stripe_create(const msc_host_stripe_config_t *config, msc_host_stripe_handle_t *stripe_handle)
+{
+    esp_err_t ret;
+
+    MSC_RETURN_ON_INVALID_ARG(config);
+    MSC_RETURN_ON_INVALID_ARG(stripe_handle);
+    MSC_RETURN_ON_FALSE(config->device_count >= 2 && config->device_count <= MSC_HOST_STRIPE_MAX_DEVICES,
+                        ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(config->priority >= 0 && config->priority < MSC_HOST_IO_PRIORITY_MAX, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(s_sched, ESP_ERR_INVALID_STATE);
+
+    const uint32_t chunk = config->stripe_sectors ? config->stripe_sectors : STRIPE_SECTORS_DEFAULT;
+    uint32_t block_size = 0;
+    uint64_t member_blocks = UINT64_MAX;
+    for (size_t i = 0; i < config->device_count; i++) {
+        const msc_device_t *device = (const msc_device_t *)config->members[i].device;
+        MSC_RETURN_ON_INVALID_ARG(device);
+        MSC_RETURN_ON_FALSE(config->members[i].lun < device->lun_count, ESP_ERR_INVALID_ARG);
+        const usb_disk_t *disk = &device->luns[config->members[i].lun].disk;
+        MSC_RETURN_ON_FALSE(disk->block_count, ESP_ERR_INVALID_STATE);
+        MSC_RETURN_ON_FALSE(!block_size || disk->block_size == block_size, ESP_ERR_INVALID_ARG);
+        block_size = disk->block_size;
+        member_blocks = MIN(member_blocks, disk->block_count);
+    }
+    // Only whole chunks of the smallest logical unit are used
+    member_blocks -= member_blocks % chunk;
+    MSC_RETURN_ON_FALSE(member_blocks, ESP_ERR_INVALID_ARG);
+
+    msc_host_stripe_handle_t stripe = calloc(1, sizeof(struct msc_host_stripe));
+    MSC_RETURN_ON_FALSE(stripe, ESP_ERR_NO_MEM);
+    MSC_GOTO_ON_FALSE( stripe->lock = xSemaphoreCreateMutex(), ESP_ERR_NO_MEM );
+    MSC_GOTO_ON_FALSE( stripe->done = xSemaphoreCreateCounting(UINT32_MAX, 0), ESP_ERR_NO_MEM );
+    portMUX_INITIALIZE(&stripe->status_lock);
+    stripe->config = *config;
+    stripe->config.stripe_sectors = chunk;
+    stripe->block_size = block_size;
+    stripe->block_count = member_blocks * config->device_count;
+
+    ESP_LOGD(TAG, "Striped volume of %d devices, %"PRIu64" sectors", (int)config->device_count, stripe->block_count);
+    *stripe_handle = stripe;
+    return ESP_OK;
+
+fail:
+    if (stripe->lock) {
+        vSemaphoreDelete(stripe->lock);
+    }
+    free(stripe);
+    return ret;
+}
+
+esp_err_t msc_host_stripe_delete(msc_host_stripe_handle_t stripe)
+{
+    MSC_RETURN_ON_INVALID_ARG(stripe);
+
+    // Wait for a read or write in progress
+    xSemaphoreTake(stripe->lock, portMAX_DELAY);
+    vSemaphoreDelete(stripe->lock);
+    vSemaphoreDelete(stripe->done);
+    free(stripe);
+    return ESP_OK;
+}
+
+esp_err_t msc_host_stripe_get_info(msc_host_stripe_handle_t stripe, msc_host_lun_info_t *info)
+{
+    MSC_RETURN_ON_INVALID_ARG(stripe);
+    MSC_RETURN_ON_INVALID_ARG(info);
+
+    info->sector_count = stripe->block_count;
+    info->sector_size = stripe->block_size;
+    return ESP_OK;
+}
+
+static esp_err_t stripe_io(msc_host_stripe_handle_t stripe, bool write, uint64_t sector, uint32_t count,
+                           uint8_t *data)
+{
+    MSC_RETURN_ON_INVALID_ARG(stripe);
+    MSC_RETURN_ON_INVALID_ARG(data);
+    MSC_RETURN_ON_FALSE(count > 0, ESP_ERR_INVALID_ARG);
+    MSC_RETURN_ON_FALSE(sector < stripe->block_count && count <= stripe->block_count - sector, ESP_ERR_INVALID_ARG);
+
+    const msc_host_stripe_config_t *config = &stripe->config;
+    const uint32_t chunk = config->stripe_sectors;
+    esp_err_t ret = ESP_OK;
+    size_t submitted = 0;
+
+    xSemaphoreTake(stripe->lock, portMAX_DELAY);
+    stripe->status = ESP_OK;
+    // All chunks are queued at once, the scheduler lets the devices take turns and their workers merge
+    // adjacent chunks of the device into one command
+    while (count > 0) {
+        const uint64_t index = sector / chunk;
+        const uint32_t offset = sector % chunk;
+        const uint32_t part = MIN(count, chunk - offset);
+        const size_t member = index % config->device_count;
+        const uint64_t member_sector = (index / config->device_count) * chunk + offset;
+
+        ret = sched_submit(config->members[member].device, write, config->members[member].lun, config->priority,
+                           member_sector, part, data, stripe_complete, stripe);
+        if (ret != ESP_OK) {
+            break;
+        }
+        submitted++;
+        sector += part;
+        count -= part;
+        data += (size_t)part * stripe->block_size;
+    }
+    for (size_t i = 0; i < submitted; i++) {
+        xSemaphoreTake(stripe->done, portMAX_DELAY);
+    }
+    if (ret == ESP_OK) {
+        ret = stripe->status;
+    }
+    xSemaphoreGive(stripe->lock);
+    return ret;
+}
+
+esp_err_t msc_host_stripe_read(msc_host_stripe_handle_t stripe, uint64_t sector, uint32_t count, void *data)
+{
+    return stripe_io(stripe, false, sector, count, (uint8_t *)data);
+}
+
+esp_err_t msc_host_stripe_write(msc_host_stripe_handle_t stripe, uint64_t sector, uint32_t count,
+                                const void *data)
+{
+    return stripe_io(stripe, true, sector, count, (uint8_t *)data);
+}
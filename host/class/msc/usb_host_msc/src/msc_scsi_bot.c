@@ -6,16 +6,20 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 #include "esp_log.h"
 #include "inttypes.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <sys/param.h>
 #include "esp_check.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "msc_common.h"
 #include "msc_scsi_bot.h"
+#include "msc_uas.h"
 #include "usb/msc_host.h"
 
 static const char *TAG = "USB_MSC_SCSI";
@@ -44,6 +48,35 @@ static const char *TAG = "USB_MSC_SCSI";
 #define SCSI_CMD_WRITE10 0x2A
 #define SCSI_CMD_WRITE12 0xAA
 #define SCSI_CMD_WRITE_AND_VERIFY 0x2E
+#define SCSI_CMD_READ16 0x88
+#define SCSI_CMD_WRITE16 0x8A
+#define SCSI_CMD_SERVICE_ACTION_IN16 0x9E
+#define SCSI_CMD_UNMAP 0x42
+#define SCSI_CMD_SYNCHRONIZE_CACHE10 0x35
+#define SCSI_SERVICE_ACTION_READ_CAPACITY16 0x10
+
+#define SCSI_SENSE_KEY_MASK         0x0F
+#define SCSI_SENSE_NOT_READY        0x02
+#define SCSI_SENSE_ILLEGAL_REQUEST  0x05
+#define SCSI_SENSE_UNIT_ATTENTION   0x06
+
+#define SENSE_UA_RETRIES    (3)                 // Unit attentions reported in a row, e.g. reset and medium change
+#define SENSE_LOG_PERIOD_US (1000 * 1000)       // Repeated sense data are logged once in the period
+
+#define SCSI_INQUIRY_EVPD (1 << 0)
+#define SCSI_VPD_SUPPORTED_PAGES 0x00
+#define SCSI_VPD_BLOCK_LIMITS 0xB0
+#define SCSI_VPD_LOGICAL_BLOCK_PROVISIONING 0xB2
+#define SCSI_VPD_LBPU (1 << 7) // UNMAP is supported
+
+#define SCSI_MODE_SENSE_DBD (1 << 3)   // No block descriptors
+#define SCSI_MODE_SELECT_PF (1 << 4)   // Page format
+#define SCSI_MODE_PAGE_CACHING 0x08
+#define SCSI_MODE_PAGE_CODE_MASK 0x3F  // PS and SPF bits of the page are cleared for MODE SELECT
+#define SCSI_CACHING_WCE (1 << 2)      // Write cache enable
+
+#define SCSI_READ_CAPACITY10_MAX_LBA 0xFFFFFFFF // READ CAPACITY(16) must be used to get the capacity
+#define SCSI_CMD10_MAX_SECTORS UINT16_MAX
 
 #define IN_DIR   CWB_FLAG_DIRECTION_IN
 #define OUT_DIR  0
@@ -54,17 +87,18 @@ static const char *TAG = "USB_MSC_SCSI";
 
 #define CBW_CMD_SIZE(cmd) (sizeof(cmd) - sizeof(msc_cbw_t))
 
-#define CBW_BASE_INIT(dir, cbw_len, data_len)   \
+#define CBW_BASE_INIT(lun_num, dir, cbw_len, data_len) \
     .base = {                                   \
         .signature = 0x43425355,                \
         .tag = ++cbw_tag,                       \
         .flags = dir,                           \
-        .lun = 0,                               \
+        .lun = lun_num,                         \
         .data_length = data_len,                \
         .cbw_length = cbw_len,                  \
     }
 
 #define CSW_SIGNATURE   0x53425355
+#define CSW_STATUS_PHASE_ERROR 0x02
 #define CBW_SIZE        31
 
 #define CWB_FLAG_DIRECTION_IN (1<<7) // device -> host
@@ -142,6 +176,17 @@ typedef struct __attribute__((packed))
     uint8_t reserved2[1];
 } cbw_write10_t;
 
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t flags;
+    uint64_t address;
+    uint32_t length;
+    uint8_t group;
+    uint8_t control;
+} cbw_rw16_t;
+
 typedef struct __attribute__((packed))
 {
     msc_cbw_t base;
@@ -151,6 +196,24 @@ typedef struct __attribute__((packed))
     uint8_t reserved[6];
 } cbw_read_capacity_t;
 
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t service_action;
+    uint64_t address;
+    uint32_t allocation_length;
+    uint8_t reserved;
+    uint8_t control;
+} cbw_read_capacity16_t;
+
+typedef struct __attribute__((packed))
+{
+    uint64_t block_count;
+    uint32_t block_size;
+    uint8_t reserved[20];
+} cbw_read_capacity16_response_t;
+
 typedef struct __attribute__((packed))
 {
     uint32_t block_count;
@@ -215,6 +278,61 @@ typedef struct __attribute__((packed))
     uint8_t data[8];
 } mode_sense_response_t;
 
+/**
+ * @brief MODE SELECT(10) command
+ *
+ * @see SCSI Primary Commands - 4 (SPC-4), Table 153
+ */
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t flags;
+    uint8_t reserved_0[5];
+    uint16_t parameter_list_length;
+    uint8_t control;
+    uint8_t reserved_1[6];  // Pads the CDB to the size of CBW
+} mode_select_t;
+
+#define MODE_SELECT_CDB_SIZE (offsetof(mode_select_t, reserved_1) - sizeof(msc_cbw_t))
+
+/**
+ * @brief Mode parameter header(10) followed by the Caching mode page, without block descriptors
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 192
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t mode_data_length;
+    uint8_t medium_type;
+    uint8_t device_specific;
+    uint8_t reserved_0[2];
+    uint16_t block_descriptor_length;
+    uint8_t page_code;
+    uint8_t page_length;
+    uint8_t flags;
+    uint8_t parameters[17];
+} mode_caching_page_t;
+
+/**
+ * @brief SYNCHRONIZE CACHE(10) command
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 75
+ */
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t flags;
+    uint32_t address;
+    uint8_t group;
+    uint16_t length;
+    uint8_t control;
+    uint8_t reserved[6];    // Pads the CDB to the size of CBW
+} cbw_sync_cache_t;
+
+#define SYNC_CACHE_CDB_SIZE (offsetof(cbw_sync_cache_t, reserved) - sizeof(msc_cbw_t))
+
 typedef struct __attribute__((packed))
 {
     msc_cbw_t base;
@@ -230,13 +348,98 @@ typedef struct __attribute__((packed))
     uint8_t data[36];
 } cbw_inquiry_response_t;
 
+typedef struct __attribute__((packed))
+{
+    msc_cbw_t base;
+    uint8_t opcode;
+    uint8_t anchor;
+    uint8_t reserved_0[4];
+    uint8_t group;
+    uint16_t parameter_list_length;
+    uint8_t control;
+    uint8_t reserved_1[6];  // Pads the CDB to the size of CBW
+} cbw_unmap_t;
+
+#define UNMAP_CDB_SIZE (offsetof(cbw_unmap_t, reserved_1) - sizeof(msc_cbw_t))
+
+/**
+ * @brief UNMAP parameter list with one block descriptor
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 97
+ */
+typedef struct __attribute__((packed))
+{
+    uint16_t data_length;
+    uint16_t block_descriptor_data_length;
+    uint8_t reserved_0[4];
+    uint64_t address;
+    uint32_t length;
+    uint8_t reserved_1[4];
+} unmap_parameter_list_t;
+
+/**
+ * @brief Block Limits VPD page
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 181
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t device_type;
+    uint8_t page_code;
+    uint16_t page_length;
+    uint8_t reserved_0[2];
+    uint16_t optimal_transfer_length_granularity;
+    uint32_t max_transfer_length;
+    uint32_t optimal_transfer_length;
+    uint32_t max_prefetch_length;
+    uint32_t max_unmap_lba_count;
+    uint32_t max_unmap_block_descriptor_count;
+    uint32_t optimal_unmap_granularity;
+    uint32_t unmap_granularity_alignment;
+    uint8_t reserved_1[28];
+} vpd_block_limits_t;
+
+/**
+ * @brief Logical Block Provisioning VPD page
+ *
+ * @see SCSI Block Commands - 3 (SBC-3), Table 185
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t device_type;
+    uint8_t page_code;
+    uint16_t page_length;
+    uint8_t threshold_exponent;
+    uint8_t flags;
+    uint8_t provisioning_type;
+    uint8_t reserved;
+} vpd_logical_block_provisioning_t;
+
+typedef struct __attribute__((packed))
+{
+    uint8_t device_type;
+    uint8_t page_code;
+    uint8_t reserved;
+    uint8_t page_length;
+    uint8_t pages[32];
+} vpd_supported_pages_t;
+
 // Unique number based on which MSC protocol pairs request and response
 static uint32_t cbw_tag;
 
+esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data, size_t size);
+
+/**
+ * @brief Check status of the command
+ *
+ * @return ESP_FAIL if the command failed and sense data are available,
+ *         ESP_ERR_INVALID_RESPONSE if the status is not valid or the device reports phase error
+ */
 static esp_err_t check_csw(msc_csw_t *csw, uint32_t tag)
 {
-    const bool csw_ok = csw->signature == CSW_SIGNATURE && csw->tag == tag &&
-                        csw->dataResidue == 0 && csw->status == 0;
+    const bool csw_valid = csw->signature == CSW_SIGNATURE && csw->tag == tag &&
+                           csw->status != CSW_STATUS_PHASE_ERROR;
+    const bool csw_ok = csw_valid && csw->dataResidue == 0 && csw->status == 0;
 
     if (!csw_ok) {
         ESP_LOGV(TAG, "CSW failed: dCSWSignature = 0x%02"PRIx32", dCSWTag = 0x%02"PRIx32", dCSWDataResidue = 0x%02"PRIx32"",
@@ -244,49 +447,48 @@ static esp_err_t check_csw(msc_csw_t *csw, uint32_t tag)
         ESP_LOGD(TAG, "CSW failed: bCSWStatus 0x%02"PRIx8"", csw->status);
     }
 
-    return csw_ok ? ESP_OK : ESP_FAIL;
+    return csw_ok ? ESP_OK : csw_valid ? ESP_FAIL : ESP_ERR_INVALID_RESPONSE;
 }
 
 /**
- * @brief Execute BOT command
+ * @brief Execute BOT command with data in segments
  *
- * There are multiple stages in BOT command:
- * 1. Command transport
- * 2. Data transport (optional)
- * 3. Status transport
- * 3.1. Error recovery (in case of error)
- *
- * This function is not 'static' so it could be called from unit test
- *
- * @see USB Mass Storage Class – Bulk Only Transport, Chapter 5.3
- *
- * @param[in] device MSC device handle
- * @param[in] cbw    Command Block Wrapper
- * @param[in] data   Data (optional)
- * @param[in] size   Size of data in bytes
- * @return esp_err_t
+ * Data transport of the command is split into transfers of the segments.
  */
-esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data, size_t size)
+static esp_err_t bot_execute_segments(msc_device_t *device, msc_cbw_t *cbw, const msc_data_segment_t *segments,
+                                      size_t segment_count)
 {
     msc_csw_t csw;
     msc_endpoint_t ep = (cbw->flags & CWB_FLAG_DIRECTION_IN) ? MSC_EP_IN : MSC_EP_OUT;
+    esp_err_t err;
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+
+    // All stages are queued at once, if the data fit in one transfer
+    if (segment_count <= 1) {
+        ret = msc_bot_transfer(device, (const uint8_t *)cbw, CBW_SIZE,
+                               segment_count ? segments[0].data : NULL, segment_count ? segments[0].size : 0, ep,
+                               (uint8_t *)&csw, sizeof(msc_csw_t), &err);
+    }
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        // 1. Command transport
+        MSC_RETURN_ON_ERROR( msc_cbw_transfer(device, (const uint8_t *)cbw, CBW_SIZE) );
 
-    // 1. Command transport
-    MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, (uint8_t *)cbw, CBW_SIZE, MSC_EP_OUT) );
+        // 2. Optional data transport
+        for (size_t i = 0; i < segment_count; i++) {
+            MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, segments[i].data, segments[i].size, ep) );
+        }
 
-    // 2. Optional data transport
-    if (data) {
-        MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, (uint8_t *)data, size, ep) );
+        // 3. Status transport
+        err = msc_csw_transfer(device, (uint8_t *)&csw, sizeof(msc_csw_t));
+    } else {
+        MSC_RETURN_ON_ERROR( ret );
     }
 
-    // 3. Status transport
-    esp_err_t err = msc_bulk_transfer(device, (uint8_t *)&csw, sizeof(msc_csw_t), MSC_EP_IN);
-
     // 3.1 Error recovery
     if (err == ESP_ERR_MSC_STALL) {
         // In case of the status transport failure, we can try reading the status again after clearing feature
         ESP_RETURN_ON_ERROR( clear_feature(device, device->config.bulk_in_ep), TAG, "Clear feature failed" );
-        err = msc_bulk_transfer(device, (uint8_t *)&csw, sizeof(msc_csw_t), MSC_EP_IN);
+        err = msc_csw_transfer(device, (uint8_t *)&csw, sizeof(msc_csw_t));
         if (ESP_OK != err) {
             // In case the repeated status transport failed we do reset recovery
             // We don't check the error code here, the command has already failed.
@@ -299,13 +501,90 @@ esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data,
     return check_csw(&csw, cbw->tag);
 }
 
-static const char *decode_sense_keys(cbw_sense_response_t *sense_response)
+/**
+ * @brief Wait for the turn of the logical unit to execute a command
+ *
+ * Commands of the owner task may nest, e.g. TEST UNIT READY of reset recovery.
+ */
+static void cmd_acquire(msc_device_t *device, uint8_t lun)
+{
+    const TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    xSemaphoreTake(device->cmd_lock, portMAX_DELAY);
+    if (device->cmd_depth == 0 || device->cmd_owner == self) {
+        device->cmd_owner = self;
+        device->cmd_depth++;
+        xSemaphoreGive(device->cmd_lock);
+        return;
+    }
+    device->luns[lun].cmd_waiting++;
+    xSemaphoreGive(device->cmd_lock);
+
+    // The turn is handed over by cmd_release(), the device stays busy in between
+    xSemaphoreTake(device->luns[lun].cmd_turn, portMAX_DELAY);
+    xSemaphoreTake(device->cmd_lock, portMAX_DELAY);
+    device->cmd_owner = self;
+    xSemaphoreGive(device->cmd_lock);
+}
+
+/**
+ * @brief Hand the turn over to the next logical unit with a waiting command, round robin
+ *
+ * A task issuing commands in a loop, e.g. chunks of a large read, does not starve the other logical units.
+ */
+static void cmd_release(msc_device_t *device, uint8_t lun)
+{
+    xSemaphoreTake(device->cmd_lock, portMAX_DELAY);
+    if (--device->cmd_depth == 0) {
+        device->cmd_owner = NULL;
+        for (uint8_t i = 1; i <= device->lun_count; i++) {
+            msc_lun_t *next = &device->luns[(lun + i) % device->lun_count];
+            if (next->cmd_waiting) {
+                next->cmd_waiting--;
+                device->cmd_depth = 1;
+                xSemaphoreGive(next->cmd_turn);
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(device->cmd_lock);
+}
+
+static esp_err_t transport_execute(msc_device_t *device, msc_cbw_t *cbw, const msc_data_segment_t *segments,
+                                   size_t segment_count, scsi_sense_data_t *sense)
+{
+    if (device->config.uas) {
+        const bool data_in = (cbw->flags & CWB_FLAG_DIRECTION_IN) != 0;
+        scsi_sense_data_t uas_sense;
+        return uas_execute_command(device, cbw->lun, (const uint8_t *)(cbw + 1), cbw->cbw_length, data_in,
+                                   segments, segment_count, sense ? sense : &uas_sense);
+    }
+    return bot_execute_segments(device, cbw, segments, segment_count);
+}
+
+static esp_err_t request_sense(msc_device_t *device, uint8_t lun, scsi_sense_data_t *sense)
+{
+    cbw_sense_response_t response;
+    cbw_sense_t cbw = {
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_sense_t), sizeof(response)),
+        .opcode = SCSI_CMD_REQUEST_SENSE,
+        .allocation_length = sizeof(response),
+    };
+
+    MSC_RETURN_ON_ERROR( bot_execute_command(device, &cbw.base, &response, sizeof(response)) );
+    sense->key = response.sense_key & SCSI_SENSE_KEY_MASK;
+    sense->code = response.sense_code;
+    sense->code_q = response.sense_code_qualifier;
+    return ESP_OK;
+}
+
+static const char *decode_sense_keys(const scsi_sense_data_t *sense)
 {
     // Only decode WRITE_PROTECTED_MEDIA sense key, other keys are not implemented
     for (int i = 0; i < SENSE_ERROR_COUNT; i++) {
-        if (sense_errors_lut[i].sense_key == sense_response->sense_key &&
-                sense_errors_lut[i].asc == sense_response->sense_code &&
-                sense_errors_lut[i].ascq == sense_response->sense_code_qualifier) {
+        if (sense_errors_lut[i].sense_key == sense->key &&
+                sense_errors_lut[i].asc == sense->code &&
+                sense_errors_lut[i].ascq == sense->code_q) {
             return sense_errors_lut[i].description;
         }
     }
@@ -313,8 +592,140 @@ static const char *decode_sense_keys(cbw_sense_response_t *sense_response)
     return "not found, refer to USB Mass Storage Class – UFI Command Specification (Table 51)";
 }
 
+/**
+ * @brief Log sense data of a failed command
+ *
+ * Conditions expected by the driver are logged only at debug level: not ready unit while waiting for it
+ * and optional VPD pages. The same sense data are logged once per SENSE_LOG_PERIOD_US.
+ */
+static void log_sense(msc_device_t *device, uint8_t lun, uint8_t opcode)
+{
+    msc_lun_t *unit = &device->luns[lun];
+    const scsi_sense_data_t *sense = &unit->sense;
+
+    if ((opcode == SCSI_CMD_TEST_UNIT_READY && sense->key == SCSI_SENSE_NOT_READY) ||
+            ((opcode == SCSI_CMD_INQUIRY || opcode == SCSI_CMD_MODE_SENSE || opcode == SCSI_CMD_MODE_SELECT ||
+              opcode == SCSI_CMD_SYNCHRONIZE_CACHE10) && sense->key == SCSI_SENSE_ILLEGAL_REQUEST)) {
+        ESP_LOGD(TAG, "LUN %d command 0x%02"PRIx8": Sense Key 0x%02"PRIx8", ASC: 0x%02"PRIx8", ASCQ: 0x%02"PRIx8"",
+                 lun, opcode, sense->key, sense->code, sense->code_q);
+        return;
+    }
+
+    const int64_t now = esp_timer_get_time();
+    if (memcmp(sense, &unit->sense_logged, sizeof(scsi_sense_data_t)) == 0 &&
+            now - unit->sense_log_us < SENSE_LOG_PERIOD_US) {
+        unit->sense_suppressed++;
+        return;
+    }
+    ESP_LOGE(TAG, "LUN %d command 0x%02"PRIx8" failed: Sense Key 0x%02"PRIx8", ASC: 0x%02"PRIx8", ASCQ: 0x%02"PRIx8
+             " (%s), %"PRIu32" more failures not logged", lun, opcode, sense->key, sense->code, sense->code_q,
+             decode_sense_keys(sense), unit->sense_suppressed);
+    unit->sense_logged = *sense;
+    unit->sense_log_us = now;
+    unit->sense_suppressed = 0;
+}
+
+/**
+ * @brief Execute the command and keep sense data of its failure
+ *
+ * BOT device reports only failure of the command, its sense data are read by REQUEST SENSE.
+ * UAS device sends them in the status. The command is repeated after UNIT ATTENTION,
+ * e.g. after reset or medium change, the condition is cleared by reporting it.
+ */
+static esp_err_t execute_with_sense(msc_device_t *device, msc_cbw_t *cbw, const msc_data_segment_t *segments,
+                                    size_t segment_count)
+{
+    const uint8_t lun = cbw->lun;
+    msc_lun_t *unit = &device->luns[lun];
+    esp_err_t ret;
+
+    unit->sense_valid = false;
+    for (int retry = 0; ; retry++) {
+        ret = transport_execute(device, cbw, segments, segment_count, &unit->sense);
+        if (ret != ESP_FAIL) {
+            return ret;
+        }
+        if (!device->config.uas && request_sense(device, lun, &unit->sense) != ESP_OK) {
+            return ret;
+        }
+        unit->sense_valid = true;
+        if (unit->sense.key != SCSI_SENSE_UNIT_ATTENTION || retry == SENSE_UA_RETRIES) {
+            break;
+        }
+        ESP_LOGD(TAG, "LUN %d unit attention, ASC: 0x%02"PRIx8", ASCQ: 0x%02"PRIx8", command repeated", lun,
+                 unit->sense.code, unit->sense.code_q);
+        cbw->tag = ++cbw_tag;
+    }
+    log_sense(device, lun, *(const uint8_t *)(cbw + 1));
+    return ret;
+}
+
+/**
+ * @brief Execute command by the transport of the device, BOT or UAS
+ *
+ * Commands of different tasks are scheduled by the logical unit, see cmd_release().
+ * UAS takes the command block from the CBW.
+ */
+static esp_err_t execute_segments(msc_device_t *device, msc_cbw_t *cbw, const msc_data_segment_t *segments,
+                                  size_t segment_count)
+{
+    esp_err_t ret;
+    const uint8_t lun = cbw->lun;
+    const uint8_t opcode = *(const uint8_t *)(cbw + 1);
+    const bool data_in = (cbw->flags & CWB_FLAG_DIRECTION_IN) != 0;
+
+    MSC_RETURN_ON_FALSE( lun < device->lun_count, ESP_ERR_INVALID_ARG );
+    cmd_acquire(device, lun);
+    // Nested commands of error recovery keep the timeouts of the failed command
+    const bool timed = device->cmd_depth == 1;
+    if (timed) {
+        const bool rw = opcode == SCSI_CMD_READ10 || opcode == SCSI_CMD_WRITE10 ||
+                        opcode == SCSI_CMD_READ16 || opcode == SCSI_CMD_WRITE16;
+        msc_command_begin(device, cbw->data_length, data_in, rw);
+    }
+    if (opcode == SCSI_CMD_REQUEST_SENSE) {
+        ret = transport_execute(device, cbw, segments, segment_count, NULL);
+    } else {
+        ret = execute_with_sense(device, cbw, segments, segment_count);
+    }
+    if (timed) {
+        msc_command_end(device, ret);
+    }
+    cmd_release(device, lun);
+    return ret;
+}
+
+/**
+ * @brief Execute BOT command
+ *
+ * There are multiple stages in BOT command:
+ * 1. Command transport
+ * 2. Data transport (optional)
+ * 3. Status transport
+ * 3.1. Error recovery (in case of error)
+ *
+ * This function is not 'static' so it could be called from unit test
+ *
+ * @see USB Mass Storage Class – Bulk Only Transport, Chapter 5.3
+ *
+ * @param[in] device MSC device handle
+ * @param[in] cbw    Command Block Wrapper
+ * @param[in] data   Data (optional)
+ * @param[in] size   Size of data in bytes
+ * @return esp_err_t
+ */
+esp_err_t bot_execute_command(msc_device_t *device, msc_cbw_t *cbw, void *data, size_t size)
+{
+    const msc_data_segment_t segment = {
+        .data = data,
+        .size = size,
+    };
+    return execute_segments(device, cbw, &segment, data ? 1 : 0);
+}
+
 
 esp_err_t scsi_cmd_read10(msc_host_device_handle_t dev,
+                          uint8_t lun,
                           uint8_t *data,
                           uint32_t sector_address,
                           uint32_t num_sectors,
@@ -322,23 +733,18 @@ esp_err_t scsi_cmd_read10(msc_host_device_handle_t dev,
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_read10_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read10_t), num_sectors * sector_size),
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_read10_t), num_sectors * sector_size),
         .opcode = SCSI_CMD_READ10,
         .flags = 0, // lun
         .address = __builtin_bswap32(sector_address),
         .length = __builtin_bswap16(num_sectors),
     };
 
-    esp_err_t ret = bot_execute_command(device, &cbw.base, data, num_sectors * sector_size);
-
-    // In case of an error, get an error code
-    if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
-    }
-    return ret;
+    return bot_execute_command(device, &cbw.base, data, num_sectors * sector_size);
 }
 
 esp_err_t scsi_cmd_write10(msc_host_device_handle_t dev,
+                           uint8_t lun,
                            const uint8_t *data,
                            uint32_t sector_address,
                            uint32_t num_sectors,
@@ -346,36 +752,198 @@ esp_err_t scsi_cmd_write10(msc_host_device_handle_t dev,
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_write10_t cbw = {
-        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(cbw_write10_t), num_sectors * sector_size),
+        CBW_BASE_INIT(lun, OUT_DIR, CBW_CMD_SIZE(cbw_write10_t), num_sectors * sector_size),
         .opcode = SCSI_CMD_WRITE10,
         .address = __builtin_bswap32(sector_address),
         .length = __builtin_bswap16(num_sectors),
     };
 
-    esp_err_t ret = bot_execute_command(device, &cbw.base, (void *)data, num_sectors * sector_size);
+    return bot_execute_command(device, &cbw.base, (void *)data, num_sectors * sector_size);
+}
 
-    // In case of an error, get an error code
-    if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+esp_err_t scsi_cmd_read16(msc_host_device_handle_t dev,
+                          uint8_t lun,
+                          uint8_t *data,
+                          uint64_t sector_address,
+                          uint32_t num_sectors,
+                          uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_rw16_t cbw = {
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_rw16_t), num_sectors * sector_size),
+        .opcode = SCSI_CMD_READ16,
+        .address = __builtin_bswap64(sector_address),
+        .length = __builtin_bswap32(num_sectors),
+    };
+
+    return bot_execute_command(device, &cbw.base, data, num_sectors * sector_size);
+}
+
+esp_err_t scsi_cmd_write16(msc_host_device_handle_t dev,
+                           uint8_t lun,
+                           const uint8_t *data,
+                           uint64_t sector_address,
+                           uint32_t num_sectors,
+                           uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_rw16_t cbw = {
+        CBW_BASE_INIT(lun, OUT_DIR, CBW_CMD_SIZE(cbw_rw16_t), num_sectors * sector_size),
+        .opcode = SCSI_CMD_WRITE16,
+        .address = __builtin_bswap64(sector_address),
+        .length = __builtin_bswap32(num_sectors),
+    };
+
+    return bot_execute_command(device, &cbw.base, (void *)data, num_sectors * sector_size);
+}
+
+/**
+ * @brief Number of sectors of one command at the address
+ *
+ * 16-byte commands are used for drives, whose capacity does not fit 32-bit LBA, or beyond the 32-bit LBA.
+ */
+static uint32_t scsi_chunk_sectors(const usb_disk_t *disk, uint64_t sector_address, uint32_t num_sectors,
+                                   uint32_t sector_size, bool *cmd16)
+{
+    *cmd16 = disk->cmd16 || (sector_address + num_sectors - 1) > UINT32_MAX;
+    // Data length of CBW is 32-bit
+    uint32_t chunk = UINT32_MAX / sector_size;
+    if (!*cmd16) {
+        chunk = MIN(chunk, SCSI_CMD10_MAX_SECTORS);
+    }
+    if (disk->max_transfer_blocks) {
+        chunk = MIN(chunk, disk->max_transfer_blocks);
+    }
+    return MIN(chunk, num_sectors);
+}
+
+esp_err_t scsi_read_sectors(msc_host_device_handle_t dev,
+                            uint8_t lun,
+                            uint8_t *data,
+                            uint64_t sector_address,
+                            uint32_t num_sectors,
+                            uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    MSC_RETURN_ON_FALSE( lun < device->lun_count, ESP_ERR_INVALID_ARG );
+    const usb_disk_t *disk = &device->luns[lun].disk;
+    while (num_sectors > 0) {
+        bool cmd16;
+        const uint32_t chunk = scsi_chunk_sectors(disk, sector_address, num_sectors, sector_size, &cmd16);
+        if (cmd16) {
+            MSC_RETURN_ON_ERROR( scsi_cmd_read16(device, lun, data, sector_address, chunk, sector_size) );
+        } else {
+            MSC_RETURN_ON_ERROR( scsi_cmd_read10(device, lun, data, (uint32_t)sector_address, chunk, sector_size) );
+        }
+        data += (size_t)chunk * sector_size;
+        sector_address += chunk;
+        num_sectors -= chunk;
     }
+    return ESP_OK;
+}
+
+esp_err_t scsi_write_sectors(msc_host_device_handle_t dev,
+                             uint8_t lun,
+                             const uint8_t *data,
+                             uint64_t sector_address,
+                             uint32_t num_sectors,
+                             uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    MSC_RETURN_ON_FALSE( lun < device->lun_count, ESP_ERR_INVALID_ARG );
+    const usb_disk_t *disk = &device->luns[lun].disk;
+    while (num_sectors > 0) {
+        bool cmd16;
+        const uint32_t chunk = scsi_chunk_sectors(disk, sector_address, num_sectors, sector_size, &cmd16);
+        if (cmd16) {
+            MSC_RETURN_ON_ERROR( scsi_cmd_write16(device, lun, data, sector_address, chunk, sector_size) );
+        } else {
+            MSC_RETURN_ON_ERROR( scsi_cmd_write10(device, lun, data, (uint32_t)sector_address, chunk, sector_size) );
+        }
+        data += (size_t)chunk * sector_size;
+        sector_address += chunk;
+        num_sectors -= chunk;
+    }
+    return ESP_OK;
+}
+
+uint32_t scsi_max_sectors(msc_host_device_handle_t dev, uint8_t lun, uint64_t sector_address, uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    bool cmd16;
+    if (lun >= device->lun_count) {
+        return 0;
+    }
+    return scsi_chunk_sectors(&device->luns[lun].disk, sector_address, UINT32_MAX, sector_size, &cmd16);
+}
+
+esp_err_t scsi_cmd_rw_segments(msc_host_device_handle_t dev,
+                               uint8_t lun,
+                               bool write,
+                               uint64_t sector_address,
+                               const msc_data_segment_t *segments,
+                               size_t segment_count,
+                               uint32_t sector_size)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    size_t size = 0;
+    for (size_t i = 0; i < segment_count; i++) {
+        size += segments[i].size;
+    }
+    const uint32_t num_sectors = size / sector_size;
+
+    bool cmd16;
+    MSC_RETURN_ON_FALSE( lun < device->lun_count, ESP_ERR_INVALID_ARG );
+    MSC_RETURN_ON_FALSE( size % sector_size == 0, ESP_ERR_INVALID_SIZE );
+    MSC_RETURN_ON_FALSE( scsi_chunk_sectors(&device->luns[lun].disk, sector_address, num_sectors, sector_size,
+                                            &cmd16) == num_sectors, ESP_ERR_INVALID_SIZE );
+
+    union {
+        msc_cbw_t base;
+        cbw_read10_t read10;
+        cbw_write10_t write10;
+        cbw_rw16_t cmd16;
+    } cbw;
+    if (cmd16) {
+        cbw.cmd16 = (cbw_rw16_t) {
+            CBW_BASE_INIT(lun, write ? OUT_DIR : IN_DIR, CBW_CMD_SIZE(cbw_rw16_t), size),
+            .opcode = write ? SCSI_CMD_WRITE16 : SCSI_CMD_READ16,
+            .address = __builtin_bswap64(sector_address),
+            .length = __builtin_bswap32(num_sectors),
+        };
+    } else if (write) {
+        cbw.write10 = (cbw_write10_t) {
+            CBW_BASE_INIT(lun, OUT_DIR, CBW_CMD_SIZE(cbw_write10_t), size),
+            .opcode = SCSI_CMD_WRITE10,
+            .address = __builtin_bswap32((uint32_t)sector_address),
+            .length = __builtin_bswap16(num_sectors),
+        };
+    } else {
+        cbw.read10 = (cbw_read10_t) {
+            CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_read10_t), size),
+            .opcode = SCSI_CMD_READ10,
+            .address = __builtin_bswap32((uint32_t)sector_address),
+            .length = __builtin_bswap16(num_sectors),
+        };
+    }
+
+    esp_err_t ret = execute_segments(device, &cbw.base, segments, segment_count);
     return ret;
 }
 
-esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint32_t *block_size, uint32_t *block_count)
+esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint8_t lun, uint32_t *block_size, uint32_t *block_count)
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_read_capacity_response_t response;
 
     cbw_read_capacity_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_read_capacity_t), sizeof(response)),
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_read_capacity_t), sizeof(response)),
         .opcode = SCSI_CMD_READ_CAPACITY,
     };
 
     esp_err_t ret = bot_execute_command(device, &cbw.base, &response, sizeof(response));
-
-    // In case of an error, get an error code
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        return ret;
     }
 
     *block_count = __builtin_bswap32(response.block_count);
@@ -384,106 +952,272 @@ esp_err_t scsi_cmd_read_capacity(msc_host_device_handle_t dev, uint32_t *block_s
     return ret;
 }
 
-esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t dev)
+esp_err_t scsi_cmd_read_capacity16(msc_host_device_handle_t dev, uint8_t lun, uint32_t *block_size, uint64_t *block_count)
 {
     msc_device_t *device = (msc_device_t *)dev;
-    cbw_unit_ready_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_unit_ready_t), 0),
-        .opcode = SCSI_CMD_TEST_UNIT_READY,
-    };
+    cbw_read_capacity16_response_t response;
 
-    esp_err_t ret = bot_execute_command(device, &cbw.base, NULL, 0);
+    cbw_read_capacity16_t cbw = {
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_read_capacity16_t), sizeof(response)),
+        .opcode = SCSI_CMD_SERVICE_ACTION_IN16,
+        .service_action = SCSI_SERVICE_ACTION_READ_CAPACITY16,
+        .allocation_length = __builtin_bswap32(sizeof(response)),
+    };
 
-    // In case of an error, get an error code
+    esp_err_t ret = bot_execute_command(device, &cbw.base, &response, sizeof(response));
     if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+        return ret;
     }
+
+    *block_count = __builtin_bswap64(response.block_count);
+    *block_size = __builtin_bswap32(response.block_size);
+
     return ret;
 }
 
-esp_err_t scsi_cmd_sense(msc_host_device_handle_t dev, scsi_sense_data_t *sense)
+esp_err_t scsi_cmd_capacity(msc_host_device_handle_t dev, uint8_t lun, uint32_t *block_size, uint64_t *block_count)
 {
     msc_device_t *device = (msc_device_t *)dev;
-    cbw_sense_response_t response;
+    uint32_t block_count32;
+
+    MSC_RETURN_ON_FALSE( lun < device->lun_count, ESP_ERR_INVALID_ARG );
+    usb_disk_t *disk = &device->luns[lun].disk;
+    MSC_RETURN_ON_ERROR( scsi_cmd_read_capacity(device, lun, block_size, &block_count32) );
+    if (block_count32 != SCSI_READ_CAPACITY10_MAX_LBA) {
+        *block_count = block_count32;
+        disk->cmd16 = false;
+        return ESP_OK;
+    }
 
-    cbw_sense_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_sense_t), sizeof(response)),
-        .opcode = SCSI_CMD_REQUEST_SENSE,
-        .allocation_length = sizeof(response),
+    MSC_RETURN_ON_ERROR( scsi_cmd_read_capacity16(device, lun, block_size, block_count) );
+    disk->cmd16 = *block_count > UINT32_MAX;
+    return ESP_OK;
+}
+
+/**
+ * @brief INQUIRY of Vital Product Data page
+ *
+ * Devices without the page report ILLEGAL REQUEST, which is not logged by the transport
+ */
+static esp_err_t scsi_cmd_inquiry_vpd(msc_device_t *device, uint8_t lun, uint8_t page_code, void *response,
+                                      uint8_t size)
+{
+    cbw_inquiry_t cbw = {
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_inquiry_t), size),
+        .opcode = SCSI_CMD_INQUIRY,
+        .flags = SCSI_INQUIRY_EVPD,
+        .page_code = page_code,
+        .allocation_length = size,
     };
 
-    MSC_RETURN_ON_ERROR( bot_execute_command(device, &cbw.base, &response, sizeof(response)) );
+    return bot_execute_command(device, &cbw.base, response, size);
+}
+
+esp_err_t scsi_cmd_block_limits(msc_host_device_handle_t dev, uint8_t lun, scsi_block_limits_t *block_limits)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    vpd_supported_pages_t pages = { 0 };
+    vpd_block_limits_t limits = { 0 };
+    vpd_logical_block_provisioning_t provisioning = { 0 };
+
+    memset(block_limits, 0, sizeof(scsi_block_limits_t));
+    // The pages are optional, ask for them only if they are listed
+    MSC_RETURN_ON_ERROR( scsi_cmd_inquiry_vpd(device, lun, SCSI_VPD_SUPPORTED_PAGES, &pages, sizeof(pages)) );
+    const uint8_t count = MIN(pages.page_length, sizeof(pages.pages));
+    if (memchr(pages.pages, SCSI_VPD_BLOCK_LIMITS, count) == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    MSC_RETURN_ON_ERROR( scsi_cmd_inquiry_vpd(device, lun, SCSI_VPD_BLOCK_LIMITS, &limits, sizeof(limits)) );
+
+    // Optimal transfer length is preferred, limited by maximum transfer length. Zero means not reported.
+    const uint32_t max_len = __builtin_bswap32(limits.max_transfer_length);
+    const uint32_t opt_len = __builtin_bswap32(limits.optimal_transfer_length);
+    block_limits->max_transfer_blocks = opt_len ? opt_len : max_len;
+    if (max_len) {
+        block_limits->max_transfer_blocks = MIN(block_limits->max_transfer_blocks, max_len);
+    }
+
+    // Unmap granularity is the erase block of flash devices, transfer granularity is used by the others
+    const uint32_t unmap_granularity = __builtin_bswap32(limits.optimal_unmap_granularity);
+    block_limits->erase_blocks = unmap_granularity ? unmap_granularity :
+                                 __builtin_bswap16(limits.optimal_transfer_length_granularity);
+
+    // UNMAP limits are valid only with LBPU bit of the provisioning page
+    const uint32_t max_unmap = __builtin_bswap32(limits.max_unmap_lba_count);
+    if (max_unmap && limits.max_unmap_block_descriptor_count &&
+            memchr(pages.pages, SCSI_VPD_LOGICAL_BLOCK_PROVISIONING, count) &&
+            scsi_cmd_inquiry_vpd(device, lun, SCSI_VPD_LOGICAL_BLOCK_PROVISIONING, &provisioning,
+                                 sizeof(provisioning)) == ESP_OK &&
+            (provisioning.flags & SCSI_VPD_LBPU)) {
+        block_limits->max_unmap_blocks = max_unmap;
+    }
+    return ESP_OK;
+}
+
+esp_err_t scsi_cmd_unmap(msc_host_device_handle_t dev, uint8_t lun, uint64_t sector_address, uint32_t num_sectors)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    unmap_parameter_list_t parameters = {
+        .data_length = __builtin_bswap16(sizeof(unmap_parameter_list_t) - 2),
+        .block_descriptor_data_length = __builtin_bswap16(sizeof(unmap_parameter_list_t) - 8),
+        .address = __builtin_bswap64(sector_address),
+        .length = __builtin_bswap32(num_sectors),
+    };
+    cbw_unmap_t cbw = {
+        CBW_BASE_INIT(lun, OUT_DIR, UNMAP_CDB_SIZE, sizeof(parameters)),
+        .opcode = SCSI_CMD_UNMAP,
+        .parameter_list_length = __builtin_bswap16(sizeof(parameters)),
+    };
+
+    return bot_execute_command(device, &cbw.base, &parameters, sizeof(parameters));
+}
+
+esp_err_t scsi_cmd_unit_ready(msc_host_device_handle_t dev, uint8_t lun)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    cbw_unit_ready_t cbw = {
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_unit_ready_t), 0),
+        .opcode = SCSI_CMD_TEST_UNIT_READY,
+    };
+
+    return bot_execute_command(device, &cbw.base, NULL, 0);
+}
+
+esp_err_t scsi_cmd_sense(msc_host_device_handle_t dev, uint8_t lun, scsi_sense_data_t *sense)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    scsi_sense_data_t data;
+
+    MSC_RETURN_ON_FALSE( lun < device->lun_count, ESP_ERR_INVALID_ARG );
+    // Sense data of the last failed command were already read by the transport
+    msc_lun_t *unit = &device->luns[lun];
+    if (unit->sense_valid) {
+        unit->sense_valid = false;
+        data = unit->sense;
+    } else {
+        MSC_RETURN_ON_ERROR( request_sense(device, lun, &data) );
+    }
 
     if (sense == NULL) {
         ESP_LOGE(TAG, "Sense error codes: Sense Key 0x%02"PRIx8", ASC: 0x%02"PRIx8", ASCQ: 0x%02"PRIx8"",
-                 response.sense_key, response.sense_code, response.sense_code_qualifier);
-        const char *error_description = decode_sense_keys(&response);
-        ESP_LOGE(TAG, "Sense error description: %s", error_description);
+                 data.key, data.code, data.code_q);
+        ESP_LOGE(TAG, "Sense error description: %s", decode_sense_keys(&data));
         return ESP_OK;
     }
 
-    sense->key = response.sense_key;
-    sense->code = response.sense_code;
-    sense->code_q = response.sense_code_qualifier;
-
+    *sense = data;
     return ESP_OK;
 }
 
-esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t dev)
+esp_err_t scsi_cmd_inquiry(msc_host_device_handle_t dev, uint8_t lun)
 {
     msc_device_t *device = (msc_device_t *)dev;
     cbw_inquiry_response_t response = { 0 };
 
     cbw_inquiry_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(cbw_inquiry_t), sizeof(response)),
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(cbw_inquiry_t), sizeof(response)),
         .opcode = SCSI_CMD_INQUIRY,
         .allocation_length = sizeof(response),
     };
 
-    esp_err_t ret = bot_execute_command(device, &cbw.base, &response, sizeof(response) );
-
-    // In case of an error, get an error code
-    if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
-    }
-    return ret;
+    return bot_execute_command(device, &cbw.base, &response, sizeof(response) );
 }
 
-esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t dev)
+esp_err_t scsi_cmd_mode_sense(msc_host_device_handle_t dev, uint8_t lun)
 {
     msc_device_t *device = (msc_device_t *)dev;
     mode_sense_response_t response = { 0 };
 
     mode_sense_t cbw = {
-        CBW_BASE_INIT(IN_DIR, CBW_CMD_SIZE(mode_sense_t), sizeof(response)),
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(mode_sense_t), sizeof(response)),
         .opcode = SCSI_CMD_MODE_SENSE,
         .pc_page_code = 0x3F,
         .parameter_list_length = sizeof(response),
     };
 
-    esp_err_t ret = bot_execute_command(device, &cbw.base, &response, sizeof(response) );
+    return bot_execute_command(device, &cbw.base, &response, sizeof(response) );
+}
 
-    // In case of an error, get an error code
-    if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
+/**
+ * @brief Read the current Caching mode page
+ *
+ * The page is used only if the device returned it without block descriptors
+ */
+static esp_err_t mode_sense_caching(msc_device_t *device, uint8_t lun, mode_caching_page_t *page)
+{
+    mode_sense_t cbw = {
+        CBW_BASE_INIT(lun, IN_DIR, CBW_CMD_SIZE(mode_sense_t), sizeof(mode_caching_page_t)),
+        .opcode = SCSI_CMD_MODE_SENSE,
+        .flags = SCSI_MODE_SENSE_DBD,
+        .pc_page_code = SCSI_MODE_PAGE_CACHING,
+        .parameter_list_length = __builtin_bswap16(sizeof(mode_caching_page_t)),
+    };
+
+    memset(page, 0, sizeof(mode_caching_page_t));
+    MSC_RETURN_ON_ERROR( bot_execute_command(device, &cbw.base, page, sizeof(mode_caching_page_t)) );
+    if (page->block_descriptor_length != 0 ||
+            (page->page_code & SCSI_MODE_PAGE_CODE_MASK) != SCSI_MODE_PAGE_CACHING || page->page_length < 1) {
+        return ESP_ERR_NOT_SUPPORTED;
     }
-    return ret;
+    return ESP_OK;
+}
+
+esp_err_t scsi_cmd_get_write_cache(msc_host_device_handle_t dev, uint8_t lun, bool *enabled)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    mode_caching_page_t page;
+
+    MSC_RETURN_ON_ERROR( mode_sense_caching(device, lun, &page) );
+    *enabled = (page.flags & SCSI_CACHING_WCE) != 0;
+    return ESP_OK;
+}
+
+esp_err_t scsi_cmd_set_write_cache(msc_host_device_handle_t dev, uint8_t lun, bool enable)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    mode_caching_page_t page;
+
+    // The page is sent back as read, with only WCE changed
+    MSC_RETURN_ON_ERROR( mode_sense_caching(device, lun, &page) );
+    if (((page.flags & SCSI_CACHING_WCE) != 0) == enable) {
+        return ESP_OK;
+    }
+    const size_t size = offsetof(mode_caching_page_t, flags) + MIN(page.page_length, sizeof(page.parameters) + 1);
+    page.mode_data_length = 0;
+    page.medium_type = 0;
+    page.device_specific = 0;
+    page.page_code &= SCSI_MODE_PAGE_CODE_MASK;
+    page.flags = enable ? (page.flags | SCSI_CACHING_WCE) : (page.flags & ~SCSI_CACHING_WCE);
+
+    mode_select_t cbw = {
+        CBW_BASE_INIT(lun, OUT_DIR, MODE_SELECT_CDB_SIZE, size),
+        .opcode = SCSI_CMD_MODE_SELECT,
+        .flags = SCSI_MODE_SELECT_PF,
+        .parameter_list_length = __builtin_bswap16(size),
+    };
+    return bot_execute_command(device, &cbw.base, &page, size);
 }
 
-esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t dev, bool prevent)
+esp_err_t scsi_cmd_sync_cache(msc_host_device_handle_t dev, uint8_t lun)
+{
+    msc_device_t *device = (msc_device_t *)dev;
+    // Zero address and length, all sectors of the logical unit
+    cbw_sync_cache_t cbw = {
+        CBW_BASE_INIT(lun, OUT_DIR, SYNC_CACHE_CDB_SIZE, 0),
+        .opcode = SCSI_CMD_SYNCHRONIZE_CACHE10,
+    };
+
+    return bot_execute_command(device, &cbw.base, NULL, 0);
+}
+
+esp_err_t scsi_cmd_prevent_removal(msc_host_device_handle_t dev, uint8_t lun, bool prevent)
 {
     msc_device_t *device = (msc_device_t *)dev;
     prevent_allow_medium_removal_t cbw = {
-        CBW_BASE_INIT(OUT_DIR, CBW_CMD_SIZE(prevent_allow_medium_removal_t), 0),
+        CBW_BASE_INIT(lun, OUT_DIR, CBW_CMD_SIZE(prevent_allow_medium_removal_t), 0),
         .opcode = SCSI_CMD_PREVENT_ALLOW_MEDIUM_REMOVAL,
         .prevent = (uint8_t) prevent,
     };
 
-    esp_err_t ret = bot_execute_command(device, &cbw.base, NULL, 0);
-
-    // In case of an error, get an error code
-    if (unlikely(ret != ESP_OK)) {
-        MSC_RETURN_ON_ERROR( scsi_cmd_sense(device, NULL));
-    }
-    return ret;
+    return bot_execute_command(device, &cbw.base, NULL, 0);
 }
@@ -0,0 +1,132 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <inttypes.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "msc_common.h"
+#include "msc_uas.h"
+
+static const char *TAG = "USB_MSC_UAS";
+
+/* ------------------------ UAS Information Units --------------------------- */
+#define UAS_IU_COMMAND      0x01
+#define UAS_IU_SENSE        0x03
+#define UAS_IU_RESPONSE     0x04
+#define UAS_IU_READ_READY   0x06
+#define UAS_IU_WRITE_READY  0x07
+
+#define UAS_TASK_ATTR_SIMPLE    0x00
+#define UAS_CDB_MAX_SIZE        16
+#define UAS_STATUS_GOOD         0x00
+#define UAS_STATUS_IU_SIZE      64  // SENSE IU with 48 bytes of sense data is enough for fixed format sense
+
+/**
+ * @brief Command IU
+ *
+ * @see Universal Serial Bus Attached SCSI (UAS), Revision 1.0, Table 7
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t iu_id;
+    uint8_t reserved_0;
+    uint16_t tag;
+    uint8_t task_attribute;
+    uint8_t reserved_1;
+    uint8_t additional_cdb_length;
+    uint8_t reserved_2;
+    uint8_t lun[8];
+    uint8_t cdb[UAS_CDB_MAX_SIZE];
+} uas_command_iu_t;
+
+/**
+ * @brief SENSE IU, READ READY and WRITE READY IUs have only the header
+ *
+ * @see Universal Serial Bus Attached SCSI (UAS), Revision 1.0, Table 10
+ */
+typedef struct __attribute__((packed))
+{
+    uint8_t iu_id;
+    uint8_t reserved_0;
+    uint16_t tag;
+    uint16_t status_qualifier;
+    uint8_t status;
+    uint8_t reserved_1[7];
+    uint16_t sense_length;
+    uint8_t sense_data[UAS_STATUS_IU_SIZE - 16];
+} uas_sense_iu_t;
+
+// Tag of the command, 0 is not used
+static uint16_t uas_tag;
+
+/**
+ * @brief Check status of the command, sense data of a failed command are returned without REQUEST SENSE
+ */
+static esp_err_t check_sense_iu(const uas_sense_iu_t *iu, uint16_t tag, scsi_sense_data_t *sense)
+{
+    MSC_RETURN_ON_FALSE( iu->iu_id == UAS_IU_SENSE && iu->tag == tag, ESP_ERR_INVALID_RESPONSE );
+
+    if (iu->status != UAS_STATUS_GOOD) {
+        const uint16_t sense_length = __builtin_bswap16(iu->sense_length);
+        // Fixed format sense data: key in byte 2, ASC and ASCQ in bytes 12 and 13
+        memset(sense, 0, sizeof(scsi_sense_data_t));
+        if (sense_length >= 14) {
+            sense->key = iu->sense_data[2] & 0x0F;
+            sense->code = iu->sense_data[12];
+            sense->code_q = iu->sense_data[13];
+        }
+        ESP_LOGD(TAG, "Status 0x%02"PRIx8", Sense Key 0x%02"PRIx8", ASC: 0x%02"PRIx8", ASCQ: 0x%02"PRIx8"",
+                 iu->status, sense->key, sense->code, sense->code_q);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uas_execute_command(msc_device_t *device, uint8_t lun, const uint8_t *cdb, uint8_t cdb_len,
+                              bool data_in, const msc_data_segment_t *segments, size_t segment_count,
+                              scsi_sense_data_t *sense)
+{
+    MSC_RETURN_ON_FALSE( cdb_len <= UAS_CDB_MAX_SIZE, ESP_ERR_INVALID_ARG );
+
+    if (++uas_tag == 0) {
+        uas_tag = 1;
+    }
+    const uint16_t tag = __builtin_bswap16(uas_tag);
+    uas_command_iu_t command = {
+        .iu_id = UAS_IU_COMMAND,
+        .tag = tag,
+        .task_attribute = UAS_TASK_ATTR_SIMPLE,
+        .lun = { 0, lun },  // Single level LUN structure, peripheral device addressing
+    };
+    memcpy(command.cdb, cdb, cdb_len);
+    uas_sense_iu_t status = { 0 };
+
+    // 1. Command IU
+    MSC_RETURN_ON_ERROR( msc_uas_command_transfer(device, (const uint8_t *)&command, sizeof(command)) );
+
+    // 2. Optional data phase, announced by the device
+    if (segment_count > 0) {
+        MSC_RETURN_ON_ERROR( msc_uas_status_transfer(device, (uint8_t *)&status, sizeof(status)) );
+        if (status.iu_id == UAS_IU_SENSE) {
+            // The command failed before the data phase
+            return check_sense_iu(&status, tag, sense);
+        }
+        const uint8_t ready = data_in ? UAS_IU_READ_READY : UAS_IU_WRITE_READY;
+        MSC_RETURN_ON_FALSE( status.iu_id == ready && status.tag == tag, ESP_ERR_INVALID_RESPONSE );
+
+        const msc_endpoint_t ep = data_in ? MSC_EP_IN : MSC_EP_OUT;
+        for (size_t i = 0; i < segment_count; i++) {
+            MSC_RETURN_ON_ERROR( msc_bulk_transfer(device, segments[i].data, segments[i].size, ep) );
+        }
+    }
+
+    // 3. SENSE IU
+    MSC_RETURN_ON_ERROR( msc_uas_status_transfer(device, (uint8_t *)&status, sizeof(status)) );
+    return check_sense_iu(&status, tag, sense);
+}
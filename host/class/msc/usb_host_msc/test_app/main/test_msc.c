@@ -17,6 +17,8 @@
 #include "esp_private/usb_phy.h"
 #include "usb/usb_host.h"
 #include "usb/msc_host_vfs.h"
+#include "usb/msc_host_copy.h"
+#include "usb/msc_host_bdev.h"
 #include "test_common.h"
 #include "../private_include/msc_common.h"
 
@@ -289,8 +291,8 @@ static void write_read_sectors(void)
     memset(write_data, 0x55, DISK_BLOCK_SIZE);
     memset(read_data, 0, DISK_BLOCK_SIZE);
 
-    ESP_OK_ASSERT( scsi_cmd_write10(device, write_data, 10, 1, DISK_BLOCK_SIZE));
-    ESP_OK_ASSERT( scsi_cmd_read10(device, read_data, 10, 1, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( scsi_cmd_write10(device, 0, write_data, 10, 1, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, 10, 1, DISK_BLOCK_SIZE));
 
     TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, DISK_BLOCK_SIZE);
 }
@@ -301,7 +303,7 @@ static void erase_storage(void)
     memset(data, 0xFF, DISK_BLOCK_SIZE);
 
     for (int block = 0; block < DISK_BLOCK_NUM; block++) {
-        scsi_cmd_write10(device, data, block, 1, DISK_BLOCK_SIZE);
+        scsi_cmd_write10(device, 0, data, block, 1, DISK_BLOCK_SIZE);
     }
 }
 
@@ -326,6 +328,110 @@ TEST_CASE("sectors_can_be_written_and_read", "[usb_msc]")
     msc_teardown();
 }
 
+static void sched_done_cb(msc_host_device_handle_t dev, esp_err_t status, void *arg)
+{
+    // Called from the worker task, failed request is detected by timeout of the test
+    if (status == ESP_OK) {
+        xSemaphoreGive((SemaphoreHandle_t)arg);
+    }
+}
+
+/**
+ * @brief I/O scheduler testcase
+ *
+ * Sectors are written one by one at low priority and read back at once at high priority.
+ */
+TEST_CASE("scheduled_sectors_can_be_written_and_read", "[usb_msc]")
+{
+    const uint32_t count = 4;
+    uint8_t *write_data = malloc(count * DISK_BLOCK_SIZE);
+    uint8_t *read_data = calloc(count, DISK_BLOCK_SIZE);
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(count, 0);
+    TEST_ASSERT_NOT_NULL(write_data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    TEST_ASSERT_NOT_NULL(done);
+    for (size_t i = 0; i < count * DISK_BLOCK_SIZE; i++) {
+        write_data[i] = i & 0xFF;
+    }
+
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .async = { .queue_size = 4, .stack_size = 4096, .task_priority = 5, .core_id = tskNO_AFFINITY },
+        .sched = { .queue_size = 8, .stack_size = 4096, .task_priority = 5, .core_id = tskNO_AFFINITY },
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    for (uint32_t i = 0; i < count; i++) {
+        ESP_OK_ASSERT( msc_host_sched_write(device, 0, MSC_HOST_IO_PRIORITY_LOW, 10 + i,
+                                            1, write_data + i * DISK_BLOCK_SIZE, sched_done_cb, done) );
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(5000)));
+    }
+    ESP_OK_ASSERT( msc_host_sched_read(device, 0, MSC_HOST_IO_PRIORITY_HIGH, 10, count, read_data,
+                                       sched_done_cb, done) );
+    TEST_ASSERT_TRUE(xSemaphoreTake(done, pdMS_TO_TICKS(5000)));
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, count * DISK_BLOCK_SIZE);
+
+    msc_teardown();
+    vSemaphoreDelete(done);
+    free(write_data);
+    free(read_data);
+}
+
+/**
+ * @brief Streaming write testcase
+ *
+ * File is preallocated for 16 sectors, but only 2 sectors and a tail are written.
+ * The file must be truncated to the written size on close.
+ */
+TEST_CASE("stream_file_can_be_written_and_read", "[usb_msc]")
+{
+    const size_t tail = 100;
+    const size_t size = 2 * DISK_BLOCK_SIZE + tail;
+    msc_host_stream_handle_t stream;
+
+    msc_setup();
+    esp_err_t ret = msc_host_vfs_stream_open(vfs_handle, "/usb/stream.bin", 16 * DISK_BLOCK_SIZE, &stream);
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        msc_teardown();
+        TEST_IGNORE_MESSAGE("FATFS is built without FF_USE_EXPAND");
+    }
+    ESP_OK_ASSERT(ret);
+
+    uint8_t *data = malloc(size);
+    uint8_t *read_data = malloc(size);
+    TEST_ASSERT_NOT_NULL(data);
+    TEST_ASSERT_NOT_NULL(read_data);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = i & 0xFF;
+    }
+
+    ESP_OK_ASSERT( msc_host_vfs_stream_write(stream, data, 2 * DISK_BLOCK_SIZE) );
+    ESP_OK_ASSERT( msc_host_vfs_stream_write(stream, data + 2 * DISK_BLOCK_SIZE, tail) );
+    // Tail ends the stream
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, msc_host_vfs_stream_write(stream, data, DISK_BLOCK_SIZE));
+    ESP_OK_ASSERT( msc_host_vfs_stream_close(stream) );
+
+    FILE *file = fopen("/usb/stream.bin", "r");
+    TEST_ASSERT_NOT_NULL_MESSAGE(file, "Could not open file for reading");
+    fseek(file, 0, SEEK_END);
+    TEST_ASSERT_EQUAL(size, ftell(file));
+    fseek(file, 0, SEEK_SET);
+    TEST_ASSERT_EQUAL(size, fread(read_data, 1, size, file));
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(data, read_data, size);
+    fclose(file);
+
+    free(data);
+    free(read_data);
+    msc_teardown();
+}
+
 esp_err_t bot_execute_command(msc_device_t *device, uint8_t *cbw, void *data, size_t size);
 /**
  * @brief Error recovery testcase
@@ -366,7 +472,7 @@ TEST_CASE("error_recovery_2", "[usb_msc][ignore]")
     // Write to and read from invalid sector
     // Some flash disks will respond with stall, some with error in CSW, some with timeout
     printf("read 10\n");
-    err = scsi_cmd_read10(device, data, UINT32_MAX, 1, DISK_BLOCK_SIZE);
+    err = scsi_cmd_read10(device, 0, data, UINT32_MAX, 1, DISK_BLOCK_SIZE);
     TEST_ASSERT_NOT_EQUAL(ESP_OK, err);
     err = msc_host_reset_recovery(device);
     TEST_ASSERT_EQUAL(ESP_OK, err);
@@ -511,6 +617,173 @@ TEST_CASE("device_info", "[usb_msc]")
     print_device_info(&info);
 }
 
+/**
+ * @brief USB MSC write cache testcase
+ *
+ * The write cache is enabled if the device reports the Caching mode page,
+ * fsync() of a written file must succeed with and without it
+ */
+TEST_CASE("fsync_with_write_cache", "[usb_msc]")
+{
+    msc_test_init();
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .callback = msc_event_cb,
+        .stack_size = 4096,
+        .task_priority = 5,
+        .enable_write_cache = true,
+    };
+    ESP_OK_ASSERT( msc_host_install(&msc_config) );
+    msc_test_wait_and_install_device();
+
+    msc_host_lun_info_t info;
+    ESP_OK_ASSERT( msc_host_get_lun_info(device, 0, &info) );
+    ESP_LOGI(TAG, "Write cache %s", info.write_cache ? "enabled" : "not reported");
+
+    FILE *file = fopen(FILE_NAME, "w");
+    TEST_ASSERT(file);
+    TEST_ASSERT_EQUAL(strlen(TEST_STRING), fwrite(TEST_STRING, 1, strlen(TEST_STRING), file));
+    TEST_ASSERT_EQUAL(0, fflush(file));
+    TEST_ASSERT_EQUAL(0, fsync(fileno(file)));
+    TEST_ASSERT_EQUAL(0, fclose(file));
+    if (info.write_cache) {
+        ESP_OK_ASSERT( scsi_cmd_sync_cache(device, 0) );
+    }
+    msc_teardown();
+}
+
+#define COPY_SECTORS (16)
+
+static uint8_t ram_media[COPY_SECTORS * DISK_BLOCK_SIZE];
+
+static esp_err_t ram_media_read(void *ctx, uint64_t sector, uint32_t count, void *data)
+{
+    memcpy(data, ram_media + sector * DISK_BLOCK_SIZE, count * DISK_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+static esp_err_t ram_media_write(void *ctx, uint64_t sector, uint32_t count, const void *data)
+{
+    memcpy(ram_media + sector * DISK_BLOCK_SIZE, data, count * DISK_BLOCK_SIZE);
+    return ESP_OK;
+}
+
+static bool copy_progress(uint64_t done, uint64_t total, void *arg)
+{
+    *(uint64_t *)arg = done;
+    return true;
+}
+
+/**
+ * @brief USB MSC sector copy testcase
+ *
+ * Sectors are copied to RAM media in chunks smaller than the copy and back to the same sectors,
+ * RAM media must hold the same data as the device
+ */
+TEST_CASE("sectors_can_be_copied", "[usb_msc]")
+{
+    msc_setup();
+    uint64_t done = 0;
+    const msc_host_copy_config_t config = {
+        .chunk_size = 4 * DISK_BLOCK_SIZE,
+        .progress_cb = copy_progress,
+        .progress_arg = &done,
+    };
+    const msc_host_copy_media_t usb = { .device = device };
+    const msc_host_copy_media_t ram = {
+        .read = ram_media_read,
+        .write = ram_media_write,
+        .sector_size = DISK_BLOCK_SIZE,
+    };
+    memset(ram_media, 0, sizeof(ram_media));
+    ESP_OK_ASSERT( msc_host_copy_sectors(&config, &usb, 0, &ram, 0, COPY_SECTORS) );
+    TEST_ASSERT_EQUAL(sizeof(ram_media), done);
+    ESP_OK_ASSERT( msc_host_copy_sectors(&config, &ram, 0, &usb, 0, COPY_SECTORS) );
+
+    uint8_t read_data[DISK_BLOCK_SIZE];
+    for (int sector = 0; sector < COPY_SECTORS; sector++) {
+        ESP_OK_ASSERT( scsi_cmd_read10(device, 0, read_data, sector, 1, DISK_BLOCK_SIZE) );
+        TEST_ASSERT_EQUAL_MEMORY(ram_media + sector * DISK_BLOCK_SIZE, read_data, DISK_BLOCK_SIZE);
+    }
+    const msc_host_copy_config_t unaligned_config = { .chunk_size = DISK_BLOCK_SIZE + 1 };
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_SIZE, msc_host_copy_sectors(&unaligned_config, &usb, 0, &ram, 0, 1));
+    msc_teardown();
+}
+
+/**
+ * @brief USB MSC raw block device testcase
+ *
+ * The logical unit is opened as a block device after it was unregistered from VFS,
+ * it cannot be registered while the block device is open
+ */
+TEST_CASE("blocks_can_be_written_and_read_by_bdev", "[usb_msc]")
+{
+    msc_setup();
+    msc_host_bdev_handle_t bdev;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, msc_host_bdev_open(device, 0, &bdev));
+    ESP_OK_ASSERT( msc_host_vfs_unregister(vfs_handle) );
+    ESP_OK_ASSERT( msc_host_bdev_open(device, 0, &bdev) );
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, msc_host_vfs_register(device, "/usb", &mount_config, &vfs_handle));
+
+    msc_host_bdev_info_t info;
+    ESP_OK_ASSERT( msc_host_bdev_get_info(bdev, &info) );
+    TEST_ASSERT_EQUAL(DISK_BLOCK_SIZE, info.block_size);
+    TEST_ASSERT(info.block_count > 10 + 4);
+    TEST_ASSERT(info.erase_blocks > 0);
+
+    uint8_t write_data[4 * DISK_BLOCK_SIZE];
+    uint8_t read_data[4 * DISK_BLOCK_SIZE];
+    for (int i = 0; i < sizeof(write_data); i++) {
+        write_data[i] = i;
+    }
+    ESP_OK_ASSERT( msc_host_bdev_write(bdev, 10, 4, write_data) );
+    ESP_OK_ASSERT( msc_host_bdev_sync(bdev) );
+    ESP_OK_ASSERT( msc_host_bdev_read(bdev, 10, 4, read_data) );
+    TEST_ASSERT_EQUAL_MEMORY(write_data, read_data, sizeof(write_data));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, msc_host_bdev_read(bdev, info.block_count - 1, 2, read_data));
+    if (!info.trim) {
+        TEST_ASSERT_EQUAL(ESP_ERR_NOT_SUPPORTED, msc_host_bdev_trim(bdev, 10, 4));
+    }
+
+    ESP_OK_ASSERT( msc_host_bdev_close(bdev) );
+    ESP_OK_ASSERT( msc_host_vfs_register(device, "/usb", &mount_config, &vfs_handle) );
+    msc_teardown();
+}
+
+/**
+ * @brief USB MSC lazy mount testcase
+ *
+ * The volume formatted by msc_setup() is registered again, mounted at the first access.
+ * Free space of FAT16 and FAT32 volumes is counted by the background scan
+ */
+TEST_CASE("lazy_mount_and_free_space_scan", "[usb_msc]")
+{
+    msc_setup();
+    ESP_OK_ASSERT( msc_host_vfs_unregister(vfs_handle) );
+
+    const msc_host_vfs_options_t options = {
+        .lazy_mount = true,
+        .scan_free_space = true,
+    };
+    ESP_OK_ASSERT( msc_host_vfs_register_ex(device, 0, "/usb", &mount_config, &options, &vfs_handle) );
+    write_read_file(FILE_NAME);
+
+    uint64_t total, free;
+    esp_err_t err = ESP_ERR_INVALID_STATE;
+    for (int i = 0; i < 20 && err == ESP_ERR_INVALID_STATE; i++) {
+        err = msc_host_vfs_get_free_space(vfs_handle, &total, &free);
+        vTaskDelay(pdMS_TO_TICKS(100));
+    }
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Free %"PRIu64" of %"PRIu64" bytes", free, total);
+        TEST_ASSERT(free < total);
+    } else {
+        // FAT12 volume of the mock device has neither FSINFO nor the scan
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, err);
+    }
+    msc_teardown();
+}
+
 /**
  * @brief USB MSC driver with no background task
  *
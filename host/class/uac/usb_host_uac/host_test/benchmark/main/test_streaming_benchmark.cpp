@@ -0,0 +1,501 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include "usb/uac_host.h"
+#include "mock_add_usb_device.h"
+#include "usb_bench.hpp"
+
+extern "C" {
+#include "Mockusb_host.h"
+}
+
+#define BENCH_DEV_ADDR          1
+#define BENCH_SPK_IFACE         1
+#define BENCH_MIC_IFACE         2
+#define BENCH_SAMPLE_FREQ       48000
+#define BENCH_CHANNELS          2
+#define BENCH_FRAME_BYTES       (BENCH_CHANNELS * 2)
+#define BENCH_PACKET_FRAMES     (BENCH_SAMPLE_FREQ / 1000)  // Full-speed device, one packet each 1 ms frame
+#define BENCH_DURATION_MS       2000                        // Simulated stream time of one benchmark run
+#define BENCH_TX_BLOCK_FRAMES   (5 * BENCH_PACKET_FRAMES)   // Frames written by the application at once
+#define BENCH_PTT_PERIOD_MS     100                         // Push-to-talk period, talking in the first half
+
+/**
+ * @brief UAC 1.0 headset: 48 kHz 16-bit stereo speaker on interface 1 and microphone on interface 2
+ *
+ * There are no Feature Units, so the driver does not send any class requests when the device is opened.
+ */
+static const uint8_t bench_device_desc[] = {
+    0x12, 0x01, 0x00, 0x02, 0x00, 0x00, 0x00, 0x40, 0x3A, 0x30, 0x00, 0x40, 0x00, 0x01, 0x00, 0x00, 0x00, 0x01,
+};
+
+static const uint8_t bench_config_desc[] = {
+    0x09, 0x02, 0xAE, 0x00, 0x03, 0x01, 0x00, 0x80, 0x32,                         // Configuration, 174 bytes, 3 interfaces
+    // Audio Control interface
+    0x09, 0x04, 0x00, 0x00, 0x00, 0x01, 0x01, 0x00, 0x00,
+    0x0A, 0x24, 0x01, 0x00, 0x01, 0x34, 0x00, 0x02, 0x01, 0x02,                   // Header, UAC 1.0, streaming interfaces 1 and 2
+    0x0C, 0x24, 0x02, 0x01, 0x01, 0x01, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,       // Input Terminal 1, USB streaming
+    0x09, 0x24, 0x03, 0x02, 0x01, 0x03, 0x00, 0x01, 0x00,                         // Output Terminal 2, speaker, source 1
+    0x0C, 0x24, 0x02, 0x03, 0x01, 0x02, 0x00, 0x02, 0x03, 0x00, 0x00, 0x00,       // Input Terminal 3, microphone
+    0x09, 0x24, 0x03, 0x04, 0x01, 0x01, 0x00, 0x03, 0x00,                         // Output Terminal 4, USB streaming, source 3
+    // Speaker streaming interface
+    0x09, 0x04, 0x01, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+    0x09, 0x04, 0x01, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+    0x07, 0x24, 0x01, 0x01, 0x01, 0x01, 0x00,                                     // AS General, terminal 1, PCM
+    0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00,             // Format Type I, 2 channels, 16 bit, 48 kHz
+    0x09, 0x05, 0x01, 0x09, 0xC0, 0x00, 0x01, 0x00, 0x00,                         // EP 0x01 isochronous adaptive, 192 bytes
+    0x07, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00,                                     // CS EP General, no sampling frequency control
+    // Microphone streaming interface
+    0x09, 0x04, 0x02, 0x00, 0x00, 0x01, 0x02, 0x00, 0x00,
+    0x09, 0x04, 0x02, 0x01, 0x01, 0x01, 0x02, 0x00, 0x00,
+    0x07, 0x24, 0x01, 0x04, 0x01, 0x01, 0x00,                                     // AS General, terminal 4, PCM
+    0x0B, 0x24, 0x02, 0x01, 0x02, 0x02, 0x10, 0x01, 0x80, 0xBB, 0x00,             // Format Type I, 2 channels, 16 bit, 48 kHz
+    0x09, 0x05, 0x82, 0x05, 0xC0, 0x00, 0x01, 0x00, 0x00,                         // EP 0x82 isochronous asynchronous, 192 bytes
+    0x07, 0x25, 0x01, 0x00, 0x00, 0x00, 0x00,                                     // CS EP General, no sampling frequency control
+};
+
+/**
+ * @brief Simulated isochronous link
+ *
+ * Each endpoint moves one packet of its oldest submitted transfer in every 1 ms frame, the transfer completes with its last packet.
+ * Every audio frame carries its index, so the latency of each frame is known when the application reads it or the device plays it.
+ * Index 0 is silence.
+ */
+typedef struct {
+    usb_transfer_t *transfer;
+    int packets_done;
+    size_t offset;
+} link_xfer_t;
+
+typedef struct {
+    size_t ring_bytes;
+    std::chrono::nanoseconds ring_time;
+    uint32_t frames;
+    uint32_t order_errors;
+    uint32_t latency_min;
+    uint32_t latency_max;
+    uint64_t latency_sum;
+    uint32_t gaps;
+} bench_stats_t;
+
+static std::deque<link_xfer_t> link_in_flight;
+static std::deque<link_xfer_t> link_out_flight;
+static uint32_t link_ms;
+static bool link_out_started;                  // OUT transfer was submitted, the speaker stream runs
+static std::vector<uint32_t> link_frame_ms;    // Time each block of frames was captured by the device or written by the application
+static uint32_t link_next_frame;               // Next frame captured by the device or written by the application
+static uint32_t link_expected_frame;           // Next frame expected by the application or the device
+static bench_stats_t bench_stats;
+static usb_bench::callback_timer bench_timer;
+static uint32_t bench_alloc_cnt;               // Transfers allocated by the driver
+
+static void frame_encode(uint8_t *frame, uint32_t index)
+{
+    const uint16_t words[BENCH_CHANNELS] = {(uint16_t)(index & 0xFFFF), (uint16_t)(index >> 16)};
+    memcpy(frame, words, BENCH_FRAME_BYTES);
+}
+
+static uint32_t frame_decode(const uint8_t *frame)
+{
+    uint16_t words[BENCH_CHANNELS];
+    memcpy(words, frame, BENCH_FRAME_BYTES);
+    return words[0] | ((uint32_t)words[1] << 16);
+}
+
+/**
+ * @brief Check order and latency of frames received by the application or played by the device
+ *
+ * @param[in] data        Audio frames
+ * @param[in] frames      Number of frames
+ * @param[in] block       Frames captured, or written, at the same time
+ */
+static void bench_frames_check(const uint8_t *data, size_t frames, uint32_t block)
+{
+    for (size_t i = 0; i < frames; i++) {
+        const uint32_t index = frame_decode(data + i * BENCH_FRAME_BYTES);
+        if (index == 0) {
+            continue;
+        }
+        if (index != link_expected_frame) {
+            bench_stats.order_errors++;
+        }
+        link_expected_frame = index + 1;
+        const uint32_t latency = link_ms - link_frame_ms[(index - 1) / block];
+        bench_stats.latency_min = std::min(bench_stats.latency_min, latency);
+        bench_stats.latency_max = std::max(bench_stats.latency_max, latency);
+        bench_stats.latency_sum += latency;
+        bench_stats.frames++;
+    }
+}
+
+static void link_complete(usb_transfer_t *transfer)
+{
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->actual_num_bytes = 0;
+    for (int i = 0; i < transfer->num_isoc_packets; i++) {
+        transfer->isoc_packet_desc[i].status = USB_TRANSFER_STATUS_COMPLETED;
+        transfer->isoc_packet_desc[i].actual_num_bytes = transfer->isoc_packet_desc[i].num_bytes;
+        transfer->actual_num_bytes += transfer->isoc_packet_desc[i].num_bytes;
+    }
+
+    // IN transfers are resubmitted from the callback, OUT transfers take the next data from the buffer
+    bench_timer.measure([transfer] { transfer->callback(transfer); });
+}
+
+/**
+ * @brief Simulate one 1 ms frame of the bus
+ */
+static void link_tick(void)
+{
+    if (!link_in_flight.empty()) {
+        // the microphone captures the frames of this packet now
+        link_xfer_t *xfer = &link_in_flight.front();
+        uint8_t *packet = xfer->transfer->data_buffer + xfer->offset;
+        for (int i = 0; i < BENCH_PACKET_FRAMES; i++) {
+            frame_encode(packet + i * BENCH_FRAME_BYTES, link_next_frame++);
+        }
+        link_frame_ms.push_back(link_ms);
+        xfer->offset += xfer->transfer->isoc_packet_desc[xfer->packets_done].num_bytes;
+        if (++xfer->packets_done == xfer->transfer->num_isoc_packets) {
+            usb_transfer_t *transfer = xfer->transfer;
+            link_in_flight.pop_front();
+            link_complete(transfer);
+        }
+    }
+
+    if (!link_out_flight.empty()) {
+        // the speaker plays the frames of this packet now
+        link_xfer_t *xfer = &link_out_flight.front();
+        const int packet_bytes = xfer->transfer->isoc_packet_desc[xfer->packets_done].num_bytes;
+        bench_frames_check(xfer->transfer->data_buffer + xfer->offset, packet_bytes / BENCH_FRAME_BYTES, BENCH_TX_BLOCK_FRAMES);
+        xfer->offset += packet_bytes;
+        if (++xfer->packets_done == xfer->transfer->num_isoc_packets) {
+            usb_transfer_t *transfer = xfer->transfer;
+            link_out_flight.pop_front();
+            link_complete(transfer);
+        }
+    } else if (link_out_started) {
+        // nothing to play after the speaker stream started
+        bench_stats.gaps++;
+    }
+    link_ms++;
+}
+
+static esp_err_t link_submit_cb(usb_transfer_t *transfer, int cmock_num_calls)
+{
+    const link_xfer_t xfer = {transfer, 0, 0};
+    if (transfer->bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) {
+        link_in_flight.push_back(xfer);
+    } else {
+        link_out_flight.push_back(xfer);
+        link_out_started = true;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t link_flush_cb(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls)
+{
+    // Transfers in the link are returned canceled, as by the endpoint flush of the real USB Host stack
+    std::deque<link_xfer_t> &flight = (bEndpointAddress & USB_B_ENDPOINT_ADDRESS_EP_DIR_MASK) ? link_in_flight : link_out_flight;
+    std::deque<link_xfer_t> canceled;
+    canceled.swap(flight);
+    for (const link_xfer_t &xfer : canceled) {
+        xfer.transfer->status = USB_TRANSFER_STATUS_CANCELED;
+        xfer.transfer->callback(xfer.transfer);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t bench_transfer_alloc_cb(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer,
+                                         int cmock_num_calls)
+{
+    bench_alloc_cnt++;
+    return usb_host_transfer_alloc_mock_callback(data_buffer_size, num_isoc_packets, transfer, cmock_num_calls);
+}
+
+static esp_err_t link_endpoint_cb(usb_device_handle_t dev_hdl, uint8_t bEndpointAddress, int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t bench_device_info_cb(usb_device_handle_t dev_hdl, usb_device_info_t *dev_info, int cmock_num_calls)
+{
+    memset(dev_info, 0, sizeof(usb_device_info_t));
+    dev_info->speed = USB_SPEED_FULL;
+    dev_info->dev_addr = BENCH_DEV_ADDR;
+    dev_info->bMaxPacketSize0 = 64;
+    dev_info->bConfigurationValue = 1;
+    return ESP_OK;
+}
+
+static esp_err_t bench_claim_cb(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber,
+                                uint8_t bAlternateSetting, int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static esp_err_t bench_release_cb(usb_host_client_handle_t client_hdl, usb_device_handle_t dev_hdl, uint8_t bInterfaceNumber,
+                                  int cmock_num_calls)
+{
+    return ESP_OK;
+}
+
+static void bench_driver_cb(uint8_t addr, uint8_t iface_num, const uac_host_driver_event_t event, void *arg)
+{
+    // The mocked device is opened by the address, no connection events are expected
+}
+
+static void bench_device_cb(uac_host_device_handle_t uac_device_handle, const uac_host_device_event_t event, void *arg)
+{
+    if (event == UAC_HOST_DEVICE_EVENT_RX_DONE || event == UAC_HOST_DEVICE_EVENT_TX_DONE) {
+        *static_cast<bool *>(arg) = true;
+    }
+}
+
+static usb_bench::report bench_report(const char *name, uint32_t buffer_size, uint32_t threshold,
+                                      const uac_host_stream_stats_t *stream_stats)
+{
+    const double ns_per_kib = (double)bench_stats.ring_time.count() * 1024 / bench_stats.ring_bytes;
+    const double latency_avg = (double)bench_stats.latency_sum / bench_stats.frames;
+    usb_bench::report report("uac", name);
+    report.value("buffer_size", buffer_size)
+    .value("threshold", threshold)
+    .value("ring_ns_per_kib", ns_per_kib)
+    .value("latency_ms_min", bench_stats.latency_min)
+    .value("latency_ms_max", bench_stats.latency_max)
+    .value("latency_ms_avg", latency_avg)
+    .value("tx_underruns", stream_stats->tx_underruns)
+    .value("gaps", bench_stats.gaps)
+    .timer(bench_timer);
+    return report;
+}
+
+static void bench_link_reset(void)
+{
+    link_in_flight.clear();
+    link_out_flight.clear();
+    link_ms = 0;
+    link_out_started = false;
+    link_frame_ms.clear();
+    link_next_frame = 1;
+    link_expected_frame = 1;
+    bench_stats = {};
+    bench_stats.latency_min = UINT32_MAX;
+    bench_timer.reset();
+}
+
+/**
+ * @brief Install UAC driver with mocked USB Host stack, all transfer submissions go to the simulated link
+ */
+static void bench_install(void)
+{
+    usb_host_mock_dev_list_init();
+    REQUIRE(ESP_OK == usb_host_mock_add_device(BENCH_DEV_ADDR, (const usb_device_desc_t *)bench_device_desc,
+            (const usb_config_desc_t *)bench_config_desc));
+
+    usb_host_device_open_Stub(usb_host_device_open_mock_callback);
+    usb_host_get_device_descriptor_Stub(usb_host_get_device_descriptor_mock_callback);
+    usb_host_get_active_config_descriptor_Stub(usb_host_get_active_config_descriptor_mock_callback);
+    usb_host_device_close_Stub(usb_host_device_close_mock_callback);
+    usb_host_device_info_Stub(bench_device_info_cb);
+    usb_host_transfer_alloc_Stub(bench_transfer_alloc_cb);
+    usb_host_transfer_free_Stub(usb_host_transfer_free_mock_callback);
+    usb_host_transfer_submit_control_Stub(usb_host_transfer_submit_control_success_mock_callback);
+    usb_host_transfer_submit_Stub(link_submit_cb);
+    usb_host_interface_claim_Stub(bench_claim_cb);
+    usb_host_interface_release_Stub(bench_release_cb);
+    usb_host_endpoint_halt_Stub(link_endpoint_cb);
+    usb_host_endpoint_flush_Stub(link_flush_cb);
+    usb_host_endpoint_clear_Stub(link_endpoint_cb);
+
+    usb_host_client_register_ExpectAnyArgsAndReturn(ESP_OK);
+    usb_host_client_register_AddCallback(usb_host_client_register_mock_callback);
+    usb_host_client_handle_events_ExpectAnyArgsAndReturn(ESP_OK);
+    usb_host_client_handle_events_AddCallback(usb_host_client_handle_events_mock_callback);
+
+    const uac_host_driver_config_t driver_config = {
+        .create_background_task = true,
+        .task_priority = 5,
+        .stack_size = 4096,
+        .core_id = 0,
+        .callback = bench_driver_cb,
+        .callback_arg = NULL
+    };
+    REQUIRE(ESP_OK == uac_host_install(&driver_config));
+}
+
+static void bench_uninstall(void)
+{
+    usb_host_client_unblock_ExpectAnyArgsAndReturn(ESP_OK);
+    usb_host_client_unblock_AddCallback(usb_host_client_unblock_mock_callback);
+    usb_host_client_deregister_ExpectAnyArgsAndReturn(ESP_OK);
+    usb_host_client_deregister_AddCallback(usb_host_client_deregister_mock_callback);
+    REQUIRE(ESP_OK == uac_host_uninstall());
+}
+
+static uac_host_device_handle_t bench_open(uint8_t iface_num, uint32_t buffer_size, uint32_t threshold, bool *ready)
+{
+    uac_host_device_config_t dev_config = {};
+    dev_config.addr = BENCH_DEV_ADDR;
+    dev_config.iface_num = iface_num;
+    dev_config.buffer_size = buffer_size;
+    dev_config.buffer_threshold = threshold;
+    dev_config.callback = bench_device_cb;
+    dev_config.callback_arg = ready;
+    uac_host_device_handle_t uac_dev_handle = nullptr;
+    REQUIRE(ESP_OK == uac_host_device_open(&dev_config, &uac_dev_handle));
+    REQUIRE(uac_dev_handle != nullptr);
+
+    bench_link_reset();
+    const uac_host_stream_config_t stream_config = {
+        .channels = BENCH_CHANNELS,
+        .bit_resolution = 16,
+        .sample_freq = BENCH_SAMPLE_FREQ,
+        .flags = 0,
+        .latency_ms = 0,
+    };
+    REQUIRE(ESP_OK == uac_host_device_start(uac_dev_handle, &stream_config));
+    return uac_dev_handle;
+}
+
+TEST_CASE("UAC streaming benchmark", "[benchmark]")
+{
+    bench_install();
+
+    // Buffer 20 ms and 40 ms, threshold 5 ms and 10 ms of 48 kHz 16-bit stereo
+    const uint32_t buffer_size = GENERATE(3840, 7680);
+    const uint32_t threshold = GENERATE(960, 1920);
+    uac_host_stream_stats_t stream_stats = {};
+    bool ready = false;
+
+    SECTION("Microphone") {
+        uac_host_device_handle_t mic = bench_open(BENCH_MIC_IFACE, buffer_size, threshold, &ready);
+        std::vector<uint8_t> rx_buf(buffer_size);
+
+        for (int ms = 0; ms < BENCH_DURATION_MS; ms++) {
+            link_tick();
+            if (!ready) {
+                continue;
+            }
+            // the application reads all buffered data, when the driver reports the threshold
+            ready = false;
+            uint32_t bytes_read = 0;
+            const auto start = std::chrono::steady_clock::now();
+            esp_err_t ret = uac_host_device_read(mic, rx_buf.data(), rx_buf.size(), &bytes_read, 0);
+            bench_stats.ring_time += std::chrono::steady_clock::now() - start;
+            if (ret == ESP_OK) {
+                bench_stats.ring_bytes += bytes_read;
+                bench_frames_check(rx_buf.data(), bytes_read / BENCH_FRAME_BYTES, BENCH_PACKET_FRAMES);
+            }
+        }
+
+        REQUIRE(ESP_OK == uac_host_device_get_stream_stats(mic, &stream_stats));
+        REQUIRE(bench_stats.frames > 0);
+        REQUIRE(bench_stats.order_errors == 0);
+        REQUIRE(stream_stats.rx_overflows == 0);
+        bench_report("mic", buffer_size, threshold, &stream_stats).print();
+        REQUIRE(ESP_OK == uac_host_device_close(mic));
+    }
+
+    SECTION("Microphone push-to-talk") {
+        uac_host_device_handle_t mic = bench_open(BENCH_MIC_IFACE, buffer_size, threshold, &ready);
+        std::vector<uint8_t> rx_buf(buffer_size);
+        const uint32_t alloc_cnt = bench_alloc_cnt;
+        std::chrono::nanoseconds resume_time{};
+        std::chrono::nanoseconds resume_time_max{};
+        uint32_t resume_cnt = 0;
+        bool talking = true;
+
+        for (int ms = 0; ms < BENCH_DURATION_MS; ms++) {
+            // the stream is suspended in the second half of each period, the buffered data are dropped
+            const bool talk = (ms % BENCH_PTT_PERIOD_MS) < BENCH_PTT_PERIOD_MS / 2;
+            if (talk != talking) {
+                talking = talk;
+                ready = false;
+                if (talk) {
+                    const auto start = std::chrono::steady_clock::now();
+                    REQUIRE(ESP_OK == uac_host_device_resume(mic));
+                    const auto elapsed = std::chrono::steady_clock::now() - start;
+                    resume_time += elapsed;
+                    resume_time_max = std::max(resume_time_max, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+                    resume_cnt++;
+                } else {
+                    REQUIRE(ESP_OK == uac_host_device_suspend(mic));
+                    link_expected_frame = link_next_frame;
+                }
+            }
+            link_tick();
+            if (!ready) {
+                continue;
+            }
+            ready = false;
+            uint32_t bytes_read = 0;
+            const auto start = std::chrono::steady_clock::now();
+            esp_err_t ret = uac_host_device_read(mic, rx_buf.data(), rx_buf.size(), &bytes_read, 0);
+            bench_stats.ring_time += std::chrono::steady_clock::now() - start;
+            if (ret == ESP_OK) {
+                bench_stats.ring_bytes += bytes_read;
+                bench_frames_check(rx_buf.data(), bytes_read / BENCH_FRAME_BYTES, BENCH_PACKET_FRAMES);
+            }
+        }
+
+        REQUIRE(ESP_OK == uac_host_device_get_stream_stats(mic, &stream_stats));
+        REQUIRE(bench_stats.frames > 0);
+        REQUIRE(bench_stats.order_errors == 0);
+        // suspend and resume keep the transfers of the stream
+        REQUIRE(bench_alloc_cnt == alloc_cnt);
+        bench_report("mic_push_to_talk", buffer_size, threshold, &stream_stats)
+        .value("resumes", resume_cnt)
+        .value("resume_ns_avg", (double)resume_time.count() / resume_cnt)
+        .value("resume_ns_max", (int64_t)resume_time_max.count())
+        .print();
+        REQUIRE(ESP_OK == uac_host_device_close(mic));
+    }
+
+    SECTION("Speaker") {
+        uac_host_device_handle_t spk = bench_open(BENCH_SPK_IFACE, buffer_size, threshold, &ready);
+        std::vector<uint8_t> tx_buf(BENCH_TX_BLOCK_FRAMES * BENCH_FRAME_BYTES);
+
+        // the stream starts by the first write
+        ready = true;
+        for (int ms = 0; ms < BENCH_DURATION_MS; ms++) {
+            if (ready) {
+                // the application writes one block, when the driver reports the threshold
+                ready = false;
+                for (int i = 0; i < BENCH_TX_BLOCK_FRAMES; i++) {
+                    frame_encode(tx_buf.data() + i * BENCH_FRAME_BYTES, link_next_frame + i);
+                }
+                const auto start = std::chrono::steady_clock::now();
+                esp_err_t ret = uac_host_device_write(spk, tx_buf.data(), tx_buf.size(), 0);
+                bench_stats.ring_time += std::chrono::steady_clock::now() - start;
+                if (ret == ESP_OK) {
+                    bench_stats.ring_bytes += tx_buf.size();
+                    link_next_frame += BENCH_TX_BLOCK_FRAMES;
+                    link_frame_ms.push_back(link_ms);
+                }
+            }
+            link_tick();
+        }
+
+        REQUIRE(ESP_OK == uac_host_device_get_stream_stats(spk, &stream_stats));
+        REQUIRE(bench_stats.frames > 0);
+        REQUIRE(bench_stats.order_errors == 0);
+        bench_report("speaker", buffer_size, threshold, &stream_stats).print();
+        REQUIRE(ESP_OK == uac_host_device_close(spk));
+    }
+
+    bench_uninstall();
+}
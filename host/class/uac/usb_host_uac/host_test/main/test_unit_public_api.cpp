@@ -112,6 +112,278 @@ SCENARIO("UAC Host install")
     }
 }
 
+SCENARIO("UAC Host device open")
+{
+    // UAC Host driver successfully installed, no UAC device opened
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_config_t dev_config = {};
+        dev_config.addr = 1;
+        dev_config.iface_num = 1;
+        dev_config.buffer_size = 1024;
+        uac_host_device_handle_t uac_dev_handle = nullptr;
+
+        SECTION("Config error: notification task without notification bits") {
+            dev_config.notify_task = reinterpret_cast<TaskHandle_t>(0xdeadbeef);
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_open(&dev_config, &uac_dev_handle));
+            REQUIRE(nullptr == uac_dev_handle);
+        }
+    }
+}
+
+SCENARIO("UAC Host zero-copy buffer access")
+{
+    // UAC Host driver successfully installed, no UAC device opened
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_handle_t unknown_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uint8_t *data = nullptr;
+        uint32_t size = 0;
+
+        SECTION("Handle of not opened device is rejected") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_read_acquire(unknown_handle, &data, &size, 0));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_read_release(unknown_handle, 0));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_write_acquire(unknown_handle, &data, &size, 0));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_write_commit(unknown_handle, 0));
+        }
+    }
+}
+
+SCENARIO("UAC Host stream statistics")
+{
+    // UAC Host driver successfully installed, no UAC device opened
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_handle_t unknown_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uac_host_stream_stats_t stats;
+
+        SECTION("Handle of not opened device is rejected") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_get_stream_stats(unknown_handle, &stats));
+        }
+    }
+}
+
+SCENARIO("UAC Host full-duplex session")
+{
+    // UAC Host driver successfully installed, no UAC device opened
+    GIVEN("UAC Host previously installed") {
+        uac_host_duplex_config_t duplex_config = {};
+        duplex_config.rx_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        duplex_config.tx_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uac_host_duplex_handle_t duplex = nullptr;
+
+        SECTION("Config is nullptr") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_duplex_start(nullptr, &duplex));
+        }
+
+        SECTION("Handles of not opened devices are rejected") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_duplex_start(&duplex_config, &duplex));
+            REQUIRE(nullptr == duplex);
+        }
+
+        SECTION("Session is nullptr") {
+            int32_t offset = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_duplex_get_loopback_offset(nullptr, &offset));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_duplex_stop(nullptr));
+        }
+    }
+}
+
+SCENARIO("UAC Host mixer")
+{
+    // UAC Host driver successfully installed, no UAC device opened
+    GIVEN("UAC Host previously installed") {
+        uac_host_mixer_port_t port = {};
+        port.handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        port.channels = 2;
+        uac_host_mixer_config_t mixer_config = {};
+        mixer_config.ports = &port;
+        mixer_config.port_num = 1;
+        mixer_config.channels = 2;
+        mixer_config.block_frames = 48;
+        uac_host_mixer_handle_t mixer = nullptr;
+
+        SECTION("Config is nullptr") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_create(nullptr, &mixer));
+        }
+
+        SECTION("Config without ports or block size is rejected") {
+            mixer_config.port_num = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_create(&mixer_config, &mixer));
+            mixer_config.port_num = 1;
+            mixer_config.block_frames = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_create(&mixer_config, &mixer));
+        }
+
+        SECTION("Handle of not opened device is rejected") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_create(&mixer_config, &mixer));
+            REQUIRE(nullptr == mixer);
+        }
+
+        SECTION("Mixer is nullptr") {
+            uint8_t data[4] = {};
+            uint32_t frames_read = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_write(nullptr, data, 1, 0));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_read(nullptr, data, 1, &frames_read, 0));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_mixer_delete(nullptr));
+        }
+    }
+}
+
+SCENARIO("UAC Host encoder")
+{
+    // UAC Host driver successfully installed, no UAC device opened
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_handle_t unknown_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uac_host_ima_adpcm_t adpcm;
+        uint8_t data[64] = {};
+        size_t data_len = 0;
+
+        SECTION("Handle of not opened device is rejected") {
+            REQUIRE(ESP_OK == uac_host_ima_adpcm_init(&adpcm, 2));
+            uac_host_encoder_config_t encoder_config = {};
+            encoder_config.block_frames = 8;
+            encoder_config.encode = uac_host_ima_adpcm_encode;
+            encoder_config.ctx = &adpcm;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_set_encoder(unknown_handle, &encoder_config));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_read_encoded(unknown_handle, data, sizeof(data), &data_len, 0));
+        }
+
+        SECTION("IMA-ADPCM block is decoded") {
+            const int16_t pcm[8] = {0, 1000, 2000, 3000, 2000, 1000, 0, -1000};
+            int16_t decoded[8] = {};
+            uint32_t frames = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_ima_adpcm_init(&adpcm, 0));
+            REQUIRE(ESP_OK == uac_host_ima_adpcm_init(&adpcm, 1));
+            REQUIRE(ESP_ERR_INVALID_SIZE == uac_host_ima_adpcm_encode(&adpcm, reinterpret_cast<const uint8_t *>(pcm), 8, data, 4, &data_len));
+            REQUIRE(ESP_OK == uac_host_ima_adpcm_encode(&adpcm, reinterpret_cast<const uint8_t *>(pcm), 8, data, sizeof(data), &data_len));
+            REQUIRE(uac_host_ima_adpcm_block_size(1, 8) == data_len);
+            REQUIRE(ESP_OK == uac_host_ima_adpcm_decode(data, data_len, 1, decoded, 8, &frames));
+            REQUIRE(8 == frames);
+            // the decoder follows the same steps as the encoder
+            REQUIRE(adpcm.predictor[0] == decoded[7]);
+        }
+    }
+}
+
+SCENARIO("UAC Host PCM conversion")
+{
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_handle_t unknown_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uac_host_convert_config_t convert_config = {};
+        // two 16-bit stereo frames
+        const uint8_t pcm[8] = {0x01, 0x00, 0xff, 0xff, 0x00, 0x80, 0xff, 0x7f};
+
+        SECTION("Handle of not opened device is rejected") {
+            int32_t samples[4] = {};
+            void *out[1] = {samples};
+            uint32_t frames_read = 0;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_read_converted(unknown_handle, &convert_config, out, 2, &frames_read, 0));
+        }
+
+        SECTION("Interleaved 16-bit frames are converted to MSB aligned 32-bit samples") {
+            int32_t samples[4] = {};
+            void *out[1] = {samples};
+            REQUIRE(ESP_OK == uac_host_pcm_convert(pcm, 2, 2, 2, &convert_config, out, 0));
+            REQUIRE(0x00010000 == samples[0]);
+            REQUIRE(-0x00010000 == samples[1]);
+            REQUIRE(INT32_MIN == samples[2]);
+            REQUIRE(0x7fff0000 == samples[3]);
+        }
+
+        SECTION("Selected channel of 24-bit frames is converted to float") {
+            const uint8_t pcm24[6] = {0x00, 0x00, 0x40, 0x00, 0x00, 0xc0};
+            float samples[1] = {};
+            void *out[1] = {samples};
+            convert_config.format = UAC_HOST_SAMPLE_FLOAT;
+            convert_config.channel_mask = 1 << 1;
+            REQUIRE(ESP_OK == uac_host_pcm_convert(pcm24, 1, 2, 3, &convert_config, out, 0));
+            REQUIRE(-0.5f == samples[0]);
+        }
+
+        SECTION("Planar output has one buffer per channel") {
+            int32_t left[2] = {};
+            int32_t right[2] = {};
+            void *out[2] = {left, right};
+            convert_config.planar = true;
+            REQUIRE(ESP_OK == uac_host_pcm_convert(pcm, 2, 2, 2, &convert_config, out, 0));
+            REQUIRE(0x00010000 == left[0]);
+            REQUIRE(INT32_MIN == left[1]);
+            REQUIRE(-0x00010000 == right[0]);
+            REQUIRE(0x7fff0000 == right[1]);
+        }
+
+        SECTION("Unsupported formats are rejected") {
+            int32_t samples[4] = {};
+            void *out[1] = {samples};
+            REQUIRE(ESP_ERR_NOT_SUPPORTED == uac_host_pcm_convert(pcm, 4, 2, 1, &convert_config, out, 0));
+            convert_config.channel_mask = 1 << 2;
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_pcm_convert(pcm, 2, 2, 2, &convert_config, out, 0));
+        }
+    }
+}
+
+SCENARIO("UAC Host level meter")
+{
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_handle_t unknown_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uac_host_meter_config_t meter_config = {};
+        meter_config.window_frames = 480;
+        meter_config.vad_threshold_db = -40 * 256;
+        uac_host_meter_level_t level = {};
+
+        SECTION("Handle of not opened device is rejected") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_set_meter(unknown_handle, &meter_config));
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_get_level(unknown_handle, &level));
+        }
+    }
+}
+
+SCENARIO("UAC Host audio/video sync")
+{
+    GIVEN("UAC Host previously installed") {
+        uac_host_device_handle_t unknown_handle = reinterpret_cast<uac_host_device_handle_t>(0xdeadbeef);
+        uac_host_stream_clock_t clock = {};
+
+        SECTION("Handle of not opened device is rejected") {
+            REQUIRE(ESP_ERR_INVALID_ARG == uac_host_device_get_stream_clock(unknown_handle, &clock));
+        }
+    }
+
+    GIVEN("Microphone 100 ppm faster than nominal 48 kHz, transfers completed with up to 500 us delay") {
+        uac_host_av_sync_config_t config = {};
+        config.sample_freq = 48000;
+        config.window_ms = 8000;
+        uac_host_av_sync_handle_t sync = nullptr;
+        REQUIRE(ESP_OK == uac_host_av_sync_create(&config, &sync));
+        uac_host_av_sync_stats_t stats = {};
+        REQUIRE(ESP_ERR_INVALID_STATE == uac_host_av_sync_get_stats(sync, &stats));
+
+        // frame 0 at host time 0, one transfer each millisecond for 10 s
+        for (int64_t ms = 1; ms <= 10000; ms++) {
+            clock.frames = ms * 48000 * 1000100 / 1000000000;
+            clock.time_us = ms * 1000 + (ms * 37) % 500;
+            REQUIRE(ESP_OK == uac_host_av_sync_audio_update(sync, &clock));
+        }
+        REQUIRE(ESP_OK == uac_host_av_sync_video_update(sync, 20000));
+        REQUIRE(ESP_OK == uac_host_av_sync_video_update(sync, 53333)); // only the first frame is the start
+
+        SECTION("Drift and offset are measured") {
+            REQUIRE(ESP_OK == uac_host_av_sync_get_stats(sync, &stats));
+            REQUIRE(stats.drift_ppm > 95.0f);
+            REQUIRE(stats.drift_ppm < 105.0f);
+            REQUIRE(stats.video_start_us == 20000);
+            REQUIRE(stats.offset_us > -20100);
+            REQUIRE(stats.offset_us < -19900);
+        }
+
+        SECTION("Audio frames are mapped to the host clock") {
+            int64_t time_us = 0;
+            REQUIRE(ESP_OK == uac_host_av_sync_audio_time(sync, 48005, &time_us));
+            REQUIRE(time_us > 1000000 - 100);
+            REQUIRE(time_us < 1000000 + 100);
+        }
+        REQUIRE(ESP_OK == uac_host_av_sync_delete(sync));
+    }
+}
+
 SCENARIO("UAC Host post-uninstall")
 {
     // UAC Host driver successfully installed
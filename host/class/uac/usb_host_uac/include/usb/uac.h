@@ -504,6 +504,199 @@ typedef struct {
     uint16_t wLockDelay;
 } __attribute__((packed)) uac_as_cs_ep_desc_t;
 
+/********************************* Refer audio20.pdf ***************************************************/
+
+/**
+ * @brief Audio Class-Specific AC Interface Descriptor Subtypes added by UAC 2.0
+ *
+ * Subtypes up to the Feature Unit keep the values of UAC 1.0
+ *
+ * @see Table A-9 of audio20.pdf
+ */
+typedef enum {
+    UAC2_AC_CLOCK_SOURCE                              = 0x0A,
+    UAC2_AC_CLOCK_SELECTOR                            = 0x0B,
+    UAC2_AC_CLOCK_MULTIPLIER                          = 0x0C
+} uac2_ac_descriptor_subtype_t;
+
+/**
+ * @brief Audio Class-Specific Request Codes of UAC 2.0
+ *
+ * The direction of the request is given by bmRequestType
+ *
+ * @see Table A-14 of audio20.pdf
+ */
+typedef enum {
+    UAC2_REQUEST_CODE_UNDEFINED                       = 0x00,
+    UAC2_CUR                                          = 0x01,
+    UAC2_RANGE                                        = 0x02
+} uac2_request_code_t;
+
+/**
+ * @brief Clock Source Control Selectors
+ *
+ * @see Table A-17 of audio20.pdf
+ */
+typedef enum {
+    UAC2_CS_CONTROL_UNDEFINED                         = 0x00,
+    UAC2_CS_SAM_FREQ_CONTROL                          = 0x01,
+    UAC2_CS_CLOCK_VALID_CONTROL                       = 0x02
+} uac2_cs_control_selector_t;
+
+#define UAC2_CONTROL_PROGRAMMABLE  (0x03)   /*!< bmControls bit pair of host programmable control */
+#define UAC2_FORMAT_PCM            (0x01)   /*!< bmFormats bit of Type I PCM format */
+
+/**
+ * @brief Audio Class-Specific AC Interface Header Descriptor of UAC 2.0
+ *
+ * @see Table 4-5 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint16_t bcdADC;
+    uint8_t bCategory;
+    uint16_t wTotalLength;
+    uint8_t bmControls;
+} __attribute__((packed)) uac2_ac_header_desc_t;
+
+/**
+ * @brief Clock Source Descriptor
+ *
+ * @see Table 4-6 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bClockID;
+    uint8_t bmAttributes;
+    uint8_t bmControls;
+    uint8_t bAssocTerminal;
+    uint8_t iClockSource;
+} __attribute__((packed)) uac2_ac_clock_source_desc_t;
+
+/**
+ * @brief Clock Selector Descriptor (pins=2)
+ *
+ * @see Table 4-7 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bClockID;
+    uint8_t bNrInPins;
+    uint8_t baCSourceID[2];
+    uint8_t bmControls;
+    uint8_t iClockSelector;
+} __attribute__((packed)) uac2_ac_clock_selector_desc_t;
+
+/**
+ * @brief Clock Multiplier Descriptor
+ *
+ * @see Table 4-8 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bClockID;
+    uint8_t bCSourceID;
+    uint8_t bmControls;
+    uint8_t iClockMultiplier;
+} __attribute__((packed)) uac2_ac_clock_multiplier_desc_t;
+
+/**
+ * @brief Input Terminal Descriptor of UAC 2.0
+ *
+ * @see Table 4-9 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t bAssocTerminal;
+    uint8_t bCSourceID;
+    uint8_t bNrChannels;
+    uint32_t bmChannelConfig;
+    uint8_t iChannelNames;
+    uint16_t bmControls;
+    uint8_t iTerminal;
+} __attribute__((packed)) uac2_ac_input_terminal_desc_t;
+
+/**
+ * @brief Output Terminal Descriptor of UAC 2.0
+ *
+ * @see Table 4-10 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t bAssocTerminal;
+    uint8_t bSourceID;
+    uint8_t bCSourceID;
+    uint16_t bmControls;
+    uint8_t iTerminal;
+} __attribute__((packed)) uac2_ac_output_terminal_desc_t;
+
+/**
+ * @brief Feature Unit Descriptor of UAC 2.0 (ch=2)
+ *
+ * Each control takes two bits of bmaControls, the Mute Control bits 0-1 and the Volume Control bits 2-3
+ *
+ * @see Table 4-13 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bUnitID;
+    uint8_t bSourceID;
+    uint32_t bmaControls[3]; // 2 channels + channel 0
+    uint8_t iFeature;
+} __attribute__((packed)) uac2_ac_feature_unit_desc_t;
+
+/**
+ * @brief Class-Specific AS Interface Descriptor of UAC 2.0
+ *
+ * @see Table 4-27 of audio20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bTerminalLink;
+    uint8_t bmControls;
+    uint8_t bFormatType;
+    uint32_t bmFormats;
+    uint8_t bNrChannels;
+    uint32_t bmChannelConfig;
+    uint8_t iChannelNames;
+} __attribute__((packed)) uac2_as_general_desc_t;
+
+/**
+ * @brief Type I Format Type Descriptor of UAC 2.0
+ *
+ * The sampling frequencies are reported by the Clock Source, not by the format descriptor
+ *
+ * @see Table 2-2 of frmts20.pdf
+ */
+typedef struct {
+    uint8_t bLength;
+    uint8_t bDescriptorType;
+    uint8_t bDescriptorSubtype;
+    uint8_t bFormatType;
+    uint8_t bSubslotSize;
+    uint8_t bBitResolution;
+} __attribute__((packed)) uac2_as_type_I_format_desc_t;
+
 /**
  * @brief Print UAC device full configuration descriptor
  *
@@ -9,6 +9,7 @@
 #include <wchar.h>
 #include <stdint.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_err.h"
 #include "uac.h"
 
@@ -36,7 +37,34 @@ extern "C" {
 */
 #define FLAG_STREAM_SUSPEND_AFTER_START      (1 << 0)
 
+/**
+ * FLAG_STREAM_SAMPLE_RATE_CONVERT: if the device does not support the sample frequency, stream at the nearest supported one
+ * and convert the rate of 16-bit PCM data in uac_host_device_read and uac_host_device_write
+ * @note Zero-copy buffer access is not available with the conversion
+*/
+#define FLAG_STREAM_SAMPLE_RATE_CONVERT      (1 << 1)
+
+/**
+ * FLAG_STREAM_XRUN_EVENTS: report UAC_HOST_DEVICE_EVENT_RX_OVERFLOW and UAC_HOST_DEVICE_EVENT_TX_UNDERFLOW events
+ * FLAG_STREAM_RX_DROP_OLDEST: on RX overflow drop the oldest data in the buffer instead of the newly received data
+ * @note Zero-copy read is not available with FLAG_STREAM_RX_DROP_OLDEST
+ * FLAG_STREAM_TX_INSERT_SILENCE: on TX underrun send silence (zero samples), so the stream keeps running until stopped
+*/
+#define FLAG_STREAM_XRUN_EVENTS              (1 << 2)
+#define FLAG_STREAM_RX_DROP_OLDEST           (1 << 3)
+#define FLAG_STREAM_TX_INSERT_SILENCE        (1 << 4)
+
+/**
+ * FLAG_STREAM_SOFT_VOLUME: apply volume and mute to 16 or 32-bit PCM data in the host instead of the device Feature Unit.
+ * Volume and mute calls do not send control requests, changes ramp over a few frames to avoid clicks
+ * @note Software volume only attenuates, 100 % is 0 dB and 1 % is -60 dB
+*/
+#define FLAG_STREAM_SOFT_VOLUME              (1 << 5)
+
 typedef struct uac_interface *uac_host_device_handle_t;    /*!< Logic Device Handle. Handle to a particular UAC interface */
+typedef struct uac_duplex *uac_host_duplex_handle_t;      /*!< Full-duplex session of microphone and speaker of one device */
+typedef struct uac_mixer *uac_host_mixer_handle_t;        /*!< Mixer of several microphones, or fan-out to several speakers */
+typedef struct uac_av_sync *uac_host_av_sync_handle_t;    /*!< Audio/video synchronization of a microphone with a camera */
 
 // ------------------------ USB UAC Host events --------------------------------
 /**
@@ -55,6 +83,9 @@ typedef enum {
     UAC_HOST_DEVICE_EVENT_TX_DONE,                       /*!< TX Done: the transmit buffer data size falls below the threshold */
     UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR,                /*!< UAC Device transfer error */
     UAC_HOST_DRIVER_EVENT_DISCONNECTED,                  /*!< UAC Device has been disconnected */
+    UAC_HOST_DEVICE_EVENT_RX_OVERFLOW,                   /*!< RX data dropped, the receive buffer is full. Only with FLAG_STREAM_XRUN_EVENTS */
+    UAC_HOST_DEVICE_EVENT_TX_UNDERFLOW,                  /*!< TX underrun started, the transmit buffer has not enough data. Only with FLAG_STREAM_XRUN_EVENTS */
+    UAC_HOST_DEVICE_EVENT_VAD_CHANGED,                   /*!< Voice activity started or ended. Only with a meter set by uac_host_device_set_meter() */
 } uac_host_device_event_t;
 
 // ------------------------ USB UAC Host events callbacks -----------------------------
@@ -159,10 +190,23 @@ typedef struct {
 typedef struct {
     uint8_t addr;                                       /*!< USB Address of connected physical device */
     uint8_t iface_num;                                  /*!< UAC Interface Number */
-    uint32_t buffer_size;                               /*!< Audio buffer size */
+    uint32_t buffer_size;                               /*!< Audio buffer size, its storage is rounded up to power of two */
     uint32_t buffer_threshold;                          /*!< Audio buffer threshold */
+    uint8_t *buffer;                                    /*!< Storage of the audio buffer provided by the user, NULL to allocate it.
+                                                             Must hold buffer_size rounded up to power of two bytes and stay valid
+                                                             until the device is closed, the driver does not free it */
     uac_host_device_event_cb_t callback;                /*!< Callback invoked when UAC device event occurs */
     void *callback_arg;                                 /*!< User provided argument passed to callback */
+    TaskHandle_t notify_task;                           /*!< Task notified instead of UAC_HOST_DEVICE_EVENT_RX_DONE and
+                                                             UAC_HOST_DEVICE_EVENT_TX_DONE callbacks, NULL to use the callback.
+                                                             RX: notified once when the buffer fills up to the threshold,
+                                                             TX: notified once when the buffer drains down to the threshold.
+                                                             The notification is armed again after the level moves back
+                                                             across the threshold, so read or write until it does */
+    uint32_t notify_bits;                               /*!< Bits set in the notification value of notify_task, by eSetBits */
+    bool restore_stream;                                /*!< If the interface was disconnected while streaming, start the stream with
+                                                             the previous configuration, volume and mute when it is opened again.
+                                                             Needs CONFIG_UAC_RECONNECT_CACHE_NUM > 0 */
 } uac_host_device_config_t;
 
 /**
@@ -174,8 +218,174 @@ typedef struct {
     uint8_t bit_resolution;                              /*!< Audio bit resolution */
     uint32_t sample_freq;                                /*!< Audio sample resolution */
     uint16_t flags;                                      /*!< Control flags */
+    uint16_t latency_ms;                                 /*!< Audio queued in USB transfers in ms, the driver derives number of
+                                                              transfers and packets per transfer from it. Lower latency has higher
+                                                              risk of dropouts. 0: CONFIG_UAC_NUM_ISOC_URBS and
+                                                              CONFIG_UAC_NUM_PACKETS_PER_URB */
 } uac_host_stream_config_t;
 
+/**
+ * @brief UAC full-duplex session configuration structure
+ *
+*/
+typedef struct {
+    uac_host_device_handle_t rx_handle;                  /*!< Opened microphone interface */
+    uac_host_device_handle_t tx_handle;                  /*!< Opened speaker interface of the same device */
+    uac_host_stream_config_t rx_config;                  /*!< Microphone stream configuration */
+    uac_host_stream_config_t tx_config;                  /*!< Speaker stream configuration, with the same sample frequency */
+} uac_host_duplex_config_t;
+
+/**
+ * @brief UAC mixer port, one started 16-bit PCM stream
+ *
+*/
+typedef struct {
+    uac_host_device_handle_t handle;                     /*!< Opened and started interface */
+    uint8_t channels;                                    /*!< Channels of the stream, equal to the mixer channels or 1 */
+} uac_host_mixer_port_t;
+
+/**
+ * @brief UAC mixer configuration structure
+ *
+ * All ports are microphones mixed into one stream, or speakers all playing one stream.
+ * The streams of the ports run at the same sample frequency with 16-bit samples.
+*/
+typedef struct {
+    const uac_host_mixer_port_t *ports;                  /*!< Ports of the mixer, of the same direction */
+    uint8_t port_num;                                    /*!< Number of ports */
+    uint8_t channels;                                    /*!< Channels of the mixer data */
+    uint32_t block_frames;                               /*!< Frames moved to or from all ports in each step, e.g. frames of 1 ms */
+} uac_host_mixer_config_t;
+
+/**
+ * @brief UAC stream statistics, reset when the stream is started
+ *
+*/
+typedef struct {
+    uint32_t rx_overflows;                               /*!< RX transfers with data dropped, because the buffer was full */
+    uint32_t rx_dropped_bytes;                           /*!< Bytes dropped by RX overflows */
+    uint32_t tx_underruns;                               /*!< TX transfers, which had not enough data in the buffer */
+    uint32_t tx_silence_bytes;                           /*!< Bytes of silence sent on TX underruns, with FLAG_STREAM_TX_INSERT_SILENCE */
+} uac_host_stream_stats_t;
+
+/**
+ * @brief UAC RX stream clock, reset when the stream is started
+ *
+ * frames - buffered is the position of the next frame returned by the stream read functions.
+ * Frames dropped by RX overflows are counted in frames, so the position jumps over them.
+*/
+typedef struct {
+    uint64_t frames;                                     /*!< Audio frames received by the endpoint since the stream was started */
+    int64_t time_us;                                     /*!< Host time of the transfer completion which reached `frames`, in microseconds of esp_timer_get_time() */
+    uint32_t buffered;                                   /*!< Frames waiting in the stream buffer at that time */
+} uac_host_stream_clock_t;
+
+/**
+ * @brief Encoder of one block of RX audio frames, e.g. uac_host_ima_adpcm_encode() or a wrapper of an Opus encoder
+ *
+ * @param[in]  ctx        Encoder context of uac_host_encoder_config_t
+ * @param[in]  pcm        Frames of the block, with interleaved channels
+ * @param[in]  frames     Number of frames, block_frames of uac_host_encoder_config_t
+ * @param[out] out        Buffer for the encoded block
+ * @param[in]  out_size   Size of the buffer
+ * @param[out] out_len    Length of the encoded block
+ * @return esp_err_t
+ */
+typedef esp_err_t (*uac_host_encode_cb_t)(void *ctx, const uint8_t *pcm, uint32_t frames, uint8_t *out, size_t out_size,
+                                          size_t *out_len);
+
+/**
+ * @brief UAC RX encoder configuration structure
+ *
+*/
+typedef struct {
+    uint32_t block_frames;                               /*!< Frames of each encoded block, e.g. 480 for 10 ms at 48 kHz */
+    uac_host_encode_cb_t encode;                         /*!< Encoder of one block */
+    void *ctx;                                           /*!< Encoder context, passed to encode */
+} uac_host_encoder_config_t;
+
+#define UAC_IMA_ADPCM_MAX_CHANNELS          (8)          /*!< Maximum channels of IMA-ADPCM encoder */
+
+/**
+ * @brief IMA-ADPCM encoder state of 16-bit PCM
+ *
+ * Each block starts with a header per channel: the predictor as 16-bit little-endian sample, the step index and a zero byte.
+ * The 4-bit codes of all samples follow, channels interleaved as in the PCM frames, low nibble first.
+ * Blocks are decoded independently of each other.
+*/
+typedef struct {
+    uint8_t channels;                                    /*!< Channels of the PCM frames */
+    int16_t predictor[UAC_IMA_ADPCM_MAX_CHANNELS];       /*!< Predicted sample of each channel */
+    uint8_t step_index[UAC_IMA_ADPCM_MAX_CHANNELS];      /*!< Step index of each channel */
+} uac_host_ima_adpcm_t;
+
+#define UAC_HOST_CONVERT_MAX_CHANNELS       (32)         /*!< Maximum channels of PCM frames converted by uac_host_pcm_convert() */
+
+/**
+ * @brief Sample format of converted PCM data
+ *
+*/
+typedef enum {
+    UAC_HOST_SAMPLE_S32 = 0,                             /*!< Signed 32-bit integer, samples of lower resolution are MSB aligned */
+    UAC_HOST_SAMPLE_FLOAT,                               /*!< 32-bit float, full scale -1.0 to 1.0 */
+} uac_host_sample_format_t;
+
+/**
+ * @brief PCM conversion configuration structure
+ *
+ * 16, 24 (packed 3-byte) and 32-bit little-endian PCM frames are converted in one pass:
+ * selected channels are picked, converted to the sample format and written interleaved or one buffer per channel.
+*/
+typedef struct {
+    uac_host_sample_format_t format;                     /*!< Sample format of the output */
+    uint32_t channel_mask;                               /*!< Bit N selects channel N, 0 selects all channels */
+    bool planar;                                         /*!< Write each selected channel into its own buffer, instead of interleaved into one buffer */
+} uac_host_convert_config_t;
+
+#define UAC_HOST_METER_MAX_CHANNELS         (8)          /*!< Maximum channels of RX level meter */
+
+/**
+ * @brief UAC RX level meter configuration structure
+ *
+*/
+typedef struct {
+    uint32_t window_frames;                              /*!< Frames of each metering window, e.g. 480 for 10 ms at 48 kHz */
+    int16_t vad_threshold_db;                            /*!< RMS level of voice activity in 1/256 dB of full scale, e.g. -40 * 256 */
+    uint16_t vad_hangover;                               /*!< Windows below the threshold until the voice activity ends */
+} uac_host_meter_config_t;
+
+/**
+ * @brief UAC RX levels of the last metering window
+ *
+ * Levels are scaled to 16-bit samples, 32768 is full scale for all bit resolutions.
+*/
+typedef struct {
+    uint16_t peak[UAC_HOST_METER_MAX_CHANNELS];          /*!< Largest absolute sample value of each channel */
+    uint16_t rms[UAC_HOST_METER_MAX_CHANNELS];           /*!< Root mean square of the samples of each channel */
+    bool voice;                                          /*!< Voice activity: RMS of any channel above the threshold, or in the hangover */
+    uint32_t windows;                                    /*!< Windows measured since the meter was set */
+} uac_host_meter_level_t;
+
+/**
+ * @brief UAC audio/video synchronization configuration structure
+*/
+typedef struct {
+    uint32_t sample_freq;                                /*!< Nominal sample frequency of the microphone stream */
+    uint32_t window_ms;                                  /*!< Time over which the clock drift is measured, 0 for 10 s */
+} uac_host_av_sync_config_t;
+
+/**
+ * @brief UAC audio/video synchronization statistics
+ *
+ * Host times are in microseconds of esp_timer_get_time().
+*/
+typedef struct {
+    int64_t audio_start_us;                              /*!< Host time of audio frame 0, the start of the microphone stream */
+    int64_t video_start_us;                              /*!< Host capture time of the first video frame */
+    int64_t offset_us;                                   /*!< audio_start_us - video_start_us, positive if audio started after video */
+    float drift_ppm;                                     /*!< Microphone clock against the host clock, positive if the device samples faster. 0 until one window is measured */
+} uac_host_av_sync_stats_t;
+
 // ----------------------------- Public ---------------------------------------
 /**
  * @brief Install USB Host UAC Class driver
@@ -212,7 +422,7 @@ esp_err_t uac_host_uninstall(void);
  * @return esp_err_t
  *  - ESP_OK on success
  *  - ESP_ERR_INVALID_STATE if UAC driver is not installed
- *  - ESP_ERR_INVALID_ARG if the configuration is invalid
+ *  - ESP_ERR_INVALID_ARG if the configuration is invalid, or notify_task is set without notify_bits
  *  - ESP_ERR_NO_MEM if memory allocation failed
  *  - ESP_ERR_NOT_SUPPORTED if the UAC version is not supported
  */
@@ -320,6 +530,9 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
 /**
  * @brief Suspend a UAC stream
  *
+ * The interface is switched to alternate setting 0 and the buffered data are dropped.
+ * The transfers and the ring buffer stay allocated, so the stream is resumed without allocation.
+ *
  * @param[in] uac_dev_handle  UAC device handle
  * @return esp_err_t
  * - ESP_OK on success
@@ -331,6 +544,9 @@ esp_err_t uac_host_device_suspend(uac_host_device_handle_t uac_dev_handle);
 /**
  * @brief Resume a UAC stream with same stream configuration
  *
+ * Only the alternate setting and, if needed, the sample frequency are set again,
+ * the transfers kept by uac_host_device_suspend() are submitted at once.
+ *
  * @param[in] uac_dev_handle  UAC device handle
  * @return esp_err_t
  * - ESP_OK on success
@@ -385,8 +601,114 @@ esp_err_t uac_host_device_read(uac_host_device_handle_t uac_dev_handle, uint8_t
 esp_err_t uac_host_device_write(uac_host_device_handle_t uac_dev_handle, uint8_t *data, uint32_t size,
                                 uint32_t timeout);
 
+/**
+ * @brief Get contiguous segment of received data in UAC stream buffer, without copying. RX stream only
+ *
+ * The data stay in the buffer until they are released by uac_host_device_read_release().
+ * The segment ends at the wrap-around of the buffer, the rest of the data are returned by the next call.
+ *
+ * @note The segment is valid until it is released, or until the stream is suspended or stopped
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] data           Pointer to the start of the segment
+ * @param[out] size           Number of bytes in the segment
+ * @param[in] timeout         Timeout in ticks to wait for data. For milliseconds, please use 'pdMS_TO_TICKS()' macros
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle or output pointer is invalid, or the stream is not RX
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state
+ * - ESP_FAIL if no data were received before timeout
+ */
+esp_err_t uac_host_device_read_acquire(uac_host_device_handle_t uac_dev_handle, uint8_t **data, uint32_t *size,
+                                       uint32_t timeout);
+
+/**
+ * @brief Remove data acquired by uac_host_device_read_acquire() from UAC stream buffer
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[in] size            Number of bytes to remove, at most size of the acquired segment
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle is invalid, or the stream is not RX
+ * - ESP_ERR_INVALID_STATE if the device is not opened
+ * - ESP_ERR_INVALID_SIZE if size is larger than the data in the buffer
+ */
+esp_err_t uac_host_device_read_release(uac_host_device_handle_t uac_dev_handle, uint32_t size);
+
+/**
+ * @brief Get contiguous segment of free space in UAC stream buffer, to be filled without copying. TX stream only
+ *
+ * Data written into the segment are sent after uac_host_device_write_commit().
+ * The segment ends at the wrap-around of the buffer, the rest of the free space is returned by the next call.
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] data           Pointer to the start of the segment
+ * @param[out] size           Number of bytes in the segment
+ * @param[in] timeout         Timeout in ticks to wait for free space. For milliseconds, please use 'pdMS_TO_TICKS()' macros
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle or output pointer is invalid, or the stream is not TX
+ * - ESP_ERR_INVALID_STATE if the device is not in the right state
+ * - ESP_FAIL if the buffer stayed full until timeout
+ */
+esp_err_t uac_host_device_write_acquire(uac_host_device_handle_t uac_dev_handle, uint8_t **data, uint32_t *size,
+                                        uint32_t timeout);
+
+/**
+ * @brief Add data written into segment from uac_host_device_write_acquire() to UAC stream buffer
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[in] size            Number of bytes written, at most size of the acquired segment
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle is invalid, or the stream is not TX
+ * - ESP_ERR_INVALID_STATE if the device is not opened or the stream changed to inactive
+ * - ESP_ERR_INVALID_SIZE if size is larger than the free space in the buffer
+ */
+esp_err_t uac_host_device_write_commit(uac_host_device_handle_t uac_dev_handle, uint32_t size);
+
+/**
+ * @brief Get overflow and underrun statistics of a UAC stream
+ *
+ * @param[in]  uac_dev_handle  UAC device handle
+ * @param[out] stats           Statistics since the stream was started
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle or stats is invalid
+ */
+esp_err_t uac_host_device_get_stream_stats(uac_host_device_handle_t uac_dev_handle, uac_host_stream_stats_t *stats);
+
+/**
+ * @brief Get clock of a UAC RX stream
+ *
+ * Maps the received audio frames to the host clock, e.g. for uac_host_av_sync_audio_update().
+ *
+ * @param[in]  uac_dev_handle  UAC device handle
+ * @param[out] clock           Frames received since the stream was started and the host time of the last transfer
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle or clock is invalid, or the stream is not RX
+ */
+esp_err_t uac_host_device_get_stream_clock(uac_host_device_handle_t uac_dev_handle, uac_host_stream_clock_t *clock);
+
+/**
+ * @brief Get clock drift of asynchronous UAC device, measured by its feedback endpoint. TX stream only
+ *
+ * Packets of asynchronous TX streams follow the rate reported by the feedback endpoint,
+ * so the stream buffer does not underrun or overflow over time. Other streams are sent at the nominal rate.
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[out] drift_ppm      Device rate relative to the nominal sample frequency in ppm, positive if the device runs faster
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the device handle or drift_ppm is invalid
+ * - ESP_ERR_INVALID_STATE if the stream is not active or no feedback was received yet
+ * - ESP_ERR_NOT_SUPPORTED if the stream has no feedback endpoint
+ */
+esp_err_t uac_host_device_get_clock_drift(uac_host_device_handle_t uac_dev_handle, int32_t *drift_ppm);
+
 /**
  * @brief Mute or un-mute the UAC device
+ * @note With FLAG_STREAM_SOFT_VOLUME the stream data are muted by the host
  * @param[in] uac_dev_handle  UAC device handle
  * @param[in] mute        True to mute, false to unmute
  * @return esp_err_t
@@ -413,6 +735,7 @@ esp_err_t uac_host_device_get_mute(uac_host_device_handle_t uac_dev_handle, bool
 
 /**
  * @brief Set the volume of the UAC device
+ * @note With FLAG_STREAM_SOFT_VOLUME the volume is applied to the stream data by the host
  * @param[in] uac_dev_handle  UAC device handle
  * @param[in] volume      Volume to set, 0-100
  * @return esp_err_t
@@ -439,6 +762,7 @@ esp_err_t uac_host_device_get_volume(uac_host_device_handle_t uac_dev_handle, ui
 
 /**
  * @brief Set the volume of the UAC device in dB
+ * @note With FLAG_STREAM_SOFT_VOLUME the volume is applied to the stream data by the host, up to 0 dB
  * @param[in] uac_dev_handle  UAC device handle
  * @param[in] volume_db   Volume to set, with resolution of 1/256 dB,
  * eg.  256 (0x0100) is 1 dB. 32767 (0x7FFF) is 127.996 dB. -32767 (0x8001) is -127.996 dB.
@@ -465,6 +789,386 @@ esp_err_t uac_host_device_set_volume_db(uac_host_device_handle_t uac_dev_handle,
  */
 esp_err_t uac_host_device_get_volume_db(uac_host_device_handle_t uac_dev_handle, int16_t *volume_db);
 
+/**
+ * @brief Start full-duplex streaming of microphone and speaker of one device, e.g. for acoustic echo cancellation
+ *
+ * Both streams are started one after another, their transfers are submitted back to back, to start them in the same USB frame.
+ * The speaker sends silence whenever there is not enough data, so both streams run continuously at the same frame rate.
+ * Write the speaker data by uac_host_device_write, read the microphone data paired with sent speaker data by uac_host_duplex_read.
+ *
+ * @note Do not suspend, stop or close the interfaces of the session, call uac_host_duplex_stop instead
+ * @note Sample rate conversion and zero-copy read are not available in the session
+ * @param[in]  config      Duplex session configuration
+ * @param[out] duplex      Duplex session handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the interfaces are not microphone and speaker of one device, or the sample frequencies differ
+ * - ESP_ERR_INVALID_STATE if an interface is already started
+ * - ESP_ERR_NO_MEM if memory allocation failed
+ * - Other errors of uac_host_device_start
+ */
+esp_err_t uac_host_duplex_start(const uac_host_duplex_config_t *config, uac_host_duplex_handle_t *duplex);
+
+/**
+ * @brief Stop full-duplex streaming and delete the session, the interfaces stay opened
+ *
+ * @param[in] duplex        Duplex session handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the session handle is invalid
+ * - Other errors of uac_host_device_stop
+ */
+esp_err_t uac_host_duplex_stop(uac_host_duplex_handle_t duplex);
+
+/**
+ * @brief Read microphone frames together with the speaker frames sent in the same USB frames
+ *
+ * The n-th received frame since the start is paired with the n-th sent frame, the pairing is kept while the data are read
+ * in time. Microphone data dropped by buffer overflow are reported by uac_host_device_get_stream_stats.
+ *
+ * @param[in]  duplex       Duplex session handle
+ * @param[out] rx_data      Buffer for microphone frames, `frames` frames of the microphone stream
+ * @param[out] tx_ref       Buffer for sent speaker frames, `frames` frames of the speaker stream
+ * @param[in]  frames       Maximum number of frames to read
+ * @param[out] frames_read  Number of frames read into both buffers
+ * @param[out] frame_pos    Shared frame counter of the first frame in the buffers, counted from the start of the session
+ * @param[in]  timeout      Timeout in ticks
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_STATE if the session is not streaming
+ * - ESP_FAIL if no data were received until timeout
+ */
+esp_err_t uac_host_duplex_read(uac_host_duplex_handle_t duplex, uint8_t *rx_data, uint8_t *tx_ref, uint32_t frames,
+                               uint32_t *frames_read, uint64_t *frame_pos, uint32_t timeout);
+
+/**
+ * @brief Get measured offset between the speaker and microphone streams of the session
+ *
+ * The offset is the number of speaker frames sent minus microphone frames received, measured when each microphone transfer completes.
+ * It includes the difference of the start of the streams and the granularity of the transfers,
+ * but not the delay of the audio path inside the device.
+ *
+ * @param[in]  duplex          Duplex session handle
+ * @param[out] offset_frames   Offset in frames, positive if the speaker is ahead
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ */
+esp_err_t uac_host_duplex_get_loopback_offset(uac_host_duplex_handle_t duplex, int32_t *offset_frames);
+
+/**
+ * @brief Create mixer of several started streams of the same direction
+ *
+ * Data are moved block by block, each block to or from all ports in turn, so all streams stay aligned to block boundaries
+ * and one task serves all devices. Mono ports are mixed down or duplicated to the channels of the mixer.
+ *
+ * @param[in]  config      Mixer configuration
+ * @param[out] mixer       Mixer handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid, a port is not opened or the ports differ in direction
+ * - ESP_ERR_NO_MEM if memory allocation failed
+ */
+esp_err_t uac_host_mixer_create(const uac_host_mixer_config_t *config, uac_host_mixer_handle_t *mixer);
+
+/**
+ * @brief Delete mixer, the streams of the ports are not changed
+ *
+ * @param[in] mixer        Mixer handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the mixer handle is invalid
+ */
+esp_err_t uac_host_mixer_delete(uac_host_mixer_handle_t mixer);
+
+/**
+ * @brief Write one stream to all speaker ports of the mixer
+ *
+ * The data are written directly to ports with the channels of the mixer, only the other ports use a converted copy.
+ * A port which fails does not stop the others, its error is returned after all blocks are written.
+ *
+ * @param[in] mixer        Mixer handle of speakers
+ * @param[in] data         Frames with the channels of the mixer
+ * @param[in] frames       Number of frames
+ * @param[in] timeout      Timeout in ticks for the whole write
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid or the ports are not speakers
+ * - Other errors of uac_host_device_write of a port
+ */
+esp_err_t uac_host_mixer_write(uac_host_mixer_handle_t mixer, const uint8_t *data, uint32_t frames, uint32_t timeout);
+
+/**
+ * @brief Read the mix of all microphone ports of the mixer
+ *
+ * Samples of all ports are added with saturation. A port without enough data until timeout is mixed as silence,
+ * reading stops after the first block which no port has filled.
+ *
+ * @param[in]  mixer        Mixer handle of microphones
+ * @param[out] data         Buffer for frames with the channels of the mixer
+ * @param[in]  frames       Maximum number of frames to read
+ * @param[out] frames_read  Number of frames read
+ * @param[in]  timeout      Timeout in ticks for the whole read
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid or the ports are not microphones
+ * - ESP_FAIL if no data were received until timeout
+ */
+esp_err_t uac_host_mixer_read(uac_host_mixer_handle_t mixer, uint8_t *data, uint32_t frames, uint32_t *frames_read,
+                              uint32_t timeout);
+
+/**
+ * @brief Set encoder of a started RX stream, read by uac_host_device_read_encoded()
+ *
+ * The buffer threshold is set to one block, so UAC_HOST_DEVICE_EVENT_RX_DONE or the task notification
+ * reports each block ready to be encoded. The threshold of the device configuration is restored when the encoder is removed.
+ * The encoder is removed when the stream is stopped.
+ *
+ * @note Not available with FLAG_STREAM_SAMPLE_RATE_CONVERT
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[in] config          Encoder configuration, NULL to remove the encoder
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid or the stream is not RX
+ * - ESP_ERR_INVALID_STATE if the stream is not started
+ * - ESP_ERR_INVALID_SIZE if the block does not fit into the buffer
+ * - ESP_ERR_NOT_SUPPORTED if the stream converts the sample frequency
+ * - ESP_ERR_NO_MEM if memory allocation failed
+ */
+esp_err_t uac_host_device_set_encoder(uac_host_device_handle_t uac_dev_handle, const uac_host_encoder_config_t *config);
+
+/**
+ * @brief Encode one block of UAC RX stream buffer
+ *
+ * The block is passed to the encoder directly from the buffer, it is copied only if it wraps around the end of the buffer.
+ * The buffer is locked for the reader while encoding, so FLAG_STREAM_RX_DROP_OLDEST drops the newly received data instead.
+ *
+ * @param[in]  uac_dev_handle  UAC device handle
+ * @param[out] data            Buffer for the encoded block
+ * @param[in]  size            Size of the buffer
+ * @param[out] data_len        Length of the encoded block
+ * @param[in]  timeout         Timeout in ticks to wait for one block
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_STATE if the stream is not active or has no encoder
+ * - ESP_FAIL if the block was not received until timeout
+ * - Other errors of the encoder, the block is dropped
+ */
+esp_err_t uac_host_device_read_encoded(uac_host_device_handle_t uac_dev_handle, uint8_t *data, size_t size, size_t *data_len,
+                                       uint32_t timeout);
+
+/**
+ * @brief Initialize IMA-ADPCM encoder state
+ *
+ * @param[out] adpcm       Encoder state
+ * @param[in]  channels    Channels of the 16-bit PCM frames, up to UAC_IMA_ADPCM_MAX_CHANNELS
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ */
+esp_err_t uac_host_ima_adpcm_init(uac_host_ima_adpcm_t *adpcm, uint8_t channels);
+
+/**
+ * @brief Get size of IMA-ADPCM block
+ *
+ * @param[in] channels     Channels of the PCM frames
+ * @param[in] frames       Frames of the block
+ * @return Size of the encoded block in bytes
+ */
+size_t uac_host_ima_adpcm_block_size(uint8_t channels, uint32_t frames);
+
+/**
+ * @brief Encode one block of 16-bit PCM frames into IMA-ADPCM, encoder of uac_host_encoder_config_t
+ *
+ * @param[in]  ctx         Encoder state, uac_host_ima_adpcm_t
+ * @param[in]  pcm         16-bit PCM frames
+ * @param[in]  frames      Number of frames
+ * @param[out] out         Buffer for the encoded block
+ * @param[in]  out_size    Size of the buffer, at least uac_host_ima_adpcm_block_size()
+ * @param[out] out_len     Length of the encoded block
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_SIZE if the buffer is too small
+ */
+esp_err_t uac_host_ima_adpcm_encode(void *ctx, const uint8_t *pcm, uint32_t frames, uint8_t *out, size_t out_size,
+                                    size_t *out_len);
+
+/**
+ * @brief Decode one IMA-ADPCM block into 16-bit PCM frames
+ *
+ * @param[in]  data        Encoded block
+ * @param[in]  len         Length of the block
+ * @param[in]  channels    Channels of the PCM frames
+ * @param[out] pcm         Buffer for the decoded frames
+ * @param[in]  frames      Frames of the block, or less
+ * @param[out] frames_out  Number of decoded frames
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_SIZE if the block is shorter than its header
+ */
+esp_err_t uac_host_ima_adpcm_decode(const uint8_t *data, size_t len, uint8_t channels, int16_t *pcm, uint32_t frames,
+                                    uint32_t *frames_out);
+
+/**
+ * @brief Convert PCM frames to 32-bit integer or float samples, with channel selection and deinterleaving
+ *
+ * Output buffers are indexed in frames: the frames are written from frame `offset` of the output.
+ * Interleaved output has the selected channels in ascending order in out[0],
+ * planar output has the Nth selected channel in out[N].
+ *
+ * @param[in]  pcm           PCM frames, little-endian, interleaved channels, no alignment required
+ * @param[in]  frames        Number of frames
+ * @param[in]  channels      Channels of the PCM frames, up to UAC_HOST_CONVERT_MAX_CHANNELS
+ * @param[in]  sample_bytes  Bytes of one sample, 2, 3 or 4
+ * @param[in]  config        Conversion configuration
+ * @param[out] out           Output buffers, one for interleaved output or one per selected channel for planar output, 32-bit aligned
+ * @param[in]  offset        First output frame
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid or the channel mask selects a channel not in the frames
+ * - ESP_ERR_NOT_SUPPORTED if the sample size or the number of channels is not supported
+ */
+esp_err_t uac_host_pcm_convert(const uint8_t *pcm, uint32_t frames, uint8_t channels, uint8_t sample_bytes,
+                               const uac_host_convert_config_t *config, void *const *out, uint32_t offset);
+
+/**
+ * @brief Read frames of UAC RX stream converted to 32-bit integer or float samples
+ *
+ * The frames are converted by uac_host_pcm_convert() directly from the stream buffer, without an intermediate copy.
+ * The buffer is locked for the reader while converting, so FLAG_STREAM_RX_DROP_OLDEST drops the newly received data instead.
+ *
+ * @note Not available with FLAG_STREAM_SAMPLE_RATE_CONVERT
+ *
+ * @param[in]  uac_dev_handle  UAC device handle
+ * @param[in]  config          Conversion configuration
+ * @param[out] out             Output buffers, see uac_host_pcm_convert()
+ * @param[in]  frames          Maximum number of frames to read
+ * @param[out] frames_read     Number of frames read
+ * @param[in]  timeout         Timeout in ticks to wait for at least one frame
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid, or the stream is not RX
+ * - ESP_ERR_INVALID_STATE if the stream is not active
+ * - ESP_ERR_NOT_SUPPORTED if the stream format is not supported or the stream converts the sample frequency
+ * - ESP_FAIL if no frame was received until timeout
+ */
+esp_err_t uac_host_device_read_converted(uac_host_device_handle_t uac_dev_handle, const uac_host_convert_config_t *config,
+                                         void *const *out, uint32_t frames, uint32_t *frames_read, uint32_t timeout);
+
+/**
+ * @brief Set level meter of a started RX stream
+ *
+ * Peak, RMS and voice activity are measured while the received packets are written into the stream buffer,
+ * after FLAG_STREAM_SOFT_VOLUME is applied. UAC_HOST_DEVICE_EVENT_VAD_CHANGED is reported by the device callback
+ * at each start and end of voice activity, so silence does not need to be read to be detected.
+ * The meter is removed when the stream is stopped.
+ *
+ * @param[in] uac_dev_handle  UAC device handle
+ * @param[in] config          Meter configuration, NULL to remove the meter
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid or the stream is not RX
+ * - ESP_ERR_INVALID_STATE if the stream is not started
+ * - ESP_ERR_NOT_SUPPORTED if the stream has more than UAC_HOST_METER_MAX_CHANNELS channels, or samples other than 16, 24 or 32-bit
+ */
+esp_err_t uac_host_device_set_meter(uac_host_device_handle_t uac_dev_handle, const uac_host_meter_config_t *config);
+
+/**
+ * @brief Get levels of the last metering window of RX stream
+ *
+ * @param[in]  uac_dev_handle  UAC device handle
+ * @param[out] level           Levels of the last window
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_STATE if no meter is set
+ */
+esp_err_t uac_host_device_get_level(uac_host_device_handle_t uac_dev_handle, uac_host_meter_level_t *level);
+
+/**
+ * @brief Create audio/video synchronization of a microphone stream with a camera, e.g. UVC and UAC functions of one webcam
+ *
+ * Both streams are mapped to the host clock. Video frames already carry their capture time on the host clock,
+ * e.g. uvc_host_frame_t.time.capture_us. Audio frames are mapped by the stream clock: the host times of the transfer completions
+ * are delayed by the scheduling of the USB Host client, so the earliest completion within each part of the window is taken
+ * and the drift of the microphone clock is measured between the oldest and the newest of them.
+ *
+ * @param[in]  config      Synchronization configuration
+ * @param[out] sync        Synchronization handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_NO_MEM if memory allocation failed
+ */
+esp_err_t uac_host_av_sync_create(const uac_host_av_sync_config_t *config, uac_host_av_sync_handle_t *sync);
+
+/**
+ * @brief Delete audio/video synchronization
+ *
+ * @param[in] sync         Synchronization handle
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the handle is invalid
+ */
+esp_err_t uac_host_av_sync_delete(uac_host_av_sync_handle_t sync);
+
+/**
+ * @brief Add a measurement of the microphone stream clock
+ *
+ * Call it regularly, e.g. before each read of the stream. A clock with fewer frames than before is a restarted stream,
+ * the audio mapping starts again.
+ *
+ * @param[in] sync         Synchronization handle
+ * @param[in] clock        Clock of uac_host_device_get_stream_clock()
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ */
+esp_err_t uac_host_av_sync_audio_update(uac_host_av_sync_handle_t sync, const uac_host_stream_clock_t *clock);
+
+/**
+ * @brief Add a video frame
+ *
+ * Only the first frame sets the start of the video, it can be called from the frame callback of every frame.
+ *
+ * @param[in] sync         Synchronization handle
+ * @param[in] capture_us   Host capture time of the frame, e.g. uvc_host_frame_t.time.capture_us
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if the handle is invalid
+ */
+esp_err_t uac_host_av_sync_video_update(uac_host_av_sync_handle_t sync, int64_t capture_us);
+
+/**
+ * @brief Get host time of an audio frame, e.g. as timestamp of the frames returned by the next read
+ *
+ * @param[in]  sync          Synchronization handle
+ * @param[in]  frame_pos     Position of the frame in the stream, clock.frames - clock.buffered for the next read frame
+ * @param[out] time_us       Host time at which the frame was received
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_STATE if no audio clock was added yet
+ */
+esp_err_t uac_host_av_sync_audio_time(uac_host_av_sync_handle_t sync, uint64_t frame_pos, int64_t *time_us);
+
+/**
+ * @brief Get measured offset of the audio and video start and drift of the microphone clock
+ *
+ * @param[in]  sync        Synchronization handle
+ * @param[out] stats       Offset and drift
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_INVALID_STATE if no audio clock or no video frame was added yet
+ */
+esp_err_t uac_host_av_sync_get_stats(uac_host_av_sync_handle_t sync, uac_host_av_sync_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif //__cplusplus
@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/uac_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Check PCM conversion configuration against the format of the frames
+ *
+ * @param[in] channels      Channels of the PCM frames
+ * @param[in] sample_bytes  Bytes of one sample
+ * @param[in] config        Conversion configuration
+ * @return esp_err_t
+ * - ESP_OK if uac_host_pcm_convert() accepts the configuration
+ * - ESP_ERR_INVALID_ARG if the configuration is invalid or selects a channel not in the frames
+ * - ESP_ERR_NOT_SUPPORTED if the sample size or the number of channels is not supported
+ */
+esp_err_t uac_convert_check(uint8_t channels, uint8_t sample_bytes, const uac_host_convert_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
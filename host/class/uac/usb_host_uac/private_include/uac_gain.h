@@ -0,0 +1,89 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UAC_GAIN_UNITY          (1 << 15)   /*!< Gain of 0 dB in Q15 */
+#define UAC_GAIN_DB_MIN         (-96 * 256) /*!< Lowest gain above silence, in 1/256 dB */
+
+/**
+ * @brief Software volume and mute of PCM stream
+ *
+ * Volume and mute are written by the user task, the gain is changed only by uac_gain_apply().
+ */
+typedef struct {
+    uint16_t volume;                           /*!< Target gain in Q15, up to UAC_GAIN_UNITY */
+    bool mute;                                 /*!< Target gain is 0 if set */
+    uint16_t gain;                             /*!< Gain applied to the last frame, ramps to the target */
+} uac_gain_t;
+
+/**
+ * @brief Initialize software gain to 0 dB, not muted
+ *
+ * @param[out] gain  Software gain
+ */
+void uac_gain_init(uac_gain_t *gain);
+
+/**
+ * @brief Convert volume in 1/256 dB to Q15 gain
+ *
+ * Gains above 0 dB are limited to 0 dB, gains below UAC_GAIN_DB_MIN are silence.
+ *
+ * @param[in] volume_db  Volume in 1/256 dB
+ * @return Gain in Q15
+ */
+uint16_t uac_gain_from_db(int16_t volume_db);
+
+/**
+ * @brief Convert volume in percent to 1/256 dB
+ *
+ * 100 % is 0 dB, 1 % is -60 dB with equal steps in dB, 0 % is silence.
+ *
+ * @param[in] volume  Volume 0-100
+ * @return Volume in 1/256 dB
+ */
+int16_t uac_gain_percent_to_db(uint8_t volume);
+
+/**
+ * @brief Set target volume, the gain ramps to it in the next uac_gain_apply() calls
+ *
+ * @param[in] gain       Software gain
+ * @param[in] volume     Gain in Q15
+ */
+void uac_gain_set_volume(uac_gain_t *gain, uint16_t volume);
+
+/**
+ * @brief Set mute, the gain ramps to silence or back to the volume
+ *
+ * @param[in] gain       Software gain
+ * @param[in] mute       True to mute
+ */
+void uac_gain_set_mute(uac_gain_t *gain, bool mute);
+
+/**
+ * @brief Apply gain to interleaved signed PCM frames in place
+ *
+ * The gain moves to the target by a limited step each frame, so volume changes do not click.
+ *
+ * @param[in]    gain          Software gain
+ * @param[inout] data          Frames, no alignment required
+ * @param[in]    frames        Number of frames
+ * @param[in]    channels      Number of channels
+ * @param[in]    sample_bytes  Bytes of one sample, 2 or 4
+ */
+void uac_gain_apply(uac_gain_t *gain, void *data, size_t frames, uint8_t channels, uint8_t sample_bytes);
+
+#ifdef __cplusplus
+}
+#endif
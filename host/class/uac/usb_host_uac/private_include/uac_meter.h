@@ -0,0 +1,61 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "usb/uac_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UAC_METER_WINDOW_DONE   (1 << 0)    /*!< uac_meter_process() completed a window, level is updated */
+#define UAC_METER_VAD_CHANGED   (1 << 1)    /*!< uac_meter_process() changed the voice activity */
+
+/**
+ * @brief Level meter and voice activity detector of PCM stream
+ *
+ * The meter is used by one task, the levels of the last window are copied out by the caller.
+ */
+typedef struct {
+    uint8_t channels;                                   /*!< Channels of the PCM frames */
+    uint8_t sample_bytes;                               /*!< Bytes of one sample, 2, 3 or 4 */
+    uint32_t window_frames;                             /*!< Frames of each window, 0 if the meter is not set */
+    uint32_t vad_energy;                                /*!< Mean square of a window at the voice activity threshold */
+    uint16_t vad_hangover;                              /*!< Windows below the threshold until the voice activity ends */
+    uint16_t hangover_left;                             /*!< Windows left until the voice activity ends */
+    uint32_t frames;                                    /*!< Frames of the current window */
+    uint64_t sum_sq[UAC_HOST_METER_MAX_CHANNELS];       /*!< Sum of squares of the current window */
+    uint16_t peak[UAC_HOST_METER_MAX_CHANNELS];         /*!< Peak of the current window */
+    uac_host_meter_level_t level;                       /*!< Levels of the last window */
+} uac_meter_t;
+
+/**
+ * @brief Initialize level meter, or clear it if config is NULL
+ *
+ * @param[out] meter         Level meter
+ * @param[in]  config        Meter configuration, NULL to clear the meter
+ * @param[in]  channels      Channels of the PCM frames, up to UAC_HOST_METER_MAX_CHANNELS
+ * @param[in]  sample_bytes  Bytes of one sample, 2, 3 or 4
+ */
+void uac_meter_init(uac_meter_t *meter, const uac_host_meter_config_t *config, uint8_t channels, uint8_t sample_bytes);
+
+/**
+ * @brief Measure interleaved signed PCM frames
+ *
+ * @param[in] meter   Level meter
+ * @param[in] data    Frames, no alignment required
+ * @param[in] frames  Number of frames
+ * @return UAC_METER_WINDOW_DONE and UAC_METER_VAD_CHANGED bits, 0 if no window completed
+ */
+uint32_t uac_meter_process(uac_meter_t *meter, const uint8_t *data, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,74 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uac_src uac_src_t;    /*!< Sample rate converter of 16-bit PCM stream */
+
+/**
+ * @brief Create sample rate converter
+ *
+ * Polyphase FIR resampler in fixed point, for any ratio of the rates.
+ * Input frames are buffered in the converter, until enough of them are written to compute the output frames.
+ *
+ * @param[in]  in_rate       Input sample frequency in Hz
+ * @param[in]  out_rate      Output sample frequency in Hz
+ * @param[in]  channels      Number of interleaved channels
+ * @param[in]  max_frames    Maximum number of input frames written at once by uac_src_write()
+ * @param[out] src_ret       Sample rate converter
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_ARG if a parameter is invalid
+ * - ESP_ERR_NO_MEM if memory allocation failed
+ */
+esp_err_t uac_src_create(uint32_t in_rate, uint32_t out_rate, uint8_t channels, size_t max_frames, uac_src_t **src_ret);
+
+/**
+ * @brief Delete sample rate converter
+ *
+ * @param[in] src  Sample rate converter
+ */
+void uac_src_delete(uac_src_t *src);
+
+/**
+ * @brief Get number of input frames the converter can accept
+ *
+ * @param[in] src  Sample rate converter
+ * @return Number of frames
+ */
+size_t uac_src_write_free(const uac_src_t *src);
+
+/**
+ * @brief Write interleaved 16-bit input frames into the converter
+ *
+ * @param[in] src     Sample rate converter
+ * @param[in] data    Input frames, no alignment required
+ * @param[in] frames  Number of input frames
+ * @return Number of frames accepted, limited by uac_src_write_free()
+ */
+size_t uac_src_write(uac_src_t *src, const void *data, size_t frames);
+
+/**
+ * @brief Compute interleaved 16-bit output frames from the buffered input frames
+ *
+ * @param[in]  src     Sample rate converter
+ * @param[out] data    Output frames, no alignment required
+ * @param[in]  frames  Maximum number of output frames
+ * @return Number of output frames
+ */
+size_t uac_src_read(uac_src_t *src, void *data, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
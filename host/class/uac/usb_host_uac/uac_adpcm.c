@@ -0,0 +1,160 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// IMA-ADPCM encoder of RX blocks, 4 bits per sample
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "usb/uac_host.h"
+
+static const char *TAG = "uac-adpcm";
+
+#define UAC_ADPCM_RETURN_ON_FALSE(exp, err, msg) ESP_RETURN_ON_FALSE((exp), (err), TAG, msg)
+
+#define UAC_ADPCM_HEADER_BYTES  (4)         // Block header of each channel
+#define UAC_ADPCM_STEP_MAX      (88)        // Last index of the step table
+
+static const int16_t s_step_table[UAC_ADPCM_STEP_MAX + 1] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+static const int8_t s_index_table[8] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+};
+
+/**
+ * @brief Update predictor and step index by one 4-bit code, the same in encoder and decoder
+ */
+static inline void uac_adpcm_step(int16_t *predictor, uint8_t *step_index, uint8_t code)
+{
+    const int32_t step = s_step_table[*step_index];
+    int32_t diff = step >> 3;
+    if (code & 4) {
+        diff += step;
+    }
+    if (code & 2) {
+        diff += step >> 1;
+    }
+    if (code & 1) {
+        diff += step >> 2;
+    }
+    const int32_t sample = (code & 8) ? *predictor - diff : *predictor + diff;
+    *predictor = (int16_t)MIN(MAX(sample, INT16_MIN), INT16_MAX);
+    *step_index = (uint8_t)MIN(MAX((int32_t)*step_index + s_index_table[code & 7], 0), UAC_ADPCM_STEP_MAX);
+}
+
+static inline uint8_t uac_adpcm_encode_sample(int16_t *predictor, uint8_t *step_index, int16_t sample)
+{
+    int32_t diff = sample - *predictor;
+    int32_t step = s_step_table[*step_index];
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 1;
+    }
+    uac_adpcm_step(predictor, step_index, code);
+    return code;
+}
+
+esp_err_t uac_host_ima_adpcm_init(uac_host_ima_adpcm_t *adpcm, uint8_t channels)
+{
+    UAC_ADPCM_RETURN_ON_FALSE(adpcm, ESP_ERR_INVALID_ARG, "Argument error");
+    UAC_ADPCM_RETURN_ON_FALSE(channels && channels <= UAC_IMA_ADPCM_MAX_CHANNELS, ESP_ERR_INVALID_ARG, "Channels not supported");
+    memset(adpcm, 0, sizeof(uac_host_ima_adpcm_t));
+    adpcm->channels = channels;
+    return ESP_OK;
+}
+
+size_t uac_host_ima_adpcm_block_size(uint8_t channels, uint32_t frames)
+{
+    return channels * UAC_ADPCM_HEADER_BYTES + ((size_t)frames * channels + 1) / 2;
+}
+
+esp_err_t uac_host_ima_adpcm_encode(void *ctx, const uint8_t *pcm, uint32_t frames, uint8_t *out, size_t out_size,
+                                    size_t *out_len)
+{
+    uac_host_ima_adpcm_t *adpcm = ctx;
+    UAC_ADPCM_RETURN_ON_FALSE(adpcm && adpcm->channels && pcm && out && out_len, ESP_ERR_INVALID_ARG, "Argument error");
+    const uint8_t channels = adpcm->channels;
+    const size_t block_size = uac_host_ima_adpcm_block_size(channels, frames);
+    UAC_ADPCM_RETURN_ON_FALSE(out_size >= block_size, ESP_ERR_INVALID_SIZE, "Buffer too small for the block");
+
+    // the header carries the state before the block, so the decoder can start at any block
+    for (int c = 0; c < channels; c++) {
+        const uint16_t predictor = (uint16_t)adpcm->predictor[c];
+        out[c * UAC_ADPCM_HEADER_BYTES] = predictor & 0xff;
+        out[c * UAC_ADPCM_HEADER_BYTES + 1] = predictor >> 8;
+        out[c * UAC_ADPCM_HEADER_BYTES + 2] = adpcm->step_index[c];
+        out[c * UAC_ADPCM_HEADER_BYTES + 3] = 0;
+    }
+    uint8_t *codes = out + channels * UAC_ADPCM_HEADER_BYTES;
+    const size_t samples = (size_t)frames * channels;
+    for (size_t i = 0; i < samples; i++) {
+        // the block may start at any byte of the audio buffer
+        int16_t sample;
+        memcpy(&sample, pcm + i * sizeof(int16_t), sizeof(int16_t));
+        const int c = i % channels;
+        const uint8_t code = uac_adpcm_encode_sample(&adpcm->predictor[c], &adpcm->step_index[c], sample);
+        if (i & 1) {
+            codes[i / 2] |= code << 4;
+        } else {
+            codes[i / 2] = code;
+        }
+    }
+    *out_len = block_size;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_ima_adpcm_decode(const uint8_t *data, size_t len, uint8_t channels, int16_t *pcm, uint32_t frames,
+                                    uint32_t *frames_out)
+{
+    UAC_ADPCM_RETURN_ON_FALSE(data && pcm && frames_out, ESP_ERR_INVALID_ARG, "Argument error");
+    UAC_ADPCM_RETURN_ON_FALSE(channels && channels <= UAC_IMA_ADPCM_MAX_CHANNELS, ESP_ERR_INVALID_ARG, "Channels not supported");
+    UAC_ADPCM_RETURN_ON_FALSE(len >= channels * UAC_ADPCM_HEADER_BYTES, ESP_ERR_INVALID_SIZE, "Block shorter than header");
+
+    int16_t predictor[UAC_IMA_ADPCM_MAX_CHANNELS];
+    uint8_t step_index[UAC_IMA_ADPCM_MAX_CHANNELS];
+    for (int c = 0; c < channels; c++) {
+        predictor[c] = (int16_t)(data[c * UAC_ADPCM_HEADER_BYTES] | (data[c * UAC_ADPCM_HEADER_BYTES + 1] << 8));
+        step_index[c] = MIN(data[c * UAC_ADPCM_HEADER_BYTES + 2], UAC_ADPCM_STEP_MAX);
+    }
+    const uint8_t *codes = data + channels * UAC_ADPCM_HEADER_BYTES;
+    // with odd number of samples the high nibble of the last byte is padding, limited by the frames of the block
+    frames = MIN(frames, (len - channels * UAC_ADPCM_HEADER_BYTES) * 2 / channels);
+    const size_t samples = (size_t)frames * channels;
+    for (size_t i = 0; i < samples; i++) {
+        const int c = i % channels;
+        const uint8_t code = (i & 1) ? codes[i / 2] >> 4 : codes[i / 2] & 0x0f;
+        uac_adpcm_step(&predictor[c], &step_index[c], code);
+        pcm[i] = predictor[c];
+    }
+    *frames_out = frames;
+    return ESP_OK;
+}
@@ -0,0 +1,205 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Mapping of a microphone stream and a camera stream to the host clock, for timestamps of muxers
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "usb/uac_host.h"
+
+static const char *TAG = "uac-av-sync";
+
+#define UAC_AV_SYNC_RETURN_ON_FALSE(exp, err, msg) ESP_RETURN_ON_FALSE((exp), (err), TAG, msg)
+
+#define UAC_AV_SYNC_BUCKETS            (8)      /*!< Parts of the window, each keeps its earliest transfer completion */
+#define UAC_AV_SYNC_DEFAULT_WINDOW_MS  (10000)
+
+/**
+ * @brief Earliest transfer completion of a part of the window
+ *
+ * err is the host time of the completion minus its time at the nominal sample frequency.
+ * Completions are only delayed by the scheduling of the client, never early, so the smallest err is the most precise.
+ */
+typedef struct {
+    uint64_t pos;                              /*!< Frames received at the completion */
+    int64_t err;                               /*!< Deviation from the nominal time, in microseconds */
+} uac_av_sync_point_t;
+
+/**
+ * @brief UAC audio/video synchronization
+ */
+struct uac_av_sync {
+    portMUX_TYPE lock;                         /*!< Audio and video are updated from different tasks */
+    uint32_t sample_freq;                      /*!< Nominal sample frequency */
+    int64_t bucket_us;                         /*!< Duration of each part of the window */
+    bool audio_started;                        /*!< At least one audio clock was added */
+    uint64_t anchor_pos;                       /*!< Frames of the first audio clock */
+    int64_t anchor_us;                         /*!< Host time of the first audio clock */
+    uint64_t last_pos;                         /*!< Frames of the last audio clock */
+    int64_t cur_start_us;                      /*!< Host time of the start of the current part */
+    uac_av_sync_point_t cur;                   /*!< Earliest completion of the current part */
+    uac_av_sync_point_t points[UAC_AV_SYNC_BUCKETS]; /*!< Earliest completions of the finished parts, oldest first from `first` */
+    uint8_t first;                             /*!< Index of the oldest finished part */
+    uint8_t count;                             /*!< Number of finished parts */
+    bool video_started;                        /*!< At least one video frame was added */
+    int64_t video_start_us;                    /*!< Host capture time of the first video frame */
+};
+
+/**
+ * @brief Line fitted to the earliest completions, deviation from the nominal time at a frame position
+ */
+typedef struct {
+    uac_av_sync_point_t ref;                   /*!< Point on the line */
+    float slope;                               /*!< Deviation per frame, in microseconds */
+} uac_av_sync_line_t;
+
+static inline int64_t uac_av_sync_nominal_us(const struct uac_av_sync *sync, uint64_t pos)
+{
+    return sync->anchor_us + (int64_t)(pos - sync->anchor_pos) * 1000000 / sync->sample_freq;
+}
+
+/**
+ * @brief Fit the line through the oldest and the newest finished part, called with the lock taken
+ */
+static void uac_av_sync_fit(const struct uac_av_sync *sync, uac_av_sync_line_t *line)
+{
+    if (sync->count == 0) {
+        line->ref = sync->cur;
+        line->slope = 0.0f;
+        return;
+    }
+    const uac_av_sync_point_t *oldest = &sync->points[sync->first];
+    const uac_av_sync_point_t *newest = &sync->points[(sync->first + sync->count - 1) % UAC_AV_SYNC_BUCKETS];
+    line->ref = *newest;
+    line->slope = (newest->pos > oldest->pos) ? (float)(newest->err - oldest->err) / (float)(newest->pos - oldest->pos) : 0.0f;
+}
+
+esp_err_t uac_host_av_sync_create(const uac_host_av_sync_config_t *config, uac_host_av_sync_handle_t *sync)
+{
+    UAC_AV_SYNC_RETURN_ON_FALSE(config && sync, ESP_ERR_INVALID_ARG, "Invalid argument");
+    UAC_AV_SYNC_RETURN_ON_FALSE(config->sample_freq > 0, ESP_ERR_INVALID_ARG, "Invalid sample frequency");
+
+    struct uac_av_sync *s = calloc(1, sizeof(struct uac_av_sync));
+    UAC_AV_SYNC_RETURN_ON_FALSE(s, ESP_ERR_NO_MEM, "Unable to allocate synchronization");
+    portMUX_INITIALIZE(&s->lock);
+    s->sample_freq = config->sample_freq;
+    const uint32_t window_ms = config->window_ms ? config->window_ms : UAC_AV_SYNC_DEFAULT_WINDOW_MS;
+    s->bucket_us = (int64_t)window_ms * 1000 / UAC_AV_SYNC_BUCKETS;
+    *sync = s;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_av_sync_delete(uac_host_av_sync_handle_t sync)
+{
+    UAC_AV_SYNC_RETURN_ON_FALSE(sync, ESP_ERR_INVALID_ARG, "Invalid handle");
+    free(sync);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_av_sync_audio_update(uac_host_av_sync_handle_t sync, const uac_host_stream_clock_t *clock)
+{
+    UAC_AV_SYNC_RETURN_ON_FALSE(sync && clock, ESP_ERR_INVALID_ARG, "Invalid argument");
+    if (clock->frames == 0) {
+        return ESP_OK; // nothing received yet
+    }
+
+    portENTER_CRITICAL(&sync->lock);
+    if (sync->audio_started && clock->frames == sync->last_pos) {
+        // no transfer completed since the last update
+        portEXIT_CRITICAL(&sync->lock);
+        return ESP_OK;
+    }
+    if (!sync->audio_started || clock->frames < sync->last_pos) {
+        // first clock, or the stream was restarted
+        sync->audio_started = true;
+        sync->anchor_pos = clock->frames;
+        sync->anchor_us = clock->time_us;
+        sync->cur_start_us = clock->time_us;
+        sync->cur.pos = clock->frames;
+        sync->cur.err = 0;
+        sync->first = 0;
+        sync->count = 0;
+        sync->last_pos = clock->frames;
+        portEXIT_CRITICAL(&sync->lock);
+        return ESP_OK;
+    }
+    sync->last_pos = clock->frames;
+
+    const uac_av_sync_point_t point = {
+        .pos = clock->frames,
+        .err = clock->time_us - uac_av_sync_nominal_us(sync, clock->frames),
+    };
+    if (clock->time_us - sync->cur_start_us >= sync->bucket_us) {
+        // the current part is finished, the oldest one leaves the window
+        if (sync->count == UAC_AV_SYNC_BUCKETS) {
+            sync->points[sync->first] = sync->cur;
+            sync->first = (sync->first + 1) % UAC_AV_SYNC_BUCKETS;
+        } else {
+            sync->points[(sync->first + sync->count) % UAC_AV_SYNC_BUCKETS] = sync->cur;
+            sync->count++;
+        }
+        sync->cur_start_us = clock->time_us;
+        sync->cur = point;
+    } else if (point.err < sync->cur.err) {
+        sync->cur = point;
+    }
+    portEXIT_CRITICAL(&sync->lock);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_av_sync_video_update(uac_host_av_sync_handle_t sync, int64_t capture_us)
+{
+    UAC_AV_SYNC_RETURN_ON_FALSE(sync, ESP_ERR_INVALID_ARG, "Invalid handle");
+    portENTER_CRITICAL(&sync->lock);
+    if (!sync->video_started) {
+        sync->video_started = true;
+        sync->video_start_us = capture_us;
+    }
+    portEXIT_CRITICAL(&sync->lock);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_av_sync_audio_time(uac_host_av_sync_handle_t sync, uint64_t frame_pos, int64_t *time_us)
+{
+    UAC_AV_SYNC_RETURN_ON_FALSE(sync && time_us, ESP_ERR_INVALID_ARG, "Invalid argument");
+
+    portENTER_CRITICAL(&sync->lock);
+    const bool started = sync->audio_started;
+    uac_av_sync_line_t line;
+    uac_av_sync_fit(sync, &line);
+    const int64_t nominal_us = uac_av_sync_nominal_us(sync, frame_pos);
+    portEXIT_CRITICAL(&sync->lock);
+    UAC_AV_SYNC_RETURN_ON_FALSE(started, ESP_ERR_INVALID_STATE, "No audio clock");
+
+    *time_us = nominal_us + line.ref.err + (int64_t)(line.slope * (float)((int64_t)frame_pos - (int64_t)line.ref.pos));
+    return ESP_OK;
+}
+
+esp_err_t uac_host_av_sync_get_stats(uac_host_av_sync_handle_t sync, uac_host_av_sync_stats_t *stats)
+{
+    UAC_AV_SYNC_RETURN_ON_FALSE(sync && stats, ESP_ERR_INVALID_ARG, "Invalid argument");
+
+    portENTER_CRITICAL(&sync->lock);
+    const bool started = sync->audio_started && sync->video_started;
+    const bool drift_valid = (sync->count >= 2);
+    uac_av_sync_line_t line;
+    uac_av_sync_fit(sync, &line);
+    const int64_t nominal_us = uac_av_sync_nominal_us(sync, 0);
+    const int64_t video_start_us = sync->video_start_us;
+    portEXIT_CRITICAL(&sync->lock);
+    UAC_AV_SYNC_RETURN_ON_FALSE(started, ESP_ERR_INVALID_STATE, "No audio clock or video frame");
+
+    stats->audio_start_us = nominal_us + line.ref.err - (int64_t)(line.slope * (float)line.ref.pos);
+    stats->video_start_us = video_start_us;
+    stats->offset_us = stats->audio_start_us - video_start_us;
+    // frames longer than nominal mean a slower device clock
+    stats->drift_ppm = drift_valid ? -line.slope * (float)sync->sample_freq : 0.0f;
+    return ESP_OK;
+}
@@ -0,0 +1,135 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Conversion of PCM frames to 32-bit integer or float samples, with channel selection and deinterleaving
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "usb/uac_host.h"
+#include "uac_convert.h"
+
+static const char *TAG = "uac-convert";
+
+#define UAC_CONVERT_RETURN_ON_FALSE(exp, err, msg) ESP_RETURN_ON_FALSE((exp), (err), TAG, msg)
+
+#define UAC_CONVERT_FLOAT_SCALE (1.0f / 2147483648.0f) // MSB aligned sample to -1.0 .. 1.0
+
+/**
+ * @brief Channels picked from each frame, in ascending order
+ */
+typedef struct {
+    uint8_t count;
+    uint8_t index[UAC_HOST_CONVERT_MAX_CHANNELS];
+} uac_convert_map_t;
+
+typedef void (*uac_convert_kernel_t)(const uint8_t *pcm, uint32_t frames, uint8_t channels, const uac_convert_map_t *map,
+                                     bool planar, void *const *out, uint32_t offset);
+
+// Load one little-endian sample MSB aligned, byte loads as the frames may be unaligned
+static inline __attribute__((always_inline)) int32_t uac_convert_load(const uint8_t *p, uint8_t sample_bytes)
+{
+    switch (sample_bytes) {
+    case 2: return (int32_t)(((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 24));
+    case 3: return (int32_t)(((uint32_t)p[0] << 8) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 24));
+    default: return (int32_t)((uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+    }
+}
+
+static inline __attribute__((always_inline)) void uac_convert_store(void *out, size_t i, int32_t sample, bool to_float)
+{
+    if (to_float) {
+        ((float *)out)[i] = (float)sample * UAC_CONVERT_FLOAT_SCALE;
+    } else {
+        ((int32_t *)out)[i] = sample;
+    }
+}
+
+/**
+ * @brief Body of the conversion kernels
+ *
+ * It is inlined with constant sample size and output format, so each kernel has loops without branches per sample,
+ * which the compiler can unroll and vectorize.
+ */
+static inline __attribute__((always_inline)) void uac_convert_frames(const uint8_t *pcm, uint32_t frames, uint8_t channels,
+                                                                     const uac_convert_map_t *map, bool planar, void *const *out,
+                                                                     uint32_t offset, uint8_t sample_bytes, bool to_float)
+{
+    if (!planar && map->count == channels) {
+        // all channels interleaved as in the frames: one flat loop over the samples
+        const size_t samples = (size_t)frames * channels;
+        const size_t first = (size_t)offset * channels;
+        for (size_t i = 0; i < samples; i++) {
+            uac_convert_store(out[0], first + i, uac_convert_load(pcm + i * sample_bytes, sample_bytes), to_float);
+        }
+        return;
+    }
+    const size_t frame_bytes = (size_t)channels * sample_bytes;
+    for (uint8_t k = 0; k < map->count; k++) {
+        // one selected channel per pass, so planar output is written sequentially
+        const uint8_t *p = pcm + map->index[k] * sample_bytes;
+        void *dst = planar ? out[k] : out[0];
+        const size_t step = planar ? 1 : map->count;
+        size_t i = planar ? offset : (size_t)offset * map->count + k;
+        for (uint32_t f = 0; f < frames; f++, p += frame_bytes, i += step) {
+            uac_convert_store(dst, i, uac_convert_load(p, sample_bytes), to_float);
+        }
+    }
+}
+
+#define UAC_CONVERT_KERNEL(name, sample_bytes, to_float) \
+static void name(const uint8_t *pcm, uint32_t frames, uint8_t channels, const uac_convert_map_t *map, \
+                 bool planar, void *const *out, uint32_t offset) \
+{ \
+    uac_convert_frames(pcm, frames, channels, map, planar, out, offset, sample_bytes, to_float); \
+}
+
+UAC_CONVERT_KERNEL(uac_convert_s16_to_s32, 2, false)
+UAC_CONVERT_KERNEL(uac_convert_s24_to_s32, 3, false)
+UAC_CONVERT_KERNEL(uac_convert_s32_to_s32, 4, false)
+UAC_CONVERT_KERNEL(uac_convert_s16_to_float, 2, true)
+UAC_CONVERT_KERNEL(uac_convert_s24_to_float, 3, true)
+UAC_CONVERT_KERNEL(uac_convert_s32_to_float, 4, true)
+
+// Kernels by sample size from 2 bytes and by output format
+static const uac_convert_kernel_t s_kernels[3][2] = {
+    {uac_convert_s16_to_s32, uac_convert_s16_to_float},
+    {uac_convert_s24_to_s32, uac_convert_s24_to_float},
+    {uac_convert_s32_to_s32, uac_convert_s32_to_float},
+};
+
+esp_err_t uac_convert_check(uint8_t channels, uint8_t sample_bytes, const uac_host_convert_config_t *config)
+{
+    UAC_CONVERT_RETURN_ON_FALSE(config, ESP_ERR_INVALID_ARG, "Invalid argument");
+    UAC_CONVERT_RETURN_ON_FALSE(config->format == UAC_HOST_SAMPLE_S32 || config->format == UAC_HOST_SAMPLE_FLOAT,
+                                ESP_ERR_INVALID_ARG, "Unknown sample format");
+    UAC_CONVERT_RETURN_ON_FALSE(channels, ESP_ERR_INVALID_ARG, "Invalid number of channels");
+    UAC_CONVERT_RETURN_ON_FALSE(channels <= UAC_HOST_CONVERT_MAX_CHANNELS, ESP_ERR_NOT_SUPPORTED, "Too many channels");
+    UAC_CONVERT_RETURN_ON_FALSE(sample_bytes >= 2 && sample_bytes <= 4, ESP_ERR_NOT_SUPPORTED, "Only 16, 24 and 32-bit samples supported");
+    const uint32_t all = (channels == 32) ? UINT32_MAX : ((1UL << channels) - 1);
+    UAC_CONVERT_RETURN_ON_FALSE(!(config->channel_mask & ~all), ESP_ERR_INVALID_ARG, "Channel mask selects missing channel");
+    return ESP_OK;
+}
+
+esp_err_t uac_host_pcm_convert(const uint8_t *pcm, uint32_t frames, uint8_t channels, uint8_t sample_bytes,
+                               const uac_host_convert_config_t *config, void *const *out, uint32_t offset)
+{
+    UAC_CONVERT_RETURN_ON_FALSE(pcm && out, ESP_ERR_INVALID_ARG, "Invalid argument");
+    ESP_RETURN_ON_ERROR(uac_convert_check(channels, sample_bytes, config), TAG, "Invalid conversion");
+
+    uac_convert_map_t map = {0};
+    for (uint8_t ch = 0; ch < channels; ch++) {
+        if (!config->channel_mask || (config->channel_mask & (1UL << ch))) {
+            map.index[map.count++] = ch;
+        }
+    }
+    for (uint8_t k = 0; k < (config->planar ? map.count : 1); k++) {
+        UAC_CONVERT_RETURN_ON_FALSE(out[k], ESP_ERR_INVALID_ARG, "Invalid output buffer");
+    }
+    s_kernels[sample_bytes - 2][config->format == UAC_HOST_SAMPLE_FLOAT](pcm, frames, channels, &map, config->planar, out, offset);
+    return ESP_OK;
+}
@@ -91,9 +91,54 @@ static void print_iad_desc(const usb_iad_desc_t *iad_desc)
     printf("iFunction %d\n", iad_desc->iFunction);
 }
 
+static void print_ac2_header_desc(const uint8_t *buff)
+{
+    const uac2_ac_header_desc_t *desc = (const uac2_ac_header_desc_t *)buff;
+    printf("\t*** Audio control header descriptor ***\n");
+    printf("\tbLength %d\n", desc->bLength);
+    printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
+    printf("\tbDescriptorSubtype 0x%x\n", desc->bDescriptorSubtype);
+    printf("\tbcdADC 0x%x\n", desc->bcdADC);
+    printf("\tbCategory 0x%x\n", desc->bCategory);
+    printf("\twTotalLength %d\n", desc->wTotalLength);
+    printf("\tbmControls 0x%x\n", desc->bmControls);
+}
+
+static void print_ac2_clock_source_desc(const uint8_t *buff)
+{
+    const uac2_ac_clock_source_desc_t *desc = (const uac2_ac_clock_source_desc_t *)buff;
+    printf("\t*** Audio control clock source descriptor ***\n");
+    printf("\tbLength %d\n", desc->bLength);
+    printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
+    printf("\tbDescriptorSubtype 0x%x\n", desc->bDescriptorSubtype);
+    printf("\tbClockID %d\n", desc->bClockID);
+    printf("\tbmAttributes 0x%x\n", desc->bmAttributes);
+    printf("\tbmControls 0x%x\n", desc->bmControls);
+    printf("\tbAssocTerminal %d\n", desc->bAssocTerminal);
+    printf("\tiClockSource %d\n", desc->iClockSource);
+}
+
+static void print_ac2_clock_selector_desc(const uint8_t *buff)
+{
+    const uac2_ac_clock_selector_desc_t *desc = (const uac2_ac_clock_selector_desc_t *)buff;
+    printf("\t*** Audio control clock selector descriptor ***\n");
+    printf("\tbLength %d\n", desc->bLength);
+    printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
+    printf("\tbDescriptorSubtype 0x%x\n", desc->bDescriptorSubtype);
+    printf("\tbClockID %d\n", desc->bClockID);
+    printf("\tbNrInPins %d\n", desc->bNrInPins);
+    for (int i = 0; i < desc->bNrInPins; ++i) {
+        printf("\t\tbaCSourceID[%d] = %d\n", i, desc->baCSourceID[i]);
+    }
+}
+
 static void print_ac_header_desc(const uint8_t *buff)
 {
     const uac_ac_header_desc_t *desc = (const uac_ac_header_desc_t *)buff;
+    if (desc->bcdADC == 0x0200) {
+        print_ac2_header_desc(buff);
+        return;
+    }
     printf("\t*** Audio control header descriptor ***\n");
     printf("\tbLength %d\n", desc->bLength);
     printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
@@ -275,6 +320,12 @@ static void print_uac_class_descriptors(const usb_standard_desc_t *desc, iface_p
         case UAC_AC_SELECTOR_UNIT:
             print_ac_selector_desc(buff);
             break;
+        case UAC2_AC_CLOCK_SOURCE:
+            print_ac2_clock_source_desc(buff);
+            break;
+        case UAC2_AC_CLOCK_SELECTOR:
+            print_ac2_clock_selector_desc(buff);
+            break;
         default:
             goto unknown;
             break;
@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/param.h>
+#include "uac_gain.h"
+
+#define UAC_GAIN_RAMP_STEP      (128)       // Gain change per frame, full scale in 256 frames
+#define UAC_GAIN_PERCENT_DB_MIN (-60 * 256) // Volume of 1 %, in 1/256 dB
+
+/**
+ * @brief Gain of each whole dB from 0 dB to -96 dB in Q15, round(32768 * 10^(-dB / 20))
+ */
+static const uint16_t s_gain_db_table[] = {
+    32768, 29205, 26029, 23198, 20675, 18427, 16423, 14637, 13045, 11627,
+    10362,  9235,  8231,  7336,  6538,  5827,  5193,  4629,  4125,  3677,
+    3277,  2920,  2603,  2320,  2068,  1843,  1642,  1464,  1305,  1163,
+    1036,   924,   823,   734,   654,   583,   519,   463,   413,   368,
+    328,   292,   260,   232,   207,   184,   164,   146,   130,   116,
+    104,    92,    82,    73,    65,    58,    52,    46,    41,    37,
+    33,    29,    26,    23,    21,    18,    16,    15,    13,    12,
+    10,     9,     8,     7,     7,     6,     5,     5,     4,     4,
+    3,     3,     3,     2,     2,     2,     2,     1,     1,     1,
+    1,     1,     1,     1,     1,     1,     1,     0,
+};
+
+void uac_gain_init(uac_gain_t *gain)
+{
+    gain->volume = UAC_GAIN_UNITY;
+    gain->mute = false;
+    gain->gain = UAC_GAIN_UNITY;
+}
+
+uint16_t uac_gain_from_db(int16_t volume_db)
+{
+    if (volume_db >= 0) {
+        return UAC_GAIN_UNITY;
+    }
+    if (volume_db < UAC_GAIN_DB_MIN) {
+        return 0;
+    }
+    // interpolate between the whole dB of the table
+    const uint32_t att = -(int32_t)volume_db;
+    const uint32_t whole = att >> 8;
+    const uint32_t frac = att & 0xff;
+    const uint32_t upper = s_gain_db_table[whole];
+    const uint32_t lower = s_gain_db_table[whole + 1];
+    return (uint16_t)(upper - (((upper - lower) * frac) >> 8));
+}
+
+int16_t uac_gain_percent_to_db(uint8_t volume)
+{
+    if (volume == 0) {
+        return INT16_MIN;
+    }
+    volume = MIN(volume, 100);
+    return (int16_t)(UAC_GAIN_PERCENT_DB_MIN * (100 - volume) / 99);
+}
+
+void uac_gain_set_volume(uac_gain_t *gain, uint16_t volume)
+{
+    __atomic_store_n(&gain->volume, MIN(volume, UAC_GAIN_UNITY), __ATOMIC_RELAXED);
+}
+
+void uac_gain_set_mute(uac_gain_t *gain, bool mute)
+{
+    __atomic_store_n(&gain->mute, mute, __ATOMIC_RELAXED);
+}
+
+static inline int32_t uac_gain_mul(int32_t sample, uint32_t gain, uint8_t sample_bytes)
+{
+    // gain is at most 1.0, the product does not overflow the sample
+    if (sample_bytes == 2) {
+        return (sample * (int32_t)gain) >> 15;
+    }
+    return (int32_t)(((int64_t)sample * gain) >> 15);
+}
+
+static void uac_gain_frame_unaligned(uint8_t *frame, uint32_t gain, uint8_t channels, uint8_t sample_bytes)
+{
+    for (int c = 0; c < channels; c++) {
+        if (sample_bytes == 2) {
+            int16_t sample;
+            memcpy(&sample, frame + c * 2, 2);
+            sample = (int16_t)uac_gain_mul(sample, gain, 2);
+            memcpy(frame + c * 2, &sample, 2);
+        } else {
+            int32_t sample;
+            memcpy(&sample, frame + c * 4, 4);
+            sample = uac_gain_mul(sample, gain, 4);
+            memcpy(frame + c * 4, &sample, 4);
+        }
+    }
+}
+
+void uac_gain_apply(uac_gain_t *gain, void *data, size_t frames, uint8_t channels, uint8_t sample_bytes)
+{
+    const uint32_t target = __atomic_load_n(&gain->mute, __ATOMIC_RELAXED) ? 0 :
+                            __atomic_load_n(&gain->volume, __ATOMIC_RELAXED);
+    uint32_t cur = gain->gain;
+    uint8_t *frame = data;
+    const size_t frame_bytes = (size_t)channels * sample_bytes;
+    const bool aligned = ((uintptr_t)data % sample_bytes) == 0;
+
+    // ramp frame by frame until the target is reached
+    while (frames && cur != target) {
+        cur = (cur < target) ? MIN(cur + UAC_GAIN_RAMP_STEP, target) : MAX((int32_t)cur - UAC_GAIN_RAMP_STEP, (int32_t)target);
+        uac_gain_frame_unaligned(frame, cur, channels, sample_bytes);
+        frame += frame_bytes;
+        frames--;
+    }
+    gain->gain = cur;
+    if (frames == 0 || cur == UAC_GAIN_UNITY) {
+        return;
+    }
+    if (cur == 0) {
+        memset(frame, 0, frames * frame_bytes);
+        return;
+    }
+
+    // constant gain, a plain loop the compiler can unroll or vectorize
+    const size_t samples = frames * channels;
+    if (!aligned) {
+        for (size_t i = 0; i < frames; i++) {
+            uac_gain_frame_unaligned(frame + i * frame_bytes, cur, channels, sample_bytes);
+        }
+    } else if (sample_bytes == 2) {
+        int16_t *s = (int16_t *)frame;
+        for (size_t i = 0; i < samples; i++) {
+            s[i] = (int16_t)(((int32_t)s[i] * (int32_t)cur) >> 15);
+        }
+    } else {
+        int32_t *s = (int32_t *)frame;
+        for (size_t i = 0; i < samples; i++) {
+            s[i] = (int32_t)(((int64_t)s[i] * cur) >> 15);
+        }
+    }
+}
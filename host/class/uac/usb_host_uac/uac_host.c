@@ -5,9 +5,12 @@
  */
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <wchar.h>
 #include <math.h>
 #include <inttypes.h>
 #include <sys/queue.h>
@@ -16,19 +19,28 @@
 #include "sdkconfig.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
-#include "freertos/ringbuf.h"
 #include "usb/usb_host.h"
+#include "usb/usb_host_xfer_pool_weak.h"
 #include "usb/uac_host.h"
 #include "usb/usb_types_ch9.h"
+#include "uac_src.h"
+#include "uac_convert.h"
+#include "uac_gain.h"
+#include "uac_meter.h"
 
 // UAC spinlock
 static portMUX_TYPE uac_lock = portMUX_INITIALIZER_UNLOCKED;
 #define UAC_ENTER_CRITICAL()    portENTER_CRITICAL(&uac_lock)
 #define UAC_EXIT_CRITICAL()     portEXIT_CRITICAL(&uac_lock)
 
+// Interface spinlock, for transfer lists and statistics of one interface accessed from its transfer callbacks
+#define UAC_IFACE_ENTER_CRITICAL(iface) portENTER_CRITICAL(&(iface)->lock)
+#define UAC_IFACE_EXIT_CRITICAL(iface)  portEXIT_CRITICAL(&(iface)->lock)
+
 // UAC verification macros
 #define UAC_GOTO_ON_FALSE_CRITICAL(exp, err)    \
     do {                                        \
@@ -75,6 +87,15 @@ static portMUX_TYPE uac_lock = portMUX_INITIALIZER_UNLOCKED;
 
 static const char *TAG = "uac-host";
 
+// Optional enumeration profiler, marks are made only if the usb_host_enum_profiler component is linked
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase) __attribute__((weak));
+#define UAC_ENUM_MARK(addr, phase)                               \
+    do {                                                         \
+        if (usb_host_enum_profiler_mark) {                       \
+            usb_host_enum_profiler_mark((addr), "uac", (phase)); \
+        }                                                        \
+    } while(0)
+
 #define DEFAULT_CTRL_XFER_TIMEOUT_MS        (5000)
 #define DEFAULT_ISOC_XFER_TIMEOUT_MS        (100)
 #define INTERFACE_FLAGS_OFFSET              (16)
@@ -82,6 +103,61 @@ static const char *TAG = "uac-host";
 #define UAC_EP_DIR_IN                       (0x80)
 #define VOLUME_DB_MIN                       (-127.9961f)
 #define VOLUME_DB_MAX                       (127.9961f)
+#define UAC_EP_SYNC_TYPE_MASK               (0x0C)
+#define UAC_EP_SYNC_TYPE_ASYNC              (0x04)
+#define UAC_RATE_FRAC_BITS                  (16)        // Rates are samples per packet in 16.16 fixed point
+#define UAC_FEEDBACK_RANGE_SHIFT            (3)         // Feedback is accepted within nominal rate +-12.5%
+#define UAC_SRC_CHUNK_FRAMES                (256)       // Frames passed through the sample rate converter at once
+#define UAC_LATENCY_MAX_URBS                (4)         // URBs used for latency profile, unless the packets of an URB exceed UAC_URB_MAX_BYTES
+#define UAC_LATENCY_MAX_URBS_CAPPED         (16)        // URBs used for latency profile with large endpoints
+#define UAC_URB_MAX_BYTES                   (8 * 1024)  // Maximum buffer size of one URB for latency profile
+#define UAC_VERSION_1                       (0x0100)    // bcdADC of UAC 1.0 devices
+#define UAC_VERSION_2                       (0x0200)    // bcdADC of UAC 2.0 devices
+#define UAC2_FREQ_SUBRANGE_SIZE             (12)        // dMIN, dMAX and dRES of one sampling frequency subrange
+#define UAC_CTRL_XFER_DATA_SIZE             (2 + UAC2_FREQ_SUBRANGE_SIZE * UAC_FREQ_NUM_MAX) // Data stage of control transfers, fits frequency RANGE
+#define UAC_DEV_ADDR_NUM                    (128)       // USB device addresses, the registry is indexed by them
+#define UAC_IFACE_SET_MIN_SIZE              (8)         // Initial size of the interface handle set, doubled when half full
+
+/**
+ * @brief Single producer single consumer ring buffer for audio data
+ *
+ * Read and write indices run freely and are masked by the power-of-two capacity, so the length is their difference
+ * and neither side needs a lock. The producer only changes the write index, the consumer only the read index.
+ * Only the user side of the ring blocks, the USB side gives the event after each transfer.
+ * Rings with more than one consumer serialize them by consumer_lock: the reader and the RX drop of the oldest data,
+ * the TX refill from USB client task and from uac_host_device_write(), and _ring_buffer_flush() of both.
+ * The USB side never blocks on the lock, it only tries it.
+ */
+typedef struct uac_ring {
+    uint32_t head;                             /*!< Write index, changed by producer */
+    uint32_t tail;                             /*!< Read index, changed by consumer */
+    uint32_t size;                             /*!< Maximum number of bytes in the ring, buffer_size of the device config */
+    uint32_t mask;                             /*!< Capacity of the storage - 1 */
+    SemaphoreHandle_t event;                   /*!< Given when data or free space was added, unblocks the waiting side */
+    SemaphoreHandle_t consumer_lock;           /*!< Keeps single consumer of the ring */
+    bool flushing;                             /*!< Set by _ring_buffer_flush(), consumers waiting for data give up */
+    uint8_t *buf;                              /*!< Storage, capacity is power of two. Follows this structure, unless provided by the user */
+} uac_ring_t;
+
+/**
+ * @brief Contiguous segment of the ring buffer storage
+ */
+typedef struct {
+    uint8_t *data;                             /*!< Start of the segment */
+    size_t len;                                /*!< Length of the segment */
+} uac_ring_seg_t;
+
+/**
+ * @brief Terminal, unit or clock entity of the Audio Control interface, indexed once when the device is added
+ */
+typedef struct {
+    uint8_t id;                                /*!< Terminal, unit or clock ID */
+    uint8_t subtype;                           /*!< Class-Specific Audio Control descriptor subtype */
+    uint8_t source_num;                        /*!< Number of source IDs, clock source IDs for clock entities */
+    uint8_t clock_id;                          /*!< UAC 2.0 clock source of a terminal, 0 if none */
+    const uint8_t *source_id;                  /*!< Source IDs, inside the descriptor */
+    const uint8_t *desc;                       /*!< Entity descriptor, inside cs_ac_desc */
+} uac_ac_entity_t;
 
 /**
  * @brief UAC Device structure.
@@ -90,7 +166,7 @@ static const char *TAG = "uac-host";
 typedef struct uac_host_device {
     // dynamic values after device opening, should be protected by critical section
     STAILQ_ENTRY(uac_host_device) tailq_entry;      /*!< UAC device queue */
-    uint8_t opened_cnt;                             /*!< Device opened counter */
+    uint8_t opened_cnt;                             /*!< Device opened counter. Accessed atomically */
     // constant values after device opening
     usb_device_handle_t dev_hdl;                    /*!< USB device handle */
     uint8_t addr;                                   /*!< USB device address */
@@ -99,6 +175,10 @@ typedef struct uac_host_device {
     usb_transfer_t *ctrl_xfer;                      /*!< Pointer to control transfer buffer */
     uint8_t ctrl_iface_num;                         /*!< Control interface number */
     uint8_t *cs_ac_desc;                            /*!< Class-Specific Audio Control Interface descriptor */
+    uac_ac_entity_t *entities;                      /*!< Topology of the Audio Control interface, entities of cs_ac_desc */
+    uint8_t entity_num;                             /*!< Number of entities */
+    uint16_t uac_version;                           /*!< bcdADC of the Audio Control header, UAC_VERSION_1 or UAC_VERSION_2 */
+    usb_speed_t speed;                              /*!< USB speed of the device */
 } uac_device_t;
 
 /**
@@ -124,46 +204,143 @@ typedef struct uac_interface_alt {
     uint16_t ep_mps;                           /*!< audio stream endpoint max size */
     uint8_t ep_attr;                           /*!< audio stream endpoint attributes */
     uint8_t interval;                          /*!< audio stream endpoint interval */
+    uint8_t fb_ep_addr;                        /*!< explicit feedback endpoint number, 0 if not present */
+    uint16_t fb_ep_mps;                        /*!< explicit feedback endpoint max size */
     uint8_t connected_terminal;                /*!< connected terminal ID */
     uint8_t feature_unit;                      /*!< connected feature unit ID */
+    uint8_t clock_id;                          /*!< UAC 2.0 clock source of the connected terminal, 0 for UAC 1.0 */
     uint8_t vol_ch_map;                        /*!< volume channel map */
     uint8_t mute_ch_map;                       /*!< mute channel map */
-    bool freq_ctrl_supported;                  /*!< sampling frequency control supported */
+    bool freq_ctrl_supported;                  /*!< sampling frequency control supported, by endpoint in UAC 1.0, by clock source in UAC 2.0 */
     uac_host_dev_alt_param_t dev_alt_param;    /*!< audio stream alternate setting parameters */
 } uac_iface_alt_t;
 
+/**
+ * @brief Stream, volume and mute set by the user, restored when the interface is opened after reconnection
+ */
+typedef struct {
+    bool stream_started;                       /*!< Stream started by uac_host_device_start and not stopped */
+    uac_host_stream_config_t stream_config;    /*!< Configuration of the last start */
+    bool volume_set;                           /*!< Volume was set by the user */
+    bool volume_is_db;                         /*!< Volume was set by uac_host_device_set_volume_db, else in % */
+    int16_t volume;                            /*!< Last volume, in % or with 1/256 db step */
+    bool mute_set;                             /*!< Mute was set by the user */
+    bool mute;                                 /*!< Last mute */
+} uac_iface_session_t;
+
 /**
  * @brief UAC Interface structure in device to interact with. After UAC device opening keeps the interface configuration
  *
  */
 typedef struct uac_interface {
     // dynamic values after interface opening, should be protected by critical section
-    STAILQ_ENTRY(uac_interface) tailq_entry;
+    STAILQ_ENTRY(uac_interface) tailq_entry;   /*!< Entry of the driver's interface list, protected by the driver lock */
+    portMUX_TYPE lock;                         /*!< Spinlock of this interface, see UAC_IFACE_ENTER_CRITICAL() */
     usb_transfer_t **xfer_list;                /*!< Pointer to transfer list */
     usb_transfer_t **free_xfer_list;           /*!< Pointer to free transfer list */
+    uint32_t tx_idle_mask;                     /*!< Bit per TX transfer parked in free_xfer_list while active, the writer which clears the bit owns the transfer */
+    bool tx_lock_missed;                       /*!< Set when a TX transfer is parked because consumer_lock was taken, the thread releasing the lock submits it */
+    uint32_t xfer_inflight;                    /*!< Stream transfers submitted and not yet returned by their callback */
     // variable only change by app operation, protected by mutex
     SemaphoreHandle_t state_mutex;             /*!< UAC device state mutex */
+    SemaphoreHandle_t xfer_returned;           /*!< Given by the last stream transfer returned while not active */
     uac_iface_state_t state;                   /*!< Interface state */
     uint32_t flags;                            /*!< Interface flags */
     uint8_t cur_alt;                           /*!< Current alternate setting (-1) */
     uint8_t cur_vol;                           /*!< volume % 0-100 */
+    uint32_t clock_freq;                       /*!< UAC 2.0 clock source frequency set by the last resume, 0 if not set since start */
     // constant parameters after interface opening
     uac_device_t *parent;                      /*!< Parent USB UAC device */
     uint8_t xfer_num;                          /*!< Number of transfers */
     uint8_t packet_num;                        /*!< packets per transfer */
-    uint32_t packet_size;                      /*!< size of each packet */
+    uint32_t packet_size;                      /*!< size of the largest packet at the nominal rate, in whole frames */
+    uint32_t packet_rate;                      /*!< data packets per second, by the bus speed and the endpoint interval */
+    uint32_t frame_bytes;                      /*!< size of one audio frame, samples of all channels */
+    uint32_t nominal_rate;                     /*!< nominal samples per packet, 16.16 fixed point */
+    uint32_t fb_rate;                          /*!< samples per packet from feedback endpoint, 16.16 fixed point. 0 if not received */
+    uint64_t rate_acc;                         /*!< fraction of samples carried to the next TX packet, in 1/(packet_rate << 16) samples */
+    usb_transfer_t *fb_xfer;                   /*!< transfer of explicit feedback endpoint, TX only */
     uac_host_device_event_cb_t user_cb;        /*!< Interface application callback */
     void *user_cb_arg;                         /*!< Interface application callback arg */
-    RingbufHandle_t ringbuf;                   /*!< Ring buffer for audio data */
-    uint32_t ringbuf_size;                     /*!< Ring buffer size */
+    TaskHandle_t notify_task;                  /*!< Task notified about buffer level instead of RX/TX done callbacks, NULL if none */
+    uint32_t notify_bits;                      /*!< Notification bits of notify_task */
+    bool notify_armed;                         /*!< Level is back across the threshold, the next crossing notifies the task */
+    uac_ring_t *ringbuf;                       /*!< Ring buffer for audio data */
+    struct uac_duplex *duplex;                 /*!< Full-duplex session the interface belongs to, NULL if none */
+    uint64_t xfer_frames;                      /*!< Audio frames transferred by the endpoint in the duplex session */
+    uac_host_stream_stats_t stats;             /*!< Overflow and underrun statistics, protected by the interface lock */
+    uac_host_stream_clock_t clock;             /*!< RX frames received and host time of the last transfer, protected by the interface lock */
+    bool tx_underrun;                          /*!< TX underrun in progress, reported once until data are sent again */
+    uac_src_t *src;                            /*!< Sample rate converter, NULL if the device runs at the stream rate */
+    uint8_t *src_buf;                          /*!< Frames at the device rate, between ring buffer and converter */
+    uac_gain_t soft_gain;                      /*!< Software volume and mute, with FLAG_STREAM_SOFT_VOLUME */
+    int16_t soft_volume_db;                    /*!< Software volume with 1/256 db step */
     uint32_t ringbuf_threshold;                /*!< Ring buffer threshold */
+    uint32_t enc_saved_threshold;              /*!< Ring buffer threshold of the device configuration, while the encoder is set */
+    uac_host_encoder_config_t encoder;         /*!< Encoder of RX blocks, set if enc_buf is not NULL */
+    uint8_t *enc_buf;                          /*!< One block, for blocks wrapping around the end of the ring buffer */
+    uac_host_meter_config_t meter_config;      /*!< RX level meter set by the user, window_frames is 0 if none. Protected by the interface lock */
+    uint32_t meter_gen;                        /*!< Incremented on each change of meter_config, protected by the interface lock */
+    uint32_t meter_cur_gen;                    /*!< Generation of meter_config applied to meter, used only by the RX transfer callback */
+    uac_meter_t meter;                         /*!< RX level meter, used only by the RX transfer callback */
+    uac_host_meter_level_t meter_level;        /*!< Levels of the last metering window, protected by the interface lock */
     uac_host_dev_info_t dev_info;              /*!< USB device parameters */
     int16_t vol_min_db;                        /*!< volume min with 1/256 db step */
     int16_t vol_max_db;                        /*!< volume max with 1/256 db step */
     int16_t vol_res_db;                        /*!< volume resolution with 1/256 db step */
     uac_iface_alt_t *iface_alt;                /*!< audio stream alternate setting */
+    uint16_t config_len;                       /*!< wTotalLength of the configuration descriptor, part of the reconnect cache key */
+    bool vol_range_valid;                      /*!< vol_min_db, vol_max_db and vol_res_db were received from the device */
+    bool gone;                                 /*!< The device was disconnected, the session is kept in the reconnect cache */
+    uac_iface_session_t session;               /*!< Stream, volume and mute set by the user */
 } uac_iface_t;
 
+/**
+ * @brief Parameters of a closed interface, kept to open it again without parsing and control requests
+ *
+ * Entries are matched by VID, PID, serial number, configuration descriptor length and interface number.
+ * An entry is moved into the interface when it is opened and back into the cache when it is closed.
+ */
+typedef struct {
+    bool used;                                 /*!< The entry holds an interface */
+    uint32_t age;                              /*!< Order of closing, the oldest entry is replaced first */
+    uint16_t vid;                              /*!< Vendor ID */
+    uint16_t pid;                              /*!< Product ID */
+    uint16_t config_len;                       /*!< wTotalLength of the configuration descriptor */
+    uint8_t iface_num;                         /*!< Interface number */
+    wchar_t serial[UAC_STR_DESC_MAX_LENGTH];   /*!< Serial number string */
+    uac_host_stream_t type;                    /*!< Stream type */
+    uint8_t iface_alt_num;                     /*!< Number of alternate settings */
+    uac_iface_alt_t *iface_alt;                /*!< Parsed alternate settings, with UAC 2.0 sampling frequencies */
+    bool vol_range_valid;                      /*!< Volume range is valid */
+    int16_t vol_min_db;                        /*!< volume min with 1/256 db step */
+    int16_t vol_max_db;                        /*!< volume max with 1/256 db step */
+    int16_t vol_res_db;                        /*!< volume resolution with 1/256 db step */
+    bool session_valid;                        /*!< The interface was closed by disconnection, the session can be restored */
+    uac_iface_session_t session;               /*!< Stream, volume and mute at disconnection */
+} uac_iface_cache_t;
+
+/**
+ * @brief UAC full-duplex session of microphone and speaker interfaces of one device
+ *
+ * Both interfaces start streaming together, so the n-th received frame is paired with the n-th sent frame.
+ */
+typedef struct uac_duplex {
+    uac_iface_t *rx_iface;                     /*!< Microphone interface */
+    uac_iface_t *tx_iface;                     /*!< Speaker interface */
+    uac_ring_t *tx_ref;                        /*!< Data sent by the speaker, returned together with the microphone data */
+    uint64_t frame_pos;                        /*!< Shared frame counter of the next returned block */
+    int32_t loopback_offset;                   /*!< Speaker frames minus microphone frames transferred, at last RX transfer */
+} uac_duplex_t;
+
+/**
+ * @brief VID and PID of a connected UAC device, both 0 if there is none at the address
+ */
+typedef struct {
+    uint16_t vid;
+    uint16_t pid;
+} uac_dev_id_t;
+
 /**
  * @brief UAC driver default context
  *
@@ -176,10 +353,20 @@ typedef struct {
     volatile bool end_client_event_handling;                    /*!< Client event handling flag */
     // constant values after UAC Host initialization
     bool event_handling_started;                                /*!< Events handler started flag */
+    TaskHandle_t event_task;                                    /*!< Task handling the client events, stream transfers return in it */
     usb_host_client_handle_t client_handle;                     /*!< Client task handle */
     uac_host_driver_event_cb_t user_cb;                         /*!< User application callback */
     void *user_arg;                                             /*!< User application callback args */
     SemaphoreHandle_t all_events_handled;                       /*!< Events handler semaphore */
+    uac_iface_cache_t *cache;                                   /*!< CONFIG_UAC_RECONNECT_CACHE_NUM closed interfaces, protected by the driver lock */
+    uint32_t cache_age;                                         /*!< Age of the last cached interface */
+    // device registry, protected by critical section
+    uac_device_t *devices_by_addr[UAC_DEV_ADDR_NUM];            /*!< Added UAC devices by USB address */
+    uac_dev_id_t connected[UAC_DEV_ADDR_NUM];                   /*!< Connected UAC devices by USB address, set by new device events */
+    bool connected_scanned;                                     /*!< Devices connected before installation were looked up */
+    uac_iface_t **iface_set;                                    /*!< Open addressing set of added interfaces, validates handles */
+    uint32_t iface_set_size;                                    /*!< Size of iface_set, power of two, 0 until the first interface */
+    uint32_t iface_count;                                       /*!< Number of interfaces in iface_set */
 } uac_driver_t;
 
 /**
@@ -202,6 +389,8 @@ static esp_err_t _uac_host_device_add(uint8_t addr, usb_device_handle_t dev_hdl,
 static esp_err_t _uac_host_device_delete(uac_device_t *uac_device);
 static esp_err_t uac_cs_request_set(uac_device_t *uac_device, const uac_cs_request_t *req);
 static esp_err_t uac_cs_request_set_ep_frequency(uac_iface_t *iface, uint8_t ep_addr, uint32_t freq);
+static esp_err_t uac_host_tx_xfer_submit_free(uac_iface_t *iface);
+static esp_err_t uac2_cs_request_set_clock_frequency(uac_iface_t *iface, uint8_t clock_id, uint32_t freq);
 
 // --------------------------- Utility Functions --------------------------------
 /**
@@ -231,70 +420,204 @@ static int16_t _volume_db_f_2_i16(float volume_db_f)
 }
 
 // --------------------------- Buffer Management --------------------------------
-static size_t _ring_buffer_get_len(RingbufHandle_t ringbuf_hdl)
+static void _ring_buffer_delete(uac_ring_t *ring)
+{
+    assert(ring);
+    if (ring->event) {
+        vSemaphoreDelete(ring->event);
+    }
+    if (ring->consumer_lock) {
+        vSemaphoreDelete(ring->consumer_lock);
+    }
+    free(ring);
+}
+
+static esp_err_t _ring_buffer_create(size_t size, uint8_t *storage, uac_ring_t **ring_ret)
+{
+    assert(ring_ret);
+    if (size == 0 || size > (1UL << 31)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Round the capacity up to power of two, so the indices can be masked
+    size_t capacity = 1;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    // Storage provided by the user must hold the whole capacity
+    uac_ring_t *ring = calloc(1, sizeof(uac_ring_t) + (storage ? 0 : capacity));
+    if (!ring) {
+        return ESP_ERR_NO_MEM;
+    }
+    ring->buf = storage ? storage : (uint8_t *)(ring + 1);
+    ring->event = xSemaphoreCreateBinary();
+    ring->consumer_lock = xSemaphoreCreateMutex();
+    if (!ring->event || !ring->consumer_lock) {
+        _ring_buffer_delete(ring);
+        return ESP_ERR_NO_MEM;
+    }
+    ring->size = size;
+    ring->mask = capacity - 1;
+    *ring_ret = ring;
+    return ESP_OK;
+}
+
+static inline size_t _ring_buffer_get_len(const uac_ring_t *ring)
+{
+    assert(ring);
+    const uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+    const uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return head - tail;
+}
+
+static inline size_t _ring_buffer_get_free(const uac_ring_t *ring)
+{
+    return ring->size - _ring_buffer_get_len(ring);
+}
+
+/**
+ * @brief Split area of the ring starting at index into at most two contiguous segments
+ *
+ * @param[in]  ring   Ring buffer
+ * @param[in]  index  Free running index of the start of the area
+ * @param[in]  len    Length of the area
+ * @param[out] seg    Two segments, the second one has zero length if the area does not wrap around
+ */
+static inline void _ring_buffer_segments(uac_ring_t *ring, uint32_t index, size_t len, uac_ring_seg_t seg[2])
+{
+    const size_t offset = index & ring->mask;
+    const size_t first = MIN(len, ring->mask + 1 - offset);
+    seg[0].data = &ring->buf[offset];
+    seg[0].len = first;
+    seg[1].data = ring->buf;
+    seg[1].len = len - first;
+}
+
+/**
+ * @brief Get segments with all data in the ring, without removing them. Consumer only
+ *
+ * @return Length of data in both segments
+ */
+static inline size_t _ring_buffer_peek_data(uac_ring_t *ring, uac_ring_seg_t seg[2])
+{
+    const size_t len = _ring_buffer_get_len(ring);
+    _ring_buffer_segments(ring, ring->tail, len, seg);
+    return len;
+}
+
+/**
+ * @brief Get segments with all free space in the ring. Producer only
+ *
+ * @return Length of free space in both segments
+ */
+static inline size_t _ring_buffer_peek_free(uac_ring_t *ring, uac_ring_seg_t seg[2])
 {
-    assert(ringbuf_hdl);
-    size_t size = 0;
-    vRingbufferGetInfo(ringbuf_hdl, NULL, NULL, NULL, NULL, &size);
-    return size;
+    const size_t len = _ring_buffer_get_free(ring);
+    _ring_buffer_segments(ring, ring->head, len, seg);
+    return len;
 }
 
-static void _ring_buffer_flush(RingbufHandle_t ringbuf_hdl)
+// Remove len bytes of data from the ring. Consumer only
+static inline void _ring_buffer_consume(uac_ring_t *ring, size_t len)
 {
-    assert(ringbuf_hdl);
-    size_t read_bytes = 0;
-    size_t uxItemsWaiting = 0;
-    vRingbufferGetInfo(ringbuf_hdl, NULL, NULL, NULL, NULL, &uxItemsWaiting);
-    uint8_t *buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, &read_bytes, 0, uxItemsWaiting);
+    __atomic_store_n(&ring->tail, ring->tail + len, __ATOMIC_RELEASE);
+}
+
+// Add len bytes written into the free segments to the ring. Producer only
+static inline void _ring_buffer_produce(uac_ring_t *ring, size_t len)
+{
+    __atomic_store_n(&ring->head, ring->head + len, __ATOMIC_RELEASE);
+}
+
+// Unblock the other side of the ring waiting in _ring_buffer_push() or _ring_buffer_pop()
+static inline void _ring_buffer_notify(uac_ring_t *ring)
+{
+    xSemaphoreGive(ring->event);
+}
 
-    if (buf_rcv) {
-        vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
+/**
+ * @brief Copy data into the ring, without blocking and without notifying the consumer. Producer only
+ *
+ * @return true if the data were copied, false if there is not enough free space
+ */
+static bool _ring_buffer_write(uac_ring_t *ring, const uint8_t *buf, size_t write_bytes)
+{
+    uac_ring_seg_t seg[2];
+    if (_ring_buffer_peek_free(ring, seg) < write_bytes) {
+        return false;
     }
+    const size_t first = MIN(write_bytes, seg[0].len);
+    memcpy(seg[0].data, buf, first);
+    memcpy(seg[1].data, buf + first, write_bytes - first);
+    _ring_buffer_produce(ring, write_bytes);
+    return true;
+}
 
-    if (uxItemsWaiting > read_bytes) {
-        // read the second time to flush all data
-        vRingbufferGetInfo(ringbuf_hdl, NULL, NULL, NULL, NULL, &uxItemsWaiting);
-        buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, &read_bytes, 0, uxItemsWaiting);
-        if (buf_rcv) {
-            vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
+/**
+ * @brief Wait until the ring has at least `len` bytes of data or of free space
+ *
+ * @return true if the condition is met, false on timeout
+ */
+static bool _ring_buffer_wait(uac_ring_t *ring, bool for_data, size_t len, TickType_t ticks_to_wait)
+{
+    TimeOut_t timeout;
+    vTaskSetTimeOutState(&timeout);
+    while ((for_data ? _ring_buffer_get_len(ring) : _ring_buffer_get_free(ring)) < len) {
+        // a consumer waiting for data holds consumer_lock, which the flush needs
+        if ((for_data && __atomic_load_n(&ring->flushing, __ATOMIC_ACQUIRE)) ||
+                xTaskCheckForTimeOut(&timeout, &ticks_to_wait) == pdTRUE) {
+            return false;
         }
+        xSemaphoreTake(ring->event, ticks_to_wait);
     }
+    return true;
 }
 
-static esp_err_t _ring_buffer_push(RingbufHandle_t ringbuf_hdl, uint8_t *buf, size_t write_bytes, TickType_t xTicksToWait)
+/**
+ * @brief Remove all data from the ring
+ *
+ * The flush is one more consumer, so it takes consumer_lock. A consumer waiting for data is woken up and gives up,
+ * so that the lock is released
+ */
+static void _ring_buffer_flush(uac_ring_t *ring)
 {
-    assert(ringbuf_hdl && buf);
-    int res = xRingbufferSend(ringbuf_hdl, buf, write_bytes, xTicksToWait);
+    assert(ring);
+    __atomic_store_n(&ring->flushing, true, __ATOMIC_RELEASE);
+    _ring_buffer_notify(ring);
+    xSemaphoreTake(ring->consumer_lock, portMAX_DELAY);
+    _ring_buffer_consume(ring, _ring_buffer_get_len(ring));
+    __atomic_store_n(&ring->flushing, false, __ATOMIC_RELEASE);
+    xSemaphoreGive(ring->consumer_lock);
+    _ring_buffer_notify(ring);
+}
 
-    if (res != pdTRUE) {
+static esp_err_t _ring_buffer_push(uac_ring_t *ring, const uint8_t *buf, size_t write_bytes, TickType_t xTicksToWait)
+{
+    assert(ring && buf);
+    if (write_bytes > ring->size || !_ring_buffer_wait(ring, false, write_bytes, xTicksToWait)) {
         ESP_LOGD(TAG, "buffer is too small, push failed");
         return ESP_FAIL;
     }
+    _ring_buffer_write(ring, buf, write_bytes);
+    _ring_buffer_notify(ring);
     return ESP_OK;
 }
 
-static esp_err_t _ring_buffer_pop(RingbufHandle_t ringbuf_hdl, uint8_t *buf, size_t req_bytes, size_t *read_bytes, TickType_t ticks_to_wait)
+static esp_err_t _ring_buffer_pop(uac_ring_t *ring, uint8_t *buf, size_t req_bytes, size_t *read_bytes, TickType_t ticks_to_wait)
 {
-    assert(ringbuf_hdl && buf && read_bytes);
-    uint8_t *buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, read_bytes, ticks_to_wait, req_bytes);
-
-    if (!buf_rcv) {
+    assert(ring && buf && read_bytes);
+    *read_bytes = 0;
+    if (!_ring_buffer_wait(ring, true, 1, ticks_to_wait)) {
         return ESP_FAIL;
     }
 
-    memcpy(buf, buf_rcv, *read_bytes);
-    vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
-
-    size_t read_bytes2 = 0;
-    if (*read_bytes < req_bytes) {
-        buf_rcv = xRingbufferReceiveUpTo(ringbuf_hdl, &read_bytes2, 0, req_bytes - *read_bytes);
-        if (buf_rcv) {
-            memcpy(buf + *read_bytes, buf_rcv, read_bytes2);
-            *read_bytes += read_bytes2;
-            vRingbufferReturnItem(ringbuf_hdl, (void *)(buf_rcv));
-        }
-    }
-
+    uac_ring_seg_t seg[2];
+    const size_t len = MIN(req_bytes, _ring_buffer_peek_data(ring, seg));
+    const size_t first = MIN(len, seg[0].len);
+    memcpy(buf, seg[0].data, first);
+    memcpy(buf + first, seg[1].data, len - first);
+    _ring_buffer_consume(ring, len);
+    _ring_buffer_notify(ring);
+    *read_bytes = len;
     return ESP_OK;
 }
 
@@ -311,6 +634,137 @@ static void event_handler_task(void *arg)
     vTaskDelete(NULL);
 }
 
+// --------------------------- Device Registry --------------------------------
+/**
+ * @brief Home slot of an interface in the interface handle set
+ *
+ * @param[in] iface  Pointer to Interface structure, it is not dereferenced
+ * @param[in] mask   Size of the set - 1
+ */
+static inline uint32_t uac_iface_set_slot(const uac_iface_t *iface, uint32_t mask)
+{
+    return ((uint32_t)((uintptr_t)iface >> 3) * 2654435761u) & mask;
+}
+
+/**
+ * @brief Find an interface in the interface handle set
+ *
+ * Handles are validated without dereferencing them, so stale handles of deleted interfaces are rejected safely.
+ *
+ * @note Called from critical section
+ *
+ * @param[in] iface  Pointer to Interface structure
+ * @return Slot of the interface, -1 if it is not in the set
+ */
+static int uac_iface_set_find(const uac_iface_t *iface)
+{
+    const uint32_t size = s_uac_driver->iface_set_size;
+    if (size == 0) {
+        return -1;
+    }
+    for (uint32_t i = uac_iface_set_slot(iface, size - 1); s_uac_driver->iface_set[i]; i = (i + 1) & (size - 1)) {
+        if (s_uac_driver->iface_set[i] == iface) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Put an interface into a set by linear probing
+ *
+ * @note Called from critical section
+ */
+static void uac_iface_set_put(uac_iface_t **set, uint32_t size, uac_iface_t *iface)
+{
+    uint32_t i = uac_iface_set_slot(iface, size - 1);
+    while (set[i]) {
+        i = (i + 1) & (size - 1);
+    }
+    set[i] = iface;
+}
+
+/**
+ * @brief Add an interface to the interface list and the handle set
+ *
+ * The set is kept at most half full. It is grown outside of the critical section and swapped in, if no other
+ * task grew it meanwhile.
+ *
+ * @param[in] iface  Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t uac_iface_register(uac_iface_t *iface)
+{
+    uac_iface_t **grown = NULL;
+    uint32_t grown_size = 0;
+
+    while (true) {
+        uac_iface_t **old = NULL;
+        UAC_ENTER_CRITICAL();
+        const uint32_t size = s_uac_driver->iface_set_size;
+        if ((s_uac_driver->iface_count + 1) * 2 <= size) {
+            uac_iface_set_put(s_uac_driver->iface_set, size, iface);
+            s_uac_driver->iface_count++;
+            STAILQ_INSERT_TAIL(&s_uac_driver->uac_ifaces_tailq, iface, tailq_entry);
+            UAC_EXIT_CRITICAL();
+            free(grown);
+            return ESP_OK;
+        }
+        if (grown && grown_size > size) {
+            for (uint32_t i = 0; i < size; i++) {
+                if (s_uac_driver->iface_set[i]) {
+                    uac_iface_set_put(grown, grown_size, s_uac_driver->iface_set[i]);
+                }
+            }
+            old = s_uac_driver->iface_set;
+            s_uac_driver->iface_set = grown;
+            s_uac_driver->iface_set_size = grown_size;
+            grown = NULL;
+        }
+        UAC_EXIT_CRITICAL();
+
+        if (old) {
+            free(old);
+            continue;
+        }
+        free(grown);
+        grown_size = size ? size * 2 : UAC_IFACE_SET_MIN_SIZE;
+        grown = calloc(grown_size, sizeof(uac_iface_t *));
+        UAC_RETURN_ON_FALSE(grown, ESP_ERR_NO_MEM, "Unable to allocate interface registry");
+    }
+}
+
+/**
+ * @brief Remove an interface from the interface list and the handle set
+ *
+ * Following entries of the probe sequence are shifted back, so no tombstones are left in the set.
+ *
+ * @param[in] iface  Pointer to Interface structure
+ */
+static void uac_iface_unregister(uac_iface_t *iface)
+{
+    UAC_ENTER_CRITICAL();
+    STAILQ_REMOVE(&s_uac_driver->uac_ifaces_tailq, iface, uac_interface, tailq_entry);
+    const int found = uac_iface_set_find(iface);
+    if (found >= 0) {
+        uac_iface_t **set = s_uac_driver->iface_set;
+        const uint32_t mask = s_uac_driver->iface_set_size - 1;
+        uint32_t hole = (uint32_t)found;
+        set[hole] = NULL;
+        for (uint32_t i = (hole + 1) & mask; set[i]; i = (i + 1) & mask) {
+            // The entry stays if its home slot is cyclically in (hole, i]
+            const uint32_t home = uac_iface_set_slot(set[i], mask);
+            if (((i - home) & mask) >= ((i - hole) & mask)) {
+                set[hole] = set[i];
+                set[i] = NULL;
+                hole = i;
+            }
+        }
+        s_uac_driver->iface_count--;
+    }
+    UAC_EXIT_CRITICAL();
+}
+
 /**
  * @brief Return UAC device in devices list by USB device handle
  *
@@ -339,17 +793,13 @@ static uac_device_t *get_uac_device_by_handle(usb_device_handle_t usb_handle)
  */
 static uac_device_t *get_uac_device_by_addr(uint8_t addr)
 {
-    uac_device_t *device = NULL;
-
-    UAC_ENTER_CRITICAL();
-    STAILQ_FOREACH(device, &s_uac_driver->uac_devices_tailq, tailq_entry) {
-        if (addr == device->addr) {
-            UAC_EXIT_CRITICAL();
-            return device;
-        }
+    if (addr >= UAC_DEV_ADDR_NUM) {
+        return NULL;
     }
+    UAC_ENTER_CRITICAL();
+    uac_device_t *device = s_uac_driver->devices_by_addr[addr];
     UAC_EXIT_CRITICAL();
-    return NULL;
+    return device;
 }
 
 /**
@@ -428,18 +878,10 @@ static uac_iface_t *get_interface_by_vid_pid(uint16_t vid, uint16_t pid, uint8_t
  */
 static inline bool is_interface_in_list(uac_iface_t *iface)
 {
-    uac_iface_t *interface = NULL;
-
     UAC_ENTER_CRITICAL();
-    STAILQ_FOREACH(interface, &s_uac_driver->uac_ifaces_tailq, tailq_entry) {
-        if (iface == interface) {
-            UAC_EXIT_CRITICAL();
-            return true;
-        }
-    }
-
+    const bool found = iface && uac_iface_set_find(iface) >= 0;
     UAC_EXIT_CRITICAL();
-    return false;
+    return found;
 }
 
 /**
@@ -460,27 +902,6 @@ static uac_iface_t *get_iface_by_handle(uac_host_device_handle_t uac_dev_handle)
     return uac_iface;
 }
 
-/**
- * @brief Check UAC interface descriptor present
- *
- * @param[in] config_desc  Pointer to Configuration Descriptor
- * @return esp_err_t
- */
-static bool uac_interface_present(const usb_config_desc_t *config_desc)
-{
-    assert(config_desc);
-    int offset = 0;
-    int total_len = config_desc->wTotalLength;
-    const usb_intf_desc_t *iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, total_len, offset);
-    while (iface_desc != NULL) {
-        if (USB_CLASS_AUDIO == iface_desc->bInterfaceClass) {
-            return true;
-        }
-        iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_len, offset);
-    }
-    return false;
-}
-
 /**
  * @brief UAC Interface user callback function.
  *
@@ -550,133 +971,182 @@ static inline esp_err_t uac_host_interface_unlock(uac_iface_t *iface)
     return (xSemaphoreGive(iface->state_mutex) ? ESP_OK : ESP_FAIL);
 }
 
-static uint8_t _uac_next_linked_uint_id(const uint8_t *desc, uint8_t unit_id, uint8_t **feat_desc)
+/**
+ * @brief Get total length of Class-Specific Audio Control descriptors, the header layout depends on the UAC version
+ *
+ * @param[in] desc    Pointer to Class-Specific Audio Control Interface Header descriptor
+ * @return Total length of the Class-Specific Audio Control descriptors
+ */
+static size_t _uac_ac_desc_total_length(const uint8_t *desc)
+{
+    const uac_ac_header_desc_t *header_desc = (const uac_ac_header_desc_t *)desc;
+    if (header_desc->bcdADC == UAC_VERSION_2) {
+        return ((const uac2_ac_header_desc_t *)desc)->wTotalLength;
+    }
+    return header_desc->wTotalLength;
+}
+
+/**
+ * @brief Fill topology entity from Class-Specific Audio Control descriptor
+ *
+ * @param[in]  desc     Pointer to the descriptor
+ * @param[out] entity   Entity, may be NULL to only check the descriptor
+ * @return true if the descriptor is a terminal, unit or clock entity used by the lookups
+ */
+static bool _uac_ac_entity_parse(const uac_desc_header_t *desc, uac_ac_entity_t *entity)
 {
-    *feat_desc = NULL;
-    if (!desc) {
-        return 0;
+    uac_ac_entity_t parsed = {
+        .subtype = desc->bDescriptorSubtype,
+        .desc = (const uint8_t *)desc,
+    };
+    const uint8_t *raw = (const uint8_t *)desc;
+    switch (desc->bDescriptorSubtype) {
+    case UAC_AC_INPUT_TERMINAL: {
+        const uac2_ac_input_terminal_desc_t *input_terminal_desc = (const uac2_ac_input_terminal_desc_t *)desc;
+        parsed.id = input_terminal_desc->bTerminalID;
+        // UAC 1.0 input terminal is shorter and has no clock
+        parsed.clock_id = (desc->bLength >= sizeof(uac2_ac_input_terminal_desc_t)) ? input_terminal_desc->bCSourceID : 0;
+        break;
     }
-    uac_ac_header_desc_t *header_desc = (uac_ac_header_desc_t *)desc;
-    const size_t total_length = header_desc->wTotalLength;
+    case UAC_AC_OUTPUT_TERMINAL: {
+        const uac2_ac_output_terminal_desc_t *output_terminal_desc = (const uac2_ac_output_terminal_desc_t *)desc;
+        parsed.id = output_terminal_desc->bTerminalID;
+        parsed.source_num = 1;
+        parsed.source_id = &output_terminal_desc->bSourceID;
+        parsed.clock_id = (desc->bLength >= sizeof(uac2_ac_output_terminal_desc_t)) ? output_terminal_desc->bCSourceID : 0;
+        break;
+    }
+    case UAC_AC_FEATURE_UNIT: {
+        const uac_ac_feature_unit_desc_t *feature_unit_desc = (const uac_ac_feature_unit_desc_t *)desc;
+        parsed.id = feature_unit_desc->bUnitID;
+        parsed.source_num = 1;
+        parsed.source_id = &feature_unit_desc->bSourceID;
+        break;
+    }
+    case UAC_AC_MIXER_UNIT:
+    case UAC_AC_SELECTOR_UNIT:
+    case UAC2_AC_CLOCK_SELECTOR: {
+        // ID, number of pins and the source IDs are at the same offsets in these descriptors
+        const uac_ac_selector_unit_desc_t *selector_unit_desc = (const uac_ac_selector_unit_desc_t *)desc;
+        parsed.id = selector_unit_desc->bUnitID;
+        parsed.source_num = MIN(selector_unit_desc->bNrInPins, desc->bLength - offsetof(uac_ac_selector_unit_desc_t, baSourceID));
+        parsed.source_id = &raw[offsetof(uac_ac_selector_unit_desc_t, baSourceID)];
+        break;
+    }
+    case UAC2_AC_CLOCK_SOURCE:
+        parsed.id = ((const uac2_ac_clock_source_desc_t *)desc)->bClockID;
+        break;
+    case UAC2_AC_CLOCK_MULTIPLIER: {
+        const uac2_ac_clock_multiplier_desc_t *multiplier_desc = (const uac2_ac_clock_multiplier_desc_t *)desc;
+        parsed.id = multiplier_desc->bClockID;
+        parsed.source_num = 1;
+        parsed.source_id = &multiplier_desc->bCSourceID;
+        break;
+    }
+    default:
+        ESP_LOGD(TAG, "UAC Unknown Descriptor Subtype %d", desc->bDescriptorSubtype);
+        return false;
+    }
+    if (entity) {
+        *entity = parsed;
+    }
+    return true;
+}
+
+/**
+ * @brief Index terminals, units and clock entities of the Class-Specific Audio Control descriptors
+ *
+ * The lookups of the linked units and clock sources use the index, the descriptors are walked only once.
+ *
+ * @param[in] uac_device    Pointer to UAC device structure, with cs_ac_desc
+ * @return esp_err_t
+ */
+static esp_err_t _uac_ac_entities_build(uac_device_t *uac_device)
+{
+    const size_t total_length = _uac_ac_desc_total_length(uac_device->cs_ac_desc);
+    size_t count = 0;
     int uac_desc_offset = 0;
-    const uac_desc_header_t *uac_cs_desc = (const uac_desc_header_t *)header_desc;
+    const uac_desc_header_t *uac_cs_desc = (const uac_desc_header_t *)uac_device->cs_ac_desc;
     while (uac_cs_desc) {
-        switch (uac_cs_desc->bDescriptorSubtype) {
-        case UAC_AC_HEADER:
-        case UAC_AC_INPUT_TERMINAL:
-            break;
-        case UAC_AC_OUTPUT_TERMINAL: {
-            const uac_ac_output_terminal_desc_t *output_terminal_desc = (const uac_ac_output_terminal_desc_t *)uac_cs_desc;
-            if (output_terminal_desc->bSourceID == unit_id) {
-                return output_terminal_desc->bTerminalID;
-            }
-            break;
-        }
-        case UAC_AC_FEATURE_UNIT: {
-            const uac_ac_feature_unit_desc_t *feature_unit_desc = (const uac_ac_feature_unit_desc_t *)uac_cs_desc;
-            if (feature_unit_desc->bSourceID == unit_id) {
-                *feat_desc = (uint8_t *)feature_unit_desc;
-                return feature_unit_desc->bUnitID;
-            }
-            break;
+        count += _uac_ac_entity_parse(uac_cs_desc, NULL);
+        uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
+    }
+    // IDs are 8-bit and unique in the interface
+    count = MIN(count, UINT8_MAX);
+    if (count == 0) {
+        return ESP_OK;
+    }
+    uac_device->entities = calloc(count, sizeof(uac_ac_entity_t));
+    UAC_RETURN_ON_FALSE(uac_device->entities, ESP_ERR_NO_MEM, "Unable to allocate memory for UAC topology");
+
+    uac_desc_offset = 0;
+    uac_cs_desc = (const uac_desc_header_t *)uac_device->cs_ac_desc;
+    while (uac_cs_desc && uac_device->entity_num < count) {
+        if (_uac_ac_entity_parse(uac_cs_desc, &uac_device->entities[uac_device->entity_num])) {
+            uac_device->entity_num++;
         }
-        case UAC_AC_SELECTOR_UNIT: {
-            const uac_ac_selector_unit_desc_t *selector_unit_desc = (const uac_ac_selector_unit_desc_t *)uac_cs_desc;
-            for (int i = 0; i < selector_unit_desc->bNrInPins; i++) {
-                if (selector_unit_desc->baSourceID[i] == unit_id) {
-                    return selector_unit_desc->bUnitID;
-                }
-            }
-            break;
+        uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
+    }
+    ESP_LOGD(TAG, "UAC topology of %d entities", uac_device->entity_num);
+    return ESP_OK;
+}
+
+/**
+ * @brief Check that the entity is a terminal or unit of the audio path, not a clock entity
+ */
+static inline bool _uac_ac_entity_is_audio(const uac_ac_entity_t *entity)
+{
+    return entity->subtype >= UAC_AC_INPUT_TERMINAL && entity->subtype <= UAC_AC_FEATURE_UNIT;
+}
+
+static uint8_t _uac_next_linked_uint_id(const uac_device_t *uac_device, uint8_t unit_id, uint8_t **feat_desc)
+{
+    *feat_desc = NULL;
+    for (int i = 0; i < uac_device->entity_num; i++) {
+        const uac_ac_entity_t *entity = &uac_device->entities[i];
+        if (!_uac_ac_entity_is_audio(entity)) {
+            continue;
         }
-        case UAC_AC_MIXER_UNIT: {
-            const uac_ac_mixer_unit_desc_t *mixer_unit_desc = (const uac_ac_mixer_unit_desc_t *)uac_cs_desc;
-            for (int i = 0; i < mixer_unit_desc->bNrInPins; i++) {
-                if (mixer_unit_desc->baSourceID[i] == unit_id) {
-                    return mixer_unit_desc->bUnitID;
+        for (int pin = 0; pin < entity->source_num; pin++) {
+            if (entity->source_id[pin] == unit_id) {
+                if (entity->subtype == UAC_AC_FEATURE_UNIT) {
+                    *feat_desc = (uint8_t *)entity->desc;
                 }
+                return entity->id;
             }
-            break;
-        }
-        default:
-            ESP_LOGD(TAG, "UAC Unknown Descriptor Subtype %d", uac_cs_desc->bDescriptorSubtype);
-            break;
         }
-        uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
     }
     return 0;
 }
 
-static uint8_t _uac_last_linked_uint_id(const uint8_t *desc, uint8_t unit_id, uint8_t **feat_desc)
+static uint8_t _uac_last_linked_uint_id(const uac_device_t *uac_device, uint8_t unit_id, uint8_t **feat_desc)
 {
     *feat_desc = NULL;
-    if (!desc) {
-        return 0;
-    }
-    uac_ac_header_desc_t *header_desc = (uac_ac_header_desc_t *)desc;
-    const size_t total_length = header_desc->wTotalLength;
-    int uac_desc_offset = 0;
-    const uac_desc_header_t *uac_cs_desc = (const uac_desc_header_t *)header_desc;
-    while (uac_cs_desc) {
-        switch (uac_cs_desc->bDescriptorSubtype) {
-        case UAC_AC_HEADER:
-        case UAC_AC_INPUT_TERMINAL:
-            break;
-        case UAC_AC_OUTPUT_TERMINAL: {
-            const uac_ac_output_terminal_desc_t *output_terminal_desc = (const uac_ac_output_terminal_desc_t *)uac_cs_desc;
-            if (output_terminal_desc->bTerminalID == unit_id) {
-                return output_terminal_desc->bSourceID;
-            }
-            break;
-        }
-        case UAC_AC_FEATURE_UNIT: {
-            const uac_ac_feature_unit_desc_t *feature_unit_desc = (const uac_ac_feature_unit_desc_t *)uac_cs_desc;
-            if (feature_unit_desc->bUnitID == unit_id) {
-                *feat_desc = (uint8_t *)feature_unit_desc;
-                return feature_unit_desc->bSourceID;
-            }
-            break;
-        }
-        case UAC_AC_SELECTOR_UNIT: {
-            const uac_ac_selector_unit_desc_t *selector_unit_desc = (const uac_ac_selector_unit_desc_t *)uac_cs_desc;
-            if (selector_unit_desc->bUnitID == unit_id) {
-                // for basic audio device, the first source should be microphone
-                return selector_unit_desc->baSourceID[0];
-            }
-            break;
+    for (int i = 0; i < uac_device->entity_num; i++) {
+        const uac_ac_entity_t *entity = &uac_device->entities[i];
+        if (!_uac_ac_entity_is_audio(entity) || entity->id != unit_id) {
+            continue;
         }
-        case UAC_AC_MIXER_UNIT: {
-            const uac_ac_mixer_unit_desc_t *mixer_unit_desc = (const uac_ac_mixer_unit_desc_t *)uac_cs_desc;
-            if (mixer_unit_desc->bUnitID == unit_id) {
-                return mixer_unit_desc->baSourceID[0];
-            }
-            break;
+        if (entity->subtype == UAC_AC_FEATURE_UNIT) {
+            *feat_desc = (uint8_t *)entity->desc;
         }
-        default:
-            ESP_LOGD(TAG, "UAC Unknown Descriptor Subtype %d", uac_cs_desc->bDescriptorSubtype);
-            break;
-        }
-        uac_cs_desc = (uac_desc_header_t *)GET_NEXT_DESC(uac_cs_desc, total_length, uac_desc_offset);
+        // for basic audio device, the first source of selector or mixer should be microphone
+        return entity->source_num ? entity->source_id[0] : 0;
     }
     return 0;
 }
 
-static uac_ac_feature_unit_desc_t *_uac_host_device_find_feature_unit(const uint8_t *header_desc, uint8_t terminal_id, bool if_input)
+static uac_ac_feature_unit_desc_t *_uac_host_device_find_feature_unit(const uac_device_t *uac_device, uint8_t terminal_id, bool if_input)
 {
-    if (!header_desc) {
-        return NULL;
-    }
-
     uint8_t unit_id = terminal_id;
     uac_ac_feature_unit_desc_t *feature_unit_desc = NULL;
-    if (if_input) {
-        while (feature_unit_desc == NULL && unit_id != 0) {
-            unit_id = _uac_next_linked_uint_id(header_desc, unit_id, (uint8_t **)&feature_unit_desc);
+    // every step moves one entity along the audio path, the number of steps is limited by the number of entities
+    for (int step = 0; step < uac_device->entity_num && feature_unit_desc == NULL && unit_id != 0; step++) {
+        if (if_input) {
+            unit_id = _uac_next_linked_uint_id(uac_device, unit_id, (uint8_t **)&feature_unit_desc);
             ESP_LOGD(TAG, "Input Terminal next linked unit ID %d", unit_id);
-        }
-    } else {
-        while (feature_unit_desc == NULL && unit_id != 0) {
-            unit_id = _uac_last_linked_uint_id(header_desc, unit_id, (uint8_t **)&feature_unit_desc);
+        } else {
+            unit_id = _uac_last_linked_uint_id(uac_device, unit_id, (uint8_t **)&feature_unit_desc);
             ESP_LOGD(TAG, "Output Terminal last linked unit ID %d", unit_id);
         }
     }
@@ -684,20 +1154,164 @@ static uac_ac_feature_unit_desc_t *_uac_host_device_find_feature_unit(const uint
     return feature_unit_desc;
 }
 
+/**
+ * @brief Find UAC 2.0 clock source of the terminal linked to the audio stream
+ *
+ * Clock selectors are followed through their first input pin, which is selected after power up.
+ * Clock multipliers are followed through their clock source.
+ *
+ * @param[in] uac_device    Pointer to UAC device structure
+ * @param[in] terminal_id   Terminal ID linked to the audio stream
+ * @return Pointer to the clock source descriptor, NULL if not found
+ */
+static const uac2_ac_clock_source_desc_t *_uac2_host_device_find_clock_source(const uac_device_t *uac_device, uint8_t terminal_id)
+{
+    uint8_t clock_id = 0;
+    for (int i = 0; i < uac_device->entity_num && !clock_id; i++) {
+        const uac_ac_entity_t *entity = &uac_device->entities[i];
+        if ((entity->subtype == UAC_AC_INPUT_TERMINAL || entity->subtype == UAC_AC_OUTPUT_TERMINAL) && entity->id == terminal_id) {
+            clock_id = entity->clock_id;
+        }
+    }
+
+    // every clock entity moves one step towards the clock source, the number of steps is limited by the number of entities
+    for (int step = 0; step < uac_device->entity_num && clock_id; step++) {
+        const uint8_t entity_id = clock_id;
+        clock_id = 0;
+        for (int i = 0; i < uac_device->entity_num; i++) {
+            const uac_ac_entity_t *entity = &uac_device->entities[i];
+            if (entity->subtype < UAC2_AC_CLOCK_SOURCE || entity->subtype > UAC2_AC_CLOCK_MULTIPLIER || entity->id != entity_id) {
+                continue;
+            }
+            if (entity->subtype == UAC2_AC_CLOCK_SOURCE) {
+                return (const uac2_ac_clock_source_desc_t *)entity->desc;
+            }
+            // selector through the first pin, multiplier through its source
+            clock_id = entity->source_num ? entity->source_id[0] : 0;
+            break;
+        }
+    }
+    return NULL;
+}
+
 /**
  * @brief Add a new logical device/interface to the UAC driver
  * @param[in] iface_num     Interface number
  * @param[out] p_uac_iface  Pointer to the UAC interface handle
  * @return esp_err_t
  */
-static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_num, uac_iface_t **p_uac_iface)
+/**
+ * @brief Take parameters of a closed interface of the device from the reconnect cache
+ *
+ * @param[in]  uac_device   Pointer to UAC device structure
+ * @param[in]  iface_num    Interface number
+ * @param[out] entry        Cache entry moved out of the cache, the caller owns entry->iface_alt
+ * @return true if the interface was found in the cache
+ */
+static bool uac_host_cache_take(uac_device_t *uac_device, uint8_t iface_num, uac_iface_cache_t *entry)
+{
+    if (CONFIG_UAC_RECONNECT_CACHE_NUM == 0) {
+        return false;
+    }
+    const usb_device_desc_t *desc;
+    const usb_config_desc_t *config_desc;
+    usb_device_info_t dev_info;
+    if (usb_host_get_device_descriptor(uac_device->dev_hdl, &desc) != ESP_OK ||
+            usb_host_get_active_config_descriptor(uac_device->dev_hdl, &config_desc) != ESP_OK ||
+            usb_host_device_info(uac_device->dev_hdl, &dev_info) != ESP_OK) {
+        return false;
+    }
+    wchar_t serial[UAC_STR_DESC_MAX_LENGTH];
+    uac_host_string_descriptor_copy(serial, dev_info.str_desc_serial_num);
+
+    bool found = false;
+    UAC_ENTER_CRITICAL();
+    for (int i = 0; i < CONFIG_UAC_RECONNECT_CACHE_NUM; i++) {
+        uac_iface_cache_t *e = &s_uac_driver->cache[i];
+        if (e->used && e->vid == desc->idVendor && e->pid == desc->idProduct && e->config_len == config_desc->wTotalLength &&
+                e->iface_num == iface_num && wcsncmp(e->serial, serial, UAC_STR_DESC_MAX_LENGTH) == 0) {
+            *entry = *e;
+            e->used = false;
+            e->iface_alt = NULL;
+            found = true;
+            break;
+        }
+    }
+    UAC_EXIT_CRITICAL();
+    if (found) {
+        ESP_LOGD(TAG, "Interface %d of %04X:%04X restored from cache", iface_num, entry->vid, entry->pid);
+    }
+    return found;
+}
+
+/**
+ * @brief Move parameters of a closed interface into the reconnect cache, the oldest entry is replaced if it is full
+ *
+ * @param[in] iface       Pointer to Interface structure, its alternate settings are moved into the cache
+ */
+static void uac_host_cache_put(uac_iface_t *iface)
+{
+    if (CONFIG_UAC_RECONNECT_CACHE_NUM == 0 || !iface->iface_alt) {
+        return;
+    }
+    const uac_iface_cache_t entry = {
+        .used = true,
+        .vid = iface->dev_info.VID,
+        .pid = iface->dev_info.PID,
+        .config_len = iface->config_len,
+        .iface_num = iface->dev_info.iface_num,
+        .type = iface->dev_info.type,
+        .iface_alt_num = iface->dev_info.iface_alt_num,
+        .iface_alt = iface->iface_alt,
+        .vol_range_valid = iface->vol_range_valid,
+        .vol_min_db = iface->vol_min_db,
+        .vol_max_db = iface->vol_max_db,
+        .vol_res_db = iface->vol_res_db,
+        .session_valid = iface->gone,
+        .session = iface->session,
+    };
+    iface->iface_alt = NULL;
+
+    uac_iface_alt_t *replaced = NULL;
+    UAC_ENTER_CRITICAL();
+    uac_iface_cache_t *slot = NULL;
+    for (int i = 0; i < CONFIG_UAC_RECONNECT_CACHE_NUM; i++) {
+        uac_iface_cache_t *e = &s_uac_driver->cache[i];
+        if (!e->used) {
+            slot = e;
+            break;
+        }
+        if (!slot || (int32_t)(e->age - slot->age) < 0) {
+            slot = e;
+        }
+    }
+    replaced = slot->used ? slot->iface_alt : NULL;
+    *slot = entry;
+    memcpy(slot->serial, iface->dev_info.iSerialNumber, sizeof(slot->serial));
+    slot->age = ++s_uac_driver->cache_age;
+    UAC_EXIT_CRITICAL();
+    free(replaced);
+}
+
+static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_num, const uac_iface_cache_t *cached,
+                                        uac_iface_t **p_uac_iface)
 {
     esp_err_t ret;
     *p_uac_iface = NULL;
     uac_iface_t *uac_iface = calloc(1, sizeof(uac_iface_t));
+    if (!uac_iface && cached) {
+        free(cached->iface_alt);
+    }
     UAC_RETURN_ON_FALSE(uac_iface, ESP_ERR_NO_MEM, "Unable to allocate memory");
+    if (cached) {
+        // the interface takes the alternate settings of the cache, they are freed on failure below
+        uac_iface->iface_alt = cached->iface_alt;
+    }
+    portMUX_INITIALIZE(&uac_iface->lock);
     uac_iface->state_mutex = xSemaphoreCreateMutex();
     UAC_GOTO_ON_FALSE(uac_iface->state_mutex, ESP_ERR_NO_MEM, "Unable to create state mutex");
+    uac_iface->xfer_returned = xSemaphoreCreateBinary();
+    UAC_GOTO_ON_FALSE(uac_iface->xfer_returned, ESP_ERR_NO_MEM, "Unable to create transfer semaphore");
     const usb_config_desc_t *config_desc = NULL;
     const usb_intf_desc_t *iface_desc = NULL;
     const usb_intf_desc_t *iface_alt_desc = NULL;
@@ -707,11 +1321,20 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
     usb_host_get_active_config_descriptor(uac_device->dev_hdl, &config_desc);
     UAC_GOTO_ON_FALSE(config_desc, ESP_ERR_INVALID_STATE, "No active configuration descriptor");
     const size_t total_length = config_desc->wTotalLength;
+    uac_iface->config_len = config_desc->wTotalLength;
     int iface_alt_offset = 0;
     int iface_alt_idx = 0;
 
     iface_desc = usb_parse_interface_descriptor(config_desc, iface_num, 0, &iface_alt_offset);
-    iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_alt_offset);
+    UAC_GOTO_ON_FALSE(iface_desc, ESP_ERR_NOT_FOUND, "Interface not found");
+    if (cached) {
+        // the same device was parsed before it was reconnected
+        uac_iface->dev_info.type = cached->type;
+        iface_alt_idx = cached->iface_alt_num;
+        iface_alt_desc = NULL;
+    } else {
+        iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_alt_offset);
+    }
     // For every alternate setting
     while (iface_alt_desc != NULL) {
         // Check if the alternate setting is for the same interface
@@ -735,7 +1358,33 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
             switch (cs_desc->bDescriptorType) {
             case UAC_CS_INTERFACE: {
                 const uac_desc_header_t *uac_desc = (const uac_desc_header_t *)cs_desc;
-                if (uac_desc->bDescriptorSubtype == UAC_AS_GENERAL) {
+                if (uac_device->uac_version == UAC_VERSION_2 && uac_desc->bDescriptorSubtype == UAC_AS_GENERAL) {
+                    // channels are given by the AS interface, sampling frequencies by the clock source of the terminal
+                    const uac2_as_general_desc_t *as_general_desc = (const uac2_as_general_desc_t *)uac_desc;
+                    iface_alt->dev_alt_param.format = (as_general_desc->bmFormats & UAC2_FORMAT_PCM) ? UAC_TYPE_I_PCM : 0;
+                    iface_alt->dev_alt_param.channels = as_general_desc->bNrChannels;
+                    iface_alt->connected_terminal = as_general_desc->bTerminalLink;
+                    const uac2_ac_clock_source_desc_t *clock_desc = _uac2_host_device_find_clock_source(uac_device,
+                            as_general_desc->bTerminalLink);
+                    if (clock_desc) {
+                        iface_alt->clock_id = clock_desc->bClockID;
+                        iface_alt->freq_ctrl_supported = (clock_desc->bmControls & 0x03) == UAC2_CONTROL_PROGRAMMABLE;
+                        ESP_LOGD(TAG, "UAC Clock Source ID %d, Frequency Control %d", clock_desc->bClockID, iface_alt->freq_ctrl_supported);
+                    } else {
+                        ESP_LOGW(TAG, "UAC Interface %d->%d, no clock source of terminal %d", iface_desc->bInterfaceNumber, iface_alt->alt_idx,
+                                 as_general_desc->bTerminalLink);
+                    }
+                } else if (uac_device->uac_version == UAC_VERSION_2 && uac_desc->bDescriptorSubtype == UAC_AS_FORMAT_TYPE) {
+                    const uac2_as_type_I_format_desc_t *as_format_type_desc = (const uac2_as_type_I_format_desc_t *)uac_desc;
+                    if (as_format_type_desc->bFormatType != UAC_FORMAT_TYPE_I) {
+                        ESP_LOGE(TAG, "UAC Format Type %d", as_format_type_desc->bFormatType);
+                        UAC_GOTO_ON_FALSE(0, ESP_ERR_NOT_SUPPORTED, "UAC Format Type not supported");
+                    }
+                    // the data are sized by the subslot, e.g. 24-bit samples in 4-byte subslots are streamed as 32-bit
+                    iface_alt->dev_alt_param.bit_resolution = as_format_type_desc->bSubslotSize * 8;
+                    ESP_LOGD(TAG, "UAC AS Format Type %d, Subslot Size %d, Bit Resolution %d", as_format_type_desc->bFormatType,
+                             as_format_type_desc->bSubslotSize, as_format_type_desc->bBitResolution);
+                } else if (uac_desc->bDescriptorSubtype == UAC_AS_GENERAL) {
                     const uac_as_general_desc_t *as_general_desc = (const uac_as_general_desc_t *)uac_desc;
                     iface_alt->dev_alt_param.format = as_general_desc->wFormatTag;
                     iface_alt->connected_terminal = as_general_desc->bTerminalLink;
@@ -767,14 +1416,37 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
             }
             case USB_B_DESCRIPTOR_TYPE_ENDPOINT: {
                 ep_desc = (const usb_ep_desc_t *)cs_desc;
+                if (iface_alt->ep_addr) {
+                    // The second endpoint is explicit feedback endpoint of asynchronous OUT stream
+                    if ((ep_desc->bEndpointAddress & UAC_EP_DIR_IN) && !(iface_alt->ep_addr & UAC_EP_DIR_IN)) {
+                        iface_alt->fb_ep_addr = ep_desc->bEndpointAddress;
+                        iface_alt->fb_ep_mps = ep_desc->wMaxPacketSize;
+                        ESP_LOGD(TAG, "UAC Feedback Endpoint 0x%02X, Max Packet Size %d", ep_desc->bEndpointAddress, ep_desc->wMaxPacketSize);
+                    }
+                    break;
+                }
                 iface_alt->ep_addr = ep_desc->bEndpointAddress;
-                iface_alt->ep_mps = ep_desc->wMaxPacketSize;
+                iface_alt->ep_mps = USB_EP_DESC_GET_MPS(ep_desc);
                 iface_alt->ep_attr = ep_desc->bmAttributes;
                 iface_alt->interval = ep_desc->bInterval;
                 uac_iface->dev_info.type = (ep_desc->bEndpointAddress & UAC_EP_DIR_IN) ? UAC_STREAM_RX : UAC_STREAM_TX;
-                uac_ac_feature_unit_desc_t *feature_unit_desc = _uac_host_device_find_feature_unit((uint8_t *)uac_device->cs_ac_desc,
+                uac_ac_feature_unit_desc_t *feature_unit_desc = _uac_host_device_find_feature_unit(uac_device,
                         iface_alt->connected_terminal, !(ep_desc->bEndpointAddress & UAC_EP_DIR_IN));
-                if (feature_unit_desc) {
+                if (feature_unit_desc && uac_device->uac_version == UAC_VERSION_2) {
+                    // UAC 2.0 controls of each channel take 4 bytes, the control is usable if host programmable
+                    iface_alt->feature_unit = feature_unit_desc->bUnitID;
+                    const uint8_t *bma_controls = (const uint8_t *)feature_unit_desc + offsetof(uac2_ac_feature_unit_desc_t, bmaControls);
+                    for (size_t i = 0; i < (feature_unit_desc->bLength - 6) / 4 && i < 8; i++) {
+                        if (((bma_controls[i * 4] >> 2) & 0x03) == UAC2_CONTROL_PROGRAMMABLE) {
+                            iface_alt->vol_ch_map |= (1 << i);
+                        }
+                        if ((bma_controls[i * 4] & 0x03) == UAC2_CONTROL_PROGRAMMABLE) {
+                            iface_alt->mute_ch_map |= (1 << i);
+                        }
+                    }
+                    ESP_LOGD(TAG, "UAC %s Feature Unit ID %d, Volume Ch Map %02X, Mute Ch Map %02X", uac_iface->dev_info.type == UAC_STREAM_RX ? "RX" : "TX",
+                             feature_unit_desc->bUnitID, iface_alt->vol_ch_map, iface_alt->mute_ch_map);
+                } else if (feature_unit_desc) {
                     iface_alt->feature_unit = feature_unit_desc->bUnitID;
                     uint8_t ch_num = 0;
                     for (size_t i = 0; i < (feature_unit_desc->bLength - 7) / feature_unit_desc->bControlSize; i++) {
@@ -795,14 +1467,18 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
             case UAC_CS_ENDPOINT: {
                 // we has got enough information to fill the uac_iface_alt_t, so we can break
                 const uac_as_cs_ep_desc_t *cs_ep_desc = (const uac_as_cs_ep_desc_t *)cs_desc;
-                if (cs_ep_desc->bDescriptorSubtype == UAC_EP_GENERAL) {
+                // UAC 2.0 sampling frequency is controlled by the clock source
+                if (cs_ep_desc->bDescriptorSubtype == UAC_EP_GENERAL && uac_device->uac_version != UAC_VERSION_2) {
                     iface_alt->freq_ctrl_supported = cs_ep_desc->bmAttributes & UAC_SAMPLING_FREQ_CONTROL;
-                    parse_continue = false;
                     ESP_LOGD(TAG, "UAC EP General, Attributes 0x%02X", cs_ep_desc->bmAttributes);
                     ESP_LOGD(TAG, "UAC EP Frequency Control %d", iface_alt->freq_ctrl_supported);
                 }
                 break;
             }
+            case USB_B_DESCRIPTOR_TYPE_INTERFACE:
+                // feedback endpoint follows the class specific endpoint, parse until the next interface
+                parse_continue = false;
+                break;
             default:
                 break;
             }
@@ -831,18 +1507,18 @@ static esp_err_t uac_host_interface_add(uac_device_t *uac_device, uint8_t iface_
     uac_host_string_descriptor_copy(uac_iface->dev_info.iProduct, dev_info.str_desc_product);
     uac_host_string_descriptor_copy(uac_iface->dev_info.iSerialNumber, dev_info.str_desc_serial_num);
 
+    UAC_GOTO_ON_ERROR(uac_iface_register(uac_iface), "Unable to register interface");
     *p_uac_iface = uac_iface;
 
-    UAC_ENTER_CRITICAL();
-    STAILQ_INSERT_TAIL(&s_uac_driver->uac_ifaces_tailq, uac_iface, tailq_entry);
-    UAC_EXIT_CRITICAL();
-
     return ESP_OK;
 
 fail:
     if (uac_iface && uac_iface->state_mutex) {
         vSemaphoreDelete(uac_iface->state_mutex);
     }
+    if (uac_iface && uac_iface->xfer_returned) {
+        vSemaphoreDelete(uac_iface->xfer_returned);
+    }
     free(uac_iface->iface_alt);
     free(uac_iface);
     return ret;
@@ -858,10 +1534,9 @@ fail:
 static esp_err_t uac_host_interface_delete(uac_iface_t *uac_iface)
 {
     uac_iface->state = UAC_INTERFACE_STATE_NOT_INITIALIZED;
-    UAC_ENTER_CRITICAL();
-    STAILQ_REMOVE(&s_uac_driver->uac_ifaces_tailq, uac_iface, uac_interface, tailq_entry);
-    UAC_EXIT_CRITICAL();
+    uac_iface_unregister(uac_iface);
     vSemaphoreDelete(uac_iface->state_mutex);
+    vSemaphoreDelete(uac_iface->xfer_returned);
     free(uac_iface->iface_alt);
     free(uac_iface);
     return ESP_OK;
@@ -870,6 +1545,8 @@ static esp_err_t uac_host_interface_delete(uac_iface_t *uac_iface)
 /**
  * @brief Check every interface in the USB device, notify user about connected interfaces/logic devices
  *
+ * The configuration descriptor is walked once, devices of other classes are rejected by the same walk.
+ *
  * @param[in] addr         USB device address
  * @param[in] config_desc  Pointer to Configuration Descriptor
  * @return esp_err_t
@@ -889,8 +1566,12 @@ static esp_err_t uac_host_interface_check(uint8_t addr, const usb_config_desc_t
     // Check every uac stream interface
     while (iface_desc != NULL) {
         if (iface_desc->bInterfaceClass == USB_CLASS_AUDIO && iface_desc->bInterfaceSubClass == UAC_SUBCLASS_AUDIOSTREAMING) {
-            // notify user about the connected Interfaces
-            is_uac_interface = true;
+            if (!is_uac_interface) {
+#ifdef CONFIG_PRINTF_UAC_CONFIGURATION_DESCRIPTOR
+                print_uac_descriptors(config_desc);
+#endif
+                is_uac_interface = true;
+            }
             const usb_intf_desc_t *iface_alt_desc = GET_NEXT_INTERFACE_DESC(iface_desc, total_length, iface_offset);
             int ep_offset = iface_offset;
             const usb_ep_desc_t *ep_desc = usb_parse_endpoint_descriptor_by_index(iface_alt_desc, 0, total_length, &ep_offset);
@@ -931,22 +1612,38 @@ static esp_err_t _uac_host_device_connected(uint8_t addr)
     bool is_uac_device = false;
     usb_device_handle_t dev_hdl;
     const usb_config_desc_t *config_desc = NULL;
+    uac_dev_id_t dev_id = {0};
 
     if (usb_host_device_open(s_uac_driver->client_handle, addr, &dev_hdl) == ESP_OK) {
-        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK) {
-            is_uac_device = uac_interface_present(config_desc);
+        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) != ESP_OK) {
+            config_desc = NULL;
+        }
+        const usb_device_desc_t *dev_desc;
+        if (usb_host_get_device_descriptor(dev_hdl, &dev_desc) == ESP_OK) {
+            dev_id.vid = dev_desc->idVendor;
+            dev_id.pid = dev_desc->idProduct;
         }
         UAC_RETURN_ON_ERROR(usb_host_device_close(s_uac_driver->client_handle, dev_hdl), "Unable to close USB device");
     }
 
-    // Create UAC interfaces list in RAM, connected to the particular USB dev
+    // Notify user about the stream interfaces, which can be claimed by opening them
+    if (config_desc) {
+        UAC_ENUM_MARK(addr, "class_check");
+        is_uac_device = (uac_host_interface_check(addr, config_desc) == ESP_OK);
+    }
     if (is_uac_device) {
-#ifdef CONFIG_PRINTF_UAC_CONFIGURATION_DESCRIPTOR
-        print_uac_descriptors(config_desc);
-#endif
-        // Create Interfaces list for a possibility to claim Interface
-        UAC_RETURN_ON_ERROR(uac_host_interface_check(addr, config_desc), "uac stream interface not found");
+        UAC_ENUM_MARK(addr, "connected");
     } else {
+        dev_id.vid = 0;
+        dev_id.pid = 0;
+    }
+    // A device of other class at the address replaces a removed UAC device, which was not opened
+    if (addr < UAC_DEV_ADDR_NUM) {
+        UAC_ENTER_CRITICAL();
+        s_uac_driver->connected[addr] = dev_id;
+        UAC_EXIT_CRITICAL();
+    }
+    if (!is_uac_device) {
         ESP_LOGW(TAG, "USB device with addr(%d) is not UAC device", addr);
     }
 
@@ -993,11 +1690,14 @@ static esp_err_t _uac_host_device_disconnected(usb_device_handle_t dev_hdl)
     assert(uac_device);
 
     UAC_ENTER_CRITICAL();
+    s_uac_driver->connected[uac_device->addr].vid = 0;
+    s_uac_driver->connected[uac_device->addr].pid = 0;
     while (!STAILQ_EMPTY(&s_uac_driver->uac_ifaces_tailq)) {
         uac_iface = STAILQ_FIRST(&s_uac_driver->uac_ifaces_tailq);
         UAC_EXIT_CRITICAL();
         if (uac_iface->parent && (uac_iface->parent->addr == uac_device->addr)) {
             uac_iface->flags |= FLAG_INTERFACE_WAIT_USER_DELETE;
+            uac_iface->gone = true;
             UAC_RETURN_ON_ERROR(uac_host_device_close(uac_iface), "Unable to close device");
             UAC_RETURN_ON_ERROR(uac_host_interface_shutdown(uac_iface), "Unable to shutdown interface");
         }
@@ -1017,12 +1717,51 @@ static esp_err_t _uac_host_device_disconnected(usb_device_handle_t dev_hdl)
 static void client_event_cb(const usb_host_client_event_msg_t *event, void *arg)
 {
     if (event->event == USB_HOST_CLIENT_EVENT_NEW_DEV) {
+        UAC_ENUM_MARK(event->new_dev.address, "new_dev");
         _uac_host_device_connected(event->new_dev.address);
     } else if (event->event == USB_HOST_CLIENT_EVENT_DEV_GONE) {
         _uac_host_device_disconnected(event->dev_gone.dev_hdl);
     }
 }
 
+/**
+ * @brief Remove encoder of RX stream and restore the buffer threshold of the device configuration
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void uac_host_interface_encoder_remove(uac_iface_t *iface)
+{
+    if (!iface->enc_buf) {
+        return;
+    }
+    // the reader holds the consumer lock while encoding
+    xSemaphoreTake(iface->ringbuf->consumer_lock, portMAX_DELAY);
+    free(iface->enc_buf);
+    iface->enc_buf = NULL;
+    memset(&iface->encoder, 0, sizeof(iface->encoder));
+    iface->ringbuf_threshold = iface->enc_saved_threshold;
+    xSemaphoreGive(iface->ringbuf->consumer_lock);
+}
+
+/**
+ * @brief Set or remove RX level meter, it is applied by the next RX transfer callback
+ *
+ * @param[in] iface    Pointer to Interface structure
+ * @param[in] config   Meter configuration, NULL to remove the meter
+ */
+static void uac_host_interface_meter_set(uac_iface_t *iface, const uac_host_meter_config_t *config)
+{
+    UAC_IFACE_ENTER_CRITICAL(iface);
+    if (config) {
+        iface->meter_config = *config;
+    } else {
+        memset(&iface->meter_config, 0, sizeof(iface->meter_config));
+    }
+    memset(&iface->meter_level, 0, sizeof(iface->meter_level));
+    iface->meter_gen++;
+    UAC_IFACE_EXIT_CRITICAL(iface);
+}
+
 /**
  * @brief UAC Host release Interface and free transfers, change state to IDLE
  *
@@ -1040,7 +1779,7 @@ static esp_err_t uac_host_interface_release_and_free_transfer(uac_iface_t *iface
     if (iface->free_xfer_list) {
         for (int i = 0; i < iface->xfer_num; i++) {
             if (iface->free_xfer_list[i]) {
-                ESP_ERROR_CHECK(usb_host_transfer_free(iface->free_xfer_list[i]));
+                ESP_ERROR_CHECK(USB_HOST_XFER_POOL_FREE(iface->free_xfer_list[i]));
             }
         }
         free(iface->free_xfer_list);
@@ -1049,12 +1788,24 @@ static esp_err_t uac_host_interface_release_and_free_transfer(uac_iface_t *iface
     if (iface->xfer_list) {
         for (int i = 0; i < iface->xfer_num; i++) {
             if (iface->xfer_list[i]) {
-                ESP_ERROR_CHECK(usb_host_transfer_free(iface->xfer_list[i]));
+                ESP_ERROR_CHECK(USB_HOST_XFER_POOL_FREE(iface->xfer_list[i]));
             }
         }
         free(iface->xfer_list);
     }
 
+    if (iface->fb_xfer) {
+        ESP_ERROR_CHECK(USB_HOST_XFER_POOL_FREE(iface->fb_xfer));
+        iface->fb_xfer = NULL;
+    }
+
+    uac_src_delete(iface->src);
+    iface->src = NULL;
+    free(iface->src_buf);
+    iface->src_buf = NULL;
+    uac_host_interface_encoder_remove(iface);
+    uac_host_interface_meter_set(iface, NULL);
+
     // Change state
     iface->state = UAC_INTERFACE_STATE_IDLE;
     return ESP_OK;
@@ -1080,9 +1831,16 @@ static esp_err_t uac_host_interface_claim_and_prepare_transfer(uac_iface_t *ifac
     iface->free_xfer_list = calloc(iface->xfer_num, sizeof(usb_transfer_t *));
     UAC_GOTO_ON_FALSE(iface->free_xfer_list, ESP_ERR_NO_MEM, "Unable to allocate free transfer list");
     for (int i = 0; i < iface->xfer_num; i++) {
-        UAC_GOTO_ON_ERROR(usb_host_transfer_alloc(packet_size * iface->packet_num, iface->packet_num, &iface->free_xfer_list[i]),
+        UAC_GOTO_ON_ERROR(USB_HOST_XFER_POOL_ALLOC(packet_size * iface->packet_num, iface->packet_num, &iface->free_xfer_list[i]),
                           "Unable to allocate transfer buffer for EP IN");
     }
+    // asynchronous OUT stream: the device reports its rate by the feedback endpoint
+    const uac_iface_alt_t *iface_alt = &iface->iface_alt[iface->cur_alt];
+    if (iface->dev_info.type == UAC_STREAM_TX && iface_alt->fb_ep_addr &&
+            (iface_alt->ep_attr & UAC_EP_SYNC_TYPE_MASK) == UAC_EP_SYNC_TYPE_ASYNC) {
+        UAC_GOTO_ON_ERROR(USB_HOST_XFER_POOL_ALLOC(iface_alt->fb_ep_mps, 1, &iface->fb_xfer),
+                          "Unable to allocate transfer buffer for feedback EP");
+    }
     // Change state
     iface->state = UAC_INTERFACE_STATE_READY;
     return ESP_OK;
@@ -1092,6 +1850,133 @@ fail:
     return ret;
 }
 
+/**
+ * @brief Apply software volume and mute to the stream data, with FLAG_STREAM_SOFT_VOLUME
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[inout] data     Whole audio frames
+ * @param[in] len         Number of bytes
+ */
+static void uac_host_interface_apply_soft_gain(uac_iface_t *iface, uint8_t *data, size_t len)
+{
+    const uac_host_dev_alt_param_t *alt_param = &iface->iface_alt[iface->cur_alt].dev_alt_param;
+    uac_gain_apply(&iface->soft_gain, data, len / iface->frame_bytes, alt_param->channels, alt_param->bit_resolution / 8);
+}
+
+/**
+ * @brief Count RX data dropped by buffer overflow and notify user
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] len         Number of bytes dropped
+ */
+static void uac_host_interface_count_rx_overflow(uac_iface_t *iface, size_t len)
+{
+    UAC_IFACE_ENTER_CRITICAL(iface);
+    iface->stats.rx_overflows++;
+    iface->stats.rx_dropped_bytes += len;
+    UAC_IFACE_EXIT_CRITICAL(iface);
+    if (iface->flags & FLAG_STREAM_XRUN_EVENTS) {
+        uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_RX_OVERFLOW);
+    }
+}
+
+/**
+ * @brief Measure RX data by the level meter, if set
+ *
+ * @param[in] iface  Pointer to Interface structure
+ * @param[in] data   Received frames
+ * @param[in] len    Length of the frames in bytes
+ * @return UAC_METER_WINDOW_DONE and UAC_METER_VAD_CHANGED bits
+ */
+static uint32_t uac_host_interface_apply_meter(uac_iface_t *iface, const uint8_t *data, size_t len)
+{
+    if (iface->meter_cur_gen != __atomic_load_n(&iface->meter_gen, __ATOMIC_RELAXED)) {
+        UAC_IFACE_ENTER_CRITICAL(iface);
+        const uac_host_meter_config_t config = iface->meter_config;
+        iface->meter_cur_gen = iface->meter_gen;
+        UAC_IFACE_EXIT_CRITICAL(iface);
+        const uac_host_dev_alt_param_t *alt_param = &iface->iface_alt[iface->cur_alt].dev_alt_param;
+        uac_meter_init(&iface->meter, config.window_frames ? &config : NULL, alt_param->channels, alt_param->bit_resolution / 8);
+    }
+    if (!iface->meter.window_frames) {
+        return 0;
+    }
+    return uac_meter_process(&iface->meter, data, len / iface->frame_bytes);
+}
+
+/**
+ * @brief Count TX transfer without enough data and notify user about start of the underrun
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] silence_len Number of bytes of silence sent instead of the data
+ */
+static void uac_host_interface_count_tx_underrun(uac_iface_t *iface, size_t silence_len)
+{
+    UAC_IFACE_ENTER_CRITICAL(iface);
+    iface->stats.tx_underruns++;
+    iface->stats.tx_silence_bytes += silence_len;
+    UAC_IFACE_EXIT_CRITICAL(iface);
+    if (!iface->tx_underrun && (iface->flags & FLAG_STREAM_XRUN_EVENTS)) {
+        uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TX_UNDERFLOW);
+    }
+    iface->tx_underrun = true;
+}
+
+/**
+ * @brief Report buffer level to the user, by notification of the user task or by the callback
+ *
+ * The task is notified once when the level reaches the threshold, the next notification is armed
+ * when the level is back on the other side. The callback is invoked whenever the level is reached.
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] reached     Buffer level is at the threshold or beyond, full enough for RX, empty enough for TX
+ * @param[in] event       Callback event, UAC_HOST_DEVICE_EVENT_RX_DONE or UAC_HOST_DEVICE_EVENT_TX_DONE
+ */
+static void uac_host_interface_report_level(uac_iface_t *iface, bool reached, uac_host_device_event_t event)
+{
+    if (!iface->notify_task) {
+        if (reached) {
+            uac_host_user_interface_callback(iface, event);
+        }
+        return;
+    }
+    if (!reached) {
+        iface->notify_armed = true;
+    } else if (iface->notify_armed) {
+        iface->notify_armed = false;
+        xTaskNotify(iface->notify_task, iface->notify_bits, eSetBits);
+    }
+}
+
+/**
+ * @brief Count stream transfer returned, wake up the suspending task when the last one is back
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void uac_host_stream_xfer_returned(uac_iface_t *iface)
+{
+    if (__atomic_sub_fetch(&iface->xfer_inflight, 1, __ATOMIC_RELAXED) == 0 && iface->state != UAC_INTERFACE_STATE_ACTIVE) {
+        xSemaphoreGive(iface->xfer_returned);
+    }
+}
+
+/**
+ * @brief Submit stream transfer of the interface, counted until returned by its callback
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] xfer        Data or feedback transfer of the interface
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_stream_xfer_submit(uac_iface_t *iface, usb_transfer_t *xfer)
+{
+    __atomic_fetch_add(&iface->xfer_inflight, 1, __ATOMIC_RELAXED);
+    esp_err_t ret = usb_host_transfer_submit(xfer);
+    if (ret != ESP_OK) {
+        uac_host_stream_xfer_returned(iface);
+    }
+    return ret;
+}
+
 /**
  * @brief UAC IN Transfer complete callback
  *
@@ -1103,6 +1988,7 @@ static void stream_rx_xfer_done(usb_transfer_t *in_xfer)
 
     uac_iface_t *iface = in_xfer->context;
     assert(iface);
+    uac_host_stream_xfer_returned(iface);
 
     if (iface->state != UAC_INTERFACE_STATE_ACTIVE) {
         in_xfer->status = USB_TRANSFER_STATUS_CANCELED;
@@ -1111,41 +1997,96 @@ static void stream_rx_xfer_done(usb_transfer_t *in_xfer)
     switch (in_xfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED: {
 
-        // if ringbuffer will overflow, notify user to read data
-        size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len + in_xfer->actual_num_bytes >= iface->ringbuf_size) {
+        size_t rx_len = 0;
+        for (int i = 0; i < in_xfer->num_isoc_packets; i++) {
+            if (in_xfer->isoc_packet_desc[i].status == USB_TRANSFER_STATUS_COMPLETED) {
+                rx_len += in_xfer->isoc_packet_desc[i].actual_num_bytes;
+            }
+        }
+
+        if (iface->notify_task) {
+            // arm the notification if the reader has drained the buffer since the last transfer
+            uac_host_interface_report_level(iface, _ring_buffer_get_len(iface->ringbuf) >= iface->ringbuf_threshold,
+                                            UAC_HOST_DEVICE_EVENT_RX_DONE);
+        } else if (_ring_buffer_get_len(iface->ringbuf) + rx_len >= iface->ringbuf->size) {
+            // if ringbuffer will overflow, notify user to read data
             uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_RX_DONE);
         }
 
-        // if ringbuffer overflow (happens if user not read in above callback), the data will be dropped
-        data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len + in_xfer->actual_num_bytes > iface->ringbuf_size) {
-            ESP_LOGD(TAG, "RX Ringbuffer overflow");
-        } else {
-            // else push data to ringbuffer
-            for (int i = 0; i < in_xfer->num_isoc_packets; i++) {
-                if (in_xfer->isoc_packet_desc[i].status != USB_TRANSFER_STATUS_COMPLETED) {
-                    // copy data to ringbuffer
-                    ESP_LOGD(TAG, "Bad RX Isoc packet %d status %d", i, in_xfer->isoc_packet_desc[i].status);
-                    continue;
-                }
-                int requested_num_bytes = in_xfer->isoc_packet_desc[i].num_bytes;
-                int actual_num_bytes = in_xfer->isoc_packet_desc[i].actual_num_bytes;
-                // in UAC, the actual_num_bytes may less than requested_num_bytes
-                // eg. the packet_size is 64, but the endpoint size is 100
-                assert(requested_num_bytes >= actual_num_bytes);
-                // copy data to ringbuffer
-                _ring_buffer_push(iface->ringbuf, in_xfer->data_buffer + i * requested_num_bytes, actual_num_bytes, 0);
+        // if ringbuffer still overflows (happens if user not read in above callback), drop the oldest data,
+        // if the reader does not hold the buffer, or the packets which do not fit
+        size_t free_len = _ring_buffer_get_free(iface->ringbuf);
+        if (rx_len > free_len && (iface->flags & FLAG_STREAM_RX_DROP_OLDEST) &&
+                xSemaphoreTake(iface->ringbuf->consumer_lock, 0) == pdTRUE) {
+            // keep the buffer aligned to audio frames
+            size_t drop_len = rx_len - free_len;
+            drop_len += (iface->frame_bytes - drop_len % iface->frame_bytes) % iface->frame_bytes;
+            drop_len = MIN(drop_len, _ring_buffer_get_len(iface->ringbuf));
+            _ring_buffer_consume(iface->ringbuf, drop_len);
+            xSemaphoreGive(iface->ringbuf->consumer_lock);
+            uac_host_interface_count_rx_overflow(iface, drop_len);
+            free_len = _ring_buffer_get_free(iface->ringbuf);
+        }
+        size_t dropped_len = 0;
+        uint32_t meter_events = 0;
+        for (int i = 0; i < in_xfer->num_isoc_packets; i++) {
+            if (in_xfer->isoc_packet_desc[i].status != USB_TRANSFER_STATUS_COMPLETED) {
+                ESP_LOGD(TAG, "Bad RX Isoc packet %d status %d", i, in_xfer->isoc_packet_desc[i].status);
+                continue;
+            }
+            int requested_num_bytes = in_xfer->isoc_packet_desc[i].num_bytes;
+            int actual_num_bytes = in_xfer->isoc_packet_desc[i].actual_num_bytes;
+            // in UAC, the actual_num_bytes may less than requested_num_bytes
+            // eg. the packet_size is 64, but the endpoint size is 100
+            assert(requested_num_bytes >= actual_num_bytes);
+            if (actual_num_bytes > free_len || dropped_len) {
+                // keep packets in order, drop this one and all the next
+                dropped_len += actual_num_bytes;
+                continue;
+            }
+            uint8_t *packet = in_xfer->data_buffer + i * requested_num_bytes;
+            if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+                uac_host_interface_apply_soft_gain(iface, packet, actual_num_bytes);
+            }
+            meter_events |= uac_host_interface_apply_meter(iface, packet, actual_num_bytes);
+            // copy data to ringbuffer
+            _ring_buffer_write(iface->ringbuf, packet, actual_num_bytes);
+            free_len -= actual_num_bytes;
+        }
+        // Unblock the reading task once for all packets
+        _ring_buffer_notify(iface->ringbuf);
+        // frames dropped by overflow are counted, so the clock follows the device
+        const int64_t rx_time_us = esp_timer_get_time();
+        const uint32_t buffered = _ring_buffer_get_len(iface->ringbuf) / iface->frame_bytes;
+        UAC_IFACE_ENTER_CRITICAL(iface);
+        iface->clock.frames += rx_len / iface->frame_bytes;
+        iface->clock.time_us = rx_time_us;
+        iface->clock.buffered = buffered;
+        UAC_IFACE_EXIT_CRITICAL(iface);
+        if (iface->duplex) {
+            // the speaker interface is handled by the same client task
+            iface->xfer_frames += rx_len / iface->frame_bytes;
+            uac_duplex_t *duplex = iface->duplex;
+            __atomic_store_n(&duplex->loopback_offset, (int32_t)(duplex->tx_iface->xfer_frames - iface->xfer_frames), __ATOMIC_RELAXED);
+        }
+        if (meter_events) {
+            UAC_IFACE_ENTER_CRITICAL(iface);
+            iface->meter_level = iface->meter.level;
+            UAC_IFACE_EXIT_CRITICAL(iface);
+            if (meter_events & UAC_METER_VAD_CHANGED) {
+                uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_VAD_CHANGED);
             }
         }
+        if (dropped_len) {
+            ESP_LOGD(TAG, "RX Ringbuffer overflow, %zu bytes dropped", dropped_len);
+            uac_host_interface_count_rx_overflow(iface, dropped_len);
+        }
         // Relaunch transfer
-        usb_host_transfer_submit(in_xfer);
+        uac_host_stream_xfer_submit(iface, in_xfer);
 
         // if ringbuffer is reach the threshold, notify user to read out
-        data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len >= iface->ringbuf_threshold) {
-            uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_RX_DONE);
-        }
+        uac_host_interface_report_level(iface, _ring_buffer_get_len(iface->ringbuf) >= iface->ringbuf_threshold,
+                                        UAC_HOST_DEVICE_EVENT_RX_DONE);
 
         return;
     }
@@ -1164,40 +2105,181 @@ static void stream_rx_xfer_done(usb_transfer_t *in_xfer)
     uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TRANSFER_ERROR);
 }
 
-static void stream_tx_xfer_submit(usb_transfer_t *out_xfer)
+/**
+ * @brief UAC feedback Transfer complete callback
+ *
+ * Full-speed devices report samples per frame in 10.14 format (3 bytes),
+ * high-speed devices samples per microframe in 16.16 format (4 bytes).
+ * Both are scaled to samples per data packet.
+ *
+ * @param[in] transfer  Pointer to transfer data structure
+ */
+static void stream_fb_xfer_done(usb_transfer_t *fb_xfer)
+{
+    assert(fb_xfer);
+
+    uac_iface_t *iface = fb_xfer->context;
+    assert(iface);
+    uac_host_stream_xfer_returned(iface);
+
+    if (iface->state != UAC_INTERFACE_STATE_ACTIVE || fb_xfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+        // User is notified about errors by the data transfers
+        return;
+    }
+
+    const uint8_t *data = fb_xfer->data_buffer;
+    uint32_t rate = 0;
+    if (fb_xfer->isoc_packet_desc[0].status == USB_TRANSFER_STATUS_COMPLETED) {
+        if (fb_xfer->isoc_packet_desc[0].actual_num_bytes == 3) {
+            rate = ((uint64_t)(data[0] | (data[1] << 8) | (data[2] << 16)) << 2) * 1000 / iface->packet_rate;
+        } else if (fb_xfer->isoc_packet_desc[0].actual_num_bytes >= 4) {
+            rate = (uint64_t)(data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24)) * 8000 / iface->packet_rate;
+        }
+    }
+    // Zero length packets are sent between feedback periods, values far from nominal rate are not valid
+    const uint32_t range = iface->nominal_rate >> UAC_FEEDBACK_RANGE_SHIFT;
+    if (rate > iface->nominal_rate - range && rate < iface->nominal_rate + range) {
+        iface->fb_rate = rate;
+    }
+    uac_host_stream_xfer_submit(iface, fb_xfer);
+}
+
+/**
+ * @brief Set size of each packet of TX transfer by the stream rate
+ *
+ * The rate from feedback endpoint is used if received, the nominal rate otherwise.
+ * The fraction of samples is carried to the next packets, so the average rate is exact,
+ * eg. 44.1 kHz at full speed sends nine packets of 44 frames followed by one of 45.
+ *
+ * @param[in]  iface       Pointer to Interface structure
+ * @param[in]  out_xfer    TX transfer
+ * @param[out] rate_acc    Carried fraction after this transfer, to be saved if the transfer is sent
+ * @return Number of bytes of all packets
+ */
+static size_t stream_tx_packets_prepare(uac_iface_t *iface, usb_transfer_t *out_xfer, uint64_t *rate_acc)
+{
+    // Samples are counted in 1/(packet_rate << 16), so both the nominal rate in Hz and the feedback rate are exact
+    const uint64_t one_sample = (uint64_t)iface->packet_rate << UAC_RATE_FRAC_BITS;
+    const uint64_t rate = iface->fb_rate ? (uint64_t)iface->fb_rate * iface->packet_rate :
+                          (uint64_t)iface->iface_alt[iface->cur_alt].cur_sampling_freq << UAC_RATE_FRAC_BITS;
+    const uint32_t max_samples = iface->iface_alt[iface->cur_alt].ep_mps / iface->frame_bytes;
+    uint64_t acc = iface->rate_acc;
+    size_t num_bytes = 0;
+    for (int j = 0; j < iface->packet_num; j++) {
+        acc += rate;
+        uint32_t samples = acc / one_sample;
+        if (samples > max_samples) {
+            samples = max_samples;
+            acc = max_samples * one_sample;
+        }
+        acc -= samples * one_sample;
+        out_xfer->isoc_packet_desc[j].num_bytes = samples * iface->frame_bytes;
+        num_bytes += samples * iface->frame_bytes;
+    }
+    *rate_acc = acc;
+    return num_bytes;
+}
+
+/**
+ * @brief Park TX transfer in the free list, it is submitted again by the next write or by uac_host_tx_consumer_unlock()
+ *
+ * The lists are updated before the idle bit is published, no critical section is needed
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] out_xfer    TX transfer not submitted
+ */
+static void uac_host_tx_xfer_park(uac_iface_t *iface, usb_transfer_t *out_xfer)
+{
+    for (int i = 0; i < iface->xfer_num; i++) {
+        if (iface->xfer_list[i] == out_xfer) {
+            iface->free_xfer_list[i] = out_xfer;
+            iface->xfer_list[i] = NULL;
+            __atomic_fetch_or(&iface->tx_idle_mask, 1UL << i, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Release consumer lock of TX ring
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return true if a transfer was parked while the lock was taken, the caller submits it by uac_host_tx_xfer_submit_free()
+ */
+static bool uac_host_tx_consumer_unlock(uac_iface_t *iface)
+{
+    xSemaphoreGive(iface->ringbuf->consumer_lock);
+    return __atomic_exchange_n(&iface->tx_lock_missed, false, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Fill TX transfer from the ringbuffer and submit it
+ *
+ * @param[in] out_xfer    TX transfer owned by the caller
+ * @return true if the caller must submit the parked transfers by uac_host_tx_xfer_submit_free()
+ */
+static bool stream_tx_xfer_submit(usb_transfer_t *out_xfer)
 {
     uac_iface_t *iface = out_xfer->context;
     assert(iface);
 
-    size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-    if (data_len >= iface->packet_size * iface->packet_num) {
-        data_len = iface->packet_size * iface->packet_num;
+    if (iface->notify_task) {
+        // arm the notification if the writer has filled the buffer since the last transfer
+        uac_host_interface_report_level(iface, _ring_buffer_get_len(iface->ringbuf) <= iface->ringbuf_threshold,
+                                        UAC_HOST_DEVICE_EVENT_TX_DONE);
+    }
+    // called from USB transfer callback, must not block: if another consumer holds the ring,
+    // it submits the parked transfer after releasing the lock, so the playback does not wait for the next write
+    if (xSemaphoreTake(iface->ringbuf->consumer_lock, 0) != pdTRUE) {
+        uac_host_tx_xfer_park(iface, out_xfer);
+        __atomic_store_n(&iface->tx_lock_missed, true, __ATOMIC_SEQ_CST);
+        // the holder may have released the lock before the flag was set, then nobody else sees it
+        if (xSemaphoreTake(iface->ringbuf->consumer_lock, 0) == pdTRUE) {
+            return uac_host_tx_consumer_unlock(iface);
+        }
+        return false;
+    }
+    bool lock_missed;
+    uint64_t rate_acc = 0;
+    size_t data_len = stream_tx_packets_prepare(iface, out_xfer, &rate_acc);
+    size_t ring_len = _ring_buffer_get_len(iface->ringbuf);
+    if (ring_len >= data_len || (iface->flags & FLAG_STREAM_TX_INSERT_SILENCE)) {
+        // on underrun send the whole frames available, followed by silence
+        const size_t actual_len = MIN(ring_len - ring_len % iface->frame_bytes, data_len);
         size_t actual_num_bytes = 0;
-        _ring_buffer_pop(iface->ringbuf, out_xfer->data_buffer, data_len, &actual_num_bytes, 0);
-        assert(actual_num_bytes == data_len);
+        if (actual_len) {
+            _ring_buffer_pop(iface->ringbuf, out_xfer->data_buffer, actual_len, &actual_num_bytes, 0);
+            if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+                // the gain ramp state is kept by the single consumer
+                uac_host_interface_apply_soft_gain(iface, out_xfer->data_buffer, actual_num_bytes);
+            }
+        }
+        iface->rate_acc = rate_acc;
+        lock_missed = uac_host_tx_consumer_unlock(iface);
+        assert(actual_num_bytes == actual_len);
+        if (actual_len < data_len) {
+            memset(out_xfer->data_buffer + actual_len, 0, data_len - actual_len);
+            uac_host_interface_count_tx_underrun(iface, data_len - actual_len);
+        } else {
+            iface->tx_underrun = false;
+        }
+        out_xfer->num_bytes = data_len;
         // Relaunch transfer, as the pipe state may change
         // the transfer may fail eg. the device is disconnected or the pipe is suspended
         // the data in ringbuffer will be dropped without notify user
-        usb_host_transfer_submit(out_xfer);
-        data_len = _ring_buffer_get_len(iface->ringbuf);
-        if (data_len <= iface->ringbuf_threshold) {
-            // Notify user send done
-            uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TX_DONE);
-        }
+        uac_host_stream_xfer_submit(iface, out_xfer);
+        // Notify user send done
+        uac_host_interface_report_level(iface, _ring_buffer_get_len(iface->ringbuf) <= iface->ringbuf_threshold,
+                                        UAC_HOST_DEVICE_EVENT_TX_DONE);
     } else {
+        lock_missed = uac_host_tx_consumer_unlock(iface);
         // add the transfer to free list
-        UAC_ENTER_CRITICAL();
-        for (int i = 0; i < iface->xfer_num; i++) {
-            if (iface->xfer_list[i] == out_xfer) {
-                iface->free_xfer_list[i] = out_xfer;
-                iface->xfer_list[i] = NULL;
-                break;
-            }
-        }
-        UAC_EXIT_CRITICAL();
+        uac_host_tx_xfer_park(iface, out_xfer);
+        uac_host_interface_count_tx_underrun(iface, 0);
         // Notify user send done
-        uac_host_user_interface_callback(iface, UAC_HOST_DEVICE_EVENT_TX_DONE);
+        uac_host_interface_report_level(iface, true, UAC_HOST_DEVICE_EVENT_TX_DONE);
     }
+    return lock_missed;
 }
 
 /**
@@ -1211,6 +2293,7 @@ static void stream_tx_xfer_done(usb_transfer_t *out_xfer)
 
     uac_iface_t *iface = out_xfer->context;
     assert(iface);
+    uac_host_stream_xfer_returned(iface);
 
     // If the iface is not active, cancel the transfer
     if (iface->state != UAC_INTERFACE_STATE_ACTIVE) {
@@ -1219,8 +2302,19 @@ static void stream_tx_xfer_done(usb_transfer_t *out_xfer)
 
     switch (out_xfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED: {
+        if (iface->duplex) {
+            // keep the sent data as reference of the microphone data
+            iface->xfer_frames += out_xfer->num_bytes / iface->frame_bytes;
+            uac_ring_t *tx_ref = iface->duplex->tx_ref;
+            if (_ring_buffer_get_free(tx_ref) >= (size_t)out_xfer->num_bytes) {
+                _ring_buffer_write(tx_ref, out_xfer->data_buffer, out_xfer->num_bytes);
+                _ring_buffer_notify(tx_ref);
+            }
+        }
         // Submit the next transfer
-        stream_tx_xfer_submit(out_xfer);
+        if (stream_tx_xfer_submit(out_xfer)) {
+            uac_host_tx_xfer_submit_free(iface);
+        }
         return;
     }
     case USB_TRANSFER_STATUS_NO_DEVICE:
@@ -1230,15 +2324,7 @@ static void stream_tx_xfer_done(usb_transfer_t *out_xfer)
         return;
     default:
         // Any other error, add the transfer to free list
-        UAC_ENTER_CRITICAL();
-        for (int i = 0; i < iface->xfer_num; i++) {
-            if (iface->xfer_list[i] == out_xfer) {
-                iface->free_xfer_list[i] = out_xfer;
-                iface->xfer_list[i] = NULL;
-                break;
-            }
-        }
-        UAC_EXIT_CRITICAL();
+        uac_host_tx_xfer_park(iface, out_xfer);
         break;
     }
 
@@ -1276,17 +2362,36 @@ static esp_err_t uac_host_interface_suspend(uac_iface_t *iface)
     UAC_RETURN_ON_ERROR(usb_host_endpoint_halt(iface->parent->dev_hdl, ep_addr), "Unable to HALT EP");
     UAC_RETURN_ON_ERROR(usb_host_endpoint_flush(iface->parent->dev_hdl, ep_addr), "Unable to FLUSH EP");
     usb_host_endpoint_clear(iface->parent->dev_hdl, ep_addr);
+    if (iface->fb_xfer) {
+        uint8_t fb_ep_addr = iface->iface_alt[iface->cur_alt].fb_ep_addr;
+        UAC_RETURN_ON_ERROR(usb_host_endpoint_halt(iface->parent->dev_hdl, fb_ep_addr), "Unable to HALT feedback EP");
+        UAC_RETURN_ON_ERROR(usb_host_endpoint_flush(iface->parent->dev_hdl, fb_ep_addr), "Unable to FLUSH feedback EP");
+        usb_host_endpoint_clear(iface->parent->dev_hdl, fb_ep_addr);
+    }
+    // the flushed transfers return asynchronously in the client task, wait for them so the resume can submit them
+    // at once. The client task itself can not wait, its pending callbacks are canceled by the state
+    if (xTaskGetCurrentTaskHandle() != s_uac_driver->event_task) {
+        while (__atomic_load_n(&iface->xfer_inflight, __ATOMIC_RELAXED) &&
+                xSemaphoreTake(iface->xfer_returned, pdMS_TO_TICKS(DEFAULT_ISOC_XFER_TIMEOUT_MS)) == pdTRUE) {
+        }
+        if (__atomic_load_n(&iface->xfer_inflight, __ATOMIC_RELAXED)) {
+            ESP_LOGW(TAG, "Interface %d: %"PRIu32" transfers not returned", iface->dev_info.iface_num,
+                     __atomic_load_n(&iface->xfer_inflight, __ATOMIC_RELAXED));
+        }
+    }
     _ring_buffer_flush(iface->ringbuf);
 
-    // add all the transfer to free list
-    UAC_ENTER_CRITICAL();
+    // add all the transfer to free list, they are not idle for writers until resumed
+    UAC_IFACE_ENTER_CRITICAL(iface);
     for (int i = 0; i < iface->xfer_num; i++) {
         if (iface->xfer_list[i]) {
             iface->free_xfer_list[i] = iface->xfer_list[i];
             iface->xfer_list[i] = NULL;
         }
     }
-    UAC_EXIT_CRITICAL();
+    iface->tx_idle_mask = 0;
+    iface->tx_lock_missed = false;
+    UAC_IFACE_EXIT_CRITICAL(iface);
     // Change state
     iface->state = UAC_INTERFACE_STATE_READY;
 
@@ -1294,12 +2399,12 @@ static esp_err_t uac_host_interface_suspend(uac_iface_t *iface)
 }
 
 /**
- * @brief Resume suspended interface, the interface will be in ACTIVE state
+ * @brief Prepare resume of suspended interface: set the alternate setting and sample frequency, and set up the transfers
  *
  * @param[in] iface       Pointer to Interface structure
  * @return esp_err_t
  */
-static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
+static esp_err_t uac_host_interface_resume_prepare(uac_iface_t *iface)
 {
     UAC_RETURN_ON_INVALID_ARG(iface);
     UAC_RETURN_ON_INVALID_ARG(iface->parent);
@@ -1312,13 +2417,21 @@ static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
     USB_SETUP_PACKET_INIT_SET_INTERFACE(&request, iface->dev_info.iface_num, iface->cur_alt + 1);
     UAC_RETURN_ON_ERROR(uac_cs_request_set(iface->parent, (uac_cs_request_t *)&request), "Unable to set Interface alternate");
     ESP_LOGI(TAG, "Set Interface %d-%d", iface->dev_info.iface_num, iface->cur_alt + 1);
-    // Set endpoint frequency control
-    if (iface->iface_alt[iface->cur_alt].freq_ctrl_supported) {
+    // Set clock source frequency of UAC 2.0, or endpoint frequency control of UAC 1.0
+    // the clock source keeps its frequency while the interface is at alternate setting 0, it is set again only if changed
+    if (iface->parent->uac_version == UAC_VERSION_2 && iface->iface_alt[iface->cur_alt].freq_ctrl_supported) {
+        if (iface->clock_freq != iface->iface_alt[iface->cur_alt].cur_sampling_freq) {
+            ESP_LOGI(TAG, "Set Clock %d frequency %"PRIu32, iface->iface_alt[iface->cur_alt].clock_id, iface->iface_alt[iface->cur_alt].cur_sampling_freq);
+            UAC_RETURN_ON_ERROR(uac2_cs_request_set_clock_frequency(iface, iface->iface_alt[iface->cur_alt].clock_id,
+                                iface->iface_alt[iface->cur_alt].cur_sampling_freq), "Unable to set clock frequency");
+            iface->clock_freq = iface->iface_alt[iface->cur_alt].cur_sampling_freq;
+        }
+    } else if (iface->iface_alt[iface->cur_alt].freq_ctrl_supported) {
         ESP_LOGI(TAG, "Set EP %02X frequency %"PRIu32, iface->iface_alt[iface->cur_alt].ep_addr, iface->iface_alt[iface->cur_alt].cur_sampling_freq);
         UAC_RETURN_ON_ERROR(uac_cs_request_set_ep_frequency(iface, iface->iface_alt[iface->cur_alt].ep_addr,
                             iface->iface_alt[iface->cur_alt].cur_sampling_freq), "Unable to set endpoint frequency");
     }
-    // for RX, we just submit all the transfers
+    // for RX, set up all the transfers, they are submitted by uac_host_interface_resume_submit()
     if (iface->dev_info.type == UAC_STREAM_RX) {
         assert(iface->iface_alt[iface->cur_alt].ep_addr & 0x80);
         for (int i = 0; i < iface->xfer_num; i++) {
@@ -1334,9 +2447,6 @@ static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
             for (int j = 0; j < iface->packet_num; j++) {
                 iface->free_xfer_list[i]->isoc_packet_desc[j].num_bytes = iface->iface_alt[iface->cur_alt].ep_mps;
             }
-            iface->xfer_list[i] = iface->free_xfer_list[i];
-            iface->free_xfer_list[i] = NULL;
-            UAC_RETURN_ON_ERROR(usb_host_transfer_submit(iface->xfer_list[i]), "Unable to submit RX transfer");
         }
     } else if (iface->dev_info.type == UAC_STREAM_TX) {
         assert(!(iface->iface_alt[iface->cur_alt].ep_addr & 0x80));
@@ -1350,20 +2460,83 @@ static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
             iface->free_xfer_list[i]->bEndpointAddress = iface->iface_alt[iface->cur_alt].ep_addr;
             // set the data buffer to 0
             memset(iface->free_xfer_list[i]->data_buffer, 0, iface->free_xfer_list[i]->data_buffer_size);
-            // for synchronous transfer type, the packet size depends on the actual sample rate, channels and bit resolution.
-            for (int j = 0; j < iface->packet_num; j++) {
-                iface->free_xfer_list[i]->isoc_packet_desc[j].num_bytes = iface->packet_size;
-            }
-            iface->free_xfer_list[i]->num_bytes = iface->packet_num * iface->packet_size;
+            // the packet sizes are scheduled by stream_tx_packets_prepare() on each submit
+            iface->free_xfer_list[i]->num_bytes = 0;
+        }
+        // the packet sizes follow the device rate reported by the feedback endpoint
+        iface->rate_acc = 0;
+        iface->fb_rate = 0;
+        if (iface->fb_xfer) {
+            iface->fb_xfer->device_handle = iface->parent->dev_hdl;
+            iface->fb_xfer->callback = stream_fb_xfer_done;
+            iface->fb_xfer->context = iface;
+            iface->fb_xfer->timeout_ms = DEFAULT_ISOC_XFER_TIMEOUT_MS;
+            iface->fb_xfer->bEndpointAddress = iface->iface_alt[iface->cur_alt].fb_ep_addr;
+            iface->fb_xfer->num_bytes = iface->iface_alt[iface->cur_alt].fb_ep_mps;
+            iface->fb_xfer->isoc_packet_desc[0].num_bytes = iface->iface_alt[iface->cur_alt].fb_ep_mps;
         }
     }
 
+    return ESP_OK;
+}
+
+/**
+ * @brief Submit the transfers prepared by uac_host_interface_resume_prepare(), the interface will be in ACTIVE state
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_interface_resume_submit(uac_iface_t *iface)
+{
+    iface->notify_armed = true;
+    // for RX, we just submit all the transfers
+    if (iface->dev_info.type == UAC_STREAM_RX) {
+        for (int i = 0; i < iface->xfer_num; i++) {
+            iface->xfer_list[i] = iface->free_xfer_list[i];
+            iface->free_xfer_list[i] = NULL;
+            UAC_RETURN_ON_ERROR(uac_host_stream_xfer_submit(iface, iface->xfer_list[i]), "Unable to submit RX transfer");
+        }
+    }
     // for TX, we check if data is available in the ringbuffer, if yes, we submit the transfer
+    iface->tx_underrun = true;
+    if (iface->dev_info.type == UAC_STREAM_TX) {
+        // all transfers are idle until written, unless they are submitted with silence below
+        const uint32_t all_idle = (uint32_t)((1ULL << iface->xfer_num) - 1);
+        __atomic_store_n(&iface->tx_idle_mask, (iface->flags & FLAG_STREAM_TX_INSERT_SILENCE) ? 0 : all_idle, __ATOMIC_RELEASE);
+    }
     iface->state = UAC_INTERFACE_STATE_ACTIVE;
+    if (iface->fb_xfer) {
+        UAC_RETURN_ON_ERROR(uac_host_stream_xfer_submit(iface, iface->fb_xfer), "Unable to submit feedback transfer");
+    }
+    // with silence insertion, the TX stream runs from the start, before any data is written
+    if (iface->dev_info.type == UAC_STREAM_TX && (iface->flags & FLAG_STREAM_TX_INSERT_SILENCE)) {
+        for (int i = 0; i < iface->xfer_num; i++) {
+            UAC_IFACE_ENTER_CRITICAL(iface);
+            usb_transfer_t *out_xfer = iface->free_xfer_list[i];
+            iface->xfer_list[i] = out_xfer;
+            iface->free_xfer_list[i] = NULL;
+            UAC_IFACE_EXIT_CRITICAL(iface);
+            if (stream_tx_xfer_submit(out_xfer)) {
+                uac_host_tx_xfer_submit_free(iface);
+            }
+        }
+    }
 
     return ESP_OK;
 }
 
+/**
+ * @brief Resume suspended interface, the interface will be in ACTIVE state
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_interface_resume(uac_iface_t *iface)
+{
+    UAC_RETURN_ON_ERROR(uac_host_interface_resume_prepare(iface), "Unable to prepare UAC Interface");
+    return uac_host_interface_resume_submit(iface);
+}
+
 /**
  * @brief Add UAC physical device to the list
  * @param[in] addr          USB device address
@@ -1405,15 +2578,18 @@ static esp_err_t _uac_host_device_add(uint8_t addr, usb_device_handle_t dev_hdl,
                 switch (uac_cs_desc->bDescriptorSubtype) {
                 case UAC_AC_HEADER: {
                     const uac_ac_header_desc_t *header_desc = (const uac_ac_header_desc_t *)uac_cs_desc;
-                    if (header_desc->bcdADC != 0x0100) {
+                    if (header_desc->bcdADC != UAC_VERSION_1 && header_desc->bcdADC != UAC_VERSION_2) {
                         ESP_LOGW(TAG, "UAC version 0x%04X not supported", header_desc->bcdADC);
                         free(uac_device);
                         return ESP_ERR_NOT_SUPPORTED;
                     }
-                    uint8_t *cs_ac_desc = calloc(header_desc->wTotalLength, sizeof(uint8_t));
+                    const size_t cs_ac_len = _uac_ac_desc_total_length((const uint8_t *)header_desc);
+                    uint8_t *cs_ac_desc = calloc(cs_ac_len, sizeof(uint8_t));
                     UAC_GOTO_ON_FALSE(cs_ac_desc, ESP_ERR_NO_MEM, "Unable to allocate memory for UAC Control CS descriptor");
-                    memcpy(cs_ac_desc, uac_cs_desc, header_desc->wTotalLength);
+                    memcpy(cs_ac_desc, uac_cs_desc, cs_ac_len);
                     uac_device->cs_ac_desc = cs_ac_desc;
+                    uac_device->uac_version = header_desc->bcdADC;
+                    UAC_GOTO_ON_ERROR(_uac_ac_entities_build(uac_device), "Unable to index UAC Control CS descriptor");
                     ESP_LOGD(TAG, "UAC version 0x%04X", header_desc->bcdADC);
                     break;
                 }
@@ -1437,12 +2613,19 @@ static esp_err_t _uac_host_device_add(uint8_t addr, usb_device_handle_t dev_hdl,
     UAC_GOTO_ON_FALSE(uac_device->device_busy =  xSemaphoreCreateMutex(), ESP_ERR_NO_MEM, "Unable to create mutex");
 
     // Allocate control transfer buffer
-    UAC_GOTO_ON_ERROR(usb_host_transfer_alloc(64, 0, &uac_device->ctrl_xfer), "Unable to allocate transfer buffer");
+    UAC_GOTO_ON_ERROR(USB_HOST_XFER_POOL_ALLOC(MAX(64, USB_SETUP_PACKET_SIZE + UAC_CTRL_XFER_DATA_SIZE), 0, &uac_device->ctrl_xfer),
+                      "Unable to allocate transfer buffer");
+
+    // High-speed devices send packets each microframe, sizes of the packets depend on the speed
+    usb_device_info_t dev_info;
+    UAC_GOTO_ON_ERROR(usb_host_device_info(dev_hdl, &dev_info), "Unable to get USB device info");
+    uac_device->speed = dev_info.speed;
 
     UAC_GOTO_ON_FALSE_CRITICAL(s_uac_driver, ESP_ERR_INVALID_STATE);
     UAC_GOTO_ON_FALSE_CRITICAL(s_uac_driver->client_handle, ESP_ERR_INVALID_STATE);
     UAC_ENTER_CRITICAL();
     STAILQ_INSERT_TAIL(&s_uac_driver->uac_devices_tailq, uac_device, tailq_entry);
+    s_uac_driver->devices_by_addr[addr] = uac_device;
     UAC_EXIT_CRITICAL();
 
     if (uac_device_handle) {
@@ -1466,7 +2649,7 @@ static esp_err_t _uac_host_device_delete(uac_device_t *uac_device)
     UAC_RETURN_ON_INVALID_ARG(uac_device);
 
     if (uac_device->ctrl_xfer) {
-        UAC_RETURN_ON_ERROR(usb_host_transfer_free(uac_device->ctrl_xfer), "Unable to free transfer buffer for EP0");
+        UAC_RETURN_ON_ERROR(USB_HOST_XFER_POOL_FREE(uac_device->ctrl_xfer), "Unable to free transfer buffer for EP0");
     }
 
     if (uac_device->ctrl_xfer_done) {
@@ -1480,11 +2663,15 @@ static esp_err_t _uac_host_device_delete(uac_device_t *uac_device)
     if (uac_device->cs_ac_desc) {
         free(uac_device->cs_ac_desc);
     }
+    free(uac_device->entities);
 
     ESP_LOGD(TAG, "Remove addr %d device from list", uac_device->addr);
 
     UAC_ENTER_CRITICAL();
-    STAILQ_REMOVE(&s_uac_driver->uac_devices_tailq, uac_device, uac_host_device, tailq_entry);
+    if (s_uac_driver->devices_by_addr[uac_device->addr] == uac_device) {
+        STAILQ_REMOVE(&s_uac_driver->uac_devices_tailq, uac_device, uac_host_device, tailq_entry);
+        s_uac_driver->devices_by_addr[uac_device->addr] = NULL;
+    }
     UAC_EXIT_CRITICAL();
 
     free(uac_device);
@@ -1680,6 +2867,103 @@ static esp_err_t uac_cs_request_set_ep_frequency(uac_iface_t *iface, uint8_t ep_
     return uac_cs_request_set(iface->parent, &set_freq);
 }
 
+/**
+ * @brief UAC 2.0 class specific request - Set Clock Source Frequency
+ * @param[in] iface       Pointer to UAC interface structure
+ * @param[in] clock_id    Clock source ID
+ * @param[in] freq        Frequency to set
+ * @return esp_err_t
+ */
+static esp_err_t uac2_cs_request_set_clock_frequency(uac_iface_t *iface, uint8_t clock_id, uint32_t freq)
+{
+    uint8_t tmp[4] = { 0, 0, 0, 0 };
+
+    const uac_cs_request_t set_freq = {
+        .bmRequestType = USB_BM_REQUEST_TYPE_DIR_OUT | USB_BM_REQUEST_TYPE_TYPE_CLASS
+        | USB_BM_REQUEST_TYPE_RECIP_INTERFACE,
+        .bRequest = UAC2_CUR,
+        .wValue = UAC2_CS_SAM_FREQ_CONTROL << 8,
+        .wIndex = (clock_id << 8) | (iface->parent->ctrl_iface_num & 0xff),
+        .wLength = 4,
+        .data = tmp
+    };
+
+    tmp[0] = freq & 0xff;
+    tmp[1] = (freq >> 8) & 0xff;
+    tmp[2] = (freq >> 16) & 0xff;
+    tmp[3] = (freq >> 24) & 0xff;
+    return uac_cs_request_set(iface->parent, &set_freq);
+}
+
+/**
+ * @brief UAC 2.0 class specific request - Get Clock Source Frequencies of the alternate setting
+ *
+ * Subranges with equal minimum and maximum are discrete frequencies, any other subrange makes the range continuous.
+ * If the range is not reported, the current frequency is the only one.
+ *
+ * @param[in] iface       Pointer to UAC interface structure
+ * @param[in] iface_alt   Pointer to alternate setting, sampling frequencies are filled
+ * @return esp_err_t
+ */
+static esp_err_t uac2_cs_request_get_clock_frequencies(uac_iface_t *iface, uac_iface_alt_t *iface_alt)
+{
+    uint8_t tmp[UAC_CTRL_XFER_DATA_SIZE] = { 0 };
+    uac_host_dev_alt_param_t *param = &iface_alt->dev_alt_param;
+
+    // number of subranges first, then all the subranges which fit
+    uac_cs_request_t get_freq = {
+        .bRequest = UAC2_RANGE,
+        .wValue = UAC2_CS_SAM_FREQ_CONTROL << 8,
+        .wIndex = (iface_alt->clock_id << 8) | (iface->parent->ctrl_iface_num & 0xff),
+        .wLength = 2,
+        .data = tmp
+    };
+    size_t actual_length = 0;
+    esp_err_t ret = uac_cs_request_get(iface->parent, &get_freq, &actual_length);
+    uint16_t num = (ret == ESP_OK && actual_length == 2) ? (tmp[0] | (tmp[1] << 8)) : 0;
+    if (num) {
+        get_freq.wLength = MIN(2 + num * UAC2_FREQ_SUBRANGE_SIZE, sizeof(tmp));
+        ret = uac_cs_request_get(iface->parent, &get_freq, &actual_length);
+        num = (ret == ESP_OK && actual_length >= 2) ? MIN(num, (actual_length - 2) / UAC2_FREQ_SUBRANGE_SIZE) : 0;
+    }
+    if (num == 0) {
+        get_freq.bRequest = UAC2_CUR;
+        get_freq.wLength = 4;
+        ret = uac_cs_request_get(iface->parent, &get_freq, &actual_length);
+        UAC_RETURN_ON_FALSE(ret == ESP_OK && actual_length == 4, ESP_FAIL, "Unable to get clock frequency");
+        param->sample_freq_type = 1;
+        param->sample_freq[0] = tmp[0] | (tmp[1] << 8) | (tmp[2] << 16) | ((uint32_t)tmp[3] << 24);
+        ESP_LOGD(TAG, "UAC Clock %d frequency %"PRIu32, iface_alt->clock_id, param->sample_freq[0]);
+        return ESP_OK;
+    }
+
+    uint32_t freq_min = UINT32_MAX;
+    uint32_t freq_max = 0;
+    bool continuous = false;
+    param->sample_freq_type = 0;
+    for (int i = 0; i < num; i++) {
+        const uint8_t *subrange = &tmp[2 + i * UAC2_FREQ_SUBRANGE_SIZE];
+        const uint32_t sub_min = subrange[0] | (subrange[1] << 8) | (subrange[2] << 16) | ((uint32_t)subrange[3] << 24);
+        const uint32_t sub_max = subrange[4] | (subrange[5] << 8) | (subrange[6] << 16) | ((uint32_t)subrange[7] << 24);
+        freq_min = MIN(freq_min, sub_min);
+        freq_max = MAX(freq_max, sub_max);
+        continuous |= (sub_min != sub_max);
+        if (!continuous && i < UAC_FREQ_NUM_MAX) {
+            param->sample_freq[i] = sub_min;
+            param->sample_freq_type++;
+        }
+    }
+    if (continuous) {
+        param->sample_freq_type = 0;
+        param->sample_freq_lower = freq_min;
+        param->sample_freq_upper = freq_max;
+    } else if (num > UAC_FREQ_NUM_MAX) {
+        ESP_LOGW(TAG, "UAC Clock %d, Frequency Number %d exceed the maximum %d", iface_alt->clock_id, num, UAC_FREQ_NUM_MAX);
+    }
+    ESP_LOGD(TAG, "UAC Clock %d, %d subranges, %"PRIu32" - %"PRIu32" Hz", iface_alt->clock_id, num, freq_min, freq_max);
+    return ESP_OK;
+}
+
 /**
  * @brief UAC class specific request - Set Volume
  * @param[in] iface       Pointer to UAC interface structure
@@ -1730,7 +3014,7 @@ static esp_err_t uac_cs_request_get_volume(uac_iface_t *iface, int16_t *volume_d
     esp_err_t ret = ESP_OK;
 
     uac_cs_request_t get_volume = {
-        .bRequest = UAC_GET_CUR,
+        .bRequest = (iface->parent->uac_version == UAC_VERSION_2) ? UAC2_CUR : UAC_GET_CUR,
         .wIndex = (feature_unit << 8) | (ctrl_iface_num & 0xff),
         .wLength = 2,
         .data = tmp
@@ -1782,28 +3066,44 @@ static esp_err_t uac_cs_request_get_volume_range(uac_iface_t *iface, int16_t *vo
     }
 
     size_t actual_length = 0;
-    ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
-    if (ret != ESP_OK || actual_length != get_volume.wLength) {
-        ESP_LOGE(TAG, "Failed to get volume min");
-        return ESP_FAIL;
-    }
-    volume_min = tmp[0] | (tmp[1] << 8);
+    if (iface->parent->uac_version == UAC_VERSION_2) {
+        // UAC 2.0 reports the first subrange as number of subranges, min, max and res
+        uint8_t range[8] = { 0 };
+        get_volume.bRequest = UAC2_RANGE;
+        get_volume.wLength = sizeof(range);
+        get_volume.data = range;
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume range");
+            return ESP_FAIL;
+        }
+        volume_min = range[2] | (range[3] << 8);
+        volume_max = range[4] | (range[5] << 8);
+        volume_res = range[6] | (range[7] << 8);
+    } else {
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume min");
+            return ESP_FAIL;
+        }
+        volume_min = tmp[0] | (tmp[1] << 8);
 
-    get_volume.bRequest = UAC_GET_MAX;
-    ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
-    if (ret != ESP_OK || actual_length != get_volume.wLength) {
-        ESP_LOGE(TAG, "Failed to get volume max");
-        return ESP_FAIL;
-    }
-    volume_max = tmp[0] | (tmp[1] << 8);
+        get_volume.bRequest = UAC_GET_MAX;
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume max");
+            return ESP_FAIL;
+        }
+        volume_max = tmp[0] | (tmp[1] << 8);
 
-    get_volume.bRequest = UAC_GET_RES;
-    ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
-    if (ret != ESP_OK || actual_length != get_volume.wLength) {
-        ESP_LOGE(TAG, "Failed to get volume res");
-        return ESP_FAIL;
+        get_volume.bRequest = UAC_GET_RES;
+        ret = uac_cs_request_get(iface->parent, &get_volume, &actual_length);
+        if (ret != ESP_OK || actual_length != get_volume.wLength) {
+            ESP_LOGE(TAG, "Failed to get volume res");
+            return ESP_FAIL;
+        }
+        volume_res = tmp[0] | (tmp[1] << 8);
     }
-    volume_res = tmp[0] | (tmp[1] << 8);
     *volume_min_db = volume_min;
     *volume_max_db = volume_max;
     *volume_res_db = volume_res;
@@ -1862,7 +3162,7 @@ static esp_err_t uac_cs_request_get_mute(uac_iface_t *iface, bool *mute)
     esp_err_t ret = ESP_OK;
 
     uac_cs_request_t get_mute = {
-        .bRequest = UAC_GET_CUR,
+        .bRequest = (iface->parent->uac_version == UAC_VERSION_2) ? UAC2_CUR : UAC_GET_CUR,
         .wIndex = (feature_unit << 8) | (ctrl_iface_num & 0xff),
         .wLength = 1,
         .data = tmp
@@ -1910,6 +3210,10 @@ esp_err_t uac_host_install(const uac_host_driver_config_t *config)
     driver->end_client_event_handling = false;
     driver->all_events_handled = xSemaphoreCreateBinary();
     UAC_GOTO_ON_FALSE(driver->all_events_handled, ESP_ERR_NO_MEM, "Unable to create semaphore");
+    if (CONFIG_UAC_RECONNECT_CACHE_NUM > 0) {
+        driver->cache = calloc(CONFIG_UAC_RECONNECT_CACHE_NUM, sizeof(uac_iface_cache_t));
+        UAC_GOTO_ON_FALSE(driver->cache, ESP_ERR_NO_MEM, "Unable to allocate reconnect cache");
+    }
 
     usb_host_client_config_t client_config = {
         .is_synchronous = false,
@@ -1941,6 +3245,7 @@ fail:
     if (driver->all_events_handled) {
         vSemaphoreDelete(driver->all_events_handled);
     }
+    free(driver->cache);
     free(driver);
     return ret;
 }
@@ -1966,11 +3271,44 @@ esp_err_t uac_host_uninstall(void)
     }
     vSemaphoreDelete(s_uac_driver->all_events_handled);
     ESP_ERROR_CHECK(usb_host_client_deregister(s_uac_driver->client_handle));
+    for (int i = 0; i < CONFIG_UAC_RECONNECT_CACHE_NUM; i++) {
+        free(s_uac_driver->cache[i].iface_alt);
+    }
+    free(s_uac_driver->cache);
+    free(s_uac_driver->iface_set);
     free(s_uac_driver);
     s_uac_driver = NULL;
     return ESP_OK;
 }
 
+/**
+ * @brief Start the stream of a reconnected interface and set its volume and mute as before the disconnection
+ *
+ * Failures are only reported, the user can still start the stream.
+ *
+ * @param[in] iface       Pointer to Interface structure
+ */
+static void uac_host_session_restore(uac_iface_t *iface)
+{
+    const uac_iface_session_t session = iface->session;
+    ESP_LOGI(TAG, "Restore stream of interface %d, %"PRIu32" Hz", iface->dev_info.iface_num, session.stream_config.sample_freq);
+    if (uac_host_device_start(iface, &session.stream_config) != ESP_OK) {
+        ESP_LOGW(TAG, "Unable to restore stream of interface %d", iface->dev_info.iface_num);
+        memset(&iface->session, 0, sizeof(iface->session));
+        return;
+    }
+    if (session.volume_set) {
+        const esp_err_t ret = session.volume_is_db ? uac_host_device_set_volume_db(iface, session.volume) :
+                              uac_host_device_set_volume(iface, (uint8_t)session.volume);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Unable to restore volume of interface %d", iface->dev_info.iface_num);
+        }
+    }
+    if (session.mute_set && uac_host_device_set_mute(iface, session.mute) != ESP_OK) {
+        ESP_LOGW(TAG, "Unable to restore mute of interface %d", iface->dev_info.iface_num);
+    }
+}
+
 esp_err_t uac_host_device_open(const uac_host_device_config_t *config, uac_host_device_handle_t *uac_dev_handle)
 {
     UAC_RETURN_ON_INVALID_ARG(uac_dev_handle);
@@ -1978,10 +3316,11 @@ esp_err_t uac_host_device_open(const uac_host_device_config_t *config, uac_host_
     *uac_dev_handle = NULL;
 
     UAC_RETURN_ON_FALSE(s_uac_driver, ESP_ERR_INVALID_STATE, "UAC Driver is not installed");
-    UAC_RETURN_ON_FALSE(config->addr, ESP_ERR_INVALID_ARG, "Invalid device address");
+    UAC_RETURN_ON_FALSE(config->addr && config->addr < UAC_DEV_ADDR_NUM, ESP_ERR_INVALID_ARG, "Invalid device address");
     UAC_RETURN_ON_FALSE(config->iface_num, ESP_ERR_INVALID_ARG, "Invalid interface number");
     UAC_RETURN_ON_FALSE(config->buffer_size, ESP_ERR_INVALID_ARG, "Invalid buffer size");
     UAC_RETURN_ON_FALSE(config->buffer_size > config->buffer_threshold, ESP_ERR_INVALID_ARG, "Invalid buffer threshold");
+    UAC_RETURN_ON_FALSE(!config->notify_task || config->notify_bits, ESP_ERR_INVALID_ARG, "Invalid notification bits");
 
     ESP_LOGD(TAG, "Open Device addr %d, iface %d", config->addr, config->iface_num);
     // Check if the logic device/interface is already added
@@ -2008,35 +3347,79 @@ esp_err_t uac_host_device_open(const uac_host_device_config_t *config, uac_host_
         uac_device->opened_cnt = 0;
     }
 
-    UAC_GOTO_ON_ERROR(uac_host_interface_add(uac_device, config->iface_num, &uac_iface), "Unable to add interface");
+    // a reconnected device is opened with the parameters of its previous connection
+    uac_iface_cache_t cached;
+    const bool is_cached = uac_host_cache_take(uac_device, config->iface_num, &cached);
+    UAC_GOTO_ON_ERROR(uac_host_interface_add(uac_device, config->iface_num, is_cached ? &cached : NULL, &uac_iface),
+                      "Unable to add interface");
 
     // Save UAC Interface callback
     uac_iface->user_cb = config->callback;
     uac_iface->user_cb_arg = config->callback_arg;
+    uac_iface->notify_task = config->notify_task;
+    uac_iface->notify_bits = config->notify_bits;
+    uac_iface->notify_armed = true;
     // create a ringbuffer for the incoming/outgoing data
-    uac_iface->ringbuf = xRingbufferCreate(config->buffer_size, RINGBUF_TYPE_BYTEBUF);
-    UAC_GOTO_ON_FALSE(uac_iface->ringbuf, ESP_ERR_NO_MEM, "Unable to create ringbuffer");
-    uac_iface->ringbuf_size = config->buffer_size;
+    UAC_GOTO_ON_ERROR(_ring_buffer_create(config->buffer_size, config->buffer, &uac_iface->ringbuf), "Unable to create ringbuffer");
     // if the threshold is not set, set it to 25% of the buffer size
     uac_iface->ringbuf_threshold = config->buffer_threshold ? config->buffer_threshold : config->buffer_size / 4;
+    uac_gain_init(&uac_iface->soft_gain);
+    uac_iface->soft_volume_db = 0;
     uac_iface->state = UAC_INTERFACE_STATE_IDLE;
     *uac_dev_handle = (uac_host_device_handle_t)uac_iface;
-    UAC_ENTER_CRITICAL();
-    uac_device->opened_cnt++;
-    UAC_EXIT_CRITICAL();
+    __atomic_fetch_add(&uac_device->opened_cnt, 1, __ATOMIC_RELAXED);
+
+    if (is_cached) {
+        uac_iface->vol_range_valid = cached.vol_range_valid;
+        uac_iface->vol_min_db = cached.vol_min_db;
+        uac_iface->vol_max_db = cached.vol_max_db;
+        uac_iface->vol_res_db = cached.vol_res_db;
+        if (cached.session_valid && config->restore_stream) {
+            uac_iface->session = cached.session;
+        }
+    }
+
+    // UAC 2.0 sampling frequencies are reported by the clock source, alternate settings usually share one
+    if (uac_device->uac_version == UAC_VERSION_2 && !is_cached) {
+        for (int i = 0; i < uac_iface->dev_info.iface_alt_num; i++) {
+            uac_iface_alt_t *iface_alt = &uac_iface->iface_alt[i];
+            if (i > 0 && iface_alt->clock_id == uac_iface->iface_alt[i - 1].clock_id) {
+                iface_alt->dev_alt_param.sample_freq_type = uac_iface->iface_alt[i - 1].dev_alt_param.sample_freq_type;
+                // the frequency list and the range share the storage
+                memcpy(iface_alt->dev_alt_param.sample_freq, uac_iface->iface_alt[i - 1].dev_alt_param.sample_freq,
+                       sizeof(uac_host_dev_alt_param_t) - offsetof(uac_host_dev_alt_param_t, sample_freq));
+            } else if (iface_alt->clock_id && uac2_cs_request_get_clock_frequencies(uac_iface, iface_alt) != ESP_OK) {
+                ESP_LOGW(TAG, "Failed to get sampling frequencies of alternate setting %d", iface_alt->alt_idx);
+            }
+        }
+    }
 
     // Get the current volume range if the device supports volume control
-    if (uac_iface->iface_alt[uac_iface->cur_alt].feature_unit && uac_iface->iface_alt[uac_iface->cur_alt].vol_ch_map) {
+    if (!uac_iface->vol_range_valid && uac_iface->iface_alt[uac_iface->cur_alt].feature_unit &&
+            uac_iface->iface_alt[uac_iface->cur_alt].vol_ch_map) {
         ret = uac_cs_request_get_volume_range(uac_iface, &uac_iface->vol_min_db, &uac_iface->vol_max_db, &uac_iface->vol_res_db);
         if (ret != ESP_OK) {
             ESP_LOGW(TAG, "Failed to get volume range");
+        } else {
+            uac_iface->vol_range_valid = true;
         }
     }
 
+    if (uac_iface->session.stream_started) {
+        uac_host_session_restore(uac_iface);
+    } else {
+        memset(&uac_iface->session, 0, sizeof(uac_iface->session));
+    }
+    UAC_ENUM_MARK(config->addr, "opened");
+
     return ESP_OK;
 
 fail:
     if (uac_iface) {
+        if (uac_iface->ringbuf) {
+            _ring_buffer_delete(uac_iface->ringbuf);
+            uac_iface->ringbuf = NULL;
+        }
         uac_host_interface_delete(uac_iface);
     }
     if (new_device) {
@@ -2045,10 +3428,86 @@ fail:
     if (dev_hdl) {
         usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
     }
-    if (uac_iface->ringbuf) {
-        vRingbufferDelete(uac_iface->ringbuf);
+    return ret;
+}
+
+/**
+ * @brief Register UAC devices connected before the driver was installed
+ *
+ * Devices connected later are registered by their new device events, so the address list is read only once.
+ */
+static void uac_host_connected_scan(void)
+{
+    uint8_t dev_addr_list[UAC_DEV_ADDR_NUM];
+    int num_of_devices = 0;
+    if (usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &num_of_devices) != ESP_OK) {
+        return;
+    }
+
+    for (int i = 0; i < num_of_devices; i++) {
+        const uint8_t addr = dev_addr_list[i];
+        if (addr >= UAC_DEV_ADDR_NUM) {
+            continue;
+        }
+        UAC_ENTER_CRITICAL();
+        const bool registered = s_uac_driver->connected[addr].vid || s_uac_driver->connected[addr].pid;
+        UAC_EXIT_CRITICAL();
+        usb_device_handle_t dev_hdl;
+        if (registered || usb_host_device_open(s_uac_driver->client_handle, addr, &dev_hdl) != ESP_OK) {
+            continue;
+        }
+        const usb_config_desc_t *config_desc;
+        const usb_device_desc_t *dev_desc;
+        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK &&
+                usb_host_get_device_descriptor(dev_hdl, &dev_desc) == ESP_OK) {
+            int iface_offset = 0;
+            const usb_intf_desc_t *iface_desc = GET_NEXT_INTERFACE_DESC(config_desc, config_desc->wTotalLength, iface_offset);
+            while (iface_desc && !(iface_desc->bInterfaceClass == USB_CLASS_AUDIO &&
+                                   iface_desc->bInterfaceSubClass == UAC_SUBCLASS_AUDIOSTREAMING)) {
+                iface_desc = GET_NEXT_INTERFACE_DESC(iface_desc, config_desc->wTotalLength, iface_offset);
+            }
+            if (iface_desc) {
+                UAC_ENTER_CRITICAL();
+                s_uac_driver->connected[addr].vid = dev_desc->idVendor;
+                s_uac_driver->connected[addr].pid = dev_desc->idProduct;
+                UAC_EXIT_CRITICAL();
+            }
+        }
+        usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
+    }
+    s_uac_driver->connected_scanned = true;
+}
+
+/**
+ * @brief Check that a registered device is still connected
+ *
+ * Removal of a device, which was not opened by this driver, is not reported by the USB Host Library,
+ * so its registry entry is dropped here or replaced by the next new device event at the address.
+ *
+ * @param[in] addr  USB device address
+ * @param[in] vid   Registered VID
+ * @param[in] pid   Registered PID
+ * @return true if the device at the address has the VID and PID
+ */
+static bool uac_host_connected_check(uint8_t addr, uint16_t vid, uint16_t pid)
+{
+    usb_device_handle_t dev_hdl;
+    const usb_device_desc_t *dev_desc;
+    bool connected = false;
+    if (usb_host_device_open(s_uac_driver->client_handle, addr, &dev_hdl) == ESP_OK) {
+        connected = (usb_host_get_device_descriptor(dev_hdl, &dev_desc) == ESP_OK &&
+                     dev_desc->idVendor == vid && dev_desc->idProduct == pid);
+        usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
+    }
+    if (!connected) {
+        UAC_ENTER_CRITICAL();
+        if (s_uac_driver->connected[addr].vid == vid && s_uac_driver->connected[addr].pid == pid) {
+            s_uac_driver->connected[addr].vid = 0;
+            s_uac_driver->connected[addr].pid = 0;
+        }
+        UAC_EXIT_CRITICAL();
     }
-    return ret;
+    return connected;
 }
 
 esp_err_t uac_host_device_open_with_vid_pid(uint16_t vid, uint16_t pid, const uac_host_device_config_t *config, uac_host_device_handle_t *uac_dev_handle)
@@ -2067,32 +3526,27 @@ esp_err_t uac_host_device_open_with_vid_pid(uint16_t vid, uint16_t pid, const ua
         return ESP_OK;
     }
 
-    // check all connected devices
-    int actual_count = 0;
-    uint8_t dev_addr_list[CONFIG_UAC_DEV_ADDR_LIST_MAX] = {0};
-    usb_host_device_addr_list_fill(sizeof(dev_addr_list), dev_addr_list, &actual_count);
-    if (actual_count == 0) {
-        return ESP_ERR_NOT_FOUND;
+    // another interface of an added device
+    uac_host_device_config_t config_copy = *config;
+    const uac_device_t *uac_dev = get_uac_device_by_vid_pid(vid, pid);
+    if (uac_dev) {
+        ESP_LOGD(TAG, "Found Device VID 0x%04X, PID 0x%04X", vid, pid);
+        config_copy.addr = uac_dev->addr;
+        return uac_host_device_open(&config_copy, uac_dev_handle);
     }
 
-    for (int i = 0; i < actual_count; i++) {
-        const usb_device_desc_t *dev_desc = NULL;
-        usb_device_handle_t dev_hdl = NULL;
-        uac_device_t *uac_dev = get_uac_device_by_vid_pid(vid, pid);
-        uac_host_device_config_t config_copy = *config;
-        config_copy.addr = dev_addr_list[i];
-        if (uac_dev) {
-            ESP_LOGD(TAG, "Found Device VID 0x%04X, PID 0x%04X", vid, pid);
+    // connected devices are registered by the new device events
+    if (!s_uac_driver->connected_scanned) {
+        uac_host_connected_scan();
+    }
+    for (int addr = 1; addr < UAC_DEV_ADDR_NUM; addr++) {
+        UAC_ENTER_CRITICAL();
+        const uac_dev_id_t dev_id = s_uac_driver->connected[addr];
+        UAC_EXIT_CRITICAL();
+        if (dev_id.vid == vid && dev_id.pid == pid && uac_host_connected_check(addr, vid, pid)) {
+            ESP_LOGD(TAG, "Found Device VID 0x%04X, PID 0x%04X at addr %d", vid, pid, addr);
+            config_copy.addr = addr;
             return uac_host_device_open(&config_copy, uac_dev_handle);
-        } else {
-            UAC_RETURN_ON_ERROR(usb_host_device_open(s_uac_driver->client_handle, dev_addr_list[i], &dev_hdl), "Unable to open USB device");
-            UAC_RETURN_ON_ERROR(usb_host_get_device_descriptor(dev_hdl, &dev_desc), "Unable to get device descriptor");
-            ESP_LOGD(TAG, "Found Device VID 0x%04X, PID 0x%04X", dev_desc->idVendor, dev_desc->idProduct);
-            if (dev_desc->idVendor == vid && dev_desc->idProduct == pid) {
-                usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
-                return uac_host_device_open(&config_copy, uac_dev_handle);
-            }
-            usb_host_device_close(s_uac_driver->client_handle, dev_hdl);
         }
     }
 
@@ -2122,16 +3576,12 @@ esp_err_t uac_host_device_close(uac_host_device_handle_t uac_dev_handle)
         return ESP_OK;
     }
 
-    UAC_ENTER_CRITICAL();
-    if (--uac_iface->parent->opened_cnt == 0) {
-        UAC_EXIT_CRITICAL();
+    if (__atomic_sub_fetch(&uac_iface->parent->opened_cnt, 1, __ATOMIC_ACQ_REL) == 0) {
         UAC_GOTO_ON_ERROR(usb_host_device_close(s_uac_driver->client_handle, uac_iface->parent->dev_hdl), "Unable to close USB device");
         ESP_LOGD(TAG, "line %d, Close Device addr %d", __LINE__, uac_iface->parent->addr);
         UAC_GOTO_ON_ERROR(_uac_host_device_delete(uac_iface->parent), "Unable to delete UAC device");
         uac_iface->parent = NULL;
-        UAC_ENTER_CRITICAL();
     }
-    UAC_EXIT_CRITICAL();
 
     // To delete the ringbuffer safely
     // We should unblock the task that is waiting for the ringbuffer
@@ -2139,20 +3589,21 @@ esp_err_t uac_host_device_close(uac_host_device_handle_t uac_dev_handle)
         if (uac_iface->dev_info.type == UAC_STREAM_RX) {
             // Unblock the task that is waiting for read from the ringbuffer
             uint8_t dummy = 0;
-            xRingbufferSend(uac_iface->ringbuf, &dummy, sizeof(dummy), 0);
+            _ring_buffer_push(uac_iface->ringbuf, &dummy, sizeof(dummy), 0);
         } else {
             // Unblock the task that is waiting for the ringbuffer
             _ring_buffer_flush(uac_iface->ringbuf);
         }
         // Unblock the low priority tasks waiting for the ringbuffer before deleting it
         vTaskDelay(pdMS_TO_TICKS(CONFIG_UAC_RINGBUF_SAFE_DELETE_WAITING_MS));
-        vRingbufferDelete(uac_iface->ringbuf);
+        _ring_buffer_delete(uac_iface->ringbuf);
         uac_iface->ringbuf = NULL;
     }
 
     uac_iface->user_cb = NULL;
     uac_iface->user_cb_arg = NULL;
     ESP_LOGD(TAG, "User Remove addr %d, iface %d from list", uac_iface->dev_info.addr, uac_iface->dev_info.iface_num);
+    uac_host_cache_put(uac_iface);
     uac_host_interface_delete(uac_iface);
 
     return ESP_OK;
@@ -2166,6 +3617,7 @@ esp_err_t uac_host_handle_events(TickType_t timeout)
 {
     UAC_RETURN_ON_FALSE(s_uac_driver != NULL, ESP_ERR_INVALID_STATE, "UAC Driver is not installed");
     s_uac_driver->event_handling_started = true;
+    s_uac_driver->event_task = xTaskGetCurrentTaskHandle();
     esp_err_t ret = usb_host_client_handle_events(s_uac_driver->client_handle, timeout);
     UAC_ENTER_CRITICAL();
     if (s_uac_driver->end_client_event_handling) {
@@ -2215,6 +3667,60 @@ esp_err_t uac_host_printf_device_param(uac_host_device_handle_t uac_dev_handle)
     return ESP_OK;
 }
 
+/**
+ * @brief Set number of URBs and packets per URB from the latency of the stream
+ *
+ * Each packet carries 1/packet_rate s of audio, 1 ms for full-speed devices with bInterval of 1 frame.
+ * The packets are spread over up to UAC_LATENCY_MAX_URBS URBs, so one URB is processed while the others are in flight.
+ * Endpoints with large max packet size use more shorter URBs, to keep the buffer of one URB within UAC_URB_MAX_BYTES.
+ *
+ * @param[in] iface       Pointer to Interface structure, with selected alternate setting and packet rate
+ * @param[in] latency_ms  Audio queued in the URBs in ms, 0 for Kconfig defaults
+ */
+static void uac_host_interface_set_latency(uac_iface_t *iface, uint16_t latency_ms)
+{
+    if (latency_ms == 0) {
+        iface->xfer_num = CONFIG_UAC_NUM_ISOC_URBS;
+        iface->packet_num = CONFIG_UAC_NUM_PACKETS_PER_URB;
+        return;
+    }
+    const uac_iface_alt_t *iface_alt = &iface->iface_alt[iface->cur_alt];
+    // at least two URBs, one of them is always queued
+    const uint32_t packets = MAX((latency_ms * iface->packet_rate + 999) / 1000, 2);
+    uint32_t xfer_num = MIN(packets, UAC_LATENCY_MAX_URBS);
+    uint32_t packet_num = (packets + xfer_num - 1) / xfer_num;
+    const uint32_t max_packet_num = MAX(UAC_URB_MAX_BYTES / iface_alt->ep_mps, 1);
+    if (packet_num > max_packet_num) {
+        packet_num = max_packet_num;
+        xfer_num = MIN((packets + packet_num - 1) / packet_num, UAC_LATENCY_MAX_URBS_CAPPED);
+    }
+    iface->xfer_num = xfer_num;
+    iface->packet_num = packet_num;
+    ESP_LOGD(TAG, "Latency %"PRIu16" ms: %"PRIu32" URBs of %"PRIu32" packets", latency_ms, xfer_num, packet_num);
+}
+
+/**
+ * @brief Get the sample frequency of the alternate setting, which is the nearest to the requested one
+ *
+ * @param[in] alt         Pointer to alternate setting
+ * @param[in] freq        Requested sample frequency
+ * @return Supported sample frequency
+ */
+static uint32_t uac_host_alt_nearest_freq(const uac_iface_alt_t *alt, uint32_t freq)
+{
+    const uac_host_dev_alt_param_t *param = &alt->dev_alt_param;
+    if (param->sample_freq_type == 0) {
+        return MIN(MAX(freq, param->sample_freq_lower), param->sample_freq_upper);
+    }
+    uint32_t nearest = param->sample_freq[0];
+    for (int i = 1; i < param->sample_freq_type; i++) {
+        if (abs((int32_t)(param->sample_freq[i] - freq)) < abs((int32_t)(nearest - freq))) {
+            nearest = param->sample_freq[i];
+        }
+    }
+    return nearest;
+}
+
 // ------------------------ USB UAC Host driver API ----------------------------
 
 esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const uac_host_stream_config_t *stream_config)
@@ -2226,6 +3732,8 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
     UAC_RETURN_ON_FALSE(stream_config->bit_resolution, ESP_ERR_INVALID_ARG, "Invalid bit resolution");
     UAC_RETURN_ON_FALSE(stream_config->channels, ESP_ERR_INVALID_ARG, "Invalid number of channels");
     UAC_RETURN_ON_FALSE(stream_config->sample_freq, ESP_ERR_INVALID_ARG, "Invalid sample frequency");
+    UAC_RETURN_ON_FALSE(!(stream_config->flags & FLAG_STREAM_SOFT_VOLUME) || stream_config->bit_resolution == 16 ||
+                        stream_config->bit_resolution == 32, ESP_ERR_NOT_SUPPORTED, "Software volume needs 16 or 32-bit samples");
 
     // get the mutex first to change the device/interface state
     UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
@@ -2262,19 +3770,55 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
         }
     }
 
+    // if no alt setting supports the sample frequency, stream at the nearest one and convert the rate
+    if (iface->cur_alt == UINT8_MAX && (stream_config->flags & FLAG_STREAM_SAMPLE_RATE_CONVERT) &&
+            stream_config->bit_resolution == 16) {
+        uint32_t best_diff = UINT32_MAX;
+        for (int i = 0; i < iface->dev_info.iface_alt_num; i++) {
+            if (iface->iface_alt[i].dev_alt_param.channels == stream_config->channels &&
+                    iface->iface_alt[i].dev_alt_param.bit_resolution == stream_config->bit_resolution) {
+                const uint32_t freq = uac_host_alt_nearest_freq(&iface->iface_alt[i], stream_config->sample_freq);
+                const uint32_t diff = abs((int32_t)(freq - stream_config->sample_freq));
+                if (diff < best_diff) {
+                    best_diff = diff;
+                    iface->cur_alt = i;
+                    iface->iface_alt[i].cur_sampling_freq = freq;
+                }
+            }
+        }
+    }
+
     UAC_GOTO_ON_FALSE(iface->cur_alt != UINT8_MAX, ESP_ERR_NOT_FOUND, "No suitable alt setting found");
 
+    // packets are sent every 2^(bInterval-1) frames at full speed, microframes at high speed
+    const uint8_t interval = MIN(MAX(iface->iface_alt[iface->cur_alt].interval, 1), 4);
+    iface->packet_rate = ((iface->parent->speed == USB_SPEED_HIGH) ? 8000 : 1000) >> (interval - 1);
     // enqueue multiple transfers to make sure the data is not lost
-    iface->xfer_num = CONFIG_UAC_NUM_ISOC_URBS;
-    iface->packet_num = CONFIG_UAC_NUM_PACKETS_PER_URB;
-    iface->packet_size = iface->iface_alt[iface->cur_alt].cur_sampling_freq * stream_config->channels * stream_config->bit_resolution / 8 / 1000;
-    iface->flags |= stream_config->flags;
-    // if the packet size is not an integer, we need to add one more byte
-    if (iface->iface_alt[iface->cur_alt].cur_sampling_freq * stream_config->channels * stream_config->bit_resolution / 8 % 1000) {
-        ESP_LOGD(TAG, "packet_size %" PRIu32 " is not an integer, add one more byte", iface->packet_size);
-        iface->packet_size++;
+    uac_host_interface_set_latency(iface, stream_config->latency_ms);
+    // keep internal flags, stream flags of the previous start are replaced
+    iface->flags = (iface->flags & ~((1 << INTERFACE_FLAGS_OFFSET) - 1)) | stream_config->flags;
+    memset(&iface->stats, 0, sizeof(iface->stats));
+    memset(&iface->clock, 0, sizeof(iface->clock));
+    iface->clock_freq = 0;
+    iface->frame_bytes = stream_config->channels * stream_config->bit_resolution / 8;
+    // packets carry whole frames, with fractional rate (eg. 44.1 frames per packet) the largest packet has one more frame
+    const uint32_t packet_frames = (iface->iface_alt[iface->cur_alt].cur_sampling_freq + iface->packet_rate - 1) / iface->packet_rate;
+    iface->packet_size = packet_frames * iface->frame_bytes;
+    ESP_LOGD(TAG, "packet_size %" PRIu32 ", %" PRIu32 " frames", iface->packet_size, packet_frames);
+    UAC_GOTO_ON_FALSE(iface->packet_size <= iface->iface_alt[iface->cur_alt].ep_mps, ESP_ERR_NOT_SUPPORTED,
+                      "Packet size exceeds endpoint max packet size");
+    iface->nominal_rate = ((uint64_t)iface->iface_alt[iface->cur_alt].cur_sampling_freq << UAC_RATE_FRAC_BITS) / iface->packet_rate;
+
+    const uint32_t dev_freq = iface->iface_alt[iface->cur_alt].cur_sampling_freq;
+    if (dev_freq != stream_config->sample_freq) {
+        ESP_LOGI(TAG, "Convert sample frequency %"PRIu32" to device %"PRIu32, stream_config->sample_freq, dev_freq);
+        const bool rx = (iface->dev_info.type == UAC_STREAM_RX);
+        UAC_GOTO_ON_ERROR(uac_src_create(rx ? dev_freq : stream_config->sample_freq, rx ? stream_config->sample_freq : dev_freq,
+                                         stream_config->channels, UAC_SRC_CHUNK_FRAMES, &iface->src),
+                          "Unable to create sample rate converter");
+        iface->src_buf = malloc(UAC_SRC_CHUNK_FRAMES * iface->frame_bytes);
+        UAC_GOTO_ON_FALSE(iface->src_buf, ESP_ERR_NO_MEM, "Unable to allocate sample rate converter buffer");
     }
-    assert(iface->packet_size <= iface->iface_alt[iface->cur_alt].ep_mps);
 
     // Claim Interface and prepare transfer
     UAC_GOTO_ON_ERROR(uac_host_interface_claim_and_prepare_transfer(iface), "Unable to claim Interface");
@@ -2283,13 +3827,20 @@ esp_err_t uac_host_device_start(uac_host_device_handle_t uac_dev_handle, const u
     if (!(iface->flags & FLAG_STREAM_SUSPEND_AFTER_START)) {
         UAC_GOTO_ON_ERROR(uac_host_interface_resume(iface), "Unable to enable UAC Interface");
     }
+    iface->session.stream_started = true;
+    iface->session.stream_config = *stream_config;
     uac_host_interface_unlock(iface);
+    UAC_ENUM_MARK(iface->parent->addr, "started");
     return ESP_OK;
 
 fail:
     if (iface_claimed) {
         uac_host_interface_release_and_free_transfer(iface);
     }
+    uac_src_delete(iface->src);
+    iface->src = NULL;
+    free(iface->src_buf);
+    iface->src_buf = NULL;
     uac_host_interface_unlock(iface);
     return ret;
 }
@@ -2353,6 +3904,7 @@ esp_err_t uac_host_device_stop(uac_host_device_handle_t uac_dev_handle)
     if (UAC_INTERFACE_STATE_READY == iface->state) {
         UAC_GOTO_ON_ERROR(uac_host_interface_release_and_free_transfer(iface), "Unable to release UAC Interface");
     }
+    iface->session.stream_started = false;
 
     uac_host_interface_unlock(iface);
     return ESP_OK;
@@ -2362,6 +3914,112 @@ fail:
     return ret;
 }
 
+/**
+ * @brief Submit free TX transfers, if there are data in the ringbuffer
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_ERR_INVALID_STATE if the interface changed to inactive state
+ */
+static esp_err_t uac_host_tx_xfer_submit_free(uac_iface_t *iface)
+{
+    bool lock_missed;
+    do {
+        lock_missed = false;
+        // While streaming, all transfers are usually submitted and this is a single load
+        uint32_t idle_mask = __atomic_load_n(&iface->tx_idle_mask, __ATOMIC_ACQUIRE);
+        // a transfer is parked again if the data do not fill it, so each transfer is tried once at most,
+        // unless a transfer was parked because this function held the lock
+        for (int n = 0; n < iface->xfer_num && idle_mask && _ring_buffer_get_len(iface->ringbuf); n++) {
+            // if interface state changed to inactive during blocking write
+            // we need to return invalid state to safely exit the write function
+            if (UAC_INTERFACE_STATE_ACTIVE != iface->state) {
+                return ESP_ERR_INVALID_STATE;
+            }
+            const int i = __builtin_ctz(idle_mask);
+            const uint32_t bit = 1UL << i;
+            // claim the transfer, another writer may have taken it
+            if (__atomic_fetch_and(&iface->tx_idle_mask, ~bit, __ATOMIC_ACQUIRE) & bit) {
+                usb_transfer_t *out_xfer = iface->free_xfer_list[i];
+                iface->free_xfer_list[i] = NULL;
+                iface->xfer_list[i] = out_xfer;
+                out_xfer->status = USB_TRANSFER_STATUS_COMPLETED;
+                lock_missed |= stream_tx_xfer_submit(out_xfer);
+            }
+            idle_mask = __atomic_load_n(&iface->tx_idle_mask, __ATOMIC_ACQUIRE);
+        }
+    } while (lock_missed);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Read RX data from the ringbuffer through the sample rate converter
+ *
+ * @param[in]  iface       Pointer to Interface structure
+ * @param[out] data        Buffer for frames at the stream rate
+ * @param[in]  size        Size of the buffer
+ * @param[out] bytes_read  Number of bytes read
+ * @param[in]  timeout     Ticks to wait for the first data
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_FAIL if no data were received until timeout
+ */
+static esp_err_t uac_host_src_read(uac_iface_t *iface, uint8_t *data, uint32_t size, uint32_t *bytes_read, uint32_t timeout)
+{
+    const size_t frame_bytes = iface->frame_bytes;
+    const size_t frames = size / frame_bytes;
+    size_t done = uac_src_read(iface->src, data, frames);
+    bool wait = (done == 0);
+    while (done < frames) {
+        if (wait && !_ring_buffer_wait(iface->ringbuf, true, frame_bytes, timeout)) {
+            break;
+        }
+        wait = false;
+        const size_t in_frames = MIN(_ring_buffer_get_len(iface->ringbuf) / frame_bytes,
+                                     MIN(uac_src_write_free(iface->src), UAC_SRC_CHUNK_FRAMES));
+        if (in_frames == 0) {
+            break;
+        }
+        size_t in_len = 0;
+        _ring_buffer_pop(iface->ringbuf, iface->src_buf, in_frames * frame_bytes, &in_len, 0);
+        uac_src_write(iface->src, iface->src_buf, in_len / frame_bytes);
+        done += uac_src_read(iface->src, data + done * frame_bytes, frames - done);
+        // the converter needs a few more frames before the first output
+        wait = (done == 0);
+    }
+    *bytes_read = done * frame_bytes;
+    return done ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * @brief Write TX data into the ringbuffer through the sample rate converter
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] data        Frames at the stream rate
+ * @param[in] size        Size of the data, incomplete frame at the end is dropped
+ * @param[in] timeout     Ticks to wait for free space in the ringbuffer, for each converted chunk
+ * @return esp_err_t
+ * - ESP_OK on success
+ * - ESP_FAIL if the ringbuffer is full until timeout
+ */
+static esp_err_t uac_host_src_write(uac_iface_t *iface, const uint8_t *data, uint32_t size, uint32_t timeout)
+{
+    const size_t frame_bytes = iface->frame_bytes;
+    const size_t frames = size / frame_bytes;
+    size_t done = 0;
+    while (done < frames) {
+        done += uac_src_write(iface->src, data + done * frame_bytes, frames - done);
+        size_t out_frames;
+        while ((out_frames = uac_src_read(iface->src, iface->src_buf, UAC_SRC_CHUNK_FRAMES)) > 0) {
+            UAC_RETURN_ON_ERROR(_ring_buffer_push(iface->ringbuf, iface->src_buf, out_frames * frame_bytes, timeout),
+                                "Unable to write converted data");
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t uac_host_device_read(uac_host_device_handle_t uac_dev_handle, uint8_t *data, uint32_t size, uint32_t *bytes_read, uint32_t timeout)
 {
     uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
@@ -2376,11 +4034,19 @@ esp_err_t uac_host_device_read(uac_host_device_handle_t uac_dev_handle, uint8_t
     }
     uac_host_interface_unlock(iface);
 
-    size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-    if (data_len > size) {
-        data_len = size;
+    // the RX callback drops the oldest data only while the reader does not hold the buffer
+    xSemaphoreTake(iface->ringbuf->consumer_lock, portMAX_DELAY);
+    esp_err_t ret;
+    if (iface->src) {
+        ret = uac_host_src_read(iface, data, size, bytes_read, timeout);
+    } else {
+        size_t data_len = _ring_buffer_get_len(iface->ringbuf);
+        if (data_len > size) {
+            data_len = size;
+        }
+        ret = _ring_buffer_pop(iface->ringbuf, data, data_len, (size_t *)bytes_read, timeout);
     }
-    esp_err_t ret = _ring_buffer_pop(iface->ringbuf, data, data_len, (size_t *)bytes_read, timeout);
+    xSemaphoreGive(iface->ringbuf->consumer_lock);
 
     if (ESP_OK != ret) {
         ESP_LOGD(TAG, "RX Ringbuffer read failed");
@@ -2408,41 +4074,304 @@ esp_err_t uac_host_device_write(uac_host_device_handle_t uac_dev_handle, uint8_t
     }
     uac_host_interface_unlock(iface);
 
-    esp_err_t ret = _ring_buffer_push(iface->ringbuf, data, size, timeout);
+    esp_err_t ret = iface->src ? uac_host_src_write(iface, data, size, timeout) :
+                    _ring_buffer_push(iface->ringbuf, data, size, timeout);
 
     if (ESP_OK != ret) {
         ESP_LOGD(TAG, "TX Ringbuffer write failed");
         return ret;
     }
 
-    // We need to submit the transfer if there is free transfer in the list
-    for (int i = 0; i < iface->xfer_num; i++) {
-        UAC_ENTER_CRITICAL();
-        if (iface->free_xfer_list[i]) {
-            size_t data_len = _ring_buffer_get_len(iface->ringbuf);
-            if (data_len == 0) {
-                goto exit_critical;
-            }
-            // if interface state changed to inactive during blocking write
-            // we need to return invalid state to safely exit the write function
-            if (UAC_INTERFACE_STATE_ACTIVE != iface->state) {
-                ret = ESP_ERR_INVALID_STATE;
-                goto exit_critical;
-            }
-            iface->xfer_list[i] = iface->free_xfer_list[i];
-            iface->free_xfer_list[i] = NULL;
-            iface->xfer_list[i]->status = USB_TRANSFER_STATUS_COMPLETED;
-            UAC_EXIT_CRITICAL();
-            stream_tx_xfer_submit(iface->xfer_list[i]);
-            UAC_ENTER_CRITICAL();
+    return uac_host_tx_xfer_submit_free(iface);
+}
+
+/**
+ * @brief Check that the zero-copy call is made on an active interface of the given direction
+ *
+ * @param[in] iface       Pointer to Interface structure
+ * @param[in] type        Stream direction the call belongs to
+ * @return esp_err_t
+ */
+static esp_err_t uac_host_interface_check_active(uac_iface_t *iface, uac_host_stream_t type)
+{
+    UAC_RETURN_ON_FALSE(iface->dev_info.type == type, ESP_ERR_INVALID_ARG, "Wrong stream direction");
+    UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
+    const bool active = (UAC_INTERFACE_STATE_ACTIVE == iface->state);
+    uac_host_interface_unlock(iface);
+    return active ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uac_host_device_read_acquire(uac_host_device_handle_t uac_dev_handle, uint8_t **data, uint32_t *size, uint32_t timeout)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(data);
+    UAC_RETURN_ON_INVALID_ARG(size);
+    *data = NULL;
+    *size = 0;
+    UAC_RETURN_ON_ERROR(uac_host_interface_check_active(iface, UAC_STREAM_RX), "Unable to acquire RX data");
+    UAC_RETURN_ON_FALSE(!iface->src, ESP_ERR_NOT_SUPPORTED, "Not available with sample rate conversion");
+    UAC_RETURN_ON_FALSE(!(iface->flags & FLAG_STREAM_RX_DROP_OLDEST), ESP_ERR_NOT_SUPPORTED, "Not available with drop oldest policy");
+
+    if (!_ring_buffer_wait(iface->ringbuf, true, 1, timeout)) {
+        ESP_LOGD(TAG, "RX Ringbuffer acquire timeout");
+        return ESP_FAIL;
+    }
+    uac_ring_seg_t seg[2];
+    _ring_buffer_peek_data(iface->ringbuf, seg);
+    *data = seg[0].data;
+    *size = seg[0].len;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_device_read_release(uac_host_device_handle_t uac_dev_handle, uint32_t size)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_FALSE(iface->dev_info.type == UAC_STREAM_RX, ESP_ERR_INVALID_ARG, "Wrong stream direction");
+    UAC_RETURN_ON_FALSE(iface->ringbuf, ESP_ERR_INVALID_STATE, "Interface not opened");
+
+    // the data may have been flushed by suspend of the interface meanwhile
+    xSemaphoreTake(iface->ringbuf->consumer_lock, portMAX_DELAY);
+    const bool acquired = (size <= _ring_buffer_get_len(iface->ringbuf));
+    if (acquired) {
+        _ring_buffer_consume(iface->ringbuf, size);
+    }
+    xSemaphoreGive(iface->ringbuf->consumer_lock);
+    UAC_RETURN_ON_FALSE(acquired, ESP_ERR_INVALID_SIZE, "Release more than acquired");
+    return ESP_OK;
+}
+
+esp_err_t uac_host_device_write_acquire(uac_host_device_handle_t uac_dev_handle, uint8_t **data, uint32_t *size, uint32_t timeout)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(data);
+    UAC_RETURN_ON_INVALID_ARG(size);
+    *data = NULL;
+    *size = 0;
+    UAC_RETURN_ON_ERROR(uac_host_interface_check_active(iface, UAC_STREAM_TX), "Unable to acquire TX buffer");
+    UAC_RETURN_ON_FALSE(!iface->src, ESP_ERR_NOT_SUPPORTED, "Not available with sample rate conversion");
+
+    if (!_ring_buffer_wait(iface->ringbuf, false, 1, timeout)) {
+        ESP_LOGD(TAG, "TX Ringbuffer acquire timeout");
+        return ESP_FAIL;
+    }
+    uac_ring_seg_t seg[2];
+    _ring_buffer_peek_free(iface->ringbuf, seg);
+    *data = seg[0].data;
+    *size = seg[0].len;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_device_write_commit(uac_host_device_handle_t uac_dev_handle, uint32_t size)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_FALSE(iface->dev_info.type == UAC_STREAM_TX, ESP_ERR_INVALID_ARG, "Wrong stream direction");
+    UAC_RETURN_ON_FALSE(iface->ringbuf, ESP_ERR_INVALID_STATE, "Interface not opened");
+    UAC_RETURN_ON_FALSE(size <= _ring_buffer_get_free(iface->ringbuf), ESP_ERR_INVALID_SIZE, "Commit more than acquired");
+
+    _ring_buffer_produce(iface->ringbuf, size);
+    return uac_host_tx_xfer_submit_free(iface);
+}
+
+esp_err_t uac_host_device_set_encoder(uac_host_device_handle_t uac_dev_handle, const uac_host_encoder_config_t *config)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_FALSE(iface->dev_info.type == UAC_STREAM_RX, ESP_ERR_INVALID_ARG, "Wrong stream direction");
+    UAC_RETURN_ON_FALSE(!config || (config->encode && config->block_frames), ESP_ERR_INVALID_ARG, "Invalid encoder configuration");
+
+    UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
+    esp_err_t ret = ESP_OK;
+    UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_READY == iface->state || UAC_INTERFACE_STATE_ACTIVE == iface->state),
+                      ESP_ERR_INVALID_STATE, "Interface not started");
+    UAC_GOTO_ON_FALSE(!iface->src, ESP_ERR_NOT_SUPPORTED, "Not available with sample rate conversion");
+    uac_host_interface_encoder_remove(iface);
+    if (config) {
+        const size_t block_bytes = config->block_frames * iface->frame_bytes;
+        UAC_GOTO_ON_FALSE(block_bytes <= iface->ringbuf->size, ESP_ERR_INVALID_SIZE, "Block exceeds buffer size");
+        uint8_t *enc_buf = malloc(block_bytes);
+        UAC_GOTO_ON_FALSE(enc_buf, ESP_ERR_NO_MEM, "Unable to allocate encoder buffer");
+        xSemaphoreTake(iface->ringbuf->consumer_lock, portMAX_DELAY);
+        iface->encoder = *config;
+        iface->enc_buf = enc_buf;
+        // the buffer level is reported for each block
+        iface->enc_saved_threshold = iface->ringbuf_threshold;
+        iface->ringbuf_threshold = block_bytes;
+        xSemaphoreGive(iface->ringbuf->consumer_lock);
+    }
+
+    uac_host_interface_unlock(iface);
+    return ESP_OK;
+
+fail:
+    uac_host_interface_unlock(iface);
+    return ret;
+}
+
+esp_err_t uac_host_device_read_encoded(uac_host_device_handle_t uac_dev_handle, uint8_t *data, size_t size, size_t *data_len,
+                                       uint32_t timeout)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(data);
+    UAC_RETURN_ON_INVALID_ARG(data_len);
+    *data_len = 0;
+    UAC_RETURN_ON_ERROR(uac_host_interface_check_active(iface, UAC_STREAM_RX), "Unable to read RX data");
+    UAC_RETURN_ON_FALSE(iface->enc_buf, ESP_ERR_INVALID_STATE, "No encoder set");
+
+    const size_t block_bytes = iface->encoder.block_frames * iface->frame_bytes;
+    if (!_ring_buffer_wait(iface->ringbuf, true, block_bytes, timeout)) {
+        ESP_LOGD(TAG, "RX Ringbuffer encode timeout");
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(iface->ringbuf->consumer_lock, portMAX_DELAY);
+    uac_ring_seg_t seg[2];
+    if (_ring_buffer_peek_data(iface->ringbuf, seg) < block_bytes) {
+        // the oldest data were dropped before the lock was taken
+        xSemaphoreGive(iface->ringbuf->consumer_lock);
+        return ESP_FAIL;
+    }
+    const uint8_t *pcm = seg[0].data;
+    if (seg[0].len < block_bytes) {
+        memcpy(iface->enc_buf, seg[0].data, seg[0].len);
+        memcpy(iface->enc_buf + seg[0].len, seg[1].data, block_bytes - seg[0].len);
+        pcm = iface->enc_buf;
+    }
+    esp_err_t ret = iface->encoder.encode(iface->encoder.ctx, pcm, iface->encoder.block_frames, data, size, data_len);
+    _ring_buffer_consume(iface->ringbuf, block_bytes);
+    xSemaphoreGive(iface->ringbuf->consumer_lock);
+    return ret;
+}
+
+esp_err_t uac_host_device_read_converted(uac_host_device_handle_t uac_dev_handle, const uac_host_convert_config_t *config,
+                                         void *const *out, uint32_t frames, uint32_t *frames_read, uint32_t timeout)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(out);
+    UAC_RETURN_ON_FALSE(frames, ESP_ERR_INVALID_ARG, "Zero frames");
+    UAC_RETURN_ON_INVALID_ARG(frames_read);
+    *frames_read = 0;
+    UAC_RETURN_ON_ERROR(uac_host_interface_check_active(iface, UAC_STREAM_RX), "Unable to read RX data");
+    UAC_RETURN_ON_FALSE(!iface->src, ESP_ERR_NOT_SUPPORTED, "Not available with sample rate conversion");
+    const uac_host_dev_alt_param_t *alt_param = &iface->iface_alt[iface->cur_alt].dev_alt_param;
+    const uint8_t channels = alt_param->channels;
+    const uint8_t sample_bytes = alt_param->bit_resolution / 8;
+    UAC_RETURN_ON_ERROR(uac_convert_check(channels, sample_bytes, config), "Unable to convert RX data");
+
+    const size_t frame_bytes = iface->frame_bytes;
+    if (!_ring_buffer_wait(iface->ringbuf, true, frame_bytes, timeout)) {
+        ESP_LOGD(TAG, "RX Ringbuffer convert timeout");
+        return ESP_FAIL;
+    }
+    xSemaphoreTake(iface->ringbuf->consumer_lock, portMAX_DELAY);
+    uac_ring_seg_t seg[2];
+    const uint32_t avail = MIN(frames, _ring_buffer_peek_data(iface->ringbuf, seg) / frame_bytes);
+    if (avail == 0) {
+        // the oldest data were dropped before the lock was taken
+        xSemaphoreGive(iface->ringbuf->consumer_lock);
+        return ESP_FAIL;
+    }
+    uint32_t done = MIN(avail, seg[0].len / frame_bytes);
+    uac_host_pcm_convert(seg[0].data, done, channels, sample_bytes, config, out, 0);
+    if (done < avail) {
+        // a frame split by the wrap-around of the buffer is joined on the stack
+        const size_t split = seg[0].len - done * frame_bytes;
+        if (split) {
+            uint8_t frame[UAC_HOST_CONVERT_MAX_CHANNELS * 4];
+            memcpy(frame, seg[0].data + done * frame_bytes, split);
+            memcpy(frame + split, seg[1].data, frame_bytes - split);
+            uac_host_pcm_convert(frame, 1, channels, sample_bytes, config, out, done);
+            done++;
         }
-exit_critical:
-        UAC_EXIT_CRITICAL();
+        const size_t skip = split ? frame_bytes - split : 0;
+        uac_host_pcm_convert(seg[1].data + skip, avail - done, channels, sample_bytes, config, out, done);
+        done = avail;
     }
+    _ring_buffer_consume(iface->ringbuf, done * frame_bytes);
+    xSemaphoreGive(iface->ringbuf->consumer_lock);
+    _ring_buffer_notify(iface->ringbuf);
+    *frames_read = done;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_device_set_meter(uac_host_device_handle_t uac_dev_handle, const uac_host_meter_config_t *config)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_FALSE(iface->dev_info.type == UAC_STREAM_RX, ESP_ERR_INVALID_ARG, "Wrong stream direction");
+    UAC_RETURN_ON_FALSE(!config || config->window_frames, ESP_ERR_INVALID_ARG, "Invalid meter configuration");
+
+    UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
+    esp_err_t ret = ESP_OK;
+    UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_READY == iface->state || UAC_INTERFACE_STATE_ACTIVE == iface->state),
+                      ESP_ERR_INVALID_STATE, "Interface not started");
+    const uac_host_dev_alt_param_t *alt_param = &iface->iface_alt[iface->cur_alt].dev_alt_param;
+    UAC_GOTO_ON_FALSE(alt_param->channels <= UAC_HOST_METER_MAX_CHANNELS, ESP_ERR_NOT_SUPPORTED, "Too many channels");
+    UAC_GOTO_ON_FALSE(alt_param->bit_resolution == 16 || alt_param->bit_resolution == 24 || alt_param->bit_resolution == 32,
+                      ESP_ERR_NOT_SUPPORTED, "Only 16, 24 and 32-bit samples supported");
+    uac_host_interface_meter_set(iface, config);
 
+fail:
+    uac_host_interface_unlock(iface);
     return ret;
 }
 
+esp_err_t uac_host_device_get_level(uac_host_device_handle_t uac_dev_handle, uac_host_meter_level_t *level)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(level);
+
+    UAC_IFACE_ENTER_CRITICAL(iface);
+    const bool set = (iface->meter_config.window_frames != 0);
+    *level = iface->meter_level;
+    UAC_IFACE_EXIT_CRITICAL(iface);
+    return set ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t uac_host_device_get_stream_stats(uac_host_device_handle_t uac_dev_handle, uac_host_stream_stats_t *stats)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(stats);
+
+    UAC_IFACE_ENTER_CRITICAL(iface);
+    *stats = iface->stats;
+    UAC_IFACE_EXIT_CRITICAL(iface);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_device_get_stream_clock(uac_host_device_handle_t uac_dev_handle, uac_host_stream_clock_t *clock)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(clock);
+    UAC_RETURN_ON_FALSE(UAC_STREAM_RX == iface->dev_info.type, ESP_ERR_INVALID_ARG, "Not RX stream");
+
+    UAC_IFACE_ENTER_CRITICAL(iface);
+    *clock = iface->clock;
+    UAC_IFACE_EXIT_CRITICAL(iface);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_device_get_clock_drift(uac_host_device_handle_t uac_dev_handle, int32_t *drift_ppm)
+{
+    uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
+    UAC_RETURN_ON_INVALID_ARG(iface);
+    UAC_RETURN_ON_INVALID_ARG(drift_ppm);
+    UAC_RETURN_ON_FALSE(UAC_INTERFACE_STATE_ACTIVE == iface->state, ESP_ERR_INVALID_STATE, "Interface not active");
+    UAC_RETURN_ON_FALSE(iface->fb_xfer, ESP_ERR_NOT_SUPPORTED, "No feedback endpoint");
+
+    const uint32_t fb_rate = iface->fb_rate;
+    UAC_RETURN_ON_FALSE(fb_rate, ESP_ERR_INVALID_STATE, "No feedback received yet");
+    *drift_ppm = (int32_t)(((int64_t)fb_rate - iface->nominal_rate) * 1000000 / iface->nominal_rate);
+    return ESP_OK;
+}
+
 esp_err_t uac_host_get_device_info(uac_host_device_handle_t uac_dev_handle, uac_host_dev_info_t *uac_dev_info)
 {
     uac_iface_t *iface = get_iface_by_handle(uac_dev_handle);
@@ -2462,7 +4391,13 @@ esp_err_t uac_host_device_set_mute(uac_host_device_handle_t uac_dev_handle, bool
     UAC_GOTO_ON_FALSE(UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state,
                       ESP_ERR_INVALID_STATE, "device not ready or active");
 
-    UAC_GOTO_ON_ERROR(uac_cs_request_set_mute(iface, mute), "Unable to set mute");
+    if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+        uac_gain_set_mute(&iface->soft_gain, mute);
+    } else {
+        UAC_GOTO_ON_ERROR(uac_cs_request_set_mute(iface, mute), "Unable to set mute");
+    }
+    iface->session.mute_set = true;
+    iface->session.mute = mute;
     ESP_LOGI(TAG, "%s Interface %d-%d", mute ? "Mute" : "Unmute", iface->dev_info.iface_num, iface->cur_alt + 1);
     uac_host_interface_unlock(iface);
     return ESP_OK;
@@ -2483,7 +4418,11 @@ esp_err_t uac_host_device_get_mute(uac_host_device_handle_t uac_dev_handle, bool
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state),
                       ESP_ERR_INVALID_STATE, "device not ready or active");
 
-    UAC_GOTO_ON_ERROR(uac_cs_request_get_mute(iface, mute), "Unable to get mute");
+    if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+        *mute = iface->soft_gain.mute;
+    } else {
+        UAC_GOTO_ON_ERROR(uac_cs_request_get_mute(iface, mute), "Unable to get mute");
+    }
     uac_host_interface_unlock(iface);
     return ESP_OK;
 
@@ -2503,16 +4442,24 @@ esp_err_t uac_host_device_set_volume(uac_host_device_handle_t uac_dev_handle, ui
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state),
                       ESP_ERR_INVALID_STATE, "device not ready or active");
 
-    // Calculate target volume in float to avoid the int16_t calculation overflow
-    float volume_db_f = _volume_db_i16_2_f(iface->vol_min_db) + (_volume_db_i16_2_f(iface->vol_max_db) - _volume_db_i16_2_f(iface->vol_min_db)) * (float)volume / 100.0f;
-    // Round to the nearest float value based the vol_res_db
-    volume_db_f = roundf(volume_db_f / _volume_db_i16_2_f(iface->vol_res_db)) * _volume_db_i16_2_f(iface->vol_res_db);
-    // Convert back to 16-bit value
-    const int16_t volume_db = _volume_db_f_2_i16(volume_db_f);
-
-    UAC_GOTO_ON_ERROR(uac_cs_request_set_volume(iface, volume_db), "Unable to set volume");
+    if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+        iface->soft_volume_db = uac_gain_percent_to_db(volume);
+        uac_gain_set_volume(&iface->soft_gain, uac_gain_from_db(iface->soft_volume_db));
+    } else {
+        // Calculate target volume in float to avoid the int16_t calculation overflow
+        float volume_db_f = _volume_db_i16_2_f(iface->vol_min_db) + (_volume_db_i16_2_f(iface->vol_max_db) - _volume_db_i16_2_f(iface->vol_min_db)) * (float)volume / 100.0f;
+        // Round to the nearest float value based the vol_res_db
+        volume_db_f = roundf(volume_db_f / _volume_db_i16_2_f(iface->vol_res_db)) * _volume_db_i16_2_f(iface->vol_res_db);
+        // Convert back to 16-bit value
+        const int16_t volume_db = _volume_db_f_2_i16(volume_db_f);
+
+        UAC_GOTO_ON_ERROR(uac_cs_request_set_volume(iface, volume_db), "Unable to set volume");
+    }
     // Backup the volume value for the get volume function
     iface->cur_vol = volume;
+    iface->session.volume_set = true;
+    iface->session.volume_is_db = false;
+    iface->session.volume = volume;
     ESP_LOGI(TAG, "Set volume %d%%, Interface %d-%d", volume, iface->dev_info.iface_num, iface->cur_alt + 1);
     uac_host_interface_unlock(iface);
     return ESP_OK;
@@ -2542,6 +4489,13 @@ esp_err_t uac_host_device_get_volume(uac_host_device_handle_t uac_dev_handle, ui
         return ESP_OK;
     }
 
+    // Software volume set in dB, 1 % is -60 dB
+    if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+        *volume = (uint8_t)MAX(0, 100 + (int32_t)iface->soft_volume_db * 99 / (60 * 256));
+        uac_host_interface_unlock(iface);
+        return ESP_OK;
+    }
+
     // Otherwise, get the volume from the device
     // Get volume range, calculate in dB float
     int16_t volume_db = 0;
@@ -2567,9 +4521,20 @@ esp_err_t uac_host_device_set_volume_db(uac_host_device_handle_t uac_dev_handle,
     UAC_RETURN_ON_ERROR(uac_host_interface_try_lock(iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state),
                       ESP_ERR_INVALID_STATE, "device not ready or active");
-    // Check if the volume is within the range
-    UAC_GOTO_ON_FALSE((volume_db >= iface->vol_min_db && volume_db <= iface->vol_max_db), ESP_ERR_INVALID_ARG, "Invalid volume value");
-    UAC_GOTO_ON_ERROR(uac_cs_request_set_volume(iface, volume_db), "Unable to set volume");
+    if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+        // Software gain can only attenuate
+        UAC_GOTO_ON_FALSE(volume_db <= 0, ESP_ERR_INVALID_ARG, "Invalid volume value");
+        iface->soft_volume_db = volume_db;
+        iface->cur_vol = 0;
+        uac_gain_set_volume(&iface->soft_gain, uac_gain_from_db(volume_db));
+    } else {
+        // Check if the volume is within the range
+        UAC_GOTO_ON_FALSE((volume_db >= iface->vol_min_db && volume_db <= iface->vol_max_db), ESP_ERR_INVALID_ARG, "Invalid volume value");
+        UAC_GOTO_ON_ERROR(uac_cs_request_set_volume(iface, volume_db), "Unable to set volume");
+    }
+    iface->session.volume_set = true;
+    iface->session.volume_is_db = true;
+    iface->session.volume = volume_db;
     uac_host_interface_unlock(iface);
     return ESP_OK;
 
@@ -2589,7 +4554,11 @@ esp_err_t uac_host_device_get_volume_db(uac_host_device_handle_t uac_dev_handle,
     UAC_GOTO_ON_FALSE((UAC_INTERFACE_STATE_ACTIVE == iface->state || UAC_INTERFACE_STATE_READY == iface->state),
                       ESP_ERR_INVALID_STATE, "device not ready or active");
 
-    UAC_GOTO_ON_ERROR(uac_cs_request_get_volume(iface, volume_db), "Unable to get volume");
+    if (iface->flags & FLAG_STREAM_SOFT_VOLUME) {
+        *volume_db = iface->soft_volume_db;
+    } else {
+        UAC_GOTO_ON_ERROR(uac_cs_request_get_volume(iface, volume_db), "Unable to get volume");
+    }
     uac_host_interface_unlock(iface);
     return ESP_OK;
 
@@ -2597,3 +4566,142 @@ fail:
     uac_host_interface_unlock(iface);
     return ret;
 }
+
+/**
+ * @brief Check that the duplex session handle belongs to opened interfaces
+ *
+ * @param[in] duplex      Duplex session handle
+ * @return true if the session is valid
+ */
+static bool uac_host_duplex_is_valid(const uac_duplex_t *duplex)
+{
+    return duplex && get_iface_by_handle(duplex->rx_iface) && get_iface_by_handle(duplex->tx_iface) &&
+           duplex->rx_iface->duplex == duplex && duplex->tx_iface->duplex == duplex;
+}
+
+esp_err_t uac_host_duplex_start(const uac_host_duplex_config_t *config, uac_host_duplex_handle_t *duplex_ret)
+{
+    UAC_RETURN_ON_INVALID_ARG(config);
+    UAC_RETURN_ON_INVALID_ARG(duplex_ret);
+    uac_iface_t *rx_iface = get_iface_by_handle(config->rx_handle);
+    uac_iface_t *tx_iface = get_iface_by_handle(config->tx_handle);
+    UAC_RETURN_ON_INVALID_ARG(rx_iface);
+    UAC_RETURN_ON_INVALID_ARG(tx_iface);
+    UAC_RETURN_ON_FALSE(rx_iface->dev_info.type == UAC_STREAM_RX && tx_iface->dev_info.type == UAC_STREAM_TX,
+                        ESP_ERR_INVALID_ARG, "Need microphone and speaker interfaces");
+    UAC_RETURN_ON_FALSE(rx_iface->parent == tx_iface->parent, ESP_ERR_INVALID_ARG, "Interfaces of different devices");
+    UAC_RETURN_ON_FALSE(config->rx_config.sample_freq == config->tx_config.sample_freq, ESP_ERR_INVALID_ARG,
+                        "Different sample frequencies");
+    UAC_RETURN_ON_FALSE(UAC_INTERFACE_STATE_IDLE == rx_iface->state && UAC_INTERFACE_STATE_IDLE == tx_iface->state,
+                        ESP_ERR_INVALID_STATE, "Interface already started");
+
+    esp_err_t ret = ESP_OK;
+    bool rx_locked = false;
+    bool tx_locked = false;
+    uac_duplex_t *duplex = calloc(1, sizeof(uac_duplex_t));
+    UAC_RETURN_ON_FALSE(duplex, ESP_ERR_NO_MEM, "Unable to allocate duplex session");
+    duplex->rx_iface = rx_iface;
+    duplex->tx_iface = tx_iface;
+
+    // claim both interfaces first, so only the transfer submits remain for the common start
+    uac_host_stream_config_t rx_config = config->rx_config;
+    rx_config.flags = (rx_config.flags & ~(FLAG_STREAM_SAMPLE_RATE_CONVERT | FLAG_STREAM_RX_DROP_OLDEST)) | FLAG_STREAM_SUSPEND_AFTER_START;
+    uac_host_stream_config_t tx_config = config->tx_config;
+    tx_config.flags = (tx_config.flags & ~FLAG_STREAM_SAMPLE_RATE_CONVERT) | FLAG_STREAM_SUSPEND_AFTER_START | FLAG_STREAM_TX_INSERT_SILENCE;
+    UAC_GOTO_ON_ERROR(uac_host_device_start(config->rx_handle, &rx_config), "Unable to start microphone");
+    UAC_GOTO_ON_ERROR(uac_host_device_start(config->tx_handle, &tx_config), "Unable to start speaker");
+
+    // the reference has room for the speaker frames of a full microphone buffer
+    UAC_GOTO_ON_ERROR(_ring_buffer_create(rx_iface->ringbuf->size / rx_iface->frame_bytes * tx_iface->frame_bytes, NULL, &duplex->tx_ref),
+                      "Unable to create reference buffer");
+
+    UAC_GOTO_ON_ERROR(uac_host_interface_try_lock(rx_iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
+    rx_locked = true;
+    UAC_GOTO_ON_ERROR(uac_host_interface_try_lock(tx_iface, DEFAULT_CTRL_XFER_TIMEOUT_MS), "Unable to lock UAC Interface");
+    tx_locked = true;
+    UAC_GOTO_ON_FALSE(UAC_INTERFACE_STATE_READY == rx_iface->state && UAC_INTERFACE_STATE_READY == tx_iface->state,
+                      ESP_ERR_INVALID_STATE, "Interface wrong state");
+    rx_iface->xfer_frames = 0;
+    tx_iface->xfer_frames = 0;
+    rx_iface->duplex = duplex;
+    tx_iface->duplex = duplex;
+    // control requests of both interfaces take several frames, do them before the transfers are submitted
+    UAC_GOTO_ON_ERROR(uac_host_interface_resume_prepare(rx_iface), "Unable to prepare microphone");
+    UAC_GOTO_ON_ERROR(uac_host_interface_resume_prepare(tx_iface), "Unable to prepare speaker");
+    UAC_GOTO_ON_ERROR(uac_host_interface_resume_submit(rx_iface), "Unable to enable microphone");
+    UAC_GOTO_ON_ERROR(uac_host_interface_resume_submit(tx_iface), "Unable to enable speaker");
+    uac_host_interface_unlock(tx_iface);
+    uac_host_interface_unlock(rx_iface);
+    *duplex_ret = duplex;
+    return ESP_OK;
+
+fail:
+    if (tx_locked) {
+        uac_host_interface_unlock(tx_iface);
+    }
+    if (rx_locked) {
+        uac_host_interface_unlock(rx_iface);
+    }
+    uac_host_device_stop(config->tx_handle);
+    uac_host_device_stop(config->rx_handle);
+    rx_iface->duplex = NULL;
+    tx_iface->duplex = NULL;
+    if (duplex->tx_ref) {
+        _ring_buffer_delete(duplex->tx_ref);
+    }
+    free(duplex);
+    return ret;
+}
+
+esp_err_t uac_host_duplex_stop(uac_host_duplex_handle_t duplex)
+{
+    UAC_RETURN_ON_FALSE(uac_host_duplex_is_valid(duplex), ESP_ERR_INVALID_ARG, "Invalid duplex session");
+
+    UAC_RETURN_ON_ERROR(uac_host_device_stop(duplex->tx_iface), "Unable to stop speaker");
+    UAC_RETURN_ON_ERROR(uac_host_device_stop(duplex->rx_iface), "Unable to stop microphone");
+    duplex->rx_iface->duplex = NULL;
+    duplex->tx_iface->duplex = NULL;
+    _ring_buffer_delete(duplex->tx_ref);
+    free(duplex);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_duplex_read(uac_host_duplex_handle_t duplex, uint8_t *rx_data, uint8_t *tx_ref, uint32_t frames,
+                               uint32_t *frames_read, uint64_t *frame_pos, uint32_t timeout)
+{
+    UAC_RETURN_ON_FALSE(uac_host_duplex_is_valid(duplex), ESP_ERR_INVALID_ARG, "Invalid duplex session");
+    UAC_RETURN_ON_INVALID_ARG(rx_data);
+    UAC_RETURN_ON_INVALID_ARG(tx_ref);
+    UAC_RETURN_ON_INVALID_ARG(frames_read);
+    UAC_RETURN_ON_INVALID_ARG(frame_pos);
+    *frames_read = 0;
+
+    const size_t rx_frame_bytes = duplex->rx_iface->frame_bytes;
+    const size_t tx_frame_bytes = duplex->tx_iface->frame_bytes;
+    uint32_t rx_len = 0;
+    UAC_RETURN_ON_ERROR(uac_host_device_read(duplex->rx_iface, rx_data, frames * rx_frame_bytes, &rx_len, timeout),
+                        "Unable to read microphone data");
+    const size_t n = rx_len / rx_frame_bytes;
+
+    // the speaker transfer of the same USB frames completes at about the same time
+    const size_t ref_len = n * tx_frame_bytes;
+    size_t ref_read = 0;
+    if (n && _ring_buffer_wait(duplex->tx_ref, true, ref_len, timeout)) {
+        _ring_buffer_pop(duplex->tx_ref, tx_ref, ref_len, &ref_read, 0);
+    }
+    memset(tx_ref + ref_read, 0, ref_len - ref_read);
+
+    *frame_pos = duplex->frame_pos;
+    duplex->frame_pos += n;
+    *frames_read = n;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_duplex_get_loopback_offset(uac_host_duplex_handle_t duplex, int32_t *offset_frames)
+{
+    UAC_RETURN_ON_FALSE(uac_host_duplex_is_valid(duplex), ESP_ERR_INVALID_ARG, "Invalid duplex session");
+    UAC_RETURN_ON_INVALID_ARG(offset_frames);
+
+    *offset_frames = __atomic_load_n(&duplex->loopback_offset, __ATOMIC_RELAXED);
+    return ESP_OK;
+}
@@ -0,0 +1,97 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <sys/param.h>
+#include "uac_gain.h"
+#include "uac_meter.h"
+
+void uac_meter_init(uac_meter_t *meter, const uac_host_meter_config_t *config, uint8_t channels, uint8_t sample_bytes)
+{
+    memset(meter, 0, sizeof(uac_meter_t));
+    if (!config) {
+        return;
+    }
+    meter->channels = channels;
+    meter->sample_bytes = sample_bytes;
+    meter->window_frames = config->window_frames;
+    // the threshold is an attenuation of full scale, as the software volume
+    const uint32_t vad_rms = uac_gain_from_db(config->vad_threshold_db);
+    meter->vad_energy = vad_rms * vad_rms;
+    meter->vad_hangover = config->vad_hangover;
+}
+
+/**
+ * @brief Add frames to the sums and peaks of the current window
+ *
+ * Only the upper 16 bits of each sample are measured, so squares of samples of all bit resolutions fit into 32 bits.
+ * Each channel is measured in its own pass, with the sum and the peak kept in registers.
+ */
+static void uac_meter_accumulate(uac_meter_t *meter, const uint8_t *data, size_t frames)
+{
+    const size_t frame_bytes = meter->channels * meter->sample_bytes;
+    for (uint8_t ch = 0; ch < meter->channels; ch++) {
+        const uint8_t *p = data + ch * meter->sample_bytes + meter->sample_bytes - 2;
+        uint64_t sum_sq = 0;
+        uint32_t peak = meter->peak[ch];
+        for (size_t f = 0; f < frames; f++, p += frame_bytes) {
+            const int32_t sample = (int16_t)(p[0] | (p[1] << 8));
+            const uint32_t magnitude = (uint32_t)(sample < 0 ? -sample : sample);
+            peak = MAX(peak, magnitude);
+            sum_sq += (uint32_t)(sample * sample);
+        }
+        meter->sum_sq[ch] += sum_sq;
+        meter->peak[ch] = peak;
+    }
+}
+
+// Publish levels of the completed window and update the voice activity, return UAC_METER_* bits
+static uint32_t uac_meter_window_done(uac_meter_t *meter)
+{
+    bool above = false;
+    for (uint8_t ch = 0; ch < meter->channels; ch++) {
+        const uint32_t mean_sq = (uint32_t)(meter->sum_sq[ch] / meter->frames);
+        meter->level.rms[ch] = (uint16_t)sqrtf((float)mean_sq);
+        meter->level.peak[ch] = meter->peak[ch];
+        above |= (mean_sq > meter->vad_energy);
+        meter->sum_sq[ch] = 0;
+        meter->peak[ch] = 0;
+    }
+    meter->frames = 0;
+    meter->level.windows++;
+
+    bool voice = true;
+    if (above) {
+        meter->hangover_left = meter->vad_hangover;
+    } else if (meter->hangover_left) {
+        meter->hangover_left--;
+    } else {
+        voice = false;
+    }
+    const bool changed = (voice != meter->level.voice);
+    meter->level.voice = voice;
+    return UAC_METER_WINDOW_DONE | (changed ? UAC_METER_VAD_CHANGED : 0);
+}
+
+uint32_t uac_meter_process(uac_meter_t *meter, const uint8_t *data, size_t frames)
+{
+    uint32_t events = 0;
+    const size_t frame_bytes = meter->channels * meter->sample_bytes;
+    while (frames) {
+        const size_t n = MIN(frames, meter->window_frames - meter->frames);
+        uac_meter_accumulate(meter, data, n);
+        meter->frames += n;
+        data += n * frame_bytes;
+        frames -= n;
+        if (meter->frames == meter->window_frames) {
+            events |= uac_meter_window_done(meter);
+        }
+    }
+    return events;
+}
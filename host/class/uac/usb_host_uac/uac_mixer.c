@@ -0,0 +1,220 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Mixing of several microphones and fan-out to several speakers, on top of the stream read and write API
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "usb/uac_host.h"
+
+static const char *TAG = "uac-mixer";
+
+#define UAC_MIXER_RETURN_ON_FALSE(exp, err, msg) ESP_RETURN_ON_FALSE((exp), (err), TAG, msg)
+
+/**
+ * @brief UAC mixer of ports of the same direction
+ */
+struct uac_mixer {
+    uac_host_stream_t type;                    /*!< Direction of all ports */
+    uint8_t channels;                          /*!< Channels of the mixer data */
+    uint32_t block_frames;                     /*!< Frames moved to or from all ports in each step */
+    int16_t *scratch;                          /*!< One block of a port, for converted or received frames */
+    int32_t *acc;                              /*!< One block of the mix, RX only */
+    uint8_t port_num;                          /*!< Number of ports */
+    uac_host_mixer_port_t ports[];             /*!< Ports of the mixer */
+};
+
+/**
+ * @brief Ticks left until the deadline, 0 if it passed
+ */
+static TickType_t uac_mixer_ticks_left(TickType_t start, uint32_t timeout)
+{
+    const TickType_t elapsed = xTaskGetTickCount() - start;
+    return (elapsed < timeout) ? timeout - elapsed : 0;
+}
+
+/**
+ * @brief Convert frames of the mixer to a mono port, averaging the channels
+ */
+static void uac_mixer_downmix(const int16_t *src, int16_t *dst, uint32_t frames, uint8_t channels)
+{
+    for (uint32_t i = 0; i < frames; i++) {
+        int32_t sum = 0;
+        for (int c = 0; c < channels; c++) {
+            sum += src[i * channels + c];
+        }
+        dst[i] = (int16_t)(sum / channels);
+    }
+}
+
+/**
+ * @brief Add frames of a port to the mix, a mono port is added to all channels of the mixer
+ */
+static void uac_mixer_accumulate(int32_t *acc, const int16_t *src, uint32_t frames, uint8_t channels, uint8_t port_channels)
+{
+    if (port_channels == channels) {
+        for (uint32_t i = 0; i < frames * channels; i++) {
+            acc[i] += src[i];
+        }
+    } else if (port_channels == 1) {
+        for (uint32_t i = 0; i < frames; i++) {
+            for (int c = 0; c < channels; c++) {
+                acc[i * channels + c] += src[i];
+            }
+        }
+    } else {
+        // mono mixer, average the channels of the port
+        for (uint32_t i = 0; i < frames; i++) {
+            int32_t sum = 0;
+            for (int c = 0; c < port_channels; c++) {
+                sum += src[i * port_channels + c];
+            }
+            acc[i] += sum / port_channels;
+        }
+    }
+}
+
+esp_err_t uac_host_mixer_create(const uac_host_mixer_config_t *config, uac_host_mixer_handle_t *mixer)
+{
+    UAC_MIXER_RETURN_ON_FALSE(config && mixer, ESP_ERR_INVALID_ARG, "Argument error");
+    UAC_MIXER_RETURN_ON_FALSE(config->ports && config->port_num && config->channels && config->block_frames,
+                              ESP_ERR_INVALID_ARG, "Invalid mixer configuration");
+
+    uac_host_stream_t type = UAC_STREAM_RX;
+    uint8_t max_channels = config->channels;
+    for (int i = 0; i < config->port_num; i++) {
+        const uac_host_mixer_port_t *port = &config->ports[i];
+        uac_host_dev_info_t dev_info;
+        UAC_MIXER_RETURN_ON_FALSE(uac_host_get_device_info(port->handle, &dev_info) == ESP_OK, ESP_ERR_INVALID_ARG,
+                                  "Port is not an opened interface");
+        UAC_MIXER_RETURN_ON_FALSE(i == 0 || dev_info.type == type, ESP_ERR_INVALID_ARG, "Ports differ in direction");
+        UAC_MIXER_RETURN_ON_FALSE(port->channels == config->channels || port->channels == 1 || config->channels == 1,
+                                  ESP_ERR_INVALID_ARG, "Port channels not supported");
+        type = dev_info.type;
+        max_channels = MAX(max_channels, port->channels);
+    }
+
+    struct uac_mixer *new_mixer = calloc(1, sizeof(struct uac_mixer) + config->port_num * sizeof(uac_host_mixer_port_t));
+    UAC_MIXER_RETURN_ON_FALSE(new_mixer, ESP_ERR_NO_MEM, "Unable to allocate mixer");
+    new_mixer->type = type;
+    new_mixer->channels = config->channels;
+    new_mixer->block_frames = config->block_frames;
+    new_mixer->port_num = config->port_num;
+    memcpy(new_mixer->ports, config->ports, config->port_num * sizeof(uac_host_mixer_port_t));
+    new_mixer->scratch = malloc(config->block_frames * max_channels * sizeof(int16_t));
+    if (type == UAC_STREAM_RX) {
+        new_mixer->acc = malloc(config->block_frames * config->channels * sizeof(int32_t));
+    }
+    if (!new_mixer->scratch || (type == UAC_STREAM_RX && !new_mixer->acc)) {
+        uac_host_mixer_delete(new_mixer);
+        ESP_LOGE(TAG, "Unable to allocate mixer buffers");
+        return ESP_ERR_NO_MEM;
+    }
+    *mixer = new_mixer;
+    return ESP_OK;
+}
+
+esp_err_t uac_host_mixer_delete(uac_host_mixer_handle_t mixer)
+{
+    UAC_MIXER_RETURN_ON_FALSE(mixer, ESP_ERR_INVALID_ARG, "Argument error");
+    free(mixer->scratch);
+    free(mixer->acc);
+    free(mixer);
+    return ESP_OK;
+}
+
+esp_err_t uac_host_mixer_write(uac_host_mixer_handle_t mixer, const uint8_t *data, uint32_t frames, uint32_t timeout)
+{
+    UAC_MIXER_RETURN_ON_FALSE(mixer && data, ESP_ERR_INVALID_ARG, "Argument error");
+    UAC_MIXER_RETURN_ON_FALSE(mixer->type == UAC_STREAM_TX, ESP_ERR_INVALID_ARG, "Mixer ports are not speakers");
+
+    const TickType_t start = xTaskGetTickCount();
+    const int16_t *src = (const int16_t *)data;
+    esp_err_t ret = ESP_OK;
+    while (frames) {
+        const uint32_t block = MIN(frames, mixer->block_frames);
+        // every port gets the block before any port gets the next one
+        for (int i = 0; i < mixer->port_num; i++) {
+            const uac_host_mixer_port_t *port = &mixer->ports[i];
+            const int16_t *port_data = src;
+            if (port->channels != mixer->channels) {
+                if (port->channels == 1) {
+                    uac_mixer_downmix(src, mixer->scratch, block, mixer->channels);
+                } else {
+                    for (uint32_t f = 0; f < block; f++) {
+                        for (int c = 0; c < port->channels; c++) {
+                            mixer->scratch[f * port->channels + c] = src[f];
+                        }
+                    }
+                }
+                port_data = mixer->scratch;
+            }
+            esp_err_t err = uac_host_device_write(port->handle, (uint8_t *)port_data, block * port->channels * sizeof(int16_t),
+                                                  uac_mixer_ticks_left(start, timeout));
+            if (err != ESP_OK && ret == ESP_OK) {
+                ESP_LOGD(TAG, "Port %d write failed", i);
+                ret = err;
+            }
+        }
+        src += block * mixer->channels;
+        frames -= block;
+    }
+    return ret;
+}
+
+esp_err_t uac_host_mixer_read(uac_host_mixer_handle_t mixer, uint8_t *data, uint32_t frames, uint32_t *frames_read,
+                              uint32_t timeout)
+{
+    UAC_MIXER_RETURN_ON_FALSE(mixer && data && frames_read, ESP_ERR_INVALID_ARG, "Argument error");
+    UAC_MIXER_RETURN_ON_FALSE(mixer->type == UAC_STREAM_RX, ESP_ERR_INVALID_ARG, "Mixer ports are not microphones");
+
+    const TickType_t start = xTaskGetTickCount();
+    int16_t *dst = (int16_t *)data;
+    *frames_read = 0;
+    while (frames) {
+        const uint32_t block = MIN(frames, mixer->block_frames);
+        uint32_t block_filled = 0;
+        memset(mixer->acc, 0, block * mixer->channels * sizeof(int32_t));
+        for (int i = 0; i < mixer->port_num; i++) {
+            const uac_host_mixer_port_t *port = &mixer->ports[i];
+            const uint32_t frame_bytes = port->channels * sizeof(int16_t);
+            const uint32_t want = block * frame_bytes;
+            uint32_t got = 0;
+            // the ports share the sample clock, only the first one usually waits for the block
+            while (got < want) {
+                uint32_t bytes_read = 0;
+                const TickType_t ticks = uac_mixer_ticks_left(start, timeout);
+                if (uac_host_device_read(port->handle, (uint8_t *)mixer->scratch + got, want - got, &bytes_read, ticks) != ESP_OK ||
+                        (bytes_read == 0 && ticks == 0)) {
+                    break;
+                }
+                got += bytes_read;
+            }
+            uac_mixer_accumulate(mixer->acc, mixer->scratch, got / frame_bytes, mixer->channels, port->channels);
+            block_filled = MAX(block_filled, got / frame_bytes);
+        }
+        if (block_filled == 0) {
+            break;
+        }
+        // the rest of the block of slower ports stays silent
+        for (uint32_t s = 0; s < block_filled * mixer->channels; s++) {
+            dst[s] = (int16_t)MIN(MAX(mixer->acc[s], INT16_MIN), INT16_MAX);
+        }
+        dst += block_filled * mixer->channels;
+        *frames_read += block_filled;
+        frames -= block_filled;
+        if (block_filled < block) {
+            break;
+        }
+    }
+    return *frames_read ? ESP_OK : ESP_FAIL;
+}
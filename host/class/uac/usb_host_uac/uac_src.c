@@ -0,0 +1,153 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/param.h>
+#include "esp_err.h"
+#include "uac_src.h"
+
+#define UAC_SRC_TAPS            (16)        // Taps of each filter phase, input frames used for one output frame
+#define UAC_SRC_PHASE_BITS      (6)         // 64 phases, resolution of the fractional position between input frames
+#define UAC_SRC_PHASES          (1 << UAC_SRC_PHASE_BITS)
+#define UAC_SRC_COEF_BITS       (15)        // Coefficients in Q15
+#define UAC_SRC_POS_BITS        (32)        // Positions in input frames in 32.32 fixed point
+#define UAC_SRC_CUTOFF          (0.45f)     // Cutoff frequency relative to the lower of the rates
+
+/**
+ * @brief Sample rate converter
+ *
+ * Input frames are kept per channel, so each output sample is a contiguous dot product of UAC_SRC_TAPS
+ * input samples and one phase of the filter. The phase is selected by the fractional position of the output frame.
+ */
+struct uac_src {
+    uint8_t channels;                          /*!< Number of channels */
+    size_t capacity;                           /*!< Input frames of each channel buffer */
+    size_t frames;                             /*!< Input frames in the buffers */
+    uint64_t pos;                              /*!< Position of the next output frame in the buffers, 32.32 fixed point */
+    uint64_t step;                             /*!< Input frames per output frame, 32.32 fixed point */
+    int16_t coef[UAC_SRC_PHASES][UAC_SRC_TAPS];/*!< Filter phases, Q15 */
+    int16_t *in[];                             /*!< Input buffer of each channel */
+};
+
+static float uac_src_window(float x)
+{
+    // Blackman window, x in <0; 1>
+    return 0.42f - 0.5f * cosf(2.0f * (float)M_PI * x) + 0.08f * cosf(4.0f * (float)M_PI * x);
+}
+
+static void uac_src_filter_design(uac_src_t *src, uint32_t in_rate, uint32_t out_rate)
+{
+    // Cutoff normalized to the input rate, lower than both Nyquist frequencies
+    const float fc = UAC_SRC_CUTOFF * (float)MIN(in_rate, out_rate) / (float)in_rate;
+    for (int p = 0; p < UAC_SRC_PHASES; p++) {
+        float h[UAC_SRC_TAPS];
+        float sum = 0.0f;
+        for (int k = 0; k < UAC_SRC_TAPS; k++) {
+            // Distance of tap k from the output frame, which lies between taps TAPS/2 - 1 and TAPS/2
+            const float t = (float)k - (float)(UAC_SRC_TAPS / 2 - 1) - (float)p / UAC_SRC_PHASES;
+            const float x = 2.0f * (float)M_PI * fc * t;
+            const float sinc = (t == 0.0f) ? 1.0f : sinf(x) / x;
+            h[k] = sinc * uac_src_window((t + UAC_SRC_TAPS / 2) / UAC_SRC_TAPS);
+            sum += h[k];
+        }
+        // Unity gain of each phase
+        for (int k = 0; k < UAC_SRC_TAPS; k++) {
+            const long c = lroundf(h[k] / sum * (1 << UAC_SRC_COEF_BITS));
+            src->coef[p][k] = (int16_t)MAX(MIN(c, INT16_MAX), INT16_MIN);
+        }
+    }
+}
+
+esp_err_t uac_src_create(uint32_t in_rate, uint32_t out_rate, uint8_t channels, size_t max_frames, uac_src_t **src_ret)
+{
+    if (!src_ret || !in_rate || !out_rate || !channels || !max_frames) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uac_src_t *src = calloc(1, sizeof(uac_src_t) + channels * sizeof(int16_t *));
+    if (!src) {
+        return ESP_ERR_NO_MEM;
+    }
+    src->channels = channels;
+    src->capacity = max_frames + UAC_SRC_TAPS;
+    src->in[0] = calloc(src->capacity * channels, sizeof(int16_t));
+    if (!src->in[0]) {
+        free(src);
+        return ESP_ERR_NO_MEM;
+    }
+    for (int ch = 1; ch < channels; ch++) {
+        src->in[ch] = src->in[ch - 1] + src->capacity;
+    }
+    src->step = ((uint64_t)in_rate << UAC_SRC_POS_BITS) / out_rate;
+    uac_src_filter_design(src, in_rate, out_rate);
+    *src_ret = src;
+    return ESP_OK;
+}
+
+void uac_src_delete(uac_src_t *src)
+{
+    if (src) {
+        free(src->in[0]);
+        free(src);
+    }
+}
+
+size_t uac_src_write_free(const uac_src_t *src)
+{
+    return src->capacity - src->frames;
+}
+
+size_t uac_src_write(uac_src_t *src, const void *data, size_t frames)
+{
+    frames = MIN(frames, uac_src_write_free(src));
+    const uint8_t *in = data;
+    for (size_t i = 0; i < frames; i++) {
+        for (int ch = 0; ch < src->channels; ch++) {
+            memcpy(&src->in[ch][src->frames + i], in, sizeof(int16_t));
+            in += sizeof(int16_t);
+        }
+    }
+    src->frames += frames;
+    return frames;
+}
+
+size_t uac_src_read(uac_src_t *src, void *data, size_t frames)
+{
+    uint8_t *out = data;
+    size_t n = 0;
+    for (; n < frames; n++) {
+        const size_t base = src->pos >> UAC_SRC_POS_BITS;
+        if (base + UAC_SRC_TAPS > src->frames) {
+            break;
+        }
+        const int16_t *coef = src->coef[(uint32_t)src->pos >> (UAC_SRC_POS_BITS - UAC_SRC_PHASE_BITS)];
+        for (int ch = 0; ch < src->channels; ch++) {
+            const int16_t *x = &src->in[ch][base];
+            int32_t acc = 1 << (UAC_SRC_COEF_BITS - 1);
+            for (int k = 0; k < UAC_SRC_TAPS; k++) {
+                acc += (int32_t)x[k] * coef[k];
+            }
+            const int16_t sample = (int16_t)MAX(MIN(acc >> UAC_SRC_COEF_BITS, INT16_MAX), INT16_MIN);
+            memcpy(out, &sample, sizeof(sample));
+            out += sizeof(sample);
+        }
+        src->pos += src->step;
+    }
+
+    // Drop input frames that no next output frame uses
+    const size_t used = MIN((size_t)(src->pos >> UAC_SRC_POS_BITS), src->frames);
+    if (used) {
+        for (int ch = 0; ch < src->channels; ch++) {
+            memmove(src->in[ch], &src->in[ch][used], (src->frames - used) * sizeof(int16_t));
+        }
+        src->frames -= used;
+        src->pos -= (uint64_t)used << UAC_SRC_POS_BITS;
+    }
+    return n;
+}
@@ -0,0 +1,83 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USB_HOST_ENUM_PROFILER_MAX_DEVICES (8)  /**< Number of devices whose profiles are kept */
+#define USB_HOST_ENUM_PROFILER_MAX_MARKS   (24) /**< Number of marks kept in one profile */
+
+/**
+ * @brief Phase of enumeration of a device, marked by one driver
+ */
+typedef struct {
+    int64_t time_us;       /**< Time of the mark by esp_timer_get_time() */
+    const char *driver;    /**< Driver that marked the phase, e.g. "msc" */
+    const char *phase;     /**< Phase that ended at this mark, e.g. "class_check" */
+} usb_host_enum_profiler_mark_t;
+
+/**
+ * @brief Enumeration and class setup profile of one device, from its new device event
+ */
+typedef struct {
+    uint8_t dev_addr;      /**< USB device address */
+    unsigned mark_count;   /**< Number of valid marks */
+    bool overflow;         /**< More marks were made than USB_HOST_ENUM_PROFILER_MAX_MARKS, later ones were dropped */
+    usb_host_enum_profiler_mark_t marks[USB_HOST_ENUM_PROFILER_MAX_MARKS]; /**< Marks in order of their time */
+} usb_host_enum_profile_t;
+
+/**
+ * @brief Mark end of a phase of a device
+ *
+ * Called by the class drivers, whenever this component is linked to the application, and
+ * by the application for its own phases. Drivers mark "new_dev" upon USB_HOST_CLIENT_EVENT_NEW_DEV,
+ * a second "new_dev" of the same driver starts a new profile of the address.
+ *
+ * @note driver and phase are stored by reference, they must be string literals
+ *
+ * @param[in] dev_addr USB device address
+ * @param[in] driver   Driver or application part marking the phase
+ * @param[in] phase    Phase that ended
+ */
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase);
+
+/**
+ * @brief Get profile of a device
+ *
+ * @param[in]  dev_addr USB device address
+ * @param[out] profile  Copy of the profile
+ * @return
+ *     - ESP_OK:              Profile copied
+ *     - ESP_ERR_INVALID_ARG: profile is NULL
+ *     - ESP_ERR_NOT_FOUND:   No mark of the device
+ */
+esp_err_t usb_host_enum_profiler_get(uint8_t dev_addr, usb_host_enum_profile_t *profile);
+
+/**
+ * @brief Print profiles to stdout
+ *
+ * Each mark is printed with its time since the first mark of the device, and the time since the previous mark
+ * of the same driver, which is the time the driver spent in the phase.
+ *
+ * @param[in] dev_addr USB device address, 0 for all devices
+ */
+void usb_host_enum_profiler_print(uint8_t dev_addr);
+
+/**
+ * @brief Delete all profiles
+ */
+void usb_host_enum_profiler_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
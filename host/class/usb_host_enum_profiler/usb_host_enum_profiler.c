@@ -0,0 +1,164 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "usb/usb_host_enum_profiler.h"
+
+#define ENUM_PROFILER_NEW_DEV "new_dev"
+
+static usb_host_enum_profile_t s_profiles[USB_HOST_ENUM_PROFILER_MAX_DEVICES];
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define ENUM_PROFILER_ENTER_CRITICAL() portENTER_CRITICAL(&s_lock)
+#define ENUM_PROFILER_EXIT_CRITICAL()  portEXIT_CRITICAL(&s_lock)
+
+/**
+ * @brief Find profile of the address
+ *
+ * @note Called from critical section
+ *
+ * @param[in] dev_addr USB device address
+ * @return Profile, NULL if the address was not marked
+ */
+static usb_host_enum_profile_t *enum_profiler_find(uint8_t dev_addr)
+{
+    for (int i = 0; i < USB_HOST_ENUM_PROFILER_MAX_DEVICES; i++) {
+        if (s_profiles[i].mark_count && s_profiles[i].dev_addr == dev_addr) {
+            return &s_profiles[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Get a free profile, or the one started first if all are used
+ *
+ * @note Called from critical section
+ */
+static usb_host_enum_profile_t *enum_profiler_alloc(void)
+{
+    usb_host_enum_profile_t *oldest = &s_profiles[0];
+    for (int i = 0; i < USB_HOST_ENUM_PROFILER_MAX_DEVICES; i++) {
+        if (!s_profiles[i].mark_count) {
+            return &s_profiles[i];
+        }
+        if (s_profiles[i].marks[0].time_us < oldest->marks[0].time_us) {
+            oldest = &s_profiles[i];
+        }
+    }
+    return oldest;
+}
+
+/**
+ * @brief A new device event of a driver, which already marked the profile, is a reconnection
+ *
+ * @note Called from critical section
+ */
+static bool enum_profiler_is_reconnection(const usb_host_enum_profile_t *profile, const char *driver)
+{
+    for (unsigned i = 0; i < profile->mark_count; i++) {
+        if (strcmp(profile->marks[i].driver, driver) == 0 && strcmp(profile->marks[i].phase, ENUM_PROFILER_NEW_DEV) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase)
+{
+    if (!driver || !phase) {
+        return;
+    }
+    const int64_t now = esp_timer_get_time();
+
+    ENUM_PROFILER_ENTER_CRITICAL();
+    usb_host_enum_profile_t *profile = enum_profiler_find(dev_addr);
+    if (profile && strcmp(phase, ENUM_PROFILER_NEW_DEV) == 0 && enum_profiler_is_reconnection(profile, driver)) {
+        profile->mark_count = 0;
+    }
+    if (!profile) {
+        profile = enum_profiler_alloc();
+        profile->mark_count = 0;
+    }
+    if (profile->mark_count == 0) {
+        profile->dev_addr = dev_addr;
+        profile->overflow = false;
+    }
+    if (profile->mark_count < USB_HOST_ENUM_PROFILER_MAX_MARKS) {
+        usb_host_enum_profiler_mark_t *mark = &profile->marks[profile->mark_count++];
+        mark->time_us = now;
+        mark->driver = driver;
+        mark->phase = phase;
+    } else {
+        profile->overflow = true;
+    }
+    ENUM_PROFILER_EXIT_CRITICAL();
+}
+
+esp_err_t usb_host_enum_profiler_get(uint8_t dev_addr, usb_host_enum_profile_t *profile)
+{
+    if (!profile) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    ENUM_PROFILER_ENTER_CRITICAL();
+    const usb_host_enum_profile_t *found = enum_profiler_find(dev_addr);
+    if (found) {
+        *profile = *found;
+        ret = ESP_OK;
+    }
+    ENUM_PROFILER_EXIT_CRITICAL();
+    return ret;
+}
+
+static void enum_profiler_print_profile(const usb_host_enum_profile_t *profile)
+{
+    const int64_t start_us = profile->marks[0].time_us;
+    printf("USB device %d: %" PRId64 " us from new device event to last mark\n",
+           profile->dev_addr, profile->marks[profile->mark_count - 1].time_us - start_us);
+    for (unsigned i = 0; i < profile->mark_count; i++) {
+        const usb_host_enum_profiler_mark_t *mark = &profile->marks[i];
+        // The phase started at the previous mark of the same driver, or at the first mark of the device
+        int64_t phase_start_us = start_us;
+        for (int j = (int)i - 1; j >= 0; j--) {
+            if (strcmp(profile->marks[j].driver, mark->driver) == 0) {
+                phase_start_us = profile->marks[j].time_us;
+                break;
+            }
+        }
+        printf("  %8" PRId64 " us  %-6s %-16s +%" PRId64 " us\n",
+               mark->time_us - start_us, mark->driver, mark->phase, mark->time_us - phase_start_us);
+    }
+    if (profile->overflow) {
+        printf("  more than %d marks, later marks dropped\n", USB_HOST_ENUM_PROFILER_MAX_MARKS);
+    }
+}
+
+void usb_host_enum_profiler_print(uint8_t dev_addr)
+{
+    // Profiles are copied one by one, so no printing is done in critical section
+    usb_host_enum_profile_t profile;
+    for (int i = 0; i < USB_HOST_ENUM_PROFILER_MAX_DEVICES; i++) {
+        ENUM_PROFILER_ENTER_CRITICAL();
+        profile = s_profiles[i];
+        ENUM_PROFILER_EXIT_CRITICAL();
+        if (profile.mark_count && (dev_addr == 0 || profile.dev_addr == dev_addr)) {
+            enum_profiler_print_profile(&profile);
+        }
+    }
+}
+
+void usb_host_enum_profiler_clear(void)
+{
+    ENUM_PROFILER_ENTER_CRITICAL();
+    memset(s_profiles, 0, sizeof(s_profiles));
+    ENUM_PROFILER_EXIT_CRITICAL();
+}
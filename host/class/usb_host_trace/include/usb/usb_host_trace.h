@@ -0,0 +1,94 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Type of trace event
+ */
+typedef enum {
+    USB_HOST_TRACE_SUBMIT = 0,          /**< Transfer was submitted */
+    USB_HOST_TRACE_COMPLETE,            /**< Transfer completed, before it is processed by the driver */
+} usb_host_trace_event_type_t;
+
+/**
+ * @brief Trace event of a transfer
+ */
+typedef struct {
+    uint32_t timestamp_us;              /**< Lower 32 bits of esp_timer_get_time() */
+    uint32_t bytes;                     /**< SUBMIT: Requested bytes. COMPLETE: Transferred bytes */
+    const char *driver;                 /**< Driver that recorded the event, e.g. "uvc" */
+    uint8_t type;                       /**< Type of event, usb_host_trace_event_type_t */
+    uint8_t status;                     /**< COMPLETE: usb_transfer_status_t of the transfer. ISOC packets carry their own status */
+    uint8_t ep;                         /**< Endpoint address of the transfer */
+    uint8_t interface;                  /**< Interface of the transfer */
+} usb_host_trace_event_t;
+
+/**
+ * @brief Record submission of a transfer
+ *
+ * Called by the class drivers right before the transfer is submitted, whenever this component is linked to the application.
+ * Returns immediately while recording is switched off.
+ *
+ * @note driver is stored by reference, it must be a string literal
+ *
+ * @param[in] driver    Driver submitting the transfer
+ * @param[in] interface Interface of the transfer
+ * @param[in] transfer  Transfer
+ */
+void usb_host_trace_submit(const char *driver, uint8_t interface, const usb_transfer_t *transfer);
+
+/**
+ * @brief Record completion of a transfer
+ *
+ * Called by the class drivers at the start of their transfer callbacks, whenever this component is linked to the application.
+ * Returns immediately while recording is switched off.
+ *
+ * @note driver is stored by reference, it must be a string literal
+ *
+ * @param[in] driver    Driver whose transfer completed
+ * @param[in] interface Interface of the transfer
+ * @param[in] transfer  Completed transfer
+ */
+void usb_host_trace_complete(const char *driver, uint8_t interface, const usb_transfer_t *transfer);
+
+/**
+ * @brief Switch recording of trace events on or off
+ *
+ * Recording is off by default. While it is on, submissions and completions of transfers of all drivers
+ * are recorded into a ring buffer of CONFIG_USB_HOST_TRACE_BUFFER_SIZE events. The oldest events are overwritten.
+ *
+ * @param[in] enable true to record trace events
+ */
+void usb_host_trace_enable(bool enable);
+
+/**
+ * @brief Take recorded trace events, oldest first
+ *
+ * Can be called anytime, also while transfers are running. Taken events are removed from the ring buffer.
+ *
+ * @param[out] events     Array to be filled with trace events
+ * @param[in]  max_events Length of the array
+ * @param[out] num_events Number of trace events filled in
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ */
+esp_err_t usb_host_trace_read(usb_host_trace_event_t *events, size_t max_events, size_t *num_events);
+
+#ifdef __cplusplus
+}
+#endif
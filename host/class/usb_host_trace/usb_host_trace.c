@@ -0,0 +1,86 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "sdkconfig.h"
+#include "usb/usb_host_trace.h"
+
+#define USB_HOST_TRACE_BUFFER_SIZE CONFIG_USB_HOST_TRACE_BUFFER_SIZE
+_Static_assert((USB_HOST_TRACE_BUFFER_SIZE & (USB_HOST_TRACE_BUFFER_SIZE - 1)) == 0, "CONFIG_USB_HOST_TRACE_BUFFER_SIZE must be a power of two");
+
+static bool s_trace_enabled = false;
+
+static struct {
+    usb_host_trace_event_t events[USB_HOST_TRACE_BUFFER_SIZE];
+    uint32_t head;                      // Number of recorded events
+    uint32_t tail;                      // Number of read or overwritten events
+} s_trace;
+
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void usb_host_trace_record(usb_host_trace_event_type_t type, const char *driver, uint8_t interface, const usb_transfer_t *transfer)
+{
+    const usb_host_trace_event_t event = {
+        .timestamp_us = (uint32_t)esp_timer_get_time(),
+        .bytes = (type == USB_HOST_TRACE_SUBMIT) ? (uint32_t)transfer->num_bytes : (uint32_t)transfer->actual_num_bytes,
+        .driver = driver,
+        .type = (uint8_t)type,
+        .status = (type == USB_HOST_TRACE_SUBMIT) ? 0 : (uint8_t)transfer->status,
+        .ep = transfer->bEndpointAddress,
+        .interface = interface,
+    };
+
+    portENTER_CRITICAL_SAFE(&s_trace_lock);
+    if (s_trace.head - s_trace.tail == USB_HOST_TRACE_BUFFER_SIZE) {
+        s_trace.tail++; // Overwrite the oldest event
+    }
+    s_trace.events[s_trace.head % USB_HOST_TRACE_BUFFER_SIZE] = event;
+    s_trace.head++;
+    portEXIT_CRITICAL_SAFE(&s_trace_lock);
+}
+
+// Cheap enough for transfer callbacks: a relaxed load while recording is switched off
+void usb_host_trace_submit(const char *driver, uint8_t interface, const usb_transfer_t *transfer)
+{
+    if (__atomic_load_n(&s_trace_enabled, __ATOMIC_RELAXED)) {
+        usb_host_trace_record(USB_HOST_TRACE_SUBMIT, driver, interface, transfer);
+    }
+}
+
+void usb_host_trace_complete(const char *driver, uint8_t interface, const usb_transfer_t *transfer)
+{
+    if (__atomic_load_n(&s_trace_enabled, __ATOMIC_RELAXED)) {
+        usb_host_trace_record(USB_HOST_TRACE_COMPLETE, driver, interface, transfer);
+    }
+}
+
+void usb_host_trace_enable(bool enable)
+{
+    __atomic_store_n(&s_trace_enabled, enable, __ATOMIC_RELAXED);
+}
+
+esp_err_t usb_host_trace_read(usb_host_trace_event_t *events, size_t max_events, size_t *num_events)
+{
+    if (events == NULL || num_events == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t num = 0;
+    portENTER_CRITICAL(&s_trace_lock);
+    while (num < max_events && s_trace.tail != s_trace.head) {
+        events[num++] = s_trace.events[s_trace.tail % USB_HOST_TRACE_BUFFER_SIZE];
+        s_trace.tail++;
+    }
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    *num_events = num;
+    return ESP_OK;
+}
@@ -0,0 +1,104 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/usb_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define USB_HOST_XFER_POOL_CLASS_NUM (4)  /**< Maximum number of size classes of the pool */
+#define USB_HOST_XFER_POOL_CLASS_MAX (32) /**< Maximum number of transfers of one size class */
+
+/**
+ * @brief Size class of the transfer pool
+ */
+typedef struct {
+    size_t buffer_size;                 /**< Buffer size of the transfers, requests up to this size are served by this class */
+    uint8_t count;                      /**< Number of transfers allocated at install, up to USB_HOST_XFER_POOL_CLASS_MAX. 0 for unused class */
+} usb_host_xfer_pool_class_t;
+
+/**
+ * @brief Transfer pool statistics
+ */
+typedef struct {
+    struct {
+        size_t buffer_size;             /**< Buffer size of the class */
+        uint8_t count;                  /**< Transfers of the class */
+        uint8_t in_use;                 /**< Transfers currently taken from the class */
+        uint8_t in_use_max;             /**< Maximum number of transfers taken at once since install */
+    } classes[USB_HOST_XFER_POOL_CLASS_NUM];
+    uint32_t hits;                      /**< Transfers taken from the pool */
+    uint32_t misses;                    /**< Transfers allocated by usb_host_transfer_alloc(), because no class had a free transfer of the size */
+} usb_host_xfer_pool_stats_t;
+
+/**
+ * @brief Allocate the transfers of the pool
+ *
+ * Transfers of all class drivers, which are allocated after this call, are taken from the pool.
+ * Call it before the class drivers open devices.
+ *
+ * @param[in] classes Size classes, sorted by buffer size
+ * @param[in] num     Number of size classes, up to USB_HOST_XFER_POOL_CLASS_NUM
+ * @return
+ *     - ESP_OK:                Success, also if all classes are unused
+ *     - ESP_ERR_INVALID_ARG:   classes is NULL, too many classes, classes not sorted or too many transfers in a class
+ *     - ESP_ERR_INVALID_STATE: The pool is already installed
+ *     - ESP_ERR_NO_MEM:        Not enough memory for the transfers
+ */
+esp_err_t usb_host_xfer_pool_install(const usb_host_xfer_pool_class_t *classes, size_t num);
+
+/**
+ * @brief Free the transfers of the pool
+ *
+ * @return
+ *     - ESP_OK:                Success
+ *     - ESP_ERR_INVALID_STATE: A transfer of the pool is still in use, e.g. a device is still opened
+ */
+esp_err_t usb_host_xfer_pool_uninstall(void);
+
+/**
+ * @brief Take a transfer from the pool
+ *
+ * Called by the class drivers instead of usb_host_transfer_alloc(), whenever this component is linked to the application.
+ * The transfer comes from the smallest class with a free transfer of at least data_buffer_size bytes,
+ * or it is allocated by usb_host_transfer_alloc() if there is none, if the pool is not installed or for isochronous transfers.
+ *
+ * @note A pooled transfer may have a larger data buffer than requested, its data_buffer_size is still the requested size
+ *
+ * @param[in]  data_buffer_size Required buffer size
+ * @param[in]  num_isoc_packets Number of isochronous packets, pooled transfers have none
+ * @param[out] transfer         Transfer
+ * @return See usb_host_transfer_alloc()
+ */
+esp_err_t usb_host_xfer_pool_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer);
+
+/**
+ * @brief Return a transfer taken by usb_host_xfer_pool_alloc()
+ *
+ * @param[in] transfer Transfer, can be NULL
+ * @return See usb_host_transfer_free()
+ */
+esp_err_t usb_host_xfer_pool_free(usb_transfer_t *transfer);
+
+/**
+ * @brief Get statistics of the pool
+ *
+ * @param[out] stats Pool statistics
+ * @return
+ *     - ESP_OK:              Success
+ *     - ESP_ERR_INVALID_ARG: stats is NULL
+ */
+esp_err_t usb_host_xfer_pool_get_stats(usb_host_xfer_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,34 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/usb_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Weak references of the transfer pool for class drivers
+ *
+ * A weak reference does not pull the pool into the application. The pool is linked only if the application itself uses it,
+ * e.g. calls usb_host_xfer_pool_install(). Otherwise the class drivers allocate their transfers by usb_host_transfer_alloc().
+ */
+esp_err_t usb_host_xfer_pool_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer) __attribute__((weak));
+esp_err_t usb_host_xfer_pool_free(usb_transfer_t *transfer) __attribute__((weak));
+
+#define USB_HOST_XFER_POOL_ALLOC(size, isoc, xfer)                                 \
+    (usb_host_xfer_pool_alloc ? usb_host_xfer_pool_alloc((size), (isoc), (xfer))   \
+                              : usb_host_transfer_alloc((size), (isoc), (xfer)))
+#define USB_HOST_XFER_POOL_FREE(xfer) \
+    (usb_host_xfer_pool_free ? usb_host_xfer_pool_free(xfer) : usb_host_transfer_free(xfer))
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,211 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_check.h"
+#include "usb/usb_host_xfer_pool.h"
+
+static const char *TAG = "usb_xfer_pool";
+
+typedef struct {
+    size_t buffer_size;
+    uint8_t count;
+    uint8_t in_use_max;
+    uint32_t free_mask;                 // Set bit marks a free transfer
+    usb_transfer_t *xfers[USB_HOST_XFER_POOL_CLASS_MAX];
+} xfer_pool_class_t;
+
+static struct {
+    xfer_pool_class_t classes[USB_HOST_XFER_POOL_CLASS_NUM];
+    size_t class_num;                   // Written only at install and uninstall, 0 if the pool is not used
+    uint32_t hits;
+    uint32_t misses;
+} s_pool;
+
+static portMUX_TYPE s_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+
+// data_buffer_size is constant in the public definition of usb_transfer_t, the pool sets it on every take and return
+static inline void xfer_set_buffer_size(usb_transfer_t *transfer, size_t size)
+{
+    *(size_t *)&transfer->data_buffer_size = size;
+}
+
+// Clear the fields set by the previous user, so the transfer looks freshly allocated
+static void xfer_reset(usb_transfer_t *transfer, size_t buffer_size)
+{
+    xfer_set_buffer_size(transfer, buffer_size);
+    transfer->num_bytes = 0;
+    transfer->actual_num_bytes = 0;
+    transfer->flags = 0;
+    transfer->device_handle = NULL;
+    transfer->bEndpointAddress = 0;
+    transfer->status = USB_TRANSFER_STATUS_COMPLETED;
+    transfer->timeout_ms = 0;
+    transfer->callback = NULL;
+    transfer->context = NULL;
+}
+
+// Free transfers of classes, which are not (or no longer) visible in s_pool
+static void xfer_pool_free_classes(xfer_pool_class_t *classes, size_t class_num)
+{
+    for (size_t i = 0; i < class_num; i++) {
+        for (uint8_t j = 0; j < classes[i].count; j++) {
+            usb_host_transfer_free(classes[i].xfers[j]);
+        }
+    }
+}
+
+esp_err_t usb_host_xfer_pool_install(const usb_host_xfer_pool_class_t *classes, size_t num)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(classes && num <= USB_HOST_XFER_POOL_CLASS_NUM, ESP_ERR_INVALID_ARG, TAG, "Invalid size classes");
+    ESP_RETURN_ON_FALSE(s_pool.class_num == 0, ESP_ERR_INVALID_STATE, TAG, "Already installed");
+
+    // Transfers are allocated outside of the pool, the drivers see the pool only once it is complete
+    xfer_pool_class_t pool_classes[USB_HOST_XFER_POOL_CLASS_NUM] = {0};
+    size_t class_num = 0;
+    for (size_t i = 0; i < num; i++) {
+        if (classes[i].count == 0) {
+            continue;
+        }
+        ESP_GOTO_ON_FALSE(classes[i].count <= USB_HOST_XFER_POOL_CLASS_MAX && classes[i].buffer_size > 0,
+                          ESP_ERR_INVALID_ARG, fail, TAG, "Invalid size class");
+        ESP_GOTO_ON_FALSE(class_num == 0 || pool_classes[class_num - 1].buffer_size < classes[i].buffer_size,
+                          ESP_ERR_INVALID_ARG, fail, TAG, "Size classes must be sorted");
+        xfer_pool_class_t *pool_class = &pool_classes[class_num++];
+        pool_class->buffer_size = classes[i].buffer_size;
+        for (uint8_t j = 0; j < classes[i].count; j++) {
+            ESP_GOTO_ON_ERROR(usb_host_transfer_alloc(classes[i].buffer_size, 0, &pool_class->xfers[j]), fail, TAG,
+                              "Not enough memory for pool transfers");
+            pool_class->count++;
+            pool_class->free_mask |= 1UL << j;
+        }
+    }
+
+    portENTER_CRITICAL(&s_pool_lock);
+    if (s_pool.class_num != 0) {
+        portEXIT_CRITICAL(&s_pool_lock);
+        ret = ESP_ERR_INVALID_STATE;
+        goto fail;
+    }
+    memcpy(s_pool.classes, pool_classes, sizeof(pool_classes));
+    s_pool.hits = 0;
+    s_pool.misses = 0;
+    s_pool.class_num = class_num;
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ESP_OK;
+
+fail:
+    xfer_pool_free_classes(pool_classes, class_num);
+    return ret;
+}
+
+esp_err_t usb_host_xfer_pool_uninstall(void)
+{
+    xfer_pool_class_t pool_classes[USB_HOST_XFER_POOL_CLASS_NUM];
+    portENTER_CRITICAL(&s_pool_lock);
+    const size_t class_num = s_pool.class_num;
+    for (size_t i = 0; i < class_num; i++) {
+        const xfer_pool_class_t *pool_class = &s_pool.classes[i];
+        if (pool_class->free_mask != (uint32_t)((1ULL << pool_class->count) - 1)) {
+            portEXIT_CRITICAL(&s_pool_lock);
+            ESP_LOGE(TAG, "Transfers of the pool are in use");
+            return ESP_ERR_INVALID_STATE;
+        }
+    }
+    memcpy(pool_classes, s_pool.classes, sizeof(pool_classes));
+    memset(&s_pool, 0, sizeof(s_pool));
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    xfer_pool_free_classes(pool_classes, class_num);
+    return ESP_OK;
+}
+
+esp_err_t usb_host_xfer_pool_alloc(size_t data_buffer_size, int num_isoc_packets, usb_transfer_t **transfer)
+{
+    // Pooled transfers have no isochronous packet descriptors
+    if (s_pool.class_num == 0 || num_isoc_packets != 0) {
+        return usb_host_transfer_alloc(data_buffer_size, num_isoc_packets, transfer);
+    }
+
+    usb_transfer_t *taken = NULL;
+    portENTER_CRITICAL(&s_pool_lock);
+    for (size_t i = 0; i < s_pool.class_num && taken == NULL; i++) {
+        xfer_pool_class_t *pool_class = &s_pool.classes[i];
+        if (pool_class->buffer_size < data_buffer_size || pool_class->free_mask == 0) {
+            continue;
+        }
+        const int idx = __builtin_ctz(pool_class->free_mask);
+        pool_class->free_mask &= ~(1UL << idx);
+        const uint8_t in_use = pool_class->count - __builtin_popcount(pool_class->free_mask);
+        if (in_use > pool_class->in_use_max) {
+            pool_class->in_use_max = in_use;
+        }
+        taken = pool_class->xfers[idx];
+    }
+    if (taken) {
+        s_pool.hits++;
+    } else {
+        s_pool.misses++;
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (taken == NULL) {
+        return usb_host_transfer_alloc(data_buffer_size, 0, transfer);
+    }
+    // Report the requested size, drivers derive transfer lengths and limits from data_buffer_size
+    xfer_set_buffer_size(taken, data_buffer_size);
+    *transfer = taken;
+    return ESP_OK;
+}
+
+esp_err_t usb_host_xfer_pool_free(usb_transfer_t *transfer)
+{
+    if (transfer == NULL) {
+        return ESP_OK;
+    }
+
+    bool pooled = false;
+    portENTER_CRITICAL(&s_pool_lock);
+    for (size_t i = 0; i < s_pool.class_num && !pooled; i++) {
+        xfer_pool_class_t *pool_class = &s_pool.classes[i];
+        for (uint8_t j = 0; j < pool_class->count; j++) {
+            if (pool_class->xfers[j] == transfer) {
+                xfer_reset(transfer, pool_class->buffer_size);
+                pool_class->free_mask |= 1UL << j;
+                pooled = true;
+                break;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&s_pool_lock);
+
+    if (!pooled) {
+        return usb_host_transfer_free(transfer);
+    }
+    return ESP_OK;
+}
+
+esp_err_t usb_host_xfer_pool_get_stats(usb_host_xfer_pool_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    memset(stats, 0, sizeof(usb_host_xfer_pool_stats_t));
+    portENTER_CRITICAL(&s_pool_lock);
+    for (size_t i = 0; i < s_pool.class_num; i++) {
+        const xfer_pool_class_t *pool_class = &s_pool.classes[i];
+        stats->classes[i].buffer_size = pool_class->buffer_size;
+        stats->classes[i].count = pool_class->count;
+        stats->classes[i].in_use = pool_class->count - __builtin_popcount(pool_class->free_mask);
+        stats->classes[i].in_use_max = pool_class->in_use_max;
+    }
+    stats->hits = s_pool.hits;
+    stats->misses = s_pool.misses;
+    portEXIT_CRITICAL(&s_pool_lock);
+    return ESP_OK;
+}
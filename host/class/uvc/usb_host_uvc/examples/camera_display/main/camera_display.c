@@ -20,6 +20,7 @@
 #include "jpeg_decoder.h"
 #include "usb/usb_host.h"
 #include "usb/uvc_host.h"
+#include "usb/uvc_host_jpeg.h"
 
 #define FRAME_H_RES  480
 #define FRAME_V_RES  320
@@ -34,6 +35,13 @@
 #define NUMBER_OF_FRAME_BUFFERS 2 // Number of frames from the camera
 #endif
 
+// Targets with JPEG codec decode MJPEG frames in hardware, while next frames are received
+#if SOC_JPEG_CODEC_SUPPORTED
+#define USE_HW_JPEG_DECODER 1
+#else
+#define USE_HW_JPEG_DECODER 0
+#endif
+
 //@todo make the LCD feature optional
 
 static uint16_t *fb = NULL; // Framebuffer for decoded data (to LCD)
@@ -42,6 +50,9 @@ static esp_lcd_panel_handle_t display_panel;
 static QueueHandle_t frame_q = NULL; // Queue of received frames that are passed to processing task
 static SemaphoreHandle_t device_disconnected_sem;
 static uvc_host_stream_hdl_t stream;
+#if USE_HW_JPEG_DECODER
+static uvc_host_jpeg_hdl_t jpeg_stage = NULL;
+#endif
 
 void yuy2_to_rgb565(const uint8_t *yuy2, uint16_t *rgb565, int width, int height);
 
@@ -53,6 +64,13 @@ void stream_callback(const uvc_host_stream_event_data_t *event, void *user_ctx)
         break;
     case UVC_HOST_DEVICE_DISCONNECTED:
         ESP_LOGW(TAG, "Device disconnected");
+#if USE_HW_JPEG_DECODER
+        // The decoding stage holds frames of the stream, it must be deleted first
+        if (jpeg_stage) {
+            ESP_ERROR_CHECK(uvc_host_jpeg_delete(jpeg_stage));
+            jpeg_stage = NULL;
+        }
+#endif
         ESP_ERROR_CHECK(uvc_host_stream_close(event->device_disconnected.stream_hdl));
         xSemaphoreGive(device_disconnected_sem);
         break;
@@ -100,6 +118,15 @@ bool frame_callback(const uvc_host_frame_t *frame, void *user_ctx)
     return frame_processed;
 }
 
+#if USE_HW_JPEG_DECODER
+static bool jpeg_decoded_callback(const uvc_host_jpeg_frame_t *frame, void *user_ctx)
+{
+    ESP_LOGD(TAG, "Decoded frame %dx%d", frame->h_res, frame->v_res);
+    esp_lcd_panel_draw_bitmap(display_panel, 0, 0, frame->h_res, frame->v_res, (const void *)frame->data);
+    return true;
+}
+#endif
+
 static void processing_task(void *pvParameters)
 {
     uvc_host_frame_t *frame;
@@ -209,7 +236,11 @@ void app_main(void)
     // UVC Stream init
     const uvc_host_stream_config_t uvc_stream_config = {
         .event_cb = stream_callback,
+#if USE_HW_JPEG_DECODER
+        .frame_cb = NULL, // Frames are taken by the JPEG decoding stage
+#else
         .frame_cb = frame_callback,
+#endif
         .user_ctx = NULL,
         .usb = {
             .vid = 0,
@@ -232,11 +263,18 @@ void app_main(void)
 #endif
             .number_of_urbs = 3,
             .urb_size = 4 * 1024,
+#if USE_HW_JPEG_DECODER
+            .frame_queue = {
+                .policy = UVC_HOST_FRAME_QUEUE_LATEST, // Decode only the latest frame
+            },
+#endif
         },
     };
 
+#if !USE_HW_JPEG_DECODER
     BaseType_t ret = xTaskCreate(processing_task, "frame_process", 4 * 1024, NULL, 2, NULL);
     assert(ret == pdPASS);
+#endif
 
     while (true) {
         ESP_LOGI(TAG, "Opening the stream...");
@@ -246,6 +284,22 @@ void app_main(void)
             continue;
         }
 
+#if USE_HW_JPEG_DECODER
+        const uvc_host_jpeg_config_t jpeg_config = {
+            .stream_hdl = stream,
+            .decoded_cb = jpeg_decoded_callback,
+            .user_ctx = NULL,
+            .output_format = JPEG_DECODE_OUT_FORMAT_RGB565,
+            .rgb_order = JPEG_DEC_RGB_ELEMENT_ORDER_BGR,
+            .conv_std = JPEG_YUV_RGB_CONV_STD_BT601,
+            .output_buffer_size = 0,
+            .timeout_ms = 0,
+            .task_stack_size = 4 * 1024,
+            .task_priority = 2,
+            .xCoreID = tskNO_AFFINITY,
+        };
+        ESP_ERROR_CHECK(uvc_host_jpeg_create(&jpeg_config, &jpeg_stage));
+#endif
         ESP_ERROR_CHECK(uvc_host_stream_start(stream));
         xSemaphoreTake(device_disconnected_sem, portMAX_DELAY);
     }
@@ -0,0 +1,222 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "usb/usb_host.h"
+#include "usb/uvc_host.h"
+#include "usb/msc_host.h"
+#include "usb/msc_host_vfs.h"
+#include "uvc_recorder.h"
+
+#define EXAMPLE_USB_HOST_PRIORITY   (15)
+#define EXAMPLE_MOUNT_POINT         "/usb"
+#define EXAMPLE_FILE_PATH           EXAMPLE_MOUNT_POINT "/video.avi"
+#define EXAMPLE_RECORDING_LENGTH_S  (30)
+#define EXAMPLE_FRAME_H_RES         (640)
+#define EXAMPLE_FRAME_V_RES         (480)
+#define EXAMPLE_FRAME_FPS           (30)
+#define EXAMPLE_FILE_SIZE           (64 * 1024 * 1024) // Preallocated for EXAMPLE_RECORDING_LENGTH_S of MJPEG
+#define EXAMPLE_MAX_FRAMES          (EXAMPLE_RECORDING_LENGTH_S * EXAMPLE_FRAME_FPS)
+#if CONFIG_SPIRAM
+#define EXAMPLE_FRAME_COUNT         (4)
+#define EXAMPLE_WRITE_BUFFER_SIZE   (128 * 1024)
+#else
+#define EXAMPLE_FRAME_COUNT         (3)
+#define EXAMPLE_WRITE_BUFFER_SIZE   (32 * 1024)
+#endif
+
+static const char *TAG = "example";
+static QueueHandle_t msc_event_queue;
+static uvc_recorder_hdl_t recorder = NULL;
+
+static void msc_event_cb(const msc_host_event_t *event, void *arg)
+{
+    // Devices are installed in the main task, not in MSC driver task
+    xQueueSend(msc_event_queue, event, 0);
+}
+
+static bool frame_callback(const uvc_host_frame_t *frame, void *user_ctx)
+{
+    if (!recorder) {
+        return true;
+    }
+    return uvc_recorder_frame_add(recorder, frame);
+}
+
+static void stream_callback(const uvc_host_stream_event_data_t *event, void *user_ctx)
+{
+    switch (event->type) {
+    case UVC_HOST_TRANSFER_ERROR:
+        ESP_LOGE(TAG, "USB error has occurred, err_no = %i", event->transfer_error.error);
+        break;
+    case UVC_HOST_DEVICE_DISCONNECTED:
+        ESP_LOGW(TAG, "Camera disconnected");
+        break;
+    case UVC_HOST_FRAME_BUFFER_OVERFLOW:
+        ESP_LOGW(TAG, "Frame buffer overflow");
+        break;
+    case UVC_HOST_FRAME_BUFFER_UNDERFLOW:
+        ESP_LOGW(TAG, "Frame buffer underflow");
+        break;
+    default:
+        abort();
+        break;
+    }
+}
+
+static void usb_lib_task(void *arg)
+{
+    while (1) {
+        uint32_t event_flags;
+        usb_host_lib_handle_events(portMAX_DELAY, &event_flags);
+        if (event_flags & USB_HOST_LIB_EVENT_FLAGS_NO_CLIENTS) {
+            usb_host_device_free_all();
+        }
+    }
+}
+
+static void print_stats(const uvc_recorder_stats_t *stats)
+{
+    ESP_LOGI(TAG, "Recorded frames: %"PRIu32", bytes: %"PRIu64", longest write: %"PRIu32" us",
+             stats->frames_recorded, stats->bytes_written, stats->max_write_us);
+    ESP_LOGI(TAG, "Dropped by recorder: queue full %"PRIu32", file full %"PRIu32,
+             stats->frames_dropped.queue_full, stats->frames_dropped.file_full);
+    ESP_LOGI(TAG, "Dropped by driver: error %"PRIu32", missing EoF %"PRIu32", overflow %"PRIu32", underflow %"PRIu32,
+             stats->stream.frames_dropped.error, stats->stream.frames_dropped.missing_eof,
+             stats->stream.frames_dropped.overflow, stats->stream.frames_dropped.underflow);
+}
+
+/**
+ * @brief Main application
+ *
+ * Waits for USB flash drive, then records MJPEG stream of the camera into AVI file on the drive.
+ * Both devices can be connected through USB hub.
+ */
+void app_main(void)
+{
+    msc_event_queue = xQueueCreate(4, sizeof(msc_host_event_t));
+    assert(msc_event_queue);
+
+    ESP_LOGI(TAG, "Installing USB Host");
+    const usb_host_config_t host_config = {
+        .skip_phy_setup = false,
+        .intr_flags = ESP_INTR_FLAG_LEVEL1,
+    };
+    ESP_ERROR_CHECK(usb_host_install(&host_config));
+    BaseType_t task_created = xTaskCreatePinnedToCore(usb_lib_task, "usb_lib", 4096, NULL, EXAMPLE_USB_HOST_PRIORITY, NULL, tskNO_AFFINITY);
+    assert(task_created == pdTRUE);
+
+    ESP_LOGI(TAG, "Installing MSC and UVC drivers");
+    const msc_host_driver_config_t msc_config = {
+        .create_backround_task = true,
+        .task_priority = EXAMPLE_USB_HOST_PRIORITY - 1,
+        .stack_size = 4096,
+        .core_id = tskNO_AFFINITY,
+        .callback = msc_event_cb,
+    };
+    ESP_ERROR_CHECK(msc_host_install(&msc_config));
+    const uvc_host_driver_config_t uvc_driver_config = {
+        .driver_task_stack_size = 4 * 1024,
+        .driver_task_priority = EXAMPLE_USB_HOST_PRIORITY + 1,
+        .xCoreID = tskNO_AFFINITY,
+        .create_background_task = true,
+    };
+    ESP_ERROR_CHECK(uvc_host_install(&uvc_driver_config));
+
+    ESP_LOGI(TAG, "Waiting for USB flash drive");
+    msc_host_event_t msc_event;
+    do {
+        xQueueReceive(msc_event_queue, &msc_event, portMAX_DELAY);
+    } while (msc_event.event != MSC_DEVICE_CONNECTED);
+
+    msc_host_device_handle_t msc_device;
+    msc_host_device_info_t msc_info;
+    msc_host_vfs_handle_t vfs_handle;
+    ESP_ERROR_CHECK(msc_host_install_device(msc_event.device.address, &msc_device));
+    ESP_ERROR_CHECK(msc_host_get_device_info(msc_device, &msc_info));
+    const esp_vfs_fat_mount_config_t mount_config = {
+        .format_if_mount_failed = false,
+        .max_files = 3,
+        .allocation_unit_size = 32 * 1024,
+    };
+    ESP_ERROR_CHECK(msc_host_vfs_register(msc_device, EXAMPLE_MOUNT_POINT, &mount_config, &vfs_handle));
+
+    ESP_LOGI(TAG, "Opening camera");
+    const uvc_host_stream_config_t stream_config = {
+        .event_cb = stream_callback,
+        .frame_cb = frame_callback,
+        .user_ctx = NULL,
+        .usb = {
+            .vid = UVC_HOST_ANY_VID,
+            .pid = UVC_HOST_ANY_PID,
+            .uvc_stream_index = 0,
+        },
+        .vs_format = {
+            .h_res = EXAMPLE_FRAME_H_RES,
+            .v_res = EXAMPLE_FRAME_V_RES,
+            .fps = EXAMPLE_FRAME_FPS,
+            .format = UVC_VS_FORMAT_MJPEG,
+        },
+        .advanced = {
+            .number_of_frame_buffers = EXAMPLE_FRAME_COUNT,
+            .frame_size = 0,
+            .number_of_urbs = 0, // Derived from the negotiated format
+            .urb_size = 0,
+        },
+    };
+    uvc_host_stream_hdl_t stream;
+    ESP_ERROR_CHECK(uvc_host_stream_open(&stream_config, pdMS_TO_TICKS(5000), &stream));
+
+    const uvc_recorder_config_t recorder_config = {
+        .stream_hdl = stream,
+        .base_path = EXAMPLE_MOUNT_POINT,
+        .file_path = EXAMPLE_FILE_PATH,
+        .file_size = EXAMPLE_FILE_SIZE,
+        .write_buffer_size = EXAMPLE_WRITE_BUFFER_SIZE,
+        .sector_size = msc_info.sector_size,
+        .max_frames = EXAMPLE_MAX_FRAMES,
+        .frame_queue_len = EXAMPLE_FRAME_COUNT - 1, // One frame buffer is always free for the frame being received
+        .write_buffer_heap_caps = 0,
+        .task_priority = EXAMPLE_USB_HOST_PRIORITY - 2,
+    };
+    ESP_ERROR_CHECK(uvc_recorder_start(&recorder_config, &recorder));
+    ESP_ERROR_CHECK(uvc_host_stream_start(stream));
+
+    for (int i = 0; i < EXAMPLE_RECORDING_LENGTH_S; i++) {
+        vTaskDelay(pdMS_TO_TICKS(1000));
+        uvc_recorder_stats_t stats;
+        ESP_ERROR_CHECK(uvc_recorder_get_stats(recorder, &stats));
+        ESP_LOGI(TAG, "%d s: %"PRIu32" frames recorded, %"PRIu32" dropped", i + 1, stats.frames_recorded,
+                 stats.frames_dropped.queue_full + stats.frames_dropped.file_full + stats.stream.frames_dropped.underflow);
+    }
+
+    ESP_ERROR_CHECK(uvc_host_stream_stop(stream));
+    uvc_recorder_stats_t stats;
+    const esp_err_t err = uvc_recorder_stop(recorder, &stats);
+    recorder = NULL;
+    print_stats(&stats);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Recording saved to %s", EXAMPLE_FILE_PATH);
+    } else {
+        ESP_LOGE(TAG, "Recording failed: %s", esp_err_to_name(err));
+    }
+
+    ESP_ERROR_CHECK(uvc_host_stream_close(stream));
+    ESP_ERROR_CHECK(msc_host_vfs_unregister(vfs_handle));
+    ESP_ERROR_CHECK(msc_host_uninstall_device(msc_device));
+    ESP_LOGI(TAG, "Done, the drive can be removed");
+}
@@ -0,0 +1,478 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/param.h>
+
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_vfs_fat.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "uvc_recorder.h"
+
+#define RECORDER_NUM_OF_BUFFERS     (2)   // Double-buffered writes: one buffer is filled while the other one is written
+#define RECORDER_BUFFER_ALIGNMENT   (64)  // Cache line, so write buffers can be in PSRAM
+#define RECORDER_DEFAULT_SECTOR     (512)
+#define RECORDER_TASK_STACK         (4096)
+
+#define AVI_FOURCC(a, b, c, d)      ((uint32_t)(a) | ((uint32_t)(b) << 8) | ((uint32_t)(c) << 16) | ((uint32_t)(d) << 24))
+#define AVI_CHUNK_HEADER_LEN        (8)   // FourCC and size
+#define AVI_HEADER_LEN              (212) // RIFF and hdrl list with avih, strh and strf chunks
+#define AVI_MOVI_HEADER_LEN         (12)  // LIST, size and movi
+#define AVIF_HASINDEX               (0x10)
+#define AVIIF_KEYFRAME              (0x10)
+
+static const char *TAG = "uvc-recorder";
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+} recorder_buffer_t;
+
+/**
+ * @brief Entry of AVI index idx1
+ *
+ * Written into the file as it is, the target is little-endian
+ */
+typedef struct {
+    uint32_t ckid;
+    uint32_t flags;
+    uint32_t offset;                   // Offset of the chunk from movi FourCC
+    uint32_t size;                     // Size of the chunk data
+} avi_index_entry_t;
+
+struct uvc_recorder_s {
+    uvc_host_stream_hdl_t stream_hdl;
+    uvc_host_stream_format_t vs_format;
+    int fd;
+    size_t sector_size;
+    size_t write_buffer_size;
+    uint64_t data_end;                 // End of area for frames, the rest of the file is reserved for AVI index
+    uint32_t max_frames;
+    avi_index_entry_t *index;
+    recorder_buffer_t buffers[RECORDER_NUM_OF_BUFFERS];
+    QueueHandle_t frame_queue;         // Frames passed by uvc_recorder_frame_add(). NULL stops the recorder task
+    QueueHandle_t write_queue;         // Filled buffers for writer task. NULL stops the writer task
+    QueueHandle_t free_buffer_queue;   // Buffers written by writer task
+    SemaphoreHandle_t task_done_sem;   // Given by writer task to recorder task at its end, then by recorder task to uvc_recorder_stop()
+    bool write_failed;
+    uvc_recorder_stats_t stats;
+
+    // Members below are accessed only from recorder task
+    recorder_buffer_t *current;        // Buffer being filled
+    uint64_t offset;                   // File offset of the end of data in current buffer
+    uint32_t max_chunk;                // Largest frame chunk, for AVI header
+};
+
+static uint8_t *avi_put16(uint8_t *p, uint16_t value)
+{
+    p[0] = value & 0xFF;
+    p[1] = value >> 8;
+    return p + 2;
+}
+
+static uint8_t *avi_put32(uint8_t *p, uint32_t value)
+{
+    p = avi_put16(p, value & 0xFFFF);
+    return avi_put16(p, value >> 16);
+}
+
+static uint8_t *avi_put_fourcc(uint8_t *p, const char *fourcc)
+{
+    memcpy(p, fourcc, 4);
+    return p + 4;
+}
+
+/**
+ * @brief Fill AVI header of one sector
+ *
+ * RIFF header, hdrl list and JUNK padding, so the movi list starts its data at sector boundary.
+ *
+ * @param[in]  recorder Recorder
+ * @param[out] p        Buffer of sector size
+ * @param[in]  movi_end File offset of the end of movi list
+ * @param[in]  file_end Size of the file
+ */
+static void recorder_avi_header(const struct uvc_recorder_s *recorder, uint8_t *p, uint64_t movi_end, uint64_t file_end)
+{
+    const uint32_t frames = recorder->stats.frames_recorded;
+    const uint32_t h_res = recorder->vs_format.h_res;
+    const uint32_t v_res = recorder->vs_format.v_res;
+    const float fps = recorder->vs_format.fps > 0 ? recorder->vs_format.fps : 30;
+
+    p = avi_put_fourcc(p, "RIFF");
+    p = avi_put32(p, file_end - 8);
+    p = avi_put_fourcc(p, "AVI ");
+
+    p = avi_put_fourcc(p, "LIST");
+    p = avi_put32(p, 192);
+    p = avi_put_fourcc(p, "hdrl");
+    p = avi_put_fourcc(p, "avih");
+    p = avi_put32(p, 56);
+    p = avi_put32(p, (uint32_t)(1000000 / fps));            // dwMicroSecPerFrame
+    p = avi_put32(p, 0);                                    // dwMaxBytesPerSec
+    p = avi_put32(p, 0);                                    // dwPaddingGranularity
+    p = avi_put32(p, AVIF_HASINDEX);                        // dwFlags
+    p = avi_put32(p, frames);                               // dwTotalFrames
+    p = avi_put32(p, 0);                                    // dwInitialFrames
+    p = avi_put32(p, 1);                                    // dwStreams
+    p = avi_put32(p, recorder->max_chunk);                  // dwSuggestedBufferSize
+    p = avi_put32(p, h_res);
+    p = avi_put32(p, v_res);
+    memset(p, 0, 16);                                       // dwReserved
+    p += 16;
+
+    p = avi_put_fourcc(p, "LIST");
+    p = avi_put32(p, 116);
+    p = avi_put_fourcc(p, "strl");
+    p = avi_put_fourcc(p, "strh");
+    p = avi_put32(p, 56);
+    p = avi_put_fourcc(p, "vids");
+    p = avi_put_fourcc(p, "MJPG");
+    p = avi_put32(p, 0);                                    // dwFlags
+    p = avi_put16(p, 0);                                    // wPriority
+    p = avi_put16(p, 0);                                    // wLanguage
+    p = avi_put32(p, 0);                                    // dwInitialFrames
+    p = avi_put32(p, 1000);                                 // dwScale
+    p = avi_put32(p, (uint32_t)(fps * 1000));               // dwRate
+    p = avi_put32(p, 0);                                    // dwStart
+    p = avi_put32(p, frames);                               // dwLength
+    p = avi_put32(p, recorder->max_chunk);                  // dwSuggestedBufferSize
+    p = avi_put32(p, UINT32_MAX);                           // dwQuality: default
+    p = avi_put32(p, 0);                                    // dwSampleSize: variable
+    p = avi_put16(p, 0);                                    // rcFrame
+    p = avi_put16(p, 0);
+    p = avi_put16(p, h_res);
+    p = avi_put16(p, v_res);
+    p = avi_put_fourcc(p, "strf");
+    p = avi_put32(p, 40);
+    p = avi_put32(p, 40);                                   // BITMAPINFOHEADER biSize
+    p = avi_put32(p, h_res);
+    p = avi_put32(p, v_res);
+    p = avi_put16(p, 1);                                    // biPlanes
+    p = avi_put16(p, 24);                                   // biBitCount
+    p = avi_put_fourcc(p, "MJPG");                          // biCompression
+    p = avi_put32(p, h_res * v_res * 3);                    // biSizeImage
+    memset(p, 0, 16);                                       // Pixels per meter and colors
+    p += 16;
+
+    const size_t junk_len = recorder->sector_size - AVI_HEADER_LEN - AVI_CHUNK_HEADER_LEN - AVI_MOVI_HEADER_LEN;
+    p = avi_put_fourcc(p, "JUNK");
+    p = avi_put32(p, junk_len);
+    memset(p, 0, junk_len);
+    p += junk_len;
+
+    p = avi_put_fourcc(p, "LIST");
+    p = avi_put32(p, movi_end - (recorder->sector_size - 4));
+    avi_put_fourcc(p, "movi");
+}
+
+/**
+ * @brief Pass current buffer to writer task and take the other one
+ *
+ * Blocks while the other buffer is being written
+ */
+static void recorder_submit(struct uvc_recorder_s *recorder)
+{
+    xQueueSend(recorder->write_queue, &recorder->current, portMAX_DELAY);
+    xQueueReceive(recorder->free_buffer_queue, &recorder->current, portMAX_DELAY);
+}
+
+/**
+ * @brief Append data to the file
+ *
+ * @param[in] recorder Recorder
+ * @param[in] data     Data to append. NULL for zeros
+ * @param[in] len      Length of data
+ */
+static void recorder_append(struct uvc_recorder_s *recorder, const uint8_t *data, size_t len)
+{
+    while (len) {
+        if (recorder->current->len == recorder->write_buffer_size) {
+            recorder_submit(recorder);
+        }
+        recorder_buffer_t *buffer = recorder->current;
+        const size_t part = MIN(len, recorder->write_buffer_size - buffer->len);
+        if (data) {
+            memcpy(buffer->data + buffer->len, data, part);
+            data += part;
+        } else {
+            memset(buffer->data + buffer->len, 0, part);
+        }
+        buffer->len += part;
+        recorder->offset += part;
+        len -= part;
+    }
+}
+
+static void recorder_chunk_header(struct uvc_recorder_s *recorder, const char *fourcc, uint32_t len)
+{
+    uint8_t header[AVI_CHUNK_HEADER_LEN];
+    avi_put32(avi_put_fourcc(header, fourcc), len);
+    recorder_append(recorder, header, sizeof(header));
+}
+
+static void recorder_frame_write(struct uvc_recorder_s *recorder, const uvc_host_frame_t *frame)
+{
+    const uint32_t padding = frame->data_len & 1; // Chunks are word aligned
+    const uint32_t chunk_len = AVI_CHUNK_HEADER_LEN + frame->data_len + padding;
+    if (recorder->write_failed || recorder->stats.frames_recorded == recorder->max_frames ||
+            recorder->offset + chunk_len > recorder->data_end) {
+        recorder->stats.frames_dropped.file_full++;
+        return;
+    }
+
+    avi_index_entry_t *entry = &recorder->index[recorder->stats.frames_recorded];
+    entry->ckid = AVI_FOURCC('0', '0', 'd', 'c');
+    entry->flags = AVIIF_KEYFRAME; // Every MJPEG frame is a key frame
+    entry->offset = recorder->offset - (recorder->sector_size - 4);
+    entry->size = frame->data_len;
+
+    recorder_chunk_header(recorder, "00dc", frame->data_len);
+    recorder_append(recorder, frame->data, frame->data_len);
+    recorder_append(recorder, NULL, padding);
+    recorder->max_chunk = MAX(recorder->max_chunk, chunk_len);
+    recorder->stats.frames_recorded++;
+}
+
+static void recorder_file_write(struct uvc_recorder_s *recorder, const void *data, size_t len)
+{
+    if (recorder->write_failed) {
+        return;
+    }
+    if (write(recorder->fd, data, len) != (ssize_t)len) {
+        ESP_LOGE(TAG, "Write failed, errno %d", errno);
+        recorder->write_failed = true;
+        return;
+    }
+    recorder->stats.bytes_written += len;
+}
+
+/**
+ * @brief Complete the AVI file
+ *
+ * The last buffer is padded to whole sectors. Then AVI index is written behind the movi list,
+ * AVI header is rewritten with final sizes and the preallocated file is truncated.
+ */
+static void recorder_finish(struct uvc_recorder_s *recorder)
+{
+    const size_t tail = recorder->offset % recorder->sector_size;
+    if (tail) {
+        size_t padding = recorder->sector_size - tail;
+        if (padding < AVI_CHUNK_HEADER_LEN) {
+            padding += recorder->sector_size;
+        }
+        recorder_chunk_header(recorder, "JUNK", padding - AVI_CHUNK_HEADER_LEN);
+        recorder_append(recorder, NULL, padding - AVI_CHUNK_HEADER_LEN);
+    }
+    const uint64_t movi_end = recorder->offset;
+    if (recorder->current->len) {
+        recorder_submit(recorder);
+    }
+
+    // Stop the writer task, all buffers are written then
+    recorder_buffer_t *stop = NULL;
+    xQueueSend(recorder->write_queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(recorder->task_done_sem, portMAX_DELAY);
+
+    const uint32_t index_len = recorder->stats.frames_recorded * sizeof(avi_index_entry_t);
+    uint8_t *buffer = recorder->current->data;
+    avi_put32(avi_put_fourcc(buffer, "idx1"), index_len);
+    recorder_file_write(recorder, buffer, AVI_CHUNK_HEADER_LEN);
+    recorder_file_write(recorder, recorder->index, index_len);
+
+    const uint64_t file_end = movi_end + AVI_CHUNK_HEADER_LEN + index_len;
+    recorder_avi_header(recorder, buffer, movi_end, file_end);
+    if (!recorder->write_failed && lseek(recorder->fd, 0, SEEK_SET) != 0) {
+        recorder->write_failed = true;
+    }
+    recorder_file_write(recorder, buffer, recorder->sector_size);
+    if (!recorder->write_failed && ftruncate(recorder->fd, file_end) != 0) {
+        ESP_LOGE(TAG, "Truncate failed, errno %d", errno);
+        recorder->write_failed = true;
+    }
+    if (close(recorder->fd) != 0) {
+        recorder->write_failed = true;
+    }
+    recorder->fd = -1;
+}
+
+static void recorder_writer_task(void *arg)
+{
+    struct uvc_recorder_s *recorder = (struct uvc_recorder_s *)arg;
+    recorder_buffer_t *buffer;
+    while (xQueueReceive(recorder->write_queue, &buffer, portMAX_DELAY) == pdPASS && buffer) {
+        const int64_t start = esp_timer_get_time();
+        recorder_file_write(recorder, buffer->data, buffer->len);
+        const uint32_t write_us = esp_timer_get_time() - start;
+
+        recorder->stats.max_write_us = MAX(recorder->stats.max_write_us, write_us);
+        buffer->len = 0;
+        xQueueSend(recorder->free_buffer_queue, &buffer, portMAX_DELAY);
+    }
+    xSemaphoreGive(recorder->task_done_sem);
+    vTaskDelete(NULL);
+}
+
+static void recorder_task(void *arg)
+{
+    struct uvc_recorder_s *recorder = (struct uvc_recorder_s *)arg;
+    uvc_host_frame_t *frame;
+    while (xQueueReceive(recorder->frame_queue, &frame, portMAX_DELAY) == pdPASS && frame) {
+        recorder_frame_write(recorder, frame);
+        uvc_host_frame_return(recorder->stream_hdl, frame); // The frame was copied, its buffer can receive next frame
+    }
+    recorder_finish(recorder);
+    xSemaphoreGive(recorder->task_done_sem);
+    vTaskDelete(NULL);
+}
+
+static void recorder_free(struct uvc_recorder_s *recorder)
+{
+    if (recorder->fd >= 0) {
+        close(recorder->fd);
+    }
+    for (int i = 0; i < RECORDER_NUM_OF_BUFFERS; i++) {
+        heap_caps_free(recorder->buffers[i].data);
+    }
+    heap_caps_free(recorder->index);
+    if (recorder->frame_queue) {
+        vQueueDelete(recorder->frame_queue);
+    }
+    if (recorder->write_queue) {
+        vQueueDelete(recorder->write_queue);
+    }
+    if (recorder->free_buffer_queue) {
+        vQueueDelete(recorder->free_buffer_queue);
+    }
+    if (recorder->task_done_sem) {
+        vSemaphoreDelete(recorder->task_done_sem);
+    }
+    free(recorder);
+}
+
+esp_err_t uvc_recorder_start(const uvc_recorder_config_t *config, uvc_recorder_hdl_t *recorder_ret)
+{
+    esp_err_t ret = ESP_OK;
+    ESP_RETURN_ON_FALSE(config && config->stream_hdl && config->base_path && config->file_path && recorder_ret &&
+                        config->max_frames && config->frame_queue_len, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    const size_t sector_size = config->sector_size ? config->sector_size : RECORDER_DEFAULT_SECTOR;
+    ESP_RETURN_ON_FALSE(sector_size >= AVI_HEADER_LEN + AVI_CHUNK_HEADER_LEN + AVI_MOVI_HEADER_LEN &&
+                        config->write_buffer_size && config->write_buffer_size % sector_size == 0,
+                        ESP_ERR_INVALID_ARG, TAG, "Write buffer must be a multiple of sector size");
+    const uint64_t index_size = AVI_CHUNK_HEADER_LEN + (uint64_t)config->max_frames * sizeof(avi_index_entry_t);
+    const uint64_t reserved_size = index_size + 2 * sector_size; // Index and padding of the last buffer
+    ESP_RETURN_ON_FALSE(config->file_size <= UINT32_MAX && config->file_size > sector_size + reserved_size,
+                        ESP_ERR_INVALID_ARG, TAG, "File size does not fit AVI header and index");
+
+    uvc_host_stream_format_t vs_format;
+    ESP_RETURN_ON_ERROR(uvc_host_stream_format_get(config->stream_hdl, &vs_format), TAG, "Could not get stream format");
+    ESP_RETURN_ON_FALSE(vs_format.format == UVC_VS_FORMAT_MJPEG, ESP_ERR_NOT_SUPPORTED, TAG, "Only MJPEG streams can be recorded");
+
+    struct uvc_recorder_s *recorder = calloc(1, sizeof(struct uvc_recorder_s));
+    ESP_RETURN_ON_FALSE(recorder, ESP_ERR_NO_MEM, TAG, "Not enough memory");
+    recorder->fd = -1;
+    recorder->stream_hdl = config->stream_hdl;
+    recorder->vs_format = vs_format;
+    recorder->sector_size = sector_size;
+    recorder->write_buffer_size = config->write_buffer_size;
+    recorder->data_end = config->file_size - reserved_size;
+    recorder->max_frames = config->max_frames;
+
+    const uint32_t caps = config->write_buffer_heap_caps ? config->write_buffer_heap_caps : MALLOC_CAP_DEFAULT;
+    recorder->index = heap_caps_calloc(config->max_frames, sizeof(avi_index_entry_t), caps);
+    ESP_GOTO_ON_FALSE(recorder->index, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for AVI index");
+    recorder->frame_queue = xQueueCreate(config->frame_queue_len, sizeof(uvc_host_frame_t *));
+    recorder->write_queue = xQueueCreate(RECORDER_NUM_OF_BUFFERS + 1, sizeof(recorder_buffer_t *)); // + stop request
+    recorder->free_buffer_queue = xQueueCreate(RECORDER_NUM_OF_BUFFERS, sizeof(recorder_buffer_t *));
+    recorder->task_done_sem = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(recorder->frame_queue && recorder->write_queue && recorder->free_buffer_queue && recorder->task_done_sem,
+                      ESP_ERR_NO_MEM, err, TAG, "Not enough memory for queues");
+    for (int i = 0; i < RECORDER_NUM_OF_BUFFERS; i++) {
+        recorder_buffer_t *buffer = &recorder->buffers[i];
+        buffer->data = heap_caps_aligned_alloc(RECORDER_BUFFER_ALIGNMENT, config->write_buffer_size, caps);
+        ESP_GOTO_ON_FALSE(buffer->data, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for write buffer %zu", config->write_buffer_size);
+        xQueueSend(recorder->free_buffer_queue, &buffer, 0);
+    }
+
+    // Preallocate contiguous file, so FATFS does not search for free clusters during recording
+    ESP_GOTO_ON_ERROR(esp_vfs_fat_create_contiguous_file(config->base_path, config->file_path, config->file_size, true),
+                      err, TAG, "Could not preallocate %s", config->file_path);
+    recorder->fd = open(config->file_path, O_WRONLY);
+    ESP_GOTO_ON_FALSE(recorder->fd >= 0, ESP_FAIL, err, TAG, "Could not open %s, errno %d", config->file_path, errno);
+
+    // Placeholder of AVI header, it is completed by uvc_recorder_stop()
+    xQueueReceive(recorder->free_buffer_queue, &recorder->current, 0);
+    recorder_avi_header(recorder, recorder->current->data, sector_size, sector_size);
+    recorder->current->len = sector_size;
+    recorder->offset = sector_size;
+
+    ESP_GOTO_ON_FALSE(pdPASS == xTaskCreatePinnedToCore(recorder_writer_task, "uvc_writer", RECORDER_TASK_STACK, recorder, config->task_priority, NULL, tskNO_AFFINITY),
+                      ESP_ERR_NO_MEM, err, TAG, "Could not create writer task");
+    if (pdPASS != xTaskCreatePinnedToCore(recorder_task, "uvc_recorder", RECORDER_TASK_STACK, recorder, config->task_priority, NULL, tskNO_AFFINITY)) {
+        ESP_LOGE(TAG, "Could not create recorder task");
+        recorder_buffer_t *stop = NULL;
+        xQueueSend(recorder->write_queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(recorder->task_done_sem, portMAX_DELAY);
+        ret = ESP_ERR_NO_MEM;
+        goto err;
+    }
+
+    ESP_LOGI(TAG, "Recording %"PRIu32"x%"PRIu32" MJPEG into %s", (uint32_t)vs_format.h_res, (uint32_t)vs_format.v_res, config->file_path);
+    *recorder_ret = recorder;
+    return ESP_OK;
+
+err:
+    recorder_free(recorder);
+    return ret;
+}
+
+bool uvc_recorder_frame_add(uvc_recorder_hdl_t recorder, const uvc_host_frame_t *frame)
+{
+    assert(recorder && frame);
+    if (pdPASS != xQueueSend(recorder->frame_queue, &frame, 0)) {
+        recorder->stats.frames_dropped.queue_full++;
+        return true;
+    }
+    return false;
+}
+
+esp_err_t uvc_recorder_get_stats(uvc_recorder_hdl_t recorder, uvc_recorder_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(recorder && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+    *stats = recorder->stats;
+    return uvc_host_stream_get_stats(recorder->stream_hdl, &stats->stream);
+}
+
+esp_err_t uvc_recorder_stop(uvc_recorder_hdl_t recorder, uvc_recorder_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(recorder, ESP_ERR_INVALID_ARG, TAG, "Invalid argument");
+
+    // Queued frames are written before the stop request. The recorder task waits for the writer task
+    const uvc_host_frame_t *stop = NULL;
+    xQueueSend(recorder->frame_queue, &stop, portMAX_DELAY);
+    xSemaphoreTake(recorder->task_done_sem, portMAX_DELAY);
+
+    if (stats) {
+        uvc_recorder_get_stats(recorder, stats);
+    }
+    const esp_err_t ret = recorder->write_failed ? ESP_FAIL : ESP_OK;
+    ESP_LOGI(TAG, "Recorded %"PRIu32" frames, %"PRIu64" bytes", recorder->stats.frames_recorded, recorder->stats.bytes_written);
+    recorder_free(recorder);
+    return ret;
+}
@@ -0,0 +1,109 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uvc_recorder_s *uvc_recorder_hdl_t;
+
+/**
+ * @brief Configuration of UVC recorder
+ */
+typedef struct {
+    uvc_host_stream_hdl_t stream_hdl;    /**< Opened MJPEG stream */          
+    const char *base_path;               /**< Base path of FAT filesystem registered by msc_host_vfs_register() */
+    const char *file_path;               /**< Full path of AVI file, e.g. "/usb/video.avi" */
+    uint64_t file_size;                  /**< Size of the file preallocated before recording. Recording stops when the file is full */
+    size_t write_buffer_size;            /**< Size of each of the two write buffers. Multiple of sector size */
+    size_t sector_size;                  /**< Sector size of the filesystem. 0: 512 bytes */
+    uint32_t max_frames;                 /**< Maximum number of recorded frames, size of AVI index */
+    unsigned frame_queue_len;            /**< Frames waiting to be written. At most number_of_frame_buffers of the stream */
+    uint32_t write_buffer_heap_caps;     /**< Memory capabilities for write buffers and AVI index. 0: MALLOC_CAP_DEFAULT */
+    int task_priority;                   /**< Priority of recorder and writer tasks */
+} uvc_recorder_config_t;
+
+/**
+ * @brief Statistics of UVC recorder
+ */
+typedef struct {
+    uint32_t frames_recorded;            /**< Frames written into the file */
+    struct {
+        uint32_t queue_full;             /**< Frame queue was full, frames are received faster than written */
+        uint32_t file_full;              /**< File or AVI index was full, or the write failed */
+    } frames_dropped;                    /**< Frames dropped by the recorder */
+    uint64_t bytes_written;              /**< Bytes written into the file, including AVI chunk headers and padding */
+    uint32_t max_write_us;               /**< Longest write of one write buffer in microseconds */
+    uvc_host_stream_stats_t stream;      /**< Statistics of the recorded stream, with frames dropped by the driver */
+} uvc_recorder_stats_t;
+
+/**
+ * @brief Start recording of UVC stream into AVI file
+ *
+ * The file is preallocated as one contiguous area of `file_size` bytes, so no cluster allocation happens while recording.
+ * Frames are copied into one of two write buffers, while the other one is written into the file.
+ * All writes of the buffers start at sector boundary and have whole sectors, so FATFS writes them directly to the device.
+ *
+ * @note The stream must be opened, but it is not started by this function
+ * @param[in]  config       Configuration of the recorder
+ * @param[out] recorder_ret Recorder handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL or write buffer is not a multiple of sector size
+ *     - ESP_ERR_NOT_SUPPORTED: Format of the stream cannot be recorded into AVI
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ *     - ESP_FAIL: The file could not be preallocated or opened
+ */
+esp_err_t uvc_recorder_start(const uvc_recorder_config_t *config, uvc_recorder_hdl_t *recorder_ret);
+
+/**
+ * @brief Pass received frame to the recorder
+ *
+ * Call it from the frame callback of the stream and return its result from the frame callback.
+ *
+ * @param[in] recorder Recorder handle
+ * @param[in] frame    Received frame
+ * @return true if the frame was dropped and can be returned
+ * @return false if the frame will be returned by the recorder after it is copied into write buffer
+ */
+bool uvc_recorder_frame_add(uvc_recorder_hdl_t recorder, const uvc_host_frame_t *frame);
+
+/**
+ * @brief Get statistics of the recorder
+ *
+ * @param[in]  recorder Recorder handle
+ * @param[out] stats    Statistics of the recorder and of the recorded stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ */
+esp_err_t uvc_recorder_get_stats(uvc_recorder_hdl_t recorder, uvc_recorder_stats_t *stats);
+
+/**
+ * @brief Stop recording and complete the AVI file
+ *
+ * Queued frames are written, then AVI index and header are written and the file is truncated to its real size.
+ *
+ * @note The stream must be stopped first, no frame can be added during and after this call
+ * @param[in]  recorder Recorder handle
+ * @param[out] stats    Final statistics of the recording. Can be NULL
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: recorder is NULL
+ *     - ESP_FAIL: Write into the file failed, the file may be incomplete
+ */
+esp_err_t uvc_recorder_stop(uvc_recorder_hdl_t recorder, uvc_recorder_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
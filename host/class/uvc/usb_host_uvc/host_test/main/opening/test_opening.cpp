@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include <catch2/catch_test_macros.hpp>
 
 #include "usb/uvc_host.h"
@@ -264,3 +265,101 @@ SCENARIO("Test mocked device format negotiation")
         REQUIRE(ESP_OK == test_uvc_host_uninstall());
     }
 }
+
+SCENARIO("Test mocked device camera controls")
+{
+    SECTION("Add mocked devices") {
+        _add_mocked_devices();
+    }
+
+    SECTION("Install the UVC driver") {
+        const uvc_host_driver_config_t uvc_driver_config = {
+            .driver_task_stack_size = 4 * 1024,
+            .driver_task_priority = 10,
+            .xCoreID = tskNO_AFFINITY,
+            .create_background_task = true,
+            .event_cb = nullptr,
+            .user_ctx = nullptr,
+        };
+        REQUIRE(ESP_OK == test_uvc_host_install(&uvc_driver_config));
+
+        uvc_host_stream_config_t stream_config = {
+            .event_cb = nullptr,
+            .frame_cb = nullptr,
+            .user_ctx = nullptr,
+            .usb = {
+                .dev_addr = 1, // Logitech C270: Camera Terminal 1, Processing Unit 2
+                .vid = UVC_HOST_ANY_VID,
+                .pid = UVC_HOST_ANY_PID,
+                .uvc_stream_index = 0,
+            },
+            .vs_format = {
+                .h_res = 1280,
+                .v_res = 720,
+                .fps = 15,
+                .format = UVC_VS_FORMAT_MJPEG,
+            },
+            .advanced = {
+                .number_of_frame_buffers = 3,
+                .frame_size = 0,
+                .frame_heap_caps = 0,
+                .number_of_urbs = 4,
+                .urb_size = 10 * 1024,
+            },
+        };
+        uvc_host_stream_hdl_t stream = nullptr;
+        REQUIRE(ESP_OK == test_uvc_host_stream_open(&stream_config, 0, &stream, true));
+
+        THEN("Units and Terminals are found in Video Control interface") {
+            uint8_t entity_id = 0;
+            REQUIRE(ESP_OK == uvc_host_stream_entity_id_get(stream, UVC_HOST_ENTITY_CAMERA_TERMINAL, &entity_id));
+            REQUIRE(entity_id == 1);
+            REQUIRE(ESP_OK == uvc_host_stream_entity_id_get(stream, UVC_HOST_ENTITY_PROCESSING_UNIT, &entity_id));
+            REQUIRE(entity_id == 2);
+        }
+
+        THEN("Control range is read from the device only once") {
+            uvc_host_control_range_t range, cached_range;
+            usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get info
+            usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get min
+            usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get max
+            usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get res
+            usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get def
+            REQUIRE(ESP_OK == uvc_host_stream_control_range_get(stream, 2, UVC_PU_BRIGHTNESS_CONTROL, 2, &range));
+
+            // No CTRL transfer is expected for cached range
+            REQUIRE(ESP_OK == uvc_host_stream_control_range_get(stream, 2, UVC_PU_BRIGHTNESS_CONTROL, 2, &cached_range));
+            REQUIRE(0 == memcmp(&range, &cached_range, sizeof(range)));
+
+            AND_THEN("Value out of cached range is rejected before any control is set") {
+                const uvc_host_control_t profile[] = {
+                    {.entity_id = 2, .selector = UVC_PU_GAIN_CONTROL, .len = 2, .value = 0},
+                    {.entity_id = 2, .selector = UVC_PU_BRIGHTNESS_CONTROL, .len = 2, .value = range.max + 1},
+                };
+                REQUIRE(ESP_OK != uvc_host_stream_controls_set(stream, profile, 2));
+            }
+        }
+
+        THEN("Batch of controls is sent in one sequence") {
+            const uvc_host_control_t profile[] = {
+                {.entity_id = 1, .selector = UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL, .len = 4, .value = 156},
+                {.entity_id = 2, .selector = UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL, .len = 2, .value = 4600},
+                {.entity_id = 2, .selector = UVC_PU_GAIN_CONTROL, .len = 2, .value = 64},
+            };
+            for (size_t i = 0; i < 3; i++) {
+                usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Set current
+            }
+            REQUIRE(ESP_OK == uvc_host_stream_controls_set(stream, profile, 3));
+        }
+
+        THEN("Invalid control length is rejected") {
+            const uvc_host_control_t control = {.entity_id = 2, .selector = UVC_PU_GAIN_CONTROL, .len = 5, .value = 0};
+            REQUIRE(ESP_ERR_INVALID_ARG == uvc_host_stream_controls_set(stream, &control, 1));
+            uvc_host_control_range_t range;
+            REQUIRE(ESP_ERR_INVALID_ARG == uvc_host_stream_control_range_get(stream, 2, UVC_PU_GAIN_CONTROL, 0, &range));
+        }
+
+        REQUIRE(ESP_OK == test_uvc_host_stream_close(stream));
+        REQUIRE(ESP_OK == test_uvc_host_uninstall());
+    }
+}
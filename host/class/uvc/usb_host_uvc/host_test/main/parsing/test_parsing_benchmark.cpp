@@ -0,0 +1,184 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/uvc_host.h"
+#include "uvc_descriptors_priv.h"
+
+#include "usb_bench.hpp"
+#include "descriptors/anker_powerconf_c200.hpp"
+#include "descriptors/canyon_cne_cwc2.hpp"
+#include "descriptors/customer.hpp"
+#include "descriptors/customer_dual.hpp"
+#include "descriptors/dual_tusb.hpp"
+#include "descriptors/elp_h264.hpp"
+#include "descriptors/elp_h265.hpp"
+#include "descriptors/logitech_c270.hpp"
+#include "descriptors/logitech_streamcam.hpp"
+#include "descriptors/old.hpp"
+#include "descriptors/trust_webcam.hpp"
+
+/**
+ * @brief Camera of the descriptor corpus
+ *
+ * Descriptors of a new camera, e.g. with a quirk, are added here too, so their parsing cost is tracked
+ */
+typedef struct {
+    const char *name;
+    const uint8_t *cfg_desc;
+} benchmark_camera_t;
+
+static const benchmark_camera_t benchmark_cameras[] = {
+    {"anker_powerconf_c200", anker_powerconf_c200::cfg_desc},
+    {"canyon_cne_cwc2", canyon_cne_cwc2::cfg_desc},
+    {"customer", customer_camera::cfg_desc},
+    {"customer_dual", customer_camera_dual::cfg_desc},
+    {"dual_tusb", dual_tusb::cfg_desc},
+    {"elp_h264", elp_h264::cfg_desc},
+    {"elp_h265", elp_h265::cfg_desc},
+    {"logitech_c270", logitech_c270::cfg_desc},
+    {"logitech_streamcam", logitech_streamcam::cfg_desc},
+    {"logitech_c980", old_cameras::Logitech_C980},
+    {"trust_webcam", trust_webcam::cfg_desc},
+};
+
+/**
+ * @brief Repeat the call for at least 20 ms and 100 times
+ *
+ * @param[in] timer Timer of the calls
+ * @param[in] call  Measured call, that runs `calls_per_measure` lookups
+ */
+template <typename F>
+static void benchmark_repeat(usb_bench::callback_timer &timer, F &&call)
+{
+    const auto start = std::chrono::steady_clock::now();
+    do {
+        timer.measure(call);
+    } while (timer.count() < 100 || std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20));
+}
+
+/**
+ * @brief Print result of one operation on one camera
+ *
+ * @param[in] camera            Camera
+ * @param[in] uvc_index         UVC function of the camera
+ * @param[in] op                Measured operation
+ * @param[in] calls_per_measure Calls of the operation in one measured call
+ * @param[in] timer             Timer of the measured calls
+ */
+static void benchmark_report(const benchmark_camera_t &camera, uint8_t uvc_index, const char *op, size_t calls_per_measure, const usb_bench::callback_timer &timer)
+{
+    const double calls = static_cast<double>(timer.count()) * calls_per_measure;
+    usb_bench::report("uvc", "descriptor_parsing")
+    .value("camera", camera.name)
+    .value("uvc_index", uvc_index)
+    .value("op", op)
+    .value("calls_per_measure", calls_per_measure)
+    .value("ns_per_call", static_cast<double>(timer.wall_ns_total()) / calls)
+    .timer(timer)
+    .print();
+}
+
+SCENARIO("Descriptor parsing and format lookup benchmark", "[parsing][index][!benchmark]")
+{
+    for (const benchmark_camera_t &camera : benchmark_cameras) {
+        GIVEN("Camera " + std::string(camera.name)) {
+            const usb_config_desc_t *cfg = (const usb_config_desc_t *)camera.cfg_desc;
+
+            // Results are checked after the measurement, so that assertions do not add to the measured time
+            bool ok = true;
+
+            // Index is built once per opened device and on each new device event
+            usb_bench::callback_timer timer;
+            benchmark_repeat(timer, [cfg, &ok] {
+                uvc_desc_index_t *index = nullptr;
+                ok &= (ESP_OK == uvc_desc_index_create(cfg, &index));
+                uvc_desc_index_delete(index);
+            });
+            REQUIRE(ok);
+            benchmark_report(camera, 0, "index_create", 1, timer);
+
+            uvc_desc_index_t *index = nullptr;
+            REQUIRE(ESP_OK == uvc_desc_index_create(cfg, &index));
+            for (uint8_t uvc_index = 0; uvc_index < index->num_of_functions; uvc_index++) {
+                size_t list_size = 0;
+                if (ESP_OK != uvc_desc_get_frame_list(cfg, uvc_index, nullptr, &list_size) || list_size == 0) {
+                    continue; // Malformed function or no supported format
+                }
+                std::vector<uvc_host_frame_info_t> frame_info(list_size);
+                uvc_host_frame_info_t (*list)[] = (uvc_host_frame_info_t (*)[])frame_info.data();
+
+                // Frame list of the hotplug event path
+                timer.reset();
+                benchmark_repeat(timer, [cfg, uvc_index, list, &frame_info, &ok] {
+                    size_t size = frame_info.size();
+                    ok &= (ESP_OK == uvc_desc_get_frame_list(cfg, uvc_index, list, &size));
+                });
+                REQUIRE(ok);
+                benchmark_report(camera, uvc_index, "frame_list", 1, timer);
+
+                timer.reset();
+                benchmark_repeat(timer, [index, uvc_index, list, &frame_info, &ok] {
+                    size_t size = frame_info.size();
+                    ok &= (ESP_OK == uvc_desc_index_get_frame_list(index, uvc_index, list, &size));
+                });
+                REQUIRE(ok);
+                benchmark_report(camera, uvc_index, "frame_list_index", 1, timer);
+
+                // Lookups of stream open and format switch, over all frames of the function.
+                // Both paths must find the same formats, whatever quirks the descriptors have
+                size_t size = frame_info.size();
+                REQUIRE(ESP_OK == uvc_desc_get_frame_list(cfg, uvc_index, list, &size));
+                std::vector<uvc_host_stream_format_t> formats;
+                for (size_t i = 0; i < size; i++) {
+                    formats.push_back({frame_info[i].h_res, frame_info[i].v_res, 0, frame_info[i].format});
+                }
+
+                size_t found = 0;
+                timer.reset();
+                benchmark_repeat(timer, [cfg, uvc_index, &formats, &found] {
+                    found = 0;
+                    for (const uvc_host_stream_format_t &format : formats) {
+                        uint16_t bcdUVC = 0;
+                        uint8_t bInterfaceNumber = 0;
+                        const uvc_format_desc_t *format_desc = nullptr;
+                        const uvc_frame_desc_t *frame_desc = nullptr;
+                        if (ESP_OK == uvc_desc_get_streaming_interface_num(cfg, uvc_index, &format, &bcdUVC, &bInterfaceNumber) &&
+                                ESP_OK == uvc_desc_get_frame_format_by_format(cfg, bInterfaceNumber, &format, &format_desc, &frame_desc)) {
+                            found++;
+                        }
+                    }
+                });
+                REQUIRE(found > 0);
+                benchmark_report(camera, uvc_index, "format_lookup", formats.size(), timer);
+
+                size_t found_index = 0;
+                timer.reset();
+                benchmark_repeat(timer, [index, uvc_index, &formats, &found_index] {
+                    found_index = 0;
+                    for (const uvc_host_stream_format_t &format : formats) {
+                        uint16_t bcdUVC = 0;
+                        uint8_t bInterfaceNumber = 0;
+                        const uvc_format_desc_t *format_desc = nullptr;
+                        const uvc_frame_desc_t *frame_desc = nullptr;
+                        if (ESP_OK == uvc_desc_index_get_streaming_interface_num(index, uvc_index, &format, &bcdUVC, &bInterfaceNumber) &&
+                                ESP_OK == uvc_desc_index_get_frame_format_by_format(index, bInterfaceNumber, &format, &format_desc, &frame_desc)) {
+                            found_index++;
+                        }
+                    }
+                });
+                REQUIRE(found_index == found);
+                benchmark_report(camera, uvc_index, "format_lookup_index", formats.size(), timer);
+            }
+            uvc_desc_index_delete(index);
+        }
+    }
+}
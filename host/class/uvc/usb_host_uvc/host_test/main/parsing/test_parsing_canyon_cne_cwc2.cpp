@@ -90,3 +90,45 @@ SCENARIO("Camera descriptor parsing: Canyon CNE CWC2", "[canyon][cne_cwc2]")
         }
     }
 }
+
+SCENARIO("Still image frames: Canyon CNE CWC2", "[canyon][cne_cwc2][still]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+    uvc_desc_index_t *index = nullptr;
+    REQUIRE(ESP_OK == uvc_desc_index_create(cfg, &index));
+    REQUIRE(index->num_of_stills == 2);
+
+    for (enum uvc_host_stream_format format : {UVC_VS_FORMAT_MJPEG, UVC_VS_FORMAT_YUY2}) {
+        GIVEN("Still image frame of format " + std::to_string(format)) {
+            const uvc_host_stream_format_t this_format = {640, 480, 30, format};
+            const uvc_format_desc_t *format_desc = nullptr;
+            const uvc_still_image_frame_desc_t *still_desc = nullptr;
+            uint8_t bStillCaptureMethod = 0;
+            REQUIRE(ESP_OK == uvc_desc_index_get_frame_format_by_format(index, 1, &this_format, &format_desc, nullptr));
+            REQUIRE(ESP_OK == uvc_desc_index_get_still_frame(index, 1, format_desc->bFormatIndex, &bStillCaptureMethod, &still_desc));
+            REQUIRE(bStillCaptureMethod == 2);
+            REQUIRE(still_desc->bNumImageSizePatterns == 9);
+            REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_index_get_still_frame(index, 1, 10, &bStillCaptureMethod, &still_desc));
+
+            THEN("Still image sizes can be found") {
+                unsigned h_res = 640, v_res = 480;
+                uint8_t bFrameIndex = 0;
+                REQUIRE(ESP_OK == uvc_desc_still_frame_find_size(still_desc, &h_res, &v_res, &bFrameIndex));
+                REQUIRE(bFrameIndex == 5);
+
+                h_res = 0;
+                v_res = 0;
+                REQUIRE(ESP_OK == uvc_desc_still_frame_find_size(still_desc, &h_res, &v_res, &bFrameIndex));
+                REQUIRE(h_res == 1600);
+                REQUIRE(v_res == 1200);
+                REQUIRE(bFrameIndex == 1);
+
+                h_res = 645;
+                v_res = 480;
+                REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_still_frame_find_size(still_desc, &h_res, &v_res, &bFrameIndex));
+            }
+        }
+    }
+
+    uvc_desc_index_delete(index);
+}
@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <vector>
 #include <catch2/catch_test_macros.hpp>
 
 #include "usb/uvc_host.h"
@@ -110,3 +111,98 @@ SCENARIO("Camera descriptor parsing: Logitech C270", "[logitech][c270]")
         }
     }
 }
+
+SCENARIO("Streaming interface bandwidth: Logitech C270", "[logitech][c270][bandwidth]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+    const usb_intf_desc_t *intf_desc = nullptr;
+    const usb_ep_desc_t *ep_desc = nullptr;
+
+    // Alternate settings of interface 1 offer payloads 192, 384, 512, 640, 800, 944, 1280, 1600, 1984, 2688 and 3060 bytes per microframe
+    GIVEN("Enough free bandwidth") {
+        THEN("The smallest alternate setting that offers the requested payload is selected") {
+            REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, 1000, 4096, true, UINT32_MAX, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 7);
+            REQUIRE(uvc_desc_get_ep_bandwidth(ep_desc, true) == 1280 * 8);
+            REQUIRE(uvc_desc_get_ep_bandwidth(ep_desc, false) == 1280);
+        }
+        THEN("Unknown payload selects the largest alternate setting") {
+            REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, UINT32_MAX, 4096, true, UINT32_MAX, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 11);
+        }
+        THEN("Endpoints with MPS over the limit are skipped") {
+            REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, UINT32_MAX, 596, false, UINT32_MAX, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 3);
+        }
+    }
+
+    GIVEN("Bandwidth reserved by other streams") {
+        const uint32_t free_bandwidth = 20000;
+        THEN("Requested payload that does not fit is refused") {
+            REQUIRE(ESP_ERR_NOT_SUPPORTED == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, 3060, 4096, true, free_bandwidth, &intf_desc, &ep_desc));
+        }
+        THEN("Requested payload that fits is accepted") {
+            REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, 1600, 4096, true, free_bandwidth, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 8);
+        }
+        THEN("Unknown payload selects the largest alternate setting that fits") {
+            REQUIRE(ESP_OK == uvc_desc_get_streaming_intf_and_ep_by_bandwidth(cfg, 1, UINT32_MAX, 4096, true, free_bandwidth, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 9);
+        }
+    }
+}
+
+SCENARIO("Descriptor index: Logitech C270", "[logitech][c270][index]")
+{
+    const usb_config_desc_t *cfg = (const usb_config_desc_t *)cfg_desc;
+    uvc_desc_index_t *index = nullptr;
+    REQUIRE(ESP_OK == uvc_desc_index_create(cfg, &index));
+    REQUIRE(index->num_of_functions == 1);
+    REQUIRE(index->num_of_alts == 11);
+
+    GIVEN("Frame list") {
+        size_t list_size = 0;
+        size_t list_size_cfg = 0;
+        REQUIRE(ESP_OK == uvc_desc_index_get_frame_list(index, 0, nullptr, &list_size));
+        REQUIRE(ESP_OK == uvc_desc_get_frame_list(cfg, 0, nullptr, &list_size_cfg));
+        REQUIRE(list_size == list_size_cfg);
+        REQUIRE(ESP_ERR_NOT_FOUND == uvc_desc_index_get_frame_list(index, 1, nullptr, &list_size));
+
+        THEN("Index lookups return the same descriptors as configuration descriptor parsing") {
+            std::vector<uvc_host_frame_info_t> frame_info(list_size);
+            REQUIRE(ESP_OK == uvc_desc_index_get_frame_list(index, 0, (uvc_host_frame_info_t (*)[])frame_info.data(), &list_size));
+            for (size_t i = 0; i < list_size; i++) {
+                const uvc_host_stream_format_t this_format = {frame_info[i].h_res, frame_info[i].v_res, 0, frame_info[i].format};
+                uint16_t bcdUVC = 0;
+                uint8_t bInterfaceNumber = 0;
+                REQUIRE(ESP_OK == uvc_desc_index_get_streaming_interface_num(index, 0, &this_format, &bcdUVC, &bInterfaceNumber));
+                REQUIRE(bInterfaceNumber == 1);
+
+                const uvc_format_desc_t *format_desc = nullptr, *format_desc_cfg = nullptr;
+                const uvc_frame_desc_t *frame_desc = nullptr, *frame_desc_cfg = nullptr;
+                REQUIRE(ESP_OK == uvc_desc_index_get_frame_format_by_format(index, 1, &this_format, &format_desc, &frame_desc));
+                REQUIRE(ESP_OK == uvc_desc_get_frame_format_by_format(cfg, 1, &this_format, &format_desc_cfg, &frame_desc_cfg));
+                REQUIRE(format_desc == format_desc_cfg);
+                REQUIRE(frame_desc == frame_desc_cfg);
+
+                REQUIRE(ESP_OK == uvc_desc_index_get_frame_format_by_index(index, 1, format_desc->bFormatIndex, frame_desc->bFrameIndex, &format_desc, &frame_desc));
+                REQUIRE(format_desc == format_desc_cfg);
+                REQUIRE(frame_desc == frame_desc_cfg);
+            }
+        }
+    }
+
+    GIVEN("Bandwidth reserved by other streams") {
+        const usb_intf_desc_t *intf_desc = nullptr;
+        const usb_ep_desc_t *ep_desc = nullptr;
+        THEN("Index selects the same alternate settings") {
+            REQUIRE(ESP_ERR_NOT_SUPPORTED == uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(index, 1, 3060, 4096, true, 20000, &intf_desc, &ep_desc));
+            REQUIRE(ESP_OK == uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(index, 1, 1600, 4096, true, 20000, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 8);
+            REQUIRE(ESP_OK == uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(index, 1, UINT32_MAX, 4096, true, 20000, &intf_desc, &ep_desc));
+            REQUIRE(intf_desc->bAlternateSetting == 9);
+        }
+    }
+
+    uvc_desc_index_delete(index);
+}
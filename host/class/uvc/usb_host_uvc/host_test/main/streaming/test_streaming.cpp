@@ -6,17 +6,27 @@
 
 #include <stdio.h>
 #include <functional>
+#include <vector>
+#include <algorithm>
 #include <catch2/catch_test_macros.hpp>
 
 #include "usb/usb_types_stack.h"
 #include "usb/uvc_host.h"
+#include "usb/uvc_host_yuv.h"
+#include "usb/uvc_host_display.h"
+#include "esp_heap_caps.h"
 #include "esp_private/uvc_stream.h"
 #include "uvc_types_priv.h"
 #include "uvc_frame_priv.h"
+#include "uvc_still_priv.h"
 
 #include "images/test_logo_jpg.hpp"
 #include "test_streaming_helpers.hpp"
 
+extern "C" {
+    bool isoc_transfer_process(usb_transfer_t *transfer);
+}
+
 // `send_frame_function` is a generic std::function that acts as a wrapper for sending frames in the
 // test scenarios. By assigning it either `test_streaming_bulk_send_frame` or `test_streaming_isoc_send_frame`
 // before calling `run_streaming_frame_reconstruction_scenario()`, we avoid duplicating the entire scenario
@@ -69,7 +79,7 @@ void run_streaming_frame_reconstruction_scenario(void)
                 return true;
             };
 
-            REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+            REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
             uvc_frame_format_update(&stream, &logo_jpg_format);
 
             // Test
@@ -81,6 +91,13 @@ void run_streaming_frame_reconstruction_scenario(void)
                         REQUIRE(frame_callback_called == 1);
                     }
 
+                    THEN("The frame is counted in stream statistics") {
+                        uvc_host_stream_stats_t stats;
+                        REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                        REQUIRE(stats.frames_delivered == 1);
+                        REQUIRE(stats.frames_dropped.error == 0);
+                    }
+
                     AND_WHEN("Next frame is send") {
                         send_function_wrapper(transfer_size, &stream, std::span(logo_jpg), 1);
 
@@ -97,6 +114,13 @@ void run_streaming_frame_reconstruction_scenario(void)
                     REQUIRE(frame_callback_called == 0);
                 }
 
+                THEN("The frame is counted as dropped") {
+                    uvc_host_stream_stats_t stats;
+                    REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                    REQUIRE(stats.frames_delivered == 0);
+                    REQUIRE(stats.frames_dropped.error == 1);
+                }
+
                 AND_WHEN("Next frame is send") {
                     send_function_wrapper(1024, &stream, std::span(logo_jpg), 1);
 
@@ -147,13 +171,18 @@ void run_streaming_frame_reconstruction_scenario(void)
                 enum uvc_host_dev_event *event_type = static_cast<enum uvc_host_dev_event *>(user_ctx);
                 *event_type = event->type;
             };
-            REQUIRE(uvc_frame_allocate(&stream, 1, logo_jpg.size() - 100, 0) == ESP_OK);
+            REQUIRE(uvc_frame_allocate(&stream, 1, logo_jpg.size() - 100, 0, NULL, 0) == ESP_OK);
 
             WHEN("The frame is too big") {
                 send_function_wrapper(1024, &stream, std::span(logo_jpg));
                 THEN("Buffer overflow event is generated") {
                     REQUIRE(event_type == UVC_HOST_FRAME_BUFFER_OVERFLOW);
                 }
+                THEN("The frame is counted as dropped") {
+                    uvc_host_stream_stats_t stats;
+                    REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                    REQUIRE(stats.frames_dropped.overflow == 1);
+                }
             }
 
             REQUIRE(uvc_frame_are_all_returned(&stream));
@@ -170,7 +199,7 @@ void run_streaming_frame_reconstruction_scenario(void)
             };
 
             uvc_host_frame_t *temp_frame = nullptr;
-            REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+            REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
             temp_frame = uvc_frame_get_empty(&stream);
             REQUIRE(temp_frame != nullptr);
 
@@ -180,12 +209,89 @@ void run_streaming_frame_reconstruction_scenario(void)
                     REQUIRE(event_type == UVC_HOST_FRAME_BUFFER_UNDERFLOW);
                     REQUIRE_FALSE(uvc_frame_are_all_returned(&stream));
                 }
+                THEN("The frame is counted as dropped") {
+                    uvc_host_stream_stats_t stats;
+                    REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                    REQUIRE(stats.frames_dropped.underflow == 1);
+                }
             }
 
             REQUIRE(uvc_host_frame_return(&stream, temp_frame) == ESP_OK);
             REQUIRE(uvc_frame_are_all_returned(&stream));
             uvc_frame_free(&stream);
         }
+
+        AND_GIVEN("There is no frame callback") {
+            stream.constant.frame_cb = nullptr;
+            REQUIRE(uvc_frame_allocate(&stream, 2, 100 * 1024, 0, NULL, 0) == ESP_OK);
+            uvc_frame_format_update(&stream, &logo_jpg_format);
+
+            WHEN("Two frames are received") {
+                send_function_wrapper(1024, &stream, std::span(logo_jpg), 0);
+                send_function_wrapper(1024, &stream, std::span(logo_jpg), 1);
+
+                THEN("The frames can be pulled from filled frames in order of reception") {
+                    uvc_host_frame_t *frame_0 = uvc_frame_get_filled(&stream);
+                    uvc_host_frame_t *frame_1 = uvc_frame_get_filled(&stream);
+                    REQUIRE(frame_0 != nullptr);
+                    REQUIRE(frame_1 != nullptr);
+                    REQUIRE(frame_0 != frame_1);
+                    REQUIRE(uvc_frame_get_filled(&stream) == nullptr);
+
+                    std::vector<uint8_t> frame_data(frame_1->data, frame_1->data + frame_1->data_len);
+                    std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+                    REQUIRE(frame_data == original_data);
+
+                    REQUIRE(uvc_host_frame_return(&stream, frame_0) == ESP_OK);
+                    REQUIRE(uvc_host_frame_return(&stream, frame_1) == ESP_OK);
+                }
+
+                AND_WHEN("The stream is paused") {
+                    REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+                    THEN("The filled frames are returned") {
+                        uvc_host_frame_t *frame = nullptr;
+                        REQUIRE(uvc_host_frame_get(&stream, 0, &frame) == ESP_ERR_TIMEOUT);
+                        REQUIRE(frame == nullptr);
+                    }
+                }
+            }
+
+            WHEN("Two frames are received with FIFO of one frame") {
+                stream.constant.filled_fb_depth = 1;
+                send_function_wrapper(1024, &stream, std::span(logo_jpg), 0);
+                send_function_wrapper(1024, &stream, std::span(logo_jpg), 1);
+
+                THEN("Only the first frame can be taken") {
+                    uvc_host_frame_t *frame = nullptr;
+                    REQUIRE(uvc_host_frame_get(&stream, 0, &frame) == ESP_OK);
+                    REQUIRE(frame == &stream.constant.fbs[0].frame);
+                    REQUIRE(uvc_host_frame_get(&stream, 1, &frame) == ESP_ERR_TIMEOUT);
+                    REQUIRE(uvc_host_frame_return(&stream, &stream.constant.fbs[0].frame) == ESP_OK);
+
+                    uvc_host_stream_stats_t stats;
+                    REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                    REQUIRE(stats.frames_delivered == 1);
+                    REQUIRE(stats.frames_dropped.queue_full == 1);
+                }
+            }
+
+            WHEN("Two frames are received with latest frame policy") {
+                stream.constant.filled_fb_policy = UVC_HOST_FRAME_QUEUE_LATEST;
+                send_function_wrapper(1024, &stream, std::span(logo_jpg), 0);
+                send_function_wrapper(1024, &stream, std::span(logo_jpg), 1);
+
+                THEN("Only the latest frame can be taken") {
+                    uvc_host_frame_t *frame = nullptr;
+                    REQUIRE(uvc_host_frame_get(&stream, 0, &frame) == ESP_OK);
+                    REQUIRE(frame == &stream.constant.fbs[1].frame);
+                    REQUIRE(uvc_host_frame_get(&stream, 1, &frame) == ESP_ERR_TIMEOUT);
+                    REQUIRE(uvc_host_frame_return(&stream, &stream.constant.fbs[1].frame) == ESP_OK);
+                }
+            }
+
+            REQUIRE(uvc_frame_are_all_returned(&stream));
+            uvc_frame_free(&stream);
+        }
     }
 
     GIVEN("Streaming disabled") {
@@ -236,7 +342,7 @@ SCENARIO("Bulk stream frame reconstruction", "[streaming][bulk]")
 
     GIVEN("Streaming enabled and frame allocated") {
         REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
-        REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
         uvc_frame_format_update(&stream, &logo_jpg_format);
 
         WHEN("Expected SoF but got EoF") {
@@ -245,6 +351,160 @@ SCENARIO("Bulk stream frame reconstruction", "[streaming][bulk]")
                 REQUIRE(frame_callback_called == 1);
             }
         }
+
+        WHEN("EoF of the frame is missing") {
+            uint8_t data_buffer[512];
+            usb_transfer_t transfer = {
+                .data_buffer = data_buffer,
+                .data_buffer_size = sizeof(data_buffer),
+                .num_bytes = 0,
+                .actual_num_bytes = 0,
+                .flags = 0,
+                .device_handle = nullptr,
+                .bEndpointAddress = 0,
+                .status = USB_TRANSFER_STATUS_COMPLETED,
+                .timeout_ms = 0,
+                .callback = nullptr,
+                .context = &stream,
+                .num_isoc_packets = 0,
+            };
+            uvc_payload_header_t *header = reinterpret_cast<uvc_payload_header_t *>(data_buffer);
+            header->bHeaderLength = HEADER_LEN;
+            header->bmHeaderInfo.val = 0;
+            header->bmHeaderInfo.end_of_header = 1;
+            header->bmHeaderInfo.frame_id = 0;
+            transfer.actual_num_bytes = HEADER_LEN + 100;
+            usb_host_transfer_submit_ExpectAndReturn(&transfer, ESP_OK);
+            bulk_transfer_callback(&transfer);
+            REQUIRE(frame_callback_called == 0);
+
+            AND_WHEN("Next frame starts with toggled Frame ID") {
+                header->bmHeaderInfo.frame_id = 1;
+                usb_host_transfer_submit_ExpectAndReturn(&transfer, ESP_OK);
+                bulk_transfer_callback(&transfer);
+                THEN("The previous frame is delivered") {
+                    REQUIRE(frame_callback_called == 1);
+                }
+            }
+        }
+    }
+
+    GIVEN("Payload transfers have maximum size") {
+        constexpr size_t max_payload_len = 1024;
+        constexpr size_t frame_len = max_payload_len - HEADER_LEN; // Last data packet of the frame has MPS size
+        stream.dynamic.dwMaxPayloadTransferSize = max_payload_len;
+        stream.constant.cb_arg = (void *)&frame_callback_called;
+        stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+            int *fb_called = static_cast<int *>(user_ctx);
+            (*fb_called)++;
+            std::vector<uint8_t> frame_data(frame->data, frame->data + frame->data_len);
+            std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.begin() + frame_len);
+            REQUIRE(frame_data == original_data);
+            return true;
+        };
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+
+        WHEN("The frame ends with full payload transfer without short packet") {
+            test_streaming_bulk_send_frame(512, &stream, std::span(logo_jpg).first(frame_len));
+            THEN("The frame callback is called with expected frame data") {
+                REQUIRE(frame_callback_called == 1);
+            }
+        }
+
+        WHEN("EoF header follows the data in the same USB transfer") {
+            uint8_t data_buffer[2048];
+            usb_transfer_t transfer = {
+                .data_buffer = data_buffer,
+                .data_buffer_size = sizeof(data_buffer),
+                .num_bytes = 0,
+                .actual_num_bytes = max_payload_len + HEADER_LEN,
+                .flags = 0,
+                .device_handle = nullptr,
+                .bEndpointAddress = 0,
+                .status = USB_TRANSFER_STATUS_COMPLETED,
+                .timeout_ms = 0,
+                .callback = nullptr,
+                .context = &stream,
+                .num_isoc_packets = 0,
+            };
+            uvc_payload_header_t *header_sof = reinterpret_cast<uvc_payload_header_t *>(data_buffer);
+            header_sof->bHeaderLength = HEADER_LEN;
+            header_sof->bmHeaderInfo.val = 0;
+            header_sof->bmHeaderInfo.end_of_header = 1;
+            std::copy_n(logo_jpg.begin(), frame_len, data_buffer + HEADER_LEN);
+            uvc_payload_header_t *header_eof = reinterpret_cast<uvc_payload_header_t *>(data_buffer + max_payload_len);
+            header_eof->bHeaderLength = HEADER_LEN;
+            header_eof->bmHeaderInfo.val = 0;
+            header_eof->bmHeaderInfo.end_of_header = 1;
+            header_eof->bmHeaderInfo.end_of_frame = 1;
+
+            usb_host_transfer_submit_ExpectAndReturn(&transfer, ESP_OK);
+            bulk_transfer_callback(&transfer);
+            THEN("The frame callback is called with expected frame data") {
+                REQUIRE(frame_callback_called == 1);
+            }
+        }
+
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+
+    GIVEN("Zero-copy streaming enabled and frame allocated") {
+        uint8_t *xfer_buffer = new uint8_t[512];
+        usb_transfer_t _transfer = {
+            .data_buffer = xfer_buffer,
+            .data_buffer_size = 512,
+            .num_bytes = 0,
+            .actual_num_bytes = 0,
+            .flags = 0,
+            .device_handle = nullptr,
+            .bEndpointAddress = 0,
+            .status = USB_TRANSFER_STATUS_COMPLETED,
+            .timeout_ms = 0,
+            .callback = nullptr,
+            .context = &stream,
+            .num_isoc_packets = 0,
+        };
+        usb_transfer_t *transfer = &_transfer;
+        uvc_host_frame_t *landing = nullptr;
+        stream.constant.bulk_zero_copy = true;
+        stream.constant.num_of_xfers = 1;
+        stream.constant.xfers = &transfer;
+        stream.constant.xfer_buffers = &xfer_buffer;
+        stream.single_thread.xfer_landing = &landing;
+
+        // We expect valid frame data
+        stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+            int *fb_called = static_cast<int *>(user_ctx);
+            (*fb_called)++;
+            std::vector<uint8_t> frame_data(frame->data, frame->data + frame->data_len);
+            std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+            REQUIRE(frame_data == original_data);
+            return true;
+        };
+
+        REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+        usb_host_transfer_submit_ExpectAndReturn(transfer, ESP_OK);
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+
+        WHEN("The frame is received directly into the frame buffer") {
+            test_streaming_bulk_send_frame_through(transfer, std::span(logo_jpg));
+            THEN("The frame callback is called with expected frame data") {
+                REQUIRE(frame_callback_called == 1);
+            }
+            THEN("The transfer receives to its own buffer and the frame is returned") {
+                REQUIRE(transfer->data_buffer == xfer_buffer);
+                REQUIRE(landing == nullptr);
+                REQUIRE(uvc_frame_are_all_returned(&stream));
+            }
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        uvc_frame_free(&stream);
+        delete[] xfer_buffer;
     }
 }
 
@@ -255,6 +515,50 @@ SCENARIO("Isochronous stream frame reconstruction", "[streaming][isoc]")
     run_streaming_frame_reconstruction_scenario();
 
     /* ISOC specific tests */
+    GIVEN("Format is being switched while transfers keep running") {
+        uvc_stream_t stream = {}; // Define mock stream
+        const uvc_host_stream_format_t new_format = {
+            .h_res = 320,
+            .v_res = 240,
+            .fps = 15.0f,
+            .format = UVC_VS_FORMAT_MJPEG,
+        };
+        int frame_callback_called = 0;
+        stream.constant.cb_arg = (void *)&frame_callback_called;
+        stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+            int *frame_callback_called = static_cast<int *>(user_ctx);
+            (*frame_callback_called)++;
+            REQUIRE(frame->vs_format.h_res == 320);
+            REQUIRE(frame->vs_format.v_res == 240);
+            return true;
+        };
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+        stream.dynamic.format_switching = true;
+
+        WHEN("A frame is received during the switch") {
+            test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg));
+            THEN("The frame is dropped and the transfers are resubmitted") {
+                REQUIRE(frame_callback_called == 0);
+                REQUIRE(uvc_frame_are_all_returned(&stream));
+            }
+
+            AND_WHEN("The switch is finished and next frame is received with the same Frame ID") {
+                uvc_frame_format_update(&stream, &new_format);
+                stream.dynamic.format_switching = false;
+                test_streaming_isoc_send_frame(1024, &stream, std::span(logo_jpg));
+                THEN("The frame is delivered in the new format") {
+                    REQUIRE(frame_callback_called == 1);
+                }
+            }
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+
     /*
     @todo ISOC test
     - Missed SoF
@@ -264,3 +568,975 @@ SCENARIO("Isochronous stream frame reconstruction", "[streaming][isoc]")
     - Unaligned USB transfer sizes
     */
 }
+
+SCENARIO("Frame format update", "[streaming]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    const uvc_host_stream_format_t new_format = {
+        .h_res = 1280,
+        .v_res = 720,
+        .fps = 30.0f,
+        .format = UVC_VS_FORMAT_YUY2,
+    };
+
+    GIVEN("Frame buffers are allocated and one of them is held by the user") {
+        REQUIRE(uvc_frame_allocate(&stream, 2, 1024, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+        uvc_host_frame_t *held_frame = uvc_frame_get_empty(&stream);
+        REQUIRE(held_frame != nullptr);
+        REQUIRE(held_frame->vs_format.format == logo_jpg_format.format);
+
+        WHEN("The format is changed") {
+            uvc_frame_format_update(&stream, &new_format);
+
+            THEN("All frames pick up the new format, including the held one") {
+                REQUIRE(uvc_host_frame_return(&stream, held_frame) == ESP_OK);
+                for (int i = 0; i < 2; i++) {
+                    uvc_host_frame_t *frame = uvc_frame_get_empty(&stream);
+                    REQUIRE(frame != nullptr);
+                    REQUIRE(frame->vs_format.h_res  == new_format.h_res);
+                    REQUIRE(frame->vs_format.v_res  == new_format.v_res);
+                    REQUIRE(frame->vs_format.fps    == new_format.fps);
+                    REQUIRE(frame->vs_format.format == new_format.format);
+                    REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                }
+            }
+        }
+        if (!uvc_frame_are_all_returned(&stream)) {
+            REQUIRE(uvc_host_frame_return(&stream, held_frame) == ESP_OK);
+        }
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("Frame timestamps", "[streaming]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.dynamic.dwClockFrequency = 1000000; // 1 tick of device clock is 1 us
+
+    // Payload header with PTS and SCR, see USB UVC specification ver 1.5, table 2-6
+    auto make_header = [](uint8_t header_len, bool pts_present, uint32_t pts, bool scr_present, uint32_t stc, uint16_t sof) {
+        std::vector<uint8_t> header(HEADER_LEN, 0);
+        uvc_payload_header_t *payload_header = reinterpret_cast<uvc_payload_header_t *>(header.data());
+        payload_header->bHeaderLength = header_len;
+        payload_header->bmHeaderInfo.end_of_header = 1;
+        payload_header->bmHeaderInfo.presentation_time = pts_present;
+        payload_header->bmHeaderInfo.source_clock_reference = scr_present;
+        for (int i = 0; i < 4; i++) {
+            header[2 + i] = (pts >> (8 * i)) & 0xFF;
+            header[6 + i] = (stc >> (8 * i)) & 0xFF;
+        }
+        header[10] = sof & 0xFF;
+        header[11] = sof >> 8;
+        return header;
+    };
+
+    GIVEN("Frame buffer is allocated") {
+        REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+        uvc_host_frame_t *frame = uvc_frame_get_empty(&stream);
+        REQUIRE(frame != nullptr);
+
+        WHEN("Payload headers contain PTS and SCR") {
+            stream.single_thread.xfer_receive_us = 1000;
+            auto header_first = make_header(HEADER_LEN, true, 6500, true, 6000, 0x0812);
+            uvc_frame_time_header(&stream, frame, header_first.data(), header_first.size());
+            stream.single_thread.xfer_receive_us = 2000;
+            auto header_last = make_header(HEADER_LEN, true, 6500, true, 7000, 0x0813);
+            uvc_frame_time_header(&stream, frame, header_last.data(), header_last.size());
+            uvc_frame_commit(&stream, frame);
+
+            THEN("Device clock and host times are saved to the frame") {
+                REQUIRE(frame->time.clock_frequency == 1000000);
+                REQUIRE(frame->time.pts_valid);
+                REQUIRE(frame->time.pts == 6500);
+                REQUIRE(frame->time.scr_valid);
+                REQUIRE(frame->time.scr_stc == 7000);
+                REQUIRE(frame->time.scr_sof == 0x0013);
+                REQUIRE(frame->time.receive_us == 1000);
+            }
+
+            THEN("Capture time is recovered from the last SCR") {
+                REQUIRE(frame->time.capture_us == 1500);
+            }
+
+            AND_WHEN("The frame is returned") {
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                frame = uvc_frame_get_empty(&stream);
+                REQUIRE(frame != nullptr);
+
+                THEN("The timestamps are cleared") {
+                    REQUIRE_FALSE(frame->time.pts_valid);
+                    REQUIRE_FALSE(frame->time.scr_valid);
+                    REQUIRE(frame->time.receive_us == 0);
+                    REQUIRE(frame->time.capture_us == 0);
+                }
+            }
+        }
+
+        WHEN("Device clock wraps around between PTS and SCR") {
+            stream.single_thread.xfer_receive_us = 10000;
+            auto header = make_header(HEADER_LEN, true, 0xFFFFFF00, true, 0x00000100, 0);
+            uvc_frame_time_header(&stream, frame, header.data(), header.size());
+            uvc_frame_commit(&stream, frame);
+
+            THEN("Capture time is recovered across the wrap-around") {
+                REQUIRE(frame->time.capture_us == 10000 - 0x200);
+            }
+        }
+
+        WHEN("Payload header contains no PTS nor SCR") {
+            stream.single_thread.xfer_receive_us = 3000;
+            auto header = make_header(2, false, 0, false, 0, 0);
+            uvc_frame_time_header(&stream, frame, header.data(), 2);
+            uvc_frame_commit(&stream, frame);
+
+            THEN("Capture time equals receive time") {
+                REQUIRE_FALSE(frame->time.pts_valid);
+                REQUIRE_FALSE(frame->time.scr_valid);
+                REQUIRE(frame->time.receive_us == 3000);
+                REQUIRE(frame->time.capture_us == 3000);
+            }
+        }
+
+        WHEN("Payload header is too short for SCR") {
+            stream.single_thread.xfer_receive_us = 4000;
+            auto header = make_header(6, true, 6500, true, 7000, 0);
+            uvc_frame_time_header(&stream, frame, header.data(), header.size());
+            uvc_frame_commit(&stream, frame);
+
+            THEN("Only PTS is saved") {
+                REQUIRE(frame->time.pts_valid);
+                REQUIRE_FALSE(frame->time.scr_valid);
+                REQUIRE(frame->time.capture_us == 4000);
+            }
+        }
+
+        REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("Frame pool", "[streaming][bulk]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.fb_pool = true;
+
+    GIVEN("Streaming enabled and frame pool allocated") {
+        constexpr size_t pool_size = 100 * 1024;
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 3, pool_size, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+
+        WHEN("Two frames are received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 1);
+            uvc_host_frame_t *frame_0 = uvc_frame_get_filled(&stream);
+            uvc_host_frame_t *frame_1 = uvc_frame_get_filled(&stream);
+            REQUIRE(frame_0 != nullptr);
+            REQUIRE(frame_1 != nullptr);
+
+            THEN("The frames occupy only their real size in the pool") {
+                REQUIRE(frame_0->data == stream.constant.fb_pool_data);
+                REQUIRE(frame_0->data_buffer_len >= frame_0->data_len);
+                REQUIRE(frame_0->data_buffer_len < pool_size);
+                REQUIRE(frame_1->data == frame_0->data + frame_0->data_buffer_len);
+
+                std::vector<uint8_t> frame_data(frame_1->data, frame_1->data + frame_1->data_len);
+                std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+                REQUIRE(frame_data == original_data);
+            }
+
+            AND_WHEN("The frames are returned and another frame is received") {
+                REQUIRE(uvc_host_frame_return(&stream, frame_0) == ESP_OK);
+                REQUIRE(uvc_host_frame_return(&stream, frame_1) == ESP_OK);
+                frame_0 = frame_1 = nullptr;
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+
+                THEN("The pool is reused from its beginning") {
+                    uvc_host_frame_t *frame = uvc_frame_get_filled(&stream);
+                    REQUIRE(frame != nullptr);
+                    REQUIRE(frame->data == stream.constant.fb_pool_data);
+                    REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                }
+            }
+
+            if (frame_0) {
+                REQUIRE(uvc_host_frame_return(&stream, frame_0) == ESP_OK);
+            }
+            if (frame_1) {
+                REQUIRE(uvc_host_frame_return(&stream, frame_1) == ESP_OK);
+            }
+        }
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("Frame decimation", "[streaming][bulk]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+
+    GIVEN("Streaming enabled and frame buffers allocated") {
+        REQUIRE(uvc_frame_allocate(&stream, 3, 100 * 1024, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+
+        WHEN("Every 2nd frame is kept and four frames are received") {
+            stream.constant.decimation_every_nth = 2;
+            REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+            for (uint8_t frame_id = 0; frame_id < 4; frame_id++) {
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), frame_id % 2);
+                uvc_host_frame_t *frame = uvc_frame_get_filled(&stream);
+                if (frame_id % 2 == 0) {
+                    REQUIRE(frame != nullptr);
+                    REQUIRE(frame->data_len == logo_jpg.size());
+                    REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                } else {
+                    REQUIRE(frame == nullptr);
+                }
+            }
+
+            THEN("Skipped frames are counted as decimated, not dropped") {
+                uvc_host_stream_stats_t stats;
+                REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                REQUIRE(stats.frames_decimated == 2);
+                REQUIRE(stats.frames_dropped.underflow == 0);
+                REQUIRE(stats.frames_dropped.missing_eof == 0);
+            }
+        }
+
+        WHEN("Frames are received faster than the maximum FPS") {
+            stream.constant.decimation_interval_us = 1000LL * 1000 * 1000; // 0.001 FPS
+            REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+            for (uint8_t frame_id = 0; frame_id < 3; frame_id++) {
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), frame_id % 2);
+            }
+
+            THEN("Only the first frame is kept") {
+                uvc_host_frame_t *frame = uvc_frame_get_filled(&stream);
+                REQUIRE(frame != nullptr);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                REQUIRE(uvc_frame_get_filled(&stream) == nullptr);
+
+                uvc_host_stream_stats_t stats;
+                REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                REQUIRE(stats.frames_decimated == 2);
+            }
+        }
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("MJPEG integrity check", "[streaming][bulk]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.mjpeg_check = true;
+
+    GIVEN("Streaming enabled and frame buffers allocated") {
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 2, 100 * 1024, 0, NULL, 0) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+        uvc_host_stream_stats_t stats;
+
+        WHEN("Valid frame is received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+            THEN("The frame is delivered") {
+                uvc_host_frame_t *frame = uvc_frame_get_filled(&stream);
+                REQUIRE(frame != nullptr);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                REQUIRE(stats.frames_dropped.invalid_jpeg == 0);
+            }
+
+            AND_WHEN("Next frame is truncated after its SOI marker") {
+                uvc_host_frame_t *frame = uvc_frame_get_filled(&stream);
+                REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg).first(1000), 1);
+
+                THEN("The frame is dropped and counted as invalid") {
+                    REQUIRE(uvc_frame_get_filled(&stream) == nullptr);
+                    REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                    REQUIRE(stats.frames_dropped.invalid_jpeg == 1);
+                }
+            }
+        }
+
+        WHEN("Frame ends with EOI but is much shorter than the previous frame") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+            uvc_host_frame_t *frame = uvc_frame_get_filled(&stream);
+            REQUIRE(frame != nullptr);
+            REQUIRE(uvc_host_frame_return(&stream, frame) == ESP_OK);
+
+            const std::vector<uint8_t> short_jpg = {0xFF, 0xD8, 0x00, 0x00, 0xFF, 0xD9};
+            test_streaming_bulk_send_frame(1024, &stream, std::span(short_jpg), 1);
+
+            THEN("The frame is dropped") {
+                REQUIRE(uvc_frame_get_filled(&stream) == nullptr);
+                REQUIRE(uvc_host_stream_get_stats(&stream, &stats) == ESP_OK);
+                REQUIRE(stats.frames_dropped.invalid_jpeg == 1);
+            }
+        }
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("Frame buffers in user memory", "[streaming][bulk]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    constexpr size_t fb_size = 100 * 1024;
+    alignas(64) static uint8_t frame_memory[2 * fb_size];
+
+    GIVEN("Misaligned or too small user memory") {
+        THEN("Frame buffers are not allocated") {
+            REQUIRE(uvc_frame_allocate(&stream, 2, fb_size, 0, frame_memory + 1, sizeof(frame_memory) - 1) == ESP_ERR_INVALID_ARG);
+            REQUIRE(uvc_frame_allocate(&stream, 2, fb_size, 0, frame_memory, sizeof(frame_memory) - 1) == ESP_ERR_INVALID_ARG);
+        }
+    }
+
+    GIVEN("Streaming enabled and frame buffers in user memory") {
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 2, fb_size, 0, frame_memory, sizeof(frame_memory)) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+
+        WHEN("Two frames are received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 1);
+            uvc_host_frame_t *frame_0 = uvc_frame_get_filled(&stream);
+            uvc_host_frame_t *frame_1 = uvc_frame_get_filled(&stream);
+            REQUIRE(frame_0 != nullptr);
+            REQUIRE(frame_1 != nullptr);
+
+            THEN("The frames are received into the user memory") {
+                REQUIRE(frame_0->data == frame_memory);
+                REQUIRE(frame_1->data == frame_memory + fb_size);
+                std::vector<uint8_t> frame_data(frame_1->data, frame_1->data + frame_1->data_len);
+                std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+                REQUIRE(frame_data == original_data);
+            }
+            REQUIRE(uvc_host_frame_return(&stream, frame_0) == ESP_OK);
+            REQUIRE(uvc_host_frame_return(&stream, frame_1) == ESP_OK);
+        }
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream); // Must not free the user memory
+    }
+}
+
+SCENARIO("Frame buffers owned by the user", "[streaming][bulk]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    constexpr size_t fb_size = 100 * 1024;
+    static uint8_t display_fb_0[fb_size];
+    static uint8_t display_fb_1[fb_size];
+    uint8_t *const buffers[] = {display_fb_0, display_fb_1};
+
+    GIVEN("Missing buffer") {
+        uint8_t *const missing[] = {display_fb_0, nullptr};
+        THEN("Frame buffers are not allocated") {
+            REQUIRE(uvc_frame_allocate_buffers(&stream, missing, 2, fb_size) == ESP_ERR_INVALID_ARG);
+            REQUIRE(uvc_frame_allocate_buffers(&stream, buffers, 2, 0) == ESP_ERR_INVALID_ARG);
+        }
+    }
+
+    GIVEN("Streaming enabled and frame buffers owned by the user") {
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate_buffers(&stream, buffers, 2, fb_size) == ESP_OK);
+        uvc_frame_format_update(&stream, &logo_jpg_format);
+
+        WHEN("Two frames are received") {
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+            test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 1);
+            uvc_host_frame_t *frame_0 = uvc_frame_get_filled(&stream);
+            uvc_host_frame_t *frame_1 = uvc_frame_get_filled(&stream);
+            REQUIRE(frame_0 != nullptr);
+            REQUIRE(frame_1 != nullptr);
+
+            THEN("The frames are received into the user's buffers") {
+                REQUIRE(frame_0->data == display_fb_0);
+                REQUIRE(frame_1->data == display_fb_1);
+                REQUIRE(frame_1->data_buffer_len == fb_size);
+                std::vector<uint8_t> frame_data(frame_1->data, frame_1->data + frame_1->data_len);
+                std::vector<uint8_t> original_data(logo_jpg.begin(), logo_jpg.end());
+                REQUIRE(frame_data == original_data);
+            }
+
+            AND_WHEN("The first buffer is returned and another frame is received") {
+                REQUIRE(uvc_host_frame_return(&stream, frame_0) == ESP_OK);
+                test_streaming_bulk_send_frame(1024, &stream, std::span(logo_jpg), 0);
+                uvc_host_frame_t *frame_2 = uvc_frame_get_filled(&stream);
+                THEN("The frame is received into the returned buffer") {
+                    REQUIRE(frame_2 != nullptr);
+                    REQUIRE(frame_2->data == display_fb_0);
+                }
+                frame_0 = frame_2;
+            }
+            REQUIRE(uvc_host_frame_return(&stream, frame_0) == ESP_OK);
+            REQUIRE(uvc_host_frame_return(&stream, frame_1) == ESP_OK);
+        }
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream); // Must not free the user's buffers
+    }
+}
+
+/**
+ * @brief Send frame in one ISOC transfer of two packets
+ *
+ * @param[in] stream      UVC stream
+ * @param[in] data        Frame data, split between the packets
+ * @param[in] frame_id    Frame ID of the payload headers
+ * @param[in] still_image Still image flag of the payload headers
+ * @param[in] eof         Set End of Frame in the last packet
+ */
+static void test_streaming_isoc_send_still(uvc_stream_t *stream, std::span<const uint8_t> data, uint8_t frame_id, bool still_image, bool eof = true)
+{
+    constexpr int num_isoc_packets = 2;
+    const size_t packet_size = HEADER_LEN + data.size();
+    std::vector<uint8_t> data_buffer(num_isoc_packets * packet_size);
+    usb_transfer_t *transfer = static_cast<usb_transfer_t *>(operator new (sizeof(usb_transfer_t) + num_isoc_packets * sizeof(usb_isoc_packet_desc_t)));
+    new (transfer) usb_transfer_t{
+        .data_buffer = data_buffer.data(),
+        .data_buffer_size = data_buffer.size(),
+        .num_bytes = static_cast<int>(data_buffer.size()),
+        .actual_num_bytes = 0,
+        .flags = 0,
+        .device_handle = nullptr,
+        .bEndpointAddress = 0,
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .timeout_ms = 0,
+        .callback = nullptr,
+        .context = stream,
+        .num_isoc_packets = num_isoc_packets,
+    };
+
+    const size_t half = data.size() / 2;
+    for (int i = 0; i < num_isoc_packets; i++) {
+        auto chunk = (i == 0) ? data.subspan(0, half) : data.subspan(half);
+        uint8_t *packet = data_buffer.data() + i * packet_size;
+        uvc_payload_header_t *header = reinterpret_cast<uvc_payload_header_t *>(packet);
+        header->bHeaderLength = HEADER_LEN;
+        header->bmHeaderInfo.val = 0;
+        header->bmHeaderInfo.end_of_header = 1;
+        header->bmHeaderInfo.frame_id = frame_id;
+        header->bmHeaderInfo.still_image = still_image;
+        header->bmHeaderInfo.end_of_frame = eof && (i == num_isoc_packets - 1);
+        std::copy(chunk.begin(), chunk.end(), packet + HEADER_LEN);
+        transfer->isoc_packet_desc[i].num_bytes = packet_size;
+        transfer->isoc_packet_desc[i].actual_num_bytes = HEADER_LEN + chunk.size();
+        transfer->isoc_packet_desc[i].status = USB_TRANSFER_STATUS_COMPLETED;
+    }
+    isoc_transfer_process(transfer);
+    operator delete (transfer);
+}
+
+SCENARIO("Still image capture method 2", "[streaming][isoc]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    int frame_callback_called = 0;
+    stream.constant.cb_arg = (void *)&frame_callback_called;
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        int *frame_callback_called = static_cast<int *>(user_ctx);
+        (*frame_callback_called)++;
+        return true;
+    };
+    const std::vector<uint8_t> video_data = {1, 2, 3, 4};
+    const std::vector<uint8_t> still_data = {5, 6, 7, 8, 9, 10};
+
+    GIVEN("Streaming enabled with frame buffer and still frame buffer") {
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+        REQUIRE(uvc_still_allocate(&stream, 1024, 0) == ESP_OK);
+        uvc_host_frame_t *still_frame = &stream.constant.still_fb->frame;
+
+        WHEN("Still image is received without capture request") {
+            test_streaming_isoc_send_still(&stream, std::span(still_data), 0, true);
+            test_streaming_isoc_send_still(&stream, std::span(video_data), 1, false);
+            THEN("The still image is skipped and video frames are delivered") {
+                REQUIRE(frame_callback_called == 1);
+                REQUIRE(stream.dynamic.still_state == UVC_STILL_IDLE);
+                REQUIRE(stream.dynamic.stats.frames_dropped.underflow == 0);
+            }
+        }
+
+        WHEN("Still image is received after trigger") {
+            stream.dynamic.still_state = UVC_STILL_PENDING;
+            test_streaming_isoc_send_still(&stream, std::span(video_data), 0, false);
+            test_streaming_isoc_send_still(&stream, std::span(still_data), 1, true);
+            test_streaming_isoc_send_still(&stream, std::span(video_data), 0, false);
+
+            THEN("The still image is received into the still frame buffer and video frames keep being delivered") {
+                REQUIRE(frame_callback_called == 2);
+                REQUIRE(stream.dynamic.still_state == UVC_STILL_DONE);
+                REQUIRE(stream.dynamic.still_result == ESP_OK);
+                REQUIRE(xSemaphoreTake(stream.constant.still_sem, 0) == pdTRUE);
+                REQUIRE(still_frame->data_len == still_data.size());
+                REQUIRE(std::equal(still_data.begin(), still_data.end(), still_frame->data));
+                REQUIRE_FALSE(uvc_frame_are_all_returned(&stream));
+            }
+
+            AND_WHEN("The still image is returned") {
+                REQUIRE(uvc_host_frame_return(&stream, still_frame) == ESP_OK);
+                THEN("The still frame buffer is free") {
+                    REQUIRE(stream.dynamic.still_state == UVC_STILL_IDLE);
+                    REQUIRE(uvc_frame_are_all_returned(&stream));
+                }
+            }
+        }
+
+        WHEN("Video frame starts before End of still image") {
+            stream.dynamic.still_state = UVC_STILL_PENDING;
+            test_streaming_isoc_send_still(&stream, std::span(still_data), 1, true, false);
+            test_streaming_isoc_send_still(&stream, std::span(video_data), 0, false);
+
+            THEN("The capture fails and the video frame is delivered") {
+                REQUIRE(frame_callback_called == 1);
+                REQUIRE(stream.dynamic.still_state == UVC_STILL_DONE);
+                REQUIRE(stream.dynamic.still_result == ESP_FAIL);
+            }
+        }
+
+        WHEN("Stream is paused during reception of still image") {
+            stream.dynamic.still_state = UVC_STILL_PENDING;
+            test_streaming_isoc_send_still(&stream, std::span(still_data), 1, true, false);
+            REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+
+            THEN("The capture fails") {
+                REQUIRE(frame_callback_called == 0);
+                REQUIRE(stream.dynamic.still_state == UVC_STILL_DONE);
+                REQUIRE(stream.dynamic.still_result == ESP_FAIL);
+            }
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        stream.dynamic.still_state = UVC_STILL_IDLE; // Failed captures are released by uvc_host_stream_still_capture()
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_still_free(&stream);
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("NAL units of H.264 frames are indexed", "[streaming][isoc][h264]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    const uvc_host_frame_t *received_frame = nullptr;
+    stream.constant.cb_arg = (void *)&received_frame;
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        const uvc_host_frame_t **received_frame = static_cast<const uvc_host_frame_t **>(user_ctx);
+        *received_frame = frame;
+        return false;
+    };
+
+    GIVEN("Streaming enabled with H.264 format") {
+        const uvc_host_stream_format_t format = {1280, 720, 30, UVC_VS_FORMAT_H264};
+        uvc_frame_format_update(&stream, &format);
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+
+        WHEN("Frame with SPS, PPS and IDR slice is received") {
+            // 4-byte and 3-byte start codes, trailing zero byte and start code split between the ISOC packets
+            const std::vector<uint8_t> h264_data = {
+                0x00, 0x00, 0x00, 0x01, 0x67, 0xAA, 0xBB,
+                0x00, 0x00, 0x01, 0x68, 0xCC,
+                0x00, 0x00, 0x01, 0x65, 0x11, 0x00, 0x22, 0x33, 0x00,
+            };
+            test_streaming_isoc_send_still(&stream, std::span(h264_data), 0, false);
+
+            THEN("Offsets, lengths and types of the NAL units are in the frame") {
+                REQUIRE(received_frame != nullptr);
+                REQUIRE(received_frame->data_len == h264_data.size());
+                REQUIRE(received_frame->nal.count == 3);
+                REQUIRE_FALSE(received_frame->nal.truncated);
+                REQUIRE(received_frame->nal.units[0].offset == 4);
+                REQUIRE(received_frame->nal.units[0].len == 3);
+                REQUIRE(received_frame->nal.units[0].type == 7);
+                REQUIRE(received_frame->nal.units[1].offset == 10);
+                REQUIRE(received_frame->nal.units[1].len == 2);
+                REQUIRE(received_frame->nal.units[1].type == 8);
+                REQUIRE(received_frame->nal.units[2].offset == 15);
+                REQUIRE(received_frame->nal.units[2].len == 5);
+                REQUIRE(received_frame->nal.units[2].type == 5);
+            }
+        }
+
+        WHEN("Frame with more NAL units than the index holds is received") {
+            std::vector<uint8_t> h264_data;
+            for (int i = 0; i < CONFIG_UVC_NAL_INDEX_SIZE + 1; i++) {
+                h264_data.insert(h264_data.end(), {0x00, 0x00, 0x01, 0x41, 0x9A});
+            }
+            test_streaming_isoc_send_still(&stream, std::span<const uint8_t>(h264_data), 0, false);
+
+            THEN("The index is full and marked as truncated") {
+                REQUIRE(received_frame != nullptr);
+                REQUIRE(received_frame->nal.count == CONFIG_UVC_NAL_INDEX_SIZE);
+                REQUIRE(received_frame->nal.truncated);
+                REQUIRE(received_frame->nal.units[CONFIG_UVC_NAL_INDEX_SIZE - 1].offset == (CONFIG_UVC_NAL_INDEX_SIZE - 1) * 5 + 3);
+                REQUIRE(received_frame->nal.units[CONFIG_UVC_NAL_INDEX_SIZE - 1].len == 2);
+                REQUIRE(received_frame->nal.units[CONFIG_UVC_NAL_INDEX_SIZE - 1].type == 1);
+            }
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        if (received_frame) {
+            REQUIRE(uvc_host_frame_return(&stream, const_cast<uvc_host_frame_t *>(received_frame)) == ESP_OK);
+        }
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("YUY2 frames are converted while received", "[streaming][isoc][yuv]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        return true;
+    };
+    const uvc_host_stream_format_t format = {2, 3, 30, UVC_VS_FORMAT_YUY2};
+    uvc_frame_format_update(&stream, &format);
+
+    // Black, white and two red pixels. The ISOC packets split the middle macropixel
+    const std::vector<uint8_t> yuy2_data = {
+        16, 128, 16, 128,
+        235, 128, 235, 128,
+        81, 90, 81, 240,
+    };
+    uvc_host_yuv_frame_t *converted = nullptr;
+    uvc_host_yuv_config_t config = {
+        .stream_hdl = &stream,
+        .converted_cb = [](const uvc_host_yuv_frame_t *frame, void *user_ctx) -> bool {
+            *static_cast<uvc_host_yuv_frame_t **>(user_ctx) = const_cast<uvc_host_yuv_frame_t *>(frame);
+            return false;
+        },
+        .user_ctx = &converted,
+        .output_format = UVC_HOST_YUV_OUT_RGB565,
+        .swap_bytes = false,
+        .output_buffer_size = 0,
+        .output_heap_caps = 0,
+    };
+    uvc_host_yuv_hdl_t yuv = nullptr;
+
+    GIVEN("Stream is streaming") {
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        THEN("The conversion stage cannot be created") {
+            REQUIRE(uvc_host_yuv_create(&config, &yuv) == ESP_ERR_INVALID_STATE);
+        }
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+    }
+
+    GIVEN("MJPEG stream") {
+        const uvc_host_stream_format_t mjpeg_format = {2, 3, 30, UVC_VS_FORMAT_MJPEG};
+        uvc_frame_format_update(&stream, &mjpeg_format);
+        THEN("The conversion stage is not supported") {
+            REQUIRE(uvc_host_yuv_create(&config, &yuv) == ESP_ERR_NOT_SUPPORTED);
+        }
+    }
+
+    GIVEN("Conversion stage to RGB565") {
+        REQUIRE(uvc_host_yuv_create(&config, &yuv) == ESP_OK);
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+
+        WHEN("YUY2 frame is received") {
+            test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 0, false);
+
+            THEN("The converted frame is passed to the user") {
+                const std::vector<uint8_t> rgb565_data = {0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0xF8, 0x00, 0xF8};
+                REQUIRE(converted != nullptr);
+                REQUIRE(converted->h_res == 2);
+                REQUIRE(converted->v_res == 3);
+                REQUIRE(converted->data_len == rgb565_data.size());
+                REQUIRE(std::equal(rgb565_data.begin(), rgb565_data.end(), converted->data));
+            }
+
+            AND_WHEN("Both output buffers are held by the user") {
+                uvc_host_yuv_frame_t *first = converted;
+                test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 1, false);
+                uvc_host_yuv_frame_t *second = converted;
+                converted = nullptr;
+                test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 0, false);
+
+                THEN("Next frames are converted only after an output is returned") {
+                    REQUIRE(second != first);
+                    REQUIRE(converted == nullptr);
+                    REQUIRE(uvc_host_yuv_frame_return(yuv, first) == ESP_OK);
+                    test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 1, false);
+                    REQUIRE(converted == first);
+                }
+            }
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        REQUIRE(uvc_host_yuv_delete(yuv) == ESP_OK);
+        REQUIRE(stream.constant.data_cb == nullptr);
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("YUY2 frames are drawn by lines without whole frame buffers", "[streaming][isoc][yuv]")
+{
+    struct drawn_lines {
+        unsigned y_start;
+        unsigned y_end;
+        std::vector<uint8_t> data;
+    };
+    static std::vector<drawn_lines> drawn;
+    static std::vector<uvc_host_display_lines_t *> held;
+    static bool hold_lines;
+    static size_t frame_len_at_end;
+    drawn.clear();
+    held.clear();
+    hold_lines = false;
+    frame_len_at_end = SIZE_MAX;
+
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        frame_len_at_end = frame->data_len;
+        return true;
+    };
+    const uvc_host_stream_format_t format = {2, 3, 30, UVC_VS_FORMAT_YUY2};
+    uvc_frame_format_update(&stream, &format);
+
+    // Black, white and red line. The ISOC packets split the middle line
+    const std::vector<uint8_t> yuy2_data = {
+        16, 128, 16, 128,
+        235, 128, 235, 128,
+        81, 90, 81, 240,
+    };
+    uvc_host_display_config_t config = {
+        .stream_hdl = &stream,
+        .draw_cb = [](const uvc_host_display_lines_t *lines, void *user_ctx) -> bool {
+            drawn.push_back({lines->y_start, lines->y_end, std::vector<uint8_t>(lines->data, lines->data + lines->data_len)});
+            if (hold_lines) {
+                held.push_back(const_cast<uvc_host_display_lines_t *>(lines));
+            }
+            return !hold_lines;
+        },
+        .user_ctx = nullptr,
+        .output_format = UVC_HOST_YUV_OUT_RGB565,
+        .swap_bytes = false,
+        .x_offset = 0,
+        .y_offset = 10,
+        .lines_per_draw = 2,
+        .number_of_line_buffers = 2,
+        .line_buffer_size = 0,
+        .line_buffer_heap_caps = MALLOC_CAP_DEFAULT,
+    };
+    uvc_host_display_hdl_t display = nullptr;
+
+    GIVEN("Stream with conversion stage") {
+        stream.constant.data_cb = [](const uvc_host_frame_t *frame, size_t offset, void *arg) {};
+        THEN("The display sink cannot be created") {
+            REQUIRE(uvc_host_display_create(&config, &display) == ESP_ERR_INVALID_STATE);
+        }
+        stream.constant.data_cb = nullptr;
+    }
+
+    GIVEN("Display sink with frame buffer smaller than the frame") {
+        REQUIRE(uvc_host_display_create(&config, &display) == ESP_OK);
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 8, 0, NULL, 0) == ESP_OK);
+
+        WHEN("YUY2 frame is received") {
+            test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 0, false);
+
+            THEN("Groups of converted lines are drawn at their position on the panel") {
+                REQUIRE(drawn.size() == 2);
+                REQUIRE(drawn[0].y_start == 10);
+                REQUIRE(drawn[0].y_end == 12);
+                REQUIRE(drawn[0].data == std::vector<uint8_t>({0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF}));
+                REQUIRE(drawn[1].y_start == 12);
+                REQUIRE(drawn[1].y_end == 13);
+                REQUIRE(drawn[1].data == std::vector<uint8_t>({0x00, 0xF8, 0x00, 0xF8}));
+                REQUIRE(frame_len_at_end == 0);
+
+                uvc_host_display_stats_t stats;
+                REQUIRE(uvc_host_display_get_stats(display, &stats) == ESP_OK);
+                REQUIRE(stats.frames == 1);
+                REQUIRE(stats.lines_drawn == 3);
+                REQUIRE(stats.lines_dropped == 0);
+            }
+        }
+
+        WHEN("All line buffers are held by the user") {
+            hold_lines = true;
+            test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 0, false);
+            drawn.clear();
+            test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 1, false);
+
+            THEN("Lines of next frames are dropped until a line buffer is returned") {
+                REQUIRE(held.size() == 2);
+                REQUIRE(drawn.empty());
+                uvc_host_display_stats_t stats;
+                REQUIRE(uvc_host_display_get_stats(display, &stats) == ESP_OK);
+                REQUIRE(stats.frames == 2);
+                REQUIRE(stats.lines_dropped == 3);
+
+                REQUIRE(uvc_host_display_lines_return(display, held[0]) == ESP_OK);
+                test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 0, false);
+                REQUIRE(drawn.size() == 1);
+                REQUIRE(drawn[0].y_start == 10);
+            }
+            REQUIRE(uvc_host_display_lines_return(display, held[1]) == ESP_OK);
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        REQUIRE(uvc_host_display_delete(display) == ESP_OK);
+        REQUIRE(stream.constant.sink_cb == nullptr);
+        uvc_frame_free(&stream);
+    }
+}
+
+SCENARIO("Partial frames are passed while received", "[streaming][isoc]")
+{
+    struct partial_frame {
+        size_t offset;
+        size_t len;
+    };
+    static std::vector<partial_frame> parts;
+    static size_t frame_len_at_end;
+    parts.clear();
+    frame_len_at_end = 0;
+
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        frame_len_at_end = frame->data_len;
+        return true;
+    };
+    stream.constant.partial_cb = [](const uvc_host_frame_t *frame, size_t offset, size_t len, void *user_ctx) {
+        parts.push_back({offset, len});
+    };
+    const uvc_host_stream_format_t format = {2, 3, 30, UVC_VS_FORMAT_YUY2};
+    uvc_frame_format_update(&stream, &format);
+    REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+    REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+
+    // Frame of 10 bytes is split into two ISOC packets of 5 bytes
+    const std::vector<uint8_t> frame_data = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+
+    GIVEN("Part size of 4 bytes") {
+        stream.constant.partial_size = 4;
+        test_streaming_isoc_send_still(&stream, std::span(frame_data), 0, false);
+
+        THEN("Whole parts are passed while received, the rest at the end of frame") {
+            REQUIRE(parts.size() == 3);
+            REQUIRE(parts[0].offset == 0);
+            REQUIRE(parts[0].len == 4);
+            REQUIRE(parts[1].offset == 4);
+            REQUIRE(parts[1].len == 4);
+            REQUIRE(parts[2].offset == 8);
+            REQUIRE(parts[2].len == 2);
+            REQUIRE(frame_len_at_end == frame_data.size());
+        }
+
+        AND_WHEN("Next frame is received") {
+            parts.clear();
+            test_streaming_isoc_send_still(&stream, std::span(frame_data), 1, false);
+            THEN("Parts start again at offset 0") {
+                REQUIRE(parts.size() == 3);
+                REQUIRE(parts[0].offset == 0);
+            }
+        }
+    }
+
+    GIVEN("Part size of 1 line of YUY2 picture") {
+        stream.constant.partial_lines = 1;
+        const std::vector<uint8_t> yuy2_data(12, 128); // 2x3 pixels
+        test_streaming_isoc_send_still(&stream, std::span(yuy2_data), 0, false);
+
+        THEN("Each part is one line of 4 bytes") {
+            REQUIRE(parts.size() == 3);
+            for (size_t i = 0; i < parts.size(); i++) {
+                REQUIRE(parts[i].offset == i * 4);
+                REQUIRE(parts[i].len == 4);
+            }
+        }
+    }
+
+    GIVEN("Part size of 0") {
+        test_streaming_isoc_send_still(&stream, std::span(frame_data), 0, false);
+
+        THEN("Every received payload is passed") {
+            REQUIRE(parts.size() == 2);
+            REQUIRE(parts[0].offset == 0);
+            REQUIRE(parts[0].len == 5);
+            REQUIRE(parts[1].offset == 5);
+            REQUIRE(parts[1].len == 5);
+        }
+    }
+
+    REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
+
+SCENARIO("YUY2 frames are cropped to region of interest", "[streaming][isoc][yuv]")
+{
+    static std::vector<uint8_t> received;
+    static unsigned h_res, v_res;
+    received.clear();
+
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        received.assign(frame->data, frame->data + frame->data_len);
+        h_res = frame->vs_format.h_res;
+        v_res = frame->vs_format.v_res;
+        return true;
+    };
+    stream.constant.crop_x = 2;
+    stream.constant.crop_y = 1;
+    stream.constant.crop_width = 2;
+    stream.constant.crop_height = 2;
+    REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+    REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+
+    // YUY2 picture of 4x3 pixels, 8 bytes per line, is split into two ISOC packets
+    std::vector<uint8_t> frame_data(24);
+    for (size_t i = 0; i < frame_data.size(); i++) {
+        frame_data[i] = i;
+    }
+
+    GIVEN("Region of 2x2 pixels inside of the picture") {
+        const uvc_host_stream_format_t format = {4, 3, 30, UVC_VS_FORMAT_YUY2};
+        uvc_frame_format_update(&stream, &format);
+        test_streaming_isoc_send_still(&stream, std::span(frame_data), 0, false);
+
+        THEN("Only the region is received, with resolution of the region") {
+            const std::vector<uint8_t> expected = {12, 13, 14, 15, 20, 21, 22, 23};
+            REQUIRE(received == expected);
+            REQUIRE(h_res == 2);
+            REQUIRE(v_res == 2);
+        }
+
+        AND_WHEN("Next frame is received") {
+            received.clear();
+            test_streaming_isoc_send_still(&stream, std::span(frame_data), 1, false);
+            THEN("The region is cropped again from its start") {
+                REQUIRE(received.size() == 8);
+                REQUIRE(received[0] == 12);
+            }
+        }
+    }
+
+    GIVEN("Region that does not fit into the picture") {
+        const uvc_host_stream_format_t format = {2, 12, 30, UVC_VS_FORMAT_YUY2};
+        uvc_frame_format_update(&stream, &format);
+        test_streaming_isoc_send_still(&stream, std::span(frame_data), 0, false);
+
+        THEN("Frames are not cropped") {
+            REQUIRE(received == frame_data);
+            REQUIRE(h_res == 2);
+            REQUIRE(v_res == 12);
+        }
+    }
+
+    REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+    REQUIRE(uvc_frame_are_all_returned(&stream));
+    uvc_frame_free(&stream);
+}
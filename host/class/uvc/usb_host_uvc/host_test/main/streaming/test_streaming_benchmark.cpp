@@ -0,0 +1,210 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include <catch2/catch_test_macros.hpp>
+#include <catch2/benchmark/catch_benchmark.hpp>
+
+#include "usb/usb_types_stack.h"
+#include "usb/usb_types_uvc.h"
+#include "usb/uvc_host.h"
+#include "esp_private/uvc_stream.h"
+#include "uvc_types_priv.h"
+#include "uvc_frame_priv.h"
+
+#include "test_streaming_trace.hpp"
+#include "usb_bench.hpp"
+
+extern "C" {
+    bool isoc_transfer_process(usb_transfer_t *transfer);
+    bool bulk_transfer_process(usb_transfer_t *transfer);
+}
+
+/**
+ * @brief ISOC transfer of one High Speed millisecond with mult = 3
+ *
+ * All packets are data packets in the middle of a frame, which is the common case of ISOC streaming.
+ */
+class isoc_benchmark_transfer {
+public:
+    static constexpr int num_isoc_packets = 24;
+    static constexpr size_t HEADER_LEN = 12;
+
+    isoc_benchmark_transfer(void *context, size_t packet_size, size_t data_len, uint8_t header_info)
+        : data_buffer(num_isoc_packets * packet_size)
+    {
+        const size_t allocation_size = sizeof(usb_transfer_t) + num_isoc_packets * sizeof(usb_isoc_packet_desc_t);
+        transfer = static_cast<usb_transfer_t *>(operator new (allocation_size));
+        new (transfer) usb_transfer_t{
+            .data_buffer = data_buffer.data(),
+            .data_buffer_size = data_buffer.size(),
+            .num_bytes = static_cast<int>(data_buffer.size()),
+            .actual_num_bytes = 0,
+            .flags = 0,
+            .device_handle = nullptr,
+            .bEndpointAddress = 0,
+            .status = USB_TRANSFER_STATUS_COMPLETED,
+            .timeout_ms = 0,
+            .callback = nullptr,
+            .context = context,
+            .num_isoc_packets = num_isoc_packets,
+        };
+        for (int i = 0; i < num_isoc_packets; i++) {
+            uint8_t *packet = data_buffer.data() + i * packet_size;
+            uvc_payload_header_t *header = reinterpret_cast<uvc_payload_header_t *>(packet);
+            header->bHeaderLength = HEADER_LEN;
+            header->bmHeaderInfo.val = header_info;
+            header->bmHeaderInfo.end_of_header = 1;
+            transfer->isoc_packet_desc[i].num_bytes = packet_size;
+            transfer->isoc_packet_desc[i].actual_num_bytes = data_len;
+            transfer->isoc_packet_desc[i].status = USB_TRANSFER_STATUS_COMPLETED;
+        }
+    }
+
+    ~isoc_benchmark_transfer()
+    {
+        operator delete (transfer);
+    }
+
+    usb_transfer_t *transfer;
+
+private:
+    std::vector<uint8_t> data_buffer;
+};
+
+SCENARIO("ISOC packet processing benchmark", "[streaming][isoc][!benchmark]")
+{
+    uvc_stream_t stream = {}; // Define mock stream
+    stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+        FAIL("Got unexpected frame");
+        return true;
+    };
+
+    GIVEN("Streaming enabled and a frame is being received") {
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_allocate(&stream, 1, 100 * 1024, 0, NULL, 0) == ESP_OK);
+
+        // Short packets show the per-packet cost, full packets the cost of copying the data
+        for (size_t data_len : {static_cast<size_t>(64), static_cast<size_t>(1024)}) {
+            isoc_benchmark_transfer isoc(&stream, 1024, data_len, 0);
+            REQUIRE(isoc_transfer_process(isoc.transfer)); // Start of frame
+            REQUIRE(stream.dynamic.current_frame != nullptr);
+
+            BENCHMARK("24 data packets of " + std::to_string(data_len) + " bytes") {
+                stream.dynamic.current_frame->data_len = 0; // Keep the frame from overflowing
+                return isoc_transfer_process(isoc.transfer);
+            };
+
+            isoc_benchmark_transfer isoc_timestamped(&stream, 1024, data_len, (1 << 2) | (1 << 3)); // PTS and SCR present
+            BENCHMARK("24 data packets of " + std::to_string(data_len) + " bytes with PTS and SCR") {
+                stream.dynamic.current_frame->data_len = 0;
+                return isoc_transfer_process(isoc_timestamped.transfer);
+            };
+            REQUIRE(stream.dynamic.stats.frames_dropped.overflow == 0);
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        REQUIRE(uvc_frame_are_all_returned(&stream));
+        uvc_frame_free(&stream);
+    }
+}
+
+/**
+ * @brief Traces of cameras streaming at 30 FPS, High Speed with 8 ISOC packets per USB transfer
+ *
+ * Recorded traces can be added by environment variable UVC_STREAMING_TRACES, colon separated paths to CSV files, see stream_trace_load()
+ */
+static std::vector<stream_trace> benchmark_traces(void)
+{
+    constexpr unsigned num_frames = 4;
+    constexpr unsigned microframes_30fps = 8000 / 30;
+    const std::vector<size_t> mjpeg_720p = stream_trace_compressed_sizes(100 * 1024, num_frames);
+    const std::vector<size_t> mjpeg_1080p = stream_trace_compressed_sizes(200 * 1024, num_frames);
+    const std::vector<size_t> yuy2_480p(num_frames, 640 * 480 * 2);
+
+    std::vector<stream_trace> traces = {
+        stream_trace_isoc("mjpeg_1280x720_mult1", 1024, 8, mjpeg_720p, microframes_30fps),
+        stream_trace_isoc("mjpeg_1280x720_mult3", 3072, 8, mjpeg_720p, microframes_30fps),
+        stream_trace_isoc("mjpeg_1920x1080_mult2", 2048, 8, mjpeg_1080p, microframes_30fps),
+        stream_trace_isoc("mjpeg_1920x1080_mult3", 3072, 8, mjpeg_1080p, microframes_30fps),
+        stream_trace_isoc("yuy2_640x480_mult1", 1024, 8, yuy2_480p, microframes_30fps), // Does not fit into 30 FPS, frames take longer
+        stream_trace_isoc("yuy2_640x480_mult2", 2048, 8, yuy2_480p, microframes_30fps),
+        stream_trace_isoc("yuy2_640x480_mult3", 3072, 8, yuy2_480p, microframes_30fps),
+        stream_trace_bulk("mjpeg_1280x720_bulk", 16 * 1024, mjpeg_720p),
+        stream_trace_bulk("yuy2_640x480_bulk", 16 * 1024, yuy2_480p),
+    };
+
+    const char *recorded = getenv("UVC_STREAMING_TRACES");
+    std::stringstream paths(recorded ? recorded : "");
+    std::string path;
+    while (std::getline(paths, path, ':')) {
+        stream_trace trace;
+        if (stream_trace_load(path, trace)) {
+            traces.push_back(trace);
+        } else {
+            printf("Could not load trace %s\n", path.c_str());
+        }
+    }
+    return traces;
+}
+
+SCENARIO("Streaming throughput benchmark with camera traces", "[streaming][trace][!benchmark]")
+{
+    for (const stream_trace &trace : benchmark_traces()) {
+        GIVEN("Trace " + trace.name) {
+            uvc_stream_t stream = {}; // Define mock stream
+            unsigned frames_received = 0;
+            stream.constant.cb_arg = &frames_received;
+            stream.constant.frame_cb = [](const uvc_host_frame_t *frame, void *user_ctx) -> bool {
+                (*static_cast<unsigned *>(user_ctx))++;
+                return true;
+            };
+            stream.single_thread.bulk_max_payload_len = trace.bulk ? trace.packet_size : 0;
+            bool (*transfer_process)(usb_transfer_t *) = trace.bulk ? bulk_transfer_process : isoc_transfer_process;
+
+            REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+            REQUIRE(uvc_frame_allocate(&stream, 3, trace.max_frame_size, 0, NULL, 0) == ESP_OK);
+            stream_trace_transfers replay(&stream, trace);
+
+            // Replay the trace repeatedly for at least 100 ms
+            usb_bench::callback_timer timer;
+            const auto start = std::chrono::steady_clock::now();
+            unsigned replays = 0;
+            do {
+                for (usb_transfer_t *transfer : replay.transfers) {
+                    timer.measure([transfer_process, transfer] { transfer_process(transfer); });
+                }
+                replays++;
+            } while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+
+            THEN("All frames are assembled") {
+                REQUIRE(frames_received == replays * trace.frames);
+                REQUIRE(stream.dynamic.stats.frames_dropped.overflow == 0);
+                REQUIRE(stream.dynamic.stats.frames_dropped.underflow == 0);
+            }
+
+            // Machine-readable result: one JSON object per line
+            const double elapsed_ns = static_cast<double>(timer.wall_ns_total());
+            const double packets = static_cast<double>(replays) * trace.packets.size();
+            usb_bench::report("uvc", "trace_replay")
+            .value("trace", trace.name.c_str())
+            .value("transfer", trace.bulk ? "bulk" : "isoc")
+            .value("packet_size", trace.packet_size)
+            .value("packets", (int64_t)packets)
+            .value("frames", frames_received)
+            .value("ns_per_packet", elapsed_ns / packets)
+            .value("fps", frames_received * 1e9 / elapsed_ns)
+            .timer(timer)
+            .print();
+
+            REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+            REQUIRE(uvc_frame_are_all_returned(&stream));
+            uvc_frame_free(&stream);
+        }
+    }
+}
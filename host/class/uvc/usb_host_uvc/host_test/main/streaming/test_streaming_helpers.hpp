@@ -23,31 +23,15 @@ extern "C" {
 #define HEADER_LEN (12)
 
 /**
- * @brief Send bulk frame to the UVC driver
+ * @brief Send bulk frame to the UVC driver through given transfer
  *
- * Only the first and last transfer contains header
+ * Only the first and last transfer contains header.
+ * The data are always written to current transfer->data_buffer, as the driver can redirect it (zero-copy)
  */
-inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_context, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false, bool eof_in_sof = false)
+inline void test_streaming_bulk_send_frame_through(usb_transfer_t *transfer, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false, bool eof_in_sof = false)
 {
-    assert(transfer_size > HEADER_LEN);
+    assert(transfer->data_buffer_size > HEADER_LEN);
     assert(!data.empty());
-    uint8_t *data_buffer = new uint8_t[transfer_size];
-    assert(data_buffer);
-    usb_transfer_t _transfer = {
-        .data_buffer = data_buffer,
-        .data_buffer_size = transfer_size,
-        .num_bytes = 0,
-        .actual_num_bytes = 0,
-        .flags = 0,
-        .device_handle = nullptr,
-        .bEndpointAddress = 0,
-        .status = USB_TRANSFER_STATUS_COMPLETED,
-        .timeout_ms = 0,
-        .callback = nullptr,
-        .context = transfer_context,
-        .num_isoc_packets = 0,
-    };
-    usb_transfer_t *transfer = &_transfer;
 
 
     // Reinterpret transfer->data_buffer as a pointer to uvc_payload_header_t
@@ -94,6 +78,33 @@ inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_
     transfer->actual_num_bytes = HEADER_LEN;
     usb_host_transfer_submit_ExpectAndReturn(transfer, ESP_OK); // Each must be re-submitted
     bulk_transfer_callback(transfer);
+}
+
+/**
+ * @brief Send bulk frame to the UVC driver
+ *
+ * Only the first and last transfer contains header
+ */
+inline void test_streaming_bulk_send_frame(size_t transfer_size, void *transfer_context, std::span<const uint8_t> data, uint8_t frame_id = 0, bool error_in_sof = false, bool error_in_eof = false, bool eof_in_sof = false)
+{
+    assert(transfer_size > HEADER_LEN);
+    uint8_t *data_buffer = new uint8_t[transfer_size];
+    assert(data_buffer);
+    usb_transfer_t _transfer = {
+        .data_buffer = data_buffer,
+        .data_buffer_size = transfer_size,
+        .num_bytes = 0,
+        .actual_num_bytes = 0,
+        .flags = 0,
+        .device_handle = nullptr,
+        .bEndpointAddress = 0,
+        .status = USB_TRANSFER_STATUS_COMPLETED,
+        .timeout_ms = 0,
+        .callback = nullptr,
+        .context = transfer_context,
+        .num_isoc_packets = 0,
+    };
+    test_streaming_bulk_send_frame_through(&_transfer, data, frame_id, error_in_sof, error_in_eof, eof_in_sof);
     delete[] data_buffer;
 }
 
@@ -0,0 +1,131 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <catch2/catch_test_macros.hpp>
+
+#include "usb/usb_types_stack.h"
+#include "usb/uvc_host.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "uvc_types_priv.h"
+#include "uvc_frame_priv.h"
+#include "uvc_processing_priv.h"
+
+#include "test_streaming_helpers.hpp"
+
+#define TEST_NUM_OF_XFERS        (4)
+#define TEST_NUM_OF_ACTIVE_XFERS (2)
+
+// Every processed transfer takes one token, so the test decides when the processing task continues
+static SemaphoreHandle_t process_gate = nullptr;
+
+static bool _gated_transfer_process(usb_transfer_t *transfer)
+{
+    xSemaphoreTake(process_gate, portMAX_DELAY);
+    const uvc_stream_t *uvc_stream = static_cast<const uvc_stream_t *>(transfer->context);
+    return __atomic_load_n(&uvc_stream->dynamic.streaming, __ATOMIC_SEQ_CST);
+}
+
+static unsigned _missing_xfers(const uvc_stream_t *stream)
+{
+    return __atomic_load_n(&stream->dynamic.missing_xfers, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * @brief Wait until the processing task put given number of transfers to the spare pool
+ */
+static void _wait_for_spare_xfers(const uvc_stream_t *stream, unsigned spare_xfers)
+{
+    for (int i = 0; i < 100 && uxQueueMessagesWaiting(stream->constant.spare_xfer_queue) < spare_xfers; i++) {
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    REQUIRE(uxQueueMessagesWaiting(stream->constant.spare_xfer_queue) == spare_xfers);
+}
+
+SCENARIO("Deferred processing of bulk transfers", "[streaming][bulk]")
+{
+    uvc_stream_t stream = {};
+    usb_transfer_t *xfers[TEST_NUM_OF_XFERS];
+    for (int i = 0; i < TEST_NUM_OF_XFERS; i++) {
+        xfers[i] = static_cast<usb_transfer_t *>(calloc(1, sizeof(usb_transfer_t)));
+        REQUIRE(xfers[i] != nullptr);
+        xfers[i]->num_bytes = i; // Make the transfers distinguishable for CMock
+        xfers[i]->context = &stream;
+    }
+    stream.constant.xfers = xfers;
+    stream.constant.num_of_xfers = TEST_NUM_OF_XFERS;
+    stream.constant.xfer_process = _gated_transfer_process;
+    REQUIRE(uvc_frame_allocate(&stream, 1, 1024, 0, NULL, 0) == ESP_OK);
+
+    process_gate = xSemaphoreCreateCounting(TEST_NUM_OF_XFERS, 0);
+    REQUIRE(process_gate != nullptr);
+
+    GIVEN("Processing task with 2 active and 2 spare transfers") {
+        REQUIRE(uvc_processing_task_create(&stream, TEST_NUM_OF_ACTIVE_XFERS, 4096, 5, tskNO_AFFINITY) == ESP_OK);
+
+        // Only the active transfers are submitted
+        usb_host_transfer_submit_ExpectAndReturn(xfers[0], ESP_OK);
+        usb_host_transfer_submit_ExpectAndReturn(xfers[1], ESP_OK);
+        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+        REQUIRE(_missing_xfers(&stream) == 0);
+
+        WHEN("Completed transfers wait for processing") {
+            // A spare transfer is submitted in place of each completed one
+            usb_host_transfer_submit_ExpectAndReturn(xfers[2], ESP_OK);
+            bulk_transfer_callback(xfers[0]);
+            usb_host_transfer_submit_ExpectAndReturn(xfers[3], ESP_OK);
+            bulk_transfer_callback(xfers[1]);
+
+            THEN("Spare transfers run out and the missing transfers are counted") {
+                REQUIRE(uxQueueMessagesWaiting(stream.constant.spare_xfer_queue) == 0);
+                bulk_transfer_callback(xfers[2]);
+                bulk_transfer_callback(xfers[3]);
+                REQUIRE(_missing_xfers(&stream) == 2);
+
+                AND_WHEN("The stream is paused and one transfer is processed") {
+                    REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+                    xSemaphoreGive(process_gate);
+                    _wait_for_spare_xfers(&stream, 1);
+
+                    AND_WHEN("The stream is unpaused") {
+                        // The processed transfer is submitted, the other one is still waiting for processing
+                        usb_host_transfer_submit_ExpectAndReturn(xfers[0], ESP_OK);
+                        REQUIRE(uvc_host_stream_unpause(&stream) == ESP_OK);
+                        REQUIRE(_missing_xfers(&stream) == 1);
+
+                        THEN("The missing transfer is resubmitted once it is processed") {
+                            usb_host_transfer_submit_ExpectAndReturn(xfers[1], ESP_OK);
+                            xSemaphoreGive(process_gate);
+                            xSemaphoreGive(process_gate);
+                            xSemaphoreGive(process_gate);
+
+                            // The other processed transfers become spare, so 2 transfers stay in flight
+                            _wait_for_spare_xfers(&stream, TEST_NUM_OF_XFERS - TEST_NUM_OF_ACTIVE_XFERS);
+                            REQUIRE(_missing_xfers(&stream) == 0);
+                        }
+                    }
+                }
+            }
+        }
+
+        REQUIRE(uvc_host_stream_pause(&stream) == ESP_OK);
+        // Let the processing task finish the transfers that are still waiting
+        for (int i = 0; i < TEST_NUM_OF_XFERS; i++) {
+            xSemaphoreGive(process_gate);
+        }
+        uvc_processing_task_delete(&stream);
+    }
+
+    vSemaphoreDelete(process_gate);
+    process_gate = nullptr;
+    uvc_frame_free(&stream);
+    for (int i = 0; i < TEST_NUM_OF_XFERS; i++) {
+        free(xfers[i]);
+    }
+}
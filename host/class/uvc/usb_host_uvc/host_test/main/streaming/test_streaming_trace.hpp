@@ -0,0 +1,257 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <new>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <cstdint>
+#include <cstring>
+
+#include "usb/usb_types_stack.h"
+#include "usb/usb_types_uvc.h"
+
+/**
+ * @brief One packet of streaming trace
+ *
+ * ISOC: one ISOC packet, always starts with payload header.
+ * Bulk: one completed USB transfer, starts with payload header only at start of payload transfer.
+ */
+struct stream_trace_packet {
+    uint32_t len;        // Received bytes, including payload header. 0 for zero-length packet
+    int header_info;     // bmHeaderInfo of payload header at start of the packet. -1 for packet without header
+};
+
+/**
+ * @brief Sequence of packets received from a camera
+ *
+ * Traces are either generated from camera parameters, see stream_trace_isoc() and stream_trace_bulk(),
+ * or loaded from a recording, see stream_trace_load().
+ */
+struct stream_trace {
+    std::string name;
+    bool bulk;                   // Bulk trace, ISOC otherwise
+    size_t packet_size;          // ISOC: size of ISOC packet (MPS * mult). Bulk: size of USB transfer
+    unsigned packets_per_urb;    // ISOC: number of ISOC packets in one USB transfer. Bulk: 1
+    unsigned frames;             // Number of frames that end in the trace
+    size_t max_frame_size;       // Largest frame in the trace
+    std::vector<stream_trace_packet> packets;
+};
+
+static constexpr size_t STREAM_TRACE_HEADER_LEN = 12; // Payload header with PTS
+static constexpr uint8_t STREAM_TRACE_FID = (1 << 0);
+static constexpr uint8_t STREAM_TRACE_EOF = (1 << 1);
+static constexpr uint8_t STREAM_TRACE_PTS = (1 << 2);
+static constexpr uint8_t STREAM_TRACE_EOH = (1 << 7);
+
+/**
+ * @brief Sizes of compressed frames around given mean size, repeatable pseudo-random
+ *
+ * @param[in] mean_size  Mean frame size in bytes
+ * @param[in] num_frames Number of frames
+ */
+inline std::vector<size_t> stream_trace_compressed_sizes(size_t mean_size, unsigned num_frames)
+{
+    std::vector<size_t> sizes;
+    uint32_t seed = 12345;
+    for (unsigned i = 0; i < num_frames; i++) {
+        seed = seed * 1103515245 + 12345;
+        const size_t spread = mean_size / 5; // +-10 % of the mean size
+        sizes.push_back(mean_size - spread / 2 + (seed >> 8) % spread);
+    }
+    return sizes;
+}
+
+/**
+ * @brief Generate ISOC trace
+ *
+ * Every (micro)frame carries one ISOC packet. Frame data are sent in full packets.
+ * Camera sends header-only packets after the end of frame, until the start of the next frame interval.
+ *
+ * @param[in] name               Name of the trace
+ * @param[in] packet_size        Size of ISOC packet: MPS * mult
+ * @param[in] packets_per_urb    ISOC packets in one USB transfer
+ * @param[in] frame_sizes        Sizes of the frames
+ * @param[in] packets_per_frame  Frame interval in (micro)frames
+ */
+inline stream_trace stream_trace_isoc(const std::string &name, size_t packet_size, unsigned packets_per_urb,
+                                      const std::vector<size_t> &frame_sizes, unsigned packets_per_frame)
+{
+    stream_trace trace = {name, false, packet_size, packets_per_urb, 0, 0, {}};
+    uint8_t fid = 0;
+    for (size_t frame_size : frame_sizes) {
+        const size_t first_packet = trace.packets.size();
+        for (size_t sent = 0; sent < frame_size;) {
+            const size_t data_len = std::min(packet_size - STREAM_TRACE_HEADER_LEN, frame_size - sent);
+            sent += data_len;
+            const uint8_t eof = (sent == frame_size) ? STREAM_TRACE_EOF : 0;
+            trace.packets.push_back({static_cast<uint32_t>(STREAM_TRACE_HEADER_LEN + data_len), STREAM_TRACE_EOH | STREAM_TRACE_PTS | eof | fid});
+        }
+        while (trace.packets.size() - first_packet < packets_per_frame) {
+            trace.packets.push_back({static_cast<uint32_t>(STREAM_TRACE_HEADER_LEN), STREAM_TRACE_EOH | STREAM_TRACE_PTS | fid});
+        }
+        trace.max_frame_size = std::max(trace.max_frame_size, frame_size);
+        trace.frames++;
+        fid ^= STREAM_TRACE_FID;
+    }
+    // Round the trace up to whole USB transfers, with Frame ID of the last frame
+    while (trace.packets.size() % packets_per_urb) {
+        trace.packets.push_back({static_cast<uint32_t>(STREAM_TRACE_HEADER_LEN), STREAM_TRACE_EOH | STREAM_TRACE_PTS | (fid ^ STREAM_TRACE_FID)});
+    }
+    return trace;
+}
+
+/**
+ * @brief Generate Bulk trace
+ *
+ * Each payload transfer fills one USB transfer of payload_size. The last payload transfer of a frame is a short packet with EoF.
+ *
+ * @param[in] name         Name of the trace
+ * @param[in] payload_size Size of payload transfer (dwMaxPayloadTransferSize) and of USB transfer
+ * @param[in] frame_sizes  Sizes of the frames
+ */
+inline stream_trace stream_trace_bulk(const std::string &name, size_t payload_size, const std::vector<size_t> &frame_sizes)
+{
+    stream_trace trace = {name, true, payload_size, 1, 0, 0, {}};
+    uint8_t fid = 0;
+    for (size_t frame_size : frame_sizes) {
+        for (size_t sent = 0; sent < frame_size;) {
+            const size_t data_len = std::min(payload_size - STREAM_TRACE_HEADER_LEN, frame_size - sent);
+            sent += data_len;
+            const uint8_t eof = (sent == frame_size) ? STREAM_TRACE_EOF : 0;
+            trace.packets.push_back({static_cast<uint32_t>(STREAM_TRACE_HEADER_LEN + data_len), STREAM_TRACE_EOH | STREAM_TRACE_PTS | eof | fid});
+        }
+        trace.max_frame_size = std::max(trace.max_frame_size, frame_size);
+        trace.frames++;
+        fid ^= STREAM_TRACE_FID;
+    }
+    return trace;
+}
+
+/**
+ * @brief Load recorded trace from CSV file
+ *
+ * First line describes the trace: `# <name>,<isoc|bulk>,<packet_size>,<packets_per_urb>`.
+ * Each next line is one packet: `<len>,<bmHeaderInfo>`, bmHeaderInfo is -1 for packet without header.
+ * Recordings of USB analyzers can be exported to this format.
+ *
+ * @param[in]  path  Path to the CSV file
+ * @param[out] trace Loaded trace
+ * @return true if the trace was loaded
+ */
+inline bool stream_trace_load(const std::string &path, stream_trace &trace)
+{
+    std::ifstream file(path);
+    std::string line;
+    if (!file || !std::getline(file, line) || line.rfind("# ", 0) != 0) {
+        return false;
+    }
+
+    std::stringstream description(line.substr(2));
+    std::string transfer, packet_size, packets_per_urb;
+    if (!std::getline(description, trace.name, ',') || !std::getline(description, transfer, ',') ||
+            !std::getline(description, packet_size, ',') || !std::getline(description, packets_per_urb, ',')) {
+        return false;
+    }
+    trace.bulk = (transfer == "bulk");
+    trace.packet_size = std::stoul(packet_size);
+    trace.packets_per_urb = trace.bulk ? 1 : std::stoul(packets_per_urb);
+    trace.frames = 0;
+    trace.max_frame_size = 0;
+    trace.packets.clear();
+
+    size_t frame_size = 0;
+    while (std::getline(file, line)) {
+        unsigned len;
+        int header_info;
+        if (sscanf(line.c_str(), "%u,%d", &len, &header_info) != 2 || len > trace.packet_size) {
+            return false;
+        }
+        if (header_info >= 0 && len < STREAM_TRACE_HEADER_LEN) {
+            return false; // The replay writes header of fixed length
+        }
+        trace.packets.push_back({len, header_info});
+        frame_size += (header_info >= 0) ? len - STREAM_TRACE_HEADER_LEN : len;
+        if (header_info >= 0 && (header_info & STREAM_TRACE_EOF)) {
+            trace.max_frame_size = std::max(trace.max_frame_size, frame_size);
+            trace.frames++;
+            frame_size = 0;
+        }
+    }
+    while (trace.packets.size() % trace.packets_per_urb) {
+        trace.packets.push_back({0, -1});
+    }
+    return !trace.packets.empty();
+}
+
+/**
+ * @brief USB transfers that replay a trace
+ *
+ * Data of all transfers are prepared in advance, so replay measures only processing of the transfers.
+ */
+class stream_trace_transfers {
+public:
+    stream_trace_transfers(void *context, const stream_trace &trace)
+        : data_buffers(trace.packets.size() / trace.packets_per_urb)
+    {
+        const size_t urb_size = trace.packet_size * trace.packets_per_urb;
+        for (size_t urb = 0; urb < data_buffers.size(); urb++) {
+            data_buffers[urb].resize(urb_size, 0xA5);
+            const int num_isoc_packets = trace.bulk ? 0 : trace.packets_per_urb;
+            const size_t allocation_size = sizeof(usb_transfer_t) + num_isoc_packets * sizeof(usb_isoc_packet_desc_t);
+            usb_transfer_t *transfer = static_cast<usb_transfer_t *>(operator new (allocation_size));
+            new (transfer) usb_transfer_t{
+                .data_buffer = data_buffers[urb].data(),
+                .data_buffer_size = urb_size,
+                .num_bytes = static_cast<int>(urb_size),
+                .actual_num_bytes = 0,
+                .flags = 0,
+                .device_handle = nullptr,
+                .bEndpointAddress = 0,
+                .status = USB_TRANSFER_STATUS_COMPLETED,
+                .timeout_ms = 0,
+                .callback = nullptr,
+                .context = context,
+                .num_isoc_packets = num_isoc_packets,
+            };
+
+            for (unsigned i = 0; i < trace.packets_per_urb; i++) {
+                const stream_trace_packet &packet = trace.packets[urb * trace.packets_per_urb + i];
+                uint8_t *packet_data = data_buffers[urb].data() + i * trace.packet_size;
+                if (packet.header_info >= 0) {
+                    uvc_payload_header_t *header = reinterpret_cast<uvc_payload_header_t *>(packet_data);
+                    header->bHeaderLength = STREAM_TRACE_HEADER_LEN;
+                    header->bmHeaderInfo.val = packet.header_info;
+                }
+                if (trace.bulk) {
+                    transfer->actual_num_bytes = packet.len;
+                } else {
+                    transfer->isoc_packet_desc[i].num_bytes = trace.packet_size;
+                    transfer->isoc_packet_desc[i].actual_num_bytes = packet.len;
+                    transfer->isoc_packet_desc[i].status = USB_TRANSFER_STATUS_COMPLETED;
+                }
+            }
+            transfers.push_back(transfer);
+        }
+    }
+
+    ~stream_trace_transfers()
+    {
+        for (usb_transfer_t *transfer : transfers) {
+            operator delete (transfer);
+        }
+    }
+
+    std::vector<usb_transfer_t *> transfers;
+
+private:
+    std::vector<std::vector<uint8_t>> data_buffers;
+};
@@ -65,10 +65,6 @@ esp_err_t test_uvc_host_stream_open(const uvc_host_stream_config_t *stream_confi
     /* **Testing starts here** */
 
     usb_host_transfer_submit_control_AddCallback(usb_host_transfer_submit_control_success_mock_callback);
-    usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);         // Claim interface
-    if (is_isoc) {                                                   // Set interface only for ISOC cameras)
-        usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK);
-    }
 
     // Negotiation
     // The UVC driver compares 'GET format' with the 'SET format'
@@ -78,6 +74,12 @@ esp_err_t test_uvc_host_stream_open(const uvc_host_stream_config_t *stream_confi
     usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get current
     usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Set current
     usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get current
+
+    // Negotiated payload size selects alternate setting of the claimed interface
+    usb_host_interface_claim_ExpectAnyArgsAndReturn(ESP_OK);         // Claim interface
+    if (is_isoc) {                                                   // Set interface only for ISOC cameras)
+        usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK);
+    }
     usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get max
     usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Get min
     usb_host_transfer_submit_control_ExpectAnyArgsAndReturn(ESP_OK); // Set current
@@ -34,6 +34,25 @@ extern "C" {
  */
 esp_err_t uvc_host_usb_ctrl(uvc_host_stream_hdl_t stream_hdl, uint8_t bmRequestType, uint8_t bRequest, uint16_t wValue, uint16_t wIndex, uint16_t wLength, uint8_t *data);
 
+/**
+ * @brief Lock CTRL transfers for a sequence of requests
+ *
+ * The lock is recursive, uvc_host_usb_ctrl() can be called while it is held.
+ * CTRL transfers of other tasks wait until the sequence is unlocked.
+ *
+ * @param[in] timeout Timeout in FreeRTOS ticks
+ * @return
+ *     - ESP_OK: Locked, must call uvc_host_usb_ctrl_unlock()
+ *     - ESP_ERR_INVALID_STATE: The driver is not installed
+ *     - ESP_ERR_TIMEOUT: CTRL transfers of another task did not finish in time
+ */
+esp_err_t uvc_host_usb_ctrl_lock(TickType_t timeout);
+
+/**
+ * @brief Unlock CTRL transfers locked by uvc_host_usb_ctrl_lock()
+ */
+void uvc_host_usb_ctrl_unlock(void);
+
 /**
  * @brief Probe UVC stream format
  *
@@ -63,6 +82,54 @@ esp_err_t uvc_host_stream_control_probe(uvc_host_stream_hdl_t stream_hdl, uvc_ho
  */
 esp_err_t uvc_host_stream_control_commit(uvc_host_stream_hdl_t stream_hdl, const uvc_host_stream_format_t *vs_format);
 
+/**
+ * @brief Commit UVC stream format negotiated by uvc_host_stream_control_probe()
+ *
+ * Only one CTRL transfer is issued, the format is not negotiated again.
+ *
+ * @param         stream_hdl UVC stream
+ * @param[inout]  vs_control Negotiation result from uvc_host_stream_control_probe()
+ * @param[in]     vs_format  Negotiated Video Stream format
+ * @return
+ *     - ESP_OK: Format committed
+ *     - ESP_ERR_INVALID_ARG: stream_hdl, vs_control or vs_format is NULL
+ *     - ESP_ERR_NOT_FOUND: The format was not found
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_commit_prepared(uvc_host_stream_hdl_t stream_hdl, uvc_vs_ctrl_t *vs_control, const uvc_host_stream_format_t *vs_format);
+
+/**
+ * @brief Negotiate and commit still image format
+ *
+ * @param         stream_hdl    UVC stream
+ * @param[inout]  still_control Requested bFormatIndex, bFrameIndex and bCompressionIndex. Negotiated sizes will be written here
+ * @return
+ *     - ESP_OK: Still image format committed
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or still_control is NULL
+ *     - ESP_ERR_NOT_SUPPORTED: The device did not accept the still image format
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_still_commit(uvc_host_stream_hdl_t stream_hdl, uvc_still_ctrl_t *still_control);
+
+/**
+ * @brief Set Still Image Trigger control
+ *
+ * @param stream_hdl UVC stream
+ * @param[in] trigger Trigger value
+ * @return
+ *     - ESP_OK: Trigger set
+ *     - ESP_ERR_INVALID_ARG: stream_hdl is NULL
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_still_trigger(uvc_host_stream_hdl_t stream_hdl, enum uvc_still_trigger trigger);
+
+/**
+ * @brief Free cached ranges of camera controls
+ *
+ * @param stream_hdl UVC stream that is being removed
+ */
+void uvc_host_stream_control_cache_free(uvc_host_stream_hdl_t stream_hdl);
+
 #ifdef __cplusplus
 }
 #endif
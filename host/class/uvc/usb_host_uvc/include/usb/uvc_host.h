@@ -128,6 +128,44 @@ typedef struct {
     enum uvc_host_stream_format format; /**< Frame coding format */
 } uvc_host_stream_format_t;
 
+/**
+ * @brief Timestamps of Video Stream frame
+ *
+ * Device clock values are taken from optional fields of payload headers.
+ * Host times are in microseconds of esp_timer_get_time()
+ */
+typedef struct {
+    uint32_t clock_frequency;           /**< Frequency of device clock in Hz, from committed format or Video Control header. 0 if unknown */
+    bool pts_valid;                     /**< The device sent Presentation Time Stamp of this frame */
+    uint32_t pts;                       /**< Presentation Time Stamp: device clock at capture of this frame */
+    bool scr_valid;                     /**< The device sent Source Clock Reference in payload headers of this frame */
+    uint32_t scr_stc;                   /**< Source Time Clock of the last SCR: device clock at transmission of the payload */
+    uint16_t scr_sof;                   /**< USB Start of Frame counter of the last SCR, 11 bits */
+    int64_t receive_us;                 /**< Host time of reception of the first payload of this frame */
+    int64_t capture_us;                 /**< Recovered host time of capture. Equal to receive_us if PTS, SCR or clock frequency is missing */
+} uvc_host_frame_time_t;
+
+/**
+ * @brief NAL unit of H.264/H.265 frame
+ */
+typedef struct {
+    uint32_t offset;                    /**< Offset of NAL unit header in frame data, behind the start code */
+    uint32_t len;                       /**< Length of NAL unit up to the next start code, without trailing zero bytes */
+    uint8_t type;                       /**< nal_unit_type from NAL unit header */
+} uvc_host_nal_unit_t;
+
+/**
+ * @brief NAL units of H.264/H.265 frame
+ *
+ * Frame-based H.264/H.265 frames are byte streams of NAL units delimited by start codes, see ITU-T H.264 Annex B.
+ * The driver indexes them once the frame is received. Frames of other formats have no NAL units
+ */
+typedef struct {
+    unsigned count;                     /**< Number of indexed NAL units */
+    bool truncated;                     /**< The frame has more than CONFIG_UVC_NAL_INDEX_SIZE NAL units. Data behind the last indexed unit were not indexed */
+    uvc_host_nal_unit_t units[CONFIG_UVC_NAL_INDEX_SIZE]; /**< NAL units in order of the frame data */
+} uvc_host_frame_nal_t;
+
 /**
  * @brief Video Stream frame
  *
@@ -138,8 +176,53 @@ typedef struct {
     size_t data_buffer_len;                   /**< Max data length supported by this frame buffer */
     size_t data_len;                          /**< Data length of currently store frame */
     uint8_t *data;                            /**< Frame data */
+    uvc_host_frame_time_t time;               /**< Timestamps of this frame */
+    uvc_host_frame_nal_t nal;                 /**< H.264/H.265 only: NAL units of this frame */
 } uvc_host_frame_t;
 
+/**
+ * @brief Policy of received frames waiting for uvc_host_frame_get()
+ */
+enum uvc_host_frame_queue_policy {
+    UVC_HOST_FRAME_QUEUE_FIFO = 0,   /**< Frames are taken in order of reception. New frames are discarded while `depth` frames are waiting */
+    UVC_HOST_FRAME_QUEUE_LATEST,     /**< Only the latest frame is waiting. Older frame is returned to the driver without copying */
+};
+
+/**
+ * @brief Periodic bandwidth of Video Stream format
+ *
+ * All values are in bytes per millisecond
+ */
+typedef struct {
+    uint32_t required;                  /**< Bandwidth that the format would reserve. 0 for Bulk streams */
+    uint32_t available;                 /**< Bandwidth not reserved by opened streams */
+    uint32_t dwMaxPayloadTransferSize;  /**< Payload size per (micro)frame requested by the device for this format */
+    bool fits;                          /**< The format fits into available bandwidth and can be opened */
+} uvc_host_bandwidth_info_t;
+
+/**
+ * @brief Statistics of Video Stream
+ *
+ * Collected since the stream was started by uvc_host_stream_start()
+ */
+typedef struct {
+    uint32_t frames_delivered;          /**< Frames passed to the frame callback or taken by uvc_host_frame_get() */
+    uint32_t frames_decimated;          /**< Frames skipped by frame_decimation in uvc_host_stream_config_t.advanced, not counted as dropped */
+    struct {
+        uint32_t error;                 /**< Error flag in payload header or USB packet error */
+        uint32_t missing_eof;           /**< ISOC only: Start of next frame was received before End of Frame */
+        uint32_t overflow;              /**< Frame did not fit into frame buffer */
+        uint32_t underflow;             /**< No free frame buffer at start of frame */
+        uint32_t queue_full;            /**< No frame callback: Frame was discarded or replaced by newer one before uvc_host_frame_get() */
+        uint32_t invalid_jpeg;          /**< mjpeg_check only: MJPEG frame without SOI or EOI marker, or much shorter than previous frames */
+    } frames_dropped;                   /**< Dropped frames by reason */
+    uint32_t isoc_packets[USB_TRANSFER_STATUS_NO_DEVICE + 1]; /**< ISOC only: Number of packets, indexed by their usb_transfer_status_t */
+    uint32_t zero_length_packets;       /**< Completed packets (ISOC) or transfers (Bulk) without any data */
+    float payload_fill;                 /**< ISOC only: Average fill of completed packets: received bytes / packet size, 0.0 - 1.0 */
+    uint32_t frame_interval_us;         /**< Running average of interval between frames received without errors in microseconds */
+    uint32_t frame_jitter_us;           /**< Running average of deviation of the frame interval from its average in microseconds */
+} uvc_host_stream_stats_t;
+
 /**
  * @brief Stream event callback type
  *
@@ -160,12 +243,26 @@ typedef void (*uvc_host_stream_callback_t)(const uvc_host_stream_event_data_t *e
  */
 typedef bool (*uvc_host_frame_callback_t)(const uvc_host_frame_t *frame, void *user_ctx);
 
+/**
+ * @brief Partial frame callback type
+ *
+ * Called from the context that processes USB transfers, while the rest of the frame is still being received.
+ * Frame data from 0 up to offset + len are valid. The frame is still owned by the driver, it is passed to the frame callback at its end.
+ * A frame that is dropped after some of its parts were passed is not passed to the frame callback, the next frame starts at offset 0.
+ *
+ * @param[in] frame    Frame being received
+ * @param[in] offset   Offset of this part in frame data
+ * @param[in] len      Length of this part
+ * @param[in] user_ctx User's argument passed to open function
+ */
+typedef void (*uvc_host_partial_frame_callback_t)(const uvc_host_frame_t *frame, size_t offset, size_t len, void *user_ctx);
+
 /**
  * @brief Configuration structure of UVC device
  */
 typedef struct {
     uvc_host_stream_callback_t event_cb;  /**< Stream's event callback function. Can be NULL */
-    uvc_host_frame_callback_t frame_cb;   /**< Stream's frame callback function */
+    uvc_host_frame_callback_t frame_cb;   /**< Stream's frame callback function. Set to NULL to get frames by uvc_host_frame_get() */
     void *user_ctx;                       /**< User's argument that will be passed to the callbacks */
     struct {
         uint8_t dev_addr;                 /**< USB address of device. Set to 0 for any. */
@@ -178,13 +275,101 @@ typedef struct {
         int number_of_frame_buffers; /**< Number of frame buffers. These can be very large as they must hold the full frame.*/
         size_t frame_size;           /**< 0: Use dwMaxVideoFrameSize from format negotiation result (might be too large).
                                           (0; SIZE_MAX>: Use user provide frame size. */
+        size_t frame_pool_size;      /**< 0: Each frame buffer has its own memory of frame_size.
+                                          (0; SIZE_MAX>: All frame buffers share one pool of this size, each received frame occupies only its real size.
+                                          frame_size is ignored and the pool does not have to be reallocated on format change. Not applicable with bulk_zero_copy */
         uint32_t frame_heap_caps;    /**< Memory capabilities for frame buffers. Directly passed to heap_caps_malloc() */
-        int number_of_urbs;          /**< Number of URBs for this stream. Triple buffering scheme is recommended */
-        size_t urb_size;             /**< Size in bytes of 1 URB, 10kB should be enough for start.
+        uint8_t *frame_memory;       /**< Memory for frame buffers provided by the user, aligned to 64 bytes. NULL to allocate it with frame_heap_caps.
+                                          Must hold number_of_frame_buffers frames of frame_size, each rounded up to 64 bytes
+                                          (plus 64 bytes with bulk_zero_copy), or frame_pool_size with frame pool.
+                                          frame_size must be set. The memory is not freed by the driver and must be valid until the stream is closed */
+        size_t frame_memory_size;    /**< Size of frame_memory in bytes */
+        uint8_t *const *frame_buffers; /**< Array of number_of_frame_buffers frame buffers owned by the user, e.g. framebuffers of a display.
+                                          NULL to use frame_memory or frame_heap_caps. Frames are received directly into the buffers
+                                          and frame data always starts at the beginning of the buffer. Each buffer must hold frame_size bytes,
+                                          frame_size must be set. Not applicable with frame_pool_size and frame_memory, bulk_zero_copy is ignored.
+                                          The buffers are not freed by the driver and must be valid until the stream is closed */
+        int number_of_urbs;          /**< Number of URBs for this stream. Triple buffering scheme is recommended.
+                                          Set to 0 to derive it from the negotiated format */
+        size_t urb_size;             /**< Size in bytes of 1 URB, 10kB should be enough for start. Set to 0 to derive it from the negotiated format.
                                           Larger value results in less frequent interrupts at the cost of memory consumption */
+        bool bulk_zero_copy;         /**< Bulk streams only: URBs receive frame data directly into frame buffers, without copying.
+                                          frame_heap_caps must select memory accessible by USB DMA. Ignored for Isochronous streams */
+        bool frame_dma_copy;         /**< Isochronous streams only: Payloads are copied from URBs into frame buffers by async memcpy DMA,
+                                          e.g. into frame buffers in PSRAM. Requires CONFIG_UVC_FRAME_DMA_COPY.
+                                          The CPU still copies the payloads if partial_frame or conversion stage is used */
+        struct {
+            size_t stack_size;               /**< Stack size of the processing task. Set to 0 to process URBs and call frame_cb in USB Host client context */
+            unsigned priority;               /**< Priority of the processing task */
+            int xCoreID;                     /**< Core affinity of the processing task */
+            int number_of_spare_urbs;        /**< Number of spare URBs that keep the endpoint busy while completed URBs wait for processing.
+                                                  Set to 0 to use number_of_urbs. Not applicable with bulk_zero_copy */
+        } processing_task;                   /**< Optional task that parses payloads and calls frame_cb, so slow frame_cb does not delay URB resubmission */
+        struct {
+            enum uvc_host_frame_queue_policy policy; /**< Policy of received frames waiting for uvc_host_frame_get() */
+            int depth;                               /**< FIFO only: Maximum number of waiting frames. Set to 0 for number_of_frame_buffers */
+        } frame_queue;                       /**< Used only if frame_cb is NULL */
+        uint32_t isoc_bandwidth_limit;       /**< ISOC only: Maximum periodic bandwidth in bytes per millisecond this stream may reserve. Set to 0 for no limit.
+                                                  If the device requests more, the largest alternate setting within the limit is used.
+                                                  Compressed formats usually work with less bandwidth than requested */
+        size_t still_frame_size;             /**< Size of dedicated frame buffer for still images of uvc_host_stream_still_capture().
+                                                  Set to 0 to disable still image capture */
+        struct {
+            uvc_host_partial_frame_callback_t cb; /**< Called with parts of the frame while it is being received. Set to NULL to disable */
+            size_t size;                     /**< Size of one part in bytes. The rest of the frame is passed at its end.
+                                                  Set to 0 to pass every received payload */
+            unsigned lines;                  /**< YUY2 only: Size of one part in picture lines. Set to 0 to use size */
+        } partial_frame;                     /**< Low latency consumers, e.g. decoding or forwarding, can start before the end of frame */
+        struct {
+            unsigned every_nth;              /**< Keep only every Nth frame. Set to 0 or 1 to keep all frames */
+            float max_fps;                   /**< Keep at most this many frames per second, for cameras that do not support so low FPS.
+                                                  Set to 0 for no limit */
+        } frame_decimation;                  /**< Skipped frames are discarded at start of frame: their payloads are not copied into frame buffers */
+        struct {
+            unsigned x;                      /**< First column of the region in pixels. Must be even for YUY2 */
+            unsigned y;                      /**< First line of the region */
+            unsigned width;                  /**< Width of the region in pixels. Must be even for YUY2. Set to 0 to disable cropping */
+            unsigned height;                 /**< Height of the region in lines */
+        } crop;                              /**< YUY2 only: Region of interest. Frames contain only this region, with resolution of the region in vs_format.
+                                                  Only the region is copied into frame buffers. If frame_size is 0, frame buffers are sized for the region.
+                                                  Not applicable with bulk_zero_copy */
+        bool mjpeg_check;                    /**< MJPEG only: Frames are checked for SOI and EOI markers and against length of previous frames
+                                                  before they are delivered. Invalid frames are dropped, so they do not reach the decoder */
     } advanced;
 } uvc_host_stream_config_t;
 
+/**
+ * @brief Units and Terminals with camera controls
+ */
+enum uvc_host_entity {
+    UVC_HOST_ENTITY_CAMERA_TERMINAL = 0, /**< Camera Terminal: exposure, focus, zoom... See enum uvc_ct_ctrl_selector */
+    UVC_HOST_ENTITY_PROCESSING_UNIT,     /**< Processing Unit: brightness, gain, white balance... See enum uvc_pu_ctrl_selector */
+};
+
+/**
+ * @brief Camera control
+ *
+ * Control of a Unit or Terminal of Video Control interface, up to 4 bytes long.
+ * Values are little-endian unsigned numbers of `len` bytes. Cast values of signed controls, e.g. (int16_t)value for Brightness.
+ */
+typedef struct {
+    uint8_t entity_id;                   /**< ID of Unit or Terminal, see uvc_host_stream_entity_id_get(). Extension Units can be addressed directly */
+    uint8_t selector;                    /**< Control selector */
+    uint8_t len;                         /**< Length of the control in bytes, 1 to 4. See USB UVC specification ver 1.5, chapter 4.2.2 */
+    uint32_t value;                      /**< Value of the control */
+} uvc_host_control_t;
+
+/**
+ * @brief Range of camera control
+ */
+typedef struct {
+    uint8_t info;                        /**< Capabilities of the control: UVC_CONTROL_INFO_SUPPORTS_GET, UVC_CONTROL_INFO_SUPPORTS_SET... */
+    uint32_t min;                        /**< Minimum value */
+    uint32_t max;                        /**< Maximum value */
+    uint32_t res;                        /**< Resolution: step between values */
+    uint32_t def;                        /**< Default value */
+} uvc_host_control_range_t;
+
 /**
  * @brief Install UVC driver
  *
@@ -269,6 +454,42 @@ esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl);
  */
 esp_err_t uvc_host_stream_format_select(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format);
 
+/**
+ * @brief Prepare fast format switch of opened stream
+ *
+ * The format is negotiated with PROBE control, the stream keeps streaming in its current format.
+ * Apply the prepared format with uvc_host_stream_format_switch().
+ *
+ * @note URBs, frame buffers and alternate setting of the stream are kept. Formats that need larger payload than
+ *       the claimed ISOC endpoint offers can be selected only by closing and reopening the stream.
+ * @param[in]    stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[inout] format     Format to prepare. Will be updated if default FPS or default format is requested.
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ *     - ESP_ERR_NOT_FOUND: Format negotiation error
+ *     - ESP_ERR_NOT_SUPPORTED: ISOC only: The format does not fit into the claimed alternate setting
+ *     - Else: USB lib error
+ */
+esp_err_t uvc_host_stream_format_prepare(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format);
+
+/**
+ * @brief Switch opened stream to format prepared by uvc_host_stream_format_prepare()
+ *
+ * ISOC streams keep their URBs in flight, the switch costs only COMMIT and SET_INTERFACE requests.
+ * Bulk streams are stopped and restarted, but the format is not negotiated again.
+ * If the stream is not streaming, the format is committed by uvc_host_stream_start().
+ *
+ * @note Frames received before the switch keep the previous format in uvc_host_frame_t.vs_format
+ * @param[in] stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl is NULL
+ *     - ESP_ERR_INVALID_STATE: No format was prepared
+ *     - Else: USB lib error
+ */
+esp_err_t uvc_host_stream_format_switch(uvc_host_stream_hdl_t stream_hdl);
+
 /**
  * @brief Get format of opened stream
  *
@@ -282,6 +503,19 @@ esp_err_t uvc_host_stream_format_select(uvc_host_stream_hdl_t stream_hdl, uvc_ho
  */
 esp_err_t uvc_host_stream_format_get(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format);
 
+/**
+ * @brief Get statistics of opened stream
+ *
+ * Can be called anytime, also while streaming. Use it to size URBs and frame buffers.
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[out] stats      Pointer to statistics structure to be filled
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ */
+esp_err_t uvc_host_stream_get_stats(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_stats_t *stats);
+
 /**
  * @brief Stop UVC stream
  *
@@ -319,6 +553,114 @@ esp_err_t uvc_host_stream_close(uvc_host_stream_hdl_t stream_hdl);
  */
 esp_err_t uvc_host_frame_return(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame);
 
+/**
+ * @brief Get received frame
+ *
+ * Alternative to frame callback: available only if the stream was opened with frame_cb set to NULL.
+ * Received frames wait for this function according to `uvc_host_stream_config_t.advanced.frame_queue`.
+ * Must call uvc_host_frame_return() after the frame is processed.
+ *
+ * @note Frames that are waiting when the stream is stopped or paused are returned to the driver.
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in]  timeout    Timeout in FreeRTOS ticks
+ * @param[out] frame_ret  Received frame
+ * @return
+ *     - ESP_OK: Success - frame_ret holds received frame
+ *     - ESP_ERR_INVALID_ARG: frame_ret or stream_hdl is NULL
+ *     - ESP_ERR_NOT_SUPPORTED: The stream has frame callback
+ *     - ESP_ERR_TIMEOUT: No frame was received within the timeout
+ */
+esp_err_t uvc_host_frame_get(uvc_host_stream_hdl_t stream_hdl, unsigned long timeout, uvc_host_frame_t **frame_ret);
+
+/**
+ * @brief Capture still image while streaming
+ *
+ * Still image size is negotiated by Still Probe and Commit controls and the image is requested by Still Image Trigger control.
+ * The device sends it either through the video endpoint between video frames (method 2),
+ * or through a dedicated Bulk endpoint (method 3), see USB UVC specification ver 1.5, chapter 2.4.2.4.
+ * The image is received into a dedicated frame buffer of `uvc_host_stream_config_t.advanced.still_frame_size` bytes,
+ * video frames keep being received into the other frame buffers.
+ * Must call uvc_host_frame_return() after the still image is processed.
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in]  h_res      Horizontal resolution of the still image. Set h_res or v_res to 0 for the first size offered by the device
+ * @param[in]  v_res      Vertical resolution of the still image
+ * @param[in]  timeout    Timeout in FreeRTOS ticks
+ * @param[out] still_ret  Captured still image. Its vs_format contains the still image resolution and zero FPS
+ * @return
+ *     - ESP_OK: Success - still image captured
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or still_ret is NULL
+ *     - ESP_ERR_NOT_SUPPORTED: The stream was opened without still_frame_size or its format has no still images of method 2 or 3
+ *     - ESP_ERR_NOT_FOUND: The still image resolution is not offered by the device
+ *     - ESP_ERR_INVALID_STATE: The stream is not streaming or the previous still image was not returned
+ *     - ESP_ERR_TIMEOUT: The still image was not received in time
+ *     - ESP_FAIL: The still image was corrupted or did not fit into the still frame buffer
+ */
+esp_err_t uvc_host_stream_still_capture(uvc_host_stream_hdl_t stream_hdl, unsigned h_res, unsigned v_res, unsigned long timeout, uvc_host_frame_t **still_ret);
+
+/**
+ * @brief Get ID of Unit or Terminal of the stream's UVC function
+ *
+ * @param[in]  stream_hdl    UVC handle obtained from uvc_host_stream_open()
+ * @param[in]  entity        Unit or Terminal
+ * @param[out] entity_id_ret ID for uvc_host_control_t.entity_id
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or entity_id_ret is NULL
+ *     - ESP_ERR_NOT_FOUND: The UVC function has no such Unit or Terminal
+ */
+esp_err_t uvc_host_stream_entity_id_get(uvc_host_stream_hdl_t stream_hdl, enum uvc_host_entity entity, uint8_t *entity_id_ret);
+
+/**
+ * @brief Get range of camera control
+ *
+ * GET_INFO, GET_MIN, GET_MAX, GET_RES and GET_DEF requests are issued only on the first call for the control,
+ * the range is cached until the stream is closed.
+ *
+ * @param[in]  stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[in]  entity_id  ID of Unit or Terminal
+ * @param[in]  selector   Control selector
+ * @param[in]  len        Length of the control in bytes, 1 to 4
+ * @param[out] range      Range of the control
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or range is NULL, or len is out of range
+ *     - ESP_ERR_NO_MEM: Not enough memory to cache the range
+ *     - Else: USB Control transfer error, e.g. the device does not support the control
+ */
+esp_err_t uvc_host_stream_control_range_get(uvc_host_stream_hdl_t stream_hdl, uint8_t entity_id, uint8_t selector, uint8_t len, uvc_host_control_range_t *range);
+
+/**
+ * @brief Get current value of camera control
+ *
+ * @param[in]    stream_hdl UVC handle obtained from uvc_host_stream_open()
+ * @param[inout] control    Control to read. Its value is written here
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or control is NULL, or control length is out of range
+ *     - Else: USB Control transfer error
+ */
+esp_err_t uvc_host_stream_control_get(uvc_host_stream_hdl_t stream_hdl, uvc_host_control_t *control);
+
+/**
+ * @brief Set a batch of camera controls
+ *
+ * All controls are first checked against their cached ranges, see uvc_host_stream_control_range_get(),
+ * then SET_CUR requests are issued back-to-back, without CTRL transfers of other streams in between.
+ * Use it to apply a camera profile, e.g. exposure, white balance, gain and focus, in one call.
+ * Controls without cached range are sent unchecked.
+ *
+ * @param[in] stream_hdl      UVC handle obtained from uvc_host_stream_open()
+ * @param[in] controls        Controls to set, in order
+ * @param[in] num_of_controls Number of controls
+ * @return
+ *     - ESP_OK: All controls were set
+ *     - ESP_ERR_INVALID_ARG: stream_hdl or controls is NULL, a control length is out of range, or a value is out of its cached range. No control was set
+ *     - ESP_ERR_NOT_SUPPORTED: Cached range of a control does not allow SET_CUR. No control was set
+ *     - Else: USB Control transfer error. Controls before the failed one were set
+ */
+esp_err_t uvc_host_stream_controls_set(uvc_host_stream_hdl_t stream_hdl, const uvc_host_control_t *controls, size_t num_of_controls);
+
 /**
  * @brief Print device's descriptors
  *
@@ -349,6 +691,29 @@ void uvc_host_desc_print(uvc_host_stream_hdl_t stream_hdl);
  */
 esp_err_t uvc_host_get_frame_list(uint8_t dev_addr, uint8_t uvc_stream_index, uvc_host_frame_info_t (*frame_info_list)[], size_t *list_size);
 
+/**
+ * @brief Check whether a Video Stream format fits into free periodic bandwidth
+ *
+ * The format is negotiated with the device to get its payload size, then the smallest alternate setting
+ * that fits is selected the same way as in uvc_host_stream_open(). Nothing is reserved by this call.
+ * Use it with uvc_host_get_frame_list() to find out in advance which combinations of resolution and FPS can be opened
+ * next to the already opened streams.
+ *
+ * @param[in]  dev_addr         USB device address, can get it from uvc_host_driver_event_callback_t
+ * @param[in]  uvc_stream_index Index of UVC function. Set to 0 to use first available UVC function
+ * @param[in]  vs_format        Video Stream format to check
+ * @param[in]  bandwidth_limit  Same as isoc_bandwidth_limit in uvc_host_stream_config_t.advanced. Set to 0 for no limit
+ * @param[out] info             Bandwidth information
+ * @return
+ *      - ESP_OK: Success, info is filled
+ *      - ESP_ERR_INVALID_ARG: vs_format or info is NULL
+ *      - ESP_ERR_INVALID_STATE: UVC driver is not installed or the streaming interface is already opened
+ *      - ESP_ERR_NOT_FOUND: Device or format not found
+ *      - Else: Format negotiation error
+ */
+esp_err_t uvc_host_format_bandwidth_get(uint8_t dev_addr, uint8_t uvc_stream_index, const uvc_host_stream_format_t *vs_format,
+                                        uint32_t bandwidth_limit, uvc_host_bandwidth_info_t *info);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,143 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+#include "usb/uvc_host_yuv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uvc_host_display_s *uvc_host_display_hdl_t;
+
+/**
+ * @brief Group of converted picture lines
+ *
+ * This type is passed to draw callback. Coordinates follow esp_lcd_panel_draw_bitmap(): end is exclusive.
+ */
+typedef struct {
+    unsigned x_start;                    /**< First column of the lines on the panel */
+    unsigned y_start;                    /**< First line on the panel */
+    unsigned x_end;                      /**< Column behind the lines on the panel */
+    unsigned y_end;                      /**< Line behind the last line on the panel */
+    size_t data_buffer_len;              /**< Size of this line buffer */
+    size_t data_len;                     /**< Length of converted data */
+    uint8_t *data;                       /**< Converted data */
+} uvc_host_display_lines_t;
+
+/**
+ * @brief Draw callback type
+ *
+ * Called from the context that processes USB transfers of the stream, right after the last pixel of the lines was converted.
+ * Start drawing, e.g. by esp_lcd_panel_draw_bitmap(), and return the lines from the colour transfer done callback
+ * of the panel IO, instead of waiting for the transfer here.
+ *
+ * @param[in] lines    Converted lines
+ * @param[in] user_ctx User's argument passed to uvc_host_display_create()
+ * @return true if the lines were drawn and their buffer can be reused
+ * @return false if the lines are still being drawn, must call uvc_host_display_lines_return() later
+ */
+typedef bool (*uvc_host_display_draw_callback_t)(const uvc_host_display_lines_t *lines, void *user_ctx);
+
+/**
+ * @brief Configuration of display sink
+ */
+typedef struct {
+    uvc_host_stream_hdl_t stream_hdl;            /**< YUY2 stream */
+    uvc_host_display_draw_callback_t draw_cb;    /**< Draw callback */
+    void *user_ctx;                              /**< User's argument passed to draw callback */
+    enum uvc_host_yuv_output_format output_format; /**< Format of converted data */
+    bool swap_bytes;                             /**< RGB565 only: Swap bytes of each pixel, as expected by SPI and I80 LCD panels */
+    unsigned x_offset;                           /**< Position of the picture on the panel */
+    unsigned y_offset;
+    unsigned lines_per_draw;                     /**< Picture lines passed to one draw callback. 0: 16 lines */
+    unsigned number_of_line_buffers;             /**< Line buffers: one is converted while the others are drawn. 0: 2 buffers */
+    size_t line_buffer_size;                     /**< 0: Computed from format of the stream and lines_per_draw */
+    uint32_t line_buffer_heap_caps;              /**< Memory capabilities for line buffers. Directly passed to heap_caps_malloc(). 0: MALLOC_CAP_DMA */
+} uvc_host_display_config_t;
+
+/**
+ * @brief Statistics of display sink
+ */
+typedef struct {
+    uint32_t frames;                             /**< Pictures received completely */
+    uint32_t lines_drawn;                        /**< Lines passed to draw callback */
+    uint32_t lines_dropped;                      /**< Lines not drawn, because all line buffers were held by the user */
+} uvc_host_display_stats_t;
+
+/**
+ * @brief Create display sink for UVC stream
+ *
+ * Payloads of YUY2 frames are converted into line buffers as soon as they are received and each group of
+ * `lines_per_draw` lines is passed to draw callback. Converted data are removed from the frame buffer,
+ * so the frame buffers of the stream only need to hold the data received at once, instead of whole frames:
+ * open the stream with `frame_size` of one ISOC packet or `urb_size` of Bulk stream, plus 4 bytes.
+ * Memory of the whole pipeline drops to one small frame buffer and a few line buffers, and the first lines
+ * are displayed while the rest of the frame is still being received.
+ *
+ * Frames are still delivered to frame callback or uvc_host_frame_get() to mark the end of picture, but their
+ * data_len is 0, unless the frame was longer than the picture.
+ * If all line buffers are held by the user, the lines are not drawn and counted in `lines_dropped`.
+ *
+ * @note The sink must be created while the stream is stopped
+ * @param[in]  config          Configuration of display sink
+ * @param[out] display_hdl_ret Display sink handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream is streaming, or it has a conversion stage or partial frame callback
+ *     - ESP_ERR_NOT_SUPPORTED: Format of the stream is not YUY2, or the stream receives Bulk data directly into frame buffers
+ *     - ESP_ERR_NO_MEM: Not enough memory for line buffers
+ */
+esp_err_t uvc_host_display_create(const uvc_host_display_config_t *config, uvc_host_display_hdl_t *display_hdl_ret);
+
+/**
+ * @brief Delete display sink
+ *
+ * Must be called while the stream is stopped and before the stream is closed.
+ * Line buffers are freed, the user must not access them anymore, e.g. from a draw that is in progress.
+ *
+ * @param[in] display_hdl Display sink handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: display_hdl is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream is streaming
+ */
+esp_err_t uvc_host_display_delete(uvc_host_display_hdl_t display_hdl);
+
+/**
+ * @brief Return drawn lines
+ *
+ * Must be called for lines that were not drawn in draw callback.
+ * Can be called from ISR, e.g. from colour transfer done callback of LCD.
+ *
+ * @param[in] display_hdl Display sink handle
+ * @param[in] lines       Drawn lines
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL or the lines do not belong to this sink
+ */
+esp_err_t uvc_host_display_lines_return(uvc_host_display_hdl_t display_hdl, uvc_host_display_lines_t *lines);
+
+/**
+ * @brief Get statistics of display sink
+ *
+ * @param[in]  display_hdl Display sink handle
+ * @param[out] stats       Statistics since uvc_host_display_create()
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ */
+esp_err_t uvc_host_display_get_stats(uvc_host_display_hdl_t display_hdl, uvc_host_display_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
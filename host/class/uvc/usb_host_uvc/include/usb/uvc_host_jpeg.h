@@ -0,0 +1,117 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "soc/soc_caps.h"
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+
+#if SOC_JPEG_CODEC_SUPPORTED
+#include "driver/jpeg_decode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uvc_host_jpeg_s *uvc_host_jpeg_hdl_t;
+
+/**
+ * @brief Decoded frame
+ *
+ * This type is returned from decoded frame callback
+ */
+typedef struct {
+    unsigned h_res;                      /**< Horizontal resolution of decoded picture */
+    unsigned v_res;                      /**< Vertical resolution of decoded picture */
+    size_t data_buffer_len;              /**< Size of this output buffer */
+    size_t data_len;                     /**< Length of decoded data */
+    uint8_t *data;                       /**< Decoded data */
+} uvc_host_jpeg_frame_t;
+
+/**
+ * @brief Decoded frame callback type
+ *
+ * Called from the decoding task. The decoder continues with the other output buffer meanwhile,
+ * so hand the frame over (e.g. to LCD DMA) and return it later, instead of processing it here.
+ *
+ * @param[in] frame    Decoded frame
+ * @param[in] user_ctx User's argument passed to uvc_host_jpeg_create()
+ * @return true if the frame was processed and its buffer can be reused
+ * @return false if the frame is still being processed, must call uvc_host_jpeg_frame_return() later
+ */
+typedef bool (*uvc_host_jpeg_callback_t)(const uvc_host_jpeg_frame_t *frame, void *user_ctx);
+
+/**
+ * @brief Configuration of hardware JPEG decoding stage
+ */
+typedef struct {
+    uvc_host_stream_hdl_t stream_hdl;            /**< MJPEG stream opened with frame_cb set to NULL */
+    uvc_host_jpeg_callback_t decoded_cb;         /**< Decoded frame callback */
+    void *user_ctx;                              /**< User's argument passed to decoded frame callback */
+    jpeg_dec_output_format_t output_format;      /**< Format of decoded data */
+    jpeg_dec_rgb_element_order_t rgb_order;      /**< Order of RGB components of decoded data */
+    jpeg_yuv_rgb_conv_std_t conv_std;            /**< YUV to RGB conversion standard */
+    size_t output_buffer_size;                   /**< 0: Computed from format of the stream. Resolution is rounded up to 16 pixels */
+    int timeout_ms;                              /**< Timeout of decoding of one frame. 0: Default 100ms */
+    size_t task_stack_size;                      /**< Stack size of the decoding task */
+    unsigned task_priority;                      /**< Priority of the decoding task */
+    int xCoreID;                                 /**< Core affinity of the decoding task */
+} uvc_host_jpeg_config_t;
+
+/**
+ * @brief Create hardware JPEG decoding stage for UVC stream
+ *
+ * The decoding task takes received MJPEG frames by uvc_host_frame_get() and decodes them into one of two output buffers.
+ * The UVC frame buffer is returned right after decoding, so USB reception and decoding overlap.
+ * Use queue policy UVC_HOST_FRAME_QUEUE_LATEST to decode the latest frame only.
+ *
+ * @note Frame buffers of the stream should be allocated in DMA capable memory, see `frame_heap_caps`
+ * @param[in]  config       Configuration of decoding stage
+ * @param[out] jpeg_hdl_ret Decoding stage handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream has frame callback
+ *     - ESP_ERR_NOT_SUPPORTED: Format of the stream is not MJPEG
+ *     - ESP_ERR_NO_MEM: Not enough memory for output buffers or the task
+ *     - Else: JPEG decoder error
+ */
+esp_err_t uvc_host_jpeg_create(const uvc_host_jpeg_config_t *config, uvc_host_jpeg_hdl_t *jpeg_hdl_ret);
+
+/**
+ * @brief Delete hardware JPEG decoding stage
+ *
+ * Must be called before the stream is closed. Output buffers are freed, the user must not access decoded frames anymore.
+ *
+ * @param[in] jpeg_hdl Decoding stage handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: jpeg_hdl is NULL
+ *     - ESP_ERR_INVALID_STATE: Called from decoded frame callback
+ */
+esp_err_t uvc_host_jpeg_delete(uvc_host_jpeg_hdl_t jpeg_hdl);
+
+/**
+ * @brief Return decoded frame
+ *
+ * Must be called for frames that were not processed in decoded frame callback.
+ * Can be called from ISR, e.g. from colour transfer done callback of LCD.
+ *
+ * @param[in] jpeg_hdl Decoding stage handle
+ * @param[in] frame    Decoded frame
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL or the frame does not belong to this stage
+ */
+esp_err_t uvc_host_jpeg_frame_return(uvc_host_jpeg_hdl_t jpeg_hdl, uvc_host_jpeg_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOC_JPEG_CODEC_SUPPORTED
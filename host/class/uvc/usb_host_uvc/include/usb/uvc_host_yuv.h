@@ -0,0 +1,118 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uvc_host_yuv_s *uvc_host_yuv_hdl_t;
+
+/**
+ * @brief Format of converted pictures
+ */
+enum uvc_host_yuv_output_format {
+    UVC_HOST_YUV_OUT_RGB565 = 0,         /**< 16 bits per pixel. Little-endian, unless `swap_bytes` is set */
+    UVC_HOST_YUV_OUT_RGB888,             /**< 24 bits per pixel, bytes in order R, G, B */
+};
+
+/**
+ * @brief Converted frame
+ *
+ * This type is returned from converted frame callback
+ */
+typedef struct {
+    unsigned h_res;                      /**< Horizontal resolution of converted picture */
+    unsigned v_res;                      /**< Vertical resolution of converted picture */
+    size_t data_buffer_len;              /**< Size of this output buffer */
+    size_t data_len;                     /**< Length of converted data */
+    uint8_t *data;                       /**< Converted data */
+} uvc_host_yuv_frame_t;
+
+/**
+ * @brief Converted frame callback type
+ *
+ * Called from the context that processes USB transfers of the stream, right after the last payload of the frame was converted.
+ * Hand the frame over (e.g. to LCD DMA) and return it later, instead of processing it here.
+ *
+ * @param[in] frame    Converted frame
+ * @param[in] user_ctx User's argument passed to uvc_host_yuv_create()
+ * @return true if the frame was processed and its buffer can be reused
+ * @return false if the frame is still being processed, must call uvc_host_yuv_frame_return() later
+ */
+typedef bool (*uvc_host_yuv_callback_t)(const uvc_host_yuv_frame_t *frame, void *user_ctx);
+
+/**
+ * @brief Configuration of YUY2 conversion stage
+ */
+typedef struct {
+    uvc_host_stream_hdl_t stream_hdl;            /**< YUY2 stream */
+    uvc_host_yuv_callback_t converted_cb;        /**< Converted frame callback */
+    void *user_ctx;                              /**< User's argument passed to converted frame callback */
+    enum uvc_host_yuv_output_format output_format; /**< Format of converted data */
+    bool swap_bytes;                             /**< RGB565 only: Swap bytes of each pixel, as expected by SPI and I80 LCD panels */
+    size_t output_buffer_size;                   /**< 0: Computed from format of the stream */
+    uint32_t output_heap_caps;                   /**< Memory capabilities for output buffers. Directly passed to heap_caps_malloc(). 0: MALLOC_CAP_DEFAULT */
+} uvc_host_yuv_config_t;
+
+/**
+ * @brief Create YUY2 to RGB conversion stage for UVC stream
+ *
+ * Payloads of YUY2 frames are converted into one of two output buffers as soon as they are received,
+ * so the conversion overlaps with the USB transfer and the picture is ready right at the end of the frame.
+ * BT.601 limited range coefficients are used, as sent by most of the USB cameras.
+ * The stream keeps delivering YUY2 frames to its frame callback or to uvc_host_frame_get().
+ *
+ * If both output buffers are held by the user, frames are not converted until one of them is returned.
+ *
+ * @note The stage must be created while the stream is stopped
+ * @param[in]  config      Configuration of conversion stage
+ * @param[out] yuv_hdl_ret Conversion stage handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream is streaming or it has another conversion stage
+ *     - ESP_ERR_NOT_SUPPORTED: Format of the stream is not YUY2
+ *     - ESP_ERR_NO_MEM: Not enough memory for output buffers
+ */
+esp_err_t uvc_host_yuv_create(const uvc_host_yuv_config_t *config, uvc_host_yuv_hdl_t *yuv_hdl_ret);
+
+/**
+ * @brief Delete YUY2 conversion stage
+ *
+ * Must be called while the stream is stopped and before the stream is closed.
+ * Output buffers are freed, the user must not access converted frames anymore.
+ *
+ * @param[in] yuv_hdl Conversion stage handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: yuv_hdl is NULL
+ *     - ESP_ERR_INVALID_STATE: The stream is streaming
+ */
+esp_err_t uvc_host_yuv_delete(uvc_host_yuv_hdl_t yuv_hdl);
+
+/**
+ * @brief Return converted frame
+ *
+ * Must be called for frames that were not processed in converted frame callback.
+ * Can be called from ISR, e.g. from colour transfer done callback of LCD.
+ *
+ * @param[in] yuv_hdl Conversion stage handle
+ * @param[in] frame   Converted frame
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Input parameter is NULL or the frame does not belong to this stage
+ */
+esp_err_t uvc_host_yuv_frame_return(uvc_host_yuv_hdl_t yuv_hdl, uvc_host_yuv_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
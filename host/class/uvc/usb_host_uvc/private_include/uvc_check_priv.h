@@ -19,3 +19,10 @@
                 return ret_val;                                         \
             }                                                           \
 })
+
+#define UVC_STREAM_CHECK_FROM_CRIT(stream, cond, ret_val) ({            \
+            if (!(cond)) {                                              \
+                UVC_STREAM_EXIT_CRITICAL(stream);                       \
+                return ret_val;                                         \
+            }                                                           \
+})
@@ -15,7 +15,12 @@ extern portMUX_TYPE uvc_lock;
 #define UVC_ENTER_CRITICAL()              portENTER_CRITICAL(&uvc_lock)
 #define UVC_EXIT_CRITICAL()               portEXIT_CRITICAL(&uvc_lock)
 
+// Dynamic members of one stream are protected by its own spinlock, so streams do not contend with each other
+#define UVC_STREAM_ENTER_CRITICAL(stream) portENTER_CRITICAL(&(stream)->lock)
+#define UVC_STREAM_EXIT_CRITICAL(stream)  portEXIT_CRITICAL(&(stream)->lock)
+
 #define UVC_ATOMIC_LOAD(x)                __atomic_load_n(&x, __ATOMIC_SEQ_CST)
+#define UVC_ATOMIC_EXCHANGE(x, new_x)     __atomic_exchange_n(&(x), (new_x), __ATOMIC_SEQ_CST)
 #define UVC_ATOMIC_SET_IF_NULL(x, new_x)  ({ \
                                               __typeof__(x) expected = NULL; \
                                               __atomic_compare_exchange_n(&(x), &expected, (new_x), false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
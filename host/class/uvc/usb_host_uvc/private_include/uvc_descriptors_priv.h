@@ -61,6 +61,49 @@ esp_err_t uvc_desc_get_streaming_intf_and_ep(
     const usb_intf_desc_t **intf_desc_ret,
     const usb_ep_desc_t **ep_desc_ret);
 
+/**
+ * @brief Get periodic bandwidth reserved by an endpoint
+ *
+ * @param[in] ep_desc    Endpoint descriptor
+ * @param[in] high_speed The device is connected at High Speed
+ * @return Bandwidth in bytes per millisecond. 0 for non-ISOC endpoints
+ */
+uint32_t uvc_desc_get_ep_bandwidth(const usb_ep_desc_t *ep_desc, bool high_speed);
+
+/**
+ * @brief Get Streaming Interface and Endpoint descriptors with the smallest sufficient bandwidth
+ *
+ * We go through all alternate interfaces with MPS lower than or equal to max_mps and pick the one that:
+ * * Offers at least dwMaxPayloadTransferSize bytes per service interval with as small payload as possible
+ * * Reserves at most max_bandwidth of periodic bandwidth
+ *
+ * If no alternate interface offers dwMaxPayloadTransferSize (e.g. Bulk endpoint or unknown dwMaxPayloadTransferSize = UINT32_MAX),
+ * the one with the largest payload that fits max_bandwidth is picked.
+ *
+ * @param[in] cfg_desc                 Configuration descriptor
+ * @param[in] bInterfaceNumber         Index of Streaming interface
+ * @param[in] dwMaxPayloadTransferSize Requested payload per service interval
+ * @param[in] max_mps                  Maximum MPS supported by the host
+ * @param[in] high_speed               The device is connected at High Speed
+ * @param[in] max_bandwidth            Free periodic bandwidth in bytes per millisecond
+ * @param[out] intf_desc_ret           Interface descriptor
+ * @param[out] ep_desc_ret             Endpoint descriptor
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: cfg_desc, intf_desc_ret or ep_desc_ret is NULL
+ *     - ESP_ERR_NOT_SUPPORTED: Alternate interface that offers dwMaxPayloadTransferSize needs more than max_bandwidth
+ *     - ESP_ERR_NOT_FOUND: Could not find interface with required parameters
+ */
+esp_err_t uvc_desc_get_streaming_intf_and_ep_by_bandwidth(
+    const usb_config_desc_t *cfg_desc,
+    uint8_t bInterfaceNumber,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    bool high_speed,
+    uint32_t max_bandwidth,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
 esp_err_t uvc_desc_get_frame_format_by_index(
     const usb_config_desc_t *cfg_desc,
     uint8_t bInterfaceNumber,
@@ -123,6 +166,176 @@ esp_err_t uvc_desc_get_frame_list(
     uvc_host_frame_info_t (*frame_info_list)[],
     size_t *list_size);
 
+/**
+ * @brief Frame of pre-parsed descriptor index
+ */
+typedef struct {
+    uint8_t bInterfaceNumber;              // Streaming interface of this frame
+    int format;                            // enum uvc_host_stream_format of format_desc. Negative for unknown format
+    const uvc_format_desc_t *format_desc;  // Format descriptor this frame belongs to
+    const uvc_frame_desc_t *frame_desc;    // Frame descriptor
+} uvc_desc_index_frame_t;
+
+/**
+ * @brief Alternate setting of pre-parsed descriptor index
+ */
+typedef struct {
+    uint8_t bInterfaceNumber;              // Streaming interface of this alternate setting
+    const usb_intf_desc_t *intf_desc;      // Interface descriptor
+    const usb_ep_desc_t *ep_desc;          // Streaming endpoint descriptor
+} uvc_desc_index_alt_t;
+
+/**
+ * @brief Still Image Frame of pre-parsed descriptor index
+ */
+typedef struct {
+    uint8_t bInterfaceNumber;              // Streaming interface of this still image frame
+    uint8_t bStillCaptureMethod;           // Still capture method from Input Header of the interface
+    const uvc_format_desc_t *format_desc;  // Format descriptor this still image frame belongs to
+    const uvc_still_image_frame_desc_t *still_desc; // Still Image Frame descriptor
+} uvc_desc_index_still_t;
+
+/**
+ * @brief Pre-parsed descriptor index
+ *
+ * Flat tables of UVC descriptors, built by one walk of configuration descriptor.
+ * The tables point into the configuration descriptor, so the index is valid only while the configuration descriptor is.
+ */
+typedef struct uvc_desc_index_s {
+    const usb_config_desc_t *cfg_desc;     // Indexed configuration descriptor
+    const uvc_vc_header_desc_t **vc_headers; // Video Control interface header of each UVC function. NULL for malformed function
+    unsigned num_of_functions;
+    uvc_desc_index_frame_t *frames;        // All frames of all streaming interfaces, in order of the configuration descriptor
+    unsigned num_of_frames;
+    uvc_desc_index_alt_t *alts;            // Streaming alternate settings, with their video endpoint
+    unsigned num_of_alts;
+    uvc_desc_index_still_t *stills;        // Still Image Frames of all formats
+    unsigned num_of_stills;
+    uint8_t *vc_interfaces;                // Video Control interface number of each UVC function, num_of_functions entries
+} uvc_desc_index_t;
+
+/**
+ * @brief Create pre-parsed descriptor index
+ *
+ * @param[in]  cfg_desc  Configuration descriptor
+ * @param[out] index_ret Created index. Free it with uvc_desc_index_delete()
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: cfg_desc or index_ret is NULL
+ *     - ESP_ERR_NO_MEM: Not enough memory for the index
+ */
+esp_err_t uvc_desc_index_create(const usb_config_desc_t *cfg_desc, uvc_desc_index_t **index_ret);
+
+/**
+ * @brief Delete pre-parsed descriptor index
+ *
+ * @param[in] index Index to delete, can be NULL
+ */
+void uvc_desc_index_delete(uvc_desc_index_t *index);
+
+/**
+ * @brief Index version of uvc_desc_get_streaming_interface_num()
+ */
+esp_err_t uvc_desc_index_get_streaming_interface_num(
+    const uvc_desc_index_t *index,
+    uint8_t uvc_index,
+    const uvc_host_stream_format_t *vs_format,
+    uint16_t *bcdUVC,
+    uint8_t *bInterfaceNumber);
+
+/**
+ * @brief Index version of uvc_desc_get_frame_format_by_format()
+ */
+esp_err_t uvc_desc_index_get_frame_format_by_format(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    const uvc_host_stream_format_t *vs_format,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret);
+
+/**
+ * @brief Index version of uvc_desc_get_frame_format_by_index()
+ */
+esp_err_t uvc_desc_index_get_frame_format_by_index(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    uint8_t bFormatIndex,
+    uint8_t bFrameIndex,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret);
+
+/**
+ * @brief Index version of uvc_desc_get_streaming_intf_and_ep_by_bandwidth()
+ */
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    bool high_speed,
+    uint32_t max_bandwidth,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret);
+
+/**
+ * @brief Index version of uvc_desc_get_frame_list()
+ */
+esp_err_t uvc_desc_index_get_frame_list(
+    const uvc_desc_index_t *index,
+    uint8_t uvc_index,
+    uvc_host_frame_info_t (*frame_info_list)[],
+    size_t *list_size);
+
+/**
+ * @brief Get Still Image Frame descriptor of a format
+ *
+ * @param[in]  index               Descriptor index
+ * @param[in]  bInterfaceNumber    Streaming interface
+ * @param[in]  bFormatIndex        Index of the format
+ * @param[out] bStillCaptureMethod Still capture method of the interface. Can be NULL
+ * @param[out] still_desc_ret      Still Image Frame descriptor
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: index or still_desc_ret is NULL
+ *     - ESP_ERR_NOT_FOUND: The format has no Still Image Frame descriptor
+ */
+esp_err_t uvc_desc_index_get_still_frame(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    uint8_t bFormatIndex,
+    uint8_t *bStillCaptureMethod,
+    const uvc_still_image_frame_desc_t **still_desc_ret);
+
+/**
+ * @brief Find image size in Still Image Frame descriptor
+ *
+ * @param[in]    still_desc  Still Image Frame descriptor
+ * @param[inout] h_res       Horizontal resolution. If h_res or v_res is 0, the first image size is used and written here
+ * @param[inout] v_res       Vertical resolution
+ * @param[out]   bFrameIndex Index of the image size for still probe control
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: NULL argument
+ *     - ESP_ERR_INVALID_SIZE: The descriptor is too short for its image sizes
+ *     - ESP_ERR_NOT_FOUND: The image size is not offered
+ */
+esp_err_t uvc_desc_still_frame_find_size(const uvc_still_image_frame_desc_t *still_desc, unsigned *h_res, unsigned *v_res, uint8_t *bFrameIndex);
+
+/**
+ * @brief Find Unit or Terminal in Video Control interface of UVC function
+ *
+ * @param[in]  index              Descriptor index
+ * @param[in]  uvc_index          Index of UVC function
+ * @param[in]  bDescriptorSubType Subtype of the Unit or Terminal descriptor, enum uvc_vc_desc_subtype
+ * @param[in]  wTerminalType      Input Terminal only: Type of the terminal, e.g. UVC_ITT_CAMERA
+ * @param[out] entity_id          bUnitID or bTerminalID of the first matching descriptor
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: index or entity_id is NULL
+ *     - ESP_ERR_NOT_FOUND: The UVC function has no such Unit or Terminal
+ */
+esp_err_t uvc_desc_index_get_entity_id(const uvc_desc_index_t *index, uint8_t uvc_index, uint8_t bDescriptorSubType, uint16_t wTerminalType, uint8_t *entity_id);
+
 #ifdef __cplusplus
 }
 #endif
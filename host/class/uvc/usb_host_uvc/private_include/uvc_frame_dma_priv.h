@@ -0,0 +1,76 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+#include "uvc_frame_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if UVC_FRAME_DMA_COPY
+/**
+ * @brief Install DMA copy of payloads into frame buffers
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ *     - Else: DMA channel could not be installed
+ */
+esp_err_t uvc_frame_dma_install(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Uninstall DMA copy
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_dma_uninstall(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Add data to the frame buffer, the aligned part of data is copied by DMA
+ *
+ * The copy can still be in progress on return, call uvc_frame_dma_wait() before the frame buffer is passed on
+ * or before the source data are released.
+ * The CPU copies the data if the stream has a conversion stage or partial frame callback, which read the data right away.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @param[in] data       Pointer to data
+ * @param[in] data_len   Data length in bytes
+ * @return
+ *     - ESP_OK: Data added to the frame buffer
+ *     - ESP_ERR_INVALID_ARG: frame or data is NULL
+ *     - ESP_ERR_INVALID_SIZE: Frame buffer overflow
+ */
+esp_err_t uvc_frame_dma_add_data(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *data, size_t data_len);
+
+/**
+ * @brief Wait for all DMA copies started by uvc_frame_dma_add_data()
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_dma_wait(uvc_stream_t *uvc_stream);
+
+#else // UVC_FRAME_DMA_COPY
+
+static inline esp_err_t uvc_frame_dma_add_data(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
+{
+    return uvc_frame_add_data(frame, data, data_len);
+}
+
+static inline void uvc_frame_dma_wait(uvc_stream_t *uvc_stream)
+{
+}
+#endif // UVC_FRAME_DMA_COPY
+
+#ifdef __cplusplus
+}
+#endif
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include <string.h> // For memset
+
 #include "usb/uvc_host.h"
 #include "uvc_types_priv.h"
 
@@ -13,19 +15,63 @@
 extern "C" {
 #endif
 
+// Alignment of frame buffers and of USB transfers that receive data directly into them (zero-copy bulk).
+// Covers DMA and cache line requirements of all supported targets
+#define UVC_FRAME_ALIGN (64)
+
+/**
+ * @brief Frame buffer private to the driver
+ *
+ * uvc_host_frame_t is the first member, so the pointer passed to the user can be cast back to this structure.
+ */
+struct uvc_frame_s {
+    uvc_host_frame_t frame;   // Frame buffer passed to the user. Must be the first member
+    uint8_t *data_base;       // Start of the allocated frame data. frame.data can be shifted by up to UVC_FRAME_ALIGN bytes from here
+    unsigned landed_xfers;    // Zero-copy bulk: number of USB transfers in flight that receive data into this frame buffer
+    bool return_pending;      // Zero-copy bulk: the frame was returned, it is queued as empty once all landed transfers finish
+    unsigned vs_format_gen;   // Generation of stream's format saved in frame.vs_format
+    size_t slice_start;       // Frame pool: Offset of this frame buffer in the pool
+    size_t slice_end;         // Frame pool: End of this frame buffer in the pool. Equal to slice_start until the frame is committed
+    bool slice_released;      // Frame pool: The frame was returned, its slice is reused once all older slices are released
+    int64_t scr_receive_us;   // Host time of reception of the payload with the last SCR in frame.time
+    uvc_frame_crop_t crop;    // Region of interest picked up with frame.vs_format
+    size_t crop_received;     // Cropped frames only: Bytes of received picture, including bytes outside of the region
+    size_t sink_consumed;     // Display sink only: Bytes of the picture consumed by the sink and removed from the frame buffer
+};
+
 /**
  * @brief Allocate frame buffers for UVC stream
  *
  * @param[in] uvc_stream UVC stream handle
  * @param[in] nb_of_fb   Number of frame buffers to allocate
- * @param[in] fb_size    Size of 1 frame buffer in bytes
+ * @param[in] fb_size    Size of 1 frame buffer in bytes. Size of the whole pool if uvc_stream->constant.fb_pool is set
  * @param[in] fb_caps    Memory capabilities of memory for frame buffers
+ * @param[in] fb_memory  Memory for frame data provided by the user, aligned to UVC_FRAME_ALIGN. NULL to allocate it with fb_caps
+ * @param[in] fb_memory_size Size of fb_memory in bytes
  * @return
  *     - ESP_OK: Success
  *     - ESP_ERR_NO_MEM: Not enough memory for frame buffers
- *     - ESP_ERR_INVALID_ARG: Invalid count or size of frame buffers
+ *     - ESP_ERR_INVALID_ARG: Invalid count or size of frame buffers, or fb_memory is misaligned or too small
  */
-esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_size, uint32_t fb_caps);
+esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_size, uint32_t fb_caps,
+                             uint8_t *fb_memory, size_t fb_memory_size);
+
+/**
+ * @brief Use frame buffers owned by the user for UVC stream
+ *
+ * Frames are received directly into the buffers, e.g. framebuffers of a display.
+ * The buffers are not freed by the driver.
+ *
+ * @param[in] uvc_stream UVC stream handle
+ * @param[in] buffers    Array of nb_of_fb frame buffers
+ * @param[in] nb_of_fb   Number of frame buffers
+ * @param[in] fb_size    Size of 1 frame buffer in bytes
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory for frame buffer descriptors
+ *     - ESP_ERR_INVALID_ARG: Invalid count or size of frame buffers, a buffer is NULL, or the stream uses frame pool or zero-copy
+ */
+esp_err_t uvc_frame_allocate_buffers(uvc_stream_t *uvc_stream, uint8_t *const *buffers, int nb_of_fb, size_t fb_size);
 
 /**
  * @brief Free allocated frame buffers
@@ -48,14 +94,74 @@ bool uvc_frame_are_all_returned(uvc_stream_t *uvc_stream);
 /**
  * @brief Get empty frame buffer
  *
+ * The frame buffer picks up the current format of the stream here.
+ * With frame pool, the frame buffer gets the largest free contiguous slice of the pool.
+ *
  * @param[in] uvc_stream UVC stream
  * @return Pointer to empty frame buffer. Can be NULL if not frame buffer is available.
  */
 uvc_host_frame_t *uvc_frame_get_empty(uvc_stream_t *uvc_stream);
 
+/**
+ * @brief Commit received frame before it is passed to the user
+ *
+ * Frame pool only: the slice of the frame shrinks to the received data, the rest of the pool is free for next frames.
+ * Host time of capture is recovered from PTS and SCR of the frame here.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Received frame
+ */
+void uvc_frame_commit(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Set frame buffer as current frame of the stream
+ *
+ * The current frame is accessed without critical section. If the stream already has a current frame
+ * or if it was paused in the meantime, the frame buffer is returned.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Empty frame buffer from uvc_frame_get_empty()
+ * @return
+ *     - true:  The frame buffer is the current frame now
+ *     - false: The frame buffer was returned
+ */
+bool uvc_frame_set_current(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Put filled frame buffer to the ring of filled frames
+ *
+ * Used if the stream has no frame callback, the user pulls the frames by uvc_host_frame_get().
+ * The frame buffers are queued according to the stream's policy of filled frames.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Filled frame buffer
+ * @return
+ *     - true:  The frame buffer is waiting for the user
+ *     - false: The frame buffer was discarded (FIFO is full), the caller must return it
+ */
+bool uvc_frame_put_filled(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Get filled frame buffer
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return Pointer to the oldest filled frame buffer. Can be NULL if no frame buffer is filled.
+ */
+uvc_host_frame_t *uvc_frame_get_filled(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Return all filled frame buffers that were not taken by the user
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_frame_return_filled(uvc_stream_t *uvc_stream);
+
 /**
  * @brief Add data to the frame buffer
  *
+ * Data that already lie at the end of frame data (zero-copy reception) are not copied.
+ * Data inside the frame buffer, behind the end of frame data, are moved to the end of frame data.
+ *
  * @param[in] frame    Frame buffer
  * @param[in] data     Pointer to data
  * @param[in] data_len Data length in bytes
@@ -77,12 +183,114 @@ static inline void uvc_frame_reset(uvc_host_frame_t *frame)
 {
     assert(frame);
     frame->data_len = 0;
+    frame->data = ((uvc_frame_t *)frame)->data_base;
+    memset(&frame->time, 0, sizeof(frame->time));
+    frame->nal.count = 0;
+    frame->nal.truncated = false;
+    ((uvc_frame_t *)frame)->crop_received = 0;
+    ((uvc_frame_t *)frame)->sink_consumed = 0;
 }
 
 /**
- * @brief Saves format to all frame buffers
+ * @brief Pass received parts of the current frame to partial frame callback
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Current frame
+ * @param[in] frame_end  The frame was received completely, its rest is passed too
+ */
+void uvc_frame_partial(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame, bool frame_end);
+
+/**
+ * @brief Pass data added to the current frame to display sink
+ *
+ * Data consumed by the sink are removed from the frame buffer, the rest is moved to its start.
+ * So the frame buffer only needs to hold the data added at once, not the whole frame.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Current frame
+ * @param[in] offset     Offset of the added data in the frame buffer
+ */
+void uvc_frame_sink(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, size_t offset);
+
+/**
+ * @brief Pass data added to the current frame to conversion stage, display sink and partial frame callback
+ *
+ * Still images are not passed, they have their own format.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Current frame
+ * @param[in] offset     Offset of the added data in the frame, 0 at start of frame
+ */
+static inline void uvc_frame_data_added(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame, size_t offset)
+{
+    if (frame == (const uvc_host_frame_t *)uvc_stream->constant.still_fb) {
+        return;
+    }
+    if (uvc_stream->constant.data_cb) {
+        uvc_stream->constant.data_cb(frame, offset, uvc_stream->constant.data_cb_arg);
+    }
+    if (uvc_stream->constant.partial_cb) {
+        if (offset == 0) {
+            uvc_stream->single_thread.partial_delivered = 0;
+        }
+        uvc_frame_partial(uvc_stream, frame, false);
+    }
+    if (uvc_stream->constant.sink_cb) {
+        uvc_frame_sink(uvc_stream, (uvc_host_frame_t *)frame, offset);
+    }
+}
+
+/**
+ * @brief Save timestamps from payload header to the frame
+ *
+ * The first payload of the frame sets its receive time. PTS is taken from the first header that has it,
+ * SCR from the last one, together with the time its payload was received.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame the payload belongs to. Can be NULL
+ * @param[in] header     Payload header
+ * @param[in] len        Length of received data that start with the header
+ */
+void uvc_frame_time_header(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *header, size_t len);
+
+/**
+ * @brief Release frame buffer from a USB transfer that received data into it
+ *
+ * If the frame was returned while the transfer was in flight, it is queued as empty now.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer the transfer received data into. Can be NULL
+ */
+void uvc_frame_landing_release(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Check integrity of received MJPEG frame
+ *
+ * Checks only SOI marker at the start, EOI marker at the end and length of the frame against previous frames,
+ * the frame data are not parsed. Frames of other formats and streams without mjpeg_check always pass.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Received frame
+ * @return true if the frame can be delivered
+ */
+bool uvc_frame_mjpeg_check(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame);
+
+/**
+ * @brief Decide at start of frame whether the frame is skipped by frame decimation
+ *
+ * Skipped frames are counted in statistics. The caller marks them with skip_current_frame,
+ * so their payloads are never copied into frame buffers.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return true if the frame that starts now is skipped
+ */
+bool uvc_frame_decimate(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Save new format of the stream
  *
- * All frames must be returned when this function is called
+ * The format is saved to frame buffers lazily, once they are taken by uvc_frame_get_empty().
+ * This includes frame buffers that are held by the user at the moment of calling this function.
  *
  * @param[in] uvc_stream UVC stream
  * @param[in] vs_format  VS format to save to frame buffers
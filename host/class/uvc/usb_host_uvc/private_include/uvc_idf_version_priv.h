@@ -24,3 +24,10 @@
 #if !(ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 4) && ESP_IDF_VERSION != ESP_IDF_VERSION_VAL(5, 2, 0))
 #define USB_EP_DESC_GET_MULT(desc_ptr) (((desc_ptr)->wMaxPacketSize & 0x1800) >> 11)
 #endif
+
+// Copying of payloads by DMA needs esp_async_memcpy and esp_cache APIs of IDF v5.3
+#if CONFIG_UVC_FRAME_DMA_COPY && (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
+#define UVC_FRAME_DMA_COPY 1
+#else
+#define UVC_FRAME_DMA_COPY 0
+#endif
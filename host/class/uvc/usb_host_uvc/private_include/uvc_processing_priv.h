@@ -0,0 +1,68 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "esp_err.h"
+#include "usb/usb_host.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create processing task of UVC stream
+ *
+ * All USB transfers of the stream are put to the spare pool.
+ * Completed transfers are then processed in this task, outside of USB Host client context.
+ *
+ * @param[in] uvc_stream          UVC stream handle with allocated transfers
+ * @param[in] num_of_active_xfers Number of transfers kept in flight while streaming. The rest are spare transfers
+ * @param[in] stack_size          Stack size of the processing task
+ * @param[in] priority            Priority of the processing task
+ * @param[in] xCoreID             Core affinity of the processing task
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: No spare transfers
+ *     - ESP_ERR_NO_MEM: Not enough memory for the queues or the task
+ */
+esp_err_t uvc_processing_task_create(uvc_stream_t *uvc_stream, unsigned num_of_active_xfers, size_t stack_size, unsigned priority, int xCoreID);
+
+/**
+ * @brief Delete processing task of UVC stream
+ *
+ * Blocks until the processing task finishes. Transfers waiting for processing are discarded.
+ *
+ * @note Must not be called from the processing task. Can be called even if the task was not created.
+ * @param[in] uvc_stream UVC stream handle
+ */
+void uvc_processing_task_delete(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Defer processing of completed transfer to the processing task
+ *
+ * Called from transfer callbacks. A spare transfer is submitted in place of the completed one,
+ * so the endpoint stays busy while the completed transfer waits for processing.
+ *
+ * @param[in] uvc_stream UVC stream handle
+ * @param[in] transfer   Completed USB transfer
+ */
+void uvc_processing_defer(uvc_stream_t *uvc_stream, usb_transfer_t *transfer);
+
+/**
+ * @brief Submit active transfers from the spare pool
+ *
+ * @param[in] uvc_stream UVC stream handle
+ * @return
+ *     - ESP_OK: Success
+ *     - Else: Transfer submission failed
+ */
+esp_err_t uvc_processing_submit(uvc_stream_t *uvc_stream);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "usb/usb_host.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reason of dropped frame
+ */
+typedef enum {
+    UVC_STATS_DROP_ERROR = 0,   // Error flag in payload header or USB packet error
+    UVC_STATS_DROP_MISSING_EOF, // Start of next frame was received before EoF
+    UVC_STATS_DROP_OVERFLOW,    // Frame did not fit into frame buffer
+    UVC_STATS_DROP_UNDERFLOW,   // No free frame buffer at start of frame
+    UVC_STATS_DROP_QUEUE_FULL,  // Frame was discarded or replaced while waiting for uvc_host_frame_get()
+    UVC_STATS_DROP_INVALID_JPEG, // MJPEG frame failed integrity check
+} uvc_stats_drop_t;
+
+/**
+ * @brief Reset statistics of UVC stream
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_stats_reset(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Count packets of completed USB transfer
+ *
+ * ISOC: status histogram, zero-length packets and payload fill. Bulk: zero-length packets.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed USB transfer
+ */
+void uvc_stats_transfer(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer);
+
+/**
+ * @brief Measure interval of frame that was received without errors
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_stats_frame_received(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Count frame delivered to the user
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_stats_frame_delivered(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Count frame skipped by frame decimation
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_stats_frame_decimated(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Count dropped frame
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] reason     Reason of the drop
+ */
+void uvc_stats_frame_dropped(uvc_stream_t *uvc_stream, uvc_stats_drop_t reason);
+
+/**
+ * @brief Skip current frame and count it as dropped
+ *
+ * The frame is counted only once, even if more errors occur in it.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] reason     Reason of the drop
+ */
+static inline void uvc_stats_frame_skip(uvc_stream_t *uvc_stream, uvc_stats_drop_t reason)
+{
+    if (!uvc_stream->single_thread.skip_current_frame) {
+        uvc_stream->single_thread.skip_current_frame = true;
+        uvc_stats_frame_dropped(uvc_stream, reason);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,85 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "usb/uvc_host.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocate still image frame buffer
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] fb_size    Size of the still frame buffer in bytes
+ * @param[in] fb_caps    Memory capabilities of the still frame buffer
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: uvc_stream is NULL or fb_size is 0
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+esp_err_t uvc_still_allocate(uvc_stream_t *uvc_stream, size_t fb_size, uint32_t fb_caps);
+
+/**
+ * @brief Free still image frame buffer and its USB transfer
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+void uvc_still_free(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Check if the frame is the still image frame buffer
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Frame buffer
+ * @return true if the frame is the still image frame buffer
+ */
+static inline bool uvc_still_is_frame(const uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    return frame && (const uvc_frame_t *)frame == uvc_stream->constant.still_fb;
+}
+
+/**
+ * @brief Check if the still image frame buffer is free
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return true if still image capture is disabled or the still frame buffer is not held by the user nor the driver
+ */
+bool uvc_still_is_returned(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Method 2: Get still frame buffer at start of still image in the video stream
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return Still frame buffer, NULL if no still image was triggered. The still image is then skipped
+ */
+uvc_host_frame_t *uvc_still_frame_start(uvc_stream_t *uvc_stream);
+
+/**
+ * @brief Pass completely received frame to uvc_host_stream_still_capture() if it is the still image
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] frame      Received frame
+ * @return true if the frame was the still image, false for video frames
+ */
+bool uvc_still_frame_end(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame);
+
+/**
+ * @brief Return still frame buffer, see uvc_host_frame_return()
+ *
+ * If the still image is still being received, the capture fails.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @return ESP_OK
+ */
+esp_err_t uvc_still_frame_return(uvc_stream_t *uvc_stream);
+
+#ifdef __cplusplus
+}
+#endif
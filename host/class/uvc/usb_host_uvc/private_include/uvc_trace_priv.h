@@ -0,0 +1,39 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include "usb/usb_host.h"
+#include "uvc_types_priv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Optional trace recorder, events are recorded only if the usb_host_trace component is linked
+void usb_host_trace_submit(const char *driver, uint8_t interface, const usb_transfer_t *transfer) __attribute__((weak));
+void usb_host_trace_complete(const char *driver, uint8_t interface, const usb_transfer_t *transfer) __attribute__((weak));
+
+// Context of streaming transfers is their UVC stream
+#define UVC_TRACE_INTERFACE(transfer) (((const uvc_stream_t *)(transfer)->context)->constant.bInterfaceNumber)
+
+#define UVC_TRACE_SUBMIT(transfer)                                                    \
+    do {                                                                              \
+        if (usb_host_trace_submit) {                                                  \
+            usb_host_trace_submit("uvc", UVC_TRACE_INTERFACE(transfer), (transfer));  \
+        }                                                                             \
+    } while (0)
+
+#define UVC_TRACE_COMPLETE(transfer)                                                  \
+    do {                                                                              \
+        if (usb_host_trace_complete) {                                                \
+            usb_host_trace_complete("uvc", UVC_TRACE_INTERFACE(transfer), (transfer)); \
+        }                                                                             \
+    } while (0)
+
+#ifdef __cplusplus
+}
+#endif
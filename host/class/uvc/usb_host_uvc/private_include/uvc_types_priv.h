@@ -11,22 +11,95 @@
 #include <sys/queue.h>
 
 #include "usb/usb_host.h"
+#include "usb/usb_host_xfer_pool_weak.h"
 #include "usb/uvc_host.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "uvc_idf_version_priv.h"
+#if UVC_FRAME_DMA_COPY
+#include "esp_async_memcpy.h"
+#endif
 
 typedef struct uvc_host_stream_s uvc_stream_t;
+typedef struct uvc_frame_s uvc_frame_t;
 
 /**
- * @brief Enum for simple state machine of Bulk frame data processing
+ * @brief Enum for simple state machine of Bulk payload transfer processing
  */
 typedef enum {
-    UVC_STREAM_BULK_PACKET_SOF = 0,
-    UVC_STREAM_BULK_PACKET_DATA,
-    UVC_STREAM_BULK_PACKET_EOF,
+    UVC_STREAM_BULK_PACKET_HEADER = 0, // Payload header, start of payload transfer
+    UVC_STREAM_BULK_PACKET_DATA,       // Payload data, up to the end of payload transfer
 } uvc_stream_bulk_packet_type_t;
 
+/**
+ * @brief State of still image frame buffer
+ */
+typedef enum {
+    UVC_STILL_IDLE = 0,  // Still frame buffer is free
+    UVC_STILL_PREPARING, // Still image format is being committed
+    UVC_STILL_PENDING,   // Still image was triggered, waiting for its start
+    UVC_STILL_RECEIVING, // Still image is being received into the still frame buffer
+    UVC_STILL_DONE,      // Capture ended, the still frame buffer is held by the user until uvc_host_frame_return()
+    UVC_STILL_ABORTING,  // Capture timed out while receiving, the still frame buffer is freed once the reception ends
+} uvc_still_state_t;
+
+/**
+ * @brief Geometry of region of interest in received picture
+ */
+typedef struct {
+    size_t line_len;                          // Length of one received line in bytes. 0 if frames are not cropped
+    size_t x_offset;                          // Offset of the region in a line in bytes
+    size_t width;                             // Width of the region in bytes
+    size_t start;                             // Offset of the first line of the region in received picture
+    size_t end;                               // Offset behind the last line of the region in received picture
+} uvc_frame_crop_t;
+
+/**
+ * @brief Slot of frame buffer index ring
+ */
+typedef struct {
+    unsigned seq;                             // Sequence number of the slot. Tells whether the slot is ready for write or read
+    unsigned index;                           // Index of frame buffer in uvc_host_stream_s.constant.fbs
+} uvc_frame_ring_slot_t;
+
+/**
+ * @brief Lock-free ring of frame buffer indices
+ *
+ * Bounded multi-producer queue with sequence number in each slot. Can be used from any context, including ISR.
+ * The ring has more slots than frame buffers, so push of a frame buffer never fails while it is popped by a single consumer.
+ */
+typedef struct {
+    uvc_frame_ring_slot_t *slots;             // Array of slots. Number of slots is a power of 2
+    unsigned mask;                            // Number of slots - 1
+    unsigned head;                            // Position of next read
+    unsigned tail;                            // Position of next write
+} uvc_frame_ring_t;
+
+/**
+ * @brief Pre-parsed descriptors of connected device, shared by all its streams
+ */
+typedef struct uvc_desc_cache_s {
+    SLIST_ENTRY(uvc_desc_cache_s) list_entry;
+    uint8_t dev_addr;                         // Address of the indexed device
+    unsigned refs;                            // Number of references: the driver's cache list and opened streams
+    struct uvc_desc_index_s *index;           // Descriptor index, see uvc_descriptors_priv.h
+} uvc_desc_cache_t;
+
+/**
+ * @brief Cached range of camera control
+ */
+typedef struct uvc_control_cache_s {
+    SLIST_ENTRY(uvc_control_cache_s) list_entry;
+    uint8_t entity_id;                        // Unit or Terminal of the control
+    uint8_t selector;                         // Control selector
+    uint8_t len;                              // Length of the control in bytes
+    uvc_host_control_range_t range;           // Range read from the device
+} uvc_control_cache_t;
+
 struct uvc_host_stream_s {
     SLIST_ENTRY(uvc_host_stream_s) list_entry;
 
@@ -35,30 +108,121 @@ struct uvc_host_stream_s {
         uvc_host_stream_callback_t stream_cb; // User's callback for stream events
         uvc_host_frame_callback_t frame_cb;   // User's frame callback
         void *cb_arg;                         // Common argument for user's callbacks
-        QueueHandle_t empty_fb_queue;         // Queue of empty framebuffers
+        uvc_frame_t *fbs;                     // Array of frame buffers
+        unsigned num_of_fbs;                  // Number of frame buffers
+        uvc_frame_ring_t empty_fb_ring;       // Ring of empty frame buffers
+        uvc_frame_ring_t filled_fb_ring;      // Ring of filled frame buffers, waiting for the user. Used if frame_cb is NULL
+        SemaphoreHandle_t filled_fb_sem;      // Signals new filled frame buffer to uvc_host_frame_get()
+        enum uvc_host_frame_queue_policy filled_fb_policy; // Policy of filled frame buffers
+        unsigned filled_fb_depth;             // FIFO only: Maximum number of filled frame buffers. 0 for all frame buffers
+        bool fb_pool;                         // Frame buffers are slices of one shared pool
+        bool fb_user_memory;                  // Frame data is in memory provided by the user, it is not freed by the driver
+        uint8_t *fb_pool_data;                // Frame pool only: Memory of the pool
+        size_t fb_pool_size;                  // Frame pool only: Size of the pool in bytes
+        unsigned *fb_pool_slices;             // Frame pool only: Indices of frame buffers in order of their slices in the pool
 
         // Constant USB descriptor values
+        uvc_desc_cache_t *desc_cache;         // Pre-parsed descriptors of the device. All descriptor lookups of this stream use its index
         uint16_t bcdUVC;                      // Version of UVC specs this device implements
+        uint8_t  uvc_index;                   // UVC function of this stream
+        uint8_t  bControlInterfaceNumber;     // USB Video Control interface of the UVC function. Needed for camera controls
         uint8_t  bInterfaceNumber;            // USB Video Streaming interface claimed by this stream. Needed for ISOC Stream start and CTRL transfers
         uint8_t  bAlternateSetting;           // Alternate setting for selected interface. Needed for ISOC Stream start
         uint8_t  bEndpointAddress;            // Streaming endpoint address. Needed for BULK Stream stop
+        uint32_t periodic_bandwidth;          // ISOC only: Periodic bandwidth reserved by the alternate setting in bytes per millisecond
+        uint32_t max_payload_size;            // Payload of the streaming endpoint per service interval. Limits formats of fast format switch
+        uint32_t vc_clock_frequency;          // Device clock frequency from Video Control header. Used if the committed format does not report it
 
         // USB host related members
         usb_device_handle_t dev_hdl;          // USB device handle
         unsigned num_of_xfers;                // Number of USB transfers
         usb_transfer_t **xfers;               // Pointer to array of USB transfers. Accessible only by the UVC driver
+        bool bulk_zero_copy;                  // Bulk only: USB transfers receive frame data directly into frame buffers
+        uint8_t **xfer_buffers;               // Zero-copy only: Original data buffers of the USB transfers
+        bool (*xfer_process)(usb_transfer_t *transfer); // Processing of completed USB transfer. Returns true if the transfer can be resubmitted
+#if UVC_FRAME_DMA_COPY
+        async_memcpy_handle_t dma_copy;       // ISOC only: DMA that copies payloads into frame buffers. NULL if the CPU copies them
+        SemaphoreHandle_t dma_copy_sem;       // Given by each finished DMA copy
+        size_t dma_copy_align;                // Alignment of DMA copies, so the DMA and the CPU do not write the same cache line
+#endif
+
+        // Processing task related members
+        TaskHandle_t processing_task;         // Task that processes completed USB transfers. NULL if they are processed in USB Host client context
+        QueueHandle_t processing_queue;       // Queue of completed USB transfers for the processing task
+        QueueHandle_t spare_xfer_queue;       // Queue of USB transfers that are not in flight nor waiting for processing
+        unsigned num_of_active_xfers;         // Number of USB transfers kept in flight while streaming
+        TaskHandle_t processing_task_closing; // Task that waits for the end of the processing task
+
+        // Still image capture related members
+        uvc_frame_t *still_fb;                // Dedicated frame buffer for still images. NULL if still image capture is disabled
+        SemaphoreHandle_t still_sem;          // Signals end of still image capture to uvc_host_stream_still_capture()
+        usb_transfer_t *still_xfer;           // Method 3 only: USB transfer of still image Bulk endpoint. Allocated by the first capture
+
+        // Conversion stage related members
+        void (*data_cb)(const uvc_host_frame_t *frame, size_t offset, void *arg); // Called with data added to the current frame from offset up to its data_len. Set only while the stream is stopped
+        void *data_cb_arg;                    // Argument of data_cb
+        size_t (*sink_cb)(const uvc_host_frame_t *frame, bool frame_start, void *arg); // Display sink: Called with data added to the current frame, returns number of bytes consumed from the start of frame data. Set only while the stream is stopped
+        void *sink_cb_arg;                    // Argument of sink_cb
+        uvc_host_partial_frame_callback_t partial_cb; // User's partial frame callback. NULL if disabled
+        size_t partial_size;                  // Size of one part in bytes. 0 for every received payload
+        unsigned partial_lines;               // YUY2 only: Size of one part in picture lines. 0 to use partial_size
+        unsigned decimation_every_nth;        // Keep only every Nth frame. 0 or 1 to keep all frames
+        int64_t decimation_interval_us;       // Minimum interval between kept frames. 0 for no limit
+        unsigned crop_x;                      // Region of interest in pixels. crop_width 0 if frames are not cropped
+        unsigned crop_y;
+        unsigned crop_width;
+        unsigned crop_height;
+        bool mjpeg_check;                     // MJPEG only: Check integrity of frames before they are delivered
+
+        // Camera control related members
+        SLIST_HEAD(list_ctrl, uvc_control_cache_s) control_cache; // Cached ranges of camera controls. Accessed only with CTRL transfers locked
     } constant; // Constant members do no change after installation thus do not require a critical section
 
     struct {
         uvc_host_stream_format_t vs_format;   // Format of the video stream
+        unsigned vs_format_gen;               // Generation of vs_format, incremented on every format change. Frame buffers pick up the format lazily
+        uvc_frame_crop_t crop;                // Region of interest in pictures of vs_format
+        size_t fb_pool_write;                 // Frame pool only: End of the newest slice
+        unsigned fb_pool_oldest;              // Frame pool only: Position of the oldest slice in fb_pool_slices
+        unsigned fb_pool_count;               // Frame pool only: Number of slices in the pool
         uint32_t dwMaxVideoFrameSize;         // Maximum frame size of this vs_format
-        uvc_host_frame_t *current_frame;      // Frame that is being written to
+        uint32_t dwMaxPayloadTransferSize;    // Maximum payload transfer size of committed vs_format. 0 if unknown
+        uint32_t dwClockFrequency;            // Device clock frequency of committed vs_format in Hz. 0 if unknown
+        uvc_host_frame_t *current_frame;      // Frame that is being written to. Accessed atomically, without critical section
         bool streaming;                       // Flag whether stream is on/off
-    } dynamic; // Dynamic members require a critical section
+        unsigned missing_xfers;               // Processing task only: Number of USB transfers that could not be resubmitted, because no spare transfer was available
+        uvc_host_stream_stats_t stats;        // Statistics of the stream. payload_fill is computed from the sums below on request
+        uint64_t stats_payload_bytes;         // ISOC only: Sum of received bytes of completed packets
+        uint64_t stats_payload_capacity;      // ISOC only: Sum of sizes of completed packets
+        int64_t stats_last_frame_us;          // Time of the last frame received without errors, 0 before the first one
+        bool next_format_ready;               // Format was prepared by uvc_host_stream_format_prepare()
+        uvc_host_stream_format_t next_format; // Prepared format
+        uvc_vs_ctrl_t next_vs_ctrl;           // Negotiation result of prepared format, committed by uvc_host_stream_format_switch()
+        bool format_switching;                // ISOC only: Format is being switched while transfers keep running. Received data is dropped
+        uvc_still_state_t still_state;        // State of still frame buffer
+        esp_err_t still_result;               // Result of the last still image capture, valid in UVC_STILL_DONE
+        bool still_xfer_busy;                 // Method 3 only: still_xfer is in flight
+    } dynamic; // Dynamic members require a critical section of the stream lock
+
+    portMUX_TYPE lock;                        // Spinlock of dynamic members, see UVC_STREAM_ENTER_CRITICAL()
 
     struct {
         uvc_stream_bulk_packet_type_t next_bulk_packet; // Bulk only: next expected packet
+        uint32_t bulk_max_payload_len;                  // Bulk only: Maximum length of payload transfer, copied from dwMaxPayloadTransferSize. 0 for no limit
+        size_t bulk_payload_len;                        // Bulk only: Length of the current payload transfer received so far
+        bool bulk_frame_end;                            // Bulk only: Current payload transfer is the last one of the frame
         bool skip_current_frame;                        // Flag to skip current frame. An error has occurred in the stream
         uint8_t current_frame_id;                       // Frame ID can be only 0 or 1. But we also allow setting it to invalid value = 2.
+        uvc_host_frame_t **xfer_landing;                // Zero-copy only: Frame buffer each USB transfer receives data into, NULL for its own buffer
+        int64_t xfer_receive_us;                        // Host time when processing of the current USB transfer started
+        size_t partial_delivered;                       // Bytes of the current frame passed to partial frame callback
+        unsigned decimation_count;                      // Frames started since the stream was unpaused, for every_nth decimation
+        int64_t decimation_next_us;                     // Time from which the next frame is kept, 0 to keep the next frame
+        int64_t decimation_sof_us;                      // Time of the previous start of frame, 0 if none
+        size_t mjpeg_avg_len;                           // Running average of length of MJPEG frames with SOI and EOI, 0 if none
+        unsigned mjpeg_format_gen;                      // Format generation of frames in mjpeg_avg_len
+#if UVC_FRAME_DMA_COPY
+        unsigned dma_copy_pending;                      // DMA copies that were started and not waited for yet
+#endif
     } single_thread; // Single thread members are only accessed from 1 thread, so they do not need protection
 };
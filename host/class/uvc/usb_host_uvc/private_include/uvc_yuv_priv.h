@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "usb/uvc_host_yuv.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UVC_YUV_MACROPIXEL (4) // YUY2 macropixel: Y0 U Y1 V, two pixels sharing chroma
+
+/**
+ * @brief Convert YUY2 macropixels into RGB
+ *
+ * Fixed-point BT.601 limited range: Y in <16; 235>, U and V in <16; 240>.
+ * Chroma terms are computed once per macropixel and shared by its two pixels.
+ *
+ * @param[in]  src          YUY2 data
+ * @param[out] dst          RGB data
+ * @param[in]  macropixels  Number of macropixels to convert
+ * @param[in]  format       Output format
+ * @param[in]  swap_bytes   RGB565 only: big-endian pixels
+ */
+void uvc_yuv_convert(const uint8_t *src, uint8_t *dst, size_t macropixels, enum uvc_host_yuv_output_format format, bool swap_bytes);
+
+static inline size_t uvc_yuv_bytes_per_pixel(enum uvc_host_yuv_output_format format)
+{
+    return (format == UVC_HOST_YUV_OUT_RGB565) ? 2 : 3;
+}
+
+#ifdef __cplusplus
+}
+#endif
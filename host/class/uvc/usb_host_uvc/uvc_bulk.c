@@ -5,18 +5,288 @@
  */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h> // For memcpy
 
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "uvc_stream.h" // For uvc_host_stream_pause()
 #include "uvc_types_priv.h"
 #include "uvc_check_priv.h"
 #include "uvc_frame_priv.h"
 #include "uvc_critical_priv.h"
+#include "uvc_processing_priv.h"
+#include "uvc_stats_priv.h"
+#include "uvc_still_priv.h"
+#include "uvc_trace_priv.h"
 
 static const char *TAG = "uvc-bulk";
 
+/**
+ * @brief Find index of USB transfer in the UVC stream
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   USB transfer
+ * @return Index of the transfer in uvc_stream->constant.xfers, -1 if not found
+ */
+static int uvc_bulk_xfer_index(const uvc_stream_t *uvc_stream, const usb_transfer_t *transfer)
+{
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
+        if (uvc_stream->constant.xfers[i] == transfer) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Zero-copy: Take frame buffer that received data of this transfer
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   Completed USB transfer
+ * @return Frame buffer that must be released by uvc_frame_landing_release() after the data are processed.
+ *         NULL if the data were received into the transfer's own buffer.
+ */
+static uvc_host_frame_t *uvc_bulk_landing_take(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer)
+{
+    if (!uvc_stream->constant.bulk_zero_copy) {
+        return NULL;
+    }
+    const int idx = uvc_bulk_xfer_index(uvc_stream, transfer);
+    if (idx < 0) {
+        return NULL;
+    }
+    uvc_host_frame_t *frame = uvc_stream->single_thread.xfer_landing[idx];
+    uvc_stream->single_thread.xfer_landing[idx] = NULL;
+    return frame;
+}
+
+/**
+ * @brief Zero-copy: Set data buffer of the transfer before it is resubmitted
+ *
+ * If frame data are expected, the transfer receives data directly into the current frame buffer.
+ * It lands behind space reserved for all transfers that are in flight ahead of it, so its data are never overwritten by them.
+ * In a stream of full data packets, the transfer lands right at the end of frame data and no copy is needed.
+ * Otherwise, the data are compacted to the end of frame data by uvc_frame_add_data().
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] transfer   USB transfer to be resubmitted
+ */
+static void uvc_bulk_landing_set(uvc_stream_t *uvc_stream, usb_transfer_t *transfer)
+{
+    if (!uvc_stream->constant.bulk_zero_copy) {
+        return;
+    }
+    const int idx = uvc_bulk_xfer_index(uvc_stream, transfer);
+    if (idx < 0) {
+        return;
+    }
+
+    uint8_t *landing = uvc_stream->constant.xfer_buffers[idx]; // Default to transfer's own buffer
+    const bool frame_data_expected = (uvc_stream->single_thread.next_bulk_packet == UVC_STREAM_BULK_PACKET_DATA) &&
+                                     !uvc_stream->single_thread.skip_current_frame;
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream); // The current frame can be returned by uvc_host_stream_pause() in the meantime
+    uvc_host_frame_t *frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+    if (frame_data_expected && frame && !uvc_still_is_frame(uvc_stream, frame)) {
+        const size_t reserved = (uvc_stream->constant.num_of_xfers - 1) * transfer->num_bytes;
+        uintptr_t addr = (uintptr_t)(frame->data + frame->data_len) + reserved;
+        addr = (addr + UVC_FRAME_ALIGN - 1) & ~((uintptr_t)UVC_FRAME_ALIGN - 1);
+        if (addr + transfer->num_bytes <= (uintptr_t)(frame->data + frame->data_buffer_len)) {
+            ((uvc_frame_t *)frame)->landed_xfers++;
+            uvc_stream->single_thread.xfer_landing[idx] = frame;
+            landing = (uint8_t *)addr;
+        }
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    // Since the data_buffer in usb_transfer_t is a constant pointer, we must cast away the const qualifier
+    uint8_t **ptr = (uint8_t **)(&(transfer->data_buffer));
+    *ptr = landing;
+}
+
+/**
+ * @brief Pass the current frame to the user
+ *
+ * The frame is delivered only if it was received without errors, otherwise it is returned to the empty ring.
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void uvc_bulk_frame_end(uvc_stream_t *uvc_stream)
+{
+    // Get the current frame being processed and clear it from the stream,
+    // so no more data is written to this frame after the end of frame.
+    // The user could stop the stream in the meantime and take the frame
+    uvc_host_frame_t *this_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+
+    // Determine if we should pass the frame to the user:
+    // Only if streaming is active and we have a valid frame to pass to the user.
+    const bool deliver_frame = (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && this_frame && !uvc_stream->single_thread.skip_current_frame);
+
+    bool return_frame = true; // Default to returning the frame in case streaming has been stopped
+    if (deliver_frame && uvc_still_frame_end(uvc_stream, this_frame)) {
+        return_frame = false; // Passed to uvc_host_stream_still_capture()
+    } else if (deliver_frame && !uvc_frame_mjpeg_check(uvc_stream, this_frame)) {
+        uvc_stats_frame_dropped(uvc_stream, UVC_STATS_DROP_INVALID_JPEG);
+    } else if (deliver_frame) {
+        uvc_frame_commit(uvc_stream, this_frame);
+        uvc_stats_frame_received(uvc_stream);
+        if (uvc_stream->constant.frame_cb) {
+            uvc_stats_frame_delivered(uvc_stream);
+            // Call the user's frame callback. If the callback returns false,
+            // we do not return the frame to the empty ring (i.e., the user wants to keep it for processing)
+            return_frame = uvc_stream->constant.frame_cb(this_frame, uvc_stream->constant.cb_arg);
+        } else {
+            // No frame callback: the user pulls the frame from the ring of filled frames
+            return_frame = !uvc_frame_put_filled(uvc_stream, this_frame);
+        }
+    }
+    if (return_frame && this_frame) {
+        // If the user has processed the frame (or the stream is stopped), return it to the empty frame ring
+        uvc_host_frame_return(uvc_stream, this_frame);
+    }
+}
+
+/**
+ * @brief Start new frame
+ *
+ * @param[in] uvc_stream     UVC stream
+ * @param[in] payload_header Payload header with new Frame ID
+ * @param[in] data_len       Length of frame data that follow the header in this transfer
+ */
+static void uvc_bulk_frame_start(uvc_stream_t *uvc_stream, const uvc_payload_header_t *payload_header, size_t data_len)
+{
+    // We detected start of new frame. Update Frame ID and start fetching this frame
+    // Error flag of the header is checked by the caller
+    uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
+    uvc_stream->single_thread.skip_current_frame = false;
+
+    // Get free frame buffer for this new frame
+    if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+        return;
+    }
+
+    // Method 2 still image is sent between video frames and is received into the still frame buffer
+    if (payload_header->bmHeaderInfo.still_image) {
+        uvc_host_frame_t *still_frame = uvc_still_frame_start(uvc_stream);
+        if (still_frame == NULL || !uvc_frame_set_current(uvc_stream, still_frame)) {
+            // Still image was not requested by uvc_host_stream_still_capture(), or the stream was paused
+            uvc_stream->single_thread.skip_current_frame = true;
+        }
+        return;
+    }
+    if (uvc_frame_decimate(uvc_stream)) {
+        // Frame is skipped by frame decimation, its payloads are not copied
+        uvc_stream->single_thread.skip_current_frame = true;
+        return;
+    }
+    uvc_host_frame_t *new_frame = uvc_frame_get_empty(uvc_stream);
+    if (new_frame == NULL) {
+        // There is no free frame buffer now, skipping this frame
+        uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_UNDERFLOW);
+
+        // Inform the user about the underflow
+        uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
+        if (stream_cb) {
+            const uvc_host_stream_event_data_t event = {
+                .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
+            };
+            stream_cb(&event, uvc_stream->constant.cb_arg);
+        }
+        return;
+    }
+
+    // Zero-copy: Shift start of the frame data, so the end of this payload is aligned for the following transfers
+    if (uvc_stream->constant.bulk_zero_copy) {
+        new_frame->data = ((uvc_frame_t *)new_frame)->data_base + (UVC_FRAME_ALIGN - data_len % UVC_FRAME_ALIGN) % UVC_FRAME_ALIGN;
+    }
+    if (!uvc_frame_set_current(uvc_stream, new_frame)) {
+        // The stream was paused in the meantime
+        uvc_stream->single_thread.skip_current_frame = true;
+    }
+}
+
+/**
+ * @brief Add received data to the current frame
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] data       Frame data
+ * @param[in] data_len   Length of frame data
+ */
+static void uvc_bulk_frame_add_data(uvc_stream_t *uvc_stream, const uint8_t *data, size_t data_len)
+{
+    if (uvc_stream->single_thread.skip_current_frame || data_len == 0) {
+        return;
+    }
+    uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+    const size_t offset = current_frame->data_len;
+    esp_err_t ret = uvc_frame_add_data(current_frame, data, data_len);
+    if (ret == ESP_OK) {
+        uvc_frame_data_added(uvc_stream, current_frame, offset);
+    } else {
+        // Frame buffer overflow
+        uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_OVERFLOW);
+
+        // Inform the user about the overflow
+        uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
+        if (stream_cb) {
+            const uvc_host_stream_event_data_t event = {
+                .type = UVC_HOST_FRAME_BUFFER_OVERFLOW,
+            };
+            stream_cb(&event, uvc_stream->constant.cb_arg);
+        }
+    }
+}
+
+/**
+ * @brief Process payload header at start of payload transfer
+ *
+ * Frame boundaries are given by Frame ID toggle: a new frame is started every time the Frame ID changes.
+ * If the EoF header of the previous frame was missed, the previous frame is delivered now.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] payload    Start of payload transfer
+ * @param[in] len        Length of the payload transfer in this USB transfer
+ * @return Length of the payload header, 0 if the header is not valid
+ */
+static size_t uvc_bulk_header_process(uvc_stream_t *uvc_stream, const uint8_t *payload, size_t len)
+{
+    const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
+    if (len < 2 || payload_header->bHeaderLength < 2 || payload_header->bHeaderLength > len) {
+        return 0;
+    }
+
+    if (payload_header->bmHeaderInfo.frame_id != uvc_stream->single_thread.current_frame_id) {
+        uvc_bulk_frame_end(uvc_stream);
+        uvc_bulk_frame_start(uvc_stream, payload_header, len - payload_header->bHeaderLength);
+    }
+    if (payload_header->bmHeaderInfo.error) {
+        uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_ERROR);
+    }
+    if (!uvc_stream->single_thread.skip_current_frame) {
+        uvc_frame_time_header(uvc_stream, UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame), payload, len);
+    }
+
+    // The frame ends with this payload transfer, including its data after the header
+    uvc_stream->single_thread.bulk_frame_end = payload_header->bmHeaderInfo.end_of_frame;
+    return payload_header->bHeaderLength;
+}
+
+/**
+ * @brief End of payload transfer: Next packet starts with payload header
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void uvc_bulk_payload_end(uvc_stream_t *uvc_stream)
+{
+    uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_HEADER;
+    uvc_stream->single_thread.bulk_payload_len = 0;
+    if (uvc_stream->single_thread.bulk_frame_end) {
+        uvc_stream->single_thread.bulk_frame_end = false;
+        uvc_bulk_frame_end(uvc_stream);
+    }
+}
+
 /**
  * @brief Callback function for handling Bulk USB transfers from a UVC camera.
  *
@@ -25,24 +295,32 @@ static const char *TAG = "uvc-bulk";
  *
  * - **CRC Included**: Ensures no errors in frame data.
  * - **ACK Mechanism**: Missed packets are retransmitted, ensuring reliable data delivery.
- * - **Packet Headers**: Not all packets contain headers; the end of a transfer is indicated by a short packet
- *   (less than the maximum packet size), and the next packet usually contains a header.
+ * - **Payload transfers**: Frame data are split into payload transfers, each starting with a payload header.
+ *   A payload transfer ends with a short packet or when it reaches dwMaxPayloadTransferSize from the committed format.
+ *   One USB transfer can thus contain end of one payload transfer and start of the next one.
  *
  * To process these packets, a state machine is implemented to track the next expected Bulk packet type:
- * - Start of Frame (SoF), usually followed by data packets in the same transfer
- * - Data packets (no header)
- * - End of Frame (EoF)
+ * - Payload header: Frame ID toggle starts a new frame, EoF flag marks the last payload transfer of the frame.
+ *   PTS and SCR are saved to the frame buffer
+ * - Payload data (no header)
+ *
+ * The frame is delivered at the end of its last payload transfer, or at Frame ID toggle if the EoF flag was missed.
  *
  * The function handles USB transfer statuses, manages frame buffers, and invokes user-defined callbacks for
  * completed frames.
  *
+ * In zero-copy mode, the transfers receive frame data directly into the frame buffer, see uvc_bulk_landing_set().
+ *
  * @param[in] transfer Pointer to the completed USB transfer structure.
+ * @return true if the transfer can be resubmitted, false if the streaming was turned off
  */
-void bulk_transfer_callback(usb_transfer_t *transfer)
+bool bulk_transfer_process(usb_transfer_t *transfer)
 {
-    ESP_LOGD(TAG, "%s", __FUNCTION__);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
 
+    // Zero-copy: frame buffer that received data of this transfer
+    uvc_host_frame_t *landed_frame = uvc_bulk_landing_take(uvc_stream, transfer);
+
     // Check USB transfer status
     switch (transfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED:
@@ -63,127 +341,88 @@ void bulk_transfer_callback(usb_transfer_t *transfer)
     }
 
     if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
-        return; // If the streaming was turned off, we don't have to do anything
+        uvc_frame_landing_release(uvc_stream, landed_frame);
+        return false; // If the streaming was turned off, we don't have to do anything
     }
+    uvc_stats_transfer(uvc_stream, transfer);
+    uvc_stream->single_thread.xfer_receive_us = esp_timer_get_time();
 
-    // In BULK implementation, 'payload' is a constant pointer to constant data,
-    // meaning both the pointer and the data it points to cannot be changed.
-    // This contrasts with the ISOC implementation, where 'payload' is a variable
-    // pointer and is increased after every ISOC packet processing
-    const uint8_t *const payload = transfer->data_buffer;
-    const uint8_t *payload_data  = payload;
-    size_t payload_data_len      = transfer->actual_num_bytes;
+    const uint8_t *payload = transfer->data_buffer;
+    size_t remaining_len   = transfer->actual_num_bytes;
+    size_t max_payload_len = uvc_stream->single_thread.bulk_max_payload_len;
 
     // Note for developers:
-    // The order of SoF, Data, and EoF handling is intentional and represents a workaround for detecting EoF in the Bulk stream.
-    // Normally, a complete Sample transfer includes two short packets: one marking the last data packet and another with the EoF header.
-    // However, if the last data packet has a size equal to the Maximum Packet Size (MPS), there is no zero-length packet between the data and the EoF header.
-    // Consequently, it becomes impossible to distinguish between the last data packet and the EoF header.
-    // To address this, the hack discards all frames whose last data packet has the MPS size.
-    switch (uvc_stream->single_thread.next_bulk_packet) {
-    case UVC_STREAM_BULK_PACKET_EOF: {
-        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
-        uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
-
-        if (payload_header->bmHeaderInfo.end_of_frame) {
-            assert(payload_header->bmHeaderInfo.frame_id == uvc_stream->single_thread.current_frame_id);
-            if (payload_header->bmHeaderInfo.error) {
-                uvc_stream->single_thread.skip_current_frame = true;
-            }
-
-            // Get the current frame being processed and clear it from the stream,
-            // so no more data is written to this frame after the end of frame
-            UVC_ENTER_CRITICAL(); // Enter critical section to safely check and modify the stream state.
-            uvc_host_frame_t *this_frame = uvc_stream->dynamic.current_frame;
-            uvc_stream->dynamic.current_frame = NULL;
-
-            // Determine if we should invoke the frame callback:
-            // Only invoke the callback if streaming is active, a frame callback exists,
-            // and we have a valid frame to pass to the user.
-            const bool invoke_fb_callback = (uvc_stream->dynamic.streaming && uvc_stream->constant.frame_cb && this_frame && !uvc_stream->single_thread.skip_current_frame);
-            UVC_EXIT_CRITICAL();
-
-            bool return_frame = true; // Default to returning the frame in case streaming has been stopped
-            if (invoke_fb_callback) {
-                // Call the user's frame callback. If the callback returns false,
-                // we do not return the frame to the empty queue (i.e., the user wants to keep it for processing)
-                return_frame = uvc_stream->constant.frame_cb(this_frame, uvc_stream->constant.cb_arg);
-            }
-            if (return_frame) {
-                // If the user has processed the frame (or the stream is stopped), return it to the empty frame queue
-                uvc_host_frame_return(uvc_stream, this_frame);
-            }
-            break;
+    // A payload transfer that reaches dwMaxPayloadTransferSize ends without short packet.
+    // Here, its last data packet can have the Maximum Packet Size (MPS) and the next payload header follows without any zero-length packet.
+    // So we count received bytes of each payload transfer to find the next payload header, even within one USB transfer.
+    while (remaining_len > 0) {
+        size_t chunk_len = remaining_len;
+        if (max_payload_len > 0 && chunk_len > max_payload_len - uvc_stream->single_thread.bulk_payload_len) {
+            chunk_len = max_payload_len - uvc_stream->single_thread.bulk_payload_len;
         }
 
-        __attribute__((fallthrough));  // Fall through! This is not EoF but SoF!
-    }
-    case UVC_STREAM_BULK_PACKET_SOF: {
-        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
-
-        // We detected start of new frame. Update Frame ID and start fetching this frame
-        uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
-        uvc_stream->single_thread.skip_current_frame = payload_header->bmHeaderInfo.error; // Check for error flag
-
-        // Get free frame buffer for this new frame
-        UVC_ENTER_CRITICAL();
-        const bool need_new_frame = (uvc_stream->dynamic.streaming && !uvc_stream->dynamic.current_frame);
-        if (need_new_frame) {
-            UVC_EXIT_CRITICAL();
-            uvc_stream->dynamic.current_frame = uvc_frame_get_empty(uvc_stream);
-            if (uvc_stream->dynamic.current_frame == NULL) {
-                // There is no free frame buffer now, skipping this frame
-                uvc_stream->single_thread.skip_current_frame = true;
-
-                // Inform the user about the underflow
-                uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
-                if (stream_cb) {
-                    const uvc_host_stream_event_data_t event = {
-                        .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
-                    };
-                    stream_cb(&event, uvc_stream->constant.cb_arg);
+        const uint8_t *payload_data = payload;
+        size_t payload_data_len     = chunk_len;
+        if (uvc_stream->single_thread.next_bulk_packet == UVC_STREAM_BULK_PACKET_HEADER) {
+            const size_t header_len = uvc_bulk_header_process(uvc_stream, payload, chunk_len);
+            if (header_len == 0) {
+                // Invalid header, discard the frame and the rest of this payload transfer
+                uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_ERROR);
+                if (max_payload_len > 0) {
+                    // The device does not respect dwMaxPayloadTransferSize, rely on short packets only
+                    ESP_LOGW(TAG, "Invalid payload header, ignoring dwMaxPayloadTransferSize");
+                    uvc_stream->single_thread.bulk_max_payload_len = 0;
+                    max_payload_len = 0;
                 }
             }
-        } else {
-            // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer
-            uvc_frame_reset(uvc_stream->dynamic.current_frame);
-            UVC_EXIT_CRITICAL();
+            payload_data     += header_len; // Pointer arithmetic!
+            payload_data_len -= header_len;
+            uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_DATA;
         }
 
-        payload_data     += payload_header->bHeaderLength; // Pointer arithmetic!
-        payload_data_len -= payload_header->bHeaderLength;
-        uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_DATA;
-        __attribute__((fallthrough));  // Fall through! There can be data after SoF!
-    }
-    case UVC_STREAM_BULK_PACKET_DATA: {
-        // We got short packet in data section, next packet is EoF
-        if (transfer->data_buffer_size > transfer->actual_num_bytes) {
-            uvc_stream->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_EOF;
-        }
         // Add received data to frame buffer
-        if (!uvc_stream->single_thread.skip_current_frame) {
-            uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
-            esp_err_t ret = uvc_frame_add_data(current_frame, payload_data, payload_data_len);
-            if (ret != ESP_OK) {
-                // Frame buffer overflow
-                uvc_stream->single_thread.skip_current_frame = true;
-
-                // Inform the user about the overflow
-                uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
-                if (stream_cb) {
-                    const uvc_host_stream_event_data_t event = {
-                        .type = UVC_HOST_FRAME_BUFFER_OVERFLOW,
-                    };
-                    stream_cb(&event, uvc_stream->constant.cb_arg);
-                }
-            }
+        uvc_bulk_frame_add_data(uvc_stream, payload_data, payload_data_len);
+
+        payload       += chunk_len;
+        remaining_len -= chunk_len;
+        uvc_stream->single_thread.bulk_payload_len += chunk_len;
+        if (max_payload_len > 0 && uvc_stream->single_thread.bulk_payload_len >= max_payload_len) {
+            // The payload transfer reached its maximum size
+            uvc_bulk_payload_end(uvc_stream);
         }
-        break;
     }
-    default: abort();
+
+    // We got short packet, the payload transfer ends here. This includes zero-length packet
+    if (transfer->actual_num_bytes < transfer->num_bytes &&
+            uvc_stream->single_thread.next_bulk_packet == UVC_STREAM_BULK_PACKET_DATA) {
+        uvc_bulk_payload_end(uvc_stream);
+    }
+
+    // The received data were processed, the frame buffer can be reused
+    uvc_frame_landing_release(uvc_stream, landed_frame);
+
+    return UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+}
+
+/**
+ * @brief Bulk transfer callback
+ *
+ * The transfer is processed right here, in USB Host client context, or it is deferred to the stream's processing task.
+ *
+ * @param[in] transfer Pointer to the completed USB transfer structure.
+ */
+void bulk_transfer_callback(usb_transfer_t *transfer)
+{
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
+    UVC_TRACE_COMPLETE(transfer);
+    if (uvc_stream->constant.processing_task) {
+        uvc_processing_defer(uvc_stream, transfer);
+        return;
     }
 
-    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+    if (bulk_transfer_process(transfer)) {
+        uvc_bulk_landing_set(uvc_stream, transfer);
+        UVC_TRACE_SUBMIT(transfer);
         usb_host_transfer_submit(transfer); // Restart the transfer
     }
 }
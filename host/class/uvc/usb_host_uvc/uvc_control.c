@@ -5,6 +5,7 @@
  */
 // This file will contain all Class-Specific request from USB UVC specification chapter 4
 
+#include <stdlib.h> // For calloc
 #include <string.h> // For memset
 #include <math.h>   // fabsf for float comparison
 
@@ -16,9 +17,12 @@
 #include "uvc_types_priv.h"
 #include "uvc_descriptors_priv.h"
 #include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
 
 #define FLOAT_EQUAL(a, b) (fabsf(a - b) < 0.0001f) // For comparing float values with acceptable difference (epsilon value)
 
+#define UVC_CONTROL_LOCK_TIMEOUT pdMS_TO_TICKS(5000) // Same as timeout of one CTRL transfer
+
 static const char *TAG = "uvc-control";
 
 static uint16_t uvc_vs_control_size(uint16_t uvc_version)
@@ -37,8 +41,7 @@ static esp_err_t uvc_host_stream_control(uvc_host_stream_hdl_t stream_hdl, uvc_v
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
     uint8_t bmRequestType, bRequest;
     uint16_t wValue, wIndex, wLength;
-    const usb_config_desc_t *cfg_desc;
-    ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(uvc_stream->constant.dev_hdl, &cfg_desc));
+    const uvc_desc_index_t *desc_index = uvc_stream->constant.desc_cache->index;
     esp_err_t ret = ESP_OK;
     const bool set = (req_code == UVC_SET_CUR) ? true : false;
 
@@ -56,13 +59,19 @@ static esp_err_t uvc_host_stream_control(uvc_host_stream_hdl_t stream_hdl, uvc_v
         const uvc_frame_desc_t *frame_desc;
 
         ESP_RETURN_ON_ERROR(
-            uvc_desc_get_frame_format_by_format(cfg_desc, uvc_stream->constant.bInterfaceNumber, vs_format, &format_desc, &frame_desc),
+            uvc_desc_index_get_frame_format_by_format(desc_index, uvc_stream->constant.bInterfaceNumber, vs_format, &format_desc, &frame_desc),
             TAG, "Could not find format that matches required format");
         UVC_CHECK(format_desc && frame_desc, ESP_ERR_NOT_FOUND);
 
         vs_control->bFormatIndex    = format_desc->bFormatIndex;
         vs_control->bFrameIndex     = frame_desc->bFrameIndex;
 
+        // Frame-based formats have variable frame size. Request framing by Frame ID and End of Frame in payload headers
+        // bmFramingInfo is sent only by UVC 1.1 and newer, older devices always toggle the Frame ID
+        if (format_desc->bDescriptorSubType == UVC_VS_DESC_SUBTYPE_FORMAT_FRAME_BASED) {
+            vs_control->bmFramingInfo = UVC_VS_FRAMING_INFO_FID_REQUIRED | UVC_VS_FRAMING_INFO_EOF_PRESENT;
+        }
+
         // Load default FPS value in case requested FPS is 0
         if (vs_format->fps == 0) {
             switch (frame_desc->bDescriptorSubType) {
@@ -92,7 +101,7 @@ static esp_err_t uvc_host_stream_control(uvc_host_stream_hdl_t stream_hdl, uvc_v
         const uvc_format_desc_t *format_desc = NULL;
         const uvc_frame_desc_t *frame_desc = NULL;
         ESP_RETURN_ON_ERROR(
-            uvc_desc_get_frame_format_by_index(cfg_desc, uvc_stream->constant.bInterfaceNumber, vs_control->bFormatIndex, vs_control->bFrameIndex, &format_desc, &frame_desc),
+            uvc_desc_index_get_frame_format_by_index(desc_index, uvc_stream->constant.bInterfaceNumber, vs_control->bFormatIndex, vs_control->bFrameIndex, &format_desc, &frame_desc),
             TAG, "Could not find requested frame format");
 
         vs_format->format = uvc_desc_parse_format(format_desc);
@@ -128,6 +137,27 @@ static inline esp_err_t uvc_control_commit(uvc_host_stream_hdl_t stream_hdl, uvc
     return uvc_host_stream_control(stream_hdl, vs_control, (uvc_host_stream_format_t *)vs_format, UVC_SET_CUR, true);
 }
 
+/**
+ * @brief Save parameters of committed format that are needed while streaming
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] vs_control Committed Video Stream control
+ */
+static void uvc_control_committed(uvc_stream_t *uvc_stream, const uvc_vs_ctrl_t *vs_control)
+{
+    // dwClockFrequency is part of Video Stream control since UVC 1.1, older devices report it in Video Control header only
+    uint32_t clock_frequency = uvc_stream->constant.vc_clock_frequency;
+    if (uvc_stream->constant.bcdUVC >= UVC_VERSION_1_1 && vs_control->dwClockFrequency != 0) {
+        clock_frequency = vs_control->dwClockFrequency;
+    }
+
+    // Bulk streams detect end of payload transfers that has the maximum size from dwMaxPayloadTransferSize
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.dwMaxPayloadTransferSize = vs_control->dwMaxPayloadTransferSize;
+    uvc_stream->dynamic.dwClockFrequency = clock_frequency;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
 static inline bool uvc_is_vs_format_equal(const uvc_host_stream_format_t *a, const uvc_host_stream_format_t *b)
 {
     if (a->h_res == b->h_res &&
@@ -204,5 +234,218 @@ esp_err_t uvc_host_stream_control_commit(uvc_host_stream_hdl_t stream_hdl, const
              vs_format->h_res, vs_format->v_res, vs_format->fps, format_set.h_res, format_set.v_res, format_set.fps);
 
     // Commit the negotiated format
-    return uvc_control_commit(stream_hdl, &vs_result, vs_format);
+    ret = uvc_control_commit(stream_hdl, &vs_result, vs_format);
+    if (ret == ESP_OK) {
+        uvc_control_committed(stream_hdl, &vs_result);
+    }
+    return ret;
+}
+
+esp_err_t uvc_host_stream_control_commit_prepared(uvc_host_stream_hdl_t stream_hdl, uvc_vs_ctrl_t *vs_control, const uvc_host_stream_format_t *vs_format)
+{
+    UVC_CHECK(stream_hdl && vs_control && vs_format, ESP_ERR_INVALID_ARG);
+
+    // The camera already accepted this format in PROBE, commit it without new negotiation
+    esp_err_t ret = uvc_control_commit(stream_hdl, vs_control, vs_format);
+    if (ret == ESP_OK) {
+        uvc_control_committed(stream_hdl, vs_control);
+    }
+    return ret;
+}
+
+/**
+ * @brief Issue request to Still Image control of the streaming interface
+ *
+ * @param[in]    stream_hdl UVC stream
+ * @param[in]    selector   Control selector: Still Probe, Still Commit or Still Image Trigger
+ * @param[in]    req_code   UVC request code
+ * @param[in]    wLength    Length of the control
+ * @param[inout] data       Data of the control
+ * @return ESP_OK on success, else USB Control transfer error
+ */
+static esp_err_t uvc_control_still(uvc_host_stream_hdl_t stream_hdl, enum uvc_vs_ctrl_selector selector, enum uvc_req_code req_code, uint16_t wLength, uint8_t *data)
+{
+    const bool set = (req_code == UVC_SET_CUR);
+    uint8_t bmRequestType = USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    bmRequestType |= set ? USB_BM_REQUEST_TYPE_DIR_OUT : USB_BM_REQUEST_TYPE_DIR_IN;
+    return uvc_host_usb_ctrl(stream_hdl, bmRequestType, (uint8_t)req_code, selector << 8, stream_hdl->constant.bInterfaceNumber, wLength, data);
+}
+
+esp_err_t uvc_host_stream_control_still_commit(uvc_host_stream_hdl_t stream_hdl, uvc_still_ctrl_t *still_control)
+{
+    UVC_CHECK(stream_hdl && still_control, ESP_ERR_INVALID_ARG);
+
+    // Still image negotiation follows the video one, but the device only fills in the sizes
+    // @see USB UVC specification ver 1.5, chapter 4.3.1.2
+    const uint16_t wLength = sizeof(uvc_still_ctrl_t);
+    uvc_still_ctrl_t still_result = *still_control;
+    ESP_RETURN_ON_ERROR(
+        uvc_control_still(stream_hdl, UVC_VS_STILL_PROBE_CONTROL, UVC_SET_CUR, wLength, (uint8_t *)&still_result),
+        TAG, "Still probe failed");
+    ESP_RETURN_ON_ERROR(
+        uvc_control_still(stream_hdl, UVC_VS_STILL_PROBE_CONTROL, UVC_GET_CUR, wLength, (uint8_t *)&still_result),
+        TAG, "Still probe failed");
+    UVC_CHECK(still_result.bFormatIndex == still_control->bFormatIndex && still_result.bFrameIndex == still_control->bFrameIndex, ESP_ERR_NOT_SUPPORTED);
+    ESP_RETURN_ON_ERROR(
+        uvc_control_still(stream_hdl, UVC_VS_STILL_COMMIT_CONTROL, UVC_SET_CUR, wLength, (uint8_t *)&still_result),
+        TAG, "Still commit failed");
+
+    ESP_LOGD(TAG, "Still image negotiation: format %d, size %d: dwMaxVideoFrameSize %"PRIu32", dwMaxPayloadTransferSize %"PRIu32,
+             still_result.bFormatIndex, still_result.bFrameIndex, still_result.dwMaxVideoFrameSize, still_result.dwMaxPayloadTransferSize);
+    *still_control = still_result;
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_stream_control_still_trigger(uvc_host_stream_hdl_t stream_hdl, enum uvc_still_trigger trigger)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    uint8_t bTrigger = (uint8_t)trigger;
+    return uvc_control_still(stream_hdl, UVC_VS_STILL_IMAGE_TRIGGER_CONTROL, UVC_SET_CUR, sizeof(bTrigger), &bTrigger);
+}
+
+esp_err_t uvc_host_stream_entity_id_get(uvc_host_stream_hdl_t stream_hdl, enum uvc_host_entity entity, uint8_t *entity_id_ret)
+{
+    UVC_CHECK(stream_hdl && entity_id_ret, ESP_ERR_INVALID_ARG);
+    const uvc_desc_index_t *desc_index = stream_hdl->constant.desc_cache->index;
+    switch (entity) {
+    case UVC_HOST_ENTITY_CAMERA_TERMINAL:
+        return uvc_desc_index_get_entity_id(desc_index, stream_hdl->constant.uvc_index, UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL, UVC_ITT_CAMERA, entity_id_ret);
+    case UVC_HOST_ENTITY_PROCESSING_UNIT:
+        return uvc_desc_index_get_entity_id(desc_index, stream_hdl->constant.uvc_index, UVC_VC_DESC_SUBTYPE_PROCESSING_UNIT, 0, entity_id_ret);
+    default:
+        return ESP_ERR_INVALID_ARG;
+    }
+}
+
+/**
+ * @brief Issue request to camera control of Video Control interface
+ *
+ * @param[in]    stream_hdl UVC stream
+ * @param[in]    entity_id  ID of Unit or Terminal
+ * @param[in]    selector   Control selector
+ * @param[in]    req_code   UVC request code
+ * @param[in]    len        Length of the control, 1 to 4 bytes. GET_INFO is always 1 byte long
+ * @param[inout] value      Value of the control
+ * @return ESP_OK on success, else USB Control transfer error
+ */
+static esp_err_t uvc_control_camera(uvc_host_stream_hdl_t stream_hdl, uint8_t entity_id, uint8_t selector, enum uvc_req_code req_code, uint8_t len, uint32_t *value)
+{
+    const bool set = (req_code == UVC_SET_CUR);
+    const uint16_t wLength = (req_code == UVC_GET_INFO) ? 1 : len;
+    uint8_t bmRequestType = USB_BM_REQUEST_TYPE_TYPE_CLASS | USB_BM_REQUEST_TYPE_RECIP_INTERFACE;
+    bmRequestType |= set ? USB_BM_REQUEST_TYPE_DIR_OUT : USB_BM_REQUEST_TYPE_DIR_IN;
+
+    // Controls are little-endian, see USB UVC specification ver 1.5, chapter 4.2.2
+    uint8_t data[4] = {0};
+    for (unsigned i = 0; set && i < wLength; i++) {
+        data[i] = (*value >> (8 * i)) & 0xFF;
+    }
+    ESP_RETURN_ON_ERROR(
+        uvc_host_usb_ctrl(stream_hdl, bmRequestType, (uint8_t)req_code, selector << 8, (entity_id << 8) | stream_hdl->constant.bControlInterfaceNumber, wLength, data),
+        TAG, "Control 0x%02X of entity %d failed", selector, entity_id);
+    if (!set) {
+        *value = 0;
+        for (unsigned i = 0; i < wLength; i++) {
+            *value |= (uint32_t)data[i] << (8 * i);
+        }
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Find cached range of camera control
+ *
+ * @note Must be called with CTRL transfers locked
+ * @return Cached range, NULL if the range was not read yet
+ */
+static const uvc_control_cache_t *uvc_control_cache_find(uvc_host_stream_hdl_t stream_hdl, uint8_t entity_id, uint8_t selector, uint8_t len)
+{
+    uvc_control_cache_t *cached;
+    SLIST_FOREACH(cached, &stream_hdl->constant.control_cache, list_entry) {
+        if (cached->entity_id == entity_id && cached->selector == selector && cached->len == len) {
+            return cached;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t uvc_host_stream_control_range_get(uvc_host_stream_hdl_t stream_hdl, uint8_t entity_id, uint8_t selector, uint8_t len, uvc_host_control_range_t *range)
+{
+    UVC_CHECK(stream_hdl && range && len >= 1 && len <= 4, ESP_ERR_INVALID_ARG);
+    ESP_RETURN_ON_ERROR(uvc_host_usb_ctrl_lock(UVC_CONTROL_LOCK_TIMEOUT), TAG,);
+
+    esp_err_t ret = ESP_OK;
+    const uvc_control_cache_t *cached = uvc_control_cache_find(stream_hdl, entity_id, selector, len);
+    if (cached) {
+        *range = cached->range;
+        goto unlock;
+    }
+
+    // All range requests are issued under one lock, so other CTRL transfers do not interleave with them
+    uvc_control_cache_t *new_entry = calloc(1, sizeof(uvc_control_cache_t));
+    ESP_GOTO_ON_FALSE(new_entry, ESP_ERR_NO_MEM, unlock, TAG,);
+    uint32_t info;
+    ESP_GOTO_ON_ERROR(uvc_control_camera(stream_hdl, entity_id, selector, UVC_GET_INFO, len, &info), fail, TAG,);
+    ESP_GOTO_ON_ERROR(uvc_control_camera(stream_hdl, entity_id, selector, UVC_GET_MIN, len, &new_entry->range.min), fail, TAG,);
+    ESP_GOTO_ON_ERROR(uvc_control_camera(stream_hdl, entity_id, selector, UVC_GET_MAX, len, &new_entry->range.max), fail, TAG,);
+    ESP_GOTO_ON_ERROR(uvc_control_camera(stream_hdl, entity_id, selector, UVC_GET_RES, len, &new_entry->range.res), fail, TAG,);
+    ESP_GOTO_ON_ERROR(uvc_control_camera(stream_hdl, entity_id, selector, UVC_GET_DEF, len, &new_entry->range.def), fail, TAG,);
+    new_entry->range.info = (uint8_t)info;
+    new_entry->entity_id = entity_id;
+    new_entry->selector = selector;
+    new_entry->len = len;
+    SLIST_INSERT_HEAD(&stream_hdl->constant.control_cache, new_entry, list_entry);
+    *range = new_entry->range;
+    goto unlock;
+
+fail:
+    free(new_entry);
+unlock:
+    uvc_host_usb_ctrl_unlock();
+    return ret;
+}
+
+esp_err_t uvc_host_stream_control_get(uvc_host_stream_hdl_t stream_hdl, uvc_host_control_t *control)
+{
+    UVC_CHECK(stream_hdl && control && control->len >= 1 && control->len <= 4, ESP_ERR_INVALID_ARG);
+    return uvc_control_camera(stream_hdl, control->entity_id, control->selector, UVC_GET_CUR, control->len, &control->value);
+}
+
+esp_err_t uvc_host_stream_controls_set(uvc_host_stream_hdl_t stream_hdl, const uvc_host_control_t *controls, size_t num_of_controls)
+{
+    UVC_CHECK(stream_hdl && controls, ESP_ERR_INVALID_ARG);
+    ESP_RETURN_ON_ERROR(uvc_host_usb_ctrl_lock(UVC_CONTROL_LOCK_TIMEOUT), TAG,);
+
+    // Check the whole batch first, so an invalid profile is not applied partially
+    esp_err_t ret = ESP_OK;
+    for (size_t i = 0; i < num_of_controls; i++) {
+        const uvc_host_control_t *control = &controls[i];
+        ESP_GOTO_ON_FALSE(control->len >= 1 && control->len <= 4, ESP_ERR_INVALID_ARG, unlock, TAG, "Control %zu: invalid length %d", i, control->len);
+        const uvc_control_cache_t *cached = uvc_control_cache_find(stream_hdl, control->entity_id, control->selector, control->len);
+        if (!cached) {
+            continue;
+        }
+        ESP_GOTO_ON_FALSE(cached->range.info & UVC_CONTROL_INFO_SUPPORTS_SET, ESP_ERR_NOT_SUPPORTED, unlock, TAG, "Control %zu: SET_CUR not supported", i);
+        ESP_GOTO_ON_FALSE(control->value >= cached->range.min && control->value <= cached->range.max, ESP_ERR_INVALID_ARG, unlock, TAG,
+                          "Control %zu: value %"PRIu32" out of range <%"PRIu32"; %"PRIu32">", i, control->value, cached->range.min, cached->range.max);
+    }
+
+    // SET_CUR requests back-to-back, without CTRL transfers of other tasks in between
+    for (size_t i = 0; i < num_of_controls; i++) {
+        uint32_t value = controls[i].value;
+        ESP_GOTO_ON_ERROR(uvc_control_camera(stream_hdl, controls[i].entity_id, controls[i].selector, UVC_SET_CUR, controls[i].len, &value), unlock, TAG,);
+    }
+
+unlock:
+    uvc_host_usb_ctrl_unlock();
+    return ret;
+}
+
+void uvc_host_stream_control_cache_free(uvc_host_stream_hdl_t stream_hdl)
+{
+    while (!SLIST_EMPTY(&stream_hdl->constant.control_cache)) {
+        uvc_control_cache_t *cached = SLIST_FIRST(&stream_hdl->constant.control_cache);
+        SLIST_REMOVE_HEAD(&stream_hdl->constant.control_cache, list_entry);
+        free(cached);
+    }
 }
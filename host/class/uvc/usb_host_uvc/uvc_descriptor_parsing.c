@@ -5,8 +5,10 @@
  */
 
 #include <inttypes.h>
+#include <stddef.h> // offsetof for still image size patterns
 #include <string.h> // strncmp for guid format parsing
 #include <math.h>   // fabsf for float comparison
+#include <stdlib.h> // calloc for descriptor index
 #include "usb/usb_helpers.h"
 #include "usb/uvc_host.h"
 #include "uvc_check_priv.h"
@@ -83,6 +85,114 @@ esp_err_t uvc_desc_get_streaming_intf_and_ep(
     return ret;
 }
 
+uint32_t uvc_desc_get_ep_bandwidth(const usb_ep_desc_t *ep_desc, bool high_speed)
+{
+    UVC_CHECK(ep_desc, 0);
+    if (USB_EP_DESC_GET_XFERTYPE(ep_desc) != USB_BM_ATTRIBUTES_XFER_ISOC) {
+        return 0; // Only ISOC endpoints reserve periodic bandwidth
+    }
+
+    // ISOC endpoint is serviced once per 2^(bInterval-1) (micro)frames, with up to 3 transactions per microframe on HS
+    const uint32_t payload = USB_EP_DESC_GET_MPS(ep_desc) * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+    const uint8_t bInterval = (ep_desc->bInterval < 1) ? 1 : ((ep_desc->bInterval > 16) ? 16 : ep_desc->bInterval);
+    const uint32_t interval = 1UL << (bInterval - 1);
+    const uint32_t per_ms = high_speed ? payload * 8 : payload; // 8 microframes or 1 frame per millisecond
+    return (per_ms + interval - 1) / interval;
+}
+
+/**
+ * @brief Selection of alternate setting by bandwidth
+ */
+typedef struct {
+    const usb_intf_desc_t *smallest_fit_intf; // Smallest endpoint that offers dwMaxPayloadTransferSize
+    const usb_ep_desc_t *smallest_fit_ep;
+    uint32_t smallest_fit_payload;
+    const usb_intf_desc_t *largest_intf;      // Largest endpoint, in case no endpoint offers dwMaxPayloadTransferSize
+    const usb_ep_desc_t *largest_ep;
+    uint32_t largest_payload;
+    bool too_large;                           // There is an endpoint that offers dwMaxPayloadTransferSize, but needs more bandwidth
+} uvc_desc_alt_selection_t;
+
+static void uvc_desc_alt_consider(uvc_desc_alt_selection_t *sel, const usb_intf_desc_t *intf_desc, const usb_ep_desc_t *ep_desc,
+                                  uint32_t dwMaxPayloadTransferSize, uint16_t max_mps, bool high_speed, uint32_t max_bandwidth)
+{
+    if (USB_EP_DESC_GET_MPS(ep_desc) > max_mps) {
+        return;
+    }
+
+    // Payload per service interval. Alternate settings are not guaranteed to be sorted, so we check all of them
+    const uint32_t payload = USB_EP_DESC_GET_MPS(ep_desc) * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+    const bool fits = (uvc_desc_get_ep_bandwidth(ep_desc, high_speed) <= max_bandwidth);
+    if (payload >= dwMaxPayloadTransferSize) {
+        if (!fits) {
+            sel->too_large = true;
+        } else if (payload < sel->smallest_fit_payload) {
+            sel->smallest_fit_payload = payload;
+            sel->smallest_fit_intf = intf_desc;
+            sel->smallest_fit_ep = ep_desc;
+        }
+    } else if (fits && payload >= sel->largest_payload) {
+        sel->largest_payload = payload;
+        sel->largest_intf = intf_desc;
+        sel->largest_ep = ep_desc;
+    }
+}
+
+static esp_err_t uvc_desc_alt_result(const uvc_desc_alt_selection_t *sel, const usb_intf_desc_t **intf_desc_ret, const usb_ep_desc_t **ep_desc_ret)
+{
+    if (sel->smallest_fit_ep) {
+        *intf_desc_ret = sel->smallest_fit_intf;
+        *ep_desc_ret = sel->smallest_fit_ep;
+        return ESP_OK;
+    }
+    if (sel->too_large) {
+        // The requested payload could be transferred, but not with the free bandwidth
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (sel->largest_ep) {
+        *intf_desc_ret = sel->largest_intf;
+        *ep_desc_ret = sel->largest_ep;
+        return ESP_OK;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t uvc_desc_get_streaming_intf_and_ep_by_bandwidth(
+    const usb_config_desc_t *cfg_desc,
+    uint8_t bInterfaceNumber,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    bool high_speed,
+    uint32_t max_bandwidth,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(cfg_desc && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
+
+    uvc_desc_alt_selection_t sel = {.smallest_fit_payload = UINT32_MAX};
+    int offset = 0;
+
+    const uint8_t num_of_alternate = usb_parse_interface_number_of_alternate(cfg_desc, bInterfaceNumber);
+    for (int i = 0; i <= num_of_alternate; i++) {
+        // Check Interface desc
+        const usb_intf_desc_t *intf_desc = usb_parse_interface_descriptor(cfg_desc, bInterfaceNumber, i, &offset);
+        UVC_CHECK(intf_desc, ESP_ERR_NOT_FOUND);
+        UVC_CHECK(intf_desc->bInterfaceClass == USB_CLASS_VIDEO, ESP_ERR_NOT_FOUND);
+        UVC_CHECK(intf_desc->bInterfaceSubClass == UVC_SC_VIDEOSTREAMING, ESP_ERR_NOT_FOUND);
+        if (intf_desc->bNumEndpoints == 0 && i == 0) {
+            continue; // This is Alternate setting 0 for ISOC cameras.
+        }
+        UVC_CHECK(intf_desc->bNumEndpoints == 1, ESP_ERR_NOT_FOUND); // Only 1 endpoint is expected
+
+        // Check EP desc
+        const usb_ep_desc_t *ep_desc = usb_parse_endpoint_descriptor_by_index(intf_desc, 0, cfg_desc->wTotalLength, &offset);
+        UVC_CHECK(ep_desc, ESP_ERR_NOT_FOUND);
+        uvc_desc_alt_consider(&sel, intf_desc, ep_desc, dwMaxPayloadTransferSize, max_mps, high_speed, max_bandwidth);
+    }
+
+    return uvc_desc_alt_result(&sel, intf_desc_ret, ep_desc_ret);
+}
+
 /**
  * @brief Check if this descriptor is Format descriptor
  *
@@ -401,6 +511,52 @@ bool uvc_desc_is_uvc_device(const usb_config_desc_t *cfg_desc)
     return false;
 }
 
+/**
+ * @brief Fill frame information from Frame descriptor
+ *
+ * @param[in]  format_type Format of the frame
+ * @param[in]  frame_desc  Frame descriptor
+ * @param[out] frame_info  Frame information
+ */
+static void uvc_desc_frame_info_fill(enum uvc_host_stream_format format_type, const uvc_frame_desc_t *frame_desc, uvc_host_frame_info_t *frame_info)
+{
+    frame_info->format = format_type;
+    frame_info->h_res = frame_desc->wWidth;
+    frame_info->v_res = frame_desc->wHeight;
+    switch (format_type) {
+    case UVC_VS_FORMAT_YUY2:
+    case UVC_VS_FORMAT_MJPEG:
+        frame_info->default_interval = frame_desc->mjpeg_uncompressed.dwDefaultFrameInterval;
+        frame_info->interval_type = frame_desc->mjpeg_uncompressed.bFrameIntervalType;
+        if (frame_info->interval_type == 0) {
+            frame_info->interval_min = frame_desc->mjpeg_uncompressed.dwMinFrameInterval;
+            frame_info->interval_max = frame_desc->mjpeg_uncompressed.dwMaxFrameInterval;
+            frame_info->interval_step = frame_desc->mjpeg_uncompressed.dwFrameIntervalStep;
+        } else {
+            for (int i = 0; i < CONFIG_UVC_INTERVAL_ARRAY_SIZE; i ++) {
+                frame_info->interval[i] = frame_desc->mjpeg_uncompressed.dwFrameInterval[i];
+            }
+        }
+        break;
+    case UVC_VS_FORMAT_H265:
+    case UVC_VS_FORMAT_H264:
+        frame_info->default_interval = frame_desc->frame_based.dwDefaultFrameInterval;
+        frame_info->interval_type = frame_desc->frame_based.bFrameIntervalType;
+        if (frame_info->interval_type == 0) {
+            frame_info->interval_min = frame_desc->frame_based.dwMinFrameInterval;
+            frame_info->interval_max = frame_desc->frame_based.dwMaxFrameInterval;
+            frame_info->interval_step = frame_desc->frame_based.dwFrameIntervalStep;
+        } else {
+            for (int i = 0; i < CONFIG_UVC_INTERVAL_ARRAY_SIZE; i ++) {
+                frame_info->interval[i] = frame_desc->frame_based.dwFrameInterval[i];
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
 esp_err_t uvc_desc_get_frame_list(const usb_config_desc_t *config_desc, uint8_t uvc_index, uvc_host_frame_info_t (*frame_info_list)[], size_t *list_size)
 {
     esp_err_t ret = ESP_OK;
@@ -448,51 +604,393 @@ esp_err_t uvc_desc_get_frame_list(const usb_config_desc_t *config_desc, uint8_t
             if (frame_index > *list_size - 1) {
                 break;
             }
-            uvc_host_frame_info_t *frame_info = &(*frame_info_list)[frame_index];
-            frame_info->format = format_type;
-            frame_info->h_res = this_frame->wWidth;
-            frame_info->v_res = this_frame->wHeight;
-            switch (format_type) {
-            case UVC_VS_FORMAT_YUY2:
-            case UVC_VS_FORMAT_MJPEG:
-                frame_info->default_interval = this_frame->mjpeg_uncompressed.dwDefaultFrameInterval;
-                frame_info->interval_type = this_frame->mjpeg_uncompressed.bFrameIntervalType;
-                if (frame_info->interval_type == 0) {
-                    frame_info->interval_min = this_frame->mjpeg_uncompressed.dwMinFrameInterval;
-                    frame_info->interval_max = this_frame->mjpeg_uncompressed.dwMaxFrameInterval;
-                    frame_info->interval_step = this_frame->mjpeg_uncompressed.dwFrameIntervalStep;
-                } else {
-                    for (int i = 0; i < CONFIG_UVC_INTERVAL_ARRAY_SIZE; i ++) {
-                        frame_info->interval[i] = this_frame->mjpeg_uncompressed.dwFrameInterval[i];
-                    }
+            uvc_desc_frame_info_fill(format_type, this_frame, &(*frame_info_list)[frame_index]);
+            frame_index++;
+        }
+
+        if (!current_desc) {
+            break;
+        }
+    }
+
+    *list_size = frame_info_list ? frame_index : num_frame;
+    return ret;
+}
+
+/**
+ * @brief Walk configuration descriptor and fill the index tables
+ *
+ * @param[in]    cfg_desc Configuration descriptor
+ * @param[inout] index    Index with allocated tables to fill. If the tables are NULL, only the number of entries is counted
+ */
+static void uvc_desc_index_walk(const usb_config_desc_t *cfg_desc, uvc_desc_index_t *index)
+{
+    const usb_intf_desc_t *streaming_intf = NULL; // Current Video Streaming interface, NULL outside of it
+    uint8_t last_intf_num = 0;                    // Number of the last interface, Video Control interface at its header
+    const uvc_format_desc_t *this_format = NULL;  // Current Format descriptor of the streaming interface
+    const uvc_vs_input_header_desc_t *input_header = NULL; // Input header of the current streaming interface
+    bool alt_indexed = false;                     // Endpoint of current alternate setting is already indexed
+    bool function_pending = false;                // Video IAD was found, its Video Control header follows
+    unsigned num_of_functions = 0, num_of_frames = 0, num_of_alts = 0, num_of_stills = 0;
+
+    int offset = 0;
+    const usb_standard_desc_t *current_desc = (const usb_standard_desc_t *)cfg_desc;
+    while ((current_desc = usb_parse_next_descriptor(current_desc, cfg_desc->wTotalLength, &offset))) {
+        switch (current_desc->bDescriptorType) {
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION: {
+            const usb_iad_desc_t *iad_desc = (const usb_iad_desc_t *)current_desc;
+            if (iad_desc->bFunctionClass == USB_CLASS_VIDEO && iad_desc->bFunctionSubClass == UVC_SC_VIDEO_INTERFACE_COLLECTION) {
+                if (function_pending && index->vc_headers) {
+                    index->vc_headers[num_of_functions] = NULL; // Previous function has no header
                 }
-                break;
-            case UVC_VS_FORMAT_H265:
-            case UVC_VS_FORMAT_H264:
-                frame_info->default_interval = this_frame->frame_based.dwDefaultFrameInterval;
-                frame_info->interval_type = this_frame->frame_based.bFrameIntervalType;
-                if (frame_info->interval_type == 0) {
-                    frame_info->interval_min = this_frame->frame_based.dwMinFrameInterval;
-                    frame_info->interval_max = this_frame->frame_based.dwMaxFrameInterval;
-                    frame_info->interval_step = this_frame->frame_based.dwFrameIntervalStep;
-                } else {
-                    for (int i = 0; i < CONFIG_UVC_INTERVAL_ARRAY_SIZE; i ++) {
-                        frame_info->interval[i] = this_frame->frame_based.dwFrameInterval[i];
-                    }
+                num_of_functions += function_pending ? 1 : 0;
+                function_pending = true;
+            }
+            break;
+        }
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE: {
+            const usb_intf_desc_t *intf_desc = (const usb_intf_desc_t *)current_desc;
+            last_intf_num = intf_desc->bInterfaceNumber;
+            const bool is_streaming = (intf_desc->bInterfaceClass == USB_CLASS_VIDEO && intf_desc->bInterfaceSubClass == UVC_SC_VIDEOSTREAMING);
+            if (is_streaming && (!streaming_intf || streaming_intf->bInterfaceNumber != intf_desc->bInterfaceNumber)) {
+                input_header = NULL; // Input header is in alternate setting 0 of each streaming interface
+            }
+            streaming_intf = is_streaming ? intf_desc : NULL;
+            this_format = NULL;
+            alt_indexed = false;
+            break;
+        }
+        case USB_B_DESCRIPTOR_TYPE_ENDPOINT: {
+            // Alternate settings with still image capture method 3 have a second, Bulk endpoint for still images
+            const usb_ep_desc_t *ep_desc = (const usb_ep_desc_t *)current_desc;
+            const bool is_video_ep = streaming_intf && (streaming_intf->bNumEndpoints == 1 ||
+                                                        (input_header && ep_desc->bEndpointAddress == input_header->bEndpointAddress));
+            if (is_video_ep && !alt_indexed) {
+                if (index->alts) {
+                    index->alts[num_of_alts].bInterfaceNumber = streaming_intf->bInterfaceNumber;
+                    index->alts[num_of_alts].intf_desc = streaming_intf;
+                    index->alts[num_of_alts].ep_desc = ep_desc;
                 }
+                num_of_alts++;
+                alt_indexed = true;
+            }
+            break;
+        }
+        case UVC_CS_INTERFACE:
+            if (function_pending) {
+                // First class specific descriptor after IAD is header of Video Control interface
+                const uvc_vc_header_desc_t *vc_header = (const uvc_vc_header_desc_t *)current_desc;
+                if (index->vc_headers) {
+                    index->vc_headers[num_of_functions] = (vc_header->bDescriptorSubType == UVC_VC_DESC_SUBTYPE_HEADER) ? vc_header : NULL;
+                    index->vc_interfaces[num_of_functions] = last_intf_num;
+                }
+                num_of_functions++;
+                function_pending = false;
                 break;
-            default:
+            }
+            if (!streaming_intf || streaming_intf->bAlternateSetting != 0) {
+                break; // Formats and Frames are described only in alternate setting 0 of streaming interface
+            }
+            if (((const uvc_format_desc_t *)current_desc)->bDescriptorSubType == UVC_VS_DESC_SUBTYPE_INPUT_HEADER) {
+                input_header = (const uvc_vs_input_header_desc_t *)current_desc;
+            } else if (uvc_desc_is_format_desc(current_desc)) {
+                this_format = (const uvc_format_desc_t *)current_desc;
+            } else if (((const uvc_format_desc_t *)current_desc)->bDescriptorSubType == UVC_VS_DESC_SUBTYPE_STILL_IMAGE_FRAME && this_format) {
+                // Still Image Frame descriptor follows the Frame descriptors of its format
+                if (index->stills) {
+                    index->stills[num_of_stills].bInterfaceNumber = streaming_intf->bInterfaceNumber;
+                    index->stills[num_of_stills].bStillCaptureMethod = input_header ? input_header->bStillCaptureMethod : 0;
+                    index->stills[num_of_stills].format_desc = this_format;
+                    index->stills[num_of_stills].still_desc = (const uvc_still_image_frame_desc_t *)current_desc;
+                }
+                num_of_stills++;
+            } else if (uvc_desc_is_frame_desc(current_desc) && this_format) {
+                if (index->frames) {
+                    index->frames[num_of_frames].bInterfaceNumber = streaming_intf->bInterfaceNumber;
+                    index->frames[num_of_frames].format = uvc_desc_parse_format(this_format);
+                    index->frames[num_of_frames].format_desc = this_format;
+                    index->frames[num_of_frames].frame_desc = (const uvc_frame_desc_t *)current_desc;
+                }
+                num_of_frames++;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (function_pending) {
+        if (index->vc_headers) {
+            index->vc_headers[num_of_functions] = NULL;
+        }
+        num_of_functions++;
+    }
+
+    index->num_of_functions = num_of_functions;
+    index->num_of_frames = num_of_frames;
+    index->num_of_alts = num_of_alts;
+    index->num_of_stills = num_of_stills;
+}
+
+esp_err_t uvc_desc_index_create(const usb_config_desc_t *cfg_desc, uvc_desc_index_t **index_ret)
+{
+    UVC_CHECK(cfg_desc && index_ret, ESP_ERR_INVALID_ARG);
+
+    // First walk counts the entries, so all tables can be allocated at once
+    uvc_desc_index_t counts = {0};
+    uvc_desc_index_walk(cfg_desc, &counts);
+
+    const size_t size = sizeof(uvc_desc_index_t) +
+                        counts.num_of_functions * sizeof(const uvc_vc_header_desc_t *) +
+                        counts.num_of_frames * sizeof(uvc_desc_index_frame_t) +
+                        counts.num_of_alts * sizeof(uvc_desc_index_alt_t) +
+                        counts.num_of_stills * sizeof(uvc_desc_index_still_t) +
+                        counts.num_of_functions * sizeof(uint8_t);
+    uvc_desc_index_t *index = calloc(1, size);
+    UVC_CHECK(index, ESP_ERR_NO_MEM);
+
+    // Tables follow the index in one allocation. Pointer tables first, for alignment
+    uint8_t *tables = (uint8_t *)(index + 1);
+    index->cfg_desc = cfg_desc;
+    index->vc_headers = (const uvc_vc_header_desc_t **)tables;
+    tables += counts.num_of_functions * sizeof(const uvc_vc_header_desc_t *);
+    index->frames = (uvc_desc_index_frame_t *)tables;
+    tables += counts.num_of_frames * sizeof(uvc_desc_index_frame_t);
+    index->alts = (uvc_desc_index_alt_t *)tables;
+    tables += counts.num_of_alts * sizeof(uvc_desc_index_alt_t);
+    index->stills = (uvc_desc_index_still_t *)tables;
+    tables += counts.num_of_stills * sizeof(uvc_desc_index_still_t);
+    index->vc_interfaces = tables;
+    uvc_desc_index_walk(cfg_desc, index);
+
+    *index_ret = index;
+    return ESP_OK;
+}
+
+void uvc_desc_index_delete(uvc_desc_index_t *index)
+{
+    free(index);
+}
+
+/**
+ * @brief Find first indexed frame of format in streaming interface
+ *
+ * @param[in] index            Descriptor index
+ * @param[in] bInterfaceNumber Streaming interface
+ * @param[in] format           enum uvc_host_stream_format
+ * @return Format descriptor, NULL if the interface does not offer the format
+ */
+static const uvc_format_desc_t *uvc_desc_index_find_format(const uvc_desc_index_t *index, uint8_t bInterfaceNumber, int format)
+{
+    for (unsigned i = 0; i < index->num_of_frames; i++) {
+        const uvc_desc_index_frame_t *frame = &index->frames[i];
+        if (frame->bInterfaceNumber == bInterfaceNumber && frame->format == format) {
+            return frame->format_desc;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t uvc_desc_index_get_frame_format_by_format(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    const uvc_host_stream_format_t *vs_format,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret)
+{
+    UVC_CHECK(index && vs_format, ESP_ERR_INVALID_ARG);
+
+    // Only frames of the first matching Format descriptor are considered
+    const uvc_format_desc_t *this_format = uvc_desc_index_find_format(index, bInterfaceNumber, vs_format->format);
+    if (!this_format) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (format_desc_ret) {
+        *format_desc_ret = this_format;
+    }
+
+    for (unsigned i = 0; i < index->num_of_frames; i++) {
+        const uvc_desc_index_frame_t *frame = &index->frames[i];
+        if (frame->format_desc == this_format && uvc_desc_format_is_equal(frame->frame_desc, vs_format)) {
+            if (frame_desc_ret) {
+                *frame_desc_ret = frame->frame_desc;
+            }
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t uvc_desc_index_get_frame_format_by_index(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    uint8_t bFormatIndex,
+    uint8_t bFrameIndex,
+    const uvc_format_desc_t **format_desc_ret,
+    const uvc_frame_desc_t **frame_desc_ret)
+{
+    UVC_CHECK(bFormatIndex > 0, ESP_ERR_INVALID_ARG); // Formats are indexed from 1
+    UVC_CHECK(bFrameIndex > 0, ESP_ERR_INVALID_ARG); // Frames are indexed from 1
+    UVC_CHECK(format_desc_ret && frame_desc_ret && index, ESP_ERR_INVALID_ARG);
+
+    for (unsigned i = 0; i < index->num_of_frames; i++) {
+        const uvc_desc_index_frame_t *frame = &index->frames[i];
+        if (frame->bInterfaceNumber == bInterfaceNumber &&
+                frame->format_desc->bFormatIndex == bFormatIndex &&
+                frame->frame_desc->bFrameIndex == bFrameIndex) {
+            *format_desc_ret = frame->format_desc;
+            *frame_desc_ret = frame->frame_desc;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t uvc_desc_index_get_streaming_interface_num(
+    const uvc_desc_index_t *index,
+    uint8_t uvc_index,
+    const uvc_host_stream_format_t *vs_format,
+    uint16_t *bcdUVC,
+    uint8_t *bInterfaceNumber)
+{
+    UVC_CHECK(index && vs_format && bcdUVC && bInterfaceNumber, ESP_ERR_INVALID_ARG);
+
+    // Get Interface header with uvc_index
+    if (uvc_index >= index->num_of_functions || !index->vc_headers[uvc_index]) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    const uvc_vc_header_desc_t *vc_header_desc = index->vc_headers[uvc_index];
+    *bcdUVC = vc_header_desc->bcdUVC;
+
+    // Find video streaming interface that offers the requested format
+    for (int streaming_if = 0; streaming_if < vc_header_desc->bInCollection; streaming_if++) {
+        const uint8_t current_bInterfaceNumber = vc_header_desc->baInterfaceNr[streaming_if];
+        if (vs_format->format == UVC_VS_FORMAT_DEFAULT ||
+                ESP_OK == uvc_desc_index_get_frame_format_by_format(index, current_bInterfaceNumber, vs_format, NULL, NULL)) {
+            *bInterfaceNumber = current_bInterfaceNumber;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    uint32_t dwMaxPayloadTransferSize,
+    uint16_t max_mps,
+    bool high_speed,
+    uint32_t max_bandwidth,
+    const usb_intf_desc_t **intf_desc_ret,
+    const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(index && intf_desc_ret && ep_desc_ret, ESP_ERR_INVALID_ARG);
+
+    uvc_desc_alt_selection_t sel = {.smallest_fit_payload = UINT32_MAX};
+    for (unsigned i = 0; i < index->num_of_alts; i++) {
+        const uvc_desc_index_alt_t *alt = &index->alts[i];
+        if (alt->bInterfaceNumber == bInterfaceNumber) {
+            uvc_desc_alt_consider(&sel, alt->intf_desc, alt->ep_desc, dwMaxPayloadTransferSize, max_mps, high_speed, max_bandwidth);
+        }
+    }
+    return uvc_desc_alt_result(&sel, intf_desc_ret, ep_desc_ret);
+}
+
+esp_err_t uvc_desc_index_get_frame_list(const uvc_desc_index_t *index, uint8_t uvc_index, uvc_host_frame_info_t (*frame_info_list)[], size_t *list_size)
+{
+    UVC_CHECK(index && list_size, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(uvc_index < index->num_of_functions && index->vc_headers[uvc_index], ESP_ERR_NOT_FOUND);
+
+    // Frames of the first streaming interface of the function
+    const uint8_t bInterfaceNumber = index->vc_headers[uvc_index]->baInterfaceNr[0];
+    size_t frame_index = 0;
+    for (unsigned i = 0; i < index->num_of_frames; i++) {
+        const uvc_desc_index_frame_t *frame = &index->frames[i];
+        if (frame->bInterfaceNumber != bInterfaceNumber || frame->format < 0) {
+            continue; // Other interface or undefined format
+        }
+        if (frame_info_list) {
+            if (frame_index >= *list_size) {
                 break;
             }
+            uvc_desc_frame_info_fill(frame->format, frame->frame_desc, &(*frame_info_list)[frame_index]);
+        }
+        frame_index++;
+    }
 
-            frame_index++;
+    *list_size = frame_index;
+    return ESP_OK;
+}
+
+esp_err_t uvc_desc_index_get_still_frame(
+    const uvc_desc_index_t *index,
+    uint8_t bInterfaceNumber,
+    uint8_t bFormatIndex,
+    uint8_t *bStillCaptureMethod,
+    const uvc_still_image_frame_desc_t **still_desc_ret)
+{
+    UVC_CHECK(index && still_desc_ret, ESP_ERR_INVALID_ARG);
+    for (unsigned i = 0; i < index->num_of_stills; i++) {
+        const uvc_desc_index_still_t *still = &index->stills[i];
+        if (still->bInterfaceNumber == bInterfaceNumber && still->format_desc->bFormatIndex == bFormatIndex) {
+            if (bStillCaptureMethod) {
+                *bStillCaptureMethod = still->bStillCaptureMethod;
+            }
+            *still_desc_ret = still->still_desc;
+            return ESP_OK;
         }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
 
-        if (!current_desc) {
-            break;
+esp_err_t uvc_desc_still_frame_find_size(const uvc_still_image_frame_desc_t *still_desc, unsigned *h_res, unsigned *v_res, uint8_t *bFrameIndex)
+{
+    UVC_CHECK(still_desc && h_res && v_res && bFrameIndex, ESP_ERR_INVALID_ARG);
+
+    // Image size patterns are pairs of wWidth and wHeight, see USB UVC specification ver 1.5, table 3-18
+    const uint8_t *patterns = (const uint8_t *)&still_desc->wWidth;
+    const unsigned num_of_patterns = still_desc->bNumImageSizePatterns;
+    UVC_CHECK(still_desc->bLength >= offsetof(uvc_still_image_frame_desc_t, wWidth) + 4 * num_of_patterns, ESP_ERR_INVALID_SIZE);
+    for (unsigned i = 0; i < num_of_patterns; i++) {
+        const unsigned width = patterns[4 * i] | (patterns[4 * i + 1] << 8);
+        const unsigned height = patterns[4 * i + 2] | (patterns[4 * i + 3] << 8);
+        const bool default_size = (*h_res == 0 || *v_res == 0);
+        if (default_size || (width == *h_res && height == *v_res)) {
+            *h_res = width;
+            *v_res = height;
+            *bFrameIndex = i + 1; // Patterns are indexed from 1
+            return ESP_OK;
         }
     }
+    return ESP_ERR_NOT_FOUND;
+}
 
-    *list_size = frame_info_list ? frame_index : num_frame;
-    return ret;
+esp_err_t uvc_desc_index_get_entity_id(const uvc_desc_index_t *index, uint8_t uvc_index, uint8_t bDescriptorSubType, uint16_t wTerminalType, uint8_t *entity_id)
+{
+    UVC_CHECK(index && entity_id, ESP_ERR_INVALID_ARG);
+    if (uvc_index >= index->num_of_functions || !index->vc_headers[uvc_index]) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // Units and Terminals follow the Video Control header, wTotalLength covers all of them
+    // @see USB UVC specification ver 1.5, chapter 3.7.2
+    const uvc_vc_header_desc_t *vc_header = index->vc_headers[uvc_index];
+    const uint8_t *cfg_end = (const uint8_t *)index->cfg_desc + index->cfg_desc->wTotalLength;
+    const uint8_t *vc_end = (const uint8_t *)vc_header + vc_header->wTotalLength;
+    const uint8_t *desc = (const uint8_t *)vc_header + vc_header->bLength;
+    if (vc_end > cfg_end) {
+        vc_end = cfg_end;
+    }
+    while (desc + 4 <= vc_end && desc[0] >= 4 && desc + desc[0] <= vc_end) {
+        if (desc[1] == UVC_CS_INTERFACE && desc[2] == bDescriptorSubType) {
+            // bUnitID and bTerminalID are both at offset 3
+            const bool type_match = (bDescriptorSubType != UVC_VC_DESC_SUBTYPE_INPUT_TERMINAL) ||
+                                    (desc[0] >= 6 && (desc[4] | (desc[5] << 8)) == wTerminalType);
+            if (type_match) {
+                *entity_id = desc[3];
+                return ESP_OK;
+            }
+        }
+        desc += desc[0];
+    }
+    return ESP_ERR_NOT_FOUND;
 }
@@ -0,0 +1,297 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <sys/param.h> // For MIN/MAX
+
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+
+#include "usb/uvc_host.h"
+#include "usb/uvc_host_display.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_yuv_priv.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define UVC_DISPLAY_LINES_PER_DRAW (16) // Default number of lines passed to one draw callback
+#define UVC_DISPLAY_NUM_OF_BUFFERS (2)  // Default number of line buffers: one is converted while the other one is drawn
+
+static const char *TAG = "uvc-display";
+
+struct uvc_host_display_s {
+    uvc_host_stream_hdl_t stream_hdl;                      // Source stream of YUY2 frames
+    uvc_host_display_draw_callback_t draw_cb;              // User's draw callback
+    void *user_ctx;                                        // User's argument of draw callback
+    enum uvc_host_yuv_output_format output_format;         // Format of converted data
+    bool swap_bytes;                                       // RGB565 only: big-endian pixels
+    unsigned x_offset;                                     // Position of the picture on the panel
+    unsigned y_offset;
+    unsigned lines_per_draw;                               // Configured number of lines of one draw
+    unsigned num_of_buffers;                               // Number of line buffers
+    uvc_host_display_lines_t *buffers;                     // Line buffers
+    QueueHandle_t free_buffer_queue;                       // Queue of line buffers that are not held by the user
+    portMUX_TYPE lock;                                     // Spinlock of statistics
+    uvc_host_display_stats_t stats;                        // Statistics
+
+    // Members below are accessed only from the context that processes USB transfers
+    uvc_host_display_lines_t *current;                     // Line buffer being converted. NULL if the lines of the current group are dropped
+    unsigned h_res;                                        // Resolution of the picture being received
+    unsigned v_res;
+    unsigned group_lines;                                  // Lines of one draw in the picture being received. 0 if the picture is not drawn
+    size_t line_size;                                      // Size of one YUY2 line
+    size_t frame_size;                                     // Size of complete YUY2 picture
+    size_t received;                                       // Bytes of the picture consumed so far
+    bool group_open;                                       // A group of lines is being received
+    unsigned group_y;                                      // First line of the group
+    size_t group_size;                                     // Size of the group in YUY2 bytes. The last group of the picture can be shorter
+    size_t group_received;                                 // Bytes of the group consumed so far
+};
+
+/**
+ * @brief Start picture at start of frame
+ *
+ * A group of lines of previous frame that was not completed is dropped.
+ *
+ * @param[in] display Display sink
+ * @param[in] frame   Frame that starts
+ */
+static void uvc_display_frame_start(struct uvc_host_display_s *display, const uvc_host_frame_t *frame)
+{
+    if (display->current) {
+        xQueueSendToFront(display->free_buffer_queue, &display->current, 0);
+        display->current = NULL;
+    }
+    display->group_open = false;
+    display->received = 0;
+    display->group_lines = 0;
+
+    // Pictures whose lines do not fit into the line buffers are not drawn, e.g. after uvc_host_stream_format_select()
+    const unsigned h_res = frame->vs_format.h_res;
+    const unsigned v_res = frame->vs_format.v_res;
+    const size_t out_line_size = h_res * uvc_yuv_bytes_per_pixel(display->output_format);
+    if (frame->vs_format.format != UVC_VS_FORMAT_YUY2 || h_res == 0 || v_res == 0 || (h_res & 1) ||
+            out_line_size > display->buffers[0].data_buffer_len) {
+        return;
+    }
+    display->h_res = h_res;
+    display->v_res = v_res;
+    display->group_lines = MIN(display->lines_per_draw, display->buffers[0].data_buffer_len / out_line_size);
+    display->line_size = h_res * 2; // YUY2 has 2 bytes per pixel
+    display->frame_size = display->line_size * v_res;
+}
+
+/**
+ * @brief Start group of lines, take a free line buffer for it
+ *
+ * @param[in] display Display sink
+ */
+static void uvc_display_group_start(struct uvc_host_display_s *display)
+{
+    display->group_y = display->received / display->line_size;
+    display->group_size = MIN(display->group_lines, display->v_res - display->group_y) * display->line_size;
+    display->group_received = 0;
+    display->group_open = true;
+    if (pdPASS != xQueueReceive(display->free_buffer_queue, &display->current, 0)) {
+        display->current = NULL; // All line buffers are held by the user, the lines of this group are dropped
+    }
+}
+
+/**
+ * @brief End group of lines, pass its line buffer to the user
+ *
+ * @param[in] display Display sink
+ */
+static void uvc_display_group_end(struct uvc_host_display_s *display)
+{
+    const unsigned lines = display->group_size / display->line_size;
+    uvc_host_display_lines_t *current = display->current;
+    display->current = NULL;
+    display->group_open = false;
+
+    portENTER_CRITICAL(&display->lock);
+    if (current) {
+        display->stats.lines_drawn += lines;
+    } else {
+        display->stats.lines_dropped += lines;
+    }
+    if (display->received == display->frame_size) {
+        display->stats.frames++;
+    }
+    portEXIT_CRITICAL(&display->lock);
+
+    if (current) {
+        current->x_start = display->x_offset;
+        current->y_start = display->y_offset + display->group_y;
+        current->x_end = display->x_offset + display->h_res;
+        current->y_end = current->y_start + lines;
+        current->data_len = display->group_size / 2 * uvc_yuv_bytes_per_pixel(display->output_format);
+        if (display->draw_cb(current, display->user_ctx)) {
+            xQueueSendToFront(display->free_buffer_queue, &current, 0);
+        }
+    }
+}
+
+/**
+ * @brief Convert data added to the frame being received into line buffers
+ *
+ * Only whole macropixels are consumed, the rest stays in the frame buffer until the next data.
+ * Data behind the end of the picture and pictures that are not drawn are consumed without conversion.
+ *
+ * @param[in] frame       Frame being received, its data start at the first byte that was not consumed yet
+ * @param[in] frame_start The data are the first data of the frame
+ * @param[in] arg         Display sink
+ * @return Number of consumed bytes
+ */
+static size_t uvc_display_sink_cb(const uvc_host_frame_t *frame, bool frame_start, void *arg)
+{
+    struct uvc_host_display_s *display = (struct uvc_host_display_s *)arg;
+    if (frame_start) {
+        uvc_display_frame_start(display, frame);
+    }
+
+    const size_t bpp = uvc_yuv_bytes_per_pixel(display->output_format);
+    size_t consumed = 0;
+    while (display->group_lines && display->received < display->frame_size) {
+        if (!display->group_open) {
+            uvc_display_group_start(display);
+        }
+        size_t len = MIN(frame->data_len - consumed, display->group_size - display->group_received);
+        if (display->current) {
+            len -= len % UVC_YUV_MACROPIXEL;
+        }
+        if (len == 0) {
+            break;
+        }
+        if (display->current) {
+            uvc_yuv_convert(frame->data + consumed, display->current->data + display->group_received / 2 * bpp,
+                            len / UVC_YUV_MACROPIXEL, display->output_format, display->swap_bytes);
+        }
+        consumed += len;
+        display->group_received += len;
+        display->received += len;
+        if (display->group_received == display->group_size) {
+            uvc_display_group_end(display);
+        }
+    }
+
+    if (!display->group_lines || display->received == display->frame_size) {
+        return frame->data_len;
+    }
+    return consumed;
+}
+
+esp_err_t uvc_host_display_create(const uvc_host_display_config_t *config, uvc_host_display_hdl_t *display_hdl_ret)
+{
+    esp_err_t ret;
+    UVC_CHECK(config && config->stream_hdl && config->draw_cb && display_hdl_ret, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = config->stream_hdl;
+    UVC_CHECK(!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && uvc_stream->constant.data_cb == NULL &&
+              uvc_stream->constant.sink_cb == NULL && uvc_stream->constant.partial_cb == NULL, ESP_ERR_INVALID_STATE);
+    // Zero-copy transfers land behind the frame data, which the sink keeps moving to the start of the frame buffer
+    UVC_CHECK(!uvc_stream->constant.bulk_zero_copy, ESP_ERR_NOT_SUPPORTED);
+
+    uvc_host_stream_format_t vs_format;
+    ESP_RETURN_ON_ERROR(uvc_host_stream_format_get(uvc_stream, &vs_format), TAG,);
+    UVC_CHECK(vs_format.format == UVC_VS_FORMAT_YUY2, ESP_ERR_NOT_SUPPORTED);
+
+    struct uvc_host_display_s *display = calloc(1, sizeof(struct uvc_host_display_s));
+    UVC_CHECK(display, ESP_ERR_NO_MEM);
+    display->stream_hdl = uvc_stream;
+    display->draw_cb = config->draw_cb;
+    display->user_ctx = config->user_ctx;
+    display->output_format = config->output_format;
+    display->swap_bytes = config->swap_bytes;
+    display->x_offset = config->x_offset;
+    display->y_offset = config->y_offset;
+    display->lines_per_draw = config->lines_per_draw ? config->lines_per_draw : UVC_DISPLAY_LINES_PER_DRAW;
+    display->num_of_buffers = config->number_of_line_buffers ? config->number_of_line_buffers : UVC_DISPLAY_NUM_OF_BUFFERS;
+    portMUX_INITIALIZE(&display->lock);
+
+    // Allocate line buffers
+    display->buffers = calloc(display->num_of_buffers, sizeof(uvc_host_display_lines_t));
+    ESP_GOTO_ON_FALSE(display->buffers, ESP_ERR_NO_MEM, err, TAG,);
+    display->free_buffer_queue = xQueueCreate(display->num_of_buffers, sizeof(uvc_host_display_lines_t *));
+    ESP_GOTO_ON_FALSE(display->free_buffer_queue, ESP_ERR_NO_MEM, err, TAG,);
+    const size_t buffer_size = config->line_buffer_size ? config->line_buffer_size :
+                               vs_format.h_res * display->lines_per_draw * uvc_yuv_bytes_per_pixel(config->output_format);
+    const uint32_t caps = config->line_buffer_heap_caps ? config->line_buffer_heap_caps : MALLOC_CAP_DMA;
+    for (unsigned i = 0; i < display->num_of_buffers; i++) {
+        uvc_host_display_lines_t *buffer = &display->buffers[i];
+        buffer->data = heap_caps_malloc(buffer_size, caps);
+        ESP_GOTO_ON_FALSE(buffer->data, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for line buffer %zu", buffer_size);
+        buffer->data_buffer_len = buffer_size;
+        xQueueSend(display->free_buffer_queue, &buffer, 0);
+    }
+
+    // Attach to the stream. It is stopped, so no USB transfer is being processed
+    uvc_stream->constant.sink_cb_arg = display;
+    uvc_stream->constant.sink_cb = uvc_display_sink_cb;
+
+    ESP_LOGD(TAG, "Display sink created, %u line buffers of %zu bytes", display->num_of_buffers, buffer_size);
+    *display_hdl_ret = display;
+    return ESP_OK;
+
+err:
+    if (display->buffers) {
+        for (unsigned i = 0; i < display->num_of_buffers; i++) {
+            heap_caps_free(display->buffers[i].data);
+        }
+        free(display->buffers);
+    }
+    if (display->free_buffer_queue) {
+        vQueueDelete(display->free_buffer_queue);
+    }
+    free(display);
+    return ret;
+}
+
+esp_err_t uvc_host_display_delete(uvc_host_display_hdl_t display_hdl)
+{
+    UVC_CHECK(display_hdl, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = display_hdl->stream_hdl;
+    UVC_CHECK(!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming), ESP_ERR_INVALID_STATE);
+
+    uvc_stream->constant.sink_cb = NULL;
+    uvc_stream->constant.sink_cb_arg = NULL;
+    for (unsigned i = 0; i < display_hdl->num_of_buffers; i++) {
+        heap_caps_free(display_hdl->buffers[i].data);
+    }
+    free(display_hdl->buffers);
+    vQueueDelete(display_hdl->free_buffer_queue);
+    free(display_hdl);
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_display_lines_return(uvc_host_display_hdl_t display_hdl, uvc_host_display_lines_t *lines)
+{
+    UVC_CHECK(display_hdl && lines, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(lines >= &display_hdl->buffers[0] && lines < &display_hdl->buffers[display_hdl->num_of_buffers], ESP_ERR_INVALID_ARG);
+
+    if (xPortInIsrContext()) {
+        BaseType_t xTaskWoken = pdFALSE;
+        xQueueSendFromISR(display_hdl->free_buffer_queue, &lines, &xTaskWoken);
+        if (xTaskWoken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xQueueSend(display_hdl->free_buffer_queue, &lines, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_display_get_stats(uvc_host_display_hdl_t display_hdl, uvc_host_display_stats_t *stats)
+{
+    UVC_CHECK(display_hdl && stats, ESP_ERR_INVALID_ARG);
+    portENTER_CRITICAL(&display_hdl->lock);
+    *stats = display_hdl->stats;
+    portEXIT_CRITICAL(&display_hdl->lock);
+    return ESP_OK;
+}
@@ -4,8 +4,9 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
-#include <string.h> // For memcpy
+#include <string.h> // For memcpy, memmove
 #include <inttypes.h>
+#include <sys/param.h> // For MIN/MAX
 
 #include "esp_check.h"
 #include "esp_heap_caps.h"
@@ -14,53 +15,543 @@
 #include "uvc_frame_priv.h"
 #include "uvc_types_priv.h"
 #include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_stats_priv.h"
+#include "uvc_still_priv.h"
 
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "uvc-frame";
 
+#define UVC_FRAME_MJPEG_MAX_PADDING   (16) // Zero bytes behind EOI that are tolerated
+#define UVC_FRAME_MJPEG_AVERAGE_SHIFT (3)  // Running average of MJPEG frame length over 8 frames
+#define UVC_FRAME_MJPEG_MIN_FRACTION  (8)  // MJPEG frames shorter than 1/8 of the average are truncated
+
+/**
+ * @brief Initialize ring of frame buffer indices
+ *
+ * @param[in] ring     Ring to initialize
+ * @param[in] capacity Minimum number of indices the ring can hold. Rounded up to a power of 2
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NO_MEM: Not enough memory for the ring
+ */
+static esp_err_t uvc_frame_ring_init(uvc_frame_ring_t *ring, unsigned capacity)
+{
+    unsigned num_of_slots = 1;
+    while (num_of_slots < capacity) {
+        num_of_slots <<= 1;
+    }
+    ring->slots = calloc(num_of_slots, sizeof(uvc_frame_ring_slot_t));
+    UVC_CHECK(ring->slots, ESP_ERR_NO_MEM);
+    for (unsigned i = 0; i < num_of_slots; i++) {
+        ring->slots[i].seq = i; // Slot i is ready for write at position i
+    }
+    ring->mask = num_of_slots - 1;
+    ring->head = 0;
+    ring->tail = 0;
+    return ESP_OK;
+}
+
+static void uvc_frame_ring_deinit(uvc_frame_ring_t *ring)
+{
+    free(ring->slots);
+    ring->slots = NULL;
+}
+
+/**
+ * @brief Push frame buffer index to the ring
+ *
+ * Producers reserve a position by moving the tail and publish the index by the sequence number of its slot.
+ *
+ * @param[in] ring  Ring
+ * @param[in] index Frame buffer index
+ * @return true on success, false if the ring is full
+ */
+static bool uvc_frame_ring_push(uvc_frame_ring_t *ring, unsigned index)
+{
+    uvc_frame_ring_slot_t *slot;
+    unsigned pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED);
+    while (1) {
+        slot = &ring->slots[pos & ring->mask];
+        const unsigned seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        const int diff = (int)(seq - pos);
+        if (diff == 0) {
+            // The slot is free, try to reserve it
+            if (__atomic_compare_exchange_n(&ring->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Full
+        } else {
+            pos = __atomic_load_n(&ring->tail, __ATOMIC_RELAXED); // Another producer was faster
+        }
+    }
+    slot->index = index;
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE); // Publish the index to consumers
+    return true;
+}
+
+/**
+ * @brief Pop frame buffer index from the ring
+ *
+ * @param[in]  ring  Ring
+ * @param[out] index Frame buffer index
+ * @return true on success, false if the ring is empty
+ */
+static bool uvc_frame_ring_pop(uvc_frame_ring_t *ring, unsigned *index)
+{
+    uvc_frame_ring_slot_t *slot;
+    unsigned pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    while (1) {
+        slot = &ring->slots[pos & ring->mask];
+        const unsigned seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        const int diff = (int)(seq - (pos + 1));
+        if (diff == 0) {
+            // The slot holds an index, try to take it
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false; // Empty
+        } else {
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED); // Another consumer was faster
+        }
+    }
+    *index = slot->index;
+    __atomic_store_n(&slot->seq, pos + ring->mask + 1, __ATOMIC_RELEASE); // The slot is free for the next lap
+    return true;
+}
+
+/**
+ * @brief Number of frame buffer indices in the ring
+ *
+ * The result is exact only if the ring is not accessed concurrently.
+ */
+static unsigned uvc_frame_ring_count(uvc_frame_ring_t *ring)
+{
+    return __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) - __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+}
+
+static inline unsigned uvc_frame_index(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    return (unsigned)((uvc_frame_t *)frame - uvc_stream->constant.fbs);
+}
+
+static inline uvc_host_frame_t *uvc_frame_ring_pop_frame(uvc_stream_t *uvc_stream, uvc_frame_ring_t *ring)
+{
+    unsigned index;
+    if (uvc_frame_ring_pop(ring, &index)) {
+        return &uvc_stream->constant.fbs[index].frame;
+    }
+    return NULL;
+}
+
+/**
+ * @brief Frame pool: Take the largest free contiguous slice of the pool for the frame buffer
+ *
+ * Slices are allocated one after another and wrap around the end of the pool.
+ * The new slice stays open (it can grow up to the free space) until the frame is committed.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] this_fb    Empty frame buffer
+ * @return true on success, false if the pool is full
+ */
+static bool uvc_frame_pool_take(uvc_stream_t *uvc_stream, uvc_frame_t *this_fb)
+{
+    const size_t pool_size = uvc_stream->constant.fb_pool_size;
+    const unsigned num_of_fbs = uvc_stream->constant.num_of_fbs;
+    size_t start = 0;
+    size_t end = pool_size;
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    if (uvc_stream->dynamic.fb_pool_count > 0) {
+        const size_t write = uvc_stream->dynamic.fb_pool_write;
+        const size_t oldest = uvc_stream->constant.fbs[uvc_stream->constant.fb_pool_slices[uvc_stream->dynamic.fb_pool_oldest]].slice_start;
+        if (write > oldest) {
+            // Slices do not wrap around: use the larger free space, behind the newest or before the oldest slice
+            if (pool_size - write >= oldest) {
+                start = write;
+            } else {
+                end = oldest;
+            }
+        } else {
+            // Slices wrap around: the only free space is between the newest and the oldest slice
+            start = write;
+            end = oldest;
+        }
+    }
+    if (end <= start) {
+        UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+        return false;
+    }
+    this_fb->slice_start = start;
+    this_fb->slice_end = start;
+    this_fb->slice_released = false;
+    const unsigned newest = (uvc_stream->dynamic.fb_pool_oldest + uvc_stream->dynamic.fb_pool_count) % num_of_fbs;
+    uvc_stream->constant.fb_pool_slices[newest] = this_fb - uvc_stream->constant.fbs;
+    uvc_stream->dynamic.fb_pool_count++;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    this_fb->data_base = uvc_stream->constant.fb_pool_data + start;
+    this_fb->frame.data = this_fb->data_base;
+    this_fb->frame.data_buffer_len = end - start;
+    return true;
+}
+
+/**
+ * @brief Frame pool: Release slice of the returned frame buffer
+ *
+ * Slices are reused in order of their allocation, so the space of the slice is free once all older slices are released.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] this_fb    Returned frame buffer
+ */
+static void uvc_frame_pool_release(uvc_stream_t *uvc_stream, uvc_frame_t *this_fb)
+{
+    const unsigned num_of_fbs = uvc_stream->constant.num_of_fbs;
+    uvc_frame_t *const fbs = uvc_stream->constant.fbs;
+    unsigned *const slices = uvc_stream->constant.fb_pool_slices;
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    this_fb->slice_released = true;
+    if (this_fb->slice_end == this_fb->slice_start) {
+        // The frame was not committed, its open slice is the newest one. Remove it right away
+        assert(uvc_stream->dynamic.fb_pool_count > 0);
+        uvc_stream->dynamic.fb_pool_count--;
+        if (uvc_stream->dynamic.fb_pool_count > 0) {
+            const unsigned newest = (uvc_stream->dynamic.fb_pool_oldest + uvc_stream->dynamic.fb_pool_count - 1) % num_of_fbs;
+            uvc_stream->dynamic.fb_pool_write = fbs[slices[newest]].slice_end;
+        }
+    }
+    while (uvc_stream->dynamic.fb_pool_count > 0 && fbs[slices[uvc_stream->dynamic.fb_pool_oldest]].slice_released) {
+        uvc_stream->dynamic.fb_pool_oldest = (uvc_stream->dynamic.fb_pool_oldest + 1) % num_of_fbs;
+        uvc_stream->dynamic.fb_pool_count--;
+    }
+    if (uvc_stream->dynamic.fb_pool_count == 0) {
+        uvc_stream->dynamic.fb_pool_write = 0; // The pool is empty, start from its beginning
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+/**
+ * @brief Read little-endian 32-bit value from payload header
+ */
+static inline uint32_t uvc_frame_get_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void uvc_frame_time_header(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *header, size_t len)
+{
+    if (frame == NULL || len < 2) {
+        return;
+    }
+    const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)header;
+    const size_t header_len = (payload_header->bHeaderLength < len) ? payload_header->bHeaderLength : len;
+
+    if (frame->time.receive_us == 0) {
+        frame->time.receive_us = uvc_stream->single_thread.xfer_receive_us;
+        frame->time.clock_frequency = UVC_ATOMIC_LOAD(uvc_stream->dynamic.dwClockFrequency);
+    }
+
+    // Optional fields follow bmHeaderInfo in this order: dwPresentationTime (4 bytes), scrSourceClock (6 bytes)
+    // see USB UVC specification ver 1.5, table 2-6
+    size_t offset = 2;
+    if (payload_header->bmHeaderInfo.presentation_time) {
+        if (offset + 4 > header_len) {
+            return;
+        }
+        if (!frame->time.pts_valid) {
+            frame->time.pts = uvc_frame_get_le32(header + offset);
+            frame->time.pts_valid = true;
+        }
+        offset += 4;
+    }
+    if (payload_header->bmHeaderInfo.source_clock_reference && offset + 6 <= header_len) {
+        frame->time.scr_stc = uvc_frame_get_le32(header + offset);
+        frame->time.scr_sof = (uint16_t)(header[offset + 4] | (header[offset + 5] << 8)) & 0x07FF;
+        frame->time.scr_valid = true;
+        ((uvc_frame_t *)frame)->scr_receive_us = uvc_stream->single_thread.xfer_receive_us;
+    }
+}
+
+/**
+ * @brief Recover host time of capture of the frame
+ *
+ * PTS and STC of SCR are samples of the same device clock. The payload with the SCR was sent (STC - PTS) after the capture,
+ * so the capture happened this time before the payload was received by the host.
+ *
+ * @param[in] frame Received frame
+ */
+static void uvc_frame_time_capture(uvc_host_frame_t *frame)
+{
+    uvc_host_frame_time_t *time = &frame->time;
+    time->capture_us = time->receive_us;
+    if (!time->pts_valid || !time->scr_valid || time->clock_frequency == 0) {
+        return;
+    }
+
+    // Signed difference handles wrap-around of the 32-bit device clock
+    const int32_t capture_to_send = (int32_t)(time->scr_stc - time->pts);
+    time->capture_us = ((uvc_frame_t *)frame)->scr_receive_us - (int64_t)capture_to_send * 1000000 / time->clock_frequency;
+}
+
+/**
+ * @brief End NAL unit at the start code that follows it
+ *
+ * Zero bytes in front of the start code are trailing_zero_8bits or zero_byte of 4-byte start code, they are not part of the unit.
+ *
+ * @param[in] data     Frame data
+ * @param[in] unit     NAL unit to end
+ * @param[in] unit_end End of the unit data, start of the next start code
+ */
+static inline void uvc_frame_nal_end(const uint8_t *data, uvc_host_nal_unit_t *unit, const uint8_t *unit_end)
+{
+    const uint8_t *unit_start = data + unit->offset;
+    while (unit_end > unit_start && unit_end[-1] == 0x00) {
+        unit_end--;
+    }
+    unit->len = unit_end - unit_start;
+}
+
+/**
+ * @brief Index NAL units of H.264/H.265 frame
+ *
+ * Emulation prevention of H.264/H.265 guarantees that start code 00 00 01 does not appear inside of NAL units,
+ * so the frame is searched for byte 0x01 and the two bytes in front of it are checked.
+ *
+ * @param[in] frame Received frame
+ */
+static void uvc_frame_nal_index(uvc_host_frame_t *frame)
+{
+    uvc_host_frame_nal_t *nal = &frame->nal;
+    const enum uvc_host_stream_format format = frame->vs_format.format;
+    nal->count = 0;
+    nal->truncated = false;
+    if ((format != UVC_VS_FORMAT_H264 && format != UVC_VS_FORMAT_H265) || frame->data_len < 3) {
+        return;
+    }
+
+    const uint8_t *data = frame->data;
+    const uint8_t *end = data + frame->data_len;
+    const uint8_t *p = data + 2;
+    uvc_host_nal_unit_t *unit = NULL;
+    while (p < end && (p = memchr(p, 0x01, end - p)) != NULL) {
+        if (p[-1] != 0x00 || p[-2] != 0x00) {
+            p++;
+            continue;
+        }
+        if (unit) {
+            uvc_frame_nal_end(data, unit, p - 2);
+            unit = NULL;
+        }
+        p++; // NAL unit header
+        if (p == end) {
+            break; // Start code at the end of frame, there is no unit behind it
+        }
+        if (nal->count == CONFIG_UVC_NAL_INDEX_SIZE) {
+            nal->truncated = true;
+            break;
+        }
+        unit = &nal->units[nal->count++];
+        unit->offset = p - data;
+        unit->type = (format == UVC_VS_FORMAT_H264) ? (p[0] & 0x1F) : ((p[0] >> 1) & 0x3F);
+        p += 3; // Next start code can end 3 bytes behind the shortest NAL unit
+    }
+    if (unit) {
+        uvc_frame_nal_end(data, unit, end);
+    }
+}
+
+void uvc_frame_partial(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame, bool frame_end)
+{
+    size_t part_len = uvc_stream->constant.partial_size;
+    if (uvc_stream->constant.partial_lines && frame->vs_format.format == UVC_VS_FORMAT_YUY2) {
+        part_len = uvc_stream->constant.partial_lines * frame->vs_format.h_res * 2; // YUY2 has 2 bytes per pixel
+    }
+
+    size_t delivered = uvc_stream->single_thread.partial_delivered;
+    while (part_len && frame->data_len - delivered >= part_len) {
+        uvc_stream->constant.partial_cb(frame, delivered, part_len, uvc_stream->constant.cb_arg);
+        delivered += part_len;
+    }
+    if ((!part_len || frame_end) && frame->data_len > delivered) {
+        uvc_stream->constant.partial_cb(frame, delivered, frame->data_len - delivered, uvc_stream->constant.cb_arg);
+        delivered = frame->data_len;
+    }
+    uvc_stream->single_thread.partial_delivered = delivered;
+}
+
+void uvc_frame_sink(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, size_t offset)
+{
+    uvc_frame_t *this_fb = (uvc_frame_t *)frame;
+    const bool frame_start = (this_fb->sink_consumed == 0 && offset == 0);
+    size_t consumed = uvc_stream->constant.sink_cb(frame, frame_start, uvc_stream->constant.sink_cb_arg);
+    consumed = MIN(consumed, frame->data_len);
+    if (consumed == 0) {
+        return;
+    }
+    memmove(frame->data, frame->data + consumed, frame->data_len - consumed);
+    frame->data_len -= consumed;
+    this_fb->sink_consumed += consumed;
+}
+
+void uvc_frame_commit(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    assert(uvc_stream && frame);
+    uvc_frame_time_capture(frame);
+    uvc_frame_nal_index(frame);
+    if (uvc_still_is_frame(uvc_stream, frame)) {
+        return; // Still frame buffer has its own memory
+    }
+    if (uvc_stream->constant.partial_cb) {
+        uvc_frame_partial(uvc_stream, frame, true);
+    }
+    if (!uvc_stream->constant.fb_pool) {
+        return;
+    }
+
+    // Shrink the slice to the received data. Slices have non-zero length and start aligned
+    uvc_frame_t *this_fb = (uvc_frame_t *)frame;
+    size_t slice_len = (frame->data_len + UVC_FRAME_ALIGN) & ~((size_t)UVC_FRAME_ALIGN - 1);
+    if (slice_len > frame->data_buffer_len) {
+        slice_len = frame->data_buffer_len;
+    }
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    this_fb->slice_end = this_fb->slice_start + slice_len;
+    uvc_stream->dynamic.fb_pool_write = this_fb->slice_end;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    frame->data_buffer_len = slice_len;
+}
+
 esp_err_t uvc_host_frame_return(uvc_host_stream_hdl_t stream_hdl, uvc_host_frame_t *frame)
 {
     UVC_CHECK(stream_hdl && frame, ESP_ERR_INVALID_ARG);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    if (uvc_still_is_frame(uvc_stream, frame)) {
+        return uvc_still_frame_return(uvc_stream);
+    }
+    UVC_CHECK(uvc_frame_index(uvc_stream, frame) < uvc_stream->constant.num_of_fbs, ESP_ERR_INVALID_ARG);
+    uvc_frame_t *this_fb = (uvc_frame_t *)frame;
     uvc_frame_reset(frame);
-    BaseType_t result = xQueueSend(uvc_stream->constant.empty_fb_queue, &frame, 0);
-    UVC_CHECK(pdPASS == result, ESP_FAIL);
+
+    // Zero-copy bulk: USB transfers can still be receiving data into this frame buffer.
+    // The frame is queued as empty by the last of them, see uvc_frame_landing_release()
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    if (this_fb->landed_xfers > 0) {
+        this_fb->return_pending = true;
+        UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+        return ESP_OK;
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    if (uvc_stream->constant.fb_pool) {
+        uvc_frame_pool_release(uvc_stream, this_fb);
+    }
+    UVC_CHECK(uvc_frame_ring_push(&uvc_stream->constant.empty_fb_ring, uvc_frame_index(uvc_stream, frame)), ESP_FAIL);
     return ESP_OK;
 }
 
-esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_size, uint32_t fb_caps)
+// Allocate frame buffer descriptors and the rings, without frame data
+static esp_err_t uvc_frame_rings_allocate(uvc_stream_t *uvc_stream, int nb_of_fb)
+{
+    // The frame buffers are passed between the driver and the user by their indices.
+    // Extra slot in the rings: a slot being popped cannot block push of the last frame buffer
+    uvc_stream->constant.fbs = calloc(nb_of_fb, sizeof(uvc_frame_t));
+    UVC_CHECK(uvc_stream->constant.fbs, ESP_ERR_NO_MEM);
+    uvc_stream->constant.num_of_fbs = nb_of_fb;
+    if (uvc_frame_ring_init(&uvc_stream->constant.empty_fb_ring, nb_of_fb + 1) != ESP_OK ||
+            uvc_frame_ring_init(&uvc_stream->constant.filled_fb_ring, nb_of_fb + 1) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    uvc_stream->constant.filled_fb_sem = xSemaphoreCreateBinary();
+    if (uvc_stream->constant.filled_fb_sem == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t uvc_frame_allocate(uvc_stream_t *uvc_stream, int nb_of_fb, size_t fb_size, uint32_t fb_caps,
+                             uint8_t *fb_memory, size_t fb_memory_size)
 {
     UVC_CHECK(uvc_stream, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(nb_of_fb > 0, ESP_ERR_INVALID_ARG);
     esp_err_t ret;
 
-    // We will be passing the frame buffers by reference
-    uvc_stream->constant.empty_fb_queue = xQueueCreate(nb_of_fb, sizeof(uvc_host_frame_t *));
-    UVC_CHECK(uvc_stream->constant.empty_fb_queue, ESP_ERR_NO_MEM);
+    // User's memory is cut into frame buffers of the same layout as the allocated ones
+    const size_t fb_extra = uvc_stream->constant.bulk_zero_copy ? UVC_FRAME_ALIGN : 0;
+    const size_t fb_stride = (fb_size + fb_extra + UVC_FRAME_ALIGN - 1) & ~((size_t)UVC_FRAME_ALIGN - 1);
+    if (fb_memory) {
+        const size_t needed = uvc_stream->constant.fb_pool ? fb_size : fb_stride * nb_of_fb;
+        if ((uintptr_t)fb_memory % UVC_FRAME_ALIGN || fb_memory_size < needed) {
+            ESP_LOGE(TAG, "Frame memory must be aligned to %d bytes and hold %zu bytes", UVC_FRAME_ALIGN, needed);
+            return ESP_ERR_INVALID_ARG;
+        }
+        uvc_stream->constant.fb_user_memory = true;
+    }
+
+    ret = uvc_frame_rings_allocate(uvc_stream, nb_of_fb);
+    if (ret != ESP_OK) {
+        goto err;
+    }
+    if (fb_caps == 0) {
+        fb_caps = MALLOC_CAP_DEFAULT; // In case the user did not fill the config, set it to default
+    }
+
+    if (uvc_stream->constant.fb_pool) {
+        // All frame buffers are slices of one pool. Slices start aligned, see uvc_frame_commit()
+        assert(!uvc_stream->constant.bulk_zero_copy);
+        uvc_stream->constant.fb_pool_data = fb_memory ? fb_memory : heap_caps_aligned_alloc(UVC_FRAME_ALIGN, fb_size, fb_caps);
+        uvc_stream->constant.fb_pool_slices = calloc(nb_of_fb, sizeof(unsigned));
+        if (uvc_stream->constant.fb_pool_data == NULL || uvc_stream->constant.fb_pool_slices == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            ESP_LOGE(TAG, "Not enough memory for frame pool %zu", fb_size);
+            goto err;
+        }
+        uvc_stream->constant.fb_pool_size = fb_size;
+        uvc_stream->dynamic.fb_pool_write = 0;
+        uvc_stream->dynamic.fb_pool_oldest = 0;
+        uvc_stream->dynamic.fb_pool_count = 0;
+        for (int i = 0; i < nb_of_fb; i++) {
+            const bool result = uvc_frame_ring_push(&uvc_stream->constant.empty_fb_ring, i);
+            assert(result);
+            (void)result;
+        }
+        return ESP_OK;
+    }
+
     for (int i = 0; i < nb_of_fb; i++) {
         // Allocate the frame buffer
-        uvc_host_frame_t *this_fb = malloc(sizeof(uvc_host_frame_t));
-        if (fb_caps == 0) {
-            fb_caps = MALLOC_CAP_DEFAULT; // In case the user did not fill the config, set it to default
-        }
-        uint8_t *this_data = heap_caps_malloc(fb_size, fb_caps);
-        if (this_data == NULL || this_fb == NULL) {
-            free(this_fb);
-            free(this_data);
+        uvc_frame_t *this_fb = &uvc_stream->constant.fbs[i];
+        uint8_t *this_data;
+        if (fb_memory) {
+            this_data = fb_memory + fb_stride * i;
+        } else if (uvc_stream->constant.bulk_zero_copy) {
+            // USB transfers receive data directly to the frame buffer: It must be aligned
+            // and it has extra space for shifting the frame data start, see bulk_transfer_callback()
+            this_data = heap_caps_aligned_alloc(UVC_FRAME_ALIGN, fb_size + UVC_FRAME_ALIGN, fb_caps);
+        } else {
+            this_data = heap_caps_malloc(fb_size, fb_caps);
+        }
+        if (this_data == NULL) {
             ret = ESP_ERR_NO_MEM;
             ESP_LOGE(TAG, "Not enough memory for frame buffers %zu", fb_size);
             goto err;
         }
 
         // Set members to default
-        this_fb->data = this_data;
-        this_fb->data_buffer_len = fb_size;
-        this_fb->data_len = 0;
+        this_fb->data_base = this_data;
+        this_fb->frame.data = this_data;
+        this_fb->frame.data_buffer_len = fb_size;
+        this_fb->frame.data_len = 0;
 
-        // Add the frame to Queue of empty frames
-        const BaseType_t result = xQueueSend(uvc_stream->constant.empty_fb_queue, &this_fb, 0);
-        assert(pdPASS == result);
+        // Add the frame to ring of empty frames
+        const bool result = uvc_frame_ring_push(&uvc_stream->constant.empty_fb_ring, i);
+        assert(result);
+        (void)result;
     }
     return ESP_OK;
 
@@ -69,42 +560,230 @@ err:
     return ret;
 }
 
+esp_err_t uvc_frame_allocate_buffers(uvc_stream_t *uvc_stream, uint8_t *const *buffers, int nb_of_fb, size_t fb_size)
+{
+    UVC_CHECK(uvc_stream && buffers, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(nb_of_fb > 0 && fb_size > 0, ESP_ERR_INVALID_ARG);
+    // Frames must start at the beginning of the buffers, they cannot be shifted or sliced
+    UVC_CHECK(!uvc_stream->constant.fb_pool && !uvc_stream->constant.bulk_zero_copy, ESP_ERR_INVALID_ARG);
+    for (int i = 0; i < nb_of_fb; i++) {
+        UVC_CHECK(buffers[i], ESP_ERR_INVALID_ARG);
+    }
+
+    const esp_err_t ret = uvc_frame_rings_allocate(uvc_stream, nb_of_fb);
+    if (ret != ESP_OK) {
+        uvc_frame_free(uvc_stream);
+        return ret;
+    }
+    uvc_stream->constant.fb_user_memory = true;
+    for (int i = 0; i < nb_of_fb; i++) {
+        uvc_frame_t *this_fb = &uvc_stream->constant.fbs[i];
+        this_fb->data_base = buffers[i];
+        this_fb->frame.data = buffers[i];
+        this_fb->frame.data_buffer_len = fb_size;
+        this_fb->frame.data_len = 0;
+        const bool result = uvc_frame_ring_push(&uvc_stream->constant.empty_fb_ring, i);
+        assert(result);
+        (void)result;
+    }
+    return ESP_OK;
+}
+
 void uvc_frame_free(uvc_stream_t *uvc_stream)
 {
-    if (!uvc_stream || !uvc_stream->constant.empty_fb_queue) {
+    if (!uvc_stream || !uvc_stream->constant.fbs) {
         return;
     }
 
-    // Free all Frame Buffers and the Queue itself
-    uvc_host_frame_t *this_fb;
-    while (xQueueReceive(uvc_stream->constant.empty_fb_queue, &this_fb, 0) == pdPASS) {
-        free(this_fb->data);
-        free(this_fb);
+    // Free all Frame Buffers and the rings
+    if (uvc_stream->constant.fb_pool) {
+        if (!uvc_stream->constant.fb_user_memory) {
+            free(uvc_stream->constant.fb_pool_data);
+        }
+        free(uvc_stream->constant.fb_pool_slices);
+        uvc_stream->constant.fb_pool_data = NULL;
+        uvc_stream->constant.fb_pool_slices = NULL;
+    } else if (!uvc_stream->constant.fb_user_memory) {
+        for (unsigned i = 0; i < uvc_stream->constant.num_of_fbs; i++) {
+            free(uvc_stream->constant.fbs[i].data_base);
+        }
+    }
+    free(uvc_stream->constant.fbs);
+    uvc_frame_ring_deinit(&uvc_stream->constant.empty_fb_ring);
+    uvc_frame_ring_deinit(&uvc_stream->constant.filled_fb_ring);
+    if (uvc_stream->constant.filled_fb_sem) {
+        vSemaphoreDelete(uvc_stream->constant.filled_fb_sem);
+        uvc_stream->constant.filled_fb_sem = NULL;
     }
-    vQueueDelete(uvc_stream->constant.empty_fb_queue);
-    uvc_stream->constant.empty_fb_queue = NULL;
+    uvc_stream->constant.fbs = NULL;
+    uvc_stream->constant.num_of_fbs = 0;
+    uvc_stream->constant.fb_user_memory = false;
 }
 
 bool uvc_frame_are_all_returned(uvc_stream_t *uvc_stream)
 {
     UVC_CHECK(uvc_stream, false);
-    UVC_CHECK(uvc_stream->constant.empty_fb_queue, false);
+    UVC_CHECK(uvc_stream->constant.fbs, false);
 
     // In case the user returns 'false' from uvc_host_frame_callback_t, he must return the frame buffers with uvc_host_frame_return()
-    // Here we check whether all allocated frame buffers are in the 'empty_fb_queue'
-    const UBaseType_t uxSpacesAvailable = uxQueueSpacesAvailable(uvc_stream->constant.empty_fb_queue);
-    return (uxSpacesAvailable == 0);
+    // Here we check whether all allocated frame buffers are in the 'empty_fb_ring'
+    return (uvc_frame_ring_count(&uvc_stream->constant.empty_fb_ring) == uvc_stream->constant.num_of_fbs) && uvc_still_is_returned(uvc_stream);
 }
 
 uvc_host_frame_t *uvc_frame_get_empty(uvc_stream_t *uvc_stream)
 {
-    UVC_CHECK(uvc_stream, NULL);
-    uvc_host_frame_t *this_fb;
-    if (xQueueReceive(uvc_stream->constant.empty_fb_queue, &this_fb, 0) == pdPASS) {
-        return this_fb;
-    } else {
+    UVC_CHECK(uvc_stream && uvc_stream->constant.fbs, NULL);
+    uvc_host_frame_t *frame = uvc_frame_ring_pop_frame(uvc_stream, &uvc_stream->constant.empty_fb_ring);
+    if (frame == NULL) {
+        return NULL;
+    }
+    if (uvc_stream->constant.fb_pool && !uvc_frame_pool_take(uvc_stream, (uvc_frame_t *)frame)) {
+        // No free space in the pool, put the frame buffer back
+        const bool result = uvc_frame_ring_push(&uvc_stream->constant.empty_fb_ring, uvc_frame_index(uvc_stream, frame));
+        assert(result);
+        (void)result;
         return NULL;
     }
+
+    // Pick up the current format, if it changed since this frame buffer was used last time
+    uvc_frame_t *this_fb = (uvc_frame_t *)frame;
+    if (this_fb->vs_format_gen != UVC_ATOMIC_LOAD(uvc_stream->dynamic.vs_format_gen)) {
+        UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+        memcpy((uvc_host_stream_format_t *)&frame->vs_format, &uvc_stream->dynamic.vs_format, sizeof(uvc_host_stream_format_t));
+        this_fb->vs_format_gen = uvc_stream->dynamic.vs_format_gen;
+        this_fb->crop = uvc_stream->dynamic.crop;
+        if (this_fb->crop.line_len) {
+            // Cropped frames report resolution of the region
+            uvc_host_stream_format_t *frame_format = (uvc_host_stream_format_t *)&frame->vs_format;
+            frame_format->h_res = uvc_stream->constant.crop_width;
+            frame_format->v_res = uvc_stream->constant.crop_height;
+        }
+        UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    }
+    return frame;
+}
+
+bool uvc_frame_set_current(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    assert(uvc_stream && frame);
+    if (!UVC_ATOMIC_SET_IF_NULL(uvc_stream->dynamic.current_frame, frame)) {
+        uvc_host_frame_return(uvc_stream, frame);
+        return false;
+    }
+
+    // uvc_host_stream_pause() could miss the frame, if it was called just before it was set as current
+    if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+        uvc_host_frame_t *current_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+        if (current_frame) {
+            uvc_host_frame_return(uvc_stream, current_frame);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool uvc_frame_put_filled(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    assert(uvc_stream && frame);
+    if (uvc_stream->constant.filled_fb_policy == UVC_HOST_FRAME_QUEUE_LATEST) {
+        // The user gets only the latest frame, recycle the stale ones
+        uvc_host_frame_t *stale_frame;
+        while ((stale_frame = uvc_frame_get_filled(uvc_stream)) != NULL) {
+            uvc_stats_frame_dropped(uvc_stream, UVC_STATS_DROP_QUEUE_FULL);
+            uvc_host_frame_return(uvc_stream, stale_frame);
+        }
+    } else if (uvc_stream->constant.filled_fb_depth > 0 &&
+               uvc_frame_ring_count(&uvc_stream->constant.filled_fb_ring) >= uvc_stream->constant.filled_fb_depth) {
+        uvc_stats_frame_dropped(uvc_stream, UVC_STATS_DROP_QUEUE_FULL);
+        return false; // FIFO is full
+    }
+
+    if (!uvc_frame_ring_push(&uvc_stream->constant.filled_fb_ring, uvc_frame_index(uvc_stream, frame))) {
+        uvc_stats_frame_dropped(uvc_stream, UVC_STATS_DROP_QUEUE_FULL);
+        return false;
+    }
+    xSemaphoreGive(uvc_stream->constant.filled_fb_sem);
+    return true;
+}
+
+uvc_host_frame_t *uvc_frame_get_filled(uvc_stream_t *uvc_stream)
+{
+    UVC_CHECK(uvc_stream && uvc_stream->constant.fbs, NULL);
+    return uvc_frame_ring_pop_frame(uvc_stream, &uvc_stream->constant.filled_fb_ring);
+}
+
+esp_err_t uvc_host_frame_get(uvc_host_stream_hdl_t stream_hdl, unsigned long timeout, uvc_host_frame_t **frame_ret)
+{
+    UVC_CHECK(stream_hdl && frame_ret, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    UVC_CHECK(uvc_stream->constant.frame_cb == NULL, ESP_ERR_NOT_SUPPORTED);
+
+    TickType_t ticks_to_wait = timeout;
+    TimeOut_t time_out;
+    vTaskSetTimeOutState(&time_out);
+    while (1) {
+        *frame_ret = uvc_frame_get_filled(uvc_stream);
+        if (*frame_ret) {
+            uvc_stats_frame_delivered(uvc_stream);
+            return ESP_OK;
+        }
+        if (xTaskCheckForTimeOut(&time_out, &ticks_to_wait) == pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+        // The semaphore can be given for a frame that was already taken, so we check the ring again after it
+        xSemaphoreTake(uvc_stream->constant.filled_fb_sem, ticks_to_wait);
+    }
+}
+
+void uvc_frame_return_filled(uvc_stream_t *uvc_stream)
+{
+    assert(uvc_stream);
+    uvc_host_frame_t *frame;
+    while ((frame = uvc_frame_get_filled(uvc_stream)) != NULL) {
+        uvc_host_frame_return(uvc_stream, frame);
+    }
+}
+
+/**
+ * @brief Add only the bytes of data that lie in the region of interest of the frame
+ *
+ * @param[in] frame    Cropped frame buffer
+ * @param[in] data     Pointer to data
+ * @param[in] data_len Data length in bytes
+ * @return
+ *     - ESP_OK: Data added to the frame buffer
+ *     - ESP_ERR_INVALID_SIZE: Frame buffer overflow
+ */
+static esp_err_t uvc_frame_crop_add_data(uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
+{
+    uvc_frame_t *this_fb = (uvc_frame_t *)frame;
+    const uvc_frame_crop_t *crop = &this_fb->crop;
+    size_t received = this_fb->crop_received;
+    const uint8_t *p = data;
+    const uint8_t *const end = data + data_len;
+    this_fb->crop_received += data_len;
+
+    // Lines above the region are skipped at once
+    if (received < crop->start) {
+        const size_t skip = MIN(crop->start - received, data_len);
+        p += skip;
+        received += skip;
+    }
+    while (p < end && received < crop->end) {
+        const size_t column = received % crop->line_len;
+        const size_t chunk = MIN(crop->line_len - column, (size_t)(end - p)); // Up to the end of this line
+        const size_t copy_start = MAX(column, crop->x_offset);
+        const size_t copy_end = MIN(column + chunk, crop->x_offset + crop->width);
+        if (copy_start < copy_end) {
+            const size_t copy_len = copy_end - copy_start;
+            UVC_CHECK(frame->data_len + copy_len <= frame->data_buffer_len, ESP_ERR_INVALID_SIZE);
+            memcpy(frame->data + frame->data_len, p + (copy_start - column), copy_len);
+            frame->data_len += copy_len;
+        }
+        p += chunk;
+        received += chunk;
+    }
+    return ESP_OK;
 }
 
 esp_err_t uvc_frame_add_data(uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
@@ -113,23 +792,125 @@ esp_err_t uvc_frame_add_data(uvc_host_frame_t *frame, const uint8_t *data, size_
         return ESP_OK; // Fast return in case of zero data
     }
     UVC_CHECK(frame && data, ESP_ERR_INVALID_ARG);
+    if (((uvc_frame_t *)frame)->crop.line_len) {
+        return uvc_frame_crop_add_data(frame, data, data_len);
+    }
     UVC_CHECK(frame->data_len + data_len <= frame->data_buffer_len, ESP_ERR_INVALID_SIZE);
 
-    memcpy(frame->data + frame->data_len, data, data_len);
+    uint8_t *const frame_end = frame->data + frame->data_len;
+    if (data != frame_end) {
+        // Data received into this frame buffer (zero-copy) can overlap with the destination
+        memmove(frame_end, data, data_len);
+    }
     frame->data_len += data_len;
     return ESP_OK;
 }
 
-void uvc_frame_format_update(uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format)
+void uvc_frame_landing_release(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
 {
-    uvc_host_frame_t *this_frame = uvc_frame_get_empty(uvc_stream);
-    if (this_frame == NULL) {
+    if (frame == NULL) {
         return;
     }
-    memcpy((uvc_host_stream_format_t *)&this_frame->vs_format, vs_format, sizeof(uvc_host_stream_format_t));
+    uvc_frame_t *this_fb = (uvc_frame_t *)frame;
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    assert(this_fb->landed_xfers > 0);
+    this_fb->landed_xfers--;
+    const bool queue_frame = (this_fb->landed_xfers == 0 && this_fb->return_pending);
+    if (queue_frame) {
+        this_fb->return_pending = false;
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    if (queue_frame) {
+        const bool result = uvc_frame_ring_push(&uvc_stream->constant.empty_fb_ring, uvc_frame_index(uvc_stream, frame));
+        assert(result);
+        (void)result;
+    }
+}
+
+bool uvc_frame_mjpeg_check(uvc_stream_t *uvc_stream, const uvc_host_frame_t *frame)
+{
+    if (!uvc_stream->constant.mjpeg_check || frame->vs_format.format != UVC_VS_FORMAT_MJPEG) {
+        return true;
+    }
+
+    // Some cameras pad frames behind EOI with zeros
+    const uint8_t *data = frame->data;
+    size_t len = frame->data_len;
+    for (int i = 0; i < UVC_FRAME_MJPEG_MAX_PADDING && len > 0 && data[len - 1] == 0x00; i++) {
+        len--;
+    }
+    if (len < 4 || data[0] != 0xFF || data[1] != 0xD8 || data[len - 2] != 0xFF || data[len - 1] != 0xD9) {
+        return false; // Missing SOI or EOI
+    }
+
+    // Truncated frame can end with EOI by chance, it is much shorter than the previous frames
+    const unsigned format_gen = ((const uvc_frame_t *)frame)->vs_format_gen;
+    if (uvc_stream->single_thread.mjpeg_format_gen != format_gen) {
+        uvc_stream->single_thread.mjpeg_format_gen = format_gen;
+        uvc_stream->single_thread.mjpeg_avg_len = 0;
+    }
+    const size_t avg_len = uvc_stream->single_thread.mjpeg_avg_len;
+    // The average follows all frames with markers, so it adapts to scene changes
+    uvc_stream->single_thread.mjpeg_avg_len = (avg_len == 0) ? len : (size_t)((int64_t)avg_len + ((int64_t)len - (int64_t)avg_len) / (1 << UVC_FRAME_MJPEG_AVERAGE_SHIFT));
+    return len >= avg_len / UVC_FRAME_MJPEG_MIN_FRACTION;
+}
+
+bool uvc_frame_decimate(uvc_stream_t *uvc_stream)
+{
+    bool skip = false;
+    const unsigned every_nth = uvc_stream->constant.decimation_every_nth;
+    if (every_nth > 1) {
+        skip = (uvc_stream->single_thread.decimation_count++ % every_nth) != 0;
+    }
+
+    const int64_t interval = uvc_stream->constant.decimation_interval_us;
+    const int64_t now = uvc_stream->single_thread.xfer_receive_us;
+    if (interval > 0) {
+        // Frames arrive with jitter: frame that comes less than half of the camera frame interval early is kept
+        const int64_t last_sof = uvc_stream->single_thread.decimation_sof_us;
+        const int64_t tolerance = (last_sof != 0) ? (now - last_sof) / 2 : 0;
+        const int64_t next = uvc_stream->single_thread.decimation_next_us;
+        if (!skip && next != 0 && now + tolerance < next) {
+            skip = true;
+        } else if (!skip) {
+            // Keep the kept frames on a fixed grid, restart it after a gap longer than the interval
+            uvc_stream->single_thread.decimation_next_us = (next != 0 && now - next < interval) ? next + interval : now + interval;
+        }
+    }
+    uvc_stream->single_thread.decimation_sof_us = now;
+
+    if (skip) {
+        uvc_stats_frame_decimated(uvc_stream);
+    }
+    return skip;
+}
+
+void uvc_frame_format_update(uvc_stream_t *uvc_stream, const uvc_host_stream_format_t *vs_format)
+{
+    assert(uvc_stream && vs_format);
+
+    // Region of interest is cropped only from uncompressed pictures that contain it
+    uvc_frame_crop_t crop = {0};
+    const unsigned crop_width = uvc_stream->constant.crop_width;
+    if (crop_width && vs_format->format == UVC_VS_FORMAT_YUY2) {
+        if (uvc_stream->constant.crop_x + crop_width <= vs_format->h_res &&
+                uvc_stream->constant.crop_y + uvc_stream->constant.crop_height <= vs_format->v_res) {
+            const size_t bytes_per_pixel = 2;
+            crop.line_len = vs_format->h_res * bytes_per_pixel;
+            crop.x_offset = uvc_stream->constant.crop_x * bytes_per_pixel;
+            crop.width = crop_width * bytes_per_pixel;
+            crop.start = uvc_stream->constant.crop_y * crop.line_len;
+            crop.end = crop.start + uvc_stream->constant.crop_height * crop.line_len;
+        } else {
+            ESP_LOGW(TAG, "Crop region does not fit into %ux%u, frames are not cropped", vs_format->h_res, vs_format->v_res);
+        }
+    }
 
-    // Attention: recursive call!
-    // The recursive loop is broken once we run out of empty frame buffers
-    uvc_frame_format_update(uvc_stream, vs_format);
-    uvc_host_frame_return(uvc_stream, this_frame);
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    memcpy(&uvc_stream->dynamic.vs_format, vs_format, sizeof(uvc_host_stream_format_t));
+    uvc_stream->dynamic.crop = crop;
+    uvc_stream->dynamic.vs_format_gen++;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
 }
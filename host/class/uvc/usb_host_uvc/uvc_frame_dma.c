@@ -0,0 +1,126 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Copying of ISOC payloads into frame buffers by async memcpy DMA
+
+#include <string.h> // For memcpy
+#include <sys/param.h> // For MIN/MAX
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_cache.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "esp_async_memcpy.h"
+
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_frame_priv.h"
+#include "uvc_frame_dma_priv.h"
+
+static const char *TAG = "uvc-dma";
+
+#define UVC_FRAME_DMA_BACKLOG     (32)  // Maximum number of DMA copies in progress
+#define UVC_FRAME_DMA_MIN_LEN     (256) // Shorter data are copied by the CPU, setting up the DMA would take longer
+#define UVC_FRAME_DMA_MIN_ALIGN   (4)
+
+static bool IRAM_ATTR uvc_frame_dma_done(async_memcpy_handle_t mcp_hdl, async_memcpy_event_t *event, void *arg)
+{
+    BaseType_t task_woken = pdFALSE;
+    xSemaphoreGiveFromISR((SemaphoreHandle_t)arg, &task_woken);
+    return task_woken == pdTRUE;
+}
+
+esp_err_t uvc_frame_dma_install(uvc_stream_t *uvc_stream)
+{
+    esp_err_t ret;
+    UVC_CHECK(uvc_stream, ESP_ERR_INVALID_ARG);
+
+    // DMA copies start and end at cache line of the frame buffers, the CPU copies the unaligned rest
+    size_t align = 0;
+    esp_cache_get_alignment(MALLOC_CAP_SPIRAM, &align);
+    uvc_stream->constant.dma_copy_align = MAX(align, UVC_FRAME_DMA_MIN_ALIGN);
+
+    uvc_stream->constant.dma_copy_sem = xSemaphoreCreateCounting(UVC_FRAME_DMA_BACKLOG, 0);
+    UVC_CHECK(uvc_stream->constant.dma_copy_sem, ESP_ERR_NO_MEM);
+
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.backlog = UVC_FRAME_DMA_BACKLOG;
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 4, 0)
+    config.psram_trans_align = uvc_stream->constant.dma_copy_align;
+    config.sram_trans_align = UVC_FRAME_DMA_MIN_ALIGN;
+#endif
+    ESP_GOTO_ON_ERROR(esp_async_memcpy_install(&config, &uvc_stream->constant.dma_copy), err, TAG, "Could not install async memcpy");
+    uvc_stream->single_thread.dma_copy_pending = 0;
+    ESP_LOGD(TAG, "DMA copy installed, alignment %zu", uvc_stream->constant.dma_copy_align);
+    return ESP_OK;
+
+err:
+    vSemaphoreDelete(uvc_stream->constant.dma_copy_sem);
+    uvc_stream->constant.dma_copy_sem = NULL;
+    return ret;
+}
+
+void uvc_frame_dma_uninstall(uvc_stream_t *uvc_stream)
+{
+    assert(uvc_stream);
+    if (uvc_stream->constant.dma_copy) {
+        uvc_frame_dma_wait(uvc_stream);
+        esp_async_memcpy_uninstall(uvc_stream->constant.dma_copy);
+        uvc_stream->constant.dma_copy = NULL;
+    }
+    if (uvc_stream->constant.dma_copy_sem) {
+        vSemaphoreDelete(uvc_stream->constant.dma_copy_sem);
+        uvc_stream->constant.dma_copy_sem = NULL;
+    }
+}
+
+void uvc_frame_dma_wait(uvc_stream_t *uvc_stream)
+{
+    while (uvc_stream->single_thread.dma_copy_pending > 0) {
+        xSemaphoreTake(uvc_stream->constant.dma_copy_sem, portMAX_DELAY);
+        uvc_stream->single_thread.dma_copy_pending--;
+    }
+}
+
+esp_err_t uvc_frame_dma_add_data(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame, const uint8_t *data, size_t data_len)
+{
+    // Conversion stages and partial frame callback read the data right after they are added
+    if (!uvc_stream->constant.dma_copy || data_len < UVC_FRAME_DMA_MIN_LEN ||
+            uvc_stream->constant.data_cb || uvc_stream->constant.sink_cb || uvc_stream->constant.partial_cb ||
+            ((uvc_frame_t *)frame)->crop.line_len) {
+        return uvc_frame_add_data(frame, data, data_len);
+    }
+    UVC_CHECK(frame && data, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(frame->data_len + data_len <= frame->data_buffer_len, ESP_ERR_INVALID_SIZE);
+
+    // The CPU copies the unaligned head and tail, so the DMA and the CPU never write the same cache line
+    const size_t align = uvc_stream->constant.dma_copy_align;
+    uint8_t *const dst = frame->data + frame->data_len;
+    const size_t head = MIN((align - ((uintptr_t)dst & (align - 1))) & (align - 1), data_len);
+    const size_t body = (data_len - head) & ~(align - 1);
+    memcpy(dst, data, head);
+    bool dma_started = false;
+    if (body > 0) {
+        if (uvc_stream->single_thread.dma_copy_pending == UVC_FRAME_DMA_BACKLOG) {
+            uvc_frame_dma_wait(uvc_stream);
+        }
+        if (esp_ptr_external_ram(dst + head)) {
+            // Dirty cache lines must not be written back over the DMA data
+            esp_cache_msync(dst + head, body, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_INVALIDATE);
+        }
+        dma_started = (ESP_OK == esp_async_memcpy(uvc_stream->constant.dma_copy, dst + head, (void *)(data + head), body,
+                                                  uvc_frame_dma_done, uvc_stream->constant.dma_copy_sem));
+    }
+    if (dma_started) {
+        uvc_stream->single_thread.dma_copy_pending++;
+    } else {
+        memcpy(dst + head, data + head, body); // The DMA is busy, copy by the CPU
+    }
+    memcpy(dst + head + body, data + head + body, data_len - head - body);
+    frame->data_len += data_len;
+    return ESP_OK;
+}
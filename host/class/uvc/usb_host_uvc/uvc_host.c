@@ -21,6 +21,11 @@
 #include "uvc_esp_video.h"
 #include "uvc_types_priv.h"
 #include "uvc_frame_priv.h"
+#include "uvc_frame_dma_priv.h"
+#include "uvc_processing_priv.h"
+#include "uvc_stats_priv.h"
+#include "uvc_still_priv.h"
+#include "uvc_trace_priv.h"
 #include "uvc_descriptors_priv.h"
 #include "uvc_check_priv.h"
 #include "uvc_critical_priv.h"
@@ -34,6 +39,26 @@
 
 static const char *TAG = "uvc";
 
+// Optional enumeration profiler, marks are made only if the usb_host_enum_profiler component is linked
+void usb_host_enum_profiler_mark(uint8_t dev_addr, const char *driver, const char *phase) __attribute__((weak));
+#define UVC_ENUM_MARK(addr, phase)                               \
+    do {                                                         \
+        if (usb_host_enum_profiler_mark) {                       \
+            usb_host_enum_profiler_mark((addr), "uvc", (phase)); \
+        }                                                        \
+    } while(0)
+
+/**
+ * @brief Mark a phase of the USB device of the stream in the enumeration profiler
+ */
+static void uvc_enum_mark_stream(const uvc_stream_t *uvc_stream, const char *phase)
+{
+    usb_device_info_t dev_info;
+    if (usb_host_enum_profiler_mark && usb_host_device_info(uvc_stream->constant.dev_hdl, &dev_info) == ESP_OK) {
+        usb_host_enum_profiler_mark(dev_info.dev_addr, "uvc", phase);
+    }
+}
+
 // UVC spinlock
 portMUX_TYPE uvc_lock = portMUX_INITIALIZER_UNLOCKED;
 
@@ -42,10 +67,23 @@ portMUX_TYPE uvc_lock = portMUX_INITIALIZER_UNLOCKED;
 #define UVC_TEARDOWN          BIT1 // UVC is being uninstalled
 #define UVC_TEARDOWN_COMPLETE BIT2 // UVC uninstall finished
 
+// Periodic bandwidth of USB bus in bytes per millisecond
+// USB 2.0 specification reserves at most 90 % of FS frame and 80 % of HS microframe for periodic transfers
+#define UVC_PERIODIC_BANDWIDTH_FS (1500 * 90 / 100)
+#define UVC_PERIODIC_BANDWIDTH_HS (7500 * 80 / 100 * 8)
+
+// Automatic URB configuration
+#define UVC_URB_AUTO_DURATION_US  1000       // ISOC: Each URB covers 1 ms of (micro)frames
+#define UVC_URB_AUTO_SIZE_MAX     (16 * 1024) // Bulk: Upper limit of URB size
+#define UVC_URB_AUTO_NUMBER       3          // Triple buffering
+#define UVC_URB_AUTO_NUMBER_MAX   8          // Bulk: Upper limit of number of URBs for high data rates
+
 // Transfer callbacks
 static void ctrl_xfer_cb(usb_transfer_t *transfer);
 void isoc_transfer_callback(usb_transfer_t *transfer);
 void bulk_transfer_callback(usb_transfer_t *transfer);
+bool isoc_transfer_process(usb_transfer_t *transfer);
+bool bulk_transfer_process(usb_transfer_t *transfer);
 
 // UVC driver object
 typedef struct {
@@ -53,17 +91,131 @@ typedef struct {
     SemaphoreHandle_t open_close_mutex;         /*!< Protects list of opened devices from concurrent access */
     EventGroupHandle_t driver_status;           /*!< Holds status of the driver */
     usb_transfer_t *ctrl_transfer;              /*!< CTRL (endpoint 0) transfer */
-    SemaphoreHandle_t ctrl_mutex;               /*!< CTRL mutex */
+    SemaphoreHandle_t ctrl_mutex;               /*!< CTRL mutex. Recursive, so a sequence of CTRL transfers can be issued under one lock */
     uvc_host_driver_event_callback_t user_cb;   /*!< Callback function to handle events */
     void *user_ctx;
     SLIST_HEAD(list_dev, uvc_host_stream_s) uvc_stream_list;   /*!< List of open streams */
+    SLIST_HEAD(list_desc, uvc_desc_cache_s) desc_cache_list;   /*!< Pre-parsed descriptors of connected devices */
 } uvc_host_driver_t;
 
 static uvc_host_driver_t *p_uvc_host_driver = NULL;
 
-static esp_err_t uvc_host_interface_check(uint8_t addr, const usb_config_desc_t *config_desc)
+/**
+ * @brief Release reference of pre-parsed descriptors
+ *
+ * The descriptors are freed with the last reference.
+ *
+ * @param[in] desc_cache Cached descriptors, can be NULL
+ */
+static void uvc_desc_cache_release(uvc_desc_cache_t *desc_cache)
+{
+    if (!desc_cache) {
+        return;
+    }
+    UVC_ENTER_CRITICAL();
+    const unsigned refs = --desc_cache->refs;
+    UVC_EXIT_CRITICAL();
+    if (refs == 0) {
+        uvc_desc_index_delete(desc_cache->index);
+        free(desc_cache);
+    }
+}
+
+/**
+ * @brief Drop cached descriptors of device with given address
+ *
+ * Streams of the device can still hold the descriptors, they are freed with the last stream.
+ *
+ * @param[in] dev_addr Device address
+ */
+static void uvc_desc_cache_remove(uint8_t dev_addr)
+{
+    uvc_desc_cache_t *stale = NULL;
+    UVC_ENTER_CRITICAL();
+    SLIST_FOREACH(stale, &p_uvc_host_driver->desc_cache_list, list_entry) {
+        if (stale->dev_addr == dev_addr) {
+            SLIST_REMOVE(&p_uvc_host_driver->desc_cache_list, stale, uvc_desc_cache_s, list_entry);
+            break;
+        }
+    }
+    UVC_EXIT_CRITICAL();
+    uvc_desc_cache_release(stale);
+}
+
+/**
+ * @brief Pre-parse descriptors of connected device and add them to the cache
+ *
+ * Cached descriptors of previous device with the same address are dropped.
+ *
+ * @param[in]  dev_addr       Device address
+ * @param[in]  cfg_desc       Active configuration descriptor of the device
+ * @param[out] desc_cache_ret Cached descriptors, with reference of the caller. Can be NULL
+ * @return
+ *     - ESP_OK:         Success
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+static esp_err_t uvc_desc_cache_add(uint8_t dev_addr, const usb_config_desc_t *cfg_desc, uvc_desc_cache_t **desc_cache_ret)
+{
+    uvc_desc_cache_remove(dev_addr);
+
+    uvc_desc_cache_t *desc_cache = calloc(1, sizeof(uvc_desc_cache_t));
+    UVC_CHECK(desc_cache, ESP_ERR_NO_MEM);
+    if (uvc_desc_index_create(cfg_desc, &desc_cache->index) != ESP_OK) {
+        free(desc_cache);
+        return ESP_ERR_NO_MEM;
+    }
+    desc_cache->dev_addr = dev_addr;
+    desc_cache->refs = desc_cache_ret ? 2 : 1; // Cache list and the caller
+
+    UVC_ENTER_CRITICAL();
+    SLIST_INSERT_HEAD(&p_uvc_host_driver->desc_cache_list, desc_cache, list_entry);
+    UVC_EXIT_CRITICAL();
+
+    if (desc_cache_ret) {
+        *desc_cache_ret = desc_cache;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Get pre-parsed descriptors of opened device
+ *
+ * The descriptors are normally parsed on device connection. They are parsed now if the cache misses them.
+ *
+ * @param[in]  dev_hdl        USB device handle
+ * @param[out] desc_cache_ret Cached descriptors. Release them with uvc_desc_cache_release()
+ * @return
+ *     - ESP_OK:         Success
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ */
+static esp_err_t uvc_desc_cache_acquire(usb_device_handle_t dev_hdl, uvc_desc_cache_t **desc_cache_ret)
 {
-    assert(config_desc);
+    const usb_config_desc_t *cfg_desc;
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(dev_hdl, &cfg_desc));
+    ESP_ERROR_CHECK(usb_host_device_info(dev_hdl, &dev_info));
+
+    uvc_desc_cache_t *current;
+    UVC_ENTER_CRITICAL();
+    SLIST_FOREACH(current, &p_uvc_host_driver->desc_cache_list, list_entry) {
+        // Configuration descriptor identifies the connection, address can be reused by another device
+        if (current->dev_addr == dev_info.dev_addr && current->index->cfg_desc == cfg_desc) {
+            current->refs++;
+            break;
+        }
+    }
+    UVC_EXIT_CRITICAL();
+
+    if (current) {
+        *desc_cache_ret = current;
+        return ESP_OK;
+    }
+    return uvc_desc_cache_add(dev_info.dev_addr, cfg_desc, desc_cache_ret);
+}
+
+static esp_err_t uvc_host_interface_check(uint8_t addr, const usb_config_desc_t *config_desc, const uvc_desc_index_t *desc_index)
+{
+    assert(config_desc && desc_index);
     size_t total_length = config_desc->wTotalLength;
     int iface_offset = 0;
     bool is_uvc_interface = false;
@@ -80,7 +232,7 @@ static esp_err_t uvc_host_interface_check(uint8_t addr, const usb_config_desc_t
 
             if (p_uvc_host_driver->user_cb) {
                 size_t frame_info_num = 0;
-                if (uvc_desc_get_frame_list(config_desc, uvc_stream_index, NULL, &frame_info_num) != ESP_OK) {
+                if (uvc_desc_index_get_frame_list(desc_index, uvc_stream_index, NULL, &frame_info_num) != ESP_OK) {
                     ESP_LOGE(TAG, "Failed to get frame list for uvc_stream_index %d", uvc_stream_index);
                     return ESP_FAIL;
                 }
@@ -116,6 +268,9 @@ static esp_err_t uvc_host_device_connected(uint8_t addr)
         if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK) {
             is_uvc_device = uvc_desc_is_uvc_device(config_desc);
         }
+        if (is_uvc_device) {
+            UVC_ENUM_MARK(addr, "class_check");
+        }
         ESP_RETURN_ON_ERROR(usb_host_device_close(p_uvc_host_driver->usb_client_hdl, dev_hdl), TAG, "Unable to close USB device");
     }
 
@@ -124,9 +279,18 @@ static esp_err_t uvc_host_device_connected(uint8_t addr)
 #ifdef CONFIG_PRINTF_UVC_CONFIGURATION_DESCRIPTOR
         usb_print_config_descriptor(config_desc, &uvc_print_desc);
 #endif
+        // Parse the descriptors once, all following lookups use the index
+        uvc_desc_cache_t *desc_cache;
+        ESP_RETURN_ON_ERROR(uvc_desc_cache_add(addr, config_desc, &desc_cache), TAG, "Could not index descriptors");
+        UVC_ENUM_MARK(addr, "descriptors");
+
         // Create Interfaces list for a possibility to claim Interface
-        ESP_RETURN_ON_ERROR(uvc_host_interface_check(addr, config_desc), TAG, "uvc stream interface not found");
+        const esp_err_t ret = uvc_host_interface_check(addr, config_desc, desc_cache->index);
+        uvc_desc_cache_release(desc_cache);
+        ESP_RETURN_ON_ERROR(ret, TAG, "uvc stream interface not found");
+        UVC_ENUM_MARK(addr, "connected");
     } else {
+        uvc_desc_cache_remove(addr);
         ESP_LOGW(TAG, "USB device with addr(%d) is not UVC device", addr);
     }
 
@@ -146,6 +310,7 @@ static void usb_event_cb(const usb_host_client_event_msg_t *event_msg, void *arg
     switch (event_msg->event) {
     case USB_HOST_CLIENT_EVENT_NEW_DEV:
         ESP_LOGD(TAG, "New device connected");
+        UVC_ENUM_MARK(event_msg->new_dev.address, "new_dev");
         uvc_host_device_connected(event_msg->new_dev.address);
         break;
     case USB_HOST_CLIENT_EVENT_DEV_GONE: {
@@ -227,9 +392,18 @@ static void uvc_transfers_free(uvc_stream_t *uvc_stream)
 {
     assert(uvc_stream);
     for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
-        usb_host_transfer_free(uvc_stream->constant.xfers[i]);
+        if (uvc_stream->constant.xfer_buffers) {
+            // Zero-copy: the transfer can point to a frame buffer, restore its own buffer before freeing it
+            uint8_t **ptr = (uint8_t **)(&(uvc_stream->constant.xfers[i]->data_buffer));
+            *ptr = uvc_stream->constant.xfer_buffers[i];
+        }
+        USB_HOST_XFER_POOL_FREE(uvc_stream->constant.xfers[i]);
     }
     free(uvc_stream->constant.xfers);
+    free(uvc_stream->constant.xfer_buffers);
+    free(uvc_stream->single_thread.xfer_landing);
+    uvc_stream->constant.xfer_buffers = NULL;
+    uvc_stream->single_thread.xfer_landing = NULL;
 }
 
 /**
@@ -273,10 +447,20 @@ static esp_err_t uvc_transfers_allocate(uvc_stream_t *uvc_stream, unsigned num_o
     uvc_stream->constant.xfers = malloc(num_of_transfers * sizeof(usb_transfer_t *));
     UVC_CHECK(uvc_stream->constant.xfers, ESP_ERR_NO_MEM);
 
+    // Zero-copy: keep original buffers of the transfers, as the transfers are redirected to frame buffers
+    if (uvc_stream->constant.bulk_zero_copy) {
+        uvc_stream->constant.xfer_buffers = calloc(num_of_transfers, sizeof(uint8_t *));
+        uvc_stream->single_thread.xfer_landing = calloc(num_of_transfers, sizeof(uvc_host_frame_t *));
+        if (!uvc_stream->constant.xfer_buffers || !uvc_stream->single_thread.xfer_landing) {
+            ret = ESP_ERR_NO_MEM;
+            goto err;
+        }
+    }
+
     // Allocate and init all the transfers
     for (unsigned i = 0; i < num_of_transfers; i++) {
         ESP_GOTO_ON_ERROR(
-            usb_host_transfer_alloc(transfer_size, num_isoc_packets, &uvc_stream->constant.xfers[i]),
+            USB_HOST_XFER_POOL_ALLOC(transfer_size, num_isoc_packets, &uvc_stream->constant.xfers[i]),
             err, TAG, "Could not allocate USB transfers");
 
         uvc_stream->constant.num_of_xfers++;
@@ -285,14 +469,19 @@ static esp_err_t uvc_transfers_allocate(uvc_stream_t *uvc_stream, unsigned num_o
         this_transfer->context = uvc_stream;
         this_transfer->timeout_ms = 1000;
         this_transfer->bEndpointAddress = ep_desc->bEndpointAddress;
+        if (uvc_stream->constant.xfer_buffers) {
+            uvc_stream->constant.xfer_buffers[i] = this_transfer->data_buffer;
+        }
 
         if (is_isoc) {
+            uvc_stream->constant.xfer_process = isoc_transfer_process;
             this_transfer->callback = isoc_transfer_callback;
             this_transfer->num_bytes = num_isoc_packets * max_packet_size;
             for (unsigned j = 0; j < num_isoc_packets; j++) {
                 this_transfer->isoc_packet_desc[j].num_bytes = max_packet_size;
             }
         } else {
+            uvc_stream->constant.xfer_process = bulk_transfer_process;
             this_transfer->callback = bulk_transfer_callback;
             this_transfer->num_bytes = transfer_size;
         }
@@ -304,6 +493,61 @@ err:
     return ret;
 }
 
+/**
+ * @brief Derive number and size of URBs from the negotiated format
+ *
+ * ISOC: One URB covers UVC_URB_AUTO_DURATION_US of service intervals of the claimed alternate setting,
+ *       the endpoint is already sized by the negotiated payload.
+ * Bulk: URB holds one payload transfer, but no more than the data of UVC_URB_AUTO_DURATION_US at the target FPS.
+ *       Streams with high data rate get additional URBs, low FPS streams do not waste RAM.
+ *
+ * @param[in]     uvc_stream     Pointer to UVC stream
+ * @param[in]     ep_desc        Descriptor of the streaming endpoint
+ * @param[in]     vs_result      Result of format negotiation
+ * @param[in]     fps            Negotiated FPS
+ * @param[in,out] number_of_urbs Number of URBs. Derived if 0
+ * @param[in,out] urb_size       Size of 1 URB. Derived if 0
+ */
+static void uvc_transfers_auto_config(uvc_stream_t *uvc_stream, const usb_ep_desc_t *ep_desc, const uvc_vs_ctrl_t *vs_result, float fps,
+                                      int *number_of_urbs, size_t *urb_size)
+{
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_device_info(uvc_stream->constant.dev_hdl, &dev_info));
+    const bool high_speed = (dev_info.speed == USB_SPEED_HIGH);
+    const uint32_t mps = USB_EP_DESC_GET_MPS(ep_desc);
+    size_t size;
+    int number = UVC_URB_AUTO_NUMBER;
+
+    if (USB_EP_DESC_GET_XFERTYPE(ep_desc) == USB_BM_ATTRIBUTES_XFER_ISOC) {
+        const uint8_t bInterval = (ep_desc->bInterval < 1) ? 1 : ((ep_desc->bInterval > 16) ? 16 : ep_desc->bInterval);
+        const uint32_t interval_us = (high_speed ? 125 : 1000) << (bInterval - 1);
+        const uint32_t num_of_packets = (interval_us < UVC_URB_AUTO_DURATION_US) ? (UVC_URB_AUTO_DURATION_US / interval_us) : 1;
+        size = num_of_packets * mps * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+    } else {
+        // Data rate of the stream, in worst case every frame has dwMaxVideoFrameSize
+        const float bytes_per_duration = (float)vs_result->dwMaxVideoFrameSize * ((fps > 0) ? fps : 30) * UVC_URB_AUTO_DURATION_US / 1000000;
+        size = (vs_result->dwMaxPayloadTransferSize > 0) ? vs_result->dwMaxPayloadTransferSize : UVC_URB_AUTO_SIZE_MAX;
+        if (bytes_per_duration > 0 && size > bytes_per_duration) {
+            size = (size_t)bytes_per_duration;
+        }
+        if (size > UVC_URB_AUTO_SIZE_MAX) {
+            // One URB cannot keep up with the data rate, add more of them
+            const float needed = bytes_per_duration * UVC_URB_AUTO_NUMBER / UVC_URB_AUTO_SIZE_MAX;
+            number = (needed > UVC_URB_AUTO_NUMBER_MAX) ? UVC_URB_AUTO_NUMBER_MAX : ((needed > UVC_URB_AUTO_NUMBER) ? (int)needed : UVC_URB_AUTO_NUMBER);
+            size = UVC_URB_AUTO_SIZE_MAX;
+        }
+        size = usb_round_up_to_mps(size > mps ? size : mps, mps);
+    }
+
+    if (*number_of_urbs <= 0) {
+        *number_of_urbs = number;
+    }
+    if (*urb_size == 0) {
+        *urb_size = size;
+    }
+    ESP_LOGD(TAG, "Auto URB config: %d URBs of %zu bytes", *number_of_urbs, *urb_size);
+}
+
 /**
  * @brief Helper function that releases resources claimed by UVC device
  *
@@ -315,10 +559,17 @@ err:
 static void uvc_device_remove(uvc_stream_t *uvc_stream)
 {
     assert(uvc_stream);
+    uvc_processing_task_delete(uvc_stream);
     uvc_transfers_free(uvc_stream);
+#if UVC_FRAME_DMA_COPY
+    uvc_frame_dma_uninstall(uvc_stream);
+#endif
     uvc_frame_free(uvc_stream);
+    uvc_still_free(uvc_stream);
+    uvc_host_stream_control_cache_free(uvc_stream);
     // We don't check the error code of usb_host_device_close, as the close might fail, if someone else is still using the device (not all interfaces are released)
     usb_host_device_close(p_uvc_host_driver->usb_client_hdl, uvc_stream->constant.dev_hdl); // Gracefully continue on error
+    uvc_desc_cache_release(uvc_stream->constant.desc_cache);
     free(uvc_stream);
 }
 
@@ -348,6 +599,7 @@ static esp_err_t uvc_find_and_open_usb_device(uint8_t dev_addr, uint16_t vid, ui
     if (*dev == NULL) {
         return ESP_ERR_NO_MEM;
     }
+    portMUX_INITIALIZE(&(*dev)->lock);
 
     // First, check list of already opened UVC devices
     ESP_LOGD(TAG, "Checking list of opened USB devices");
@@ -437,46 +689,149 @@ static inline esp_err_t uvc_set_interface(uvc_host_stream_hdl_t stream_hdl, bool
 }
 
 /**
- * @brief Find and claim interface for selected frame format
+ * @brief Find streaming interface for selected frame format
  *
- * @param[in]  uvc_stream  Pointer to UVC stream
- * @param[in]  uvc_index   Index of UVC function you want to use
- * @param[in]  vs_format   Desired frame format
- * @param[out] ep_desc_ret EP descriptor for this stream
+ * @param[in] uvc_stream Pointer to UVC stream
+ * @param[in] uvc_index  Index of UVC function you want to use
+ * @param[in] vs_format  Desired frame format
  * @return
- *     - ESP_OK:              Success, interface found and claimed
+ *     - ESP_OK:              Success, interface found
  *     - ESP_ERR_INVALID_ARG: Input parameter is NULL
  *     - ESP_ERR_NOT_FOUND:   Selected format was not found
- *     - Other:               Error during interface claim
  */
-static esp_err_t uvc_claim_interface(uvc_stream_t *uvc_stream, uint8_t uvc_index, const uvc_host_stream_format_t *vs_format, const usb_ep_desc_t **ep_desc_ret)
+static esp_err_t uvc_find_interface(uvc_stream_t *uvc_stream, uint8_t uvc_index, const uvc_host_stream_format_t *vs_format)
 {
-    UVC_CHECK(uvc_stream && vs_format && ep_desc_ret, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(uvc_stream && vs_format, ESP_ERR_INVALID_ARG);
 
-    const usb_config_desc_t *cfg_desc;
-    const usb_intf_desc_t *intf_desc;
-    const usb_ep_desc_t *ep_desc;
-    ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(uvc_stream->constant.dev_hdl, &cfg_desc));
+    // The stream holds pre-parsed descriptors of its device until it is removed
+    if (!uvc_stream->constant.desc_cache) {
+        ESP_RETURN_ON_ERROR(uvc_desc_cache_acquire(uvc_stream->constant.dev_hdl, &uvc_stream->constant.desc_cache), TAG, "Could not index descriptors");
+    }
 
     // Find UVC USB function with desired index
     uint16_t bcdUVC = 0;
     uint8_t bInterfaceNumber = 0;
 
     ESP_RETURN_ON_ERROR(
-        uvc_desc_get_streaming_interface_num(cfg_desc, uvc_index, vs_format, &bcdUVC, &bInterfaceNumber),
+        uvc_desc_index_get_streaming_interface_num(uvc_stream->constant.desc_cache->index, uvc_index, vs_format, &bcdUVC, &bInterfaceNumber),
         TAG, "Could not find frame format %dx%d@%2.1fFPS",
         vs_format->h_res, vs_format->v_res, vs_format->fps);
 
+    // Save constant information needed for format negotiation
+    uvc_stream->constant.bInterfaceNumber   = bInterfaceNumber;
+    uvc_stream->constant.bcdUVC             = bcdUVC;
+    uvc_stream->constant.uvc_index          = uvc_index;
+    uvc_stream->constant.bControlInterfaceNumber = uvc_stream->constant.desc_cache->index->vc_interfaces[uvc_index];
+    uvc_stream->constant.vc_clock_frequency = uvc_stream->constant.desc_cache->index->vc_headers[uvc_index]->dwClockFrequency;
+    return ESP_OK;
+}
+
+/**
+ * @brief Get periodic bandwidth not reserved by opened streams
+ *
+ * @note The caller must hold open_close_mutex, so the reservations do not change
+ * @param[in] high_speed Budget of High Speed bus
+ * @return Free bandwidth in bytes per millisecond
+ */
+static uint32_t uvc_bandwidth_free(bool high_speed)
+{
+    uint32_t reserved = 0;
+    uvc_stream_t *uvc_stream;
+    UVC_ENTER_CRITICAL();
+    SLIST_FOREACH(uvc_stream, &p_uvc_host_driver->uvc_stream_list, list_entry) {
+        reserved += uvc_stream->constant.periodic_bandwidth;
+    }
+    UVC_EXIT_CRITICAL();
+
+    const uint32_t total = high_speed ? UVC_PERIODIC_BANDWIDTH_HS : UVC_PERIODIC_BANDWIDTH_FS;
+    return (reserved < total) ? (total - reserved) : 0;
+}
+
+/**
+ * @brief Plan bandwidth of streaming interface
+ *
+ * Picks the alternate setting with the smallest endpoint that offers dwMaxPayloadTransferSize
+ * and fits into periodic bandwidth that is not reserved by opened streams.
+ *
+ * @note The caller must hold open_close_mutex
+ * @param[in]  dev_hdl                  USB device handle
+ * @param[in]  desc_index               Pre-parsed descriptors of the device
+ * @param[in]  bInterfaceNumber         Streaming interface
+ * @param[in]  dwMaxPayloadTransferSize Payload size requested by the device. 0 if unknown
+ * @param[in]  bandwidth_limit          Maximum bandwidth the stream may reserve in bytes per millisecond. 0 for no limit
+ * @param[out] intf_desc_ret            Interface descriptor of the alternate setting
+ * @param[out] ep_desc_ret              EP descriptor of the alternate setting
+ * @param[out] high_speed_ret           The device is connected at High Speed
+ * @return
+ *     - ESP_OK:                Success
+ *     - ESP_ERR_NOT_SUPPORTED: Not enough free periodic bandwidth
+ *     - ESP_ERR_NOT_FOUND:     No suitable alternate setting
+ */
+static esp_err_t uvc_bandwidth_plan(usb_device_handle_t dev_hdl, const uvc_desc_index_t *desc_index, uint8_t bInterfaceNumber,
+                                    uint32_t dwMaxPayloadTransferSize, uint32_t bandwidth_limit,
+                                    const usb_intf_desc_t **intf_desc_ret, const usb_ep_desc_t **ep_desc_ret, bool *high_speed_ret)
+{
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_device_info(dev_hdl, &dev_info));
+    const bool high_speed = (dev_info.speed == USB_SPEED_HIGH);
+    *high_speed_ret = high_speed;
+
+    if (dwMaxPayloadTransferSize == 0) {
+        // The device did not tell us its needs: use the largest endpoint as before, without limiting other streams
+        return uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(desc_index, bInterfaceNumber, UINT32_MAX, MAX_MPS_IN, high_speed,
+                bandwidth_limit ? bandwidth_limit : UINT32_MAX, intf_desc_ret, ep_desc_ret);
+    }
+
+    const uint32_t free_bandwidth = uvc_bandwidth_free(high_speed);
+    const bool limited_by_user = (bandwidth_limit > 0 && bandwidth_limit < free_bandwidth);
+    esp_err_t ret = uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(
+                        desc_index, bInterfaceNumber, dwMaxPayloadTransferSize, MAX_MPS_IN, high_speed,
+                        limited_by_user ? bandwidth_limit : free_bandwidth, intf_desc_ret, ep_desc_ret);
+    if (ret == ESP_ERR_NOT_SUPPORTED && limited_by_user) {
+        // User accepts less bandwidth than the device requested: use the largest endpoint within the limit
+        ret = uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(desc_index, bInterfaceNumber, UINT32_MAX, MAX_MPS_IN, high_speed,
+                bandwidth_limit, intf_desc_ret, ep_desc_ret);
+    }
+    return ret;
+}
+
+/**
+ * @brief Claim streaming interface with alternate setting that fits the negotiated format
+ *
+ * @note The caller must hold open_close_mutex
+ * @param[in]  uvc_stream               Pointer to UVC stream with found streaming interface, see uvc_find_interface()
+ * @param[in]  dwMaxPayloadTransferSize Payload size requested by the device. 0 if unknown
+ * @param[in]  bandwidth_limit          Maximum bandwidth the stream may reserve in bytes per millisecond. 0 for no limit
+ * @param[out] ep_desc_ret              EP descriptor for this stream
+ * @return
+ *     - ESP_OK:                Success, interface claimed
+ *     - ESP_ERR_INVALID_ARG:   Input parameter is NULL
+ *     - ESP_ERR_NOT_SUPPORTED: Not enough free periodic bandwidth
+ *     - ESP_ERR_NOT_FOUND:     No suitable alternate setting
+ *     - Other:                 Error during interface claim
+ */
+static esp_err_t uvc_claim_interface(uvc_stream_t *uvc_stream, uint32_t dwMaxPayloadTransferSize, uint32_t bandwidth_limit, const usb_ep_desc_t **ep_desc_ret)
+{
+    UVC_CHECK(uvc_stream && ep_desc_ret, ESP_ERR_INVALID_ARG);
+
+    const usb_intf_desc_t *intf_desc;
+    const usb_ep_desc_t *ep_desc;
+    bool high_speed = false;
+    const uint8_t bInterfaceNumber = uvc_stream->constant.bInterfaceNumber;
+
     ESP_RETURN_ON_ERROR(
-        uvc_desc_get_streaming_intf_and_ep(cfg_desc, bInterfaceNumber, MAX_MPS_IN, &intf_desc, &ep_desc),
-        TAG, "Could not find Streaming interface %d", bInterfaceNumber);
+        uvc_bandwidth_plan(uvc_stream->constant.dev_hdl, uvc_stream->constant.desc_cache->index, bInterfaceNumber, dwMaxPayloadTransferSize, bandwidth_limit, &intf_desc, &ep_desc, &high_speed),
+        TAG, "Could not find Streaming interface %d with payload %"PRIu32" B, %"PRIu32" B/ms of periodic bandwidth is free",
+        bInterfaceNumber, dwMaxPayloadTransferSize, uvc_bandwidth_free(high_speed));
 
     // Save all constant information about the UVC stream
-    uvc_stream->constant.bInterfaceNumber  = bInterfaceNumber;
-    uvc_stream->constant.bcdUVC            = bcdUVC;
-    uvc_stream->constant.bAlternateSetting = intf_desc->bAlternateSetting;
-    uvc_stream->constant.bEndpointAddress  = ep_desc->bEndpointAddress;
-    *ep_desc_ret                           = ep_desc;
+    uvc_stream->constant.bAlternateSetting  = intf_desc->bAlternateSetting;
+    uvc_stream->constant.bEndpointAddress   = ep_desc->bEndpointAddress;
+    uvc_stream->constant.periodic_bandwidth = uvc_desc_get_ep_bandwidth(ep_desc, high_speed);
+    uvc_stream->constant.max_payload_size   = USB_EP_DESC_GET_MPS(ep_desc) * (USB_EP_DESC_GET_MULT(ep_desc) + 1);
+    *ep_desc_ret                            = ep_desc;
+    ESP_LOGD(TAG, "Interface %d-%d reserves %"PRIu32" B/ms for payload %"PRIu32" B",
+             bInterfaceNumber, intf_desc->bAlternateSetting, uvc_stream->constant.periodic_bandwidth, dwMaxPayloadTransferSize);
 
     // Claim the interface in USB Host Lib
     return usb_host_interface_claim(
@@ -506,10 +861,10 @@ esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config)
     uvc_host_driver_t *uvc_obj = heap_caps_calloc(1, sizeof(uvc_host_driver_t), MALLOC_CAP_DEFAULT);
     EventGroupHandle_t driver_status = xEventGroupCreate();
     SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
-    SemaphoreHandle_t ctrl_mutex = xSemaphoreCreateMutex();
+    SemaphoreHandle_t ctrl_mutex = xSemaphoreCreateRecursiveMutex();
     SemaphoreHandle_t ctrl_sem = xSemaphoreCreateBinary();
     usb_transfer_t *ctrl_xfer = NULL;
-    usb_host_transfer_alloc(64, 0, &ctrl_xfer); // Worst case HS MPS
+    USB_HOST_XFER_POOL_ALLOC(64, 0, &ctrl_xfer); // Worst case HS MPS
     TaskHandle_t driver_task_h = NULL;
 
     if (driver_config->create_background_task) {
@@ -536,6 +891,7 @@ esp_err_t uvc_host_install(const uvc_host_driver_config_t *driver_config)
 
     // Initialize UVC driver structure
     SLIST_INIT(&(uvc_obj->uvc_stream_list));
+    SLIST_INIT(&(uvc_obj->desc_cache_list));
     uvc_obj->driver_status = driver_status;
     uvc_obj->open_close_mutex = mutex;
     uvc_obj->usb_client_hdl = usb_client;
@@ -578,7 +934,7 @@ err: // Clean-up
         vSemaphoreDelete(ctrl_mutex);
     }
     if (ctrl_xfer) {
-        usb_host_transfer_free(ctrl_xfer);
+        USB_HOST_XFER_POOL_FREE(ctrl_xfer);
     }
     if (ctrl_sem) {
         vSemaphoreDelete(ctrl_sem);
@@ -593,7 +949,7 @@ esp_err_t uvc_host_uninstall()
     UVC_CHECK(uvc_obj, ESP_ERR_INVALID_STATE);
 
     xSemaphoreTake(uvc_obj->open_close_mutex, portMAX_DELAY); // Wait for all open/close calls to finish
-    xSemaphoreTake(uvc_obj->ctrl_mutex, portMAX_DELAY); // Wait for all CTRL transfers to finish
+    xSemaphoreTakeRecursive(uvc_obj->ctrl_mutex, portMAX_DELAY); // Wait for all CTRL transfers to finish
 
     UVC_ENTER_CRITICAL();
     if (SLIST_EMPTY(&uvc_obj->uvc_stream_list)) { // Check that device list is empty (all devices closed)
@@ -620,25 +976,31 @@ esp_err_t uvc_host_uninstall()
     ESP_LOGD(TAG, "Deregistering client");
     ESP_ERROR_CHECK(usb_host_client_deregister(uvc_obj->usb_client_hdl));
 
-    // Free remaining resources and return
+    // Free remaining resources and return. All streams are closed, so only the cache holds the descriptors
+    while (!SLIST_EMPTY(&uvc_obj->desc_cache_list)) {
+        uvc_desc_cache_t *desc_cache = SLIST_FIRST(&uvc_obj->desc_cache_list);
+        SLIST_REMOVE_HEAD(&uvc_obj->desc_cache_list, list_entry);
+        uvc_desc_index_delete(desc_cache->index);
+        free(desc_cache);
+    }
     vEventGroupDelete(uvc_obj->driver_status);
     xSemaphoreGive(uvc_obj->open_close_mutex);
     vSemaphoreDelete(uvc_obj->open_close_mutex);
-    xSemaphoreGive(uvc_obj->ctrl_mutex);
+    xSemaphoreGiveRecursive(uvc_obj->ctrl_mutex);
     vSemaphoreDelete(uvc_obj->ctrl_mutex);
     vSemaphoreDelete(uvc_obj->ctrl_transfer->context);
-    usb_host_transfer_free(uvc_obj->ctrl_transfer);
+    USB_HOST_XFER_POOL_FREE(uvc_obj->ctrl_transfer);
     free(uvc_obj);
     return ESP_OK;
 
 unblock:
     xSemaphoreGive(uvc_obj->open_close_mutex);
-    xSemaphoreGive(uvc_obj->ctrl_mutex);
+    xSemaphoreGiveRecursive(uvc_obj->ctrl_mutex);
     return ret;
 }
 
 /**
- * @brief Saves format to stream handle and all its frame buffers
+ * @brief Saves format to stream handle and its frame buffers
  *
  * @param[in] uvc_stream Stream handle
  * @param[in] vs_format  Format to save
@@ -648,14 +1010,11 @@ static void uvc_format_save(uvc_stream_t *uvc_stream, const uvc_host_stream_form
 {
     assert(uvc_stream && vs_format);
 
-    UVC_ENTER_CRITICAL();
-    // Save to video format to this stream
-    memcpy((uvc_host_stream_format_t *)&uvc_stream->dynamic.vs_format, vs_format, sizeof(uvc_host_stream_format_t));
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
     uvc_stream->dynamic.dwMaxVideoFrameSize = dwMaxVideoFrameSize;
-    UVC_EXIT_CRITICAL();
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
 
-    // Save to all frame buffers
-    assert(uvc_frame_are_all_returned(uvc_stream));
+    // Save video format to this stream. Frame buffers pick it up when they are used next time
     uvc_frame_format_update(uvc_stream, vs_format);
 }
 esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, int timeout, uvc_host_stream_hdl_t *stream_hdl_ret)
@@ -674,11 +1033,31 @@ esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, in
         goto not_found;
     }
 
-    // Find the streaming interface and endpoint and claim it
+    // Find the streaming interface
+    ESP_GOTO_ON_ERROR(
+        uvc_find_interface(uvc_stream, stream_config->usb.uvc_stream_index, &stream_config->vs_format),
+        claim_err, TAG, "Could not find streaming interface");
+
+    // Note: The maximum frame size (dwMaxVideoFrameSize) is not provided in the device descriptors.
+    // Instead, it is retrieved via a negotiation process that involves:
+    //   1. Setting the desired video format on the camera.
+    //   2. Receiving the negotiation result, which includes the maximum supported frame size (dwMaxVideoFrameSize).
+    //
+    // Important: This negotiation only computes the potential maximum frame size.
+    // The selected video frame format is not committed until uvc_host_stream_start() is executed.
+    // Negotiate the frame format. The negotiated payload size (dwMaxPayloadTransferSize) selects the alternate setting
+    uvc_vs_ctrl_t vs_result;
+    uvc_host_stream_format_t real_format;
+    memcpy(&real_format, &stream_config->vs_format, sizeof(uvc_host_stream_format_t)); // Memcpy to avoid overwriting the original format
+    ESP_GOTO_ON_ERROR(
+        uvc_host_stream_control_probe(uvc_stream, &real_format, &vs_result),
+        claim_err, TAG, "Failed to negotiate requested Video Stream format");
+
+    // Claim the streaming interface with the smallest alternate setting that fits the format and free periodic bandwidth
     const usb_ep_desc_t *ep_desc;
     ESP_GOTO_ON_ERROR(
-        uvc_claim_interface(uvc_stream, stream_config->usb.uvc_stream_index, &stream_config->vs_format, &ep_desc),
-        claim_err, TAG, "Could not find/claim streaming interface");
+        uvc_claim_interface(uvc_stream, vs_result.dwMaxPayloadTransferSize, stream_config->advanced.isoc_bandwidth_limit, &ep_desc),
+        claim_err, TAG, "Could not claim streaming interface");
     ESP_LOGD(TAG, "Claimed interface index %d with MPS %d", uvc_stream->constant.bInterfaceNumber, USB_EP_DESC_GET_MPS(ep_desc));
 
     /*
@@ -691,40 +1070,160 @@ esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, in
         uvc_set_interface(uvc_stream, false);
     }
 
+    // Zero-copy reception into frame buffers is possible only for Bulk streams
+    if (stream_config->advanced.bulk_zero_copy) {
+        if (USB_EP_DESC_GET_XFERTYPE(ep_desc) == USB_BM_ATTRIBUTES_XFER_BULK) {
+            uvc_stream->constant.bulk_zero_copy = true;
+        } else {
+            ESP_LOGW(TAG, "Zero-copy is supported only for Bulk streams, ignoring");
+        }
+    }
+
+    // Frame buffers in user's memory have a fixed size, it cannot be derived from the negotiated format
+    ESP_GOTO_ON_FALSE(!stream_config->advanced.frame_memory || stream_config->advanced.frame_size || stream_config->advanced.frame_pool_size,
+                      ESP_ERR_INVALID_ARG, err, TAG, "frame_size must be set with frame_memory");
+
+    // Frames received into user's buffers must start at the beginning of them, e.g. at the first pixel of a display
+    const bool use_frame_buffers = (stream_config->advanced.frame_buffers != NULL);
+    if (use_frame_buffers) {
+        ESP_GOTO_ON_FALSE(stream_config->advanced.frame_size && !stream_config->advanced.frame_pool_size && !stream_config->advanced.frame_memory,
+                          ESP_ERR_INVALID_ARG, err, TAG, "frame_buffers need frame_size and exclude frame_pool_size and frame_memory");
+        if (uvc_stream->constant.bulk_zero_copy) {
+            // Zero-copy transfers shift the frame data start inside of the frame buffer
+            ESP_LOGW(TAG, "Zero-copy is not supported with frame_buffers, ignoring");
+            uvc_stream->constant.bulk_zero_copy = false;
+        }
+    }
+
+    ESP_GOTO_ON_FALSE(stream_config->advanced.frame_decimation.max_fps >= 0,
+                      ESP_ERR_INVALID_ARG, err, TAG, "frame_decimation.max_fps must not be negative");
+
+    // Region of interest is cropped by whole YUY2 macropixels
+    const unsigned crop_width = stream_config->advanced.crop.width;
+    if (crop_width) {
+        ESP_GOTO_ON_FALSE(stream_config->advanced.crop.height && !(crop_width & 1) && !(stream_config->advanced.crop.x & 1),
+                          ESP_ERR_INVALID_ARG, err, TAG, "Crop region must have non-zero height, even width and even x");
+        if (uvc_stream->constant.bulk_zero_copy) {
+            // Received data must be copied to pick the region out of the lines
+            ESP_LOGW(TAG, "Zero-copy is not supported with crop, ignoring");
+            uvc_stream->constant.bulk_zero_copy = false;
+        }
+        uvc_stream->constant.crop_x = stream_config->advanced.crop.x;
+        uvc_stream->constant.crop_y = stream_config->advanced.crop.y;
+        uvc_stream->constant.crop_width = crop_width;
+        uvc_stream->constant.crop_height = stream_config->advanced.crop.height;
+    }
+
+    // Frame pool: frame buffers are slices of one pool, sized by the received frames
+    const bool use_frame_pool = (stream_config->advanced.frame_pool_size > 0);
+    if (use_frame_pool) {
+        uvc_stream->constant.fb_pool = true;
+        if (uvc_stream->constant.bulk_zero_copy) {
+            // Zero-copy transfers need space in the frame buffer before the frame is received
+            ESP_LOGW(TAG, "Zero-copy is not supported with frame pool, ignoring");
+            uvc_stream->constant.bulk_zero_copy = false;
+        }
+    }
+
+    // URBs not configured by the user are derived from the negotiated format
+    int number_of_active_urbs = stream_config->advanced.number_of_urbs;
+    size_t urb_size = stream_config->advanced.urb_size;
+    if (number_of_active_urbs <= 0 || urb_size == 0) {
+        uvc_transfers_auto_config(uvc_stream, ep_desc, &vs_result, real_format.fps, &number_of_active_urbs, &urb_size);
+    }
+
+    // Processing task keeps spare URBs in flight, while the completed ones wait for processing
+    const bool use_processing_task = (stream_config->advanced.processing_task.stack_size > 0);
+    int number_of_urbs = number_of_active_urbs;
+    if (use_processing_task) {
+        if (uvc_stream->constant.bulk_zero_copy) {
+            // Transfers landing in frame buffers must be processed in order of their submission
+            ESP_LOGW(TAG, "Zero-copy is not supported with processing task, ignoring");
+            uvc_stream->constant.bulk_zero_copy = false;
+        }
+        const int number_of_spare_urbs = stream_config->advanced.processing_task.number_of_spare_urbs;
+        number_of_urbs += (number_of_spare_urbs > 0) ? number_of_spare_urbs : number_of_active_urbs;
+    }
+
     // Allocate USB transfers
     ESP_GOTO_ON_ERROR(
-        uvc_transfers_allocate(uvc_stream, stream_config->advanced.number_of_urbs, stream_config->advanced.urb_size, ep_desc),
+        uvc_transfers_allocate(uvc_stream, number_of_urbs, urb_size, ep_desc),
         err, TAG,);
+    uvc_stream->constant.num_of_active_xfers = uvc_stream->constant.num_of_xfers;
 
-    // Note: The maximum frame size (dwMaxVideoFrameSize) is not provided in the device descriptors.
-    // Instead, it is retrieved via a negotiation process that involves:
-    //   1. Setting the desired video format on the camera.
-    //   2. Receiving the negotiation result, which includes the maximum supported frame size (dwMaxVideoFrameSize).
-    //
-    // Important: This negotiation only computes the potential maximum frame size.
-    // The selected video frame format is not committed until uvc_host_stream_start() is executed.
-    // Negotiate the frame format
-    uvc_vs_ctrl_t vs_result;
-    uvc_host_stream_format_t real_format;
-    memcpy(&real_format, &stream_config->vs_format, sizeof(uvc_host_stream_format_t)); // Memcpy to avoid overwriting the original format
-    ESP_GOTO_ON_ERROR(
-        uvc_host_stream_control_probe(uvc_stream, &real_format, &vs_result),
-        err, TAG, "Failed to negotiate requested Video Stream format");
+    if (use_processing_task) {
+        ESP_GOTO_ON_ERROR(
+            uvc_processing_task_create(
+                uvc_stream,
+                number_of_active_urbs,
+                stream_config->advanced.processing_task.stack_size,
+                stream_config->advanced.processing_task.priority,
+                stream_config->advanced.processing_task.xCoreID),
+            err, TAG, "Could not create processing task");
+    }
 
-    // Allocate Frame buffers
-    ESP_GOTO_ON_ERROR(
-        uvc_frame_allocate(
-            uvc_stream,
-            stream_config->advanced.number_of_frame_buffers,
-            stream_config->advanced.frame_size ? stream_config->advanced.frame_size : vs_result.dwMaxVideoFrameSize,
-            stream_config->advanced.frame_heap_caps),
-        err, TAG,);
+    // Allocate Frame buffers. Frames cropped from the negotiated format need only the size of the region
+    size_t frame_size = stream_config->advanced.frame_size ? stream_config->advanced.frame_size : vs_result.dwMaxVideoFrameSize;
+    if (!stream_config->advanced.frame_size && crop_width && real_format.format == UVC_VS_FORMAT_YUY2 &&
+            stream_config->advanced.crop.x + crop_width <= real_format.h_res &&
+            stream_config->advanced.crop.y + stream_config->advanced.crop.height <= real_format.v_res) {
+        frame_size = crop_width * stream_config->advanced.crop.height * 2; // YUY2 has 2 bytes per pixel
+    }
+    if (use_frame_buffers) {
+        ESP_GOTO_ON_ERROR(
+            uvc_frame_allocate_buffers(
+                uvc_stream,
+                stream_config->advanced.frame_buffers,
+                stream_config->advanced.number_of_frame_buffers,
+                stream_config->advanced.frame_size),
+            err, TAG,);
+    } else {
+        ESP_GOTO_ON_ERROR(
+            uvc_frame_allocate(
+                uvc_stream,
+                stream_config->advanced.number_of_frame_buffers,
+                use_frame_pool ? stream_config->advanced.frame_pool_size : frame_size,
+                stream_config->advanced.frame_heap_caps,
+                stream_config->advanced.frame_memory,
+                stream_config->advanced.frame_memory_size),
+            err, TAG,);
+    }
+
+    // DMA copy of payloads into frame buffers is possible only for Isochronous streams
+    if (stream_config->advanced.frame_dma_copy) {
+#if UVC_FRAME_DMA_COPY
+        if (uvc_stream->constant.xfer_process == isoc_transfer_process) {
+            ESP_GOTO_ON_ERROR(uvc_frame_dma_install(uvc_stream), err, TAG, "Could not install DMA copy");
+        } else {
+            ESP_LOGW(TAG, "DMA copy is supported only for Isochronous streams, ignoring");
+        }
+#else
+        ESP_LOGW(TAG, "DMA copy is not enabled by CONFIG_UVC_FRAME_DMA_COPY, ignoring");
+#endif
+    }
+
+    // Allocate still image frame buffer
+    if (stream_config->advanced.still_frame_size > 0) {
+        ESP_GOTO_ON_ERROR(
+            uvc_still_allocate(uvc_stream, stream_config->advanced.still_frame_size, stream_config->advanced.frame_heap_caps),
+            err, TAG,);
+    }
 
     // Save info
     uvc_format_save(uvc_stream, &real_format, vs_result.dwMaxVideoFrameSize);
     uvc_stream->constant.stream_cb = stream_config->event_cb;
     uvc_stream->constant.frame_cb = stream_config->frame_cb;
     uvc_stream->constant.cb_arg = stream_config->user_ctx;
+    uvc_stream->constant.filled_fb_policy = stream_config->advanced.frame_queue.policy;
+    uvc_stream->constant.filled_fb_depth = (stream_config->advanced.frame_queue.depth > 0) ? stream_config->advanced.frame_queue.depth : 0;
+    uvc_stream->constant.partial_cb = stream_config->advanced.partial_frame.cb;
+    uvc_stream->constant.partial_size = stream_config->advanced.partial_frame.size;
+    uvc_stream->constant.partial_lines = stream_config->advanced.partial_frame.lines;
+    uvc_stream->constant.decimation_every_nth = stream_config->advanced.frame_decimation.every_nth;
+    uvc_stream->constant.mjpeg_check = stream_config->advanced.mjpeg_check;
+    if (stream_config->advanced.frame_decimation.max_fps > 0) {
+        uvc_stream->constant.decimation_interval_us = (int64_t)(1000000.0f / stream_config->advanced.frame_decimation.max_fps);
+    }
 
     // Everything OK, add the device into list
     UVC_ENTER_CRITICAL();
@@ -732,6 +1231,7 @@ esp_err_t uvc_host_stream_open(const uvc_host_stream_config_t *stream_config, in
     UVC_EXIT_CRITICAL();
     *stream_hdl_ret = (uvc_host_stream_hdl_t)uvc_stream;
     xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    uvc_enum_mark_stream(uvc_stream, "stream_opened");
     return ESP_OK;
 
 err:
@@ -770,6 +1270,13 @@ esp_err_t uvc_host_stream_close(uvc_host_stream_hdl_t stream_hdl)
         goto exit;
     }
 
+    // Processing task cannot wait for its own end
+    if (uvc_stream->constant.processing_task && uvc_stream->constant.processing_task == xTaskGetCurrentTaskHandle()) {
+        ESP_LOGE(TAG, "Stream cannot be closed from its frame callback with processing task");
+        ret = ESP_ERR_INVALID_STATE;
+        goto exit;
+    }
+
     if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
         uvc_host_stream_stop(stream_hdl);
     }
@@ -815,10 +1322,10 @@ static esp_err_t uvc_clear_endpoint_feature(uvc_host_stream_hdl_t stream_hdl)
 esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl)
 {
     UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
-    UVC_ENTER_CRITICAL();
-    UVC_CHECK_FROM_CRIT(stream_hdl->dynamic.streaming == false, ESP_ERR_INVALID_STATE);
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    UVC_STREAM_CHECK_FROM_CRIT(stream_hdl, stream_hdl->dynamic.streaming == false, ESP_ERR_INVALID_STATE);
     const uvc_host_stream_format_t format = stream_hdl->dynamic.vs_format;
-    UVC_EXIT_CRITICAL();
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
 
     // 1. Negotiate and commit the frame format
     // @see USB UVC specification ver 1.5, figure 4-1
@@ -835,13 +1342,38 @@ esp_err_t uvc_host_stream_start(uvc_host_stream_hdl_t stream_hdl)
     }
 
     // 3. Unpause: Submit all URBs
+    uvc_stats_reset(stream_hdl);
     ESP_RETURN_ON_ERROR(
         uvc_host_stream_unpause(stream_hdl),
         TAG, "Could not unpause the stream");
+    uvc_enum_mark_stream(stream_hdl, "stream_started");
 
     return ESP_OK;
 }
 
+/**
+ * @brief Complete partial format from the current format of the stream
+ *
+ * If the user does not provide resolution/format, we use the **current one**
+ * If the user does not provide FPS, we use the **default one**
+ *
+ * @param[in]    stream_hdl Stream handle
+ * @param[inout] format     Format to complete
+ */
+static void uvc_format_complete(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format)
+{
+    if (format->h_res == 0 || format->v_res == 0) {
+        UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+        format->h_res = stream_hdl->dynamic.vs_format.h_res;
+        format->v_res = stream_hdl->dynamic.vs_format.v_res;
+        UVC_STREAM_EXIT_CRITICAL(stream_hdl);
+    }
+
+    if (format->format == UVC_VS_FORMAT_DEFAULT) {
+        format->format = UVC_ATOMIC_LOAD(stream_hdl->dynamic.vs_format.format);
+    }
+}
+
 esp_err_t uvc_host_stream_format_select(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format)
 {
     esp_err_t ret = ESP_OK;
@@ -858,18 +1390,7 @@ esp_err_t uvc_host_stream_format_select(uvc_host_stream_hdl_t stream_hdl, uvc_ho
     }
 
     // Allow partial format change
-    // If the user does not provide resolution/format, we use the **current one**
-    // If the user does not provide FPS, we use the **default one**
-    if (format->h_res == 0 || format->v_res == 0) {
-        UVC_ENTER_CRITICAL();
-        format->h_res = stream_hdl->dynamic.vs_format.h_res;
-        format->v_res = stream_hdl->dynamic.vs_format.v_res;
-        UVC_EXIT_CRITICAL();
-    }
-
-    if (format->format == UVC_VS_FORMAT_DEFAULT) {
-        format->format = UVC_ATOMIC_LOAD(stream_hdl->dynamic.vs_format.format);
-    }
+    uvc_format_complete(stream_hdl, format);
 
     uvc_vs_ctrl_t vs_result;
     ESP_GOTO_ON_ERROR(
@@ -884,12 +1405,94 @@ bailout:
     return ret;
 }
 
+esp_err_t uvc_host_stream_format_prepare(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format)
+{
+    UVC_CHECK(stream_hdl && format, ESP_ERR_INVALID_ARG);
+
+    // Allow partial format change
+    uvc_format_complete(stream_hdl, format);
+
+    // PROBE does not change the committed format, so the stream keeps streaming
+    uvc_vs_ctrl_t vs_result;
+    ESP_RETURN_ON_ERROR(
+        uvc_host_stream_control_probe(stream_hdl, format, &vs_result),
+        TAG, "Failed to negotiate requested Video Stream format");
+
+    // URBs and alternate setting are kept, the format must fit into the claimed endpoint
+    const bool is_isoc = (stream_hdl->constant.bAlternateSetting != 0);
+    if (is_isoc && vs_result.dwMaxPayloadTransferSize > stream_hdl->constant.max_payload_size) {
+        ESP_LOGE(TAG, "Format needs payload %"PRIu32" B, alternate setting %d offers %"PRIu32" B",
+                 vs_result.dwMaxPayloadTransferSize, stream_hdl->constant.bAlternateSetting, stream_hdl->constant.max_payload_size);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    memcpy(&stream_hdl->dynamic.next_format, format, sizeof(uvc_host_stream_format_t));
+    memcpy(&stream_hdl->dynamic.next_vs_ctrl, &vs_result, sizeof(uvc_vs_ctrl_t));
+    stream_hdl->dynamic.next_format_ready = true;
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_stream_format_switch(uvc_host_stream_hdl_t stream_hdl)
+{
+    UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
+    esp_err_t ret = ESP_OK;
+
+    uvc_host_stream_format_t format;
+    uvc_vs_ctrl_t vs_ctrl;
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    UVC_STREAM_CHECK_FROM_CRIT(stream_hdl, stream_hdl->dynamic.next_format_ready, ESP_ERR_INVALID_STATE);
+    stream_hdl->dynamic.next_format_ready = false;
+    memcpy(&format, &stream_hdl->dynamic.next_format, sizeof(uvc_host_stream_format_t));
+    memcpy(&vs_ctrl, &stream_hdl->dynamic.next_vs_ctrl, sizeof(uvc_vs_ctrl_t));
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
+
+    // Stream that is not streaming commits the format on uvc_host_stream_start()
+    if (!UVC_ATOMIC_LOAD(stream_hdl->dynamic.streaming)) {
+        uvc_format_save(stream_hdl, &format, vs_ctrl.dwMaxVideoFrameSize);
+        return ESP_OK;
+    }
+
+    if (stream_hdl->constant.bAlternateSetting == 0) {
+        // Bulk streams are stopped by halting the endpoint, the transfers cannot stay in flight
+        ESP_RETURN_ON_ERROR(uvc_host_stream_stop(stream_hdl), TAG, "Could not stop the stream");
+        ret = uvc_host_stream_control_commit_prepared(stream_hdl, &vs_ctrl, &format);
+        if (ret == ESP_OK) {
+            uvc_format_save(stream_hdl, &format, vs_ctrl.dwMaxVideoFrameSize);
+        }
+        uvc_stats_reset(stream_hdl);
+        ret |= uvc_host_stream_unpause(stream_hdl);
+        return ret;
+    }
+
+    // ISOC: transfers stay in flight, data received until the device streams the new format is dropped
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    stream_hdl->dynamic.format_switching = true;
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
+
+    uvc_set_interface(stream_hdl, false); // Some cameras accept COMMIT only in alternate setting 0. We silently continue on error
+    ret = uvc_host_stream_control_commit_prepared(stream_hdl, &vs_ctrl, &format);
+    if (ret == ESP_OK) {
+        uvc_format_save(stream_hdl, &format, vs_ctrl.dwMaxVideoFrameSize);
+    } else {
+        ESP_LOGE(TAG, "Could not commit prepared format, streaming continues in previous format");
+    }
+    vTaskDelay(pdMS_TO_TICKS(10)); // Some cameras need delay between format Commit and SetInterface
+    ret |= uvc_set_interface(stream_hdl, true);
+
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    stream_hdl->dynamic.format_switching = false;
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
+    return ret;
+}
+
 esp_err_t uvc_host_stream_format_get(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_format_t *format)
 {
     UVC_CHECK(stream_hdl && format, ESP_ERR_INVALID_ARG);
-    UVC_ENTER_CRITICAL();
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
     memcpy(format, &stream_hdl->dynamic.vs_format, sizeof(uvc_host_stream_format_t));
-    UVC_EXIT_CRITICAL();
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
     return ESP_OK;
 }
 
@@ -925,17 +1528,19 @@ esp_err_t uvc_host_stream_pause(uvc_host_stream_hdl_t stream_hdl)
 
     // We do not cancel the ongoing transfers here, it is not supported by USB Host Library
     // By setting stream_hdl->dynamic.streaming = false; no frame callbacks will be called and the transfer can gracefully finish
-    UVC_ENTER_CRITICAL();
-    UVC_CHECK_FROM_CRIT(stream_hdl->dynamic.streaming, ESP_OK); // Return immediately if already paused
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    UVC_STREAM_CHECK_FROM_CRIT(stream_hdl, stream_hdl->dynamic.streaming, ESP_OK); // Return immediately if already paused
     stream_hdl->dynamic.streaming = false;
-    uvc_host_frame_t *current_frame = stream_hdl->dynamic.current_frame;
-    stream_hdl->dynamic.current_frame = NULL;
-    UVC_EXIT_CRITICAL();
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
 
+    uvc_host_frame_t *current_frame = UVC_ATOMIC_EXCHANGE(stream_hdl->dynamic.current_frame, NULL);
     if (current_frame) {
         uvc_host_frame_return(stream_hdl, current_frame);
     }
 
+    // Filled frames that were not taken by the user are outdated now
+    uvc_frame_return_filled(stream_hdl);
+
     return ESP_OK;
 }
 
@@ -944,16 +1549,38 @@ esp_err_t uvc_host_stream_unpause(uvc_host_stream_hdl_t stream_hdl)
     UVC_CHECK(stream_hdl, ESP_ERR_INVALID_ARG);
     esp_err_t ret = ESP_OK;
 
-    UVC_ENTER_CRITICAL();
-    UVC_CHECK_FROM_CRIT(!stream_hdl->dynamic.streaming, ESP_ERR_INVALID_STATE);
+    UVC_STREAM_ENTER_CRITICAL(stream_hdl);
+    UVC_STREAM_CHECK_FROM_CRIT(stream_hdl, !stream_hdl->dynamic.streaming, ESP_ERR_INVALID_STATE);
     stream_hdl->dynamic.streaming = true;
     // Start of Frame is detected when received FrameID != current_frame_id
     // We set current_frame_id to illegal value (FrameID can be 0 or 1) so we catch SoF of the very first frame
     stream_hdl->single_thread.current_frame_id = 2;
-    stream_hdl->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_SOF;
-    UVC_EXIT_CRITICAL();
+    stream_hdl->single_thread.next_bulk_packet = UVC_STREAM_BULK_PACKET_HEADER;
+    stream_hdl->single_thread.bulk_max_payload_len = stream_hdl->dynamic.dwMaxPayloadTransferSize;
+    stream_hdl->single_thread.bulk_payload_len = 0;
+    stream_hdl->single_thread.bulk_frame_end = false;
+    stream_hdl->single_thread.decimation_count = 0;
+    stream_hdl->single_thread.decimation_next_us = 0;
+    stream_hdl->single_thread.decimation_sof_us = 0;
+    UVC_STREAM_EXIT_CRITICAL(stream_hdl);
+
+    // Zero-copy: all transfers start with their own buffers, they are redirected to frame buffers during streaming
+    if (stream_hdl->constant.bulk_zero_copy) {
+        for (int i = 0; i < stream_hdl->constant.num_of_xfers; i++) {
+            uvc_frame_landing_release(stream_hdl, stream_hdl->single_thread.xfer_landing[i]);
+            stream_hdl->single_thread.xfer_landing[i] = NULL;
+            uint8_t **ptr = (uint8_t **)(&(stream_hdl->constant.xfers[i]->data_buffer));
+            *ptr = stream_hdl->constant.xfer_buffers[i];
+        }
+    }
+
+    if (stream_hdl->constant.processing_task) {
+        ESP_GOTO_ON_ERROR(uvc_processing_submit(stream_hdl), stop_stream, TAG,);
+        return ret;
+    }
 
     for (int i = 0; i < stream_hdl->constant.num_of_xfers; i++) {
+        UVC_TRACE_SUBMIT(stream_hdl->constant.xfers[i]);
         ESP_GOTO_ON_ERROR(
             usb_host_transfer_submit(stream_hdl->constant.xfers[i]),
             stop_stream, TAG, "Could not submit transfer %d", i);
@@ -983,10 +1610,7 @@ esp_err_t uvc_host_usb_ctrl(uvc_host_stream_hdl_t stream_hdl, uint8_t bmRequestT
     esp_err_t ret;
 
     // Take Mutex and fill the CTRL request
-    BaseType_t taken = xSemaphoreTake(p_uvc_host_driver->ctrl_mutex, pdMS_TO_TICKS(5000));
-    if (!taken) {
-        return ESP_ERR_TIMEOUT;
-    }
+    ESP_RETURN_ON_ERROR(uvc_host_usb_ctrl_lock(pdMS_TO_TICKS(5000)), TAG,);
     usb_setup_packet_t *req = (usb_setup_packet_t *)(p_uvc_host_driver->ctrl_transfer->data_buffer);
     uint8_t *start_of_data = (uint8_t *)req + sizeof(usb_setup_packet_t);
     req->bmRequestType = bmRequestType;
@@ -1009,7 +1633,7 @@ esp_err_t uvc_host_usb_ctrl(uvc_host_stream_hdl_t stream_hdl, uint8_t bmRequestT
         usb_host_transfer_submit_control(p_uvc_host_driver->usb_client_hdl, p_uvc_host_driver->ctrl_transfer),
         unblock, TAG, "CTRL transfer failed");
 
-    taken = xSemaphoreTake((SemaphoreHandle_t)p_uvc_host_driver->ctrl_transfer->context, pdMS_TO_TICKS(5000)); // This is a fixed timeout. Every device should be able to respond to CTRL transfer in 5 seconds
+    const BaseType_t taken = xSemaphoreTake((SemaphoreHandle_t)p_uvc_host_driver->ctrl_transfer->context, pdMS_TO_TICKS(5000)); // This is a fixed timeout. Every device should be able to respond to CTRL transfer in 5 seconds
     ESP_GOTO_ON_FALSE(taken, ESP_ERR_TIMEOUT, unblock, TAG, "CTRL timeout");
     ESP_GOTO_ON_FALSE(p_uvc_host_driver->ctrl_transfer->status == USB_TRANSFER_STATUS_COMPLETED, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Control transfer error");
     ESP_GOTO_ON_FALSE(p_uvc_host_driver->ctrl_transfer->actual_num_bytes == p_uvc_host_driver->ctrl_transfer->num_bytes, ESP_ERR_INVALID_RESPONSE, unblock, TAG, "Incorrect number of bytes transferred");
@@ -1021,20 +1645,121 @@ esp_err_t uvc_host_usb_ctrl(uvc_host_stream_hdl_t stream_hdl, uint8_t bmRequestT
     ret = ESP_OK;
 
 unblock:
-    xSemaphoreGive(p_uvc_host_driver->ctrl_mutex);
+    uvc_host_usb_ctrl_unlock();
     return ret;
 }
 
+esp_err_t uvc_host_usb_ctrl_lock(TickType_t timeout)
+{
+    UVC_CHECK(p_uvc_host_driver, ESP_ERR_INVALID_STATE);
+    return xSemaphoreTakeRecursive(p_uvc_host_driver->ctrl_mutex, timeout) ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+void uvc_host_usb_ctrl_unlock(void)
+{
+    xSemaphoreGiveRecursive(p_uvc_host_driver->ctrl_mutex);
+}
+
 esp_err_t uvc_host_get_frame_list(uint8_t dev_addr, uint8_t uvc_stream_index, uvc_host_frame_info_t (*frame_info_list)[], size_t *list_size)
 {
     UVC_CHECK(list_size, ESP_ERR_INVALID_ARG);
 
     usb_device_handle_t dev_hdl;
     const usb_config_desc_t *config_desc = NULL;
+    uvc_desc_cache_t *desc_cache = NULL;
     if (usb_host_device_open(p_uvc_host_driver->usb_client_hdl, dev_addr, &dev_hdl) == ESP_OK) {
-        usb_host_get_active_config_descriptor(dev_hdl, &config_desc);
+        if (usb_host_get_active_config_descriptor(dev_hdl, &config_desc) == ESP_OK) {
+            uvc_desc_cache_acquire(dev_hdl, &desc_cache); // On failure, parse the configuration descriptor directly
+        }
         ESP_RETURN_ON_ERROR(usb_host_device_close(p_uvc_host_driver->usb_client_hdl, dev_hdl), TAG, "Unable to close USB device");
     }
 
-    return uvc_desc_get_frame_list(config_desc, uvc_stream_index, frame_info_list, list_size);
+    if (!desc_cache) {
+        return uvc_desc_get_frame_list(config_desc, uvc_stream_index, frame_info_list, list_size);
+    }
+    const esp_err_t ret = uvc_desc_index_get_frame_list(desc_cache->index, uvc_stream_index, frame_info_list, list_size);
+    uvc_desc_cache_release(desc_cache);
+    return ret;
+}
+
+esp_err_t uvc_host_format_bandwidth_get(uint8_t dev_addr, uint8_t uvc_stream_index, const uvc_host_stream_format_t *vs_format,
+                                        uint32_t bandwidth_limit, uvc_host_bandwidth_info_t *info)
+{
+    UVC_CHECK(UVC_ATOMIC_LOAD(p_uvc_host_driver), ESP_ERR_INVALID_STATE);
+    UVC_CHECK(vs_format && info, ESP_ERR_INVALID_ARG);
+
+    esp_err_t ret = ESP_OK;
+    usb_device_handle_t dev_hdl = NULL;
+    bool device_opened = false;
+    uvc_stream_t *probe_stream = NULL;
+    xSemaphoreTake(p_uvc_host_driver->open_close_mutex, portMAX_DELAY);
+
+    // Reuse USB device of opened streams, otherwise open it just for this check
+    uvc_stream_t *uvc_stream;
+    SLIST_FOREACH(uvc_stream, &p_uvc_host_driver->uvc_stream_list, list_entry) {
+        usb_device_info_t dev_info;
+        ESP_ERROR_CHECK(usb_host_device_info(uvc_stream->constant.dev_hdl, &dev_info));
+        if (dev_info.dev_addr == dev_addr) {
+            dev_hdl = uvc_stream->constant.dev_hdl;
+            break;
+        }
+    }
+    if (dev_hdl == NULL) {
+        ESP_GOTO_ON_FALSE(usb_host_device_open(p_uvc_host_driver->usb_client_hdl, dev_addr, &dev_hdl) == ESP_OK,
+                          ESP_ERR_NOT_FOUND, exit, TAG, "Could not open device %d", dev_addr);
+        device_opened = true;
+    }
+
+    // Temporary stream for format negotiation. It is never added to the list of opened streams
+    probe_stream = calloc(1, sizeof(uvc_stream_t));
+    ESP_GOTO_ON_FALSE(probe_stream, ESP_ERR_NO_MEM, exit, TAG,);
+    portMUX_INITIALIZE(&probe_stream->lock);
+    probe_stream->constant.dev_hdl = dev_hdl;
+    ESP_GOTO_ON_ERROR(uvc_find_interface(probe_stream, uvc_stream_index, vs_format), exit, TAG,);
+
+    // Negotiation would interfere with opened stream of this interface
+    SLIST_FOREACH(uvc_stream, &p_uvc_host_driver->uvc_stream_list, list_entry) {
+        ESP_GOTO_ON_FALSE(!(uvc_stream->constant.dev_hdl == dev_hdl && uvc_stream->constant.bInterfaceNumber == probe_stream->constant.bInterfaceNumber),
+                          ESP_ERR_INVALID_STATE, exit, TAG, "Streaming interface %d is already opened", probe_stream->constant.bInterfaceNumber);
+    }
+
+    uvc_vs_ctrl_t vs_result;
+    uvc_host_stream_format_t format;
+    memcpy(&format, vs_format, sizeof(uvc_host_stream_format_t));
+    ESP_GOTO_ON_ERROR(
+        uvc_host_stream_control_probe(probe_stream, &format, &vs_result),
+        exit, TAG, "Failed to negotiate requested Video Stream format");
+
+    // Alternate setting that the format needs regardless of other streams
+    const uvc_desc_index_t *desc_index = probe_stream->constant.desc_cache->index;
+    const usb_intf_desc_t *intf_desc;
+    const usb_ep_desc_t *ep_desc;
+    usb_device_info_t dev_info;
+    ESP_ERROR_CHECK(usb_host_device_info(dev_hdl, &dev_info));
+    const bool high_speed = (dev_info.speed == USB_SPEED_HIGH);
+    const uint32_t dwMaxPayloadTransferSize = vs_result.dwMaxPayloadTransferSize ? vs_result.dwMaxPayloadTransferSize : UINT32_MAX;
+    ESP_GOTO_ON_ERROR(
+        uvc_desc_index_get_streaming_intf_and_ep_by_bandwidth(desc_index, probe_stream->constant.bInterfaceNumber, dwMaxPayloadTransferSize, MAX_MPS_IN, high_speed,
+                bandwidth_limit ? bandwidth_limit : UINT32_MAX, &intf_desc, &ep_desc),
+        exit, TAG, "Could not find Streaming interface %d", probe_stream->constant.bInterfaceNumber);
+
+    // Alternate setting that the stream would get now. If it does not fit, ep_desc keeps the one the format needs
+    bool planned_high_speed;
+    const esp_err_t plan_ret = uvc_bandwidth_plan(dev_hdl, desc_index, probe_stream->constant.bInterfaceNumber, vs_result.dwMaxPayloadTransferSize, bandwidth_limit,
+                               &intf_desc, &ep_desc, &planned_high_speed);
+    info->required = uvc_desc_get_ep_bandwidth(ep_desc, high_speed);
+    info->available = uvc_bandwidth_free(high_speed);
+    info->dwMaxPayloadTransferSize = vs_result.dwMaxPayloadTransferSize;
+    info->fits = (plan_ret == ESP_OK);
+
+exit:
+    if (probe_stream) {
+        uvc_desc_cache_release(probe_stream->constant.desc_cache);
+        free(probe_stream);
+    }
+    if (device_opened) {
+        usb_host_device_close(p_uvc_host_driver->usb_client_hdl, dev_hdl);
+    }
+    xSemaphoreGive(p_uvc_host_driver->open_close_mutex);
+    return ret;
 }
@@ -8,15 +8,235 @@
 #include <string.h> // For memcpy
 
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "uvc_stream.h" // For uvc_host_stream_pause()
 #include "uvc_types_priv.h"
 #include "uvc_check_priv.h"
 #include "uvc_frame_priv.h"
+#include "uvc_frame_dma_priv.h"
 #include "uvc_critical_priv.h"
+#include "uvc_processing_priv.h"
+#include "uvc_stats_priv.h"
+#include "uvc_still_priv.h"
+#include "uvc_trace_priv.h"
 
 static const char *TAG = "uvc-isoc";
 
+// Bits of bmHeaderInfo in payload header, see USB UVC specification ver 1.5, table 2-5
+#define UVC_ISOC_HEADER_FID (1 << 0)
+#define UVC_ISOC_HEADER_EOF (1 << 1)
+#define UVC_ISOC_HEADER_PTS (1 << 2)
+#define UVC_ISOC_HEADER_SCR (1 << 3)
+#define UVC_ISOC_HEADER_ERR (1 << 6)
+#define UVC_ISOC_HEADER_SLOW_MASK (UVC_ISOC_HEADER_FID | UVC_ISOC_HEADER_EOF | UVC_ISOC_HEADER_ERR) // Bits checked by fast path of isoc_transfer_process()
+
+/**
+ * @brief Skip current frame on frame buffer overflow and inform the user
+ *
+ * @param[in] uvc_stream UVC stream
+ */
+static void uvc_isoc_frame_overflow(uvc_stream_t *uvc_stream)
+{
+    uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_OVERFLOW);
+
+    // Inform the user about the overflow
+    uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
+    if (stream_cb) {
+        const uvc_host_stream_event_data_t event = {
+            .type = UVC_HOST_FRAME_BUFFER_OVERFLOW,
+        };
+        stream_cb(&event, uvc_stream->constant.cb_arg);
+    }
+}
+
+/**
+ * @brief Add data of ISOC packet to the current frame
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] packet     Received packet, starting with payload header
+ * @param[in] len        Number of received bytes
+ */
+static inline void uvc_isoc_frame_add_data(uvc_stream_t *uvc_stream, const uint8_t *packet, size_t len)
+{
+    const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)packet;
+    uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+    if (payload_header->bmHeaderInfo.val & (UVC_ISOC_HEADER_PTS | UVC_ISOC_HEADER_SCR)) {
+        uvc_frame_time_header(uvc_stream, current_frame, packet, len);
+    }
+    const size_t offset = current_frame->data_len;
+    if (uvc_frame_dma_add_data(uvc_stream, current_frame, packet + payload_header->bHeaderLength, len - payload_header->bHeaderLength) != ESP_OK) {
+        uvc_isoc_frame_overflow(uvc_stream);
+    } else {
+        uvc_frame_data_added(uvc_stream, current_frame, offset);
+    }
+}
+
+/**
+ * @brief Process ISOC packet that is not a plain data packet of the current frame
+ *
+ * Handles USB packet errors, Start of Frame, error flag in the payload header and End of Frame.
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] isoc_desc  Packet descriptor
+ * @param[in] packet     Received packet, starting with payload header
+ * @return true if the next packets can be processed, false if the stream was paused
+ */
+static bool uvc_isoc_packet_process(uvc_stream_t *uvc_stream, const usb_isoc_packet_desc_t *isoc_desc, const uint8_t *packet)
+{
+    // Check USB status
+    switch (isoc_desc->status) {
+    case USB_TRANSFER_STATUS_COMPLETED:
+        break;
+    case USB_TRANSFER_STATUS_NO_DEVICE:
+    case USB_TRANSFER_STATUS_CANCELED:
+        ESP_ERROR_CHECK(uvc_host_stream_pause(uvc_stream)); // This should never fail
+        return false; // No need to process the rest
+    case USB_TRANSFER_STATUS_ERROR:
+    case USB_TRANSFER_STATUS_OVERFLOW:
+    case USB_TRANSFER_STATUS_STALL:
+        ESP_LOGW(TAG, "usb err %d", isoc_desc->status);
+        if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame)) {
+            uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_ERROR);
+        } else {
+            uvc_stream->single_thread.skip_current_frame = true; // No frame is being received, nothing is dropped
+        }
+        return true; // Data corrupted
+
+    case USB_TRANSFER_STATUS_TIMED_OUT:
+    case USB_TRANSFER_STATUS_SKIPPED:
+        return true; // Skipped and timed out ISOC transfers are not an issue
+    default:
+        assert(false);
+    }
+
+    // Check for Zero Length Packet
+    if (isoc_desc->actual_num_bytes == 0) {
+        return true;
+    }
+
+    // Check payload header
+    const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)packet;
+    if (isoc_desc->actual_num_bytes < 2 || payload_header->bHeaderLength < 2 || payload_header->bHeaderLength > isoc_desc->actual_num_bytes) {
+        uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_ERROR);
+        return true;
+    }
+
+    // Check for start of new frame
+    const bool start_of_frame = (uvc_stream->single_thread.current_frame_id != payload_header->bmHeaderInfo.frame_id);
+    if (start_of_frame) {
+        uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
+        if (current_frame && !uvc_stream->single_thread.skip_current_frame) {
+            uvc_stats_frame_dropped(uvc_stream, UVC_STATS_DROP_MISSING_EOF);
+        }
+
+        // Method 2 still image is sent between video frames and is received into the still frame buffer.
+        // If EoF between still image and video frame was missed, the frame buffer of the other kind is returned
+        const bool still_image = payload_header->bmHeaderInfo.still_image;
+        if (current_frame && uvc_still_is_frame(uvc_stream, current_frame) != still_image) {
+            current_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+            if (current_frame) {
+                uvc_host_frame_return(uvc_stream, current_frame);
+                current_frame = NULL;
+            }
+        }
+
+        // We detected start of new frame. Update Frame ID and start fetching this frame
+        // Error flag of this header is checked below
+        uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
+        uvc_stream->single_thread.skip_current_frame = false;
+
+        // Get free frame buffer for this new frame
+        const bool need_new_frame = (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && !current_frame);
+        if (need_new_frame && !still_image && uvc_frame_decimate(uvc_stream)) {
+            // Frame is skipped by frame decimation, its payloads are not copied
+            uvc_stream->single_thread.skip_current_frame = true;
+        } else if (need_new_frame && still_image) {
+            uvc_host_frame_t *still_frame = uvc_still_frame_start(uvc_stream);
+            if (still_frame == NULL) {
+                // Still image was not requested by uvc_host_stream_still_capture()
+                uvc_stream->single_thread.skip_current_frame = true;
+                return true;
+            }
+            if (!uvc_frame_set_current(uvc_stream, still_frame)) {
+                uvc_stream->single_thread.skip_current_frame = true;
+                return true;
+            }
+        } else if (need_new_frame) {
+            uvc_host_frame_t *new_frame = uvc_frame_get_empty(uvc_stream);
+            if (new_frame == NULL) {
+                // There is no free frame buffer now, skipping this frame
+                uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_UNDERFLOW);
+
+                // Inform the user about the underflow
+                uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
+                if (stream_cb) {
+                    const uvc_host_stream_event_data_t event = {
+                        .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
+                    };
+                    stream_cb(&event, uvc_stream->constant.cb_arg);
+                }
+                return true;
+            }
+            if (!uvc_frame_set_current(uvc_stream, new_frame)) {
+                // The stream was paused in the meantime
+                uvc_stream->single_thread.skip_current_frame = true;
+                return true;
+            }
+        } else if (current_frame) {
+            // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer
+            uvc_frame_reset(current_frame);
+        }
+    }
+
+    // Check for error flag
+    if (payload_header->bmHeaderInfo.error) {
+        uvc_stats_frame_skip(uvc_stream, UVC_STATS_DROP_ERROR);
+    }
+
+    // Add received data and timestamps to frame buffer
+    if (!uvc_stream->single_thread.skip_current_frame) {
+        uvc_isoc_frame_add_data(uvc_stream, packet, isoc_desc->actual_num_bytes);
+        if (uvc_stream->single_thread.skip_current_frame) {
+            return true; // Frame buffer overflow
+        }
+    }
+
+    // End of Frame. Pass the frame to user
+    if (payload_header->bmHeaderInfo.end_of_frame) {
+        bool return_frame = true; // In case streaming is stopped ATM, we must return the frame
+
+        // Stop writing more data to this frame. The user could stop the stream in the meantime and take the frame
+        uvc_host_frame_t *this_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+        uvc_frame_dma_wait(uvc_stream);
+
+        // Determine if we should pass the frame to the user:
+        // Only if streaming is active and we have a valid frame to pass to the user.
+        const bool deliver_frame = (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && this_frame && !uvc_stream->single_thread.skip_current_frame);
+
+        if (deliver_frame && uvc_still_frame_end(uvc_stream, this_frame)) {
+            return_frame = false; // Passed to uvc_host_stream_still_capture()
+        } else if (deliver_frame && !uvc_frame_mjpeg_check(uvc_stream, this_frame)) {
+            uvc_stats_frame_dropped(uvc_stream, UVC_STATS_DROP_INVALID_JPEG);
+        } else if (deliver_frame) {
+            uvc_frame_commit(uvc_stream, this_frame);
+            uvc_stats_frame_received(uvc_stream);
+            if (uvc_stream->constant.frame_cb) {
+                uvc_stats_frame_delivered(uvc_stream);
+                return_frame = uvc_stream->constant.frame_cb(this_frame, uvc_stream->constant.cb_arg);
+            } else {
+                // No frame callback: the user pulls the frame from the ring of filled frames
+                return_frame = !uvc_frame_put_filled(uvc_stream, this_frame);
+            }
+        }
+        if (return_frame && this_frame) {
+            // The user has processed the frame in his callback, return it back to empty ring
+            uvc_host_frame_return(uvc_stream, this_frame);
+        }
+    }
+    return true;
+}
+
 /**
  * @brief Callback function for handling Isochronous USB transfers from a UVC camera.
  *
@@ -30,18 +250,21 @@ static const char *TAG = "uvc-isoc";
  *   - **No ACK**: Packets can be missed.
  *   - **Packet Header**: Each packet includes a header used to detect errors, missed packets, and other issues.
  *
- * The callback performs the following tasks:
+ * Most packets are plain data packets in the middle of a frame: completed, with the same Frame ID, without error and EoF flag.
+ * These are handled by a fast path that only copies their data to the current frame buffer.
+ * All other packets are processed by uvc_isoc_packet_process(), which performs the following tasks:
  * 1. Checks the status of each isochronous packet and handles various USB transfer statuses (e.g., completed,
  *    error, device disconnected).
  * 2. Parses packet headers to detect the start of new frames, handles errors, and manages frame buffers.
+ *    PTS and SCR from the headers are saved to the frame buffer.
  * 3. Aggregates valid data into a frame buffer, ensuring no buffer overflow occurs.
  * 4. Signals the end of a frame and invokes user-defined callbacks if necessary.
  *
  * @param[in] transfer Pointer to the completed USB transfer structure.
+ * @return true if the transfer can be resubmitted, false if the streaming was turned off
  */
-void isoc_transfer_callback(usb_transfer_t *transfer)
+bool isoc_transfer_process(usb_transfer_t *transfer)
 {
-    ESP_LOGD(TAG, "%s", __FUNCTION__);
     uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
 
     // USB_TRANSFER_STATUS_NO_DEVICE is set in transfer->status.
@@ -51,132 +274,70 @@ void isoc_transfer_callback(usb_transfer_t *transfer)
     }
 
     if (!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
-        return; // If the streaming was turned off, we don't have to do anything
+        return false; // If the streaming was turned off, we don't have to do anything
     }
+    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.format_switching)) {
+        // Data of the previous format. The frame being received would keep the previous format, return it
+        uvc_host_frame_t *current_frame = UVC_ATOMIC_EXCHANGE(uvc_stream->dynamic.current_frame, NULL);
+        if (current_frame) {
+            uvc_host_frame_return(uvc_stream, current_frame);
+        }
+        uvc_stream->single_thread.current_frame_id = 2; // Catch SoF of the first frame in the new format
+        return true;
+    }
+    uvc_stats_transfer(uvc_stream, transfer);
+    uvc_stream->single_thread.xfer_receive_us = esp_timer_get_time();
 
+    // DMA copies of the payloads must be done before the transfer is resubmitted
+    bool resubmit = true;
     const uint8_t *payload = transfer->data_buffer;
     for (int i = 0; i < transfer->num_isoc_packets; i++) {
-        usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
-
-        // Check USB status
-        switch (isoc_desc->status) {
-        case USB_TRANSFER_STATUS_COMPLETED:
-            break;
-        case USB_TRANSFER_STATUS_NO_DEVICE:
-        case USB_TRANSFER_STATUS_CANCELED:
-            ESP_ERROR_CHECK(uvc_host_stream_pause(uvc_stream)); // This should never fail
-            return; // No need to process the rest
-        case USB_TRANSFER_STATUS_ERROR:
-        case USB_TRANSFER_STATUS_OVERFLOW:
-        case USB_TRANSFER_STATUS_STALL:
-            ESP_LOGW(TAG, "usb err %d", isoc_desc->status);
-            uvc_stream->single_thread.skip_current_frame = true;
-            goto next_isoc_packet; // Data corrupted
-
-        case USB_TRANSFER_STATUS_TIMED_OUT:
-        case USB_TRANSFER_STATUS_SKIPPED:
-            goto next_isoc_packet; // Skipped and timed out ISOC transfers are not an issue
-        default:
-            assert(false);
-        }
-
-        // Check for Zero Length Packet
-        if (isoc_desc->actual_num_bytes == 0) {
-            goto next_isoc_packet;
-        }
-
-        // Check for start of new frame
-        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)payload;
-        const bool start_of_frame = (uvc_stream->single_thread.current_frame_id != payload_header->bmHeaderInfo.frame_id);
-        if (start_of_frame) {
-            // We detected start of new frame. Update Frame ID and start fetching this frame
-            uvc_stream->single_thread.current_frame_id   = payload_header->bmHeaderInfo.frame_id;
-            uvc_stream->single_thread.skip_current_frame = payload_header->bmHeaderInfo.error;
-
-            // Get free frame buffer for this new frame
-            UVC_ENTER_CRITICAL();
-            const bool need_new_frame = (uvc_stream->dynamic.streaming && !uvc_stream->dynamic.current_frame);
-            if (need_new_frame) {
-                UVC_EXIT_CRITICAL();
-                uvc_stream->dynamic.current_frame = uvc_frame_get_empty(uvc_stream);
-                if (uvc_stream->dynamic.current_frame == NULL) {
-                    // There is no free frame buffer now, skipping this frame
-                    uvc_stream->single_thread.skip_current_frame = true;
-
-                    // Inform the user about the underflow
-                    uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
-                    if (stream_cb) {
-                        const uvc_host_stream_event_data_t event = {
-                            .type = UVC_HOST_FRAME_BUFFER_UNDERFLOW,
-                        };
-                        stream_cb(&event, uvc_stream->constant.cb_arg);
-                    }
-                    goto next_isoc_packet;
-                }
-            } else {
-                // We received SoF but current_frame is not NULL: We missed EoF - reset the frame buffer
-                uvc_frame_reset(uvc_stream->dynamic.current_frame);
-                UVC_EXIT_CRITICAL();
-            }
-        }
+        const usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
+        const uint8_t *packet = payload;
+        payload += isoc_desc->num_bytes;
 
-        // Check for error flag
-        if (payload_header->bmHeaderInfo.error) {
-            uvc_stream->single_thread.skip_current_frame = true;
+        // Fast path: data packet of the frame being received.
+        // Frame ID, EoF and error flag are compared at once. Invalid Frame ID 2 must not match the EoF flag
+        const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)packet;
+        const bool data_packet = (isoc_desc->status == USB_TRANSFER_STATUS_COMPLETED) &&
+                                 (isoc_desc->actual_num_bytes >= 2) &&
+                                 (payload_header->bHeaderLength >= 2) && (payload_header->bHeaderLength <= isoc_desc->actual_num_bytes) &&
+                                 ((payload_header->bmHeaderInfo.val & UVC_ISOC_HEADER_SLOW_MASK) == uvc_stream->single_thread.current_frame_id) &&
+                                 (uvc_stream->single_thread.current_frame_id <= 1) &&
+                                 !uvc_stream->single_thread.skip_current_frame;
+        if (data_packet) {
+            uvc_isoc_frame_add_data(uvc_stream, packet, isoc_desc->actual_num_bytes);
+            continue;
         }
 
-        // Add received data to frame buffer
-        if (!uvc_stream->single_thread.skip_current_frame) {
-            const uint8_t *payload_data = payload + payload_header->bHeaderLength;
-            const size_t payload_data_len = isoc_desc->actual_num_bytes - payload_header->bHeaderLength;
-            uvc_host_frame_t *current_frame = UVC_ATOMIC_LOAD(uvc_stream->dynamic.current_frame);
-
-            esp_err_t ret = uvc_frame_add_data(current_frame, payload_data, payload_data_len);
-            if (ret != ESP_OK) {
-                // Frame buffer overflow, skip this frame
-                uvc_stream->single_thread.skip_current_frame = true;
-
-                // Inform the user about the overflow
-                uvc_host_stream_callback_t stream_cb = uvc_stream->constant.stream_cb;
-                if (stream_cb) {
-                    const uvc_host_stream_event_data_t event = {
-                        .type = UVC_HOST_FRAME_BUFFER_OVERFLOW,
-                    };
-                    stream_cb(&event, uvc_stream->constant.cb_arg);
-                }
-                goto next_isoc_packet;
-            }
+        if (!uvc_isoc_packet_process(uvc_stream, isoc_desc, packet)) {
+            resubmit = false;
+            break;
         }
+    }
 
-        // End of Frame. Pass the frame to user
-        if (payload_header->bmHeaderInfo.end_of_frame) {
-            bool return_frame = true; // In case streaming is stopped ATM, we must return the frame
-
-            // Check if the user did not stop the stream in the meantime
-            UVC_ENTER_CRITICAL();
-            uvc_host_frame_t *this_frame = uvc_stream->dynamic.current_frame;
-            uvc_stream->dynamic.current_frame = NULL; // Stop writing more data to this frame
-
-            // Determine if we should invoke the frame callback:
-            // Only invoke the callback if streaming is active, a frame callback exists,
-            // and we have a valid frame to pass to the user.
-            const bool invoke_fb_callback = (uvc_stream->dynamic.streaming && uvc_stream->constant.frame_cb && this_frame && !uvc_stream->single_thread.skip_current_frame);
-            UVC_EXIT_CRITICAL();
+    uvc_frame_dma_wait(uvc_stream);
+    return resubmit && UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming);
+}
 
-            if (invoke_fb_callback) {
-                return_frame = uvc_stream->constant.frame_cb(this_frame, uvc_stream->constant.cb_arg);
-            }
-            if (return_frame) {
-                // The user has processed the frame in his callback, return it back to empty queue
-                uvc_host_frame_return(uvc_stream, this_frame);
-            }
-        }
-next_isoc_packet:
-        payload += isoc_desc->num_bytes;
-        continue;
+/**
+ * @brief Isochronous transfer callback
+ *
+ * The transfer is processed right here, in USB Host client context, or it is deferred to the stream's processing task.
+ *
+ * @param[in] transfer Pointer to the completed USB transfer structure.
+ */
+void isoc_transfer_callback(usb_transfer_t *transfer)
+{
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
+    UVC_TRACE_COMPLETE(transfer);
+    if (uvc_stream->constant.processing_task) {
+        uvc_processing_defer(uvc_stream, transfer);
+        return;
     }
 
-    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+    if (isoc_transfer_process(transfer)) {
+        UVC_TRACE_SUBMIT(transfer);
         usb_host_transfer_submit(transfer); // Restart the transfer
     }
 }
@@ -0,0 +1,225 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "usb/uvc_host.h"
+#include "usb/uvc_host_jpeg.h"
+#include "driver/jpeg_decode.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#define UVC_JPEG_NUM_OF_OUTPUTS    (2)   // Double-buffered output: one buffer is decoded while the other one is processed by the user
+#define UVC_JPEG_POLL_PERIOD_MS    (100) // Period of checking stop request in the decoding task
+#define UVC_JPEG_DEFAULT_TIMEOUT   (100) // Default timeout of decoding of one frame in ms
+#define UVC_JPEG_PICTURE_ALIGN     (16)  // HW decoder output is aligned to MCU size
+
+static const char *TAG = "uvc-jpeg";
+
+struct uvc_host_jpeg_s {
+    uvc_host_stream_hdl_t stream_hdl;                       // Source stream of MJPEG frames
+    uvc_host_jpeg_callback_t decoded_cb;                    // User's decoded frame callback
+    void *user_ctx;                                         // User's argument of decoded frame callback
+    jpeg_decoder_handle_t decoder;                          // HW JPEG decoder engine
+    jpeg_decode_cfg_t decode_cfg;                           // Output configuration of the decoder
+    uvc_host_jpeg_frame_t outputs[UVC_JPEG_NUM_OF_OUTPUTS]; // Output buffers
+    QueueHandle_t free_output_queue;                        // Queue of output buffers that are not held by the user
+    TaskHandle_t task;                                      // Decoding task
+    TaskHandle_t closing_task;                              // Task that waits for the end of the decoding task
+    bool closing;                                           // Stop request for the decoding task. Accessed atomically
+};
+
+/**
+ * @brief Decode one frame into free output buffer
+ *
+ * @param[in] jpeg     Decoding stage
+ * @param[in] frame    Received MJPEG frame
+ * @param[in] output   Free output buffer
+ * @return ESP_OK if the output holds decoded frame
+ */
+static esp_err_t uvc_jpeg_decode(struct uvc_host_jpeg_s *jpeg, const uvc_host_frame_t *frame, uvc_host_jpeg_frame_t *output)
+{
+    if (frame->vs_format.format != UVC_VS_FORMAT_MJPEG) {
+        return ESP_ERR_NOT_SUPPORTED; // The format could be changed by uvc_host_stream_format_select()
+    }
+
+    jpeg_decode_picture_info_t picture_info;
+    ESP_RETURN_ON_ERROR(jpeg_decoder_get_info(frame->data, frame->data_len, &picture_info), TAG, "Invalid JPEG header");
+
+    uint32_t out_size = 0;
+    ESP_RETURN_ON_ERROR(
+        jpeg_decoder_process(jpeg->decoder, &jpeg->decode_cfg, frame->data, frame->data_len, output->data, output->data_buffer_len, &out_size),
+        TAG, "Decoding failed");
+    output->h_res = picture_info.width;
+    output->v_res = picture_info.height;
+    output->data_len = out_size;
+    return ESP_OK;
+}
+
+/**
+ * @brief Decoding task
+ *
+ * Waits for free output buffer first, so the UVC driver keeps handling received frames according to the stream's queue policy.
+ *
+ * @param[in] arg Decoding stage
+ */
+static void uvc_jpeg_task(void *arg)
+{
+    struct uvc_host_jpeg_s *jpeg = (struct uvc_host_jpeg_s *)arg;
+
+    while (!UVC_ATOMIC_LOAD(jpeg->closing)) {
+        uvc_host_jpeg_frame_t *output;
+        if (pdPASS != xQueueReceive(jpeg->free_output_queue, &output, pdMS_TO_TICKS(UVC_JPEG_POLL_PERIOD_MS))) {
+            continue; // Both outputs are held by the user
+        }
+
+        uvc_host_frame_t *frame;
+        if (ESP_OK != uvc_host_frame_get(jpeg->stream_hdl, pdMS_TO_TICKS(UVC_JPEG_POLL_PERIOD_MS), &frame)) {
+            xQueueSendToFront(jpeg->free_output_queue, &output, 0);
+            continue;
+        }
+
+        const esp_err_t ret = uvc_jpeg_decode(jpeg, frame, output);
+        uvc_host_frame_return(jpeg->stream_hdl, frame); // The frame buffer is free for USB reception again
+        if (ret != ESP_OK || jpeg->decoded_cb(output, jpeg->user_ctx)) {
+            xQueueSendToFront(jpeg->free_output_queue, &output, 0);
+        }
+    }
+
+    // Inform the closing task that this task will not touch the stage anymore
+    xTaskNotifyGive(jpeg->closing_task);
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief Compute size of output buffer from format of the stream
+ *
+ * @param[in] vs_format     Format of the stream
+ * @param[in] output_format Format of decoded data
+ * @return Size of output buffer in bytes
+ */
+static size_t uvc_jpeg_output_size(const uvc_host_stream_format_t *vs_format, jpeg_dec_output_format_t output_format)
+{
+    const size_t h_res = (vs_format->h_res + UVC_JPEG_PICTURE_ALIGN - 1) & ~(UVC_JPEG_PICTURE_ALIGN - 1);
+    const size_t v_res = (vs_format->v_res + UVC_JPEG_PICTURE_ALIGN - 1) & ~(UVC_JPEG_PICTURE_ALIGN - 1);
+    switch (output_format) {
+    case JPEG_DECODE_OUT_FORMAT_GRAY:
+        return h_res * v_res;
+    case JPEG_DECODE_OUT_FORMAT_RGB565:
+        return h_res * v_res * 2;
+    case JPEG_DECODE_OUT_FORMAT_RGB888:
+    default:
+        return h_res * v_res * 3; // Enough for all formats
+    }
+}
+
+esp_err_t uvc_host_jpeg_create(const uvc_host_jpeg_config_t *config, uvc_host_jpeg_hdl_t *jpeg_hdl_ret)
+{
+    esp_err_t ret;
+    UVC_CHECK(config && config->stream_hdl && config->decoded_cb && jpeg_hdl_ret, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(config->stream_hdl->constant.frame_cb == NULL, ESP_ERR_INVALID_STATE);
+
+    uvc_host_stream_format_t vs_format;
+    ESP_RETURN_ON_ERROR(uvc_host_stream_format_get(config->stream_hdl, &vs_format), TAG,);
+    UVC_CHECK(vs_format.format == UVC_VS_FORMAT_MJPEG, ESP_ERR_NOT_SUPPORTED);
+
+    struct uvc_host_jpeg_s *jpeg = calloc(1, sizeof(struct uvc_host_jpeg_s));
+    UVC_CHECK(jpeg, ESP_ERR_NO_MEM);
+    jpeg->stream_hdl = config->stream_hdl;
+    jpeg->decoded_cb = config->decoded_cb;
+    jpeg->user_ctx = config->user_ctx;
+    jpeg->decode_cfg.output_format = config->output_format;
+    jpeg->decode_cfg.rgb_order = config->rgb_order;
+    jpeg->decode_cfg.conv_std = config->conv_std;
+
+    const jpeg_decode_engine_cfg_t engine_cfg = {
+        .intr_priority = 0,
+        .timeout_ms = config->timeout_ms ? config->timeout_ms : UVC_JPEG_DEFAULT_TIMEOUT,
+    };
+    ESP_GOTO_ON_ERROR(jpeg_new_decoder_engine(&engine_cfg, &jpeg->decoder), err, TAG, "Could not create JPEG decoder");
+
+    // Allocate output buffers
+    jpeg->free_output_queue = xQueueCreate(UVC_JPEG_NUM_OF_OUTPUTS, sizeof(uvc_host_jpeg_frame_t *));
+    ESP_GOTO_ON_FALSE(jpeg->free_output_queue, ESP_ERR_NO_MEM, err, TAG,);
+    const size_t output_size = config->output_buffer_size ? config->output_buffer_size : uvc_jpeg_output_size(&vs_format, config->output_format);
+    const jpeg_decode_memory_alloc_cfg_t mem_cfg = {
+        .buffer_direction = JPEG_DEC_ALLOC_OUTPUT_BUFFER,
+    };
+    for (int i = 0; i < UVC_JPEG_NUM_OF_OUTPUTS; i++) {
+        uvc_host_jpeg_frame_t *output = &jpeg->outputs[i];
+        size_t allocated_size = 0;
+        output->data = jpeg_alloc_decoder_mem(output_size, &mem_cfg, &allocated_size);
+        ESP_GOTO_ON_FALSE(output->data, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for output buffer %zu", output_size);
+        output->data_buffer_len = allocated_size;
+        xQueueSend(jpeg->free_output_queue, &output, 0);
+    }
+
+    ESP_GOTO_ON_FALSE(
+        pdPASS == xTaskCreatePinnedToCore(uvc_jpeg_task, "USB-UVC-jpeg", config->task_stack_size, jpeg,
+                                          config->task_priority, &jpeg->task, config->xCoreID),
+        ESP_ERR_NO_MEM, err, TAG, "Could not create decoding task");
+
+    ESP_LOGD(TAG, "JPEG decoding stage created, %d outputs of %zu bytes", UVC_JPEG_NUM_OF_OUTPUTS, output_size);
+    *jpeg_hdl_ret = jpeg;
+    return ESP_OK;
+
+err:
+    for (int i = 0; i < UVC_JPEG_NUM_OF_OUTPUTS; i++) {
+        free(jpeg->outputs[i].data);
+    }
+    if (jpeg->free_output_queue) {
+        vQueueDelete(jpeg->free_output_queue);
+    }
+    if (jpeg->decoder) {
+        jpeg_del_decoder_engine(jpeg->decoder);
+    }
+    free(jpeg);
+    return ret;
+}
+
+esp_err_t uvc_host_jpeg_delete(uvc_host_jpeg_hdl_t jpeg_hdl)
+{
+    UVC_CHECK(jpeg_hdl, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(xTaskGetCurrentTaskHandle() != jpeg_hdl->task, ESP_ERR_INVALID_STATE);
+
+    // Stop the decoding task. It returns all UVC frames it holds before it ends
+    jpeg_hdl->closing_task = xTaskGetCurrentTaskHandle();
+    __atomic_store_n(&jpeg_hdl->closing, true, __ATOMIC_SEQ_CST);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    for (int i = 0; i < UVC_JPEG_NUM_OF_OUTPUTS; i++) {
+        free(jpeg_hdl->outputs[i].data);
+    }
+    vQueueDelete(jpeg_hdl->free_output_queue);
+    jpeg_del_decoder_engine(jpeg_hdl->decoder);
+    free(jpeg_hdl);
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_jpeg_frame_return(uvc_host_jpeg_hdl_t jpeg_hdl, uvc_host_jpeg_frame_t *frame)
+{
+    UVC_CHECK(jpeg_hdl && frame, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(frame >= &jpeg_hdl->outputs[0] && frame < &jpeg_hdl->outputs[UVC_JPEG_NUM_OF_OUTPUTS], ESP_ERR_INVALID_ARG);
+
+    if (xPortInIsrContext()) {
+        BaseType_t xTaskWoken = pdFALSE;
+        xQueueSendFromISR(jpeg_hdl->free_output_queue, &frame, &xTaskWoken);
+        if (xTaskWoken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xQueueSend(jpeg_hdl->free_output_queue, &frame, 0);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,183 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "usb/usb_host.h"
+#include "uvc_processing_priv.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_trace_priv.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+static const char *TAG = "uvc-processing";
+
+/**
+ * @brief Return USB transfer to the spare pool
+ *
+ * The pool can hold all transfers of the stream, so this never blocks.
+ */
+static inline void uvc_processing_spare_put(uvc_stream_t *uvc_stream, usb_transfer_t *transfer)
+{
+    xQueueSend(uvc_stream->constant.spare_xfer_queue, &transfer, 0);
+}
+
+/**
+ * @brief Processing task of UVC stream
+ *
+ * Processes completed USB transfers in order of their completion.
+ * A processed transfer is resubmitted only if a spare transfer was missing when it completed,
+ * otherwise it becomes a spare transfer. This way the number of transfers in flight stays constant.
+ *
+ * @param[in] arg UVC stream handle
+ */
+static void uvc_processing_task(void *arg)
+{
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)arg;
+    usb_transfer_t *transfer;
+
+    while (1) {
+        xQueueReceive(uvc_stream->constant.processing_queue, &transfer, portMAX_DELAY);
+        if (transfer == NULL) {
+            break; // Stop request
+        }
+
+        bool resubmit = uvc_stream->constant.xfer_process(transfer);
+        if (resubmit) {
+            UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+            resubmit = (uvc_stream->dynamic.missing_xfers > 0);
+            if (resubmit) {
+                uvc_stream->dynamic.missing_xfers--;
+            }
+            UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+        }
+
+        if (resubmit) {
+            UVC_TRACE_SUBMIT(transfer);
+        }
+        if (!resubmit || usb_host_transfer_submit(transfer) != ESP_OK) {
+            uvc_processing_spare_put(uvc_stream, transfer);
+        }
+    }
+
+    // Inform the closing task that this task will not touch the stream anymore
+    xTaskNotifyGive(uvc_stream->constant.processing_task_closing);
+    vTaskDelete(NULL);
+}
+
+esp_err_t uvc_processing_task_create(uvc_stream_t *uvc_stream, unsigned num_of_active_xfers, size_t stack_size, unsigned priority, int xCoreID)
+{
+    assert(uvc_stream);
+    UVC_CHECK(num_of_active_xfers < uvc_stream->constant.num_of_xfers, ESP_ERR_INVALID_ARG);
+
+    // +1 for the stop request
+    uvc_stream->constant.processing_queue = xQueueCreate(uvc_stream->constant.num_of_xfers + 1, sizeof(usb_transfer_t *));
+    uvc_stream->constant.spare_xfer_queue = xQueueCreate(uvc_stream->constant.num_of_xfers, sizeof(usb_transfer_t *));
+    if (!uvc_stream->constant.processing_queue || !uvc_stream->constant.spare_xfer_queue) {
+        goto err;
+    }
+
+    // All transfers are spare until the stream is unpaused
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_xfers; i++) {
+        uvc_processing_spare_put(uvc_stream, uvc_stream->constant.xfers[i]);
+    }
+    uvc_stream->constant.num_of_active_xfers = num_of_active_xfers;
+
+    if (pdPASS != xTaskCreatePinnedToCore(
+                uvc_processing_task, "USB-UVC-proc", stack_size, uvc_stream,
+                priority, &uvc_stream->constant.processing_task, xCoreID)) {
+        goto err;
+    }
+    ESP_LOGD(TAG, "Processing task created, %u active and %u spare transfers",
+             num_of_active_xfers, uvc_stream->constant.num_of_xfers - num_of_active_xfers);
+    return ESP_OK;
+
+err:
+    uvc_processing_task_delete(uvc_stream);
+    return ESP_ERR_NO_MEM;
+}
+
+void uvc_processing_task_delete(uvc_stream_t *uvc_stream)
+{
+    assert(uvc_stream);
+    if (uvc_stream->constant.processing_task) {
+        usb_transfer_t *stop_request = NULL;
+        uvc_stream->constant.processing_task_closing = xTaskGetCurrentTaskHandle();
+        xQueueSend(uvc_stream->constant.processing_queue, &stop_request, portMAX_DELAY);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uvc_stream->constant.processing_task = NULL;
+    }
+    if (uvc_stream->constant.processing_queue) {
+        vQueueDelete(uvc_stream->constant.processing_queue);
+        uvc_stream->constant.processing_queue = NULL;
+    }
+    if (uvc_stream->constant.spare_xfer_queue) {
+        vQueueDelete(uvc_stream->constant.spare_xfer_queue);
+        uvc_stream->constant.spare_xfer_queue = NULL;
+    }
+}
+
+void uvc_processing_defer(uvc_stream_t *uvc_stream, usb_transfer_t *transfer)
+{
+    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming)) {
+        // Keep the endpoint busy: submit a spare transfer before the completed one is processed
+        usb_transfer_t *spare;
+        bool spare_submitted = false;
+        if (pdPASS == xQueueReceive(uvc_stream->constant.spare_xfer_queue, &spare, 0)) {
+            UVC_TRACE_SUBMIT(spare);
+            spare_submitted = (usb_host_transfer_submit(spare) == ESP_OK);
+            if (!spare_submitted) {
+                uvc_processing_spare_put(uvc_stream, spare);
+            }
+        }
+        if (!spare_submitted) {
+            // The processing task resubmits the transfer once it is processed
+            UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+            uvc_stream->dynamic.missing_xfers++;
+            UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+        }
+    }
+
+    // The queue can hold all transfers of the stream, so this never blocks
+    xQueueSend(uvc_stream->constant.processing_queue, &transfer, 0);
+}
+
+esp_err_t uvc_processing_submit(uvc_stream_t *uvc_stream)
+{
+    assert(uvc_stream);
+    esp_err_t ret = ESP_OK;
+    unsigned missing_xfers = 0;
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.missing_xfers = 0;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    for (unsigned i = 0; i < uvc_stream->constant.num_of_active_xfers; i++) {
+        usb_transfer_t *transfer;
+        if (pdPASS != xQueueReceive(uvc_stream->constant.spare_xfer_queue, &transfer, 0)) {
+            // The transfer is still waiting for processing from previous streaming. It is resubmitted once processed
+            missing_xfers++;
+            continue;
+        }
+        UVC_TRACE_SUBMIT(transfer);
+        ret = usb_host_transfer_submit(transfer);
+        if (ret != ESP_OK) {
+            uvc_processing_spare_put(uvc_stream, transfer);
+            ESP_LOGE(TAG, "Could not submit transfer %u", i);
+            break;
+        }
+    }
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.missing_xfers += missing_xfers;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    return ret;
+}
@@ -0,0 +1,138 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h> // For memset
+
+#include "esp_timer.h"
+
+#include "usb/uvc_host.h"
+#include "uvc_stats_priv.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+
+#define UVC_STATS_AVERAGE_SHIFT (4) // Weight of new sample in running averages is 1/16
+
+void uvc_stats_reset(uvc_stream_t *uvc_stream)
+{
+    assert(uvc_stream);
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    memset(&uvc_stream->dynamic.stats, 0, sizeof(uvc_stream->dynamic.stats));
+    uvc_stream->dynamic.stats_payload_bytes = 0;
+    uvc_stream->dynamic.stats_payload_capacity = 0;
+    uvc_stream->dynamic.stats_last_frame_us = 0;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+void uvc_stats_transfer(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer)
+{
+    uvc_host_stream_stats_t *stats = &uvc_stream->dynamic.stats;
+
+    if (transfer->num_isoc_packets == 0) {
+        // Bulk transfer
+        if (transfer->status == USB_TRANSFER_STATUS_COMPLETED && transfer->actual_num_bytes == 0) {
+            UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+            stats->zero_length_packets++;
+            UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+        }
+        return;
+    }
+
+    // Sum up the transfer first, so we enter the critical section only once
+    uint32_t isoc_packets[USB_TRANSFER_STATUS_NO_DEVICE + 1] = {0};
+    uint32_t zero_length_packets = 0;
+    uint64_t payload_bytes = 0;
+    uint64_t payload_capacity = 0;
+    for (int i = 0; i < transfer->num_isoc_packets; i++) {
+        const usb_isoc_packet_desc_t *isoc_desc = &transfer->isoc_packet_desc[i];
+        if ((unsigned)isoc_desc->status <= USB_TRANSFER_STATUS_NO_DEVICE) {
+            isoc_packets[isoc_desc->status]++;
+        }
+        if (isoc_desc->status == USB_TRANSFER_STATUS_COMPLETED) {
+            zero_length_packets += (isoc_desc->actual_num_bytes == 0);
+            payload_bytes       += isoc_desc->actual_num_bytes;
+            payload_capacity    += isoc_desc->num_bytes;
+        }
+    }
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    for (int i = 0; i <= USB_TRANSFER_STATUS_NO_DEVICE; i++) {
+        stats->isoc_packets[i] += isoc_packets[i];
+    }
+    stats->zero_length_packets += zero_length_packets;
+    uvc_stream->dynamic.stats_payload_bytes += payload_bytes;
+    uvc_stream->dynamic.stats_payload_capacity += payload_capacity;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+void uvc_stats_frame_received(uvc_stream_t *uvc_stream)
+{
+    uvc_host_stream_stats_t *stats = &uvc_stream->dynamic.stats;
+    const int64_t now = esp_timer_get_time();
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    const int64_t last = uvc_stream->dynamic.stats_last_frame_us;
+    if (last != 0) {
+        const int64_t interval = now - last;
+        if (stats->frame_interval_us == 0) {
+            stats->frame_interval_us = (uint32_t)interval; // First interval
+        } else {
+            // Running averages of interval and of its deviation
+            const int64_t deviation = interval - stats->frame_interval_us;
+            const int64_t abs_deviation = (deviation < 0) ? -deviation : deviation;
+            stats->frame_interval_us = (uint32_t)(stats->frame_interval_us + deviation / (1 << UVC_STATS_AVERAGE_SHIFT));
+            stats->frame_jitter_us = (uint32_t)(stats->frame_jitter_us + (abs_deviation - (int64_t)stats->frame_jitter_us) / (1 << UVC_STATS_AVERAGE_SHIFT));
+        }
+    }
+    uvc_stream->dynamic.stats_last_frame_us = now;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+void uvc_stats_frame_delivered(uvc_stream_t *uvc_stream)
+{
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.stats.frames_delivered++;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+void uvc_stats_frame_decimated(uvc_stream_t *uvc_stream)
+{
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.stats.frames_decimated++;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+void uvc_stats_frame_dropped(uvc_stream_t *uvc_stream, uvc_stats_drop_t reason)
+{
+    uvc_host_stream_stats_t *stats = &uvc_stream->dynamic.stats;
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    switch (reason) {
+    case UVC_STATS_DROP_ERROR:       stats->frames_dropped.error++; break;
+    case UVC_STATS_DROP_MISSING_EOF: stats->frames_dropped.missing_eof++; break;
+    case UVC_STATS_DROP_OVERFLOW:    stats->frames_dropped.overflow++; break;
+    case UVC_STATS_DROP_UNDERFLOW:   stats->frames_dropped.underflow++; break;
+    case UVC_STATS_DROP_QUEUE_FULL:  stats->frames_dropped.queue_full++; break;
+    case UVC_STATS_DROP_INVALID_JPEG: stats->frames_dropped.invalid_jpeg++; break;
+    default: break;
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+}
+
+esp_err_t uvc_host_stream_get_stats(uvc_host_stream_hdl_t stream_hdl, uvc_host_stream_stats_t *stats)
+{
+    UVC_CHECK(stream_hdl && stats, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    memcpy(stats, &uvc_stream->dynamic.stats, sizeof(uvc_host_stream_stats_t));
+    const uint64_t payload_bytes = uvc_stream->dynamic.stats_payload_bytes;
+    const uint64_t payload_capacity = uvc_stream->dynamic.stats_payload_capacity;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    stats->payload_fill = (payload_capacity > 0) ? (float)payload_bytes / (float)payload_capacity : 0.0f;
+    return ESP_OK;
+}
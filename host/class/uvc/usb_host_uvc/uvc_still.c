@@ -0,0 +1,415 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+// Still image capture, see USB UVC specification ver 1.5, chapter 2.4.2.4
+
+#include <stdbool.h>
+#include <stddef.h> // For offsetof
+#include <stdlib.h> // For calloc
+#include <string.h> // For memcpy
+
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "usb/usb_helpers.h"
+
+#include "uvc_control.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_descriptors_priv.h"
+#include "uvc_frame_priv.h"
+#include "uvc_still_priv.h"
+
+static const char *TAG = "uvc-still";
+
+// Method 3: Size of the still image transfer if the device does not report dwMaxPayloadTransferSize
+#define UVC_STILL_BULK_DEFAULT_SIZE (16 * 1024)
+
+esp_err_t uvc_still_allocate(uvc_stream_t *uvc_stream, size_t fb_size, uint32_t fb_caps)
+{
+    UVC_CHECK(uvc_stream && fb_size > 0, ESP_ERR_INVALID_ARG);
+    if (fb_caps == 0) {
+        fb_caps = MALLOC_CAP_DEFAULT; // In case the user did not fill the config, set it to default
+    }
+
+    // Still images are copied from USB transfers, so the frame buffer does not have to be DMA capable
+    uvc_frame_t *still_fb = calloc(1, sizeof(uvc_frame_t));
+    uint8_t *still_data = heap_caps_malloc(fb_size, fb_caps);
+    SemaphoreHandle_t still_sem = xSemaphoreCreateBinary();
+    if (still_fb == NULL || still_data == NULL || still_sem == NULL) {
+        ESP_LOGE(TAG, "Not enough memory for still frame buffer %zu", fb_size);
+        free(still_fb);
+        free(still_data);
+        if (still_sem) {
+            vSemaphoreDelete(still_sem);
+        }
+        return ESP_ERR_NO_MEM;
+    }
+    still_fb->data_base = still_data;
+    still_fb->frame.data = still_data;
+    still_fb->frame.data_buffer_len = fb_size;
+
+    uvc_stream->constant.still_fb = still_fb;
+    uvc_stream->constant.still_sem = still_sem;
+    uvc_stream->dynamic.still_state = UVC_STILL_IDLE;
+    return ESP_OK;
+}
+
+void uvc_still_free(uvc_stream_t *uvc_stream)
+{
+    if (!uvc_stream || !uvc_stream->constant.still_fb) {
+        return;
+    }
+    if (uvc_stream->constant.still_xfer) {
+        USB_HOST_XFER_POOL_FREE(uvc_stream->constant.still_xfer);
+        uvc_stream->constant.still_xfer = NULL;
+    }
+    free(uvc_stream->constant.still_fb->data_base);
+    free(uvc_stream->constant.still_fb);
+    vSemaphoreDelete(uvc_stream->constant.still_sem);
+    uvc_stream->constant.still_fb = NULL;
+    uvc_stream->constant.still_sem = NULL;
+}
+
+bool uvc_still_is_returned(uvc_stream_t *uvc_stream)
+{
+    if (!uvc_stream->constant.still_fb) {
+        return true;
+    }
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    const bool returned = (uvc_stream->dynamic.still_state == UVC_STILL_IDLE && !uvc_stream->dynamic.still_xfer_busy);
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    return returned;
+}
+
+/**
+ * @brief End still image capture and wake up uvc_host_stream_still_capture()
+ *
+ * @param[in] uvc_stream UVC stream
+ * @param[in] result     Result of the capture
+ */
+static void uvc_still_finish(uvc_stream_t *uvc_stream, esp_err_t result)
+{
+    bool signal = false;
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    switch (uvc_stream->dynamic.still_state) {
+    case UVC_STILL_PENDING:
+    case UVC_STILL_RECEIVING:
+        uvc_stream->dynamic.still_state = UVC_STILL_DONE;
+        uvc_stream->dynamic.still_result = result;
+        signal = true;
+        break;
+    case UVC_STILL_ABORTING:
+        uvc_stream->dynamic.still_state = UVC_STILL_IDLE; // Nobody waits for this capture anymore
+        break;
+    default:
+        break;
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    if (signal) {
+        xSemaphoreGive(uvc_stream->constant.still_sem);
+    }
+}
+
+uvc_host_frame_t *uvc_still_frame_start(uvc_stream_t *uvc_stream)
+{
+    if (!uvc_stream->constant.still_fb) {
+        return NULL;
+    }
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    UVC_STREAM_CHECK_FROM_CRIT(uvc_stream, uvc_stream->dynamic.still_state == UVC_STILL_PENDING, NULL);
+    uvc_stream->dynamic.still_state = UVC_STILL_RECEIVING;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    uvc_host_frame_t *frame = &uvc_stream->constant.still_fb->frame;
+    uvc_frame_reset(frame);
+    return frame;
+}
+
+bool uvc_still_frame_end(uvc_stream_t *uvc_stream, uvc_host_frame_t *frame)
+{
+    if (!uvc_still_is_frame(uvc_stream, frame)) {
+        return false;
+    }
+    uvc_frame_commit(uvc_stream, frame);
+    uvc_still_finish(uvc_stream, ESP_OK);
+    return true;
+}
+
+esp_err_t uvc_still_frame_return(uvc_stream_t *uvc_stream)
+{
+    bool signal = false;
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    switch (uvc_stream->dynamic.still_state) {
+    case UVC_STILL_RECEIVING:
+        // The still image was dropped during reception: corrupted, overflowed or the stream was paused
+        uvc_stream->dynamic.still_state = UVC_STILL_DONE;
+        uvc_stream->dynamic.still_result = ESP_FAIL;
+        signal = true;
+        break;
+    case UVC_STILL_DONE:
+    case UVC_STILL_ABORTING:
+        uvc_stream->dynamic.still_state = UVC_STILL_IDLE;
+        break;
+    default:
+        break;
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    if (signal) {
+        xSemaphoreGive(uvc_stream->constant.still_sem);
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Method 3: Process payload transfer received from still image Bulk endpoint
+ *
+ * The transfer is sized to hold one payload transfer, so each completed transfer starts with payload header.
+ *
+ * @param[in]  uvc_stream UVC stream
+ * @param[in]  transfer   Completed USB transfer
+ * @param[out] result     Result of the capture, valid if true is returned
+ * @return true if the capture ended, false if the transfer must be resubmitted for more data
+ */
+static bool uvc_still_bulk_process(uvc_stream_t *uvc_stream, const usb_transfer_t *transfer, esp_err_t *result)
+{
+    *result = ESP_FAIL;
+    if (transfer->status != USB_TRANSFER_STATUS_COMPLETED) {
+        ESP_LOGW(TAG, "usb err %d", transfer->status);
+        return true;
+    }
+    const size_t len = transfer->actual_num_bytes;
+    if (len == 0) {
+        return false; // Zero length packet, wait for the payload
+    }
+    const uvc_payload_header_t *payload_header = (const uvc_payload_header_t *)transfer->data_buffer;
+    if (len < 2 || payload_header->bHeaderLength < 2 || payload_header->bHeaderLength > len || payload_header->bmHeaderInfo.error) {
+        return true;
+    }
+
+    // The still image starts with the first payload on its endpoint
+    uvc_still_frame_start(uvc_stream);
+    if (UVC_ATOMIC_LOAD(uvc_stream->dynamic.still_state) != UVC_STILL_RECEIVING) {
+        return true; // The capture timed out
+    }
+    uvc_host_frame_t *frame = &uvc_stream->constant.still_fb->frame;
+    if (frame->time.receive_us == 0) {
+        frame->time.receive_us = esp_timer_get_time();
+    }
+    if (uvc_frame_add_data(frame, transfer->data_buffer + payload_header->bHeaderLength, len - payload_header->bHeaderLength) != ESP_OK) {
+        ESP_LOGW(TAG, "Still image does not fit into still frame buffer");
+        return true;
+    }
+    if (payload_header->bmHeaderInfo.end_of_frame) {
+        *result = ESP_OK;
+        return true;
+    }
+    return false;
+}
+
+/**
+ * @brief Method 3: Callback of still image Bulk transfer
+ *
+ * @param[in] transfer Completed USB transfer
+ */
+static void uvc_still_bulk_callback(usb_transfer_t *transfer)
+{
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)transfer->context;
+    esp_err_t result;
+    if (!uvc_still_bulk_process(uvc_stream, transfer, &result)) {
+        if (usb_host_transfer_submit(transfer) == ESP_OK) {
+            return;
+        }
+        result = ESP_FAIL;
+    }
+
+    // The transfer is free before the capture ends, so the next capture can submit it again
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.still_xfer_busy = false;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    if (result == ESP_OK) {
+        uvc_still_frame_end(uvc_stream, &uvc_stream->constant.still_fb->frame);
+    } else {
+        uvc_still_finish(uvc_stream, result);
+    }
+}
+
+/**
+ * @brief Method 3: Prepare USB transfer of still image Bulk endpoint
+ *
+ * @param[in] uvc_stream       UVC stream
+ * @param[in] bEndpointAddress Still image Bulk endpoint
+ * @param[in] payload_size     Negotiated dwMaxPayloadTransferSize of still image, 0 if unknown
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_NOT_SUPPORTED: The endpoint is not Bulk endpoint of the claimed alternate setting
+ *     - ESP_ERR_NO_MEM: Not enough memory for the transfer
+ */
+static esp_err_t uvc_still_xfer_prepare(uvc_stream_t *uvc_stream, uint8_t bEndpointAddress, uint32_t payload_size)
+{
+    int offset = 0;
+    const usb_ep_desc_t *ep_desc = usb_parse_endpoint_descriptor_by_address(
+                                       uvc_stream->constant.desc_cache->index->cfg_desc,
+                                       uvc_stream->constant.bInterfaceNumber,
+                                       uvc_stream->constant.bAlternateSetting,
+                                       bEndpointAddress,
+                                       &offset);
+    UVC_CHECK(ep_desc && USB_EP_DESC_GET_XFERTYPE(ep_desc) == USB_BM_ATTRIBUTES_XFER_BULK, ESP_ERR_NOT_SUPPORTED);
+    const uint16_t max_packet_size = USB_EP_DESC_GET_MPS(ep_desc);
+    UVC_CHECK(max_packet_size > 0, ESP_ERR_NOT_SUPPORTED);
+
+    // One transfer holds one payload transfer, which ends with a short packet or at dwMaxPayloadTransferSize
+    const size_t transfer_size = usb_round_up_to_mps(payload_size ? payload_size : UVC_STILL_BULK_DEFAULT_SIZE, max_packet_size);
+    if (uvc_stream->constant.still_xfer && uvc_stream->constant.still_xfer->num_bytes < transfer_size) {
+        USB_HOST_XFER_POOL_FREE(uvc_stream->constant.still_xfer);
+        uvc_stream->constant.still_xfer = NULL;
+    }
+    if (!uvc_stream->constant.still_xfer) {
+        ESP_RETURN_ON_ERROR(
+            USB_HOST_XFER_POOL_ALLOC(transfer_size, 0, &uvc_stream->constant.still_xfer),
+            TAG, "Could not allocate still image transfer");
+    }
+
+    usb_transfer_t *transfer = uvc_stream->constant.still_xfer;
+    transfer->device_handle = uvc_stream->constant.dev_hdl;
+    transfer->bEndpointAddress = bEndpointAddress;
+    transfer->callback = uvc_still_bulk_callback;
+    transfer->context = uvc_stream;
+    transfer->timeout_ms = 0;
+    transfer->num_bytes = transfer_size;
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_stream_still_capture(uvc_host_stream_hdl_t stream_hdl, unsigned h_res, unsigned v_res, unsigned long timeout, uvc_host_frame_t **still_ret)
+{
+    UVC_CHECK(stream_hdl && still_ret, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = (uvc_stream_t *)stream_hdl;
+    UVC_CHECK(uvc_stream->constant.still_fb, ESP_ERR_NOT_SUPPORTED);
+    esp_err_t ret;
+
+    // Still image sizes are given by Still Image Frame descriptor of the current format
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    const uvc_host_stream_format_t vs_format = uvc_stream->dynamic.vs_format;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    const uvc_desc_index_t *desc_index = uvc_stream->constant.desc_cache->index;
+    const uvc_format_desc_t *format_desc;
+    ESP_RETURN_ON_ERROR(
+        uvc_desc_index_get_frame_format_by_format(desc_index, uvc_stream->constant.bInterfaceNumber, &vs_format, &format_desc, NULL),
+        TAG, "Could not find current format");
+    uint8_t method = 0;
+    const uvc_still_image_frame_desc_t *still_desc;
+    UVC_CHECK(uvc_desc_index_get_still_frame(desc_index, uvc_stream->constant.bInterfaceNumber, format_desc->bFormatIndex, &method, &still_desc) == ESP_OK,
+              ESP_ERR_NOT_SUPPORTED);
+    UVC_CHECK(method == 2 || method == 3, ESP_ERR_NOT_SUPPORTED); // Method 1 still images are regular video frames
+
+    uvc_still_ctrl_t still_control = {
+        .bFormatIndex = format_desc->bFormatIndex,
+    };
+    ESP_RETURN_ON_ERROR(
+        uvc_desc_still_frame_find_size(still_desc, &h_res, &v_res, &still_control.bFrameIndex),
+        TAG, "Still image size %ux%u is not offered", h_res, v_res);
+
+    // bNumCompressionPtn follows the image size patterns. The first compression is used, if any
+    const size_t compression_offset = offsetof(uvc_still_image_frame_desc_t, wWidth) + 4 * still_desc->bNumImageSizePatterns;
+    if (still_desc->bLength > compression_offset && ((const uint8_t *)still_desc)[compression_offset] > 0) {
+        still_control.bCompressionIndex = 1;
+    }
+
+    // Take the still frame buffer. Only one capture can run at a time
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    UVC_STREAM_CHECK_FROM_CRIT(uvc_stream, uvc_stream->dynamic.streaming, ESP_ERR_INVALID_STATE);
+    UVC_STREAM_CHECK_FROM_CRIT(uvc_stream, uvc_stream->dynamic.still_state == UVC_STILL_IDLE && !uvc_stream->dynamic.still_xfer_busy, ESP_ERR_INVALID_STATE);
+    uvc_stream->dynamic.still_state = UVC_STILL_PREPARING;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+
+    // Negotiate the still image format. The video format is not affected
+    ESP_GOTO_ON_ERROR(
+        uvc_host_stream_control_still_commit(uvc_stream, &still_control),
+        release, TAG, "Failed to negotiate still image %ux%u", h_res, v_res);
+    if (method == 3) {
+        ESP_GOTO_ON_ERROR(
+            uvc_still_xfer_prepare(uvc_stream, still_desc->bEndpointAddress, still_control.dwMaxPayloadTransferSize),
+            release, TAG, "Could not prepare still image endpoint 0x%02X", still_desc->bEndpointAddress);
+    }
+
+    uvc_host_frame_t *still_frame = &uvc_stream->constant.still_fb->frame;
+    const uvc_host_stream_format_t still_format = {
+        .h_res = h_res,
+        .v_res = v_res,
+        .fps = 0,
+        .format = vs_format.format,
+    };
+    memcpy((uvc_host_stream_format_t *)&still_frame->vs_format, &still_format, sizeof(uvc_host_stream_format_t));
+    uvc_frame_reset(still_frame);
+    xSemaphoreTake(uvc_stream->constant.still_sem, 0); // Clear signal of a capture that timed out
+
+    // Method 3: The still image comes through its own endpoint, the transfer waits for it
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.still_state = UVC_STILL_PENDING;
+    uvc_stream->dynamic.still_xfer_busy = (method == 3);
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    if (method == 3) {
+        ret = usb_host_transfer_submit(uvc_stream->constant.still_xfer);
+        if (ret != ESP_OK) {
+            UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+            uvc_stream->dynamic.still_xfer_busy = false;
+            UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+            ESP_LOGE(TAG, "Could not submit still image transfer");
+            goto release;
+        }
+    }
+
+    // Request the still image
+    const enum uvc_still_trigger trigger = (method == 2) ? UVC_STILL_TRIGGER_TRANSMIT : UVC_STILL_TRIGGER_TRANSMIT_BULK;
+    ret = uvc_host_stream_control_still_trigger(uvc_stream, trigger);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Could not trigger still image");
+        goto abort;
+    }
+
+    if (xSemaphoreTake(uvc_stream->constant.still_sem, timeout) != pdTRUE) {
+        ret = ESP_ERR_TIMEOUT;
+        goto abort;
+    }
+
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    ret = uvc_stream->dynamic.still_result;
+    if (ret != ESP_OK) {
+        uvc_stream->dynamic.still_state = UVC_STILL_IDLE;
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    if (ret == ESP_OK) {
+        *still_ret = still_frame;
+    }
+    return ret;
+
+abort:
+    // The still image can be received in the meantime. It is then freed once its reception ends
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    if (uvc_stream->dynamic.still_state == UVC_STILL_PENDING) {
+        uvc_stream->dynamic.still_state = UVC_STILL_IDLE;
+    } else if (uvc_stream->dynamic.still_state == UVC_STILL_RECEIVING) {
+        uvc_stream->dynamic.still_state = UVC_STILL_ABORTING;
+    } else if (uvc_stream->dynamic.still_state == UVC_STILL_DONE) {
+        uvc_stream->dynamic.still_state = UVC_STILL_IDLE; // Finished right after the timeout
+    }
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    uvc_host_stream_control_still_trigger(uvc_stream, UVC_STILL_TRIGGER_ABORT); // Gracefully continue on error
+    if (method == 3) {
+        // Pending transfer is returned by its callback with canceled status
+        usb_host_endpoint_halt(uvc_stream->constant.dev_hdl, still_desc->bEndpointAddress);
+        usb_host_endpoint_flush(uvc_stream->constant.dev_hdl, still_desc->bEndpointAddress);
+        usb_host_endpoint_clear(uvc_stream->constant.dev_hdl, still_desc->bEndpointAddress);
+    }
+    return ret;
+
+release:
+    UVC_STREAM_ENTER_CRITICAL(uvc_stream);
+    uvc_stream->dynamic.still_state = UVC_STILL_IDLE;
+    UVC_STREAM_EXIT_CRITICAL(uvc_stream);
+    return ret;
+}
@@ -0,0 +1,230 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+
+#include "usb/uvc_host.h"
+#include "usb/uvc_host_yuv.h"
+#include "uvc_types_priv.h"
+#include "uvc_check_priv.h"
+#include "uvc_critical_priv.h"
+#include "uvc_yuv_priv.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define UVC_YUV_NUM_OF_OUTPUTS (2) // Double-buffered output: one buffer is converted while the other one is processed by the user
+
+static const char *TAG = "uvc-yuv";
+
+struct uvc_host_yuv_s {
+    uvc_host_stream_hdl_t stream_hdl;                      // Source stream of YUY2 frames
+    uvc_host_yuv_callback_t converted_cb;                  // User's converted frame callback
+    void *user_ctx;                                        // User's argument of converted frame callback
+    enum uvc_host_yuv_output_format output_format;         // Format of converted data
+    bool swap_bytes;                                       // RGB565 only: big-endian pixels
+    uvc_host_yuv_frame_t outputs[UVC_YUV_NUM_OF_OUTPUTS];  // Output buffers
+    QueueHandle_t free_output_queue;                       // Queue of output buffers that are not held by the user
+
+    // Members below are accessed only from the context that processes USB transfers
+    uvc_host_yuv_frame_t *current_output;                  // Output of the frame being received. NULL if the frame is not converted
+    size_t converted;                                      // Bytes of the frame being received that were converted
+    size_t frame_size;                                     // Size of complete YUY2 frame
+};
+
+static inline uint8_t uvc_yuv_clamp(int value)
+{
+    return (value < 0) ? 0 : ((value > 255) ? 255 : value);
+}
+
+void uvc_yuv_convert(const uint8_t *src, uint8_t *dst, size_t macropixels, enum uvc_host_yuv_output_format format, bool swap_bytes)
+{
+    for (size_t i = 0; i < macropixels; i++, src += UVC_YUV_MACROPIXEL) {
+        const int u = src[1] - 128;
+        const int v = src[3] - 128;
+        const int r_chroma = 409 * v + 128;
+        const int g_chroma = -100 * u - 208 * v + 128;
+        const int b_chroma = 516 * u + 128;
+
+        for (int p = 0; p < 2; p++) {
+            const int y = 298 * (src[p * 2] - 16);
+            const uint8_t r = uvc_yuv_clamp((y + r_chroma) >> 8);
+            const uint8_t g = uvc_yuv_clamp((y + g_chroma) >> 8);
+            const uint8_t b = uvc_yuv_clamp((y + b_chroma) >> 8);
+            if (format == UVC_HOST_YUV_OUT_RGB565) {
+                const uint16_t pixel = ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+                dst[swap_bytes ? 1 : 0] = pixel & 0xFF;
+                dst[swap_bytes ? 0 : 1] = pixel >> 8;
+                dst += 2;
+            } else {
+                dst[0] = r;
+                dst[1] = g;
+                dst[2] = b;
+                dst += 3;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Take output buffer at start of frame
+ *
+ * The output of previous frame that was not completed is reused.
+ *
+ * @param[in] yuv   Conversion stage
+ * @param[in] frame Frame that starts
+ */
+static void uvc_yuv_frame_start(struct uvc_host_yuv_s *yuv, const uvc_host_frame_t *frame)
+{
+    if (!yuv->current_output && pdPASS != xQueueReceive(yuv->free_output_queue, &yuv->current_output, 0)) {
+        yuv->current_output = NULL; // Both outputs are held by the user, this frame is not converted
+        return;
+    }
+
+    const size_t pixels = frame->vs_format.h_res * frame->vs_format.v_res;
+    uvc_host_yuv_frame_t *output = yuv->current_output;
+    if (frame->vs_format.format != UVC_VS_FORMAT_YUY2 || pixels == 0 ||
+            pixels * uvc_yuv_bytes_per_pixel(yuv->output_format) > output->data_buffer_len) {
+        // The format was changed by uvc_host_stream_format_select()
+        xQueueSendToFront(yuv->free_output_queue, &output, 0);
+        yuv->current_output = NULL;
+        return;
+    }
+    output->h_res = frame->vs_format.h_res;
+    output->v_res = frame->vs_format.v_res;
+    output->data_len = 0;
+    yuv->converted = 0;
+    yuv->frame_size = pixels * 2;
+}
+
+/**
+ * @brief Convert data added to the frame being received
+ *
+ * Only whole macropixels are converted, the rest is converted with the next data.
+ * The output is passed to the user once the frame has all its pixels.
+ *
+ * @param[in] frame  Frame being received
+ * @param[in] offset Offset of the added data, 0 at start of frame
+ * @param[in] arg    Conversion stage
+ */
+static void uvc_yuv_data_cb(const uvc_host_frame_t *frame, size_t offset, void *arg)
+{
+    struct uvc_host_yuv_s *yuv = (struct uvc_host_yuv_s *)arg;
+    if (offset == 0) {
+        uvc_yuv_frame_start(yuv, frame);
+    }
+    uvc_host_yuv_frame_t *output = yuv->current_output;
+    if (!output) {
+        return;
+    }
+
+    const size_t received = (frame->data_len < yuv->frame_size) ? frame->data_len : yuv->frame_size;
+    const size_t macropixels = (received - yuv->converted) / UVC_YUV_MACROPIXEL;
+    if (macropixels == 0) {
+        return;
+    }
+    const size_t bpp = uvc_yuv_bytes_per_pixel(yuv->output_format);
+    uvc_yuv_convert(frame->data + yuv->converted, output->data + yuv->converted / 2 * bpp, macropixels, yuv->output_format, yuv->swap_bytes);
+    yuv->converted += macropixels * UVC_YUV_MACROPIXEL;
+
+    if (yuv->converted == yuv->frame_size) {
+        output->data_len = yuv->frame_size / 2 * bpp;
+        yuv->current_output = NULL;
+        if (yuv->converted_cb(output, yuv->user_ctx)) {
+            xQueueSendToFront(yuv->free_output_queue, &output, 0);
+        }
+    }
+}
+
+esp_err_t uvc_host_yuv_create(const uvc_host_yuv_config_t *config, uvc_host_yuv_hdl_t *yuv_hdl_ret)
+{
+    esp_err_t ret;
+    UVC_CHECK(config && config->stream_hdl && config->converted_cb && yuv_hdl_ret, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = config->stream_hdl;
+    UVC_CHECK(!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming) && uvc_stream->constant.data_cb == NULL &&
+              uvc_stream->constant.sink_cb == NULL, ESP_ERR_INVALID_STATE);
+
+    uvc_host_stream_format_t vs_format;
+    ESP_RETURN_ON_ERROR(uvc_host_stream_format_get(uvc_stream, &vs_format), TAG,);
+    UVC_CHECK(vs_format.format == UVC_VS_FORMAT_YUY2, ESP_ERR_NOT_SUPPORTED);
+
+    struct uvc_host_yuv_s *yuv = calloc(1, sizeof(struct uvc_host_yuv_s));
+    UVC_CHECK(yuv, ESP_ERR_NO_MEM);
+    yuv->stream_hdl = uvc_stream;
+    yuv->converted_cb = config->converted_cb;
+    yuv->user_ctx = config->user_ctx;
+    yuv->output_format = config->output_format;
+    yuv->swap_bytes = config->swap_bytes;
+
+    // Allocate output buffers
+    yuv->free_output_queue = xQueueCreate(UVC_YUV_NUM_OF_OUTPUTS, sizeof(uvc_host_yuv_frame_t *));
+    ESP_GOTO_ON_FALSE(yuv->free_output_queue, ESP_ERR_NO_MEM, err, TAG,);
+    const size_t output_size = config->output_buffer_size ? config->output_buffer_size :
+                               vs_format.h_res * vs_format.v_res * uvc_yuv_bytes_per_pixel(config->output_format);
+    const uint32_t caps = config->output_heap_caps ? config->output_heap_caps : MALLOC_CAP_DEFAULT;
+    for (int i = 0; i < UVC_YUV_NUM_OF_OUTPUTS; i++) {
+        uvc_host_yuv_frame_t *output = &yuv->outputs[i];
+        output->data = heap_caps_malloc(output_size, caps);
+        ESP_GOTO_ON_FALSE(output->data, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for output buffer %zu", output_size);
+        output->data_buffer_len = output_size;
+        xQueueSend(yuv->free_output_queue, &output, 0);
+    }
+
+    // Attach to the stream. It is stopped, so no USB transfer is being processed
+    uvc_stream->constant.data_cb_arg = yuv;
+    uvc_stream->constant.data_cb = uvc_yuv_data_cb;
+
+    ESP_LOGD(TAG, "YUY2 conversion stage created, %d outputs of %zu bytes", UVC_YUV_NUM_OF_OUTPUTS, output_size);
+    *yuv_hdl_ret = yuv;
+    return ESP_OK;
+
+err:
+    for (int i = 0; i < UVC_YUV_NUM_OF_OUTPUTS; i++) {
+        heap_caps_free(yuv->outputs[i].data);
+    }
+    if (yuv->free_output_queue) {
+        vQueueDelete(yuv->free_output_queue);
+    }
+    free(yuv);
+    return ret;
+}
+
+esp_err_t uvc_host_yuv_delete(uvc_host_yuv_hdl_t yuv_hdl)
+{
+    UVC_CHECK(yuv_hdl, ESP_ERR_INVALID_ARG);
+    uvc_stream_t *uvc_stream = yuv_hdl->stream_hdl;
+    UVC_CHECK(!UVC_ATOMIC_LOAD(uvc_stream->dynamic.streaming), ESP_ERR_INVALID_STATE);
+
+    uvc_stream->constant.data_cb = NULL;
+    uvc_stream->constant.data_cb_arg = NULL;
+    for (int i = 0; i < UVC_YUV_NUM_OF_OUTPUTS; i++) {
+        heap_caps_free(yuv_hdl->outputs[i].data);
+    }
+    vQueueDelete(yuv_hdl->free_output_queue);
+    free(yuv_hdl);
+    return ESP_OK;
+}
+
+esp_err_t uvc_host_yuv_frame_return(uvc_host_yuv_hdl_t yuv_hdl, uvc_host_yuv_frame_t *frame)
+{
+    UVC_CHECK(yuv_hdl && frame, ESP_ERR_INVALID_ARG);
+    UVC_CHECK(frame >= &yuv_hdl->outputs[0] && frame < &yuv_hdl->outputs[UVC_YUV_NUM_OF_OUTPUTS], ESP_ERR_INVALID_ARG);
+
+    if (xPortInIsrContext()) {
+        BaseType_t xTaskWoken = pdFALSE;
+        xQueueSendFromISR(yuv_hdl->free_output_queue, &frame, &xTaskWoken);
+        if (xTaskWoken == pdTRUE) {
+            portYIELD_FROM_ISR();
+        }
+    } else {
+        xQueueSend(yuv_hdl->free_output_queue, &frame, 0);
+    }
+    return ESP_OK;
+}
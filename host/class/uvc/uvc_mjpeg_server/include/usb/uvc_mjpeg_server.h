@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "usb/uvc_host.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct uvc_mjpeg_server_s *uvc_mjpeg_server_hdl_t;
+
+/**
+ * @brief Configuration of MJPEG server
+ */
+typedef struct {
+    uint16_t port;                       /**< TCP port of the server, e.g. 80 */
+    unsigned max_clients;                /**< Maximum number of clients streaming at once */
+} uvc_mjpeg_server_config_t;
+
+/**
+ * @brief Statistics of MJPEG server
+ */
+typedef struct {
+    uint32_t frames_sent;                /**< Frames that were sent to a client completely and acknowledged by TCP */
+    uint32_t frames_replaced;            /**< Frames that were replaced by a newer frame before a slow client could start sending them */
+    unsigned clients;                    /**< Number of connected clients */
+} uvc_mjpeg_server_stats_t;
+
+/**
+ * @brief Start MJPEG server
+ *
+ * The server answers every HTTP GET request with multipart/x-mixed-replace stream of JPEG frames.
+ * Frames are sent directly from UVC frame buffers, without copying. Each frame buffer is held by the server
+ * until all clients acknowledged it by TCP ACK, then it is returned by uvc_host_frame_return().
+ *
+ * @param[in]  config     Server configuration
+ * @param[out] server_ret Server handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: config or server_ret is NULL, or max_clients is 0
+ *     - ESP_ERR_NO_MEM: Not enough memory
+ *     - ESP_FAIL: Could not listen on the port
+ */
+esp_err_t uvc_mjpeg_server_start(const uvc_mjpeg_server_config_t *config, uvc_mjpeg_server_hdl_t *server_ret);
+
+/**
+ * @brief Stop MJPEG server
+ *
+ * Connections are closed and all held frames are returned to the UVC driver.
+ * Stop the stream by uvc_host_stream_stop() before, so uvc_mjpeg_server_frame_cb() is not called any more,
+ * and close it by uvc_host_stream_close() after this function.
+ *
+ * @param[in] server Server handle
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: server is NULL
+ */
+esp_err_t uvc_mjpeg_server_stop(uvc_mjpeg_server_hdl_t server);
+
+/**
+ * @brief Set stream whose frames the server sends
+ *
+ * Must be called after uvc_host_stream_open() and before uvc_host_stream_start().
+ * Frames received before the stream is set are returned to the UVC driver right away.
+ *
+ * @param[in] server     Server handle
+ * @param[in] stream_hdl Stream opened with uvc_mjpeg_server_frame_cb() as frame callback and the server as user_ctx
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: server is NULL
+ */
+esp_err_t uvc_mjpeg_server_stream_set(uvc_mjpeg_server_hdl_t server, uvc_host_stream_hdl_t stream_hdl);
+
+/**
+ * @brief Frame callback that passes MJPEG frames to the server
+ *
+ * Set it as frame_cb in uvc_host_stream_config_t, with the server handle as user_ctx.
+ * Slow clients get latest-frame semantics: a frame waiting for a client that is still sending
+ * the previous frame is replaced by the new one.
+ *
+ * @param[in] frame    Received frame
+ * @param[in] user_ctx Server handle
+ * @return true if no client takes the frame, false if the server holds it
+ */
+bool uvc_mjpeg_server_frame_cb(const uvc_host_frame_t *frame, void *user_ctx);
+
+/**
+ * @brief Get statistics of MJPEG server
+ *
+ * @param[in]  server Server handle
+ * @param[out] stats  Statistics
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: server or stats is NULL
+ */
+esp_err_t uvc_mjpeg_server_get_stats(uvc_mjpeg_server_hdl_t server, uvc_mjpeg_server_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
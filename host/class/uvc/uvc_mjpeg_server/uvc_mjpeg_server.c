@@ -0,0 +1,578 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h> // For MIN
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/tcp.h"
+#include "lwip/tcpip.h"
+#include "lwip/priv/tcpip_priv.h"
+#include "usb/uvc_mjpeg_server.h"
+
+static const char *TAG = "uvc-mjpeg";
+
+#define MJPEG_BOUNDARY         "uvcmjpegframe"
+#define MJPEG_PART_HEADER_MAX  (96) // Boundary, Content-Type and Content-Length of one part
+#define MJPEG_POLL_INTERVAL    (2)  // TCP poll interval in units of 500 ms. Retries sending that ran out of lwIP memory
+
+#define MJPEG_ENTER_CRITICAL(server) portENTER_CRITICAL(&(server)->lock)
+#define MJPEG_EXIT_CRITICAL(server)  portEXIT_CRITICAL(&(server)->lock)
+
+static const char mjpeg_response[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=" MJPEG_BOUNDARY "\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: close\r\n"
+    "\r\n";
+static const char mjpeg_part_end[] = "\r\n";
+static const char mjpeg_end_of_header[] = "\r\n\r\n";
+
+typedef struct uvc_mjpeg_server_s uvc_mjpeg_server_t;
+
+/**
+ * @brief Frame being sent to one client
+ */
+typedef struct {
+    const uvc_host_frame_t *frame;        // Frame of this part, NULL if none
+    size_t total;                         // Length of the part: header, frame data and part end
+    size_t queued;                        // Bytes of the part passed to tcp_write()
+    size_t acked;                         // Bytes of the part acknowledged by the client
+    size_t header_len;                    // Length of header
+    char header[MJPEG_PART_HEADER_MAX];   // Part header, copied by tcp_write()
+} mjpeg_tx_t;
+
+/**
+ * @brief Client connection
+ */
+typedef struct {
+    uvc_mjpeg_server_t *server;
+    struct tcp_pcb *pcb;                  // Connection, NULL if this slot is free
+    bool streaming;                       // HTTP request was answered, frames are sent. Written only in TCP/IP thread, under server lock
+    const uvc_host_frame_t *pending;      // Latest frame waiting for the client. Protected by server lock
+    mjpeg_tx_t tx[2];                     // Frames in flight, tx[0] is the oldest one
+    size_t response_unacked;              // Bytes of HTTP response header not yet acknowledged
+    char request_method[4];               // Begin of HTTP request
+    size_t request_len;                   // Received bytes of HTTP request
+    size_t end_of_header_matched;         // Bytes of end of HTTP request header matched so far
+} mjpeg_client_t;
+
+/**
+ * @brief Frame held by the server
+ */
+typedef struct {
+    const uvc_host_frame_t *frame;        // Held frame, NULL if this slot is free
+    unsigned refs;                        // Number of clients that still send the frame or wait for it
+} mjpeg_held_frame_t;
+
+struct uvc_mjpeg_server_s {
+    portMUX_TYPE lock;                    // Protects members shared by frame callback and TCP/IP thread
+    uvc_host_stream_hdl_t stream_hdl;     // Stream the held frames are returned to
+    struct tcp_pcb *listen_pcb;           // Listening connection. Accessed only in TCP/IP thread
+    bool kick_pending;                    // Sending of new frame was requested from TCP/IP thread
+    unsigned max_clients;
+    mjpeg_client_t *clients;              // Array of max_clients connections
+    unsigned max_held;
+    mjpeg_held_frame_t *held;             // Array of max_held frames
+    const uvc_host_frame_t **replaced;    // Frame callback only: frames replaced by the new frame
+    uvc_mjpeg_server_stats_t stats;
+};
+
+/**
+ * @brief Message of calls into TCP/IP thread
+ */
+typedef struct {
+    struct tcpip_api_call_data call;      // Must be the first member
+    uvc_mjpeg_server_t *server;
+    uint16_t port;
+} mjpeg_api_msg_t;
+
+/**
+ * @brief Release reference of a client to the frame, return the frame to the UVC driver by the last one
+ */
+static void mjpeg_frame_release(uvc_mjpeg_server_t *server, const uvc_host_frame_t *frame)
+{
+    if (frame == NULL) {
+        return;
+    }
+    bool return_frame = false;
+    MJPEG_ENTER_CRITICAL(server);
+    for (unsigned i = 0; i < server->max_held; i++) {
+        if (server->held[i].frame == frame) {
+            if (--server->held[i].refs == 0) {
+                server->held[i].frame = NULL;
+                return_frame = true;
+            }
+            break;
+        }
+    }
+    uvc_host_stream_hdl_t stream_hdl = server->stream_hdl;
+    MJPEG_EXIT_CRITICAL(server);
+
+    if (return_frame) {
+        uvc_host_frame_return(stream_hdl, (uvc_host_frame_t *)frame);
+    }
+}
+
+/**
+ * @brief Close client connection and release its frames
+ *
+ * @param[in] client    Client
+ * @param[in] pcb_alive The connection was not freed by lwIP yet, it is aborted here
+ */
+static void mjpeg_client_close(mjpeg_client_t *client, bool pcb_alive)
+{
+    uvc_mjpeg_server_t *server = client->server;
+    if (pcb_alive && client->pcb) {
+        // Aborted connection frees its segments right away, so no frame data are referenced by lwIP after this
+        tcp_arg(client->pcb, NULL);
+        tcp_recv(client->pcb, NULL);
+        tcp_sent(client->pcb, NULL);
+        tcp_err(client->pcb, NULL);
+        tcp_poll(client->pcb, NULL, 0);
+        tcp_abort(client->pcb);
+    }
+    client->pcb = NULL;
+
+    MJPEG_ENTER_CRITICAL(server);
+    const uvc_host_frame_t *pending = client->pending;
+    client->pending = NULL;
+    client->streaming = false;
+    server->stats.clients--;
+    MJPEG_EXIT_CRITICAL(server);
+
+    mjpeg_frame_release(server, pending);
+    mjpeg_frame_release(server, client->tx[0].frame);
+    mjpeg_frame_release(server, client->tx[1].frame);
+    memset(client->tx, 0, sizeof(client->tx));
+}
+
+/**
+ * @brief Start sending the pending frame in tx
+ *
+ * @return true if there was a pending frame
+ */
+static bool mjpeg_tx_start(mjpeg_client_t *client, mjpeg_tx_t *tx)
+{
+    MJPEG_ENTER_CRITICAL(client->server);
+    const uvc_host_frame_t *frame = client->pending;
+    client->pending = NULL;
+    MJPEG_EXIT_CRITICAL(client->server);
+    if (frame == NULL) {
+        return false;
+    }
+
+    const int header_len = snprintf(tx->header, sizeof(tx->header),
+                                    "--" MJPEG_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: %u\r\n\r\n",
+                                    (unsigned)frame->data_len);
+    assert(header_len > 0 && header_len < (int)sizeof(tx->header));
+    tx->frame = frame;
+    tx->header_len = header_len;
+    tx->total = header_len + frame->data_len + strlen(mjpeg_part_end);
+    tx->queued = 0;
+    tx->acked = 0;
+    return true;
+}
+
+/**
+ * @brief Pass the rest of the part to lwIP, as far as its send buffer allows
+ *
+ * The part header is copied. The frame data are only referenced by the TCP segments (scatter-gather),
+ * they must stay valid until they are acknowledged.
+ *
+ * @return
+ *     - ERR_OK: The whole part was queued
+ *     - ERR_MEM: The send buffer is full, continue when some data are acknowledged
+ *     - Else: Connection error
+ */
+static err_t mjpeg_tx_queue(struct tcp_pcb *pcb, mjpeg_tx_t *tx)
+{
+    const size_t data_end = tx->header_len + tx->frame->data_len;
+    while (tx->queued < tx->total) {
+        const size_t sndbuf = tcp_sndbuf(pcb);
+        if (sndbuf == 0) {
+            return ERR_MEM;
+        }
+        const void *ptr;
+        size_t len;
+        u8_t flags = 0; // Frame data and static part end are not copied
+        if (tx->queued < tx->header_len) {
+            ptr = tx->header + tx->queued;
+            len = tx->header_len - tx->queued;
+            flags = TCP_WRITE_FLAG_COPY;
+        } else if (tx->queued < data_end) {
+            ptr = tx->frame->data + (tx->queued - tx->header_len);
+            len = data_end - tx->queued;
+        } else {
+            ptr = mjpeg_part_end + (tx->queued - data_end);
+            len = tx->total - tx->queued;
+        }
+        len = MIN(MIN(len, sndbuf), 0xFFFF);
+        if (tx->queued + len < tx->total) {
+            flags |= TCP_WRITE_FLAG_MORE;
+        }
+        const err_t err = tcp_write(pcb, ptr, (u16_t)len, flags);
+        if (err != ERR_OK) {
+            return err;
+        }
+        tx->queued += len;
+    }
+    return ERR_OK;
+}
+
+/**
+ * @brief Queue parts of frames in flight, and of the pending frame once there is room for it
+ *
+ * @return ERR_ABRT if the connection was aborted, ERR_OK otherwise
+ */
+static err_t mjpeg_client_send(mjpeg_client_t *client)
+{
+    if (client->pcb == NULL || !client->streaming) {
+        return ERR_OK;
+    }
+    for (;;) {
+        mjpeg_tx_t *tx;
+        if (client->tx[0].frame && client->tx[0].queued < client->tx[0].total) {
+            tx = &client->tx[0];
+        } else if (client->tx[1].frame && client->tx[1].queued < client->tx[1].total) {
+            tx = &client->tx[1];
+        } else if (!client->tx[0].frame && mjpeg_tx_start(client, &client->tx[0])) {
+            tx = &client->tx[0];
+        } else if (client->tx[0].frame && !client->tx[1].frame && mjpeg_tx_start(client, &client->tx[1])) {
+            tx = &client->tx[1];
+        } else {
+            break; // Nothing more to send
+        }
+
+        const err_t err = mjpeg_tx_queue(client->pcb, tx);
+        if (err == ERR_MEM) {
+            break;
+        } else if (err != ERR_OK) {
+            ESP_LOGW(TAG, "Send error %d, closing connection", err);
+            mjpeg_client_close(client, true);
+            return ERR_ABRT;
+        }
+    }
+    tcp_output(client->pcb);
+    return ERR_OK;
+}
+
+static err_t mjpeg_sent(void *arg, struct tcp_pcb *pcb, u16_t len)
+{
+    mjpeg_client_t *client = (mjpeg_client_t *)arg;
+    uvc_mjpeg_server_t *server = client->server;
+
+    const size_t response_acked = MIN(client->response_unacked, len);
+    client->response_unacked -= response_acked;
+    len -= response_acked;
+
+    // Frame is returned once all its bytes are acknowledged, frame data are not referenced by lwIP any more
+    while (len > 0 && client->tx[0].frame) {
+        mjpeg_tx_t *tx = &client->tx[0];
+        const size_t acked = MIN(tx->queued - tx->acked, len);
+        if (acked == 0) {
+            break;
+        }
+        tx->acked += acked;
+        len -= acked;
+        if (tx->acked == tx->total) {
+            const uvc_host_frame_t *frame = tx->frame;
+            client->tx[0] = client->tx[1];
+            memset(&client->tx[1], 0, sizeof(mjpeg_tx_t));
+            MJPEG_ENTER_CRITICAL(server);
+            server->stats.frames_sent++;
+            MJPEG_EXIT_CRITICAL(server);
+            mjpeg_frame_release(server, frame);
+        }
+    }
+    return mjpeg_client_send(client);
+}
+
+static err_t mjpeg_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p, err_t err)
+{
+    mjpeg_client_t *client = (mjpeg_client_t *)arg;
+    if (p == NULL || err != ERR_OK) {
+        // Connection closed by the client
+        if (p) {
+            pbuf_free(p);
+        }
+        mjpeg_client_close(client, true);
+        return ERR_ABRT;
+    }
+    tcp_recved(pcb, p->tot_len);
+
+    // Only end of HTTP request header is searched for, the requested path is not checked
+    bool request_end = false;
+    for (struct pbuf *q = p; q && !client->streaming && !request_end; q = q->next) {
+        const char *data = (const char *)q->payload;
+        for (u16_t i = 0; i < q->len && !request_end; i++) {
+            if (client->request_len < sizeof(client->request_method)) {
+                client->request_method[client->request_len] = data[i];
+            }
+            client->request_len++;
+            if (data[i] == mjpeg_end_of_header[client->end_of_header_matched]) {
+                client->end_of_header_matched++;
+            } else {
+                client->end_of_header_matched = (data[i] == '\r') ? 1 : 0;
+            }
+            request_end = (client->end_of_header_matched == strlen(mjpeg_end_of_header));
+        }
+    }
+    pbuf_free(p);
+
+    if (request_end) {
+        if (client->request_len < sizeof(client->request_method) ||
+                memcmp(client->request_method, "GET ", sizeof(client->request_method)) != 0) {
+            ESP_LOGW(TAG, "Unsupported HTTP request, closing connection");
+            mjpeg_client_close(client, true);
+            return ERR_ABRT;
+        }
+        if (tcp_write(pcb, mjpeg_response, strlen(mjpeg_response), 0) != ERR_OK) {
+            mjpeg_client_close(client, true);
+            return ERR_ABRT;
+        }
+        client->response_unacked = strlen(mjpeg_response);
+        MJPEG_ENTER_CRITICAL(client->server);
+        client->streaming = true;
+        MJPEG_EXIT_CRITICAL(client->server);
+        tcp_output(pcb);
+    }
+    return ERR_OK;
+}
+
+static void mjpeg_err(void *arg, err_t err)
+{
+    mjpeg_client_t *client = (mjpeg_client_t *)arg;
+    if (client) {
+        // The connection was already freed by lwIP
+        client->pcb = NULL;
+        mjpeg_client_close(client, false);
+    }
+}
+
+static err_t mjpeg_poll(void *arg, struct tcp_pcb *pcb)
+{
+    return mjpeg_client_send((mjpeg_client_t *)arg);
+}
+
+static err_t mjpeg_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    uvc_mjpeg_server_t *server = (uvc_mjpeg_server_t *)arg;
+    if (err != ERR_OK || newpcb == NULL) {
+        return ERR_VAL;
+    }
+
+    mjpeg_client_t *client = NULL;
+    for (unsigned i = 0; i < server->max_clients; i++) {
+        if (server->clients[i].pcb == NULL) {
+            client = &server->clients[i];
+            break;
+        }
+    }
+    if (client == NULL) {
+        ESP_LOGW(TAG, "Too many clients");
+        tcp_abort(newpcb);
+        return ERR_ABRT;
+    }
+
+    memset(client, 0, sizeof(mjpeg_client_t));
+    client->server = server;
+    client->pcb = newpcb;
+    MJPEG_ENTER_CRITICAL(server);
+    server->stats.clients++;
+    MJPEG_EXIT_CRITICAL(server);
+
+    tcp_arg(newpcb, client);
+    tcp_recv(newpcb, mjpeg_recv);
+    tcp_sent(newpcb, mjpeg_sent);
+    tcp_err(newpcb, mjpeg_err);
+    tcp_poll(newpcb, mjpeg_poll, MJPEG_POLL_INTERVAL);
+    tcp_nagle_disable(newpcb); // Ends of frames are sent without waiting for ACK of previous segments
+    return ERR_OK;
+}
+
+/**
+ * @brief Start sending of new frame to idle clients, called in TCP/IP thread
+ */
+static void mjpeg_kick(void *ctx)
+{
+    uvc_mjpeg_server_t *server = (uvc_mjpeg_server_t *)ctx;
+    MJPEG_ENTER_CRITICAL(server);
+    server->kick_pending = false;
+    MJPEG_EXIT_CRITICAL(server);
+    for (unsigned i = 0; i < server->max_clients; i++) {
+        mjpeg_client_send(&server->clients[i]);
+    }
+}
+
+static err_t mjpeg_listen_api(struct tcpip_api_call_data *call)
+{
+    mjpeg_api_msg_t *msg = (mjpeg_api_msg_t *)call;
+    uvc_mjpeg_server_t *server = msg->server;
+
+    struct tcp_pcb *pcb = tcp_new_ip_type(IPADDR_TYPE_ANY);
+    if (pcb == NULL) {
+        return ERR_MEM;
+    }
+    err_t err = tcp_bind(pcb, IP_ANY_TYPE, msg->port);
+    if (err != ERR_OK) {
+        tcp_close(pcb);
+        return err;
+    }
+    struct tcp_pcb *listen_pcb = tcp_listen_with_backlog(pcb, (u8_t)MIN(server->max_clients, 0xFF));
+    if (listen_pcb == NULL) {
+        tcp_close(pcb);
+        return ERR_MEM;
+    }
+    tcp_arg(listen_pcb, server);
+    tcp_accept(listen_pcb, mjpeg_accept);
+    server->listen_pcb = listen_pcb;
+    return ERR_OK;
+}
+
+static err_t mjpeg_close_api(struct tcpip_api_call_data *call)
+{
+    mjpeg_api_msg_t *msg = (mjpeg_api_msg_t *)call;
+    uvc_mjpeg_server_t *server = msg->server;
+
+    if (server->listen_pcb) {
+        tcp_arg(server->listen_pcb, NULL);
+        tcp_accept(server->listen_pcb, NULL);
+        tcp_close(server->listen_pcb);
+        server->listen_pcb = NULL;
+    }
+    for (unsigned i = 0; i < server->max_clients; i++) {
+        if (server->clients[i].pcb) {
+            mjpeg_client_close(&server->clients[i], true);
+        }
+    }
+    return ERR_OK;
+}
+
+static void mjpeg_server_free(uvc_mjpeg_server_t *server)
+{
+    free(server->clients);
+    free(server->held);
+    free(server->replaced);
+    free(server);
+}
+
+esp_err_t uvc_mjpeg_server_start(const uvc_mjpeg_server_config_t *config, uvc_mjpeg_server_hdl_t *server_ret)
+{
+    ESP_RETURN_ON_FALSE(config && server_ret && config->max_clients > 0, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+
+    uvc_mjpeg_server_t *server = calloc(1, sizeof(uvc_mjpeg_server_t));
+    ESP_RETURN_ON_FALSE(server, ESP_ERR_NO_MEM, TAG, "Not enough memory for server");
+    portMUX_INITIALIZE(&server->lock);
+    server->max_clients = config->max_clients;
+    // Each client holds up to two frames in flight and one pending frame, the new frame is held before replaced ones are released
+    server->max_held = 3 * config->max_clients + 1;
+    server->clients = calloc(server->max_clients, sizeof(mjpeg_client_t));
+    server->held = calloc(server->max_held, sizeof(mjpeg_held_frame_t));
+    server->replaced = calloc(server->max_clients, sizeof(const uvc_host_frame_t *));
+    if (!server->clients || !server->held || !server->replaced) {
+        mjpeg_server_free(server);
+        ESP_LOGE(TAG, "Not enough memory for clients");
+        return ESP_ERR_NO_MEM;
+    }
+
+    mjpeg_api_msg_t msg = {
+        .server = server,
+        .port = config->port,
+    };
+    const err_t err = tcpip_api_call(mjpeg_listen_api, &msg.call);
+    if (err != ERR_OK) {
+        mjpeg_server_free(server);
+        ESP_LOGE(TAG, "Could not listen on port %u: %d", config->port, err);
+        return (err == ERR_MEM) ? ESP_ERR_NO_MEM : ESP_FAIL;
+    }
+    *server_ret = server;
+    return ESP_OK;
+}
+
+esp_err_t uvc_mjpeg_server_stop(uvc_mjpeg_server_hdl_t server)
+{
+    ESP_RETURN_ON_FALSE(server, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+
+    // Calls of mjpeg_kick() requested by the frame callback are processed before this call
+    mjpeg_api_msg_t msg = {
+        .server = server,
+    };
+    tcpip_api_call(mjpeg_close_api, &msg.call);
+    mjpeg_server_free(server);
+    return ESP_OK;
+}
+
+esp_err_t uvc_mjpeg_server_stream_set(uvc_mjpeg_server_hdl_t server, uvc_host_stream_hdl_t stream_hdl)
+{
+    ESP_RETURN_ON_FALSE(server, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    MJPEG_ENTER_CRITICAL(server);
+    server->stream_hdl = stream_hdl;
+    MJPEG_EXIT_CRITICAL(server);
+    return ESP_OK;
+}
+
+bool uvc_mjpeg_server_frame_cb(const uvc_host_frame_t *frame, void *user_ctx)
+{
+    uvc_mjpeg_server_t *server = (uvc_mjpeg_server_t *)user_ctx;
+    if (frame->vs_format.format != UVC_VS_FORMAT_MJPEG || frame->data_len == 0) {
+        return true;
+    }
+
+    unsigned refs = 0;
+    unsigned replaced = 0;
+    bool kick = false;
+    MJPEG_ENTER_CRITICAL(server);
+    if (server->stream_hdl) {
+        // Latest-frame semantics: frame that a slow client did not start yet is replaced by the new one
+        for (unsigned i = 0; i < server->max_clients; i++) {
+            mjpeg_client_t *client = &server->clients[i];
+            if (!client->streaming) {
+                continue;
+            }
+            if (client->pending) {
+                server->replaced[replaced++] = client->pending;
+                server->stats.frames_replaced++;
+            }
+            client->pending = frame;
+            refs++;
+        }
+    }
+    if (refs > 0) {
+        for (unsigned i = 0; i < server->max_held; i++) {
+            if (server->held[i].frame == NULL) {
+                server->held[i].frame = frame;
+                server->held[i].refs = refs;
+                break;
+            }
+        }
+        kick = !server->kick_pending;
+        server->kick_pending = true;
+    }
+    MJPEG_EXIT_CRITICAL(server);
+
+    for (unsigned i = 0; i < replaced; i++) {
+        mjpeg_frame_release(server, server->replaced[i]);
+    }
+    if (kick && tcpip_try_callback(mjpeg_kick, server) != ERR_OK) {
+        // TCP/IP mailbox is full, the frame is sent from the next TCP poll of the clients
+        MJPEG_ENTER_CRITICAL(server);
+        server->kick_pending = false;
+        MJPEG_EXIT_CRITICAL(server);
+    }
+    return refs == 0;
+}
+
+esp_err_t uvc_mjpeg_server_get_stats(uvc_mjpeg_server_hdl_t server, uvc_mjpeg_server_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(server && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    MJPEG_ENTER_CRITICAL(server);
+    *stats = server->stats;
+    MJPEG_EXIT_CRITICAL(server);
+    return ESP_OK;
+}
@@ -1,21 +1,45 @@
 #!/bin/bash
 
+# Usage: run_host_tests.sh [--bench [<report_file>]]
+#
+# Without arguments, all host tests are run.
+# With --bench, only benchmarks of all class drivers are run, their JSON results are collected into <report_file>,
+# host_bench_report.jsonl by default, one object per line, see host/class/host_test_common/usb_bench.hpp
+
 # Extra arguments for the .elf files, to make the host test results and failures more informative
 # (https://github.com/catchorg/Catch2/tree/devel/docs)
 EXTRA_ARGS="--reporter Automake --reporter console::out=-::colour-mode=ansi"
 
+BENCH_REPORT=""
+if [ "$1" == "--bench" ]; then
+    BENCH_REPORT="${2:-host_bench_report.jsonl}"
+    BENCH_TAGS="[benchmark],[!benchmark]"
+    : > "$BENCH_REPORT"
+fi
+
 # Indicator for the CI job, whether a host test has failed or not
 TEST_FAILED=0
 
 ## Find all host_test*.elf files
 for test_file in $(find . -type f -name "host_test*.elf"); do
     echo "Running $test_file..."
-    "$test_file" $EXTRA_ARGS    # Call the host_test*.elf file with the extra arguments
-    if [ $? -ne 0 ]; then       # Check whether the host test failed
+    if [ -n "$BENCH_REPORT" ]; then
+        # Results are printed and collected, the exit value is the one of the test
+        "$test_file" "$BENCH_TAGS" --allow-running-no-tests | tee /dev/stderr | grep '^{"driver"' >> "$BENCH_REPORT"
+        TEST_RESULT=${PIPESTATUS[0]}
+    else
+        "$test_file" $EXTRA_ARGS    # Call the host_test*.elf file with the extra arguments
+        TEST_RESULT=$?
+    fi
+    if [ $TEST_RESULT -ne 0 ]; then # Check whether the host test failed
         TEST_FAILED=1
     fi
 done
 
+if [ -n "$BENCH_REPORT" ]; then
+    echo "Benchmark results: $(wc -l < "$BENCH_REPORT") in $BENCH_REPORT"
+fi
+
 # Return exit value 1 (FAIL) 0 (PASS) to ensure that the CI job passes/fails
 if [ $TEST_FAILED -ne 0 ]; then
     echo "Some host tests failed."